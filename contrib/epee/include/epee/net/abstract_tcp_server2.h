@@ -41,6 +41,7 @@
 #include <vector>
 #include <atomic>
 #include <cassert>
+#include <functional>
 #include <map>
 #include <memory>
 
@@ -120,7 +121,7 @@ namespace net_utils
     void save_dbg_log();
 
 
-		bool speed_limit_is_enabled() const; ///< tells us should we be sleeping here (e.g. do not sleep on RPC connections)
+		bool speed_limit_is_enabled() const; ///< tells us should we be pacing here (e.g. do not pace RPC connections)
 
     bool cancel();
     
@@ -150,6 +151,12 @@ namespace net_utils
     /// Handle completion of a write operation.
     void handle_write(const boost::system::error_code& e, size_t cb);
 
+    /// Writes the front of the send queue once the rate limits allow it.  Call with
+    /// `m_send_que_lock` held and a non-empty queue.
+    void start_write();
+    /// Queues the next read, after `delay` if incoming traffic is over the rate limits.
+    void start_read(std::chrono::steady_clock::duration delay);
+
     /// reset connection timeout timer and callback
     void reset_timer(std::chrono::milliseconds ms, bool add);
     std::chrono::milliseconds get_default_timeout();
@@ -182,6 +189,8 @@ namespace net_utils
     std::mutex m_throttle_speed_out_mutex;
 
     boost::asio::steady_timer m_timer;
+    boost::asio::steady_timer m_pace_write_timer; // delays writes/reads that are over the rate limits
+    boost::asio::steady_timer m_pace_read_timer;
     bool m_local;
     bool m_ready_to_close;
     std::string m_host;
@@ -239,6 +248,9 @@ namespace net_utils
 
     void set_threads_prefix(const std::string& prefix_name);
 
+    /// Sets a function each worker thread calls, with its thread index, before it starts serving
+    void set_thread_init(std::function<void(uint32_t)> init) { m_thread_init = std::move(init); }
+
     bool deinit_server(){return true;}
 
     size_t get_threads_count(){return m_threads_count;}
@@ -367,6 +379,7 @@ namespace net_utils
     std::thread::id m_main_thread_id;
     std::mutex m_threads_lock;
     std::atomic<uint32_t> m_thread_index;
+    std::function<void(uint32_t)> m_thread_init;
 
     t_connection_type m_connection_type;
 
@@ -100,6 +100,8 @@ PRAGMA_WARNING_DISABLE_VS(4355)
 		m_throttle_speed_in("speed_in", "throttle_speed_in"),
 		m_throttle_speed_out("speed_out", "throttle_speed_out"),
 		m_timer(GET_IO_SERVICE(socket_)),
+		m_pace_write_timer(GET_IO_SERVICE(socket_)),
+		m_pace_read_timer(GET_IO_SERVICE(socket_)),
 		m_local(false),
 		m_ready_to_close(false)
   {
@@ -175,6 +177,7 @@ PRAGMA_WARNING_DISABLE_VS(4355)
 
     context = t_connection_context{};
     context.set_details(random_uuid, std::move(real_remote), is_income);
+    m_zone = context.m_remote_address.get_zone();
 
     boost::system::error_code ec;
     auto local_ep = socket().local_endpoint(ec);
@@ -334,26 +337,9 @@ PRAGMA_WARNING_DISABLE_VS(4355)
 			epee::net_utils::network_throttle_manager::network_throttle_manager::get_global_throttle_in().handle_trafic_exact(bytes_transferred);
 		}
 
-		double delay=0; // will be calculated - how much we should sleep to obey speed limit etc
+		// over the limit: hold off on the next read (letting TCP push back on the sender) rather than sleeping here
+		const auto delay = speed_limit_is_enabled() ? reserve_down(bytes_transferred) : std::chrono::steady_clock::duration::zero();
 
-
-		if (speed_limit_is_enabled()) {
-			do // keep sleeping if we should sleep
-			{
-				{
-					std::lock_guard lock{epee::net_utils::network_throttle_manager::m_lock_get_global_throttle_in};
-					delay = epee::net_utils::network_throttle_manager::get_global_throttle_in().get_sleep_time_after_tick( bytes_transferred );
-				}
-				
-				delay *= 0.5;
-				long int ms = (long int)(delay * 100);
-				if (ms > 0) {
-					reset_timer(std::chrono::milliseconds(ms + 1), true);
-					std::this_thread::sleep_for(std::chrono::milliseconds{ms});
-				}
-			} while(delay > 0);
-		} // any form of sleeping
-		
       //MINFO("[sock " << socket().native_handle() << "] RECV " << bytes_transferred);
       logger_handle_net_read(bytes_transferred);
       context.m_last_recv = std::chrono::steady_clock::now();
@@ -375,12 +361,8 @@ PRAGMA_WARNING_DISABLE_VS(4355)
           shutdown();
       }else
       {
-        reset_timer(get_timeout_from_bytes_read(bytes_transferred), false);
-        socket().async_read_some(boost::asio::buffer(buffer_),
-          strand_.wrap(
-            boost::bind(&connection<t_protocol_handler>::handle_read, connection<t_protocol_handler>::shared_from_this(),
-              boost::asio::placeholders::error,
-              boost::asio::placeholders::bytes_transferred)));
+        reset_timer(get_timeout_from_bytes_read(bytes_transferred) + std::chrono::ceil<std::chrono::milliseconds>(delay), false);
+        start_read(delay);
         //MINFO("[sock " << socket().native_handle() << "]Async read requested.");
       }
     }else
@@ -512,7 +494,7 @@ PRAGMA_WARNING_DISABLE_VS(4355)
     //some data should be wrote to stream
     //request complete
     
-    // No sleeping here; sleeping is done once and for all in "handle_write"
+    // No sleeping here; rate limit pacing is done with a timer in start_write()
 
     std::unique_lock queue_lock{m_send_que_lock};
 
@@ -554,6 +536,7 @@ PRAGMA_WARNING_DISABLE_VS(4355)
         }
     }
 
+    send_que_bytes += chunk.size();
     m_send_que.push_back(std::move(chunk));
 
     if(m_send_que.size() > 1)
@@ -578,14 +561,7 @@ PRAGMA_WARNING_DISABLE_VS(4355)
         if (speed_limit_is_enabled())
 			do_send_handler_write( m_send_que.back().data(), m_send_que.back().size() ); // (((H)))
 
-        CHECK_AND_ASSERT_MES( size_now == m_send_que.front().size(), false, "Unexpected queue size");
-        reset_timer(get_default_timeout(), false);
-        using namespace boost::placeholders;
-        boost::asio::async_write(socket(), boost::asio::buffer(m_send_que.front().data(), size_now ) ,
-                                 strand_.wrap(
-                                 boost::bind(&connection<t_protocol_handler>::handle_write, self, _1, _2)
-                                 )
-                                 );
+        start_write();
         //MTRACE("(chunk): " << size_now);
         //logger_handle_net_write(size_now);
         //MINFO("[sock " << socket().native_handle() << "] Async send requested " << m_send_que.front().size());
@@ -684,6 +660,8 @@ PRAGMA_WARNING_DISABLE_VS(4355)
     m_was_shutdown = true;
     // Initiate graceful connection closure.
     m_timer.cancel();
+    m_pace_write_timer.cancel();
+    m_pace_read_timer.cancel();
     boost::system::error_code ignored_ec;
     socket().shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored_ec);
     if (!m_host.empty())
@@ -749,9 +727,9 @@ PRAGMA_WARNING_DISABLE_VS(4355)
     }
     logger_handle_net_write(cb);
 
-                // The single sleeping that is needed for correctly handling "out" speed throttling
 		if (speed_limit_is_enabled()) {
-			sleep_before_packet(cb, 1, 1);
+			std::lock_guard lock{network_throttle_manager::m_lock_get_global_throttle_out};
+			network_throttle_manager::get_global_throttle_out().handle_trafic_exact(cb);
 		}
 
     bool do_shutdown = false;
@@ -762,6 +740,7 @@ PRAGMA_WARNING_DISABLE_VS(4355)
       return;
     }
 
+    send_que_bytes -= m_send_que.front().size();
     m_send_que.pop_front();
     if(m_send_que.empty())
     {
@@ -772,18 +751,11 @@ PRAGMA_WARNING_DISABLE_VS(4355)
     }else
     {
       //have more data to send
-		reset_timer(get_default_timeout(), false);
 		auto size_now = m_send_que.front().size();
 		MDEBUG("handle_write() NOW SENDS: packet="<<size_now<<" B" <<", from  queue size="<<m_send_que.size());
 		if (speed_limit_is_enabled())
 			do_send_handler_write_from_queue(e, m_send_que.front().size() , m_send_que.size()); // (((H)))
-		CHECK_AND_ASSERT_MES( size_now == m_send_que.front().size(), void(), "Unexpected queue size");
-        using namespace boost::placeholders;
-        boost::asio::async_write(socket(), boost::asio::buffer(m_send_que.front().data(), size_now) , 
-           strand_.wrap(
-            boost::bind(&connection<t_protocol_handler>::handle_write, connection<t_protocol_handler>::shared_from_this(), _1, _2)
-			  )
-          );
+		start_write();
       //MTRACE("(normal)" << size_now);
     }
     lock.unlock();
@@ -794,6 +766,63 @@ PRAGMA_WARNING_DISABLE_VS(4355)
     }
     CATCH_ENTRY_L0("connection<t_protocol_handler>::handle_write", void());
   }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
+  void connection<t_protocol_handler>::start_write()
+  {
+    auto self = connection<t_protocol_handler>::shared_from_this();
+    const auto delay = speed_limit_is_enabled() ? reserve_up(m_send_que.front().size()) : std::chrono::steady_clock::duration::zero();
+    reset_timer(get_default_timeout() + std::chrono::ceil<std::chrono::milliseconds>(delay), false);
+
+    auto write = [this, self] {
+      using namespace boost::placeholders;
+      boost::asio::async_write(socket(), boost::asio::buffer(m_send_que.front().data(), m_send_que.front().size()),
+        strand_.wrap(boost::bind(&connection<t_protocol_handler>::handle_write, self, _1, _2)));
+    };
+
+    if (delay <= std::chrono::steady_clock::duration::zero())
+    {
+      write();
+      return;
+    }
+
+    MTRACE("[sock " << socket().native_handle() << "] Delaying send of " << m_send_que.front().size() << " B by "
+        << std::chrono::duration_cast<std::chrono::milliseconds>(delay).count() << "ms for rate limit");
+    m_pace_write_timer.expires_after(delay);
+    m_pace_write_timer.async_wait(strand_.wrap([this, self, write](const boost::system::error_code& ec) {
+      if (ec == boost::asio::error::operation_aborted || m_was_shutdown)
+        return;
+      std::lock_guard lock{m_send_que_lock};
+      if (!m_send_que.empty())
+        write();
+    }));
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
+  void connection<t_protocol_handler>::start_read(std::chrono::steady_clock::duration delay)
+  {
+    auto self = connection<t_protocol_handler>::shared_from_this();
+    auto read = [this, self] {
+      socket().async_read_some(boost::asio::buffer(buffer_),
+        strand_.wrap(
+          boost::bind(&connection<t_protocol_handler>::handle_read, self,
+            boost::asio::placeholders::error,
+            boost::asio::placeholders::bytes_transferred)));
+    };
+
+    if (delay <= std::chrono::steady_clock::duration::zero())
+    {
+      read();
+      return;
+    }
+
+    m_pace_read_timer.expires_after(delay);
+    m_pace_read_timer.async_wait(strand_.wrap([this, read](const boost::system::error_code& ec) {
+      if (ec == boost::asio::error::operation_aborted || m_was_shutdown)
+        return;
+      read();
+    }));
+  }
 
   //---------------------------------------------------------------------------------
   template<class t_protocol_handler>
@@ -995,6 +1024,8 @@ POP_WARNINGS
     std::string thread_name = std::string("[") + m_thread_name_prefix;
     thread_name += std::to_string(local_thr_index) + "]";
     MLOG_SET_THREAD_NAME(thread_name);
+    if (m_thread_init)
+      m_thread_init(local_thr_index);
     //   MDEBUG("Thread name: " << m_thread_name_prefix);
     while(!m_stop_signal_sent)
     {
@@ -45,12 +45,14 @@
 #include <mutex>
 #include <string>
 #include <atomic>
+#include <chrono>
 #include <memory>
 #include <deque>
 
 #include <boost/asio.hpp>
 
 #include "../shared_sv.h"
+#include "enums.h"
 
 namespace epee
 {
@@ -84,6 +86,14 @@ class connection_basic_pimpl; // PIMPL for this class
   
   std::string to_string(t_connection_type type);
 
+  /// Current state of one direction of a rate limit
+  struct throttle_usage
+  {
+    uint64_t limit;                    ///< bytes per second, 0 if unlimited
+    uint64_t total_bytes;              ///< bytes charged since startup
+    std::chrono::milliseconds backlog; ///< how long a transfer charged now would be delayed
+  };
+
 class connection_basic { // not-templated base class for rapid developmet of some code parts
 		// beware of removing const, net_utils::connection is sketchily doing a cast to prevent storing ptr twice
 		const std::shared_ptr<connection_basic_shared_state> m_state;
@@ -96,6 +106,8 @@ class connection_basic { // not-templated base class for rapid developmet of som
     std::atomic<bool> m_was_shutdown;
     std::mutex m_send_que_lock;
     std::deque<shared_sv> m_send_que;
+    /// Bytes waiting in the send queues of all connections
+    static std::atomic<uint64_t> send_que_bytes;
     std::atomic<bool> m_is_multithreaded;
     /// Strand to ensure the connection's handlers are not called concurrently.
     boost::asio::io_service::strand strand_;
@@ -129,14 +141,30 @@ class connection_basic { // not-templated base class for rapid developmet of som
 		static uint64_t get_rate_up_limit();
 		static uint64_t get_rate_down_limit();
 
+		/// Per-zone limits [kB/s] applied in both directions, on top of the global limits; 0 for none
+		static void set_zone_rate_limit(zone z, uint64_t limit);
+		/// Per-connection limit [kB/s] applied in both directions to connections opened after the call; 0 for none
+		static void set_peer_rate_limit(uint64_t limit);
+		static uint64_t get_peer_rate_limit();
+
+		/// Usage of the global limit (zone::invalid) or of a zone's limit
+		static throttle_usage get_usage_up(zone z = zone::invalid);
+		static throttle_usage get_usage_down(zone z = zone::invalid);
+
 		// config misc
 		static void set_tos_flag(int tos); // ToS / QoS flag
 		static int get_tos_flag();
 
-		// handlers and sleep
-		void sleep_before_packet(size_t packet_size, int phase, int q_len); // execute a sleep ; phase is not really used now(?)
+		/// Charges the global, zone and connection limits for a transfer, returning how long to wait
+		/// before making it (e.g. on a timer; never sleep on the IO threads).
+		std::chrono::steady_clock::duration reserve_up(size_t bytes);
+		std::chrono::steady_clock::duration reserve_down(size_t bytes);
+
 		static void save_limit_to_file(int limit); ///< for dr-monero
 		static double get_sleep_time(size_t cb);
+
+	protected:
+		zone m_zone = zone::public_; ///< set when the connection starts; selects the zone limit
 };
 
 } // nameserver
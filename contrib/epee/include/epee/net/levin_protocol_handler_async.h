@@ -876,23 +876,35 @@ int async_protocol_handler_config<t_connection_context>::invoke_async(int comman
 template<class t_connection_context> template<class callback_t>
 bool async_protocol_handler_config<t_connection_context>::foreach_connection(const callback_t &cb)
 {
-  std::lock_guard lock{m_connects_lock};
-  for(auto& c: m_connects)
+  // Take a referenced snapshot of the connections and run the callbacks on that without holding
+  // m_connects_lock, so that relaying to or inspecting every peer doesn't hold up connections being
+  // set up or torn down (each reference keeps its connection alive until we're done with it).
+  std::vector<async_protocol_handler<t_connection_context>*> snapshot;
   {
-    async_protocol_handler<t_connection_context>* aph = c.second;
+    std::lock_guard lock{m_connects_lock};
+    snapshot.reserve(m_connects.size());
+    for(auto& c: m_connects)
+      if (c.second->start_outer_call())
+        snapshot.push_back(c.second);
+  }
+  auto release = misc_utils::create_scope_leave_handler([&snapshot] {
+    for (auto* aph : snapshot)
+      aph->finish_outer_call();
+  });
+  for (auto* aph : snapshot)
     if(!cb(aph->get_context_ref()))
       return false;
-  }
   return true;
 }
 //------------------------------------------------------------------------------------------
 template<class t_connection_context> template<class callback_t>
 bool async_protocol_handler_config<t_connection_context>::for_connection(const boost::uuids::uuid &connection_id, const callback_t &cb)
 {
-  std::lock_guard lock{m_connects_lock};
-  async_protocol_handler<t_connection_context>* aph = find_connection(connection_id);
-  if (!aph)
+  // As with foreach_connection, the callback runs on a referenced connection without the lock
+  async_protocol_handler<t_connection_context>* aph;
+  if (find_and_lock_connection(connection_id, aph) != LEVIN_OK)
     return false;
+  auto release = misc_utils::create_scope_leave_handler([aph] { aph->finish_outer_call(); });
   if(!cb(aph->get_context_ref()))
     return false;
   return true;
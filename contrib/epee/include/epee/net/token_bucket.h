@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace epee
+{
+namespace net_utils
+{
+  /// Byte-rate pacer.  Callers charge it for the bytes they are about to transfer and get back how
+  /// long they should wait before doing so (e.g. on an asio timer), rather than sleeping.
+  ///
+  /// Up to one second of traffic can go through without waiting; beyond that the bucket goes into
+  /// debt, so a burst of queued traffic is spread out at the configured rate.  A rate of 0 means
+  /// unlimited: `reserve()` never asks for a wait but still counts the bytes.
+  ///
+  /// Thread-safe.
+  class token_bucket
+  {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    explicit token_bucket(uint64_t rate = 0) : m_rate{rate}, m_tokens(rate) {}
+
+    token_bucket(const token_bucket&) = delete;
+    token_bucket& operator=(const token_bucket&) = delete;
+
+    /// Sets the rate in bytes per second; 0 disables limiting.  Outstanding debt is kept.
+    void set_rate(uint64_t rate, clock::time_point now = clock::now())
+    {
+      std::lock_guard lock{m_lock};
+      refill(now);
+      m_rate = rate;
+      m_tokens = std::min(m_tokens, static_cast<double>(rate));
+    }
+
+    uint64_t get_rate() const
+    {
+      std::lock_guard lock{m_lock};
+      return m_rate;
+    }
+
+    /// Charges the bucket for `bytes` and returns how long to wait before transferring them.
+    clock::duration reserve(size_t bytes, clock::time_point now = clock::now())
+    {
+      std::lock_guard lock{m_lock};
+      m_total += bytes;
+      if (!m_rate)
+        return clock::duration::zero();
+      refill(now);
+      m_tokens -= bytes;
+      return debt(m_tokens);
+    }
+
+    /// Returns how long a transfer charged now would have to wait, i.e. the current backlog.
+    clock::duration get_backlog(clock::time_point now = clock::now()) const
+    {
+      std::lock_guard lock{m_lock};
+      if (!m_rate)
+        return clock::duration::zero();
+      const double elapsed = std::chrono::duration<double>(now - m_last).count();
+      return debt(std::min(m_tokens + elapsed * m_rate, static_cast<double>(m_rate)));
+    }
+
+    /// Returns the total number of bytes charged to the bucket.
+    uint64_t get_total() const
+    {
+      std::lock_guard lock{m_lock};
+      return m_total;
+    }
+
+  private:
+    void refill(clock::time_point now)
+    {
+      if (now > m_last)
+      {
+        const double elapsed = std::chrono::duration<double>(now - m_last).count();
+        m_tokens = std::min(m_tokens + elapsed * m_rate, static_cast<double>(m_rate));
+        m_last = now;
+      }
+    }
+
+    clock::duration debt(double tokens) const
+    {
+      if (tokens >= 0)
+        return clock::duration::zero();
+      return std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>{-tokens / m_rate});
+    }
+
+    mutable std::mutex m_lock;
+    uint64_t m_rate = 0;
+    double m_tokens = 0;
+    clock::time_point m_last = clock::now();
+    uint64_t m_total = 0;
+  };
+
+} // net_utils
+} // epee
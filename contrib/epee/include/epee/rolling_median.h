@@ -122,6 +122,35 @@ private:
      return i == 0;
   }
 
+  //replaces the item in data slot i of a full heap, maintains median in O(lg nItems)
+  void replace(int i, Item v)
+  {
+    int p = pos[i];
+    Item old = data[i];
+    data[i] = v;
+    if (p > 0)         //item is in minHeap
+    {
+      if (v > old)
+        minSortDown(p);
+      else if (minSortUp(p) && mmCmpExch(0, -1))
+        maxSortDown(-1);
+    }
+    else if (p < 0)   //item is in maxheap
+    {
+      if (v < old)
+        maxSortDown(p);
+      else if (maxSortUp(p) && minCt && mmCmpExch(1, 0))
+        minSortDown(1);
+    }
+    else //item is at median
+    {
+      if (maxCt && maxSortUp(-1))
+        maxSortDown(-1);
+      if (minCt && minSortUp(1))
+        minSortDown(1);
+    }
+  }
+
 protected:
   rolling_median_t &operator=(const rolling_median_t&) = delete;
   rolling_median_t(const rolling_median_t&) = delete;
@@ -220,6 +249,18 @@ public:
     }
   }
 
+  //Undoes the most recent insert into a full window: removes the newest item and puts back `oldest`,
+  //the item that insert pushed out of the window.  Maintains median in O(lg nItems).  Returns false
+  //(and does nothing) if the window isn't full, in which case nothing was pushed out.
+  bool rollback(Item oldest)
+  {
+    if (sz < N)
+      return false;
+    idx = (idx + N - 1) % N;
+    replace(idx, oldest);
+    return true;
+  }
+
   //returns median item (or average of 2 when item count is even)
   Item median() const
   {
@@ -26,6 +26,7 @@
 
 #pragma once
 
+#include <cstring>
 #include <type_traits>
 #include <set>
 #include <unordered_set>
@@ -105,11 +106,11 @@ namespace epee
     static bool unserialize_t_val_as_blob(t_type& d, t_storage& stg, section* parent_section, const char* pname)
     {
       assert_blob_serializable<t_type>();
-      std::string blob;
-      if(!stg.get_value(pname, blob, parent_section))
+      const std::string* blob = stg.get_string(pname, parent_section);
+      if(!blob)
         return false;
-      CHECK_AND_ASSERT_MES(blob.size() == sizeof(d), false, "unserialize_t_val_as_blob: size of " << typeid(t_type).name() << " = " << sizeof(t_type) << ", but stored blod size = " << blob.size() << ", value name = " << pname);
-      d = *(const t_type*)blob.data();
+      CHECK_AND_ASSERT_MES(blob->size() == sizeof(d), false, "unserialize_t_val_as_blob: size of " << typeid(t_type).name() << " = " << sizeof(t_type) << ", but stored blod size = " << blob->size() << ", value name = " << pname);
+      std::memcpy((void*) &d, blob->data(), sizeof(d));
       return true;
     } 
     //-------------------------------------------------------------------------------------------------------------------
@@ -196,9 +197,10 @@ namespace epee
       assert_blob_serializable<T>();
 
       container.clear();
-      std::string buff;
-      if (!stg.get_value(pname, buff, parent_section))
+      const std::string* blob = stg.get_string(pname, parent_section);
+      if (!blob)
         return false;
+      const std::string& buff = *blob;
 
       CHECK_AND_ASSERT_MES(buff.size() % sizeof(T) == 0,
         false, 
@@ -238,6 +240,8 @@ namespace epee
       container.clear();
       auto* arr = stg.template get_array<section>(pname, parent_section);
       if (!arr) return false;
+      if constexpr (is_std_vector<stl_container>)
+        container.reserve(arr->size());
       for (auto& child_section : *arr)
         if (!container.emplace_back()._load(stg, &child_section))
           return false;
@@ -55,6 +55,7 @@ namespace epee
         return false;
       }
       serialization::portable_storage stg_ret;
+      stg_ret.consume_strings = true;
       if(!stg_ret.load_from_binary(buff_to_recv))
       {
         LOG_ERROR("Failed to load_from_binary on command " << command);
@@ -99,6 +100,7 @@ namespace epee
         return false;
       }
       typename serialization::portable_storage stg_ret;
+      stg_ret.consume_strings = true;
       if(!stg_ret.load_from_binary(buff_to_recv))
       {
         LOG_ERROR("Failed to load_from_binary on command " << command);
@@ -124,6 +126,7 @@ namespace epee
           return false;
         }
         serialization::portable_storage stg_ret;
+        stg_ret.consume_strings = true;
         if(!stg_ret.load_from_binary(buff))
         {
           LOG_ERROR("Failed to load_from_binary on command " << command);
@@ -170,6 +173,7 @@ namespace epee
     int buff_to_t_adapter(int command, const epee::span<const uint8_t> in_buff, std::string& buff_out, callback_t cb, t_context& context )
     {
       serialization::portable_storage strg;
+      strg.consume_strings = true;
       if(!strg.load_from_binary(in_buff))
       {
         LOG_ERROR("Failed to load_from_binary in command " << command);
@@ -200,6 +204,7 @@ namespace epee
     int buff_to_t_adapter(t_owner* powner, int command, const epee::span<const uint8_t> in_buff, callback_t cb, t_context& context)
     {
       serialization::portable_storage strg;
+      strg.consume_strings = true;
       if(!strg.load_from_binary(in_buff))
       {
         LOG_ERROR("Failed to load_from_binary in notify " << command);
@@ -249,8 +254,11 @@ namespace epee
   return -1; \
   } 
 
-#define BEGIN_INVOKE_MAP2(owner_type) \
-  template <class t_context> int handle_invoke_map(bool is_notify, int command, const epee::span<const uint8_t> in_buff, std::string& buff_out, t_context& context, bool& handled) \
+#define BEGIN_INVOKE_MAP2(owner_type) BEGIN_NAMED_INVOKE_MAP2(owner_type, handle_invoke_map)
+
+// Same as BEGIN_INVOKE_MAP2, for an owner that wraps the generated map in its own handle_invoke_map
+#define BEGIN_NAMED_INVOKE_MAP2(owner_type, map_name) \
+  template <class t_context> int map_name(bool is_notify, int command, const epee::span<const uint8_t> in_buff, std::string& buff_out, t_context& context, bool& handled) \
   { \
   typedef owner_type internal_owner_type_name;
 
@@ -49,18 +49,29 @@ namespace epee
     public:
       portable_storage() = default;
       virtual ~portable_storage() = default;
-      section*   open_section(const std::string& section_name,  section* parent_section, bool create_if_notexist = false);
+      section*   open_section(std::string_view section_name,  section* parent_section, bool create_if_notexist = false);
       template <typename T>
-      bool       get_value(const std::string& value_name, T& val, section* parent_section);
-      bool       get_value(const std::string& value_name, storage_entry& val, section* parent_section);
+      bool       get_value(std::string_view value_name, T& val, section* parent_section);
+      bool       get_value(std::string_view value_name, storage_entry& val, section* parent_section);
+      // Returns a pointer to a stored string value, or nullptr if the value doesn't exist; throws
+      // (as get_value would) if it isn't a string.  Lets blob values be decoded directly from the
+      // storage without copying them first.
+      const std::string* get_string(std::string_view value_name, section* parent_section);
       template <class T>
       bool       set_value(const std::string& value_name, const T& target, section* parent_section);
 
       // Class for iterating through a type with automatic conversion to `T` when dereferencing.
+      // When set, string values are moved out of the storage as they are read for a string field
+      // (leaving an empty string behind) instead of being copied, which saves a copy of every blob
+      // in a large message.  Only set this on a storage that is read once, e.g. when loading a
+      // struct straight from received binary data.
+      bool consume_strings = false;
+
       template <typename T>
       class converting_array_iterator {
         array_entry& array;
         size_t index = 0;
+        bool consume = false;
       public:
         using value_type = T;
         using difference_type = std::ptrdiff_t;
@@ -68,14 +79,18 @@ namespace epee
         using reference = T;
         using iterator_category = std::input_iterator_tag;
 
-        explicit converting_array_iterator(array_entry& array) : array{array} {}
-        converting_array_iterator(array_entry& array, bool end) : array{array} {
+        explicit converting_array_iterator(array_entry& array, bool consume = false) : array{array}, consume{consume} {}
+        converting_array_iterator(array_entry& array, bool end, bool consume) : array{array}, consume{consume} {
           if (end)
             index = var::visit([](auto& a) { return a.size(); }, array);
         }
         // Converting dereference operator.  Returns the converted value.  Note that this can throw
         // if the requested conversion fails.
         T operator*() const {
+          if constexpr (std::is_same_v<T, std::string>)
+            if (consume)
+              if (auto* strings = std::get_if<array_t<std::string>>(&array))
+                return std::move((*strings)[index]);
           return var::visit([this](auto& a) { T val; convert_t(a[index], val); return val; }, array);
         }
         bool operator==(const converting_array_iterator& other) const { return &array == &other.array && index == other.index; }
@@ -96,14 +111,14 @@ namespace epee
       // if the member isn't an array.
       template <typename T>
       std::pair<converting_array_iterator<T>, converting_array_iterator<T>>
-      converting_array_range(const std::string& value_name, section* parent_section)
+      converting_array_range(std::string_view value_name, section* parent_section)
       {
         if (!parent_section) parent_section = &m_root;
         storage_entry* pentry = find_storage_entry(value_name, parent_section);
         if (!pentry)
-          throw std::out_of_range{value_name + " does not exist"};
+          throw std::out_of_range{std::string{value_name} + " does not exist"};
         auto& ar_entry = var::get<array_entry>(*pentry);
-        return {converting_array_iterator<T>{ar_entry}, converting_array_iterator<T>{ar_entry, true}};
+        return {converting_array_iterator<T>{ar_entry, consume_strings}, converting_array_iterator<T>{ar_entry, true, consume_strings}};
       }
 
       // Accesses an existing array value of the given type.  If the given value does not exist or
@@ -112,7 +127,7 @@ namespace epee
       // array_range(), this does not convert (so, for example, you can't get uint64_t's if the
       // stored values are uint32_t's).
       template <typename T>
-      array_t<T>* get_array(const std::string& value_name, section* parent_section) {
+      array_t<T>* get_array(std::string_view value_name, section* parent_section) {
         if (!parent_section) parent_section = &m_root;
         if (storage_entry* pentry = find_storage_entry(value_name, parent_section))
           if (auto* ar_entry = std::get_if<array_entry>(pentry))
@@ -158,11 +173,11 @@ namespace epee
     private:
       section m_root;
       section* get_root_section() {return &m_root;}
-      storage_entry* find_storage_entry(const std::string& pentry_name, section* psection);
+      storage_entry* find_storage_entry(std::string_view pentry_name, section* psection);
       template<class entry_type>
-      storage_entry* insert_new_entry_get_storage_entry(const std::string& pentry_name, section* psection, const entry_type& entry);
+      storage_entry* insert_new_entry_get_storage_entry(std::string_view pentry_name, section* psection, const entry_type& entry);
 
-      section*    insert_new_section(const std::string& pentry_name, section* psection);
+      section*    insert_new_section(std::string_view pentry_name, section* psection);
 
       const void* context = nullptr;
       const std::type_info* context_type = nullptr;
@@ -178,7 +193,7 @@ namespace epee
 #pragma pack(pop)
     };
     template <typename T>
-    bool portable_storage::get_value(const std::string& value_name, T& val, section* parent_section)
+    bool portable_storage::get_value(std::string_view value_name, T& val, section* parent_section)
     {
       static_assert(variant_contains<T, storage_entry>);
       //TRY_ENTRY();
@@ -187,6 +202,14 @@ namespace epee
       if(!pentry)
         return false;
 
+      if constexpr (std::is_same_v<T, std::string>)
+      {
+        if (auto* str = std::get_if<std::string>(pentry); str && consume_strings)
+        {
+          val = std::move(*str);
+          return true;
+        }
+      }
       var::visit([&val](const auto& v) { convert_t(v, val); }, *pentry);
       return true;
       //CATCH_ENTRY("portable_storage::template<>get_value", false);
@@ -213,7 +236,7 @@ namespace epee
     }
     //---------------------------------------------------------------------------------------------------------------
     template<class entry_type>
-    storage_entry* portable_storage::insert_new_entry_get_storage_entry(const std::string& pentry_name, section* psection, const entry_type& entry)
+    storage_entry* portable_storage::insert_new_entry_get_storage_entry(std::string_view pentry_name, section* psection, const entry_type& entry)
     {
       TRY_ENTRY();
       CHECK_AND_ASSERT(psection, nullptr);
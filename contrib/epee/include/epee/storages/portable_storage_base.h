@@ -28,6 +28,7 @@
 
 #pragma once 
 
+#include <map>
 #include <variant>
 #include <string>
 #include <vector>
@@ -105,7 +106,9 @@ namespace epee
     /************************************************************************/
     struct section
     {
-      std::map<std::string, storage_entry> m_entries;
+      // Transparent comparator so that entries can be looked up by the `const char*` names that the
+      // KV_SERIALIZE macros use without constructing a std::string for every lookup.
+      std::map<std::string, storage_entry, std::less<>> m_entries;
     };
 
     template <typename T> constexpr bool TYPE_IS_NOT_SERIALIZABLE = false;
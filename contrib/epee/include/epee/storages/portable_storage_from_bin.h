@@ -224,7 +224,9 @@ namespace epee
         //read section name string
         std::string sec_name;
         read_sec_name(sec_name);
-        sec.m_entries.insert(std::make_pair(sec_name, load_storage_entry()));
+        // Our own writer emits entries in map order, so hinting at the end makes each insert O(1).
+        // As with insert, a duplicate name keeps the first value.
+        sec.m_entries.emplace_hint(sec.m_entries.end(), std::move(sec_name), load_storage_entry());
       }
     }
     inline 
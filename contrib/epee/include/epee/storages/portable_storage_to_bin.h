@@ -122,7 +122,7 @@ namespace epee
 
     inline void pack_entry_to_buff(std::ostream& strm, const section& sec)
     {
-      typedef std::map<std::string, storage_entry>::value_type section_pair;
+      typedef decltype(sec.m_entries)::value_type section_pair;
       pack_varint(strm, sec.m_entries.size());
       for(const section_pair& se: sec.m_entries)
       {
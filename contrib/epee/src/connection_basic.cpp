@@ -41,11 +41,14 @@
 #include "epee/misc_language.h"
 #include "epee/pragma_comp_defs.h"
 #include <iomanip>
+#include <algorithm>
+#include <array>
 
 #include <boost/asio/basic_socket.hpp>
 
 // TODO:
 #include "epee/net/network_throttle-detail.hpp"
+#include "epee/net/token_bucket.h"
 
 #if BOOST_VERSION >= 107000
 #define GET_IO_SERVICE(s) ((boost::asio::io_context&)(s).get_executor().context())
@@ -88,9 +91,47 @@ class connection_basic_pimpl {
 
 		network_throttle_bw m_throttle; // per-perr
 
+		token_bucket m_bucket_up; // per-peer pacing
+		token_bucket m_bucket_down;
+
 		int m_peer_number; // e.g. for debug/stats
 };
 
+namespace
+{
+	struct rate_limits
+	{
+		token_bucket global_up;
+		token_bucket global_down;
+		std::array<token_bucket, 4> zone_up;
+		std::array<token_bucket, 4> zone_down;
+		std::atomic<uint64_t> peer{0}; // bytes/s
+	};
+
+	rate_limits& get_rate_limits()
+	{
+		static rate_limits limits;
+		return limits;
+	}
+
+	size_t zone_index(zone z)
+	{
+		const size_t i = static_cast<size_t>(z);
+		return i < std::tuple_size_v<decltype(rate_limits::zone_up)> ? i : 0;
+	}
+
+	throttle_usage get_usage(const token_bucket& bucket)
+	{
+		return {bucket.get_rate(), bucket.get_total(), std::chrono::ceil<std::chrono::milliseconds>(bucket.get_backlog())};
+	}
+
+	std::chrono::steady_clock::duration reserve(size_t bytes, token_bucket& global, token_bucket& zone_bucket, token_bucket& peer)
+	{
+		const auto now = std::chrono::steady_clock::now();
+		return std::max({global.reserve(bytes, now), zone_bucket.reserve(bytes, now), peer.reserve(bytes, now)});
+	}
+}
+
 
 } // namespace
 } // namespace
@@ -108,7 +149,12 @@ namespace net_utils
 // connection_basic_pimpl
 // ================================================================================================
 	
-connection_basic_pimpl::connection_basic_pimpl(const std::string &name) : m_throttle(name), m_peer_number(0) { }
+connection_basic_pimpl::connection_basic_pimpl(const std::string &name)
+	: m_throttle(name),
+	m_bucket_up(get_rate_limits().peer),
+	m_bucket_down(get_rate_limits().peer),
+	m_peer_number(0)
+{ }
 
 // ================================================================================================
 // connection_basic
@@ -116,6 +162,7 @@ connection_basic_pimpl::connection_basic_pimpl(const std::string &name) : m_thro
 
 // static variables:
 int connection_basic_pimpl::m_default_tos;
+std::atomic<uint64_t> connection_basic::send_que_bytes{0};
 
 // methods:
 connection_basic::connection_basic(boost::asio::ip::tcp::socket&& sock, std::shared_ptr<connection_basic_shared_state> state)
@@ -166,6 +213,8 @@ connection_basic::connection_basic(boost::asio::io_service &io_service, std::sha
 
 connection_basic::~connection_basic() noexcept(false) {
 	--(m_state->sock_count);
+	for (auto& chunk : m_send_que)
+		send_que_bytes -= chunk.size();
 
 	std::string remote_addr_str = "?";
 	try { boost::system::error_code e; remote_addr_str = socket().remote_endpoint(e).address().to_string(); } catch(...){} ;
@@ -177,6 +226,7 @@ void connection_basic::set_rate_up_limit(uint64_t limit) {
 		std::lock_guard lock{network_throttle_manager::m_lock_get_global_throttle_out};
 		network_throttle_manager::get_global_throttle_out().set_target_speed(limit);
 	}
+	get_rate_limits().global_up.set_rate(limit * 1024);
 	save_limit_to_file(limit);
 }
 
@@ -190,6 +240,7 @@ void connection_basic::set_rate_down_limit(uint64_t limit) {
 	  std::lock_guard lock{network_throttle_manager::m_lock_get_global_throttle_inreq};
 		network_throttle_manager::get_global_throttle_inreq().set_target_speed(limit);
 	}
+	get_rate_limits().global_down.set_rate(limit * 1024);
     save_limit_to_file(limit);
 }
 
@@ -211,6 +262,40 @@ uint64_t connection_basic::get_rate_down_limit() {
     return limit;
 }
 
+void connection_basic::set_zone_rate_limit(zone z, uint64_t limit) {
+	auto& limits = get_rate_limits();
+	limits.zone_up[zone_index(z)].set_rate(limit * 1024);
+	limits.zone_down[zone_index(z)].set_rate(limit * 1024);
+}
+
+void connection_basic::set_peer_rate_limit(uint64_t limit) {
+	get_rate_limits().peer = limit * 1024;
+}
+
+uint64_t connection_basic::get_peer_rate_limit() {
+	return get_rate_limits().peer / 1024;
+}
+
+throttle_usage connection_basic::get_usage_up(zone z) {
+	auto& limits = get_rate_limits();
+	return get_usage(z == zone::invalid ? limits.global_up : limits.zone_up[zone_index(z)]);
+}
+
+throttle_usage connection_basic::get_usage_down(zone z) {
+	auto& limits = get_rate_limits();
+	return get_usage(z == zone::invalid ? limits.global_down : limits.zone_down[zone_index(z)]);
+}
+
+std::chrono::steady_clock::duration connection_basic::reserve_up(size_t bytes) {
+	auto& limits = get_rate_limits();
+	return reserve(bytes, limits.global_up, limits.zone_up[zone_index(m_zone)], mI->m_bucket_up);
+}
+
+std::chrono::steady_clock::duration connection_basic::reserve_down(size_t bytes) {
+	auto& limits = get_rate_limits();
+	return reserve(bytes, limits.global_down, limits.zone_down[zone_index(m_zone)], mI->m_bucket_down);
+}
+
 void connection_basic::save_limit_to_file(int limit) {
 }
  
@@ -222,36 +307,6 @@ int connection_basic::get_tos_flag() {
 	return connection_basic_pimpl::m_default_tos;
 }
 
-void connection_basic::sleep_before_packet(size_t packet_size, int phase,  int q_len) {
-	double delay=0; // will be calculated
-	do
-	{ // rate limiting
-		if (m_was_shutdown) { 
-			MDEBUG("m_was_shutdown - so abort sleep");
-			return;
-		}
-
-		{ 
-			std::lock_guard lock{network_throttle_manager::m_lock_get_global_throttle_out};
-			delay = network_throttle_manager::get_global_throttle_out().get_sleep_time_after_tick( packet_size );
-		}
-
-		delay *= 0.50;
-		if (delay > 0) {
-            long int ms = (long int)(delay * 1000);
-			MTRACE("Sleeping in " << __FUNCTION__ << " for " << ms << " ms before packet_size="<<packet_size); // debug sleep
-			std::this_thread::sleep_for(std::chrono::milliseconds{ms});
-		}
-	} while(delay > 0);
-
-// XXX LATER XXX
-	{
-	  std::lock_guard lock{network_throttle_manager::m_lock_get_global_throttle_out};
-		network_throttle_manager::get_global_throttle_out().handle_trafic_exact( packet_size ); // increase counter - global
-	}
-
-}
-
 void connection_basic::do_send_handler_write(const void* ptr , size_t cb ) {
         // No sleeping here; sleeping is done once and for all in connection<t_protocol_handler>::handle_write
 	MTRACE("handler_write (direct) - before ASIO write, for packet="<<cb<<" B (after sleep)");
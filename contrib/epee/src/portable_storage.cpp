@@ -5,6 +5,29 @@
 namespace epee {
   namespace serialization {
 
+    namespace {
+      // Output stream buffer that appends straight to a std::string, so that binary serialization
+      // doesn't go through a stringstream buffer and then get copied out of it.
+      class string_appender : public std::streambuf
+      {
+        std::string& out;
+      public:
+        explicit string_appender(std::string& out) : out{out} {}
+      protected:
+        int_type overflow(int_type c) override
+        {
+          if (!traits_type::eq_int_type(c, traits_type::eof()))
+            out.push_back(traits_type::to_char_type(c));
+          return traits_type::not_eof(c);
+        }
+        std::streamsize xsputn(const char* s, std::streamsize n) override
+        {
+          out.append(s, n);
+          return n;
+        }
+      };
+    }
+
     void dump_as_json(std::ostream& strm, const array_entry& ae, size_t indent, bool pretty)
     {
       var::visit([&](const auto& a) {
@@ -102,14 +125,16 @@ namespace epee {
     bool portable_storage::store_to_binary(std::string& target)
     {
       TRY_ENTRY();
-      std::stringstream ss;
+      // Clearing (rather than replacing) target keeps its capacity for a caller reusing a buffer
+      target.clear();
+      string_appender buf{target};
+      std::ostream ss{&buf};
       storage_block_header sbh{};
       sbh.m_signature_a = PORTABLE_STORAGE_SIGNATUREA;
       sbh.m_signature_b = PORTABLE_STORAGE_SIGNATUREB;
       sbh.m_ver = PORTABLE_STORAGE_FORMAT_VER;
       ss.write(reinterpret_cast<const char*>(&sbh), sizeof(storage_block_header));
       pack_entry_to_buff(ss, m_root);
-      target = ss.str();
       return true;
       CATCH_ENTRY("portable_storage::store_to_binary", false)
     }
@@ -142,7 +167,7 @@ namespace epee {
       CATCH_ENTRY("portable_storage::load_from_binary", false);
     }
 
-    section* portable_storage::open_section(const std::string& section_name, section* parent_section, bool create_if_notexist)
+    section* portable_storage::open_section(std::string_view section_name, section* parent_section, bool create_if_notexist)
     {
       TRY_ENTRY();
       if (!parent_section) parent_section = &m_root;
@@ -167,7 +192,7 @@ namespace epee {
       CATCH_ENTRY("portable_storage::open_section", nullptr);
     }
 
-    bool portable_storage::get_value(const std::string& value_name, storage_entry& val, section* parent_section)
+    bool portable_storage::get_value(std::string_view value_name, storage_entry& val, section* parent_section)
     {
       //TRY_ENTRY();
       if(!parent_section) parent_section = &m_root;
@@ -180,7 +205,18 @@ namespace epee {
       //CATCH_ENTRY("portable_storage::template<>get_value", false);
     }
 
-    storage_entry* portable_storage::find_storage_entry(const std::string& pentry_name, section* psection)
+    const std::string* portable_storage::get_string(std::string_view value_name, section* parent_section)
+    {
+      if(!parent_section) parent_section = &m_root;
+      storage_entry* pentry = find_storage_entry(value_name, parent_section);
+      if(!pentry)
+        return nullptr;
+      auto* str = std::get_if<std::string>(pentry);
+      CHECK_AND_ASSERT_THROW_MES(str, "WRONG DATA CONVERSION: value " << value_name << " is not a string");
+      return str;
+    }
+
+    storage_entry* portable_storage::find_storage_entry(std::string_view pentry_name, section* psection)
     {
       TRY_ENTRY();
       CHECK_AND_ASSERT(psection, nullptr);
@@ -192,7 +228,7 @@ namespace epee {
       CATCH_ENTRY("portable_storage::find_storage_entry", nullptr);
     }
 
-    section* portable_storage::insert_new_section(const std::string& pentry_name, section* psection)
+    section* portable_storage::insert_new_section(std::string_view pentry_name, section* psection)
     {
       TRY_ENTRY();
       storage_entry* pse = insert_new_entry_get_storage_entry(pentry_name, psection, section());
@@ -55,6 +55,11 @@ const command_line::arg_descriptor<bool> arg_db_salvage  = {
 , "Try to salvage a blockchain database if it seems corrupted"
 , false
 };
+const command_line::arg_descriptor<uint64_t> arg_db_map_size = {
+  "db-map-size"
+, "Initial size of the database memory map in MiB, to avoid repeatedly growing it during a long sync (0 = size from the existing database)"
+, 0
+};
 
 BlockchainDB *new_db()
 {
@@ -65,6 +70,7 @@ void BlockchainDB::init_options(boost::program_options::options_description& des
 {
   command_line::add_arg(desc, arg_db_sync_mode);
   command_line::add_arg(desc, arg_db_salvage);
+  command_line::add_arg(desc, arg_db_map_size);
 }
 
 void BlockchainDB::pop_block()
@@ -304,6 +310,44 @@ transaction BlockchainDB::get_tx(const crypto::hash& h) const
   return tx;
 }
 
+std::vector<uint64_t> BlockchainDB::get_block_cumulative_rct_outputs_range(uint64_t start_height, uint64_t end_height) const
+{
+  std::vector<uint64_t> heights;
+  if (end_height < start_height)
+    return heights;
+  heights.reserve(end_height + 1 - start_height);
+  for (uint64_t h = start_height; h <= end_height; ++h)
+    heights.push_back(h);
+  return get_block_cumulative_rct_outputs(heights);
+}
+
+void BlockchainDB::has_key_images(epee::span<const crypto::key_image> imgs, std::vector<bool>& spent) const
+{
+  spent.clear();
+  spent.reserve(imgs.size());
+  for (const auto& img : imgs)
+    spent.push_back(has_key_image(img));
+}
+
+bool BlockchainDB::get_block_pow_hash(const crypto::hash &blkid, crypto::hash &pow_hash) const
+{
+  return false;
+}
+
+void BlockchainDB::add_block_pow_hash(const crypto::hash &blkid, const crypto::hash &pow_hash)
+{
+}
+
+std::vector<block_header_info> BlockchainDB::get_block_headers(uint64_t start_height, uint64_t count) const
+{
+  return {};
+}
+
+bool BlockchainDB::get_coinbase_sums(uint64_t height, block_coinbase_sums &sums) const
+{
+  return false;
+}
+
 uint64_t BlockchainDB::get_output_unlock_time(const uint64_t amount, const uint64_t amount_index) const
 {
   output_data_t odata = get_output_key(amount, amount_index);
@@ -431,41 +475,60 @@ void BlockchainDB::fill_timestamps_and_difficulties_for_pow(cryptonote::network_
   if (chain_height < MIN_CHAIN_HEIGHT)
     return;
 
-  uint64_t const top_block_height   = chain_height - 1;
   bool const before_hf16            = !is_hard_fork_at_least(nettype, network_version_16_pulse, chain_height);
   uint64_t const block_count        = DIFFICULTY_BLOCKS_COUNT(before_hf16);
 
-  timestamps.reserve(block_count);
-  difficulties.reserve(block_count);
-
-  if (timestamps_difficulty_height == 0 ||
-      (chain_height - timestamps_difficulty_height) != 1 ||
-      timestamps.size()   > block_count ||
-      difficulties.size() > block_count)
+  // We want the entries for heights [start_height, chain_height), skipping the genesis block
+  uint64_t const start_height = std::max<uint64_t>(chain_height - std::min<uint64_t>(chain_height, block_count), 1);
+
+  // The input arrays hold [cached_start, cached_end) from the previous call; reuse whatever overlaps
+  // and only load the heights at either end that we don't have, so that moving the chain up or
+  // down by a block costs a single entry.
+  uint64_t const cached_end   = timestamps_difficulty_height;
+  uint64_t const cached_start = cached_end - std::min<uint64_t>(cached_end, timestamps.size());
+  if (cached_end == 0 ||
+      timestamps.size() != difficulties.size() ||
+      cached_start < 1 ||
+      cached_end <= start_height ||
+      cached_start >= chain_height)
   {
     // Cache invalidated.
     timestamps.clear();
     difficulties.clear();
-
-    // Fill missing timestamps/difficulties, up to one before the latest (latest is added below).
-    uint64_t start_height = chain_height - std::min<size_t>(chain_height, block_count);
-    start_height          = std::max<uint64_t>(start_height, 1);
-
-    for (uint64_t block_height = start_height; block_height < (chain_height - 1) /*skip latest block*/; block_height++)
+    for (uint64_t block_height = start_height; block_height < chain_height; block_height++)
     {
       timestamps.push_back(get_block_timestamp(block_height));
       difficulties.push_back(get_block_cumulative_difficulty(block_height));
     }
+    return;
   }
 
-  // Add latest timestamp/difficulty
-  add_timestamp_and_difficulty(nettype,
-                               chain_height,
-                               timestamps,
-                               difficulties,
-                               get_block_timestamp(top_block_height),
-                               get_block_cumulative_difficulty(top_block_height));
-
+  if (cached_end > chain_height)
+  {
+    timestamps.resize(timestamps.size() - (cached_end - chain_height));
+    difficulties.resize(difficulties.size() - (cached_end - chain_height));
+  }
+  if (cached_start < start_height)
+  {
+    timestamps.erase(timestamps.begin(), timestamps.begin() + (start_height - cached_start));
+    difficulties.erase(difficulties.begin(), difficulties.begin() + (start_height - cached_start));
+  }
+  else if (cached_start > start_height)
+  {
+    std::vector<uint64_t> front_timestamps, front_difficulties;
+    for (uint64_t block_height = start_height; block_height < cached_start; block_height++)
+    {
+      front_timestamps.push_back(get_block_timestamp(block_height));
+      front_difficulties.push_back(get_block_cumulative_difficulty(block_height));
+    }
+    timestamps.insert(timestamps.begin(), front_timestamps.begin(), front_timestamps.end());
+    difficulties.insert(difficulties.begin(), front_difficulties.begin(), front_difficulties.end());
+  }
+  for (uint64_t block_height = cached_end; block_height < chain_height; block_height++)
+  {
+    timestamps.push_back(get_block_timestamp(block_height));
+    difficulties.push_back(get_block_cumulative_difficulty(block_height));
+  }
 }
 
 
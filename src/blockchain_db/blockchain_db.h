@@ -31,6 +31,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <exception>
 #include <boost/program_options.hpp>
 #include "common/command_line.h"
@@ -109,6 +110,7 @@ typedef std::pair<crypto::hash, uint64_t> tx_out_index;
 
 extern const command_line::arg_descriptor<std::string> arg_db_sync_mode;
 extern const command_line::arg_descriptor<bool, false> arg_db_salvage;
+extern const command_line::arg_descriptor<uint64_t> arg_db_map_size;
 
 #pragma pack(push, 1)
 
@@ -150,6 +152,42 @@ struct alt_block_data_t
   uint8_t  checkpointed;
 };
 
+/**
+ * @brief what the block header RPC calls report about a main chain block, as
+ * stored alongside it so that it can be had without fetching and parsing the
+ * block
+ */
+struct block_header_info
+{
+  uint64_t height;
+  crypto::hash hash;
+  uint8_t major_version;
+  uint8_t minor_version;
+  uint32_t nonce;
+  uint64_t timestamp;
+  crypto::hash prev_id;
+  crypto::hash miner_tx_hash;
+  crypto::public_key service_node_winner;
+  uint64_t reward;            // all of the miner tx's outputs
+  uint64_t miner_reward;      // its first output
+  uint64_t num_txes;          // not counting the miner tx
+  uint64_t weight;
+  uint64_t long_term_weight;
+  difficulty_type cumulative_difficulty;
+};
+
+/**
+ * @brief the coin emission, miner fees and burned coins of the main chain from
+ * the genesis block up to and including some block, as get_coinbase_tx_sum
+ * counts them
+ */
+struct block_coinbase_sums
+{
+  uint64_t emission;
+  uint64_t fees;
+  uint64_t burned;
+};
+
 /**
  * @brief a struct containing txpool per transaction metadata
  */
@@ -547,6 +585,7 @@ protected:
   mutable uint64_t time_tx_exists = 0;  //!< a performance metric
   uint64_t time_commit1 = 0;  //!< a performance metric
   bool m_auto_remove_logs = true;  //!< whether or not to automatically remove old logs
+  uint64_t m_map_size_hint = 0;  //!< requested initial size of the database map, in bytes (0 = automatic)
 
 public:
 
@@ -599,6 +638,36 @@ public:
    */
   virtual void open(const fs::path& filename, cryptonote::network_type nettype, const int db_flags = 0) = 0;
 
+  /**
+   * @brief sets the initial size the database should reserve for itself
+   *
+   * Must be called before open().  Subclasses that need to grow their storage
+   * as the chain grows (such as LMDB's memory map) should start at least this
+   * large, so that a node expecting a full sync can avoid growing repeatedly.
+   * 0 (the default) lets the subclass choose a size itself.
+   *
+   * @param bytes the requested initial size
+   */
+  void set_map_size_hint(uint64_t bytes) { m_map_size_hint = bytes; }
+
+  /**
+   * @brief statistics about resizes of the database's storage since it was opened
+   */
+  struct resize_stats
+  {
+    uint64_t count = 0;     //!< number of resizes
+    uint64_t total_ms = 0;  //!< total time writers were stalled by resizes, in milliseconds
+    uint64_t last_ms = 0;   //!< time taken by the most recent resize, in milliseconds
+  };
+
+  /**
+   * @brief get statistics about storage resizes
+   *
+   * The default implementation is for subclasses that never resize, and
+   * returns all zeros.
+   */
+  virtual resize_stats get_resize_stats() const { return {}; }
+
   /**
    * @brief Gets the current open/ready state of the BlockchainDB
    *
@@ -638,6 +707,25 @@ public:
    */
   virtual void safesyncmode(const bool onoff) = 0;
 
+  /**
+   * @brief the access pattern the DB should currently be tuned for
+   */
+  enum class io_policy
+  {
+    syncing,   //!< appending blocks, with random lookups of the outputs and key images they use
+    synced,    //!< mostly serving reads, which are largely runs of recent blocks and txs
+    pruning,   //!< sweeping through the prunable tx data
+    exporting, //!< reading the whole chain in order
+  };
+
+  /**
+   * @brief hint at how the DB is about to be accessed
+   *
+   * Lets a subclass adjust read-ahead and the like to suit.  The default
+   * implementation ignores it.
+   */
+  virtual void set_io_policy(io_policy) {}
+
   /**
    * @brief Remove everything from the BlockchainDB
    *
@@ -924,6 +1012,20 @@ public:
    */
   virtual cryptonote::blobdata get_block_blob_from_height(uint64_t height) const = 0;
 
+  /**
+   * @brief fetch a block blob by height without copying it out of the database
+   *
+   * Like get_block_blob_from_height(), but returns a view directly into the
+   * database's storage.  The caller must already hold a read transaction (e.g.
+   * via db_rtxn_guard): the returned view is only valid until that transaction
+   * ends, and the subclass should throw DB_ERROR if there is no such transaction.
+   *
+   * @param height the height to look for
+   *
+   * @return a view of the block blob
+   */
+  virtual std::string_view get_block_blob_view_from_height(uint64_t height) const = 0;
+
   /**
    * @brief fetch a block by height
    *
@@ -964,6 +1066,22 @@ public:
    */
   virtual std::vector<uint64_t> get_block_cumulative_rct_outputs(const std::vector<uint64_t> &heights) const = 0;
 
+  /**
+   * @brief fetch the cumulative number of rct outputs for a contiguous range of blocks
+   *
+   * Equivalent to calling get_block_cumulative_rct_outputs() with every height
+   * in [start_height, end_height], but lets the subclass read the range in a
+   * single sequential pass.  The default implementation does exactly that.
+   *
+   * If any block in the range does not exist, the subclass should throw BLOCK_DNE
+   *
+   * @param start_height the first height requested
+   * @param end_height the last height requested (inclusive)
+   *
+   * @return the cumulative number of rct outputs for each block in the range
+   */
+  virtual std::vector<uint64_t> get_block_cumulative_rct_outputs_range(uint64_t start_height, uint64_t end_height) const;
+
   /**
    * @brief fetch the top block's timestamp
    *
@@ -1298,6 +1416,20 @@ public:
    */
   virtual bool get_pruned_tx_blobs_from(const crypto::hash& h, size_t count, std::vector<cryptonote::blobdata> &bd) const = 0;
 
+  /**
+   * @brief fetches views of a number of pruned transaction blobs, in canonical blockchain order
+   *
+   * Like get_pruned_tx_blobs_from(), but appends views directly into the
+   * database's storage rather than copies.  As with
+   * get_block_blob_view_from_height(), the caller must hold a read transaction
+   * for as long as the views are used.
+   *
+   * @param h the hash to look for
+   *
+   * @return true iff the transactions were found
+   */
+  virtual bool get_pruned_tx_blob_views_from(const crypto::hash& h, size_t count, std::vector<std::string_view> &bd) const = 0;
+
   /**
    * @brief fetches the prunable transaction blob with the given hash
    *
@@ -1507,6 +1639,17 @@ public:
    */
   virtual bool has_key_image(const crypto::key_image& img) const = 0;
 
+  /**
+   * @brief check whether each of a set of key images is stored as spent
+   *
+   * The default implementation calls has_key_image() for each image; subclasses
+   * can override it to look the images up in a single ordered pass.
+   *
+   * @param imgs the key images to check for
+   * @param spent return-by-reference: set to one value per image, true if the image is present
+   */
+  virtual void has_key_images(epee::span<const crypto::key_image> imgs, std::vector<bool>& spent) const;
+
   /**
    * @brief add a txpool transaction
    *
@@ -1588,6 +1731,19 @@ public:
    */
   virtual bool prune_blockchain(uint32_t pruning_seed = 0) = 0;
 
+  /**
+   * @brief prunes part of the blockchain, continuing where the last partial prune stopped
+   *
+   * Does the same work as prune_blockchain, but returns after looking at `max_records` txs so
+   * that a live database can be pruned in small write txns.  The position reached is saved in
+   * the database, so pruning resumes from there after a restart.
+   *
+   * @param pruning_seed the seed to use, 0 for default (highly recommended)
+   * @param max_records the number of txs to look at before returning
+   * @return true once the whole blockchain is pruned, false if there is more to do
+   */
+  virtual bool prune_blockchain_step(uint32_t pruning_seed, size_t max_records) = 0;
+
   /**
    * @brief prunes recent blockchain changes as needed, iff pruning is enabled
    * @return success iff true
@@ -1663,6 +1819,58 @@ public:
    */
   virtual void drop_alt_blocks() = 0;
 
+  /**
+   * @brief fetch the cached proof-of-work hash of a block
+   *
+   * PoW hashes are only cached when the caller stores them with
+   * add_block_pow_hash(); entries are kept when blocks are popped so that
+   * re-adding a block (or re-validating an alt chain) doesn't recompute them.
+   * The default implementation has no cache.
+   *
+   * @param blkid the block hash
+   * @param pow_hash return-by-reference the cached PoW hash
+   *
+   * @return true if a cached PoW hash was found
+   */
+  virtual bool get_block_pow_hash(const crypto::hash &blkid, crypto::hash &pow_hash) const;
+
+  /**
+   * @brief cache the proof-of-work hash of a block
+   *
+   * The default implementation does nothing.
+   *
+   * @param blkid the block hash
+   * @param pow_hash the block's PoW hash
+   */
+  virtual void add_block_pow_hash(const crypto::hash &blkid, const crypto::hash &pow_hash);
+
+  /**
+   * @brief fetch the header info of a run of main chain blocks
+   *
+   * Stops early at the first block without stored header info, i.e. one
+   * added by a version that didn't store it, so the caller has to fall back
+   * to the full block for the rest.  The default implementation stores none.
+   *
+   * @param start_height the height of the first block
+   * @param count the number of blocks wanted
+   *
+   * @return the header info of blocks start_height, start_height+1, ..., up to count of them
+   */
+  virtual std::vector<block_header_info> get_block_headers(uint64_t start_height, uint64_t count) const;
+
+  /**
+   * @brief fetch the running coinbase totals of the main chain at a height
+   *
+   * The sums over a range of blocks are the totals at its last block less
+   * those at the block before it.  The default implementation stores none.
+   *
+   * @param height the height of the block
+   * @param sums return-by-reference the totals for blocks 0 through height
+   *
+   * @return true if the totals were found, otherwise false
+   */
+  virtual bool get_coinbase_sums(uint64_t height, block_coinbase_sums &sums) const;
+
   /**
    * @brief runs a function over all txpool transactions
    *
@@ -1798,15 +2006,25 @@ public:
    */
   virtual uint64_t get_database_size() const = 0;
 
+  /**
+   * @brief get how much of the database is resident in memory
+   *
+   * @return the bytes of the database's mapping currently in RAM, or 0 if unknown
+   */
+  virtual uint64_t get_resident_size() const { return 0; }
+
   /**
    * @brief fix up anything that may be wrong due to past bugs
    */
   virtual void fixup(cryptonote::network_type nettype);
 
-  virtual void get_output_blacklist(std::vector<uint64_t> &blacklist) const   = 0;
+  /// Appends the blacklisted global output indices >= `from` to `blacklist`, in ascending order
+  virtual void get_output_blacklist(std::vector<uint64_t> &blacklist, uint64_t from = 0) const = 0;
   virtual void add_output_blacklist(std::vector<uint64_t> const &blacklist)   = 0;
   virtual void set_service_node_data(const std::string& data, bool long_term) = 0;
-  virtual bool get_service_node_data(std::string &data, bool long_term) const = 0;
+  /// Points `data` at the stored service node data, without copying it out of the database; the
+  /// view is only valid until the caller's read transaction ends.
+  virtual bool get_service_node_data(std::string_view &data, bool long_term) const = 0;
   virtual void clear_service_node_data()                                      = 0;
 
   /// Updates the given proof data with the latest stored info for the given service node.  Returns
@@ -1843,7 +2061,10 @@ public:
   // timestamps_difficulty_height: The last 'chain_height' that this function
   // was invoked and loaded historical timestamp/difficulties into (allowing
   // this function to be called iteratively on the same input arrays over time).
-  // This should be set to 0 on the initial call.
+  // This should be set to 0 on the initial call.  Entries that are still in the
+  // window are kept and only the missing heights are loaded, whether the chain
+  // has grown or shrunk since then; the caller must lower it (and drop the
+  // entries) for any popped blocks before new blocks are added at those heights.
   void fill_timestamps_and_difficulties_for_pow(cryptonote::network_type nettype,
                                                 std::vector<uint64_t> &timestamps,
                                                 std::vector<uint64_t> &difficulties,
@@ -32,15 +32,28 @@
 #include <boost/circular_buffer.hpp>
 #include <boost/endian/conversion.hpp>
 #include <memory>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <numeric>
 #include <cstring>
 #include <type_traits>
 #include <variant>
+#include <fstream>
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+#endif
 
 #include "cryptonote_basic/hardfork.h"
 #include "epee/string_tools.h"
 #include "common/file.h"
 #include "common/pruning.h"
 #include "common/hex.h"
+#include "common/metrics.h"
+#include "common/oxen.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
 #include "crypto/crypto.h"
 #include "epee/profile_tools.h"
@@ -64,6 +77,7 @@ enum struct lmdb_version
     v5,     // alt_block_data_1_t => alt_block_data_t: Alt block data has boolean for if the block was checkpointed
     v6,     // remigrate quorum_signature struct due to alignment change
     v7,     // rebuild the checkpoint table because v6 update in-place made MDB_LAST not give us the newest checkpoint
+    v8,     // build the running coinbase totals of the block_coinbase_sums table
     _count
 };
 
@@ -217,6 +231,10 @@ namespace
  *
  * alt_blocks       block hash   {block data, block blob}
  *
+ * block_pow_hashes block hash   proof-of-work hash (optional cache, see Blockchain::set_pow_cache)
+ * block_headers    block ID     {block header fields for the header RPCs}
+ * block_coinbase_sums block ID  {emission, fees, burned} totals up to the block
+ *
  * Note: where the data items are of uniform size, DUPFIXED tables have
  * been used to save space. In most of these cases, a dummy "zerokval"
  * key is used when accessing the table; the Key listed above will be
@@ -224,6 +242,11 @@ namespace
  * (DUPFIXED saves 8 bytes per record.)
  *
  * The output_amounts table doesn't use a dummy key, but uses DUPSORT.
+ * Each amount is stored once as the key, with that amount's outputs as
+ * DUPFIXED records sorted by amount output index (and so by height).  All
+ * RingCT outputs share the amount key 0, so they already form a single dense
+ * array of fixed-size outkey records (pre_rct_outkey for non-zero amounts),
+ * and decoy lookups for nearby indices land on the same leaf pages.
  */
 const char* const LMDB_BLOCKS = "blocks";
 const char* const LMDB_BLOCK_HEIGHTS = "block_heights";
@@ -247,6 +270,9 @@ const char* const LMDB_TXPOOL_META = "txpool_meta";
 const char* const LMDB_TXPOOL_BLOB = "txpool_blob";
 
 const char* const LMDB_ALT_BLOCKS = "alt_blocks";
+const char* const LMDB_BLOCK_POW_HASHES = "block_pow_hashes";
+const char* const LMDB_BLOCK_HEADERS = "block_headers";
+const char* const LMDB_BLOCK_COINBASE_SUMS = "block_coinbase_sums";
 
 const char* const LMDB_HF_STARTING_HEIGHTS = "hf_starting_heights";
 const char* const LMDB_HF_VERSIONS = "hf_versions";
@@ -255,7 +281,7 @@ const char* const LMDB_SERVICE_NODE_LATEST = "service_node_proofs"; // contains
 
 const char* const LMDB_PROPERTIES = "properties";
 
-constexpr unsigned int LMDB_DB_COUNT = 23; // Should agree with the number of db's above
+constexpr unsigned int LMDB_DB_COUNT = 26; // Should agree with the number of db's above
 
 const char zerokey[8] = {0};
 const MDB_val zerokval = { sizeof(zerokey), (void *)zerokey };
@@ -396,6 +422,9 @@ void setup_rcursor(const MDB_dbi& db, MDB_cursor*& cursor, MDB_txn* txn, bool* r
 #define m_cur_txpool_meta	m_cursors->txpool_meta
 #define m_cur_txpool_blob	m_cursors->txpool_blob
 #define m_cur_alt_blocks	m_cursors->alt_blocks
+#define m_cur_block_pow_hashes	m_cursors->block_pow_hashes
+#define m_cur_block_headers	m_cursors->block_headers
+#define m_cur_block_coinbase_sums	m_cursors->block_coinbase_sums
 #define m_cur_hf_versions	m_cursors->hf_versions
 #define m_cur_properties	m_cursors->properties
 
@@ -429,6 +458,44 @@ struct mdb_block_info : mdb_block_info_2
 
 static_assert(sizeof(mdb_block_info) == sizeof(mdb_block_info_1) + 16, "unexpected mdb_block_info struct sizes");
 
+// The parts of block_header_info that aren't in mdb_block_info
+struct mdb_block_header
+{
+  crypto::hash hash; // to catch a record left behind by a version that didn't remove them with their block
+  crypto::hash prev_id;
+  crypto::hash miner_tx_hash;
+  crypto::public_key service_node_winner;
+  uint64_t timestamp;
+  uint64_t reward;
+  uint64_t miner_reward;
+  uint64_t num_txes;
+  uint32_t nonce;
+  uint8_t major_version;
+  uint8_t minor_version;
+  uint8_t padding[2];
+};
+static_assert(sizeof(mdb_block_header) == 4 * 32 + 5 * 8, "mdb_block_header has unexpected padding");
+
+static_assert(sizeof(block_coinbase_sums) == 3 * 8, "block_coinbase_sums has unexpected padding");
+
+// Adds a block's amounts to the running coinbase totals: its miner tx's outputs
+// with add_miner_tx_amounts, then the fees (which those outputs include) and
+// burns of each of its txes with add_tx_amounts.
+static void add_miner_tx_amounts(block_coinbase_sums &sums, const transaction &miner_tx)
+{
+  sums.emission += get_outs_money_amount(miner_tx);
+}
+
+static void add_tx_amounts(block_coinbase_sums &sums, const transaction &tx, uint8_t hf_version)
+{
+  const bool burning = hf_version >= HF_VERSION_FEE_BURNING;
+  const uint64_t fee = get_tx_miner_fee(tx, burning);
+  sums.emission -= fee;
+  sums.fees += fee;
+  if (burning)
+    sums.burned += get_burned_amount_from_tx_extra(tx.extra);
+}
+
 struct blk_checkpoint_header
 {
   uint64_t     height;
@@ -492,8 +559,7 @@ mdb_txn_safe::~mdb_txn_safe()
   LOG_PRINT_L3("mdb_txn_safe: destructor");
   if (m_tinfo != nullptr)
   {
-    mdb_txn_reset(m_tinfo->m_ti_rtxn);
-    memset(&m_tinfo->m_ti_rflags, 0, sizeof(m_tinfo->m_ti_rflags));
+    m_tinfo->m_ti_db->block_rtxn_stop();
   } else if (m_txn != nullptr)
   {
     if (m_batch_txn) // this is a batch txn and should have been handled before this point for safety
@@ -625,12 +691,34 @@ void BlockchainLMDB::do_resize(uint64_t increase_size)
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
   std::lock_guard lock{*this};
-  const uint64_t add_size = 1LL << 30;
+  static auto& resizes = tools::metrics::get_counter("oxend_lmdb_resizes_total", "Times the LMDB map has been grown");
+  resizes.inc();
+
+  MDB_envinfo mei;
+
+  mdb_env_info(m_env, &mei);
+
+  MDB_stat mst;
+
+  mdb_env_stat(m_env, &mst);
+
+  // If given, increase_size is the least we need.  This is currently used for increasing by an
+  // estimated size at start of new batch txn.
+  const uint64_t min_add_size = std::max<uint64_t>(MIN_RESIZE_INCREMENT, increase_size);
+
+  // Otherwise grow geometrically so that the number of resizes, each of which stalls every reader
+  // and writer, stays logarithmic in the size of the chain.
+  uint64_t add_size = std::max(min_add_size, (uint64_t) mei.me_mapsize / RESIZE_GROWTH_DIVISOR);
 
   // check disk capacity
   try
   {
     auto si = fs::space(m_folder);
+    if (si.available < add_size && si.available >= min_add_size)
+    {
+      MWARNING("Not enough free space for a full LMDB map increase, growing by " << (min_add_size >> 20L) << " MB instead");
+      add_size = min_add_size;
+    }
     if(si.available < add_size)
     {
       MERROR("!! WARNING: Insufficient free space to extend database !!: " <<
@@ -644,27 +732,17 @@ void BlockchainLMDB::do_resize(uint64_t increase_size)
     MWARNING("Unable to query free disk space.");
   }
 
-  MDB_envinfo mei;
-
-  mdb_env_info(m_env, &mei);
-
-  MDB_stat mst;
-
-  mdb_env_stat(m_env, &mst);
-
-  // add 1Gb per resize, instead of doing a percentage increase
   uint64_t new_mapsize = (uint64_t) mei.me_mapsize + add_size;
 
-  // If given, use increase_size instead of above way of resizing.
-  // This is currently used for increasing by an estimated size at start of new
-  // batch txn.
-  if (increase_size > 0)
-    new_mapsize = mei.me_mapsize + increase_size;
-
   new_mapsize += (new_mapsize % mst.ms_psize);
 
+  const auto stall_start = std::chrono::steady_clock::now();
   mdb_txn_safe::prevent_new_txns();
 
+  // Pooled snapshots are live read txns that aren't tracked by mdb_txn_safe, so they have to be
+  // reset here or the resize would fail.
+  invalidate_read_snapshots();
+
   if (m_write_txn != nullptr)
   {
     if (m_batch_active)
@@ -679,13 +757,33 @@ void BlockchainLMDB::do_resize(uint64_t increase_size)
 
   mdb_txn_safe::wait_no_active_txns();
 
-  int result = mdb_env_set_mapsize(m_env, new_mapsize);
-  if (result)
-    throw0(DB_ERROR(lmdb_error("Failed to set new mapsize: ", result).c_str()));
-
-  MGINFO("LMDB Mapsize increased." << "  Old: " << mei.me_mapsize / (1024 * 1024) << "MiB" << ", New: " << new_mapsize / (1024 * 1024) << "MiB");
+  {
+    std::lock_guard policy_lock{m_io_policy_mutex};
+    int result = mdb_env_set_mapsize(m_env, new_mapsize);
+    if (result)
+      throw0(DB_ERROR(lmdb_error("Failed to set new mapsize: ", result).c_str()));
+    if (m_io_policy != io_policy::syncing)
+      apply_io_policy();
+  }
 
   mdb_txn_safe::allow_new_txns();
+
+  const uint64_t stall_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - stall_start).count();
+  m_resize_count++;
+  m_resize_total_ms += stall_ms;
+  m_resize_last_ms = stall_ms;
+
+  MGINFO("LMDB Mapsize increased." << "  Old: " << mei.me_mapsize / (1024 * 1024) << "MiB" << ", New: " << new_mapsize / (1024 * 1024) << "MiB"
+      << " (resize #" << m_resize_count << ", took " << stall_ms << "ms)");
+}
+
+BlockchainDB::resize_stats BlockchainLMDB::get_resize_stats() const
+{
+  resize_stats stats;
+  stats.count = m_resize_count;
+  stats.total_ms = m_resize_total_ms;
+  stats.last_ms = m_resize_last_ms;
+  return stats;
 }
 
 // threshold_size is used for batch transactions
@@ -914,6 +1012,24 @@ void BlockchainLMDB::add_block(const block& blk, size_t block_weight, uint64_t l
   if (result)
     throw0(DB_ERROR(lmdb_error("Failed to add block height by hash to db transaction: ", result).c_str()));
 
+  mdb_block_header hdr{};
+  hdr.hash = blk_hash;
+  hdr.prev_id = blk.prev_id;
+  hdr.miner_tx_hash = get_transaction_hash(blk.miner_tx);
+  hdr.service_node_winner = get_service_node_winner_from_tx_extra(blk.miner_tx.extra);
+  hdr.timestamp = blk.timestamp;
+  for (const auto &out : blk.miner_tx.vout)
+    hdr.reward += out.amount;
+  hdr.miner_reward = blk.miner_tx.vout.empty() ? 0 : blk.miner_tx.vout[0].amount;
+  hdr.num_txes = blk.tx_hashes.size();
+  hdr.nonce = blk.nonce;
+  hdr.major_version = blk.major_version;
+  hdr.minor_version = blk.minor_version;
+  MDB_val_set(val_hdr, hdr);
+  // Not appended: an older version may have left records above the top block
+  if ((result = mdb_put(*m_write_txn, m_block_headers, &key, &val_hdr, 0)))
+    throw0(DB_ERROR(lmdb_error("Failed to add block header to db transaction: ", result).c_str()));
+
   // we use weight as a proxy for size, since we don't have size but weight is >= size
   // and often actually equal
   m_cum_size += block_weight;
@@ -955,6 +1071,12 @@ void BlockchainLMDB::remove_block()
 
   if ((result = mdb_cursor_del(m_cur_block_info, 0)))
       throw1(DB_ERROR(lmdb_error("Failed to add removal of block info to db transaction: ", result).c_str()));
+
+  if ((result = mdb_del(*m_write_txn, m_block_headers, &k, nullptr)) && result != MDB_NOTFOUND)
+      throw1(DB_ERROR(lmdb_error("Failed to add removal of block header to db transaction: ", result).c_str()));
+
+  if ((result = mdb_del(*m_write_txn, m_block_coinbase_sums, &k, nullptr)))
+      throw1(DB_ERROR(lmdb_error("Failed to add removal of block coinbase sums to db transaction: ", result).c_str()));
 }
 
 uint64_t BlockchainLMDB::add_transaction_data(const crypto::hash& blk_hash, const std::pair<transaction, blobdata>& txp, const crypto::hash& tx_hash, const crypto::hash& tx_prunable_hash)
@@ -1397,7 +1519,8 @@ BlockchainLMDB::BlockchainLMDB(bool batch_transactions): BlockchainDB()
 void BlockchainLMDB::open(const fs::path& filename, cryptonote::network_type nettype, const int db_flags)
 {
   int result;
-  int mdb_flags = MDB_NORDAHEAD;
+  // MDB_NOTLS lets read txns move between threads, which the read snapshot pool relies on.
+  int mdb_flags = MDB_NORDAHEAD | MDB_NOTLS;
 
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
 
@@ -1444,7 +1567,9 @@ void BlockchainLMDB::open(const fs::path& filename, cryptonote::network_type net
     (result = mdb_env_set_maxreaders(m_env, threads+16)))
     throw0(DB_ERROR(lmdb_error("Failed to set max number of readers: ", result).c_str()));
 
-  size_t mapsize = DEFAULT_MAPSIZE;
+  uint64_t mapsize = DEFAULT_MAPSIZE;
+  if (m_map_size_hint > mapsize && m_map_size_hint <= std::numeric_limits<size_t>::max())
+    mapsize = m_map_size_hint;
 
   if (db_flags & DBF_FAST)
     mdb_flags |= MDB_NOSYNC;
@@ -1464,6 +1589,20 @@ void BlockchainLMDB::open(const fs::path& filename, cryptonote::network_type net
   mdb_env_info(m_env, &mei);
   uint64_t cur_mapsize = (uint64_t)mei.me_mapsize;
 
+#if defined(ENABLE_AUTO_RESIZE)
+  // Without an explicit hint, leave room for the existing data to grow by one resize increment so
+  // that a node resuming a sync doesn't hit a resize almost immediately.
+  if (!m_map_size_hint && !(mdb_flags & MDB_RDONLY))
+  {
+    MDB_stat mst;
+    mdb_env_stat(m_env, &mst);
+    const uint64_t size_used = mst.ms_psize * mei.me_last_pgno;
+    const uint64_t projected = size_used + std::max<uint64_t>(MIN_RESIZE_INCREMENT, size_used / RESIZE_GROWTH_DIVISOR);
+    if (projected > mapsize && projected <= std::numeric_limits<size_t>::max())
+      mapsize = projected;
+  }
+#endif
+
   if (cur_mapsize < mapsize)
   {
     if (auto result = mdb_env_set_mapsize(m_env, mapsize))
@@ -1516,6 +1655,23 @@ void BlockchainLMDB::open(const fs::path& filename, cryptonote::network_type net
   lmdb_db_open(txn, LMDB_TXPOOL_BLOB, MDB_CREATE, m_txpool_blob, "Failed to open db handle for m_txpool_blob");
 
   lmdb_db_open(txn, LMDB_ALT_BLOCKS, MDB_CREATE, m_alt_blocks, "Failed to open db handle for m_alt_blocks");
+  // The PoW hash cache was added without a db migration, so it may be missing from an older db
+  // opened read-only; in that case the handle is left as 0 and the cache behaves as empty.
+  if (!(mdb_flags & MDB_RDONLY))
+    lmdb_db_open(txn, LMDB_BLOCK_POW_HASHES, MDB_CREATE, m_block_pow_hashes, "Failed to open db handle for m_block_pow_hashes");
+  else if (mdb_dbi_open(txn, LMDB_BLOCK_POW_HASHES, 0, &m_block_pow_hashes))
+    m_block_pow_hashes = 0;
+  // Likewise the header records; blocks added before it existed just don't have one
+  if (!(mdb_flags & MDB_RDONLY))
+    lmdb_db_open(txn, LMDB_BLOCK_HEADERS, MDB_INTEGERKEY | MDB_CREATE, m_block_headers, "Failed to open db handle for m_block_headers");
+  else if (mdb_dbi_open(txn, LMDB_BLOCK_HEADERS, MDB_INTEGERKEY, &m_block_headers))
+    m_block_headers = 0;
+  // Filled in for existing blocks by migrate_7_8, which can't run on a read-only db: such a db
+  // fails the version check below instead.
+  if (!(mdb_flags & MDB_RDONLY))
+    lmdb_db_open(txn, LMDB_BLOCK_COINBASE_SUMS, MDB_INTEGERKEY | MDB_CREATE, m_block_coinbase_sums, "Failed to open db handle for m_block_coinbase_sums");
+  else if (mdb_dbi_open(txn, LMDB_BLOCK_COINBASE_SUMS, MDB_INTEGERKEY, &m_block_coinbase_sums))
+    m_block_coinbase_sums = 0;
 
   // this subdb is dropped on sight, so it may not be present when we open the DB.
   // Since we use MDB_CREATE, we'll get an exception if we open read-only and it does not exist.
@@ -1547,6 +1703,8 @@ void BlockchainLMDB::open(const fs::path& filename, cryptonote::network_type net
   mdb_set_compare(txn, m_txpool_meta, compare_hash32);
   mdb_set_compare(txn, m_txpool_blob, compare_hash32);
   mdb_set_compare(txn, m_alt_blocks, compare_hash32);
+  if (m_block_pow_hashes)
+    mdb_set_compare(txn, m_block_pow_hashes, compare_hash32);
   mdb_set_compare(txn, m_service_node_proofs, compare_hash32);
   mdb_set_compare(txn, m_properties, compare_string);
 
@@ -1641,6 +1799,11 @@ void BlockchainLMDB::close()
   }
   this->sync();
   m_tinfo.reset();
+  {
+    std::lock_guard lock{m_rtxn_pool_mutex};
+    m_rtxn_live.clear();
+    m_rtxn_idle.clear();
+  }
 
   // FIXME: not yet thread safe!!!  Use with care.
   mdb_env_close(m_env);
@@ -1669,6 +1832,67 @@ void BlockchainLMDB::safesyncmode(const bool onoff)
   mdb_env_set_flags(m_env, MDB_NOSYNC|MDB_MAPASYNC, !onoff);
 }
 
+#ifdef __linux__
+// LMDB doesn't expose where it mapped the environment, so look for the mapping of its data file
+static std::pair<void*, size_t> find_data_file_mapping(const fs::path& data_file)
+{
+  struct stat st;
+  if (stat(data_file.c_str(), &st))
+    return {nullptr, 0};
+
+  std::pair<void*, size_t> found{nullptr, 0};
+  std::ifstream maps{"/proc/self/maps"};
+  for (std::string line; std::getline(maps, line); )
+  {
+    unsigned long start, end, offset, inode;
+    unsigned int dev_major, dev_minor;
+    if (sscanf(line.c_str(), "%lx-%lx %*s %lx %x:%x %lu", &start, &end, &offset, &dev_major, &dev_minor, &inode) != 6)
+      continue;
+    if (offset == 0 && inode == st.st_ino && makedev(dev_major, dev_minor) == st.st_dev && end - start > found.second)
+      found = {reinterpret_cast<void*>(start), end - start};
+  }
+  return found;
+}
+#endif
+
+void BlockchainLMDB::set_io_policy(io_policy policy)
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  std::lock_guard lock{m_io_policy_mutex};
+  if (policy == m_io_policy)
+    return;
+  m_io_policy = policy;
+  apply_io_policy();
+}
+
+void BlockchainLMDB::apply_io_policy()
+{
+#ifdef __linux__
+  // Read-ahead only wastes I/O on the scattered output and key image lookups of a sync, but
+  // serving runs of blocks or sweeping over the tables wants it (aggressively, for the sweeps).
+  int advice = MADV_RANDOM;
+  const char* name = "random";
+  switch (m_io_policy)
+  {
+    case io_policy::syncing: break;
+    case io_policy::synced: advice = MADV_NORMAL; name = "normal"; break;
+    case io_policy::pruning:
+    case io_policy::exporting: advice = MADV_SEQUENTIAL; name = "sequential"; break;
+  }
+
+  auto [addr, len] = find_data_file_mapping(m_folder / CRYPTONOTE_BLOCKCHAINDATA_FILENAME);
+  if (!addr)
+  {
+    MWARNING("Unable to find the LMDB map, leaving its read-ahead unchanged");
+    return;
+  }
+  if (madvise(addr, len, advice))
+    MWARNING("Failed to set LMDB map read-ahead to " << name << ": " << strerror(errno));
+  else
+    MINFO("LMDB map read-ahead set to " << name);
+#endif
+}
+
 void BlockchainLMDB::reset()
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
@@ -1711,6 +1935,12 @@ void BlockchainLMDB::reset()
     throw0(DB_ERROR(lmdb_error("Failed to drop m_hf_versions: ", result).c_str()));
   if (auto result = mdb_drop(txn, m_service_node_data, 0))
     throw0(DB_ERROR(lmdb_error("Failed to drop m_service_node_data: ", result).c_str()));
+  if (auto result = m_block_pow_hashes ? mdb_drop(txn, m_block_pow_hashes, 0) : 0)
+    throw0(DB_ERROR(lmdb_error("Failed to drop m_block_pow_hashes: ", result).c_str()));
+  if (auto result = m_block_headers ? mdb_drop(txn, m_block_headers, 0) : 0)
+    throw0(DB_ERROR(lmdb_error("Failed to drop m_block_headers: ", result).c_str()));
+  if (auto result = m_block_coinbase_sums ? mdb_drop(txn, m_block_coinbase_sums, 0) : 0)
+    throw0(DB_ERROR(lmdb_error("Failed to drop m_block_coinbase_sums: ", result).c_str()));
   if (auto result = mdb_drop(txn, m_properties, 0))
     throw0(DB_ERROR(lmdb_error("Failed to drop m_properties: ", result).c_str()));
 
@@ -1793,7 +2023,10 @@ void BlockchainLMDB::unlock()
 #define TXN_POSTFIX_SUCCESS() \
   do { \
     if (! m_batch_active) \
+    { \
       auto_txn.commit(); \
+      invalidate_read_snapshots(); \
+    } \
   } while(0)
 
 
@@ -1819,7 +2052,10 @@ void BlockchainLMDB::unlock()
 #define TXN_BLOCK_POSTFIX_SUCCESS() \
   do { \
     if (! m_batch_active && ! m_write_txn) \
+    { \
       auto_txn.commit(); \
+      invalidate_read_snapshots(); \
+    } \
   } while(0)
 
 void BlockchainLMDB::add_txpool_tx(const crypto::hash &txid, const cryptonote::blobdata &blob, const txpool_tx_meta_t &meta)
@@ -2045,7 +2281,7 @@ static bool is_v1_tx(MDB_cursor *c_txs_pruned, MDB_val *tx_id)
 
 enum { prune_mode_prune, prune_mode_update, prune_mode_check };
 
-bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed)
+bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed, size_t max_records)
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
   const uint32_t log_stripes = tools::get_pruning_log_stripes(pruning_seed);
@@ -2056,6 +2292,16 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed)
     throw0(DB_ERROR("Pruning seed not in range"));
   check_open();
 
+  // A full pass reads the whole prunable table in key order
+  io_policy prev_policy;
+  {
+    std::lock_guard lock{m_io_policy_mutex};
+    prev_policy = m_io_policy;
+  }
+  if (!max_records)
+    set_io_policy(io_policy::pruning);
+  OXEN_DEFER { if (!max_records) set_io_policy(prev_policy); };
+
   TIME_MEASURE_START(t);
 
   size_t n_total_records = 0, n_prunable_records = 0, n_pruned_records = 0, commit_counter = 0;
@@ -2117,7 +2363,7 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed)
 
   if (mode == prune_mode_check)
     MINFO("Checking blockchain pruning...");
-  else
+  else if (!max_records)
     MINFO("Pruning blockchain...");
 
   MDB_cursor *c_txs_pruned, *c_txs_prunable, *c_txs_prunable_tip;
@@ -2131,6 +2377,7 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed)
   if (result)
     throw0(DB_ERROR(lmdb_error("Failed to open a cursor for txs_prunable_tip: ", result).c_str()));
   const uint64_t blockchain_height = height();
+  bool finished = true;
 
   if (prune_tip_table)
   {
@@ -2200,7 +2447,36 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed)
     if (result)
       throw0(DB_ERROR(lmdb_error("Failed to open a cursor for tx_indices: ", result).c_str()));
     MDB_cursor_op op = MDB_FIRST;
-    while (1)
+    bool more = true;
+    txindex ti;
+
+    // An earlier partial prune leaves the hash of the next tx to look at in the properties table
+    MDB_val_str(k_progress, "pruning_progress");
+    if (mode != prune_mode_check)
+    {
+      result = mdb_get(txn, m_properties, &k_progress, &v);
+      if (result == 0)
+      {
+        if (v.mv_size != sizeof(ti.key))
+          throw0(DB_ERROR("Failed to retrieve pruning progress: unexpected value size"));
+        memcpy(&ti.key, v.mv_data, sizeof(ti.key));
+        MDB_val val;
+        val.mv_size = sizeof(ti);
+        val.mv_data = (void *)&ti;
+        result = mdb_cursor_get(c_tx_indices, (MDB_val*)&zerokval, &val, MDB_GET_BOTH_RANGE);
+        if (result == MDB_NOTFOUND)
+          more = false;
+        else if (result)
+          throw0(DB_ERROR(lmdb_error("Failed to restore cursor for tx_indices: ", result).c_str()));
+        else
+          op = MDB_GET_CURRENT;
+        MDEBUG("Resuming pruning at tx " << ti.key);
+      }
+      else if (result != MDB_NOTFOUND)
+        throw0(DB_ERROR(lmdb_error("Failed to retrieve pruning progress: ", result).c_str()));
+    }
+
+    while (more)
     {
       int ret = mdb_cursor_get(c_tx_indices, &k, &v, op);
       op = MDB_NEXT;
@@ -2209,10 +2485,14 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed)
       if (ret)
         throw0(DB_ERROR(lmdb_error("Failed to enumerate transactions: ", ret).c_str()));
 
-      ++n_total_records;
       //const txindex *ti = (const txindex *)v.mv_data;
-      txindex ti;
       memcpy(&ti, v.mv_data, sizeof(ti));
+      if (max_records && n_total_records >= max_records)
+      {
+        finished = false;
+        break;
+      }
+      ++n_total_records;
       const uint64_t block_height = ti.data.block_id;
       if (block_height + CRYPTONOTE_PRUNING_TIP_BLOCKS >= blockchain_height)
       {
@@ -2306,6 +2586,19 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed)
       }
     }
     mdb_cursor_close(c_tx_indices);
+
+    if (mode != prune_mode_check)
+    {
+      if (finished)
+        result = mdb_del(txn, m_properties, &k_progress, NULL);
+      else
+      {
+        MDB_val_set(v_progress, ti.key);
+        result = mdb_put(txn, m_properties, &k_progress, &v_progress, 0);
+      }
+      if (result && result != MDB_NOTFOUND)
+        throw0(DB_ERROR(lmdb_error("Failed to save pruning progress: ", result).c_str()));
+    }
   }
 
   if ((result = mdb_stat(txn, m_txs_prunable, &db_stats)))
@@ -2318,14 +2611,16 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed)
   mdb_cursor_close(c_txs_pruned);
 
   txn.commit();
+  invalidate_read_snapshots();
 
   TIME_MEASURE_FINISH(t);
 
-  MINFO((mode == prune_mode_check ? "Checked" : "Pruned") << " blockchain in " <<
+  MCLOG(max_records ? el::Level::Debug : el::Level::Info, LOKI_DEFAULT_LOG_CATEGORY,
+      (mode == prune_mode_check ? "Checked" : "Pruned") << " blockchain in " <<
       t << " ms: " << (n_bytes/1024.0f/1024.0f) << " MB (" << db_bytes/1024.0f/1024.0f << " MB) pruned in " <<
       n_pruned_records << " records (" << pages0 - pages1 << "/" << pages0 << " " << db_stats.ms_psize << " byte pages), " <<
       n_prunable_records << "/" << n_total_records << " pruned records");
-  return true;
+  return finished;
 }
 
 bool BlockchainLMDB::prune_blockchain(uint32_t pruning_seed)
@@ -2333,6 +2628,11 @@ bool BlockchainLMDB::prune_blockchain(uint32_t pruning_seed)
   return prune_worker(prune_mode_prune, pruning_seed);
 }
 
+bool BlockchainLMDB::prune_blockchain_step(uint32_t pruning_seed, size_t max_records)
+{
+  return prune_worker(prune_mode_prune, pruning_seed, max_records);
+}
+
 bool BlockchainLMDB::update_pruning()
 {
   return prune_worker(prune_mode_update, 0);
@@ -2576,6 +2876,27 @@ T BlockchainLMDB::get_and_convert_block_blob_from_height(uint64_t height) const
   return result;
 }
 
+std::string_view BlockchainLMDB::get_block_blob_view_from_height(uint64_t height) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  TXN_PREFIX_RDONLY();
+  if (my_rtxn)
+    throw0(DB_ERROR("get_block_blob_view_from_height requires an active read transaction"));
+  RCURSOR(blocks);
+
+  MDB_val_copy<uint64_t> key(height);
+  MDB_val value;
+  auto get_result = mdb_cursor_get(m_cur_blocks, &key, &value, MDB_SET);
+  if (get_result == MDB_NOTFOUND)
+    throw0(BLOCK_DNE(std::string("Attempt to get block from height ").append(std::to_string(height)).append(" failed -- block not in db").c_str()));
+  else if (get_result)
+    throw0(DB_ERROR("Error attempting to retrieve a block from the db"));
+
+  return {reinterpret_cast<const char *>(value.mv_data), value.mv_size};
+}
+
 block BlockchainLMDB::get_block_from_height(uint64_t height) const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
@@ -2707,6 +3028,56 @@ std::vector<uint64_t> BlockchainLMDB::get_block_cumulative_rct_outputs(const std
   return res;
 }
 
+std::vector<uint64_t> BlockchainLMDB::get_block_cumulative_rct_outputs_range(uint64_t start_height, uint64_t end_height) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+  std::vector<uint64_t> res;
+  int result;
+
+  if (end_height < start_height)
+    return res;
+
+  TXN_PREFIX_RDONLY();
+  RCURSOR(block_info);
+
+  MDB_stat db_stats;
+  if ((result = mdb_stat(m_txn, m_blocks, &db_stats)))
+    throw0(DB_ERROR(lmdb_error("Failed to query m_blocks: ", result).c_str()));
+  if (end_height >= db_stats.ms_entries)
+    throw0(BLOCK_DNE(std::string("Attempt to get rct distribution up to height " + std::to_string(end_height) + " failed -- block size not in db").c_str()));
+
+  res.reserve(end_height + 1 - start_height);
+
+  // Seek to the first block, then pull the rest of the range a page of records at a time
+  MDB_val v;
+  v.mv_size = sizeof(uint64_t);
+  v.mv_data = (void*)&start_height;
+  result = mdb_cursor_get(m_cur_block_info, (MDB_val *)&zerokval, &v, MDB_GET_BOTH);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Error attempting to retrieve rct distribution from the db: ", result).c_str()));
+  res.push_back(((const mdb_block_info *)v.mv_data)->bi_cum_rct);
+
+  uint64_t range_begin = 0, range_end = 0;
+  for (uint64_t height = start_height + 1; height <= end_height; ++height)
+  {
+    if (height < range_begin || height >= range_end)
+    {
+      MDB_val k2;
+      if ((result = mdb_cursor_get(m_cur_block_info, &k2, &v, MDB_NEXT_MULTIPLE)))
+        throw0(DB_ERROR(lmdb_error("Error attempting to retrieve rct distribution from the db: ", result).c_str()));
+      range_begin = ((const mdb_block_info*)v.mv_data)->bi_height;
+      range_end = range_begin + v.mv_size / sizeof(mdb_block_info); // whole records please
+      if (height < range_begin || height >= range_end)
+        throw0(DB_ERROR(("Height " + std::to_string(height) + " not included in multuple record range: " + std::to_string(range_begin) + "-" + std::to_string(range_end)).c_str()));
+    }
+    const mdb_block_info *bi = ((const mdb_block_info *)v.mv_data) + (height - range_begin);
+    res.push_back(bi->bi_cum_rct);
+  }
+
+  return res;
+}
+
 uint64_t BlockchainLMDB::get_top_block_timestamp() const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
@@ -3207,10 +3578,34 @@ bool BlockchainLMDB::get_pruned_tx_blobs_from(const crypto::hash& h, size_t coun
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
   check_open();
 
+  if (!count)
+    return true;
+
+  // Hold a txn across the view lookup and the copy so that the views stay valid until copied
+  TXN_PREFIX_RDONLY();
+
+  std::vector<std::string_view> views;
+  if (!get_pruned_tx_blob_views_from(h, count, views))
+    return false;
+
+  bd.reserve(bd.size() + views.size());
+  for (const auto& v : views)
+    bd.emplace_back(v);
+
+  return true;
+}
+
+bool BlockchainLMDB::get_pruned_tx_blob_views_from(const crypto::hash& h, size_t count, std::vector<std::string_view> &bd) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
   if (!count)
     return true;
 
   TXN_PREFIX_RDONLY();
+  if (my_rtxn)
+    throw0(DB_ERROR("get_pruned_tx_blob_views_from requires an active read transaction"));
   RCURSOR(tx_indices);
   RCURSOR(txs_pruned);
 
@@ -3236,7 +3631,7 @@ bool BlockchainLMDB::get_pruned_tx_blobs_from(const crypto::hash& h, size_t coun
       return false;
     if (res)
       throw0(DB_ERROR(lmdb_error("DB error attempting to fetch tx blob", res).c_str()));
-    bd.emplace_back(reinterpret_cast<char*>(result.mv_data), result.mv_size);
+    bd.emplace_back(reinterpret_cast<const char*>(result.mv_data), result.mv_size);
   }
 
   return true;
@@ -3499,6 +3894,54 @@ bool BlockchainLMDB::has_key_image(const crypto::key_image& img) const
   return ret;
 }
 
+void BlockchainLMDB::has_key_images(epee::span<const crypto::key_image> imgs, std::vector<bool>& spent) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  spent.assign(imgs.size(), false);
+  if (imgs.empty())
+    return;
+
+  TXN_PREFIX_RDONLY();
+  RCURSOR(spent_keys);
+
+  // Visit the images in the table's own (compare_hash32) order so that each lookup carries on
+  // from where the previous one left the cursor rather than descending from the root again.
+  std::vector<size_t> order(imgs.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&imgs](size_t a, size_t b) {
+    MDB_val va{sizeof(crypto::key_image), (void *)&imgs[a]}, vb{sizeof(crypto::key_image), (void *)&imgs[b]};
+    return compare_hash32(&va, &vb) < 0;
+  });
+
+  // `next` is the smallest stored key image >= the previous image we looked up; any image sorting
+  // before it can't be in the table, so only images past it need another seek.
+  MDB_val next{0, nullptr};
+  for (size_t i : order)
+  {
+    MDB_val k{sizeof(crypto::key_image), (void *)&imgs[i]};
+    if (next.mv_data)
+    {
+      int cmp = compare_hash32(&k, &next);
+      if (cmp <= 0)
+      {
+        spent[i] = cmp == 0;
+        continue;
+      }
+    }
+
+    MDB_val v = k;
+    int result = mdb_cursor_get(m_cur_spent_keys, (MDB_val *)&zerokval, &v, MDB_GET_BOTH_RANGE);
+    if (result == MDB_NOTFOUND)
+      break; // everything remaining sorts after the last stored key image
+    if (result)
+      throw0(DB_ERROR(lmdb_error("Failed to look up spent key images: ", result).c_str()));
+    next = v;
+    spent[i] = compare_hash32(&k, &next) == 0;
+  }
+}
+
 bool BlockchainLMDB::for_all_key_images(std::function<bool(const crypto::key_image&)> f) const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
@@ -3773,6 +4216,7 @@ void BlockchainLMDB::batch_commit()
   m_write_txn->commit();
   TIME_MEASURE_FINISH(time1);
   time_commit1 += time1;
+  invalidate_read_snapshots();
   LOG_PRINT_L3("batch transaction: committed");
 
   m_write_txn = nullptr;
@@ -3811,6 +4255,7 @@ void BlockchainLMDB::batch_stop()
     TIME_MEASURE_FINISH(time1);
     time_commit1 += time1;
     cleanup_batch();
+    invalidate_read_snapshots();
   }
   catch (const std::exception &e)
   {
@@ -3867,23 +4312,53 @@ bool BlockchainLMDB::block_rtxn_start(MDB_txn **mtxn, mdb_txn_cursors **mcur) co
   /* Check for existing info and force reset if env doesn't match -
    * only happens if env was opened/closed multiple times in same process
    */
-  if (!(tinfo = m_tinfo.get()) || mdb_txn_env(tinfo->m_ti_rtxn) != m_env)
+  if ((tinfo = m_tinfo.get()) && mdb_txn_env(tinfo->m_ti_rtxn) != m_env)
   {
-    tinfo = new mdb_threadinfo;
-    m_tinfo.reset(tinfo);
-    memset(&tinfo->m_ti_rcursors, 0, sizeof(tinfo->m_ti_rcursors));
-    memset(&tinfo->m_ti_rflags, 0, sizeof(tinfo->m_ti_rflags));
-    if (auto mdb_res = lmdb_txn_begin(m_env, NULL, MDB_RDONLY, &tinfo->m_ti_rtxn))
-      throw0(DB_ERROR_TXN_START(lmdb_error("Failed to create a read transaction for the db: ", mdb_res).c_str()));
-    ret = true;
-  } else if (!tinfo->m_ti_rflags.m_rf_txn)
+    m_tinfo.reset();
+    tinfo = nullptr;
+  }
+  if (!tinfo || !tinfo->m_ti_rflags.m_rf_txn)
   {
-    if (auto mdb_res = lmdb_txn_renew(tinfo->m_ti_rtxn))
-      throw0(DB_ERROR_TXN_START(lmdb_error("Failed to renew a read transaction for the db: ", mdb_res).c_str()));
+    std::unique_lock lock{m_rtxn_pool_mutex};
+    const uint64_t generation = m_rtxn_generation;
+    if (!m_rtxn_live.empty())
+    {
+      // Nothing has been written since this snapshot was opened, so we can take it over (along
+      // with its cursors) without having to renew anything.
+      std::unique_ptr<mdb_threadinfo> reset_tinfo{m_tinfo.release()};
+      m_tinfo.reset(m_rtxn_live.back().release());
+      m_rtxn_live.pop_back();
+      if (reset_tinfo && m_rtxn_idle.size() < RTXN_POOL_MAX)
+        m_rtxn_idle.push_back(std::move(reset_tinfo));
+      tinfo = m_tinfo.get();
+    }
+    else
+    {
+      if (!tinfo && !m_rtxn_idle.empty())
+      {
+        m_tinfo.reset(m_rtxn_idle.back().release());
+        m_rtxn_idle.pop_back();
+        tinfo = m_tinfo.get();
+      }
+      lock.unlock();
+
+      if (!tinfo)
+      {
+        tinfo = new mdb_threadinfo;
+        m_tinfo.reset(tinfo);
+        memset(&tinfo->m_ti_rcursors, 0, sizeof(tinfo->m_ti_rcursors));
+        memset(&tinfo->m_ti_rflags, 0, sizeof(tinfo->m_ti_rflags));
+        tinfo->m_ti_db = this;
+        if (auto mdb_res = lmdb_txn_begin(m_env, NULL, MDB_RDONLY, &tinfo->m_ti_rtxn))
+          throw0(DB_ERROR_TXN_START(lmdb_error("Failed to create a read transaction for the db: ", mdb_res).c_str()));
+      }
+      else if (auto mdb_res = lmdb_txn_renew(tinfo->m_ti_rtxn))
+        throw0(DB_ERROR_TXN_START(lmdb_error("Failed to renew a read transaction for the db: ", mdb_res).c_str()));
+      tinfo->m_ti_generation = generation;
+      tinfo->m_ti_rflags.m_rf_txn = true;
+    }
     ret = true;
   }
-  if (ret)
-    tinfo->m_ti_rflags.m_rf_txn = true;
   *mtxn = tinfo->m_ti_rtxn;
   *mcur = &tinfo->m_ti_rcursors;
 
@@ -3895,8 +4370,34 @@ bool BlockchainLMDB::block_rtxn_start(MDB_txn **mtxn, mdb_txn_cursors **mcur) co
 void BlockchainLMDB::block_rtxn_stop() const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
-  mdb_txn_reset(m_tinfo->m_ti_rtxn);
-  memset(&m_tinfo->m_ti_rflags, 0, sizeof(m_tinfo->m_ti_rflags));
+  mdb_threadinfo *tinfo = m_tinfo.get();
+  if (!tinfo || !tinfo->m_ti_rflags.m_rf_txn)
+    return;
+  {
+    std::lock_guard lock{m_rtxn_pool_mutex};
+    if (tinfo->m_ti_generation == m_rtxn_generation && m_rtxn_live.size() < RTXN_POOL_MAX)
+    {
+      // Still a view of the current chain state: leave it open for the next reader
+      m_rtxn_live.emplace_back(m_tinfo.release());
+      return;
+    }
+  }
+  mdb_txn_reset(tinfo->m_ti_rtxn);
+  memset(&tinfo->m_ti_rflags, 0, sizeof(tinfo->m_ti_rflags));
+}
+
+void BlockchainLMDB::invalidate_read_snapshots() const
+{
+  std::lock_guard lock{m_rtxn_pool_mutex};
+  ++m_rtxn_generation;
+  for (auto& tinfo : m_rtxn_live)
+  {
+    mdb_txn_reset(tinfo->m_ti_rtxn);
+    memset(&tinfo->m_ti_rflags, 0, sizeof(tinfo->m_ti_rflags));
+    if (m_rtxn_idle.size() < RTXN_POOL_MAX)
+      m_rtxn_idle.push_back(std::move(tinfo));
+  }
+  m_rtxn_live.clear();
 }
 
 bool BlockchainLMDB::block_rtxn_start() const
@@ -3957,6 +4458,7 @@ void BlockchainLMDB::block_wtxn_stop()
       delete m_write_txn;
       m_write_txn = nullptr;
       memset(&m_wcursors, 0, sizeof(m_wcursors));
+      invalidate_read_snapshots();
 	}
   }
 }
@@ -3980,8 +4482,11 @@ void BlockchainLMDB::block_wtxn_abort()
 void BlockchainLMDB::block_rtxn_abort() const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
-  mdb_txn_reset(m_tinfo->m_ti_rtxn);
-  memset(&m_tinfo->m_ti_rflags, 0, sizeof(m_tinfo->m_ti_rflags));
+  mdb_threadinfo *tinfo = m_tinfo.get();
+  if (!tinfo || !tinfo->m_ti_rflags.m_rf_txn)
+    return;
+  mdb_txn_reset(tinfo->m_ti_rtxn);
+  memset(&tinfo->m_ti_rflags, 0, sizeof(tinfo->m_ti_rflags));
 }
 
 uint64_t BlockchainLMDB::add_block(const std::pair<block, blobdata>& blk, size_t block_weight, uint64_t long_term_block_weight, const difficulty_type& cumulative_difficulty, const uint64_t& coins_generated,
@@ -4010,6 +4515,25 @@ uint64_t BlockchainLMDB::add_block(const std::pair<block, blobdata>& blk, size_t
     throw;
   }
 
+  // Still in the block's write txn: add the block's amounts to the totals of its parent
+  block_coinbase_sums sums{};
+  MDB_val_set(key, m_height);
+  MDB_val val;
+  if (m_height > 0)
+  {
+    uint64_t parent_height = m_height - 1;
+    MDB_val_set(parent_key, parent_height);
+    if (int result = mdb_get(*m_write_txn, m_block_coinbase_sums, &parent_key, &val))
+      throw0(DB_ERROR(lmdb_error("Failed to get parent block coinbase sums: ", result).c_str()));
+    std::memcpy(&sums, val.mv_data, sizeof(sums));
+  }
+  add_miner_tx_amounts(sums, blk.first.miner_tx);
+  for (const auto &tx : txs)
+    add_tx_amounts(sums, tx.first, blk.first.major_version);
+  val = {sizeof(sums), &sums};
+  if (int result = mdb_put(*m_write_txn, m_block_coinbase_sums, &key, &val, MDB_APPEND))
+    throw0(DB_ERROR(lmdb_error("Failed to add block coinbase sums to db transaction: ", result).c_str()));
+
   return ++m_height;
 }
 
@@ -4295,45 +4819,104 @@ void BlockchainLMDB::get_output_key(const epee::span<const uint64_t> &amounts, c
   TIME_MEASURE_START(db3);
   check_open();
   outputs.clear();
-  outputs.reserve(offsets.size());
+
+  // Visit the requested (amount, amount index) pairs in key order rather than request order so
+  // that we can walk the cursor forward from one output to the next instead of doing a full
+  // B-tree descent for each one.  Ring members are heavily clustered around recent outputs, so
+  // neighbouring lookups are usually on the same (or an adjacent) page.
+  auto amount_at = [&](size_t i) { return amounts.size() == 1 ? amounts[0] : amounts[i]; };
+  std::vector<size_t> order(offsets.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return std::make_pair(amount_at(a), offsets[a]) < std::make_pair(amount_at(b), offsets[b]);
+  });
+
+  std::vector<output_data_t> results(offsets.size());
+  std::vector<bool> found(offsets.size(), false);
 
   TXN_PREFIX_RDONLY();
 
   RCURSOR(output_amounts);
 
-  for (size_t i = 0; i < offsets.size(); ++i)
+  // Within the same amount the duplicate values are sorted by amount index (and amount indices
+  // are dense), so a short forward gap is cheaper to cover by stepping with MDB_NEXT_DUP than by
+  // seeking.
+  constexpr uint64_t MAX_CURSOR_STEP = 16;
+
+  bool positioned = false;
+  uint64_t cur_amount = 0, cur_index = 0;
+  MDB_val v;
+  for (size_t i : order)
   {
-    const uint64_t amount = amounts.size() == 1 ? amounts[0] : amounts[i];
-    MDB_val_set(k, amount);
-    MDB_val_set(v, offsets[i]);
+    const uint64_t amount = amount_at(i);
+    const uint64_t index = offsets[i];
 
-    auto get_result = mdb_cursor_get(m_cur_output_amounts, &k, &v, MDB_GET_BOTH);
-    if (get_result == MDB_NOTFOUND)
+    int get_result = 0;
+    if (positioned && amount == cur_amount && index >= cur_index && index - cur_index <= MAX_CURSOR_STEP)
     {
-      if (allow_partial)
+      MDB_val k;
+      while (cur_index < index && get_result == 0)
       {
-        MDEBUG("Partial result: " << outputs.size() << "/" << offsets.size());
-        break;
+        get_result = mdb_cursor_get(m_cur_output_amounts, &k, &v, MDB_NEXT_DUP);
+        ++cur_index;
       }
-      throw1(OUTPUT_DNE((std::string("Attempting to get output pubkey by global index (amount ") + std::to_string(amount) + ", index " + std::to_string(offsets[i]) + ", count " + std::to_string(get_num_outputs(amount)) + "), but key does not exist (current height " + std::to_string(height()) + ")").c_str()));
+      // Should never happen since amount indices are contiguous, but if it does fall back to a
+      // full lookup rather than returning the wrong output.
+      if (get_result == 0 && ((const outkey *)v.mv_data)->amount_index != index)
+        get_result = MDB_NOTFOUND;
+      if (get_result == MDB_NOTFOUND)
+        positioned = false;
+    }
+    else
+      positioned = false;
+
+    if (!positioned)
+    {
+      MDB_val_set(k, amount);
+      MDB_val_set(vi, index);
+      get_result = mdb_cursor_get(m_cur_output_amounts, &k, &vi, MDB_GET_BOTH);
+      v = vi;
+    }
+
+    if (get_result == MDB_NOTFOUND)
+    {
+      positioned = false;
+      if (allow_partial)
+        continue;
+      throw1(OUTPUT_DNE((std::string("Attempting to get output pubkey by global index (amount ") + std::to_string(amount) + ", index " + std::to_string(index) + ", count " + std::to_string(get_num_outputs(amount)) + "), but key does not exist (current height " + std::to_string(height()) + ")").c_str()));
     }
     else if (get_result)
       throw0(DB_ERROR(lmdb_error("Error attempting to retrieve an output pubkey from the db", get_result).c_str()));
 
+    positioned = true;
+    cur_amount = amount;
+    cur_index = index;
+
+    output_data_t &data = results[i];
     if (amount == 0)
     {
       const outkey *okp = (const outkey *)v.mv_data;
-      outputs.push_back(okp->data);
+      data = okp->data;
     }
     else
     {
       const pre_rct_outkey *okp = (const pre_rct_outkey *)v.mv_data;
-      outputs.resize(outputs.size() + 1);
-      output_data_t &data = outputs.back();
       memcpy(&data, &okp->data, sizeof(pre_rct_output_data_t));
       data.commitment = rct::zeroCommit(amount);
     }
+    found[i] = true;
+  }
+
+  // A partial result is the request-order prefix up to the first missing output
+  size_t count = offsets.size();
+  if (allow_partial)
+  {
+    count = std::find(found.begin(), found.end(), false) - found.begin();
+    if (count < offsets.size())
+      MDEBUG("Partial result: " << count << "/" << offsets.size());
   }
+  results.resize(count);
+  outputs = std::move(results);
 
   TIME_MEASURE_FINISH(db3);
   LOG_PRINT_L3("db3: " << db3);
@@ -4375,6 +4958,27 @@ void BlockchainLMDB::get_output_tx_and_index(const uint64_t& amount, const std::
   LOG_PRINT_L3("db3: " << db3);
 }
 
+// The number of the first `count` outputs of `amount` that were created in blocks below `height`.
+// Output heights never decrease with their amount index, so this is a binary search over it.
+static uint64_t num_outputs_below_height(MDB_cursor *cur_output_amounts, uint64_t amount, uint64_t count, uint64_t height)
+{
+  uint64_t lo = 0, hi = count;
+  while (lo < hi)
+  {
+    uint64_t mid = lo + (hi - lo) / 2;
+    MDB_val_set(k, amount);
+    MDB_val_set(v, mid);
+    if (int ret = mdb_cursor_get(cur_output_amounts, &k, &v, MDB_GET_BOTH))
+      throw0(DB_ERROR(lmdb_error("Failed to get output " + std::to_string(mid) + " of amount " + std::to_string(amount) + ": ", ret).c_str()));
+    // outkey and pre_rct_outkey agree up to the height
+    if (((const pre_rct_outkey *)v.mv_data)->data.height < height)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
 std::map<uint64_t, std::tuple<uint64_t, uint64_t, uint64_t>> BlockchainLMDB::get_output_histogram(const std::vector<uint64_t> &amounts, bool unlocked, uint64_t recent_cutoff, uint64_t min_count) const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
@@ -4431,35 +5035,35 @@ std::map<uint64_t, std::tuple<uint64_t, uint64_t, uint64_t>> BlockchainLMDB::get
   }
 
   if (unlocked || recent_cutoff > 0) {
+    RCURSOR(block_info);
     const uint64_t blockchain_height = height();
-    for (std::map<uint64_t, std::tuple<uint64_t, uint64_t, uint64_t>>::iterator i = histogram.begin(); i != histogram.end(); ++i) {
-      uint64_t amount = i->first;
-      uint64_t num_elems = std::get<0>(i->second);
-      while (num_elems > 0) {
-        const tx_out_index toi = get_output_tx_and_index(amount, num_elems - 1);
-        const uint64_t height = get_tx_block_height(toi.first);
-        if (height + CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE <= blockchain_height)
+    // Outputs unlock once their block is CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE deep
+    const uint64_t unlocked_below = blockchain_height + 1 - std::min<uint64_t>(blockchain_height + 1, CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE);
+
+    // Recent outputs are the unlocked ones above the newest block older than the cutoff
+    uint64_t recent_from = unlocked_below;
+    if (recent_cutoff > 0 && unlocked_below > 0)
+    {
+      uint64_t h = unlocked_below - 1;
+      MDB_val_set(v, h);
+      int ret = mdb_cursor_get(m_cur_block_info, (MDB_val *)&zerokval, &v, MDB_GET_BOTH);
+      for (; ret == 0; ret = mdb_cursor_get(m_cur_block_info, (MDB_val *)&zerokval, &v, MDB_PREV_DUP))
+      {
+        const mdb_block_info *bi = (const mdb_block_info *)v.mv_data;
+        if (bi->bi_timestamp < recent_cutoff)
           break;
-        --num_elems;
+        recent_from = bi->bi_height;
       }
-      // modifying second does not invalidate the iterator
-      std::get<1>(i->second) = num_elems;
+      if (ret && ret != MDB_NOTFOUND)
+        throw0(DB_ERROR(lmdb_error("Failed to enumerate block info: ", ret).c_str()));
+    }
 
+    for (auto &[amount, counts] : histogram)
+    {
+      const uint64_t num_unlocked = num_outputs_below_height(m_cur_output_amounts, amount, std::get<0>(counts), unlocked_below);
+      std::get<1>(counts) = num_unlocked;
       if (recent_cutoff > 0)
-      {
-        uint64_t recent = 0;
-        while (num_elems > 0) {
-          const tx_out_index toi = get_output_tx_and_index(amount, num_elems - 1);
-          const uint64_t height = get_tx_block_height(toi.first);
-          const uint64_t ts = get_block_timestamp(height);
-          if (ts < recent_cutoff)
-            break;
-          --num_elems;
-          ++recent;
-        }
-        // modifying second does not invalidate the iterator
-        std::get<2>(i->second) = recent;
-      }
+        std::get<2>(counts) = num_unlocked - num_outputs_below_height(m_cur_output_amounts, amount, num_unlocked, recent_from);
     }
   }
 
@@ -4511,7 +5115,7 @@ bool BlockchainLMDB::get_output_distribution(uint64_t amount, uint64_t from_heig
   return true;
 }
 
-void BlockchainLMDB::get_output_blacklist(std::vector<uint64_t> &blacklist) const
+void BlockchainLMDB::get_output_blacklist(std::vector<uint64_t> &blacklist, uint64_t from) const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
   check_open();
@@ -4519,15 +5123,18 @@ void BlockchainLMDB::get_output_blacklist(std::vector<uint64_t> &blacklist) cons
   TXN_PREFIX_RDONLY();
   RCURSOR(output_blacklist);
 
-  MDB_stat db_stat;
-  if (int result = mdb_stat(m_txn, m_output_blacklist, &db_stat))
-    throw0(DB_ERROR(lmdb_error("Failed to query output blacklist stats: ", result).c_str()));
+  if (from == 0)
+  {
+    MDB_stat db_stat;
+    if (int result = mdb_stat(m_txn, m_output_blacklist, &db_stat))
+      throw0(DB_ERROR(lmdb_error("Failed to query output blacklist stats: ", result).c_str()));
+    blacklist.reserve(blacklist.size() + db_stat.ms_entries);
+  }
 
   MDB_val key = zerokval;
-  MDB_val val;
-  blacklist.reserve(db_stat.ms_entries);
+  MDB_val val = {sizeof(from), &from};
 
-  if (int ret = mdb_cursor_get(m_cur_output_blacklist, &key, &val, MDB_FIRST))
+  if (int ret = mdb_cursor_get(m_cur_output_blacklist, &key, &val, MDB_GET_BOTH_RANGE))
   {
     if (ret != MDB_NOTFOUND)
     {
@@ -4673,6 +5280,121 @@ uint64_t BlockchainLMDB::get_alt_block_count()
   return count;
 }
 
+bool BlockchainLMDB::get_block_pow_hash(const crypto::hash &blkid, crypto::hash &pow_hash) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+  if (!m_block_pow_hashes)
+    return false;
+
+  TXN_PREFIX_RDONLY();
+  RCURSOR(block_pow_hashes);
+
+  MDB_val_set(k, blkid);
+  MDB_val v;
+  int result = mdb_cursor_get(m_cur_block_pow_hashes, &k, &v, MDB_SET);
+  if (result == MDB_NOTFOUND)
+    return false;
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Error attempting to retrieve PoW hash of block " + tools::type_to_hex(blkid) + " from the db: ", result).c_str()));
+  if (v.mv_size != sizeof(pow_hash))
+    throw0(DB_ERROR("Unexpected PoW hash record size"));
+  std::memcpy(&pow_hash, v.mv_data, sizeof(pow_hash));
+  return true;
+}
+
+void BlockchainLMDB::add_block_pow_hash(const crypto::hash &blkid, const crypto::hash &pow_hash)
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  TXN_BLOCK_PREFIX(0);
+  MDB_val k{sizeof(blkid), (void *)&blkid}, v{sizeof(pow_hash), (void *)&pow_hash};
+  if (auto result = mdb_put(*txn_ptr, m_block_pow_hashes, &k, &v, 0))
+    throw0(DB_ERROR(lmdb_error("Failed to add block PoW hash to db transaction: ", result).c_str()));
+
+  TXN_BLOCK_POSTFIX_SUCCESS();
+}
+
+std::vector<block_header_info> BlockchainLMDB::get_block_headers(uint64_t start_height, uint64_t count) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+  std::vector<block_header_info> headers;
+  if (!m_block_headers || !count)
+    return headers;
+
+  TXN_PREFIX_RDONLY();
+  RCURSOR(block_headers);
+  RCURSOR(block_info);
+
+  MDB_val_set(k, start_height);
+  MDB_val v;
+  int result = mdb_cursor_get(m_cur_block_headers, &k, &v, MDB_SET);
+  MDB_val_set(bi_v, start_height);
+  int bi_result = result ? result : mdb_cursor_get(m_cur_block_info, (MDB_val *)&zerokval, &bi_v, MDB_GET_BOTH);
+  headers.reserve(count);
+  for (uint64_t height = start_height; headers.size() < count; ++height)
+  {
+    if (result == MDB_NOTFOUND || bi_result == MDB_NOTFOUND)
+      break;
+    if (result || bi_result)
+      throw0(DB_ERROR(lmdb_error("Failed to get block header at height " + std::to_string(height) + ": ", result ? result : bi_result).c_str()));
+    if (*(const uint64_t *)k.mv_data != height || v.mv_size != sizeof(mdb_block_header))
+      break;
+
+    mdb_block_header hdr;
+    std::memcpy(&hdr, v.mv_data, sizeof(hdr));
+    const mdb_block_info *bi = (const mdb_block_info *)bi_v.mv_data;
+    if (bi->bi_height != height || hdr.hash != bi->bi_hash)
+      break;
+
+    auto &h = headers.emplace_back();
+    h.height = height;
+    h.hash = hdr.hash;
+    h.major_version = hdr.major_version;
+    h.minor_version = hdr.minor_version;
+    h.nonce = hdr.nonce;
+    h.timestamp = hdr.timestamp;
+    h.prev_id = hdr.prev_id;
+    h.miner_tx_hash = hdr.miner_tx_hash;
+    h.service_node_winner = hdr.service_node_winner;
+    h.reward = hdr.reward;
+    h.miner_reward = hdr.miner_reward;
+    h.num_txes = hdr.num_txes;
+    h.weight = bi->bi_weight;
+    h.long_term_weight = bi->bi_long_term_block_weight;
+    h.cumulative_difficulty = bi->bi_diff;
+
+    result = mdb_cursor_get(m_cur_block_headers, &k, &v, MDB_NEXT);
+    bi_result = mdb_cursor_get(m_cur_block_info, (MDB_val *)&zerokval, &bi_v, MDB_NEXT_DUP);
+  }
+  return headers;
+}
+
+bool BlockchainLMDB::get_coinbase_sums(uint64_t height, block_coinbase_sums &sums) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+  if (!m_block_coinbase_sums)
+    return false;
+
+  TXN_PREFIX_RDONLY();
+  RCURSOR(block_coinbase_sums);
+
+  MDB_val_set(k, height);
+  MDB_val v;
+  int result = mdb_cursor_get(m_cur_block_coinbase_sums, &k, &v, MDB_SET);
+  if (result == MDB_NOTFOUND)
+    return false;
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to get block coinbase sums: ", result).c_str()));
+  if (v.mv_size != sizeof(sums))
+    throw0(DB_ERROR("Unexpected block coinbase sums record size"));
+  std::memcpy(&sums, v.mv_data, sizeof(sums));
+  return true;
+}
+
 void BlockchainLMDB::drop_alt_blocks()
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
@@ -4705,6 +5427,34 @@ uint64_t BlockchainLMDB::get_database_size() const
   return fs::file_size(m_folder / CRYPTONOTE_BLOCKCHAINDATA_FILENAME);
 }
 
+uint64_t BlockchainLMDB::get_resident_size() const
+{
+#ifdef __linux__
+  auto [addr, len] = find_data_file_mapping(m_folder / CRYPTONOTE_BLOCKCHAINDATA_FILENAME);
+  if (!addr)
+    return 0;
+  std::error_code ec;
+  len = std::min<size_t>(len, fs::file_size(m_folder / CRYPTONOTE_BLOCKCHAINDATA_FILENAME, ec));
+
+  // mincore wants a byte per page, so walk the map in chunks
+  const size_t page = sysconf(_SC_PAGESIZE);
+  std::vector<unsigned char> pages(16384);
+  uint64_t resident = 0;
+  for (size_t done = 0; done < len; done += pages.size() * page)
+  {
+    const size_t n = std::min(len - done, pages.size() * page);
+    // Fails if the map is being resized under us; try again next time
+    if (mincore(static_cast<char*>(addr) + done, n, pages.data()))
+      return 0;
+    for (size_t i = 0; i < (n + page - 1) / page; i++)
+      resident += pages[i] & 1;
+  }
+  return resident * page;
+#else
+  return 0;
+#endif
+}
+
 void BlockchainLMDB::fixup(cryptonote::network_type nettype)
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
@@ -6110,6 +6860,75 @@ void BlockchainLMDB::migrate_6_7()
     throw0(DB_ERROR(lmdb_error("Failed to update version for the db: ", result).c_str()));
 }
 
+void BlockchainLMDB::migrate_7_8()
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  MGINFO_YELLOW("Migrating blockchain from DB version 7 to 8 - this may take a while:");
+  MINFO("totalling block coinbase amounts...");
+
+  mdb_txn_safe txn(false);
+  if (auto result = mdb_txn_begin(m_env, NULL, 0, txn))
+    throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+
+  MDB_stat db_stats;
+  if (auto result = mdb_stat(txn, m_blocks, &db_stats))
+    throw0(DB_ERROR(lmdb_error("Failed to query m_blocks: ", result).c_str()));
+  const uint64_t num_blocks = db_stats.ms_entries;
+
+  // Records from an earlier, interrupted run are simply overwritten
+  block_coinbase_sums sums{};
+  MDB_cursor *c_tx_indices;
+  for (uint64_t height = 0; height < num_blocks; height++)
+  {
+    if (!(height % 1000))
+    {
+      if (height)
+      {
+        LOGIF(el::Level::Info) {
+          std::cout << height << " / " << num_blocks << "  \r" << std::flush;
+        }
+        txn.commit();
+        if (auto result = mdb_txn_begin(m_env, NULL, 0, txn))
+          throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+      }
+      if (auto result = mdb_cursor_open(txn, m_tx_indices, &c_tx_indices))
+        throw0(DB_ERROR(lmdb_error("Failed to open a cursor for tx_indices: ", result).c_str()));
+    }
+
+    MDB_val_set(key, height);
+    MDB_val v;
+    if (auto result = mdb_get(txn, m_blocks, &key, &v))
+      throw0(DB_ERROR(lmdb_error("Failed to get block " + std::to_string(height) + ": ", result).c_str()));
+    block b;
+    if (!parse_and_validate_block_from_blob(std::string_view{static_cast<const char *>(v.mv_data), v.mv_size}, b))
+      throw0(DB_ERROR("Failed to parse block " + std::to_string(height) + " from blob retrieved from the db"));
+
+    add_miner_tx_amounts(sums, b.miner_tx);
+    for (const auto &tx_hash : b.tx_hashes)
+    {
+      // The pruned part holds everything the totals need: the extra and the rct fee
+      MDB_val_set(ti, tx_hash);
+      if (auto result = mdb_cursor_get(c_tx_indices, (MDB_val *)&zerokval, &ti, MDB_GET_BOTH))
+        throw0(DB_ERROR(lmdb_error("Failed to get tx index of " + tools::type_to_hex(tx_hash) + ": ", result).c_str()));
+      MDB_val_set(tx_id, static_cast<const txindex *>(ti.mv_data)->data.tx_id);
+      if (auto result = mdb_get(txn, m_txs_pruned, &tx_id, &v))
+        throw0(DB_ERROR(lmdb_error("Failed to get pruned tx " + tools::type_to_hex(tx_hash) + ": ", result).c_str()));
+      transaction tx;
+      if (!parse_and_validate_tx_base_from_blob(std::string_view{static_cast<const char *>(v.mv_data), v.mv_size}, tx))
+        throw0(DB_ERROR("Failed to parse tx " + tools::type_to_hex(tx_hash) + " from blob retrieved from the db"));
+      add_tx_amounts(sums, tx, b.major_version);
+    }
+
+    MDB_val_set(val, sums);
+    if (auto result = mdb_put(txn, m_block_coinbase_sums, &key, &val, 0))
+      throw0(DB_ERROR(lmdb_error("Failed to add block coinbase sums to db transaction: ", result).c_str()));
+  }
+  txn.commit();
+
+  if (int result = write_db_version(m_env, m_properties, (uint32_t)lmdb_version::v8))
+    throw0(DB_ERROR(lmdb_error("Failed to update version for the db: ", result).c_str()));
+}
+
 void BlockchainLMDB::migrate(const uint32_t oldversion, cryptonote::network_type nettype)
 {
   switch(oldversion) {
@@ -6127,6 +6946,8 @@ void BlockchainLMDB::migrate(const uint32_t oldversion, cryptonote::network_type
     migrate_5_6(); /* FALLTHRU */
   case 6:
     migrate_6_7(); /* FALLTHRU */
+  case 7:
+    migrate_7_8(); /* FALLTHRU */
   default:
     break;
   }
@@ -6151,7 +6972,7 @@ void BlockchainLMDB::set_service_node_data(const std::string& data, bool long_te
     throw0(DB_ERROR(lmdb_error("Failed to add service node data to db transaction: ", result).c_str()));
 }
 
-bool BlockchainLMDB::get_service_node_data(std::string& data, bool long_term) const
+bool BlockchainLMDB::get_service_node_data(std::string_view& data, bool long_term) const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
   check_open();
@@ -6177,7 +6998,7 @@ bool BlockchainLMDB::get_service_node_data(std::string& data, bool long_term) co
     }
   }
 
-  data.assign(reinterpret_cast<const char*>(v.mv_data), v.mv_size);
+  data = {reinterpret_cast<const char*>(v.mv_data), v.mv_size};
   return true;
 }
 
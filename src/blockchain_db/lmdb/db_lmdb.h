@@ -27,6 +27,9 @@
 #pragma once
 
 #include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #include "blockchain_db/blockchain_db.h"
 #include "cryptonote_basic/blobdatatype.h" // for type blobdata
@@ -73,6 +76,9 @@ struct mdb_txn_cursors
   MDB_cursor *txpool_blob;
 
   MDB_cursor *alt_blocks;
+  MDB_cursor *block_pow_hashes;
+  MDB_cursor *block_headers;
+  MDB_cursor *block_coinbase_sums;
 
   MDB_cursor *hf_versions;
 
@@ -103,17 +109,24 @@ struct mdb_rflags
   bool m_rf_txpool_meta;
   bool m_rf_txpool_blob;
   bool m_rf_alt_blocks;
+  bool m_rf_block_pow_hashes;
+  bool m_rf_block_headers;
+  bool m_rf_block_coinbase_sums;
   bool m_rf_hf_versions;
   bool m_rf_service_node_data;
   bool m_rf_service_node_proofs;
   bool m_rf_properties;
 };
 
+class BlockchainLMDB;
+
 struct mdb_threadinfo
 {
   MDB_txn *m_ti_rtxn;	// per-thread read txn
   mdb_txn_cursors m_ti_rcursors;	// per-thread read cursors
   mdb_rflags m_ti_rflags;	// per-thread read state
+  const BlockchainLMDB *m_ti_db; // owning db, used to release the txn back into the snapshot pool
+  uint64_t m_ti_generation; // snapshot generation this txn was started at
 
   ~mdb_threadinfo();
 };
@@ -186,6 +199,8 @@ public:
 
   void safesyncmode(const bool onoff) override;
 
+  void set_io_policy(io_policy policy) override;
+
   void reset() override;
 
   std::vector<fs::path> get_filenames() const override;
@@ -211,8 +226,10 @@ public:
   cryptonote::blobdata get_block_blob(const crypto::hash& h) const override;
 
   cryptonote::blobdata get_block_blob_from_height(uint64_t height) const override;
+  std::string_view get_block_blob_view_from_height(uint64_t height) const override;
 
   std::vector<uint64_t> get_block_cumulative_rct_outputs(const std::vector<uint64_t> &heights) const override;
+  std::vector<uint64_t> get_block_cumulative_rct_outputs_range(uint64_t start_height, uint64_t end_height) const override;
 
   uint64_t get_block_timestamp(const uint64_t& height) const override;
 
@@ -252,6 +269,7 @@ public:
   bool get_tx_blob(const crypto::hash& h, cryptonote::blobdata &tx) const override;
   bool get_pruned_tx_blob(const crypto::hash& h, cryptonote::blobdata &tx) const override;
   bool get_pruned_tx_blobs_from(const crypto::hash& h, size_t count, std::vector<cryptonote::blobdata> &bd) const override;
+  bool get_pruned_tx_blob_views_from(const crypto::hash& h, size_t count, std::vector<std::string_view> &bd) const override;
   bool get_prunable_tx_blob(const crypto::hash& h, cryptonote::blobdata &tx) const override;
   bool get_prunable_tx_hash(const crypto::hash& tx_hash, crypto::hash &prunable_hash) const override;
 
@@ -276,6 +294,7 @@ public:
   std::vector<std::vector<uint64_t>> get_tx_amount_output_indices(const uint64_t tx_id, size_t n_txes) const override;
 
   bool has_key_image(const crypto::key_image& img) const override;
+  void has_key_images(epee::span<const crypto::key_image> imgs, std::vector<bool>& spent) const override;
 
   void add_txpool_tx(const crypto::hash &txid, const cryptonote::blobdata &blob, const txpool_tx_meta_t& meta) override;
   void update_txpool_tx(const crypto::hash &txid, const txpool_tx_meta_t& meta) override;
@@ -287,6 +306,7 @@ public:
   cryptonote::blobdata get_txpool_tx_blob(const crypto::hash& txid) const override;
   uint32_t get_blockchain_pruning_seed() const override;
   bool prune_blockchain(uint32_t pruning_seed = 0) override;
+  bool prune_blockchain_step(uint32_t pruning_seed, size_t max_records) override;
   bool update_pruning() override;
   bool check_pruning() override;
 
@@ -296,6 +316,13 @@ public:
   uint64_t get_alt_block_count() override;
   void drop_alt_blocks() override;
 
+  bool get_block_pow_hash(const crypto::hash &blkid, crypto::hash &pow_hash) const override;
+  void add_block_pow_hash(const crypto::hash &blkid, const crypto::hash &pow_hash) override;
+
+  std::vector<block_header_info> get_block_headers(uint64_t start_height, uint64_t count) const override;
+
+  bool get_coinbase_sums(uint64_t height, block_coinbase_sums &sums) const override;
+
   bool for_all_txpool_txes(std::function<bool(const crypto::hash&, const txpool_tx_meta_t&, const cryptonote::blobdata*)> f, bool include_blob = false, bool include_unrelayed_txes = true) const override;
 
   bool for_all_key_images(std::function<bool(const crypto::key_image&)>) const override;
@@ -333,6 +360,14 @@ public:
 
   bool block_rtxn_start(MDB_txn **mtxn, mdb_txn_cursors **mcur) const;
 
+  /**
+   * @brief drops all pooled read snapshots
+   *
+   * Called after each write commit: pooled snapshots are reset and kept for renewal, and any
+   * snapshot currently in use by a reader is reset when it is released instead of being pooled.
+   */
+  void invalidate_read_snapshots() const;
+
   void pop_block(block& blk, std::vector<transaction>& txs) override;
 
   bool can_thread_bulk_indices() const override { return true; }
@@ -350,7 +385,7 @@ public:
   std::map<uint64_t, std::tuple<uint64_t, uint64_t, uint64_t>> get_output_histogram(const std::vector<uint64_t> &amounts, bool unlocked, uint64_t recent_cutoff, uint64_t min_count) const override;
 
   bool get_output_distribution(uint64_t amount, uint64_t from_height, uint64_t to_height, std::vector<uint64_t> &distribution, uint64_t &base) const override;
-  void get_output_blacklist(std::vector<uint64_t>       &blacklist) const override;
+  void get_output_blacklist(std::vector<uint64_t>       &blacklist, uint64_t from = 0) const override;
   void add_output_blacklist(std::vector<uint64_t> const &blacklist) override;
 
   // helper functions
@@ -361,6 +396,9 @@ public:
 private:
   void do_resize(uint64_t size_increase=0);
 
+  // madvise()s the map to suit m_io_policy; the caller must hold m_io_policy_mutex
+  void apply_io_policy();
+
   bool need_resize(uint64_t threshold_size=0) const;
   void check_and_resize_for_batch(uint64_t batch_num_blocks, uint64_t batch_bytes);
   uint64_t get_estimated_batch_size(uint64_t batch_num_blocks, uint64_t batch_bytes) const;
@@ -405,12 +443,17 @@ private:
 
   inline void check_open() const;
 
-  bool prune_worker(int mode, uint32_t pruning_seed);
+  // Returns false if it stopped after looking at max_records txs (0 for no limit) with more to do
+  bool prune_worker(int mode, uint32_t pruning_seed, size_t max_records = 0);
 
   bool is_read_only() const override;
 
   uint64_t get_database_size() const override;
 
+  uint64_t get_resident_size() const override;
+
+  resize_stats get_resize_stats() const override;
+
   std::vector<uint64_t> get_block_info_64bit_fields(uint64_t start_height, size_t count, uint64_t (*extract)(const mdb_block_info*)) const;
 
   uint64_t get_max_block_size() override;
@@ -429,12 +472,13 @@ private:
   void migrate_4_5(cryptonote::network_type nettype);
   void migrate_5_6();
   void migrate_6_7();
+  void migrate_7_8();
 
   void cleanup_batch();
 
   bool get_block_checkpoint_internal(uint64_t height, checkpoint_t &checkpoint, MDB_cursor_op op) const;
   void set_service_node_data(const std::string& data, bool long_term) override;
-  bool get_service_node_data(std::string& data, bool long_term) const override;
+  bool get_service_node_data(std::string_view& data, bool long_term) const override;
   void clear_service_node_data() override;
 
   bool get_service_node_proof(const crypto::public_key& pubkey, service_nodes::proof_info& proof) const override;
@@ -474,6 +518,9 @@ private:
   MDB_dbi m_txpool_blob;
 
   MDB_dbi m_alt_blocks;
+  MDB_dbi m_block_pow_hashes;
+  MDB_dbi m_block_headers;
+  MDB_dbi m_block_coinbase_sums;
 
   MDB_dbi m_hf_starting_heights;
   MDB_dbi m_hf_versions;
@@ -496,6 +543,17 @@ private:
   mdb_txn_cursors m_wcursors;
   mutable boost::thread_specific_ptr<mdb_threadinfo> m_tinfo;
 
+  // Read snapshots shared between reader threads (requires MDB_NOTLS).  When a reader finishes
+  // with its read txn and no write has been committed since it started, the still-open txn (and
+  // its cursors) goes into m_rtxn_live for the next reader on any thread to pick up without a
+  // renew; a write commit bumps m_rtxn_generation and moves everything to m_rtxn_idle, where txns
+  // wait (reset) to be renewed.
+  mutable std::mutex m_rtxn_pool_mutex;
+  mutable std::vector<std::unique_ptr<mdb_threadinfo>> m_rtxn_live;
+  mutable std::vector<std::unique_ptr<mdb_threadinfo>> m_rtxn_idle;
+  mutable uint64_t m_rtxn_generation = 0;
+  constexpr static size_t RTXN_POOL_MAX = 16;
+
 #if defined(__arm__)
   // force a value so it can compile with 32-bit ARM
   constexpr static uint64_t DEFAULT_MAPSIZE = 1LL << 31;
@@ -511,6 +569,20 @@ private:
   std::mutex m_synchronization_lock;
 
   constexpr static float RESIZE_PERCENT = 0.9f;
+  // Each resize grows the map by 1/RESIZE_GROWTH_DIVISOR of its current size, but at least
+  // MIN_RESIZE_INCREMENT.
+  constexpr static uint64_t RESIZE_GROWTH_DIVISOR = 4;
+  constexpr static uint64_t MIN_RESIZE_INCREMENT = 1LL << 30;
+
+  std::atomic<uint64_t> m_resize_count{0};
+  std::atomic<uint64_t> m_resize_total_ms{0};
+  std::atomic<uint64_t> m_resize_last_ms{0};
+
+  // Guards the map against a resize while it's being advised
+  std::mutex m_io_policy_mutex;
+  // What the map is advised for; mdb_env_open (and each remap) leaves it MADV_RANDOM, which suits
+  // syncing
+  io_policy m_io_policy = io_policy::syncing;
 };
 
 }  // namespace cryptonote
@@ -32,25 +32,26 @@
 
 namespace cryptonote
 {
-    // This class is meant to create a batch when none currently exists.
-    // If a batch exists, it can't be from another thread, since we can
-    // only be called with the txpool lock taken, and it is held during
-    // the whole prepare/handle/cleanup incoming block sequence.
+    // This class is meant to start a txpool transaction when none currently exists, so that the
+    // txpool changes made while it is alive are undone unless it is committed.  Txpool changes only
+    // touch Blockchain's in-memory txpool store (the db copy is written by Blockchain::flush_txpool),
+    // so this doesn't need a db write batch.  If a txpool transaction exists, it can't be from
+    // another thread, since we can only be called with the txpool lock taken.
     class LockedTXN {
     public:
-      LockedTXN(Blockchain &b): m_db{b.get_db()} {
-        m_batch = m_db.batch_start();
+      LockedTXN(Blockchain &b): m_blockchain{b} {
+        m_batch = m_blockchain.txpool_txn_start();
       }
       LockedTXN(const LockedTXN &) = delete;
       LockedTXN &operator=(const LockedTXN &) = delete;
-      LockedTXN(LockedTXN &&o) : m_db{o.m_db}, m_batch{o.m_batch} { o.m_batch = false; }
+      LockedTXN(LockedTXN &&o) : m_blockchain{o.m_blockchain}, m_batch{o.m_batch} { o.m_batch = false; }
       LockedTXN &operator=(LockedTXN &&) = delete;
 
-      void commit() { try { if (m_batch) { m_db.batch_stop(); m_batch = false; } } catch (const std::exception &e) { MWARNING("LockedTXN::commit filtering exception: " << e.what()); } }
-      void abort() { try { if (m_batch) { m_db.batch_abort(); m_batch = false; } } catch (const std::exception &e) { MWARNING("LockedTXN::abort filtering exception: " << e.what()); } }
+      void commit() { if (m_batch) { m_blockchain.txpool_txn_stop(); m_batch = false; } }
+      void abort() { try { if (m_batch) { m_blockchain.txpool_txn_abort(); m_batch = false; } } catch (const std::exception &e) { MWARNING("LockedTXN::abort filtering exception: " << e.what()); } }
       ~LockedTXN() { this->abort(); }
     private:
-      BlockchainDB &m_db;
+      Blockchain &m_blockchain;
       bool m_batch;
     };
 }
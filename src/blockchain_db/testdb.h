@@ -67,11 +67,13 @@ public:
 
   virtual bool block_exists(const crypto::hash& h, uint64_t *height) const override { return false; }
   virtual cryptonote::blobdata get_block_blob_from_height(uint64_t height) const override { return cryptonote::t_serializable_object_to_blob(get_block_from_height(height)); }
+  virtual std::string_view get_block_blob_view_from_height(uint64_t height) const override { return {}; }
   virtual cryptonote::blobdata get_block_blob(const crypto::hash& h) const override { return cryptonote::blobdata(); }
   virtual cryptonote::block_header get_block_header_from_height(uint64_t height) const override { return get_block_from_height(height); }
   virtual bool get_tx_blob(const crypto::hash& h, cryptonote::blobdata &tx) const override { return false; }
   virtual bool get_pruned_tx_blob(const crypto::hash& h, cryptonote::blobdata &tx) const override { return false; }
   virtual bool get_pruned_tx_blobs_from(const crypto::hash& h, size_t count, std::vector<cryptonote::blobdata> &bd) const override { return false; }
+  virtual bool get_pruned_tx_blob_views_from(const crypto::hash& h, size_t count, std::vector<std::string_view> &bd) const override { return false; }
   virtual bool get_prunable_tx_blob(const crypto::hash& h, cryptonote::blobdata &tx) const override { return false; }
   virtual bool get_prunable_tx_hash(const crypto::hash& tx_hash, crypto::hash &prunable_hash) const override { return false; }
   virtual uint64_t get_block_height(const crypto::hash& h) const override { return 0; }
@@ -149,6 +151,7 @@ public:
 
   virtual uint32_t get_blockchain_pruning_seed() const override { return 0; }
   virtual bool prune_blockchain(uint32_t pruning_seed = 0) override { return true; }
+  virtual bool prune_blockchain_step(uint32_t pruning_seed, size_t max_records) override { return true; }
   virtual bool update_pruning() override { return true; }
   virtual bool check_pruning() override { return true; }
   virtual void prune_outputs(uint64_t amount) override {}
@@ -162,10 +165,10 @@ public:
   virtual void remove_block_checkpoint(uint64_t height) override { }
   std::vector<cryptonote::checkpoint_t> get_checkpoints_range(uint64_t start, uint64_t end, size_t num_desired_checkpoints = BlockchainDB::GET_ALL_CHECKPOINTS) const override { return {}; }
 
-  virtual void get_output_blacklist   (std::vector<uint64_t> &blacklist)       const override { }
+  virtual void get_output_blacklist   (std::vector<uint64_t> &blacklist, uint64_t from = 0) const override { }
   virtual void add_output_blacklist   (std::vector<uint64_t> const &blacklist)       override { }
   virtual void set_service_node_data  (const std::string& data, bool long_term)      override { }
-  virtual bool get_service_node_data  (std::string& data, bool long_term)      const override { return false; }
+  virtual bool get_service_node_data  (std::string_view& data, bool long_term) const override { return false; }
   virtual void clear_service_node_data()                                             override { }
 
   bool get_service_node_proof(const crypto::public_key &pubkey, service_nodes::proof_info &proof) const override { return false; }
@@ -30,6 +30,7 @@
  #define __STDC_FORMAT_MACROS // NOTE(oxen): Explicitly define the SCNu64 macro on Mingw
 #endif
 
+#include <deque>
 #include <unordered_map>
 #include <unordered_set>
 #include <boost/archive/portable_binary_iarchive.hpp>
@@ -54,8 +55,8 @@ namespace po = boost::program_options;
 using namespace cryptonote;
 
 static bool stop_requested = false;
-static uint64_t cached_txes = 0, cached_blocks = 0, cached_outputs = 0, total_txes = 0, total_blocks = 0, total_outputs = 0;
-static bool opt_cache_outputs = false, opt_cache_txes = false, opt_cache_blocks = false;
+static uint64_t cached_txes = 0, cached_outputs = 0, total_txes = 0, total_outputs = 0;
+static bool opt_cache_outputs = false, opt_cache_txes = false;
 
 struct ancestor
 {
@@ -136,7 +137,7 @@ struct ancestry_state_t
   std::unordered_map<crypto::hash, std::unordered_set<ancestor>> ancestry;
   std::unordered_map<ancestor, crypto::hash> output_cache;
   std::unordered_map<crypto::hash, ::tx_data_t> tx_cache;
-  std::vector<cryptonote::block> block_cache;
+  std::vector<cryptonote::block> block_cache; // no longer used, but still in the state file
 
   ancestry_state_t(): height(0) {}
 
@@ -222,29 +223,6 @@ static std::unordered_set<ancestor> get_ancestry(const std::unordered_map<crypto
   return i->second;
 }
 
-static bool get_block_from_height(ancestry_state_t &state, BlockchainDB *db, uint64_t height, cryptonote::block &b)
-{
-  ++total_blocks;
-  if (state.block_cache.size() > height && !state.block_cache[height].miner_tx.vin.empty())
-  {
-    ++cached_blocks;
-    b = state.block_cache[height];
-    return true;
-  }
-  cryptonote::blobdata bd = db->get_block_blob_from_height(height);
-  if (!cryptonote::parse_and_validate_block_from_blob(bd, b))
-  {
-    LOG_PRINT_L0("Bad block from db");
-    return false;
-  }
-  if (opt_cache_blocks)
-  {
-    state.block_cache.resize(height + 1);
-    state.block_cache[height] = b;
-  }
-  return true;
-}
-
 static bool get_transaction(ancestry_state_t &state, BlockchainDB *db, const crypto::hash &txid, ::tx_data_t &tx_data)
 {
   std::unordered_map<crypto::hash, ::tx_data_t>::const_iterator i = state.tx_cache.find(txid);
@@ -274,6 +252,7 @@ static bool get_transaction(ancestry_state_t &state, BlockchainDB *db, const cry
   return true;
 }
 
+// Looks up the tx that created an output in the db's output index
 static bool get_output_txid(ancestry_state_t &state, BlockchainDB *db, uint64_t amount, uint64_t offset, crypto::hash &txid)
 {
   ++total_outputs;
@@ -285,47 +264,18 @@ static bool get_output_txid(ancestry_state_t &state, BlockchainDB *db, uint64_t
     return true;
   }
 
-  const output_data_t od = db->get_output_key(amount, offset, false);
-  cryptonote::block b;
-  if (!get_block_from_height(state, db, od.height, b))
-    return false;
-
-  for (size_t out = 0; out < b.miner_tx.vout.size(); ++out)
+  try
   {
-    if (const auto* txout = std::get_if<cryptonote::txout_to_key>(&b.miner_tx.vout[out].target))
-    {
-      if (txout->key == od.pubkey)
-      {
-        txid = cryptonote::get_transaction_hash(b.miner_tx);
-        if (opt_cache_outputs)
-          state.output_cache.insert(std::make_pair(ancestor{amount, offset}, txid));
-        return true;
-      }
-    }
-    else
-    {
-      LOG_PRINT_L0("Bad vout type in txid " << cryptonote::get_transaction_hash(b.miner_tx));
-      return false;
-    }
+    txid = db->get_output_tx_and_index(amount, offset).first;
   }
-  for (const crypto::hash &block_txid: b.tx_hashes)
+  catch (const std::exception &e)
   {
-    ::tx_data_t tx_data3;
-    if (!get_transaction(state, db, block_txid, tx_data3))
-      return false;
-
-    for (size_t out = 0; out < tx_data3.vout.size(); ++out)
-    {
-      if (tx_data3.vout[out] == od.pubkey)
-      {
-        txid = block_txid;
-        if (opt_cache_outputs)
-          state.output_cache.insert(std::make_pair(ancestor{amount, offset}, txid));
-        return true;
-      }
-    }
+    LOG_PRINT_L0("Failed to find output " << amount << "/" << offset << ": " << e.what());
+    return false;
   }
-  return false;
+  if (opt_cache_outputs)
+    state.output_cache.insert(std::make_pair(ancestor{amount, offset}, txid));
+  return true;
 }
 
 int main(int argc, char* argv[])
@@ -349,7 +299,7 @@ int main(int argc, char* argv[])
   const command_line::arg_descriptor<bool> arg_refresh  = {"refresh", "Refresh the whole chain first", false};
   const command_line::arg_descriptor<bool> arg_cache_outputs  = {"cache-outputs", "Cache outputs (memory hungry)", false};
   const command_line::arg_descriptor<bool> arg_cache_txes  = {"cache-txes", "Cache txes (memory hungry)", false};
-  const command_line::arg_descriptor<bool> arg_cache_blocks  = {"cache-blocks", "Cache blocks (memory hungry)", false};
+  const command_line::arg_descriptor<uint64_t> arg_max_depth  = {"max-depth", "Only trace ancestors up to this many txes back (0 for no limit)", 0};
   const command_line::arg_descriptor<bool> arg_include_coinbase  = {"include-coinbase", "Including coinbase tx in per height average", false};
   const command_line::arg_descriptor<bool> arg_show_cache_stats  = {"show-cache-stats", "Show cache statistics", false};
 
@@ -363,7 +313,7 @@ int main(int argc, char* argv[])
   command_line::add_arg(desc_cmd_sett, arg_refresh);
   command_line::add_arg(desc_cmd_sett, arg_cache_outputs);
   command_line::add_arg(desc_cmd_sett, arg_cache_txes);
-  command_line::add_arg(desc_cmd_sett, arg_cache_blocks);
+  command_line::add_arg(desc_cmd_sett, arg_max_depth);
   command_line::add_arg(desc_cmd_sett, arg_include_coinbase);
   command_line::add_arg(desc_cmd_sett, arg_show_cache_stats);
   command_line::add_arg(desc_cmd_only, command_line::arg_help);
@@ -407,7 +357,7 @@ int main(int argc, char* argv[])
   bool opt_refresh = command_line::get_arg(vm, arg_refresh);
   opt_cache_outputs = command_line::get_arg(vm, arg_cache_outputs);
   opt_cache_txes = command_line::get_arg(vm, arg_cache_txes);
-  opt_cache_blocks = command_line::get_arg(vm, arg_cache_blocks);
+  uint64_t opt_max_depth = command_line::get_arg(vm, arg_max_depth);
   bool opt_include_coinbase = command_line::get_arg(vm, arg_include_coinbase);
   bool opt_show_cache_stats = command_line::get_arg(vm, arg_show_cache_stats);
 
@@ -495,23 +445,16 @@ int main(int argc, char* argv[])
   if (opt_refresh)
   {
     MINFO("Starting from height " << state.height);
-    state.block_cache.reserve(db_height);
     for (uint64_t h = state.height; h < db_height; ++h)
     {
       size_t block_ancestry_size = 0;
       const cryptonote::blobdata bd = db->get_block_blob_from_height(h);
-      ++total_blocks;
       cryptonote::block b;
       if (!cryptonote::parse_and_validate_block_from_blob(bd, b))
       {
         LOG_PRINT_L0("Bad block from db");
         return 1;
       }
-      if (opt_cache_blocks)
-      {
-        state.block_cache.resize(h + 1);
-        state.block_cache[h] = b;
-      }
       std::vector<crypto::hash> txids;
       txids.reserve(1 + b.tx_hashes.size());
       if (opt_include_coinbase)
@@ -652,11 +595,17 @@ int main(int argc, char* argv[])
 
     std::unordered_map<ancestor, unsigned int> ancestry;
 
-    std::list<crypto::hash> txids;
-    txids.push_back(start_txid);
+    // Breadth first, expanding each ancestor tx only once however many paths lead to it, so the
+    // work and memory used grow with the number of distinct ancestors rather than paths
+    std::unordered_set<crypto::hash> seen{start_txid};
+    std::deque<std::pair<crypto::hash, uint64_t>> txids; // txid and its depth
+    txids.emplace_back(start_txid, 0);
+    uint64_t max_depth = 0;
+    std::vector<tx_out_index> output_txs;
+    db_rtxn_guard rtxn_guard{*db};
     while (!txids.empty())
     {
-      const crypto::hash txid = txids.front();
+      const auto [txid, depth] = txids.front();
       txids.pop_front();
 
       if (stop_requested)
@@ -669,33 +618,42 @@ int main(int argc, char* argv[])
       const bool coinbase = tx_data2.coinbase;
       if (coinbase)
         continue;
+      max_depth = std::max(max_depth, depth + 1);
+      const bool expand = !opt_max_depth || depth + 1 < opt_max_depth;
 
       for (size_t ring = 0; ring < tx_data2.vin.size(); ++ring)
       {
+        const uint64_t amount = tx_data2.vin[ring].first;
+        const std::vector<uint64_t> &absolute_offsets = tx_data2.vin[ring].second;
+        for (uint64_t offset: absolute_offsets)
+          add_ancestor(ancestry, amount, offset);
+        if (!expand)
+          continue;
+
+        // find the txes which created this ring's outputs
+        try
+        {
+          output_txs.clear();
+          db->get_output_tx_and_index(amount, absolute_offsets, output_txs);
+        }
+        catch (const std::exception &e)
+        {
+          LOG_PRINT_L0("Output originating transaction not found: " << e.what());
+          return 1;
+        }
+        total_outputs += output_txs.size();
+        for (const tx_out_index &toi: output_txs)
         {
-          const uint64_t amount = tx_data2.vin[ring].first;
-          auto absolute_offsets = tx_data2.vin[ring].second;
-          for (uint64_t offset: absolute_offsets)
+          if (seen.insert(toi.first).second)
           {
-            add_ancestor(ancestry, amount, offset);
-
-            // find the tx which created this output
-            bool found = false;
-            crypto::hash output_txid;
-            if (!get_output_txid(state, db, amount, offset, output_txid))
-            {
-              LOG_PRINT_L0("Output originating transaction not found");
-              return 1;
-            }
-
-            add_ancestry(state.ancestry, txid, get_ancestry(state.ancestry, output_txid));
-            txids.push_back(output_txid);
-            MDEBUG("adding txid: " << output_txid);
+            txids.emplace_back(toi.first, depth + 1);
+            MDEBUG("adding txid: " << toi.first);
           }
         }
       }
     }
 
+    MINFO("Ancestry depth for " << start_txid << ": " << max_depth << " txes, " << seen.size() - 1 << " distinct ancestor txes");
     MINFO("Ancestry for " << start_txid << ": " << get_deduplicated_ancestry(ancestry) << " / " << get_full_ancestry(ancestry));
     for (const auto &i: ancestry)
     {
@@ -708,7 +666,6 @@ done:
 
   if (opt_show_cache_stats)
   MINFO("cache: txes " << std::to_string(cached_txes*100./total_txes)
-        << "%, blocks " << std::to_string(cached_blocks*100./total_blocks)
         << "%, outputs " << std::to_string(cached_outputs*100./total_outputs)
         << "%");
 
@@ -1313,6 +1313,13 @@ int main(int argc, char* argv[])
 
   std::vector<output_data> work_spent;
 
+  // The chain reaction pass only needs to look at the rings of the outputs marked as spent, and of
+  // the key images seen, during this run, unless an earlier run didn't get to finish its pass (or
+  // this is the first run, for which it would look at everything anyway).
+  bool full_chain_reaction = opt_force_chain_reaction_pass || get_processed_txidx(fs::canonical(inputs[0]).u8string()) == 0;
+  std::vector<output_data> new_spent;
+  std::vector<std::pair<uint64_t, crypto::key_image>> new_rings;
+
   if (opt_historical_stat)
   {
     if (!start_blackballed_outputs)
@@ -1374,6 +1381,18 @@ int main(int argc, char* argv[])
     goto skip_secondary_passes;
   }
 
+  {
+    MDB_txn *txn;
+    int dbr = mdb_txn_begin(env, NULL, 0, &txn);
+    CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to create LMDB transaction: " + std::string(mdb_strerror(dbr)));
+    uint64_t pending;
+    if (get_stat(txn, "chain-reaction-pending", pending) && pending)
+      full_chain_reaction = true;
+    set_stat(txn, "chain-reaction-pending", 1);
+    dbr = mdb_txn_commit(txn);
+    CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to commit txn: " + std::string(mdb_strerror(dbr)));
+  }
+
   if (!extra_spent_outputs.empty())
   {
     MINFO("Adding " << extra_spent_outputs.size() << " extra spent outputs");
@@ -1397,6 +1416,9 @@ int main(int argc, char* argv[])
     if (!blackballs.empty())
     {
       ringdb.blackball(blackballs);
+      if (!full_chain_reaction)
+        for (const auto &output: blackballs)
+          new_spent.emplace_back(output.first, output.second);
       blackballs.clear();
     }
     mdb_cursor_close(cur);
@@ -1550,6 +1572,8 @@ int main(int argc, char* argv[])
         if (n == 0)
         {
           set_relative_ring(txn, txin.k_image, new_ring);
+          if (!full_chain_reaction)
+            new_rings.emplace_back(txin.amount, txin.k_image);
           if (!opt_rct_only)
             inc_per_amount_outputs(txn, txin.amount, 0, 1);
         }
@@ -1578,6 +1602,9 @@ int main(int argc, char* argv[])
         if (!blackballs.empty())
         {
           ringdb.blackball(blackballs);
+          if (!full_chain_reaction)
+            for (const auto &output: blackballs)
+              new_spent.emplace_back(output.first, output.second);
           blackballs.clear();
         }
         mdb_cursor_close(cur);
@@ -1599,6 +1626,14 @@ int main(int argc, char* argv[])
       }
       return true;
     });
+    if (!blackballs.empty())
+    {
+      ringdb.blackball(blackballs);
+      if (!full_chain_reaction)
+        for (const auto &output: blackballs)
+          new_spent.emplace_back(output.first, output.second);
+      blackballs.clear();
+    }
     mdb_cursor_close(cur);
     dbr = mdb_txn_commit(txn);
     CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to commit txn creating/opening database: " + std::string(mdb_strerror(dbr)));
@@ -1610,79 +1645,119 @@ int main(int argc, char* argv[])
   if (stop_requested)
     goto skip_secondary_passes;
 
-  if (opt_force_chain_reaction_pass || get_num_spent_outputs() > start_blackballed_outputs)
-  {
-    MDB_txn *txn;
-    dbr = mdb_txn_begin(env, NULL, MDB_RDONLY, &txn);
-    CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to create LMDB transaction: " + std::string(mdb_strerror(dbr)));
-    work_spent = get_spent_outputs(txn);
-    mdb_txn_abort(txn);
-  }
-
-  while (!work_spent.empty())
   {
-    LOG_PRINT_L0("Secondary pass on " << work_spent.size() << " spent outputs");
-
-    int dbr = resize_env(cache_dir.string().c_str());
-    CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to resize LMDB database: " + std::string(mdb_strerror(dbr)));
-
-    MDB_txn *txn;
-    dbr = mdb_txn_begin(env, NULL, 0, &txn);
-    CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to create LMDB transaction: " + std::string(mdb_strerror(dbr)));
-    MDB_cursor *cur;
-    dbr = mdb_cursor_open(txn, dbi_spent, &cur);
-    CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to open LMDB cursor: " + std::string(mdb_strerror(dbr)));
-
-    std::vector<std::pair<uint64_t, uint64_t>> blackballs;
-    std::vector<output_data> scan_spent = std::move(work_spent);
-    work_spent.clear();
-    for (const output_data &od: scan_spent)
+    // Marks the one ring member of `ki` that isn't known to be spent as spent, if there is one.
+    const auto check_ring = [&](MDB_txn *txn, MDB_cursor *cur, uint64_t amount, const crypto::key_image &ki, std::vector<std::pair<uint64_t, uint64_t>> &blackballs)
     {
-      std::vector<crypto::key_image> key_images = get_key_images(txn, od);
-      for (const crypto::key_image &ki: key_images)
+      std::vector<uint64_t> relative_ring;
+      CHECK_AND_ASSERT_THROW_MES(get_relative_ring(txn, ki, relative_ring), "Relative ring not found");
+      std::vector<uint64_t> absolute = cryptonote::relative_output_offsets_to_absolute(relative_ring);
+      size_t known = 0;
+      uint64_t last_unknown = 0;
+      for (uint64_t out: absolute)
       {
-        std::vector<uint64_t> relative_ring;
-        CHECK_AND_ASSERT_THROW_MES(get_relative_ring(txn, ki, relative_ring), "Relative ring not found");
-        std::vector<uint64_t> absolute = cryptonote::relative_output_offsets_to_absolute(relative_ring);
-        size_t known = 0;
-        uint64_t last_unknown = 0;
-        for (uint64_t out: absolute)
-        {
-          output_data new_od(od.amount, out);
-          if (is_output_spent(cur, new_od))
-            ++known;
-          else
-            last_unknown = out;
-        }
-        if (known == absolute.size() - 1)
+        output_data new_od(amount, out);
+        if (is_output_spent(cur, new_od))
+          ++known;
+        else
+          last_unknown = out;
+      }
+      if (known == absolute.size() - 1)
+      {
+        const std::pair<uint64_t, uint64_t> output = std::make_pair(amount, last_unknown);
+        if (opt_verbose)
         {
-          const std::pair<uint64_t, uint64_t> output = std::make_pair(od.amount, last_unknown);
-          if (opt_verbose)
-          {
-            MINFO("Marking output " << output.first << "/" << output.second << " as spent, due to being used in a " <<
-                absolute.size() << "-ring where all other outputs are known to be spent");
-          }
-          blackballs.push_back(output);
-          if (add_spent_output(cur, output_data(od.amount, last_unknown)))
-            inc_stat(txn, od.amount ? "pre-rct-chain-reaction" : "rct-chain-reaction");
-          work_spent.push_back(output_data(od.amount, last_unknown));
+          MINFO("Marking output " << output.first << "/" << output.second << " as spent, due to being used in a " <<
+              absolute.size() << "-ring where all other outputs are known to be spent");
         }
+        blackballs.push_back(output);
+        if (add_spent_output(cur, output_data(amount, last_unknown)))
+          inc_stat(txn, amount ? "pre-rct-chain-reaction" : "rct-chain-reaction");
+        work_spent.push_back(output_data(amount, last_unknown));
       }
+    };
 
-      if (stop_requested)
+    if (full_chain_reaction)
+    {
+      if (opt_force_chain_reaction_pass || get_num_spent_outputs() > start_blackballed_outputs)
       {
-        MINFO("Stopping secondary passes. Secondary passes are not incremental, they will re-run fully.");
-        return 0;
+        MDB_txn *txn;
+        dbr = mdb_txn_begin(env, NULL, MDB_RDONLY, &txn);
+        CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to create LMDB transaction: " + std::string(mdb_strerror(dbr)));
+        work_spent = get_spent_outputs(txn);
+        mdb_txn_abort(txn);
       }
     }
-    if (!blackballs.empty())
+    else
     {
-      ringdb.blackball(blackballs);
-      blackballs.clear();
+      work_spent = std::move(new_spent);
+      if (!new_rings.empty())
+      {
+        LOG_PRINT_L0("Checking " << new_rings.size() << " new rings");
+        int dbr = resize_env(cache_dir.string().c_str());
+        CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to resize LMDB database: " + std::string(mdb_strerror(dbr)));
+        MDB_txn *txn;
+        dbr = mdb_txn_begin(env, NULL, 0, &txn);
+        CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to create LMDB transaction: " + std::string(mdb_strerror(dbr)));
+        MDB_cursor *cur;
+        dbr = mdb_cursor_open(txn, dbi_spent, &cur);
+        CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to open LMDB cursor: " + std::string(mdb_strerror(dbr)));
+        std::vector<std::pair<uint64_t, uint64_t>> blackballs;
+        for (const auto &[amount, ki]: new_rings)
+          check_ring(txn, cur, amount, ki, blackballs);
+        if (!blackballs.empty())
+          ringdb.blackball(blackballs);
+        mdb_cursor_close(cur);
+        dbr = mdb_txn_commit(txn);
+        CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to commit txn creating/opening database: " + std::string(mdb_strerror(dbr)));
+      }
     }
-    mdb_cursor_close(cur);
+
+    while (!work_spent.empty())
+    {
+      LOG_PRINT_L0("Secondary pass on " << work_spent.size() << " spent outputs");
+
+      int dbr = resize_env(cache_dir.string().c_str());
+      CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to resize LMDB database: " + std::string(mdb_strerror(dbr)));
+
+      MDB_txn *txn;
+      dbr = mdb_txn_begin(env, NULL, 0, &txn);
+      CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to create LMDB transaction: " + std::string(mdb_strerror(dbr)));
+      MDB_cursor *cur;
+      dbr = mdb_cursor_open(txn, dbi_spent, &cur);
+      CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to open LMDB cursor: " + std::string(mdb_strerror(dbr)));
+
+      std::vector<std::pair<uint64_t, uint64_t>> blackballs;
+      std::vector<output_data> scan_spent = std::move(work_spent);
+      work_spent.clear();
+      for (const output_data &od: scan_spent)
+      {
+        std::vector<crypto::key_image> key_images = get_key_images(txn, od);
+        for (const crypto::key_image &ki: key_images)
+          check_ring(txn, cur, od.amount, ki, blackballs);
+
+        if (stop_requested)
+        {
+          MINFO("Stopping secondary passes. The interrupted pass will re-run fully next time.");
+          return 0;
+        }
+      }
+      if (!blackballs.empty())
+      {
+        ringdb.blackball(blackballs);
+        blackballs.clear();
+      }
+      mdb_cursor_close(cur);
+      dbr = mdb_txn_commit(txn);
+      CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to commit txn creating/opening database: " + std::string(mdb_strerror(dbr)));
+    }
+
+    MDB_txn *txn;
+    dbr = mdb_txn_begin(env, NULL, 0, &txn);
+    CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to create LMDB transaction: " + std::string(mdb_strerror(dbr)));
+    set_stat(txn, "chain-reaction-pending", 0);
     dbr = mdb_txn_commit(txn);
-    CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to commit txn creating/opening database: " + std::string(mdb_strerror(dbr)));
+    CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to commit txn: " + std::string(mdb_strerror(dbr)));
   }
 
 skip_secondary_passes:
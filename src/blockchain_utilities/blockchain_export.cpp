@@ -60,6 +60,8 @@ int main(int argc, char* argv[])
   const command_line::arg_descriptor<std::string> arg_log_level  = {"log-level",  "0-4 or categories", ""};
   const command_line::arg_descriptor<uint64_t> arg_block_stop = {"block-stop", "Stop at block number", block_stop};
   const command_line::arg_descriptor<bool> arg_blocks_dat = {"blocksdat", "Output in blocks.dat format", blocks_dat};
+  const command_line::arg_descriptor<unsigned> arg_threads = {"threads", "Number of threads to use for loading blocks (bootstrap format only)", 1};
+  const command_line::arg_descriptor<bool> arg_bootstrap_v2 = {"bootstrap-v2", "Output in the v0.2 bootstrap format, which carries raw blobs and per-block db records for a faster import with --dangerous-unverified-import", false};
 
 
   command_line::add_arg(desc_cmd_sett, cryptonote::arg_data_dir);
@@ -69,6 +71,8 @@ int main(int argc, char* argv[])
   command_line::add_arg(desc_cmd_sett, arg_log_level);
   command_line::add_arg(desc_cmd_sett, arg_block_stop);
   command_line::add_arg(desc_cmd_sett, arg_blocks_dat);
+  command_line::add_arg(desc_cmd_sett, arg_threads);
+  command_line::add_arg(desc_cmd_sett, arg_bootstrap_v2);
 
   command_line::add_arg(desc_cmd_only, command_line::arg_help);
 
@@ -109,6 +113,7 @@ int main(int argc, char* argv[])
     return 1;
   }
   bool opt_blocks_dat = command_line::get_arg(vm, arg_blocks_dat);
+  unsigned opt_threads = std::max(1u, command_line::get_arg(vm, arg_threads));
 
   auto config_folder = fs::u8path(command_line::get_arg(vm, cryptonote::arg_data_dir));
 
@@ -153,6 +158,7 @@ int main(int argc, char* argv[])
   CHECK_AND_ASSERT_MES(r, 1, "Failed to initialize source blockchain storage");
   LOG_PRINT_L0("Source blockchain storage initialized OK");
   LOG_PRINT_L0("Exporting blockchain raw data...");
+  db->set_io_policy(BlockchainDB::io_policy::exporting);
 
   if (opt_blocks_dat)
   {
@@ -162,7 +168,7 @@ int main(int argc, char* argv[])
   else
   {
     BootstrapFile bootstrap;
-    r = bootstrap.store_blockchain_raw(core_storage, NULL, output_file_path, block_stop);
+    r = bootstrap.store_blockchain_raw(core_storage, NULL, output_file_path, block_stop, opt_threads, command_line::get_arg(vm, arg_bootstrap_v2));
   }
   CHECK_AND_ASSERT_MES(r, 1, "Failed to export blockchain raw data");
   LOG_PRINT_L0("Blockchain raw data exported OK");
@@ -28,9 +28,17 @@
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
 
 #include <boost/algorithm/string.hpp>
 #include <unistd.h>
@@ -44,6 +52,7 @@
 #include "cryptonote_core/uptime_proof.h"
 #include "cryptonote_core/cryptonote_core.h"
 #include "common/hex.h"
+#include "common/metrics.h"
 
 #undef OXEN_DEFAULT_LOG_CATEGORY
 #define OXEN_DEFAULT_LOG_CATEGORY "bcutil"
@@ -70,8 +79,20 @@ uint64_t db_batch_size = 100;
 // frequently saved
 uint64_t db_batch_size_verify = 5000;
 
+// maximum number of blocks the file reader thread may read and deserialize ahead of the
+// verification/commit stage; 0 reads blocks in the same thread.
+uint64_t pipeline_depth = 2 * db_batch_size_verify;
+
 std::string refresh_string = "\r                                    \r";
 
+// Time spent in each stage of a verified import, reported by --benchmark
+struct stage_timings
+{
+  using clock = std::chrono::steady_clock;
+  clock::duration prepare{}, txs{}, blocks{}, commit{};
+  uint64_t num_txs = 0;
+} timings;
+
 const command_line::arg_descriptor<bool> arg_recalculate_difficulty = {
   "recalculate-difficulty",
   "Recalculate per-block difficulty starting from the height specified",
@@ -124,7 +145,9 @@ int pop_blocks(cryptonote::core& core, int num_blocks)
   return num_blocks;
 }
 
-int check_flush(cryptonote::core &core, std::vector<block_complete_entry> &blocks, bool force)
+// `hashes` must contain the hashes of the blocks in `blocks`; it is cleared along with `blocks`
+// when the blocks are flushed.
+int check_flush(cryptonote::core &core, std::vector<block_complete_entry> &blocks, std::vector<crypto::hash> &hashes, bool force)
 {
   if (blocks.empty())
     return 0;
@@ -136,19 +159,12 @@ int check_flush(cryptonote::core &core, std::vector<block_complete_entry> &block
   if (!force && new_height % HASH_OF_HASHES_STEP)
     return 0;
 
-  std::vector<crypto::hash> hashes;
-  for (const auto &b: blocks)
+  if (hashes.size() != blocks.size())
   {
-    cryptonote::block block;
-    if (!parse_and_validate_block_from_blob(b.block, block))
-    {
-      MERROR("Failed to parse block: "
-          << tools::type_to_hex(get_blob_hash(b.block)));
-      core.cleanup_handle_incoming_blocks();
-      return 1;
-    }
-    hashes.push_back(cryptonote::get_block_hash(block));
+    MERROR("Unexpected number of block hashes");
+    return 1;
   }
+  auto start = stage_timings::clock::now();
   core.prevalidate_block_hashes(core.get_blockchain_storage().get_db().height(), hashes);
 
   // TODO(doyle): Checkpointing
@@ -158,6 +174,8 @@ int check_flush(cryptonote::core &core, std::vector<block_complete_entry> &block
     MERROR("Failed to prepare to add blocks");
     return 1;
   }
+  auto now = stage_timings::clock::now();
+  timings.prepare += now - start;
   if (!pblocks.empty() && pblocks.size() != blocks.size())
   {
     MERROR("Unexpected parsed blocks size");
@@ -181,12 +199,17 @@ int check_flush(cryptonote::core &core, std::vector<block_complete_entry> &block
         return 1;
       }
     }
+    timings.num_txs += block_entry.txs.size();
+    start = std::exchange(now, stage_timings::clock::now());
+    timings.txs += now - start;
 
     // process block
 
     block_verification_context bvc{};
 
     core.handle_incoming_block(block_entry.block, pblocks.empty() ? NULL : &pblocks[blockidx++], bvc, nullptr /*checkpoint*/, false); // <--- process block
+    start = std::exchange(now, stage_timings::clock::now());
+    timings.blocks += now - start;
 
     if(bvc.m_verifivation_failed)
     {
@@ -205,11 +228,328 @@ int check_flush(cryptonote::core &core, std::vector<block_complete_entry> &block
   } // each download block
   if (!core.cleanup_handle_incoming_blocks())
     return 1;
+  timings.commit += stage_timings::clock::now() - now;
 
   blocks.clear();
+  hashes.clear();
   return 0;
 }
 
+// Reads the next chunk of the bootstrap file into `buffer`.  Returns 0 on success, 1 if the end of
+// the file was reached, or 2 on error.
+int read_chunk(fs::ifstream& import_file, std::string& buffer, uint64_t& bytes_read)
+{
+  uint32_t chunk_size;
+  char buffer1[sizeof(chunk_size)];
+  import_file.read(buffer1, sizeof(chunk_size));
+  // TODO: bootstrap.read_chunk();
+  if (! import_file) {
+    std::cout << refresh_string;
+    MINFO("End of file reached");
+    return 1;
+  }
+  bytes_read += sizeof(chunk_size);
+
+  try {
+    serialization::parse_binary(std::string_view{buffer1, sizeof(chunk_size)}, chunk_size);
+  } catch (const std::exception& e) {
+    throw std::runtime_error("Error in deserialization of chunk size: "s + e.what());
+  }
+  MDEBUG("chunk_size: " << chunk_size);
+
+  if (chunk_size > BUFFER_SIZE)
+  {
+    MWARNING("WARNING: chunk_size " << chunk_size << " > BUFFER_SIZE " << BUFFER_SIZE);
+    throw std::runtime_error("Aborting: chunk size exceeds buffer size");
+  }
+  if (chunk_size > CHUNK_SIZE_WARNING_THRESHOLD)
+  {
+    MINFO("NOTE: chunk_size " << chunk_size << " > " << CHUNK_SIZE_WARNING_THRESHOLD);
+  }
+  else if (chunk_size == 0) {
+    MFATAL("ERROR: chunk_size == 0");
+    return 2;
+  }
+  buffer.resize(chunk_size);
+  import_file.read(buffer.data(), chunk_size);
+  if (! import_file) {
+    if (import_file.eof())
+    {
+      std::cout << refresh_string;
+      MINFO("End of file reached - file was truncated");
+      return 1;
+    }
+    else
+    {
+      MFATAL("ERROR: unexpected end of file: bytes read before error: "
+          << import_file.gcount() << " of chunk_size " << chunk_size);
+      return 2;
+    }
+  }
+  bytes_read += chunk_size;
+  MDEBUG("Total bytes read: " << bytes_read);
+  return 0;
+}
+
+// A block read from the bootstrap file, ready to be verified
+struct import_entry
+{
+  block_complete_entry entry;
+  crypto::hash hash;
+};
+
+// Parses a bootstrap chunk into the blobs to verify.  v0.2 chunks already hold the blobs, so only
+// the block needs parsing (for its hash).
+void parse_import_entry(const std::string& chunk, bool v2, import_entry& e)
+{
+  try {
+    if (v2)
+    {
+      bootstrap::block_package_v2 bp;
+      serialization::parse_binary(chunk, bp);
+      block b;
+      if (!parse_and_validate_block_from_blob(bp.block, b, e.hash))
+        throw std::runtime_error("invalid block blob");
+      e.entry.block = std::move(bp.block);
+      e.entry.txs = std::move(bp.txs);
+      return;
+    }
+    bootstrap::block_package bp;
+    serialization::parse_binary(chunk, bp);
+    cryptonote::block_to_blob(bp.block, e.entry.block);
+    e.entry.txs.reserve(bp.txs.size());
+    for (const auto &tx: bp.txs)
+      cryptonote::tx_to_blob(tx, e.entry.txs.emplace_back());
+    e.hash = cryptonote::get_block_hash(bp.block);
+  } catch (const std::exception& e) {
+    throw std::runtime_error("Error in deserialization of chunk"s + e.what());
+  }
+}
+
+// A block read from a v0.2 bootstrap file for unverified import
+struct unverified_entry
+{
+  bootstrap::block_package_v2 bp;
+  block b;
+  crypto::hash hash;
+  std::vector<std::pair<transaction, blobdata>> txs;
+};
+
+void parse_unverified_entry(const std::string& chunk, unverified_entry& e)
+{
+  try {
+    serialization::parse_binary(chunk, e.bp);
+  } catch (const std::exception& ex) {
+    throw std::runtime_error("Error in deserialization of chunk"s + ex.what());
+  }
+  if (!parse_and_validate_block_from_blob(e.bp.block, e.b, e.hash))
+    throw std::runtime_error("Invalid block blob in chunk");
+  if (e.bp.txs.size() != e.b.tx_hashes.size())
+    throw std::runtime_error("Wrong number of txs for block " + tools::type_to_hex(e.hash));
+  e.txs.reserve(e.bp.txs.size());
+  for (size_t i = 0; i < e.bp.txs.size(); i++)
+  {
+    auto& [tx, blob] = e.txs.emplace_back();
+    crypto::hash tx_hash;
+    if (!parse_and_validate_tx_from_blob(e.bp.txs[i], tx, tx_hash) || tx_hash != e.b.tx_hashes[i])
+      throw std::runtime_error("Invalid tx " + tools::type_to_hex(e.b.tx_hashes[i]) + " in block " + tools::type_to_hex(e.hash));
+    blob = std::move(e.bp.txs[i]);
+  }
+}
+
+// Writes blocks from a v0.2 bootstrap file straight to the db.  The only checks are that each
+// block's txs match its tx hashes (done when parsing), that the blocks chain onto the db tip, and
+// that their hashes match the compiled-in block hashes where those cover them.
+int add_unverified_blocks(cryptonote::core& core, std::vector<unverified_entry>& pending)
+{
+  if (pending.empty())
+    return 0;
+  auto& bc = core.get_blockchain_storage();
+  auto& db = bc.get_db();
+  const uint64_t height = db.height();
+
+  std::vector<crypto::hash> hashes;
+  hashes.reserve(pending.size());
+  crypto::hash prev = db.top_block_hash();
+  for (const auto& e : pending)
+  {
+    if (e.b.prev_id != prev)
+    {
+      MFATAL("Block " << e.hash << " at height " << height + hashes.size() << " does not follow block " << prev);
+      return 1;
+    }
+    prev = hashes.emplace_back(e.hash);
+  }
+  const uint64_t usable = core.prevalidate_block_hashes(height, hashes);
+  if (usable < hashes.size() && bc.is_within_compiled_block_hash_area(height + usable))
+  {
+    MFATAL("Blocks from height " << height + usable << " could not be matched against the compiled-in block hashes");
+    return 1;
+  }
+
+  try
+  {
+    for (auto& e : pending)
+      db.add_block(std::make_pair(std::move(e.b), std::move(e.bp.block)), e.bp.block_weight, e.bp.long_term_block_weight,
+          e.bp.cumulative_difficulty, e.bp.coins_generated, e.txs);
+  }
+  catch (const std::exception& e)
+  {
+    std::cout << refresh_string;
+    MFATAL("Error adding block to blockchain: " << e.what());
+    return 1;
+  }
+  pending.clear();
+  return 0;
+}
+
+// Bounded single-producer, single-consumer queue between the file reader thread and the
+// verification/commit stage.
+class import_queue
+{
+public:
+  explicit import_queue(size_t max_size) : m_max_size{std::max<size_t>(max_size, 1)} {}
+
+  // Blocks while the queue is full.  Returns false if the consumer has given up.
+  bool push(import_entry&& e)
+  {
+    std::unique_lock lock{m_mutex};
+    m_not_full.wait(lock, [this] { return m_cancelled || m_queue.size() < m_max_size; });
+    if (m_cancelled)
+      return false;
+    m_queue.push_back(std::move(e));
+    m_not_empty.notify_one();
+    return true;
+  }
+
+  // Blocks until an entry is available; returns nullopt once the producer has finished and the
+  // queue has been drained.
+  std::optional<import_entry> pop()
+  {
+    std::unique_lock lock{m_mutex};
+    m_not_empty.wait(lock, [this] { return m_done || !m_queue.empty(); });
+    if (m_queue.empty())
+      return std::nullopt;
+    std::optional<import_entry> e{std::move(m_queue.front())};
+    m_queue.pop_front();
+    m_not_full.notify_one();
+    return e;
+  }
+
+  // Called by the producer once it has queued everything (or hit an error)
+  void finish(int status)
+  {
+    std::lock_guard lock{m_mutex};
+    m_done = true;
+    m_status = status;
+    m_not_empty.notify_all();
+  }
+
+  // Called by the consumer to make the producer stop early
+  void cancel()
+  {
+    std::lock_guard lock{m_mutex};
+    m_cancelled = true;
+    m_not_full.notify_all();
+  }
+
+  int status()
+  {
+    std::lock_guard lock{m_mutex};
+    return m_status;
+  }
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_not_empty, m_not_full;
+  std::deque<import_entry> m_queue;
+  size_t m_max_size;
+  bool m_done = false, m_cancelled = false;
+  int m_status = 0;
+};
+
+// Verified import with reading and deserialising the bootstrap file on a separate thread from
+// verification and commit.  prepare_handle_incoming_blocks holds the blockchain lock and the batch
+// txn until cleanup_handle_incoming_blocks so the verification and commit stages can't overlap each
+// other, but both overlap with the disk reads and block/tx (de)serialisation done by the reader.
+//
+// Returns the same quit codes as the main import loop.
+int import_verified_pipelined(cryptonote::core& core, fs::ifstream& import_file, bool v2, uint64_t& h, uint64_t block_stop, uint64_t& num_imported, uint64_t& bytes_read)
+{
+  import_queue queue{pipeline_depth};
+  std::exception_ptr reader_error;
+
+  std::thread reader{[&, h]() mutable {
+    int status = 1;
+    try
+    {
+      std::string chunk;
+      while (true)
+      {
+        if (int ret = read_chunk(import_file, chunk, bytes_read))
+        {
+          status = ret;
+          break;
+        }
+        if (h > block_stop)
+        {
+          std::cout << refresh_string << "block " << h-1
+            << " / " << block_stop
+            << "\n" << std::endl;
+          MINFO("Specified block number reached - stopping.  block: " << h-1 << "  total blocks: " << h);
+          break;
+        }
+
+        import_entry e;
+        parse_import_entry(chunk, v2, e);
+        ++h;
+
+        if (!queue.push(std::move(e)))
+          break;
+      }
+    }
+    catch (const std::exception& e)
+    {
+      std::cout << refresh_string;
+      MFATAL("exception while reading from file, height=" << h << ": " << e.what());
+      status = 2;
+    }
+    queue.finish(status);
+  }};
+
+  int quit = 0;
+  std::vector<block_complete_entry> blocks;
+  std::vector<crypto::hash> hashes;
+  const int progress_interval = 10;
+  while (auto e = queue.pop())
+  {
+    ++h;
+    MDEBUG("loading block number " << h-1);
+    if ((h-1) % progress_interval == 0)
+    {
+      std::cout << refresh_string << "block " << h-1
+        << " / " << block_stop
+        << "\r" << std::flush;
+    }
+    blocks.push_back(std::move(e->entry));
+    hashes.push_back(e->hash);
+    if (check_flush(core, blocks, hashes, false))
+    {
+      quit = 2; // make sure we don't commit partial block data
+      break;
+    }
+    ++num_imported;
+  }
+  queue.cancel();
+  reader.join();
+
+  if (!quit && queue.status() == 2)
+    quit = 2;
+  if (quit < 2 && check_flush(core, blocks, hashes, true))
+    quit = 2;
+  return quit ? quit : 1;
+}
+
 int import_from_file(cryptonote::core& core, const fs::path& import_file_path, uint64_t block_stop=0)
 {
   // Reset stats, in case we're using newly created db, accumulating stats
@@ -252,8 +592,7 @@ int import_from_file(cryptonote::core& core, const fs::path& import_file_path, u
   // 4 byte magic + (currently) 1024 byte header structures
   bootstrap.seek_to_first_chunk(import_file);
 
-  char buffer1[1024];
-  char buffer_block[BUFFER_SIZE];
+  std::string buffer_block;
   block b;
   transaction tx;
   int quit = 0;
@@ -278,6 +617,10 @@ int import_from_file(cryptonote::core& core, const fs::path& import_file_path, u
   std::cout << "\n";
 
   std::vector<block_complete_entry> blocks;
+  std::vector<crypto::hash> hashes;
+  // v0.2 blocks for unverified import, added once a full group of compiled-in hashes is read
+  std::vector<unverified_entry> pending;
+  uint64_t batch_blocks = 0;
 
   uint64_t h = 0;
   uint64_t num_imported = 0;
@@ -306,57 +649,28 @@ int import_from_file(cryptonote::core& core, const fs::path& import_file_path, u
     import_file.seekg(pos);
     core.get_blockchain_storage().get_db().batch_start(db_batch_size, bytes);
   }
-  while (! quit)
-  {
-    uint32_t chunk_size;
-    import_file.read(buffer1, sizeof(chunk_size));
-    // TODO: bootstrap.read_chunk();
-    if (! import_file) {
-      std::cout << refresh_string;
-      MINFO("End of file reached");
-      quit = 1;
-      break;
-    }
-    bytes_read += sizeof(chunk_size);
 
-    try {
-      serialization::parse_binary(std::string_view{buffer1, sizeof(chunk_size)}, chunk_size);
-    } catch (const std::exception& e) {
-      throw std::runtime_error("Error in deserialization of chunk size: "s + e.what());
-    }
-    MDEBUG("chunk_size: " << chunk_size);
+  if (opt_verify && pipeline_depth > 0)
+  {
+    MINFO("Reading up to " << pipeline_depth << " blocks ahead of verification");
+    quit = import_verified_pipelined(core, import_file, bootstrap.is_v2(), h, block_stop, num_imported, bytes_read);
+    import_file.close();
+    if (quit > 1)
+      return quit;
+    goto finished;
+  }
 
-    if (chunk_size > BUFFER_SIZE)
-    {
-      MWARNING("WARNING: chunk_size " << chunk_size << " > BUFFER_SIZE " << BUFFER_SIZE);
-      throw std::runtime_error("Aborting: chunk size exceeds buffer size");
-    }
-    if (chunk_size > CHUNK_SIZE_WARNING_THRESHOLD)
+  while (! quit)
+  {
+    if (int ret = read_chunk(import_file, buffer_block, bytes_read))
     {
-      MINFO("NOTE: chunk_size " << chunk_size << " > " << CHUNK_SIZE_WARNING_THRESHOLD);
-    }
-    else if (chunk_size == 0) {
-      MFATAL("ERROR: chunk_size == 0");
-      return 2;
-    }
-    import_file.read(buffer_block, chunk_size);
-    if (! import_file) {
-      if (import_file.eof())
+      if (ret == 1)
       {
-        std::cout << refresh_string;
-        MINFO("End of file reached - file was truncated");
         quit = 1;
         break;
       }
-      else
-      {
-        MFATAL("ERROR: unexpected end of file: bytes read before error: "
-            << import_file.gcount() << " of chunk_size " << chunk_size);
-        return 2;
-      }
+      return ret;
     }
-    bytes_read += chunk_size;
-    MDEBUG("Total bytes read: " << bytes_read);
 
     if (h > block_stop)
     {
@@ -370,9 +684,56 @@ int import_from_file(cryptonote::core& core, const fs::path& import_file_path, u
 
     try
     {
+      if (bootstrap.is_v2())
+      {
+        ++h;
+        MDEBUG("loading block number " << h-1);
+        if ((h-1) % 10 == 0)
+        {
+          std::cout << refresh_string << "block " << h-1
+            << " / " << block_stop
+            << "\r" << std::flush;
+        }
+        if (opt_verify)
+        {
+          import_entry e;
+          parse_import_entry(buffer_block, true, e);
+          blocks.push_back(std::move(e.entry));
+          hashes.push_back(e.hash);
+          if (check_flush(core, blocks, hashes, false))
+          {
+            quit = 2; // make sure we don't commit partial block data
+            break;
+          }
+          ++num_imported;
+          continue;
+        }
+
+        parse_unverified_entry(buffer_block, pending.emplace_back());
+        if (h % HASH_OF_HASHES_STEP)
+          continue;
+        const size_t n = pending.size();
+        if (add_unverified_blocks(core, pending))
+        {
+          quit = 2; // make sure we don't commit partial block data
+          break;
+        }
+        num_imported += n;
+        batch_blocks += n;
+        if (use_batch && batch_blocks >= db_batch_size)
+        {
+          std::cout << refresh_string;
+          std::cout << "\n[- batch commit at height " << h-1 << " -]\n";
+          core.get_blockchain_storage().get_db().batch_stop();
+          core.get_blockchain_storage().get_db().batch_start(db_batch_size);
+          batch_blocks = 0;
+        }
+        continue;
+      }
+
       bootstrap::block_package bp;
       try {
-        serialization::parse_binary(std::string_view{buffer_block, chunk_size}, bp);
+        serialization::parse_binary(buffer_block, bp);
       } catch (const std::exception& e) {
         throw std::runtime_error("Error in deserialization of chunk"s + e.what());
       }
@@ -413,7 +774,8 @@ int import_from_file(cryptonote::core& core, const fs::path& import_file_path, u
             cryptonote::tx_to_blob(tx, txs.back());
           }
           blocks.push_back({block, txs});
-          int ret = check_flush(core, blocks, false);
+          hashes.push_back(cryptonote::get_block_hash(bp.block));
+          int ret = check_flush(core, blocks, hashes, false);
           if (ret)
           {
             quit = 2; // make sure we don't commit partial block data
@@ -496,9 +858,18 @@ int import_from_file(cryptonote::core& core, const fs::path& import_file_path, u
 quitting:
   import_file.close();
 
+  if (quit < 2)
+  {
+    const size_t n = pending.size();
+    if (add_unverified_blocks(core, pending))
+      quit = 2; // don't commit the batch below
+    else
+      num_imported += n;
+  }
+
   if (opt_verify)
   {
-    int ret = check_flush(core, blocks, true);
+    int ret = check_flush(core, blocks, hashes, true);
     if (ret)
       return ret;
   }
@@ -516,6 +887,7 @@ quitting:
     }
   }
 
+finished:
   core.get_blockchain_storage().get_db().show_stats();
   MINFO("Number of blocks imported: " << num_imported);
   if (h > 0)
@@ -526,6 +898,42 @@ quitting:
   return 0;
 }
 
+// Prints where the time of a --benchmark run went: the stages the import drives, and within block
+// verification the blockchain's own per-stage timing metrics.
+void print_benchmark(const std::string& mode, stage_timings::clock::duration elapsed)
+{
+  double blocks = 0;
+  std::map<std::string, double> stage;
+  for (auto& s : tools::metrics::snapshot())
+  {
+    if (s.name == "oxend_blocks_added_total")
+      blocks = s.value;
+    else if (s.type == "histogram")
+      stage[s.name] = s.sum;
+  }
+  const double total = std::chrono::duration<double>(elapsed).count();
+
+  std::cout << "\nSync benchmark (" << mode << "): " << blocks << " blocks, " << timings.num_txs << " txs in "
+    << std::fixed << std::setprecision(2) << total << "s: " << (total > 0 ? blocks / total : 0) << " blocks/s\n\n"
+    << std::setw(44) << std::left << "stage" << std::right << std::setw(12) << "total (s)" << std::setw(12) << "ms/block" << '\n';
+  auto row = [&](const char* name, double seconds) {
+    std::cout << std::setw(44) << std::left << name << std::right << std::setw(12) << std::setprecision(3) << seconds
+      << std::setw(12) << (blocks ? seconds * 1000 / blocks : 0) << '\n';
+  };
+  auto secs = [](stage_timings::clock::duration d) { return std::chrono::duration<double>(d).count(); };
+  row("prepare (PoW precompute, ringct prep)", secs(timings.prepare));
+  row("tx parse and semantic checks", secs(timings.txs));
+  row("block verification and add", secs(timings.blocks));
+  row("  PoW", stage["oxend_block_pow_seconds"]);
+  row("  tx inputs and ring signatures", stage["oxend_block_tx_inputs_seconds"]);
+  row("  db add_block", stage["oxend_block_db_add_seconds"]);
+  row("  service node list", stage["oxend_block_sn_list_seconds"]);
+  row("  ONS", stage["oxend_block_ons_seconds"]);
+  row("batch cleanup and db commit", secs(timings.commit));
+  row("total", total);
+  std::cout << std::endl;
+}
+
 int main(int argc, char* argv[])
 {
   TRY_ENTRY();
@@ -549,6 +957,8 @@ int main(int argc, char* argv[])
   const command_line::arg_descriptor<uint64_t> arg_block_stop  = {"block-stop", "Stop at block number", block_stop};
   const command_line::arg_descriptor<uint64_t> arg_batch_size  = {"batch-size", "", db_batch_size};
   const command_line::arg_descriptor<uint64_t> arg_pop_blocks  = {"pop-blocks", "Remove blocks from end of blockchain", num_blocks};
+  const command_line::arg_descriptor<uint64_t> arg_pipeline_depth = {"pipeline-depth",
+    "Maximum number of blocks to read ahead of verification (0 to read and verify in the same thread)", pipeline_depth};
   const command_line::arg_descriptor<bool>     arg_count_blocks = {
     "count-blocks"
       , "Count blocks in bootstrap file and exit"
@@ -560,17 +970,27 @@ int main(int argc, char* argv[])
     "Batch transactions for faster import", true};
   const command_line::arg_descriptor<bool> arg_resume =  {"resume",
     "Resume from current height if output database already exists", true};
+  const command_line::arg_descriptor<std::string> arg_benchmark = {"benchmark",
+    "Benchmark sync: import the input file (up to --block-stop) into a temporary database, which is deleted afterwards, "
+    "and report the time taken by each verification stage.  \"checkpointed\" trusts the compiled-in block hashes the way a "
+    "syncing node does; \"full\" verifies every block", ""};
+  const command_line::arg_descriptor<std::string> arg_state_commitments = {"state-commitments-file",
+    "Write the state commitment of each complete chunk of compiled-in block hashes to this file, for "
+    "appending to the compiled-in blocks data (requires a verified import from genesis)", ""};
 
   command_line::add_arg(desc_cmd_sett, arg_input_file);
   command_line::add_arg(desc_cmd_sett, arg_log_level);
   command_line::add_arg(desc_cmd_sett, arg_batch_size);
   command_line::add_arg(desc_cmd_sett, arg_block_stop);
+  command_line::add_arg(desc_cmd_sett, arg_pipeline_depth);
 
   command_line::add_arg(desc_cmd_only, arg_count_blocks);
   command_line::add_arg(desc_cmd_only, arg_pop_blocks);
   command_line::add_arg(desc_cmd_only, command_line::arg_help);
 
   command_line::add_arg(desc_cmd_only, arg_recalculate_difficulty);
+  command_line::add_arg(desc_cmd_only, arg_benchmark);
+  command_line::add_arg(desc_cmd_only, arg_state_commitments);
 
   // call add_options() directly for these arguments since
   // command_line helpers support only boolean switch, not boolean argument
@@ -599,6 +1019,7 @@ int main(int argc, char* argv[])
   opt_resume    = command_line::get_arg(vm, arg_resume);
   block_stop    = command_line::get_arg(vm, arg_block_stop);
   db_batch_size = command_line::get_arg(vm, arg_batch_size);
+  pipeline_depth = command_line::get_arg(vm, arg_pipeline_depth);
 
   if (command_line::get_arg(vm, command_line::arg_help))
   {
@@ -637,6 +1058,32 @@ int main(int argc, char* argv[])
     std::cerr << "Error: Can't specify more than one of --testnet and --devnet\n";
     return 1;
   }
+  const std::string benchmark_mode = command_line::get_arg(vm, arg_benchmark);
+  fs::path benchmark_dir;
+  if (!benchmark_mode.empty())
+  {
+    if (benchmark_mode != "checkpointed" && benchmark_mode != "full")
+    {
+      std::cerr << "Error: --" << arg_benchmark.name << " must be \"checkpointed\" or \"full\"\n";
+      return 1;
+    }
+    if (!opt_verify)
+    {
+      std::cerr << "Error: --" << arg_benchmark.name << " can't be used with --" << arg_noverify.name << "\n";
+      return 1;
+    }
+    benchmark_dir = fs::temp_directory_path() / ("oxen-sync-benchmark-" + std::to_string(getpid()));
+    vm.at(cryptonote::arg_data_dir.name) = po::variable_value{benchmark_dir.u8string(), false};
+    // Declared by the core; 0 disables trusting the compiled-in block hashes
+    vm.at("fast-block-sync") = po::variable_value{uint64_t{benchmark_mode == "checkpointed"}, false};
+    opt_resume = false;
+  }
+  const std::string state_commitments_file = command_line::get_arg(vm, arg_state_commitments);
+  if (!state_commitments_file.empty() && !opt_verify)
+  {
+    std::cerr << "Error: --" << arg_state_commitments.name << " can't be used with --" << arg_noverify.name << "\n";
+    return 1;
+  }
   m_config_folder = command_line::get_arg(vm, cryptonote::arg_data_dir);
 
   mlog_configure(mlog_get_default_log_path("oxen-blockchain-import.log"), true);
@@ -673,6 +1120,8 @@ int main(int argc, char* argv[])
     MINFO("batch:   " << std::boolalpha << opt_batch << std::noboolalpha);
   }
   MINFO("resume:  " << std::boolalpha << opt_resume  << std::noboolalpha);
+  if (opt_verify)
+    MINFO("pipeline depth: " << pipeline_depth);
   MINFO("nettype: " << (opt_testnet ? "testnet" : opt_devnet ? "devnet" : "mainnet"));
 
   MINFO("bootstrap file path: " << import_file_path);
@@ -723,18 +1172,55 @@ int main(int argc, char* argv[])
   if (command_line::get_arg(vm, arg_recalculate_difficulty))
     core.get_blockchain_storage().get_db().fixup(core.get_nettype());
 
+  if (!state_commitments_file.empty())
+  {
+    if (core.get_blockchain_storage().get_current_blockchain_height() > 1)
+    {
+      std::cerr << "Error: --" << arg_state_commitments.name << " needs to import into an empty database\n";
+      return 1;
+    }
+    core.get_blockchain_storage().record_state_commitments(true);
+  }
+
+  const auto import_start = stage_timings::clock::now();
   import_from_file(core, import_file_path, block_stop);
+  const auto import_time = stage_timings::clock::now() - import_start;
+
+  if (!state_commitments_file.empty())
+  {
+    const std::string commitments = core.get_blockchain_storage().recorded_state_commitments();
+    std::ofstream out{fs::u8path(state_commitments_file), std::ios::binary | std::ios::trunc};
+    out.write(commitments.data(), commitments.size());
+    if (!out)
+    {
+      std::cerr << "Error: failed to write " << state_commitments_file << "\n";
+      return 1;
+    }
+    MINFO("Wrote " << commitments.size() / cryptonote::Blockchain::CHUNK_STATE_COMMITMENT_SIZE << " chunk state commitments to " << state_commitments_file);
+  }
 
   // ensure db closed
   //   - transactions properly checked and handled
   //   - disk sync if needed
   //
   core.deinit();
+
+  if (!benchmark_mode.empty())
+  {
+    print_benchmark(benchmark_mode, import_time);
+    std::error_code ec;
+    fs::remove_all(benchmark_dir, ec);
+  }
   }
   catch (const DB_ERROR& e)
   {
     std::cout << std::string("Error loading blockchain db: ") + e.what() + " -- shutting down now\n";
     core.deinit();
+    if (!benchmark_dir.empty())
+    {
+      std::error_code ec;
+      fs::remove_all(benchmark_dir, ec);
+    }
     return 1;
   }
 
@@ -433,6 +433,90 @@ static bool parse_db_sync_mode(std::string db_sync_mode, uint64_t &db_flags)
   return true;
 }
 
+// Prunes the database where it is, in small write txns, rather than copying it.  Each step's
+// progress is committed, so this can be interrupted and rerun to carry on.  With `compact`, the
+// pruned database is then copied without its free pages and swapped in, which needs only as much
+// spare disk as the pruned database itself.
+static int prune_in_place(const std::string& data_dir, network_type net_type, uint64_t db_flags, size_t step_records, uint64_t pause_ms, bool compact)
+{
+  fs::path path;
+  {
+    blockchain_objects_t blockchain_objects = {};
+    Blockchain *core_storage = &blockchain_objects.m_blockchain;
+    BlockchainDB *db = new_db();
+    if (db == NULL)
+    {
+      MERROR("Failed to initialize a database");
+      return 1;
+    }
+    path = fs::u8path(data_dir) / db->get_db_name();
+    MINFO("Loading blockchain from folder " << path << " ...");
+    try
+    {
+      db->open(path.string(), net_type, db_flags);
+    }
+    catch (const std::exception& e)
+    {
+      MERROR("Error opening database: " << e.what());
+      return 1;
+    }
+    if (!core_storage->init(db, nullptr /*ons_db*/, net_type))
+    {
+      MERROR("Failed to initialize blockchain storage");
+      return 1;
+    }
+
+    MINFO("Pruning in place, " << step_records << " txs at a time...");
+    uint64_t steps = 0;
+    while (!db->prune_blockchain_step(0, step_records))
+    {
+      if (++steps % 100 == 0)
+        MINFO("Pruned " << steps * step_records << " txs so far");
+      if (pause_ms)
+        std::this_thread::sleep_for(std::chrono::milliseconds(pause_ms));
+    }
+    MINFO("Blockchain pruned in place, pruning seed " << epee::string_tools::to_string_hex(db->get_blockchain_pruning_seed()));
+    core_storage->deinit();
+  }
+
+  if (!compact)
+    return 0;
+
+  fs::path compacted = path;
+  compacted += "-compact";
+  if (fs::exists(compacted))
+  {
+    MERROR(compacted << " already exists, remove it first");
+    return 1;
+  }
+  if (!fs::create_directories(compacted))
+  {
+    MERROR("Failed to create directory: " << compacted.string());
+    return 1;
+  }
+
+  MINFO("Writing compacted copy to " << compacted << " ...");
+  MDB_env *env = NULL;
+  open(env, path, db_flags, true);
+  int dbr = mdb_env_copy2(env, compacted.string().c_str(), MDB_CP_COMPACT);
+  close(env);
+  if (dbr)
+  {
+    MERROR("Failed to compact database: " << mdb_strerror(dbr));
+    return 1;
+  }
+
+  MINFO("Swapping databases, uncompacted blockchain will be left in " << path.string() + "-old and can be removed if desired");
+  fs::path old = path;
+  old += "-old";
+  if (replace_file(path, old) || replace_file(compacted, path))
+  {
+    MERROR("Blockchain compacted OK, but renaming failed");
+    return 1;
+  }
+  return 0;
+}
+
 int main(int argc, char* argv[])
 {
   TRY_ENTRY();
@@ -454,6 +538,10 @@ int main(int argc, char* argv[])
   , "fast:1000"
   };
   const command_line::arg_descriptor<bool> arg_copy_pruned_database  = {"copy-pruned-database",  "Copy database anyway if already pruned"};
+  const command_line::arg_descriptor<bool> arg_in_place  = {"in-place",  "Prune the database in place in small steps instead of copying it; can be interrupted and resumed"};
+  const command_line::arg_descriptor<size_t> arg_step_records  = {"step-records",  "Txs to look at per write txn with --in-place", 4096};
+  const command_line::arg_descriptor<uint64_t> arg_step_pause  = {"step-pause-ms",  "Milliseconds to pause between steps with --in-place", 0};
+  const command_line::arg_descriptor<bool> arg_compact  = {"compact",  "After pruning with --in-place, swap in a compacted copy of the database to give back the freed space"};
 
   command_line::add_arg(desc_cmd_sett, cryptonote::arg_data_dir);
   command_line::add_arg(desc_cmd_sett, cryptonote::arg_testnet_on);
@@ -461,6 +549,10 @@ int main(int argc, char* argv[])
   command_line::add_arg(desc_cmd_sett, arg_log_level);
   command_line::add_arg(desc_cmd_sett, arg_db_sync_mode);
   command_line::add_arg(desc_cmd_sett, arg_copy_pruned_database);
+  command_line::add_arg(desc_cmd_sett, arg_in_place);
+  command_line::add_arg(desc_cmd_sett, arg_step_records);
+  command_line::add_arg(desc_cmd_sett, arg_step_pause);
+  command_line::add_arg(desc_cmd_sett, arg_compact);
   command_line::add_arg(desc_cmd_only, command_line::arg_help);
 
   po::options_description desc_options("Allowed options");
@@ -508,6 +600,12 @@ int main(int argc, char* argv[])
     return 1;
   }
 
+  if (command_line::get_arg(vm, arg_in_place))
+  {
+    return prune_in_place(data_dir, net_type, db_flags, std::max<size_t>(command_line::get_arg(vm, arg_step_records), 1),
+        command_line::get_arg(vm, arg_step_pause), command_line::get_arg(vm, arg_compact));
+  }
+
   // If we wanted to use the memory pool, we would set up a fake_core.
 
   // Use Blockchain instead of lower-level BlockchainDB for two reasons:
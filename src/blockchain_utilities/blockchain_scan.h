@@ -0,0 +1,175 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "blockchain_db/blockchain_db.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "epee/misc_log_ex.h"
+
+namespace tools {
+
+  /// A block and its (pruned) transactions, as handed to a scan_blocks callback.
+  struct scanned_block
+  {
+    uint64_t height;
+    cryptonote::block block;
+    size_t blob_size;                           // size of the block blob
+    std::vector<cryptonote::transaction> txs;   // in block.tx_hashes order
+    std::vector<size_t> tx_blob_sizes;          // sizes of the pruned tx blobs
+  };
+
+  namespace detail {
+    inline bool read_scanned_block(cryptonote::BlockchainDB& db, uint64_t height, scanned_block& sb)
+    {
+      sb.height = height;
+      cryptonote::blobdata bd = db.get_block_blob_from_height(height);
+      if (!cryptonote::parse_and_validate_block_from_blob(bd, sb.block))
+      {
+        MERROR("Bad block from db at height " << height);
+        return false;
+      }
+      sb.blob_size = bd.size();
+      sb.txs.resize(sb.block.tx_hashes.size());
+      sb.tx_blob_sizes.resize(sb.block.tx_hashes.size());
+      for (size_t i = 0; i < sb.block.tx_hashes.size(); i++)
+      {
+        const crypto::hash& tx_id = sb.block.tx_hashes[i];
+        if (tx_id == crypto::null_hash || !db.get_pruned_tx_blob(tx_id, bd))
+        {
+          MERROR("Tx " << tx_id << " of block " << height << " not found in db");
+          return false;
+        }
+        if (!cryptonote::parse_and_validate_tx_base_from_blob(bd, sb.txs[i]))
+        {
+          MERROR("Bad tx " << tx_id << " from db");
+          return false;
+        }
+        sb.tx_blob_sizes[i] = bd.size();
+      }
+      return true;
+    }
+  }
+
+  /// Reads and parses the blocks in [start, stop) on `threads` worker threads, for the blockchain
+  /// utilities that aggregate something over the whole chain.
+  ///
+  /// The range is split into chunks of `chunk_size` blocks.  Each worker takes the next chunk,
+  /// holds its own read txn while it reads the chunk's blocks and txs, and calls
+  /// `process(Accumulator&, scanned_block&)` for each block with an accumulator that is new for the
+  /// chunk.  Finished accumulators are passed to `merge(Accumulator&&)` on the calling thread in
+  /// height order, so merging may depend on chain order; workers wait rather than run more than
+  /// two chunks per thread ahead of the merge.  `merge` returns false to stop the scan.
+  ///
+  /// Returns true if every block was processed and merged; false if the scan was stopped, or if a
+  /// block or tx could not be read or parsed or a callback threw (which gets logged).
+  template <typename Accumulator, typename Process, typename Merge>
+  bool scan_blocks(cryptonote::BlockchainDB& db, uint64_t start, uint64_t stop, unsigned threads, Process process, Merge merge, uint64_t chunk_size = 100)
+  {
+    if (start >= stop)
+      return true;
+    threads = std::max(threads, 1u);
+    const uint64_t chunks = (stop - start + chunk_size - 1) / chunk_size;
+    const uint64_t max_pending = 2 * threads;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::map<uint64_t, Accumulator> finished;
+    uint64_t next_chunk = 0, next_merge = 0;
+    bool failed = false, stopping = false;
+
+    auto worker = [&] {
+      for (;;)
+      {
+        uint64_t chunk;
+        {
+          std::unique_lock lock{mutex};
+          cv.wait(lock, [&] { return stopping || next_chunk >= chunks || next_chunk < next_merge + max_pending; });
+          if (stopping || next_chunk >= chunks)
+            return;
+          chunk = next_chunk++;
+        }
+
+        Accumulator acc{};
+        bool ok = true;
+        try
+        {
+          cryptonote::db_rtxn_guard txn_guard{db};
+          const uint64_t from = start + chunk * chunk_size, to = std::min(stop, from + chunk_size);
+          for (uint64_t height = from; ok && height < to; height++)
+          {
+            scanned_block sb{};
+            ok = detail::read_scanned_block(db, height, sb);
+            if (ok)
+              process(acc, sb);
+          }
+        }
+        catch (const std::exception& e)
+        {
+          MERROR("Failed to scan blocks: " << e.what());
+          ok = false;
+        }
+
+        {
+          std::lock_guard lock{mutex};
+          if (ok)
+            finished.emplace(chunk, std::move(acc));
+          else
+            failed = stopping = true;
+        }
+        cv.notify_all();
+      }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    for (unsigned i = 0; i < threads; i++)
+      workers.emplace_back(worker);
+
+    for (uint64_t chunk = 0; chunk < chunks; chunk++)
+    {
+      std::unique_lock lock{mutex};
+      cv.wait(lock, [&] { return stopping || finished.count(chunk); });
+      if (stopping)
+        break;
+      auto acc = std::move(finished.extract(chunk).mapped());
+      lock.unlock();
+
+      bool keep_going = false, merged = false;
+      try
+      {
+        keep_going = merge(std::move(acc));
+        merged = true;
+      }
+      catch (const std::exception& e)
+      {
+        MERROR("Failed to merge scanned blocks: " << e.what());
+      }
+
+      lock.lock();
+      if (merged)
+        next_merge = chunk + 1;
+      else
+        failed = true;
+      if (!keep_going)
+        stopping = true;
+      lock.unlock();
+      cv.notify_all();
+    }
+
+    {
+      std::lock_guard lock{mutex};
+      stopping = true;
+    }
+    cv.notify_all();
+    for (auto& t : workers)
+      t.join();
+
+    return !failed && next_merge == chunks;
+  }
+
+}
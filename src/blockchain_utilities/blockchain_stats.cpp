@@ -30,9 +30,11 @@
 #include "common/command_line.h"
 #include "common/varint.h"
 #include "common/signal_handler.h"
+#include "common/util.h"
 #include "cryptonote_basic/cryptonote_boost_serialization.h"
 #include "cryptonote_core/cryptonote_core.h"
 #include "blockchain_objects.h"
+#include "blockchain_scan.h"
 #include "blockchain_db/blockchain_db.h"
 #include "version.h"
 #include "epee/misc_os_dependent.h"
@@ -46,6 +48,19 @@ using namespace cryptonote;
 
 static bool stop_requested = false;
 
+namespace {
+  // What the stats need from each block, collected by the scan threads
+  struct block_stats
+  {
+    struct tx_stats { uint32_t ins, outs, ring; }; // ring is 0 for a tx without inputs
+
+    uint64_t height;
+    uint64_t timestamp;
+    uint64_t bytes; // block and tx blobs
+    std::vector<tx_stats> txs;
+  };
+}
+
 int main(int argc, char* argv[])
 {
   TRY_ENTRY();
@@ -69,6 +84,7 @@ int main(int argc, char* argv[])
   const command_line::arg_descriptor<bool> arg_outputs  = {"with-outputs", "with output stats", false};
   const command_line::arg_descriptor<bool> arg_ringsize  = {"with-ringsize", "with ringsize stats", false};
   const command_line::arg_descriptor<bool> arg_hours  = {"with-hours", "with txns per hour", false};
+  const command_line::arg_descriptor<unsigned> arg_threads = {"threads", "number of threads used to read and parse blocks (0 = one per core)", 0};
 
   command_line::add_arg(desc_cmd_sett, cryptonote::arg_data_dir);
   command_line::add_arg(desc_cmd_sett, cryptonote::arg_testnet_on);
@@ -80,6 +96,7 @@ int main(int argc, char* argv[])
   command_line::add_arg(desc_cmd_sett, arg_outputs);
   command_line::add_arg(desc_cmd_sett, arg_ringsize);
   command_line::add_arg(desc_cmd_sett, arg_hours);
+  command_line::add_arg(desc_cmd_sett, arg_threads);
   command_line::add_arg(desc_cmd_only, command_line::arg_help);
 
   po::options_description desc_options("Allowed options");
@@ -121,6 +138,9 @@ int main(int argc, char* argv[])
   bool do_outputs = command_line::get_arg(vm, arg_outputs);
   bool do_ringsize = command_line::get_arg(vm, arg_ringsize);
   bool do_hours = command_line::get_arg(vm, arg_hours);
+  unsigned threads = command_line::get_arg(vm, arg_threads);
+  if (!threads)
+    threads = tools::get_max_concurrency();
 
   LOG_PRINT_L0("Initializing source blockchain (BlockchainDB)");
   blockchain_objects_t blockchain_objects = {};
@@ -205,111 +225,111 @@ plot 'stats.csv' index "DATA" using (timecolumn(1,"%Y-%m-%d")):4 with lines, ''
   uint32_t txhr[24] = {0};
   unsigned int i;
 
-  for (uint64_t h = block_start; h < block_stop; ++h)
+  const auto process = [&](std::vector<block_stats>& stats, tools::scanned_block& sb)
   {
-    cryptonote::blobdata bd = db->get_block_blob_from_height(h);
-    cryptonote::block blk;
-    if (!cryptonote::parse_and_validate_block_from_blob(bd, blk))
+    auto& bs = stats.emplace_back();
+    bs.height = sb.height;
+    bs.timestamp = sb.block.timestamp;
+    bs.bytes = sb.blob_size;
+    bs.txs.reserve(sb.txs.size());
+    for (size_t t = 0; t < sb.txs.size(); t++)
     {
-      LOG_PRINT_L0("Bad block from db");
-      return 1;
+      const transaction& tx = sb.txs[t];
+      bs.bytes += sb.tx_blob_sizes[t];
+      auto& ts = bs.txs.emplace_back();
+      ts.ins = tx.vin.size();
+      ts.outs = tx.vout.size();
+      ts.ring = do_ringsize && !tx.vin.empty() ? var::get<cryptonote::txin_to_key>(tx.vin[0]).key_offsets.size() : 0;
     }
-    time_t tt = blk.timestamp;
-    char timebuf[64];
-    epee::misc_utils::get_gmt_time(tt, currtm);
-    if (!prevtm.tm_year)
-      prevtm = currtm;
-    // catch change of day
-    if (currtm.tm_mday > prevtm.tm_mday || (currtm.tm_mday == 1 && prevtm.tm_mday > 27))
+  };
+
+  const auto merge = [&](std::vector<block_stats>&& stats)
+  {
+    for (const block_stats& bs : stats)
     {
-      // check for timestamp fudging around month ends
-      if (prevtm.tm_mday == 1 && currtm.tm_mday > 27)
-        goto skip;
-      strftime(timebuf, sizeof(timebuf), "%Y-%m-%d", &prevtm);
-      prevtm = currtm;
-      std::cout << timebuf << "\t" << currblks << "\t" << h << "\t" << currtxs << "\t" << prevtxs + currtxs << "\t" << currsz << "\t" << prevsz + currsz;
-      prevsz += currsz;
-      currsz = 0;
-      currblks = 0;
-      prevtxs += currtxs;
-      currtxs = 0;
-      if (!tottxs)
-        tottxs = 1;
-      if (do_inputs) {
-        std::cout << "\t" << (maxins ? minins : 0) << "\t" << maxins << "\t" << totins / tottxs;
-        minins = 10; maxins = 0; totins = 0;
-      }
-      if (do_outputs) {
-        std::cout << "\t" << (maxouts ? minouts : 0) << "\t" << maxouts << "\t" << totouts / tottxs;
-        minouts = 10; maxouts = 0; totouts = 0;
-      }
-      if (do_ringsize) {
-        std::cout << "\t" << (maxrings ? minrings : 0) << "\t" << maxrings << "\t" << totrings / tottxs;
-        minrings = 50; maxrings = 0; totrings = 0;
-      }
-      tottxs = 0;
-      if (do_hours) {
-        for (i=0; i<24; i++) {
-          std::cout << "\t" << txhr[i];
-          txhr[i] = 0;
+      const uint64_t h = bs.height;
+      time_t tt = bs.timestamp;
+      char timebuf[64];
+      epee::misc_utils::get_gmt_time(tt, currtm);
+      if (!prevtm.tm_year)
+        prevtm = currtm;
+      // catch change of day
+      if (currtm.tm_mday > prevtm.tm_mday || (currtm.tm_mday == 1 && prevtm.tm_mday > 27))
+      {
+        // check for timestamp fudging around month ends
+        if (prevtm.tm_mday == 1 && currtm.tm_mday > 27)
+          goto skip;
+        strftime(timebuf, sizeof(timebuf), "%Y-%m-%d", &prevtm);
+        prevtm = currtm;
+        std::cout << timebuf << "\t" << currblks << "\t" << h << "\t" << currtxs << "\t" << prevtxs + currtxs << "\t" << currsz << "\t" << prevsz + currsz;
+        prevsz += currsz;
+        currsz = 0;
+        currblks = 0;
+        prevtxs += currtxs;
+        currtxs = 0;
+        if (!tottxs)
+          tottxs = 1;
+        if (do_inputs) {
+          std::cout << "\t" << (maxins ? minins : 0) << "\t" << maxins << "\t" << totins / tottxs;
+          minins = 10; maxins = 0; totins = 0;
+        }
+        if (do_outputs) {
+          std::cout << "\t" << (maxouts ? minouts : 0) << "\t" << maxouts << "\t" << totouts / tottxs;
+          minouts = 10; maxouts = 0; totouts = 0;
         }
+        if (do_ringsize) {
+          std::cout << "\t" << (maxrings ? minrings : 0) << "\t" << maxrings << "\t" << totrings / tottxs;
+          minrings = 50; maxrings = 0; totrings = 0;
+        }
+        tottxs = 0;
+        if (do_hours) {
+          for (i=0; i<24; i++) {
+            std::cout << "\t" << txhr[i];
+            txhr[i] = 0;
+          }
+        }
+        std::cout << "\n";
       }
-      std::cout << "\n";
-    }
 skip:
-    currsz += bd.size();
-    for (const auto& tx_id : blk.tx_hashes)
-    {
-      if (tx_id == crypto::null_hash)
-      {
-        throw std::runtime_error("Aborting: tx == null_hash");
-      }
-      if (!db->get_pruned_tx_blob(tx_id, bd))
+      currsz += bs.bytes;
+      for (const auto& ts : bs.txs)
       {
-        throw std::runtime_error("Aborting: tx not found");
-      }
-      transaction tx;
-      if (!parse_and_validate_tx_base_from_blob(bd, tx))
-      {
-        LOG_PRINT_L0("Bad txn from db");
-        return 1;
-      }
-      currsz += bd.size();
-      currtxs++;
-      if (do_hours)
-        txhr[currtm.tm_hour]++;
-      if (do_inputs) {
-        io = tx.vin.size();
-        if (io < minins)
-          minins = io;
-        else if (io > maxins)
-          maxins = io;
-        totins += io;
-      }
-      if (do_ringsize) {
-        const auto& tx_in_to_key = var::get<cryptonote::txin_to_key>(tx.vin[0]);
-        io = tx_in_to_key.key_offsets.size();
-        if (io < minrings)
-          minrings = io;
-        else if (io > maxrings)
-          maxrings = io;
-        totrings += io;
-      }
-      if (do_outputs) {
-        io = tx.vout.size();
-        if (io < minouts)
-          minouts = io;
-        else if (io > maxouts)
-          maxouts = io;
-        totouts += io;
+        currtxs++;
+        if (do_hours)
+          txhr[currtm.tm_hour]++;
+        if (do_inputs) {
+          io = ts.ins;
+          if (io < minins)
+            minins = io;
+          else if (io > maxins)
+            maxins = io;
+          totins += io;
+        }
+        if (do_ringsize && ts.ring) {
+          io = ts.ring;
+          if (io < minrings)
+            minrings = io;
+          else if (io > maxrings)
+            maxrings = io;
+          totrings += io;
+        }
+        if (do_outputs) {
+          io = ts.outs;
+          if (io < minouts)
+            minouts = io;
+          else if (io > maxouts)
+            maxouts = io;
+          totouts += io;
+        }
+        tottxs++;
       }
-      tottxs++;
+      currblks++;
     }
-    currblks++;
+    return !stop_requested;
+  };
 
-    if (stop_requested)
-      break;
-  }
+  if (!tools::scan_blocks<std::vector<block_stats>>(*db, block_start, block_stop, threads, process, merge) && !stop_requested)
+    return 1;
 
   core_storage->deinit();
   return 0;
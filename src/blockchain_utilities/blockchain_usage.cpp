@@ -29,8 +29,10 @@
 
 #include "common/command_line.h"
 #include "common/varint.h"
+#include "common/util.h"
 #include "cryptonote_core/cryptonote_core.h"
 #include "blockchain_objects.h"
+#include "blockchain_scan.h"
 #include "blockchain_db/blockchain_db.h"
 #include "cryptonote_core/uptime_proof.h"
 #include "version.h"
@@ -90,12 +92,14 @@ int main(int argc, char* argv[])
   const command_line::arg_descriptor<std::string> arg_log_level  = {"log-level",  "0-4 or categories", ""};
   const command_line::arg_descriptor<bool> arg_rct_only  = {"rct-only", "Only work on ringCT outputs", false};
   const command_line::arg_descriptor<std::string> arg_input = {"input", ""};
+  const command_line::arg_descriptor<unsigned> arg_threads = {"threads", "number of threads used to read and parse blocks (0 = one per core)", 0};
 
   command_line::add_arg(desc_cmd_sett, cryptonote::arg_testnet_on);
   command_line::add_arg(desc_cmd_sett, cryptonote::arg_devnet_on);
   command_line::add_arg(desc_cmd_sett, arg_log_level);
   command_line::add_arg(desc_cmd_sett, arg_rct_only);
   command_line::add_arg(desc_cmd_sett, arg_input);
+  command_line::add_arg(desc_cmd_sett, arg_threads);
   command_line::add_arg(desc_cmd_only, command_line::arg_help);
 
   po::options_description desc_options("Allowed options");
@@ -134,6 +138,9 @@ int main(int argc, char* argv[])
   bool opt_devnet = command_line::get_arg(vm, cryptonote::arg_devnet_on);
   network_type net_type = opt_testnet ? TESTNET : opt_devnet ? DEVNET : MAINNET;
   bool opt_rct_only = command_line::get_arg(vm, arg_rct_only);
+  unsigned threads = command_line::get_arg(vm, arg_threads);
+  if (!threads)
+    threads = tools::get_max_concurrency();
 
   // If we wanted to use the memory pool, we would set up a fake_core.
 
@@ -184,10 +191,20 @@ int main(int argc, char* argv[])
   std::unordered_map<uint64_t,uint64_t> indices;
 
   LOG_PRINT_L0("Reading blockchain from " << input);
-  core_storage->for_all_transactions([&](const crypto::hash &hash, const cryptonote::transaction &tx)->bool
+  // The scan threads hand over each block's transactions (miner tx first) in chain order
+  using block_txs = std::pair<uint64_t, std::vector<cryptonote::transaction>>;
+  const auto process = [](std::vector<block_txs>& blocks, tools::scanned_block& sb)
+  {
+    auto& [height, txs] = blocks.emplace_back(sb.height, std::vector<cryptonote::transaction>{});
+    txs.reserve(1 + sb.txs.size());
+    txs.push_back(std::move(sb.block.miner_tx));
+    for (auto& tx : sb.txs)
+      txs.push_back(std::move(tx));
+  };
+
+  const auto add_tx = [&](const cryptonote::transaction &tx, const uint64_t height)
   {
     const bool coinbase = tx.vin.size() == 1 && std::holds_alternative<txin_gen>(tx.vin[0]);
-    const uint64_t height = core_storage->get_db().get_tx_block_height(hash);
 
     // create new outputs
     for (const auto &out: tx.vout)
@@ -213,8 +230,21 @@ int main(int argc, char* argv[])
         outputs[od].push_back(reference(height, txin->key_offsets.size(), n));
       }
     }
+  };
+
+  const auto merge = [&](std::vector<block_txs>&& blocks)
+  {
+    for (const auto& [height, txs] : blocks)
+      for (const auto& tx : txs)
+        add_tx(tx, height);
     return true;
-  }, true);
+  };
+
+  if (!tools::scan_blocks<std::vector<block_txs>>(*db, 0, db->height(), threads, process, merge))
+  {
+    LOG_PRINT_L0("Failed to read the blockchain");
+    return 1;
+  }
 
   std::unordered_map<uint64_t, uint64_t> counts;
   size_t total = 0;
@@ -31,6 +31,9 @@
 #include "serialization/binary_utils.h" // dump_binary(), parse_binary()
 
 #include "bootstrap_file.h"
+#include "common/hex.h"
+
+#include <thread>
 
 #undef OXEN_DEFAULT_LOG_CATEGORY
 #define OXEN_DEFAULT_LOG_CATEGORY "bcutil"
@@ -47,6 +50,9 @@ namespace
   const uint32_t header_size = 1024;
 
   std::string refresh_string = "\r                                    \r";
+
+  // Number of blocks each worker thread loads per batch in a multithreaded export
+  constexpr uint64_t BLOCKS_PER_EXPORT_THREAD = 100;
 }
 
 
@@ -125,7 +131,7 @@ bool BootstrapFile::initialize_file()
 
   bootstrap::file_info bfi;
   bfi.major_version = 0;
-  bfi.minor_version = 1;
+  bfi.minor_version = m_v2 ? 2 : 1;
   bfi.header_size = header_size;
 
   bootstrap::blocks_info bbi;
@@ -210,8 +216,25 @@ void BootstrapFile::flush_chunk()
   MDEBUG("flushed chunk:  chunk_size: " << chunk_size);
 }
 
-void BootstrapFile::write_block(block& block)
+blobdata BootstrapFile::serialize_block(const block& block) const
 {
+  if (m_v2)
+  {
+    const auto& db = m_blockchain_storage->get_db();
+    const uint64_t block_height = var::get<txin_gen>(block.miner_tx.vin.front()).height;
+    bootstrap::block_package_v2 bp;
+    bp.block = db.get_block_blob_from_height(block_height);
+    bp.txs.resize(block.tx_hashes.size());
+    for (size_t i = 0; i < block.tx_hashes.size(); i++)
+      if (!db.get_tx_blob(block.tx_hashes[i], bp.txs[i]))
+        throw std::runtime_error("Aborting: tx " + tools::type_to_hex(block.tx_hashes[i]) + " not found");
+    bp.block_weight = db.get_block_weight(block_height);
+    bp.long_term_block_weight = db.get_block_long_term_weight(block_height);
+    bp.cumulative_difficulty = db.get_block_cumulative_difficulty(block_height);
+    bp.coins_generated = db.get_block_already_generated_coins(block_height);
+    return t_serializable_object_to_blob(bp);
+  }
+
   bootstrap::block_package bp;
   bp.block = block;
 
@@ -248,10 +271,53 @@ void BootstrapFile::write_block(block& block)
     bp.coins_generated = coins_generated;
   }
 
-  blobdata bd = t_serializable_object_to_blob(bp);
+  return t_serializable_object_to_blob(bp);
+}
+
+void BootstrapFile::write_block_blob(const blobdata& bd)
+{
   m_output_stream->write((const char*)bd.data(), bd.size());
 }
 
+void BootstrapFile::write_block(block& block)
+{
+  write_block_blob(serialize_block(block));
+}
+
+void BootstrapFile::load_blocks_parallel(uint64_t start, uint64_t end, unsigned num_threads, std::vector<blobdata>& blobs) const
+{
+  blobs.clear();
+  blobs.resize(end - start);
+  const uint64_t per_thread = (end - start + num_threads - 1) / num_threads;
+  std::vector<std::exception_ptr> errors(num_threads);
+  std::vector<std::thread> workers;
+  workers.reserve(num_threads);
+  for (unsigned t = 0; t < num_threads; t++)
+  {
+    const uint64_t from = start + t * per_thread, to = std::min(end, from + per_thread);
+    if (from >= to)
+      break;
+    workers.emplace_back([this, from, to, start, &blobs, &error = errors[t]] {
+      try
+      {
+        auto& db = m_blockchain_storage->get_db();
+        db_rtxn_guard rtxn_guard{db};
+        for (uint64_t h = from; h < to; ++h)
+          blobs[h - start] = serialize_block(db.get_block_from_height(h));
+      }
+      catch (...)
+      {
+        error = std::current_exception();
+      }
+    });
+  }
+  for (auto& w : workers)
+    w.join();
+  for (auto& e : errors)
+    if (e)
+      std::rethrow_exception(e);
+}
+
 bool BootstrapFile::close()
 {
   if (m_raw_data_file->fail())
@@ -264,7 +330,7 @@ bool BootstrapFile::close()
 }
 
 
-bool BootstrapFile::store_blockchain_raw(Blockchain* _blockchain_storage, tx_memory_pool* _tx_pool, fs::path& output_file, uint64_t requested_block_stop)
+bool BootstrapFile::store_blockchain_raw(Blockchain* _blockchain_storage, tx_memory_pool* _tx_pool, fs::path& output_file, uint64_t requested_block_stop, unsigned num_threads, bool v2)
 {
   uint64_t num_blocks_written = 0;
   m_max_chunk = 0;
@@ -272,11 +338,19 @@ bool BootstrapFile::store_blockchain_raw(Blockchain* _blockchain_storage, tx_mem
   m_tx_pool = _tx_pool;
   uint64_t progress_interval = 100;
   MINFO("Storing blocks raw data...");
+  m_v2 = v2;
   if (!BootstrapFile::open_writer(output_file))
   {
     MFATAL("failed to open raw file for write");
     return false;
   }
+  // open_writer picks up the format of a file it appends to
+  if (m_v2 != v2)
+  {
+    MFATAL("Existing bootstrap file is v0." << (m_v2 ? 2 : 1) << ", cannot append v0." << (v2 ? 2 : 1) << " blocks to it");
+    BootstrapFile::close();
+    return false;
+  }
   block b;
 
   // block_start, block_stop use 0-based height. m_height uses 1-based height. So to resume export
@@ -295,12 +369,28 @@ bool BootstrapFile::store_blockchain_raw(Blockchain* _blockchain_storage, tx_mem
     block_stop = m_blockchain_storage->get_current_blockchain_height() - 1;
     MINFO("Using block height of source blockchain: " << block_stop);
   }
+  if (num_threads > 1)
+    MINFO("Loading blocks using " << num_threads << " threads");
+  std::vector<blobdata> batch;
+  uint64_t batch_start = block_start;
   for (m_cur_height = block_start; m_cur_height <= block_stop; ++m_cur_height)
   {
     // this method's height refers to 0-based height (genesis block = height 0)
-    crypto::hash hash = m_blockchain_storage->get_block_id_by_height(m_cur_height);
-    m_blockchain_storage->get_block_by_hash(hash, b);
-    write_block(b);
+    if (num_threads > 1)
+    {
+      if (m_cur_height >= batch_start + batch.size())
+      {
+        batch_start = m_cur_height;
+        load_blocks_parallel(batch_start, std::min(block_stop + 1, batch_start + num_threads * BLOCKS_PER_EXPORT_THREAD), num_threads, batch);
+      }
+      write_block_blob(batch[m_cur_height - batch_start]);
+    }
+    else
+    {
+      crypto::hash hash = m_blockchain_storage->get_block_id_by_height(m_cur_height);
+      m_blockchain_storage->get_block_by_hash(hash, b);
+      write_block(b);
+    }
     if (m_cur_height % NUM_BLOCKS_PER_CHUNK == 0) {
       flush_chunk();
       num_blocks_written += NUM_BLOCKS_PER_CHUNK;
@@ -377,6 +467,12 @@ uint64_t BootstrapFile::seek_to_first_chunk(fs::ifstream& import_file)
     throw std::runtime_error("Error in deserialization of bootstrap::file_info: "s + e.what());
   }
   MINFO("bootstrap file v" << unsigned(bfi.major_version) << "." << unsigned(bfi.minor_version));
+  if (bfi.major_version != 0)
+  {
+    MFATAL("unsupported bootstrap file version");
+    throw std::runtime_error("Aborting");
+  }
+  m_v2 = bfi.minor_version >= 2;
   MINFO("bootstrap magic size: " << sizeof(file_magic));
   MINFO("bootstrap header size: " << bfi.header_size);
 
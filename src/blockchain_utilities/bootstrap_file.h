@@ -61,8 +61,17 @@ public:
   uint64_t count_blocks(const fs::path& dir_path);
   uint64_t seek_to_first_chunk(fs::ifstream& import_file);
 
+  // If num_threads is greater than 1 then blocks are loaded and serialized by that many worker
+  // threads (each with its own read txn) and appended by the calling thread in height order; the
+  // output is identical to a single-threaded export.
+  //
+  // If v2 is true the file is written in the v0.2 format (bootstrap::block_package_v2 chunks);
+  // appending to an existing file requires it to be in the same format.
   bool store_blockchain_raw(cryptonote::Blockchain* cs, cryptonote::tx_memory_pool* txp,
-      fs::path& output_file, uint64_t use_block_height=0);
+      fs::path& output_file, uint64_t use_block_height=0, unsigned num_threads=1, bool v2=false);
+
+  // Whether the file last opened by seek_to_first_chunk is in the v0.2 format
+  bool is_v2() const { return m_v2; }
 
 protected:
 
@@ -79,11 +88,17 @@ protected:
   bool initialize_file();
   bool close();
   void write_block(block& block);
+  void write_block_blob(const blobdata& bp_blob);
+  // Loads the txs and extra data for a block and serializes it as a bootstrap::block_package.
+  // Only touches the db, so can be called concurrently from multiple threads.
+  blobdata serialize_block(const block& block) const;
   void flush_chunk();
+  void load_blocks_parallel(uint64_t start, uint64_t end, unsigned num_threads, std::vector<blobdata>& blobs) const;
 
 private:
 
   uint64_t m_height;
   uint64_t m_cur_height; // tracks current height during export
   uint32_t m_max_chunk;
+  bool m_v2 = false;
 };
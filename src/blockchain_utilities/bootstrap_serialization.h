@@ -29,7 +29,9 @@
 #pragma once
 
 #include "cryptonote_basic/cryptonote_boost_serialization.h"
+#include "cryptonote_basic/blobdatatype.h"
 #include "cryptonote_basic/difficulty.h"
+#include "serialization/string.h"
 
 
 namespace cryptonote
@@ -83,6 +85,28 @@ namespace cryptonote
       END_SERIALIZE()
     };
 
+    // Chunk of a v0.2 bootstrap file: the block and full tx blobs as stored in the db, plus the
+    // other per-block records, so that an unverified import can write them to the db without
+    // re-serializing anything or reading back earlier blocks.
+    struct block_package_v2
+    {
+      cryptonote::blobdata block;
+      std::vector<cryptonote::blobdata> txs; // in block.tx_hashes order
+      uint64_t block_weight;
+      uint64_t long_term_block_weight;
+      difficulty_type cumulative_difficulty;
+      uint64_t coins_generated;
+
+      BEGIN_SERIALIZE()
+        FIELD(block)
+        FIELD(txs)
+        VARINT_FIELD(block_weight)
+        VARINT_FIELD(long_term_block_weight)
+        VARINT_FIELD(cumulative_difficulty)
+        VARINT_FIELD(coins_generated)
+      END_SERIALIZE()
+    };
+
   }
 
 }
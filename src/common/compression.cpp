@@ -0,0 +1,63 @@
+#include "compression.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <zlib.h>
+
+#include "common/oxen.h"
+
+namespace tools {
+
+std::string compress(std::string_view data, bool gzip)
+{
+  z_stream zs{};
+  // 15 window bits for zlib output; +16 asks for a gzip header and trailer instead
+  if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, gzip ? 15 + 16 : 15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    throw std::runtime_error{"Failed to initialize zlib compression"};
+  OXEN_DEFER { deflateEnd(&zs); };
+
+  std::string out;
+  out.resize(deflateBound(&zs, data.size()));
+  zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  zs.avail_in = data.size();
+  zs.next_out = reinterpret_cast<Bytef*>(out.data());
+  zs.avail_out = out.size();
+  if (deflate(&zs, Z_FINISH) != Z_STREAM_END)
+    throw std::runtime_error{"Failed to compress data"};
+  out.resize(zs.total_out);
+  return out;
+}
+
+std::optional<std::string> decompress(std::string_view data, size_t max_size)
+{
+  z_stream zs{};
+  // +32 detects a zlib or gzip header
+  if (inflateInit2(&zs, 15 + 32) != Z_OK)
+    return std::nullopt;
+  OXEN_DEFER { inflateEnd(&zs); };
+
+  zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  zs.avail_in = data.size();
+  std::string out;
+  // Deflated blocks and txes typically shrink to a third or so
+  out.resize(std::min(max_size, std::max<size_t>(data.size() * 4, 4096)));
+  for (;;)
+  {
+    zs.next_out = reinterpret_cast<Bytef*>(out.data() + zs.total_out);
+    zs.avail_out = out.size() - zs.total_out;
+    int ret = inflate(&zs, Z_NO_FLUSH);
+    if (ret == Z_STREAM_END)
+      break;
+    if (ret != Z_OK && ret != Z_BUF_ERROR)
+      return std::nullopt;
+    if (zs.avail_out > 0)
+      return std::nullopt; // Out of input before the end of the stream
+    if (out.size() >= max_size)
+      return std::nullopt;
+    out.resize(std::min(max_size, out.size() * 2));
+  }
+  out.resize(zs.total_out);
+  return out;
+}
+
+}
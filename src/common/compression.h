@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace tools {
+
+  // Deflate-compresses the given data with zlib.  With `gzip` the output gets a gzip rather than a
+  // zlib header, as HTTP's "Content-Encoding: gzip" wants.
+  std::string compress(std::string_view data, bool gzip = false);
+
+  // Decompresses zlib or gzip compressed data.  Returns nullopt if the data is corrupt, truncated,
+  // or would decompress to more than `max_size` bytes (so that a small message can't make us
+  // allocate an arbitrary amount of memory).
+  std::optional<std::string> decompress(std::string_view data, size_t max_size);
+
+}
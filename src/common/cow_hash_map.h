@@ -0,0 +1,237 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+namespace tools
+{
+// Hash map whose copies share their storage.  Elements are spread over a fixed number of shards,
+// each held by a shared_ptr, so copying the map copies only the shard pointers; a shard is cloned
+// the first time a copy sharing it is modified.  A copy that then changes a handful of elements
+// costs a handful of (size/Shards element) shards rather than a copy of every element.
+//
+// Modification goes through the non-const find, operator[], at, emplace and erase, each of which
+// unshares just the shard holding the element.  Iteration is const-only; the mutable `iterator`
+// returned by find/emplace refers to a single element and can't be incremented (it converts to a
+// `const_iterator`, and so compares with `end()`).
+//
+// Like the std containers, not thread-safe; copies may however be used and modified independently
+// from different threads.
+template <typename Key, typename Value, typename Hash = std::hash<Key>, size_t Shards = 256>
+class cow_hash_map
+{
+  using shard_t = std::unordered_map<Key, Value, Hash>;
+
+public:
+  using key_type = Key;
+  using mapped_type = Value;
+  using value_type = typename shard_t::value_type;
+
+  class iterator;
+  class const_iterator
+  {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename shard_t::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+    const_iterator() = default;
+
+    reference operator*() const { return *m_it; }
+    pointer operator->() const { return &*m_it; }
+    const_iterator& operator++() { ++m_it; settle(); return *this; }
+    const_iterator operator++(int) { auto copy = *this; ++*this; return copy; }
+
+    friend bool operator==(const const_iterator& a, const const_iterator& b)
+    {
+      return a.m_shard == b.m_shard && (a.m_shard == Shards || a.m_it == b.m_it);
+    }
+    friend bool operator!=(const const_iterator& a, const const_iterator& b) { return !(a == b); }
+
+  private:
+    friend class cow_hash_map;
+    friend class iterator;
+    const_iterator(const cow_hash_map* map, size_t shard, typename shard_t::const_iterator it)
+      : m_map{map}, m_shard{shard}, m_it{it} {}
+
+    // Moves forward, if needed, to the first element at or after the current position
+    void settle()
+    {
+      while (m_shard < Shards)
+      {
+        const auto& s = m_map->m_shards[m_shard];
+        if (s && m_it != s->end())
+          return;
+        if (++m_shard < Shards && m_map->m_shards[m_shard])
+          m_it = m_map->m_shards[m_shard]->begin();
+      }
+    }
+
+    const cow_hash_map* m_map = nullptr;
+    size_t m_shard = Shards;
+    typename shard_t::const_iterator m_it;
+  };
+
+  class iterator
+  {
+  public:
+    using value_type = typename shard_t::value_type;
+
+    value_type& operator*() const { return *m_it; }
+    value_type* operator->() const { return &*m_it; }
+    operator const_iterator() const { return m_shard == Shards ? const_iterator{} : const_iterator{m_map, m_shard, m_it}; }
+
+  private:
+    friend class cow_hash_map;
+    iterator(const cow_hash_map* map, size_t shard, typename shard_t::iterator it)
+      : m_map{map}, m_shard{shard}, m_it{it} {}
+    iterator() = default;
+
+    const cow_hash_map* m_map = nullptr;
+    size_t m_shard = Shards;
+    typename shard_t::iterator m_it;
+  };
+
+  size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+
+  const_iterator begin() const
+  {
+    const_iterator it{this, 0, m_shards[0] ? m_shards[0]->cbegin() : typename shard_t::const_iterator{}};
+    it.settle();
+    return it;
+  }
+  const_iterator end() const { return {}; }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+
+  const_iterator find(const Key& key) const
+  {
+    const size_t i = shard_index(key);
+    if (!m_shards[i])
+      return end();
+    auto it = m_shards[i]->find(key);
+    return it == m_shards[i]->end() ? end() : const_iterator{this, i, it};
+  }
+
+  // Unshares the element's shard only if the element exists
+  iterator find(const Key& key)
+  {
+    const size_t i = shard_index(key);
+    if (!m_shards[i] || !m_shards[i]->count(key))
+      return {};
+    return {this, i, writable(i).find(key)};
+  }
+
+  size_t count(const Key& key) const
+  {
+    const size_t i = shard_index(key);
+    return m_shards[i] ? m_shards[i]->count(key) : 0;
+  }
+
+  const Value& at(const Key& key) const
+  {
+    auto it = find(key);
+    if (it == end())
+      throw std::out_of_range{"cow_hash_map::at: key not found"};
+    return it->second;
+  }
+  Value& at(const Key& key)
+  {
+    auto it = find(key);
+    if (it == end())
+      throw std::out_of_range{"cow_hash_map::at: key not found"};
+    return it->second;
+  }
+
+  Value& operator[](const Key& key)
+  {
+    auto& s = writable(shard_index(key));
+    const size_t before = s.size();
+    auto& v = s[key];
+    m_size += s.size() - before;
+    return v;
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args)
+  {
+    value_type v{std::forward<Args>(args)...};
+    const size_t i = shard_index(v.first);
+    auto [it, inserted] = writable(i).emplace(std::move(v));
+    m_size += inserted;
+    return {iterator{this, i, it}, inserted};
+  }
+
+  void erase(iterator it)
+  {
+    auto& s = m_shards[it.m_shard];
+    if (s.use_count() > 1)
+    {
+      // The map was copied since `it` was obtained, so its shard needs unsharing again
+      erase(Key{it->first});
+      return;
+    }
+    s->erase(it.m_it);
+    m_size--;
+  }
+  size_t erase(const Key& key)
+  {
+    const size_t i = shard_index(key);
+    if (!m_shards[i] || !m_shards[i]->count(key))
+      return 0;
+    writable(i).erase(key);
+    m_size--;
+    return 1;
+  }
+
+  // Calls `f(shard)` with each underlying (non-empty) std::unordered_map.  Copies sharing a shard
+  // pass the same object, so memory accounting over several copies can count each shard once.
+  template <typename F>
+  void for_each_shard(F&& f) const
+  {
+    for (auto& s : m_shards)
+      if (s)
+        f(*s);
+  }
+
+  void clear()
+  {
+    for (auto& s : m_shards)
+      s.reset();
+    m_size = 0;
+  }
+
+private:
+  static size_t shard_index(const Key& key)
+  {
+    // Fold in the high bits: the shards' own buckets are chosen from the low bits of the same hash
+    const uint64_t h = Hash{}(key);
+    return (h ^ (h >> 24) ^ (h >> 48)) % Shards;
+  }
+
+  // Returns shard i, first creating it or cloning it if another copy of the map shares it
+  shard_t& writable(size_t i)
+  {
+    auto& s = m_shards[i];
+    if (!s)
+      s = std::make_shared<shard_t>();
+    else if (s.use_count() > 1)
+      s = std::make_shared<shard_t>(*s);
+    return *s;
+  }
+
+  std::array<std::shared_ptr<shard_t>, Shards> m_shards;
+  size_t m_size = 0;
+};
+
+}
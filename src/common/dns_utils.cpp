@@ -32,14 +32,14 @@
 #include "common/string_util.h"
 #include "unbound.h"
 
+#include <algorithm>
 #include <chrono>
 #include <optional>
 #include <stdexcept>
 #include <cstdlib>
 #include <cstdio>
+#include <thread>
 #include "epee/misc_log_ex.h"
-#include "common/threadpool.h"
-#include "crypto/crypto.h"
 
 #undef OXEN_DEFAULT_LOG_CATEGORY
 #define OXEN_DEFAULT_LOG_CATEGORY "net.dns"
@@ -197,6 +197,32 @@ struct ub_result_deleter {
 
 using ub_result_ptr = std::unique_ptr<ub_result, ub_result_deleter>;
 
+// Answers are cached for their TTL, but never longer than this, and at most this many of them
+constexpr auto max_cache_ttl = 1h;
+constexpr size_t max_cache_entries = 1000;
+
+dns_answer make_answer(const ub_result& result, const char* record_name, std::optional<std::string> (*reader)(const char*, size_t))
+{
+  dns_answer answer;
+  answer.secure = result.secure;
+  answer.bogus = result.bogus;
+  if (result.why_bogus)
+    answer.why_bogus = result.why_bogus;
+  answer.expiry = std::chrono::steady_clock::now() + std::min<std::chrono::steady_clock::duration>(std::chrono::seconds{std::max(result.ttl, 0)}, max_cache_ttl);
+  if (result.havedata)
+  {
+    for (size_t i = 0; result.data[i] != NULL; i++)
+    {
+      if (auto r = (*reader)(result.data[i], result.len[i]))
+      {
+        MINFO("Found \"" << *r << "\" in " << record_name << " record for " << result.qname);
+        answer.records.push_back(std::move(*r));
+      }
+    }
+  }
+  return answer;
+}
+
 void add_anchors(ub_ctx *ctx)
 {
   for (const char* ds : get_builtin_ds())
@@ -272,38 +298,66 @@ DNSResolver::DNSResolver()
 
 std::vector<std::string> DNSResolver::get_record(const std::string& url, int record_type, std::optional<std::string> (*reader)(const char *,size_t), bool& dnssec_available, bool& dnssec_valid)
 {
-  std::vector<std::string> addresses;
   dnssec_available = false;
   dnssec_valid = false;
 
   if (url.find('.') == std::string::npos)
   {
-    return addresses;
+    return {};
   }
 
-  ub_result* result_raw = nullptr;
-  // call DNS resolver, blocking.  if return value not zero, something went wrong
-  if (!ub_resolve(m_ctx, url.c_str(), record_type, DNS_CLASS_IN, &result_raw))
+  auto answer = get_cached(record_type, url);
+  if (!answer)
   {
+    ub_result* result_raw = nullptr;
+    // call DNS resolver, blocking.  if return value not zero, something went wrong
+    if (ub_resolve(m_ctx, url.c_str(), record_type, DNS_CLASS_IN, &result_raw))
+      return {};
     // destructor takes care of cleanup
     ub_result_ptr result{result_raw};
+    answer = make_answer(*result, get_record_name(record_type), reader);
+    cache(record_type, url, *answer);
+  }
+
+  dnssec_available = (answer->secure || answer->bogus);
+  dnssec_valid = answer->secure && !answer->bogus;
+  return std::move(answer->records);
+}
 
-    dnssec_available = (result->secure || result->bogus);
-    dnssec_valid = result->secure && !result->bogus;
-    if (result->havedata)
+std::optional<dns_answer> DNSResolver::get_cached(int record_type, const std::string& hostname)
+{
+  std::lock_guard lock{m_cache_mutex};
+  auto it = m_cache.find({record_type, hostname});
+  if (it == m_cache.end())
+    return std::nullopt;
+  if (it->second.expiry <= std::chrono::steady_clock::now())
+  {
+    m_cache.erase(it);
+    return std::nullopt;
+  }
+  MDEBUG("Using cached " << get_record_name(record_type) << " record(s) for " << hostname);
+  return it->second;
+}
+
+void DNSResolver::cache(int record_type, const std::string& hostname, const dns_answer& answer)
+{
+  const auto now = std::chrono::steady_clock::now();
+  if (answer.expiry <= now)
+    return;
+  std::lock_guard lock{m_cache_mutex};
+  if (m_cache.size() >= max_cache_entries)
+  {
+    for (auto it = m_cache.begin(); it != m_cache.end(); )
     {
-      for (size_t i=0; result->data[i] != NULL; i++)
-      {
-        if (auto res = (*reader)(result->data[i], result->len[i]))
-        {
-          MINFO("Found \"" << *res << "\" in " << get_record_name(record_type) << " record for " << url);
-          addresses.push_back(*res);
-        }
-      }
+      if (it->second.expiry <= now)
+        it = m_cache.erase(it);
+      else
+        ++it;
     }
+    if (m_cache.size() >= max_cache_entries)
+      return;
   }
-
-  return addresses;
+  m_cache.insert_or_assign({record_type, hostname}, answer);
 }
 
 std::vector<std::string> DNSResolver::get_ipv4(const std::string& url, bool& dnssec_available, bool& dnssec_valid)
@@ -327,17 +381,27 @@ namespace {
     int& all_done;
     const std::string& hostname;
     const char* record_name;
-    std::vector<std::string>& results;
+    std::optional<dns_answer>& answer;
     std::optional<std::string> (*reader)(const char*, size_t);
     int async_id{0};
     bool done{false};
-    bool dnssec;
-    bool dnssec_required;
 
-    dns_results(int& a, const std::string& h, const char* rn, std::vector<std::string>& r, std::optional<std::string> (*rdr)(const char*, size_t), bool dnssec, bool dnssec_req)
-      : all_done{a}, hostname{h}, record_name{rn}, results{r}, reader{rdr}, dnssec{dnssec}, dnssec_required{dnssec_req}
+    dns_results(int& a, const std::string& h, const char* rn, std::optional<dns_answer>& ans, std::optional<std::string> (*rdr)(const char*, size_t))
+      : all_done{a}, hostname{h}, record_name{rn}, answer{ans}, reader{rdr}
     {}
   };
+
+  // Returns whether get_many should use `answer` given its DNSSEC options
+  bool dnssec_acceptable(const std::string& hostname, const dns_answer& answer, bool dnssec, bool dnssec_required)
+  {
+    if ((dnssec || dnssec_required) && answer.bogus)
+      MWARNING("resolution of " << hostname << " failed DNSSEC validation: " << answer.why_bogus);
+    else if (dnssec_required && !answer.secure)
+      MWARNING("resolution of " << hostname << " failed: DNSSEC validate is required but is not available");
+    else
+      return true;
+    return false;
+  }
 }
 
 extern "C" void DNSResolver_async_callback(void* data, int err, ub_result* result_raw)
@@ -348,21 +412,8 @@ extern "C" void DNSResolver_async_callback(void* data, int err, ub_result* resul
   res.done = true;
   if (err)
     MWARNING("resolution of " << res.hostname << " failed: " << ub_strerror(err));
-  else if ((res.dnssec || res.dnssec_required) && result->bogus)
-    MWARNING("resolution of " << res.hostname << " failed DNSSEC validation: " << result->why_bogus);
-  else if (res.dnssec_required && !result->secure)
-    MWARNING("resolution of " << res.hostname << " failed: DNSSEC validate is required but is not available");
-  else if (result->havedata)
-  {
-    for (size_t i = 0; result->data[i] != NULL; i++)
-    {
-      if (auto r = (*res.reader)(result->data[i], result->len[i]))
-      {
-        MINFO("Found \"" << *r << "\" in " << res.record_name << " record for " << res.hostname);
-        res.results.push_back(*r);
-      }
-    }
-  }
+  else
+    res.answer = make_answer(*result, res.record_name, res.reader);
 }
 
 std::vector<std::vector<std::string>> DNSResolver::get_many(int type, const std::vector<std::string>& hostnames, std::chrono::milliseconds timeout, bool dnssec, bool dnssec_required)
@@ -375,48 +426,78 @@ std::vector<std::vector<std::string>> DNSResolver::get_many(int type, const std:
   if (hostnames.empty())
     return results;
 
-  int num_done = 0;
-  std::vector<dns_results> result_packs;
-  results.reserve(hostnames.size());
-  result_packs.reserve(hostnames.size());
-  ub_ctx_async(m_ctx, true); // Tells libunbound to use a thread instead of a fork
+  std::vector<std::optional<dns_answer>> answers(hostnames.size());
+  std::vector<size_t> lookups;
+  for (size_t i = 0; i < hostnames.size(); i++)
+  {
+    answers[i] = get_cached(type, hostnames[i]);
+    if (!answers[i])
+      lookups.push_back(i);
+  }
 
-  // Initiate lookups:
-  for (auto& host : hostnames)
+  if (!lookups.empty())
   {
-    auto& pack = result_packs.emplace_back(num_done, host, get_record_name(type), results.emplace_back(), reader, dnssec, dnssec_required);
-    int err = ub_resolve_async(m_ctx, host.c_str(), type, DNS_CLASS_IN, static_cast<void*>(&pack), DNSResolver_async_callback, &pack.async_id);
-    if (err)
+    std::lock_guard lock{m_async_mutex};
+
+    int num_done = 0;
+    std::vector<dns_results> result_packs;
+    result_packs.reserve(lookups.size());
+    ub_ctx_async(m_ctx, true); // Tells libunbound to use a thread instead of a fork
+
+    // Initiate lookups:
+    for (size_t i : lookups)
     {
-      MWARNING("unable to initiate lookup for " << host << ": " << ub_strerror(err));
-      num_done++;
-      pack.done = true;
+      auto& host = hostnames[i];
+      auto& pack = result_packs.emplace_back(num_done, host, get_record_name(type), answers[i], reader);
+      int err = ub_resolve_async(m_ctx, host.c_str(), type, DNS_CLASS_IN, static_cast<void*>(&pack), DNSResolver_async_callback, &pack.async_id);
+      if (err)
+      {
+        MWARNING("unable to initiate lookup for " << host << ": " << ub_strerror(err));
+        num_done++;
+        pack.done = true;
+      }
     }
-  }
 
-  // Wait for results
-  auto expiry = std::chrono::steady_clock::now() + timeout;
-  while (num_done < (int)results.size() && std::chrono::steady_clock::now() < expiry)
-  {
-    std::this_thread::sleep_for(5ms);
-    int err = ub_process(m_ctx);
-    if (err)
+    // Wait for results
+    auto expiry = std::chrono::steady_clock::now() + timeout;
+    while (num_done < (int)result_packs.size() && std::chrono::steady_clock::now() < expiry)
     {
-      MWARNING("ub_process returned an error while waiting for async results: " << ub_strerror(err));
-      break;
+      std::this_thread::sleep_for(5ms);
+      int err = ub_process(m_ctx);
+      if (err)
+      {
+        MWARNING("ub_process returned an error while waiting for async results: " << ub_strerror(err));
+        break;
+      }
     }
-  }
 
-  // Cancel any outstanding requests
-  for (auto& pack : result_packs)
-  {
-    if (!pack.done)
-      ub_cancel(m_ctx, pack.async_id);
+    // Cancel any outstanding requests
+    for (auto& pack : result_packs)
+    {
+      if (!pack.done)
+        ub_cancel(m_ctx, pack.async_id);
+    }
   }
 
+  for (size_t i : lookups)
+    if (answers[i])
+      cache(type, hostnames[i], *answers[i]);
+
+  results.resize(hostnames.size());
+  for (size_t i = 0; i < hostnames.size(); i++)
+    if (answers[i] && dnssec_acceptable(hostnames[i], *answers[i], dnssec, dnssec_required))
+      results[i] = std::move(answers[i]->records);
+
   return results;
 }
 
+std::future<std::vector<std::vector<std::string>>> DNSResolver::get_many_async(int type, std::vector<std::string> hostnames, std::chrono::milliseconds timeout, bool dnssec, bool dnssec_required)
+{
+  return std::async(std::launch::async, [this, type, hostnames = std::move(hostnames), timeout, dnssec, dnssec_required] {
+    return get_many(type, hostnames, timeout, dnssec, dnssec_required);
+  });
+}
+
 std::string DNSResolver::get_dns_format_from_oa_address(std::string_view addr_v)
 {
   std::string addr{addr_v};
@@ -555,44 +636,8 @@ bool load_txt_records_from_dns(std::vector<std::string> &good_records, const std
   // Prevent infinite recursion when distributing
   if (dns_urls.empty()) return false;
 
-  std::vector<std::vector<std::string> > records;
-  records.resize(dns_urls.size());
-
-  size_t first_index = crypto::rand_idx(dns_urls.size());
-
-  // send all requests in parallel
-  std::deque<bool> avail(dns_urls.size(), false), valid(dns_urls.size(), false);
-  tools::threadpool& tpool = tools::threadpool::getInstance();
-  tools::threadpool::waiter waiter;
-  for (size_t n = 0; n < dns_urls.size(); ++n)
-  {
-    tpool.submit(&waiter,[n, dns_urls, &records, &avail, &valid](){
-      records[n] = tools::DNSResolver::instance().get_txt_record(dns_urls[n], avail[n], valid[n]); 
-    });
-  }
-  waiter.wait(&tpool);
-
-  size_t cur_index = first_index;
-  do
-  {
-    const std::string &url = dns_urls[cur_index];
-    if (!avail[cur_index])
-    {
-      records[cur_index].clear();
-      LOG_PRINT_L2("DNSSEC not available for hostname: " << url << ", skipping.");
-    }
-    if (!valid[cur_index])
-    {
-      records[cur_index].clear();
-      LOG_PRINT_L2("DNSSEC validation failed for hostname: " << url << ", skipping.");
-    }
-
-    cur_index++;
-    if (cur_index == dns_urls.size())
-    {
-      cur_index = 0;
-    }
-  } while (cur_index != first_index);
+  // all requests go out in parallel; only DNSSEC-validated answers count
+  auto records = tools::DNSResolver::instance().get_many(DNS_TYPE_TXT, dns_urls, 10s, true, true);
 
   size_t num_valid_records = 0;
 
@@ -32,6 +32,9 @@
 #include <functional>
 #include <optional>
 #include <chrono>
+#include <future>
+#include <map>
+#include <mutex>
 #include <string_view>
 
 struct ub_ctx;
@@ -49,6 +52,16 @@ constexpr int DNS_TYPE_AAAA = 8;
 
 struct ub_ctx_deleter { void operator()(ub_ctx*); };
 
+/// The answer to one lookup, as returned by libunbound
+struct dns_answer
+{
+  std::vector<std::string> records;
+  bool secure = false;
+  bool bogus = false;
+  std::string why_bogus;
+  std::chrono::steady_clock::time_point expiry; ///< when the answer's TTL runs out
+};
+
 /**
  * @brief Provides high-level access to DNS resolution
  *
@@ -124,6 +137,14 @@ public:
    // TODO: this could be extended to support doing multiple lookup types at once (e.g. A and AAAA).
   std::vector<std::vector<std::string>> get_many(int type, const std::vector<std::string>& hostnames, std::chrono::milliseconds timeout = 10s, bool dnssec = false, bool dnssec_required = false);
 
+  /**
+   * @brief starts `get_many` on a new thread, for callers that have other things to do while the
+   * lookups are in flight.
+   *
+   * @return a future for what `get_many` returns
+   */
+  std::future<std::vector<std::vector<std::string>>> get_many_async(int type, std::vector<std::string> hostnames, std::chrono::milliseconds timeout = 10s, bool dnssec = false, bool dnssec_required = false);
+
   /**
    * @brief Gets a DNS address from OpenAlias format
    *
@@ -165,7 +186,18 @@ private:
   // TODO: modify this to accommodate DNSSEC
   std::vector<std::string> get_record(const std::string& url, int record_type, std::optional<std::string> (*reader)(const char *,size_t), bool& dnssec_available, bool& dnssec_valid);
 
+  /// Returns the cached answer of a `record_type` lookup of `hostname`, if its TTL hasn't run out.
+  std::optional<dns_answer> get_cached(int record_type, const std::string& hostname);
+  void cache(int record_type, const std::string& hostname, const dns_answer& answer);
+
   ub_ctx* m_ctx = nullptr;
+
+  std::mutex m_cache_mutex;
+  std::map<std::pair<int, std::string>, dns_answer> m_cache;
+
+  // ub_process runs the callbacks of every async query on m_ctx, so only one get_many can be
+  // waiting for its answers at a time.
+  std::mutex m_async_mutex;
 }; // class DNSResolver
 
 namespace dns_utils
@@ -0,0 +1,106 @@
+#include "lock_stats.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <dlfcn.h>
+#endif
+
+#include "metrics.h"
+
+namespace tools::lock_stats {
+
+namespace detail {
+
+  class lock
+  {
+  public:
+    explicit lock(const std::string& name)
+      : wait{metrics::get_histogram("oxend_lock_" + name + "_wait_seconds", "Time spent waiting to acquire the " + name + " lock", 1e-9)}
+      , hold{metrics::get_histogram("oxend_lock_" + name + "_hold_seconds", "Time the " + name + " lock was held for", 1e-9)}
+    {}
+
+    metrics::histogram& wait;
+    metrics::histogram& hold;
+
+    struct totals { uint64_t count = 0, wait_ns = 0, hold_ns = 0; };
+    std::mutex sites_mutex;
+    std::unordered_map<const void*, totals> sites;
+  };
+
+}
+
+namespace {
+
+  std::mutex registry_mutex;
+  std::map<std::string, std::unique_ptr<detail::lock>, std::less<>> registry;
+
+  std::string location(const void* pc)
+  {
+    char buf[32];
+#ifdef __linux__
+    Dl_info info;
+    if (dladdr(pc, &info) && info.dli_fname && info.dli_fbase)
+    {
+      snprintf(buf, sizeof(buf), "+0x%zx", static_cast<size_t>(reinterpret_cast<uintptr_t>(pc) - reinterpret_cast<uintptr_t>(info.dli_fbase)));
+      return info.dli_fname + std::string{buf};
+    }
+#endif
+    snprintf(buf, sizeof(buf), "%p", pc);
+    return buf;
+  }
+
+}
+
+detail::lock& detail::get(std::string_view name)
+{
+  std::lock_guard lock{registry_mutex};
+  auto it = registry.find(name);
+  if (it == registry.end())
+    it = registry.emplace(std::string{name}, std::make_unique<detail::lock>(std::string{name})).first;
+  return *it->second;
+}
+
+void detail::record(lock& l, const void* site, uint64_t wait_ns, uint64_t hold_ns)
+{
+  l.wait.observe(wait_ns);
+  l.hold.observe(hold_ns);
+  std::lock_guard lock{l.sites_mutex};
+  auto& t = l.sites[site];
+  t.count++;
+  t.wait_ns += wait_ns;
+  t.hold_ns += hold_ns;
+}
+
+std::vector<lock_sites> top_sites(size_t top)
+{
+  std::vector<lock_sites> result;
+  std::lock_guard lock{registry_mutex};
+  for (auto& [name, l] : registry)
+  {
+    std::vector<std::pair<const void*, detail::lock::totals>> sites;
+    {
+      std::lock_guard sites_lock{l->sites_mutex};
+      sites.assign(l->sites.begin(), l->sites.end());
+    }
+    const size_t n = std::min(top, sites.size());
+    std::partial_sort(sites.begin(), sites.begin() + n, sites.end(),
+        [](const auto& a, const auto& b) { return a.second.hold_ns > b.second.hold_ns; });
+
+    auto& ls = result.emplace_back();
+    ls.name = name;
+    for (size_t i = 0; i < n; i++)
+    {
+      auto& [pc, t] = sites[i];
+      ls.sites.push_back({location(pc), t.count, t.wait_ns * 1e-9, t.hold_ns * 1e-9});
+    }
+  }
+  return result;
+}
+
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Contention instrumentation for the daemon's hot mutexes (the blockchain, service node list, tx
+/// pool and sync queue locks).  Such a mutex is declared as
+///
+///     mutable tools::instrumented_mutex<std::recursive_mutex> m_blockchain_lock{"blockchain"};
+///
+/// and used exactly like the mutex it wraps.  In builds configured with -DLOCK_STATS=ON (which
+/// defines OXEN_LOCK_STATS) each outermost acquisition then records how long it waited and how long
+/// the lock was held into the oxend_lock_<name>_wait_seconds and oxend_lock_<name>_hold_seconds
+/// metrics, and totals per call site (the code that called lock()).  Otherwise the wrapper is the
+/// plain mutex and costs nothing.
+///
+/// Locks taken through a reference to the underlying mutex type (e.g. a
+/// std::lock_guard<std::recursive_mutex>) bypass the instrumentation.
+namespace tools {
+
+  namespace lock_stats {
+
+    struct site
+    {
+      std::string location; // module+0xoffset of the code that took the lock
+      uint64_t count;       // outermost acquisitions from there
+      double wait;          // total seconds spent waiting for the lock
+      double hold;          // total seconds holding it
+    };
+
+    struct lock_sites
+    {
+      std::string name;
+      std::vector<site> sites; // the top call sites, by total hold time
+    };
+
+    /// The `top` call sites of every instrumented lock, sorted by lock name.  Empty unless built
+    /// with OXEN_LOCK_STATS.
+    std::vector<lock_sites> top_sites(size_t top = 10);
+
+    constexpr bool enabled =
+#ifdef OXEN_LOCK_STATS
+      true;
+#else
+      false;
+#endif
+
+    namespace detail {
+      class lock;
+      lock& get(std::string_view name);
+      void record(lock& l, const void* site, uint64_t wait_ns, uint64_t hold_ns);
+    }
+  }
+
+#ifdef OXEN_LOCK_STATS
+
+  template <typename Mutex>
+  class instrumented_mutex : public Mutex
+  {
+    using clock = std::chrono::steady_clock;
+  public:
+    explicit instrumented_mutex(std::string_view name) : stats{lock_stats::detail::get(name)} {}
+
+    // Not inlined, so that the return address is the caller's lock site
+    [[gnu::noinline]] void lock()
+    {
+      const auto start = clock::now();
+      Mutex::lock();
+      acquired(__builtin_return_address(0), start);
+    }
+
+    [[gnu::noinline]] bool try_lock()
+    {
+      const auto start = clock::now();
+      if (!Mutex::try_lock())
+        return false;
+      acquired(__builtin_return_address(0), start);
+      return true;
+    }
+
+    void unlock()
+    {
+      // Only ever touched by the thread holding the lock
+      if (--depth == 0)
+      {
+        const auto now = clock::now();
+        lock_stats::detail::record(stats, site, wait_ns, std::chrono::duration_cast<std::chrono::nanoseconds>(now - held_since).count());
+      }
+      Mutex::unlock();
+    }
+
+  private:
+    void acquired(const void* caller, clock::time_point start)
+    {
+      if (depth++ > 0)
+        return; // a recursive re-lock is part of the outer hold
+      held_since = clock::now();
+      wait_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(held_since - start).count();
+      site = caller;
+    }
+
+    lock_stats::detail::lock& stats;
+    unsigned depth = 0;
+    const void* site = nullptr;
+    uint64_t wait_ns = 0;
+    clock::time_point held_since;
+  };
+
+#else
+
+  template <typename Mutex>
+  class instrumented_mutex : public Mutex
+  {
+  public:
+    explicit instrumented_mutex(std::string_view) {}
+  };
+
+#endif
+
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace tools
+{
+// Size-bounded map that evicts the least recently used element when full.  Not thread-safe: the
+// owner is responsible for any locking (note that even `get` modifies the cache).
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class lru_cache
+{
+public:
+  explicit lru_cache(size_t max_size) : m_max_size{max_size} {}
+
+  // Returns a pointer to the cached value for `key` (marking it as most recently used), or nullptr
+  // if not present.  The pointer is invalidated by any subsequent non-const call.
+  Value* get(const Key& key)
+  {
+    auto it = m_index.find(key);
+    if (it == m_index.end())
+    {
+      m_misses++;
+      return nullptr;
+    }
+    m_hits++;
+    m_items.splice(m_items.begin(), m_items, it->second);
+    return &it->second->second;
+  }
+
+  // Returns true if `key` is cached.  Does not affect the LRU order or the hit/miss counters.
+  bool contains(const Key& key) const { return m_index.count(key); }
+
+  // Inserts or replaces the value for `key`, evicting the least recently used elements if the cache
+  // would exceed its maximum size.
+  Value& put(const Key& key, Value value)
+  {
+    if (auto it = m_index.find(key); it != m_index.end())
+    {
+      it->second->second = std::move(value);
+      m_items.splice(m_items.begin(), m_items, it->second);
+      return it->second->second;
+    }
+    m_items.emplace_front(key, std::move(value));
+    m_index.emplace(key, m_items.begin());
+    shrink_to(m_max_size);
+    return m_items.front().second;
+  }
+
+  bool erase(const Key& key)
+  {
+    auto it = m_index.find(key);
+    if (it == m_index.end())
+      return false;
+    m_items.erase(it->second);
+    m_index.erase(it);
+    return true;
+  }
+
+  // Removes every element for which `pred(key, value)` returns true
+  template <typename Pred>
+  void erase_if(Pred pred)
+  {
+    for (auto it = m_items.begin(); it != m_items.end();)
+    {
+      if (pred(std::as_const(it->first), std::as_const(it->second)))
+      {
+        m_index.erase(it->first);
+        it = m_items.erase(it);
+      }
+      else
+        ++it;
+    }
+  }
+
+  void clear()
+  {
+    m_items.clear();
+    m_index.clear();
+  }
+
+  size_t size() const { return m_items.size(); }
+  bool empty() const { return m_items.empty(); }
+
+  size_t max_size() const { return m_max_size; }
+  void max_size(size_t max)
+  {
+    m_max_size = max;
+    shrink_to(m_max_size);
+  }
+
+  // Calls `f(key, value)` for each element, most recently used first
+  template <typename F>
+  void for_each(F&& f) const
+  {
+    for (auto& [key, value] : m_items)
+      f(key, value);
+  }
+
+  uint64_t hits() const { return m_hits; }
+  uint64_t misses() const { return m_misses; }
+
+private:
+  void shrink_to(size_t max)
+  {
+    while (m_items.size() > max)
+    {
+      m_index.erase(m_items.back().first);
+      m_items.pop_back();
+    }
+  }
+
+  using list_t = std::list<std::pair<Key, Value>>;
+  list_t m_items; // most recently used at the front
+  std::unordered_map<Key, typename list_t::iterator, Hash> m_index;
+  size_t m_max_size;
+  uint64_t m_hits = 0;
+  uint64_t m_misses = 0;
+};
+
+}
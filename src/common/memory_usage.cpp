@@ -0,0 +1,31 @@
+#include "memory_usage.h"
+
+#include <fstream>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace tools::memory {
+
+metrics::registration track(std::string_view name, std::string_view help, std::function<double()> bytes)
+{
+  std::string metric{METRIC_PREFIX};
+  metric += name;
+  metric += METRIC_SUFFIX;
+  return metrics::register_gauge(metric, help, std::move(bytes));
+}
+
+uint64_t resident_bytes()
+{
+#ifdef __linux__
+  // statm is "size resident shared ..." in pages
+  std::ifstream statm{"/proc/self/statm"};
+  uint64_t size = 0, resident = 0;
+  if (statm >> size >> resident)
+    return resident * sysconf(_SC_PAGESIZE);
+#endif
+  return 0;
+}
+
+}
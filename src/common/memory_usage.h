@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "metrics.h"
+
+/// Runtime memory accounting.  A subsystem that holds a significant amount of memory registers a
+/// callback estimating it:
+///
+///     m_memory_metric = tools::memory::track("txpool", "Transaction pool indices and caches", [this] { ... });
+///
+/// which is exported as the oxend_memory_txpool_bytes gauge and listed by the daemon's print_mem
+/// command.  The estimates count the storage of the containers involved (and whatever they point
+/// to that the subsystem owns), not allocator overhead, so they add up to somewhat less than the
+/// resident size.
+namespace tools::memory {
+
+  /// Every tracked gauge is named METRIC_PREFIX + name + METRIC_SUFFIX
+  constexpr std::string_view METRIC_PREFIX = "oxend_memory_", METRIC_SUFFIX = "_bytes";
+
+  /// Registers `bytes` (called at export time from RPC threads, so it must be thread-safe) as the
+  /// memory used by `name`.
+  [[nodiscard]] metrics::registration track(std::string_view name, std::string_view help, std::function<double()> bytes);
+
+  /// The resident set size of the process, or 0 where that isn't available
+  uint64_t resident_bytes();
+
+  // Heap storage used by standard containers: their elements plus the per-node overhead of the
+  // node-based ones.  Only the container itself is counted; heap storage owned by the elements has
+  // to be added by the caller.
+  inline size_t heap_bytes(const std::string& s) { return s.capacity() > 15 ? s.capacity() + 1 : 0; }
+  template <typename T, typename A>
+  size_t heap_bytes(const std::vector<T, A>& v) { return v.capacity() * sizeof(T); }
+  template <typename T, typename A>
+  size_t heap_bytes(const std::deque<T, A>& d) { return d.size() * sizeof(T); }
+  template <typename T, typename A>
+  size_t heap_bytes(const std::list<T, A>& l) { return l.size() * (sizeof(T) + 2 * sizeof(void*)); }
+  template <typename... T>
+  size_t heap_bytes(const std::set<T...>& s) { return s.size() * (sizeof(typename std::set<T...>::value_type) + 4 * sizeof(void*)); }
+  template <typename... T>
+  size_t heap_bytes(const std::map<T...>& m) { return m.size() * (sizeof(typename std::map<T...>::value_type) + 4 * sizeof(void*)); }
+  template <typename... T>
+  size_t heap_bytes(const std::unordered_set<T...>& s) {
+    return s.size() * (sizeof(typename std::unordered_set<T...>::value_type) + 2 * sizeof(void*)) + s.bucket_count() * sizeof(void*);
+  }
+  template <typename... T>
+  size_t heap_bytes(const std::unordered_map<T...>& m) {
+    return m.size() * (sizeof(typename std::unordered_map<T...>::value_type) + 2 * sizeof(void*)) + m.bucket_count() * sizeof(void*);
+  }
+
+}
@@ -0,0 +1,209 @@
+#include "metrics.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <variant>
+
+namespace tools::metrics {
+
+namespace {
+
+  struct callback_gauge
+  {
+    std::function<double()> get;
+    uint64_t id;
+  };
+
+  struct entry
+  {
+    std::string help;
+    std::variant<std::unique_ptr<counter>, std::unique_ptr<gauge>, std::unique_ptr<histogram>, callback_gauge> metric;
+  };
+
+  std::mutex registry_mutex;
+  std::map<std::string, entry, std::less<>> registry;
+  uint64_t next_id = 1;
+
+  template <typename T, typename... Args>
+  T& get_metric(std::string_view name, std::string_view help, Args&&... args)
+  {
+    std::lock_guard lock{registry_mutex};
+    auto it = registry.find(name);
+    if (it == registry.end())
+      it = registry.emplace(std::string{name}, entry{std::string{help}, std::make_unique<T>(std::forward<Args>(args)...)}).first;
+    auto* m = std::get_if<std::unique_ptr<T>>(&it->second.metric);
+    if (!m)
+      throw std::logic_error{"Metric " + std::string{name} + " is already registered with a different type"};
+    return **m;
+  }
+
+  // Twelve significant digits: exact for counts below 10^12, without printing bucket bounds such
+  // as 7 * 1e-3 as 0.0070000000000000001
+  std::string number(double x)
+  {
+    std::ostringstream o;
+    o.precision(12);
+    o << x;
+    return o.str();
+  }
+
+}
+
+size_t histogram::bucket(uint64_t value)
+{
+  if (value < SUB_BUCKETS)
+    return value;
+  const unsigned e = 63 - __builtin_clzll(value);
+  return SUB_BUCKETS + (e - SUB_BITS) * SUB_BUCKETS + ((value >> (e - SUB_BITS)) & (SUB_BUCKETS - 1));
+}
+
+uint64_t histogram::bucket_max(size_t i)
+{
+  if (i < SUB_BUCKETS)
+    return i;
+  const size_t k = i - SUB_BUCKETS;
+  const unsigned shift = k / SUB_BUCKETS;
+  const uint64_t lower = (SUB_BUCKETS + k % SUB_BUCKETS) << shift;
+  return lower + ((uint64_t{1} << shift) - 1);
+}
+
+void histogram::observe(uint64_t value)
+{
+  counts[bucket(value)].fetch_add(1, std::memory_order_relaxed);
+  n.fetch_add(1, std::memory_order_relaxed);
+  total.fetch_add(value, std::memory_order_relaxed);
+}
+
+counter& get_counter(std::string_view name, std::string_view help)
+{
+  return get_metric<counter>(name, help);
+}
+
+gauge& get_gauge(std::string_view name, std::string_view help)
+{
+  return get_metric<gauge>(name, help);
+}
+
+histogram& get_histogram(std::string_view name, std::string_view help, double unit)
+{
+  return get_metric<histogram>(name, help, unit);
+}
+
+registration register_gauge(std::string_view name, std::string_view help, std::function<double()> get)
+{
+  std::lock_guard lock{registry_mutex};
+  auto& e = registry[std::string{name}];
+  const bool fresh = e.metric.index() == 0 && !std::get<0>(e.metric);
+  if (!fresh && !std::holds_alternative<callback_gauge>(e.metric))
+    throw std::logic_error{"Metric " + std::string{name} + " is already registered with a different type"};
+  e.help = help;
+  const uint64_t id = next_id++;
+  e.metric = callback_gauge{std::move(get), id};
+  return registration{id};
+}
+
+registration& registration::operator=(registration&& o) noexcept
+{
+  if (this != &o)
+  {
+    reset();
+    id = o.id;
+    o.id = 0;
+  }
+  return *this;
+}
+
+void registration::reset()
+{
+  if (!id)
+    return;
+  std::lock_guard lock{registry_mutex};
+  for (auto it = registry.begin(); it != registry.end(); ++it)
+  {
+    if (auto* cb = std::get_if<callback_gauge>(&it->second.metric); cb && cb->id == id)
+    {
+      registry.erase(it);
+      break;
+    }
+  }
+  id = 0;
+}
+
+std::vector<sample> snapshot()
+{
+  std::vector<sample> result;
+  std::vector<std::pair<size_t, std::function<double()>>> callbacks;
+  {
+    std::lock_guard lock{registry_mutex};
+    result.reserve(registry.size());
+    for (auto& [name, e] : registry)
+    {
+      auto& s = result.emplace_back();
+      s.name = name;
+      s.help = e.help;
+      if (auto* c = std::get_if<std::unique_ptr<counter>>(&e.metric))
+      {
+        s.type = "counter";
+        s.value = (*c)->value();
+      }
+      else if (auto* g = std::get_if<std::unique_ptr<gauge>>(&e.metric))
+      {
+        s.type = "gauge";
+        s.value = (*g)->value();
+      }
+      else if (auto* h = std::get_if<std::unique_ptr<histogram>>(&e.metric))
+      {
+        s.type = "histogram";
+        s.count = (*h)->count();
+        s.unit = (*h)->unit;
+        s.sum = (*h)->sum() * s.unit;
+        for (size_t i = 0; i < histogram::BUCKETS; i++)
+          if (auto n = (*h)->bucket_count(i))
+            s.buckets.emplace_back(histogram::bucket_max(i) * (*h)->unit, n);
+      }
+      else
+      {
+        s.type = "gauge";
+        callbacks.emplace_back(result.size() - 1, std::get<callback_gauge>(e.metric).get);
+      }
+    }
+  }
+  // Callbacks may take subsystem locks, so they are called without holding the registry's
+  for (auto& [i, get] : callbacks)
+    result[i].value = get();
+  return result;
+}
+
+std::string prometheus_text()
+{
+  std::ostringstream o;
+  for (auto& s : snapshot())
+  {
+    o << "# HELP " << s.name << ' ' << s.help << '\n'
+      << "# TYPE " << s.name << ' ' << s.type << '\n';
+    if (s.type != "histogram")
+    {
+      o << s.name << ' ' << number(s.value) << '\n';
+      continue;
+    }
+    // Cumulative counts at each power of two, i.e. at the last of each group of sub-buckets
+    uint64_t cumulative = 0;
+    auto b = s.buckets.begin();
+    for (size_t i = histogram::SUB_BUCKETS - 1; b != s.buckets.end() && i < histogram::BUCKETS; i += histogram::SUB_BUCKETS)
+    {
+      const double le = histogram::bucket_max(i) * s.unit;
+      for (; b != s.buckets.end() && b->first <= le; ++b)
+        cumulative += b->second;
+      o << s.name << "_bucket{le=\"" << number(le) << "\"} " << cumulative << '\n';
+    }
+    o << s.name << "_bucket{le=\"+Inf\"} " << s.count << '\n'
+      << s.name << "_sum " << number(s.sum) << '\n'
+      << s.name << "_count " << s.count << '\n';
+  }
+  return o.str();
+}
+
+}
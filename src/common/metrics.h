@@ -0,0 +1,131 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// The daemon-wide metrics registry.  Subsystems get a metric by name once, typically into a
+/// function-local static reference:
+///
+///     static auto& blocks_added = tools::metrics::get_counter("oxend_blocks_added_total", "Blocks added to the main chain");
+///     blocks_added.inc();
+///
+/// after which updates are lock-free atomics.  Metrics live until exit.  Values that are cheaper
+/// to read on demand than to track can instead be registered as callback gauges.  Everything is
+/// exported by the get_metrics admin RPC and, with --rpc-metrics, at /metrics for Prometheus.
+namespace tools::metrics {
+
+  class counter {
+  public:
+    void inc(uint64_t n = 1) { v.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const { return v.load(std::memory_order_relaxed); }
+  private:
+    std::atomic<uint64_t> v{0};
+  };
+
+  class gauge {
+  public:
+    void set(int64_t x) { v.store(x, std::memory_order_relaxed); }
+    void add(int64_t n) { v.fetch_add(n, std::memory_order_relaxed); }
+    int64_t value() const { return v.load(std::memory_order_relaxed); }
+  private:
+    std::atomic<int64_t> v{0};
+  };
+
+  /// A histogram of non-negative integer observations in log-linear (HDR-style) buckets: four
+  /// buckets per power of two, so any value is placed to within 25% with no range configured.
+  /// `unit` scales observations for export (e.g. 1e-6 for values recorded in microseconds,
+  /// exported in seconds).
+  class histogram {
+  public:
+    static constexpr size_t SUB_BITS = 2, SUB_BUCKETS = 1 << SUB_BITS;
+    static constexpr size_t BUCKETS = SUB_BUCKETS + (64 - SUB_BITS) * SUB_BUCKETS;
+
+    explicit histogram(double unit = 1) : unit{unit} {}
+
+    void observe(uint64_t value);
+
+    static size_t bucket(uint64_t value);
+    /// The largest value that lands in bucket `i`
+    static uint64_t bucket_max(size_t i);
+
+    uint64_t count() const { return n.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return total.load(std::memory_order_relaxed); }
+    uint64_t bucket_count(size_t i) const { return counts[i].load(std::memory_order_relaxed); }
+
+    const double unit;
+  private:
+    std::array<std::atomic<uint64_t>, BUCKETS> counts{};
+    std::atomic<uint64_t> n{0}, total{0};
+  };
+
+  /// Observes the microseconds from construction to destruction (or stop()) into a histogram,
+  /// which should be registered with a unit of 1e-6 to be exported in seconds.
+  class scoped_timer {
+  public:
+    explicit scoped_timer(histogram& h) : h{&h}, start{std::chrono::steady_clock::now()} {}
+    ~scoped_timer() { stop(); }
+    void stop()
+    {
+      if (!h)
+        return;
+      h->observe(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+      h = nullptr;
+    }
+    scoped_timer(const scoped_timer&) = delete;
+    scoped_timer& operator=(const scoped_timer&) = delete;
+  private:
+    histogram* h;
+    std::chrono::steady_clock::time_point start;
+  };
+
+  /// Returns the metric of the given name, registering it on first use.  Metric names are
+  /// Prometheus names (oxend_..., with _total on counters); asking for a name registered as a
+  /// different type throws.
+  counter& get_counter(std::string_view name, std::string_view help);
+  gauge& get_gauge(std::string_view name, std::string_view help);
+  histogram& get_histogram(std::string_view name, std::string_view help, double unit = 1);
+
+  /// Keeps a callback gauge registered; unregisters it when destroyed.
+  class registration {
+  public:
+    registration() = default;
+    registration(registration&& o) noexcept : id{o.id} { o.id = 0; }
+    registration& operator=(registration&& o) noexcept;
+    ~registration() { reset(); }
+    void reset();
+  private:
+    friend registration register_gauge(std::string_view, std::string_view, std::function<double()>);
+    explicit registration(uint64_t id) : id{id} {}
+    uint64_t id = 0;
+  };
+
+  /// Registers a gauge whose value is read by calling `get` at export time (from an RPC thread,
+  /// so it has to be thread-safe).  Registering a name again replaces the earlier callback.
+  [[nodiscard]] registration register_gauge(std::string_view name, std::string_view help, std::function<double()> get);
+
+  /// A point-in-time copy of one metric
+  struct sample {
+    std::string name;
+    std::string help;
+    std::string_view type;  // "counter", "gauge" or "histogram"
+    double value = 0;       // counters and gauges
+    uint64_t count = 0;     // histograms: the number of observations,
+    double sum = 0;         // their (scaled) sum,
+    std::vector<std::pair<double, uint64_t>> buckets; // and the non-empty buckets as (scaled max value, count)
+    double unit = 1;        // histograms: the scale applied to their values
+  };
+
+  /// Reads every registered metric, sorted by name.
+  std::vector<sample> snapshot();
+
+  /// Every registered metric in the Prometheus text exposition format.  Histogram buckets are
+  /// exported at power-of-two boundaries only (up to the largest observation).
+  std::string prometheus_text();
+
+}
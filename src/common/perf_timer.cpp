@@ -30,6 +30,7 @@
 #include <vector>
 #include "epee/misc_os_dependent.h"
 #include "perf_timer.h"
+#include "trace.h"
 
 #undef OXEN_DEFAULT_LOG_CATEGORY
 #define OXEN_DEFAULT_LOG_CATEGORY "perf"
@@ -93,8 +94,23 @@ LoggingPerformanceTimer::LoggingPerformanceTimer(const std::string &s, const std
   performance_timers->push_back(this);
 }
 
+LoggingPerformanceTimer::LoggingPerformanceTimer(const char *s, const char *cat, uint64_t unit, el::Level l): LoggingPerformanceTimer(std::string{s}, std::string{cat}, unit, l)
+{
+  if constexpr ((OXEN_TRACE_CATEGORIES & trace::perf) != 0)
+  {
+    if (trace::enabled())
+    {
+      trace_name = s;
+      trace_cat = cat;
+      trace_start = trace::detail::now();
+    }
+  }
+}
+
 LoggingPerformanceTimer::~LoggingPerformanceTimer()
 {
+  if (trace_start)
+    trace::detail::record(trace_cat, trace_name, trace_start, trace::detail::now());
   pause();
   performance_timers->pop_back();
   const bool log = ELPP->vRegistry()->allowed(level, cat.c_str());
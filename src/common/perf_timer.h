@@ -32,6 +32,7 @@
 #include <string>
 #include <cstdio>
 #include <cstdint>
+#include <string_view>
 #include "epee/misc_log_ex.h"
 
 namespace tools
@@ -61,6 +62,9 @@ class LoggingPerformanceTimer: public PerformanceTimer
 {
 public:
   LoggingPerformanceTimer(const std::string &s, const std::string &cat, uint64_t unit, el::Level l = el::Level::Info);
+  // As above, but also records a trace span (see common/trace.h); used by the PERF_TIMER macros,
+  // whose names and categories are string literals.
+  LoggingPerformanceTimer(const char *s, const char *cat, uint64_t unit, el::Level l = el::Level::Info);
   ~LoggingPerformanceTimer();
 
 private:
@@ -68,6 +72,8 @@ private:
   std::string cat;
   uint64_t unit;
   el::Level level;
+  std::string_view trace_name, trace_cat;
+  uint64_t trace_start = 0;
 };
 
 void set_performance_timer_log_level(el::Level level);
@@ -0,0 +1,227 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __linux__
+#include <cerrno>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <fstream>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#include "epee/misc_log_ex.h"
+
+#undef LOKI_DEFAULT_LOG_CATEGORY
+#define LOKI_DEFAULT_LOG_CATEGORY "profiler"
+
+namespace tools::profiler {
+
+namespace {
+
+  struct slot
+  {
+    std::atomic<int> depth; // set (release) once `pcs` is filled in; 0 while empty or being written
+    pid_t tid;
+    void* pcs[max_depth];
+  };
+
+  std::mutex control_mutex;
+  // Allocated by the first start() and never freed, so that a late signal can't write to freed memory
+  slot* slots = nullptr;
+  std::atomic<bool> active{false};
+  std::atomic<size_t> next{0}, lost{0};
+
+#ifdef __linux__
+  // The handler's own frame and the kernel's signal trampoline, which head every captured stack
+  constexpr int skip_frames = 2;
+
+  void on_sigprof(int)
+  {
+    if (!active.load(std::memory_order_relaxed))
+      return;
+    const int saved_errno = errno;
+    const size_t i = next.fetch_add(1, std::memory_order_relaxed);
+    if (i < capacity)
+    {
+      auto& s = slots[i];
+      s.tid = static_cast<pid_t>(syscall(SYS_gettid));
+      s.depth.store(std::max(backtrace(s.pcs, max_depth), 0), std::memory_order_release);
+    }
+    else
+      lost.fetch_add(1, std::memory_order_relaxed);
+    errno = saved_errno;
+  }
+
+  bool set_timer(unsigned hz)
+  {
+    itimerval t{};
+    if (hz)
+    {
+      t.it_interval.tv_sec = 0;
+      t.it_interval.tv_usec = std::max<long>(1'000'000 / hz, 1);
+      t.it_value = t.it_interval;
+    }
+    return setitimer(ITIMER_PROF, &t, nullptr) == 0;
+  }
+
+  std::string thread_name(pid_t tid)
+  {
+    std::string name;
+    if (std::ifstream f{"/proc/self/task/" + std::to_string(tid) + "/comm"}; !std::getline(f, name) || name.empty())
+      name = "thread-" + std::to_string(tid);
+    for (char& c : name)
+      if (c == ';' || c == ' ')
+        c = '_';
+    return name;
+  }
+
+  // A return address points after its call, so it is moved back by one to resolve to the calling
+  // line; the interrupted frame's address is exact.
+  std::string frame_name(void* pc, bool return_address)
+  {
+    const auto addr = reinterpret_cast<uintptr_t>(pc) - (return_address ? 1 : 0);
+    char buf[32];
+    Dl_info info;
+    if (dladdr(reinterpret_cast<void*>(addr), &info) && info.dli_fname && info.dli_fbase)
+    {
+      snprintf(buf, sizeof(buf), "+0x%zx", static_cast<size_t>(addr - reinterpret_cast<uintptr_t>(info.dli_fbase)));
+      return info.dli_fname + std::string{buf};
+    }
+    snprintf(buf, sizeof(buf), "0x%zx", static_cast<size_t>(addr));
+    return buf;
+  }
+#endif
+
+}
+
+bool start(unsigned hz)
+{
+#ifdef __linux__
+  if (hz < 1 || hz > 10000)
+    return false;
+  std::lock_guard lock{control_mutex};
+  active.store(false);
+  set_timer(0);
+
+  if (!slots)
+  {
+    slots = new slot[capacity];
+    // The first backtrace() loads libgcc's unwinder, which isn't safe to do from a signal handler
+    void* warmup[1];
+    backtrace(warmup, 1);
+
+    struct sigaction sa{};
+    sa.sa_handler = on_sigprof;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGPROF, &sa, nullptr) != 0)
+    {
+      MERROR("Failed to install the profiler's SIGPROF handler");
+      return false;
+    }
+  }
+  for (size_t i = 0; i < capacity; i++)
+    slots[i].depth.store(0, std::memory_order_relaxed);
+  next = 0;
+  lost = 0;
+
+  active.store(true);
+  if (!set_timer(hz))
+  {
+    active.store(false);
+    MERROR("Failed to start the profiling timer");
+    return false;
+  }
+  MINFO("CPU profiling started at " << hz << "Hz");
+  return true;
+#else
+  MWARNING("CPU profiling is not supported on this platform");
+  return false;
+#endif
+}
+
+void stop()
+{
+#ifdef __linux__
+  std::lock_guard lock{control_mutex};
+  if (!active.exchange(false))
+    return;
+  set_timer(0);
+  MINFO("CPU profiling stopped after " << samples() << " samples");
+#endif
+}
+
+bool running()
+{
+  return active.load(std::memory_order_relaxed);
+}
+
+size_t samples()
+{
+  return std::min(next.load(std::memory_order_relaxed), capacity);
+}
+
+size_t dropped()
+{
+  return lost.load(std::memory_order_relaxed);
+}
+
+std::string collapsed_stacks()
+{
+  std::string out;
+#ifdef __linux__
+  std::lock_guard lock{control_mutex};
+  if (!slots)
+    return out;
+
+  std::map<std::string, uint64_t> stacks;
+  std::unordered_map<pid_t, std::string> threads;
+  std::unordered_map<void*, std::string> frames[2];
+  std::string stack;
+  for (size_t i = 0, n = samples(); i < n; i++)
+  {
+    const auto& s = slots[i];
+    const int depth = s.depth.load(std::memory_order_acquire);
+    if (depth <= skip_frames)
+      continue;
+
+    auto [t, inserted] = threads.try_emplace(s.tid);
+    if (inserted)
+      t->second = thread_name(s.tid);
+    stack = t->second;
+    // Outermost frame first
+    for (int f = depth - 1; f >= skip_frames; f--)
+    {
+      const bool ret = f > skip_frames;
+      auto [fr, new_frame] = frames[ret].try_emplace(s.pcs[f]);
+      if (new_frame)
+        fr->second = frame_name(s.pcs[f], ret);
+      stack += ';';
+      stack += fr->second;
+    }
+    stacks[stack]++;
+  }
+
+  for (auto& [st, count] : stacks)
+  {
+    out += st;
+    out += ' ';
+    out += std::to_string(count);
+    out += '\n';
+  }
+#endif
+  return out;
+}
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/// A built-in sampling CPU profiler for production daemons, where attaching perf is not an option.
+/// While running, a SIGPROF timer interrupts whichever thread is using CPU `hz` times per second of
+/// process CPU time, and the signal handler copies that thread's stack into a buffer allocated
+/// when profiling starts; nothing is allocated or locked in the handler, and the buffer simply
+/// stops filling when full.  Linux only.
+///
+/// Stacks are exported in the collapsed ("folded") format used by flamegraph.pl, speedscope and
+/// inferno, one line per distinct stack:
+///
+///     thread-name;/path/to/oxend+0x1a2b3c;/path/to/oxend+0x4d5e6f 17
+///
+/// Frames are left unsymbolised as module+offset so that this works on stripped release builds;
+/// resolve them offline against the matching binary (or its debug symbols) with addr2line.
+namespace tools::profiler {
+
+  // Sample slots allocated by start(), and frames kept per sample
+  constexpr size_t capacity = 16384;
+  constexpr size_t max_depth = 64;
+
+  // Discards the previous profile and starts sampling at `hz` samples per CPU-second.  Returns
+  // false if profiling is unsupported, `hz` is out of range (1-10000) or the timer can't be set.
+  // Only one profile can run at a time; starting while running restarts it.
+  bool start(unsigned hz = 99);
+
+  // Stops sampling; the samples taken are kept until the next start().
+  void stop();
+
+  bool running();
+
+  // The samples recorded so far, and those lost because the buffer was full
+  size_t samples();
+  size_t dropped();
+
+  // The samples recorded so far in collapsed-stack format.  Can be called while running.
+  std::string collapsed_stacks();
+
+}
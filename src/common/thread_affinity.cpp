@@ -0,0 +1,194 @@
+#include "thread_affinity.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "common/string_util.h"
+#include "crypto/hash.h"
+#include "epee/misc_log_ex.h"
+
+#undef LOKI_DEFAULT_LOG_CATEGORY
+#define LOKI_DEFAULT_LOG_CATEGORY "affinity"
+
+using namespace std::literals;
+
+namespace tools {
+
+namespace {
+
+  // Parses a kernel-style cpu list ("0-3,8,10-11"), appending to `out`; items of the form "nodeN"
+  // are taken from `nodes` when it is given.
+  bool parse_cpu_list(std::string_view list, std::vector<unsigned>& out, const std::vector<std::vector<unsigned>>* nodes)
+  {
+    for (auto item : split(list, ","sv, true))
+    {
+      if (nodes && starts_with(item, "node"sv))
+      {
+        unsigned node;
+        if (!parse_int(item.substr(4), node) || node >= nodes->size() || (*nodes)[node].empty())
+          return false;
+        out.insert(out.end(), (*nodes)[node].begin(), (*nodes)[node].end());
+        continue;
+      }
+      unsigned first, last;
+      auto dash = item.find('-');
+      if (!parse_int(item.substr(0, dash), first))
+        return false;
+      last = first;
+      if (dash != std::string_view::npos && (!parse_int(item.substr(dash + 1), last) || last < first || last - first > 4096))
+        return false;
+      for (unsigned cpu = first; cpu <= last; cpu++)
+        out.push_back(cpu);
+    }
+    return true;
+  }
+
+  std::vector<std::vector<unsigned>> detect_numa_nodes()
+  {
+    std::vector<std::vector<unsigned>> nodes;
+#ifdef __linux__
+    std::string online;
+    std::vector<unsigned> node_ids;
+    if (std::ifstream f{"/sys/devices/system/node/online"}; std::getline(f, online) && parse_cpu_list(online, node_ids, nullptr))
+    {
+      for (unsigned node : node_ids)
+      {
+        std::string cpus;
+        std::ifstream f{"/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"};
+        if (node >= nodes.size())
+          nodes.resize(node + 1);
+        if (!std::getline(f, cpus) || !parse_cpu_list(cpus, nodes[node], nullptr))
+          nodes[node].clear();
+      }
+    }
+#endif
+    if (std::none_of(nodes.begin(), nodes.end(), [](const auto& n) { return !n.empty(); }))
+    {
+      nodes.assign(1, {});
+      for (unsigned cpu = 0, n = std::max(std::thread::hardware_concurrency(), 1u); cpu < n; cpu++)
+        nodes[0].push_back(cpu);
+    }
+    return nodes;
+  }
+
+  struct placement
+  {
+    bool numa = false; // one node per thread, round-robin
+    std::vector<unsigned> cpus;
+  };
+
+  std::mutex placements_mutex;
+  std::map<std::string, placement, std::less<>> placements;
+
+  constexpr std::string_view known_pools[] = {"threadpool"sv, "miner"sv, "p2p"sv};
+
+}
+
+const std::vector<std::vector<unsigned>>& numa_nodes()
+{
+  static const auto nodes = detect_numa_nodes();
+  return nodes;
+}
+
+std::optional<std::vector<unsigned>> parse_cpu_set(std::string_view spec)
+{
+  std::vector<unsigned> cpus;
+  if (!parse_cpu_list(spec, cpus, &numa_nodes()) || cpus.empty())
+    return std::nullopt;
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+  return cpus;
+}
+
+bool pin_current_thread(const std::vector<unsigned>& cpus)
+{
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (unsigned cpu : cpus)
+    if (cpu < CPU_SETSIZE)
+      CPU_SET(cpu, &set);
+  if (int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set))
+  {
+    MERROR("Failed to set thread CPU affinity: " << std::strerror(err));
+    return false;
+  }
+  return true;
+#else
+  MWARNING("Setting thread CPU affinity is not supported on this platform");
+  return false;
+#endif
+}
+
+bool set_thread_affinity(std::string_view assignment)
+{
+  auto eq = assignment.find('=');
+  if (eq == std::string_view::npos)
+    return false;
+  auto pool = assignment.substr(0, eq);
+  auto spec = assignment.substr(eq + 1);
+  if (std::find(std::begin(known_pools), std::end(known_pools), pool) == std::end(known_pools))
+    return false;
+
+  placement p;
+  if (spec == "numa"sv)
+    p.numa = true;
+  else if (auto cpus = parse_cpu_set(spec))
+    p.cpus = std::move(*cpus);
+  else
+    return false;
+
+  std::lock_guard lock{placements_mutex};
+  placements.insert_or_assign(std::string{pool}, std::move(p));
+  return true;
+}
+
+void pin_thread_to_pool(std::string_view pool, unsigned index)
+{
+  std::vector<unsigned> cpus;
+  {
+    std::lock_guard lock{placements_mutex};
+    auto it = placements.find(pool);
+    if (it == placements.end())
+      return;
+    if (!it->second.numa)
+      cpus = it->second.cpus;
+  }
+
+  const auto& nodes = numa_nodes();
+  int node = -1;
+  if (cpus.empty())
+  {
+    // Skip nodes without CPUs (memory-only nodes) when dealing threads out
+    std::vector<unsigned> with_cpus;
+    for (unsigned n = 0; n < nodes.size(); n++)
+      if (!nodes[n].empty())
+        with_cpus.push_back(n);
+    node = with_cpus[index % with_cpus.size()];
+    cpus = nodes[node];
+  }
+  else
+  {
+    for (unsigned n = 0; node < 0 && n < nodes.size(); n++)
+      if (!nodes[n].empty() && std::includes(nodes[n].begin(), nodes[n].end(), cpus.begin(), cpus.end()))
+        node = n;
+  }
+
+  if (!pin_current_thread(cpus))
+    return;
+  MDEBUG("Pinned " << pool << " thread " << index << " to " << cpus.size() << " CPU(s)" << (node >= 0 ? " on NUMA node " + std::to_string(node) : ""s));
+  if (node >= 0)
+    crypto::rx_set_numa_node(node);
+}
+
+}
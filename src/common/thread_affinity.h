@@ -0,0 +1,34 @@
+#pragma once
+
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace tools {
+
+  /// The online CPUs of each NUMA node, indexed by node number.  Read once from sysfs on Linux;
+  /// elsewhere, or when the kernel reports no nodes, this is a single node holding every CPU.
+  const std::vector<std::vector<unsigned>>& numa_nodes();
+
+  /// Parses a CPU set such as "0-3,8,10-11", where an item can also be "nodeN" for every CPU of
+  /// NUMA node N.  Returns the sorted, deduplicated CPUs, or nullopt if the set is empty,
+  /// malformed, or names a node that doesn't exist.
+  std::optional<std::vector<unsigned>> parse_cpu_set(std::string_view spec);
+
+  /// Restricts the calling thread to the given CPUs.  Returns false (after logging) if the
+  /// platform doesn't support it or the kernel refuses.
+  bool pin_current_thread(const std::vector<unsigned>& cpus);
+
+  /// Sets the placement of one of the daemon's thread pools ("threadpool", "miner" or "p2p") from
+  /// a "pool=spec" assignment.  The spec is a CPU set as taken by parse_cpu_set, or "numa" to
+  /// spread the pool's threads round-robin over the NUMA nodes, each pinned to its node's CPUs.
+  /// Returns false if the assignment can't be parsed.  Has to be called before the pool starts.
+  bool set_thread_affinity(std::string_view assignment);
+
+  /// Pins the calling thread, the `index`th thread of the named pool, as configured with
+  /// set_thread_affinity; does nothing for a pool without a placement.  A thread that ends up
+  /// on a single NUMA node is also registered with RandomX as being on that node, so that it
+  /// mines against a dataset in that node's memory.
+  void pin_thread_to_pool(std::string_view pool, unsigned index);
+
+}
@@ -30,6 +30,7 @@
 
 #include "cryptonote_config.h"
 #include "common/util.h"
+#include "common/thread_affinity.h"
 
 static thread_local int depth = 0;
 static thread_local bool is_leaf = false;
@@ -74,12 +75,19 @@ void threadpool::create(unsigned int max_threads) {
   const std::unique_lock lock{mutex};
   max = max_threads ? max_threads : tools::get_max_concurrency();
   running = true;
-  for (size_t i = max ? max : 1; i > 0; i--) {
-    threads.emplace_back([this] { run(false); });
+  for (unsigned i = 0; i < std::max(max, 1u); i++) {
+    threads.emplace_back([this, i] {
+      pin_thread_to_pool("threadpool", i);
+      run(false);
+    });
   }
 }
 
-void threadpool::submit(waiter *obj, std::function<void()> f, bool leaf) {
+bool threadpool::in_leaf_task() {
+  return is_leaf;
+}
+
+void threadpool::submit(waiter *obj, task f, bool leaf) {
   CHECK_AND_ASSERT_THROW_MES(!is_leaf, "A leaf routine is using a thread pool");
   std::unique_lock lock{mutex};
   if (!leaf && ((active == max && !queue.empty()) || depth > 0)) {
@@ -95,9 +103,9 @@ void threadpool::submit(waiter *obj, std::function<void()> f, bool leaf) {
     if (obj)
       obj->inc();
     if (leaf)
-      queue.push_front({obj, f, leaf});
+      queue.push_front({obj, std::move(f), leaf});
     else
-      queue.push_back({obj, f, leaf});
+      queue.push_back({obj, std::move(f), leaf});
     has_work.notify_one();
   }
 }
@@ -134,14 +142,17 @@ void threadpool::waiter::wait(threadpool *tpool) {
 }
 
 void threadpool::waiter::inc() {
-  const std::unique_lock lock{mt};
   num++;
 }
 
 void threadpool::waiter::dec() {
+  // Only the decrement that may reach zero needs the lock: wait() can only see zero, and return
+  // (possibly destroying the waiter), once we've released it after notifying.
+  for (int n = num.load(); n > 1; )
+    if (num.compare_exchange_weak(n, n - 1))
+      return;
   const std::unique_lock lock{mt};
-  num--;
-  if (!num)
+  if (!--num)
     cv.notify_all();
 }
 
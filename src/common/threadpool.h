@@ -27,8 +27,12 @@
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <functional>
+#include <new>
+#include <type_traits>
 #include <utility>
 #include <vector>
 #include <deque>
@@ -56,7 +60,7 @@ public:
   class waiter {
     std::mutex mt;
     std::condition_variable cv;
-    int num;
+    std::atomic<int> num;
     public:
     void inc();
     void dec();
@@ -65,10 +69,114 @@ public:
     ~waiter();
   };
 
+  // A queued task: a move-only callable that keeps lambdas of up to a few pointers' worth of
+  // captures in place, where std::function would allocate for anything over 16 bytes.
+  class task {
+    public:
+    task() = default;
+    template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, task>>>
+    task(F&& f) {
+      using T = std::decay_t<F>;
+      if constexpr (fits_inline<T>)
+        new (buf) T(std::forward<F>(f));
+      else
+      {
+        *reinterpret_cast<T**>(buf) = new T(std::forward<F>(f));
+        heap = true;
+      }
+      impl = &impl_for<T>;
+    }
+    task(task&& t) noexcept { take(t); }
+    task& operator=(task&& t) noexcept {
+      if (this != &t)
+      {
+        reset();
+        take(t);
+      }
+      return *this;
+    }
+    ~task() { reset(); }
+    void operator()() { impl->call(target()); }
+    explicit operator bool() const { return impl; }
+
+    private:
+    static constexpr size_t INLINE_SIZE = 6 * sizeof(void*);
+    template <typename T> static constexpr bool fits_inline = sizeof(T) <= INLINE_SIZE &&
+        alignof(T) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<T>;
+
+    struct ops {
+      void (*call)(void* f);
+      void (*move)(void* from, void* to) noexcept; // move-constructs at `to` and destroys `from`
+      void (*destroy)(void* f, bool heap) noexcept;
+    };
+    template <typename T> static void call_impl(void* f) { (*static_cast<T*>(f))(); }
+    template <typename T> static void move_impl(void* from, void* to) noexcept {
+      if constexpr (fits_inline<T>)
+      {
+        new (to) T(std::move(*static_cast<T*>(from)));
+        static_cast<T*>(from)->~T();
+      }
+    }
+    template <typename T> static void destroy_impl(void* f, bool heap) noexcept {
+      if (heap)
+        delete static_cast<T*>(f);
+      else
+        static_cast<T*>(f)->~T();
+    }
+    template <typename T> static inline constexpr ops impl_for{&call_impl<T>, &move_impl<T>, &destroy_impl<T>};
+
+    void* target() { return heap ? *reinterpret_cast<void**>(buf) : static_cast<void*>(buf); }
+    void take(task& t) noexcept {
+      impl = std::exchange(t.impl, nullptr);
+      heap = t.heap;
+      if (!impl)
+        return;
+      if (heap)
+        *reinterpret_cast<void**>(buf) = *reinterpret_cast<void**>(t.buf);
+      else
+        impl->move(t.buf, buf);
+    }
+    void reset() noexcept {
+      if (impl)
+        impl->destroy(target(), heap);
+      impl = nullptr;
+    }
+
+    alignas(std::max_align_t) unsigned char buf[INLINE_SIZE];
+    const ops* impl = nullptr;
+    bool heap = false;
+  };
+
   // Submit a task to the pool. The waiter pointer may be
   // NULL if the caller doesn't care to wait for the
   // task to finish.
-  void submit(waiter *waiter, std::function<void()> f, bool leaf = false);
+  void submit(waiter *waiter, task f, bool leaf = false);
+
+  // Calls f(i) for each i in [begin, end) on the pool and the calling thread, and waits for them
+  // all.  Rather than a task per index, this queues one task per thread; each of them (and the
+  // caller) takes the next `grain` indices from a shared counter until none are left, so threads
+  // that get through their share early take on more.  `leaf` is passed on to submit.
+  template <typename F>
+  void parallel_for(size_t begin, size_t end, size_t grain, F f, bool leaf = false) {
+    if (begin >= end)
+      return;
+    grain = std::max<size_t>(grain, 1);
+    const size_t chunks = (end - begin + grain - 1) / grain;
+    std::atomic<size_t> next{0};
+    auto run_chunks = [&] {
+      for (size_t c; (c = next.fetch_add(1, std::memory_order_relaxed)) < chunks; )
+        for (size_t i = begin + c * grain, e = std::min(end, i + grain); i < e; ++i)
+          f(i);
+    };
+    waiter w;
+    for (size_t n = std::min<size_t>(chunks, get_max_concurrency()); n > 1; --n)
+      submit(&w, run_chunks, leaf);
+    run_chunks();
+    w.wait(this);
+  }
+
+  // Whether the calling thread is running a leaf task, and so may not submit anything
+  static bool in_leaf_task();
 
   // destroy and recreate threads
   void recycle();
@@ -85,7 +193,7 @@ public:
     void create(unsigned int max_threads);
     typedef struct entry {
       waiter *wo;
-      std::function<void()> f;
+      task f;
       bool leaf;
     } entry;
     std::deque<entry> queue;
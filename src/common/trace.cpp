@@ -0,0 +1,181 @@
+#include "trace.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "epee/misc_log_ex.h"
+
+namespace tools::trace {
+
+namespace detail {
+  std::atomic<bool> enabled{false};
+
+  uint64_t now()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+}
+
+namespace {
+
+  struct event
+  {
+    std::string_view cat;
+    std::string_view name;
+    uint64_t start, end;
+  };
+
+  // One per thread that has recorded a span.  The mutex is only ever contended while a dump or
+  // clear copies the buffer out.
+  struct thread_buffer
+  {
+    std::mutex mutex;
+    std::vector<event> events; // ring of up to `capacity` events
+    size_t next = 0;           // where the next event goes, once the ring is full
+    unsigned tid;
+    std::string thread_name;
+  };
+
+  std::mutex buffers_mutex;
+  std::vector<std::shared_ptr<thread_buffer>> buffers;
+  unsigned next_tid = 1;
+
+  thread_buffer& local_buffer()
+  {
+    // Shared with `buffers`, so that spans of threads that have exited stay around for the next dump
+    thread_local std::shared_ptr<thread_buffer> local = [] {
+      auto b = std::make_shared<thread_buffer>();
+      b->events.reserve(capacity);
+      b->thread_name = el::Helpers::getThreadName();
+      std::lock_guard lock{buffers_mutex};
+      b->tid = next_tid++;
+      buffers.push_back(b);
+      return b;
+    }();
+    return *local;
+  }
+
+  void append_json_string(std::string& out, std::string_view s)
+  {
+    out += '"';
+    for (char c : s)
+    {
+      if (c == '"' || c == '\\')
+        out += '\\';
+      if (static_cast<unsigned char>(c) >= 0x20)
+        out += c;
+    }
+    out += '"';
+  }
+
+  void append_us(std::string& out, uint64_t ns)
+  {
+    out += std::to_string(ns / 1000);
+    out += '.';
+    auto frac = std::to_string(ns % 1000);
+    out.append(3 - frac.size(), '0');
+    out += frac;
+  }
+
+}
+
+std::string_view category_name(category c)
+{
+  switch (c)
+  {
+    case blockchain: return "blockchain";
+    case txpool: return "txpool";
+    case rpc: return "rpc";
+    case p2p: return "p2p";
+    case perf: return "perf";
+  }
+  return "other";
+}
+
+void detail::record(std::string_view cat, std::string_view name, uint64_t start, uint64_t end)
+{
+  auto& b = local_buffer();
+  std::lock_guard lock{b.mutex};
+  if (b.events.size() < capacity)
+    b.events.push_back({cat, name, start, end});
+  else
+  {
+    b.events[b.next] = {cat, name, start, end};
+    b.next = (b.next + 1) % capacity;
+  }
+}
+
+void enable(bool on)
+{
+  detail::enabled.store(on, std::memory_order_relaxed);
+}
+
+void clear()
+{
+  std::lock_guard lock{buffers_mutex};
+  for (auto it = buffers.begin(); it != buffers.end(); )
+  {
+    if (it->use_count() == 1) // the thread has exited
+    {
+      it = buffers.erase(it);
+      continue;
+    }
+    std::lock_guard block{(*it)->mutex};
+    (*it)->events.clear();
+    (*it)->next = 0;
+    ++it;
+  }
+}
+
+std::string chrome_trace_json()
+{
+  std::vector<std::shared_ptr<thread_buffer>> bufs;
+  {
+    std::lock_guard lock{buffers_mutex};
+    bufs = buffers;
+  }
+
+  std::string out = R"({"displayTimeUnit":"ms","traceEvents":[)";
+  bool first = true;
+  auto begin_event = [&] {
+    if (!first)
+      out += ",\n";
+    first = false;
+  };
+  std::vector<event> events;
+  for (auto& b : bufs)
+  {
+    {
+      std::lock_guard lock{b->mutex};
+      events.assign(b->events.begin() + b->next, b->events.end());
+      events.insert(events.end(), b->events.begin(), b->events.begin() + b->next);
+    }
+    const auto tid = std::to_string(b->tid);
+    if (!b->thread_name.empty())
+    {
+      begin_event();
+      out += R"({"ph":"M","name":"thread_name","pid":1,"tid":)" + tid + R"(,"args":{"name":)";
+      append_json_string(out, b->thread_name);
+      out += "}}";
+    }
+    for (auto& e : events)
+    {
+      begin_event();
+      out += R"({"ph":"X","pid":1,"tid":)" + tid + R"(,"cat":)";
+      append_json_string(out, e.cat);
+      out += R"(,"name":)";
+      append_json_string(out, e.name);
+      out += R"(,"ts":)";
+      append_us(out, e.start);
+      out += R"(,"dur":)";
+      append_us(out, e.end - e.start);
+      out += '}';
+    }
+  }
+  out += "]}";
+  return out;
+}
+
+}
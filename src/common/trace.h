@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/// Span tracing: TRACE_SPAN(category, name) records the wall time of the enclosing scope, on the
+/// current thread, as one complete event in a per-thread ring buffer.  Tracing is off until
+/// enabled at runtime (see the `trace` admin RPC); while off a span costs one relaxed atomic load.
+/// The recorded spans are exported as Chrome trace JSON, which chrome://tracing and Perfetto open.
+///
+/// Categories can be compiled out entirely by building with OXEN_TRACE_CATEGORIES set to a mask
+/// of the tools::trace::category values to keep.
+#ifndef OXEN_TRACE_CATEGORIES
+#define OXEN_TRACE_CATEGORIES 0xffffffffu
+#endif
+
+namespace tools::trace {
+
+  enum category : uint32_t {
+    blockchain = 1 << 0,
+    txpool     = 1 << 1,
+    rpc        = 1 << 2,
+    p2p        = 1 << 3,
+    perf       = 1 << 4, // PERF_TIMER sites
+  };
+
+  std::string_view category_name(category c);
+
+  namespace detail {
+    extern std::atomic<bool> enabled;
+    uint64_t now();
+    void record(std::string_view cat, std::string_view name, uint64_t start, uint64_t end);
+  }
+
+  // Whether spans are currently being recorded
+  inline bool enabled() { return detail::enabled.load(std::memory_order_relaxed); }
+
+  // Turns recording on or off.  Spans already recorded are kept until clear().
+  void enable(bool on);
+
+  // Drops every recorded span.
+  void clear();
+
+  // Returns the recorded spans (at most the last `capacity` per thread) as a Chrome trace JSON
+  // document: {"traceEvents":[...]} with complete ("X") events in microseconds.
+  std::string chrome_trace_json();
+
+  // The number of spans each thread keeps before overwriting its oldest
+  constexpr size_t capacity = 8192;
+
+  // Records the scope it lives in as a span; `name` (and `cat`) must outlive the trace, which
+  // string literals do.
+  template <uint32_t Category, bool = (Category & (OXEN_TRACE_CATEGORIES)) != 0>
+  class span {
+  public:
+    explicit span(std::string_view name) : name{name}, start{enabled() ? detail::now() : 0} {}
+    ~span() {
+      if (start)
+        detail::record(category_name(static_cast<category>(Category)), name, start, detail::now());
+    }
+    span(const span&) = delete;
+    span& operator=(const span&) = delete;
+  private:
+    std::string_view name;
+    uint64_t start;
+  };
+
+  template <uint32_t Category>
+  class span<Category, false> {
+  public:
+    explicit span(std::string_view) {}
+  };
+
+}
+
+#define TRACE_SPAN(cat, name) tools::trace::span<tools::trace::cat> trace_span_##name{#name}
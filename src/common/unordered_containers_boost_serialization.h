@@ -56,13 +56,14 @@ namespace boost
       x.clear();
       size_t s = 0;
       a >> s;
+      x.reserve(s);
       for(size_t i = 0; i != s; i++)
       {
         h_key k;
         hval v;
         a >> k;
         a >> v;
-        x.insert(std::pair<h_key, hval>(k, v));
+        x.emplace(std::move(k), std::move(v));
       }
     }
 
@@ -85,13 +86,14 @@ namespace boost
       x.clear();
       size_t s = 0;
       a >> s;
+      x.reserve(s);
       for(size_t i = 0; i != s; i++)
       {
         h_key k;
         hval v;
         a >> k;
         a >> v;
-        x.emplace(k, v);
+        x.emplace(std::move(k), std::move(v));
       }
     }
 
@@ -113,11 +115,12 @@ namespace boost
       x.clear();
       size_t s = 0;
       a >> s;
+      x.reserve(s);
       for(size_t i = 0; i != s; i++)
       {
         hval v;
         a >> v;
-        x.insert(v);
+        x.insert(std::move(v));
       }
     }
 
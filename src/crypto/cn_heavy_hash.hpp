@@ -122,6 +122,23 @@ public:
 			software_hash(in, len, out, prehashed);
 	}
 
+	// Hashes in0 with this context and in1 with `other`, which must be a different one; the same as
+	// two hash() calls, but with hardware AES on x86 their main loops run interleaved, hiding much of
+	// the latency of each.
+	void hash_x2(cn_heavy_hash& other, const void* in0, size_t len0, void* out0, const void* in1, size_t len1, void* out1)
+	{
+		assert(&other != this);
+#if defined(HAS_INTEL_HW)
+		if(cpu_aes_enabled)
+		{
+			hardware_hash_x2(other, in0, len0, out0, in1, len1, out1);
+			return;
+		}
+#endif
+		hash(in0, len0, out0);
+		other.hash(in1, len1, out1);
+	}
+
 	void software_hash(const void* in, size_t len, void* out, bool prehashed);
 	
 #if !defined(HAS_INTEL_HW) && !defined(HAS_ARM_HW)
@@ -130,6 +147,10 @@ public:
 	void hardware_hash(const void* in, size_t len, void* out, bool prehashed);
 #endif
 
+#if defined(HAS_INTEL_HW)
+	void hardware_hash_x2(cn_heavy_hash& other, const void* in0, size_t len0, void* out0, const void* in1, size_t len1, void* out1);
+#endif
+
 private:
 	static constexpr size_t MASK = ((MEMORY-1) >> 4) << 4;
 	friend cn_heavy_hash_v1;
@@ -353,60 +353,61 @@ inline uint64_t xmm_extract_64(__m128i x)
 #endif
 }
 
-template<size_t MEMORY, size_t ITER, size_t VERSION>
-void cn_heavy_hash<MEMORY,ITER,VERSION>::hardware_hash(const void* in, size_t len, void* out, bool prehashed)
+// The state of one hash's main loop, so that hardware_hash_x2 can run two of them side by side
+struct hard_loop_state
 {
-	if (!prehashed)
-		keccak((const uint8_t *)in, len, spad.as_byte(), 200);
+	uint64_t al0, ah0, idx0;
+	__m128i bx0;
+};
 
-	explode_scratchpad_hard();
-	
-	uint64_t* h0 = spad.as_uqword();
+static inline void hard_loop_init(hard_loop_state& s, const uint64_t* h0)
+{
+	s.al0 = h0[0] ^ h0[4];
+	s.ah0 = h0[1] ^ h0[5];
+	s.bx0 = _mm_set_epi64x(h0[3] ^ h0[7], h0[2] ^ h0[6]);
+	s.idx0 = h0[0] ^ h0[4];
+}
 
-	uint64_t al0 = h0[0] ^ h0[4];
-	uint64_t ah0 = h0[1] ^ h0[5];
-	__m128i bx0 = _mm_set_epi64x(h0[3] ^ h0[7], h0[2] ^ h0[6]);
+template<size_t MASK, size_t VERSION>
+static inline void hard_loop_step(cn_sptr lpad, hard_loop_state& s)
+{
+	auto scratchpad_ptr = [&lpad](uint64_t idx) { return lpad.offset(idx & MASK); };
 
-	uint64_t idx0 = h0[0] ^ h0[4];
+	__m128i cx;
+	cx = _mm_load_si128(as_xmm(scratchpad_ptr(s.idx0)));
 
-	// Optim - 90% time boundary
-	for(size_t i = 0; i < ITER; i++)
-	{
-		__m128i cx;
-		cx = _mm_load_si128(as_xmm(scratchpad_ptr(idx0)));
+	cx = _mm_aesenc_si128(cx, _mm_set_epi64x(s.ah0, s.al0));
 
-		cx = _mm_aesenc_si128(cx, _mm_set_epi64x(ah0, al0));
+	_mm_store_si128(as_xmm(scratchpad_ptr(s.idx0)), _mm_xor_si128(s.bx0, cx));
+	s.idx0 = xmm_extract_64(cx);
+	s.bx0 = cx;
 
-		_mm_store_si128(as_xmm(scratchpad_ptr(idx0)), _mm_xor_si128(bx0, cx));
-		idx0 = xmm_extract_64(cx);
-		bx0 = cx;
+	uint64_t hi, lo, cl, ch;
+	cl = scratchpad_ptr(s.idx0).as_uqword(0);
+	ch = scratchpad_ptr(s.idx0).as_uqword(1);
 
-		uint64_t hi, lo, cl, ch;
-		cl = scratchpad_ptr(idx0).as_uqword(0);
-		ch = scratchpad_ptr(idx0).as_uqword(1);
+	lo = _umul128(s.idx0, cl, &hi);
 
-		lo = _umul128(idx0, cl, &hi);
+	s.al0 += hi;
+	s.ah0 += lo;
+	scratchpad_ptr(s.idx0).as_uqword(0) = s.al0;
+	scratchpad_ptr(s.idx0).as_uqword(1) = s.ah0;
+	s.ah0 ^= ch;
+	s.al0 ^= cl;
+	s.idx0 = s.al0;
 
-		al0 += hi;
-		ah0 += lo;
-		scratchpad_ptr(idx0).as_uqword(0) = al0;
-		scratchpad_ptr(idx0).as_uqword(1) = ah0;
-		ah0 ^= ch;
-		al0 ^= cl;
-		idx0 = al0;
-		
-		if(VERSION > 0)
-		{
-			int64_t n  = scratchpad_ptr(idx0).as_qword(0);
-			int32_t d  = scratchpad_ptr(idx0).as_dword(2);
-			int64_t q = n / (d | 5);
-			scratchpad_ptr(idx0).as_qword(0) = n ^ q;
-			idx0 = d ^ q;
-		}
+	if(VERSION > 0)
+	{
+		int64_t n  = scratchpad_ptr(s.idx0).as_qword(0);
+		int32_t d  = scratchpad_ptr(s.idx0).as_dword(2);
+		int64_t q = n / (d | 5);
+		scratchpad_ptr(s.idx0).as_qword(0) = n ^ q;
+		s.idx0 = d ^ q;
 	}
+}
 
-	implode_scratchpad_hard();
-
+static void hard_finish(cn_sptr spad, void* out)
+{
 	keccakf(spad.as_uqword(), 24);
 
 	switch(spad.as_byte(0) & 3)
@@ -426,6 +427,55 @@ void cn_heavy_hash<MEMORY,ITER,VERSION>::hardware_hash(const void* in, size_t le
 	}
 }
 
+template<size_t MEMORY, size_t ITER, size_t VERSION>
+void cn_heavy_hash<MEMORY,ITER,VERSION>::hardware_hash(const void* in, size_t len, void* out, bool prehashed)
+{
+	if (!prehashed)
+		keccak((const uint8_t *)in, len, spad.as_byte(), 200);
+
+	explode_scratchpad_hard();
+
+	hard_loop_state s;
+	hard_loop_init(s, spad.as_uqword());
+
+	// Optim - 90% time boundary
+	for(size_t i = 0; i < ITER; i++)
+		hard_loop_step<MASK, VERSION>(lpad, s);
+
+	implode_scratchpad_hard();
+
+	hard_finish(spad, out);
+}
+
+template<size_t MEMORY, size_t ITER, size_t VERSION>
+void cn_heavy_hash<MEMORY,ITER,VERSION>::hardware_hash_x2(cn_heavy_hash& other, const void* in0, size_t len0, void* out0, const void* in1, size_t len1, void* out1)
+{
+	keccak((const uint8_t *)in0, len0, spad.as_byte(), 200);
+	keccak((const uint8_t *)in1, len1, other.spad.as_byte(), 200);
+
+	// these already keep the AES unit busy with eight blocks at a time, so gain nothing from pairing
+	explode_scratchpad_hard();
+	other.explode_scratchpad_hard();
+
+	hard_loop_state s0, s1;
+	hard_loop_init(s0, spad.as_uqword());
+	hard_loop_init(s1, other.spad.as_uqword());
+
+	// each iteration is one long dependency chain (load, aesenc, store, load, mul, and for v2 a
+	// division); two independent ones fill each other's stalls
+	for(size_t i = 0; i < ITER; i++)
+	{
+		hard_loop_step<MASK, VERSION>(lpad, s0);
+		hard_loop_step<MASK, VERSION>(other.lpad, s1);
+	}
+
+	implode_scratchpad_hard();
+	other.implode_scratchpad_hard();
+
+	hard_finish(spad, out0);
+	hard_finish(other.spad, out1);
+}
+
 template class cn_heavy_hash<2*1024*1024, 0x80000, 0>;
 template class cn_heavy_hash<4*1024*1024, 0x40000, 1>;
 
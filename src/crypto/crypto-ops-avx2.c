@@ -0,0 +1,360 @@
+/* AVX2 version of ge_scalarmult that computes four independent scalar multiplications at once.
+ *
+ * ge_scalarmult's control flow doesn't depend on its inputs, so four of them can run in lockstep
+ * with each field element limb held in a 64-bit lane (one lane per point).  The field arithmetic
+ * mirrors crypto-ops.c's ref10 code limb for limb: products are formed from the same 32-bit
+ * operands, summed into the same 64-bit integers and carried in the same order, so every lane
+ * ends up with exactly ge_scalarmult's result, representation included.
+ *
+ * This file is compiled with -mavx2; ge_scalarmult_x4 (in crypto-ops.c) only calls in here when
+ * the running CPU supports it.
+ */
+
+#include <immintrin.h>
+
+#include "crypto-ops.h"
+
+/* The product loops below only vectorise well when fully unrolled, so that the operand choices
+ * are made at compile time */
+#if defined(__clang__)
+#define UNROLL _Pragma("unroll")
+#elif defined(__GNUC__)
+#define UNROLL _Pragma("GCC unroll 10")
+#else
+#define UNROLL
+#endif
+
+typedef __m256i fe4[10];
+
+typedef struct {
+  fe4 X;
+  fe4 Y;
+  fe4 Z;
+} ge4_p2;
+
+typedef struct {
+  fe4 X;
+  fe4 Y;
+  fe4 Z;
+  fe4 T;
+} ge4_p3;
+
+typedef struct {
+  fe4 X;
+  fe4 Y;
+  fe4 Z;
+  fe4 T;
+} ge4_p1p1;
+
+typedef struct {
+  fe4 YplusX;
+  fe4 YminusX;
+  fe4 Z;
+  fe4 T2d;
+} ge4_cached;
+
+static void fe4_load(fe4 h, const fe f0, const fe f1, const fe f2, const fe f3) {
+  int i;
+  for (i = 0; i < 10; i++)
+    h[i] = _mm256_set_epi64x(f3[i], f2[i], f1[i], f0[i]);
+}
+
+static void fe4_store(fe f0, fe f1, fe f2, fe f3, const fe4 h) {
+  int i;
+  for (i = 0; i < 10; i++) {
+    int64_t l[4];
+    _mm256_storeu_si256((__m256i *) l, h[i]);
+    f0[i] = (int32_t) l[0];
+    f1[i] = (int32_t) l[1];
+    f2[i] = (int32_t) l[2];
+    f3[i] = (int32_t) l[3];
+  }
+}
+
+static void fe4_set(fe4 h, const fe f) {
+  int i;
+  for (i = 0; i < 10; i++)
+    h[i] = _mm256_set1_epi64x(f[i]);
+}
+
+static void fe4_0(fe4 h) {
+  int i;
+  for (i = 0; i < 10; i++)
+    h[i] = _mm256_setzero_si256();
+}
+
+static void fe4_1(fe4 h) {
+  fe4_0(h);
+  h[0] = _mm256_set1_epi64x(1);
+}
+
+static void fe4_copy(fe4 h, const fe4 f) {
+  int i;
+  for (i = 0; i < 10; i++)
+    h[i] = f[i];
+}
+
+static void fe4_add(fe4 h, const fe4 f, const fe4 g) {
+  int i;
+  for (i = 0; i < 10; i++)
+    h[i] = _mm256_add_epi64(f[i], g[i]);
+}
+
+static void fe4_sub(fe4 h, const fe4 f, const fe4 g) {
+  int i;
+  for (i = 0; i < 10; i++)
+    h[i] = _mm256_sub_epi64(f[i], g[i]);
+}
+
+static void fe4_neg(fe4 h, const fe4 f) {
+  int i;
+  for (i = 0; i < 10; i++)
+    h[i] = _mm256_sub_epi64(_mm256_setzero_si256(), f[i]);
+}
+
+/* Replaces f with g in the lanes where mask is all ones; mask lanes must be all ones or zero. */
+static void fe4_cmov(fe4 f, const fe4 g, __m256i mask) {
+  int i;
+  for (i = 0; i < 10; i++)
+    f[i] = _mm256_blendv_epi8(f[i], g[i], mask);
+}
+
+/* 19 * f, in 64 bits (there is no 64-bit multiply in AVX2) */
+static inline __m256i mul19(__m256i f) {
+  return _mm256_add_epi64(_mm256_add_epi64(_mm256_slli_epi64(f, 4), _mm256_slli_epi64(f, 1)), f);
+}
+
+/* (h + 2^(s-1)) >> s with ref10's signed shift.  AVX2 has no 64-bit arithmetic shift, so the shift
+ * is done on h + 2^62 (a multiple of 2^s, and non-negative for the |h| < 2^61.5 that fe_sq2 can
+ * reach) and the bias is taken back off afterwards. */
+static inline __m256i fe4_carry(__m256i h, int s) {
+  const int64_t bias = (int64_t) 1 << 62;
+  __m256i t = _mm256_add_epi64(h, _mm256_set1_epi64x(bias + ((int64_t) 1 << (s - 1))));
+  return _mm256_sub_epi64(_mm256_srli_epi64(t, s), _mm256_set1_epi64x(bias >> s));
+}
+
+#define FE4_CARRY(i, s) do { \
+    __m256i c = fe4_carry(h[i], s); \
+    h[(i) + 1] = _mm256_add_epi64(h[(i) + 1], c); \
+    h[i] = _mm256_sub_epi64(h[i], _mm256_slli_epi64(c, s)); \
+  } while (0)
+
+/* The carry chain shared by ref10's fe_mul, fe_sq and fe_sq2 */
+static void fe4_reduce(fe4 out, __m256i h[10]) {
+  __m256i c;
+  FE4_CARRY(0, 26);
+  FE4_CARRY(4, 26);
+  FE4_CARRY(1, 25);
+  FE4_CARRY(5, 25);
+  FE4_CARRY(2, 26);
+  FE4_CARRY(6, 26);
+  FE4_CARRY(3, 25);
+  FE4_CARRY(7, 25);
+  FE4_CARRY(4, 26);
+  FE4_CARRY(8, 26);
+  c = fe4_carry(h[9], 25);
+  h[0] = _mm256_add_epi64(h[0], mul19(c));
+  h[9] = _mm256_sub_epi64(h[9], _mm256_slli_epi64(c, 25));
+  FE4_CARRY(0, 26);
+  fe4_copy(out, h);
+}
+
+#undef FE4_CARRY
+
+/* h = f * g, as fe_mul: the odd limbs of f are doubled when multiplied by odd limbs of g, and the
+ * limbs of g are multiplied by 19 where the product wraps around. */
+static void fe4_mul(fe4 h, const fe4 f, const fe4 g) {
+  __m256i f2[10], g19[10], t[10];
+  int i, j;
+  for (i = 0; i < 10; i++) {
+    f2[i] = _mm256_add_epi64(f[i], f[i]);
+    g19[i] = mul19(g[i]);
+    t[i] = _mm256_setzero_si256();
+  }
+  UNROLL
+  for (i = 0; i < 10; i++) {
+    UNROLL
+    for (j = 0; j < 10; j++) {
+      __m256i a = (i & j & 1) ? f2[i] : f[i];
+      __m256i b = i + j >= 10 ? g19[j] : g[j];
+      t[(i + j) % 10] = _mm256_add_epi64(t[(i + j) % 10], _mm256_mul_epi32(a, b));
+    }
+  }
+  fe4_reduce(h, t);
+}
+
+/* The products of fe_sq (each cross product counted once, doubled), before carrying */
+static void fe4_sq_terms(__m256i t[10], const fe4 f) {
+  __m256i f2[10], f4[10], f19[10];
+  int i, j;
+  for (i = 0; i < 10; i++) {
+    f2[i] = _mm256_add_epi64(f[i], f[i]);
+    f4[i] = _mm256_add_epi64(f2[i], f2[i]);
+    f19[i] = mul19(f[i]);
+    t[i] = _mm256_setzero_si256();
+  }
+  UNROLL
+  for (i = 0; i < 10; i++) {
+    UNROLL
+    for (j = i; j < 10; j++) {
+      int scale = (i != j ? 2 : 1) * ((i & j & 1) ? 2 : 1);
+      __m256i a = scale == 4 ? f4[i] : scale == 2 ? f2[i] : f[i];
+      __m256i b = i + j >= 10 ? f19[j] : f[j];
+      t[(i + j) % 10] = _mm256_add_epi64(t[(i + j) % 10], _mm256_mul_epi32(a, b));
+    }
+  }
+}
+
+static void fe4_sq(fe4 h, const fe4 f) {
+  __m256i t[10];
+  fe4_sq_terms(t, f);
+  fe4_reduce(h, t);
+}
+
+/* h = 2 * f * f */
+static void fe4_sq2(fe4 h, const fe4 f) {
+  __m256i t[10];
+  int i;
+  fe4_sq_terms(t, f);
+  for (i = 0; i < 10; i++)
+    t[i] = _mm256_add_epi64(t[i], t[i]);
+  fe4_reduce(h, t);
+}
+
+static void ge4_add(ge4_p1p1 *r, const ge4_p3 *p, const ge4_cached *q) {
+  fe4 t0;
+  fe4_add(r->X, p->Y, p->X);
+  fe4_sub(r->Y, p->Y, p->X);
+  fe4_mul(r->Z, r->X, q->YplusX);
+  fe4_mul(r->Y, r->Y, q->YminusX);
+  fe4_mul(r->T, q->T2d, p->T);
+  fe4_mul(r->X, p->Z, q->Z);
+  fe4_add(t0, r->X, r->X);
+  fe4_sub(r->X, r->Z, r->Y);
+  fe4_add(r->Y, r->Z, r->Y);
+  fe4_add(r->Z, t0, r->T);
+  fe4_sub(r->T, t0, r->T);
+}
+
+static void ge4_p1p1_to_p2(ge4_p2 *r, const ge4_p1p1 *p) {
+  fe4_mul(r->X, p->X, p->T);
+  fe4_mul(r->Y, p->Y, p->Z);
+  fe4_mul(r->Z, p->Z, p->T);
+}
+
+static void ge4_p1p1_to_p3(ge4_p3 *r, const ge4_p1p1 *p) {
+  fe4_mul(r->X, p->X, p->T);
+  fe4_mul(r->Y, p->Y, p->Z);
+  fe4_mul(r->Z, p->Z, p->T);
+  fe4_mul(r->T, p->X, p->Y);
+}
+
+static void ge4_p2_dbl(ge4_p1p1 *r, const ge4_p2 *p) {
+  fe4 t0;
+  fe4_sq(r->X, p->X);
+  fe4_sq(r->Z, p->Y);
+  fe4_sq2(r->T, p->Z);
+  fe4_add(r->Y, p->X, p->Y);
+  fe4_sq(t0, r->Y);
+  fe4_add(r->Y, r->Z, r->X);
+  fe4_sub(r->Z, r->Z, r->X);
+  fe4_sub(r->X, t0, r->Y);
+  fe4_sub(r->T, r->T, r->Z);
+}
+
+static void ge4_p3_to_cached(ge4_cached *r, const ge4_p3 *p, const fe4 d2) {
+  fe4_add(r->YplusX, p->Y, p->X);
+  fe4_sub(r->YminusX, p->Y, p->X);
+  fe4_copy(r->Z, p->Z);
+  fe4_mul(r->T2d, p->T, d2);
+}
+
+static void ge4_cached_0(ge4_cached *r) {
+  fe4_1(r->YplusX);
+  fe4_1(r->YminusX);
+  fe4_1(r->Z);
+  fe4_0(r->T2d);
+}
+
+static void ge4_cached_cmov(ge4_cached *t, const ge4_cached *u, __m256i mask) {
+  fe4_cmov(t->YplusX, u->YplusX, mask);
+  fe4_cmov(t->YminusX, u->YminusX, mask);
+  fe4_cmov(t->Z, u->Z, mask);
+  fe4_cmov(t->T2d, u->T2d, mask);
+}
+
+/* Same recoding as ge_scalarmult; assumes that a[31] <= 127 */
+static void recode(signed char *e, const unsigned char *a) {
+  int carry, carry2, i;
+  carry = 0;
+  for (i = 0; i < 31; i++) {
+    carry += a[i];
+    carry2 = (carry + 8) >> 4;
+    e[2 * i] = carry - (carry2 << 4);
+    carry = (carry2 + 8) >> 4;
+    e[2 * i + 1] = carry2 - (carry << 4);
+  }
+  carry += a[31];
+  carry2 = (carry + 8) >> 4;
+  e[62] = carry - (carry2 << 4);
+  e[63] = carry2;
+}
+
+void ge_scalarmult_x4_avx2(ge_p2 *r, const unsigned char *const *a, const ge_p3 *A) {
+  signed char e[4][64];
+  int i, k;
+  fe4 d2;
+  ge4_p3 A4, u;
+  ge4_cached Ai[8]; /* 1 * A, 2 * A, ..., 8 * A */
+  ge4_p1p1 t;
+  ge4_p2 r4;
+
+  for (k = 0; k < 4; k++)
+    recode(e[k], a[k]);
+
+  fe4_set(d2, fe_d2);
+  fe4_load(A4.X, A[0].X, A[1].X, A[2].X, A[3].X);
+  fe4_load(A4.Y, A[0].Y, A[1].Y, A[2].Y, A[3].Y);
+  fe4_load(A4.Z, A[0].Z, A[1].Z, A[2].Z, A[3].Z);
+  fe4_load(A4.T, A[0].T, A[1].T, A[2].T, A[3].T);
+
+  ge4_p3_to_cached(&Ai[0], &A4, d2);
+  for (i = 0; i < 7; i++) {
+    ge4_add(&t, &A4, &Ai[i]);
+    ge4_p1p1_to_p3(&u, &t);
+    ge4_p3_to_cached(&Ai[i + 1], &u, d2);
+  }
+
+  fe4_0(r4.X);
+  fe4_1(r4.Y);
+  fe4_1(r4.Z);
+  for (i = 63; i >= 0; i--) {
+    /* Per lane: the absolute value of the digit, and all ones if it is negative */
+    const __m256i b = _mm256_set_epi64x(e[3][i], e[2][i], e[1][i], e[0][i]);
+    const __m256i bnegative = _mm256_cmpgt_epi64(_mm256_setzero_si256(), b);
+    const __m256i babs = _mm256_sub_epi64(_mm256_xor_si256(b, bnegative), bnegative);
+    ge4_cached cur, minuscur;
+    ge4_p2_dbl(&t, &r4);
+    ge4_p1p1_to_p2(&r4, &t);
+    ge4_p2_dbl(&t, &r4);
+    ge4_p1p1_to_p2(&r4, &t);
+    ge4_p2_dbl(&t, &r4);
+    ge4_p1p1_to_p2(&r4, &t);
+    ge4_p2_dbl(&t, &r4);
+    ge4_p1p1_to_p3(&u, &t);
+    ge4_cached_0(&cur);
+    for (k = 0; k < 8; k++)
+      ge4_cached_cmov(&cur, &Ai[k], _mm256_cmpeq_epi64(babs, _mm256_set1_epi64x(k + 1)));
+    fe4_copy(minuscur.YplusX, cur.YminusX);
+    fe4_copy(minuscur.YminusX, cur.YplusX);
+    fe4_copy(minuscur.Z, cur.Z);
+    fe4_neg(minuscur.T2d, cur.T2d);
+    ge4_cached_cmov(&cur, &minuscur, bnegative);
+    ge4_add(&t, &u, &cur);
+    ge4_p1p1_to_p2(&r4, &t);
+  }
+
+  fe4_store(r[0].X, r[1].X, r[2].X, r[3].X, r4.X);
+  fe4_store(r[0].Y, r[1].Y, r[2].Y, r[3].Y, r4.Y);
+  fe4_store(r[0].Z, r[1].Z, r[2].Z, r[3].Z, r4.Z);
+}
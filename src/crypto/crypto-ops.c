@@ -39,7 +39,6 @@ DISABLE_VS_WARNINGS(4146 4244)
 
 static void fe_mul(fe, const fe, const fe);
 static void fe_sq(fe, const fe);
-static void ge_madd(ge_p1p1 *, const ge_p3 *, const ge_precomp *);
 static void ge_msub(ge_p1p1 *, const ge_p3 *, const ge_precomp *);
 static void ge_p2_0(ge_p2 *);
 static void ge_p3_dbl(ge_p1p1 *, const ge_p3 *);
@@ -1428,7 +1427,7 @@ int ge_frombytes_vartime(ge_p3 *h, const unsigned char *s) {
 r = p + q
 */
 
-static void ge_madd(ge_p1p1 *r, const ge_p3 *p, const ge_precomp *q) {
+void ge_madd(ge_p1p1 *r, const ge_p3 *p, const ge_precomp *q) {
   fe t0;
   fe_add(r->X, p->Y, p->X);
   fe_sub(r->Y, p->Y, p->X);
@@ -1548,6 +1547,19 @@ void ge_p3_to_cached(ge_cached *r, const ge_p3 *p) {
   fe_mul(r->T2d, p->T, fe_d2);
 }
 
+/* r = p in affine form, for ge_madd; costs an inversion */
+
+void ge_p3_to_precomp(ge_precomp *r, const ge_p3 *p) {
+  fe recip, x, y;
+  fe_invert(recip, p->Z);
+  fe_mul(x, p->X, recip);
+  fe_mul(y, p->Y, recip);
+  fe_add(r->yplusx, y, x);
+  fe_sub(r->yminusx, y, x);
+  fe_mul(r->xy2d, x, y);
+  fe_mul(r->xy2d, r->xy2d, fe_d2);
+}
+
 /* From ge_p3_to_p2.c */
 
 /*
@@ -1712,6 +1724,37 @@ void ge_tobytes(unsigned char *s, const ge_p2 *h) {
   s[31] ^= fe_isnegative(x) << 7;
 }
 
+/* Encodes n points into s (32 bytes each) like ge_tobytes, but with a single field inversion for
+   the whole batch (Montgomery's trick).  tmp is scratch space for n field elements. */
+void ge_tobytes_batch(unsigned char *s, const ge_p2 *h, fe *tmp, size_t n) {
+  fe acc;
+  fe recip;
+  fe x;
+  fe y;
+  size_t i;
+
+  if (n == 0) {
+    return;
+  }
+  fe_copy(tmp[0], h[0].Z);
+  for (i = 1; i < n; i++) {
+    fe_mul(tmp[i], tmp[i - 1], h[i].Z);
+  }
+  fe_invert(acc, tmp[n - 1]);
+  for (i = n; i-- > 0;) {
+    if (i > 0) {
+      fe_mul(recip, acc, tmp[i - 1]);
+      fe_mul(acc, acc, h[i].Z);
+    } else {
+      fe_copy(recip, acc);
+    }
+    fe_mul(x, h[i].X, recip);
+    fe_mul(y, h[i].Y, recip);
+    fe_tobytes(s + 32 * i, y);
+    s[32 * i + 31] ^= fe_isnegative(x) << 7;
+  }
+}
+
 /* From sc_reduce.c */
 
 /*
@@ -2094,6 +2137,24 @@ void ge_scalarmult(ge_p2 *r, const unsigned char *a, const ge_p3 *A) {
   }
 }
 
+#ifdef HAVE_CRYPTO_OPS_AVX2
+void ge_scalarmult_x4_avx2(ge_p2 *, const unsigned char *const *, const ge_p3 *);
+#endif
+
+/* r[i] = a[i] * A[i] for i = 0..3, with exactly the results of ge_scalarmult; uses the AVX2 version
+   when the CPU has it.  Assumes that a[i][31] <= 127 */
+void ge_scalarmult_x4(ge_p2 *r, const unsigned char *const *a, const ge_p3 *A) {
+  int i;
+#ifdef HAVE_CRYPTO_OPS_AVX2
+  if (__builtin_cpu_supports("avx2")) {
+    ge_scalarmult_x4_avx2(r, a, A);
+    return;
+  }
+#endif
+  for (i = 0; i < 4; i++)
+    ge_scalarmult(&r[i], a[i], &A[i]);
+}
+
 void ge_scalarmult_p3(ge_p3 *r3, const unsigned char *a, const ge_p3 *A) {
   signed char e[64];
   int carry, carry2, i;
@@ -29,6 +29,7 @@
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
 #pragma once
+#include <stddef.h>
 #include <stdint.h>
 
 /* From fe.h */
@@ -105,6 +106,7 @@ void ge_p2_dbl(ge_p1p1 *, const ge_p2 *);
 
 extern const fe fe_d2;
 void ge_p3_to_cached(ge_cached *, const ge_p3 *);
+void ge_p3_to_precomp(ge_precomp *, const ge_p3 *);
 
 /* From ge_p3_to_p2.c */
 
@@ -122,6 +124,7 @@ void ge_scalarmult_base(ge_p3 *, const unsigned char *);
 /* From ge_tobytes.c */
 
 void ge_tobytes(unsigned char *, const ge_p2 *);
+void ge_tobytes_batch(unsigned char *, const ge_p2 *, fe *, size_t);
 
 /* From sc_reduce.c */
 
@@ -131,6 +134,7 @@ void sc_reduce(unsigned char *);
 
 void ge_scalarmult(ge_p2 *, const unsigned char *, const ge_p3 *);
 void ge_scalarmult_p3(ge_p3 *, const unsigned char *, const ge_p3 *);
+void ge_scalarmult_x4(ge_p2 *, const unsigned char *const *, const ge_p3 *);
 void ge_double_scalarmult_precomp_vartime(ge_p2 *, const unsigned char *, const ge_p3 *, const unsigned char *, const ge_dsmp);
 void ge_triple_scalarmult_precomp_vartime(ge_p2 *, const unsigned char *, const ge_dsmp, const unsigned char *, const ge_dsmp, const unsigned char *, const ge_dsmp);
 void ge_double_scalarmult_precomp_vartime2(ge_p2 *, const unsigned char *, const ge_dsmp, const unsigned char *, const ge_dsmp);
@@ -159,6 +163,7 @@ int sc_isnonzero(const unsigned char *); /* Doesn't normalize */
 uint64_t load_3(const unsigned char *in);
 uint64_t load_4(const unsigned char *in);
 void ge_sub(ge_p1p1 *r, const ge_p3 *p, const ge_cached *q);
+void ge_madd(ge_p1p1 *r, const ge_p3 *p, const ge_precomp *q);
 void fe_add(fe h, const fe f, const fe g);
 void fe_tobytes(unsigned char *, const fe);
 void fe_invert(fe out, const fe z);
@@ -37,6 +37,7 @@
 #include <cstdio>
 #include <memory>
 #include <stdexcept>
+#include <vector>
 
 #include "common/varint.h"
 #include "epee/warnings.h"
@@ -213,6 +214,40 @@ namespace crypto {
     return true;
   }
 
+  void generate_key_derivations(const public_key *keys, size_t count, const secret_key &key2, key_derivation *derivations, bool *valid) {
+    assert(sc_check(&key2) == 0);
+    std::vector<ge_p3> inputs;
+    std::vector<size_t> indices;
+    inputs.reserve(count);
+    indices.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+      valid[i] = ge_frombytes_vartime(&inputs.emplace_back(), &keys[i]) == 0;
+      if (valid[i])
+        indices.push_back(i);
+      else
+        inputs.pop_back();
+    }
+    // Four scalar multiplications at a time (vectorised where the CPU allows), then the rest
+    std::vector<ge_p2> points(inputs.size());
+    const unsigned char *const scalars[4] = {&unwrap(key2), &unwrap(key2), &unwrap(key2), &unwrap(key2)};
+    size_t n = 0;
+    for (; n + 4 <= inputs.size(); n += 4)
+      ge_scalarmult_x4(&points[n], scalars, &inputs[n]);
+    for (; n < inputs.size(); n++)
+      ge_scalarmult(&points[n], &unwrap(key2), &inputs[n]);
+    for (auto &point : points) {
+      ge_p1p1 point3;
+      ge_mul8(&point3, &point);
+      ge_p1p1_to_p2(&point, &point3);
+    }
+    std::vector<key_derivation> encoded(points.size());
+    std::unique_ptr<fe[]> scratch{new fe[points.size()]};
+    static_assert(sizeof(key_derivation) == 32, "Unexpected key_derivation size");
+    ge_tobytes_batch(reinterpret_cast<unsigned char*>(encoded.data()), points.data(), scratch.get(), points.size());
+    for (size_t i = 0; i < indices.size(); i++)
+      derivations[indices[i]] = encoded[i];
+  }
+
   void derivation_to_scalar(const key_derivation &derivation, size_t output_index, ec_scalar &res) {
     struct {
       key_derivation derivation;
@@ -271,6 +306,35 @@ namespace crypto {
     return true;
   }
 
+  void derive_subaddress_public_keys(const public_key *out_keys, const key_derivation *derivations, const size_t *output_indices, size_t count, public_key *derived_keys, bool *valid) {
+    std::vector<ge_p2> points;
+    std::vector<size_t> indices;
+    points.reserve(count);
+    indices.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+      ec_scalar scalar;
+      ge_p3 point1;
+      ge_p3 point2;
+      ge_cached point3;
+      ge_p1p1 point4;
+      valid[i] = ge_frombytes_vartime(&point1, &out_keys[i]) == 0;
+      if (!valid[i])
+        continue;
+      derivation_to_scalar(derivations[i], output_indices[i], scalar);
+      ge_scalarmult_base(&point2, &scalar);
+      ge_p3_to_cached(&point3, &point2);
+      ge_sub(&point4, &point1, &point3);
+      ge_p1p1_to_p2(&points.emplace_back(), &point4);
+      indices.push_back(i);
+    }
+    std::vector<public_key> encoded(points.size());
+    std::unique_ptr<fe[]> scratch{new fe[points.size()]};
+    static_assert(sizeof(public_key) == 32, "Unexpected public_key size");
+    ge_tobytes_batch(reinterpret_cast<unsigned char*>(encoded.data()), points.data(), scratch.get(), points.size());
+    for (size_t i = 0; i < indices.size(); i++)
+      derived_keys[indices[i]] = encoded[i];
+  }
+
   struct s_comm {
     hash h;
     ec_point key;
@@ -516,6 +580,58 @@ namespace crypto {
     ge_tobytes(&image, &point2);
   }
 
+  void generate_key_images(const public_key *pubs, const secret_key *secs, size_t count, key_image *images) {
+    std::vector<std::string_view> keys;
+    keys.reserve(count);
+    for (size_t i = 0; i < count; i++)
+      keys.emplace_back(reinterpret_cast<const char *>(&pubs[i]), sizeof(public_key));
+    const std::vector<hash> hashes = cn_fast_hash_batch(keys);
+    std::vector<ge_p3> points(count);
+    for (size_t i = 0; i < count; i++) {
+      ge_p2 point;
+      ge_p1p1 point2;
+      ge_fromfe_frombytes_vartime(&point, reinterpret_cast<const unsigned char *>(&hashes[i]));
+      ge_mul8(&point2, &point);
+      ge_p1p1_to_p3(&points[i], &point2);
+    }
+    std::vector<ge_p2> results(count);
+    size_t n = 0;
+    for (; n + 4 <= count; n += 4) {
+      const unsigned char *const scalars[4] = {&unwrap(secs[n]), &unwrap(secs[n + 1]), &unwrap(secs[n + 2]), &unwrap(secs[n + 3])};
+      assert(sc_check(scalars[0]) == 0 && sc_check(scalars[1]) == 0 && sc_check(scalars[2]) == 0 && sc_check(scalars[3]) == 0);
+      ge_scalarmult_x4(&results[n], scalars, &points[n]);
+    }
+    for (; n < count; n++) {
+      assert(sc_check(&secs[n]) == 0);
+      ge_scalarmult(&results[n], &unwrap(secs[n]), &points[n]);
+    }
+    std::unique_ptr<fe[]> scratch{new fe[count]};
+    ge_tobytes_batch(reinterpret_cast<unsigned char *>(images), results.data(), scratch.get(), count);
+  }
+
+  void check_key_images_domain(const key_image *images, size_t count, bool *in_domain) {
+    static constexpr unsigned char order[32] = {0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10};
+    static constexpr unsigned char zero[32] = {};
+    std::vector<ge_p2> points;
+    std::vector<size_t> indices;
+    points.reserve(count);
+    indices.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+      ge_p3 point;
+      in_domain[i] = false;
+      if (ge_frombytes_vartime(&point, &images[i]) != 0)
+        continue;
+      ge_double_scalarmult_base_vartime(&points.emplace_back(), order, &point, zero);
+      indices.push_back(i);
+    }
+    std::vector<ec_point> encoded(points.size());
+    std::unique_ptr<fe[]> scratch{new fe[points.size()]};
+    ge_tobytes_batch(reinterpret_cast<unsigned char *>(encoded.data()), points.data(), scratch.get(), points.size());
+    for (size_t i = 0; i < indices.size(); i++)
+      in_domain[indices[i]] = memcmp(&encoded[i], &infinity, 32) == 0;
+  }
+
   struct rs_comm {
     hash prefix;
     std::vector<std::pair<ec_point, ec_point>> ab;
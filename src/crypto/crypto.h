@@ -202,6 +202,19 @@ namespace crypto {
   void derive_secret_key(const key_derivation &derivation, std::size_t output_index, const secret_key &base, secret_key &derived_key);
   bool derive_subaddress_public_key(const public_key &out_key, const key_derivation &derivation, std::size_t output_index, public_key &result);
 
+  /* Batched version of generate_key_derivation for many public keys and a single secret key (e.g.
+   * the view key when scanning): uses one field inversion for the whole batch instead of one per
+   * key.  valid[i] is set to whether keys[i] was a valid point; derivations[i] is only set if so.
+   */
+  void generate_key_derivations(const public_key *keys, std::size_t count, const secret_key &key2, key_derivation *derivations, bool *valid);
+
+  /* Batched version of derive_subaddress_public_key: derived_keys[i] is the subaddress spend key
+   * of out_keys[i] under derivations[i] and output_indices[i], encoded with one field inversion
+   * for the whole batch.  valid[i] is set to whether out_keys[i] was a valid point; derived_keys[i]
+   * is only set if so.
+   */
+  void derive_subaddress_public_keys(const public_key *out_keys, const key_derivation *derivations, const std::size_t *output_indices, std::size_t count, public_key *derived_keys, bool *valid);
+
   /* Generation and checking of a non-standard Monero curve 25519 signature.  This is a custom
    * scheme that is not Ed25519 because it uses a random "r" (unlike Ed25519's use of a
    * deterministic value), it requires pre-hashing the message (Ed25519 does not), and produces
@@ -255,6 +268,16 @@ namespace crypto {
    * To check the signature, it is necessary to collect all the keys that were used to generate it. To detect double spends, it is necessary to check that each key image is used at most once.
    */
   void generate_key_image(const public_key &pub, const secret_key &sec, key_image &image);
+  /* Batched version of generate_key_image: the hashes to the curve go four at a time, as do the
+   * scalar multiplications (vectorised where the CPU allows), and the images are encoded with one
+   * field inversion for the whole batch.
+   */
+  void generate_key_images(const public_key *pubs, const secret_key *secs, std::size_t count, key_image *images);
+  /* Checks that key images are in the prime order subgroup (l*image == identity), as required of
+   * every key image on chain; in_domain[i] is set to whether images[i] is.  Variable time, with one
+   * field inversion for the whole batch.
+   */
+  void check_key_images_domain(const key_image *images, std::size_t count, bool *in_domain);
   void generate_ring_signature(
       const hash& prefix_hash,
       const key_image& image,
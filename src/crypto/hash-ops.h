@@ -62,6 +62,9 @@ enum
 
 #define CN_TURTLE_PAGE_SIZE 262144
 void cn_fast_hash(const void *data, size_t length, char *hash);
+// cn_fast_hash of each of count inputs, four at a time where the CPU allows it.  hashes[i] may
+// overlap data[j] only for j <= i.
+void cn_fast_hash_batch(const void *const *data, const size_t *length, size_t count, char (*hashes)[HASH_SIZE]);
 void cn_turtle_hash(const void *data, size_t length, char *hash, int light, int variant, int prehashed, uint32_t scratchpad, uint32_t iterations);
 #ifdef ENABLE_MONERO_SLOW_HASH
 void cn_monero_hash(const void *data, size_t length, char *hash, int variant, int prehashed);
@@ -72,6 +75,7 @@ void hash_extra_groestl(const void *data, size_t length, char *hash);
 void hash_extra_jh(const void *data, size_t length, char *hash);
 void hash_extra_skein(const void *data, size_t length, char *hash);
 
+size_t tree_hash_cnt(size_t count);
 void tree_hash(const char (*hashes)[HASH_SIZE], size_t count, char *root_hash);
 
 void rx_slow_hash_allocate_state(void);
@@ -79,4 +83,16 @@ void rx_slow_hash_free_state(void);
 uint64_t rx_seedheight(const uint64_t height);
 void rx_seedheights(const uint64_t height, uint64_t *seed_height, uint64_t *next_height);
 void rx_slow_hash(const uint64_t mainheight, const uint64_t seedheight, const char *seedhash, const void *data, size_t length, char *hash, int miners, int is_alt);
+// Pipelined mainchain hashing, for miners: rx_slow_hash_first sets up the thread's VM as
+// rx_slow_hash does and starts on `data`; each rx_slow_hash_next then starts on `next_data` and
+// returns the hash of the previous input.  Start over with rx_slow_hash_first for a new seed.
+void rx_slow_hash_first(const uint64_t mainheight, const uint64_t seedheight, const char *seedhash, const void *data, size_t length, int miners);
+void rx_slow_hash_next(const void *next_data, size_t length, char *hash);
+// Sets up the (light mode) cache for a seed ahead of rx_slow_hash needing it for mainchain blocks
+void rx_prepare_seed(const uint64_t seedheight, const char *seedhash);
 void rx_reorg(const uint64_t split_height);
+// Bytes held by the RandomX caches, datasets and VMs
+uint64_t rx_memory_usage(void);
+// Sets the NUMA node of the calling thread, so that its full-memory (mining) hashes use and build
+// a dataset local to that node; threads that never call this share node 0's dataset.
+void rx_set_numa_node(int node);
@@ -56,3 +56,18 @@ void cn_fast_hash(const void *data, size_t length, char *hash) {
   hash_process(&state, data, length);
   memcpy(hash, &state, HASH_SIZE);
 }
+
+void cn_fast_hash_batch(const void *const *data, const size_t *length, size_t count, char (*hashes)[HASH_SIZE]) {
+  size_t i, n;
+  for (i = 0; i + 4 <= count; i += 4) {
+    const uint8_t *in[4];
+    uint8_t *md[4];
+    for (n = 0; n < 4; n++) {
+      in[n] = data[i + n];
+      md[n] = (uint8_t*)hashes[i + n];
+    }
+    keccak_x4(in, length + i, md, HASH_SIZE);
+  }
+  for (; i < count; i++)
+    cn_fast_hash(data[i], length[i], hashes[i]);
+}
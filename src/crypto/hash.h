@@ -32,6 +32,8 @@
 
 #include <cstddef>
 #include <ostream>
+#include <string_view>
+#include <vector>
 
 #include "generic-ops.h"
 #include "common/hex.h"
@@ -69,6 +71,19 @@ namespace crypto {
     return h;
   }
 
+  /// cn_fast_hash of each blob, several at a time where the CPU allows it
+  inline std::vector<hash> cn_fast_hash_batch(const std::vector<std::string_view> &blobs) {
+    std::vector<const void *> data(blobs.size());
+    std::vector<std::size_t> length(blobs.size());
+    for (std::size_t i = 0; i < blobs.size(); ++i) {
+      data[i] = blobs[i].data();
+      length[i] = blobs[i].size();
+    }
+    std::vector<hash> hashes(blobs.size());
+    cn_fast_hash_batch(data.data(), length.data(), blobs.size(), reinterpret_cast<char (*)[HASH_SIZE]>(hashes.data()));
+    return hashes;
+  }
+
   enum struct cn_slow_hash_type
   {
 #ifdef ENABLE_MONERO_SLOW_HASH
@@ -83,17 +98,27 @@ namespace crypto {
     turtle_lite_v2,
   };
 
+  /// The heavy hash scratchpads of the calling thread, kept for the thread's lifetime; v1 borrows
+  /// v2's (larger) pads.  cn_slow_hash_x2 uses a second set for its second hash.
+  struct heavy_hash_contexts {
+    cn_heavy_hash_v2 v2;
+    cn_heavy_hash_v1 v1 = cn_heavy_hash_v1::make_borrowed(v2);
+  };
+  template <int N>
+  heavy_hash_contexts &heavy_hash_context() {
+    static thread_local heavy_hash_contexts ctx;
+    return ctx;
+  }
+
   inline void cn_slow_hash(const void *data, std::size_t length, hash &hash, cn_slow_hash_type type) {
     switch(type)
     {
       case cn_slow_hash_type::heavy_v1:
       case cn_slow_hash_type::heavy_v2:
       {
-        static thread_local cn_heavy_hash_v2 v2;
-        static thread_local cn_heavy_hash_v1 v1 = cn_heavy_hash_v1::make_borrowed(v2);
-
-        if (type == cn_slow_hash_type::heavy_v1) v1.hash(data, length, hash.data);
-        else                                     v2.hash(data, length, hash.data);
+        auto &ctx = heavy_hash_context<0>();
+        if (type == cn_slow_hash_type::heavy_v1) ctx.v1.hash(data, length, hash.data);
+        else                                     ctx.v2.hash(data, length, hash.data);
       }
       break;
 
@@ -134,6 +159,20 @@ namespace crypto {
     }
   }
 
+  /// Two cn_slow_hash()es of the same type.  The heavy types are hashed interleaved (see
+  /// cn_heavy_hash::hash_x2), which is faster than one after the other with hardware AES.
+  inline void cn_slow_hash_x2(const void *data0, std::size_t length0, hash &hash0, const void *data1, std::size_t length1, hash &hash1, cn_slow_hash_type type) {
+    if (type == cn_slow_hash_type::heavy_v1 || type == cn_slow_hash_type::heavy_v2) {
+      auto &ctx0 = heavy_hash_context<0>();
+      auto &ctx1 = heavy_hash_context<1>();
+      if (type == cn_slow_hash_type::heavy_v1) ctx0.v1.hash_x2(ctx1.v1, data0, length0, hash0.data, data1, length1, hash1.data);
+      else                                     ctx0.v2.hash_x2(ctx1.v2, data0, length0, hash0.data, data1, length1, hash1.data);
+      return;
+    }
+    cn_slow_hash(data0, length0, hash0, type);
+    cn_slow_hash(data1, length1, hash1, type);
+  }
+
   inline void tree_hash(const hash *hashes, std::size_t count, hash &root_hash) {
     tree_hash(reinterpret_cast<const char (*)[HASH_SIZE]>(hashes), count, reinterpret_cast<char *>(&root_hash));
   }
@@ -0,0 +1,98 @@
+/* AVX2 version of keccakf that runs four independent Keccak-f[1600] permutations at once, with
+ * each of the 25 state words held in a 256-bit register (one 64-bit lane per state).
+ *
+ * This file is compiled with -mavx2; keccak_x4 (in keccak.c) only calls in here when the running
+ * CPU supports it.
+ */
+
+#include <immintrin.h>
+
+#include "keccak.h"
+
+/* Fully unrolled, the rotation counts and lane indices below become constants */
+#if defined(__clang__)
+#define UNROLL _Pragma("unroll")
+#elif defined(__GNUC__)
+#define UNROLL _Pragma("GCC unroll 25")
+#else
+#define UNROLL
+#endif
+
+#define ROTL256(x, y) _mm256_or_si256(_mm256_slli_epi64((x), (y)), _mm256_srli_epi64((x), 64 - (y)))
+
+/* Copies of the tables in keccak.c, so that the compiler can see their values */
+static const uint64_t rndc[24] =
+{
+    0x0000000000000001, 0x0000000000008082, 0x800000000000808a,
+    0x8000000080008000, 0x000000000000808b, 0x0000000080000001,
+    0x8000000080008081, 0x8000000000008009, 0x000000000000008a,
+    0x0000000000000088, 0x0000000080008009, 0x000000008000000a,
+    0x000000008000808b, 0x800000000000008b, 0x8000000000008089,
+    0x8000000000008003, 0x8000000000008002, 0x8000000000000080,
+    0x000000000000800a, 0x800000008000000a, 0x8000000080008081,
+    0x8000000000008080, 0x0000000080000001, 0x8000000080008008
+};
+
+static const int rotc[24] =
+{
+    1,  3,  6,  10, 15, 21, 28, 36, 45, 55, 2,  14,
+    27, 41, 56, 8,  25, 43, 62, 18, 39, 61, 20, 44
+};
+
+static const int piln[24] =
+{
+    10, 7,  11, 17, 18, 3, 5,  16, 8,  21, 24, 4,
+    15, 23, 19, 13, 12, 2, 20, 14, 22, 9,  6,  1
+};
+
+void keccakf_x4_avx2(uint64_t st[25][4])
+{
+    __m256i a[25], bc[5], t;
+    int i, j, round;
+
+    for (i = 0; i < 25; i++)
+        a[i] = _mm256_loadu_si256((const __m256i *) st[i]);
+
+    for (round = 0; round < KECCAK_ROUNDS; round++) {
+
+        // Theta
+        UNROLL
+        for (i = 0; i < 5; i++)
+            bc[i] = _mm256_xor_si256(_mm256_xor_si256(_mm256_xor_si256(a[i], a[i + 5]), _mm256_xor_si256(a[i + 10], a[i + 15])), a[i + 20]);
+
+        UNROLL
+        for (i = 0; i < 5; i++) {
+            t = _mm256_xor_si256(bc[(i + 4) % 5], ROTL256(bc[(i + 1) % 5], 1));
+            UNROLL
+            for (j = 0; j < 25; j += 5)
+                a[j + i] = _mm256_xor_si256(a[j + i], t);
+        }
+
+        // Rho Pi
+        t = a[1];
+        UNROLL
+        for (i = 0; i < 24; i++) {
+            j = piln[i];
+            bc[0] = a[j];
+            a[j] = ROTL256(t, rotc[i]);
+            t = bc[0];
+        }
+
+        //  Chi
+        UNROLL
+        for (j = 0; j < 25; j += 5) {
+            UNROLL
+            for (i = 0; i < 5; i++)
+                bc[i] = a[j + i];
+            UNROLL
+            for (i = 0; i < 5; i++)
+                a[j + i] = _mm256_xor_si256(a[j + i], _mm256_andnot_si256(bc[(i + 1) % 5], bc[(i + 2) % 5]));
+        }
+
+        //  Iota
+        a[0] = _mm256_xor_si256(a[0], _mm256_set1_epi64x(rndc[round]));
+    }
+
+    for (i = 0; i < 25; i++)
+        _mm256_storeu_si256((__m256i *) st[i], a[i]);
+}
@@ -144,6 +144,74 @@ void keccak1600(const uint8_t *in, size_t inlen, uint8_t *md)
     keccak(in, inlen, md, sizeof(state_t));
 }
 
+#ifdef HAVE_KECCAK_AVX2
+void keccakf_x4_avx2(uint64_t st[25][4]);
+#endif
+
+// compute four keccak hashes at once; with AVX2 the four permutations run side by side, each input
+// taking as many of them as it needs (so inputs of similar length go best together)
+void keccak_x4(const uint8_t *const in[4], const size_t inlen[4], uint8_t *const md[4], int mdlen)
+{
+    size_t n;
+#ifdef HAVE_KECCAK_AVX2
+    if (mdlen > 0 && mdlen <= 96 && mdlen % 8 == 0 && __builtin_cpu_supports("avx2")) {
+        uint64_t st[25][4];
+        uint64_t out[4][12];
+        uint8_t temp[144];
+        const size_t rsiz = 200 - 2 * mdlen, rsizw = rsiz / 8;
+        size_t blocks[4], max_blocks = 0, b, i;
+
+        for (n = 0; n < 4; n++) {
+            blocks[n] = inlen[n] / rsiz + 1;
+            if (blocks[n] > max_blocks)
+                max_blocks = blocks[n];
+        }
+        memset(st, 0, sizeof(st));
+
+        for (b = 0; b < max_blocks; b++) {
+            for (n = 0; n < 4; n++) {
+                const uint8_t *block = in[n] + b * rsiz;
+                if (b + 1 < blocks[n]) {
+                    for (i = 0; i < rsizw; i++) {
+                        uint64_t ina;
+                        memcpy(&ina, block + i * 8, 8);
+                        st[i][n] ^= swap64le(ina);
+                    }
+                } else if (b + 1 == blocks[n]) {
+                    // last block and padding
+                    const size_t rest = inlen[n] - b * rsiz;
+                    if (rest > 0)
+                        memcpy(temp, block, rest);
+                    temp[rest] = 1;
+                    memset(temp + rest + 1, 0, rsiz - rest - 1);
+                    temp[rsiz - 1] |= 0x80;
+                    for (i = 0; i < rsizw; i++) {
+                        uint64_t ina;
+                        memcpy(&ina, temp + i * 8, 8);
+                        st[i][n] ^= swap64le(ina);
+                    }
+                }
+                // else this input is already done, and its lane just runs along
+            }
+
+            keccakf_x4_avx2(st);
+
+            for (n = 0; n < 4; n++)
+                if (b + 1 == blocks[n])
+                    for (i = 0; i < (size_t)mdlen / 8; i++)
+                        out[n][i] = st[i][n];
+        }
+
+        // only written at the end, so the outputs may overwrite the inputs
+        for (n = 0; n < 4; n++)
+            memcpy_swap64le(md[n], out[n], mdlen / 8);
+        return;
+    }
+#endif
+    for (n = 0; n < 4; n++)
+        keccak(in[n], inlen[n], md[n], mdlen);
+}
+
 #define KECCAK_FINALIZED 0x80000000
 #define KECCAK_BLOCKLEN 136
 #define KECCAK_WORDS 17
@@ -34,6 +34,9 @@ void keccakf(uint64_t st[25], int norounds);
 
 void keccak1600(const uint8_t *in, size_t inlen, uint8_t *md);
 
+// compute four keccak hashes (md[i] of mdlen bytes) of in[i], at once where the CPU allows it
+void keccak_x4(const uint8_t *const in[4], const size_t inlen[4], uint8_t *const md[4], int mdlen);
+
 void keccak_init(KECCAK_CTX * ctx);
 void keccak_update(KECCAK_CTX * ctx, const uint8_t *in, size_t inlen);
 void keccak_finish(KECCAK_CTX * ctx, uint8_t *md);
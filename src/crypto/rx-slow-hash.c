@@ -26,6 +26,10 @@
 // STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
@@ -33,6 +37,9 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <limits.h>
+#if defined(__linux__)
+#include <sched.h>
+#endif
 
 #include "randomx.h"
 #include "c_threads.h"
@@ -59,10 +66,18 @@ static CTHR_MUTEX_TYPE rx_dataset_mutex = CTHR_MUTEX_INIT;
 
 static rx_state rx_s[2] = {{CTHR_MUTEX_INIT,{0},0,0},{CTHR_MUTEX_INIT,{0},0,0}};
 
-static randomx_dataset *rx_dataset;
+/* one full-memory dataset per NUMA node that has miner threads on it */
+#define RX_MAX_NODES	8
+static randomx_dataset *rx_dataset[RX_MAX_NODES];
 static int rx_dataset_nomem;
-static uint64_t rx_dataset_height;
+static uint64_t rx_dataset_height[RX_MAX_NODES];
 static THREADV randomx_vm *rx_vm = NULL;
+static THREADV int rx_node = 0;
+static uint64_t rx_vm_count; /* protected by rx_mutex */
+
+/* RANDOMX_ARGON_MEMORY KiB and RANDOMX_SCRATCHPAD_L3 bytes, which randomx.h doesn't export */
+#define RX_CACHE_BYTES	(256ULL << 20)
+#define RX_VM_BYTES	(2ULL << 20)
 
 static void local_abort(const char *msg)
 {
@@ -114,13 +129,18 @@ static inline int enabled_flags(void) {
 #define SEEDHASH_EPOCH_BLOCKS	2048	/* Must be same as BLOCKS_SYNCHRONIZING_MAX_COUNT in cryptonote_config.h */
 #define SEEDHASH_EPOCH_LAG		64
 
+void rx_set_numa_node(int node) {
+  rx_node = (node >= 0 && node < RX_MAX_NODES) ? node : 0;
+}
+
 void rx_reorg(const uint64_t split_height) {
-  int i;
+  int i, n;
   CTHR_MUTEX_LOCK(rx_mutex);
   for (i=0; i<2; i++) {
     if (split_height <= rx_s[i].rs_height) {
-      if (rx_s[i].rs_height == rx_dataset_height)
-        rx_dataset_height = 1;
+      for (n=0; n<RX_MAX_NODES; n++)
+        if (rx_s[i].rs_height == rx_dataset_height[n])
+          rx_dataset_height[n] = 1;
       rx_s[i].rs_height = 1;	/* set to an invalid seed height */
     }
   }
@@ -139,6 +159,7 @@ void rx_seedheights(const uint64_t height, uint64_t *seedheight, uint64_t *nexth
 }
 
 typedef struct seedinfo {
+  randomx_dataset *si_dataset;
   randomx_cache *si_cache;
   unsigned long si_start;
   unsigned long si_count;
@@ -146,11 +167,25 @@ typedef struct seedinfo {
 
 static CTHR_THREAD_RTYPE rx_seedthread(void *arg) {
   seedinfo *si = arg;
-  randomx_init_dataset(rx_dataset, si->si_cache, si->si_start, si->si_count);
+  randomx_init_dataset(si->si_dataset, si->si_cache, si->si_start, si->si_count);
   CTHR_THREAD_RETURN;
 }
 
-static void rx_initdata(randomx_cache *rs_cache, const int miners, const uint64_t seedheight) {
+/* Builds the calling thread's node's dataset.  The seed threads inherit the caller's CPU affinity,
+ * so when the miner is pinned to a node, the dataset pages are first touched (and so placed) there. */
+static void rx_initdata(randomx_cache *rs_cache, int miners, const uint64_t seedheight) {
+  randomx_dataset *dataset = rx_dataset[rx_node];
+  /* the miners all wait for the dataset, so build it on every core we may run on rather than just theirs */
+#if defined(__linux__)
+  cpu_set_t allowed;
+  const long cpus = sched_getaffinity(0, sizeof(allowed), &allowed) == 0 ? CPU_COUNT(&allowed) : 0;
+#elif defined(_SC_NPROCESSORS_ONLN)
+  const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+  const long cpus = 0;
+#endif
+  if (cpus > miners && cpus <= 256)
+    miners = cpus;
   if (miners > 1) {
     unsigned long delta = randomx_dataset_item_count() / miners;
     unsigned long start = 0;
@@ -166,36 +201,78 @@ static void rx_initdata(randomx_cache *rs_cache, const int miners, const uint64_
       local_abort("Couldn't allocate RandomX mining threadlist");
     }
     for (i=0; i<miners-1; i++) {
+      si[i].si_dataset = dataset;
       si[i].si_cache = rs_cache;
       si[i].si_start = start;
       si[i].si_count = delta;
       start += delta;
     }
+    si[i].si_dataset = dataset;
     si[i].si_cache = rs_cache;
     si[i].si_start = start;
     si[i].si_count = randomx_dataset_item_count() - start;
     for (i=1; i<miners; i++) {
       CTHR_THREAD_CREATE(st[i], rx_seedthread, &si[i]);
     }
-    randomx_init_dataset(rx_dataset, rs_cache, 0, si[0].si_count);
+    randomx_init_dataset(dataset, rs_cache, 0, si[0].si_count);
     for (i=1; i<miners; i++) {
       CTHR_THREAD_JOIN(st[i]);
     }
     free(st);
     free(si);
   } else {
-    randomx_init_dataset(rx_dataset, rs_cache, 0, randomx_dataset_item_count());
+    randomx_init_dataset(dataset, rs_cache, 0, randomx_dataset_item_count());
   }
-  rx_dataset_height = seedheight;
+  rx_dataset_height[rx_node] = seedheight;
 }
 
-void rx_slow_hash(const uint64_t mainheight, const uint64_t seedheight, const char *seedhash, const void *data, size_t length,
-  char *hash, int miners, int is_alt) {
+/* Sets up the cache of a slot for the given seed (if it isn't already); rx_sp->rs_mutex must be held */
+static randomx_cache *rx_prepare_cache(rx_state *rx_sp, randomx_flags flags, const uint64_t seedheight, const char *seedhash) {
+  randomx_cache *cache = rx_sp->rs_cache;
+  if (cache == NULL) {
+    cache = randomx_alloc_cache(flags | RANDOMX_FLAG_LARGE_PAGES);
+    if (cache == NULL) {
+      mdebug(RX_LOGCAT, "Couldn't use largePages for RandomX cache");
+      cache = randomx_alloc_cache(flags);
+    }
+    if (cache == NULL)
+      local_abort("Couldn't allocate RandomX cache");
+  }
+  if (rx_sp->rs_height != seedheight || rx_sp->rs_cache == NULL || memcmp(seedhash, rx_sp->rs_hash, HASH_SIZE)) {
+    randomx_init_cache(cache, seedhash, HASH_SIZE);
+    rx_sp->rs_cache = cache;
+    rx_sp->rs_height = seedheight;
+    memcpy(rx_sp->rs_hash, seedhash, HASH_SIZE);
+  }
+  return cache;
+}
+
+void rx_prepare_seed(const uint64_t seedheight, const char *seedhash) {
+  /* the slot rx_slow_hash uses for mainchain blocks hashed with this seed */
+  int toggle = (seedheight & SEEDHASH_EPOCH_BLOCKS) != 0;
+  randomx_flags flags = enabled_flags() & ~disabled_flags();
+  rx_state *rx_sp;
+
+  CTHR_MUTEX_LOCK(rx_mutex);
+  rx_sp = &rx_s[toggle];
+  CTHR_MUTEX_LOCK(rx_sp->rs_mutex);
+  CTHR_MUTEX_UNLOCK(rx_mutex);
+  rx_prepare_cache(rx_sp, flags, seedheight, seedhash);
+  CTHR_MUTEX_UNLOCK(rx_sp->rs_mutex);
+}
+
+/* Sets up the calling thread's VM for a hash of a block at mainheight with the given seed; returns
+ * the seed slot it uses, whose rs_mutex the caller must unlock: before hashing for a mainchain
+ * hash, afterwards if *is_alt is set on return. */
+static rx_state *rx_setup_vm(const uint64_t mainheight, const uint64_t seedheight, const char *seedhash,
+  int miners, int *is_alt_p) {
+  int is_alt = *is_alt_p;
   uint64_t s_height = rx_seedheight(mainheight);
   int toggle = (s_height & SEEDHASH_EPOCH_BLOCKS) != 0;
   randomx_flags flags = enabled_flags() & ~disabled_flags();
   rx_state *rx_sp;
   randomx_cache *cache;
+  randomx_dataset **dataset = &rx_dataset[rx_node];
 
   CTHR_MUTEX_LOCK(rx_mutex);
 
@@ -218,24 +295,7 @@ void rx_slow_hash(const uint64_t mainheight, const uint64_t seedheight, const ch
   CTHR_MUTEX_LOCK(rx_sp->rs_mutex);
   CTHR_MUTEX_UNLOCK(rx_mutex);
 
-  cache = rx_sp->rs_cache;
-  if (cache == NULL) {
-    if (cache == NULL) {
-      cache = randomx_alloc_cache(flags | RANDOMX_FLAG_LARGE_PAGES);
-      if (cache == NULL) {
-        mdebug(RX_LOGCAT, "Couldn't use largePages for RandomX cache");
-        cache = randomx_alloc_cache(flags);
-      }
-      if (cache == NULL)
-        local_abort("Couldn't allocate RandomX cache");
-    }
-  }
-  if (rx_sp->rs_height != seedheight || rx_sp->rs_cache == NULL || memcmp(seedhash, rx_sp->rs_hash, HASH_SIZE)) {
-    randomx_init_cache(cache, seedhash, HASH_SIZE);
-    rx_sp->rs_cache = cache;
-    rx_sp->rs_height = seedheight;
-    memcpy(rx_sp->rs_hash, seedhash, HASH_SIZE);
-  }
+  cache = rx_prepare_cache(rx_sp, flags, seedheight, seedhash);
   if (rx_vm == NULL) {
     if ((flags & RANDOMX_FLAG_JIT) && !miners) {
         flags |= RANDOMX_FLAG_SECURE & ~disabled_flags();
@@ -246,17 +306,17 @@ void rx_slow_hash(const uint64_t mainheight, const uint64_t seedheight, const ch
     if (miners) {
       CTHR_MUTEX_LOCK(rx_dataset_mutex);
       if (!rx_dataset_nomem) {
-        if (rx_dataset == NULL) {
-          rx_dataset = randomx_alloc_dataset(RANDOMX_FLAG_LARGE_PAGES);
-          if (rx_dataset == NULL) {
+        if (*dataset == NULL) {
+          *dataset = randomx_alloc_dataset(RANDOMX_FLAG_LARGE_PAGES);
+          if (*dataset == NULL) {
             mdebug(RX_LOGCAT, "Couldn't use largePages for RandomX dataset");
-            rx_dataset = randomx_alloc_dataset(RANDOMX_FLAG_DEFAULT);
+            *dataset = randomx_alloc_dataset(RANDOMX_FLAG_DEFAULT);
           }
-          if (rx_dataset != NULL)
+          if (*dataset != NULL)
             rx_initdata(rx_sp->rs_cache, miners, seedheight);
         }
       }
-      if (rx_dataset != NULL)
+      if (*dataset != NULL)
         flags |= RANDOMX_FLAG_FULL_MEM;
       else {
         miners = 0;
@@ -267,22 +327,25 @@ void rx_slow_hash(const uint64_t mainheight, const uint64_t seedheight, const ch
       }
       CTHR_MUTEX_UNLOCK(rx_dataset_mutex);
     }
-    rx_vm = randomx_create_vm(flags | RANDOMX_FLAG_LARGE_PAGES, rx_sp->rs_cache, rx_dataset);
+    rx_vm = randomx_create_vm(flags | RANDOMX_FLAG_LARGE_PAGES, rx_sp->rs_cache, *dataset);
     if(rx_vm == NULL) { //large pages failed
       mdebug(RX_LOGCAT, "Couldn't use largePages for RandomX VM");
-      rx_vm = randomx_create_vm(flags, rx_sp->rs_cache, rx_dataset);
+      rx_vm = randomx_create_vm(flags, rx_sp->rs_cache, *dataset);
     }
     if(rx_vm == NULL) {//fallback if everything fails
       flags = RANDOMX_FLAG_DEFAULT | (miners ? RANDOMX_FLAG_FULL_MEM : 0);
-      rx_vm = randomx_create_vm(flags, rx_sp->rs_cache, rx_dataset);
+      rx_vm = randomx_create_vm(flags, rx_sp->rs_cache, *dataset);
     }
     if (rx_vm == NULL)
       local_abort("Couldn't allocate RandomX VM");
+    CTHR_MUTEX_LOCK(rx_mutex);
+    rx_vm_count++;
+    CTHR_MUTEX_UNLOCK(rx_mutex);
   } else if (miners) {
     CTHR_MUTEX_LOCK(rx_dataset_mutex);
-    if (rx_dataset != NULL && rx_dataset_height != seedheight)
+    if (*dataset != NULL && rx_dataset_height[rx_node] != seedheight)
       rx_initdata(cache, miners, seedheight);
-    else if (rx_dataset == NULL) {
+    else if (*dataset == NULL) {
       /* this is a no-op if the cache hasn't changed */
       randomx_vm_set_cache(rx_vm, rx_sp->rs_cache);
     }
@@ -291,6 +354,13 @@ void rx_slow_hash(const uint64_t mainheight, const uint64_t seedheight, const ch
     /* this is a no-op if the cache hasn't changed */
     randomx_vm_set_cache(rx_vm, rx_sp->rs_cache);
   }
+  *is_alt_p = is_alt;
+  return rx_sp;
+}
+
+void rx_slow_hash(const uint64_t mainheight, const uint64_t seedheight, const char *seedhash, const void *data, size_t length,
+  char *hash, int miners, int is_alt) {
+  rx_state *rx_sp = rx_setup_vm(mainheight, seedheight, seedhash, miners, &is_alt);
   /* mainchain users can run in parallel */
   if (!is_alt)
     CTHR_MUTEX_UNLOCK(rx_sp->rs_mutex);
@@ -300,6 +370,35 @@ void rx_slow_hash(const uint64_t mainheight, const uint64_t seedheight, const ch
     CTHR_MUTEX_UNLOCK(rx_sp->rs_mutex);
 }
 
+void rx_slow_hash_first(const uint64_t mainheight, const uint64_t seedheight, const char *seedhash, const void *data, size_t length,
+  int miners) {
+  int is_alt = 0;
+  rx_state *rx_sp = rx_setup_vm(mainheight, seedheight, seedhash, miners, &is_alt);
+  CTHR_MUTEX_UNLOCK(rx_sp->rs_mutex);
+  randomx_calculate_hash_first(rx_vm, data, length);
+}
+
+void rx_slow_hash_next(const void *next_data, size_t length, char *hash) {
+  randomx_calculate_hash_next(rx_vm, next_data, length, hash);
+}
+
+uint64_t rx_memory_usage(void) {
+  uint64_t bytes = 0;
+  int i;
+  CTHR_MUTEX_LOCK(rx_mutex);
+  for (i=0; i<2; i++)
+    if (rx_s[i].rs_cache != NULL)
+      bytes += RX_CACHE_BYTES;
+  bytes += rx_vm_count * RX_VM_BYTES;
+  CTHR_MUTEX_UNLOCK(rx_mutex);
+  CTHR_MUTEX_LOCK(rx_dataset_mutex);
+  for (i=0; i<RX_MAX_NODES; i++)
+    if (rx_dataset[i] != NULL)
+      bytes += (uint64_t)randomx_dataset_item_count() * RANDOMX_DATASET_ITEM_SIZE;
+  CTHR_MUTEX_UNLOCK(rx_dataset_mutex);
+  return bytes;
+}
+
 void rx_slow_hash_allocate_state(void) {
 }
 
@@ -307,15 +406,21 @@ void rx_slow_hash_free_state(void) {
   if (rx_vm != NULL) {
     randomx_destroy_vm(rx_vm);
     rx_vm = NULL;
+    CTHR_MUTEX_LOCK(rx_mutex);
+    rx_vm_count--;
+    CTHR_MUTEX_UNLOCK(rx_mutex);
   }
 }
 
 void rx_stop_mining(void) {
+  int n;
   CTHR_MUTEX_LOCK(rx_dataset_mutex);
-  if (rx_dataset != NULL) {
-    randomx_dataset *rd = rx_dataset;
-    rx_dataset = NULL;
-    randomx_release_dataset(rd);
+  for (n=0; n<RX_MAX_NODES; n++) {
+    if (rx_dataset[n] != NULL) {
+      randomx_dataset *rd = rx_dataset[n];
+      rx_dataset[n] = NULL;
+      randomx_release_dataset(rd);
+    }
   }
   rx_dataset_nomem = 0;
   CTHR_MUTEX_UNLOCK(rx_dataset_mutex);
@@ -59,6 +59,27 @@ size_t tree_hash_cnt(size_t count) {
 	return pow >> 1;
 }
 
+/***
+* Hashes count consecutive pairs of hashes from in into out, which may be the same buffer
+*/
+static void tree_hash_pairs(const char *in, size_t count, char *out) {
+  const void *data[64];
+  size_t length[64];
+  size_t i, n;
+
+  while (count > 0) {
+    n = count < 64 ? count : 64;
+    for (i = 0; i < n; ++i) {
+      data[i] = in + i * 2 * HASH_SIZE;
+      length[i] = 2 * HASH_SIZE;
+    }
+    cn_fast_hash_batch(data, length, n, (char (*)[HASH_SIZE])out);
+    in += n * 2 * HASH_SIZE;
+    out += n * HASH_SIZE;
+    count -= n;
+  }
+}
+
 void tree_hash(const char (*hashes)[HASH_SIZE], size_t count, char *root_hash) {
 // The blockchain block at height 202612 https://moneroblocks.info/block/202612
 // contained 514 transactions, that triggered bad calculation of variable "cnt" in the original version of this function
@@ -79,8 +100,6 @@ void tree_hash(const char (*hashes)[HASH_SIZE], size_t count, char *root_hash) {
   } else if (count == 2) {
     cn_fast_hash(hashes, 2 * HASH_SIZE, root_hash);
   } else {
-    size_t i, j;
-
     size_t cnt = tree_hash_cnt( count );
 
     char *ints = calloc(cnt, HASH_SIZE);  // zero out as extra protection for using uninitialized mem
@@ -88,16 +107,12 @@ void tree_hash(const char (*hashes)[HASH_SIZE], size_t count, char *root_hash) {
 
     memcpy(ints, hashes, (2 * cnt - count) * HASH_SIZE);
 
-    for (i = 2 * cnt - count, j = 2 * cnt - count; j < cnt; i += 2, ++j) {
-      cn_fast_hash(hashes[i], 64, ints + j * HASH_SIZE);
-    }
-    assert(i == count);
+    // each level's hashes are independent of each other, so they are done in batches
+    tree_hash_pairs(hashes[2 * cnt - count], count - cnt, ints + (2 * cnt - count) * HASH_SIZE);
 
     while (cnt > 2) {
       cnt >>= 1;
-      for (i = 0, j = 0; j < cnt; i += 2, ++j) {
-        cn_fast_hash(ints + i * HASH_SIZE, 64, ints + j * HASH_SIZE);
-      }
+      tree_hash_pairs(ints, cnt, ints);
     }
 
     cn_fast_hash(ints, 64, root_hash);
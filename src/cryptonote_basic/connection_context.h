@@ -35,6 +35,7 @@
 #include "epee/net/net_utils_base.h"
 #include "epee/copyable_atomic.h"
 #include "crypto/hash.h"
+#include "known_inventory.h"
 
 namespace cryptonote
 {
@@ -64,6 +65,7 @@ namespace cryptonote
     uint32_t m_pruning_seed{0};
     uint16_t m_rpc_port{0};
     bool m_anchor{false};
+    known_inventory m_known_inventory; // blob hashes of txs/blocks this peer has sent us or we've sent it
     //size_t m_score{0};  TODO: add score calculations
   };
 
@@ -39,6 +39,7 @@
 #include "epee/string_tools.h"
 #include "common/i18n.h"
 #include "common/meta.h"
+#include "common/threadpool.h"
 #include "serialization/string.h"
 #include "serialization/binary_utils.h"
 #include "cryptonote_format_utils.h"
@@ -1408,6 +1409,14 @@ namespace cryptonote
     return blob;
   }
   //---------------------------------------------------------------
+  size_t get_block_hashing_blob_nonce_offset(const block_header& b)
+  {
+    return tools::get_varint_data(b.major_version).size() +
+      tools::get_varint_data(b.minor_version).size() +
+      tools::get_varint_data(b.timestamp).size() +
+      sizeof(b.prev_id);
+  }
+  //---------------------------------------------------------------
   bool calculate_block_hash(const block& b, crypto::hash& res)
   {
     bool hash_result = get_object_hash(get_block_hashing_blob(b), res);
@@ -1509,9 +1518,46 @@ namespace cryptonote
     return t_serializable_object_to_blob(tx, b_blob);
   }
   //---------------------------------------------------------------
+  // Below this many hashes a tree hash takes less time than handing it out to the thread pool
+  static constexpr size_t PARALLEL_TREE_HASH_MIN = 2048;
+  //---------------------------------------------------------------
   void get_tx_tree_hash(const std::vector<crypto::hash>& tx_hashes, crypto::hash& h)
   {
-    tree_hash(tx_hashes.data(), tx_hashes.size(), h);
+    const size_t count = tx_hashes.size();
+    tools::threadpool& tpool = tools::threadpool::getInstance();
+    size_t chunks = 1;
+    while (chunks * 2 <= tpool.get_max_concurrency() && chunks * 512 <= count)
+      chunks *= 2;
+    if (count < PARALLEL_TREE_HASH_MIN || chunks == 1 || tools::threadpool::in_leaf_task())
+    {
+      tree_hash(tx_hashes.data(), count, h);
+      return;
+    }
+
+    // Past its first level (which pairs up the last hashes to leave a power of two), the tree is a
+    // perfect binary tree, so it splits into power of two sized subtrees that hash independently,
+    // the roots of which are then tree hashed in turn.
+    const size_t cnt = crypto::tree_hash_cnt(count);
+    const size_t copied = 2 * cnt - count;
+    const size_t chunk_size = cnt / chunks;
+    std::vector<crypto::hash> level(cnt);
+    std::vector<crypto::hash> roots(chunks);
+    tools::threadpool::waiter waiter;
+    for (size_t c = 0; c < chunks; ++c)
+    {
+      tpool.submit(&waiter, [&, c] {
+        for (size_t i = c * chunk_size; i < (c + 1) * chunk_size; ++i)
+        {
+          if (i < copied)
+            level[i] = tx_hashes[i];
+          else
+            crypto::cn_fast_hash(&tx_hashes[copied + 2 * (i - copied)], 2 * sizeof(crypto::hash), level[i]);
+        }
+        tree_hash(&level[c * chunk_size], chunk_size, roots[c]);
+      }, true);
+    }
+    waiter.wait(&tpool);
+    tree_hash(roots.data(), chunks, h);
   }
   //---------------------------------------------------------------
   crypto::hash get_tx_tree_hash(const std::vector<crypto::hash>& tx_hashes)
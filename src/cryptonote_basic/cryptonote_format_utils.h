@@ -192,6 +192,8 @@ namespace cryptonote
   crypto::hash get_pruned_transaction_hash(const transaction& t, const crypto::hash &pruned_data_hash);
 
   blobdata get_block_hashing_blob(const block& b);
+  // Offset of the 4-byte little-endian nonce within get_block_hashing_blob(b)
+  size_t get_block_hashing_blob_nonce_offset(const block_header& b);
   bool calculate_block_hash(const block& b, crypto::hash& res);
   bool get_block_hash(const block& b, crypto::hash& res);
   crypto::hash get_block_hash(const block& b);
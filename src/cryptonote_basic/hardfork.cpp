@@ -101,6 +101,47 @@ static_assert(is_ordered(testnet_hard_forks),
 static_assert(is_ordered(devnet_hard_forks),
     "Invalid devnet hard forks: version must start at 7, versions and heights must be strictly increasing, and timestamps must be non-decreasing");
 
+// Returns the number of leading entries of the (ordered) fork table [begin, end) for which `pred`
+// holds; `pred` must be true for some prefix of the table and false for the rest.  This is
+// std::partition_point, but constexpr (so that the tables below can be checked at compile time) and
+// with no data-dependent branch in the loop, which is the cheaper way to search a dozen entries.
+template <typename Pred>
+static constexpr size_t count_prefix(const hard_fork* begin, const hard_fork* end, Pred pred) {
+  size_t n = end - begin;
+  if (n == 0)
+    return 0;
+  const hard_fork* base = begin;
+  while (n > 1) {
+    size_t half = n / 2;
+    base = pred(base[half]) ? base + half : base;
+    n -= half;
+  }
+  return (base - begin) + pred(*base);
+}
+
+// The last fork in [begin, end) that has started by `height`, or nullptr if none has.
+static constexpr const hard_fork* active_hard_fork(const hard_fork* begin, const hard_fork* end, uint64_t height) {
+  size_t i = count_prefix(begin, end, [height](const hard_fork& hf) { return hf.height <= height; });
+  return i ? begin + i - 1 : nullptr;
+}
+
+template <size_t N>
+static constexpr uint8_t version_at(const std::array<hard_fork, N>& forks, uint64_t height) {
+  return active_hard_fork(forks.data(), forks.data() + N, height)->version;
+}
+
+static_assert(version_at(mainnet_hard_forks, 0) == 7
+    && version_at(mainnet_hard_forks, 64323) == 7
+    && version_at(mainnet_hard_forks, 64324) == 8
+    && version_at(mainnet_hard_forks, 641110) == 15
+    && version_at(mainnet_hard_forks, 641111) == 16
+    && version_at(mainnet_hard_forks, 839009) == 18
+    && version_at(mainnet_hard_forks, UINT64_MAX) == 18,
+    "Hard fork lookup is broken");
+static_assert(version_at(devnet_hard_forks, 1) == 7 && version_at(devnet_hard_forks, 2) == 11
+    && version_at(devnet_hard_forks, 98) == 15 && version_at(devnet_hard_forks, 99) == 16,
+    "Hard fork lookup is broken");
+
 std::vector<hard_fork> fakechain_hardforks;
 
 std::pair<const hard_fork*, const hard_fork*> get_hard_forks(network_type type)
@@ -116,37 +157,30 @@ std::pair<const hard_fork*, const hard_fork*> get_hard_forks(network_type type)
 std::pair<std::optional<uint64_t>, std::optional<uint64_t>>
 get_hard_fork_heights(network_type nettype, uint8_t version) {
   std::pair<std::optional<uint64_t>, std::optional<uint64_t>> found;
-  for (auto [it, end] = get_hard_forks(nettype); it != end; it++) {
-    if (it->version > version) { // This (and anything else) are in the future
-      if (found.first) // Found something suitable in the previous iteration, so one before this hf is the max
-        found.second = it->height - 1;
-      break;
-    } else if (it->version == version && !found.first) {
-      found.first = it->height;
-    }
-  }
+  auto [begin, end] = get_hard_forks(nettype);
+  const size_t n = end - begin;
+  const size_t first = count_prefix(begin, end, [version](const hard_fork& hf) { return hf.version < version; });
+  if (first == n || begin[first].version != version)
+    return found;
+  found.first = begin[first].height;
+  const size_t next = count_prefix(begin, end, [version](const hard_fork& hf) { return hf.version <= version; });
+  if (next < n)
+    found.second = begin[next].height - 1;
   return found;
 }
 
 uint8_t hard_fork_ceil(network_type nettype, uint8_t version) {
-  auto [it, end] = get_hard_forks(nettype);
-  for (; it != end; it++)
-    if (it->version >= version)
-      return it->version;
-
-  return version;
+  auto [begin, end] = get_hard_forks(nettype);
+  const size_t i = count_prefix(begin, end, [version](const hard_fork& hf) { return hf.version < version; });
+  return i < size_t(end - begin) ? begin[i].version : version;
 }
 
 std::pair<uint8_t, uint8_t>
 get_network_version_revision(network_type nettype, uint64_t height) {
-  std::pair<uint8_t, uint8_t> result;
-  for (auto [it, end] = get_hard_forks(nettype); it != end; it++) {
-    if (it->height <= height)
-      result = {it->version, it->snode_revision};
-    else
-      break;
-  }
-  return result;
+  auto [begin, end] = get_hard_forks(nettype);
+  if (auto* hf = active_hard_fork(begin, end, height))
+    return {hf->version, hf->snode_revision};
+  return {};
 }
 
 bool is_hard_fork_at_least(network_type type, uint8_t version, uint64_t height) {
@@ -156,13 +190,11 @@ bool is_hard_fork_at_least(network_type type, uint8_t version, uint64_t height)
 std::pair<uint8_t, uint8_t>
 get_ideal_block_version(network_type nettype, uint64_t height)
 {
-  std::pair<uint8_t, uint8_t> result;
-  for (auto [it, end] = get_hard_forks(nettype); it != end; it++) {
-    if (it->height <= height)
-      result.first = it->version;
-    result.second = it->version;
-  }
-  return result;
+  auto [begin, end] = get_hard_forks(nettype);
+  if (begin == end)
+    return {};
+  auto* hf = active_hard_fork(begin, end, height);
+  return {hf ? hf->version : 0, end[-1].version};
 }
 
 
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <vector>
+#include "crypto/crypto.h"
+#include "crypto/hash.h"
+
+namespace cryptonote
+{
+
+  /// Bounded record of the tx and block hashes a peer is already known to have (because it sent
+  /// them to us, or we sent them to it), used to avoid relaying things back to it.
+  ///
+  /// This is a rolling bloom filter: two generations of `GENERATION_SIZE` entries, where the older
+  /// one is discarded once the current one fills up, so that anything inserted within the last
+  /// GENERATION_SIZE insertions is always found, and older entries eventually age out.  False
+  /// positives (~0.2%) mean a peer occasionally doesn't get a relay from us, which is harmless as
+  /// it will hear about it from its other peers.
+  ///
+  /// The bit positions are salted with per-filter random values so that a peer can't grind hashes
+  /// that collide with something it wants to keep us from relaying to others.
+  ///
+  /// Thread-safe: the connection's thread records inventory while relaying (on other threads)
+  /// consults it.  The bits aren't allocated until the first insertion.
+  class known_inventory
+  {
+  public:
+    static constexpr size_t GENERATION_SIZE = 2500;
+    static constexpr size_t NUM_HASHES = 10;
+    static constexpr size_t WORDS = 576; // 36864 bits per generation
+    static constexpr size_t BITS = WORDS * 64;
+
+    known_inventory() = default;
+    known_inventory(const known_inventory& other) { *this = other; }
+    known_inventory& operator=(const known_inventory& other)
+    {
+      if (this != &other)
+      {
+        std::scoped_lock lock{m_mutex, other.m_mutex};
+        m_generations = other.m_generations;
+        m_current = other.m_current;
+        m_count = other.m_count;
+        m_salt = other.m_salt;
+      }
+      return *this;
+    }
+
+    void insert(const crypto::hash& h)
+    {
+      std::lock_guard lock{m_mutex};
+      if (m_generations[0].empty())
+      {
+        for (auto& g : m_generations)
+          g.resize(WORDS, 0);
+        m_salt = {crypto::rand<uint64_t>(), crypto::rand<uint64_t>()};
+      }
+      if (m_count >= GENERATION_SIZE)
+      {
+        m_current ^= 1;
+        std::fill(m_generations[m_current].begin(), m_generations[m_current].end(), 0);
+        m_count = 0;
+      }
+      auto& bits = m_generations[m_current];
+      for_each_bit(h, [&bits](uint64_t b) { bits[b / 64] |= uint64_t{1} << (b % 64); });
+      m_count++;
+    }
+
+    bool contains(const crypto::hash& h) const
+    {
+      std::lock_guard lock{m_mutex};
+      if (m_generations[0].empty())
+        return false;
+      for (const auto& bits : m_generations)
+      {
+        bool all = true;
+        for_each_bit(h, [&bits, &all](uint64_t b) { all = all && (bits[b / 64] >> (b % 64) & 1); });
+        if (all)
+          return true;
+      }
+      return false;
+    }
+
+    void clear()
+    {
+      std::lock_guard lock{m_mutex};
+      for (auto& g : m_generations)
+        g.clear();
+      m_current = 0;
+      m_count = 0;
+    }
+
+  private:
+    static uint64_t mix(uint64_t x)
+    {
+      x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+      x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+      return x ^ (x >> 31);
+    }
+
+    // Double hashing over the two salted halves of the (already uniform) hash
+    template <typename F>
+    void for_each_bit(const crypto::hash& h, F f) const
+    {
+      uint64_t h1, h2;
+      std::memcpy(&h1, h.data, 8);
+      std::memcpy(&h2, h.data + 8, 8);
+      h1 = mix(h1 ^ m_salt[0]);
+      h2 = mix(h2 ^ m_salt[1]) | 1;
+      for (size_t i = 0; i < NUM_HASHES; i++)
+        f((h1 + i * h2) % BITS);
+    }
+
+    mutable std::mutex m_mutex;
+    std::array<std::vector<uint64_t>, 2> m_generations;
+    size_t m_current = 0;
+    size_t m_count = 0;
+    std::array<uint64_t, 2> m_salt{};
+  };
+
+}
@@ -30,7 +30,9 @@
 //
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
+#include <cstring>
 #include <numeric>
+#include <boost/endian/conversion.hpp>
 #include <oxenmq/base64.h>
 #include "epee/misc_language.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
@@ -39,6 +41,7 @@
 #include "common/util.h"
 #include "common/file.h"
 #include "common/string_util.h"
+#include "common/thread_affinity.h"
 #include "epee/string_coding.h"
 #include "epee/string_tools.h"
 #include "epee/storages/portable_storage_template_helper.h"
@@ -62,16 +65,23 @@ namespace cryptonote
     const command_line::arg_descriptor<std::string> arg_extra_messages =  {"extra-messages-file", "Specify file for extra messages to include into coinbase transactions", "", true};
     const command_line::arg_descriptor<std::string> arg_start_mining =    {"start-mining", "Specify wallet address to mining for", "", true};
     const command_line::arg_descriptor<uint32_t>      arg_mining_threads =  {"mining-threads", "Specify mining threads count", 0, true};
+
+    // Overwrites the nonce in a block hashing blob
+    void set_blob_nonce(blobdata& blob, size_t offset, uint32_t nonce)
+    {
+      boost::endian::native_to_little_inplace(nonce);
+      std::memcpy(blob.data() + offset, &nonce, sizeof(nonce));
+    }
   }
 
 
-  miner::miner(i_miner_handler* phandler, const get_block_hash_t &gbh):m_stop(1),
+  miner::miner(i_miner_handler* phandler, get_block_hasher_t get_hasher):m_stop(1),
     m_template{},
     m_template_no(0),
     m_diffic(0),
     m_thread_index(0),
     m_phandler(phandler),
-    m_gbh(gbh),
+    m_get_hasher(std::move(get_hasher)),
     m_height(0),
     m_pausers_count(0),
     m_threads_total(0),
@@ -162,7 +172,8 @@ namespace cryptonote
   {
     if(m_last_hr_merge_time && is_mining())
     {
-      m_current_hash_rate = m_hashes * 1000 / ((epee::misc_utils::get_tick_count() - m_last_hr_merge_time + 1));
+      const uint64_t elapsed = epee::misc_utils::get_tick_count() - m_last_hr_merge_time;
+      m_current_hash_rate = m_hashes * 1000 / (elapsed + 1);
       std::unique_lock lock{m_last_hash_rates_lock};
       m_last_hash_rates.push_back(m_current_hash_rate);
       if(m_last_hash_rates.size() > 19)
@@ -173,11 +184,23 @@ namespace cryptonote
         float hr = static_cast<float>(total_hr)/static_cast<float>(m_last_hash_rates.size());
         const auto flags = std::cout.flags();
         const auto precision = std::cout.precision();
-        std::cout << "hashrate: " << std::setprecision(4) << std::fixed << hr << std::setiosflags(flags) << std::setprecision(precision) << std::endl;
+        std::cout << "hashrate: " << std::setprecision(4) << std::fixed << hr;
+        std::unique_lock threads_lock{m_threads_lock};
+        if (m_thread_hashes.size() > 1)
+        {
+          std::cout << " (";
+          for (size_t i = 0; i < m_thread_hashes.size(); i++)
+            std::cout << (i ? ", " : "") << m_thread_hashes[i] * 1000 / (elapsed + 1);
+          std::cout << " per thread)";
+        }
+        std::cout << std::setiosflags(flags) << std::setprecision(precision) << std::endl;
       }
     }
     m_last_hr_merge_time = epee::misc_utils::get_tick_count();
     m_hashes = 0;
+    std::unique_lock threads_lock{m_threads_lock};
+    for (auto& h : m_thread_hashes)
+      h = 0;
   }
   //-----------------------------------------------------------------------------------------------------
   void miner::update_autodetection()
@@ -229,6 +252,7 @@ namespace cryptonote
     m_threads.clear();
     m_stop = false;
     m_thread_index = 0;
+    m_thread_hashes = std::vector<std::atomic<uint64_t>>(m_threads_total);
     for(size_t i = 0; i != m_threads_total; i++)
       m_threads.emplace_back([this] { return worker_thread(false); });
   }
@@ -342,7 +366,8 @@ namespace cryptonote
     m_stop_height = stop_after ? m_height + stop_after : std::numeric_limits<uint64_t>::max();
     if (stop_after)
       MGINFO("Mining until height " << m_stop_height);
-    
+
+    m_thread_hashes = std::vector<std::atomic<uint64_t>>(m_threads_total);
     for(size_t i = 0; i != m_threads_total; i++)
     {
       m_threads.emplace_back([=] { return worker_thread(slow_mining); });
@@ -444,12 +469,19 @@ namespace cryptonote
   {
     uint32_t th_local_index = m_thread_index++;
     MLOG_SET_THREAD_NAME(std::string("[miner ") + std::to_string(th_local_index) + "]");
+    tools::pin_thread_to_pool("miner", th_local_index);
     MGINFO("Miner thread was started ["<< th_local_index << "]");
     uint32_t nonce = m_starter_nonce + th_local_index;
     uint64_t height = 0;
     difficulty_type local_diff = 0;
     uint32_t local_template_ver = 0;
     block b;
+    // Hashing blob of b with its nonce patched in place, and the nonce the hasher's next() will
+    // return the hash of
+    blobdata blob;
+    size_t nonce_offset = 0;
+    uint32_t pending_nonce = 0;
+    std::unique_ptr<block_hasher> hasher;
     rx_slow_hash_allocate_state();
     bool call_stop = false;
 
@@ -471,6 +503,7 @@ namespace cryptonote
         }
         local_template_ver = m_template_no;
         nonce = m_starter_nonce + th_local_index;
+        hasher.reset();
       }
 
       if(!local_template_ver)//no any set_block_template call
@@ -488,13 +521,25 @@ namespace cryptonote
         break;
       }
 
-      b.nonce = nonce;
-      crypto::hash h;
-      m_gbh(b, height, slow_mining ? 0 : tools::get_max_concurrency(), h);
+      if (!hasher)
+      {
+        blob = get_block_hashing_blob(b);
+        nonce_offset = get_block_hashing_blob_nonce_offset(b);
+        hasher = m_get_hasher(b, height, slow_mining ? 0 : tools::get_max_concurrency());
+        set_blob_nonce(blob, nonce_offset, nonce);
+        hasher->start(blob);
+        pending_nonce = nonce;
+        nonce+=m_threads_total;
+      }
+
+      set_blob_nonce(blob, nonce_offset, nonce);
+      crypto::hash h = hasher->next(blob);
 
       if(check_hash(h, local_diff))
       {
         //we lucky!
+        b.nonce = pending_nonce;
+        b.invalidate_hashes();
         ++m_config.current_extra_message_index;
         MGINFO_GREEN("Found block " << get_block_hash(b) << " at height " << height << " for difficulty: " << local_diff);
         cryptonote::block_verification_context bvc;
@@ -506,9 +551,11 @@ namespace cryptonote
             tools::dump_file(m_config_dir / fs::u8path(MINER_CONFIG_FILE_NAME), json);
       }
 
+      pending_nonce = nonce;
       nonce+=m_threads_total;
       ++m_hashes;
       ++m_total_hashes;
+      ++m_thread_hashes[th_local_index];
     }
     rx_slow_hash_free_state();
     MGINFO("Miner thread stopped ["<< th_local_index << "]");
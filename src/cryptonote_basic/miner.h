@@ -31,6 +31,7 @@
 #pragma once 
 
 #include <atomic>
+#include <memory>
 #include <thread>
 #include "cryptonote_basic/blobdatatype.h"
 #include "cryptonote_basic/cryptonote_basic.h"
@@ -58,13 +59,27 @@ namespace cryptonote
 
   typedef std::function<bool(const cryptonote::block&, uint64_t, unsigned int, crypto::hash&)> get_block_hash_t;
 
+  // Proof-of-work hashing of successive nonces of one block template in one mining thread.  An
+  // implementation may pipeline the work, so start() takes the first hashing blob and each next()
+  // takes the following one and returns the hash of the blob before it.
+  struct block_hasher
+  {
+    virtual ~block_hasher() = default;
+    virtual void start(const blobdata& blob) = 0;
+    virtual crypto::hash next(const blobdata& next_blob) = 0;
+  };
+
+  // Returns a hasher for the given block template at the given height, using `threads` to size
+  // the RandomX dataset (0 for light, slow mining).
+  typedef std::function<std::unique_ptr<block_hasher>(const cryptonote::block&, uint64_t, unsigned int)> get_block_hasher_t;
+
   /************************************************************************/
   /*                                                                      */
   /************************************************************************/
   class miner
   {
   public: 
-    miner(i_miner_handler* phandler, const get_block_hash_t& gbh);
+    miner(i_miner_handler* phandler, get_block_hasher_t get_hasher);
     ~miner();
     bool init(const boost::program_options::variables_map& vm, network_type nettype);
     static void init_options(boost::program_options::options_description& desc);
@@ -117,7 +132,7 @@ namespace cryptonote
     std::list<std::thread> m_threads;
     std::mutex m_threads_lock;
     i_miner_handler* m_phandler;
-    get_block_hash_t m_gbh;
+    get_block_hasher_t m_get_hasher;
     account_public_address m_mine_address;
     tools::periodic_task m_update_block_template_interval{5s};
     tools::periodic_task m_update_merge_hr_interval{2s};
@@ -131,6 +146,7 @@ namespace cryptonote
     std::atomic<uint64_t> m_current_hash_rate;
     std::mutex m_last_hash_rates_lock;
     std::list<uint64_t> m_last_hash_rates;
+    std::vector<std::atomic<uint64_t>> m_thread_hashes; // per-thread m_hashes, guarded by m_threads_lock
     bool m_do_print_hashrate;
     bool m_do_mining;
     std::vector<std::pair<uint64_t, uint64_t>> m_threads_autodetect;
@@ -0,0 +1,110 @@
+#include "transaction_view.h"
+
+#include "cryptonote_format_utils.h"
+#include "serialization/binary_utils.h"
+
+namespace cryptonote
+{
+  transaction_view::transaction_view(std::string_view blob) : m_blob{blob}
+  {
+    serialization::binary_string_unarchiver ar{m_blob};
+    serialization::value(ar, m_prefix);
+    m_prefix_size = ar.streampos();
+  }
+
+  const rct::rctSigBase& transaction_view::rct_base()
+  {
+    if (m_rct_base)
+      return *m_rct_base;
+
+    rct::rctSigBase base{};
+    base.type = rct::RCTType::Null;
+    size_t end = m_prefix_size;
+    // v1 transactions have ring signatures rather than an rct base, and transactions without
+    // inputs don't serialize one at all.
+    if (m_prefix.version >= txversion::v2_ringct && !m_prefix.vin.empty())
+    {
+      serialization::binary_string_unarchiver ar{m_blob.substr(m_prefix_size)};
+      base.serialize_rctsig_base(ar, m_prefix.vin.size(), m_prefix.vout.size());
+      end += ar.streampos();
+
+      // As expand_transaction_1 does for a parsed (non-coinbase) transaction
+      const bool coinbase = m_prefix.vin.size() == 1 && std::holds_alternative<txin_gen>(m_prefix.vin[0]);
+      if (base.type != rct::RCTType::Null && !coinbase)
+      {
+        if (base.outPk.size() != m_prefix.vout.size())
+          throw std::runtime_error{"bad outPk size"};
+        for (size_t n = 0; n < base.outPk.size(); ++n)
+        {
+          auto* out = std::get_if<txout_to_key>(&m_prefix.vout[n].target);
+          if (!out)
+            throw std::runtime_error{"unsupported output type"};
+          base.outPk[n].dest = rct::pk2rct(out->key);
+        }
+      }
+    }
+
+    m_unprunable_size = end;
+    return m_rct_base.emplace(std::move(base));
+  }
+
+  size_t transaction_view::unprunable_size()
+  {
+    rct_base();
+    return m_unprunable_size;
+  }
+
+  crypto::hash transaction_view::prefix_hash() const
+  {
+    return get_blob_hash(m_blob.substr(0, m_prefix_size));
+  }
+
+  crypto::hash transaction_view::prunable_hash()
+  {
+    if (m_prefix.version == txversion::v1)
+      throw std::runtime_error{"v1 transactions have no prunable hash"};
+    return get_blob_hash(prunable_blob());
+  }
+
+  crypto::hash transaction_view::hash()
+  {
+    if (m_hash)
+      return *m_hash;
+
+    // v1 transactions hash the entire blob
+    if (m_prefix.version == txversion::v1)
+      return m_hash.emplace(get_blob_hash(m_blob));
+
+    // v2 transactions hash the hashes of the prefix, the rct base and the prunable data
+    crypto::hash hashes[3];
+    hashes[0] = prefix_hash();
+    const rct::rctSigBase& base = rct_base();
+    if (m_unprunable_size > m_prefix_size)
+      hashes[1] = get_blob_hash(m_blob.substr(m_prefix_size, m_unprunable_size - m_prefix_size));
+    else
+    {
+      // Nothing was serialized; the hash is of an empty (Null) base
+      serialization::binary_string_archiver ba;
+      const_cast<rct::rctSigBase&>(base).serialize_rctsig_base(ba, 0, 0);
+      hashes[1] = get_blob_hash(ba.str());
+    }
+    hashes[2] = base.type == rct::RCTType::Null ? crypto::null_hash : get_blob_hash(prunable_blob());
+
+    return m_hash.emplace(crypto::cn_fast_hash(hashes, sizeof(hashes)));
+  }
+
+  const transaction& transaction_view::tx()
+  {
+    if (!m_tx)
+    {
+      if (!parse_and_validate_tx_from_blob(m_blob, m_tx.emplace()))
+      {
+        m_tx.reset();
+        throw std::runtime_error{"failed to parse transaction"};
+      }
+      if (m_hash)
+        m_tx->set_hash(*m_hash);
+    }
+    return *m_tx;
+  }
+}
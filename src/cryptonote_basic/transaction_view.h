@@ -0,0 +1,61 @@
+#pragma once
+
+#include <optional>
+#include <string_view>
+
+#include "cryptonote_basic.h"
+
+namespace cryptonote
+{
+  /// Lazily parsed, read-only view of a transaction blob, for callers that want the prefix, the
+  /// hashes or the pruned/prunable split of a transaction without deserializing its signatures and
+  /// range proofs.
+  ///
+  /// The prefix is parsed when the view is constructed.  The rct signature base is parsed the first
+  /// time it (or anything that needs its end offset) is asked for, and the complete transaction
+  /// only if tx() is called.  The hashes are computed directly from the blob at the recorded
+  /// offsets.
+  ///
+  /// The view refers to the blob, which the caller must keep alive.  It is not thread-safe.
+  class transaction_view
+  {
+  public:
+    /// Parses the prefix of `blob`.  Throws std::runtime_error if the prefix can't be parsed.
+    explicit transaction_view(std::string_view blob);
+
+    const transaction_prefix& prefix() const { return m_prefix; }
+    std::string_view blob() const { return m_blob; }
+
+    /// The blob without its prunable data, i.e. what a pruned node stores.
+    std::string_view pruned_blob() { return m_blob.substr(0, unprunable_size()); }
+    /// The prunable data (range proofs, ring signatures) at the end of the blob.
+    std::string_view prunable_blob() { return m_blob.substr(unprunable_size()); }
+
+    /// Sizes of the prefix, and of the prefix plus the rct signature base.
+    size_t prefix_size() const { return m_prefix_size; }
+    size_t unprunable_size();
+
+    /// The rct signature base: type, fee, ecdh info and output commitments.  Parsed on first use;
+    /// throws if it can't be.  Empty (type Null) for v1 transactions and transactions without inputs.
+    const rct::rctSigBase& rct_base();
+
+    /// Hashes, the same as get_transaction_prefix_hash, get_transaction_prunable_hash and
+    /// get_transaction_hash of the parsed transaction.
+    crypto::hash prefix_hash() const;
+    crypto::hash prunable_hash();
+    crypto::hash hash();
+
+    /// The fully parsed transaction; parsed on first use.  Throws if the blob doesn't parse.
+    const transaction& tx();
+
+  private:
+    std::string_view m_blob;
+    transaction_prefix m_prefix;
+    size_t m_prefix_size;
+
+    std::optional<rct::rctSigBase> m_rct_base;
+    size_t m_unprunable_size = 0;
+    std::optional<crypto::hash> m_hash;
+    std::optional<transaction> m_tx;
+  };
+}
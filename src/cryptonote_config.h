@@ -123,6 +123,8 @@ constexpr uint64_t BLOCKS_EXPECTED_IN_YEARS(int years) { return BLOCKS_EXPECTED_
 #define CRYPTONOTE_NOISE_DELAY_RANGE                    5      // seconds
 #define CRYPTONOTE_NOISE_BYTES                          3*1024 // 3 KiB
 #define CRYPTONOTE_NOISE_CHANNELS                       2      // Max outgoing connections per zone used for noise/covert sending
+#define CRYPTONOTE_STALE_CIRCUIT_TIMEOUT                150    // seconds, an outbound i2p/tor connection we haven't heard from for this long is considered dead
+#define CRYPTONOTE_MAX_HELD_NOTIFICATIONS               100    // local tx notifications held while an i2p/tor zone has no outbound connections
 
 #define CRYPTONOTE_MAX_FRAGMENTS                        20 // ~20 * NOISE_BYTES max payload size for covert/noise send
 
@@ -142,6 +144,7 @@ constexpr uint64_t BLOCKS_EXPECTED_IN_YEARS(int years) { return BLOCKS_EXPECTED_
 #define P2P_DEFAULT_HANDSHAKE_INVOKE_TIMEOUT            5000       //5 seconds
 #define P2P_DEFAULT_WHITELIST_CONNECTIONS_PERCENT       70
 #define P2P_DEFAULT_ANCHOR_CONNECTIONS_COUNT            2
+#define P2P_DEFAULT_CONNECT_ATTEMPTS_IN_FLIGHT          4          // outgoing connections attempted at once while below the out peers count
 #define P2P_DEFAULT_SYNC_SEARCH_CONNECTIONS_COUNT       2
 #define P2P_DEFAULT_LIMIT_RATE_UP                       2048       // kB/s
 #define P2P_DEFAULT_LIMIT_RATE_DOWN                     8192       // kB/s
@@ -155,7 +158,9 @@ constexpr uint64_t BLOCKS_EXPECTED_IN_YEARS(int years) { return BLOCKS_EXPECTED_
 // able to sync non-fluffy blocks, keep here so we can still accept blocks
 // pre-hardfork
 #define P2P_SUPPORT_FLAG_FLUFFY_BLOCKS                  0x01
-#define P2P_SUPPORT_FLAGS                               P2P_SUPPORT_FLAG_FLUFFY_BLOCKS
+// The peer can take the blocks of NOTIFY_RESPONSE_GET_BLOCKS compressed (in compressed_blocks)
+#define P2P_SUPPORT_FLAG_COMPRESSED_BLOCKS              0x02
+#define P2P_SUPPORT_FLAGS                               (P2P_SUPPORT_FLAG_FLUFFY_BLOCKS | P2P_SUPPORT_FLAG_COMPRESSED_BLOCKS)
 
 #define CRYPTONOTE_NAME                         "oxen"
 #define CRYPTONOTE_POOLDATA_FILENAME            "poolstate.bin"
@@ -181,6 +186,7 @@ constexpr uint64_t BLOCKS_EXPECTED_IN_YEARS(int years) { return BLOCKS_EXPECTED_
 #define HF_VERSION_PULSE cryptonote::network_version_16_pulse
 #define HF_VERSION_CLSAG                        cryptonote::network_version_16_pulse
 #define HF_VERSION_PROOF_BTENC                  cryptonote::network_version_18
+#define HF_VERSION_VOTE_BUNDLES                 cryptonote::network_version_19
 
 #define PER_KB_FEE_QUANTIZATION_DECIMALS        8
 
@@ -242,6 +248,7 @@ namespace config
   inline constexpr auto UPTIME_PROOF_FREQUENCY = 1h; // How often to send proofs out to the network since the last proof we successfully sent.  (Approximately; this can be up to CHECK_INTERFACE/2 off in either direction).  The minimum accepted time between proofs is half of this.
   inline constexpr auto UPTIME_PROOF_VALIDITY = 2h + 5min; // The maximum time that we consider an uptime proof to be valid (i.e. after this time since the last proof we consider the SN to be down)
   inline constexpr auto REACHABLE_MAX_FAILURE_VALIDITY = 5min; // If we don't hear any SS ping/lokinet session test failures for more than this long then we start considering the SN as passing for the purpose of obligation testing until we get another test result.  This should be somewhat larger than SS/lokinet's max re-test backoff (2min).
+  inline constexpr auto FLUFFY_BLOCK_PREFILL_TX_AGE = 10s; // Block txes that reached our mempool less than this long ago are sent along with the block when we relay it, since peers likely don't have them yet and would otherwise need a missing-tx round trip before they can add (and relay) the block.
 
   // Hash domain separators
   inline constexpr std::string_view HASH_KEY_BULLETPROOF_EXPONENT = "bulletproof"sv;
@@ -31,7 +31,9 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <cstdio>
+#include <future>
 #include <boost/endian/conversion.hpp>
 
 #include "common/rules.h"
@@ -57,14 +59,18 @@
 #include "cryptonote_core.h"
 #include "ringct/rctSigs.h"
 #include "common/perf_timer.h"
+#include "common/trace.h"
 #include "common/notify.h"
 #include "service_node_voting.h"
 #include "service_node_list.h"
 #include "common/varint.h"
 #include "common/pruning.h"
 #include "common/lock.h"
+#include "common/memory_usage.h"
+#include "common/oxen.h"
 #include "common/meta.h"
 #include "common/sha256sum.h"
+#include "common/string_util.h"
 
 #ifdef ENABLE_SYSTEMD
 extern "C" {
@@ -112,10 +118,11 @@ Blockchain::block_extended_info::block_extended_info(const alt_block_data_t &src
 //------------------------------------------------------------------
 Blockchain::Blockchain(tx_memory_pool& tx_pool, service_nodes::service_node_list& service_node_list):
   m_db(), m_tx_pool(tx_pool), m_current_block_cumul_weight_limit(0), m_current_block_cumul_weight_median(0),
-  m_max_prepare_blocks_threads(4), m_db_sync_on_blocks(true), m_db_sync_threshold(1), m_db_sync_mode(db_async), m_db_default_sync(false), m_fast_sync(true), m_show_time_stats(false), m_sync_counter(0), m_bytes_to_sync(0), m_cancel(false),
+  m_max_prepare_blocks_threads(0), m_db_sync_on_blocks(true), m_db_sync_threshold(1), m_db_sync_mode(db_async), m_db_default_sync(false), m_fast_sync(true), m_show_time_stats(false), m_sync_counter(0), m_bytes_to_sync(0), m_cancel(false),
   m_long_term_block_weights_window(CRYPTONOTE_LONG_TERM_BLOCK_WEIGHT_WINDOW_SIZE),
   m_long_term_effective_median_block_weight(0),
   m_long_term_block_weights_cache_tip_hash(crypto::null_hash),
+  m_long_term_block_weights_cache_tip_height(0),
   m_long_term_block_weights_cache_rolling_median(CRYPTONOTE_LONG_TERM_BLOCK_WEIGHT_WINDOW_SIZE),
   m_service_node_list(service_node_list),
   m_btc_valid(false),
@@ -151,6 +158,20 @@ bool Blockchain::have_tx_keyimg_as_spent(const crypto::key_image &key_im) const
   return  m_db->has_key_image(key_im);
 }
 //------------------------------------------------------------------
+void Blockchain::have_tx_keyimgs_as_spent(epee::span<const crypto::key_image> key_images, std::vector<bool> &spent) const
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+  // WARNING: as above, this does not take m_blockchain_lock.
+  m_db->has_key_images(key_images, spent);
+}
+//------------------------------------------------------------------
+bool Blockchain::have_tx_keyimg_as_spent_prefetched(const crypto::key_image &key_im) const
+{
+  if (m_scan_unspent_key_images.count(key_im))
+    return false;
+  return m_db->has_key_image(key_im);
+}
+//------------------------------------------------------------------
 // This function makes sure that each "input" in an input (mixins) exists
 // and collects the public key for each from the transaction it was included in
 // via the visitor passed to it.
@@ -185,7 +206,15 @@ bool Blockchain::scan_outputkeys_for_indexes(const txin_to_key& tx_in_to_key, vi
     }
   }
 
-  if (!found)
+  if (!found && tx_in_to_key.amount == 0)
+  {
+    if (!get_ring_outputs(absolute_offsets, outputs))
+    {
+      MERROR_VER("Output does not exist! amount = " << tx_in_to_key.amount);
+      return false;
+    }
+  }
+  else if (!found)
   {
     try
     {
@@ -286,6 +315,55 @@ bool Blockchain::scan_outputkeys_for_indexes(const txin_to_key& tx_in_to_key, vi
   return true;
 }
 //------------------------------------------------------------------
+bool Blockchain::get_ring_outputs(const std::vector<uint64_t>& indices, std::vector<output_data_t>& outputs) const
+{
+  outputs.resize(indices.size());
+  std::vector<uint64_t> missing;
+  std::vector<size_t> missing_pos;
+  {
+    std::lock_guard lock{m_output_cache_mutex};
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+      if (auto* out = m_output_cache.get(indices[i]))
+        outputs[i] = *out;
+      else
+      {
+        missing.push_back(indices[i]);
+        missing_pos.push_back(i);
+      }
+    }
+  }
+  if (missing.empty())
+    return true;
+
+  std::vector<output_data_t> loaded;
+  const uint64_t amount = 0;
+  try
+  {
+    m_db->get_output_key(epee::span<const uint64_t>(&amount, 1), missing, loaded, true);
+  }
+  catch (...)
+  {
+    return false;
+  }
+  if (loaded.size() != missing.size())
+    return false;
+
+  std::lock_guard lock{m_output_cache_mutex};
+  for (size_t i = 0; i < missing.size(); i++)
+  {
+    outputs[missing_pos[i]] = loaded[i];
+    m_output_cache.put(missing[i], loaded[i]);
+  }
+  return true;
+}
+//------------------------------------------------------------------
+void Blockchain::invalidate_output_cache(uint64_t from_height)
+{
+  std::lock_guard lock{m_output_cache_mutex};
+  m_output_cache.erase_if([from_height](uint64_t, const output_data_t& out) { return out.height >= from_height; });
+}
+//------------------------------------------------------------------
 uint64_t Blockchain::get_current_blockchain_height(bool lock) const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
@@ -317,24 +395,70 @@ bool Blockchain::load_missing_blocks_into_oxen_subsystems()
   auto scan_start               = work_start;
   work_time ons_duration{}, snl_duration{}, ons_iteration_duration{}, snl_iteration_duration{};
 
-  std::vector<cryptonote::block> blocks;
-  std::vector<cryptonote::transaction> txs;
-  std::vector<crypto::hash> missed_txs;
+  // Fetching and parsing the blocks and txes is done on the threadpool, a batch ahead of the
+  // (strictly serial) subsystem updates for the current batch.
+  struct replay_batch
+  {
+    std::vector<cryptonote::block> blocks;
+    std::vector<std::vector<cryptonote::transaction>> txs;
+    std::vector<char> loaded;
+  };
+  auto batch_height = [&](int64_t index) { return start_height + index * BLOCK_COUNT; };
+  auto batch_size   = [&](int64_t index) { return std::min<uint64_t>(BLOCK_COUNT, end_height - batch_height(index)); };
+  int64_t const num_batches = (total_blocks + BLOCK_COUNT - 1) / BLOCK_COUNT;
+
+  tools::threadpool &tpool = tools::threadpool::getInstance();
+  replay_batch next;
+  tools::threadpool::waiter next_waiter;
+  auto prefetch = [&](int64_t index) {
+    uint64_t const height = batch_height(index), count = batch_size(index);
+    next.blocks.assign(count, {});
+    next.txs.assign(count, {});
+    next.loaded.assign(count, false);
+    for (uint64_t i = 0; i < count; i++)
+    {
+      tpool.submit(&next_waiter, [this, &next, i, height = height + i] {
+        try
+        {
+          db_rtxn_guard rtxn_guard{m_db};
+          next.blocks[i] = m_db->get_block_from_height(height);
+          std::vector<crypto::hash> missed_txs;
+          if (get_transactions(next.blocks[i].tx_hashes, next.txs[i], missed_txs) && missed_txs.empty())
+            next.loaded[i] = true;
+          else
+            MERROR("Unable to get transactions for block at height " << height << " for updating oxen subsystems");
+        }
+        catch (const std::exception &e)
+        {
+          MERROR("Unable to get block at height " << height << " for updating oxen subsystems: " << e.what());
+        }
+      }, true);
+    }
+  };
+
+  // Longer ONS replays use its bulk mode, which commits a batch of blocks at a time
+  bool const ons_bulk_load = m_ons_db.db && ons_height + BLOCK_COUNT < end_height && m_ons_db.begin_bulk_load();
+  OXEN_DEFER { if (ons_bulk_load) m_ons_db.end_bulk_load(); };
 
-  for (int64_t block_count = total_blocks,
-               index       = 0;
-       block_count > 0;
-       block_count -= BLOCK_COUNT, index++)
+  prefetch(0);
+  for (int64_t index = 0; index < num_batches; index++)
   {
+    next_waiter.wait(&tpool);
+    replay_batch batch = std::move(next);
+    if (index + 1 < num_batches)
+      prefetch(index + 1);
+
     if (index > 0 && (index % 10 == 0))
     {
       m_service_node_list.store();
       auto duration = work_time{clock::now() - work_start};
-      MGINFO("... scanning height " << start_height + (index * BLOCK_COUNT) << " (" << duration.count() << "s) (snl: " << snl_iteration_duration.count() << "s; ons: " << ons_iteration_duration.count() << "s)");
+      uint64_t const done = index * BLOCK_COUNT;
+      auto const eta = work_time{clock::now() - scan_start} * (static_cast<float>(total_blocks - done) / done);
+      MGINFO("... scanning height " << batch_height(index) << " (" << (done * 100 / total_blocks) << "%, " << duration.count() << "s, ETA " << static_cast<int64_t>(eta.count()) << "s) (snl: " << snl_iteration_duration.count() << "s; ons: " << ons_iteration_duration.count() << "s)");
 #ifdef ENABLE_SYSTEMD
       // Tell systemd that we're doing something so that it should let us continue starting up
       // (giving us 120s until we have to send the next notification):
-      sd_notify(0, ("EXTEND_TIMEOUT_USEC=120000000\nSTATUS=Recanning blockchain; height " + std::to_string(start_height + (index * BLOCK_COUNT))).c_str());
+      sd_notify(0, ("EXTEND_TIMEOUT_USEC=120000000\nSTATUS=Recanning blockchain; height " + std::to_string(batch_height(index))).c_str());
 #endif
       work_start = clock::now();
 
@@ -343,26 +467,18 @@ bool Blockchain::load_missing_blocks_into_oxen_subsystems()
       ons_iteration_duration = snl_iteration_duration = {};
     }
 
-    blocks.clear();
-    uint64_t height = start_height + (index * BLOCK_COUNT);
-    if (!get_blocks_only(height, static_cast<uint64_t>(BLOCK_COUNT), blocks))
-    {
-      LOG_ERROR("Unable to get checkpointed historical blocks for updating oxen subsystems");
-      return false;
-    }
-
-    for (cryptonote::block const &blk : blocks)
+    for (size_t i = 0; i < batch.blocks.size(); i++)
     {
-      uint64_t block_height = get_block_height(blk);
-
-      txs.clear();
-      missed_txs.clear();
-      if (!get_transactions(blk.tx_hashes, txs, missed_txs))
+      if (!batch.loaded[i])
       {
-        MERROR("Unable to get transactions for block for updating ONS DB: " << cryptonote::get_block_hash(blk));
+        next_waiter.wait(&tpool);
         return false;
       }
 
+      cryptonote::block const &blk                    = batch.blocks[i];
+      std::vector<cryptonote::transaction> const &txs = batch.txs[i];
+      uint64_t block_height                           = get_block_height(blk);
+
       if (block_height >= snl_height)
       {
         auto snl_start = clock::now();
@@ -375,6 +491,7 @@ bool Blockchain::load_missing_blocks_into_oxen_subsystems()
         if (!m_service_node_list.block_added(blk, txs, checkpoint_ptr))
         {
           MFATAL("Unable to process block for updating service node list: " << cryptonote::get_block_hash(blk));
+          next_waiter.wait(&tpool);
           return false;
         }
         snl_iteration_duration += clock::now() - snl_start;
@@ -386,6 +503,7 @@ bool Blockchain::load_missing_blocks_into_oxen_subsystems()
         if (!m_ons_db.add_block(blk, txs))
         {
           MFATAL("Unable to process block for updating ONS DB: " << cryptonote::get_block_hash(blk));
+          next_waiter.wait(&tpool);
           return false;
         }
         ons_iteration_duration += clock::now() - ons_start;
@@ -393,6 +511,12 @@ bool Blockchain::load_missing_blocks_into_oxen_subsystems()
     }
   }
 
+  if (ons_bulk_load && !m_ons_db.end_bulk_load())
+  {
+    MFATAL("Unable to commit the blocks loaded into the ONS DB");
+    return false;
+  }
+
   if (total_blocks > 1)
   {
     auto duration = work_time{clock::now() - scan_start};
@@ -428,6 +552,31 @@ bool Blockchain::init(BlockchainDB* db, sqlite3 *ons_db, const network_type nett
   }
 
   m_db = db;
+  load_txpool_store();
+  load_alt_block_index();
+
+  m_metrics.push_back(tools::metrics::register_gauge("oxend_blockchain_height", "Height of the main chain", [db] { return db->height(); }));
+  m_metrics.push_back(tools::metrics::register_gauge("oxend_db_size_bytes", "Size of the blockchain database file", [db] { return db->get_database_size(); }));
+  m_metrics.push_back(tools::memory::track("resident", "Resident size of the whole process", [] { return tools::memory::resident_bytes(); }));
+  m_metrics.push_back(tools::memory::track("lmdb", "Blockchain database pages (including alt blocks and the txpool blobs) resident in RAM", [db] { return db->get_resident_size(); }));
+  m_metrics.push_back(tools::memory::track("randomx", "RandomX caches, mining datasets and VMs", [] { return rx_memory_usage(); }));
+  m_metrics.push_back(tools::memory::track("blockchain_caches", "Cached main chain blocks and preverified tx rings", [this] {
+    size_t bytes = 0;
+    {
+      std::lock_guard lock{m_block_cache_mutex};
+      m_block_cache.for_each([&bytes](uint64_t, const std::shared_ptr<const cached_block>& b) {
+        bytes += sizeof(cached_block) + tools::memory::heap_bytes(b->blob) + tools::memory::heap_bytes(b->blk.tx_hashes)
+          + tools::memory::heap_bytes(b->blk.miner_tx.vout) + tools::memory::heap_bytes(b->blk.miner_tx.extra);
+      });
+    }
+    std::lock_guard lock{m_preverified_txs_mutex};
+    m_preverified_txs.for_each([&bytes](const crypto::hash&, const rct::ctkeyM& rings) {
+      bytes += tools::memory::heap_bytes(rings);
+      for (auto& ring : rings)
+        bytes += tools::memory::heap_bytes(ring);
+    });
+    return bytes;
+  }));
 
 #if defined(OXEN_ENABLE_INTEGRATION_TEST_HOOKS)
   // NOTE(doyle): Passing in test options in integration mode means we're
@@ -554,16 +703,42 @@ bool Blockchain::init(BlockchainDB* db, sqlite3 *ons_db, const network_type nett
       return false;
   }
 
-  if (ons_db && !m_ons_db.init(this, nettype, ons_db))
+  // Start setting up the RandomX cache the next block will be verified with, if it needs one; it
+  // takes a while and nothing below depends on it.
+  if (m_nettype != FAKECHAIN)
   {
-    MFATAL("ONS failed to initialise");
-    return false;
+    const uint64_t next_height = m_db->height();
+    const uint8_t next_hf = get_network_version(next_height);
+    const auto pow_cache_height = pow_cache_trusted_height();
+    if (next_hf >= network_version_12_checkpointing && next_hf < network_version_16_pulse &&
+        !(pow_cache_height && next_height <= *pow_cache_height))
+    {
+      const uint64_t seed_height = rx_seedheight(next_height);
+      const crypto::hash seed_hash = m_db->get_block_hash_from_height(seed_height);
+      tools::threadpool::getInstance().submit(nullptr, [seed_height, seed_hash] { rx_prepare_seed(seed_height, seed_hash.data); }, true);
+    }
   }
 
   hook_block_added(m_checkpoints);
   hook_blockchain_detached(m_checkpoints);
-  for (InitHook* hook : m_init_hooks)
-    hook->init();
+
+  // The init hooks (chiefly the service node list deserialising its saved state) and ONS only read
+  // the chain, so load them concurrently.  The hooks get the other thread because ONS init takes the
+  // blockchain lock, which this one already holds.
+  const auto subsystems_start = std::chrono::steady_clock::now();
+  auto hooks = std::async(std::launch::async, [this] {
+    for (InitHook* hook : m_init_hooks)
+      hook->init();
+  });
+
+  if (ons_db && !m_ons_db.init(this, nettype, ons_db))
+  {
+    MFATAL("ONS failed to initialise");
+    hooks.wait();
+    return false;
+  }
+  hooks.get();
+  MINFO("Service node state and ONS loaded in " << tools::friendly_duration(std::chrono::steady_clock::now() - subsystems_start));
 
   if (!m_db->is_read_only() && !load_missing_blocks_into_oxen_subsystems())
   {
@@ -577,6 +752,8 @@ bool Blockchain::init(BlockchainDB* db, sqlite3 *ons_db, const network_type nett
 bool Blockchain::store_blockchain()
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
+  flush_txpool();
+
   // lock because the rpc_thread command handler also calls this
   std::unique_lock lock{*m_db};
 
@@ -618,10 +795,12 @@ bool Blockchain::deinit()
   // as this should be called if handling a SIGSEGV, need to check
   // if m_db is a NULL pointer (and thus may have caused the illegal
   // memory operation), otherwise we may cause a loop.
+  m_metrics.clear();
   try
   {
     if (m_db)
     {
+      flush_txpool();
       m_db->close();
       MTRACE("Local blockchain read/write activity stopped successfully");
     }
@@ -695,16 +874,42 @@ block Blockchain::pop_block_from_blockchain()
   LOG_PRINT_L3("Blockchain::" << __func__);
   std::unique_lock lock{*this};
 
-  m_cache.m_timestamps_and_difficulties_height = 0;
+  // Drop the popped block from the difficulty window, if it's in it; the rest of the window stays
+  // valid and get_difficulty_for_next_block only has to load the block that slides back in.
+  if (uint64_t new_height = m_db->height() - 1; m_cache.m_timestamps_and_difficulties_height > new_height)
+  {
+    uint64_t const drop = m_cache.m_timestamps_and_difficulties_height - new_height;
+    if (drop <= m_cache.m_timestamps.size() && m_cache.m_timestamps.size() == m_cache.m_difficulties.size())
+    {
+      m_cache.m_timestamps.resize(m_cache.m_timestamps.size() - drop);
+      m_cache.m_difficulties.resize(m_cache.m_difficulties.size() - drop);
+      m_cache.m_timestamps_and_difficulties_height = new_height;
+    }
+    else
+      m_cache.m_timestamps_and_difficulties_height = 0;
+  }
 
   block popped_block;
   std::vector<transaction> popped_txs;
 
   CHECK_AND_ASSERT_THROW_MES(m_db->height() > 1, "Cannot pop the genesis block");
 
+  m_chunk_state.tracked = false;
+
+  // Roll the popped block out of the long term weight median window while we can still check that
+  // the window ends at it
+  if (m_long_term_block_weights_cache_tip_height > 0 && m_long_term_block_weights_cache_tip_hash == m_db->top_block_hash())
+    rollback_long_term_block_weights_cache(m_long_term_block_weights_cache_tip_height - 1);
+
   try
   {
     m_db->pop_block(popped_block, popped_txs);
+    invalidate_block_cache(m_db->height());
+    invalidate_output_cache(m_db->height());
+    {
+      std::lock_guard lock{m_output_blacklist_mutex};
+      m_output_blacklist_reload = true;
+    }
   }
   // anything that could cause this to throw is likely catastrophic,
   // so we re-throw
@@ -753,6 +958,8 @@ block Blockchain::pop_block_from_blockchain()
 
   m_blocks_longhash_table.clear();
   m_scan_table.clear();
+  m_scan_unspent_key_images.clear();
+  m_scan_verified_rct_txs.clear();
   m_blocks_txs_check.clear();
 
   CHECK_AND_ASSERT_THROW_MES(update_next_cumulative_weight_limit(), "Error updating next cumulative weight limit");
@@ -767,8 +974,20 @@ bool Blockchain::reset_and_set_genesis_block(const block& b)
   std::unique_lock lock{*this};
   m_cache.m_timestamps_and_difficulties_height = 0;
   invalidate_block_template_cache();
+  invalidate_block_cache(0);
+  invalidate_output_cache(0);
+  {
+    std::lock_guard lock{m_output_blacklist_mutex};
+    m_output_blacklist_reload = true;
+  }
   m_db->reset();
-  m_db->drop_alt_blocks();
+  drop_alt_blocks();
+  {
+    std::lock_guard store_lock{m_txpool_store_mutex};
+    m_txpool_store.clear();
+    m_txpool_dirty.clear();
+    m_txpool_undo.clear();
+  }
 
   for (InitHook* hook : m_init_hooks)
     hook->init();
@@ -810,18 +1029,33 @@ void Blockchain::get_short_chain_history(std::list<crypto::hash>& ids) const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
   std::unique_lock lock{*this};
+  db_rtxn_guard rtxn_guard(m_db);
+  const auto &history = cached_short_chain_history();
+  ids.insert(ids.end(), history.begin(), history.end());
+}
+//------------------------------------------------------------------
+const std::vector<crypto::hash>& Blockchain::cached_short_chain_history() const
+{
   uint64_t sz = m_db->height();
-  if(!sz)
-    return;
+  if (!sz)
+  {
+    m_short_chain_history.clear();
+    return m_short_chain_history;
+  }
 
-  db_rtxn_guard rtxn_guard(m_db);
+  const crypto::hash top = m_db->top_block_hash();
+  if (!m_short_chain_history.empty() && m_short_chain_history.front() == top)
+    return m_short_chain_history;
+
+  m_short_chain_history.clear();
   for (uint64_t i = 0, decr = 1, offset = 1; offset < sz; ++i)
   {
-    ids.push_back(m_db->get_block_hash_from_height(sz - offset));
+    m_short_chain_history.push_back(m_db->get_block_hash_from_height(sz - offset));
     if (i >= 10) decr *= 2;
     offset += decr;
   }
-  ids.push_back(m_db->get_block_hash_from_height(0));
+  m_short_chain_history.push_back(m_db->get_block_hash_from_height(0));
+  return m_short_chain_history;
 }
 //------------------------------------------------------------------
 crypto::hash Blockchain::get_block_id_by_height(uint64_t height) const
@@ -861,7 +1095,7 @@ crypto::hash Blockchain::get_pending_block_id_by_height(uint64_t height) const
 bool Blockchain::get_block_by_hash(const crypto::hash &h, block &blk, bool *orphan) const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
-  std::unique_lock lock{*this};
+  db_rtxn_guard rtxn_guard(m_db);
 
   // try to find block in main chain
   try
@@ -904,15 +1138,61 @@ bool Blockchain::get_block_by_hash(const crypto::hash &h, block &blk, bool *orph
 //------------------------------------------------------------------
 bool Blockchain::get_block_by_height(uint64_t height, block &blk) const
 {
-  try
+  if (auto cached = get_cached_block(height))
   {
-    blk = m_db->get_block_from_height(height);
+    blk = cached->blk;
     return true;
   }
-  catch (const BLOCK_DNE& e) { }
   return false;
 }
 //------------------------------------------------------------------
+std::shared_ptr<const Blockchain::cached_block> Blockchain::get_cached_block(uint64_t height) const
+{
+  uint64_t generation;
+  {
+    std::lock_guard lock{m_block_cache_mutex};
+    if (auto* cached = m_block_cache.get(height))
+      return *cached;
+    generation = m_block_cache_generation;
+  }
+
+  auto result = std::make_shared<cached_block>();
+  try
+  {
+    result->blob = m_db->get_block_blob_from_height(height);
+  }
+  catch (const BLOCK_DNE& e)
+  {
+    return nullptr;
+  }
+  if (!parse_and_validate_block_from_blob(result->blob, result->blk, result->hash))
+  {
+    LOG_ERROR("Invalid block at height " << height);
+    return nullptr;
+  }
+
+  if (height + BLOCK_CACHE_SIZE >= m_db->height())
+  {
+    std::lock_guard lock{m_block_cache_mutex};
+    if (generation == m_block_cache_generation)
+      m_block_cache.put(height, result);
+  }
+  return result;
+}
+//------------------------------------------------------------------
+void Blockchain::invalidate_block_cache(uint64_t from_height)
+{
+  std::lock_guard lock{m_block_cache_mutex};
+  m_block_cache.erase_if([from_height](uint64_t height, const auto&) { return height >= from_height; });
+  ++m_block_cache_generation;
+}
+//------------------------------------------------------------------
+Blockchain::block_cache_stats Blockchain::get_block_cache_stats() const
+{
+  std::lock_guard lock{m_block_cache_mutex};
+  return {m_block_cache.hits(), m_block_cache.misses(), m_block_cache.size()};
+}
+//------------------------------------------------------------------
 // This function aggregates the cumulative difficulties and timestamps of the
 // last DIFFICULTY_WINDOW blocks and passes them to next_difficulty,
 // returning the result of that call.  Ignores the genesis block, and can use
@@ -988,8 +1268,6 @@ bool Blockchain::rollback_blockchain_switching(const std::list<block_and_checkpo
     return true;
   }
 
-  m_cache.m_timestamps_and_difficulties_height = 0;
-
   // remove blocks from blockchain until we get back to where we should be.
   while (m_db->height() != rollback_height)
   {
@@ -1035,8 +1313,6 @@ bool Blockchain::switch_to_alternative_blockchain(const std::list<block_extended
   LOG_PRINT_L3("Blockchain::" << __func__);
   std::unique_lock lock{*this};
 
-  m_cache.m_timestamps_and_difficulties_height = 0;
-
   // if empty alt chain passed (not sure how that could happen), return false
   CHECK_AND_ASSERT_MES(alt_chain.size(), false, "switch_to_alternative_blockchain: empty chain passed");
 
@@ -1085,14 +1361,14 @@ bool Blockchain::switch_to_alternative_blockchain(const std::list<block_extended
       const crypto::hash blkid = cryptonote::get_block_hash(bei.bl);
       add_block_as_invalid(bei.bl);
       MERROR("The block was inserted as invalid while connecting new alternative chain, block_id: " << blkid);
-      m_db->remove_alt_block(blkid);
+      remove_alt_block(blkid);
       alt_ch_iter++;
 
       for(auto alt_ch_to_orph_iter = alt_ch_iter; alt_ch_to_orph_iter != alt_chain.end(); )
       {
         const auto &bei = *alt_ch_to_orph_iter++;
         add_block_as_invalid(bei.bl);
-        m_db->remove_alt_block(blkid);
+        remove_alt_block(cryptonote::get_block_hash(bei.bl));
       }
       return false;
     }
@@ -1116,7 +1392,9 @@ bool Blockchain::switch_to_alternative_blockchain(const std::list<block_extended
   //removing alt_chain entries from alternative chains container
   for (const auto &bei: alt_chain)
   {
-    m_db->remove_alt_block(cryptonote::get_block_hash(bei.bl));
+    const crypto::hash blkid = cryptonote::get_block_hash(bei.bl);
+    remove_alt_block(blkid);
+    m_alt_block_pow.erase(blkid);
   }
 
   get_block_longhash_reorg(split_height);
@@ -1177,11 +1455,25 @@ difficulty_type Blockchain::get_difficulty_for_alternative_chain(const std::list
     if(!main_chain_start_offset)
       ++main_chain_start_offset; //skip genesis block
 
-    // get difficulties and timestamps from relevant main chain blocks
-    for(; main_chain_start_offset < main_chain_stop_offset; ++main_chain_start_offset)
+    // get difficulties and timestamps from relevant main chain blocks, taking them from the main
+    // chain's difficulty window when the alt chain forks off within it
+    const uint64_t cached_end   = m_cache.m_timestamps_and_difficulties_height;
+    const uint64_t cached_start = cached_end - std::min<uint64_t>(cached_end, m_cache.m_timestamps.size());
+    if (cached_end && m_cache.m_timestamps.size() == m_cache.m_difficulties.size() &&
+        main_chain_start_offset >= cached_start && main_chain_stop_offset <= cached_end && cached_end <= m_db->height())
+    {
+      timestamps.assign(m_cache.m_timestamps.begin() + (main_chain_start_offset - cached_start),
+                        m_cache.m_timestamps.begin() + (main_chain_stop_offset - cached_start));
+      cumulative_difficulties.assign(m_cache.m_difficulties.begin() + (main_chain_start_offset - cached_start),
+                                     m_cache.m_difficulties.begin() + (main_chain_stop_offset - cached_start));
+    }
+    else
     {
-      timestamps.push_back(m_db->get_block_timestamp(main_chain_start_offset));
-      cumulative_difficulties.push_back(m_db->get_block_cumulative_difficulty(main_chain_start_offset));
+      for(; main_chain_start_offset < main_chain_stop_offset; ++main_chain_start_offset)
+      {
+        timestamps.push_back(m_db->get_block_timestamp(main_chain_start_offset));
+        cumulative_difficulties.push_back(m_db->get_block_cumulative_difficulty(main_chain_start_offset));
+      }
     }
 
     // make sure we haven't accidentally grabbed too many blocks...maybe don't need this check?
@@ -1413,20 +1705,53 @@ uint64_t Blockchain::get_long_term_block_weight_median(uint64_t start_height, si
     {
       MTRACE("requesting " << count << " from " << start_height << ", incremental");
       m_long_term_block_weights_cache_tip_hash = tip_hash;
+      m_long_term_block_weights_cache_tip_height = tip_height;
       m_long_term_block_weights_cache_rolling_median.insert(m_db->get_block_long_term_weight(tip_height));
       return m_long_term_block_weights_cache_rolling_median.median();
     }
   }
 
+  // after popping blocks the window moves down: roll the newest blocks back out of it, as long as
+  // that's cheaper than reloading the window
+  const uint64_t cache_tip_height = m_long_term_block_weights_cache_tip_height;
+  if (count == (size_t)m_long_term_block_weights_cache_rolling_median.size() &&
+      tip_height < cache_tip_height && cache_tip_height - tip_height < count / 2 && cache_tip_height < blockchain_height &&
+      m_long_term_block_weights_cache_tip_hash == m_db->get_block_hash_from_height(cache_tip_height))
+  {
+    MTRACE("requesting " << count << " from " << start_height << ", rolled back " << (cache_tip_height - tip_height));
+    if (rollback_long_term_block_weights_cache(tip_height))
+      return m_long_term_block_weights_cache_rolling_median.median();
+  }
+
   MTRACE("requesting " << count << " from " << start_height << ", uncached");
   std::vector<uint64_t> weights = m_db->get_long_term_block_weights(start_height, count);
   m_long_term_block_weights_cache_tip_hash = tip_hash;
+  m_long_term_block_weights_cache_tip_height = tip_height;
   m_long_term_block_weights_cache_rolling_median.clear();
   for (uint64_t w: weights)
     m_long_term_block_weights_cache_rolling_median.insert(w);
   return m_long_term_block_weights_cache_rolling_median.median();
 }
 //------------------------------------------------------------------
+bool Blockchain::rollback_long_term_block_weights_cache(uint64_t tip_height) const
+{
+  auto &median = m_long_term_block_weights_cache_rolling_median;
+  const uint64_t window = median.size();
+  while (m_long_term_block_weights_cache_tip_height > tip_height)
+  {
+    // The block to put back is the one just before the oldest one in the window
+    const uint64_t tip = m_long_term_block_weights_cache_tip_height;
+    if (tip < window || !median.rollback(m_db->get_block_long_term_weight(tip - window)))
+    {
+      m_long_term_block_weights_cache_tip_hash = crypto::null_hash;
+      return false;
+    }
+    m_long_term_block_weights_cache_tip_height--;
+  }
+  m_long_term_block_weights_cache_tip_hash = m_db->get_block_hash_from_height(tip_height);
+  return true;
+}
+//------------------------------------------------------------------
 uint64_t Blockchain::get_current_cumulative_block_weight_limit() const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
@@ -1458,9 +1783,18 @@ bool Blockchain::create_block_template_internal(block& b, const crypto::hash *fr
     // The pool cookie is atomic. The lack of locking is OK, as if it changes
     // just as we compare it, we'll just use a slightly old template, but
     // this would be the case anyway if we'd lock, and the change happened
-    // just after the block template was created
-    if (info.miner_address != m_btc_address && m_btc_nonce == ex_nonce
-      && m_btc_pool_cookie == m_tx_pool.cookie() && m_btc.prev_id == get_tail_id()) {
+    // just after the block template was created.
+    //
+    // If the pool has changed we still reuse a recent template as long as every tx in it is still
+    // in the pool (i.e. txs were only added): it remains valid, and is just missing the newest
+    // txs until it is rebuilt after BLOCK_TEMPLATE_MAX_STALENESS.
+    const bool same_request = info.is_miner == m_btc_is_miner
+      && (info.is_miner ? info.miner_address == m_btc_address : info.service_node_payout.key == m_btc_producer)
+      && m_btc_nonce == ex_nonce && m_btc.prev_id == get_tail_id();
+    bool pool_ok = same_request && m_btc_pool_cookie == m_tx_pool.cookie();
+    if (same_request && !pool_ok && std::chrono::steady_clock::now() - m_btc_time < BLOCK_TEMPLATE_MAX_STALENESS)
+      pool_ok = std::all_of(m_btc.tx_hashes.begin(), m_btc.tx_hashes.end(), [this](const crypto::hash &txid) { return m_tx_pool.have_tx(txid); });
+    if (pool_ok) {
       MDEBUG("Using cached template");
       const uint64_t now = time(NULL);
       if (m_btc.timestamp < now /*ensures it can't get below the median of the last few blocks*/ || !info.is_miner)
@@ -1471,7 +1805,7 @@ bool Blockchain::create_block_template_internal(block& b, const crypto::hash *fr
       expected_reward = m_btc_expected_reward;
       return true;
     }
-    MDEBUG("Not using cached template: address " << (bool)(info.miner_address != m_btc_address) << ", nonce " << (m_btc_nonce == ex_nonce) << ", cookie " << (m_btc_pool_cookie == m_tx_pool.cookie()) << ", from_block " << (!!from_block));
+    MDEBUG("Not using cached template: address " << (info.miner_address == m_btc_address) << ", nonce " << (m_btc_nonce == ex_nonce) << ", cookie " << (m_btc_pool_cookie == m_tx_pool.cookie()) << ", miner " << info.is_miner);
     invalidate_block_template_cache();
   }
 
@@ -1615,7 +1949,7 @@ bool Blockchain::create_block_template_internal(block& b, const crypto::hash *fr
     CHECK_AND_ASSERT_MES(cumulative_weight == txs_weight + get_transaction_weight(b.miner_tx), false, "unexpected case: cumulative_weight=" << cumulative_weight << " is not equal txs_cumulative_weight=" << txs_weight << " + get_transaction_weight(b.miner_tx)=" << get_transaction_weight(b.miner_tx));
 
     if (!from_block)
-      cache_block_template(b, info.miner_address, ex_nonce, diffic, height, expected_reward, pool_cookie);
+      cache_block_template(b, info, ex_nonce, diffic, height, expected_reward, pool_cookie);
     return true;
   }
   LOG_ERROR("Failed to create_block_template with " << 10 << " tries");
@@ -1678,6 +2012,21 @@ bool Blockchain::build_alt_chain(const crypto::hash &prev_id,
                                  int *num_alt_checkpoints,
                                  int *num_checkpoints)
 {
+    // Find the fork point in the alt block index first: a chain forking off too long ago is
+    // rejected without loading its blocks
+    if (auto hashes = get_alt_chain_hashes(prev_id); !hashes.empty())
+    {
+      const uint64_t fork_height = m_alt_blocks.at(hashes.back()).height;
+      if (!m_checkpoints.is_alternative_block_allowed(m_db->height(), fork_height, nullptr /*service_node_checkpoint*/))
+      {
+        LOG_PRINT_L2("alternative chain forking at height " << fork_height << " is too old to consider: " << prev_id);
+        bvc.m_verifivation_failed = true;
+        for (const auto &h : hashes)
+          remove_alt_block(h);
+        return false;
+      }
+    }
+
     //build alternative subchain, front -> mainchain, back -> alternative head
     cryptonote::alt_block_data_t data;
     cryptonote::blobdata blob;
@@ -1780,7 +2129,7 @@ bool Blockchain::build_alt_chain(const crypto::hash &prev_id,
         // Cleanup alt chain, it's invalid
         bvc.m_verifivation_failed = true;
         for (auto const &bei : alt_chain)
-          m_db->remove_alt_block(cryptonote::get_block_hash(bei.bl));
+          remove_alt_block(cryptonote::get_block_hash(bei.bl));
 
         return false;
       }
@@ -1835,9 +2184,6 @@ bool Blockchain::handle_alternative_block(const block& b, const crypto::hash& id
     return false;
   }
 
-  // NOTE: Reset timestamp/difficulty cache
-  m_cache.m_timestamps_and_difficulties_height = 0;
-
   // NOTE: Build the alternative chain for checking reorg-ability
   std::list<block_extended_info> alt_chain;
   std::vector<uint64_t> timestamps;
@@ -1869,7 +2215,7 @@ bool Blockchain::handle_alternative_block(const block& b, const crypto::hash& id
   }
   else
   {
-    block_pow_verified const blk_pow = verify_block_pow(b, current_diff, chain_height, true /*alt_block*/);
+    blk_pow = verify_block_pow(b, current_diff, chain_height, true /*alt_block*/);
     if (!blk_pow.valid)
     {
       bvc.m_verifivation_failed = true;
@@ -1931,7 +2277,9 @@ bool Blockchain::handle_alternative_block(const block& b, const crypto::hash& id
     uint64_t block_reward = get_outs_money_amount(b.miner_tx);
     const uint64_t prev_generated_coins = alt_chain.size() ? prev_data.already_generated_coins : m_db->get_block_already_generated_coins(blk_height - 1);
     alt_data.already_generated_coins = (block_reward < (MONEY_SUPPLY - prev_generated_coins)) ? prev_generated_coins + block_reward : MONEY_SUPPLY;
-    m_db->add_alt_block(id, alt_data, cryptonote::block_to_blob(b), checkpoint_blob.empty() ? nullptr : &checkpoint_blob);
+    add_alt_block(id, alt_data, b, checkpoint_blob.empty() ? nullptr : &checkpoint_blob);
+    if (m_pow_cache_enabled && !pulse_block)
+      m_db->add_block_pow_hash(id, blk_pow.proof_of_work);
 
     // Check current height for pre-existing checkpoint
     bool height_is_checkpointed = false;
@@ -2139,7 +2487,13 @@ bool Blockchain::get_blocks_only(uint64_t start_offset, size_t count, std::vecto
   {
     try
     {
-      blocks.emplace_back(m_db->get_block_from_height(start_offset + i));
+      auto cached = get_cached_block(start_offset + i);
+      if (!cached)
+      {
+        LOG_ERROR("Invalid block at height " << start_offset + i);
+        return false;
+      }
+      blocks.push_back(cached->blk);
     }
     catch(std::exception const &e)
     {
@@ -2195,12 +2549,13 @@ bool Blockchain::get_blocks(uint64_t start_offset, size_t count, std::vector<std
   blocks.reserve(blocks.size() + num_blocks);
   for(size_t i = 0; i < num_blocks; i++)
   {
-    blocks.emplace_back(m_db->get_block_blob_from_height(start_offset + i), block{});
-    if (!parse_and_validate_block_from_blob(blocks.back().first, blocks.back().second))
+    auto cached = get_cached_block(start_offset + i);
+    if (!cached)
     {
       LOG_ERROR("Invalid block");
       return false;
     }
+    blocks.emplace_back(cached->blob, cached->blk);
   }
   return true;
 }
@@ -2353,14 +2708,122 @@ size_t Blockchain::get_alternative_blocks_count() const
   return m_db->get_alt_block_count();
 }
 //------------------------------------------------------------------
+void Blockchain::load_alt_block_index()
+{
+  m_alt_blocks.clear();
+  m_alt_blocks_by_height.clear();
+  m_db->for_all_alt_blocks([this](const crypto::hash &blkid, const cryptonote::alt_block_data_t &data, const cryptonote::blobdata *block_blob, const cryptonote::blobdata *checkpoint_blob) {
+    cryptonote::block bl;
+    if (!block_blob || !cryptonote::parse_and_validate_block_from_blob(*block_blob, bl))
+    {
+      MERROR("Failed to parse alt block " << blkid << " from blob");
+      return true;
+    }
+    m_alt_blocks.emplace(blkid, alt_block_index_entry{data.height, bl.prev_id});
+    m_alt_blocks_by_height.emplace(data.height, blkid);
+    return true;
+  }, true);
+}
+//------------------------------------------------------------------
+void Blockchain::add_alt_block(const crypto::hash &id, const alt_block_data_t &data, const block &b, const cryptonote::blobdata *checkpoint_blob)
+{
+  m_db->add_alt_block(id, data, cryptonote::block_to_blob(b), checkpoint_blob);
+  if (m_alt_blocks.emplace(id, alt_block_index_entry{data.height, b.prev_id}).second)
+    m_alt_blocks_by_height.emplace(data.height, id);
+}
+//------------------------------------------------------------------
+void Blockchain::remove_alt_block(const crypto::hash &id)
+{
+  m_db->remove_alt_block(id);
+  auto it = m_alt_blocks.find(id);
+  if (it == m_alt_blocks.end())
+    return;
+  auto [begin, end] = m_alt_blocks_by_height.equal_range(it->second.height);
+  for (auto h = begin; h != end; ++h)
+  {
+    if (h->second == id)
+    {
+      m_alt_blocks_by_height.erase(h);
+      break;
+    }
+  }
+  m_alt_blocks.erase(it);
+}
+//------------------------------------------------------------------
+std::vector<crypto::hash> Blockchain::get_alt_chain_hashes(const crypto::hash &id) const
+{
+  std::vector<crypto::hash> hashes;
+  for (auto it = m_alt_blocks.find(id); it != m_alt_blocks.end(); it = m_alt_blocks.find(it->second.prev_id))
+    hashes.push_back(it->first);
+  return hashes;
+}
+//------------------------------------------------------------------
+void Blockchain::drop_alt_blocks()
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+  std::unique_lock lock{*this};
+  m_db->drop_alt_blocks();
+  m_alt_blocks.clear();
+  m_alt_blocks_by_height.clear();
+}
+//------------------------------------------------------------------
+void Blockchain::prune_alt_blocks()
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+  size_t pruned = 0;
+  for (;;)
+  {
+    std::unique_lock lock{*this};
+    if (m_cancel || !m_db || m_db->is_read_only())
+      break;
+    const uint64_t height = m_db->height();
+    if (height <= ALT_BLOCK_RETENTION)
+      break;
+    const auto prune_end = m_alt_blocks_by_height.lower_bound(height - ALT_BLOCK_RETENTION);
+
+    std::vector<crypto::hash> batch;
+    for (auto it = m_alt_blocks_by_height.begin(); it != prune_end && batch.size() < ALT_BLOCK_PRUNE_BATCH; ++it)
+      batch.push_back(it->second);
+    if (batch.empty())
+      break;
+
+    try
+    {
+      db_wtxn_guard wtxn_guard{m_db};
+      for (const auto &id : batch)
+      {
+        remove_alt_block(id);
+        m_alt_block_pow.erase(id);
+      }
+    }
+    catch (const std::exception &e)
+    {
+      MERROR("Failed to prune alt blocks: " << e.what());
+      break;
+    }
+    pruned += batch.size();
+  }
+  if (pruned)
+    MDEBUG("Pruned " << pruned << " alt blocks more than " << ALT_BLOCK_RETENTION << " blocks below the top of the chain");
+}
+//------------------------------------------------------------------
 // This function adds the output specified by <amount, i> to the result_outs container
 // unlocked and other such checks should be done by here.
 uint64_t Blockchain::get_num_mature_outputs(uint64_t amount) const
 {
+  uint64_t top_height;
+  const crypto::hash top = m_db->top_block_hash(&top_height);
+  if (amount == 0)
+  {
+    std::lock_guard lock{m_mature_rct_outputs_mutex};
+    if (m_mature_rct_outputs_top == top)
+      return m_mature_rct_outputs;
+  }
+
   uint64_t num_outs = m_db->get_num_outputs(amount);
   // ensure we don't include outputs that aren't yet eligible to be used
   // outpouts are sorted by height
-  const uint64_t blockchain_height = m_db->height();
+  const uint64_t blockchain_height = top_height + 1;
   while (num_outs > 0)
   {
     const tx_out_index toi = m_db->get_output_tx_and_index(amount, num_outs - 1);
@@ -2370,6 +2833,12 @@ uint64_t Blockchain::get_num_mature_outputs(uint64_t amount) const
     --num_outs;
   }
 
+  if (amount == 0)
+  {
+    std::lock_guard lock{m_mature_rct_outputs_mutex};
+    m_mature_rct_outputs_top = top;
+    m_mature_rct_outputs = num_outs;
+  }
   return num_outs;
 }
 
@@ -2383,7 +2852,7 @@ crypto::public_key Blockchain::get_output_key(uint64_t amount, uint64_t global_i
 bool Blockchain::get_outs(const rpc::GET_OUTPUTS_BIN::request& req, rpc::GET_OUTPUTS_BIN::response& res) const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
-  std::unique_lock lock{*this};
+  db_rtxn_guard rtxn_guard(m_db);
 
   res.outs.clear();
   res.outs.reserve(req.outputs.size());
@@ -2445,6 +2914,7 @@ bool Blockchain::get_output_distribution(uint64_t amount, uint64_t from_height,
     start_height = from_height;
 
   distribution.clear();
+  db_rtxn_guard rtxn_guard(m_db);
   uint64_t db_height = m_db->height();
   if (db_height == 0)
     return false;
@@ -2453,12 +2923,10 @@ bool Blockchain::get_output_distribution(uint64_t amount, uint64_t from_height,
 
   if (amount == 0)
   {
-    std::vector<uint64_t> heights;
-    heights.reserve(to_height + 1 - start_height);
+    // The per-block cumulative rct output counts are maintained in the block info as blocks are
+    // added and removed, so this is a single sequential read of the requested range.
     const uint64_t real_start_height = start_height > 0 ? start_height-1 : start_height;
-    for (uint64_t h = real_start_height; h <= to_height; ++h)
-      heights.push_back(h);
-    distribution = m_db->get_block_cumulative_rct_outputs(heights);
+    distribution = m_db->get_block_cumulative_rct_outputs_range(real_start_height, to_height);
     if (start_height > 0)
     {
       base = distribution[0];
@@ -2472,9 +2940,19 @@ bool Blockchain::get_output_distribution(uint64_t amount, uint64_t from_height,
   }
 }
 //------------------------------------------------------------------
-void Blockchain::get_output_blacklist(std::vector<uint64_t> &blacklist) const
+uint64_t Blockchain::get_output_blacklist(std::vector<uint64_t> &blacklist, std::optional<uint64_t> after) const
 {
-  m_db->get_output_blacklist(blacklist);
+  std::lock_guard lock{m_output_blacklist_mutex};
+  if (m_output_blacklist_reload)
+  {
+    m_output_blacklist.clear();
+    m_output_blacklist_reload = false;
+  }
+  m_db->get_output_blacklist(m_output_blacklist, m_output_blacklist.empty() ? 0 : m_output_blacklist.back() + 1);
+
+  auto begin = after ? std::upper_bound(m_output_blacklist.begin(), m_output_blacklist.end(), *after) : m_output_blacklist.begin();
+  blacklist.assign(begin, m_output_blacklist.end());
+  return m_output_blacklist.size();
 }
 //------------------------------------------------------------------
 // This function takes a list of block hashes from another node
@@ -2496,13 +2974,27 @@ bool Blockchain::find_blockchain_supplement(const std::list<crypto::hash>& qbloc
   db_rtxn_guard rtxn_guard(m_db);
   // make sure that the last block in the request's block list matches
   // the genesis block
-  auto gen_hash = m_db->get_block_hash_from_height(0);
+  const auto &history = cached_short_chain_history();
+  CHECK_AND_ASSERT_MES(!history.empty(), false, "Blockchain has no genesis block");
+  const crypto::hash &gen_hash = history.back();
   if(qblock_ids.back() != gen_hash)
   {
     MCERROR("net.p2p", "Client sent wrong NOTIFY_REQUEST_CHAIN: genesis block mismatch: " << std::endl << "id: " << qblock_ids.back() << ", " << std::endl << "expected: " << gen_hash << "," << std::endl << " dropping connection");
     return false;
   }
 
+  // Fast path for (nearly) synced peers and wallets, whose most recent block is one of our last
+  // few blocks: the start of our short history is consecutive heights back from the top.
+  const size_t recent = std::min<size_t>(history.size() - 1, SHORT_CHAIN_HISTORY_CONSECUTIVE);
+  for (size_t i = 0; i < recent; i++)
+  {
+    if (history[i] == qblock_ids.front())
+    {
+      starter_offset = m_db->height() - 1 - i;
+      return true;
+    }
+  }
+
   // Find the first block the foreign chain has that we also have.
   // Assume qblock_ids is in reverse-chronological order.
   auto bl_it = qblock_ids.begin();
@@ -2567,11 +3059,12 @@ bool Blockchain::get_blocks(const std::vector<crypto::hash>& block_ids, std::vec
       uint64_t height = 0;
       if (m_db->block_exists(block_hash, &height))
       {
-        blocks.push_back(std::make_pair(m_db->get_block_blob_from_height(height), block()));
-        if (!parse_and_validate_block_from_blob(blocks.back().first, blocks.back().second))
+        auto cached = get_cached_block(height);
+        if (cached && cached->hash == block_hash)
+          blocks.emplace_back(cached->blob, cached->blk);
+        else
         {
           LOG_ERROR("Invalid block: " << block_hash);
-          blocks.pop_back();
           missed_bs.push_back(block_hash);
         }
       }
@@ -2591,7 +3084,7 @@ bool Blockchain::get_blocks(const std::vector<crypto::hash>& block_ids, std::vec
 bool Blockchain::get_transactions_blobs(const std::vector<crypto::hash>& txs_ids, std::vector<cryptonote::blobdata>& txs, std::vector<crypto::hash>& missed_txs, bool pruned) const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
-  std::unique_lock lock{*this};
+  db_rtxn_guard rtxn_guard(m_db);
 
   txs.reserve(txs_ids.size());
   for (const auto& tx_hash : txs_ids)
@@ -2617,7 +3110,7 @@ bool Blockchain::get_transactions_blobs(const std::vector<crypto::hash>& txs_ids
 std::vector<uint64_t> Blockchain::get_transactions_heights(const std::vector<crypto::hash>& txs_ids) const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
-  std::unique_lock lock{*this};
+  db_rtxn_guard rtxn_guard(m_db);
 
   auto heights = m_db->get_tx_block_heights(txs_ids);
   for (auto &h : heights)
@@ -2641,7 +3134,7 @@ size_t get_transaction_version(const cryptonote::blobdata &bd)
 bool Blockchain::get_split_transactions_blobs(const std::vector<crypto::hash>& txs_ids, std::vector<std::tuple<crypto::hash, cryptonote::blobdata, crypto::hash, cryptonote::blobdata>>& txs, std::vector<crypto::hash>& missed_txs) const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
-  std::unique_lock lock{*this};
+  db_rtxn_guard rtxn_guard(m_db);
 
   txs.reserve(txs_ids.size());
   for (const auto& tx_hash : txs_ids)
@@ -2674,7 +3167,7 @@ bool Blockchain::get_split_transactions_blobs(const std::vector<crypto::hash>& t
 bool Blockchain::get_transactions(const std::vector<crypto::hash>& txs_ids, std::vector<transaction>& txs, std::vector<crypto::hash>& missed_txs) const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
-  std::unique_lock lock{*this};
+  db_rtxn_guard rtxn_guard(m_db);
 
   txs.reserve(txs_ids.size());
   cryptonote::blobdata tx;
@@ -2782,30 +3275,38 @@ bool Blockchain::find_blockchain_supplement(const uint64_t req_start_block, cons
   for(uint64_t i = start_height; i < total_height && count < max_count && (size < FIND_BLOCKCHAIN_SUPPLEMENT_MAX_SIZE || count < 3); i++, count++)
   {
     blocks.resize(blocks.size()+1);
-    blocks.back().first.first = m_db->get_block_blob_from_height(i);
+    // Parse straight out of the db (valid while rtxn_guard is held) so the blob is only copied once
+    std::string_view block_blob = m_db->get_block_blob_view_from_height(i);
     block b;
-    CHECK_AND_ASSERT_MES(parse_and_validate_block_from_blob(blocks.back().first.first, b), false, "internal error, invalid block");
+    CHECK_AND_ASSERT_MES(parse_and_validate_block_from_blob(block_blob, b), false, "internal error, invalid block");
+    blocks.back().first.first = block_blob;
     blocks.back().first.second = get_miner_tx_hash ? cryptonote::get_transaction_hash(b.miner_tx) : crypto::null_hash;
-    std::vector<cryptonote::blobdata> txs;
+    size += block_blob.size();
+    blocks.back().second.reserve(b.tx_hashes.size());
     if (pruned)
     {
-      CHECK_AND_ASSERT_MES(m_db->get_pruned_tx_blobs_from(b.tx_hashes.front(), b.tx_hashes.size(), txs), false, "Failed to retrieve all transactions needed");
+      std::vector<std::string_view> txs;
+      if (!b.tx_hashes.empty())
+        CHECK_AND_ASSERT_MES(m_db->get_pruned_tx_blob_views_from(b.tx_hashes.front(), b.tx_hashes.size(), txs), false, "Failed to retrieve all transactions needed");
+      CHECK_AND_ASSERT_MES(txs.size() == b.tx_hashes.size(), false, "mismatched sizes of b.tx_hashes and txs");
+      for (size_t i = 0; i < txs.size(); ++i)
+      {
+        size += txs[i].size();
+        blocks.back().second.emplace_back(b.tx_hashes[i], txs[i]);
+      }
     }
     else
     {
+      std::vector<cryptonote::blobdata> txs;
       std::vector<crypto::hash> mis;
       get_transactions_blobs(b.tx_hashes, txs, mis, pruned);
       CHECK_AND_ASSERT_MES(!mis.size(), false, "internal error, transaction from block not found");
-    }
-    size += blocks.back().first.first.size();
-    for (const auto &t: txs)
-      size += t.size();
-
-    CHECK_AND_ASSERT_MES(txs.size() == b.tx_hashes.size(), false, "mismatched sizes of b.tx_hashes and txs");
-    blocks.back().second.reserve(txs.size());
-    for (size_t i = 0; i < txs.size(); ++i)
-    {
-      blocks.back().second.push_back(std::make_pair(b.tx_hashes[i], std::move(txs[i])));
+      CHECK_AND_ASSERT_MES(txs.size() == b.tx_hashes.size(), false, "mismatched sizes of b.tx_hashes and txs");
+      for (size_t i = 0; i < txs.size(); ++i)
+      {
+        size += txs[i].size();
+        blocks.back().second.emplace_back(b.tx_hashes[i], std::move(txs[i]));
+      }
     }
   }
   return true;
@@ -2892,7 +3393,7 @@ bool Blockchain::check_for_double_spend(const transaction& tx, key_images_contai
       // check the blockchain-wide spent keys container and make sure the
       // key wasn't used in another block already.
       auto r = keys_this_block.insert(in.k_image);
-      return r.second && !m_db->has_key_image(in.k_image);
+      return r.second && !have_tx_keyimg_as_spent_prefetched(in.k_image);
     }
     else if constexpr (std::is_same_v<T, txin_gen>)
       return true;
@@ -2915,7 +3416,7 @@ bool Blockchain::check_for_double_spend(const transaction& tx, key_images_contai
 bool Blockchain::get_tx_outputs_gindexs(const crypto::hash& tx_id, size_t n_txes, std::vector<std::vector<uint64_t>>& indexs) const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
-  std::unique_lock lock{*this};
+  db_rtxn_guard rtxn_guard(m_db);
   uint64_t tx_index;
   if (!m_db->tx_exists(tx_id, tx_index))
   {
@@ -2931,7 +3432,7 @@ bool Blockchain::get_tx_outputs_gindexs(const crypto::hash& tx_id, size_t n_txes
 bool Blockchain::get_tx_outputs_gindexs(const crypto::hash& tx_id, std::vector<uint64_t>& indexs) const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
-  std::unique_lock lock{*this};
+  db_rtxn_guard rtxn_guard(m_db);
   uint64_t tx_index;
   if (!m_db->tx_exists(tx_id, tx_index))
   {
@@ -3132,7 +3633,10 @@ bool Blockchain::expand_transaction_2(transaction &tx, const crypto::hash &tx_pr
     CHECK_AND_ASSERT_MES(!pubkeys.empty() && !pubkeys[0].empty(), false, "empty pubkeys");
     rv.mixRing.resize(pubkeys[0].size());
     for (size_t m = 0; m < pubkeys[0].size(); ++m)
+    {
       rv.mixRing[m].clear();
+      rv.mixRing[m].reserve(pubkeys.size());
+    }
     for (size_t n = 0; n < pubkeys.size(); ++n)
     {
       CHECK_AND_ASSERT_MES(pubkeys[n].size() <= pubkeys[0].size(), false, "More inputs that first ring");
@@ -3147,13 +3651,7 @@ bool Blockchain::expand_transaction_2(transaction &tx, const crypto::hash &tx_pr
     CHECK_AND_ASSERT_MES(!pubkeys.empty() && !pubkeys[0].empty(), false, "empty pubkeys");
     rv.mixRing.resize(pubkeys.size());
     for (size_t n = 0; n < pubkeys.size(); ++n)
-    {
-      rv.mixRing[n].clear();
-      for (size_t m = 0; m < pubkeys[n].size(); ++m)
-      {
-        rv.mixRing[n].push_back(pubkeys[n][m]);
-      }
-    }
+      rv.mixRing[n].assign(pubkeys[n].begin(), pubkeys[n].end());
   }
   else
   {
@@ -3276,7 +3774,7 @@ bool Blockchain::check_tx_inputs(transaction& tx, tx_verification_context &tvc,
           last_key_image = &in_to_key.k_image;
         }
 
-        if(have_tx_keyimg_as_spent(in_to_key.k_image))
+        if(have_tx_keyimg_as_spent_prefetched(in_to_key.k_image))
         {
           MERROR_VER("Key image already spent in blockchain: " << tools::type_to_hex(in_to_key.k_image));
           if (key_image_conflicts)
@@ -3410,7 +3908,24 @@ bool Blockchain::check_tx_inputs(transaction& tx, tx_verification_context &tvc,
         }
       }
 
-      if (!rct::verRctNonSemanticsSimple(rv))
+      // Skip the expensive part if prepare_handle_incoming_blocks or preverify_tx_signatures
+      // already verified these exact signatures against these same rings.
+      const crypto::hash txid = get_transaction_hash(tx);
+      bool preverified = m_scan_verified_rct_txs.count(txid);
+      if (!preverified)
+      {
+        std::lock_guard lock{m_preverified_txs_mutex};
+        if (auto *rings = m_preverified_txs.get(txid))
+        {
+          preverified = std::equal(rings->begin(), rings->end(), rv.mixRing.begin(), rv.mixRing.end(),
+              [](const rct::ctkeyV &a, const rct::ctkeyV &b) {
+                return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                    [](const rct::ctkey &x, const rct::ctkey &y) { return x.dest == y.dest && x.mask == y.mask; });
+              });
+          m_preverified_txs.erase(txid);
+        }
+      }
+      if (!preverified && !rct::verRctNonSemanticsSimple(rv))
       {
         MERROR_VER("Failed to check ringct signatures!");
         return false;
@@ -3694,23 +4209,41 @@ byte_and_output_fees Blockchain::get_dynamic_base_fee(uint64_t block_reward, siz
 }
 
 //------------------------------------------------------------------
-bool Blockchain::check_fee(size_t tx_weight, size_t tx_outs, uint64_t fee, uint64_t burned, const tx_pool_options &opts) const
+std::optional<Blockchain::next_block_fee_rules> Blockchain::get_next_block_fee_rules() const
 {
-  const uint8_t version = get_network_version();
   const uint64_t blockchain_height = get_current_blockchain_height();
+  std::lock_guard lock{m_fee_rules_mutex};
+  if (m_fee_rules && m_fee_rules->height == blockchain_height)
+    return m_fee_rules;
 
+  const uint8_t version = get_network_version(blockchain_height);
   uint64_t median = m_current_block_cumul_weight_limit / 2;
   uint64_t already_generated_coins = blockchain_height ? m_db->get_block_already_generated_coins(blockchain_height - 1) : 0;
   uint64_t base_reward, base_reward_unpenalized;
   if (!get_base_block_reward(median, 1, already_generated_coins, base_reward, base_reward_unpenalized, version, blockchain_height))
+    return std::nullopt;
+
+  const bool use_long_term_median_in_fee = version >= HF_VERSION_LONG_TERM_BLOCK_WEIGHT;
+  auto fees = get_dynamic_base_fee(base_reward, use_long_term_median_in_fee ? std::min<uint64_t>(median, m_long_term_effective_median_block_weight) : median, version);
+  if (version >= HF_VERSION_PER_BYTE_FEE)
+    MDEBUG("Using " << print_money(fees.first) << "/byte + " << print_money(fees.second) << "/out fee");
+  else
+    MDEBUG("Using " << print_money(fees.first) << "/kB fee");
+
+  m_fee_rules = next_block_fee_rules{blockchain_height, version, fees};
+  return m_fee_rules;
+}
+//------------------------------------------------------------------
+bool Blockchain::check_fee(size_t tx_weight, size_t tx_outs, uint64_t fee, uint64_t burned, const tx_pool_options &opts) const
+{
+  auto rules = get_next_block_fee_rules();
+  if (!rules)
     return false;
+  auto& fees = rules->fees;
 
   uint64_t needed_fee;
-  if (version >= HF_VERSION_PER_BYTE_FEE)
+  if (rules->hf_version >= HF_VERSION_PER_BYTE_FEE)
   {
-    const bool use_long_term_median_in_fee = version >= HF_VERSION_LONG_TERM_BLOCK_WEIGHT;
-    auto fees = get_dynamic_base_fee(base_reward, use_long_term_median_in_fee ? std::min<uint64_t>(median, m_long_term_effective_median_block_weight) : median, version);
-    MDEBUG("Using " << print_money(fees.first) << "/byte + " << print_money(fees.second) << "/out fee");
     needed_fee = tx_weight * fees.first + tx_outs * fees.second;
     // quantize fee up to 8 decimals
     const uint64_t mask = get_fee_quantization_mask();
@@ -3718,10 +4251,7 @@ bool Blockchain::check_fee(size_t tx_weight, size_t tx_outs, uint64_t fee, uint6
   }
   else
   {
-    auto fees = get_dynamic_base_fee(base_reward, median, version);
     assert(fees.second == 0);
-    MDEBUG("Using " << print_money(fees.first) << "/kB fee");
-
     needed_fee = tx_weight / 1024;
     needed_fee += (tx_weight % 1024) ? 1 : 0;
     needed_fee *= fees.first;
@@ -3836,6 +4366,7 @@ bool Blockchain::check_tx_input(const txin_to_key& txin, const crypto::hash& tx_
   };
 
   output_keys.clear();
+  output_keys.reserve(txin.key_offsets.size());
 
   // collect output keys
   outputs_visitor vi(output_keys, *this);
@@ -3987,7 +4518,20 @@ Blockchain::block_pow_verified Blockchain::verify_block_pow(cryptonote::block co
       randomx_context.seed_block_hash           = get_block_id_by_height(randomx_context.seed_height);
     }
 
-    result.proof_of_work = get_altblock_longhash(m_nettype, randomx_context, blk, blk_height);
+    if (auto *cached = m_alt_block_pow.get(blk_hash); cached && cached->seed_hash == randomx_context.seed_block_hash)
+    {
+      result.precomputed   = true;
+      result.proof_of_work = cached->pow;
+    }
+    else if (auto max = pow_cache_trusted_height(); max && blk_height <= *max && m_db->get_block_pow_hash(blk_hash, result.proof_of_work))
+    {
+      result.precomputed = true;
+    }
+    else
+    {
+      result.proof_of_work = get_altblock_longhash(m_nettype, randomx_context, blk, blk_height);
+      m_alt_block_pow.put(blk_hash, {randomx_context.seed_block_hash, result.proof_of_work});
+    }
   }
   else
   {
@@ -4030,6 +4574,17 @@ Blockchain::block_pow_verified Blockchain::verify_block_pow(cryptonote::block co
         result.precomputed   = true;
         result.proof_of_work = it->second;
       }
+      else if (auto *cached = m_alt_block_pow.get(blk_hash); cached &&
+          cached->seed_hash == (blk.major_version >= cryptonote::network_version_12_checkpointing
+            ? get_pending_block_id_by_height(rx_seedheight(blk_height)) : crypto::null_hash))
+      {
+        // Hashed while it was an alt block (we're switching to its chain); still valid as long as
+        // the RandomX seed block it was hashed against is the one on the chain it now extends.
+        result.precomputed   = true;
+        result.proof_of_work = cached->pow;
+      }
+      else if (auto max = pow_cache_trusted_height(); max && blk_height <= *max && m_db->get_block_pow_hash(blk_hash, result.proof_of_work))
+        result.precomputed = true;
       else
         result.proof_of_work = get_block_longhash_w_blockchain(m_nettype, this, blk, chain_height, 0);
     }
@@ -4156,6 +4711,12 @@ bool Blockchain::basic_block_checks(cryptonote::block const &blk, bool alt_block
 bool Blockchain::handle_block_to_main_chain(const block& bl, const crypto::hash& id, block_verification_context& bvc, checkpoint_t const *checkpoint, bool notify)
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
+  TRACE_SPAN(blockchain, handle_block_to_main_chain);
+  static auto& pow_time = tools::metrics::get_histogram("oxend_block_pow_seconds", "Time spent verifying the proof of work of blocks added to the main chain", 1e-6);
+  static auto& tx_inputs_time = tools::metrics::get_histogram("oxend_block_tx_inputs_seconds", "Time spent checking the inputs (and ring signatures) of each tx of blocks added to the main chain", 1e-6);
+  static auto& db_add_time = tools::metrics::get_histogram("oxend_block_db_add_seconds", "Time spent writing blocks added to the main chain to the db", 1e-6);
+  static auto& sn_list_time = tools::metrics::get_histogram("oxend_block_sn_list_seconds", "Time spent updating the service node list for blocks added to the main chain", 1e-6);
+  static auto& ons_time = tools::metrics::get_histogram("oxend_block_ons_seconds", "Time spent updating the ONS db for blocks added to the main chain", 1e-6);
 
   TIME_MEASURE_START(block_processing_time);
   std::unique_lock lock{*this};
@@ -4192,7 +4753,10 @@ bool Blockchain::handle_block_to_main_chain(const block& bl, const crypto::hash&
     miner.difficulty_calc_time = epee::misc_utils::get_tick_count() - miner.difficulty_calc_time;
 
     miner.verify_pow_time = epee::misc_utils::get_tick_count();
-    miner.blk_pow         = verify_block_pow(bl, current_diffic, chain_height, false /*alt_block*/);
+    {
+      tools::metrics::scoped_timer timer{pow_time};
+      miner.blk_pow = verify_block_pow(bl, current_diffic, chain_height, false /*alt_block*/);
+    }
     miner.verify_pow_time = epee::misc_utils::get_tick_count() - miner.verify_pow_time;
 
     if (!miner.blk_pow.valid)
@@ -4220,6 +4784,7 @@ bool Blockchain::handle_block_to_main_chain(const block& bl, const crypto::hash&
 // XXX old code adds miner tx here
 
   size_t tx_index = 0;
+  const bool state_committed = chain_height < m_blocks_state_commitments.size() * HASH_OF_HASHES_STEP;
   // Iterate over the block's transaction hashes, grabbing each
   // from the tx_pool and validating them.  Each is then added
   // to txs.  Keys spent in each are added to <keys> by the double spend check.
@@ -4234,7 +4799,8 @@ bool Blockchain::handle_block_to_main_chain(const block& bl, const crypto::hash&
     TIME_MEASURE_START(aa);
 
 // XXX old code does not check whether tx exists
-    if (m_db->tx_exists(tx_id))
+    // Under a state commitment a duplicate is left to the db, which refuses to add it
+    if (!state_committed && m_db->tx_exists(tx_id))
     {
       MGINFO_RED("Block with id: " << id << " attempting to add transaction already in blockchain with id: " << tx_id);
       bvc.m_verifivation_failed = true;
@@ -4287,6 +4853,7 @@ bool Blockchain::handle_block_to_main_chain(const block& bl, const crypto::hash&
     {
       // validate that transaction inputs and the keys spending them are correct.
       tx_verification_context tvc{};
+      tools::metrics::scoped_timer timer{tx_inputs_time};
       if(!check_tx_inputs(tx, tvc))
       {
         MGINFO_RED("Block with id: " << id  << " has at least one transaction (id: " << tx_id << ") with wrong inputs.");
@@ -4361,7 +4928,15 @@ bool Blockchain::handle_block_to_main_chain(const block& bl, const crypto::hash&
     {
       uint64_t long_term_block_weight = get_next_long_term_block_weight(block_weight);
       cryptonote::blobdata bd = cryptonote::block_to_blob(bl);
+      tools::metrics::scoped_timer timer{db_add_time};
       new_height = m_db->add_block(std::make_pair(std::move(bl), std::move(bd)), block_weight, long_term_block_weight, cumulative_difficulty, already_generated_coins, txs);
+      if (!m_scan_unspent_key_images.empty())
+        for (const auto& tx : txs)
+          for (const auto& in : tx.first.vin)
+            if (auto* in_to_key = std::get_if<txin_to_key>(&in))
+              m_scan_unspent_key_images.erase(in_to_key->k_image);
+      if (m_pow_cache_enabled && !pulse_block && !miner.blk_pow.per_block_checkpointed)
+        m_db->add_block_pow_hash(id, miner.blk_pow.proof_of_work);
     }
     catch (const KEY_IMAGE_EXISTS& e)
     {
@@ -4405,19 +4980,23 @@ bool Blockchain::handle_block_to_main_chain(const block& bl, const crypto::hash&
   for (std::pair<transaction, blobdata> const &tx_pair : txs)
     only_txs.push_back(tx_pair.first);
 
+  tools::metrics::scoped_timer sn_list_timer{sn_list_time};
   if (!m_service_node_list.block_added(bl, only_txs, checkpoint))
   {
     MGINFO_RED("Failed to add block to Service Node List.");
     bvc.m_verifivation_failed = true;
     return false;
   }
+  sn_list_timer.stop();
 
+  tools::metrics::scoped_timer ons_timer{ons_time};
   if (!m_ons_db.add_block(bl, only_txs))
   {
     MGINFO_RED("Failed to add block to ONS DB.");
     bvc.m_verifivation_failed = true;
     return false;
   }
+  ons_timer.stop();
 
   for (BlockAddedHook* hook : m_block_added_hooks)
   {
@@ -4429,6 +5008,16 @@ bool Blockchain::handle_block_to_main_chain(const block& bl, const crypto::hash&
     }
   }
 
+  if (!update_chunk_state(bl, txs, new_height - 1))
+  {
+    // Part of the chunk went in without the checks its commitment stood in for; take all of it
+    // back out so that it is synced again and fully verified.
+    abort_block.cancel();
+    drop_compiled_in_blocks_from((new_height - 1) / HASH_OF_HASHES_STEP);
+    bvc.m_verifivation_failed = true;
+    return false;
+  }
+
   TIME_MEASURE_FINISH(addblock);
 
   // do this after updating the hard fork state since the weight limit may change due to fork
@@ -4439,6 +5028,10 @@ bool Blockchain::handle_block_to_main_chain(const block& bl, const crypto::hash&
   }
 
   abort_block.cancel();
+  static auto& blocks_added = tools::metrics::get_counter("oxend_blocks_added_total", "Blocks added to the main chain");
+  static auto& block_verify_time = tools::metrics::get_histogram("oxend_block_verify_seconds", "Time taken to verify the blocks added to the main chain", 1e-3);
+  blocks_added.inc();
+  block_verify_time.observe(block_processing_time);
   uint64_t const fee_after_penalty = get_outs_money_amount(bl.miner_tx) - base_reward;
   if (bl.signatures.size() == service_nodes::PULSE_BLOCK_REQUIRED_SIGNATURES)
   {
@@ -4491,8 +5084,19 @@ bool Blockchain::handle_block_to_main_chain(const block& bl, const crypto::hash&
 //------------------------------------------------------------------
 bool Blockchain::prune_blockchain(uint32_t pruning_seed)
 {
-  auto lock = tools::unique_locks(m_tx_pool, *this);
-  return m_db->prune_blockchain(pruning_seed);
+  constexpr size_t STEP_RECORDS = 4096;
+  constexpr auto STEP_PAUSE = 50ms;
+  while (!m_cancel)
+  {
+    {
+      auto lock = tools::unique_locks(m_tx_pool, *this);
+      if (m_db->prune_blockchain_step(pruning_seed, STEP_RECORDS))
+        return true;
+    }
+    std::this_thread::sleep_for(STEP_PAUSE);
+  }
+  MINFO("Blockchain pruning interrupted, it will resume from where it stopped");
+  return false;
 }
 //------------------------------------------------------------------
 bool Blockchain::update_blockchain_pruning()
@@ -4572,6 +5176,7 @@ bool Blockchain::update_next_cumulative_weight_limit(uint64_t *long_term_effecti
     else
     {
       m_long_term_block_weights_cache_tip_hash = m_db->get_block_hash_from_height(db_height - 1);
+      m_long_term_block_weights_cache_tip_height = db_height - 1;
       m_long_term_block_weights_cache_rolling_median.insert(long_term_block_weight);
       long_term_median = m_long_term_block_weights_cache_rolling_median.median();
     }
@@ -4590,6 +5195,10 @@ bool Blockchain::update_next_cumulative_weight_limit(uint64_t *long_term_effecti
     m_current_block_cumul_weight_median = full_reward_zone;
 
   m_current_block_cumul_weight_limit = m_current_block_cumul_weight_median * 2;
+  {
+    std::lock_guard lock{m_fee_rules_mutex};
+    m_fee_rules.reset();
+  }
 
   if (long_term_effective_median_block_weight)
     *long_term_effective_median_block_weight = m_long_term_effective_median_block_weight;
@@ -4604,6 +5213,7 @@ bool Blockchain::add_new_block(const block& bl, block_verification_context& bvc,
 {
 
   LOG_PRINT_L3("Blockchain::" << __func__);
+  TRACE_SPAN(blockchain, add_new_block);
   crypto::hash id = get_block_hash(bl);
   auto lock = tools::unique_locks(m_tx_pool, *this);
   db_rtxn_guard rtxn_guard(m_db);
@@ -4735,28 +5345,122 @@ bool Blockchain::get_checkpoint(uint64_t height, checkpoint_t &checkpoint) const
   return m_checkpoints.get_checkpoint(height, checkpoint);
 }
 //------------------------------------------------------------------
-void Blockchain::block_longhash_worker(uint64_t height, const epee::span<const block> &blocks, std::unordered_map<crypto::hash, crypto::hash> &map) const
+void Blockchain::block_longhash_worker(uint64_t height, const epee::span<const block> &blocks, std::unordered_map<crypto::hash, crypto::hash> &map, std::optional<uint64_t> pow_cache_height) const
 {
   TIME_MEASURE_START(t);
 
+  struct cn_block { crypto::hash id; blobdata blob; crypto::cn_slow_hash_type type; };
+  std::vector<cn_block> cn_blocks;
   for (const auto & block : blocks)
   {
     if (m_cancel)
       break;
     crypto::hash id = get_block_hash(block);
-    crypto::hash pow = get_block_longhash_w_blockchain(m_nettype, this, block, height++, 0);
+    crypto::hash pow;
+    if (!(pow_cache_height && height <= *pow_cache_height && m_db->get_block_pow_hash(id, pow)))
+    {
+      if (auto type = get_block_cn_slow_hash_type(m_nettype, block.major_version))
+      {
+        cn_blocks.push_back({id, get_block_hashing_blob(block), *type});
+        ++height;
+        continue;
+      }
+      pow = get_block_longhash_w_blockchain(m_nettype, this, block, height, 0);
+    }
+    ++height;
     map.emplace(id, pow);
   }
 
+  // The pre-RandomX blocks go two at a time where they share a variant (see cn_slow_hash_x2)
+  for (size_t i = 0; i < cn_blocks.size() && !m_cancel; )
+  {
+    const cn_block &b0 = cn_blocks[i];
+    crypto::hash pow0, pow1;
+    if (i + 1 < cn_blocks.size() && cn_blocks[i + 1].type == b0.type)
+    {
+      const cn_block &b1 = cn_blocks[i + 1];
+      crypto::cn_slow_hash_x2(b0.blob.data(), b0.blob.size(), pow0, b1.blob.data(), b1.blob.size(), pow1, b0.type);
+      map.emplace(b1.id, pow1);
+      i += 2;
+    }
+    else
+    {
+      crypto::cn_slow_hash(b0.blob.data(), b0.blob.size(), pow0, b0.type);
+      i += 1;
+    }
+    map.emplace(b0.id, pow0);
+  }
+
   TIME_MEASURE_FINISH(t);
 }
 
+//------------------------------------------------------------------
+void Blockchain::precompute_alt_block_pow(const std::vector<block_complete_entry> &blocks_entry)
+{
+  std::vector<block> blocks(blocks_entry.size());
+  std::vector<crypto::hash> hashes(blocks_entry.size());
+  for (size_t i = 0; i < blocks_entry.size(); i++)
+    if (!parse_and_validate_block_from_blob(blocks_entry[i].block, blocks[i], hashes[i]))
+      return;
+  if (blocks.empty())
+    return;
+
+  // We can only hash the span if it builds on a block we know, on the main chain or an alt chain
+  uint64_t height;
+  if (alt_block_data_t prev_data; m_db->block_exists(blocks[0].prev_id, &height))
+    height++;
+  else if (m_db->get_alt_block(blocks[0].prev_id, &prev_data, nullptr, nullptr))
+    height = prev_data.height + 1;
+  else
+    return;
+
+  const uint64_t chain_height = m_db->height();
+  std::vector<randomx_longhash_context> contexts(blocks.size());
+  std::vector<uint64_t> heights(blocks.size());
+  std::vector<size_t> todo;
+  for (size_t i = 0; i < blocks.size(); i++, height++)
+  {
+    if (i > 0 && blocks[i].prev_id != hashes[i - 1])
+      break;
+    heights[i] = height;
+    if (cryptonote::block_has_pulse_components(blocks[i]) || m_alt_block_pow.contains(hashes[i]) || have_block(hashes[i]))
+      continue;
+
+    auto &ctx = contexts[i];
+    if (blocks[i].major_version >= cryptonote::network_version_12_checkpointing)
+    {
+      ctx.current_blockchain_height = chain_height;
+      ctx.seed_height               = rx_seedheight(height);
+      if (ctx.seed_height >= chain_height)
+        break; // Hashed against a seed that is itself on the alt chain; leave it to handle_alternative_block
+      ctx.seed_block_hash = m_db->get_block_hash_from_height(ctx.seed_height);
+    }
+    todo.push_back(i);
+  }
+  if (todo.empty())
+    return;
+
+  std::vector<crypto::hash> pow(blocks.size());
+  tools::threadpool& tpool = tools::threadpool::getInstance();
+  tools::threadpool::waiter waiter;
+  for (size_t i : todo)
+    tpool.submit(&waiter, [this, &blk=blocks[i], &ctx=contexts[i], height=heights[i], &result=pow[i]]
+        { if (!m_cancel) result = get_altblock_longhash(m_nettype, ctx, blk, height); }, true);
+  waiter.wait(&tpool);
+  if (m_cancel)
+    return;
+
+  for (size_t i : todo)
+    m_alt_block_pow.put(hashes[i], {contexts[i].seed_block_hash, pow[i]});
+  MDEBUG("Prepare blocks: precomputed PoW for " << todo.size() << " alternative blocks");
+}
 //------------------------------------------------------------------
 bool Blockchain::cleanup_handle_incoming_blocks(bool force_sync)
 {
   bool success = false;
 
   MTRACE("Blockchain::" << __func__);
+  TRACE_SPAN(blockchain, cleanup_handle_incoming_blocks);
   TIME_MEASURE_START(t1);
 
   try
@@ -4787,7 +5491,7 @@ bool Blockchain::cleanup_handle_incoming_blocks(bool force_sync)
       {
         m_sync_counter = 0;
         m_bytes_to_sync = 0;
-        m_async_service.dispatch([this] { return store_blockchain(); });
+        request_async_sync();
       }
       else if(m_db_sync_mode == db_sync)
       {
@@ -4803,6 +5507,8 @@ bool Blockchain::cleanup_handle_incoming_blocks(bool force_sync)
   TIME_MEASURE_FINISH(t1);
   m_blocks_longhash_table.clear();
   m_scan_table.clear();
+  m_scan_unspent_key_images.clear();
+  m_scan_verified_rct_txs.clear();
   m_blocks_txs_check.clear();
 
   // when we're well clear of the precomputed hashes, free the memory
@@ -4811,15 +5517,48 @@ bool Blockchain::cleanup_handle_incoming_blocks(bool force_sync)
     MINFO("Dumping block hashes, we're now 4k past " << m_blocks_hash_check.size());
     m_blocks_hash_check.clear();
     m_blocks_hash_check.shrink_to_fit();
+    m_blocks_state_commitments.clear();
+    m_blocks_state_commitments.shrink_to_fit();
   }
 
   unlock();
   m_tx_pool.unlock();
 
+  // With the locks released (the sync flushes the pool), hold off on the next batch while too many
+  // syncs are outstanding, so that a disk slower than block processing bounds how much is at risk
+  if (m_db_sync_mode == db_async && m_db_max_pending_syncs)
+  {
+    std::unique_lock lock{m_async_sync_mutex};
+    m_async_sync_cv.wait(lock, [this] { return m_pending_syncs <= m_db_max_pending_syncs; });
+  }
+
   update_blockchain_pruning();
 
   return success;
 }
+//------------------------------------------------------------------
+void Blockchain::request_async_sync()
+{
+  std::lock_guard lock{m_async_sync_mutex};
+  ++m_pending_syncs;
+  if (m_async_sync_queued)
+    return;
+  m_async_sync_queued = true;
+  m_async_service.post([this] {
+    uint64_t covered;
+    {
+      std::lock_guard lock{m_async_sync_mutex};
+      m_async_sync_queued = false;
+      covered = m_pending_syncs;
+    }
+    store_blockchain();
+    {
+      std::lock_guard lock{m_async_sync_mutex};
+      m_pending_syncs -= covered;
+    }
+    m_async_sync_cv.notify_all();
+  });
+}
 
 //------------------------------------------------------------------
 void Blockchain::output_scan_worker(const uint64_t amount, const std::vector<uint64_t> &offsets, std::vector<output_data_t> &outputs) const
@@ -4934,6 +5673,27 @@ uint64_t Blockchain::prevalidate_block_hashes(uint64_t height, const std::vector
   return usable;
 }
 
+std::optional<uint64_t> Blockchain::find_checkpoint_conflict(uint64_t height, const std::vector<crypto::hash> &hashes) const
+{
+  if (hashes.empty())
+    return std::nullopt;
+
+  const uint64_t end = height + hashes.size() - 1;
+  try
+  {
+    db_rtxn_guard rtxn_guard{m_db};
+    // The range gets clamped to the checkpointed heights, so can return ones outside it
+    for (const auto& checkpoint : m_db->get_checkpoints_range(height, end))
+      if (checkpoint.height >= height && checkpoint.height <= end && !checkpoint.check(hashes[checkpoint.height - height]))
+        return checkpoint.height;
+  }
+  catch (const std::exception& e)
+  {
+    MERROR("Failed to look up checkpoints for blocks " << height << "-" << end << ": " << e.what());
+  }
+  return std::nullopt;
+}
+
 bool Blockchain::calc_batched_governance_reward(uint64_t height, uint64_t &reward) const
 {
   reward = 0;
@@ -4991,7 +5751,8 @@ bool Blockchain::calc_batched_governance_reward(uint64_t height, uint64_t &rewar
 
 //------------------------------------------------------------------
 // ND: Speedups:
-// 1. Thread long_hash computations if possible (m_max_prepare_blocks_threads = nthreads, default = 4)
+// 1. Thread long_hash computations if possible, using as many threads as the measured per-block
+//    cost makes worthwhile (capped by m_max_prepare_blocks_threads, if set)
 // 2. Group all amounts (from txs) and related absolute offsets and form a table of tx_prefix_hash
 //    vs [k_image, output_keys] (m_scan_table). This is faster because it takes advantage of bulk queries
 //    and is threaded if possible. The table (m_scan_table) will be used later when querying output
@@ -4999,6 +5760,7 @@ bool Blockchain::calc_batched_governance_reward(uint64_t height, uint64_t &rewar
 bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete_entry> &blocks_entry, std::vector<block> &blocks)
 {
   MTRACE("Blockchain::" << __func__);
+  TRACE_SPAN(blockchain, prepare_handle_incoming_blocks);
   TIME_MEASURE_START(prepare);
   uint64_t bytes = 0;
   size_t total_txs = 0;
@@ -5052,10 +5814,21 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
   blocks.resize(blocks_entry.size());
 
   {
-    // limit threads, default limit = 4
-    if(threads > m_max_prepare_blocks_threads)
+    // limit threads to the user-supplied maximum, if any (0 = use the whole threadpool)
+    if(m_max_prepare_blocks_threads > 0 && threads > m_max_prepare_blocks_threads)
       threads = m_max_prepare_blocks_threads;
 
+    // Only split the work as far as is worth it: once we know what a block costs to hash, give each
+    // thread at least PREPARE_MIN_MS_PER_THREAD of work.  A span of cheap (or few) blocks then
+    // stays on a couple of threads while heavy PoW spans get the whole pool.
+    const unsigned max_threads = threads;
+    if (m_prepare_longhash_ms_per_block > 0)
+    {
+      const double total_ms = m_prepare_longhash_ms_per_block * blocks_entry.size();
+      threads = std::clamp<unsigned>(std::ceil(total_ms / PREPARE_MIN_MS_PER_THREAD), 1, max_threads);
+    }
+    threads = std::max<unsigned>(1, std::min<size_t>(threads, blocks_entry.size()));
+
     unsigned int batches = blocks_entry.size() / threads;
     unsigned int extra = blocks_entry.size() % threads;
     MDEBUG("block_batches: " << batches);
@@ -5081,6 +5854,7 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
           {
             MDEBUG("Skipping prepare blocks. New blocks don't belong to chain.");
             blocks.clear();
+            precompute_alt_block_pow(blocks_entry);
             return true;
           }
         }
@@ -5113,13 +5887,36 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
       m_prepare_height = height;
       m_prepare_nblocks = blocks_entry.size();
       m_prepare_blocks = &blocks;
+      const auto pow_cache_height = pow_cache_trusted_height();
+
+      // Set up the RandomX caches of the span's seeds (two at most, where it crosses an epoch) first,
+      // in parallel; otherwise each seed's hashing threads stall behind whichever of them gets to
+      // it first, and the per block cost measured below includes the cache setup.
+      if (m_nettype != FAKECHAIN)
+      {
+        std::vector<std::pair<uint64_t, crypto::hash>> seeds;
+        for (size_t i = 0; i < blocks.size(); i++)
+        {
+          const uint64_t blk_height = height + i;
+          if (blocks[i].major_version < network_version_12_checkpointing || (pow_cache_height && blk_height <= *pow_cache_height))
+            continue;
+          const uint64_t seed_height = rx_seedheight(blk_height);
+          if (seeds.empty() || seeds.back().first != seed_height)
+            seeds.emplace_back(seed_height, get_pending_block_id_by_height(seed_height));
+        }
+        for (const auto &seed : seeds)
+          tpool.submit(&waiter, [&seed] { rx_prepare_seed(seed.first, seed.second.data); }, true);
+        waiter.wait(&tpool);
+      }
+
+      const auto longhash_start = std::chrono::steady_clock::now();
       for (unsigned int i = 0; i < threads; i++)
       {
         unsigned nblocks = batches;
         if (i < extra)
           ++nblocks;
-        tpool.submit(&waiter, [this, thread_height, blocks=epee::span<const block>(&blocks[thread_height - height], nblocks), &map=maps[i]]
-            { block_longhash_worker(thread_height, blocks, map); }, true);
+        tpool.submit(&waiter, [this, thread_height, blocks=epee::span<const block>(&blocks[thread_height - height], nblocks), &map=maps[i], pow_cache_height]
+            { block_longhash_worker(thread_height, blocks, map, pow_cache_height); }, true);
         thread_height += nblocks;
       }
 
@@ -5129,6 +5926,20 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
       if (m_cancel)
          return false;
 
+      // Track the (cpu) cost per block so the next span can be split accordingly; smoothed, so that a
+      // single odd span doesn't swing the thread count around.
+      const double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - longhash_start).count();
+      const double ms_per_block = elapsed_ms * threads / blocks_entry.size();
+      m_prepare_longhash_ms_per_block = m_prepare_longhash_ms_per_block > 0
+        ? 0.7 * m_prepare_longhash_ms_per_block + 0.3 * ms_per_block
+        : ms_per_block;
+      if (m_show_time_stats)
+        MINFO("Prepare blocks: hashed " << blocks_entry.size() << " blocks on " << threads << "/" << max_threads
+            << " threads in " << elapsed_ms << " ms (" << ms_per_block << " ms/block, " << m_prepare_longhash_ms_per_block << " average)");
+      else
+        MDEBUG("Prepare blocks: " << blocks_entry.size() << " blocks on " << threads << "/" << max_threads << " threads, "
+            << ms_per_block << " ms/block");
+
       for (const auto & map : maps)
       {
         m_blocks_longhash_table.insert(map.begin(), map.end());
@@ -5149,6 +5960,8 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
   m_fake_pow_calc_time = 0;
 
   m_scan_table.clear();
+  m_scan_unspent_key_images.clear();
+  m_scan_verified_rct_txs.clear();
 
   TIME_MEASURE_FINISH(prepare);
   m_fake_pow_calc_time = prepare / blocks_entry.size();
@@ -5165,33 +5978,58 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
   // [output] stores all output_data_t for each absolute_offset
   std::map<uint64_t, std::vector<output_data_t>> tx_map;
   std::vector<std::pair<cryptonote::transaction, crypto::hash>> txes(total_txs);
+  // [input] stores every key image spent by the incoming blocks
+  std::vector<crypto::key_image> key_images;
 
 #define SCAN_TABLE_QUIT(m) \
   do { \
     MERROR_VER(m) ;\
     m_scan_table.clear(); \
+    m_scan_unspent_key_images.clear(); \
+    m_scan_verified_rct_txs.clear(); \
     return false; \
   } while(0); \
 
-  // generate sorted tables for all amounts and absolute offsets
+  // parse all the txs first, so that their prefix hashes can be computed in one batch
   size_t tx_index = 0, block_index = 0;
+  {
+    std::vector<std::string> prefix_blobs(total_txs);
+    for (const auto &entry : blocks_entry)
+    {
+      if (m_cancel)
+        return false;
+
+      for (const auto &tx_blob : entry.txs)
+      {
+        if (tx_index >= txes.size())
+          SCAN_TABLE_QUIT("tx_index is out of sync");
+        transaction &tx = txes[tx_index].first;
+        if (!parse_and_validate_tx_base_from_blob(tx_blob, tx))
+          SCAN_TABLE_QUIT("Could not parse tx from incoming blocks.");
+        prefix_blobs[tx_index++] = serialization::dump_binary(static_cast<transaction_prefix&>(tx));
+      }
+    }
+
+    const std::vector<crypto::hash> prefix_hashes = crypto::cn_fast_hash_batch(std::vector<std::string_view>(prefix_blobs.begin(), prefix_blobs.end()));
+    for (size_t i = 0; i < prefix_hashes.size(); ++i)
+      txes[i].second = prefix_hashes[i];
+  }
+
+  // generate sorted tables for all amounts and absolute offsets
+  tx_index = 0;
   for (const auto &entry : blocks_entry)
   {
     if (m_cancel)
       return false;
 
-    for (const auto &tx_blob : entry.txs)
+    for (size_t i = 0; i < entry.txs.size(); ++i)
     {
       if (tx_index >= txes.size())
         SCAN_TABLE_QUIT("tx_index is out of sync");
-      transaction &tx = txes[tx_index].first;
-      crypto::hash &tx_prefix_hash = txes[tx_index].second;
+      const transaction &tx = txes[tx_index].first;
+      const crypto::hash &tx_prefix_hash = txes[tx_index].second;
       ++tx_index;
 
-      if (!parse_and_validate_tx_base_from_blob(tx_blob, tx))
-        SCAN_TABLE_QUIT("Could not parse tx from incoming blocks.");
-      cryptonote::get_transaction_prefix_hash(tx, tx_prefix_hash);
-
       auto its = m_scan_table.find(tx_prefix_hash);
       if (its != m_scan_table.end())
         SCAN_TABLE_QUIT("Duplicate tx found from incoming blocks.");
@@ -5211,6 +6049,7 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
           SCAN_TABLE_QUIT("Duplicate key_image found from incoming blocks.");
 
         amounts.push_back(in_to_key.amount);
+        key_images.push_back(in_to_key.k_image);
       }
 
       // sort and remove duplicate amounts from amounts list
@@ -5276,6 +6115,16 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
     }
   }
 
+  // check all the key images against the spent keys in one pass; check_tx_inputs and
+  // check_for_double_spend then only go to the db for images that weren't unspent here.
+  {
+    std::vector<bool> spent;
+    m_db->has_key_images(epee::to_span(key_images), spent);
+    for (size_t i = 0; i < key_images.size(); i++)
+      if (!spent[i])
+        m_scan_unspent_key_images.insert(key_images[i]);
+  }
+
   // now generate a table for each tx_prefix and k_image hashes
   tx_index = 0;
   for (const auto &entry : blocks_entry)
@@ -5283,7 +6132,7 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
     if (m_cancel)
       return false;
 
-    for (const auto &tx_blob : entry.txs)
+    for (size_t i = 0; i < entry.txs.size(); ++i)
     {
       if (tx_index >= txes.size())
         SCAN_TABLE_QUIT("tx_index is out of sync");
@@ -5336,47 +6185,355 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
       MDEBUG("Prepare scantable took: " << scantable << " ms");
   }
 
+  // The ring signature checks in check_tx_inputs otherwise run one tx at a time on the thread
+  // adding the blocks, so verify them here across the whole span in parallel.  Only txes whose
+  // rings are entirely in the scan table can be done now: rings that use outputs created earlier
+  // in this same span are left to check_tx_inputs, once those outputs have been added.
+  TIME_MEASURE_START(ringct);
+  std::vector<std::pair<const blobdata*, size_t>> verify_txes; // blob, index into txes
+  tx_index = 0;
+  for (const auto &entry : blocks_entry)
+  {
+    for (const auto &tx_blob : entry.txs)
+    {
+      const transaction &tx = txes[tx_index].first;
+      const bool simple_rct = tx.version >= txversion::v2_ringct && !tx.vin.empty() &&
+        tools::equals_any(tx.rct_signatures.type, rct::RCTType::Simple, rct::RCTType::Bulletproof, rct::RCTType::Bulletproof2, rct::RCTType::CLSAG);
+      if (simple_rct)
+      {
+        const auto &scanned = m_scan_table.at(txes[tx_index].second);
+        const bool complete = std::all_of(tx.vin.begin(), tx.vin.end(), [&scanned](const txin_v &in) {
+          const auto &in_to_key = var::get<txin_to_key>(in);
+          auto it = scanned.find(in_to_key.k_image);
+          return it != scanned.end() && it->second.size() == in_to_key.key_offsets.size();
+        });
+        if (complete)
+          verify_txes.emplace_back(&tx_blob, tx_index);
+      }
+      ++tx_index;
+    }
+  }
+
+  // Parse and expand the txes on the threadpool, then verify all their signatures in one batch
+  std::vector<transaction> verify_tx(verify_txes.size());
+  std::vector<crypto::hash> verify_txid(verify_txes.size(), crypto::null_hash);
+  {
+    tools::threadpool::waiter waiter;
+    for (size_t i = 0; i < verify_txes.size(); i++)
+    {
+      tpool.submit(&waiter, [this, &blob=*verify_txes[i].first, &tx_prefix_hash=txes[verify_txes[i].second].second, &tx=verify_tx[i], &txid=verify_txid[i]] {
+        crypto::hash hash;
+        if (!parse_and_validate_tx_from_blob(blob, tx, hash))
+          return;
+        const auto &scanned = m_scan_table.at(tx_prefix_hash);
+        std::vector<std::vector<rct::ctkey>> pubkeys(tx.vin.size());
+        for (size_t n = 0; n < tx.vin.size(); ++n)
+          for (const auto &out : scanned.at(var::get<txin_to_key>(tx.vin[n]).k_image))
+            pubkeys[n].push_back(rct::ctkey({rct::pk2rct(out.pubkey), out.commitment}));
+        if (expand_transaction_2(tx, tx_prefix_hash, pubkeys))
+          txid = hash;
+      }, true);
+    }
+    waiter.wait(&tpool);
+  }
+  std::vector<const rct::rctSig*> rvv;
+  std::vector<const crypto::hash*> rvv_txids;
+  for (size_t i = 0; i < verify_txes.size(); i++)
+  {
+    if (verify_txid[i] == crypto::null_hash)
+      continue;
+    rvv.push_back(&verify_tx[i].rct_signatures);
+    rvv_txids.push_back(&verify_txid[i]);
+  }
+  const std::vector<bool> verified = rct::verRctNonSemanticsSimple(rvv);
+  for (size_t i = 0; i < verified.size(); i++)
+    if (verified[i])
+      m_scan_verified_rct_txs.insert(*rvv_txids[i]);
+
+  TIME_MEASURE_FINISH(ringct);
+  if (!verify_txes.empty() && m_show_time_stats)
+    MDEBUG("Prepare ringct signatures took: " << ringct << " ms (" << m_scan_verified_rct_txs.size() << "/" << verify_txes.size() << " txes verified)");
+
   return true;
 }
 
+//------------------------------------------------------------------
+void Blockchain::preverify_tx_signatures(const std::vector<std::pair<const transaction*, crypto::hash>> &txs)
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+  TIME_MEASURE_START(preverify);
+
+  // Read the rings on this thread (db read txns are per-thread), then verify on the threadpool.
+  // No blockchain lock is taken: if the chain changes underneath us the rings we read may be
+  // stale, but check_tx_inputs only trusts the result if it reads back the same rings.
+  std::vector<std::pair<const transaction*, crypto::hash>> verify_txes;
+  std::vector<std::vector<std::vector<rct::ctkey>>> pubkeys;
+  {
+    db_rtxn_guard rtxn_guard(m_db);
+    for (const auto &[tx, txid] : txs)
+    {
+      if (tx->version < txversion::v2_ringct || tx->vin.empty() ||
+          !tools::equals_any(tx->rct_signatures.type, rct::RCTType::Simple, rct::RCTType::Bulletproof, rct::RCTType::Bulletproof2, rct::RCTType::CLSAG))
+        continue;
+      {
+        std::lock_guard lock{m_preverified_txs_mutex};
+        if (m_preverified_txs.contains(txid))
+          continue;
+      }
+
+      std::vector<std::vector<rct::ctkey>> tx_pubkeys;
+      tx_pubkeys.reserve(tx->vin.size());
+      bool ok = true;
+      for (const auto &in : tx->vin)
+      {
+        const auto *in_to_key = std::get_if<txin_to_key>(&in);
+        if (!in_to_key || in_to_key->key_offsets.empty())
+        {
+          ok = false;
+          break;
+        }
+        std::vector<output_data_t> outputs;
+        try
+        {
+          m_db->get_output_key(epee::span<const uint64_t>(&in_to_key->amount, 1),
+              relative_output_offsets_to_absolute(in_to_key->key_offsets), outputs, true);
+        }
+        catch (...)
+        {
+          ok = false;
+          break;
+        }
+        if (outputs.size() != in_to_key->key_offsets.size())
+        {
+          ok = false;
+          break;
+        }
+        auto &ring = tx_pubkeys.emplace_back();
+        ring.reserve(outputs.size());
+        for (const auto &out : outputs)
+          ring.push_back(rct::ctkey({rct::pk2rct(out.pubkey), out.commitment}));
+      }
+      if (!ok)
+        continue;
+      verify_txes.emplace_back(tx, txid);
+      pubkeys.push_back(std::move(tx_pubkeys));
+    }
+  }
+
+  // Verify the signatures of all the txes in one threadpool batch (one task per input), so that
+  // workers that draw cheap inputs keep pulling from the queue while others are busy.
+  std::vector<transaction> verify_tx;
+  std::vector<const crypto::hash*> verify_txid;
+  verify_tx.reserve(verify_txes.size());
+  for (size_t i = 0; i < verify_txes.size(); i++)
+  {
+    transaction tx = *verify_txes[i].first;
+    if (!expand_transaction_2(tx, get_transaction_prefix_hash(tx), pubkeys[i]))
+      continue;
+    verify_tx.push_back(std::move(tx));
+    verify_txid.push_back(&verify_txes[i].second);
+  }
+  std::vector<const rct::rctSig*> rvv;
+  rvv.reserve(verify_tx.size());
+  for (const auto &tx : verify_tx)
+    rvv.push_back(&tx.rct_signatures);
+  const std::vector<bool> verified = rct::verRctNonSemanticsSimple(rvv);
+  {
+    std::lock_guard lock{m_preverified_txs_mutex};
+    for (size_t i = 0; i < verified.size(); i++)
+      if (verified[i])
+        m_preverified_txs.put(*verify_txid[i], std::move(verify_tx[i].rct_signatures.mixRing));
+  }
+
+  TIME_MEASURE_FINISH(preverify);
+  if (!verify_txes.empty() && m_show_time_stats)
+    MDEBUG("Preverifying " << verify_txes.size() << " tx signatures took: " << preverify << " ms");
+}
+//------------------------------------------------------------------
 void Blockchain::add_txpool_tx(const crypto::hash &txid, const cryptonote::blobdata &blob, const txpool_tx_meta_t &meta)
 {
-  m_db->add_txpool_tx(txid, blob, meta);
+  std::lock_guard lock{m_txpool_store_mutex};
+  if (m_txpool_store.count(txid))
+    throw DB_ERROR("Attempting to add txpool tx that's already in the txpool");
+  journal_txpool_tx(txid);
+  m_txpool_store.emplace(txid, txpool_store_entry{meta, blob});
+  m_txpool_dirty[txid] = true;
 }
 
 void Blockchain::update_txpool_tx(const crypto::hash &txid, const txpool_tx_meta_t &meta)
 {
-  m_db->update_txpool_tx(txid, meta);
+  std::lock_guard lock{m_txpool_store_mutex};
+  auto it = m_txpool_store.find(txid);
+  if (it == m_txpool_store.end())
+    throw DB_ERROR("Error finding txpool tx meta to update");
+  journal_txpool_tx(txid);
+  it->second.meta = meta;
+  m_txpool_dirty.emplace(txid, false);
 }
 
 void Blockchain::remove_txpool_tx(const crypto::hash &txid)
 {
-  m_db->remove_txpool_tx(txid);
+  std::lock_guard lock{m_txpool_store_mutex};
+  auto it = m_txpool_store.find(txid);
+  if (it == m_txpool_store.end())
+    return;
+  journal_txpool_tx(txid);
+  m_txpool_store.erase(it);
+  m_txpool_dirty[txid] = true;
 }
 
 uint64_t Blockchain::get_txpool_tx_count(bool include_unrelayed_txes) const
 {
-  return m_db->get_txpool_tx_count(include_unrelayed_txes);
+  std::lock_guard lock{m_txpool_store_mutex};
+  if (include_unrelayed_txes)
+    return m_txpool_store.size();
+  return std::count_if(m_txpool_store.begin(), m_txpool_store.end(), [](const auto &e) { return !e.second.meta.do_not_relay; });
 }
 
 bool Blockchain::get_txpool_tx_meta(const crypto::hash& txid, txpool_tx_meta_t &meta) const
 {
-  return m_db->get_txpool_tx_meta(txid, meta);
+  std::lock_guard lock{m_txpool_store_mutex};
+  auto it = m_txpool_store.find(txid);
+  if (it == m_txpool_store.end())
+    return false;
+  meta = it->second.meta;
+  return true;
 }
 
 bool Blockchain::get_txpool_tx_blob(const crypto::hash& txid, cryptonote::blobdata &bd) const
 {
-  return m_db->get_txpool_tx_blob(txid, bd);
+  std::lock_guard lock{m_txpool_store_mutex};
+  auto it = m_txpool_store.find(txid);
+  if (it == m_txpool_store.end())
+    return false;
+  bd = it->second.blob;
+  return true;
 }
 
 cryptonote::blobdata Blockchain::get_txpool_tx_blob(const crypto::hash& txid) const
 {
-  return m_db->get_txpool_tx_blob(txid);
+  cryptonote::blobdata bd;
+  if (!get_txpool_tx_blob(txid, bd))
+    throw DB_ERROR("Tx not found in txpool: ");
+  return bd;
 }
 
 bool Blockchain::for_all_txpool_txes(std::function<bool(const crypto::hash&, const txpool_tx_meta_t&, const cryptonote::blobdata*)> f, bool include_blob, bool include_unrelayed_txes) const
 {
-  return m_db->for_all_txpool_txes(f, include_blob, include_unrelayed_txes);
+  std::lock_guard lock{m_txpool_store_mutex};
+  // Iterate over a snapshot of the txids, and pass copies, so that `f` may modify the txpool
+  std::vector<crypto::hash> txids;
+  txids.reserve(m_txpool_store.size());
+  for (const auto &e : m_txpool_store)
+    txids.push_back(e.first);
+
+  for (const auto &txid : txids)
+  {
+    auto it = m_txpool_store.find(txid);
+    if (it == m_txpool_store.end() || (!include_unrelayed_txes && it->second.meta.do_not_relay))
+      continue;
+    const txpool_tx_meta_t meta = it->second.meta;
+    cryptonote::blobdata bd;
+    if (include_blob)
+      bd = it->second.blob;
+    if (!f(txid, meta, include_blob ? &bd : nullptr))
+      return false;
+  }
+  return true;
+}
+
+bool Blockchain::txpool_has_tx(const crypto::hash &txid) const
+{
+  std::lock_guard lock{m_txpool_store_mutex};
+  return m_txpool_store.count(txid);
+}
+
+void Blockchain::journal_txpool_tx(const crypto::hash &txid)
+{
+  if (!m_txpool_txn_active)
+    return;
+  auto it = m_txpool_store.find(txid);
+  m_txpool_undo.emplace_back(txid, it == m_txpool_store.end() ? std::nullopt : std::make_optional(it->second));
+}
+
+bool Blockchain::txpool_txn_start()
+{
+  std::lock_guard lock{m_txpool_store_mutex};
+  if (m_txpool_txn_active)
+    return false;
+  m_txpool_txn_active = true;
+  m_txpool_undo.clear();
+  return true;
+}
+
+void Blockchain::txpool_txn_stop()
+{
+  std::lock_guard lock{m_txpool_store_mutex};
+  m_txpool_txn_active = false;
+  m_txpool_undo.clear();
+}
+
+void Blockchain::txpool_txn_abort()
+{
+  std::lock_guard lock{m_txpool_store_mutex};
+  for (auto it = m_txpool_undo.rbegin(); it != m_txpool_undo.rend(); ++it)
+  {
+    auto &[txid, prev] = *it;
+    if (prev)
+      m_txpool_store.insert_or_assign(txid, std::move(*prev));
+    else
+      m_txpool_store.erase(txid);
+    m_txpool_dirty[txid] = true;
+  }
+  m_txpool_txn_active = false;
+  m_txpool_undo.clear();
+}
+
+void Blockchain::load_txpool_store()
+{
+  std::lock_guard lock{m_txpool_store_mutex};
+  m_txpool_store.clear();
+  m_txpool_dirty.clear();
+  m_db->for_all_txpool_txes([this](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata *bd) {
+    m_txpool_store.emplace(txid, txpool_store_entry{meta, *bd});
+    return true;
+  }, true /*include_blob*/);
+}
+
+void Blockchain::flush_txpool()
+{
+  auto locks = tools::unique_locks(m_tx_pool, *this);
+  std::lock_guard store_lock{m_txpool_store_mutex};
+  if (m_txpool_dirty.empty() || !m_db || m_db->is_read_only())
+    return;
+
+  bool stop_batch = m_db->batch_start();
+  try
+  {
+    for (const auto &[txid, blob_changed] : m_txpool_dirty)
+    {
+      auto it = m_txpool_store.find(txid);
+      if (it != m_txpool_store.end() && !blob_changed)
+      {
+        m_db->update_txpool_tx(txid, it->second.meta);
+        continue;
+      }
+      m_db->remove_txpool_tx(txid);
+      if (it != m_txpool_store.end())
+        m_db->add_txpool_tx(txid, it->second.blob, it->second.meta);
+    }
+  }
+  catch (const std::exception &e)
+  {
+    MERROR("Failed to write txpool changes to the db: " << e.what());
+    if (stop_batch)
+      m_db->batch_abort();
+    return;
+  }
+  if (stop_batch)
+    m_db->batch_stop();
+  MDEBUG("Flushed " << m_txpool_dirty.size() << " txpool changes to the db");
+  m_txpool_dirty.clear();
 }
 
 uint64_t Blockchain::get_immutable_height() const
@@ -5402,6 +6559,17 @@ void Blockchain::set_user_options(uint64_t maxthreads, bool sync_on_blocks, uint
   m_max_prepare_blocks_threads = maxthreads;
 }
 
+std::optional<uint64_t> Blockchain::pow_cache_trusted_height() const
+{
+  if (!m_pow_cache_enabled)
+    return std::nullopt;
+  uint64_t trusted = m_checkpoints.get_max_height();
+  const uint64_t height = m_db->height();
+  if (m_pow_cache_trust_depth > 0 && height > m_pow_cache_trust_depth)
+    trusted = std::max(trusted, height - m_pow_cache_trust_depth);
+  return trusted;
+}
+
 void Blockchain::safesyncmode(const bool onoff)
 {
   /* all of this is no-op'd if the user set a specific
@@ -5412,6 +6580,9 @@ void Blockchain::safesyncmode(const bool onoff)
     m_db->safesyncmode(onoff);
     m_db_sync_mode = onoff ? db_nosync : db_async;
   }
+
+  // This is called with onoff set as we finish syncing, and cleared when we fall behind
+  m_db->set_io_policy(onoff ? BlockchainDB::io_policy::synced : BlockchainDB::io_policy::syncing);
 }
 
 std::map<uint64_t, std::tuple<uint64_t, uint64_t, uint64_t>> Blockchain:: get_output_histogram(const std::vector<uint64_t> &amounts, bool unlocked, uint64_t recent_cutoff, uint64_t min_count) const
@@ -5422,59 +6593,38 @@ std::map<uint64_t, std::tuple<uint64_t, uint64_t, uint64_t>> Blockchain:: get_ou
 std::vector<std::pair<Blockchain::block_extended_info,std::vector<crypto::hash>>> Blockchain::get_alternative_chains() const
 {
   std::vector<std::pair<Blockchain::block_extended_info,std::vector<crypto::hash>>> chains;
+  std::unique_lock lock{*this};
 
-  blocks_ext_by_hash alt_blocks;
-  alt_blocks.reserve(m_db->get_alt_block_count());
-  m_db->for_all_alt_blocks([&alt_blocks](const crypto::hash &blkid, const cryptonote::alt_block_data_t &data, const cryptonote::blobdata *block_blob, const cryptonote::blobdata *checkpoint_blob) {
-    if (!block_blob)
+  // The chain tips are the alt blocks that no other alt block builds on
+  std::unordered_set<crypto::hash> parents;
+  parents.reserve(m_alt_blocks.size());
+  for (const auto &[id, entry] : m_alt_blocks)
+    parents.insert(entry.prev_id);
+
+  for (const auto &[id, entry] : m_alt_blocks)
+  {
+    if (parents.count(id))
+      continue;
+
+    alt_block_data_t data;
+    cryptonote::blobdata blob, checkpoint_blob;
+    if (!m_db->get_alt_block(id, &data, &blob, &checkpoint_blob))
     {
-      MERROR("No blob, but blobs were requested");
-      return false;
+      MERROR("Alt block " << id << " is indexed but not in the db");
+      continue;
     }
 
     checkpoint_t checkpoint = {};
-    if (data.checkpointed && checkpoint_blob)
-    {
-      if (!t_serializable_object_from_blob(checkpoint, *checkpoint_blob))
-        MERROR("Failed to parse checkpoint from blob");
-    }
+    if (data.checkpointed && !t_serializable_object_from_blob(checkpoint, checkpoint_blob))
+      MERROR("Failed to parse checkpoint from blob");
 
     cryptonote::block block;
-    if (cryptonote::parse_and_validate_block_from_blob(*block_blob, block))
+    if (!cryptonote::parse_and_validate_block_from_blob(blob, block))
     {
-      block_extended_info bei(data, std::move(block), data.checkpointed ? &checkpoint : nullptr);
-      alt_blocks.insert(std::make_pair(cryptonote::get_block_hash(bei.bl), std::move(bei)));
-    }
-    else
       MERROR("Failed to parse block from blob");
-    return true;
-  }, true);
-
-  for (const auto &i: alt_blocks)
-  {
-    const crypto::hash top = cryptonote::get_block_hash(i.second.bl);
-    bool found = false;
-    for (const auto &j: alt_blocks)
-    {
-      if (j.second.bl.prev_id == top)
-      {
-        found = true;
-        break;
-      }
-    }
-    if (!found)
-    {
-      std::vector<crypto::hash> chain;
-      auto h = i.second.bl.prev_id;
-      chain.push_back(top);
-      blocks_ext_by_hash::const_iterator prev;
-      while ((prev = alt_blocks.find(h)) != alt_blocks.end())
-      {
-        chain.push_back(h);
-        h = prev->second.bl.prev_id;
-      }
-      chains.push_back(std::make_pair(i.second, chain));
+      continue;
     }
+    chains.emplace_back(block_extended_info(data, std::move(block), data.checkpointed ? &checkpoint : nullptr), get_alt_chain_hashes(id));
   }
   return chains;
 }
@@ -5532,10 +6682,13 @@ void Blockchain::load_compiled_in_block_hashes(const GetCheckpointsCallback& get
         MERROR("Block hash data is too large");
         return;
       }
+      // The hashes can be followed by state commitments for the first chunks they cover
       const size_t size_needed = 4 + (nblocks * sizeof(crypto::hash));
-      if(checkpoints.size() != size_needed)
+      const size_t ncommitments = checkpoints.size() > size_needed ? (checkpoints.size() - size_needed) / CHUNK_STATE_COMMITMENT_SIZE : 0;
+      if(checkpoints.size() != size_needed + ncommitments * CHUNK_STATE_COMMITMENT_SIZE || ncommitments > nblocks)
       {
-        MERROR("Failed to load hashes - unexpected data size " << checkpoints.size() << ", expected " << size_needed);
+        MERROR("Failed to load hashes - unexpected data size " << checkpoints.size() << ", expected " << size_needed
+            << " or that plus up to " << nblocks << " " << CHUNK_STATE_COMMITMENT_SIZE << "-byte state commitments");
         return;
       }
       else if(nblocks > 0 && nblocks > (m_db->height() + HASH_OF_HASHES_STEP - 1) / HASH_OF_HASHES_STEP)
@@ -5551,6 +6704,21 @@ void Blockchain::load_compiled_in_block_hashes(const GetCheckpointsCallback& get
         m_blocks_hash_check.resize(m_blocks_hash_of_hashes.size() * HASH_OF_HASHES_STEP, crypto::null_hash);
         MINFO(nblocks << " block hashes loaded");
 
+        m_blocks_state_commitments.reserve(ncommitments);
+        for (size_t i = 0; i < ncommitments; i++)
+        {
+          auto& c = m_blocks_state_commitments.emplace_back();
+          std::memcpy(&c.outputs, checkpoints.data(), sizeof(c.outputs));
+          boost::endian::little_to_native_inplace(c.outputs);
+          checkpoints.remove_prefix(sizeof(c.outputs));
+          std::memcpy(c.key_images.data, checkpoints.data(), sizeof(c.key_images.data));
+          checkpoints.remove_prefix(sizeof(c.key_images.data));
+          std::memcpy(c.service_nodes.data, checkpoints.data(), sizeof(c.service_nodes.data));
+          checkpoints.remove_prefix(sizeof(c.service_nodes.data));
+        }
+        if (ncommitments)
+          MINFO(ncommitments << " chunk state commitments loaded");
+
         // FIXME: clear tx_pool because the process might have been
         // terminated and caused it to store txs kept by blocks.
         // The core will not call check_tx_inputs(..) for these
@@ -5558,19 +6726,16 @@ void Blockchain::load_compiled_in_block_hashes(const GetCheckpointsCallback& get
         // for tx hashes will fail in handle_block_to_main_chain(..)
         std::unique_lock lock{m_tx_pool};
 
-        std::vector<transaction> txs;
-        m_tx_pool.get_transactions(txs);
+        std::vector<crypto::hash> tx_hashes;
+        m_tx_pool.get_transaction_hashes(tx_hashes);
 
         size_t tx_weight;
         uint64_t fee;
         bool relayed, do_not_relay, double_spend_seen;
         transaction pool_tx;
         blobdata txblob;
-        for(const transaction &tx : txs)
-        {
-          crypto::hash tx_hash = get_transaction_hash(tx);
+        for(const crypto::hash &tx_hash : tx_hashes)
           m_tx_pool.take_tx(tx_hash, pool_tx, txblob, tx_weight, fee, relayed, do_not_relay, double_spend_seen);
-        }
       }
     }
   }
@@ -5586,6 +6751,96 @@ bool Blockchain::is_within_compiled_block_hash_area(uint64_t height) const
 #endif
 }
 
+bool Blockchain::update_chunk_state(const block& bl, const std::vector<std::pair<transaction, blobdata>>& txs, uint64_t height)
+{
+  const uint64_t chunk = height / HASH_OF_HASHES_STEP;
+  const bool committed = chunk < m_blocks_state_commitments.size();
+  const bool recording = m_record_state_commitments && chunk == m_recorded_state_commitments.size();
+  if (!committed && !recording)
+  {
+    m_chunk_state.tracked = false;
+    return true;
+  }
+
+  if (height % HASH_OF_HASHES_STEP == 0)
+  {
+    m_chunk_state.tracked = true;
+    m_chunk_state.outputs = 0;
+    m_chunk_state.key_images.clear();
+  }
+  if (!m_chunk_state.tracked)
+    return true;
+
+  m_chunk_state.outputs += bl.miner_tx.vout.size();
+  for (const auto& [tx, blob] : txs)
+  {
+    m_chunk_state.outputs += tx.vout.size();
+    for (const auto& in : tx.vin)
+      if (auto* in_to_key = std::get_if<txin_to_key>(&in))
+        m_chunk_state.key_images.push_back(in_to_key->k_image);
+  }
+
+  if (height % HASH_OF_HASHES_STEP != HASH_OF_HASHES_STEP - 1)
+    return true;
+
+  chunk_state_commitment state{m_chunk_state.outputs};
+  crypto::cn_fast_hash(m_chunk_state.key_images.data(), m_chunk_state.key_images.size() * sizeof(crypto::key_image), state.key_images);
+  state.service_nodes = m_service_node_list.state_hash();
+  m_chunk_state.tracked = false;
+  m_chunk_state.key_images.clear();
+  m_chunk_state.key_images.shrink_to_fit();
+
+  if (recording)
+    m_recorded_state_commitments.push_back(state);
+
+  if (committed)
+  {
+    auto& expected = m_blocks_state_commitments[chunk];
+    if (state.outputs != expected.outputs || state.key_images != expected.key_images || state.service_nodes != expected.service_nodes)
+    {
+      MERROR("State after blocks " << chunk * HASH_OF_HASHES_STEP << " - " << height << " does not match the compiled-in commitment: "
+          << state.outputs << " outputs, key images " << state.key_images << ", service nodes " << state.service_nodes << "; expected "
+          << expected.outputs << ", " << expected.key_images << ", " << expected.service_nodes);
+      return false;
+    }
+    MDEBUG("State after blocks " << chunk * HASH_OF_HASHES_STEP << " - " << height << " matches the compiled-in commitment");
+  }
+  return true;
+}
+
+void Blockchain::drop_compiled_in_blocks_from(uint64_t chunk)
+{
+  const uint64_t start = chunk * HASH_OF_HASHES_STEP;
+  MWARNING("No longer trusting the compiled-in blocks data from height " << start << "; blocks from there on will be fully verified");
+  if (m_blocks_hash_of_hashes.size() > chunk)
+    m_blocks_hash_of_hashes.resize(chunk);
+  if (m_blocks_hash_check.size() > start)
+    m_blocks_hash_check.resize(start);
+  if (m_blocks_state_commitments.size() > chunk)
+    m_blocks_state_commitments.resize(chunk);
+
+  const uint64_t old_height = m_db->height();
+  while (m_db->height() > std::max<uint64_t>(start, 1))
+    pop_block_from_blockchain();
+  if (m_db->height() != old_height)
+    for (BlockchainDetachedHook* hook : m_blockchain_detached_hooks)
+      hook->blockchain_detached(m_db->height(), false /*by_pop_blocks*/);
+}
+
+std::string Blockchain::recorded_state_commitments() const
+{
+  std::string data;
+  data.reserve(m_recorded_state_commitments.size() * CHUNK_STATE_COMMITMENT_SIZE);
+  for (const auto& c : m_recorded_state_commitments)
+  {
+    uint64_t outputs = boost::endian::native_to_little(c.outputs);
+    data.append(reinterpret_cast<const char*>(&outputs), sizeof(outputs));
+    data.append(c.key_images.data, sizeof(c.key_images.data));
+    data.append(c.service_nodes.data, sizeof(c.service_nodes.data));
+  }
+  return data;
+}
+
 bool Blockchain::for_all_key_images(std::function<bool(const crypto::key_image&)> f) const
 {
   return m_db->for_all_key_images(f);
@@ -5617,14 +6872,17 @@ void Blockchain::invalidate_block_template_cache()
   m_btc_valid = false;
 }
 
-void Blockchain::cache_block_template(const block &b, const cryptonote::account_public_address &address, const blobdata &nonce, const difficulty_type &diff, uint64_t height, uint64_t expected_reward, uint64_t pool_cookie)
+void Blockchain::cache_block_template(const block &b, const block_template_info &info, const blobdata &nonce, const difficulty_type &diff, uint64_t height, uint64_t expected_reward, uint64_t pool_cookie)
 {
   MDEBUG("Setting block template cache");
   m_btc = b;
-  m_btc_address = address;
+  m_btc_is_miner = info.is_miner;
+  m_btc_address = info.miner_address;
+  m_btc_producer = info.service_node_payout.key;
   m_btc_nonce = nonce;
   m_btc_height = height;
   m_btc_expected_reward = expected_reward;
   m_btc_pool_cookie = pool_cookie;
+  m_btc_time = std::chrono::steady_clock::now();
   m_btc_valid = true;
 }
@@ -45,7 +45,12 @@
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/member.hpp>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -54,6 +59,9 @@
 #include "epee/rolling_median.h"
 #include "cryptonote_basic/cryptonote_basic.h"
 #include "common/util.h"
+#include "common/lock_stats.h"
+#include "common/lru_cache.h"
+#include "common/metrics.h"
 #include "cryptonote_protocol/cryptonote_protocol_defs.h"
 #include "rpc/core_rpc_server_commands_defs.h"
 #include "cryptonote_basic/difficulty.h"
@@ -199,6 +207,25 @@ namespace cryptonote
      */
     size_t get_alternative_blocks_count() const;
 
+    /**
+     * @brief removes all alternative blocks
+     */
+    void drop_alt_blocks();
+
+    /**
+     * @brief removes alternative blocks more than ALT_BLOCK_RETENTION blocks below the top of the
+     * main chain
+     *
+     * Blocks are removed ALT_BLOCK_PRUNE_BATCH at a time, each batch in its own db transaction,
+     * with the blockchain lock released in between.
+     */
+    void prune_alt_blocks();
+
+    // Alt blocks this far below the top of the main chain can't win a reorg (or are long past the
+    // immutable checkpoint), so prune_alt_blocks drops them
+    static constexpr uint64_t ALT_BLOCK_RETENTION = 720;
+    static constexpr size_t ALT_BLOCK_PRUNE_BATCH = 100;
+
     /**
      * @brief gets a block's hash given a height
      *
@@ -241,6 +268,18 @@ namespace cryptonote
      */
     bool get_block_by_height(uint64_t height, block &blk) const;
 
+    struct block_cache_stats
+    {
+      uint64_t hits;
+      uint64_t misses;
+      size_t size;
+    };
+
+    /**
+     * @brief returns hit/miss counts and the current size of the recent block cache
+     */
+    block_cache_stats get_block_cache_stats() const;
+
     /**
      * @brief performs some preprocessing on a group of incoming blocks to speed up verification
      *
@@ -293,6 +332,17 @@ namespace cryptonote
      */
     bool have_tx_keyimg_as_spent(const crypto::key_image &key_im) const;
 
+    /**
+     * @brief check if each of a list of key images is already spent on the blockchain
+     *
+     * Plural version of have_tx_keyimg_as_spent() which looks all the images up in a single pass
+     * over the database.
+     *
+     * @param key_images the key images to search for
+     * @param spent return-by-reference: one value per image, true if it is already spent
+     */
+    void have_tx_keyimgs_as_spent(epee::span<const crypto::key_image> key_images, std::vector<bool> &spent) const;
+
     /**
      * @brief get the current height of the blockchain
      *
@@ -564,9 +614,12 @@ namespace cryptonote
     /**
      * @brief gets global output indexes that should not be used, i.e. registration tx outputs
      *
-     * @param return-by-reference blacklist global indexes of rct outputs to ignore
+     * @param return-by-reference blacklist global indexes of rct outputs to ignore, in ascending order
+     * @param after if given, only return the indexes above this one
+     *
+     * @return the total number of blacklisted outputs
      */
-    void get_output_blacklist(std::vector<uint64_t> &blacklist) const;
+    uint64_t get_output_blacklist(std::vector<uint64_t> &blacklist, std::optional<uint64_t> after = std::nullopt) const;
 
     /**
      * @brief gets the global indices for outputs from a given transaction
@@ -612,6 +665,21 @@ namespace cryptonote
      */
     bool check_tx_inputs(transaction& tx, uint64_t& pmax_used_block_height, crypto::hash& max_used_block_id, tx_verification_context &tvc, bool kept_by_block = false, std::unordered_set<crypto::key_image>* key_image_conflicts = nullptr);
 
+    /**
+     * @brief verifies the ring signatures of a batch of incoming transactions in parallel, without
+     * holding the blockchain lock
+     *
+     * The rings are read from the db and each transaction's signatures are checked on the
+     * threadpool.  Transactions that pass are remembered along with the rings they were checked
+     * against, so that a later check_tx_inputs of the same transaction only has to confirm the
+     * rings are unchanged rather than repeat the signature check.  Transactions that fail (or
+     * whose rings can't be read) are simply not remembered: check_tx_inputs does the full check
+     * and reports the error.
+     *
+     * @param txs the parsed transactions and their hashes
+     */
+    void preverify_tx_signatures(const std::vector<std::pair<const transaction*, crypto::hash>> &txs);
+
     /**
      * @brief get fee quantization mask
      *
@@ -767,7 +835,7 @@ namespace cryptonote
     /**
      * @brief sets various performance options
      *
-     * @param maxthreads max number of threads when preparing blocks for addition
+     * @param maxthreads max number of threads when preparing blocks for addition (0 for no limit)
      * @param sync_on_blocks whether to sync based on blocks or bytes
      * @param sync_threshold number of blocks/bytes to cache before syncing to database
      * @param sync_mode the ::blockchain_db_sync_mode to use
@@ -776,6 +844,23 @@ namespace cryptonote
     void set_user_options(uint64_t maxthreads, bool sync_on_blocks, uint64_t sync_threshold,
         blockchain_db_sync_mode sync_mode, bool fast_sync);
 
+    /**
+     * @brief configures the on-disk cache of verified block PoW hashes
+     *
+     * @param enabled whether to store and use cached PoW hashes
+     * @param trust_depth also trust cached hashes for blocks at least this many blocks below the
+     * current height (0 = only at or below the latest checkpoint)
+     */
+    void set_pow_cache(bool enabled, uint64_t trust_depth) { m_pow_cache_enabled = enabled; m_pow_cache_trust_depth = trust_depth; }
+
+    /**
+     * @brief bounds how far durability may lag behind block processing in db_async sync mode
+     *
+     * @param max_pending the number of requested database syncs that may be outstanding before
+     * block processing waits for the oldest to finish (0 = no limit)
+     */
+    void set_max_pending_syncs(uint64_t max_pending) { m_db_max_pending_syncs = max_pending; }
+
     /**
      * @brief sets a block notify object to call for every new block
      *
@@ -930,9 +1015,31 @@ namespace cryptonote
      * @param height the height of the first block
      * @param blocks the blocks to be hashed
      * @param map return-by-reference the hashes for each block
+     * @param pow_cache_height if set, PoW hashes cached in the db are used for blocks up to this
+     * height (see pow_cache_trusted_height())
      */
     void block_longhash_worker(uint64_t height, const epee::span<const block> &blocks,
-        std::unordered_map<crypto::hash, crypto::hash> &map) const;
+        std::unordered_map<crypto::hash, crypto::hash> &map, std::optional<uint64_t> pow_cache_height) const;
+
+    /**
+     * @brief computes, in parallel, the PoW hashes of a span of incoming blocks that forks off the
+     * main chain, storing them in m_alt_block_pow for handle_alternative_block and a later
+     * switch_to_alternative_blockchain to use
+     *
+     * Does nothing if the span doesn't build on a known main chain or alt block.
+     *
+     * @param blocks_entry the incoming blocks
+     */
+    void precompute_alt_block_pow(const std::vector<block_complete_entry> &blocks_entry);
+
+    /**
+     * @brief returns the highest block height for which a PoW hash cached in the db may be used
+     * instead of recomputing it, or nullopt if the PoW cache is disabled
+     *
+     * Cached hashes are trusted at or below the latest checkpoint and, if a trust depth is
+     * configured, for blocks at least that many blocks below the current chain height.
+     */
+    std::optional<uint64_t> pow_cache_trusted_height() const;
 
     /**
      * @brief returns a set of known alternate chains
@@ -949,11 +1056,80 @@ namespace cryptonote
     bool get_txpool_tx_blob(const crypto::hash& txid, cryptonote::blobdata &bd) const;
     cryptonote::blobdata get_txpool_tx_blob(const crypto::hash& txid) const;
     bool for_all_txpool_txes(std::function<bool(const crypto::hash&, const txpool_tx_meta_t&, const cryptonote::blobdata*)>, bool include_blob = false, bool include_unrelayed_txes = true) const;
+    bool txpool_has_tx(const crypto::hash &txid) const;
+
+    /**
+     * @brief writes the txpool changes made since the last flush to the db's txpool tables
+     *
+     * The txpool_tx methods above work on an in-memory copy of the txpool; the db copy is only
+     * there so that the pool survives a restart.  This is called periodically, when storing the
+     * blockchain and on shutdown.
+     */
+    void flush_txpool();
+
+    /**
+     * @brief starts a txpool "transaction" (used by LockedTXN): txpool changes made until
+     * txpool_txn_stop() can be undone with txpool_txn_abort()
+     *
+     * Must be called with the txpool lock held.
+     *
+     * @return false if a txpool transaction is already active (it then covers these changes, too)
+     */
+    bool txpool_txn_start();
+    void txpool_txn_stop();
+    void txpool_txn_abort();
+
+    /**
+     * State committed to by the optional second section of the compiled-in blocks data, one per
+     * HASH_OF_HASHES_STEP block chunk.  Fast sync skips some per-tx checks for blocks covered by
+     * these commitments, and checks them when each chunk's last block is added.
+     */
+    struct chunk_state_commitment
+    {
+      uint64_t outputs;            // tx outputs (including coinbase outputs) created in the chunk
+      crypto::hash key_images;     // cn_fast_hash of the key images spent in the chunk, in chain order
+      crypto::hash service_nodes;  // service_node_list::state_hash() after the chunk's last block
+    };
+    static constexpr size_t CHUNK_STATE_COMMITMENT_SIZE = 8 + 2 * sizeof(crypto::hash);
+
+    /**
+     * @brief enables recording the state commitment of every chunk added from genesis, for
+     * generating the compiled-in blocks data (see recorded_state_commitments()).
+     */
+    void record_state_commitments(bool enable) { m_record_state_commitments = enable; }
+
+    /**
+     * @brief the state commitments of the complete chunks added since genesis while recording,
+     * serialized for appending to the compiled-in blocks data
+     */
+    std::string recorded_state_commitments() const;
 
     bool is_within_compiled_block_hash_area(uint64_t height) const;
     bool is_within_compiled_block_hash_area() const { return is_within_compiled_block_hash_area(m_db->height()); }
     uint64_t prevalidate_block_hashes(uint64_t height, const std::vector<crypto::hash> &hashes);
+
+    /**
+     * @brief checks block ids from a peer's chain against our checkpoints
+     *
+     * Lets sync reject a peer on a chain that violates a checkpoint from the ids it sends alone,
+     * before downloading any of its blocks.
+     *
+     * @param height the height of the first of `hashes`
+     * @param hashes consecutive block ids
+     *
+     * @return the height of the first id that conflicts with a checkpoint, if any
+     */
+    std::optional<uint64_t> find_checkpoint_conflict(uint64_t height, const std::vector<crypto::hash> &hashes) const;
     uint32_t get_blockchain_pruning_seed() const { return m_db->get_blockchain_pruning_seed(); }
+    /**
+     * @brief prunes the blockchain a few thousand txs at a time
+     *
+     * The blockchain and tx pool locks are released, with a short pause, between steps so that
+     * block sync is not held up for the whole run.  Stopping part way (including via cancel())
+     * leaves the progress in the database for the next call to pick up.
+     *
+     * @return true once the blockchain is fully pruned
+     */
     bool prune_blockchain(uint32_t pruning_seed = 0);
     bool update_blockchain_pruning();
     bool check_blockchain_pruning();
@@ -1056,20 +1232,177 @@ namespace cryptonote
     service_nodes::service_node_list& m_service_node_list;
     ons::name_system_db               m_ons_db;
 
-    mutable std::recursive_mutex m_blockchain_lock; // TODO: add here reader/writer lock
+    // Held exclusively by anything that modifies the chain or reads state beyond the db (caches,
+    // alt chains, checkpoints, the scan tables, ...).  Accessors that only read the db
+    // (get_block_by_hash, get_outs, get_output_distribution, get_transactions*, get_tx_outputs_gindexs)
+    // don't take it: they hold a db_rtxn_guard instead so that they see one consistent, committed
+    // snapshot and can run concurrently with each other and with block addition.
+    mutable tools::instrumented_mutex<std::recursive_mutex> m_blockchain_lock{"blockchain"};
 
     // main chain
     size_t m_current_block_cumul_weight_limit;
     size_t m_current_block_cumul_weight_median;
 
+    // Cache of recently requested main chain blocks near the top of the chain, keyed by height, so
+    // that the same blocks requested by every syncing peer and wallet don't need to be re-read and
+    // re-parsed each time.  Blocks more than BLOCK_CACHE_SIZE below the top are never cached.
+    struct cached_block
+    {
+      crypto::hash hash;
+      cryptonote::blobdata blob;
+      block blk;
+    };
+    static constexpr size_t BLOCK_CACHE_SIZE = 1000;
+    mutable std::mutex m_block_cache_mutex;
+    mutable tools::lru_cache<uint64_t, std::shared_ptr<const cached_block>> m_block_cache{BLOCK_CACHE_SIZE};
+    // Incremented whenever cached blocks are invalidated so that a concurrent reader doesn't insert
+    // a block it loaded before the invalidation.
+    mutable uint64_t m_block_cache_generation = 0;
+
+    // Copy of the db output blacklist for get_output_blacklist.  The db blacklist only ever gains
+    // outputs newer (and so higher) than those already in it, so this is just topped up from the
+    // db, except after a pop: new outputs then reuse lower indexes, so it is reloaded.
+    mutable std::mutex m_output_blacklist_mutex;
+    mutable std::vector<uint64_t> m_output_blacklist;
+    mutable bool m_output_blacklist_reload = false;
+
+    // get_num_mature_outputs(0) as of top block m_mature_rct_outputs_top: the sanity check of each
+    // submitted tx needs it, and computing it looks up every output of the last few blocks.
+    mutable std::mutex m_mature_rct_outputs_mutex;
+    mutable crypto::hash m_mature_rct_outputs_top = crypto::null_hash;
+    mutable uint64_t m_mature_rct_outputs = 0;
+
+    // Cache of ring member outputs, keyed by (amount 0) global output index: the pool admitting a
+    // tx and then the block including it both look up the same, mostly recent, outputs.  Only used
+    // with the blockchain lock held; outputs created at or above a popped height are dropped.
+    static constexpr size_t OUTPUT_CACHE_SIZE = 65536;
+    mutable std::mutex m_output_cache_mutex;
+    mutable tools::lru_cache<uint64_t, output_data_t> m_output_cache{OUTPUT_CACHE_SIZE};
+
+    /**
+     * @brief gets the amount 0 outputs at the given global indices, using the output cache where
+     * possible
+     *
+     * @return false if any of the outputs doesn't exist
+     */
+    bool get_ring_outputs(const std::vector<uint64_t>& indices, std::vector<output_data_t>& outputs) const;
+
+    /**
+     * @brief drops outputs created at or above the given height from the output cache
+     */
+    void invalidate_output_cache(uint64_t from_height);
+
+    /**
+     * @brief gets the blob and parsed block at a main chain height, using the block cache if possible
+     *
+     * @return the cached block, or nullptr if the block does not exist or fails to parse
+     */
+    std::shared_ptr<const cached_block> get_cached_block(uint64_t height) const;
+
+    /**
+     * @brief removes cached blocks at or above the given height
+     */
+    void invalidate_block_cache(uint64_t from_height);
+
+    /**
+     * @brief returns the short chain history (see get_short_chain_history) for the current top
+     * block, rebuilding it only when the top block has changed
+     *
+     * The blockchain lock must be held and the returned reference is only valid while it is.
+     */
+    const std::vector<crypto::hash>& cached_short_chain_history() const;
+
+    // short chain history for the current top block (front() is the top block hash); guarded by
+    // the blockchain lock
+    mutable std::vector<crypto::hash> m_short_chain_history;
+    // number of leading entries of the short chain history that are consecutive heights counting
+    // down from the top block
+    static constexpr size_t SHORT_CHAIN_HISTORY_CONSECUTIVE = 11;
+
     // metadata containers
     std::unordered_map<crypto::hash, std::unordered_map<crypto::key_image, std::vector<output_data_t>>> m_scan_table;
+    // key images from the blocks being added that prepare_handle_incoming_blocks found to be unspent;
+    // entries are dropped as the blocks spending them are added.
+    std::unordered_set<crypto::key_image> m_scan_unspent_key_images;
+    // hashes of txes from the blocks being added whose ring signatures prepare_handle_incoming_blocks
+    // has already verified (against the rings in m_scan_table)
+    std::unordered_set<crypto::hash> m_scan_verified_rct_txs;
     std::unordered_map<crypto::hash, crypto::hash> m_blocks_longhash_table;
 
+    // The in-memory txpool store (see flush_txpool).  Modified only with the txpool lock held; the
+    // mutex protects readers that don't hold it.
+    struct txpool_store_entry
+    {
+      txpool_tx_meta_t meta;
+      cryptonote::blobdata blob;
+    };
+    mutable std::recursive_mutex m_txpool_store_mutex;
+    std::unordered_map<crypto::hash, txpool_store_entry> m_txpool_store;
+    // txids changed since the last flush, mapped to whether the blob has to be (re)written
+    std::unordered_map<crypto::hash, bool> m_txpool_dirty;
+    // the previous state of each entry changed in the current txpool transaction, if any
+    bool m_txpool_txn_active = false;
+    std::vector<std::pair<crypto::hash, std::optional<txpool_store_entry>>> m_txpool_undo;
+
+    void load_txpool_store();
+    void journal_txpool_tx(const crypto::hash &txid);
+
+    // Index of the db's alt blocks, which the db keys by hash only, so that alt chains can be
+    // followed and old alt blocks found without reading and parsing every alt block.  Loaded at
+    // init and kept in step with the db by add_alt_block and remove_alt_block; guarded by the
+    // blockchain lock.
+    struct alt_block_index_entry
+    {
+      uint64_t height;
+      crypto::hash prev_id;
+    };
+    std::unordered_map<crypto::hash, alt_block_index_entry> m_alt_blocks;
+    std::multimap<uint64_t, crypto::hash> m_alt_blocks_by_height;
+
+    void load_alt_block_index();
+    void add_alt_block(const crypto::hash &id, const alt_block_data_t &data, const block &b, const cryptonote::blobdata *checkpoint_blob);
+    void remove_alt_block(const crypto::hash &id);
+
+    /**
+     * @brief follows the alt chain ending in the given alt block back to where it forks off the
+     * main chain, using the alt block index
+     *
+     * @return the alt chain's block hashes, from `id` down to the first block after the fork
+     * point; empty if `id` is not an alt block
+     */
+    std::vector<crypto::hash> get_alt_chain_hashes(const crypto::hash &id) const;
+
+    // PoW hashes of alternative blocks, computed when they arrived (see precompute_alt_block_pow)
+    // and reused when the block is added to an alt chain and when we switch to that chain.  The
+    // seed hash is the RandomX seed block the PoW was computed against (null before RandomX).
+    struct alt_block_pow
+    {
+      crypto::hash seed_hash;
+      crypto::hash pow;
+    };
+    static constexpr size_t ALT_BLOCK_POW_CACHE_SIZE = 1024;
+    tools::lru_cache<crypto::hash, alt_block_pow> m_alt_block_pow{ALT_BLOCK_POW_CACHE_SIZE};
+
+    // Rings that preverify_tx_signatures verified incoming txes' signatures against, by txid.
+    static constexpr size_t PREVERIFIED_TX_CACHE_SIZE = 4096;
+    tools::lru_cache<crypto::hash, rct::ctkeyM> m_preverified_txs{PREVERIFIED_TX_CACHE_SIZE};
+    std::mutex m_preverified_txs_mutex;
+
     // Keccak hashes for each block and for fast pow checking
     std::vector<crypto::hash> m_blocks_hash_of_hashes;
     std::vector<crypto::hash> m_blocks_hash_check;
     std::vector<crypto::hash> m_blocks_txs_check;
+    std::vector<chunk_state_commitment> m_blocks_state_commitments;
+    bool m_record_state_commitments = false;
+    std::vector<chunk_state_commitment> m_recorded_state_commitments;
+    // What has been added so far of the chunk being synced; `tracked` is false if we didn't see
+    // the chunk from its first block (e.g. we restarted partway through it)
+    struct
+    {
+      bool tracked = false;
+      uint64_t outputs = 0;
+      std::vector<crypto::key_image> key_images;
+    } m_chunk_state;
 
     blockchain_db_sync_mode m_db_sync_mode;
     bool m_fast_sync;
@@ -1077,7 +1410,12 @@ namespace cryptonote
     bool m_db_default_sync;
     bool m_db_sync_on_blocks;
     uint64_t m_db_sync_threshold;
-    uint64_t m_max_prepare_blocks_threads;
+    uint64_t m_db_max_pending_syncs = 0;
+    uint64_t m_max_prepare_blocks_threads; // 0 = no limit beyond the threadpool size
+    double m_prepare_longhash_ms_per_block = 0; // smoothed cost of hashing one block in prepare_handle_incoming_blocks
+    static constexpr double PREPARE_MIN_MS_PER_THREAD = 50;
+    bool m_pow_cache_enabled = false;
+    uint64_t m_pow_cache_trust_depth = 0;
     uint64_t m_fake_pow_calc_time;
     uint64_t m_fake_scan_time;
     uint64_t m_sync_counter;
@@ -1085,7 +1423,20 @@ namespace cryptonote
 
     uint64_t m_long_term_block_weights_window;
     uint64_t m_long_term_effective_median_block_weight;
+
+    // The fee rates check_fee requires of txes going into the next block, and the hard fork version
+    // they are for.  They only change with the chain, so they are computed once per chain tip rather
+    // than once per tx; update_next_cumulative_weight_limit clears them.
+    struct next_block_fee_rules
+    {
+      uint64_t height;
+      uint8_t hf_version;
+      byte_and_output_fees fees;
+    };
+    mutable std::mutex m_fee_rules_mutex;
+    mutable std::optional<next_block_fee_rules> m_fee_rules;
     mutable crypto::hash m_long_term_block_weights_cache_tip_hash;
+    mutable uint64_t m_long_term_block_weights_cache_tip_height;
     mutable epee::misc_utils::rolling_median_t<uint64_t> m_long_term_block_weights_cache_rolling_median;
 
     // NOTE: PoW/Difficulty Cache
@@ -1111,6 +1462,19 @@ namespace cryptonote
     std::thread m_async_thread;
     std::unique_ptr<boost::asio::io_service::work> m_async_work_idle;
 
+    // db_async mode: syncs requested but not yet completed, and whether one is waiting to run (later
+    // requests are covered by it rather than queueing another)
+    std::mutex m_async_sync_mutex;
+    std::condition_variable m_async_sync_cv;
+    uint64_t m_pending_syncs = 0;
+    bool m_async_sync_queued = false;
+
+    /// Queues a store_blockchain() on m_async_service, unless one is already queued
+    void request_async_sync();
+
+    // callback gauges reading the db, dropped before it closes
+    std::vector<tools::metrics::registration> m_metrics;
+
     // some invalid blocks
     std::set<crypto::hash> m_invalid_blocks;
 
@@ -1128,14 +1492,19 @@ namespace cryptonote
 
     std::atomic<bool> m_cancel;
 
-    // block template cache
+    // block template cache, for either a miner (by address) or a Pulse block producer (by key)
     block m_btc;
+    bool m_btc_is_miner;
     account_public_address m_btc_address;
+    crypto::public_key m_btc_producer;
     blobdata m_btc_nonce;
     uint64_t m_btc_height;
     uint64_t m_btc_pool_cookie;
     uint64_t m_btc_expected_reward;
+    std::chrono::steady_clock::time_point m_btc_time;
     bool m_btc_valid;
+    // how long a cached template is reused after txs have been added to the pool
+    static constexpr auto BLOCK_TEMPLATE_MAX_STALENESS = std::chrono::seconds{5};
 
 
     bool m_batch_success;
@@ -1360,6 +1729,19 @@ namespace cryptonote
      */
     uint64_t get_long_term_block_weight_median(uint64_t start_height, size_t count) const;
 
+    /**
+     * @brief moves the long term block weight median cache back down the chain
+     *
+     * Rolls the newest blocks out of the cached (full) window, putting back the older blocks they
+     * had pushed out, so that popping a block doesn't force a reload of the whole window.  The
+     * cached window's blocks at or below `tip_height` must still be on the main chain.
+     *
+     * @param tip_height the height of the newest block to keep in the window
+     *
+     * @return true on success; false (with the cache invalidated) if the window can't be rolled back
+     */
+    bool rollback_long_term_block_weights_cache(uint64_t tip_height) const;
+
     /**
      * @brief checks if a transaction is unlocked (its outputs spendable)
      *
@@ -1449,6 +1831,14 @@ namespace cryptonote
      * @return true
      */
     bool update_next_cumulative_weight_limit(uint64_t *long_term_effective_median_block_weight = NULL);
+
+    /**
+     * @brief gets the fee rules for the next block, computing them if the chain has changed since
+     * they were last needed
+     *
+     * @return the rules, or nullopt if the base block reward can't be determined
+     */
+    std::optional<next_block_fee_rules> get_next_block_fee_rules() const;
     void return_tx_to_pool(std::vector<std::pair<transaction, blobdata>> &txs);
 
     /**
@@ -1461,6 +1851,13 @@ namespace cryptonote
      */
     bool check_for_double_spend(const transaction& tx, key_images_container& keys_this_block) const;
 
+    /**
+     * @brief check if a key image is already spent, using the results prefetched for the blocks
+     * currently being added (if any) before falling back to the database.  Must be called with
+     * the blockchain lock held.
+     */
+    bool have_tx_keyimg_as_spent_prefetched(const crypto::key_image &key_im) const;
+
     /**
      * @brief validates a transaction input's ring signature
      *
@@ -1484,6 +1881,20 @@ namespace cryptonote
      */
     void load_compiled_in_block_hashes(const GetCheckpointsCallback& get_checkpoints);
 
+    /**
+     * @brief adds a just-added main chain block to m_chunk_state, and at the end of a chunk checks
+     * it against (or records) the chunk's state commitment
+     *
+     * @return false if the completed chunk doesn't match its compiled-in commitment
+     */
+    bool update_chunk_state(const block& bl, const std::vector<std::pair<transaction, blobdata>>& txs, uint64_t height);
+
+    /**
+     * @brief stops trusting the compiled-in blocks data from the start of the given chunk on,
+     * popping the blocks of it that were added under that trust so that they get fully verified
+     */
+    void drop_compiled_in_blocks_from(uint64_t chunk);
+
     /**
      * @brief expands v2 transaction data from blockchain
      *
@@ -1503,6 +1914,6 @@ namespace cryptonote
      *
      * At some point, may be used to push an update to miners
      */
-    void cache_block_template(const block &b, const cryptonote::account_public_address &address, const blobdata &nonce, const difficulty_type &diff, uint64_t height, uint64_t expected_reward, uint64_t pool_cookie);
+    void cache_block_template(const block &b, const block_template_info &info, const blobdata &nonce, const difficulty_type &diff, uint64_t height, uint64_t expected_reward, uint64_t pool_cookie);
   };
 }  // namespace cryptonote
@@ -53,6 +53,7 @@ extern "C" {
 #include "common/file.h"
 #include "common/sha256sum.h"
 #include "common/threadpool.h"
+#include "common/trace.h"
 #include "common/command_line.h"
 #include "common/hex.h"
 #include "common/base58.h"
@@ -141,6 +142,11 @@ namespace cryptonote
   , "Set maximum size of block download queue in bytes (0 for default)"
   , 0
   };
+  const command_line::arg_descriptor<size_t> arg_protocol_threads  = {
+    "protocol-threads"
+  , "Number of threads handling p2p protocol messages (block and tx verification) off the network threads; 0 handles them on the network threads"
+  , 2
+  };
 
   static const command_line::arg_descriptor<bool> arg_test_drop_download = {
     "test-drop-download"
@@ -158,8 +164,8 @@ namespace cryptonote
   };
   static const command_line::arg_descriptor<uint64_t> arg_prep_blocks_threads = {
     "prep-blocks-threads"
-  , "Max number of threads to use when preparing block hashes in groups."
-  , 4
+  , "Max number of threads to use when preparing block hashes in groups (0 = choose automatically up to the number of available threads)."
+  , 0
   };
   static const command_line::arg_descriptor<uint64_t> arg_show_time_stats  = {
     "show-time-stats"
@@ -245,6 +251,22 @@ namespace cryptonote
   , "Keep alternative blocks on restart"
   , false
   };
+  static const command_line::arg_descriptor<bool> arg_block_pow_cache  = {
+    "block-pow-cache"
+  , "Keep the PoW hashes of verified blocks in the database so that re-adding a block (e.g. after a pop or reorg) does not recompute them."
+  , false
+  };
+  static const command_line::arg_descriptor<uint64_t> arg_block_pow_cache_depth  = {
+    "block-pow-cache-depth"
+  , "With --block-pow-cache, also use cached PoW hashes for blocks at least this many blocks below the chain tip (0 = only at or below the latest checkpoint)."
+  , 0
+  };
+
+  static const command_line::arg_descriptor<uint64_t> arg_db_sync_max_pending  = {
+    "db-sync-max-pending"
+  , "With an async --db-sync-mode, the number of database syncs that block processing may get ahead of before it waits for them (0 = no limit)."
+  , 8
+  };
 
   static const command_line::arg_descriptor<uint64_t> arg_store_quorum_history = {
     "store-quorum-history",
@@ -265,6 +287,7 @@ namespace cryptonote
   quorumnet_relay_obligation_votes_proc *quorumnet_relay_obligation_votes = [](void*, const std::vector<service_nodes::quorum_vote_t>&) { need_core_init("quorumnet_relay_obligation_votes"sv); };
   quorumnet_send_blink_proc *quorumnet_send_blink = [](core&, const std::string&) -> std::future<std::pair<blink_result, std::string>> { need_core_init("quorumnet_send_blink"sv); };
   quorumnet_pulse_relay_message_to_quorum_proc *quorumnet_pulse_relay_message_to_quorum = [](void *, pulse::message const &, service_nodes::quorum const &, bool) -> void { need_core_init("quorumnet_pulse_relay_message_to_quorum"sv); };
+  quorumnet_warm_peers_proc *quorumnet_warm_peers = [](void *, uint64_t) -> void { need_core_init("quorumnet_warm_peers"sv); };
 
   //-----------------------------------------------------------------------------------------------
   core::core()
@@ -272,9 +295,8 @@ namespace cryptonote
   , m_service_node_list(m_blockchain_storage)
   , m_blockchain_storage(m_mempool, m_service_node_list)
   , m_quorum_cop(*this)
-  , m_miner(this, [this](const cryptonote::block &b, uint64_t height, unsigned int threads, crypto::hash &hash) {
-    hash = cryptonote::get_block_longhash_w_blockchain(m_nettype, &m_blockchain_storage, b, height, threads);
-    return true;
+  , m_miner(this, [this](const cryptonote::block &b, uint64_t height, unsigned int threads) {
+    return cryptonote::make_block_hasher(m_nettype, &m_blockchain_storage, b, height, threads);
   })
   , m_pprotocol(&m_protocol_stub)
   , m_starter_message_showed(false)
@@ -343,6 +365,7 @@ namespace cryptonote
     command_line::add_arg(desc, arg_block_sync_size);
     command_line::add_arg(desc, arg_offline);
     command_line::add_arg(desc, arg_block_download_max_size);
+    command_line::add_arg(desc, arg_protocol_threads);
     command_line::add_arg(desc, arg_max_txpool_weight);
     command_line::add_arg(desc, arg_service_node);
     command_line::add_arg(desc, arg_public_ip);
@@ -357,6 +380,9 @@ namespace cryptonote
     command_line::add_arg(desc, arg_reorg_notify);
     command_line::add_arg(desc, arg_block_rate_notify);
     command_line::add_arg(desc, arg_keep_alt_blocks);
+    command_line::add_arg(desc, arg_block_pow_cache);
+    command_line::add_arg(desc, arg_block_pow_cache_depth);
+    command_line::add_arg(desc, arg_db_sync_max_pending);
 
     command_line::add_arg(desc, arg_store_quorum_history);
 #if defined(OXEN_ENABLE_INTEGRATION_TEST_HOOKS)
@@ -613,6 +639,7 @@ namespace cryptonote
 
     std::string db_sync_mode = command_line::get_arg(vm, cryptonote::arg_db_sync_mode);
     bool db_salvage = command_line::get_arg(vm, cryptonote::arg_db_salvage) != 0;
+    uint64_t db_map_size = command_line::get_arg(vm, cryptonote::arg_db_map_size);
     bool fast_sync = command_line::get_arg(vm, arg_fast_block_sync) != 0;
     uint64_t blocks_threads = command_line::get_arg(vm, arg_prep_blocks_threads);
     size_t max_txpool_weight = command_line::get_arg(vm, arg_max_txpool_weight);
@@ -749,6 +776,7 @@ namespace cryptonote
       if (db_salvage)
         db_flags |= DBF_SALVAGE;
 
+      db->set_map_size_hint(db_map_size << 20);
       db->open(folder, m_nettype, db_flags);
       if(!db->m_open)
         return false;
@@ -761,6 +789,9 @@ namespace cryptonote
 
     m_blockchain_storage.set_user_options(blocks_threads,
         sync_on_blocks, sync_threshold, sync_mode, fast_sync);
+    m_blockchain_storage.set_pow_cache(command_line::get_arg(vm, arg_block_pow_cache),
+        command_line::get_arg(vm, arg_block_pow_cache_depth));
+    m_blockchain_storage.set_max_pending_syncs(command_line::get_arg(vm, arg_db_sync_max_pending));
 
     try
     {
@@ -850,7 +881,7 @@ namespace cryptonote
     CHECK_AND_ASSERT_MES(r, false, "Failed to initialize miner instance");
 
     if (!keep_alt_blocks && !m_blockchain_storage.get_db().is_read_only())
-      m_blockchain_storage.get_db().drop_alt_blocks();
+      m_blockchain_storage.drop_alt_blocks();
 
     if (prune_blockchain)
     {
@@ -1092,7 +1123,7 @@ namespace cryptonote
       {
         m_pulse_thread_id = m_omq->add_tagged_thread("pulse");
         m_omq->add_timer([this]() { pulse::main(m_quorumnet_state, *this); },
-                         std::chrono::milliseconds(500),
+                         std::chrono::milliseconds(50),
                          false,
                          m_pulse_thread_id);
         m_omq->add_timer([this]() {this->check_service_node_time();},
@@ -1203,9 +1234,9 @@ namespace cryptonote
     return true;
   }
   //-----------------------------------------------------------------------------------------------
-  void core::parse_incoming_tx_accumulated_batch(std::vector<tx_verification_batch_info> &tx_info, bool kept_by_block)
+  void core::parse_incoming_tx_accumulated_batch(std::vector<tx_verification_batch_info> &tx_info, bool kept_by_block, uint64_t height)
   {
-    if (kept_by_block && get_blockchain_storage().is_within_compiled_block_hash_area())
+    if (kept_by_block && get_blockchain_storage().is_within_compiled_block_hash_area(height))
     {
       MTRACE("Skipping semantics check for txs kept by block in embedded hash area");
       return;
@@ -1301,6 +1332,7 @@ namespace cryptonote
   {
     // Caller needs to do this around both this *and* handle_parsed_txs
     //auto lock = incoming_tx_lock();
+    TRACE_SPAN(txpool, parse_incoming_txs);
     std::vector<tx_verification_batch_info> tx_info(tx_blobs.size());
 
     tools::threadpool& tpool = tools::threadpool::getInstance();
@@ -1321,6 +1353,15 @@ namespace cryptonote
     }
     waiter.wait(&tpool);
 
+    mark_already_have_txs(tx_info);
+
+    parse_incoming_tx_accumulated_batch(tx_info, opts.kept_by_block, m_blockchain_storage.get_current_blockchain_height());
+
+    return tx_info;
+  }
+  //-----------------------------------------------------------------------------------------------
+  void core::mark_already_have_txs(std::vector<tx_verification_batch_info> &tx_info)
+  {
     for (auto &info : tx_info) {
       if (!info.result)
         continue;
@@ -1336,23 +1377,74 @@ namespace cryptonote
         info.already_have = true;
       }
     }
+  }
+  //-----------------------------------------------------------------------------------------------
+  std::vector<std::vector<core::tx_verification_batch_info>> core::preparse_incoming_block_txs(const std::vector<block_complete_entry>& blocks, uint64_t start_height)
+  {
+    std::vector<std::vector<tx_verification_batch_info>> tx_info(blocks.size());
 
+    // Submit the txs of the whole span at once so that blocks with few txs don't leave the pool idle
+    tools::threadpool& tpool = tools::threadpool::getInstance();
+    tools::threadpool::waiter waiter;
+    for (size_t b = 0; b < blocks.size(); b++) {
+      const auto &tx_blobs = blocks[b].txs;
+      tx_info[b].resize(tx_blobs.size());
+      for (size_t i = 0; i < tx_blobs.size(); i++) {
+        tx_info[b][i].blob = &tx_blobs[i];
+        tpool.submit(&waiter, [this, &info = tx_info[b][i]] {
+          try
+          {
+            parse_incoming_tx_pre(info);
+          }
+          catch (const std::exception &e)
+          {
+            MERROR_VER("Exception in handle_incoming_tx_pre: " << e.what());
+            info.tvc.m_verifivation_failed = true;
+          }
+        });
+      }
+    }
+    waiter.wait(&tpool);
 
-    parse_incoming_tx_accumulated_batch(tx_info, opts.kept_by_block);
+    // `already_have` isn't known yet, so this checks every tx; handle_preparsed_txs() fills it in
+    // once the earlier blocks have been added.
+    for (size_t b = 0; b < blocks.size(); b++)
+      parse_incoming_tx_accumulated_batch(tx_info[b], true /*kept_by_block*/, start_height + b);
 
     return tx_info;
   }
+  //-----------------------------------------------------------------------------------------------
+  bool core::handle_preparsed_txs(std::vector<tx_verification_batch_info> &parsed_txs, const tx_pool_options &opts)
+  {
+    auto lock = incoming_tx_lock();
+    mark_already_have_txs(parsed_txs);
+    return handle_parsed_txs(parsed_txs, opts);
+  }
 
   bool core::handle_parsed_txs(std::vector<tx_verification_batch_info> &parsed_txs, const tx_pool_options &opts,
       uint64_t *blink_rollback_height)
   {
     // Caller needs to do this around both this *and* parse_incoming_txs
     //auto lock = incoming_tx_lock();
+    TRACE_SPAN(txpool, handle_parsed_txs);
     uint8_t version      = m_blockchain_storage.get_network_version();
     bool ok              = true;
     bool tx_pool_changed = false;
     if (blink_rollback_height)
       *blink_rollback_height = 0;
+
+    // Check the signatures of new (i.e. not block-relayed) txes in parallel up front, without the
+    // pool or blockchain locks; add_tx below then only has to do the cheap checks for each tx.
+    if (!opts.kept_by_block)
+    {
+      std::vector<std::pair<const transaction*, crypto::hash>> verify;
+      for (const auto &info : parsed_txs)
+        if (info.result && !info.already_have)
+          verify.emplace_back(&info.tx, info.tx_hash);
+      if (verify.size() > 1)
+        m_blockchain_storage.preverify_tx_signatures(verify);
+    }
+
     tx_pool_options tx_opts;
     for (size_t i = 0; i < parsed_txs.size(); i++) {
       auto &info = parsed_txs[i];
@@ -1718,11 +1810,7 @@ namespace cryptonote
   //-----------------------------------------------------------------------------------------------
   bool core::are_key_images_spent(const std::vector<crypto::key_image>& key_im, std::vector<bool> &spent) const
   {
-    spent.clear();
-    for(auto& ki: key_im)
-    {
-      spent.push_back(m_blockchain_storage.have_tx_keyimg_as_spent(ki));
-    }
+    m_blockchain_storage.have_tx_keyimgs_as_spent(epee::to_span(key_im), spent);
     return true;
   }
   //-----------------------------------------------------------------------------------------------
@@ -1740,83 +1828,29 @@ namespace cryptonote
     return m_mempool.check_for_key_images(key_im, spent);
   }
   //-----------------------------------------------------------------------------------------------
-  std::optional<std::tuple<uint64_t, uint64_t, uint64_t>> core::get_coinbase_tx_sum(uint64_t start_offset, size_t count)
+  std::tuple<uint64_t, uint64_t, uint64_t> core::get_coinbase_tx_sum(uint64_t start_offset, size_t count)
   {
     std::tuple<uint64_t, uint64_t, uint64_t> result{0, 0, 0};
-    if (count == 0)
+    auto& db = m_blockchain_storage.get_db();
+    db_rtxn_guard rtxn_guard{db};
+    const uint64_t height = db.height();
+    if (start_offset >= height || count == 0)
       return result;
+    const uint64_t end = start_offset + std::min<uint64_t>(count, height - start_offset) - 1;
 
     auto& [emission_amount, total_fee_amount, burnt_oxen] = result;
-
-    // Caching.
-    //
-    // Requesting this value from the beginning of the chain is very slow, so we cache it.  That
-    // still means the first request will be slow, but that's okay.  To prevent a bunch of threads
-    // getting backed up trying to calculate this, we lock out more than one thread building the
-    // cache at a time if we're requesting a large number of block values at once.  Any other thread
-    // requesting will get a nullopt back.
-
-    constexpr uint64_t CACHE_LAG = 30; // We cache the values up to this many blocks ago; we lag so that we don't have to worry about small reorgs
-    constexpr uint64_t CACHE_EXCLUSIVE = 1000; // If we need to load more than this, we block out other threads
-
-    // Check if we have a cacheable from-the-beginning result
-    uint64_t cache_to = 0;
-    std::chrono::steady_clock::time_point cache_build_started;
-    if (start_offset == 0) {
-      uint64_t height = m_blockchain_storage.get_current_blockchain_height();
-      if (count > height) count = height;
-      cache_to = height - std::min(CACHE_LAG, height);
-      {
-        std::shared_lock lock{m_coinbase_cache.mutex};
-        if (m_coinbase_cache.height && count >= m_coinbase_cache.height) {
-          emission_amount = m_coinbase_cache.emissions;
-          total_fee_amount = m_coinbase_cache.fees;
-          burnt_oxen = m_coinbase_cache.burnt;
-          start_offset = m_coinbase_cache.height + 1;
-          count -= m_coinbase_cache.height;
-        }
-        // else don't change anything; we need a subset of blocks that ends before the cache.
-
-        if (cache_to <= m_coinbase_cache.height)
-          cache_to = 0; // Cache doesn't need updating
-      }
-
-      // If we're loading a lot then acquire an exclusive lock, recheck our variables, and block out
-      // other threads until we're done.  (We don't do this if we're only loading a few because even
-      // if we have some competing cache updates they don't hurt anything).
-      if (cache_to > 0 && count > CACHE_EXCLUSIVE) {
-        std::unique_lock lock{m_coinbase_cache.mutex};
-        if (m_coinbase_cache.building)
-          return std::nullopt; // Another thread is already updating the cache
-
-        if (m_coinbase_cache.height && m_coinbase_cache.height >= start_offset) {
-          // Someone else updated the cache while we were acquiring the unique lock, so update our variables
-          if (m_coinbase_cache.height >= start_offset + count) {
-            // The cache is now *beyond* us, which means we can't use it, so reset start/count back
-            // to what they were originally.
-            count += start_offset - 1;
-            start_offset = 0;
-            cache_to = 0;
-          } else {
-            // The cache is updated and we can still use it, so update our variables.
-            emission_amount = m_coinbase_cache.emissions;
-            total_fee_amount = m_coinbase_cache.fees;
-            burnt_oxen = m_coinbase_cache.burnt;
-            count -= m_coinbase_cache.height - start_offset + 1;
-            start_offset = m_coinbase_cache.height + 1;
-          }
-        }
-        if (cache_to > 0 && count > CACHE_EXCLUSIVE) {
-          cache_build_started = std::chrono::steady_clock::now();
-          m_coinbase_cache.building = true; // Block out other threads until we're done
-          MINFO("Starting slow cache build request for get_coinbase_tx_sum(" << start_offset << ", " << count << ")");
-        }
-      }
+    block_coinbase_sums last, before{};
+    if (db.get_coinbase_sums(end, last) && (start_offset == 0 || db.get_coinbase_sums(start_offset - 1, before)))
+    {
+      emission_amount = last.emission - before.emission;
+      total_fee_amount = last.fees - before.fees;
+      burnt_oxen = last.burned - before.burned;
+      return result;
     }
 
-    const uint64_t end = start_offset + count - 1;
+    // The db doesn't keep the totals, so add up the blocks themselves
     m_blockchain_storage.for_blocks_range(start_offset, end,
-      [this, &cache_to, &result, &cache_build_started](uint64_t height, const crypto::hash& hash, const block& b){
+      [this, &result](uint64_t height, const crypto::hash& hash, const block& b){
       auto& [emission_amount, total_fee_amount, burnt_oxen] = result;
       std::vector<transaction> txs;
       std::vector<crypto::hash> missed_txs;
@@ -1834,24 +1868,6 @@ namespace cryptonote
 
       emission_amount += coinbase_amount - tx_fee_amount;
       total_fee_amount += tx_fee_amount;
-      if (cache_to && cache_to == height)
-      {
-        std::unique_lock lock{m_coinbase_cache.mutex};
-        if (m_coinbase_cache.height < height)
-        {
-          m_coinbase_cache.height = height;
-          m_coinbase_cache.emissions = emission_amount;
-          m_coinbase_cache.fees = total_fee_amount;
-          m_coinbase_cache.burnt = burnt_oxen;
-        }
-        if (m_coinbase_cache.building)
-        {
-          m_coinbase_cache.building = false;
-          MINFO("Finishing cache build for get_coinbase_tx_sum in " <<
-              std::chrono::duration<double>{std::chrono::steady_clock::now() - cache_build_started}.count() << "s");
-        }
-        cache_to = 0;
-      }
       return true;
     });
 
@@ -1888,14 +1904,16 @@ namespace cryptonote
   //-----------------------------------------------------------------------------------------------
   bool core::check_tx_inputs_keyimages_domain(const transaction& tx) const
   {
-    std::unordered_set<crypto::key_image> ki;
+    std::vector<crypto::key_image> key_images;
+    key_images.reserve(tx.vin.size());
     for(const auto& in: tx.vin)
     {
       CHECKED_GET_SPECIFIC_VARIANT(in, txin_to_key, tokey_in, false);
-      if (!(rct::scalarmultKey(rct::ki2rct(tokey_in.k_image), rct::curveOrder()) == rct::identity()))
-        return false;
+      key_images.push_back(tokey_in.k_image);
     }
-    return true;
+    std::unique_ptr<bool[]> in_domain{new bool[key_images.size()]};
+    crypto::check_key_images_domain(key_images.data(), key_images.size(), in_domain.get());
+    return std::all_of(in_domain.get(), in_domain.get() + key_images.size(), [](bool b) { return b; });
   }
   //-----------------------------------------------------------------------------------------------
   size_t core::get_blockchain_total_transactions() const
@@ -2049,9 +2067,9 @@ namespace cryptonote
     return m_blockchain_storage.get_output_distribution(amount, from_height, to_height, start_height, distribution, base);
   }
   //-----------------------------------------------------------------------------------------------
-  void core::get_output_blacklist(std::vector<uint64_t> &blacklist) const
+  uint64_t core::get_output_blacklist(std::vector<uint64_t> &blacklist, std::optional<uint64_t> after) const
   {
-    m_blockchain_storage.get_output_blacklist(blacklist);
+    return m_blockchain_storage.get_output_blacklist(blacklist, after);
   }
   //-----------------------------------------------------------------------------------------------
   bool core::get_tx_outputs_gindexs(const crypto::hash& tx_id, std::vector<uint64_t>& indexs) const
@@ -2074,15 +2092,21 @@ namespace cryptonote
     m_miner.resume();
   }
   //-----------------------------------------------------------------------------------------------
-  block_complete_entry get_block_complete_entry(block& b, tx_memory_pool &pool)
+  // Also collects, into `fresh_txs`, the blobs of txes that arrived in the pool too recently for
+  // peers to be likely to have them yet; those get sent along with the block when we relay it.
+  block_complete_entry get_block_complete_entry(block& b, tx_memory_pool &pool, std::vector<blobdata>& fresh_txs)
   {
     block_complete_entry bce = {};
     bce.block                = cryptonote::block_to_blob(b);
+    const time_t fresh_since = time(nullptr) - std::chrono::seconds{config::FLUFFY_BLOCK_PREFILL_TX_AGE}.count();
     for (const auto &tx_hash: b.tx_hashes)
     {
       cryptonote::blobdata txblob;
-      CHECK_AND_ASSERT_THROW_MES(pool.get_transaction(tx_hash, txblob), "Transaction not found in pool");
-      bce.txs.push_back(txblob);
+      txpool_tx_meta_t meta;
+      CHECK_AND_ASSERT_THROW_MES(pool.get_transaction(tx_hash, txblob, &meta), "Transaction not found in pool");
+      if (static_cast<time_t>(meta.receive_time) >= fresh_since)
+        fresh_txs.push_back(txblob);
+      bce.txs.push_back(std::move(txblob));
     }
     return bce;
   }
@@ -2091,12 +2115,13 @@ namespace cryptonote
   {
     bvc = {};
     std::vector<block_complete_entry> blocks;
+    std::vector<blobdata> fresh_txs;
     m_miner.pause();
     {
       OXEN_DEFER { m_miner.resume(); };
       try
       {
-        blocks.push_back(get_block_complete_entry(b, m_mempool));
+        blocks.push_back(get_block_complete_entry(b, m_mempool, fresh_txs));
       }
       catch (const std::exception &e)
       {
@@ -2135,7 +2160,8 @@ namespace cryptonote
       cryptonote_connection_context exclude_context{};
       NOTIFY_NEW_FLUFFY_BLOCK::request arg{};
       arg.current_blockchain_height                 = m_blockchain_storage.get_current_blockchain_height();
-      arg.b                                         = blocks[0];
+      arg.b.block                                   = std::move(blocks[0].block);
+      arg.b.txs                                     = std::move(fresh_txs);
 
       m_pprotocol->relay_block(arg, exclude_context);
     }
@@ -2245,6 +2271,19 @@ namespace cryptonote
     m_omq->set_active_sns(std::move(active_sns));
   }
   //-----------------------------------------------------------------------------------------------
+  void core::wake_pulse()
+  {
+    if (m_pulse_thread_id)
+      m_omq->job([this]() { pulse::wake(m_quorumnet_state, *this); }, *m_pulse_thread_id);
+  }
+  //-----------------------------------------------------------------------------------------------
+  void core::warm_quorumnet_peers(uint64_t height)
+  {
+    // Not while syncing: by the time we catch up these quorums will long be over
+    if (m_quorumnet_state && height >= get_target_blockchain_height())
+      m_omq->job([this, height]() { quorumnet_warm_peers(m_quorumnet_state, height); });
+  }
+  //-----------------------------------------------------------------------------------------------
   crypto::hash core::get_tail_id() const
   {
     return m_blockchain_storage.get_tail_id();
@@ -2394,6 +2433,9 @@ namespace cryptonote
     m_check_disk_space_interval.do_call([this] { return check_disk_space(); });
     m_block_rate_interval.do_call([this] { return check_block_rate(); });
     m_sn_proof_cleanup_interval.do_call([&snl=m_service_node_list] { snl.cleanup_proofs(); return true; });
+    m_sn_proof_flush_interval.do_call([&snl=m_service_node_list] { snl.flush_proofs(); return true; });
+    m_txpool_flush_interval.do_call([this] { m_blockchain_storage.flush_txpool(); return true; });
+    m_alt_block_prune_interval.do_call([this] { m_blockchain_storage.prune_alt_blocks(); return true; });
 
     std::chrono::seconds lifetime{time(nullptr) - get_start_time()};
     if (m_service_node && lifetime > get_net_config().UPTIME_PROOF_STARTUP_DELAY) // Give us some time to connect to peers before sending uptimes
@@ -2541,6 +2583,11 @@ namespace cryptonote
     return get_blockchain_storage().prevalidate_block_hashes(height, hashes);
   }
   //-----------------------------------------------------------------------------------------------
+  std::optional<uint64_t> core::find_checkpoint_conflict(uint64_t height, const std::vector<crypto::hash> &hashes) const
+  {
+    return get_blockchain_storage().find_checkpoint_conflict(height, hashes);
+  }
+  //-----------------------------------------------------------------------------------------------
   uint64_t core::get_free_space() const
   {
     return fs::space(m_config_folder).available;
@@ -2571,6 +2618,11 @@ namespace cryptonote
     return m_quorum_cop.handle_vote(vote, vvc);
   }
   //-----------------------------------------------------------------------------------------------
+  bool core::add_service_node_votes(const std::vector<service_nodes::quorum_vote_t>& votes, std::vector<vote_verification_context> &vvcs)
+  {
+    return m_quorum_cop.handle_votes(votes, vvcs);
+  }
+  //-----------------------------------------------------------------------------------------------
   uint32_t core::get_blockchain_pruning_seed() const
   {
     return get_blockchain_storage().get_blockchain_pruning_seed();
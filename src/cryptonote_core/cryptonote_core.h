@@ -73,6 +73,7 @@ namespace cryptonote
   extern const command_line::arg_descriptor<bool> arg_dev_allow_local;
   extern const command_line::arg_descriptor<bool> arg_offline;
   extern const command_line::arg_descriptor<size_t> arg_block_download_max_size;
+  extern const command_line::arg_descriptor<size_t> arg_protocol_threads;
 
   // Function pointers that are set to throwing stubs and get replaced by the actual functions in
   // cryptonote_protocol/quorumnet.cpp's quorumnet::init_core_callbacks().  This indirection is here
@@ -99,6 +100,10 @@ namespace cryptonote
   // Relay a Pulse message to members specified in the quorum excluding the originating message owner.
   using quorumnet_pulse_relay_message_to_quorum_proc = void (void *, pulse::message const &msg, service_nodes::quorum const &quorum, bool block_producer);
 
+  // Opens (or keeps open) connections to the peers we will relay to in the quorums coming up after
+  // the given chain height.
+  using quorumnet_warm_peers_proc = void (void *self, uint64_t height);
+
   // Function pointer that we invoke when the mempool has changed; this gets set during
   // rpc/http_server.cpp's init_options().
   extern void (*long_poll_trigger)(tx_memory_pool& pool);
@@ -110,6 +115,7 @@ namespace cryptonote
   extern quorumnet_send_blink_proc *quorumnet_send_blink;
 
   extern quorumnet_pulse_relay_message_to_quorum_proc *quorumnet_pulse_relay_message_to_quorum;
+  extern quorumnet_warm_peers_proc *quorumnet_warm_peers;
 
   /************************************************************************/
   /*                                                                      */
@@ -261,6 +267,33 @@ namespace cryptonote
       */
      std::vector<tx_verification_batch_info> handle_incoming_txs(const std::vector<blobdata>& tx_blobs, const tx_pool_options &opts);
 
+     /**
+      * @brief parses the transactions of a span of not-yet-added blocks
+      *
+      * Performs the chain-state independent part of parse_incoming_txs() (deserialization,
+      * hashing and the semantic/bulletproof batch checks) for the txs of each of the given blocks,
+      * the first of which is at height `start_height`.  This does *not* require
+      * m_incoming_tx_lock and does not determine `already_have`, so that it can run on another
+      * thread while earlier blocks are still being added; the results must be passed (one block
+      * at a time, in order) to handle_preparsed_txs().
+      *
+      * The blobs of `blocks` are referenced by the returned values and must outlive them, as with
+      * parse_incoming_txs().
+      *
+      * @return one vector of tx_verification_batch_info per block in `blocks`
+      */
+     std::vector<std::vector<tx_verification_batch_info>> preparse_incoming_block_txs(const std::vector<block_complete_entry>& blocks, uint64_t start_height);
+
+     /**
+      * @brief handles transactions parsed by preparse_incoming_block_txs()
+      *
+      * Takes the incoming tx lock, marks the txs that we already have and then inserts the rest as
+      * per handle_parsed_txs().
+      *
+      * @return false if any transactions failed verification, true otherwise.
+      */
+     bool handle_preparsed_txs(std::vector<tx_verification_batch_info> &parsed_txs, const tx_pool_options &opts);
+
      /**
       * @brief parses and filters received blink transaction signatures
       *
@@ -353,6 +386,14 @@ namespace cryptonote
      /// active SNs.
      void update_omq_sns();
 
+     /// Called (from service_node_quorum_cop) when a block is added to have the Pulse thread, if we
+     /// are running one, act on the new block right away.
+     void wake_pulse();
+
+     /// Called (from service_node_quorum_cop) when a block is added to have quorumnet connect ahead
+     /// of time to the quorum peers we are about to relay to.  Does nothing if not a service node.
+     void warm_quorumnet_peers(uint64_t height);
+
      /**
       * @brief get the cryptonote protocol instance
       *
@@ -658,7 +699,8 @@ namespace cryptonote
       */
      bool get_output_distribution(uint64_t amount, uint64_t from_height, uint64_t to_height, uint64_t &start_height, std::vector<uint64_t> &distribution, uint64_t &base) const;
 
-     void get_output_blacklist(std::vector<uint64_t> &blacklist) const;
+     /// Returns the total number of blacklisted outputs; see Blockchain::get_output_blacklist
+     uint64_t get_output_blacklist(std::vector<uint64_t> &blacklist, std::optional<uint64_t> after = std::nullopt) const;
 
      /**
       * @copydoc miner::pause
@@ -805,17 +847,12 @@ namespace cryptonote
       * @param start_offset the height to start counting from
       * @param count the number of blocks to include
       *
-      * When requesting from the beginning of the chain (i.e. with `start_offset=0` and count >=
-      * current height) the first thread to call this will take a very long time; during this
-      * initial calculation any other threads that attempt to make a similar request will fail
-      * immediately (getting back std::nullopt) until the first thread to calculate it has finished,
-      * after which we use the cached value and only calculate for the last few blocks.
+      * The db keeps running totals of these, so any range is two lookups; only a db without them
+      * falls back to adding up every block in the range.
       *
-      * @return optional tuple of: coin emissions, total fees, and total burned coins in the
-      * requested range.  The optional value will be empty only if requesting the full chain *and*
-      * another thread is already calculating it.
+      * @return tuple of: coin emissions, total fees, and total burned coins in the requested range
       */
-     std::optional<std::tuple<uint64_t, uint64_t, uint64_t>> get_coinbase_tx_sum(uint64_t start_offset, size_t count);
+     std::tuple<uint64_t, uint64_t, uint64_t> get_coinbase_tx_sum(uint64_t start_offset, size_t count);
 
      /**
       * @brief get the network type we're on
@@ -843,6 +880,13 @@ namespace cryptonote
       */
      uint64_t prevalidate_block_hashes(uint64_t height, const std::vector<crypto::hash> &hashes);
 
+     /**
+      * @brief check a set of consecutive block hashes against our checkpoints
+      *
+      * @return the height of the first hash that conflicts with a checkpoint, if any
+      */
+     std::optional<uint64_t> find_checkpoint_conflict(uint64_t height, const std::vector<crypto::hash> &hashes) const;
+
      /**
       * @brief get free disk space on the blockchain partition
       *
@@ -902,6 +946,16 @@ namespace cryptonote
       */
      bool add_service_node_vote(const service_nodes::quorum_vote_t& vote, vote_verification_context &vvc);
 
+     /**
+      * @brief Add a bundle of service node votes, looking up each quorum they are for once
+      *
+      * @param votes the votes to add
+      * @param vvcs set to the verification result of each of `votes`
+      *
+      * @return false if any of the votes failed
+      */
+     bool add_service_node_votes(const std::vector<service_nodes::quorum_vote_t>& votes, std::vector<vote_verification_context> &vvcs);
+
      using service_keys = service_nodes::service_node_keys;
 
      /**
@@ -1041,7 +1095,8 @@ namespace cryptonote
      void set_semantics_failed(const crypto::hash &tx_hash);
 
      void parse_incoming_tx_pre(tx_verification_batch_info &tx_info);
-     void parse_incoming_tx_accumulated_batch(std::vector<tx_verification_batch_info> &tx_info, bool kept_by_block);
+     void parse_incoming_tx_accumulated_batch(std::vector<tx_verification_batch_info> &tx_info, bool kept_by_block, uint64_t height);
+     void mark_already_have_txs(std::vector<tx_verification_batch_info> &tx_info);
 
      /**
       * @brief act on a set of command line options given
@@ -1183,7 +1238,10 @@ namespace cryptonote
      tools::periodic_task m_blockchain_pruning_interval{5h}; //!< interval for incremental blockchain pruning
      tools::periodic_task m_service_node_vote_relayer{2min, false};
      tools::periodic_task m_sn_proof_cleanup_interval{1h, false};
+     tools::periodic_task m_sn_proof_flush_interval{30s}; //!< interval for writing updated service node proofs to the db
      tools::periodic_task m_systemd_notify_interval{10s};
+     tools::periodic_task m_txpool_flush_interval{30s}; //!< interval for writing txpool changes to the db
+     tools::periodic_task m_alt_block_prune_interval{5min}; //!< interval for dropping alt blocks too far below the chain top
 
      std::atomic<bool> m_starter_message_showed; //!< has the "daemon will sync now" message been shown?
 
@@ -1226,12 +1284,6 @@ namespace cryptonote
 
      std::shared_ptr<tools::Notify> m_block_rate_notify;
 
-     struct {
-       std::shared_mutex mutex;
-       bool building = false;
-       uint64_t height = 0, emissions = 0, fees = 0, burnt = 0;
-     } m_coinbase_cache;
-
      std::optional<oxenmq::TaggedThreadID> m_pulse_thread_id;
    };
 }
@@ -1088,50 +1088,96 @@ namespace cryptonote
     }
   }
 
+  std::optional<crypto::cn_slow_hash_type> get_block_cn_slow_hash_type(cryptonote::network_type nettype, uint8_t hf_version)
+  {
+    if (nettype == FAKECHAIN)
+      return cn_slow_hash_type::turtle_lite_v2;
+    if (hf_version >= network_version_12_checkpointing)
+      return std::nullopt;
+    if (hf_version >= network_version_11_infinite_staking)
+      return cn_slow_hash_type::turtle_lite_v2;
+    if (hf_version >= network_version_7)
+      return cn_slow_hash_type::heavy_v2;
+    return cn_slow_hash_type::heavy_v1;
+  }
+
   crypto::hash get_block_longhash(cryptonote::network_type nettype, randomx_longhash_context const &randomx_context, const block& b, uint64_t height, int miners)
   {
     crypto::hash result      = {};
     const blobdata bd        = get_block_hashing_blob(b);
-    const uint8_t hf_version = b.major_version;
 
 #if defined(OXEN_INTEGRATION_TESTS)
     miners = 0;
 #endif
 
-    crypto::cn_slow_hash_type cn_type = cn_slow_hash_type::heavy_v1;
-    if (nettype == FAKECHAIN)
+    if (auto cn_type = get_block_cn_slow_hash_type(nettype, b.major_version))
     {
-      cn_type = cn_slow_hash_type::turtle_lite_v2;
+      crypto::cn_slow_hash(bd.data(), bd.size(), result, *cn_type);
+      return result;
     }
-    else
+
+    rx_slow_hash(randomx_context.current_blockchain_height,
+                 randomx_context.seed_height,
+                 randomx_context.seed_block_hash.data,
+                 bd.data(),
+                 bd.size(),
+                 result.data,
+                 miners,
+                 0);
+    return result;
+  }
+
+  crypto::hash get_block_longhash_w_blockchain(cryptonote::network_type nettype, const Blockchain *pbc, const block& b, uint64_t height, int miners)
+  {
+    crypto::hash result = get_block_longhash(nettype,randomx_longhash_context(pbc, b, height), b, height, miners);
+    return result;
+  }
+
+  namespace
+  {
+    struct cn_block_hasher final : block_hasher
     {
-      if (hf_version >= network_version_12_checkpointing)
+      crypto::cn_slow_hash_type type;
+      blobdata blob;
+      explicit cn_block_hasher(crypto::cn_slow_hash_type type) : type{type} {}
+
+      void start(const blobdata& first) override { blob = first; }
+      crypto::hash next(const blobdata& next_blob) override
       {
-        rx_slow_hash(randomx_context.current_blockchain_height,
-                     randomx_context.seed_height,
-                     randomx_context.seed_block_hash.data,
-                     bd.data(),
-                     bd.size(),
-                     result.data,
-                     miners,
-                     0);
+        crypto::hash result;
+        crypto::cn_slow_hash(blob.data(), blob.size(), result, type);
+        blob = next_blob;
         return result;
       }
+    };
 
-      if (hf_version >= network_version_11_infinite_staking)
-        cn_type = cn_slow_hash_type::turtle_lite_v2;
-      else if (hf_version >= network_version_7)
-        cn_type = crypto::cn_slow_hash_type::heavy_v2;
-    }
+    struct rx_block_hasher final : block_hasher
+    {
+      randomx_longhash_context ctx;
+      int miners;
+      rx_block_hasher(randomx_longhash_context ctx, int miners) : ctx{std::move(ctx)}, miners{miners} {}
 
-    crypto::cn_slow_hash(bd.data(), bd.size(), result, cn_type);
-    return result;
+      void start(const blobdata& first) override
+      {
+        rx_slow_hash_first(ctx.current_blockchain_height, ctx.seed_height, ctx.seed_block_hash.data, first.data(), first.size(), miners);
+      }
+      crypto::hash next(const blobdata& next_blob) override
+      {
+        crypto::hash result;
+        rx_slow_hash_next(next_blob.data(), next_blob.size(), result.data);
+        return result;
+      }
+    };
   }
 
-  crypto::hash get_block_longhash_w_blockchain(cryptonote::network_type nettype, const Blockchain *pbc, const block& b, uint64_t height, int miners)
+  std::unique_ptr<block_hasher> make_block_hasher(cryptonote::network_type nettype, const Blockchain *pbc, const block& b, uint64_t height, int miners)
   {
-    crypto::hash result = get_block_longhash(nettype,randomx_longhash_context(pbc, b, height), b, height, miners);
-    return result;
+#if defined(OXEN_INTEGRATION_TESTS)
+    miners = 0;
+#endif
+    if (auto cn_type = get_block_cn_slow_hash_type(nettype, b.major_version))
+      return std::make_unique<cn_block_hasher>(*cn_type);
+    return std::make_unique<rx_block_hasher>(randomx_longhash_context(pbc, b, height), miners);
   }
 
   void get_block_longhash_reorg(const uint64_t split_height)
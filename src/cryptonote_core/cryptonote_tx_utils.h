@@ -253,9 +253,15 @@ namespace cryptonote
   };
 
   class Blockchain;
+  // The CryptoNight variant get_block_longhash uses for blocks of the given version, or nullopt if it
+  // uses RandomX
+  std::optional<crypto::cn_slow_hash_type> get_block_cn_slow_hash_type(cryptonote::network_type nettype, uint8_t hf_version);
   crypto::hash get_block_longhash(cryptonote::network_type nettype, randomx_longhash_context const &randomx_context, const block& b, uint64_t height, int miners);
   crypto::hash get_altblock_longhash(cryptonote::network_type nettype, randomx_longhash_context const &randomx_context, const block& b, uint64_t height);
   crypto::hash get_block_longhash_w_blockchain(cryptonote::network_type nettype, const Blockchain *pb, const block& b, uint64_t height, int miners);
+  // A miner's hasher for nonces of block template b; the RandomX one pipelines successive hashes.
+  struct block_hasher;
+  std::unique_ptr<block_hasher> make_block_hasher(cryptonote::network_type nettype, const Blockchain *pb, const block& b, uint64_t height, int miners);
   void get_block_longhash_reorg(const uint64_t split_height);
 
 }
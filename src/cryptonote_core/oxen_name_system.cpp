@@ -1,13 +1,16 @@
 #include <bitset>
 #include <variant>
 #include <iterator>
+#include <set>
 #include <vector>
 #include <algorithm>
+#include <unordered_map>
 #include "common/hex.h"
 #include "oxen_name_system.h"
 
 #include "common/oxen.h"
 #include "common/string_util.h"
+#include "common/metrics.h"
 #include "crypto/hash.h"
 #include "cryptonote_basic/cryptonote_basic.h"
 #include "cryptonote_basic/cryptonote_basic_impl.h"
@@ -532,9 +535,9 @@ bool sql_compiled_statement::compile(std::string_view query, bool optimise_for_m
 {
   sqlite3_stmt* st;
 #if SQLITE_VERSION_NUMBER >= 3020000
-  int prepare_result = sqlite3_prepare_v3(nsdb.db, query.data(), query.size(), optimise_for_multiple_usage ? SQLITE_PREPARE_PERSISTENT : 0, &st, nullptr /*pzTail*/);
+  int prepare_result = sqlite3_prepare_v3(conn ? conn : nsdb.db, query.data(), query.size(), optimise_for_multiple_usage ? SQLITE_PREPARE_PERSISTENT : 0, &st, nullptr /*pzTail*/);
 #else
-  int prepare_result = sqlite3_prepare_v2(nsdb.db, query.data(), query.size(), &st, nullptr /*pzTail*/);
+  int prepare_result = sqlite3_prepare_v2(conn ? conn : nsdb.db, query.data(), query.size(), &st, nullptr /*pzTail*/);
 #endif
 
   if (prepare_result != SQLITE_OK) {
@@ -1649,9 +1652,11 @@ COMMIT TRANSACTION;
   }
 
   // Updates to add columns; we ignore errors on these since they will fail if the column already
-  // exists
+  // exists.  The update_height index (which lets a detach find the detached blocks' rows without a
+  // table scan) comes after the mappings migration, since older tables lack the column.
   for (const auto& upgrade : {
     "ALTER TABLE settings ADD COLUMN pruned_height INTEGER NOT NULL DEFAULT 0",
+    "CREATE INDEX IF NOT EXISTS mapping_update_height ON mappings (update_height)",
   }) {
     sqlite3_exec(ons_db.db, upgrade, nullptr /*callback*/, nullptr /*callback ctx*/, nullptr /*errstr*/);
   }
@@ -1722,6 +1727,7 @@ scoped_db_transaction::~scoped_db_transaction()
 
 enum struct db_version { v0, v1_track_updates, v2_full_rows };
 auto constexpr DB_VERSION = db_version::v2_full_rows;
+uint64_t constexpr BULK_LOAD_COMMIT_BLOCKS = 1000;
 
 constexpr auto EXPIRATION = " (expiration_height IS NULL OR expiration_height >= ?) "sv;
 
@@ -1732,6 +1738,8 @@ bool name_system_db::init(cryptonote::Blockchain const *blockchain, cryptonote::
   if (!db) return false;
   this->db      = db;
   this->nettype = nettype;
+  if (const char *path = sqlite3_db_filename(db, "main"); path && *path)
+    db_path = path;
 
   std::string const GET_MAPPINGS_BY_OWNER_STR = sql_select_mappings_and_owners_prefix
     + "WHERE ? IN (o1.address, o2.address)"
@@ -1747,7 +1755,7 @@ bool name_system_db::init(cryptonote::Blockchain const *blockchain, cryptonote::
     GROUP BY type)";
 
   std::string const RESOLVE_STR = R"(
-SELECT encrypted_value, MAX(update_height)
+SELECT encrypted_value, MAX(update_height), expiration_height
 FROM mappings
 WHERE type = ? AND name_hash = ? AND)" + std::string{EXPIRATION};
 
@@ -1755,12 +1763,16 @@ WHERE type = ? AND name_hash = ? AND)" + std::string{EXPIRATION};
   constexpr auto GET_OWNER_BY_ID_STR  = "SELECT * FROM owner WHERE id = ?"sv;
   constexpr auto GET_OWNER_BY_KEY_STR = "SELECT * FROM owner WHERE address = ?"sv;
 
-  // Prune queries used when we need to rollback to remove records added after the detach point:
+  // Prune queries used when we need to rollback to remove records added after the detach point.
+  // Every update is its own mappings row, so the rows at or above a height are exactly the changes
+  // made by those blocks, and only owners those rows refer to can become unreferenced.
+  constexpr auto GET_MAPPINGS_ON_HEIGHT_AND_NEWER_STR = "SELECT type, name_hash, owner_id, backup_owner_id FROM mappings WHERE update_height >= ?"sv;
   constexpr auto PRUNE_MAPPINGS_STR   = "DELETE FROM mappings WHERE update_height >= ?"sv;
   constexpr auto PRUNE_OWNERS_STR = R"(
 DELETE FROM owner
-WHERE NOT EXISTS (SELECT * FROM mappings WHERE owner.id = mappings.owner_id)
-AND NOT EXISTS   (SELECT * FROM mappings WHERE owner.id = mappings.backup_owner_id))"sv;
+WHERE id = ?1
+AND NOT EXISTS (SELECT * FROM mappings WHERE owner_id = ?1)
+AND NOT EXISTS (SELECT * FROM mappings WHERE backup_owner_id = ?1))"sv;
 
   constexpr auto SAVE_MAPPING_STR  = "INSERT INTO mappings (type, name_hash, encrypted_value, txid, owner_id, backup_owner_id, update_height, expiration_height) VALUES (?,?,?,?,?,?,?,?)"sv;
   constexpr auto SAVE_OWNER_STR    = "INSERT INTO owner (address) VALUES (?)"sv;
@@ -1857,6 +1869,7 @@ AND NOT EXISTS   (SELECT * FROM mappings WHERE owner.id = mappings.backup_owner_
       !resolve_sql.compile(RESOLVE_STR) ||
       !get_owner_by_id_sql.compile(GET_OWNER_BY_ID_STR) ||
       !get_owner_by_key_sql.compile(GET_OWNER_BY_KEY_STR) ||
+      !get_mappings_on_height_and_newer_sql.compile(GET_MAPPINGS_ON_HEIGHT_AND_NEWER_STR) ||
       !prune_mappings_sql.compile(PRUNE_MAPPINGS_STR) ||
       !prune_owners_sql.compile(PRUNE_OWNERS_STR) ||
       !save_mapping_sql.compile(SAVE_MAPPING_STR) ||
@@ -1920,9 +1933,65 @@ AND NOT EXISTS   (SELECT * FROM mappings WHERE owner.id = mappings.backup_owner_
   return true;
 }
 
+struct name_system_db::reader
+{
+  sqlite3 *db;
+  sql_compiled_statement resolve_sql;
+  sql_compiled_statement get_mapping_counts_sql;
+
+  reader(name_system_db &nsdb, sqlite3 *db) : db{db}, resolve_sql{nsdb, db}, get_mapping_counts_sql{nsdb, db} {}
+  ~reader()
+  {
+    // As with the main connection, the close completes once the statements are finalized
+    sqlite3_close_v2(db);
+  }
+};
+
+void name_system_db::reader_returner::operator()(reader *r) const
+{
+  std::lock_guard lock{nsdb->readers_mutex};
+  nsdb->idle_readers.emplace_back(r);
+}
+
+name_system_db::reader_ptr name_system_db::acquire_reader()
+{
+  {
+    std::lock_guard lock{readers_mutex};
+    if (!idle_readers.empty())
+    {
+      reader_ptr result{idle_readers.back().release(), reader_returner{this}};
+      idle_readers.pop_back();
+      return result;
+    }
+  }
+
+  if (db_path.empty() || !resolve_sql || !get_mapping_counts_sql)
+    return reader_ptr{nullptr, reader_returner{this}};
+
+  sqlite3 *conn = nullptr;
+  int sql_open  = sqlite3_open_v2(db_path.c_str(), &conn, SQLITE_OPEN_READONLY, nullptr);
+  if (sql_open != SQLITE_OK)
+  {
+    MERROR("Failed to open ONS db read connection at: " << db_path << ", reason: " << sqlite3_errstr(sql_open));
+    sqlite3_close_v2(conn);
+    return reader_ptr{nullptr, reader_returner{this}};
+  }
+
+  auto r = std::make_unique<reader>(*this, conn);
+  if (!r->resolve_sql.compile(sqlite3_sql(resolve_sql.statement)) ||
+      !r->get_mapping_counts_sql.compile(sqlite3_sql(get_mapping_counts_sql.statement)))
+    return reader_ptr{nullptr, reader_returner{this}};
+
+  return reader_ptr{r.release(), reader_returner{this}};
+}
+
+name_system_db::name_system_db() = default;
+
 name_system_db::~name_system_db()
 {
+  idle_readers.clear();
   if (!db) return;
+  end_bulk_load();
 
   {
     scoped_db_transaction db_transaction(*this);
@@ -2095,6 +2164,48 @@ bool add_ons_entry(ons::name_system_db &ons_db, uint64_t height, cryptonote::tx_
   return true;
 }
 
+std::string resolve_cache_key(mapping_type type, std::string_view name_hash_b64)
+{
+  std::string key = std::to_string(db_mapping_type(type));
+  key += ':';
+  key += name_hash_b64;
+  return key;
+}
+
+// Adds the block's ONS entries into the current transaction; sets `parsed` if there were any and
+// appends the resolve cache keys of the names they change to `touched`.
+bool add_ons_entries(name_system_db &ons_db, const cryptonote::block &block, const std::vector<cryptonote::transaction> &txs, bool &parsed, std::vector<std::string> &touched)
+{
+  if (block.major_version < cryptonote::network_version_15_ons)
+    return true;
+
+  uint64_t height = cryptonote::get_block_height(block);
+  for (cryptonote::transaction const &tx : txs)
+  {
+    if (tx.type != cryptonote::txtype::oxen_name_system)
+      continue;
+
+    cryptonote::tx_extra_oxen_name_system entry = {};
+    std::string fail_reason;
+    if (!ons_db.validate_ons_tx(block.major_version, height, tx, entry, &fail_reason))
+    {
+      MFATAL("ONS TX: Failed to validate for tx=" << get_transaction_hash(tx) << ". This should have failed validation earlier reason=" << fail_reason);
+      assert("Failed to validate acquire name service. Should already have failed validation prior" == nullptr);
+      return false;
+    }
+
+    crypto::hash const &tx_hash = cryptonote::get_transaction_hash(tx);
+    if (!add_ons_entry(ons_db, height, entry, tx_hash))
+      return false;
+    static auto& ons_records = tools::metrics::get_counter("oxend_ons_records_added_total", "ONS buys, renewals and updates added from blocks");
+    ons_records.inc();
+
+    touched.push_back(resolve_cache_key(entry.type, hash_to_base64(entry.name_hash)));
+    parsed = true;
+  }
+  return true;
+}
+
 } // anon namespace
 
 bool name_system_db::add_block(const cryptonote::block &block, const std::vector<cryptonote::transaction> &txs)
@@ -2103,35 +2214,44 @@ bool name_system_db::add_block(const cryptonote::block &block, const std::vector
   if (last_processed_height >= height)
       return true;
 
-  scoped_db_transaction db_transaction(*this);
-  if (!db_transaction)
-   return false;
-
   bool ons_parsed_from_block = false;
-  if (block.major_version >= cryptonote::network_version_15_ons)
+  if (bulk_load)
   {
-    for (cryptonote::transaction const &tx : txs)
+    if (!transaction_begun)
     {
-      if (tx.type != cryptonote::txtype::oxen_name_system)
-        continue;
-
-      cryptonote::tx_extra_oxen_name_system entry = {};
-      std::string fail_reason;
-      if (!validate_ons_tx(block.major_version, height, tx, entry, &fail_reason))
+      char *sql_err = nullptr;
+      if (sqlite3_exec(db, "BEGIN;", nullptr, nullptr, &sql_err) != SQLITE_OK)
       {
-        MFATAL("ONS TX: Failed to validate for tx=" << get_transaction_hash(tx) << ". This should have failed validation earlier reason=" << fail_reason);
-        assert("Failed to validate acquire name service. Should already have failed validation prior" == nullptr);
+        MERROR("Failed to begin ONS bulk load transaction, reason=" << (sql_err ? sql_err : "??"));
+        sqlite3_free(sql_err);
         return false;
       }
+      transaction_begun = true;
+      bulk_blocks       = 0;
+      bulk_start_height = last_processed_height;
+      bulk_start_hash   = last_processed_hash;
+    }
 
-      crypto::hash const &tx_hash = cryptonote::get_transaction_hash(tx);
-      if (!add_ons_entry(*this, height, entry, tx_hash))
-        return false;
-
-      ons_parsed_from_block = true;
+    if (!add_ons_entries(*this, block, txs, ons_parsed_from_block, resolve_cache_pending))
+    {
+      rollback_bulk_transaction();
+      return false;
     }
+
+    last_processed_height = height;
+    last_processed_hash   = cryptonote::get_block_hash(block);
+    return ++bulk_blocks < BULK_LOAD_COMMIT_BLOCKS || commit_bulk_transaction();
   }
 
+  // Declared first so that it runs after the transaction below has been committed or rolled back
+  OXEN_DEFER { invalidate_resolve_cache(); };
+  scoped_db_transaction db_transaction(*this);
+  if (!db_transaction)
+   return false;
+
+  if (!add_ons_entries(*this, block, txs, ons_parsed_from_block, resolve_cache_pending))
+    return false;
+
   last_processed_height = height;
   last_processed_hash   = cryptonote::get_block_hash(block);
   if (ons_parsed_from_block)
@@ -2177,6 +2297,99 @@ struct replay_ons_tx
   cryptonote::tx_extra_oxen_name_system entry;
 };
 
+bool name_system_db::begin_bulk_load()
+{
+  if (bulk_load)
+    return true;
+
+  // Blocks replayed here are in the blockchain db already, so losing the ones not yet on disk
+  // (on an OS crash; a daemon crash loses nothing) only means replaying them again on startup.
+  int exec = sqlite3_exec(db, "PRAGMA synchronous = OFF", nullptr, nullptr, nullptr);
+  if (exec != SQLITE_OK)
+  {
+    MERROR("Failed to set synchronous mode to OFF: " << sqlite3_errstr(exec));
+    return false;
+  }
+  bulk_load = true;
+  return true;
+}
+
+bool name_system_db::end_bulk_load()
+{
+  if (!bulk_load)
+    return true;
+  bulk_load = false;
+
+  bool result = commit_bulk_transaction();
+  int exec = sqlite3_exec(db, "PRAGMA synchronous = NORMAL", nullptr, nullptr, nullptr);
+  if (exec != SQLITE_OK)
+  {
+    MERROR("Failed to set synchronous mode to NORMAL: " << sqlite3_errstr(exec));
+    result = false;
+  }
+
+  // Write the replayed blocks through to the (now synced) main db file
+  exec = sqlite3_wal_checkpoint_v2(db, nullptr, SQLITE_CHECKPOINT_TRUNCATE, nullptr, nullptr);
+  if (exec != SQLITE_OK)
+    MWARNING("Failed to checkpoint the ONS db after bulk loading: " << sqlite3_errstr(exec));
+  return result;
+}
+
+bool name_system_db::commit_bulk_transaction()
+{
+  if (!transaction_begun)
+    return true;
+
+  save_settings(last_processed_height, last_processed_hash, static_cast<int>(DB_VERSION));
+  char *sql_err = nullptr;
+  if (sqlite3_exec(db, "END;", nullptr, nullptr, &sql_err) != SQLITE_OK)
+  {
+    MERROR("Failed to commit ONS bulk load transaction, reason=" << (sql_err ? sql_err : "??"));
+    sqlite3_free(sql_err);
+    rollback_bulk_transaction();
+    return false;
+  }
+  transaction_begun = false;
+  invalidate_resolve_cache();
+  return true;
+}
+
+void name_system_db::rollback_bulk_transaction()
+{
+  if (!transaction_begun)
+    return;
+
+  sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+  transaction_begun     = false;
+  last_processed_height = bulk_start_height;
+  last_processed_hash   = bulk_start_hash;
+  invalidate_resolve_cache();
+}
+
+name_system_db::resolve_cache_entry const *name_system_db::find_resolve_cache(std::string const &key, uint64_t blockchain_height)
+{
+  auto *cached = resolve_cache.get(key);
+  if (cached && blockchain_height >= cached->from_height &&
+      (!cached->expiration_height || blockchain_height <= *cached->expiration_height))
+    return cached;
+  return nullptr;
+}
+
+void name_system_db::invalidate_resolve_cache(bool all)
+{
+  if (!all && resolve_cache_pending.empty())
+    return;
+
+  std::lock_guard lock{resolve_cache_mutex};
+  if (all)
+    resolve_cache.clear();
+  else
+    for (auto const &key : resolve_cache_pending)
+      resolve_cache.erase(key);
+  resolve_cache_pending.clear();
+  resolve_cache_generation++;
+}
+
 void name_system_db::block_detach(cryptonote::Blockchain const &blockchain, uint64_t new_blockchain_height)
 {
   prune_db(new_blockchain_height);
@@ -2224,10 +2437,35 @@ bool name_system_db::save_settings(uint64_t top_height, crypto::hash const &top_
 
 bool name_system_db::prune_db(uint64_t height)
 {
+  std::vector<std::string> touched;
+  std::set<int64_t> owners;
+  {
+    auto& statement = get_mappings_on_height_and_newer_sql;
+    bind_all(statement, height);
+    int step_result;
+    while ((step_result = step(statement)) == SQLITE_ROW)
+    {
+      touched.push_back(resolve_cache_key(static_cast<mapping_type>(get<int>(statement, 0)), get<std::string_view>(statement, 1)));
+      owners.insert(get<int64_t>(statement, 2));
+      if (auto backup = get<std::optional<int64_t>>(statement, 3))
+        owners.insert(*backup);
+    }
+    reset(statement);
+    clear_bindings(statement);
+    if (step_result != SQLITE_DONE)
+    {
+      MERROR("Failed to query ONS mappings to prune: " << sqlite3_errmsg(db));
+      return false;
+    }
+  }
+
   if (!bind_and_run(ons_sql_type::pruning, prune_mappings_sql, nullptr, height)) return false;
-  if (!sql_run_statement(ons_sql_type::pruning, prune_owners_sql, nullptr)) return false;
+  for (int64_t owner_id : owners)
+    if (!bind_and_run(ons_sql_type::pruning, prune_owners_sql, nullptr, owner_id)) return false;
 
   this->last_processed_height = (height - 1);
+  resolve_cache_pending.insert(resolve_cache_pending.end(), std::make_move_iterator(touched.begin()), std::make_move_iterator(touched.end()));
+  invalidate_resolve_cache();
   return true;
 }
 
@@ -2279,21 +2517,123 @@ mapping_record name_system_db::get_mapping(mapping_type type, std::string_view n
 std::optional<mapping_value> name_system_db::resolve(mapping_type type, std::string_view name_hash_b64, uint64_t blockchain_height)
 {
   assert(name_hash_b64.size() == 44 && name_hash_b64.back() == '=' && oxenmq::is_base64(name_hash_b64));
+  std::string cache_key = resolve_cache_key(type, name_hash_b64);
+  uint64_t generation;
+  {
+    std::lock_guard lock{resolve_cache_mutex};
+    if (auto *cached = find_resolve_cache(cache_key, blockchain_height))
+      return cached->value;
+    generation = resolve_cache_generation;
+  }
+
   std::optional<mapping_value> result;
-  bind_all(resolve_sql, db_mapping_type(type), name_hash_b64, blockchain_height);
-  if (step(resolve_sql) == SQLITE_ROW)
+  std::optional<uint64_t> expiration_height;
+  auto rd = acquire_reader();
+  auto &statement = rd ? rd->resolve_sql : resolve_sql;
+  bind_all(statement, db_mapping_type(type), name_hash_b64, blockchain_height);
+  if (step(statement) == SQLITE_ROW)
   {
-    if (auto blob = get<std::optional<blob_view>>(resolve_sql, 0))
+    if (auto blob = get<std::optional<blob_view>>(statement, 0))
     {
       auto& r = result.emplace();
       assert(blob->data.size() <= r.buffer.size());
       r.len = blob->data.size();
       r.encrypted = true;
       std::copy(blob->data.begin(), blob->data.end(), r.buffer.begin());
+      expiration_height = get<std::optional<uint64_t>>(statement, 2);
     }
   }
-  reset(resolve_sql);
-  clear_bindings(resolve_sql);
+  reset(statement);
+  clear_bindings(statement);
+
+  if (result)
+  {
+    std::lock_guard lock{resolve_cache_mutex};
+    if (generation == resolve_cache_generation)
+      resolve_cache.put(cache_key, {*result, blockchain_height, expiration_height});
+  }
+  return result;
+}
+
+std::vector<std::optional<mapping_value>> name_system_db::resolve(std::vector<std::pair<mapping_type, std::string>> const &keys, uint64_t blockchain_height)
+{
+  std::vector<std::optional<mapping_value>> result(keys.size());
+  std::unordered_map<std::string, std::vector<size_t>> missing; // cache key -> indices into keys
+  std::vector<std::string_view> name_hashes;
+  uint64_t generation;
+  {
+    std::lock_guard lock{resolve_cache_mutex};
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+      auto const &[type, name_hash_b64] = keys[i];
+      assert(name_hash_b64.size() == 44 && name_hash_b64.back() == '=' && oxenmq::is_base64(name_hash_b64));
+      std::string cache_key = resolve_cache_key(type, name_hash_b64);
+      if (auto *cached = find_resolve_cache(cache_key, blockchain_height))
+        result[i] = cached->value;
+      else
+      {
+        auto &indices = missing[std::move(cache_key)];
+        if (indices.empty())
+          name_hashes.push_back(name_hash_b64);
+        indices.push_back(i);
+      }
+    }
+    generation = resolve_cache_generation;
+  }
+
+  if (missing.empty())
+    return result;
+
+  // Like RESOLVE_STR, but for every type at once of many names (filtered to the requested types
+  // below): with a single MAX() aggregate sqlite takes the other columns from the max row.
+  std::string sql_statement = "SELECT type, name_hash, encrypted_value, MAX(update_height), expiration_height FROM mappings WHERE name_hash IN (";
+  std::vector<std::variant<uint64_t, std::string_view>> bind;
+  for (size_t i = 0; i < name_hashes.size(); i++)
+  {
+    sql_statement += i > 0 ? ", ?" : "?";
+    bind.emplace_back(name_hashes[i]);
+  }
+  sql_statement += ") AND";
+  sql_statement += EXPIRATION;
+  sql_statement += "GROUP BY type, name_hash";
+  bind.emplace_back(blockchain_height);
+
+  auto rd = acquire_reader();
+  sql_compiled_statement statement{*this, rd ? rd->db : nullptr};
+  if (!statement.compile(sql_statement, false /*optimise_for_multiple_usage*/)
+      || !bind_container(statement, bind))
+    return result;
+
+  std::vector<std::pair<std::string, resolve_cache_entry>> found;
+  for (int step_result; (step_result = step(statement)) != SQLITE_DONE;)
+  {
+    if (step_result == SQLITE_BUSY)
+      continue;
+    if (step_result != SQLITE_ROW)
+    {
+      LOG_PRINT_L1("Failed to execute statement: " << sqlite3_sql(statement.statement) << ", reason: " << sqlite3_errstr(step_result));
+      break;
+    }
+
+    auto type = static_cast<mapping_type>(get<uint16_t>(statement, 0));
+    auto it = missing.find(resolve_cache_key(type, get<std::string_view>(statement, 1)));
+    auto blob = get<std::optional<blob_view>>(statement, 2);
+    if (it == missing.end() || !blob)
+      continue;
+
+    auto &[key, entry] = found.emplace_back(it->first, resolve_cache_entry{{}, blockchain_height, get<std::optional<uint64_t>>(statement, 4)});
+    assert(blob->data.size() <= entry.value.buffer.size());
+    entry.value.len = blob->data.size();
+    entry.value.encrypted = true;
+    std::copy(blob->data.begin(), blob->data.end(), entry.value.buffer.begin());
+    for (size_t i : it->second)
+      result[i] = entry.value;
+  }
+
+  std::lock_guard lock{resolve_cache_mutex};
+  if (generation == resolve_cache_generation)
+    for (auto &[key, entry] : found)
+      resolve_cache.put(key, std::move(entry));
   return result;
 }
 
@@ -2335,7 +2675,8 @@ std::vector<mapping_record> name_system_db::get_mappings(std::vector<mapping_typ
   sql_statement += sql_select_mappings_and_owners_suffix;
 
   // Compile Statement
-  sql_compiled_statement statement{*this};
+  auto rd = acquire_reader();
+  sql_compiled_statement statement{*this, rd ? rd->db : nullptr};
   if (!statement.compile(sql_statement, false /*optimise_for_multiple_usage*/)
       || !bind_container(statement, bind))
     return result;
@@ -2388,7 +2729,8 @@ std::vector<mapping_record> name_system_db::get_mappings_by_owners(std::vector<g
 
   // Compile Statement
   std::vector<mapping_record> result;
-  sql_compiled_statement statement{*this};
+  auto rd = acquire_reader();
+  sql_compiled_statement statement{*this, rd ? rd->db : nullptr};
   if (!statement.compile(sql_statement, false /*optimise_for_multiple_usage*/)
       || !bind_container(statement, bind))
     return result;
@@ -2414,7 +2756,8 @@ std::vector<mapping_record> name_system_db::get_mappings_by_owner(generic_owner
 
 std::map<mapping_type, int> name_system_db::get_mapping_counts(uint64_t blockchain_height) {
   std::map<mapping_type, int> result;
-  bind_and_run(ons_sql_type::get_mapping_counts, get_mapping_counts_sql, &result, blockchain_height);
+  auto rd = acquire_reader();
+  bind_and_run(ons_sql_type::get_mapping_counts, rd ? rd->get_mapping_counts_sql : get_mapping_counts_sql, &result, blockchain_height);
   return result;
 }
 
@@ -6,10 +6,14 @@
 #include "epee/span.h"
 #include "cryptonote_basic/tx_extra.h"
 #include "common/fs.h"
+#include "common/lru_cache.h"
 #include <oxenmq/hex.h>
 
 #include <cassert>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 struct sqlite3;
 struct sqlite3_stmt;
@@ -244,11 +248,14 @@ class sql_compiled_statement final
 public:
   /// The name_system_db upon which this object operates
   name_system_db& nsdb;
+  /// The connection to compile on, if not nsdb's own (read-write) connection
+  sqlite3* conn = nullptr;
   /// The stored, owned statement
   sqlite3_stmt* statement = nullptr;
 
-  /// Constructor; takes a reference to the name_system_db.
-  explicit sql_compiled_statement(name_system_db& nsdb) : nsdb{nsdb} {}
+  /// Constructor; takes a reference to the name_system_db and, optionally, another connection to
+  /// the same database to compile statements on.
+  explicit sql_compiled_statement(name_system_db& nsdb, sqlite3* conn = nullptr) : nsdb{nsdb}, conn{conn} {}
 
   /// Non-copyable (because we own an internal sqlite3 statement handle)
   sql_compiled_statement(const sql_compiled_statement&) = delete;
@@ -256,7 +263,7 @@ public:
 
   /// Move construction; ownership of the internal statement handle, if present, is transferred to
   /// the new object.
-  sql_compiled_statement(sql_compiled_statement&& from) : nsdb{from.nsdb}, statement{from.statement} { from.statement = nullptr; }
+  sql_compiled_statement(sql_compiled_statement&& from) : nsdb{from.nsdb}, conn{from.conn}, statement{from.statement} { from.statement = nullptr; }
 
   /// Move copying.  The referenced name_system_db must be the same.  Ownership of the internal
   /// statement handle is transferred.  If the target already has a statement handle then it is
@@ -283,13 +290,19 @@ struct name_system_db
   cryptonote::network_type    network_type() const { return nettype; }
   uint64_t                    height      () const { return last_processed_height; }
 
+  // Bulk mode, for replaying many blocks at once: until end_bulk_load(), add_block groups blocks
+  // into one transaction per BULK_LOAD_COMMIT_BLOCKS and syncing to disk is turned off.
+  // end_bulk_load() commits the remaining blocks, restores syncing and checkpoints the WAL.
+  bool                        begin_bulk_load();
+  bool                        end_bulk_load  ();
+
   // Signifies the blockchain has reorganized commences the rollback and pruning procedures.
   void                        block_detach   (cryptonote::Blockchain const &blockchain, uint64_t new_blockchain_height);
   bool                        save_owner     (generic_owner const &owner, int64_t *row_id);
   bool                        save_mapping   (crypto::hash const &tx_hash, cryptonote::tx_extra_oxen_name_system const &src, uint64_t height, std::optional<uint64_t> expiration_height, int64_t owner_id, std::optional<int64_t> backup_owner_id);
   bool                        save_settings  (uint64_t top_height, crypto::hash const &top_hash, int version);
 
-  // Delete all mappings that are registered on height or newer followed by deleting all owners no longer referenced in the DB
+  // Delete all mappings that are registered on height or newer followed by deleting the owners they referenced that are no longer referenced in the DB
   bool                        prune_db(uint64_t height);
 
   owner_record                get_owner_by_key      (generic_owner const &owner);
@@ -312,16 +325,63 @@ struct name_system_db
   // not found or expired, otherwise returns the encrypted value.
   std::optional<mapping_value> resolve(mapping_type type, std::string_view name_hash_b64, uint64_t blockchain_height);
 
+  // Resolves many mappings at once, as resolve() does one, with a single query for the names that
+  // aren't cached.  Returns one element per (type, name hash) of `keys`, in the same order.
+  std::vector<std::optional<mapping_value>> resolve(std::vector<std::pair<mapping_type, std::string>> const &keys, uint64_t blockchain_height);
+
   // Validates an ONS transaction.  If the function returns true then entry will be populated with
   // the ONS details.  On a false return, `reason` is instead populated with the failure reason.
   bool validate_ons_tx(uint8_t hf_version, uint64_t blockchain_height, cryptonote::transaction const &tx, cryptonote::tx_extra_oxen_name_system &entry, std::string *reason);
 
+  // Out of line because `reader` is only complete in the .cpp
+  name_system_db();
   // Destructor; closes the sqlite3 database if one is open
   ~name_system_db();
 
   sqlite3 *db               = nullptr;
   bool    transaction_begun = false;
 private:
+  // A read-only connection with its own lookup statements.  resolve, get_mappings,
+  // get_mappings_by_owners and get_mapping_counts (the RPC lookups) each borrow one from a pool, so
+  // that they can run concurrently with each other and with block processing (through WAL they
+  // only see committed blocks).  Without a pool (e.g. a temporary db, which can't be shared between
+  // connections) they use the main connection instead.
+  struct reader;
+  struct reader_returner { name_system_db *nsdb; void operator()(reader *r) const; };
+  using reader_ptr = std::unique_ptr<reader, reader_returner>;
+  reader_ptr acquire_reader();
+
+  std::string db_path; // empty if the db can't be opened by other connections
+
+  bool commit_bulk_transaction();
+  void rollback_bulk_transaction();
+  bool bulk_load = false;
+  uint64_t bulk_blocks = 0; // blocks added in the current bulk transaction
+  uint64_t bulk_start_height = 0;
+  crypto::hash bulk_start_hash = crypto::null_hash;
+  std::mutex readers_mutex;
+  std::vector<std::unique_ptr<reader>> idle_readers;
+
+  // Recent resolve() results, keyed by resolve_cache_key(type, name hash).  An entry is the newest
+  // unexpired value as of `from_height`, and so stays the answer for the heights up to its
+  // expiry until a block touches the name: add_block drops the entries of the names it changed
+  // once its transaction ends (collecting them in resolve_cache_pending until then), and a detach
+  // drops those of the names the detached blocks changed.  Each drop bumps the generation so that a lookup which read the db before
+  // the drop doesn't cache what it read.
+  struct resolve_cache_entry
+  {
+    mapping_value value;
+    uint64_t from_height;
+    std::optional<uint64_t> expiration_height;
+  };
+  static constexpr size_t RESOLVE_CACHE_SIZE = 10000;
+  resolve_cache_entry const *find_resolve_cache(std::string const &key, uint64_t blockchain_height); // requires resolve_cache_mutex
+  void invalidate_resolve_cache(bool all = false);
+  std::mutex resolve_cache_mutex;
+  tools::lru_cache<std::string, resolve_cache_entry> resolve_cache{RESOLVE_CACHE_SIZE};
+  uint64_t resolve_cache_generation = 0;
+  std::vector<std::string> resolve_cache_pending;
+
   cryptonote::network_type nettype;
   uint64_t last_processed_height = 0;
   crypto::hash last_processed_hash = crypto::null_hash;
@@ -1,4 +1,6 @@
 #include <array>
+#include <algorithm>
+#include <deque>
 #include <mutex>
 #include <chrono>
 
@@ -212,10 +214,18 @@ struct round_context
     } signed_block;
   } transient;
 
+  std::optional<pulse::round_stats> stats; // For the round in progress, if we take part in it
+
   round_state state;
+  pulse::time_point wake_time; // When pulse::main next steps the state machine, unless woken earlier
 };
 
 static round_context context;
+
+// The stats of the most recently ended rounds, for pulse::recent_rounds()
+constexpr size_t RECENT_ROUNDS_SIZE = 64;
+static std::mutex recent_rounds_mutex;
+static std::deque<pulse::round_stats> recent_rounds_history;
 namespace
 {
 
@@ -534,6 +544,15 @@ void pulse::handle_message(void *quorumnet_state, pulse::message const &msg)
     return;
   }
 
+  if (context.stats && msg.type != pulse::message_type::invalid)
+  {
+    auto const &sender = msg.type == pulse::message_type::block_template ? context.prepare_for_round.quorum.workers[0]
+                                                                         : context.prepare_for_round.quorum.validators[msg.quorum_position];
+    auto &arrivals = context.stats->arrivals;
+    if (std::none_of(arrivals.begin(), arrivals.end(), [&](auto const &a) { return a.type == msg.type && a.sender == sender; }))
+      arrivals.push_back({msg.type, sender, std::chrono::duration_cast<std::chrono::milliseconds>(pulse::clock::now() - context.prepare_for_round.start_time)});
+  }
+
   pulse_wait_stage *stage = nullptr;
   switch(msg.type)
   {
@@ -731,6 +750,12 @@ bool pulse::convert_time_to_round(pulse::time_point const &time, pulse::time_poi
   return result_usize <= 255;
 }
 
+std::vector<pulse::round_stats> pulse::recent_rounds()
+{
+  std::lock_guard lock{recent_rounds_mutex};
+  return {recent_rounds_history.begin(), recent_rounds_history.end()};
+}
+
 bool pulse::get_round_timings(cryptonote::Blockchain const &blockchain, uint64_t block_height, uint64_t prev_timestamp, pulse::timings &times)
 {
   times = {};
@@ -988,14 +1013,26 @@ Yes +-----[Block can not be added to blockchain]
       P2P-ed.
 */
 
-round_state goto_preparing_for_next_round(round_context &context)
+// `failure` is recorded in the round's stats; it is empty if we completed our part in the round.
+round_state goto_preparing_for_next_round(round_context &context, std::string_view failure = {})
 {
+  if (context.stats && context.stats->failure.empty())
+    context.stats->failure = failure;
   context.prepare_for_round.queue_for_next_round = true;
   return round_state::prepare_for_round;
 }
 
 void clear_round_data(round_context &context)
 {
+  if (context.stats)
+  {
+    std::lock_guard lock{recent_rounds_mutex};
+    recent_rounds_history.push_back(std::move(*context.stats));
+    while (recent_rounds_history.size() > RECENT_ROUNDS_SIZE)
+      recent_rounds_history.pop_front();
+    context.stats.reset();
+  }
+
   if (service_nodes::verify_pulse_quorum_sizes(context.prepare_for_round.quorum))
   {
     // NOTE: Store the quorum into history before deleting it from memory.
@@ -1038,8 +1075,10 @@ void clear_round_data(round_context &context)
   context.prepare_for_round = {};
 }
 
-round_state goto_wait_for_next_block_and_clear_round_data(round_context &context)
+round_state goto_wait_for_next_block_and_clear_round_data(round_context &context, std::string_view failure = {})
 {
+  if (context.stats && context.stats->failure.empty())
+    context.stats->failure = failure;
   clear_round_data(context);
   return round_state::wait_for_next_block;
 }
@@ -1207,16 +1246,42 @@ round_state prepare_for_round(round_context &context, service_nodes::service_nod
     }
   }
 
+  if (context.prepare_for_round.participant != sn_type::none)
+  {
+    auto &stats     = context.stats.emplace();
+    stats.height    = context.wait_for_next_block.height;
+    stats.round     = context.prepare_for_round.round;
+    stats.node_name = context.prepare_for_round.node_name;
+  }
+
   return round_state::wait_for_round;
 }
 
-round_state wait_for_round(round_context &context, cryptonote::Blockchain const &blockchain)
+// As the round's block producer, build (or refresh) our block template before it's needed: the
+// blockchain caches it, so the create_next_pulse_block_template in send_block_template only has to
+// fill in the round and validator bitset.
+void prepare_block_template(round_context const &context, service_nodes::service_node_keys const &key, cryptonote::Blockchain &blockchain)
+{
+  if (context.prepare_for_round.participant != sn_type::producer)
+    return;
+
+  std::vector<service_nodes::service_node_pubkey_info> list_state = blockchain.get_service_node_list().get_service_node_list_state({key.pub});
+  if (list_state.empty() || !list_state[0].info->is_active())
+    return;
+
+  cryptonote::block block;
+  uint64_t height = 0;
+  if (!blockchain.create_next_pulse_block_template(block, service_nodes::service_node_info_to_payout(key.pub, *list_state[0].info), context.prepare_for_round.round, 0 /*validator_bitset*/, height))
+    MDEBUG(log_prefix(context) << "Failed to prepare the block template ahead of time");
+}
+
+round_state wait_for_round(round_context &context, service_nodes::service_node_keys const &key, cryptonote::Blockchain &blockchain)
 {
   const auto curr_height = blockchain.get_current_blockchain_height(true /*lock*/);
   if (context.wait_for_next_block.height != curr_height)
   {
     MDEBUG(log_prefix(context) << "Block height changed whilst waiting for round " << +context.prepare_for_round.round << ", restarting Pulse stages");
-    return goto_wait_for_next_block_and_clear_round_data(context);
+    return goto_wait_for_next_block_and_clear_round_data(context, "Block height changed whilst waiting for round");
   }
 
   auto start_time = context.prepare_for_round.start_time;
@@ -1224,6 +1289,7 @@ round_state wait_for_round(round_context &context, cryptonote::Blockchain const
   {
     for (static uint64_t last_height = 0; last_height != context.wait_for_next_block.height; last_height = context.wait_for_next_block.height)
       MINFO(log_prefix(context) << "Waiting for round " << +context.prepare_for_round.round << " to start in " << tools::friendly_duration(start_time - now));
+    prepare_block_template(context, key, blockchain);
     return round_state::wait_for_round;
   }
 
@@ -1237,7 +1303,7 @@ round_state wait_for_round(round_context &context, cryptonote::Blockchain const
     if (faulty_chance < 10)
     {
       MDEBUG(log_prefix(context) << "FAULTY NODE ACTIVATED");
-      return goto_preparing_for_next_round(context);
+      return goto_preparing_for_next_round(context, "Faulty node test code");
     }
 
     size_t sleep_chance = tools::uniform_distribution_portable(tools::rng, 100);
@@ -1283,7 +1349,7 @@ round_state send_and_wait_for_handshakes(round_context &context, void *quorumnet
     catch (std::exception const &e)
     {
       MERROR(log_prefix(context) << "Attempting to invoke and send a Pulse participation handshake unexpectedly failed. " << e.what());
-      return goto_preparing_for_next_round(context);
+      return goto_preparing_for_next_round(context, "Failed to send handshake");
     }
   }
 
@@ -1322,11 +1388,11 @@ round_state send_handshake_bitsets(round_context &context, void *quorumnet_state
   catch(std::exception const &e)
   {
     MERROR(log_prefix(context) << "Attempting to invoke and send a Pulse validator bitset unexpectedly failed. " << e.what());
-    return goto_preparing_for_next_round(context);
+    return goto_preparing_for_next_round(context, "Failed to send handshake bitset");
   }
 }
 
-round_state wait_for_handshake_bitsets(round_context &context, service_nodes::service_node_list &node_list, void *quorumnet_state, service_nodes::service_node_keys const &key)
+round_state wait_for_handshake_bitsets(round_context &context, service_nodes::service_node_list &node_list, void *quorumnet_state, service_nodes::service_node_keys const &key, cryptonote::Blockchain &blockchain)
 {
   handle_messages_received_early_for(context.transient.wait_for_handshake_bitsets.stage, quorumnet_state);
   pulse_wait_stage const &stage = context.transient.wait_for_handshake_bitsets.stage;
@@ -1361,8 +1427,10 @@ round_state wait_for_handshake_bitsets(round_context &context, service_nodes::se
 
     if (count < service_nodes::PULSE_BLOCK_REQUIRED_SIGNATURES || best_bitset == 0 || i_am_not_participating)
     {
+      std::string_view failure;
       if (best_bitset == 0)
       {
+        failure = "No agreement on handshake bitsets"sv;
         // Less than the threshold of the validators can come to agreement about
         // which validators are online, we wait until the next round.
         MDEBUG(log_prefix(context) << count << "/" << quorum.size()
@@ -1371,17 +1439,19 @@ round_state wait_for_handshake_bitsets(round_context &context, service_nodes::se
       }
       else if (i_am_not_participating)
       {
+        failure = "Not included in the handshake bitset"sv;
         MDEBUG(log_prefix(context) << "The participating validator bitset " << bitset_view16(best_bitset)
                                    << " does not include us (quorum index " << context.prepare_for_round.my_quorum_position << "). Waiting until next round.");
       }
       else
       {
         // Can't come to agreement, see threshold comment above
+        failure = "Too few validators agreed on the handshake bitset"sv;
         MDEBUG(log_prefix(context) << "We heard back from less than " << service_nodes::PULSE_BLOCK_REQUIRED_SIGNATURES << " of the validators ("
                                    << count << "/" << quorum.size() << "). Waiting until next round.");
       }
 
-      return goto_preparing_for_next_round(context);
+      return goto_preparing_for_next_round(context, failure);
     }
 
     context.transient.wait_for_handshake_bitsets.best_bitset = best_bitset;
@@ -1398,6 +1468,7 @@ round_state wait_for_handshake_bitsets(round_context &context, service_nodes::se
       return round_state::wait_for_block_template;
   }
 
+  prepare_block_template(context, key, blockchain);
   return round_state::wait_for_handshake_bitsets;
 }
 
@@ -1410,14 +1481,14 @@ round_state send_block_template(round_context &context, void *quorumnet_state, s
   if (list_state.empty())
   {
     MWARNING(log_prefix(context) << "Block producer (us) is not available on the service node list, waiting until next round");
-    return goto_preparing_for_next_round(context);
+    return goto_preparing_for_next_round(context, "Block producer (us) not on the service node list");
   }
 
   std::shared_ptr<const service_nodes::service_node_info> info = list_state[0].info;
   if (!info->is_active())
   {
     MWARNING(log_prefix(context) << "Block producer (us) is not an active service node, waiting until next round");
-    return goto_preparing_for_next_round(context);
+    return goto_preparing_for_next_round(context, "Block producer (us) not active");
   }
 
   // Block
@@ -1432,13 +1503,13 @@ round_state send_block_template(round_context &context, void *quorumnet_state, s
                                                      height))
     {
       MERROR(log_prefix(context) << "Failed to generate a block template, waiting until next round");
-      return goto_preparing_for_next_round(context);
+      return goto_preparing_for_next_round(context, "Failed to generate block template");
     }
 
     if (context.wait_for_next_block.height != height)
     {
       MDEBUG(log_prefix(context) << "Block height changed whilst preparing block template for round " << +context.prepare_for_round.round << ", restarting Pulse stages");
-      return goto_wait_for_next_block_and_clear_round_data(context);
+      return goto_wait_for_next_block_and_clear_round_data(context, "Block height changed whilst preparing block template");
     }
   }
 
@@ -1477,7 +1548,7 @@ round_state wait_for_block_template(round_context &context, service_nodes::servi
     else
     {
       MINFO(log_prefix(context) << "Timed out, block template was not received");
-      return goto_preparing_for_next_round(context);
+      return goto_preparing_for_next_round(context, "Timed out waiting for block template");
     }
   }
 
@@ -1514,7 +1585,7 @@ round_state send_and_wait_for_random_value_hashes(round_context &context, servic
   if (timed_out || all_hashes)
   {
     if (!enforce_validator_participation_and_timeouts(context, stage, node_list, timed_out, all_hashes))
-      return goto_preparing_for_next_round(context);
+      return goto_preparing_for_next_round(context, "Timed out waiting for random value hashes");
 
     MINFO(log_prefix(context) << "Received " << bitset_view16(stage.bitset).count() << " random value hashes from " << bitset_view16(stage.bitset) << (timed_out ? ". We timed out and some hashes are missing" : ""));
     return round_state::send_and_wait_for_random_value;
@@ -1552,7 +1623,7 @@ round_state send_and_wait_for_random_value(round_context &context, service_nodes
   if (timed_out || all_values)
   {
     if (!enforce_validator_participation_and_timeouts(context, stage, node_list, timed_out, all_values))
-      return goto_preparing_for_next_round(context);
+      return goto_preparing_for_next_round(context, "Timed out waiting for random values");
 
     // Generate Final Random Value
     crypto::hash final_hash = {};
@@ -1633,7 +1704,7 @@ round_state send_and_wait_for_signed_blocks(round_context &context, service_node
   if (timed_out || enough)
   {
     if (!enforce_validator_participation_and_timeouts(context, stage, node_list, timed_out, enough))
-      return goto_preparing_for_next_round(context);
+      return goto_preparing_for_next_round(context, "Timed out waiting for signed blocks");
 
     // Select signatures randomly so we don't always just take the first N required signatures.
     // Then sort just the first N required signatures, so signatures are added
@@ -1666,7 +1737,7 @@ round_state send_and_wait_for_signed_blocks(round_context &context, service_node
     MDEBUG(log_prefix(context) << "Final signed block constructed\n" << cryptonote::obj_to_json_str(final_block));
     cryptonote::block_verification_context bvc = {};
     if (!core.handle_block_found(final_block, bvc))
-      return goto_preparing_for_next_round(context);
+      return goto_preparing_for_next_round(context, "Final block rejected");
 
     return goto_wait_for_next_block_and_clear_round_data(context);
   }
@@ -1674,10 +1745,41 @@ round_state send_and_wait_for_signed_blocks(round_context &context, service_node
   return round_state::send_and_wait_for_signed_blocks;
 }
 
+// How often the state machine is stepped when it isn't waiting on a stage deadline or woken, to
+// pick up anything it isn't woken for (e.g. a change of height in the middle of a round).
+constexpr auto POLL_INTERVAL = std::chrono::milliseconds(500);
+
+// Returns when the state machine next needs to be stepped if nothing wakes it before then: the
+// deadline of the stage it is waiting in, but no later than a poll interval from now.
+pulse::time_point next_wake_time(round_context const &context)
+{
+  pulse::time_point result = pulse::clock::now() + POLL_INTERVAL;
+  pulse::time_point deadline = result;
+  switch (context.state)
+  {
+    case round_state::wait_for_round:                        deadline = context.prepare_for_round.start_time; break;
+    case round_state::send_and_wait_for_handshakes:          deadline = context.transient.send_and_wait_for_handshakes.stage.end_time; break;
+    case round_state::wait_for_handshake_bitsets:            deadline = context.transient.wait_for_handshake_bitsets.stage.end_time; break;
+    case round_state::wait_for_block_template:               deadline = context.transient.wait_for_block_template.stage.end_time; break;
+    case round_state::send_and_wait_for_random_value_hashes: deadline = context.transient.random_value_hashes.wait.stage.end_time; break;
+    case round_state::send_and_wait_for_random_value:        deadline = context.transient.random_value.wait.stage.end_time; break;
+    case round_state::send_and_wait_for_signed_blocks:       deadline = context.transient.signed_block.wait.stage.end_time; break;
+    default: break;
+  }
+  return std::min(result, deadline);
+}
+
 void pulse::main(void *quorumnet_state, cryptonote::core &core)
+{
+  if (pulse::clock::now() >= context.wake_time)
+    wake(quorumnet_state, core);
+}
+
+void pulse::wake(void *quorumnet_state, cryptonote::core &core)
 {
   cryptonote::Blockchain &blockchain          = core.get_blockchain_storage();
   service_nodes::service_node_keys const &key = core.get_service_keys();
+  context.wake_time                           = pulse::clock::now() + POLL_INTERVAL;
 
   //
   // NOTE: Early exit if too early
@@ -1718,7 +1820,7 @@ void pulse::main(void *quorumnet_state, cryptonote::core &core)
         break;
 
       case round_state::wait_for_round:
-        context.state = wait_for_round(context, blockchain);
+        context.state = wait_for_round(context, key, blockchain);
         break;
 
       case round_state::send_and_wait_for_handshakes:
@@ -1730,7 +1832,7 @@ void pulse::main(void *quorumnet_state, cryptonote::core &core)
         break;
 
       case round_state::wait_for_handshake_bitsets:
-        context.state = wait_for_handshake_bitsets(context, node_list, quorumnet_state, key);
+        context.state = wait_for_handshake_bitsets(context, node_list, quorumnet_state, key, blockchain);
         break;
 
       case round_state::wait_for_block_template:
@@ -1754,5 +1856,7 @@ void pulse::main(void *quorumnet_state, cryptonote::core &core)
         break;
     }
   }
+
+  context.wake_time = next_wake_time(context);
 }
 
@@ -1,9 +1,12 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <condition_variable>
+#include <string>
 #include <string_view>
+#include <vector>
 
 #include "cryptonote_basic/cryptonote_basic_impl.h"
 #include "crypto/crypto.h"
@@ -86,9 +89,36 @@ struct message
   } signed_block;
 };
 
+// Steps the Pulse state machine.  main is run by a short, frequent timer but only does anything
+// once the current stage's deadline is reached (or its poll interval for new blocks elapses); wake
+// steps it immediately, and is invoked when a block is added or a message has been handled so that
+// a stage completed by them doesn't wait for its deadline.  Both must run on the Pulse thread.
 void main(void *quorumnet_state, cryptonote::core &core);
+void wake(void *quorumnet_state, cryptonote::core &core);
 void handle_message(void *quorumnet_state, pulse::message const &msg);
 
+// What we saw of a Pulse round that we took part in.  The most recent rounds are kept (see
+// recent_rounds()) so that slow or failed rounds can be diagnosed after the fact.
+struct round_stats
+{
+  struct arrival
+  {
+    message_type type;
+    crypto::public_key sender; // The validator that sent the message, or the block producer for the block template
+    std::chrono::milliseconds latency; // Time from the start of the round until the message was first received
+  };
+
+  uint64_t height;
+  uint8_t round;
+  std::string node_name;         // Our part in the round: V[n] for validator n, or W[0] for the block producer
+  std::vector<arrival> arrivals; // In the order received; includes our own messages
+  std::string failure;           // Why the round failed, empty if we completed our part in it
+};
+
+// Returns the stats of the most recent rounds that we took part in, oldest first.  Unlike the rest
+// of the interface this may be called from any thread.
+std::vector<round_stats> recent_rounds();
+
 struct timings
 {
   pulse::time_point genesis_timestamp;
@@ -31,6 +31,8 @@
 #include <functional>
 #include <algorithm>
 #include <chrono>
+#include <optional>
+#include <utility>
 
 #include <boost/endian/conversion.hpp>
 
@@ -50,6 +52,8 @@ extern "C" {
 #include "common/util.h"
 #include "common/random.h"
 #include "common/lock.h"
+#include "common/memory_usage.h"
+#include "common/metrics.h"
 #include "common/hex.h"
 #include "epee/misc_os_dependent.h"
 #include "blockchain.h"
@@ -68,6 +72,7 @@ extern "C" {
 namespace service_nodes
 {
   size_t constexpr STORE_LONG_TERM_STATE_INTERVAL = 10000;
+  size_t constexpr SHORT_TERM_FULL_STATE_INTERVAL = 100;
 
   constexpr auto X25519_MAP_PRUNING_INTERVAL = 5min;
   constexpr auto X25519_MAP_PRUNING_LAG = 24h;
@@ -88,6 +93,70 @@ namespace service_nodes
   , m_service_node_keys(nullptr)
   , m_state{this}
   {
+    m_memory_metric = tools::memory::track("service_nodes", "Service node states (current, recent, archived and alt), quorums and proofs", [this] {
+      std::lock_guard lock{m_sn_mutex};
+      return memory_usage();
+    });
+  }
+
+  size_t service_node_list::memory_usage() const
+  {
+    using tools::memory::heap_bytes;
+    // Consecutive states share most of their service node infos, infos map shards and quorums, so
+    // each of those is counted once however many states hold it
+    std::unordered_set<const void*> seen;
+    auto once = [&seen](const void* p) { return p && seen.insert(p).second; };
+    size_t bytes = 0;
+    auto add_quorums = [&](const quorum_manager &quorums) {
+      for (auto *q : {&quorums.obligations, &quorums.checkpointing, &quorums.blink, &quorums.pulse})
+        if (once(q->get()))
+          bytes += sizeof(quorum) + heap_bytes((*q)->validators) + heap_bytes((*q)->workers);
+    };
+    auto add_state = [&](const state_t &state) {
+      state.service_nodes_infos.for_each_shard([&](const auto &shard) {
+        if (!once(&shard))
+          return;
+        bytes += heap_bytes(shard);
+        for (auto &[pubkey, info] : shard)
+        {
+          if (!once(info.get()))
+            continue;
+          bytes += sizeof(service_node_info) + heap_bytes(info->contributors);
+          for (auto &contributor : info->contributors)
+            bytes += heap_bytes(contributor.locked_contributions);
+        }
+      });
+      bytes += heap_bytes(state.key_image_blacklist);
+      add_quorums(state.quorums);
+      if (once(state.sorted_active_infos.get()))
+        bytes += heap_bytes(*state.sorted_active_infos);
+      if (once(state.swarms.get()))
+      {
+        bytes += heap_bytes(*state.swarms);
+        for (auto &[id, members] : *state.swarms)
+          bytes += heap_bytes(members);
+      }
+    };
+
+    add_state(m_state);
+    bytes += heap_bytes(m_transient.state_history) + heap_bytes(m_transient.state_archive) + heap_bytes(m_transient.alt_state);
+    for (auto &state : m_transient.state_history)
+      add_state(state);
+    for (auto &state : m_transient.state_archive)
+      add_state(state);
+    for (auto &[hash, state] : m_transient.alt_state)
+      add_state(state);
+    bytes += heap_bytes(m_transient.old_quorum_states);
+    for (auto &q : m_transient.old_quorum_states)
+      add_quorums(q.quorums);
+    bytes += heap_bytes(m_transient.cache_data_blob);
+
+    {
+      std::lock_guard lock{m_proofs_mutex};
+      bytes += heap_bytes(proofs) + heap_bytes(m_dirty_proofs);
+    }
+    std::shared_lock lock{m_x25519_map_mutex};
+    return bytes + heap_bytes(x25519_to_pub);
   }
 
   void service_node_list::init()
@@ -125,7 +194,46 @@ namespace service_nodes
     return result;
   }
 
+  // Returns the same list as sort_and_filter(sns_infos, is_active) given `prev`, the sorted active
+  // list of the state that `sns_infos` was derived from.  Nodes that are still active keep their
+  // relative order, so the full sort is only needed if a node became active since `prev`.
+  static std::vector<pubkey_and_sninfo> update_active_list(const service_nodes_infos_t &sns_infos, const std::vector<pubkey_and_sninfo> &prev) {
+    std::vector<pubkey_and_sninfo> result;
+    result.reserve(prev.size());
+    for (const auto &key_info : prev)
+    {
+      auto it = sns_infos.find(key_info.first);
+      if (it != sns_infos.end() && it->second->is_active())
+        result.emplace_back(key_info.first, it->second);
+    }
+
+    size_t num_active = 0;
+    for (const auto &key_info : sns_infos)
+      num_active += key_info.second->is_active();
+    if (num_active == result.size())
+      return result;
+    return sort_and_filter(sns_infos, [](const service_node_info &info) { return info.is_active(); });
+  }
+
+  // Groups pubkey-sorted active nodes by swarm, preserving their order within each swarm
+  static swarm_snode_map_t gather_swarms(const std::vector<pubkey_and_sninfo> &sorted_active) {
+    swarm_snode_map_t result;
+    for (const auto &key_info : sorted_active)
+      result[key_info.second->swarm_id].push_back(key_info.first);
+    return result;
+  }
+
+  std::vector<crypto::public_key> service_node_list::state_t::swarm_members(swarm_id_t swarm_id) const {
+    std::shared_ptr<const swarm_snode_map_t> index = swarms;
+    if (!index)
+      index = std::make_shared<const swarm_snode_map_t>(gather_swarms(active_service_nodes_infos()));
+    auto it = index->find(swarm_id);
+    return it != index->end() ? it->second : std::vector<crypto::public_key>{};
+  }
+
   std::vector<pubkey_and_sninfo> service_node_list::state_t::active_service_nodes_infos() const {
+    if (sorted_active_infos)
+      return *sorted_active_infos;
     return sort_and_filter(service_nodes_infos, [](const service_node_info &info) { return info.is_active(); }, /*reserve=*/ true);
   }
 
@@ -224,6 +332,31 @@ namespace service_nodes
     return m_state.service_nodes_infos.size();
   }
 
+  crypto::hash service_node_list::state_hash() const
+  {
+    std::vector<std::pair<crypto::public_key, const service_node_info*>> nodes;
+    std::lock_guard lock(m_sn_mutex);
+    nodes.reserve(m_state.service_nodes_infos.size());
+    for (auto& [pubkey, info] : m_state.service_nodes_infos)
+      nodes.emplace_back(pubkey, info.get());
+    std::sort(nodes.begin(), nodes.end(), [](auto& a, auto& b) { return a.first < b.first; });
+
+    std::string data;
+    data.reserve(nodes.size() * (sizeof(crypto::public_key) + 16));
+    for (auto& [pubkey, info] : nodes)
+    {
+      data.append(reinterpret_cast<const char*>(pubkey.data), sizeof(pubkey.data));
+      for (uint64_t v : {info->registration_height, static_cast<uint64_t>(info->active_since_height)})
+      {
+        boost::endian::native_to_little_inplace(v);
+        data.append(reinterpret_cast<const char*>(&v), sizeof(v));
+      }
+    }
+    crypto::hash result;
+    crypto::cn_fast_hash(data.data(), data.size(), result);
+    return result;
+  }
+
   std::vector<service_node_pubkey_info> service_node_list::get_service_node_list_state(const std::vector<crypto::public_key> &service_node_pubkeys) const
   {
     std::lock_guard lock(m_sn_mutex);
@@ -262,11 +395,20 @@ namespace service_nodes
     m_store_quorum_history = hist_size;
   }
 
-  bool service_node_list::is_service_node(const crypto::public_key& pubkey, bool require_active) const
+  std::vector<crypto::public_key> service_node_list::get_swarm_members(const crypto::public_key &pubkey) const
   {
     std::lock_guard lock(m_sn_mutex);
     auto it = m_state.service_nodes_infos.find(pubkey);
-    return it != m_state.service_nodes_infos.end() && (!require_active || it->second->is_active());
+    if (it == m_state.service_nodes_infos.end() || !it->second->is_active())
+      return {};
+    return m_state.swarm_members(it->second->swarm_id);
+  }
+
+  bool service_node_list::is_service_node(const crypto::public_key& pubkey, bool require_active) const
+  {
+    auto infos = registered_infos();
+    auto it = infos->find(pubkey);
+    return it != infos->end() && (!require_active || it->second->is_active());
   }
 
   bool service_node_list::is_key_image_locked(crypto::key_image const &check_image, uint64_t *unlock_height, service_node_info::contribution_t *the_locked_contribution) const
@@ -720,9 +862,10 @@ namespace service_nodes
 
         if (sn_list && !sn_list->m_rescanning)
         {
+          std::lock_guard proofs_lock{sn_list->m_proofs_mutex};
           auto &proof = sn_list->proofs[key];
           proof.timestamp = proof.effective_timestamp = 0;
-          proof.store(key, sn_list->m_blockchain);
+          sn_list->m_dirty_proofs.insert(key);
         }
         return true;
 
@@ -762,6 +905,7 @@ namespace service_nodes
         // next actual proof from being sent/relayed.
         if (sn_list)
         {
+          std::lock_guard proofs_lock{sn_list->m_proofs_mutex};
           auto &proof = sn_list->proofs[key];
           proof.effective_timestamp = block.timestamp;
           proof.checkpoint_participation.reset();
@@ -1008,7 +1152,7 @@ namespace service_nodes
     if (hf_version >= cryptonote::network_version_11_infinite_staking)
     {
       // NOTE(oxen): Grace period is not used anymore with infinite staking. So, if someone somehow reregisters, we just ignore it
-      const auto iter = service_nodes_infos.find(key);
+      const auto iter = std::as_const(service_nodes_infos).find(key);
       if (iter != service_nodes_infos.end())
         return false;
 
@@ -1016,9 +1160,9 @@ namespace service_nodes
       // re-registration: we want to wipe out any data from the previous registration.
       if (sn_list && !sn_list->m_rescanning)
       {
-        auto &proof = sn_list->proofs[key];
-        proof = {};
-        proof.store(key, sn_list->m_blockchain);
+        std::lock_guard proofs_lock{sn_list->m_proofs_mutex};
+        sn_list->proofs[key] = {};
+        sn_list->m_dirty_proofs.insert(key);
       }
 
       if (my_keys && my_keys->pub == key) MGINFO_GREEN("Service node registered (yours): " << key << " on height: " << block_height);
@@ -1029,7 +1173,7 @@ namespace service_nodes
       // NOTE: A node doesn't expire until registration_height + lock blocks excess now which acts as the grace period
       // So it is possible to find the node still in our list.
       bool registered_during_grace_period = false;
-      const auto iter = service_nodes_infos.find(key);
+      const auto iter = std::as_const(service_nodes_infos).find(key);
       if (iter != service_nodes_infos.end())
       {
         if (hf_version >= cryptonote::network_version_10_bulletproofs)
@@ -1998,11 +2142,23 @@ namespace service_nodes
     // TX's included in the block were applied
     //   i.e. before any deregistrations, registrations, decommissions, recommissions.
     //
+    // Taken (leaving sorted_active_infos null) before anything below changes the node list
+    auto prev_active_list = std::move(sorted_active_infos);
+    if (!prev_active_list)
+      prev_active_list = std::make_shared<const std::vector<pubkey_and_sninfo>>(active_service_nodes_infos());
+    block_leader.reset();
+
     crypto::public_key winner_pubkey = cryptonote::get_service_node_winner_from_tx_extra(block.miner_tx.extra);
     if (hf_version >= cryptonote::network_version_16_pulse)
     {
-      std::vector<crypto::hash> entropy = get_pulse_entropy_for_next_block(db, block.prev_id, block.pulse.round);
-      quorum pulse_quorum = generate_pulse_quorum(nettype, winner_pubkey, hf_version, active_service_nodes_infos(), entropy, block.pulse.round);
+      quorum pulse_quorum;
+      if (sn_list)
+        pulse_quorum = sn_list->pulse_quorum_for_next_block(block.prev_id, winner_pubkey, hf_version, *prev_active_list, block.pulse.round);
+      else
+      {
+        std::vector<crypto::hash> entropy = get_pulse_entropy_for_next_block(db, block.prev_id, block.pulse.round);
+        pulse_quorum = generate_pulse_quorum(nettype, winner_pubkey, hf_version, *prev_active_list, entropy, block.pulse.round);
+      }
       if (verify_pulse_quorum_sizes(pulse_quorum))
       {
         // NOTE: Send candidate to the back of the list
@@ -2087,7 +2243,11 @@ namespace service_nodes
     }
 
     // Filtered pubkey-sorted vector of service nodes that are active (fully funded and *not* decommissioned).
-    std::vector<pubkey_and_sninfo> active_snode_list = sort_and_filter(service_nodes_infos, [](const service_node_info &info) { return info.is_active(); });
+    std::vector<pubkey_and_sninfo> active_snode_list = update_active_list(service_nodes_infos, *prev_active_list);
+    bool const active_list_changed = !std::equal(active_snode_list.begin(), active_snode_list.end(),
+        prev_active_list->begin(), prev_active_list->end(),
+        [](const pubkey_and_sninfo &a, const pubkey_and_sninfo &b) { return a.first == b.first; });
+    prev_active_list.reset();
 
     if (need_swarm_update)
     {
@@ -2096,23 +2256,47 @@ namespace service_nodes
       std::memcpy(&seed, block_hash.data, sizeof(seed));
 
       /// Gather existing swarms from infos
-      swarm_snode_map_t existing_swarms;
-      for (const auto &key_info : active_snode_list)
-        existing_swarms[key_info.second->swarm_id].push_back(key_info.first);
+      swarm_snode_map_t existing_swarms = gather_swarms(active_snode_list);
 
       calc_swarm_changes(existing_swarms, seed);
 
       /// Apply changes
       for (const auto& [swarm_id, snodes] : existing_swarms) {
         for (const auto& snode : snodes) {
-          auto& sn_info_ptr = service_nodes_infos.at(snode);
-          if (sn_info_ptr->swarm_id == swarm_id) continue; /// nothing changed for this snode
-          duplicate_info(sn_info_ptr).swarm_id = swarm_id;
+          if (std::as_const(service_nodes_infos).at(snode)->swarm_id == swarm_id) continue; /// nothing changed for this snode
+          duplicate_info(service_nodes_infos.at(snode)).swarm_id = swarm_id;
         }
       }
+
+      for (auto &key_info : active_snode_list)
+        key_info.second = std::as_const(service_nodes_infos).at(key_info.first);
     }
 
+    // Swarm membership only changes with the active list or a swarm update, otherwise the previous
+    // block's index (copied along with the rest of the state) is still correct.
+    if (!swarms || need_swarm_update || active_list_changed)
+      swarms = std::make_shared<const swarm_snode_map_t>(gather_swarms(active_snode_list));
+
     generate_other_quorums(*this, active_snode_list, nettype, hf_version);
+    sorted_active_infos = std::make_shared<const std::vector<pubkey_and_sninfo>>(std::move(active_snode_list));
+    block_leader = std::make_shared<const payout>(get_block_leader());
+  }
+
+  quorum service_node_list::pulse_quorum_for_next_block(const crypto::hash &prev_id, const crypto::public_key &leader, uint8_t hf_version,
+                                                        const std::vector<pubkey_and_sninfo> &active_snode_list, uint8_t round) const
+  {
+    auto &last = m_last_pulse_quorum;
+    {
+      std::lock_guard lock{m_last_pulse_quorum_mutex};
+      if (last.result && last.prev_id == prev_id && last.leader == leader && last.hf_version == hf_version && last.round == round)
+        return *last.result;
+    }
+
+    std::vector<crypto::hash> entropy = get_pulse_entropy_for_next_block(m_blockchain.get_db(), prev_id, round);
+    auto result = std::make_shared<const quorum>(generate_pulse_quorum(m_blockchain.nettype(), leader, hf_version, active_snode_list, entropy, round));
+    std::lock_guard lock{m_last_pulse_quorum_mutex};
+    last = {prev_id, leader, hf_version, round, result};
+    return *result;
   }
 
   void service_node_list::process_block(const cryptonote::block& block, const std::vector<cryptonote::transaction>& txs)
@@ -2166,11 +2350,13 @@ namespace service_nodes
     cryptonote::network_type nettype = m_blockchain.nettype();
     m_transient.state_history.insert(m_transient.state_history.end(), m_state);
     m_state.update_from_block(m_blockchain.get_db(), nettype, m_transient.state_history, m_transient.state_archive, {}, block, txs, m_service_node_keys);
+    publish_registered_infos();
   }
 
   void service_node_list::blockchain_detached(uint64_t height, bool /*by_pop_blocks*/)
   {
     std::lock_guard lock(m_sn_mutex);
+    m_detach_count++;
 
     uint64_t revert_to_height = height - 1;
     bool reinitialise         = false;
@@ -2208,6 +2394,7 @@ namespace service_nodes
     auto it = std::prev(history.end());
     m_state = std::move(*it);
     history.erase(it);
+    publish_registered_infos();
   }
 
   std::vector<crypto::public_key> service_node_list::state_t::get_expired_nodes(cryptonote::BlockchainDB const &db,
@@ -2287,6 +2474,9 @@ namespace service_nodes
 
   service_nodes::payout service_node_list::state_t::get_block_leader() const
   {
+    if (block_leader)
+      return *block_leader;
+
     crypto::public_key key = crypto::null_pkey;
     service_node_info const *info = nullptr;
     {
@@ -2408,8 +2598,14 @@ namespace service_nodes
     //
     if (cryptonote::block_has_pulse_components(block))
     {
-      std::vector<crypto::hash> entropy = get_pulse_entropy_for_next_block(m_blockchain.get_db(), block.prev_id, block.pulse.round);
-      quorum pulse_quorum = generate_pulse_quorum(m_blockchain.nettype(), block_leader.key, hf_version, m_state.active_service_nodes_infos(), entropy, block.pulse.round);
+      quorum pulse_quorum;
+      if (block.prev_id == m_state.block_hash)
+        pulse_quorum = pulse_quorum_for_next_block(block.prev_id, block_leader.key, hf_version, m_state.active_service_nodes_infos(), block.pulse.round);
+      else
+      {
+        std::vector<crypto::hash> entropy = get_pulse_entropy_for_next_block(m_blockchain.get_db(), block.prev_id, block.pulse.round);
+        pulse_quorum = generate_pulse_quorum(m_blockchain.nettype(), block_leader.key, hf_version, m_state.active_service_nodes_infos(), entropy, block.pulse.round);
+      }
       if (!verify_pulse_quorum_sizes(pulse_quorum))
       {
         MGINFO_RED("Pulse block received but Pulse has insufficient nodes for quorum, block hash " << cryptonote::get_block_hash(block) << ", height " << height);
@@ -2446,7 +2642,7 @@ namespace service_nodes
     size_t expected_vouts_size                        = 0;
     if (mode == verify_mode::pulse_block_leader_is_producer || mode == verify_mode::pulse_different_block_producer)
     {
-      auto info_it = m_state.service_nodes_infos.find(block_producer_key);
+      auto info_it = std::as_const(m_state.service_nodes_infos).find(block_producer_key);
       if (info_it == m_state.service_nodes_infos.end())
       {
         MGINFO_RED("The pulse block producer for round: " << +block.pulse.round << " is not currently a Service Node: " << block_producer_key);
@@ -2641,7 +2837,10 @@ namespace service_nodes
     return result;
   }
 
-  static service_node_list::state_serialized serialize_service_node_state_object(uint8_t hf_version, service_node_list::state_t const &state, bool only_serialize_quorums = false)
+  // If `base` is given the state is delta encoded against it: only the nodes whose info isn't the
+  // same (shared) object as in `base` are stored, along with the keys of the nodes `base` has that
+  // `state` doesn't.
+  static service_node_list::state_serialized serialize_service_node_state_object(uint8_t hf_version, service_node_list::state_t const &state, bool only_serialize_quorums = false, service_nodes_infos_t const *base = nullptr)
   {
     service_node_list::state_serialized result = {};
     result.version                             = service_node_list::state_serialized::get_version(hf_version);
@@ -2652,9 +2851,25 @@ namespace service_nodes
     if (only_serialize_quorums)
      return result;
 
-    result.infos.reserve(state.service_nodes_infos.size());
-    for (const auto &kv_pair : state.service_nodes_infos)
-      result.infos.emplace_back(kv_pair);
+    if (base)
+    {
+      result.delta = true;
+      for (const auto &kv_pair : state.service_nodes_infos)
+      {
+        auto it = base->find(kv_pair.first);
+        if (it == base->end() || it->second != kv_pair.second)
+          result.infos.emplace_back(kv_pair);
+      }
+      for (const auto &kv_pair : *base)
+        if (!state.service_nodes_infos.count(kv_pair.first))
+          result.removed_infos.push_back(kv_pair.first);
+    }
+    else
+    {
+      result.infos.reserve(state.service_nodes_infos.size());
+      for (const auto &kv_pair : state.service_nodes_infos)
+        result.infos.emplace_back(kv_pair);
+    }
 
     result.key_image_blacklist = state.key_image_blacklist;
     result.block_hash          = state.block_hash;
@@ -2666,6 +2881,8 @@ namespace service_nodes
     if (!m_blockchain.has_db())
         return false; // Haven't been initialized yet
 
+    flush_proofs();
+
     uint8_t hf_version = m_blockchain.get_network_version();
     if (hf_version < cryptonote::network_version_9_service_nodes)
       return true;
@@ -2699,13 +2916,24 @@ namespace service_nodes
     // store their quorums, such that the following states have quorum
     // information preceeding it.
 
+    //
+    // The remaining states are written as deltas against the state before them, with a full
+    // snapshot every SHORT_TERM_FULL_STATE_INTERVAL blocks so that a bad entry doesn't take the
+    // whole chain of states after it down with it.
+
     uint64_t const max_short_term_height = short_term_state_cull_height(hf_version, (m_state.height - 1)) + VOTE_LIFETIME + VOTE_OR_TX_VERIFY_HEIGHT_BUFFER;
+    service_nodes_infos_t const *delta_base = nullptr;
     for (auto it = m_transient.state_history.begin();
          it != m_transient.state_history.end() && it->height <= max_short_term_height;
          it++)
     {
       // TODO(oxen): There are 2 places where we convert a state_t to be a serialized state_t without quorums. We should only do this in one location for clarity.
-      m_transient.cache_short_term_data.states.push_back(serialize_service_node_state_object(hf_version, *it, it->height < max_short_term_height /*only_serialize_quorums*/));
+      bool const only_quorums = it->height < max_short_term_height;
+      if (it->height % SHORT_TERM_FULL_STATE_INTERVAL == 0)
+        delta_base = nullptr;
+      m_transient.cache_short_term_data.states.push_back(serialize_service_node_state_object(hf_version, *it, only_quorums, delta_base));
+      if (!only_quorums && !it->only_loaded_quorums)
+        delta_base = &it->service_nodes_infos;
     }
 
     m_transient.cache_data_blob.clear();
@@ -2902,7 +3130,14 @@ namespace service_nodes
     }
   }
 
-#define REJECT_PROOF(log) do { LOG_PRINT_L2("Rejecting uptime proof from " << proof.pubkey << ": " log); return false; } while (0)
+  static tools::metrics::counter& uptime_proofs_metric(bool accepted)
+  {
+    static auto& accepted_proofs = tools::metrics::get_counter("oxend_uptime_proofs_accepted_total", "Uptime proofs accepted from service nodes");
+    static auto& rejected_proofs = tools::metrics::get_counter("oxend_uptime_proofs_rejected_total", "Uptime proofs from service nodes that were rejected");
+    return accepted ? accepted_proofs : rejected_proofs;
+  }
+
+#define REJECT_PROOF(log) do { LOG_PRINT_L2("Rejecting uptime proof from " << proof.pubkey << ": " log); uptime_proofs_metric(false).inc(); return false; } while (0)
 
   //TODO remove after HF18, snode revision 1
   bool service_node_list::handle_uptime_proof(cryptonote::NOTIFY_UPTIME_PROOF::request const &proof, bool &my_uptime_proof_confirmation, crypto::x25519_public_key &x25519_pkey)
@@ -2926,6 +3161,17 @@ namespace service_nodes
     if (!debug_allow_local_ips && !epee::net_utils::is_ip_public(proof.public_ip))
       REJECT_PROOF("public_ip is not actually public");
 
+    // Most proofs we receive are relayed copies of one we already accepted, so check (again below)
+    // the cheap reasons to reject it before verifying the signatures.
+    {
+      if (!registered_infos()->count(proof.pubkey))
+        REJECT_PROOF("no such service node is currently registered");
+      std::lock_guard lock{m_proofs_mutex};
+      auto it = proofs.find(proof.pubkey);
+      if (it != proofs.end() && now <= std::chrono::system_clock::from_time_t(it->second.timestamp) + std::chrono::seconds{netconf.UPTIME_PROOF_FREQUENCY} / 2)
+        REJECT_PROOF("already received one uptime proof for this node recently");
+    }
+
     //
     // Validate proof signature
     //
@@ -2949,10 +3195,9 @@ namespace service_nodes
     if (proof.qnet_port == 0)
       REJECT_PROOF("invalid quorumnet port in uptime proof");
 
-    auto locks = tools::unique_locks(m_blockchain, m_sn_mutex, m_x25519_map_mutex);
-    auto it = m_state.service_nodes_infos.find(proof.pubkey);
-    if (it == m_state.service_nodes_infos.end())
+    if (!registered_infos()->count(proof.pubkey))
       REJECT_PROOF("no such service node is currently registered");
+    auto locks = tools::unique_locks(m_proofs_mutex, m_x25519_map_mutex);
 
     auto &iproof = proofs[proof.pubkey];
 
@@ -2977,7 +3222,7 @@ namespace service_nodes
 
     auto old_x25519 = iproof.pubkey_x25519;
     if (iproof.update(std::chrono::system_clock::to_time_t(now), proof.public_ip, proof.storage_https_port, proof.storage_omq_port, proof.qnet_port, proof.snode_version, proof.pubkey_ed25519, derived_x25519_pubkey))
-      iproof.store(proof.pubkey, m_blockchain);
+      m_dirty_proofs.insert(proof.pubkey);
 
     if (now - x25519_map_last_pruned >= X25519_MAP_PRUNING_INTERVAL)
     {
@@ -2995,11 +3240,13 @@ namespace service_nodes
     if (derived_x25519_pubkey && (old_x25519 != derived_x25519_pubkey))
       x25519_pkey = derived_x25519_pubkey;
 
+    m_proofs_version++;
+    uptime_proofs_metric(true).inc();
     return true;
   }
 
 #undef REJECT_PROOF
-#define REJECT_PROOF(log) do { LOG_PRINT_L2("Rejecting uptime proof from " << proof->pubkey << ": " log); return false; } while (0)
+#define REJECT_PROOF(log) do { LOG_PRINT_L2("Rejecting uptime proof from " << proof->pubkey << ": " log); uptime_proofs_metric(false).inc(); return false; } while (0)
 
   bool service_node_list::handle_btencoded_uptime_proof(std::unique_ptr<uptime_proof::Proof> proof, bool &my_uptime_proof_confirmation, crypto::x25519_public_key &x25519_pkey)
   {
@@ -3026,6 +3273,17 @@ namespace service_nodes
     if (!debug_allow_local_ips && !epee::net_utils::is_ip_public(proof->public_ip))
       REJECT_PROOF("public_ip is not actually public");
 
+    // Most proofs we receive are relayed copies of one we already accepted, so check (again below)
+    // the cheap reasons to reject it before verifying the signatures.
+    {
+      if (!registered_infos()->count(proof->pubkey))
+        REJECT_PROOF("no such service node is currently registered");
+      std::lock_guard lock{m_proofs_mutex};
+      auto it = proofs.find(proof->pubkey);
+      if (it != proofs.end() && now <= std::chrono::system_clock::from_time_t(it->second.timestamp) + std::chrono::seconds{netconf.UPTIME_PROOF_FREQUENCY} / 2)
+        REJECT_PROOF("already received one uptime proof for this node recently");
+    }
+
     //
     // Validate proof signature
     //
@@ -3048,10 +3306,9 @@ namespace service_nodes
     if (proof->qnet_port == 0)
       REJECT_PROOF("invalid quorumnet port in uptime proof");
 
-    auto locks = tools::unique_locks(m_blockchain, m_sn_mutex, m_x25519_map_mutex);
-    auto it = m_state.service_nodes_infos.find(proof->pubkey);
-    if (it == m_state.service_nodes_infos.end())
+    if (!registered_infos()->count(proof->pubkey))
       REJECT_PROOF("no such service node is currently registered");
+    auto locks = tools::unique_locks(m_proofs_mutex, m_x25519_map_mutex);
 
     auto &iproof = proofs[proof->pubkey];
 
@@ -3075,9 +3332,7 @@ namespace service_nodes
 
     auto old_x25519 = iproof.pubkey_x25519;
     if (iproof.update(std::chrono::system_clock::to_time_t(now), std::move(proof), derived_x25519_pubkey))
-    {
-      iproof.store(iproof.proof->pubkey, m_blockchain);
-    }
+      m_dirty_proofs.insert(iproof.proof->pubkey);
 
     if (now - x25519_map_last_pruned >= X25519_MAP_PRUNING_INTERVAL)
     {
@@ -3095,13 +3350,16 @@ namespace service_nodes
     if (derived_x25519_pubkey && (old_x25519 != derived_x25519_pubkey))
       x25519_pkey = derived_x25519_pubkey;
 
+    m_proofs_version++;
+    uptime_proofs_metric(true).inc();
     return true;
   }
 
   void service_node_list::cleanup_proofs()
   {
     MDEBUG("Cleaning up expired SN proofs");
-    auto locks = tools::unique_locks(m_sn_mutex, m_blockchain);
+    auto infos = registered_infos();
+    auto locks = tools::unique_locks(m_blockchain, m_proofs_mutex);
     uint64_t now = std::time(nullptr);
     auto& db = m_blockchain.get_db();
     cryptonote::db_wtxn_guard guard{db};
@@ -3112,16 +3370,39 @@ namespace service_nodes
       // 6h here because there's no harm in leaving proofs around a bit longer (they aren't big, and
       // we only store one per SN), and it's possible that we could reorg a few blocks and resurrect
       // a service node but don't want to prematurely expire the proof.
-      if (!m_state.service_nodes_infos.count(pubkey) && proof.timestamp + 6*60*60 < now)
+      if (!infos->count(pubkey) && proof.timestamp + 6*60*60 < now)
       {
         db.remove_service_node_proof(pubkey);
+        m_dirty_proofs.erase(pubkey);
         it = proofs.erase(it);
+        m_proofs_version++;
       }
       else
         ++it;
     }
   }
 
+  void service_node_list::flush_proofs()
+  {
+    auto locks = tools::unique_locks(m_blockchain, m_proofs_mutex);
+    if (m_dirty_proofs.empty() || !m_blockchain.has_db())
+      return;
+
+    cryptonote::db_wtxn_guard guard{m_blockchain.get_db()};
+    for (const auto &pubkey : m_dirty_proofs)
+    {
+      auto it = proofs.find(pubkey);
+      if (it != proofs.end())
+        it->second.store(pubkey, m_blockchain);
+    }
+    m_dirty_proofs.clear();
+  }
+
+  void service_node_list::publish_registered_infos()
+  {
+    std::atomic_store(&m_registered_infos, std::make_shared<const service_nodes_infos_t>(m_state.service_nodes_infos));
+  }
+
   crypto::public_key service_node_list::get_pubkey_from_x25519(const crypto::x25519_public_key &x25519) const {
     std::shared_lock lock{m_x25519_map_mutex};
     auto it = x25519_to_pub.find(x25519);
@@ -3141,10 +3422,11 @@ namespace service_nodes
   }
 
   void service_node_list::initialize_x25519_map() {
-    auto locks = tools::unique_locks(m_sn_mutex, m_x25519_map_mutex);
+    auto infos = registered_infos();
+    auto locks = tools::unique_locks(m_proofs_mutex, m_x25519_map_mutex);
 
     auto now = std::time(nullptr);
-    for (const auto &pk_info : m_state.service_nodes_infos)
+    for (const auto &pk_info : *infos)
     {
       auto it = proofs.find(pk_info.first);
       if (it == proofs.end())
@@ -3189,22 +3471,22 @@ namespace service_nodes
 
   void service_node_list::record_checkpoint_participation(crypto::public_key const &pubkey, uint64_t height, bool participated)
   {
-    std::lock_guard lock(m_sn_mutex);
-    if (!m_state.service_nodes_infos.count(pubkey))
+    if (!registered_infos()->count(pubkey))
       return;
 
     participation_entry entry  = {};
     entry.height               = height;
     entry.voted                = participated;
 
+    std::lock_guard lock{m_proofs_mutex};
     auto &info = proofs[pubkey];
     info.checkpoint_participation.add(entry);
+    m_proofs_version++;
   }
 
   void service_node_list::record_pulse_participation(crypto::public_key const &pubkey, uint64_t height, uint8_t round, bool participated)
   {
-    std::lock_guard lock(m_sn_mutex);
-    if (!m_state.service_nodes_infos.count(pubkey))
+    if (!registered_infos()->count(pubkey))
       return;
 
     participation_entry entry  = {};
@@ -3213,34 +3495,38 @@ namespace service_nodes
     entry.voted                = participated;
     entry.pulse.round          = round;
 
+    std::lock_guard lock{m_proofs_mutex};
     auto &info = proofs[pubkey];
     info.pulse_participation.add(entry);
+    m_proofs_version++;
   }
 
   void service_node_list::record_timestamp_participation(crypto::public_key const &pubkey, bool participated)
   {
-    std::lock_guard lock(m_sn_mutex);
-    if (!m_state.service_nodes_infos.count(pubkey))
+    if (!registered_infos()->count(pubkey))
       return;
 
     timestamp_participation_entry entry  = {};
     entry.participated                = participated;
 
+    std::lock_guard lock{m_proofs_mutex};
     auto &info = proofs[pubkey];
     info.timestamp_participation.add(entry);
+    m_proofs_version++;
   }
 
   void service_node_list::record_timesync_status(crypto::public_key const &pubkey, bool synced)
   {
-    std::lock_guard lock(m_sn_mutex);
-    if (!m_state.service_nodes_infos.count(pubkey))
+    if (!registered_infos()->count(pubkey))
       return;
 
     timesync_entry entry  = {};
     entry.in_sync                = synced;
 
+    std::lock_guard lock{m_proofs_mutex};
     auto &info = proofs[pubkey];
     info.timesync_status.add(entry);
+    m_proofs_version++;
   }
 
   std::optional<bool> proof_info::reachable_stats::reachable(const std::chrono::steady_clock::time_point& now) const {
@@ -3265,11 +3551,9 @@ namespace service_nodes
 
     // (See .h for overview description)
 
-    std::lock_guard lock(m_sn_mutex);
-
     const auto type = storage_server ? "storage server"sv : "lokinet"sv;
 
-    if (!m_state.service_nodes_infos.count(pubkey)) {
+    if (!registered_infos()->count(pubkey)) {
       MDEBUG("Dropping " << type << " reachable report: " << pubkey << " is not a registered SN pubkey");
       return false;
     }
@@ -3278,6 +3562,7 @@ namespace service_nodes
 
     const auto now = std::chrono::steady_clock::now();
 
+    std::lock_guard lock{m_proofs_mutex};
     auto& reach = storage_server ? proofs[pubkey].ss_reachable : proofs[pubkey].lokinet_reachable;
     if (reachable) {
       reach.last_reachable = now;
@@ -3287,6 +3572,7 @@ namespace service_nodes
       if (reach.first_unreachable == NEVER)
         reach.first_unreachable = now;
     }
+    m_proofs_version++;
 
     return true;
 
@@ -3383,7 +3669,7 @@ namespace service_nodes
     uint64_t bytes_loaded = 0;
     auto &db = m_blockchain.get_db();
     cryptonote::db_rtxn_guard txn_guard{db};
-    std::string blob;
+    std::string_view blob; // points into the db, so only valid while txn_guard is held
     if (db.get_service_node_data(blob, true /*long_term*/))
     {
       bytes_loaded += blob.size();
@@ -3517,22 +3803,65 @@ namespace service_nodes
       }
       else
       {
+        service_nodes_infos_t const *delta_base = nullptr;
+        auto load_state = [&](state_serialized &&entry) -> std::optional<state_t> {
+          bool const delta   = entry.delta;
+          auto removed_infos = std::move(entry.removed_infos);
+          state_t result{this, std::move(entry)};
+          if (delta)
+          {
+            if (!delta_base)
+            {
+              LOG_PRINT_L0("Serialised state at height " << result.height << " is a delta without a preceding state, failed to load from DB");
+              return std::nullopt;
+            }
+            service_nodes_infos_t infos = *delta_base;
+            for (const auto &pubkey : removed_infos)
+              infos.erase(pubkey);
+            for (const auto &kv_pair : result.service_nodes_infos)
+              infos[kv_pair.first] = kv_pair.second;
+            result.service_nodes_infos = std::move(infos);
+          }
+          return result;
+        };
+
         size_t const last_index  = data_in.states.size() - 1;
         for (size_t i = 0; i < last_index; i++)
         {
           state_serialized &entry = data_in.states[i];
           if (entry.block_hash == crypto::null_hash) entry.block_hash = m_blockchain.get_block_id_by_height(entry.height);
-          m_transient.state_history.emplace_hint(m_transient.state_history.end(), this, std::move(entry));
+          auto state = load_state(std::move(entry));
+          if (!state)
+            return false;
+          auto it = m_transient.state_history.emplace_hint(m_transient.state_history.end(), std::move(*state));
+          if (!it->only_loaded_quorums)
+            delta_base = &it->service_nodes_infos;
         }
 
-        m_state = {this, std::move(data_in.states[last_index])};
+        auto state = load_state(std::move(data_in.states[last_index]));
+        if (!state)
+          return false;
+        m_state = std::move(*state);
       }
     }
 
+    publish_registered_infos();
+
     // NOTE: Load uptime proof data
-    proofs = db.get_all_service_node_proofs();
+    {
+      std::lock_guard lock{m_proofs_mutex};
+      auto loaded = db.get_all_service_node_proofs();
+      for (const auto &pubkey : m_dirty_proofs) // Not yet flushed, so newer than what's in the db
+      {
+        auto it = proofs.find(pubkey);
+        if (it != proofs.end())
+          loaded[pubkey] = std::move(it->second);
+      }
+      proofs = std::move(loaded);
+    }
     if (m_service_node_keys)
     {
+      std::lock_guard lock{m_proofs_mutex};
       // Reset our own proof timestamp to zero so that we aggressively try to resend proofs on
       // startup (in case we are restarting because the last proof that we think went out didn't
       // actually make it to the network).
@@ -3563,6 +3892,7 @@ namespace service_nodes
     }
 
     m_state.height = hard_fork_begins(m_blockchain.nettype(), cryptonote::network_version_9_service_nodes).value_or(1) - 1;
+    publish_registered_infos();
   }
 
   size_t service_node_info::total_num_locked_contributions() const
@@ -28,16 +28,23 @@
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <memory>
 #include <mutex>
 #include <shared_mutex>
 #include <string_view>
+#include <unordered_set>
 #include "serialization/serialization.h"
 #include "cryptonote_basic/cryptonote_basic_impl.h"
 #include "cryptonote_core/service_node_rules.h"
 #include "cryptonote_core/service_node_voting.h"
 #include "cryptonote_core/service_node_quorum_cop.h"
+#include "cryptonote_core/service_node_swarm.h"
 #include "common/util.h"
+#include "common/cow_hash_map.h"
+#include "common/lock_stats.h"
+#include "common/metrics.h"
 
 namespace cryptonote
 {
@@ -109,29 +116,25 @@ namespace service_nodes
   template <typename ValueType, size_t Count = QUORUM_VOTE_CHECK_COUNT>
   struct participation_history {
     std::array<ValueType, Count> array;
-    size_t write_index;
+    size_t write_index = 0;
+    size_t failures    = 0; // Number of entries currently in `array` that don't pass()
 
-    void reset() { write_index = 0; }
+    void reset() { write_index = 0; failures = 0; }
 
-    void add(ValueType &entry)
+    void add(const ValueType &entry)
     {
-      size_t real_write_index = write_index % array.size();
-      array[real_write_index] = entry;
+      ValueType &slot = array[write_index % array.size()];
+      if (write_index >= array.size() && !slot.pass())
+        failures--;
+      slot = entry;
+      if (!entry.pass())
+        failures++;
       write_index++;
     }
 
-    bool check_participation(uint16_t threshold)
+    bool check_participation(uint16_t threshold) const
     {
-      if (this->write_index >= Count)
-      {
-        int failed_counter = 0;
-        for (ValueType &entry : array)
-          if (!entry.pass()) failed_counter++;
-
-        if (failed_counter > threshold)
-          return false;
-      }
-      return true;
+      return write_index < Count || failures <= threshold;
     }
 
     ValueType *begin()       { return array.data(); }
@@ -367,7 +370,9 @@ namespace service_nodes
   };
 
   using pubkey_and_sninfo     =          std::pair<crypto::public_key, std::shared_ptr<const service_node_info>>;
-  using service_nodes_infos_t = std::unordered_map<crypto::public_key, std::shared_ptr<const service_node_info>>;
+  // Copy-on-write so that the many stored states (one per recent height, plus alt chain states)
+  // share the entries that didn't change between them.
+  using service_nodes_infos_t = tools::cow_hash_map<crypto::public_key, std::shared_ptr<const service_node_info>>;
 
   struct service_node_pubkey_info
   {
@@ -459,6 +464,9 @@ namespace service_nodes
 
     bool block_added(const cryptonote::block& block, const std::vector<cryptonote::transaction>& txs, cryptonote::checkpoint_t const *checkpoint) override;
     void blockchain_detached(uint64_t height, bool by_pop_blocks) override;
+    /// Incremented by every blockchain_detached; lets users caching values derived from the list
+    /// (such as quorums) detect that blocks they were derived from may have been replaced.
+    uint64_t detach_count() const { return m_detach_count.load(); }
     void init() override;
     bool validate_miner_tx(cryptonote::block const &block, cryptonote::block_reward_parts const &base_reward) const override;
     bool alt_block_added(const cryptonote::block& block, const std::vector<cryptonote::transaction>& txs, cryptonote::checkpoint_t const *checkpoint) override;
@@ -478,6 +486,12 @@ namespace service_nodes
     bool                          get_quorum_pubkey(quorum_type type, quorum_group group, uint64_t height, size_t quorum_index, crypto::public_key &key) const;
 
     size_t get_service_node_count() const;
+    /// Hash of the registered nodes (pubkey, registration height and active/decommissioned height,
+    /// in pubkey order) as of the current height; committed to by the compiled-in fast sync data.
+    crypto::hash state_hash() const;
+    /// Returns the pubkey-sorted active members of the swarm of the given active service node
+    /// (including itself), or an empty list if it isn't an active service node.
+    std::vector<crypto::public_key> get_swarm_members(const crypto::public_key &pubkey) const;
     std::vector<service_node_pubkey_info> get_service_node_list_state(const std::vector<crypto::public_key> &service_node_pubkeys = {}) const;
     const std::vector<key_image_blacklist_entry> &get_blacklisted_key_images() const { return m_state.key_image_blacklist; }
 
@@ -486,12 +500,16 @@ namespace service_nodes
     /// at all for the given pubkey then Func will not be called.
     template <typename Func>
     void access_proof(const crypto::public_key &pubkey, Func f) const {
-      std::unique_lock lock{m_sn_mutex};
+      std::unique_lock lock{m_proofs_mutex};
       auto it = proofs.find(pubkey);
       if (it != proofs.end())
         f(it->second);
     }
 
+    /// Changes whenever any node's proof data (uptime proof, reachability, participation history)
+    /// does, so that callers can tell whether something they built from it is still current.
+    uint64_t proofs_version() const { return m_proofs_version; }
+
     /// Returns the (monero curve) pubkey associated with a x25519 pubkey.  Returns a null public
     /// key if not found.  (Note: this is just looking up the association, not derivation).
     crypto::public_key get_pubkey_from_x25519(const crypto::x25519_public_key &x25519) const;
@@ -506,17 +524,18 @@ namespace service_nodes
     /// returns that service node's quorumnet contact information, if we have it, else empty string.
     std::string remote_lookup(std::string_view x25519_pk);
 
-    /// Does something read-only for each registered service node in the range of pubkeys.  The SN
-    /// lock is held while iterating, so the "something" should be quick.  Func should take
+    /// Does something read-only for each registered service node in the range of pubkeys.  The
+    /// proofs lock is held while iterating, so the "something" should be quick.  Func should take
     /// arguments:
     ///     (const crypto::public_key&, const service_node_info&, const proof_info&)
     /// Unknown public keys are skipped.
     template <typename It, typename Func>
     void for_each_service_node_info_and_proof(It begin, It end, Func f) const {
       static const proof_info empty_proof{};
-      std::lock_guard lock{m_sn_mutex};
-      for (auto sni_end = m_state.service_nodes_infos.end(); begin != end; ++begin) {
-        auto it = m_state.service_nodes_infos.find(*begin);
+      auto infos = registered_infos();
+      std::lock_guard lock{m_proofs_mutex};
+      for (auto sni_end = infos->end(); begin != end; ++begin) {
+        auto it = infos->find(*begin);
         if (it != sni_end) {
           auto pit = proofs.find(it->first);
           f(it->first, *it->second, (pit != proofs.end() ? pit->second : empty_proof));
@@ -527,8 +546,9 @@ namespace service_nodes
     /// Copies x25519 pubkeys (as strings) of all currently active SNs into the given output iterator
     template <typename OutputIt>
     void copy_active_x25519_pubkeys(OutputIt out) const {
-      std::lock_guard lock{m_sn_mutex};
-      for (const auto& pk_info : m_state.service_nodes_infos) {
+      auto infos = registered_infos();
+      std::lock_guard lock{m_proofs_mutex};
+      for (const auto& pk_info : *infos) {
         if (!pk_info.second->is_active())
           continue;
         auto it = proofs.find(pk_info.first);
@@ -569,6 +589,9 @@ namespace service_nodes
     // Called every hour to remove proofs for expired SNs from memory and the database.
     void cleanup_proofs();
 
+    // Writes proofs changed since the last call to the database; called periodically and on store().
+    void flush_proofs();
+
     // Called via RPC from storage server/lokinet to report a ping test result for a remote storage
     // server/lokinet.
     //
@@ -631,8 +654,8 @@ namespace service_nodes
 
     struct state_serialized
     {
-      enum struct version_t : uint8_t { version_0, version_1_serialize_hash, count, };
-      static version_t get_version(uint8_t /*hf_version*/) { return version_t::version_1_serialize_hash; }
+      enum struct version_t : uint8_t { version_0, version_1_serialize_hash, version_2_delta, count, };
+      static version_t get_version(uint8_t /*hf_version*/) { return version_t::version_2_delta; }
 
       version_t                              version;
       uint64_t                               height;
@@ -641,6 +664,10 @@ namespace service_nodes
       quorum_for_serialization               quorums;
       bool                                   only_stored_quorums;
       crypto::hash                           block_hash;
+      // If set, `infos` holds only the nodes added or changed since the preceding state (that isn't
+      // only_stored_quorums) in the same blob, and `removed_infos` the nodes it had that this doesn't.
+      bool                                   delta;
+      std::vector<crypto::public_key>        removed_infos;
 
       BEGIN_SERIALIZE()
         ENUM_FIELD(version, version < version_t::count)
@@ -652,6 +679,12 @@ namespace service_nodes
 
         if (version >= version_t::version_1_serialize_hash)
           FIELD(block_hash);
+
+        if (version >= version_t::version_2_delta)
+        {
+          FIELD(delta)
+          FIELD(removed_infos)
+        }
       END_SERIALIZE()
     };
 
@@ -684,6 +717,13 @@ namespace service_nodes
       block_height                           height{0};
       mutable quorum_manager                 quorums;          // Mutable because we are allowed to (and need to) change it via std::set iterator
       service_node_list*                     sn_list;
+      // The pubkey-sorted active nodes in service_nodes_infos, as left by update_from_block (null
+      // for a state that was loaded rather than updated).
+      std::shared_ptr<const std::vector<pubkey_and_sninfo>> sorted_active_infos;
+      // The active nodes of each swarm, pubkey-sorted; maintained alongside sorted_active_infos.
+      std::shared_ptr<const swarm_snode_map_t> swarms;
+      // get_block_leader()'s result, set by update_from_block (null for a loaded state).
+      std::shared_ptr<const payout> block_leader;
 
       state_t(service_node_list* snl) : sn_list{snl} {}
       state_t(service_node_list* snl, state_serialized &&state);
@@ -694,6 +734,7 @@ namespace service_nodes
 
       std::vector<pubkey_and_sninfo>  active_service_nodes_infos() const;
       std::vector<pubkey_and_sninfo>  decommissioned_service_nodes_infos() const; // return: All nodes that are fully funded *and* decommissioned.
+      std::vector<crypto::public_key> swarm_members(swarm_id_t swarm_id) const;
       std::vector<crypto::public_key> get_expired_nodes(cryptonote::BlockchainDB const &db, cryptonote::network_type nettype, uint8_t hf_version, uint64_t block_height) const;
       void update_from_block(
           cryptonote::BlockchainDB const &db,
@@ -740,7 +781,18 @@ namespace service_nodes
     void reset(bool delete_db_entry = false);
     bool load(uint64_t current_height);
 
-    mutable std::recursive_mutex  m_sn_mutex;
+    // Publishes the current service node infos for the proof handling and lookups that don't take
+    // m_sn_mutex; called under m_sn_mutex whenever m_state changes.
+    void publish_registered_infos();
+    std::shared_ptr<const service_nodes_infos_t> registered_infos() const { return std::atomic_load(&m_registered_infos); }
+
+    // Returns the Pulse quorum of a block with the given leader and round on top of `prev_id`, where
+    // `active_snode_list` is that of the state after `prev_id`.  Validating a Pulse block's miner tx
+    // and then applying the block need the same quorum, so the last one generated is kept.
+    quorum pulse_quorum_for_next_block(const crypto::hash &prev_id, const crypto::public_key &leader, uint8_t hf_version,
+                                       const std::vector<pubkey_and_sninfo> &active_snode_list, uint8_t round) const;
+
+    mutable tools::instrumented_mutex<std::recursive_mutex> m_sn_mutex{"service_node_list"};
     cryptonote::Blockchain&       m_blockchain;
     const service_node_keys      *m_service_node_keys;
     uint64_t                      m_store_quorum_history = 0;
@@ -749,7 +801,24 @@ namespace service_nodes
     /// Maps x25519 pubkeys to registration pubkeys + last block seen value (used for expiry)
     std::unordered_map<crypto::x25519_public_key, std::pair<crypto::public_key, time_t>> x25519_to_pub;
     std::chrono::system_clock::time_point x25519_map_last_pruned = std::chrono::system_clock::from_time_t(0);
+
+    // Guards `proofs` and `m_dirty_proofs`.  When also taking m_sn_mutex, take that first.
+    mutable std::mutex m_proofs_mutex;
     std::unordered_map<crypto::public_key, proof_info> proofs;
+    std::unordered_set<crypto::public_key> m_dirty_proofs; // proofs not yet written to the db
+    std::atomic<uint64_t> m_proofs_version{0};
+    std::atomic<uint64_t> m_detach_count{0};
+    std::shared_ptr<const service_nodes_infos_t> m_registered_infos = std::make_shared<const service_nodes_infos_t>();
+
+    mutable std::mutex m_last_pulse_quorum_mutex;
+    mutable struct
+    {
+      crypto::hash prev_id;
+      crypto::public_key leader;
+      uint8_t hf_version;
+      uint8_t round;
+      std::shared_ptr<const quorum> result;
+    } m_last_pulse_quorum;
 
     struct quorums_by_height
     {
@@ -772,6 +841,10 @@ namespace service_nodes
     } m_transient = {};
 
     state_t m_state; // NOTE: Not in m_transient due to the non-trivial constructor. We can't blanket initialise using = {}; needs to be reset in ::reset(...) manually
+
+    // Estimates the memory held by the states, quorums and proofs; m_sn_mutex must be held
+    size_t memory_usage() const;
+    tools::metrics::registration m_memory_metric; // last, so it is unregistered before what it measures is destroyed
   };
 
   struct staking_components
@@ -85,10 +85,8 @@ namespace service_nodes
     uint64_t timestamp = 0;
     decltype(std::declval<proof_info>().public_ips) ips{};
 
-    service_nodes::participation_history<service_nodes::participation_entry> checkpoint_participation{};
-    service_nodes::participation_history<service_nodes::participation_entry> pulse_participation{};
-    service_nodes::participation_history<service_nodes::timestamp_participation_entry> timestamp_participation{};
-    service_nodes::participation_history<service_nodes::timesync_entry> timesync_status{};
+    // The histories keep running failure counts, so these are evaluated in place rather than copied
+    bool checkpoint_participation = true, pulse_participation = true, timestamp_participation = true, timesync_status = true;
 
     constexpr std::array<uint16_t, 3> MIN_TIMESTAMP_VERSION{9,1,0};
 
@@ -99,12 +97,10 @@ namespace service_nodes
       lokinet_reachable        = !proof.lokinet_reachable.unreachable_for(unreachable_threshold);
       timestamp                = std::max(proof.timestamp, proof.effective_timestamp);
       ips                      = proof.public_ips;
-      checkpoint_participation = proof.checkpoint_participation;
-      pulse_participation      = proof.pulse_participation;
-
-      timestamp_participation  = proof.timestamp_participation;
-      timesync_status          = proof.timesync_status;
-
+      checkpoint_participation = proof.checkpoint_participation.check_participation(CHECKPOINT_MAX_MISSABLE_VOTES);
+      pulse_participation      = proof.pulse_participation.check_participation(PULSE_MAX_MISSABLE_VOTES);
+      timestamp_participation  = proof.timestamp_participation.check_participation(TIMESTAMP_MAX_MISSABLE_VOTES);
+      timesync_status          = proof.timesync_status.check_participation(TIMESYNC_MAX_UNSYNCED_VOTES);
     });
     std::chrono::seconds time_since_last_uptime_proof{std::time(nullptr) - timestamp};
 
@@ -154,24 +150,24 @@ namespace service_nodes
 
     if (!info.is_decommissioned())
     {
-      if (check_checkpoint_obligation && !checkpoint_participation.check_participation(CHECKPOINT_MAX_MISSABLE_VOTES) )
+      if (check_checkpoint_obligation && !checkpoint_participation)
       {
         LOG_PRINT_L1("Service Node: " << pubkey << ", failed checkpoint obligation check");
         result.checkpoint_participation = false;
       }
 
-      if (!pulse_participation.check_participation(PULSE_MAX_MISSABLE_VOTES) )
+      if (!pulse_participation)
       {
         LOG_PRINT_L1("Service Node: " << pubkey << ", failed pulse obligation check");
         result.pulse_participation = false;
       }
 
-      if (!timestamp_participation.check_participation(TIMESTAMP_MAX_MISSABLE_VOTES) )
+      if (!timestamp_participation)
       {
         LOG_PRINT_L1("Service Node: " << pubkey << ", failed timestamp obligation check");
         result.timestamp_participation = false;
       }
-      if (!timesync_status.check_participation(TIMESYNC_MAX_UNSYNCED_VOTES) )
+      if (!timesync_status)
       {
         LOG_PRINT_L1("Service Node: " << pubkey << ", failed timesync obligation check");
         result.timesync_status = false;
@@ -525,6 +521,8 @@ namespace service_nodes
     // These feels out of place here because the hook system sucks: TODO replace it with
     // std::function hooks instead.
     m_core.update_omq_sns();
+    m_core.wake_pulse();
+    m_core.warm_quorumnet_peers(height);
 
     return true;
   }
@@ -666,12 +664,37 @@ namespace service_nodes
   }
 
   bool quorum_cop::handle_vote(quorum_vote_t const &vote, cryptonote::vote_verification_context &vvc)
+  {
+    std::shared_ptr<const quorum> quorum = m_core.get_quorum(vote.type, vote.block_height);
+    return handle_vote(vote, vvc, m_core.get_current_blockchain_height(), quorum.get());
+  }
+
+  bool quorum_cop::handle_votes(std::vector<quorum_vote_t> const &votes, std::vector<cryptonote::vote_verification_context> &vvcs)
+  {
+    vvcs.clear();
+    vvcs.resize(votes.size());
+    uint64_t const latest_height = m_core.get_current_blockchain_height();
+
+    // Bundled votes are mostly for the same one or two quorums
+    std::map<std::pair<quorum_type, uint64_t>, std::shared_ptr<const quorum>> quorums;
+    bool result = true;
+    for (size_t i = 0; i < votes.size(); i++)
+    {
+      auto &vote = votes[i];
+      auto [it, inserted] = quorums.try_emplace(std::make_pair(vote.type, vote.block_height));
+      if (inserted)
+        it->second = m_core.get_quorum(vote.type, vote.block_height);
+      result &= handle_vote(vote, vvcs[i], latest_height, it->second.get());
+    }
+    return result;
+  }
+
+  bool quorum_cop::handle_vote(quorum_vote_t const &vote, cryptonote::vote_verification_context &vvc, uint64_t latest_height, const quorum *quorum)
   {
     vvc = {};
-    if (!verify_vote_age(vote, m_core.get_current_blockchain_height(), vvc))
+    if (!verify_vote_age(vote, latest_height, vvc))
       return false;
 
-    std::shared_ptr<const quorum> quorum = m_core.get_quorum(vote.type, vote.block_height);
     if (!quorum)
     {
       vvc.m_invalid_block_height = true;
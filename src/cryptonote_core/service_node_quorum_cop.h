@@ -124,10 +124,14 @@ namespace service_nodes
     void                       set_votes_relayed  (std::vector<quorum_vote_t> const &relayed_votes);
     std::vector<quorum_vote_t> get_relayable_votes(uint64_t current_height, uint8_t hf_version, bool quorum_relay);
     bool                       handle_vote        (quorum_vote_t const &vote, cryptonote::vote_verification_context &vvc);
+    // Handles a bundle of votes, looking up each quorum involved only once; vvcs is resized to hold
+    // the result of each vote.  Returns false if any vote failed.
+    bool                       handle_votes       (std::vector<quorum_vote_t> const &votes, std::vector<cryptonote::vote_verification_context> &vvcs);
 
     static int64_t calculate_decommission_credit(const service_node_info &info, uint64_t current_height);
 
   private:
+    bool handle_vote(quorum_vote_t const &vote, cryptonote::vote_verification_context &vvc, uint64_t latest_height, const quorum *quorum);
     void process_quorums(cryptonote::block const &block);
     service_node_test_results check_service_node(uint8_t hf_version, const crypto::public_key &pubkey, const service_node_info &info) const;
 
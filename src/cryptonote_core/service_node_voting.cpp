@@ -36,6 +36,7 @@
 #include "checkpoints/checkpoints.h"
 #include "common/util.h"
 #include "common/hex.h"
+#include "common/threadpool.h"
 
 #include "epee/misc_log_ex.h"
 #include "epee/string_tools.h"
@@ -230,6 +231,10 @@ namespace service_nodes
     return true;
   }
 
+  // Below this many signatures verify_quorum_signatures checks them serially, as farming them out to
+  // the threadpool would cost more than it saves.
+  constexpr size_t PARALLEL_QUORUM_SIGNATURE_CHECKS_MIN = 4;
+
   bool verify_quorum_signatures(service_nodes::quorum const &quorum, service_nodes::quorum_type type, uint8_t hf_version, uint64_t height, crypto::hash const &hash, std::vector<quorum_signature> const &signatures, const cryptonote::block* block)
   {
     bool enforce_vote_ordering                          = true;
@@ -333,9 +338,32 @@ namespace service_nodes
         MGINFO("Voter: " << tools::type_to_hex(key) << ", quorum index is duplicated: " << quorum_signature.voter_index << ", failed verification at height: " << height);
         return false;
       }
+    }
+
+    // The signatures are otherwise well-formed, so now check them all at once
+    std::vector<char> valid(signatures.size()); // not vector<bool>: elements get set from different threads
+    auto check_signature = [&](size_t i) {
+      valid[i] = crypto::check_signature(hash, quorum.validators[signatures[i].voter_index], signatures[i].signature);
+    };
+    auto &tpool = tools::threadpool::getInstance();
+    if (signatures.size() >= PARALLEL_QUORUM_SIGNATURE_CHECKS_MIN && tpool.get_max_concurrency() > 1)
+    {
+      tools::threadpool::waiter waiter;
+      for (size_t i = 0; i < signatures.size(); i++)
+        tpool.submit(&waiter, [&check_signature, i] { check_signature(i); }, true);
+      waiter.wait(&tpool);
+    }
+    else
+    {
+      for (size_t i = 0; i < signatures.size(); i++)
+        check_signature(i);
+    }
 
-      if (!crypto::check_signature(hash, key, quorum_signature.signature))
+    for (size_t i = 0; i < signatures.size(); i++)
+    {
+      if (!valid[i])
       {
+        crypto::public_key const &key = quorum.validators[signatures[i].voter_index];
         MGINFO("Incorrect signature for vote, failed verification at height: " << height << " for voter: " << key << "\n" << quorum);
         return false;
       }
@@ -48,6 +48,9 @@
 #include "epee/misc_language.h"
 #include "epee/warnings.h"
 #include "common/perf_timer.h"
+#include "common/memory_usage.h"
+#include "common/metrics.h"
+#include "common/threadpool.h"
 #include "crypto/hash.h"
 
 #undef OXEN_DEFAULT_LOG_CATEGORY
@@ -79,6 +82,17 @@ namespace cryptonote
       return d;
     }
 
+    // Heap storage of a parsed tx prefix: its inputs (and their ring offsets), outputs and extra
+    size_t prefix_heap_bytes(const transaction_prefix &prefix)
+    {
+      size_t bytes = tools::memory::heap_bytes(prefix.vin) + tools::memory::heap_bytes(prefix.vout)
+        + tools::memory::heap_bytes(prefix.extra) + tools::memory::heap_bytes(prefix.output_unlock_times);
+      for (auto &in : prefix.vin)
+        if (auto *in_to_key = std::get_if<txin_to_key>(&in))
+          bytes += tools::memory::heap_bytes(in_to_key->key_offsets);
+      return bytes;
+    }
+
     uint64_t get_transaction_weight_limit(uint8_t version)
     {
       // from v10, bulletproofs, limit a tx to 50% of the minimum block weight
@@ -92,7 +106,28 @@ namespace cryptonote
   // warning: bchs is passed here uninitialized, so don't do anything but store it
   tx_memory_pool::tx_memory_pool(Blockchain& bchs): m_blockchain(bchs), m_txpool_max_weight(DEFAULT_TXPOOL_MAX_WEIGHT), m_txpool_weight(0), m_cookie(0)
   {
-
+    m_weight_metric = tools::metrics::register_gauge("oxend_txpool_weight_bytes", "Total weight of the transactions in the pool", [this] { return get_txpool_weight(); });
+    m_size_metric = tools::metrics::register_gauge("oxend_txpool_transactions", "Number of transactions in the pool", [this] {
+      std::unique_lock lock{m_transactions_lock};
+      return m_txs_by_fee_and_receive_time.size();
+    });
+    m_memory_metric = tools::memory::track("txpool", "Transaction pool indices and parsed tx caches (the tx blobs themselves are in the database)", [this] {
+      std::unique_lock lock{m_transactions_lock};
+      size_t bytes = tools::memory::heap_bytes(m_spent_key_images) + tools::memory::heap_bytes(m_txs_by_fee_and_receive_time)
+        + tools::memory::heap_bytes(m_sorted_tx_index) + tools::memory::heap_bytes(m_input_cache)
+        + tools::memory::heap_bytes(m_parsed_tx_cache) + tools::memory::heap_bytes(m_ready_txs)
+        + tools::memory::heap_bytes(m_timed_out_transactions);
+      for (auto &[txid, info] : m_sorted_tx_index)
+        bytes += prefix_heap_bytes(info.prefix);
+      // The signatures aren't worth walking: the prunable part of the blob is a close enough
+      // stand-in for them
+      for (auto &[txid, tx] : m_parsed_tx_cache)
+        bytes += prefix_heap_bytes(tx) + (tx.is_blob_size_valid() ? tx.blob_size : 0);
+      for (auto &[txid, key_images] : m_ready_txs)
+        bytes += tools::memory::heap_bytes(key_images);
+      std::shared_lock blink_lock{m_blinks_mutex};
+      return bytes + tools::memory::heap_bytes(m_blinks) + m_blinks.size() * sizeof(blink_tx);
+    });
   }
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::have_duplicated_non_standard_tx(transaction const &tx, uint8_t hard_fork_version) const
@@ -394,7 +429,7 @@ namespace cryptonote
           m_blockchain.add_txpool_tx(id, blob, meta);
           if (!insert_key_images(tx, id, opts.kept_by_block))
             return false;
-          m_txs_by_fee_and_receive_time.emplace(std::tuple<bool, double, std::time_t>(non_standard_tx, fee / (double)(tx_weight ? tx_weight : 1), receive_time), id);
+          insert_sorted_tx(id, tx, fee, tx_weight, receive_time, opts.kept_by_block);
           lock.commit();
         }
         catch (const std::exception &e)
@@ -440,7 +475,7 @@ namespace cryptonote
         m_blockchain.add_txpool_tx(id, blob, meta);
         if (!insert_key_images(tx, id, opts.kept_by_block))
           return false;
-        m_txs_by_fee_and_receive_time.emplace(std::tuple<bool, double, std::time_t>(non_standard_tx, fee / (double)(tx_weight ? tx_weight : 1), receive_time), id);
+        insert_sorted_tx(id, tx, fee, tx_weight, receive_time, opts.kept_by_block);
         lock.commit();
       }
       catch (const std::exception &e)
@@ -458,6 +493,8 @@ namespace cryptonote
     m_txpool_weight += tx_weight;
 
     ++m_cookie;
+    static auto& txs_added = tools::metrics::get_counter("oxend_txpool_added_total", "Transactions added to the pool");
+    txs_added.inc();
 
     MINFO("Transaction added to pool: txid " << id << " weight: " << tx_weight << " fee/byte: " << (fee / (double)(tx_weight ? tx_weight : 1)));
 
@@ -502,7 +539,7 @@ namespace cryptonote
     if (result && approved)
     {
       auto lock = blink_unique_lock();
-      m_blinks[txhash] = blink_ptr;
+      m_blinks[txhash] = {blink_ptr, 0};
     }
     else if (!result)
     {
@@ -517,11 +554,13 @@ namespace cryptonote
   bool tx_memory_pool::add_existing_blink(std::shared_ptr<blink_tx> blink_ptr)
   {
     assert(blink_ptr && blink_ptr->approved());
-    auto &ptr = m_blinks[blink_ptr->get_txhash()];
-    if (ptr)
+    auto &entry = m_blinks[blink_ptr->get_txhash()];
+    if (entry.blink)
       return false;
 
-    ptr = blink_ptr;
+    entry.blink = blink_ptr; // The tx may already be mined, so leave the height to be looked up
+    for (auto& notify : m_blink_notify)
+      notify(blink_ptr->get_txhash());
     return true;
   }
   //---------------------------------------------------------------------------------
@@ -529,7 +568,7 @@ namespace cryptonote
   {
     auto it = m_blinks.find(tx_hash);
     if (it != m_blinks.end())
-        return it->second;
+        return it->second.blink;
     return {};
   }
   //---------------------------------------------------------------------------------
@@ -552,46 +591,58 @@ namespace cryptonote
     std::pair<std::vector<crypto::hash>, std::vector<uint64_t>> hnh;
     auto &hashes = hnh.first;
     auto &heights = hnh.second;
+
+    const uint64_t immutable_height = m_blockchain.get_immutable_height();
+    std::vector<crypto::hash> unknown;
+    bool retire = false;
     {
       auto lock = blink_shared_lock();
-      if (!m_blinks.empty())
+      hashes.reserve(m_blinks.size());
+      heights.reserve(m_blinks.size());
+      for (auto &[tx_hash, entry] : m_blinks)
       {
-        hashes.reserve(m_blinks.size());
-        for (auto &b : m_blinks)
-          hashes.push_back(b.first);
+        if (!entry.height)
+          unknown.push_back(tx_hash);
+        else if (*entry.height == 0 /* unmined mempool blink */ || *entry.height > immutable_height)
+        {
+          hashes.push_back(tx_hash);
+          heights.push_back(*entry.height);
+        }
+        else
+          retire = true;
       }
     }
 
-    heights = m_blockchain.get_transactions_heights(hashes);
+    std::vector<uint64_t> unknown_heights;
+    if (!unknown.empty())
+      unknown_heights = m_blockchain.get_transactions_heights(unknown);
+    else if (!retire)
+      return hnh;
 
-    // Filter out (and delete from the blink pool) any blinks that are in immutable blocks
-    const uint64_t immutable_height = m_blockchain.get_immutable_height();
-    size_t next_good = 0;
-    for (size_t i = 0; i < hashes.size(); i++)
+    auto lock = blink_unique_lock();
+    for (size_t i = 0; i < unknown.size(); i++)
     {
-      if (heights[i] > immutable_height || heights[i] == 0 /* unmined mempool blink */)
+      auto it = m_blinks.find(unknown[i]);
+      if (it == m_blinks.end() || it->second.height) // Gone, or set by on_blockchain_inc meanwhile
+        continue;
+      const uint64_t height = unknown_heights[i];
+      it->second.height = height;
+      if (height > 0)
+        m_blinks_by_height[height].push_back(unknown[i]);
+      if (height == 0 || height > immutable_height)
       {
-        // Swap elements into the "good" part of the list so that when we're we'll have divided the
-        // vector into [0, ..., next_good-1] elements containing the parts we want to return, and
-        // [next_good, ...] containing the elements to remove from blink storage.
-        if (i != next_good)
-        {
-          using std::swap;
-          swap(heights[i], heights[next_good]);
-          swap(hashes[i], hashes[next_good]);
-        }
-        next_good++;
+        hashes.push_back(unknown[i]);
+        heights.push_back(height);
       }
     }
 
-    if (next_good < hashes.size())
+    // Delete from the blink pool any blinks that are in immutable blocks
+    while (!m_blinks_by_height.empty() && m_blinks_by_height.begin()->first <= immutable_height)
     {
-      auto lock = blink_unique_lock();
-      for (size_t i = next_good; i < hashes.size(); i++)
-        m_blinks.erase(hashes[i]);
+      for (auto &tx_hash : m_blinks_by_height.begin()->second)
+        m_blinks.erase(tx_hash);
+      m_blinks_by_height.erase(m_blinks_by_height.begin());
     }
-    hashes.resize(next_good);
-    heights.resize(next_good);
 
     return hnh;
   }
@@ -708,18 +759,27 @@ namespace cryptonote
   //---------------------------------------------------------------------------------
   void tx_memory_pool::set_txpool_max_weight(size_t bytes)
   {
-    std::unique_lock lock{m_transactions_lock};
-    m_txpool_max_weight = bytes;
+    bool over;
+    {
+      std::unique_lock lock{m_transactions_lock};
+      m_txpool_max_weight = bytes;
+      over = m_txpool_weight > m_txpool_max_weight;
+    }
+    // Apply a lowered limit now rather than on the next addition
+    if (over)
+      prune();
   }
   //---------------------------------------------------------------------------------
-  bool tx_memory_pool::remove_tx(const crypto::hash &txid, const txpool_tx_meta_t *meta, const sorted_tx_container::iterator *stc_it)
+  bool tx_memory_pool::remove_tx(const crypto::hash &txid)
   {
-    const auto it = stc_it ? *stc_it : find_tx_in_sorted_container(txid);
-    if (it == m_txs_by_fee_and_receive_time.end())
+    const auto info = m_sorted_tx_index.find(txid);
+    if (info == m_sorted_tx_index.end())
     {
       MERROR("Failed to find tx in txpool sorted list");
       return false;
     }
+    const auto it = info->second.it;
+    const size_t weight = info->second.weight;
 
     cryptonote::blobdata tx_blob = m_blockchain.get_txpool_tx_blob(txid);
     cryptonote::transaction_prefix tx;
@@ -729,25 +789,14 @@ namespace cryptonote
       return false;
     }
 
-    txpool_tx_meta_t lookup_meta;
-    if (!meta)
-    {
-      if (m_blockchain.get_txpool_tx_meta(txid, lookup_meta))
-        meta = &lookup_meta;
-      else
-      {
-        MERROR("Failed to find tx in txpool");
-        return false;
-      }
-    }
-
     // remove first, in case this throws, so key images aren't removed
-    const uint64_t tx_fee = std::get<1>(it->first);
-    MINFO("Removing tx " << txid << " from txpool: weight: " << meta->weight << ", fee/byte: " << tx_fee);
+    const double tx_fee = std::get<1>(it->first);
+    MINFO("Removing tx " << txid << " from txpool: weight: " << weight << ", fee/byte: " << tx_fee);
     m_blockchain.remove_txpool_tx(txid);
-    m_txpool_weight -= meta->weight;
+    m_txpool_weight -= weight;
     remove_transaction_keyimages(tx, txid);
-    m_txs_by_fee_and_receive_time.erase(it);
+    erase_sorted_tx(it);
+    notify_removed(txid);
 
     return true;
   }
@@ -763,27 +812,34 @@ namespace cryptonote
 
     // Tries checking conditions for pruning and, if appropriate, removing the tx.
     // Returns false on failure, true for no prune wanted or a successful prune.
-    auto try_pruning = [this, &skip, &changed](auto &it, bool forward) -> bool {
+    auto try_pruning = [this, &skip, &changed](auto &it, bool forward, bool evicting) -> bool {
       try
       {
-        const crypto::hash &txid = it->second;
-        txpool_tx_meta_t meta;
-        if (!m_blockchain.get_txpool_tx_meta(txid, meta))
+        const crypto::hash txid = it->second;
+        const auto info = m_sorted_tx_index.find(txid);
+        if (info == m_sorted_tx_index.end())
         {
-          MERROR("Failed to find tx in txpool");
+          MERROR("Failed to find tx in txpool sorted list");
           return false;
         }
-        auto del_it = forward ? it++ : it--;
+        const size_t weight = info->second.weight;
+        const bool kept_by_block = info->second.kept_by_block;
+        forward ? ++it : --it;
 
         // don't prune the kept_by_block ones, they're likely added because we're adding a block with those
         // don't prune blink txes
         // don't prune the one we just added
-        if (meta.kept_by_block || this->has_blink(txid) || txid == skip)
+        if (kept_by_block || this->has_blink(txid) || txid == skip)
           return true;
 
-        if (this->remove_tx(txid, &meta, &del_it))
+        if (this->remove_tx(txid))
         {
           changed = true;
+          if (evicting)
+          {
+            m_evicted_txes++;
+            m_evicted_weight += weight;
+          }
           return true;
         }
         return false;
@@ -804,7 +860,7 @@ namespace cryptonote
       if (is_standard_tx || receive_time >= unexpired)
         break;
 
-      if (!try_pruning(it, true /*forward*/))
+      if (!try_pruning(it, true /*forward*/, false /*evicting*/))
         return;
     }
 
@@ -814,7 +870,7 @@ namespace cryptonote
       it = std::prev(it);
     while (m_txpool_weight > m_txpool_max_weight && it != m_txs_by_fee_and_receive_time.begin())
     {
-      if (!try_pruning(it, false /*forward*/))
+      if (!try_pruning(it, false /*forward*/, true /*evicting*/))
         return;
     }
     lock.commit();
@@ -829,12 +885,11 @@ namespace cryptonote
     for(const auto& in: tx.vin)
     {
       CHECKED_GET_SPECIFIC_VARIANT(in, txin_to_key, txin, false);
-      std::unordered_set<crypto::hash>& kei_image_set = m_spent_key_images[txin.k_image];
+      key_image_txids& kei_image_set = m_spent_key_images[txin.k_image];
       CHECK_AND_ASSERT_MES(kept_by_block || kei_image_set.size() == 0, false, "internal error: kept_by_block=" << kept_by_block
                                           << ",  kei_image_set.size()=" << kei_image_set.size() << "\ntxin.k_image=" << txin.k_image
                                           << "\ntx_id=" << id );
-      auto ins_res = kei_image_set.insert(id);
-      CHECK_AND_ASSERT_MES(ins_res.second, false, "internal error: try to insert duplicate iterator in key_image set");
+      CHECK_AND_ASSERT_MES(kei_image_set.insert(id), false, "internal error: try to insert duplicate iterator in key_image set");
     }
     ++m_cookie;
     return true;
@@ -854,14 +909,12 @@ namespace cryptonote
       auto it = m_spent_key_images.find(txin.k_image);
       CHECK_AND_ASSERT_MES(it != m_spent_key_images.end(), false, "failed to find transaction input in key images. img=" << txin.k_image
                                     << "\ntransaction id = " << actual_hash);
-      std::unordered_set<crypto::hash>& key_image_set =  it->second;
+      key_image_txids& key_image_set =  it->second;
       CHECK_AND_ASSERT_MES(key_image_set.size(), false, "empty key_image set, img=" << txin.k_image
         << "\ntransaction id = " << actual_hash);
 
-      auto it_in_set = key_image_set.find(actual_hash);
-      CHECK_AND_ASSERT_MES(it_in_set != key_image_set.end(), false, "transaction id not found in key_image set, img=" << txin.k_image
+      CHECK_AND_ASSERT_MES(key_image_set.erase(actual_hash), false, "transaction id not found in key_image set, img=" << txin.k_image
         << "\ntransaction id = " << actual_hash);
-      key_image_set.erase(it_in_set);
       if(!key_image_set.size())
       {
         //it is now empty hash container for this key_image
@@ -914,6 +967,7 @@ namespace cryptonote
       m_txpool_weight -= tx_weight;
       remove_transaction_keyimages(tx, id);
       lock.commit();
+      notify_removed(id);
     }
     catch (const std::exception &e)
     {
@@ -921,8 +975,7 @@ namespace cryptonote
       return false;
     }
 
-    if (sorted_it != m_txs_by_fee_and_receive_time.end())
-      m_txs_by_fee_and_receive_time.erase(sorted_it);
+    erase_sorted_tx(sorted_it);
     ++m_cookie;
     return true;
   }
@@ -938,14 +991,45 @@ namespace cryptonote
     m_tx_notify.push_back(std::move(notify));
   }
 
+  void tx_memory_pool::add_remove_notify(std::function<void(const crypto::hash&)> notify)
+  {
+    std::unique_lock lock{m_transactions_lock};
+    m_tx_remove_notify.push_back(std::move(notify));
+  }
+
+  void tx_memory_pool::add_blink_notify(std::function<void(const crypto::hash&)> notify)
+  {
+    std::unique_lock lock{m_transactions_lock};
+    m_blink_notify.push_back(std::move(notify));
+  }
+
+  void tx_memory_pool::notify_removed(const crypto::hash &txid)
+  {
+    for (auto& notify : m_tx_remove_notify)
+      notify(txid);
+  }
+
   //---------------------------------------------------------------------------------
   sorted_tx_container::iterator tx_memory_pool::find_tx_in_sorted_container(const crypto::hash& id) const
   {
-    return std::find_if( m_txs_by_fee_and_receive_time.begin(), m_txs_by_fee_and_receive_time.end()
-                       , [&](const sorted_tx_container::value_type& a){
-                         return a.second == id;
-                       }
-    );
+    auto it = m_sorted_tx_index.find(id);
+    return it != m_sorted_tx_index.end() ? it->second.it : m_txs_by_fee_and_receive_time.end();
+  }
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::insert_sorted_tx(const crypto::hash &txid, transaction_prefix prefix, uint64_t fee, size_t weight, time_t receive_time, bool kept_by_block)
+  {
+    erase_sorted_tx(find_tx_in_sorted_container(txid));
+    const bool non_standard = !prefix.is_transfer();
+    auto it = m_txs_by_fee_and_receive_time.emplace(std::tuple<bool, double, std::time_t>(non_standard, fee / (double)(weight ? weight : 1), receive_time), txid).first;
+    m_sorted_tx_index[txid] = sorted_tx_info{it, weight, kept_by_block, std::move(prefix)};
+  }
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::erase_sorted_tx(sorted_tx_container::iterator it)
+  {
+    if (it == m_txs_by_fee_and_receive_time.end())
+      return;
+    m_sorted_tx_index.erase(it->second);
+    m_txs_by_fee_and_receive_time.erase(it);
   }
   //---------------------------------------------------------------------------------
   //TODO: investigate whether boolean return is appropriate
@@ -968,7 +1052,7 @@ namespace cryptonote
         }
         else
         {
-          m_txs_by_fee_and_receive_time.erase(sorted_it);
+          erase_sorted_tx(sorted_it);
         }
         m_timed_out_transactions.insert(txid);
         remove.push_back(std::make_pair(txid, meta.weight));
@@ -997,6 +1081,7 @@ namespace cryptonote
             m_blockchain.remove_txpool_tx(txid);
             m_txpool_weight -= entry.second;
             remove_transaction_keyimages(tx, txid);
+            notify_removed(txid);
           }
         }
         catch (const std::exception &e)
@@ -1029,6 +1114,14 @@ namespace cryptonote
         {
           try
           {
+            if (meta.fee == 0)
+            {
+              // Only state changes may be free; check that from the cached prefix before paying
+              // for the blob and full parse.
+              auto info = m_sorted_tx_index.find(txid);
+              if (info != m_sorted_tx_index.end() && info->second.prefix.type != txtype::state_change)
+                return true;
+            }
             cryptonote::blobdata bd = m_blockchain.get_txpool_tx_blob(txid);
             if (meta.fee == 0)
             {
@@ -1141,15 +1234,17 @@ namespace cryptonote
     }, true, include_unrelayed_txes);
   }
   //------------------------------------------------------------------
-  void tx_memory_pool::get_transaction_hashes(std::vector<crypto::hash>& txs, bool include_unrelayed_txes, bool include_only_blinked) const
+  void tx_memory_pool::get_transaction_hashes(std::vector<crypto::hash>& txs, bool include_unrelayed_txes, bool include_only_blinked,
+      std::vector<crypto::hash>* blinked) const
   {
     auto locks = tools::unique_locks(m_transactions_lock, m_blockchain);
 
     txs.reserve(m_blockchain.get_txpool_tx_count(include_unrelayed_txes));
-    m_blockchain.for_all_txpool_txes([&txs, include_only_blinked, this](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata *bd){
-      bool include_tx = true;
-      if (include_only_blinked) include_tx = has_blink(txid);
-      if (include_tx) txs.push_back(txid);
+    m_blockchain.for_all_txpool_txes([&txs, include_only_blinked, blinked, this](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata *bd){
+      bool is_blink = (include_only_blinked || blinked) && has_blink(txid);
+      if (include_only_blinked && !is_blink) return true;
+      txs.push_back(txid);
+      if (blinked && is_blink) blinked->push_back(txid);
       return true;
     }, false, include_unrelayed_txes);
   }
@@ -1199,6 +1294,8 @@ namespace cryptonote
       return true;
     }, false, include_unrelayed_txes);
     stats.bytes_med = epee::misc_utils::median(weights);
+    stats.num_evicted = m_evicted_txes;
+    stats.bytes_evicted = m_evicted_weight;
     if (stats.txs_total > 1)
     {
       /* looking for 98th percentile */
@@ -1299,7 +1396,7 @@ namespace cryptonote
     txpool_tx_meta_t meta;
     for (const key_images_container::value_type& kee : m_spent_key_images) {
       const crypto::key_image& k_image = kee.first;
-      const std::unordered_set<crypto::hash>& kei_image_set = kee.second;
+      const key_image_txids& kei_image_set = kee.second;
       rpc::spent_key_image_info ki{};
       ki.id_hash = tools::type_to_hex(k_image);
       for (const crypto::hash& tx_id_hash : kei_image_set)
@@ -1332,7 +1429,7 @@ namespace cryptonote
     return true;
   }
   //---------------------------------------------------------------------------------
-  bool tx_memory_pool::check_for_key_images(const std::vector<crypto::key_image>& key_images, std::vector<bool>& spent) const
+  bool tx_memory_pool::check_for_key_images(const std::vector<crypto::key_image>& key_images, std::vector<bool>& spent, bool include_unrelayed_txes) const
   {
     auto locks = tools::unique_locks(m_transactions_lock, m_blockchain);
 
@@ -1340,7 +1437,14 @@ namespace cryptonote
 
     for (const auto& image : key_images)
     {
-      spent.push_back(m_spent_key_images.find(image) == m_spent_key_images.end() ? false : true);
+      auto it = m_spent_key_images.find(image);
+      bool found = it != m_spent_key_images.end();
+      if (found && !include_unrelayed_txes)
+        found = std::any_of(it->second.begin(), it->second.end(), [this](const crypto::hash &txid) {
+          txpool_tx_meta_t meta;
+          return m_blockchain.get_txpool_tx_meta(txid, meta) && meta.relayed;
+        });
+      spent.push_back(found);
     }
 
     return true;
@@ -1368,14 +1472,24 @@ namespace cryptonote
     return added;
   }
   //---------------------------------------------------------------------------------
-  bool tx_memory_pool::get_transaction(const crypto::hash& id, cryptonote::blobdata& txblob) const
+  bool tx_memory_pool::get_transaction(const crypto::hash& id, cryptonote::blobdata& txblob, txpool_tx_meta_t* meta) const
   {
-    std::vector<cryptonote::blobdata> found;
-    find_transactions({{id}}, found);
-    if (found.empty())
-      return false;
-    txblob = std::move(found[0]);
-    return true;
+    if (!meta)
+    {
+      std::vector<cryptonote::blobdata> found;
+      find_transactions({{id}}, found);
+      if (found.empty())
+        return false;
+      txblob = std::move(found[0]);
+      return true;
+    }
+
+    auto locks = tools::unique_locks(m_transactions_lock, m_blockchain);
+    try
+    {
+      return m_blockchain.get_txpool_tx_meta(id, *meta) && m_blockchain.get_txpool_tx_blob(id, txblob);
+    }
+    catch (...) { return false; }
   }
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::on_blockchain_inc(block const &blk)
@@ -1384,9 +1498,24 @@ namespace cryptonote
     m_input_cache.clear();
     m_parsed_tx_cache.clear();
 
-    std::vector<transaction> pool_txs;
-    get_transactions(pool_txs);
-    if (pool_txs.empty()) return true;
+    uint64_t const block_height = cryptonote::get_block_height(blk);
+    {
+      auto blink_lock = blink_unique_lock();
+      if (!m_blinks.empty())
+      {
+        for (auto &tx_hash : blk.tx_hashes)
+        {
+          auto it = m_blinks.find(tx_hash);
+          if (it != m_blinks.end() && it->second.height.value_or(0) == 0)
+          {
+            it->second.height = block_height;
+            m_blinks_by_height[block_height].push_back(tx_hash);
+          }
+        }
+      }
+    }
+
+    if (m_sorted_tx_index.empty()) return true;
 
     // NOTE: For transactions in the pool, on new block received, if a Service
     // Node changed state any older state changes that the node cannot
@@ -1395,24 +1524,16 @@ namespace cryptonote
 
     // Otherwise multiple state changes can queue up until they are applicable
     // and be applied on the node.
-    uint64_t const block_height = cryptonote::get_block_height(blk);
     auto &service_node_list = m_blockchain.get_service_node_list();
-    for (transaction const &pool_tx : pool_txs)
+    std::vector<crypto::hash> invalid_state_changes;
+    for (auto const &[tx_hash, info] : m_sorted_tx_index)
     {
+      transaction_prefix const &pool_tx = info.prefix;
       tx_extra_service_node_state_change state_change;
       crypto::public_key service_node_pubkey;
       if (pool_tx.type == txtype::state_change &&
           get_service_node_state_change_from_tx_extra(pool_tx.extra, state_change, blk.major_version))
       {
-        // TODO(oxen): PERF(oxen): On pop_blocks we return all the TXs to the
-        // pool. The greater the pop_blocks, the more txs that are queued in the
-        // pool, and for every subsequent block you sync, get_transactions has
-        // to allocate these transactions and we have to search every
-        // transaction in the pool every synced block- causing great slowdown.
-
-        // It'd be nice to optimise this or rearchitect the way this pruning is
-        // done to be smarter.
-
         if (state_change.block_height >= block_height) // NOTE: Can occur if we pop_blocks and old popped state changes are returned to the pool.
           continue;
 
@@ -1422,38 +1543,27 @@ namespace cryptonote
                                                 state_change.service_node_index,
                                                 service_node_pubkey))
         {
-          crypto::hash tx_hash;
-          if (!get_transaction_hash(pool_tx, tx_hash))
-          {
-            MERROR("Failed to get transaction hash from txpool to check if we can prune a state change");
-            continue;
-          }
-
-          txpool_tx_meta_t meta;
-          if (!m_blockchain.get_txpool_tx_meta(tx_hash, meta))
-          {
-            MERROR("Failed to get tx meta from txpool to check if we can prune a state change");
-            continue;
-          }
-
-          if (meta.kept_by_block) // Do not prune transaction if kept by block (belongs to alt block, so we need incase we switch to alt-chain)
+          if (info.kept_by_block) // Do not prune transaction if kept by block (belongs to alt block, so we need incase we switch to alt-chain)
             continue;
 
           std::vector<service_nodes::service_node_pubkey_info> service_node_array = service_node_list.get_service_node_list_state({service_node_pubkey});
           if (service_node_array.empty() ||
               !service_node_array[0].info->can_transition_to_state(blk.major_version, state_change.block_height, state_change.state))
-          {
-            transaction tx;
-            cryptonote::blobdata blob;
-            size_t tx_weight;
-            uint64_t fee;
-            bool relayed, do_not_relay, double_spend_seen;
-            take_tx(tx_hash, tx, blob, tx_weight, fee, relayed, do_not_relay, double_spend_seen);
-          }
+            invalid_state_changes.push_back(tx_hash);
         }
       }
     }
 
+    for (auto const &tx_hash : invalid_state_changes)
+    {
+      transaction tx;
+      cryptonote::blobdata blob;
+      size_t tx_weight;
+      uint64_t fee;
+      bool relayed, do_not_relay, double_spend_seen;
+      take_tx(tx_hash, tx, blob, tx_weight, fee, relayed, do_not_relay, double_spend_seen);
+    }
+
     return true;
   }
   //---------------------------------------------------------------------------------
@@ -1462,6 +1572,15 @@ namespace cryptonote
     std::unique_lock lock{m_transactions_lock};
     m_input_cache.clear();
     m_parsed_tx_cache.clear();
+
+    // Blinks mined in the popped block(s) are back in the mempool.  Pops are rare, so rather than
+    // work out which blinks those are we forget all mined heights and let them be looked up again.
+    auto blink_lock = blink_unique_lock();
+    for (auto &[height, tx_hashes] : m_blinks_by_height)
+      for (auto &tx_hash : tx_hashes)
+        if (auto it = m_blinks.find(tx_hash); it != m_blinks.end())
+          it->second.height.reset();
+    m_blinks_by_height.clear();
     return true;
   }
   //------------------------------------------------------------------
@@ -1470,9 +1589,8 @@ namespace cryptonote
     std::vector<uint8_t> result(hashes.size(), false);
     auto locks = tools::unique_locks(m_transactions_lock, m_blockchain);
 
-    auto &db = m_blockchain.get_db();
     for (size_t i = 0; i < hashes.size(); i++)
-      result[i] = db.txpool_has_tx(hashes[i]);
+      result[i] = m_blockchain.txpool_has_tx(hashes[i]);
 
     return result;
   }
@@ -1628,7 +1746,7 @@ end:
       const cryptonote::blobdata &txblob;
       const crypto::hash &txid;
       transaction &tx;
-      bool parsed;
+      bool parsed = false;
     } lazy_tx(txblob, txid, tx);
 
     //not the best implementation at this time, sorry :(
@@ -1676,45 +1794,6 @@ end:
     return true;
   }
   //---------------------------------------------------------------------------------
-  /**
-   * @brief check if any of a transaction's spent key images are present in a given set
-   *
-   * @param kic the set of key images to check against
-   * @param tx the transaction to check
-   *
-   * @return true if any key images present in the set, otherwise false
-   */
-  static bool have_key_images(const std::unordered_set<crypto::key_image>& k_images, const transaction_prefix& tx)
-  {
-    for(size_t i = 0; i!= tx.vin.size(); i++)
-    {
-      CHECKED_GET_SPECIFIC_VARIANT(tx.vin[i], txin_to_key, itk, false);
-      if(k_images.count(itk.k_image))
-        return true;
-    }
-    return false;
-  }
-  //---------------------------------------------------------------------------------
-
-  /**
-   * @brief append the key images from a transaction to the given set
-   *
-   * @param kic the set of key images to append to
-   * @param tx the transaction
-   *
-   * @return false if any append fails, otherwise true
-   */
-  static bool append_key_images(std::unordered_set<crypto::key_image>& k_images, const transaction_prefix& tx)
-  {
-    for(size_t i = 0; i!= tx.vin.size(); i++)
-    {
-      CHECKED_GET_SPECIFIC_VARIANT(tx.vin[i], txin_to_key, itk, false);
-      auto i_res = k_images.insert(itk.k_image);
-      CHECK_AND_ASSERT_MES(i_res.second, false, "internal error: key images pool cache - inserted duplicate image in set: " << itk.k_image);
-    }
-    return true;
-  }
-  //---------------------------------------------------------------------------------
   void tx_memory_pool::mark_double_spend(const transaction &tx)
   {
     auto locks = tools::unique_locks(m_transactions_lock, m_blockchain);
@@ -1792,6 +1871,14 @@ end:
     uint64_t next_reward = 0;
     uint64_t net_fee     = 0;
 
+    // A tx found ready to go stays ready for as long as the chain does not change, so we only have
+    // to re-check (and re-parse) txes that were not ready, or are new, since the last template.
+    if (crypto::hash top = m_blockchain.get_tail_id(); top != m_ready_txs_top)
+    {
+      m_ready_txs.clear();
+      m_ready_txs_top = top;
+    }
+
     for (auto sorted_it : m_txs_by_fee_and_receive_time)
     {
       txpool_tx_meta_t meta;
@@ -1841,41 +1928,53 @@ end:
         continue;
       }
 
-      cryptonote::blobdata txblob = m_blockchain.get_txpool_tx_blob(sorted_it.second);
-      cryptonote::transaction tx;
-
-      // Skip transactions that are not ready to be
-      // included into the blockchain or that are
-      // missing key images
-      const cryptonote::txpool_tx_meta_t original_meta = meta;
-      bool ready = false;
-      try
-      {
-        ready = is_transaction_ready_to_go(meta, sorted_it.second, txblob, tx);
-      }
-      catch (const std::exception &e)
-      {
-        MERROR("Failed to check transaction readiness: " << e.what());
-        // continue, not fatal
-      }
-      if (memcmp(&original_meta, &meta, sizeof(meta)))
+      auto ready_it = m_ready_txs.find(sorted_it.second);
+      if (ready_it == m_ready_txs.end())
       {
+        cryptonote::blobdata txblob = m_blockchain.get_txpool_tx_blob(sorted_it.second);
+        cryptonote::transaction tx;
+
+        // Skip transactions that are not ready to be
+        // included into the blockchain or that are
+        // missing key images
+        const cryptonote::txpool_tx_meta_t original_meta = meta;
+        bool ready = false;
         try
         {
-          m_blockchain.update_txpool_tx(sorted_it.second, meta);
+          ready = is_transaction_ready_to_go(meta, sorted_it.second, txblob, tx);
         }
         catch (const std::exception &e)
         {
-          MERROR("Failed to update tx meta: " << e.what());
+          MERROR("Failed to check transaction readiness: " << e.what());
           // continue, not fatal
         }
+        if (memcmp(&original_meta, &meta, sizeof(meta)))
+        {
+          try
+          {
+            m_blockchain.update_txpool_tx(sorted_it.second, meta);
+          }
+          catch (const std::exception &e)
+          {
+            MERROR("Failed to update tx meta: " << e.what());
+            // continue, not fatal
+          }
+        }
+        if (!ready)
+        {
+          LOG_PRINT_L2("  not ready to go");
+          continue;
+        }
+
+        std::vector<crypto::key_image> key_images;
+        for (const auto &in : tx.vin)
+          if (auto *in_to_key = std::get_if<txin_to_key>(&in))
+            key_images.push_back(in_to_key->k_image);
+        ready_it = m_ready_txs.emplace(sorted_it.second, std::move(key_images)).first;
       }
-      if (!ready)
-      {
-        LOG_PRINT_L2("  not ready to go");
-        continue;
-      }
-      if (have_key_images(k_images, tx))
+
+      const auto &key_images = ready_it->second;
+      if (std::any_of(key_images.begin(), key_images.end(), [&k_images](const crypto::key_image &ki) { return k_images.count(ki); }))
       {
         LOG_PRINT_L2("  key images already seen");
         continue;
@@ -1886,7 +1985,7 @@ end:
       raw_fee      += meta.fee;
       net_fee       = next_reward_parts.miner_fee;
       best_reward   = next_reward;
-      append_key_images(k_images, tx);
+      k_images.insert(key_images.begin(), key_images.end());
       LOG_PRINT_L2("  added, new block weight " << total_weight << "/" << max_total_weight << ", reward " << print_money(best_reward));
     }
     lock.commit();
@@ -1938,6 +2037,7 @@ end:
           m_blockchain.remove_txpool_tx(txid);
           m_txpool_weight -= get_transaction_weight(tx, txblob.size());
           remove_transaction_keyimages(tx, txid);
+          notify_removed(txid);
           auto sorted_it = find_tx_in_sorted_container(txid);
           if (sorted_it == m_txs_by_fee_and_receive_time.end())
           {
@@ -1945,7 +2045,7 @@ end:
           }
           else
           {
-            m_txs_by_fee_and_receive_time.erase(sorted_it);
+            erase_sorted_tx(sorted_it);
           }
           ++n_removed;
         }
@@ -1968,38 +2068,55 @@ end:
 
     m_txpool_max_weight = max_txpool_weight ? max_txpool_weight : DEFAULT_TXPOOL_MAX_WEIGHT;
     m_txs_by_fee_and_receive_time.clear();
+    m_sorted_tx_index.clear();
     m_spent_key_images.clear();
     m_txpool_weight = 0;
     std::vector<crypto::hash> remove;
 
+    struct stored_tx
+    {
+      crypto::hash txid;
+      txpool_tx_meta_t meta;
+      cryptonote::blobdata blob;
+      cryptonote::transaction_prefix prefix;
+      bool parsed = false;
+    };
+    std::vector<stored_tx> stored;
+    m_blockchain.for_all_txpool_txes([&stored](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata *bd) {
+      stored.push_back({txid, meta, *bd});
+      return true;
+    }, true);
+
+    // Parsing is nearly all of the work for a large pool, and independent per tx
+    tools::threadpool::getInstance().parallel_for(0, stored.size(), 16, [&stored](size_t i) {
+      stored[i].parsed = parse_and_validate_tx_prefix_from_blob(stored[i].blob, stored[i].prefix);
+      stored[i].blob.clear();
+    }, true);
+
     // first add the not kept by block, then the kept by block,
     // to avoid rejection due to key image collision
     for (int pass = 0; pass < 2; ++pass)
     {
       const bool kept = pass == 1;
-      bool r = m_blockchain.for_all_txpool_txes([this, &remove, kept](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata *bd) {
-        if (kept != (bool)meta.kept_by_block)
-          return true;
-        cryptonote::transaction_prefix tx;
-        if (!parse_and_validate_tx_prefix_from_blob(*bd, tx))
+      for (auto &tx : stored)
+      {
+        if (kept != (bool)tx.meta.kept_by_block)
+          continue;
+        if (!tx.parsed)
         {
           MWARNING("Failed to parse tx from txpool, removing");
-          remove.push_back(txid);
-          return true;
+          remove.push_back(tx.txid);
+          continue;
         }
-        if (!insert_key_images(tx, txid, meta.kept_by_block))
+        if (!insert_key_images(tx.prefix, tx.txid, tx.meta.kept_by_block))
         {
           MFATAL("Failed to insert key images from txpool tx");
           return false;
         }
 
-        const bool non_standard_tx = !tx.is_transfer();
-        m_txs_by_fee_and_receive_time.emplace(std::tuple<bool, double, time_t>(non_standard_tx, meta.fee / (double)meta.weight, meta.receive_time), txid);
-        m_txpool_weight += meta.weight;
-        return true;
-      }, true);
-      if (!r)
-        return false;
+        insert_sorted_tx(tx.txid, std::move(tx.prefix), tx.meta.fee, tx.meta.weight, tx.meta.receive_time, tx.meta.kept_by_block);
+        m_txpool_weight += tx.meta.weight;
+      }
     }
     if (!remove.empty())
     {
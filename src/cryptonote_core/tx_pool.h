@@ -30,15 +30,21 @@
 
 #pragma once
 
+#include <algorithm>
+#include <map>
+#include <optional>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
 #include <queue>
+#include <vector>
 #include <boost/serialization/version.hpp>
 #include <functional>
 
 #include "epee/string_tools.h"
 #include "common/periodic_task.h"
+#include "common/lock_stats.h"
+#include "common/metrics.h"
 #include "cryptonote_basic/cryptonote_basic_impl.h"
 #include "cryptonote_basic/verification_context.h"
 #include "blockchain_db/blockchain_db.h"
@@ -327,6 +333,20 @@ namespace cryptonote
      */
     void add_notify(std::function<void(const crypto::hash&, const transaction&, const std::string& blob, const tx_pool_options&)> notify);
 
+    /**
+     * Specifies a callback to invoke when a transaction leaves the mempool: because it was mined,
+     * pruned, replaced by a conflicting blink, or dropped as stuck or invalid.  Invoked with the
+     * pool lock held.
+     */
+    void add_remove_notify(std::function<void(const crypto::hash&)> notify);
+
+    /**
+     * Specifies a callback to invoke when blink approval arrives for a transaction that is already
+     * in the mempool (see add_existing_blink).  Blink txes that arrive already approved are
+     * reported through add_notify instead.
+     */
+    void add_blink_notify(std::function<void(const crypto::hash&)> notify);
+
     /**
      * @brief locks the transaction pool
      */
@@ -406,9 +426,13 @@ namespace cryptonote
      *
      * @param txs return-by-reference the list of transactions
      * @param include_unrelayed_txes include unrelayed txes in the result
+     * @param include_only_blinked only return approved blink txes
+     * @param blinked if non-null, also return (in the same pass) the subset of `txs` that are
+     * approved blink txes
      *
      */
-    void get_transaction_hashes(std::vector<crypto::hash>& txs, bool include_unrelayed_txes = true, bool include_only_blinked = false) const;
+    void get_transaction_hashes(std::vector<crypto::hash>& txs, bool include_unrelayed_txes = true, bool include_only_blinked = false,
+        std::vector<crypto::hash>* blinked = nullptr) const;
 
     /**
      * @brief get (weight, fee, receive time) for all transaction in the pool
@@ -447,20 +471,22 @@ namespace cryptonote
      *
      * @param key_images [in] vector of key images to check
      * @param spent [out] vector of bool to return
+     * @param include_unrelayed_txes if false, only count key images spent by a relayed tx
      *
      * @return true
      */
-    bool check_for_key_images(const std::vector<crypto::key_image>& key_images, std::vector<bool>& spent) const;
+    bool check_for_key_images(const std::vector<crypto::key_image>& key_images, std::vector<bool>& spent, bool include_unrelayed_txes = true) const;
 
     /**
      * @brief get a specific transaction from the pool
      *
      * @param h the hash of the transaction to get
      * @param tx return-by-reference the transaction blob requested
+     * @param meta if non-null, return-by-pointer the transaction's pool metadata
      *
      * @return true if the transaction is found, otherwise false
      */
-    bool get_transaction(const crypto::hash& h, cryptonote::blobdata& txblob) const;
+    bool get_transaction(const crypto::hash& h, cryptonote::blobdata& txblob, txpool_tx_meta_t* meta = nullptr) const;
 
     /**
      * @brief get specific transactions from the pool
@@ -636,22 +662,19 @@ namespace cryptonote
      * from the mempool because of a conflicting blink transaction arriving.  Transactions lock and
      * blockchain lock must be held by the caller.
      *
-     * @param txid the transaction id to remove
-     * @param meta optional pointer to txpool_tx_meta_t; will be looked up if omitted
-     * @param stc_it an optional iterator to the tx's entry in m_txs_by_fee_and_receive_time to save
-     * a (linear) scan to find it when already available.  The given iterator will be invalidated if
-     * removed.
+     * @param txid the transaction id to remove.  Any iterator to the tx's entry in
+     * m_txs_by_fee_and_receive_time is invalidated.
      *
      * @return true if the transaction was removed, false on failure.
      */
-    bool remove_tx(const crypto::hash &txid, const txpool_tx_meta_t *meta = nullptr, const sorted_tx_container::iterator *stc_it = nullptr);
+    bool remove_tx(const crypto::hash &txid);
 
     /**
      * @brief prune lowest fee/byte txes till we're not above bytes
      *
      * @param skip don't prune the given ID this time (because it was just added)
      */
-    void prune(const crypto::hash &skip);
+    void prune(const crypto::hash &skip = crypto::null_hash);
 
     /**
      * @brief Attempt to add a blink tx "by force", removing conflicting non-blink txs
@@ -682,6 +705,65 @@ namespace cryptonote
      */
     bool remove_blink_conflicts(const crypto::hash &id, const std::vector<crypto::hash> &conflict_txs, uint64_t *blink_rollback_height);
 
+    //! the txids spending a key image.  Nearly always exactly one, which is stored inline so that
+    //! indexing a tx's key images costs one allocation per key image rather than three; only the
+    //! (rare) reorg case described below spills into the vector, which then holds all of them.
+    class key_image_txids
+    {
+    public:
+      const crypto::hash* begin() const { return m_spill.empty() ? &m_first : m_spill.data(); }
+      const crypto::hash* end() const { return begin() + size(); }
+      size_t size() const { return m_spill.empty() ? m_has_first : m_spill.size(); }
+      bool empty() const { return size() == 0; }
+
+      //! adds `txid`; returns false if it was already present
+      bool insert(const crypto::hash &txid)
+      {
+        if (std::find(begin(), end(), txid) != end())
+          return false;
+        if (!m_has_first)
+        {
+          m_first = txid;
+          m_has_first = true;
+        }
+        else
+        {
+          if (m_spill.empty())
+            m_spill.push_back(m_first);
+          m_spill.push_back(txid);
+        }
+        return true;
+      }
+
+      //! removes `txid`; returns false if it wasn't present
+      bool erase(const crypto::hash &txid)
+      {
+        if (m_spill.empty())
+        {
+          if (!m_has_first || m_first != txid)
+            return false;
+          m_has_first = false;
+          return true;
+        }
+        auto it = std::find(m_spill.begin(), m_spill.end(), txid);
+        if (it == m_spill.end())
+          return false;
+        m_spill.erase(it);
+        if (m_spill.size() == 1)
+        {
+          m_first = m_spill.front();
+          m_spill.clear();
+          m_spill.shrink_to_fit();
+        }
+        return true;
+      }
+
+    private:
+      crypto::hash m_first;
+      bool m_has_first = false;
+      std::vector<crypto::hash> m_spill;
+    };
+
     //TODO: confirm the below comments and investigate whether or not this
     //      is the desired behavior
     //! map key images to transactions which spent them
@@ -691,9 +773,9 @@ namespace cryptonote
      *  transaction on the assumption that the original will not be in a
      *  block again.
      */
-    typedef std::unordered_map<crypto::key_image, std::unordered_set<crypto::hash> > key_images_container;
+    typedef std::unordered_map<crypto::key_image, key_image_txids> key_images_container;
 
-    mutable std::recursive_mutex m_transactions_lock;  //!< mutex for the pool
+    mutable tools::instrumented_mutex<std::recursive_mutex> m_transactions_lock{"txpool"};  //!< mutex for the pool
 
     //! container for spent key images from the transactions in the pool
     key_images_container m_spent_key_images;  
@@ -708,8 +790,18 @@ namespace cryptonote
 
     std::atomic<uint64_t> m_cookie; //!< incremented at each change
 
+    //! the pool size metrics
+    tools::metrics::registration m_weight_metric, m_size_metric;
+
     /// Callbacks for new tx notifications
     std::vector<std::function<void(const crypto::hash&, const transaction&, const std::string& blob, const tx_pool_options&)>> m_tx_notify;
+    /// Callbacks for removed tx notifications
+    std::vector<std::function<void(const crypto::hash&)>> m_tx_remove_notify;
+    /// Callbacks for blink approvals of existing txes
+    std::vector<std::function<void(const crypto::hash&)>> m_blink_notify;
+
+    /// Invokes the m_tx_remove_notify callbacks for `txid`
+    void notify_removed(const crypto::hash &txid);
 
     /**
      * @brief get an iterator to a transaction in the sorted container
@@ -720,6 +812,12 @@ namespace cryptonote
      */
     sorted_tx_container::iterator find_tx_in_sorted_container(const crypto::hash& id) const;
 
+    //! adds a tx to m_txs_by_fee_and_receive_time and m_sorted_tx_index (replacing any existing entry)
+    void insert_sorted_tx(const crypto::hash &txid, transaction_prefix prefix, uint64_t fee, size_t weight, time_t receive_time, bool kept_by_block);
+
+    //! removes a tx from m_txs_by_fee_and_receive_time and m_sorted_tx_index; does nothing if `it` is the end iterator
+    void erase_sorted_tx(sorted_tx_container::iterator it);
+
     //! cache/call Blockchain::check_tx_inputs results
     bool check_tx_inputs(const std::function<cryptonote::transaction&()> &get_tx, const crypto::hash &txid, uint64_t &max_used_block_height, crypto::hash &max_used_block_id, tx_verification_context &tvc, bool kept_by_block = false, uint64_t* blink_rollback_height = nullptr) const;
 
@@ -734,18 +832,51 @@ namespace cryptonote
     size_t m_txpool_max_weight;
     size_t m_txpool_weight;
 
+    //! per-tx pool accounting, so that lookups in m_txs_by_fee_and_receive_time and pruning don't
+    //! need a scan or a txpool db lookup per tx.  The parsed prefix is kept too, for the scans that
+    //! only need a tx's type or extra and would otherwise have to fetch and parse every blob.
+    struct sorted_tx_info
+    {
+      sorted_tx_container::iterator it;
+      size_t weight;
+      bool kept_by_block;
+      transaction_prefix prefix;
+    };
+    std::unordered_map<crypto::hash, sorted_tx_info> m_sorted_tx_index;
+
+    uint64_t m_evicted_txes = 0; //!< number of txes pruned to keep the pool within m_txpool_max_weight
+    uint64_t m_evicted_weight = 0; //!< total weight of the txes counted in m_evicted_txes
+
     mutable std::unordered_map<crypto::hash, std::tuple<bool, tx_verification_context, uint64_t, crypto::hash>> m_input_cache;
 
     std::unordered_map<crypto::hash, transaction> m_parsed_tx_cache;
 
+    // The key images of the txes that fill_block_template found ready to go while the chain tip
+    // was m_ready_txs_top; cleared when the tip changes.
+    std::unordered_map<crypto::hash, std::vector<crypto::key_image>> m_ready_txs;
+    crypto::hash m_ready_txs_top = crypto::null_hash;
+
     mutable std::shared_mutex m_blinks_mutex;
 
-    // Contains blink metadata for approved blink transactions. { txhash => blink_tx, ... }.
-    mutable std::unordered_map<crypto::hash, std::shared_ptr<cryptonote::blink_tx>> m_blinks;
+    struct blink_entry
+    {
+      std::shared_ptr<cryptonote::blink_tx> blink;
+      std::optional<uint64_t> height; // mined height (0 if in the mempool), std::nullopt until known
+    };
+    // Contains blink metadata for approved blink transactions. { txhash => {blink_tx, height}, ... }.
+    mutable std::unordered_map<crypto::hash, blink_entry> m_blinks;
+    // The hashes of the m_blinks entries with a known, non-zero mined height, by height, so that
+    // blinks can be retired once their block becomes immutable without looking at each of them.
+    mutable std::map<uint64_t, std::vector<crypto::hash>> m_blinks_by_height;
 
     // Helper method: retrieves hashes and mined heights of blink txes since the immutable block;
     // mempool blinks are included with a height of 0.  Also takes care of cleaning up any blinks
-    // that have become immutable.  Blink lock must not be already held.
+    // that have become immutable.  Only blinks whose height isn't yet known (i.e. that were added
+    // already mined, or were in a block since popped) are looked up in the blockchain.  Blink lock
+    // must not be already held.
     std::pair<std::vector<crypto::hash>, std::vector<uint64_t>> get_blink_hashes_and_mined_heights() const;
+
+    //! the pool memory metric; last, so that it is unregistered before anything it looks at is destroyed
+    tools::metrics::registration m_memory_metric;
   };
 }
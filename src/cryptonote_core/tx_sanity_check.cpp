@@ -26,6 +26,7 @@
 // STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <algorithm>
 #include <stdint.h>
 #include <vector>
 #include "cryptonote_basic/cryptonote_basic.h"
@@ -43,7 +44,8 @@ bool tx_sanity_check(const cryptonote::blobdata &tx_blob, uint64_t rct_outs_avai
 {
   cryptonote::transaction tx;
 
-  if (!cryptonote::parse_and_validate_tx_from_blob(tx_blob, tx))
+  // Only the inputs are looked at, so the prunable part (signatures and range proofs) isn't parsed
+  if (!cryptonote::parse_and_validate_tx_base_from_blob(tx_blob, tx))
   {
     MERROR("Failed to parse transaction");
     return false;
@@ -54,8 +56,7 @@ bool tx_sanity_check(const cryptonote::blobdata &tx_blob, uint64_t rct_outs_avai
     MERROR("Transaction is coinbase");
     return false;
   }
-  std::set<uint64_t> rct_indices;
-  size_t n_indices = 0;
+  std::vector<uint64_t> rct_indices;
 
   for (const auto& txin : tx.vin)
   {
@@ -64,16 +65,16 @@ bool tx_sanity_check(const cryptonote::blobdata &tx_blob, uint64_t rct_outs_avai
       continue;
     if (in_to_key->amount != 0)
       continue;
-    for (uint64_t offset : cryptonote::relative_output_offsets_to_absolute(in_to_key->key_offsets))
-      rct_indices.insert(offset);
-    n_indices += in_to_key->key_offsets.size();
+    auto offsets = cryptonote::relative_output_offsets_to_absolute(in_to_key->key_offsets);
+    rct_indices.insert(rct_indices.end(), offsets.begin(), offsets.end());
   }
 
-  return tx_sanity_check(rct_indices, n_indices, rct_outs_available);
+  return tx_sanity_check(rct_indices, rct_outs_available);
 }
 
-bool tx_sanity_check(const std::set<uint64_t> &rct_indices, size_t n_indices, uint64_t rct_outs_available)
+bool tx_sanity_check(std::vector<uint64_t> &rct_indices, uint64_t rct_outs_available)
 {
+  const size_t n_indices = rct_indices.size();
   if (n_indices <= 10)
   {
     MDEBUG("n_indices is only " << n_indices << ", not checking");
@@ -83,14 +84,15 @@ bool tx_sanity_check(const std::set<uint64_t> &rct_indices, size_t n_indices, ui
   if (rct_outs_available < 10000)
     return true;
 
+  std::sort(rct_indices.begin(), rct_indices.end());
+  rct_indices.erase(std::unique(rct_indices.begin(), rct_indices.end()), rct_indices.end());
   if (rct_indices.size() < n_indices * 8 / 10)
   {
     MERROR("amount of unique indices is too low (amount of rct indices is " << rct_indices.size() << ", out of total " << n_indices << "indices.");
     return false;
   }
 
-  std::vector<uint64_t> offsets(rct_indices.begin(), rct_indices.end());
-  uint64_t median = epee::misc_utils::median(offsets);
+  uint64_t median = epee::misc_utils::median(rct_indices);
   if (median < rct_outs_available * 6 / 10)
   {
     MERROR("median offset index is too low (median is " << median << " out of total " << rct_outs_available << "offsets). Transactions should contain a higher fraction of recent outputs.");
@@ -26,11 +26,14 @@
 // STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
-#include <set>
+#include <cstdint>
+#include <vector>
 #include "cryptonote_basic/blobdatatype.h"
 
 namespace cryptonote
 {
   bool tx_sanity_check(const cryptonote::blobdata &tx_blob, uint64_t rct_outs_available);
-  bool tx_sanity_check(const std::set<uint64_t> &rct_indices, size_t n_indices, uint64_t rct_outs_available);
+  // `rct_indices` holds the global indices of every ring member, duplicates included; it is sorted
+  // and deduplicated in place.
+  bool tx_sanity_check(std::vector<uint64_t> &rct_indices, uint64_t rct_outs_available);
 }
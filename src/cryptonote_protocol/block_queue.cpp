@@ -30,11 +30,13 @@
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
 #include <vector>
+#include <algorithm>
 #include <unordered_map>
 #include <boost/uuid/nil_generator.hpp>
 #include <boost/uuid/uuid_io.hpp>
 #include "epee/string_tools.h"
 #include "cryptonote_protocol_defs.h"
+#include "common/memory_usage.h"
 #include "common/pruning.h"
 #include "block_queue.h"
 
@@ -55,6 +57,60 @@ struct hash<boost::uuids::uuid>
 namespace cryptonote
 {
 
+namespace
+{
+  // spans for slow peers are scaled down to no less than this fraction of the full span size
+  constexpr uint64_t MIN_SPAN_SIZE_DIVISOR = 8;
+  // a span is late once it has been outstanding this many times longer than its peer's rate says
+  // it should take, and it gets re-requested from a peer at least this many times faster
+  constexpr float LATE_SPAN_FACTOR = 3.f;
+  constexpr float FAST_PEER_RATE_FACTOR = 2.f;
+
+  std::unordered_map<boost::uuids::uuid, float> get_rates(const block_queue::block_map &blocks)
+  {
+    std::unordered_map<boost::uuids::uuid, float> speeds;
+    for (const auto &span: blocks)
+    {
+      if (span.blocks.empty())
+        continue;
+      // note that the average below does not average over the whole set, but over the
+      // previous pseudo average and the latest rate: this gives much more importance
+      // to the latest measurements, which is fine here
+      std::unordered_map<boost::uuids::uuid, float>::iterator i = speeds.find(span.connection_id);
+      if (i == speeds.end())
+        speeds.insert(std::make_pair(span.connection_id, span.rate));
+      else
+        i->second = (i->second + span.rate) / 2;
+    }
+    return speeds;
+  }
+}
+
+block_queue::block_queue()
+{
+  size_metric = tools::metrics::register_gauge("oxend_block_queue_bytes", "Size of the downloaded blocks waiting to be added", [this] { return get_data_size(); });
+  spans_metric = tools::metrics::register_gauge("oxend_block_queue_spans", "Downloaded spans of blocks waiting to be added", [this] { return get_num_filled_spans(); });
+  memory_metric = tools::memory::track("block_queue", "Downloaded and requested spans of blocks", [this] { return memory_usage(); });
+}
+
+size_t block_queue::memory_usage() const
+{
+  using tools::memory::heap_bytes;
+  std::unique_lock lock{mutex};
+  size_t bytes = heap_bytes(blocks) + heap_bytes(requested_hashes) + heap_bytes(have_blocks);
+  for (const auto &span : blocks)
+  {
+    bytes += heap_bytes(span.hashes) + heap_bytes(span.blocks);
+    for (const auto &entry : span.blocks)
+    {
+      bytes += heap_bytes(entry.block) + heap_bytes(entry.txs) + heap_bytes(entry.checkpoint) + heap_bytes(entry.blinks);
+      for (const auto &tx : entry.txs)
+        bytes += heap_bytes(tx);
+    }
+  }
+  return bytes;
+}
+
 void block_queue::add_blocks(uint64_t height, std::vector<cryptonote::block_complete_entry> bcel, const boost::uuids::uuid &connection_id, float rate, size_t size)
 {
   std::unique_lock lock{mutex};
@@ -389,6 +445,23 @@ bool block_queue::has_next_span(uint64_t height, bool &filled, std::chrono::stea
   return true;
 }
 
+bool block_queue::get_filled_span_at(uint64_t height, std::vector<cryptonote::block_complete_entry> &bcel, boost::uuids::uuid &connection_id) const
+{
+  std::unique_lock lock{mutex};
+  for (const auto &span: blocks)
+  {
+    if (span.start_block_height > height)
+      break;
+    if (span.start_block_height == height && !span.blocks.empty())
+    {
+      bcel = span.blocks;
+      connection_id = span.connection_id;
+      return true;
+    }
+  }
+  return false;
+}
+
 size_t block_queue::get_data_size() const
 {
   std::unique_lock lock{mutex};
@@ -440,20 +513,7 @@ bool block_queue::has_spans(const boost::uuids::uuid &connection_id) const
 float block_queue::get_speed(const boost::uuids::uuid &connection_id) const
 {
   std::unique_lock lock{mutex};
-  std::unordered_map<boost::uuids::uuid, float> speeds;
-  for (const auto &span: blocks)
-  {
-    if (span.blocks.empty())
-      continue;
-    // note that the average below does not average over the whole set, but over the
-    // previous pseudo average and the latest rate: this gives much more importance
-    // to the latest measurements, which is fine here
-    std::unordered_map<boost::uuids::uuid, float>::iterator i = speeds.find(span.connection_id);
-    if (i == speeds.end())
-      speeds.insert(std::make_pair(span.connection_id, span.rate));
-    else
-      i->second = (i->second + span.rate) / 2;
-  }
+  const auto speeds = get_rates(blocks);
   float conn_rate = -1, best_rate = 0;
   for (const auto &i: speeds)
   {
@@ -473,6 +533,52 @@ float block_queue::get_speed(const boost::uuids::uuid &connection_id) const
   return speed;
 }
 
+uint64_t block_queue::get_span_size(const boost::uuids::uuid &connection_id, uint64_t max_blocks) const
+{
+  // Peers get spans in proportion to how fast they are compared to the fastest one, so that a
+  // slow peer holds up fewer blocks when it gets the next span we need
+  const float speed = get_speed(connection_id);
+  const uint64_t min_blocks = std::max<uint64_t>(1, max_blocks / MIN_SPAN_SIZE_DIVISOR);
+  const uint64_t nblocks = std::clamp<uint64_t>(max_blocks * speed + 0.5f, min_blocks, max_blocks);
+  MTRACE("Span size for " << connection_id << ": " << nblocks << "/" << max_blocks << " (relative speed " << speed << ")");
+  return nblocks;
+}
+
+bool block_queue::is_next_span_late(uint64_t height, const boost::uuids::uuid &connection_id, std::chrono::steady_clock::time_point now) const
+{
+  std::unique_lock lock{mutex};
+  block_map::const_iterator i = blocks.begin();
+  if (i == blocks.end() || i->start_block_height > height || !i->blocks.empty() || i->connection_id == connection_id)
+    return false;
+
+  const auto speeds = get_rates(blocks);
+  const auto holder = speeds.find(i->connection_id), requester = speeds.find(connection_id);
+  if (holder == speeds.end() || requester == speeds.end() || holder->second <= 0)
+    return false; // no measurement for one of them, leave it to the fixed timeouts
+  if (requester->second < holder->second * FAST_PEER_RATE_FACTOR)
+    return false;
+
+  uint64_t bytes = 0, nblocks = 0;
+  for (const auto &span: blocks)
+  {
+    if (span.blocks.empty())
+      continue;
+    bytes += span.size;
+    nblocks += span.nblocks;
+  }
+  if (nblocks == 0)
+    return false;
+
+  // how long the holder should take to send us the span at its measured rate
+  const float expected = bytes * i->nblocks / (float)nblocks / holder->second;
+  const float elapsed = std::chrono::duration<float>{now - i->time}.count();
+  if (elapsed < expected * LATE_SPAN_FACTOR)
+    return false;
+  MDEBUG("Next span " << i->start_block_height << " from " << i->connection_id << " is late: " << elapsed << " s, expected " << expected
+      << " s, " << connection_id << " is faster (" << requester->second << " vs " << holder->second << " b/s)");
+  return true;
+}
+
 float block_queue::get_download_rate(const boost::uuids::uuid &connection_id) const
 {
   std::unique_lock lock{mutex};
@@ -38,6 +38,8 @@
 #include <mutex>
 #include <boost/uuid/uuid.hpp>
 #include "crypto/hash.h"
+#include "common/lock_stats.h"
+#include "common/metrics.h"
 
 #undef OXEN_DEFAULT_LOG_CATEGORY
 #define OXEN_DEFAULT_LOG_CATEGORY "cn.block_queue"
@@ -71,6 +73,7 @@ namespace cryptonote
     typedef std::set<span> block_map;
 
   public:
+    block_queue();
     void add_blocks(uint64_t height, std::vector<cryptonote::block_complete_entry> bcel, const boost::uuids::uuid &connection_id, float rate, size_t size);
     void add_blocks(uint64_t height, uint64_t nblocks, const boost::uuids::uuid &connection_id, std::chrono::steady_clock::time_point time);
     void flush_spans(const boost::uuids::uuid &connection_id, bool all = false);
@@ -88,15 +91,19 @@ namespace cryptonote
     void set_span_hashes(uint64_t start_height, const boost::uuids::uuid &connection_id, std::vector<crypto::hash> hashes);
     bool get_next_span(uint64_t &height, std::vector<cryptonote::block_complete_entry> &bcel, boost::uuids::uuid &connection_id, bool filled = true) const;
     bool has_next_span(uint64_t height, bool &filled, std::chrono::steady_clock::time_point& time, boost::uuids::uuid &connection_id) const;
+    bool get_filled_span_at(uint64_t height, std::vector<cryptonote::block_complete_entry> &bcel, boost::uuids::uuid &connection_id) const;
     size_t get_data_size() const;
     size_t get_num_filled_spans() const;
     crypto::hash get_last_known_hash(const boost::uuids::uuid &connection_id) const;
     bool has_spans(const boost::uuids::uuid &connection_id) const;
     float get_speed(const boost::uuids::uuid &connection_id) const;
     float get_download_rate(const boost::uuids::uuid &connection_id) const;
+    uint64_t get_span_size(const boost::uuids::uuid &connection_id, uint64_t max_blocks) const;
+    bool is_next_span_late(uint64_t height, const boost::uuids::uuid &connection_id, std::chrono::steady_clock::time_point now) const;
     bool foreach(std::function<bool(const span&)> f) const;
     bool requested(const crypto::hash &hash) const;
     bool have(const crypto::hash &hash) const;
+    size_t memory_usage() const;
 
   private:
     void erase_block(block_map::iterator j);
@@ -104,8 +111,9 @@ namespace cryptonote
 
   private:
     block_map blocks;
-    mutable std::recursive_mutex mutex;
+    mutable tools::instrumented_mutex<std::recursive_mutex> mutex{"block_queue"};
     std::unordered_set<crypto::hash> requested_hashes;
     std::unordered_set<crypto::hash> have_blocks;
+    tools::metrics::registration size_metric, spans_metric, memory_metric;
   };
 }
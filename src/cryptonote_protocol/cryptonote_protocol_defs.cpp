@@ -70,6 +70,7 @@ KV_SERIALIZE_MAP_CODE_BEGIN(NOTIFY_RESPONSE_GET_BLOCKS::request)
   KV_SERIALIZE(blocks)
   KV_SERIALIZE_CONTAINER_POD_AS_BLOB(missed_ids)
   KV_SERIALIZE(current_blockchain_height)
+  KV_SERIALIZE(compressed_blocks)
 KV_SERIALIZE_MAP_CODE_END()
 
 KV_SERIALIZE_MAP_CODE_BEGIN(CORE_SYNC_DATA)
@@ -163,6 +163,9 @@ namespace cryptonote
       std::vector<block_complete_entry>  blocks;
       std::vector<crypto::hash>          missed_ids;
       uint64_t                           current_blockchain_height;
+      // Sent instead of `blocks` to a peer with P2P_SUPPORT_FLAG_COMPRESSED_BLOCKS: the zlib
+      // compressed serialization of a request holding only the blocks.
+      std::string                        compressed_blocks;
 
       KV_MAP_SERIALIZABLE
     };
@@ -34,10 +34,20 @@
 
 #pragma once
 
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/io_context_strand.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/program_options/variables_map.hpp>
 #include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "common/periodic_task.h"
 #include "epee/storages/levin_abstract_invoke2.h"
@@ -46,6 +56,7 @@
 #include "cryptonote_protocol_handler_common.h"
 #include "block_queue.h"
 #include "common/perf_timer.h"
+#include "common/trace.h"
 #include "common/meta.h"
 #include "cryptonote_basic/connection_context.h"
 #include <boost/circular_buffer.hpp>
@@ -68,9 +79,9 @@ namespace cryptonote
 
     t_cryptonote_protocol_handler(t_core& rcore, bool offline = false);
 
-    virtual ~t_cryptonote_protocol_handler() = default;
+    virtual ~t_cryptonote_protocol_handler() { deinit(); }
 
-    BEGIN_INVOKE_MAP2(cryptonote_protocol_handler)
+    BEGIN_NAMED_INVOKE_MAP2(cryptonote_protocol_handler, handle_protocol_map)
       HANDLE_NOTIFY_T2(NOTIFY_NEW_TRANSACTIONS, handle_notify_new_transactions)
       HANDLE_NOTIFY_T2(NOTIFY_REQUEST_GET_BLOCKS, handle_request_get_blocks)
       HANDLE_NOTIFY_T2(NOTIFY_RESPONSE_GET_BLOCKS, handle_response_get_blocks)
@@ -86,6 +97,25 @@ namespace cryptonote
       HANDLE_NOTIFY_T2(NOTIFY_RESPONSE_BLOCK_BLINKS, handle_response_block_blinks)
     END_INVOKE_MAP2()
 
+    // Notifications are handled on the protocol worker threads (when there are any) rather than the
+    // network thread that read them, so that block and tx verification doesn't hold up reads from
+    // every other peer.  Each connection has its own strand, so its messages are still handled one
+    // at a time and in the order they arrived.
+    template <class t_context>
+    int handle_invoke_map(bool is_notify, int command, const epee::span<const uint8_t> in_buff, std::string& buff_out, t_context& context, bool& handled)
+    {
+      if (!is_notify || m_workers.empty())
+        return handle_protocol_map(is_notify, command, in_buff, buff_out, context, handled);
+
+      handled = true;
+      queue_work(context.m_connection_id, [this, command, buff = std::string{reinterpret_cast<const char*>(in_buff.data()), in_buff.size()}] (connection_context& c) {
+        bool h = false;
+        std::string out;
+        handle_protocol_map(true, command, epee::strspan<uint8_t>(buff), out, c, h);
+      });
+      return 1;
+    }
+
     bool on_idle();
     bool init(const boost::program_options::variables_map& vm);
     bool deinit();
@@ -108,6 +138,18 @@ namespace cryptonote
     std::string get_peers_overview() const;
     std::pair<uint32_t, uint32_t> get_next_needed_pruning_stripe() const;
     bool needs_new_sync_connections() const;
+
+    // Counters of how incoming fluffy blocks were reconstructed
+    struct fluffy_block_stats
+    {
+      uint64_t received = 0; // new fluffy blocks received (not counting replies to missing tx requests)
+      uint64_t reconstructed = 0; // blocks completed from our pool, chain, and prefilled txes alone
+      uint64_t missing_requests = 0; // blocks for which we had to request missing txes
+      uint64_t missing_txs = 0; // txes requested by those requests
+      uint64_t prefilled_txs = 0; // txes included by the sender along with the block
+      uint64_t prefilled_used = 0; // prefilled txes that were not already in our pool
+    };
+    fluffy_block_stats get_fluffy_block_stats() const { std::lock_guard lock{m_fluffy_stats_mutex}; return m_fluffy_stats; }
   private:
     //----------------- commands handlers ----------------------------------------------
     int handle_notify_new_transactions(int command, NOTIFY_NEW_TRANSACTIONS::request& arg, cryptonote_connection_context& context);
@@ -170,6 +212,11 @@ namespace cryptonote
     int try_add_next_blocks(cryptonote_connection_context &context);
     void notify_new_stripe(cryptonote_connection_context &context, uint32_t stripe);
     void skip_unneeded_hashes(cryptonote_connection_context& context, bool check_block_queue) const;
+    bool handle_callback(cryptonote_connection_context& context);
+
+    // Runs `f` with the connection's context on its strand of the worker threads, unless the
+    // connection has gone away by then.
+    void queue_work(const boost::uuids::uuid& connection_id, std::function<void(connection_context&)> f);
 
     t_core& m_core;
 
@@ -190,6 +237,14 @@ namespace cryptonote
     uint64_t m_sync_spans_downloaded, m_sync_old_spans_downloaded, m_sync_bad_spans_downloaded;
     uint64_t m_sync_download_chain_size, m_sync_download_objects_size;
     size_t m_block_download_max_size;
+    fluffy_block_stats m_fluffy_stats;
+    mutable std::mutex m_fluffy_stats_mutex;
+
+    boost::asio::io_context m_worker_ioc;
+    std::optional<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> m_worker_work;
+    std::vector<std::thread> m_workers;
+    std::mutex m_strands_mutex;
+    std::unordered_map<boost::uuids::uuid, std::shared_ptr<boost::asio::io_context::strand>, boost::hash<boost::uuids::uuid>> m_strands;
 
     // Values for sync time estimates
     std::chrono::steady_clock::time_point m_sync_start_time;
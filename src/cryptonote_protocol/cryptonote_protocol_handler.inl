@@ -41,6 +41,7 @@
 #include <list>
 #include <ctime>
 #include <chrono>
+#include <future>
 
 #include "cryptonote_basic/cryptonote_format_utils.h"
 #include "cryptonote_basic/hardfork.h"
@@ -49,10 +50,12 @@
 #include "cryptonote_core/tx_pool.h"
 #include "epee/profile_tools.h"
 #include "epee/net/network_throttle-detail.hpp"
+#include "common/compression.h"
 #include "common/pruning.h"
 #include "common/random.h"
 #include "common/lock.h"
 #include "common/util.h"
+#include "oxenmq/bt_serialize.h"
 
 #undef OXEN_DEFAULT_LOG_CATEGORY
 #define OXEN_DEFAULT_LOG_CATEGORY "net.cn"
@@ -115,16 +118,59 @@ namespace cryptonote
 
     m_block_download_max_size = command_line::get_arg(vm, cryptonote::arg_block_download_max_size);
 
+    if (const size_t threads = command_line::get_arg(vm, cryptonote::arg_protocol_threads))
+    {
+      m_worker_work.emplace(m_worker_ioc.get_executor());
+      for (size_t i = 0; i < threads; i++)
+        m_workers.emplace_back([this] { m_worker_ioc.run(); });
+      MINFO("Handling p2p protocol messages on " << threads << " worker threads");
+    }
+
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------
   template<class t_core>
   bool t_cryptonote_protocol_handler<t_core>::deinit()
   {
+    // Connections are gone by now, so anything still queued returns right away
+    m_worker_work.reset();
+    for (auto& t : m_workers)
+      t.join();
+    m_workers.clear();
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------
   template<class t_core>
+  void t_cryptonote_protocol_handler<t_core>::queue_work(const boost::uuids::uuid& connection_id, std::function<void(connection_context&)> f)
+  {
+    std::shared_ptr<boost::asio::io_context::strand> strand;
+    {
+      std::lock_guard lock{m_strands_mutex};
+      auto& s = m_strands[connection_id];
+      if (!s)
+        s = std::make_shared<boost::asio::io_context::strand>(m_worker_ioc);
+      strand = s;
+    }
+
+    // The job holds on to the strand, which on_connection_close drops from m_strands
+    boost::asio::post(*strand, [this, strand, connection_id, f = std::move(f)]() mutable {
+      if (m_stopping)
+        return;
+      m_p2p->for_connection(connection_id, [&f](connection_context& context, nodetool::peerid_type, uint32_t) {
+        try
+        {
+          f(context);
+        }
+        catch (const std::exception& e)
+        {
+          LOG_ERROR_CCONTEXT("Exception while handling protocol message: " << e.what());
+        }
+        return true;
+      });
+    });
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
   void t_cryptonote_protocol_handler<t_core>::set_p2p_endpoint(nodetool::i_p2p_endpoint<connection_context>* p2p)
   {
     if(p2p)
@@ -135,6 +181,18 @@ namespace cryptonote
   //------------------------------------------------------------------------------------------------------------------------
   template<class t_core>
   bool t_cryptonote_protocol_handler<t_core>::on_callback(cryptonote_connection_context& context)
+  {
+    // Runs after any messages from the connection that are already queued
+    if (!m_workers.empty())
+    {
+      queue_work(context.m_connection_id, [this] (connection_context& c) { handle_callback(c); });
+      return true;
+    }
+    return handle_callback(context);
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
+  bool t_cryptonote_protocol_handler<t_core>::handle_callback(cryptonote_connection_context& context)
   {
     LOG_PRINT_CCONTEXT_L2("callback fired");
     CHECK_AND_ASSERT_MES_CC( context.m_callback_request_count > 0, false, "false callback fired, but context.m_callback_request_count=" << context.m_callback_request_count);
@@ -557,8 +615,12 @@ namespace cryptonote
   int t_cryptonote_protocol_handler<t_core>::handle_notify_new_fluffy_block(int command, NOTIFY_NEW_FLUFFY_BLOCK::request& arg, cryptonote_connection_context& context)
   {
     MLOGIF_P2P_MESSAGE(crypto::hash hash; cryptonote::block b; bool ret = cryptonote::parse_and_validate_block_from_blob(arg.b.block, b, &hash);, ret, "Received NOTIFY_NEW_FLUFFY_BLOCK " << hash << " (height " << arg.current_blockchain_height << ", " << arg.b.txs.size() << " txes)");
+    TRACE_SPAN(p2p, handle_notify_new_fluffy_block);
     if(context.m_state != cryptonote_connection_context::state_normal)
       return 1;
+    context.m_known_inventory.insert(get_blob_hash(arg.b.block));
+    for (const auto& tx_blob : arg.b.txs)
+      context.m_known_inventory.insert(get_blob_hash(tx_blob));
     if(!is_synchronized() || m_no_sync) // can happen if a peer connection goes to normal but another thread still hasn't finished adding queued blocks
     {
       LOG_DEBUG_CC(context, "Received new block while syncing, ignored");
@@ -593,6 +655,8 @@ namespace cryptonote
       }      
       
       std::vector<blobdata> have_tx;
+      const bool first_notify = context.m_requested_objects.empty();
+      size_t prefilled_used = 0;
       
       // Instead of requesting missing transactions by hash like BTC, 
       // we do it by index (thanks to a suggestion from moneromooo) because
@@ -670,6 +734,7 @@ namespace cryptonote
           if(!m_core.get_pool().have_tx(tx_hash))
           {
             MDEBUG("Incoming tx " << tx_hash << " not in pool, adding");
+            ++prefilled_used;
             cryptonote::tx_verification_context tvc{};
             if(!m_core.handle_incoming_tx(tx_blob, tvc, tx_pool_options::from_block()) || tvc.m_verifivation_failed)
             {
@@ -721,12 +786,20 @@ namespace cryptonote
         return 1;
       }      
       
+      // Txes that only just reached our pool (including any the sender had to give us) are likely
+      // to be missing from our peers' pools too, so we pass them along if we relay the block.
+      std::vector<blobdata> relay_txs;
+      const time_t fresh_since = time(nullptr) - std::chrono::seconds{config::FLUFFY_BLOCK_PREFILL_TX_AGE}.count();
+
       size_t tx_idx = 0;
       for(auto& tx_hash: new_block.tx_hashes)
       {
         cryptonote::blobdata txblob;
-        if(m_core.get_pool().get_transaction(tx_hash, txblob))
+        txpool_tx_meta_t meta;
+        if(m_core.get_pool().get_transaction(tx_hash, txblob, &meta))
         {
+          if (static_cast<time_t>(meta.receive_time) >= fresh_since)
+            relay_txs.push_back(txblob);
           have_tx.push_back(txblob);
         }
         else
@@ -758,6 +831,27 @@ namespace cryptonote
         ++tx_idx;
       }
         
+      {
+        std::lock_guard lock{m_fluffy_stats_mutex};
+        auto& stats = m_fluffy_stats;
+        if (first_notify)
+        {
+          stats.received++;
+          stats.prefilled_txs += arg.b.txs.size();
+          if (need_tx_indices.empty())
+            stats.reconstructed++;
+          else
+          {
+            stats.missing_requests++;
+            stats.missing_txs += need_tx_indices.size();
+          }
+        }
+        stats.prefilled_used += prefilled_used;
+        MDEBUG("Fluffy block with " << new_block.tx_hashes.size() << " txes: " << arg.b.txs.size() << " prefilled (" << prefilled_used << " new to us), "
+            << need_tx_indices.size() << " missing; totals: " << stats.received << " received, " << stats.reconstructed << " reconstructed without requests, "
+            << stats.missing_requests << " needed requests for " << stats.missing_txs << " txes");
+      }
+
       if(!need_tx_indices.empty()) // drats, we don't have everything..
       {
         // request non-mempool txs
@@ -814,7 +908,8 @@ namespace cryptonote
           //TODO: Add here announce protocol usage
           NOTIFY_NEW_FLUFFY_BLOCK::request reg_arg{};
           reg_arg.current_blockchain_height = arg.current_blockchain_height;
-          reg_arg.b = b;
+          reg_arg.b.block = std::move(b.block);
+          reg_arg.b.txs = std::move(relay_txs);
           relay_block(reg_arg, context);
         }
         else if( bvc.m_marked_as_orphaned )
@@ -894,9 +989,21 @@ namespace cryptonote
     // submitted automatically by the daemon itself instead of
     // using my own proof relayed by other nodes.
 
-    (void)context;
     bool my_uptime_proof_confirmation = false;
 
+    // The sender has this proof, so we don't relay it back -- unless it's the service node sending
+    // its own proof (judged by the proof's IP), as the copies relayed back are how it confirms that
+    // the network accepted it.
+    bool from_proof_origin = false;
+    try
+    {
+      oxenmq::bt_dict_consumer proof{arg.proof};
+      from_proof_origin = proof.skip_until("ip") && proof.consume_string_view() == context.m_remote_address.host_str();
+    }
+    catch (const std::exception&) {} // Rejected below
+    if (!from_proof_origin)
+      context.m_known_inventory.insert(crypto::cn_fast_hash(arg.proof.data(), arg.proof.size()));
+
     if (m_core.handle_btencoded_uptime_proof(arg, my_uptime_proof_confirmation))
     {
       if (!my_uptime_proof_confirmation)
@@ -904,7 +1011,8 @@ namespace cryptonote
         // NOTE: The default exclude context contains the peer who sent us this
         // uptime proof, we want to ensure we relay it back so they know that the
         // peer they relayed to received their uptime and confirm it, so send in an
-        // empty context so we don't omit the source peer from the relay back.
+        // empty context so we don't omit the source peer from the relay back (the
+        // known inventory above takes care of not echoing relayed copies).
         cryptonote_connection_context empty_context = {};
         relay_btencoded_uptime_proof(arg, empty_context);
       }
@@ -1061,11 +1169,14 @@ namespace cryptonote
   int t_cryptonote_protocol_handler<t_core>::handle_notify_new_transactions(int command, NOTIFY_NEW_TRANSACTIONS::request& arg, cryptonote_connection_context& context)
   {
     MLOG_P2P_MESSAGE("Received NOTIFY_NEW_TRANSACTIONS (" << arg.txs.size() << " txes w/ " << arg.blinks.size() << " blinks)");
+    TRACE_SPAN(p2p, handle_notify_new_transactions);
     for (const auto &blob: arg.txs)
       MLOGIF_P2P_MESSAGE(cryptonote::transaction tx; crypto::hash hash; bool ret = cryptonote::parse_and_validate_tx_from_blob(blob, tx, hash);, ret, "Including transaction " << hash);
 
     if(context.m_state != cryptonote_connection_context::state_normal)
       return 1;
+    for (const auto& tx_blob : arg.txs)
+      context.m_known_inventory.insert(get_blob_hash(tx_blob));
 
     // while syncing, core will lock for a long time, so we ignore those txes as they aren't really
     // needed anyway, and avoid a long block before replying.  (Not for .requested though: in that
@@ -1186,6 +1297,22 @@ namespace cryptonote
     }
     MLOG_P2P_MESSAGE("-->>NOTIFY_RESPONSE_GET_BLOCKS: blocks.size()=" << rsp.blocks.size()
                             << ", rsp.m_current_blockchain_height=" << rsp.current_blockchain_height << ", missed_ids.size()=" << rsp.missed_ids.size());
+
+    uint32_t support_flags = 0;
+    m_p2p->for_connection(context.m_connection_id, [&support_flags](cryptonote_connection_context&, nodetool::peerid_type, uint32_t f) {
+      support_flags = f;
+      return true;
+    });
+    if (!rsp.blocks.empty() && (support_flags & P2P_SUPPORT_FLAG_COMPRESSED_BLOCKS))
+    {
+      // Runs here, on the protocol worker thread handling this peer (with --protocol-threads)
+      NOTIFY_RESPONSE_GET_BLOCKS::request blocks_only{};
+      blocks_only.blocks = std::move(rsp.blocks);
+      rsp.blocks.clear();
+      const std::string blob = epee::serialization::store_t_to_binary(blocks_only);
+      rsp.compressed_blocks = tools::compress(blob);
+      MDEBUG(context << " compressed " << blocks_only.blocks.size() << " blocks from " << blob.size() << " to " << rsp.compressed_blocks.size() << " bytes");
+    }
     post_notify<NOTIFY_RESPONSE_GET_BLOCKS>(rsp, context);
     return 1;
   }
@@ -1195,6 +1322,20 @@ namespace cryptonote
   template<class t_core>
   int t_cryptonote_protocol_handler<t_core>::handle_response_get_blocks(int command, NOTIFY_RESPONSE_GET_BLOCKS::request& arg, cryptonote_connection_context& context)
   {
+    if (!arg.compressed_blocks.empty())
+    {
+      NOTIFY_RESPONSE_GET_BLOCKS::request blocks_only{};
+      auto blob = tools::decompress(arg.compressed_blocks, LEVIN_DEFAULT_MAX_PACKET_SIZE);
+      if (!blob || !arg.blocks.empty() || !epee::serialization::load_t_from_binary(blocks_only, *blob))
+      {
+        LOG_ERROR_CCONTEXT("sent invalid compressed blocks in NOTIFY_RESPONSE_GET_BLOCKS, dropping connection");
+        drop_connection(context, false, false);
+        return 1;
+      }
+      arg.blocks = std::move(blocks_only.blocks);
+      arg.compressed_blocks.clear();
+    }
+
     MLOG_P2P_MESSAGE("Received NOTIFY_RESPONSE_GET_BLOCKS (" << arg.blocks.size() << " blocks)");
     MLOG_PEER_STATE("received blocks");
 
@@ -1311,7 +1452,7 @@ namespace cryptonote
       seconds_f dt = now - request_time;
       const double rate = size / dt.count();
       MDEBUG(context << " adding span: " << arg.blocks.size() << " at height " << start_height << ", " << dt.count() << " seconds, " << (rate/1024) << " kB/s, size now " << (m_block_queue.get_data_size() + blocks_size) / 1048576.f << " MB");
-      m_block_queue.add_blocks(start_height, arg.blocks, context.m_connection_id, rate, blocks_size);
+      m_block_queue.add_blocks(start_height, std::move(arg.blocks), context.m_connection_id, rate, blocks_size);
 
       const crypto::hash last_block_hash = cryptonote::get_block_hash(b);
       context.m_last_known_hash = last_block_hash;
@@ -1375,6 +1516,7 @@ namespace cryptonote
   template<class t_core>
   int t_cryptonote_protocol_handler<t_core>::try_add_next_blocks(cryptonote_connection_context& context)
   {
+    TRACE_SPAN(p2p, try_add_next_blocks);
     bool force_next_span = false;
 
     {
@@ -1401,6 +1543,19 @@ namespace cryptonote
           if (!starting) m_last_add_end_time = epee::misc_utils::get_ns_count();
         };
 
+        // While a span is being added we parse and semantically check the txs of the span that
+        // follows it on another thread.  Preparing the blocks themselves (and anything else that
+        // depends on the chain state) still has to wait for the previous span to be added.
+        struct preparsed_span
+        {
+          uint64_t start_height;
+          boost::uuids::uuid connection_id;
+          std::vector<cryptonote::block_complete_entry> blocks;
+          // Declared after `blocks` (which it references) so that it is waited on before they are freed
+          std::future<std::vector<std::vector<cryptonote::core::tx_verification_batch_info>>> txs;
+        };
+        std::unique_ptr<preparsed_span> next_span;
+
         while (1)
         {
           const uint64_t previous_height = m_core.get_current_blockchain_height();
@@ -1413,6 +1568,25 @@ namespace cryptonote
             break;
           }
 
+          std::vector<std::vector<cryptonote::core::tx_verification_batch_info>> span_txs;
+          if (next_span && next_span->start_height == start_height && next_span->connection_id == span_connection_id)
+          {
+            try
+            {
+              span_txs = next_span->txs.get();
+              // The parsed txs point into these blobs, so use them rather than the copy we just got
+              blocks = std::move(next_span->blocks);
+            }
+            catch (const std::exception &e)
+            {
+              MERROR(context << "Failed to pre-parse span txs: " << e.what());
+              span_txs.clear();
+            }
+            if (span_txs.size() != blocks.size())
+              span_txs.clear();
+          }
+          next_span.reset();
+
           if (blocks.empty())
           {
             MERROR(context << "Next span has no blocks");
@@ -1508,6 +1682,16 @@ namespace cryptonote
             return 1;
           }
 
+          if (auto following = std::make_unique<preparsed_span>();
+              m_block_queue.get_filled_span_at(start_height + blocks.size(), following->blocks, following->connection_id))
+          {
+            following->start_height = start_height + blocks.size();
+            following->txs = std::async(std::launch::async, [this, &f = *following] {
+              return m_core.preparse_incoming_block_txs(f.blocks, f.start_height);
+            });
+            next_span = std::move(following);
+          }
+
           {
             bool remove_spans = false;
             OXEN_DEFER
@@ -1536,7 +1720,14 @@ namespace cryptonote
               // process transactions
               TIME_MEASURE_START(transactions_process_time);
               num_txs += block_entry.txs.size();
-              auto parsed_txs = m_core.handle_incoming_txs(block_entry.txs, tx_pool_options::from_block());
+              std::vector<cryptonote::core::tx_verification_batch_info> parsed_txs;
+              if (!span_txs.empty())
+              {
+                parsed_txs = std::move(span_txs[blockidx]);
+                m_core.handle_preparsed_txs(parsed_txs, tx_pool_options::from_block());
+              }
+              else
+                parsed_txs = m_core.handle_incoming_txs(block_entry.txs, tx_pool_options::from_block());
 
               for (size_t i = 0; i < parsed_txs.size(); ++i)
               {
@@ -1868,6 +2059,14 @@ skip:
           return true;
         }
 
+        // the holder is well behind what its own measured rate would take while we're measurably faster:
+        // ask for it too rather than wait for it to trickle in and hold up the whole queue
+        if (m_block_queue.is_next_span_late(blockchain_height, context.m_connection_id, now))
+        {
+          MDEBUG(context << " we should download it as its peer is late with it and we are faster");
+          return true;
+        }
+
         // in standby, be ready to double download early since we're idling anyway
         // let the fastest peer trigger first
         long threshold;
@@ -2133,7 +2332,7 @@ skip:
       NOTIFY_REQUEST_GET_BLOCKS::request req;
       bool is_next = false;
       size_t count = 0;
-      const size_t count_limit = m_core.get_block_sync_size(m_core.get_current_blockchain_height());
+      const size_t count_limit = m_block_queue.get_span_size(context.m_connection_id, m_core.get_block_sync_size(m_core.get_current_blockchain_height()));
       std::pair<uint64_t, uint64_t> span = std::make_pair(0, 0);
       if (force_next_span)
       {
@@ -2440,6 +2639,14 @@ skip:
       return 1;
     }
 
+    // Checkpoints let us tell that this peer is on the wrong chain before downloading any of it
+    if (auto bad_height = m_core.find_checkpoint_conflict(arg.start_height, arg.m_block_ids))
+    {
+      LOG_ERROR_CCONTEXT("sent a chain that conflicts with our checkpoint at height " << *bad_height << ", dropping connection");
+      drop_connection(context, true, false);
+      return 1;
+    }
+
     uint64_t n_use_blocks = m_core.prevalidate_block_hashes(arg.start_height, arg.m_block_ids);
     if (n_use_blocks + HASH_OF_HASHES_STEP <= arg.m_block_ids.size())
     {
@@ -2518,36 +2725,37 @@ skip:
   template<class t_core>
   bool t_cryptonote_protocol_handler<t_core>::relay_block(NOTIFY_NEW_FLUFFY_BLOCK::request& arg, cryptonote_connection_context& exclude_context)
   {
-    // sort peers between fluffy ones and others
+    const crypto::hash block_hash = get_blob_hash(arg.b.block);
+    std::vector<crypto::hash> tx_hashes;
+    tx_hashes.reserve(arg.b.txs.size());
+    for (const auto& tx_blob : arg.b.txs)
+      tx_hashes.push_back(get_blob_hash(tx_blob));
+    // send to every public peer that isn't already known to have the block
+    size_t already_known = 0;
     std::vector<std::pair<epee::net_utils::zone, boost::uuids::uuid>> fluffyConnections;
-    m_p2p->for_each_connection([&exclude_context, &fluffyConnections](connection_context& context, nodetool::peerid_type peer_id, uint32_t support_flags)
+    m_p2p->for_each_connection([&](connection_context& context, nodetool::peerid_type peer_id, uint32_t support_flags)
     {
       if (peer_id && exclude_context.m_connection_id != context.m_connection_id && context.m_remote_address.get_zone() == epee::net_utils::zone::public_)
       {
+        if (context.m_known_inventory.contains(block_hash))
+        {
+          already_known++;
+          return true;
+        }
         LOG_DEBUG_CC(context, "PEER FLUFFY BLOCKS - RELAYING THIN/COMPACT WHATEVER BLOCK");
+        context.m_known_inventory.insert(block_hash);
+        for (const auto& h : tx_hashes)
+          context.m_known_inventory.insert(h);
         fluffyConnections.push_back({context.m_remote_address.get_zone(), context.m_connection_id});
       }
       return true;
     });
 
+    // Any txes in `arg` are the ones the caller expects peers not to have yet; everything else
+    // gets filled in from the receiving peer's pool (or requested via NOTIFY_REQUEST_FLUFFY_MISSING_TX).
+    MDEBUG("Relaying fluffy block with " << arg.b.txs.size() << " prefilled txes to " << fluffyConnections.size() << " peers (" << already_known << " already have it)");
     std::string fluffyBlob;
-    if (arg.b.txs.size())
-    {
-      epee::serialization::store_t_to_binary(arg, fluffyBlob);
-    }
-    else
-    {
-      // NOTE: We should never ideally hit this case. If we do, some developer
-      // at the calling site passed in the full block information
-
-      // relay_block is only meant to send the header, tx blobs should be
-      // requested subsequently in handle notify fluffy transactions
-      LOG_PRINT_L1("relay_block called with argument that contains TX blobs, this is the non-expected case");
-      NOTIFY_NEW_FLUFFY_BLOCK::request arg_without_tx_blobs = {};
-      arg_without_tx_blobs.current_blockchain_height        = arg.current_blockchain_height;
-      arg_without_tx_blobs.b.block                          = arg.b.block;
-      epee::serialization::store_t_to_binary(arg_without_tx_blobs, fluffyBlob);
-    }
+    epee::serialization::store_t_to_binary(arg, fluffyBlob);
 
     m_p2p->relay_notify_to_list(NOTIFY_NEW_FLUFFY_BLOCK::ID, epee::strspan<uint8_t>(fluffyBlob), std::move(fluffyConnections));
     return true;
@@ -2563,8 +2771,32 @@ skip:
   template<class t_core>
   bool t_cryptonote_protocol_handler<t_core>::relay_btencoded_uptime_proof(NOTIFY_BTENCODED_UPTIME_PROOF::request& arg, cryptonote_connection_context& exclude_context)
   {
-    bool result = relay_to_synchronized_peers<NOTIFY_BTENCODED_UPTIME_PROOF>(arg, exclude_context);
-    return result;
+    // As for relay_to_synchronized_peers, but skipping peers already known to have the proof
+    const crypto::hash proof_hash = crypto::cn_fast_hash(arg.proof.data(), arg.proof.size());
+    size_t already_known = 0;
+    std::vector<std::pair<epee::net_utils::zone, boost::uuids::uuid>> connections;
+    m_p2p->for_each_connection([&](connection_context& context, nodetool::peerid_type peer_id, uint32_t support_flags)
+    {
+      if (peer_id && context.m_state > cryptonote_connection_context::state_synchronizing && exclude_context.m_connection_id != context.m_connection_id)
+      {
+        if (context.m_known_inventory.contains(proof_hash))
+        {
+          already_known++;
+          return true;
+        }
+        context.m_known_inventory.insert(proof_hash);
+        connections.push_back({context.m_remote_address.get_zone(), context.m_connection_id});
+      }
+      return true;
+    });
+
+    MDEBUG("Relaying uptime proof to " << connections.size() << " peers (" << already_known << " already have it)");
+    if (connections.empty())
+      return true;
+
+    std::string arg_buff;
+    epee::serialization::store_t_to_binary(arg, arg_buff);
+    return m_p2p->relay_notify_to_list(NOTIFY_BTENCODED_UPTIME_PROOF::ID, epee::strspan<uint8_t>(arg_buff), std::move(connections));
   }
   //------------------------------------------------------------------------------------------------------------------------
   template<class t_core>
@@ -2733,6 +2965,10 @@ skip:
     }
 
     m_block_queue.flush_spans(context.m_connection_id, false);
+    {
+      std::lock_guard lock{m_strands_mutex};
+      m_strands.erase(context.m_connection_id);
+    }
     MLOG_PEER_STATE("closed");
   }
 
@@ -30,8 +30,10 @@
 
 #include <boost/asio/steady_timer.hpp>
 #include <boost/system/system_error.hpp>
+#include <algorithm>
 #include <chrono>
 #include <deque>
+#include <map>
 #include <stdexcept>
 
 #include "common/expect.h"
@@ -39,6 +41,7 @@
 #include "cryptonote_config.h"
 #include "crypto/random.h"
 #include "cryptonote_basic/connection_context.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
 #include "cryptonote_protocol/cryptonote_protocol_defs.h"
 #include "net/dandelionpp.h"
 #include "p2p/net_node.h"
@@ -54,12 +57,17 @@ namespace levin
   {
     constexpr std::size_t connection_id_reserve_size = 100;
 
+    //! Batched flood notifications are sent early once they reach this many tx bytes
+    constexpr std::size_t max_batched_tx_bytes = 1024 * 1024;
+
     constexpr const std::chrono::minutes noise_min_epoch{CRYPTONOTE_NOISE_MIN_EPOCH};
     constexpr const std::chrono::seconds noise_epoch_range{CRYPTONOTE_NOISE_EPOCH_RANGE};
 
     constexpr const std::chrono::seconds noise_min_delay{CRYPTONOTE_NOISE_MIN_DELAY};
     constexpr const std::chrono::seconds noise_delay_range{CRYPTONOTE_NOISE_DELAY_RANGE};
 
+    constexpr const std::chrono::seconds stale_circuit_timeout{CRYPTONOTE_STALE_CIRCUIT_TIMEOUT};
+
     /*! Select a randomized duration from 0 to `range`. The precision will be to
         the systems `steady_clock`. As an example, supplying 3 seconds to this
         function will select a duration from [0, 3] seconds, and the increments
@@ -73,23 +81,32 @@ namespace levin
       return std::chrono::steady_clock::duration{crypto::rand_range(rep(0), range.count())};
     }
 
-    //! \return All outgoing connections supporting fragments in `connections`.
+    //! \return True if nothing has been received on `context` for `stale_circuit_timeout`.
+    bool is_stale(const detail::p2p_context& context, const std::chrono::steady_clock::time_point now)
+    {
+      // Peers send timed syncs every P2P_DEFAULT_HANDSHAKE_INTERVAL, so a live circuit is never quiet this long
+      return now - std::max(context.m_started, context.m_last_recv) > stale_circuit_timeout;
+    }
+
+    /*! \return All outgoing connections supporting fragments in `connections`,
+        leaving out stale ones (see `is_stale`) unless every one of them is. */
     std::vector<boost::uuids::uuid> get_out_connections(connections& p2p)
     {
-      std::vector<boost::uuids::uuid> outs;
+      std::vector<boost::uuids::uuid> outs, stale;
       outs.reserve(connection_id_reserve_size);
 
       /* The foreach call is serialized with a lock, but should be quick due to
          the reserve call so a strand is not used. Investigate if there is lots
          of waiting in here. */
 
-      p2p.foreach_connection([&outs] (detail::p2p_context& context) {
+      const auto now = std::chrono::steady_clock::now();
+      p2p.foreach_connection([&outs, &stale, now] (detail::p2p_context& context) {
         if (!context.m_is_income)
-          outs.emplace_back(context.m_connection_id);
+          (is_stale(context, now) ? stale : outs).emplace_back(context.m_connection_id);
         return true;
       });
 
-      return outs;
+      return outs.empty() ? stale : outs;
     }
 
     std::string make_tx_payload(std::vector<blobdata>&& txs, const bool pad)
@@ -183,13 +200,21 @@ namespace levin
       boost::asio::steady_timer next_noise;
       boost::uuids::uuid connection;
     };
+
+    //! A notification of our own txs waiting for an outbound i2p/tor connection
+    struct held_notification
+    {
+      epee::shared_sv covert;    //!< The fragmented notification, if the zone uses noise
+      std::vector<blobdata> txs; //!< Otherwise the txs to flood
+      bool pad;
+    };
   } // anonymous
 
   namespace detail
   {
     struct zone
     {
-      explicit zone(boost::asio::io_service& io_service, std::shared_ptr<connections> p2p, epee::shared_sv noise_in, bool is_public)
+      explicit zone(boost::asio::io_service& io_service, std::shared_ptr<connections> p2p, epee::shared_sv noise_in, bool is_public, std::chrono::milliseconds relay_delay)
         : p2p(std::move(p2p)),
           noise(std::move(noise_in)),
           next_epoch(io_service),
@@ -197,7 +222,9 @@ namespace levin
           map(),
           channels(),
           connection_count(0),
-          is_public(is_public)
+          is_public(is_public),
+          relay_delay(relay_delay),
+          next_flood(io_service)
       {
         for (std::size_t count = 0; !noise.view.empty() && count < CRYPTONOTE_NOISE_CHANNELS; ++count)
           channels.emplace_back(io_service);
@@ -211,6 +238,16 @@ namespace levin
       std::deque<noise_channel> channels;  //!< Never touch after init; only update elements on `noise_channel.strand`
       std::atomic<std::size_t> connection_count; //!< Only update in strand, can be read at any time
       const bool is_public;                      //!< Zone is public ipv4/ipv6 connections
+      const std::chrono::milliseconds relay_delay; //!< How long flood notifications are batched for; 0 to send immediately
+      boost::asio::steady_timer next_flood;      //!< Fires when the batched flood notifications are due
+      //! Txs waiting for the next batched flood notification, with the connection(s) that sent each one to us.
+      //! Ordered by blob so that the receive order isn't leaked.  Only touch in strand.
+      std::map<blobdata, std::vector<boost::uuids::uuid>> pending_txs;
+      std::size_t pending_bytes = 0; //!< Only touch in strand
+      bool pending_pad = false;      //!< Only touch in strand
+      //! Notifications that arrived while an anonymity zone had no outbound connection to send
+      //! them over, sent by `new_out_connection`.  Only touch in strand.
+      std::deque<held_notification> held;
     };
   } // detail
 
@@ -244,26 +281,25 @@ namespace levin
 
         if (!channel.connection.is_nil())
           channel.queue.push_back(std::move(message_));
-        else if (destination_ == 0 && zone_->connection_count == 0)
-          MWARNING("Unable to send transaction(s) over anonymity network - no available outbound connections");
       }
     };
 
-    //! Sends a message to every active connection
+    //! Sends a message to every active connection that doesn't already know all of its txs
     class flood_notify
     {
       std::shared_ptr<detail::zone> zone_;
       epee::shared_sv message_; // Requires manual copy
+      std::vector<crypto::hash> hashes_;
       boost::uuids::uuid source_;
 
     public:
-      explicit flood_notify(std::shared_ptr<detail::zone> zone, epee::shared_sv message, const boost::uuids::uuid& source)
-        : zone_(std::move(zone)), message_(message), source_(source)
+      explicit flood_notify(std::shared_ptr<detail::zone> zone, epee::shared_sv message, std::vector<crypto::hash> hashes, const boost::uuids::uuid& source)
+        : zone_(std::move(zone)), message_(message), hashes_(std::move(hashes)), source_(source)
       {}
 
       flood_notify(flood_notify&&) = default;
       flood_notify(const flood_notify& source)
-        : zone_(source.zone_), message_(source.message_), source_(source.source_)
+        : zone_(source.zone_), message_(source.message_), hashes_(source.hashes_), source_(source.source_)
       {}
 
       void operator()() const
@@ -285,8 +321,14 @@ namespace levin
           /* Only send to outgoing connections when "flooding" over i2p/tor.
              Otherwise this makes the tx linkable to a hidden service address,
              making things linkable across connections. */
-          if (this->source_ != context.m_connection_id && (this->zone_->is_public || !context.m_is_income))
-            connections.emplace_back(context.m_connection_id);
+          if (this->source_ == context.m_connection_id || !(this->zone_->is_public || !context.m_is_income))
+            return true;
+          auto& known = context.m_known_inventory;
+          if (std::all_of(hashes_.begin(), hashes_.end(), [&known] (const crypto::hash& h) { return known.contains(h); }))
+            return true;
+          for (const crypto::hash& h : hashes_)
+            known.insert(h);
+          connections.emplace_back(context.m_connection_id);
           return true;
         });
 
@@ -295,6 +337,127 @@ namespace levin
       }
     };
 
+    //! Sends the batched flood notification to every active connection, leaving out of each
+    //! connection's copy the txs that it sent to us itself or is otherwise known to have.
+    struct send_batched_flood
+    {
+      std::shared_ptr<detail::zone> zone_;
+
+      //! \pre Called within `zone_->strand`.
+      void operator()(boost::system::error_code error = {}) const
+      {
+        if (!zone_ || !zone_->p2p || zone_->pending_txs.empty())
+          return;
+
+        if (error == boost::system::errc::operation_canceled)
+          return; // the batch this timer was for already went out early
+        if (error)
+          throw boost::system::system_error{error, "send_batched_flood timer failed"};
+
+        assert(zone_->strand.running_in_this_thread());
+
+        auto pending = std::move(zone_->pending_txs);
+        zone_->pending_txs.clear();
+        zone_->pending_bytes = 0;
+        const bool pad = zone_->pending_pad;
+        zone_->pending_pad = false;
+        zone_->next_flood.cancel();
+
+        std::vector<crypto::hash> hashes;
+        hashes.reserve(pending.size());
+        for (const auto& [blob, from] : pending)
+          hashes.push_back(cryptonote::get_blob_hash(blob));
+
+        // Connection ids with which of the pending txs to send them; empty means all of them
+        std::vector<std::pair<boost::uuids::uuid, std::vector<bool>>> connections;
+        connections.reserve(connection_id_reserve_size);
+        zone_->p2p->foreach_connection([this, &pending, &hashes, &connections] (detail::p2p_context& context) {
+          if (!(this->zone_->is_public || !context.m_is_income))
+            return true;
+          std::vector<bool> include(pending.size());
+          bool all = true, any = false;
+          size_t i = 0;
+          for (const auto& [blob, from] : pending)
+          {
+            const bool send = std::find(from.begin(), from.end(), context.m_connection_id) == from.end()
+              && !context.m_known_inventory.contains(hashes[i]);
+            if (send)
+              context.m_known_inventory.insert(hashes[i]);
+            include[i++] = send;
+            all = all && send;
+            any = any || send;
+          }
+          if (any)
+            connections.emplace_back(context.m_connection_id, all ? std::vector<bool>{} : std::move(include));
+          return true;
+        });
+
+        // Everyone that needs all of the txs gets the same message
+        epee::shared_sv full_message;
+        const auto make_message = [&pending, pad] (const std::vector<bool>& include) {
+          std::vector<blobdata> txs;
+          txs.reserve(pending.size());
+          size_t i = 0;
+          for (const auto& [blob, from] : pending)
+            if (include.empty() || include[i++])
+              txs.push_back(blob);
+          const std::string payload = make_tx_payload(std::move(txs), pad);
+          return epee::shared_sv{epee::levin::make_notify(NOTIFY_NEW_TRANSACTIONS::ID, epee::strspan<std::uint8_t>(payload))};
+        };
+
+        MDEBUG("Relaying batch of " << pending.size() << " txs to " << connections.size() << " connections");
+        for (const auto& [connection, include] : connections)
+        {
+          if (!include.empty())
+            zone_->p2p->send(make_message(include), connection);
+          else
+          {
+            if (full_message.view.empty())
+              full_message = make_message(include);
+            zone_->p2p->send(full_message, connection);
+          }
+        }
+      }
+    };
+
+    //! Adds txs to the batched flood notification, starting its timer if needed.
+    struct queue_flood_notify
+    {
+      std::shared_ptr<detail::zone> zone_;
+      std::vector<blobdata> txs_;
+      boost::uuids::uuid source_;
+      bool pad_;
+
+      //! \pre Called within `zone_->strand`.
+      void operator()()
+      {
+        if (!zone_)
+          return;
+
+        assert(zone_->strand.running_in_this_thread());
+
+        const bool was_empty = zone_->pending_txs.empty();
+        for (auto& tx : txs_)
+        {
+          const std::size_t size = tx.size();
+          auto [it, inserted] = zone_->pending_txs.try_emplace(std::move(tx));
+          if (inserted)
+            zone_->pending_bytes += size;
+          if (!source_.is_nil() && std::find(it->second.begin(), it->second.end(), source_) == it->second.end())
+            it->second.push_back(source_);
+        }
+        zone_->pending_pad |= pad_;
+
+        if (zone_->pending_bytes >= max_batched_tx_bytes)
+          send_batched_flood{zone_}();
+        else if (was_empty && !zone_->pending_txs.empty())
+        {
+          zone_->next_flood.expires_after(zone_->relay_delay);
+          zone_->next_flood.async_wait(zone_->strand.wrap(send_batched_flood{zone_}));
+        }
+      }
+    };
+
     //! Updates the connection for a channel.
     struct update_channel
     {
@@ -328,11 +491,12 @@ namespace levin
       }
     };
 
-    //! Merges `out_connections_` into the existing `zone_->map`.
+    //! Merges `out_connections_` into the existing `zone_->map`, dropping `lost_` if set.
     struct update_channels
     {
       std::shared_ptr<detail::zone> zone_;
       std::vector<boost::uuids::uuid> out_connections_;
+      boost::uuids::uuid lost_ = boost::uuids::nil_uuid();
 
       //! \pre Called within `zone->strand`.
       static void post(std::shared_ptr<detail::zone> zone)
@@ -357,7 +521,19 @@ namespace levin
           return;
 
         assert(zone_->strand.running_in_this_thread());
-        if (zone_->map.update(std::move(out_connections_)))
+
+        // a failed send can precede the close notification, so don't pick the same connection again
+        bool changed = false;
+        if (!lost_.is_nil())
+        {
+          changed = zone_->map.remove(lost_);
+          out_connections_.erase(
+            std::remove(out_connections_.begin(), out_connections_.end(), lost_), out_connections_.end()
+          );
+        }
+
+        changed |= zone_->map.update(std::move(out_connections_));
+        if (changed)
           post(std::move(zone_));
       }
     };
@@ -443,6 +619,7 @@ namespace levin
           }
           else
           {
+            const boost::uuids::uuid lost = channel.connection;
             channel.active = {};
             channel.connection = boost::uuids::nil_uuid();
 
@@ -450,7 +627,7 @@ namespace levin
             if (connections.empty())
               MWARNING("Lost all outbound connections to anonymity network - currently unable to send transaction(s)");
 
-            zone_->strand.post(update_channels{zone_, std::move(connections)});
+            zone_->strand.post(update_channels{zone_, std::move(connections), lost});
           }
         }
 
@@ -486,10 +663,102 @@ namespace levin
         alias.next_epoch.async_wait(start_epoch{std::move(*this)});
       }
     };
+
+    //! Queues `message` in every noise channel of `zone`.
+    void send_covert(const std::shared_ptr<detail::zone>& zone, const epee::shared_sv& message)
+    {
+      for (std::size_t channel = 0; channel < zone->channels.size(); ++channel)
+      {
+        zone->channels[channel].strand.dispatch(
+          queue_covert_notify{zone, message, channel}
+        );
+      }
+    }
+
+    //! Floods `txs` to the connections of `zone`, batched if it has a relay delay.
+    void send_flood(const std::shared_ptr<detail::zone>& zone, std::vector<blobdata> txs, const boost::uuids::uuid& source, const bool pad_txs)
+    {
+      if (zone->relay_delay > std::chrono::milliseconds::zero())
+      {
+        // coalesce with whatever else arrives within the relay delay into one message per connection
+        zone->strand.dispatch(queue_flood_notify{zone, std::move(txs), source, pad_txs});
+        return;
+      }
+
+      std::vector<crypto::hash> hashes;
+      hashes.reserve(txs.size());
+      for (const auto& tx : txs)
+        hashes.push_back(cryptonote::get_blob_hash(tx));
+
+      const std::string payload = make_tx_payload(std::move(txs), pad_txs);
+      epee::shared_sv message{
+        epee::levin::make_notify(NOTIFY_NEW_TRANSACTIONS::ID, epee::strspan<std::uint8_t>(payload))};
+
+      // traditional monero send technique
+      zone->strand.dispatch(flood_notify{zone, std::move(message), std::move(hashes), source});
+    }
+
+    /*! Sends a notification over an anonymity zone, or holds it until the zone
+        has an outbound connection: without one the tx would otherwise only
+        leave with the tx pool's next rebroadcast, minutes later. */
+    struct send_or_hold
+    {
+      std::shared_ptr<detail::zone> zone_;
+      held_notification notification_;
+
+      //! \pre Called within `zone_->strand`.
+      void operator()()
+      {
+        if (!zone_ || !zone_->p2p)
+          return;
+
+        assert(zone_->strand.running_in_this_thread());
+
+        // noise channels only get connections through `map`
+        const bool connected = notification_.covert.view.empty()
+          ? !get_out_connections(*zone_->p2p).empty()
+          : zone_->map.size() != 0;
+
+        if (connected)
+        {
+          if (!notification_.covert.view.empty())
+            send_covert(zone_, notification_.covert);
+          else
+            send_flood(zone_, std::move(notification_.txs), boost::uuids::nil_uuid(), notification_.pad);
+          return;
+        }
+
+        MWARNING("No outbound connections to anonymity network - holding transaction(s) until there is one");
+        if (zone_->held.size() >= CRYPTONOTE_MAX_HELD_NOTIFICATIONS)
+          zone_->held.pop_front(); // still in the tx pool, so relayed again eventually
+        zone_->held.push_back(std::move(notification_));
+      }
+    };
+
+    //! Retries the notifications held by `send_or_hold`.
+    struct send_held
+    {
+      std::shared_ptr<detail::zone> zone_;
+
+      //! \pre Called within `zone_->strand`.
+      void operator()() const
+      {
+        if (!zone_ || zone_->held.empty())
+          return;
+
+        assert(zone_->strand.running_in_this_thread());
+
+        auto held = std::move(zone_->held);
+        zone_->held.clear();
+        MDEBUG("Sending " << held.size() << " held notification(s) over new anonymity network connection");
+        for (auto& notification : held)
+          send_or_hold{zone_, std::move(notification)}();
+      }
+    };
   } // anonymous
 
-  notify::notify(boost::asio::io_service& service, std::shared_ptr<connections> p2p, epee::shared_sv noise, bool is_public)
-    : zone_(std::make_shared<detail::zone>(service, std::move(p2p), std::move(noise), is_public))
+  notify::notify(boost::asio::io_service& service, std::shared_ptr<connections> p2p, epee::shared_sv noise, bool is_public, std::chrono::milliseconds relay_delay)
+    : zone_(std::make_shared<detail::zone>(service, std::move(p2p), std::move(noise), is_public, relay_delay))
   {
     if (!zone_->p2p)
       throw std::logic_error{"cryptonote::levin::notify cannot have nullptr p2p argument"};
@@ -516,12 +785,17 @@ namespace levin
 
   void notify::new_out_connection()
   {
-    if (!zone_ || zone_->noise.view.empty() || CRYPTONOTE_NOISE_CHANNELS <= zone_->connection_count)
+    if (!zone_)
       return;
 
-    zone_->strand.dispatch(
-      update_channels{zone_, get_out_connections(*(zone_->p2p))}
-    );
+    if (!zone_->noise.view.empty() && zone_->connection_count < CRYPTONOTE_NOISE_CHANNELS)
+    {
+      zone_->strand.dispatch(
+        update_channels{zone_, get_out_connections(*(zone_->p2p))}
+      );
+    }
+    // after the strand has put the new connection in a channel
+    zone_->strand.dispatch(send_held{zone_});
   }
 
   void notify::run_epoch()
@@ -566,22 +840,12 @@ namespace levin
         return false;
       }
 
-      for (std::size_t channel = 0; channel < zone_->channels.size(); ++channel)
-      {
-        zone_->channels[channel].strand.dispatch(
-          queue_covert_notify{zone_, message, channel}
-        );
-      }
+      zone_->strand.dispatch(send_or_hold{zone_, {std::move(message), {}, false}});
     }
+    else if (!zone_->is_public && source.is_nil())
+      zone_->strand.dispatch(send_or_hold{zone_, {{}, std::move(txs), pad_txs}});
     else
-    {
-      const std::string payload = make_tx_payload(std::move(txs), pad_txs);
-      epee::shared_sv message{
-        epee::levin::make_notify(NOTIFY_NEW_TRANSACTIONS::ID, epee::strspan<std::uint8_t>(payload))};
-
-      // traditional monero send technique
-      zone_->strand.dispatch(flood_notify{zone_, std::move(message), source});
-    }
+      send_flood(zone_, std::move(txs), source, pad_txs);
 
     return true;
   }
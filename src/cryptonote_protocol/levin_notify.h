@@ -30,6 +30,7 @@
 
 #include <boost/asio/io_service.hpp>
 #include <boost/uuid/uuid.hpp>
+#include <chrono>
 #include <memory>
 #include <vector>
 
@@ -85,8 +86,13 @@ namespace levin
       : zone_(nullptr)
     {}
 
-    //! Construct an instance with available notification `zones`.
-    explicit notify(boost::asio::io_service& service, std::shared_ptr<connections> p2p, epee::shared_sv noise, bool is_public);
+    /*! Construct an instance with available notification `zones`.
+
+        \param relay_delay When greater than zero (and noise is not in use),
+          txs are collected for up to this long and then flooded together, as
+          one message per connection that leaves out the txs that connection
+          sent to us. */
+    explicit notify(boost::asio::io_service& service, std::shared_ptr<connections> p2p, epee::shared_sv noise, bool is_public, std::chrono::milliseconds relay_delay = {});
 
     notify(const notify&) = delete;
     notify(notify&&) = default;
@@ -38,6 +38,7 @@
 #include "quorumnet_conn_matrix.h"
 #include "cryptonote_config.h"
 #include "common/random.h"
+#include "common/threadpool.h"
 
 #include <oxenmq/oxenmq.h>
 #include <oxenmq/hex.h>
@@ -95,6 +96,11 @@ struct QnetState {
     std::condition_variable pulse_message_queue_cv;
     std::queue<pulse::message> pulse_message_queue;
 
+    // x25519 pubkeys of the peers that warm_quorum_peers() last asked OMQ to keep connections to,
+    // with the warm_* flags of the quorums they were picked for.
+    std::mutex warm_peers_mutex;
+    std::unordered_map<std::string, uint8_t> warm_peers;
+
     QnetState(cryptonote::core &core) : core{core} {}
 
     static QnetState &from(void* obj) {
@@ -351,9 +357,6 @@ private:
     template <typename QuorumIt>
     void compute_validator_peers(QuorumIt qbegin, QuorumIt qend, bool opportunistic) {
 
-        // TODO: when we receive a new block, if our quorum starts soon we can tell SNNetwork to
-        // pre-connect (to save the time in handshaking when we get an actual blink tx).
-
         strong_peers = 0;
 
         size_t i = 0;
@@ -464,8 +467,7 @@ bt_dict serialize_vote(const quorum_vote_t &vote) {
     return result;
 }
 
-quorum_vote_t deserialize_vote(std::string_view v) {
-    const auto &d = bt_deserialize<bt_dict>(v); // throws if not a bt_dict
+quorum_vote_t deserialize_vote(const bt_dict &d) {
     quorum_vote_t vote;
     vote.version = get_int<uint8_t>(d.at("v"));
     vote.type = get_enum<quorum_type>(d, "t");
@@ -489,12 +491,28 @@ quorum_vote_t deserialize_vote(std::string_view v) {
     return vote;
 }
 
+quorum_vote_t deserialize_vote(std::string_view v) {
+    return deserialize_vote(bt_deserialize<bt_dict>(v)); // throws if not a bt_dict
+}
+
+// The most votes we put in, or accept in, a single quorum.votes_ob bundle
+constexpr size_t MAX_VOTES_PER_BUNDLE = 256;
+
 void relay_obligation_votes(void *obj, const std::vector<service_nodes::quorum_vote_t> &votes) {
     auto &qnet = QnetState::from(obj);
 
-    const auto& my_keys = qnet.core.get_service_keys();
     assert(qnet.core.service_node());
 
+    // Once everyone understands quorum.votes_ob we send each peer a single message with all the
+    // votes for it rather than one message per vote.
+    const bool bundle = qnet.core.get_blockchain_storage().get_network_version() >= HF_VERSION_VOTE_BUNDLES;
+    // x25519 pubkey => {conn location (empty if opportunistic), votes}
+    std::unordered_map<std::string, std::pair<std::string, bt_list>> bundles;
+
+    // Votes for the same height share a quorum, and so share the peers to relay to; nullopt if we
+    // can't relay votes for the height.
+    std::map<uint64_t, std::optional<peer_info>> peers_by_height;
+
     MDEBUG("Starting relay of " << votes.size() << " votes");
     std::vector<service_nodes::quorum_vote_t> relayed_votes;
     relayed_votes.reserve(votes.size());
@@ -504,29 +522,61 @@ void relay_obligation_votes(void *obj, const std::vector<service_nodes::quorum_v
             continue;
         }
 
-        auto quorum = qnet.core.get_service_node_list().get_quorum(vote.type, vote.block_height);
-        if (!quorum) {
-            MWARNING("Unable to relay vote: no " << vote.type << " quorum available for height " << vote.block_height);
-            continue;
-        }
+        auto [it, inserted] = peers_by_height.try_emplace(vote.block_height);
+        if (inserted) {
+            auto quorum = qnet.core.get_service_node_list().get_quorum(vote.type, vote.block_height);
+            if (!quorum) {
+                MWARNING("Unable to relay vote: no " << vote.type << " quorum available for height " << vote.block_height);
+                continue;
+            }
 
-        auto &quorum_voters = quorum->validators;
-        if (quorum_voters.size() < service_nodes::min_votes_for_quorum_type(vote.type)) {
-            MWARNING("Invalid vote relay: " << vote.type << " quorum @ height " << vote.block_height <<
-                    " does not have enough validators (" << quorum_voters.size() << ") to reach the minimum required votes ("
-                    << service_nodes::min_votes_for_quorum_type(vote.type) << ")");
-            continue;
-        }
+            auto &quorum_voters = quorum->validators;
+            if (quorum_voters.size() < service_nodes::min_votes_for_quorum_type(vote.type)) {
+                MWARNING("Invalid vote relay: " << vote.type << " quorum @ height " << vote.block_height <<
+                        " does not have enough validators (" << quorum_voters.size() << ") to reach the minimum required votes ("
+                        << service_nodes::min_votes_for_quorum_type(vote.type) << ")");
+                continue;
+            }
 
-        peer_info pinfo{qnet, vote.type, quorum.get()};
-        if (!pinfo.my_position_count) {
-            MWARNING("Invalid vote relay: vote to relay does not include this service node");
-            continue;
+            auto &pinfo = it->second.emplace(qnet, vote.type, quorum.get());
+            if (!pinfo.my_position_count) {
+                MWARNING("Invalid vote relay: vote to relay does not include this service node");
+                it->second.reset();
+                continue;
+            }
         }
+        if (!it->second)
+            continue;
 
-        pinfo.relay_to_peers("quorum.vote_ob", serialize_vote(vote));
+        auto &pinfo = *it->second;
+        if (!bundle) {
+            pinfo.relay_to_peers("quorum.vote_ob", serialize_vote(vote));
+        } else {
+            auto serialized = serialize_vote(vote);
+            for (auto &[x25519, addr] : pinfo.peers) {
+                auto &[bundle_addr, bundle_votes] = bundles[x25519];
+                if (bundle_addr.empty())
+                    bundle_addr = addr; // Connect for the bundle if any of its votes needs to
+                bundle_votes.push_back(serialized);
+            }
+        }
         relayed_votes.push_back(vote);
     }
+
+    for (auto &[x25519, b] : bundles) {
+        auto &[addr, bundle_votes] = b;
+        MTRACE("Relaying " << bundle_votes.size() << " votes to peer " << to_hex(x25519) << (addr.empty() ? " (if connected)"s : " @ " + addr));
+        while (!bundle_votes.empty()) {
+            bt_list chunk;
+            auto chunk_end = bundle_votes.begin();
+            std::advance(chunk_end, std::min(bundle_votes.size(), MAX_VOTES_PER_BUNDLE));
+            chunk.splice(chunk.end(), bundle_votes, bundle_votes.begin(), chunk_end);
+            if (addr.empty())
+                qnet.omq.send(x25519, "quorum.votes_ob", bt_serialize(chunk), send_option::optional{});
+            else
+                qnet.omq.send(x25519, "quorum.votes_ob", bt_serialize(chunk), send_option::hint{addr});
+        }
+    }
     MDEBUG("Relayed " << relayed_votes.size() << " votes");
     qnet.core.set_service_node_votes_relayed(relayed_votes);
 }
@@ -569,6 +619,63 @@ void handle_obligation_vote(Message& m, QnetState& qnet) {
     }
 }
 
+/// quorum.votes_ob carries a list of obligation votes, each serialized as for quorum.vote_ob.  The
+/// votes are verified together, and those that are new to us relayed on in bundles of our own.
+void handle_obligation_votes(Message& m, QnetState& qnet) {
+    MDEBUG("Received a relayed obligation vote bundle from " << to_hex(m.conn.pubkey()));
+
+    if (m.data.size() != 1) {
+        MINFO("Ignoring vote bundle: expected 1 data part, not " << m.data.size());
+        return;
+    }
+
+    try {
+        auto bundle = bt_deserialize<bt_list>(m.data[0]);
+        if (bundle.size() > MAX_VOTES_PER_BUNDLE) {
+            MINFO("Ignoring vote bundle: too many votes (" << bundle.size() << " > " << MAX_VOTES_PER_BUNDLE << ")");
+            return;
+        }
+
+        const uint64_t height = qnet.core.get_current_blockchain_height();
+        std::vector<quorum_vote_t> votes;
+        votes.reserve(bundle.size());
+        std::unordered_set<crypto::signature> seen;
+        for (auto &v : bundle) {
+            auto vote = deserialize_vote(var::get<bt_dict>(v));
+            if (vote.type != quorum_type::obligations) {
+                MWARNING("Received invalid non-obligations vote via quorumnet; ignoring");
+                continue;
+            }
+            if (vote.block_height > height) {
+                MDEBUG("Ignoring vote: block height " << vote.block_height << " is too high");
+                continue;
+            }
+            if (seen.insert(vote.signature).second)
+                votes.push_back(std::move(vote));
+        }
+
+        std::vector<cryptonote::vote_verification_context> vvcs;
+        qnet.core.add_service_node_votes(votes, vvcs);
+
+        std::vector<quorum_vote_t> added;
+        size_t failed = 0;
+        for (size_t i = 0; i < votes.size(); i++) {
+            if (vvcs[i].m_verification_failed)
+                failed++;
+            else if (vvcs[i].m_added_to_pool)
+                added.push_back(std::move(votes[i]));
+        }
+        if (failed)
+            MWARNING("Vote verification failed for " << failed << " of " << votes.size() << " bundled votes; ignoring them");
+
+        if (!added.empty())
+            relay_obligation_votes(&qnet, added);
+    }
+    catch (const std::exception &e) {
+        MWARNING("Deserialization of vote bundle from " << to_hex(m.conn.pubkey()) << " failed: " << e.what());
+    }
+}
+
 void handle_timestamp(Message& m) {
     MDEBUG("Received a timestamp request from " << to_hex(m.conn.pubkey()));
     const time_t seconds = time(nullptr);
@@ -587,6 +694,19 @@ std::enable_if_t<std::is_integral<I>::value, I> get_or(bt_dict &d, const std::st
     return fallback;
 }
 
+// Blink quorums recently obtained by get_blink_quorums, by blink height.  Every blink message for a
+// tx needs them, so this saves looking them up in the service node list for each one.  An entry is
+// only used while the list's detach_count() is what it was when the entry was looked up.
+struct cached_blink_quorums {
+    const service_node_list *snl;
+    uint64_t detach_count;
+    quorum_array quorums;
+    uint64_t checksum;
+};
+constexpr size_t BLINK_QUORUMS_CACHE_SIZE = 8;
+std::map<uint64_t, cached_blink_quorums> blink_quorums_cache;
+std::mutex blink_quorums_cache_mutex;
+
 // Obtains the blink quorums, verifies that they are of an acceptable size, and verifies the given
 // input quorum checksum matches the computed checksum for the quorums (if provided), otherwise sets
 // the given output checksum (if provided) to the calculated value.  Throws std::runtime_error on
@@ -598,19 +718,38 @@ quorum_array get_blink_quorums(uint64_t blink_height, const service_node_list &s
     quorum_array result;
 
     uint64_t local_checksum = 0;
-    for (uint8_t qi = 0; qi < NUM_BLINK_QUORUMS; qi++) {
-        auto height = blink_tx::quorum_height(blink_height, static_cast<blink_tx::subquorum>(qi));
-        if (!height)
-            throw std::runtime_error("too early in blockchain to create a quorum");
-        result[qi] = snl.get_quorum(quorum_type::blink, height);
-        if (!result[qi])
-            throw std::runtime_error("failed to obtain a blink quorum");
-        auto &v = result[qi]->validators;
-        if (v.size() < BLINK_MIN_VOTES || v.size() > BLINK_SUBQUORUM_SIZE)
-            throw std::runtime_error("not enough blink nodes to form a quorum");
-        local_checksum += quorum_checksum(v, qi * BLINK_SUBQUORUM_SIZE);
+    const uint64_t detach_count = snl.detach_count();
+    bool cached = false;
+    {
+        std::lock_guard lock{blink_quorums_cache_mutex};
+        if (auto it = blink_quorums_cache.find(blink_height); it != blink_quorums_cache.end() &&
+                it->second.snl == &snl && it->second.detach_count == detach_count) {
+            result = it->second.quorums;
+            local_checksum = it->second.checksum;
+            cached = true;
+        }
+    }
+
+    if (!cached) {
+        for (uint8_t qi = 0; qi < NUM_BLINK_QUORUMS; qi++) {
+            auto height = blink_tx::quorum_height(blink_height, static_cast<blink_tx::subquorum>(qi));
+            if (!height)
+                throw std::runtime_error("too early in blockchain to create a quorum");
+            result[qi] = snl.get_quorum(quorum_type::blink, height);
+            if (!result[qi])
+                throw std::runtime_error("failed to obtain a blink quorum");
+            auto &v = result[qi]->validators;
+            if (v.size() < BLINK_MIN_VOTES || v.size() > BLINK_SUBQUORUM_SIZE)
+                throw std::runtime_error("not enough blink nodes to form a quorum");
+            local_checksum += quorum_checksum(v, qi * BLINK_SUBQUORUM_SIZE);
+        }
+        MTRACE("Verified enough active blink nodes for a quorum; quorum checksum: " << local_checksum);
+
+        std::lock_guard lock{blink_quorums_cache_mutex};
+        blink_quorums_cache[blink_height] = {&snl, detach_count, result, local_checksum};
+        while (blink_quorums_cache.size() > BLINK_QUORUMS_CACHE_SIZE)
+            blink_quorums_cache.erase(blink_quorums_cache.begin());
     }
-    MTRACE("Verified enough active blink nodes for a quorum; quorum checksum: " << local_checksum);
 
     if (input_checksum) {
         if (*input_checksum != local_checksum)
@@ -646,6 +785,10 @@ std::string debug_known_signatures(blink_tx &btx, quorum_array &blink_quorums) {
 }
 
 
+/// Below this many signatures at once process_blink_signatures checks them serially, as farming
+/// them out to the threadpool would cost more than it saves.
+constexpr size_t PARALLEL_BLINK_SIGNATURE_CHECKS_MIN = 4;
+
 /// Processes blink signatures; called immediately upon receiving a signature if we know about the
 /// tx; otherwise signatures are stored until we learn about the tx and then processed.
 void process_blink_signatures(QnetState &qnet, const std::shared_ptr<blink_tx> &btxptr, quorum_array &blink_quorums, uint64_t quorum_checksum, std::list<pending_signature> &&signatures,
@@ -679,18 +822,30 @@ void process_blink_signatures(QnetState &qnet, const std::shared_ptr<blink_tx> &
     if (signatures.empty())
         return;
 
-    // Now check and discard any invalid signatures (we can do this without holding a lock)
-    for (auto it = signatures.begin(); it != signatures.end(); ) {
-        auto &pending = *it;
-        auto &approval = std::get<bool>(pending);
-        auto &qi = std::get<uint8_t>(pending);
-        auto &position = std::get<int>(pending);
-        auto &signature = std::get<crypto::signature>(pending);
-
-        auto subquorum = static_cast<blink_tx::subquorum>(qi);
-        auto &validators = blink_quorums[qi]->validators;
+    // Now check and discard any invalid signatures (we can do this without holding a lock).  A batch
+    // of them (such as the ones that arrived before the tx did) gets checked in parallel.
+    const crypto::hash approval_hash = btx.hash(true), rejection_hash = btx.hash(false);
+    std::vector<char> valid(signatures.size()); // not vector<bool>: elements get set from different threads
+    auto check_signature = [&](size_t i, const pending_signature &pending) {
+        auto &[approval, qi, position, signature] = pending;
+        valid[i] = crypto::check_signature(approval ? approval_hash : rejection_hash, blink_quorums[qi]->validators[position], signature);
+    };
+    auto &tpool = tools::threadpool::getInstance();
+    if (signatures.size() >= PARALLEL_BLINK_SIGNATURE_CHECKS_MIN && tpool.get_max_concurrency() > 1) {
+        tools::threadpool::waiter waiter;
+        size_t i = 0;
+        for (auto &pending : signatures)
+            tpool.submit(&waiter, [&check_signature, i = i++, &pending] { check_signature(i, pending); }, true);
+        waiter.wait(&tpool);
+    } else {
+        size_t i = 0;
+        for (auto &pending : signatures)
+            check_signature(i++, pending);
+    }
 
-        if (!crypto::check_signature(btx.hash(approval), validators[position], signature)) {
+    size_t i = 0;
+    for (auto it = signatures.begin(); it != signatures.end(); ) {
+        if (!valid[i++]) {
             MWARNING("Invalid blink signature: signature verification failed");
             it = signatures.erase(it);
             continue;
@@ -1428,6 +1583,127 @@ void handle_blink_success(Message& m) {
     common_blink_response(tag, cryptonote::blink_result::accepted, ""s);
 }
 
+//
+// Peer pre-warming
+//
+
+// How many upcoming heights of obligations and blink quorums warm_quorum_peers() connects ahead for
+constexpr uint64_t WARM_QUORUM_HEIGHTS = 2;
+// How long OMQ keeps a pre-warmed connection without traffic.  warm_quorum_peers() renews it on
+// every block for as long as the peer stays in an upcoming quorum, so this need only outlast a
+// couple of blocks.
+constexpr auto WARM_PEER_KEEP_ALIVE = 5min;
+
+enum warm_flags : uint8_t { warm_obligations = 1, warm_blink = 2, warm_pulse = 4 };
+
+using warm_peer_map = std::unordered_map<std::string /*x25519 pubkey*/, std::pair<std::string /*conn location*/, uint8_t /*warm_flags*/>>;
+
+// Adds the peers `pinfo` would relay to over a strong connection
+void add_warm_peers(warm_peer_map &warm, const peer_info &pinfo, warm_flags flag) {
+    for (auto &[x25519, addr] : pinfo.peers) {
+        if (addr.empty()) continue;
+        auto &w = warm[x25519];
+        w.first = addr;
+        w.second |= flag;
+    }
+}
+
+/// Called on each new block to connect to the peers we are going to relay to in the quorums coming
+/// up next, so that the first vote, blink signature or Pulse message of a quorum doesn't wait on a
+/// connection handshake:
+/// - obligations quorums that our quorum cop votes on in the next few blocks;
+/// - blink quorums for blinks submitted in the next few blocks;
+/// - the round 0 Pulse quorum of the next block.
+/// Peers are connected with a keep-alive that gets renewed on each call while they remain in an
+/// upcoming quorum; peers that drop out are left to time out.
+void warm_quorum_peers(void *obj, uint64_t height) {
+    auto &qnet = QnetState::from(obj);
+    auto &core = qnet.core;
+    auto &snl = core.get_service_node_list();
+    const auto &my_pubkey = core.get_service_keys().pub;
+    if (height == 0 || !snl.is_service_node(my_pubkey, true /*require_active*/))
+        return;
+
+    const auto hf_version = get_network_version(core.get_nettype(), height);
+    warm_peer_map warm;
+
+    // The quorum cop votes on the obligations quorum at a height once it is
+    // REORG_SAFETY_BUFFER_BLOCKS deep, so the quorums it gets to next are already known.
+    const uint64_t reorg_buffer = hf_version >= cryptonote::network_version_12_checkpointing
+        ? REORG_SAFETY_BUFFER_BLOCKS_POST_HF12 : REORG_SAFETY_BUFFER_BLOCKS_PRE_HF12;
+    for (uint64_t i = 0; i < WARM_QUORUM_HEIGHTS && reorg_buffer + i < height; i++) {
+        auto quorum = snl.get_quorum(quorum_type::obligations, height - reorg_buffer - 1 + i);
+        if (!quorum) continue;
+        peer_info pinfo{qnet, quorum_type::obligations, quorum.get(), false /*!opportunistic*/};
+        if (pinfo.my_position_count)
+            add_warm_peers(warm, pinfo, warm_obligations);
+    }
+
+    if (hf_version >= HF_VERSION_BLINK) {
+        const service_nodes::quorum *last = nullptr;
+        for (uint64_t blink_height = height; blink_height < height + WARM_QUORUM_HEIGHTS; blink_height++) {
+            quorum_array quorums;
+            try {
+                quorums = get_blink_quorums(blink_height, snl, nullptr);
+            } catch (const std::runtime_error &e) {
+                MDEBUG("Not pre-warming blink peers for height " << blink_height << ": " << e.what());
+                continue;
+            }
+            // Blink quorums only change every BLINK_QUORUM_INTERVAL blocks
+            if (quorums[0].get() == last) continue;
+            last = quorums[0].get();
+            peer_info pinfo{qnet, quorum_type::blink, quorums.begin(), quorums.end(), false /*!opportunistic*/};
+            if (pinfo.my_position_count)
+                add_warm_peers(warm, pinfo, warm_blink);
+        }
+    }
+
+    if (hf_version >= cryptonote::network_version_16_pulse) {
+        auto quorum = service_nodes::generate_pulse_quorum(core.get_nettype(),
+                snl.get_block_leader().key,
+                hf_version,
+                snl.active_service_nodes_infos(),
+                service_nodes::get_pulse_entropy_for_next_block(core.get_blockchain_storage().get_db()),
+                0 /*round*/);
+        if (service_nodes::verify_pulse_quorum_sizes(quorum)) {
+            peer_info pinfo{qnet, quorum_type::pulse, &quorum, false /*!opportunistic*/, {}, true /*include_workers*/};
+            if (pinfo.my_position_count) {
+                add_warm_peers(warm, pinfo, warm_pulse);
+            } else if (quorum.workers[0] == my_pubkey) {
+                // The block producer sends its template to a random subset of the validators
+                for (auto &[pubkey, remote] : pinfo.remotes) {
+                    auto &w = warm[get_data_as_string(remote.first)];
+                    w.first = remote.second;
+                    w.second |= warm_pulse;
+                }
+            }
+        }
+    }
+
+    int counts[3] = {0, 0, 0}, added = 0;
+    std::lock_guard lock{qnet.warm_peers_mutex};
+    size_t dropped = qnet.warm_peers.size();
+    for (auto &[x25519, w] : warm) {
+        auto &[addr, flags] = w;
+        for (int i = 0; i < 3; i++)
+            if (flags & (1 << i)) counts[i]++;
+        if (qnet.warm_peers.count(x25519))
+            dropped--;
+        else
+            added++;
+        MTRACE("Pre-warming connection to " << to_hex(x25519) << " @ " << addr);
+        qnet.omq.connect_sn(x25519, WARM_PEER_KEEP_ALIVE, addr);
+    }
+    qnet.warm_peers.clear();
+    for (auto &[x25519, w] : warm)
+        qnet.warm_peers.emplace(x25519, w.second);
+
+    if (!warm.empty() || dropped)
+        MINFO("Keeping " << warm.size() << " quorumnet peer connections warm for height " << height << " (" <<
+                counts[0] << " obligations, " << counts[1] << " blink, " << counts[2] << " pulse; " <<
+                added << " new, " << dropped << " dropped)");
+}
+
 //
 // Pulse
 //
@@ -1585,6 +1861,16 @@ pulse::message pulse_parse_msg_header_fields(pulse::message_type type, bt_dict_c
 // QuorumNet from another validator, either forwarded or originating from that
 // node. The message is added to the Pulse message queue and validating the
 // contents of the message is left to the caller.
+// Handles the message on the Pulse thread, then steps the Pulse state machine straight away in case
+// the message completed the stage it is waiting in.
+void queue_pulse_message(QnetState &qnet, pulse::message &&msg)
+{
+  qnet.omq.job([&qnet, data = std::move(msg)]() {
+    pulse::handle_message(&qnet, data);
+    pulse::wake(&qnet, qnet.core);
+  }, qnet.core.pulse_thread_id());
+}
+
 void handle_pulse_participation_bit_or_bitset(Message &m, QnetState& qnet, bool bitset)
 {
   if (m.data.size() != 1)
@@ -1604,7 +1890,7 @@ void handle_pulse_participation_bit_or_bitset(Message &m, QnetState& qnet, bool
       throw std::invalid_argument(std::string(INVALID_ARG_PREFIX) + tag + "'");
   }
 
-  qnet.omq.job([&qnet, data = std::move(msg)]() { pulse::handle_message(&qnet, data); }, qnet.core.pulse_thread_id());
+  queue_pulse_message(qnet, std::move(msg));
 }
 
 void handle_pulse_block_template(Message &m, QnetState &qnet)
@@ -1621,7 +1907,7 @@ void handle_pulse_block_template(Message &m, QnetState &qnet)
   else
     throw std::invalid_argument(std::string(INVALID_ARG_PREFIX) + tag + "'");
 
-  qnet.omq.job([&qnet, data = std::move(msg)]() { pulse::handle_message(&qnet, data); }, qnet.core.pulse_thread_id());
+  queue_pulse_message(qnet, std::move(msg));
 }
 
 void handle_pulse_random_value_hash(Message &m, QnetState &qnet)
@@ -1644,7 +1930,7 @@ void handle_pulse_random_value_hash(Message &m, QnetState &qnet)
     throw std::invalid_argument(std::string(INVALID_ARG_PREFIX) + tag + "'");
   }
 
-  qnet.omq.job([&qnet, data = std::move(msg)]() { pulse::handle_message(&qnet, data); }, qnet.core.pulse_thread_id());
+  queue_pulse_message(qnet, std::move(msg));
 }
 
 void handle_pulse_random_value(Message &m, QnetState &qnet)
@@ -1665,7 +1951,7 @@ void handle_pulse_random_value(Message &m, QnetState &qnet)
     throw std::invalid_argument(std::string(INVALID_ARG_PREFIX) + tag + "'");
   }
 
-  qnet.omq.job([&qnet, data = std::move(msg)]() { pulse::handle_message(&qnet, data); }, qnet.core.pulse_thread_id());
+  queue_pulse_message(qnet, std::move(msg));
 }
 
 void handle_pulse_signed_block(Message &m, QnetState &qnet)
@@ -1684,7 +1970,7 @@ void handle_pulse_signed_block(Message &m, QnetState &qnet)
     throw std::invalid_argument("Invalid pulse signed block: missing required field '"s + tag + "'");
   }
 
-  qnet.omq.job([&qnet, data = std::move(msg)]() { pulse::handle_message(&qnet, data); }, qnet.core.pulse_thread_id());
+  queue_pulse_message(qnet, std::move(msg));
 }
 
 } // end empty namespace
@@ -1699,6 +1985,7 @@ void init_core_callbacks() {
     cryptonote::quorumnet_relay_obligation_votes = relay_obligation_votes;
     cryptonote::quorumnet_send_blink = send_blink;
     cryptonote::quorumnet_pulse_relay_message_to_quorum = pulse_relay_message_to_quorum;
+    cryptonote::quorumnet_warm_peers = warm_quorum_peers;
 }
 
 namespace {
@@ -1713,6 +2000,8 @@ void setup_endpoints(cryptonote::core& core, void* obj) {
         omq.add_category("quorum", Access{AuthLevel::none, true /*remote sn*/, true /*local sn*/}, 2 /*reserved threads*/)
             // Receives an obligation vote
             .add_command("vote_ob", [&qnet](Message& m) { handle_obligation_vote(m, qnet); })
+            // Receives a bundle of obligation votes
+            .add_command("votes_ob", [&qnet](Message& m) { handle_obligation_votes(m, qnet); })
             // Receives blink tx signatures or rejections between quorum members (either original or
             // forwarded).  These are propagated by the receiver if new
             .add_command("blink_sign", [&qnet](Message& m) { handle_blink_signature(m, qnet); })
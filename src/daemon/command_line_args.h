@@ -70,6 +70,13 @@ namespace daemon_args
   , "Max number of threads to use for a parallel job"
   , 0
   };
+  const command_line::arg_descriptor<std::vector<std::string>> arg_thread_affinity = {
+    "thread-affinity"
+  , "Pin a thread pool to CPUs, as pool=cpus where pool is one of threadpool, miner or p2p, and cpus "
+    "is a list such as 0-7,16-23 whose items may also be NUMA nodes (node0), or is \"numa\" to spread "
+    "the pool's threads over the NUMA nodes with each mining against a dataset in its own node's memory. "
+    "Can be repeated."
+  };
 
 }  // namespace daemon_args
 
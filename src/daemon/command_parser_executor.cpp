@@ -224,6 +224,13 @@ bool command_parser_executor::print_net_stats(const std::vector<std::string>& ar
   return m_executor.print_net_stats();
 }
 
+bool command_parser_executor::print_mem(const std::vector<std::string>& args)
+{
+  if (!args.empty()) return false;
+
+  return m_executor.print_mem();
+}
+
 bool command_parser_executor::print_blockchain_info(const std::vector<std::string>& args)
 {
   if(!args.size())
@@ -358,6 +365,42 @@ bool command_parser_executor::set_log_level(const std::vector<std::string>& args
   }
 }
 
+bool command_parser_executor::trace(const std::vector<std::string>& args)
+{
+  if (args.size() == 1 && args[0] == "start")
+    return m_executor.trace(true, false, "");
+  if (args.size() == 1 && args[0] == "stop")
+    return m_executor.trace(false, false, "");
+  if (args.size() == 1 && args[0] == "clear")
+    return m_executor.trace(std::nullopt, true, "");
+  if (args.size() == 2 && args[0] == "dump")
+    return m_executor.trace(std::nullopt, false, args[1]);
+  std::cout << "use: trace start|stop|clear|dump <filename>" << std::endl;
+  return true;
+}
+
+bool command_parser_executor::profile(const std::vector<std::string>& args)
+{
+  if (!args.empty() && args[0] == "start" && args.size() <= 2)
+  {
+    uint32_t hz = 99;
+    if (args.size() == 2 && !epee::string_tools::get_xtype_from_string(hz, args[1]))
+    {
+      std::cout << "Invalid sampling frequency: " << args[1] << std::endl;
+      return true;
+    }
+    return m_executor.profile(true, hz, "");
+  }
+  if (args.size() == 1 && args[0] == "stop")
+    return m_executor.profile(false, 0, "");
+  if (args.size() == 1 && args[0] == "status")
+    return m_executor.profile(std::nullopt, 0, "");
+  if (args.size() == 2 && args[0] == "dump")
+    return m_executor.profile(std::nullopt, 0, args[1]);
+  std::cout << "use: profile start [<hz>]|stop|status|dump <filename>" << std::endl;
+  return true;
+}
+
 bool command_parser_executor::print_height(const std::vector<std::string>& args)
 {
   if (!args.empty()) return false;
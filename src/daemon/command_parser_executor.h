@@ -84,6 +84,10 @@ public:
 
   bool set_log_categories(const std::vector<std::string>& args);
 
+  bool trace(const std::vector<std::string>& args);
+
+  bool profile(const std::vector<std::string>& args);
+
   bool print_height(const std::vector<std::string>& args);
 
   bool print_block(const std::vector<std::string>& args);
@@ -150,6 +154,8 @@ public:
 
   bool print_net_stats(const std::vector<std::string>& args);
 
+  bool print_mem(const std::vector<std::string>& args);
+
   bool print_sn_state_changes(const std::vector<std::string> &args);
 
   bool set_bootstrap_daemon(const std::vector<std::string>& args);
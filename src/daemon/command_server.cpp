@@ -90,6 +90,11 @@ void command_server::init_commands(cryptonote::rpc::core_rpc_server* rpc_server)
     , [this](const auto &x) { return m_parser.print_net_stats(x); }
     , "Print network statistics."
     );
+  m_command_lookup.set_handler(
+      "print_mem"
+    , [this](const auto &x) { return m_parser.print_mem(x); }
+    , "Print the estimated memory use of each subsystem (the tx pool, service node states, block queue, RandomX, resident LMDB pages, p2p buffers, ...) and of the whole process."
+    );
   m_command_lookup.set_handler(
       "print_bc"
     , [this](const auto &x) { return m_parser.print_blockchain_info(x); }
@@ -207,6 +212,18 @@ void command_server::init_commands(cryptonote::rpc::core_rpc_server* rpc_server)
     , "set_log <level>|<{+,-,}categories>"
     , "Change the current log level/categories where <level> is a number 0-4."
     );
+  m_command_lookup.set_handler(
+      "trace"
+    , [this](const auto &x) { return m_parser.trace(x); }
+    , "trace start|stop|clear|dump <filename>"
+    , "Start or stop recording trace spans, discard the recorded spans, or save them to <filename> in Chrome trace JSON format (for chrome://tracing or ui.perfetto.dev)."
+    );
+  m_command_lookup.set_handler(
+      "profile"
+    , [this](const auto &x) { return m_parser.profile(x); }
+    , "profile start [<hz>]|stop|status|dump <filename>"
+    , "Start (at <hz> samples per CPU-second, default 99) or stop the sampling CPU profiler, show how many samples it has taken, or save them to <filename> as collapsed stacks (for flamegraph.pl or speedscope). Frames are module+offset addresses; symbolise them with addr2line against this oxend build."
+    );
   m_command_lookup.set_handler(
       "diff"
     , [this](const auto &x) { return m_parser.show_difficulty(x); }
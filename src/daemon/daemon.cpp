@@ -210,13 +210,22 @@ daemon::daemon(boost::program_options::variables_map vm_) :
   if (!rpc_listen_admin.empty())
   {
     MGINFO("- admin HTTP RPC server");
-    http_rpc_admin.emplace(*rpc, rpc_config, false /*not restricted*/, std::move(rpc_listen_admin));
+    http_rpc_admin.emplace(*rpc, rpc_config, false /*not restricted*/, std::move(rpc_listen_admin),
+        1 /*threads*/, command_line::get_arg(vm, cryptonote::rpc::http_server::arg_rpc_metrics));
   }
 
   if (!rpc_listen_public.empty())
   {
     MGINFO("- public HTTP RPC server");
-    http_rpc_public.emplace(*rpc, rpc_config, true /*restricted*/, std::move(rpc_listen_public));
+    http_rpc_public.emplace(*rpc, rpc_config, true /*restricted*/, std::move(rpc_listen_public),
+        command_line::get_arg(vm, cryptonote::rpc::http_server::arg_rpc_public_threads));
+    cryptonote::rpc::http_server::request_limits limits;
+    limits.max_in_flight = command_line::get_arg(vm, cryptonote::rpc::http_server::arg_rpc_public_max_requests);
+    limits.max_heavy_in_flight = (limits.max_in_flight + 1) / 2;
+    limits.ip_rate = command_line::get_arg(vm, cryptonote::rpc::http_server::arg_rpc_public_rate_limit);
+    limits.ip_burst = command_line::get_arg(vm, cryptonote::rpc::http_server::arg_rpc_public_rate_burst);
+    limits.max_batch = command_line::get_arg(vm, cryptonote::rpc::http_server::arg_rpc_public_max_batch);
+    http_rpc_public->set_request_limits(limits);
   }
 
   MGINFO_BLUE("Done daemon object initialization");
@@ -307,6 +316,12 @@ bool daemon::run(bool interactive)
     if (!core->init(vm, nullptr, get_checkpoints))
       throw std::runtime_error("Failed to start core");
 
+    if (command_line::get_arg(vm, cryptonote::rpc::core_rpc_server::arg_light_wallet_index))
+    {
+      MGINFO("Starting light wallet index");
+      rpc->start_light_wallet_index();
+    }
+
     MGINFO("Starting OxenMQ");
     omq_rpc = std::make_unique<cryptonote::rpc::omq_rpc>(*core, *rpc, vm);
     core->start_oxenmq();
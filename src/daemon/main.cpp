@@ -34,6 +34,7 @@
 #include "common/scoped_message_writer.h"
 #include "common/password.h"
 #include "common/util.h"
+#include "common/thread_affinity.h"
 #include "common/fs.h"
 #include "cryptonote_core/cryptonote_core.h"
 #include "daemonizer/daemonizer.h"
@@ -94,6 +95,7 @@ int main(int argc, char const * argv[])
       command_line::add_arg(core_settings, daemon_args::arg_max_log_file_size);
       command_line::add_arg(core_settings, daemon_args::arg_max_log_files);
       command_line::add_arg(core_settings, daemon_args::arg_max_concurrency);
+      command_line::add_arg(core_settings, daemon_args::arg_thread_affinity);
 
       daemonizer::init_options(hidden_options, visible_options);
       daemonize::daemon::init_options(core_settings, hidden_options);
@@ -310,6 +312,15 @@ int main(int argc, char const * argv[])
     if (!command_line::is_arg_defaulted(vm, daemon_args::arg_max_concurrency))
       tools::set_max_concurrency(command_line::get_arg(vm, daemon_args::arg_max_concurrency));
 
+    for (const auto& assignment : command_line::get_arg(vm, daemon_args::arg_thread_affinity))
+    {
+      if (!tools::set_thread_affinity(assignment))
+      {
+        MERROR("Invalid --thread-affinity value: " << assignment);
+        return 1;
+      }
+    }
+
     // logging is now set up
     // FIXME: only print this when starting up as a daemon but not when running rpc commands
     MGINFO_CYAN("Oxen '" << OXEN_RELEASE_NAME << "' (v" << OXEN_VERSION_FULL << ")");
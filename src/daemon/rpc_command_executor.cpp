@@ -32,8 +32,11 @@
 #include "epee/string_tools.h"
 #include "common/password.h"
 #include "common/scoped_message_writer.h"
+#include "common/string_util.h"
 #include "common/pruning.h"
 #include "common/hex.h"
+#include "common/file.h"
+#include "common/memory_usage.h"
 #include "daemon/rpc_command_executor.h"
 #include "epee/int-util.h"
 #include "rpc/core_rpc_server_commands_defs.h"
@@ -678,6 +681,43 @@ bool rpc_command_executor::print_connections() {
   return true;
 }
 
+bool rpc_command_executor::print_mem()
+{
+  GET_METRICS::response res{};
+  if (!invoke<GET_METRICS>({}, res, "Failed to retrieve metrics"))
+    return false;
+
+  using tools::memory::METRIC_PREFIX, tools::memory::METRIC_SUFFIX;
+  std::optional<double> resident;
+  std::vector<std::pair<std::string, const GET_METRICS::metric*>> tracked;
+  for (auto& m : res.metrics)
+  {
+    std::string_view name{m.name};
+    if (!tools::starts_with(name, METRIC_PREFIX) || !tools::ends_with(name, METRIC_SUFFIX))
+      continue;
+    name.remove_prefix(METRIC_PREFIX.size());
+    name.remove_suffix(METRIC_SUFFIX.size());
+    if (name == "resident")
+      resident = m.value;
+    else
+      tracked.emplace_back(name, &m);
+  }
+  std::sort(tracked.begin(), tracked.end(), [](auto& a, auto& b) { return a.second->value > b.second->value; });
+
+  auto msg = tools::msg_writer();
+  double total = 0;
+  for (auto& [name, m] : tracked)
+  {
+    total += m->value;
+    msg << boost::format("%-18s %10s  %s\n") % name % tools::get_human_readable_bytes(static_cast<uint64_t>(m->value)) % m->help;
+  }
+  if (resident)
+    msg << boost::format("%-18s %10s  %s\n%-18s %10s  %s")
+      % "untracked" % tools::get_human_readable_bytes(static_cast<uint64_t>(std::max(*resident - total, 0.0))) % "Memory not attributed to the above: other heap, allocator overhead, code and stacks"
+      % "resident" % tools::get_human_readable_bytes(static_cast<uint64_t>(*resident)) % "Resident size of the whole process";
+  return true;
+}
+
 bool rpc_command_executor::print_net_stats()
 {
   GET_NET_STATS::response net_stats_res{};
@@ -710,6 +750,19 @@ bool rpc_command_executor::print_net_stats()
     % percent
     % tools::get_human_readable_bytes(limit);
 
+  tools::success_msg_writer() << boost::format("Received %u new blocks: %u reconstructed without requests, %u needed %u missing txes; peers prefilled %u txes, %u of them new to us")
+    % net_stats_res.fluffy_blocks_received
+    % net_stats_res.fluffy_blocks_reconstructed
+    % net_stats_res.fluffy_blocks_missing_requests
+    % net_stats_res.fluffy_blocks_missing_txs
+    % net_stats_res.fluffy_blocks_prefilled_txs
+    % net_stats_res.fluffy_blocks_prefilled_used;
+
+  if (net_stats_res.send_backlog_ms || net_stats_res.recv_backlog_ms)
+    tools::success_msg_writer() << boost::format("Rate limits are currently holding back sends by %ums and reads by %ums")
+      % net_stats_res.send_backlog_ms
+      % net_stats_res.recv_backlog_ms;
+
   return true;
 }
 
@@ -807,6 +860,51 @@ bool rpc_command_executor::set_log_categories(std::string categories) {
   return true;
 }
 
+bool rpc_command_executor::trace(std::optional<bool> enable, bool clear, const std::string& dump_filename) {
+  TRACE::response res{};
+
+  if (!invoke<TRACE>({enable, clear, !dump_filename.empty()}, res, "Failed to control tracing"))
+    return false;
+
+  if (!dump_filename.empty())
+  {
+    if (!tools::dump_file(fs::u8path(dump_filename), res.trace))
+    {
+      tools::fail_msg_writer() << "Failed to write trace to " << dump_filename;
+      return false;
+    }
+    tools::success_msg_writer() << "Saved trace to " << dump_filename;
+  }
+  else if (clear)
+    tools::success_msg_writer() << "Discarded the recorded trace spans";
+  else
+    tools::success_msg_writer() << "Tracing is now " << (res.enabled ? "on" : "off");
+
+  return true;
+}
+
+bool rpc_command_executor::profile(std::optional<bool> enable, uint32_t frequency, const std::string& dump_filename) {
+  PROFILE::response res{};
+
+  if (!invoke<PROFILE>({enable, frequency, !dump_filename.empty()}, res, "Failed to control the profiler"))
+    return false;
+
+  if (!dump_filename.empty())
+  {
+    if (!tools::dump_file(fs::u8path(dump_filename), res.profile))
+    {
+      tools::fail_msg_writer() << "Failed to write profile to " << dump_filename;
+      return false;
+    }
+    tools::success_msg_writer() << "Saved " << res.samples << " samples to " << dump_filename;
+  }
+  else
+    tools::success_msg_writer() << "Profiler is " << (res.running ? "running" : "stopped") << ", " << res.samples << " samples taken"
+      << (res.dropped ? ", " + std::to_string(res.dropped) + " dropped (buffer full)" : "");
+
+  return true;
+}
+
 bool rpc_command_executor::print_height() {
   GET_HEIGHT::response res{};
 
@@ -1049,6 +1147,8 @@ bool rpc_command_executor::print_transaction_pool_stats() {
   tools::msg_writer() << n_transactions << " tx(es), " << res.pool_stats.bytes_total << " bytes total (min " << res.pool_stats.bytes_min << ", max " << res.pool_stats.bytes_max << ", avg " << avg_bytes << ", median " << res.pool_stats.bytes_med << ")" << std::endl
       << "fees " << cryptonote::print_money(res.pool_stats.fee_total) << " (avg " << cryptonote::print_money(n_transactions ? res.pool_stats.fee_total / n_transactions : 0) << " per tx" << ", " << cryptonote::print_money(res.pool_stats.bytes_total ? res.pool_stats.fee_total / res.pool_stats.bytes_total : 0) << " per byte)" << std::endl
       << res.pool_stats.num_double_spends << " double spends, " << res.pool_stats.num_not_relayed << " not relayed, " << res.pool_stats.num_failing << " failing, " << res.pool_stats.num_10m << " older than 10 minutes (oldest " << (res.pool_stats.oldest == 0 ? "-" : get_human_time_ago(res.pool_stats.oldest, now)) << "), " << backlog_message;
+  if (res.pool_stats.num_evicted)
+    tools::msg_writer() << res.pool_stats.num_evicted << " tx(es) (" << res.pool_stats.bytes_evicted << " bytes) evicted to keep the pool within its size limit";
 
   if (n_transactions > 1 && res.pool_stats.histo.size())
   {
@@ -117,6 +117,10 @@ public:
 
   bool set_log_categories(std::string categories);
 
+  bool trace(std::optional<bool> enable, bool clear, const std::string& dump_filename);
+
+  bool profile(std::optional<bool> enable, uint32_t frequency, const std::string& dump_filename);
+
   bool print_height();
 
 private:
@@ -195,6 +199,8 @@ public:
 
   bool print_net_stats();
 
+  bool print_mem();
+
   bool set_bootstrap_daemon(
     const std::string &address,
     const std::string &username,
@@ -160,6 +160,13 @@ namespace hw {
         /*                               SUB ADDRESS                               */
         /* ======================================================================= */
         virtual bool  derive_subaddress_public_key(const crypto::public_key &pub, const crypto::key_derivation &derivation, const std::size_t output_index,  crypto::public_key &derived_pub) = 0;
+        // Batch form of derive_subaddress_public_key; valid[i] says whether derived_pubs[i] was set.
+        virtual bool  derive_subaddress_public_keys(const crypto::public_key *pubs, const crypto::key_derivation *derivations, const std::size_t *output_indices, size_t count, crypto::public_key *derived_pubs, bool *valid)
+        {
+            for (size_t i = 0; i < count; ++i)
+                valid[i] = derive_subaddress_public_key(pubs[i], derivations[i], output_indices[i], derived_pubs[i]);
+            return true;
+        }
         virtual crypto::public_key  get_subaddress_spend_public_key(const cryptonote::account_keys& keys, const cryptonote::subaddress_index& index) = 0;
         virtual std::vector<crypto::public_key>  get_subaddress_spend_public_keys(const cryptonote::account_keys &keys, uint32_t account, uint32_t begin, uint32_t end) = 0;
         virtual cryptonote::account_public_address  get_subaddress(const cryptonote::account_keys& keys, const cryptonote::subaddress_index &index) = 0;
@@ -174,6 +181,14 @@ namespace hw {
         virtual bool  sc_secret_add( crypto::secret_key &r, const crypto::secret_key &a, const crypto::secret_key &b) = 0;
         virtual crypto::secret_key  generate_keys(crypto::public_key &pub, crypto::secret_key &sec, const crypto::secret_key& recovery_key = crypto::secret_key(), bool recover = false) = 0;
         virtual bool  generate_key_derivation(const crypto::public_key &pub, const crypto::secret_key &sec, crypto::key_derivation &derivation) = 0;
+        // Batch form of generate_key_derivation; valid[i] says whether derivations[i] was generated.
+        // Devices that can derive several at once (or on the host) override this.
+        virtual bool  generate_key_derivations(const crypto::public_key *pubs, size_t count, const crypto::secret_key &sec, crypto::key_derivation *derivations, bool *valid)
+        {
+            for (size_t i = 0; i < count; ++i)
+                valid[i] = generate_key_derivation(pubs[i], sec, derivations[i]);
+            return true;
+        }
         virtual bool  conceal_derivation(crypto::key_derivation &derivation, const crypto::public_key &tx_pub_key, const std::vector<crypto::public_key> &additional_tx_pub_keys, const crypto::key_derivation &main_derivation, const std::vector<crypto::key_derivation> &additional_derivations) = 0;
         virtual bool  derivation_to_scalar(const crypto::key_derivation &derivation, const size_t output_index, crypto::ec_scalar &res) = 0;
         virtual bool  derive_secret_key(const crypto::key_derivation &derivation, const std::size_t output_index, const crypto::secret_key &sec,  crypto::secret_key &derived_sec) = 0;
@@ -39,6 +39,7 @@
 #include "ringct/rctOps.h"
 #include "cryptonote_config.h"
 #include <sodium/crypto_generichash.h>
+#include <memory>
 
 namespace hw {
 
@@ -125,6 +126,11 @@ namespace hw {
             return crypto::derive_subaddress_public_key(out_key, derivation, output_index,derived_key);
         }
 
+        bool device_default::derive_subaddress_public_keys(const crypto::public_key *out_keys, const crypto::key_derivation *derivations, const std::size_t *output_indices, size_t count, crypto::public_key *derived_keys, bool *valid) {
+            crypto::derive_subaddress_public_keys(out_keys, derivations, output_indices, count, derived_keys, valid);
+            return true;
+        }
+
         crypto::public_key device_default::get_subaddress_spend_public_key(const cryptonote::account_keys& keys, const cryptonote::subaddress_index &index) {
             if (index.is_zero())
               return keys.m_account_address.m_spend_public_key;
@@ -144,8 +150,7 @@ namespace hw {
         std::vector<crypto::public_key>  device_default::get_subaddress_spend_public_keys(const cryptonote::account_keys &keys, uint32_t account, uint32_t begin, uint32_t end) {
             CHECK_AND_ASSERT_THROW_MES(begin <= end, "begin > end");
 
-            std::vector<crypto::public_key> pkeys;
-            pkeys.reserve(end - begin);
+            std::vector<crypto::public_key> pkeys(end - begin);
             cryptonote::subaddress_index index = {account, begin};
 
             ge_p3 p3;
@@ -154,28 +159,34 @@ namespace hw {
                 "ge_frombytes_vartime failed to convert spend public key");
             ge_p3_to_cached(&cached, &p3);
 
+            // The D's are left in projective form and encoded together at the end, which takes a
+            // single field inversion for the whole range rather than one per subaddress.
+            std::vector<ge_p2> points(end - begin);
+            std::unique_ptr<fe[]> scratch{new fe[end - begin]};
             for (uint32_t idx = begin; idx < end; ++idx)
             {
                 index.minor = idx;
                 if (index.is_zero())
                 {
-                    pkeys.push_back(keys.m_account_address.m_spend_public_key);
+                    // The main address: D = B, filled in below (this just keeps the batch valid)
+                    ge_p3_to_p2(&points[idx - begin], &p3);
                     continue;
                 }
                 crypto::secret_key m = get_subaddress_secret_key(keys.m_view_secret_key, index);
 
                 // M = m*G
-                ge_scalarmult_base(&p3, (const unsigned char*)m.data);
+                ge_p3 M;
+                ge_scalarmult_base(&M, (const unsigned char*)m.data);
 
                 // D = B + M
-                crypto::public_key D;
                 ge_p1p1 p1p1;
-                ge_add(&p1p1, &p3, &cached);
-                ge_p1p1_to_p3(&p3, &p1p1);
-                ge_p3_tobytes((unsigned char*)D.data, &p3);
-
-                pkeys.push_back(D);
+                ge_add(&p1p1, &M, &cached);
+                ge_p1p1_to_p2(&points[idx - begin], &p1p1);
             }
+            static_assert(sizeof(crypto::public_key) == 32, "unexpected public key size");
+            ge_tobytes_batch((unsigned char*)pkeys.data(), points.data(), scratch.get(), points.size());
+            if (account == 0 && begin == 0 && end > 0)
+                pkeys[0] = keys.m_account_address.m_spend_public_key;
             return pkeys;
         }
 
@@ -241,6 +252,11 @@ namespace hw {
             return crypto::generate_key_derivation(key1, key2, derivation);
         }
 
+        bool device_default::generate_key_derivations(const crypto::public_key *pubs, size_t count, const crypto::secret_key &sec, crypto::key_derivation *derivations, bool *valid) {
+            crypto::generate_key_derivations(pubs, count, sec, derivations, valid);
+            return true;
+        }
+
         bool device_default::derivation_to_scalar(const crypto::key_derivation &derivation, const size_t output_index, crypto::ec_scalar &res){
             crypto::derivation_to_scalar(derivation,output_index, res);
             return true;
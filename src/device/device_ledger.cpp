@@ -676,6 +676,8 @@ namespace hw {
         receive_bytes(viewkey.data, 32);
         has_view_key = !is_fake_view_key(viewkey);
         MDEBUG((has_view_key ? "Have view key" : "Have no view key"));
+        if (!has_view_key)
+          MINFO("The device did not export the view key; every transaction scanned will need a device round-trip. Allow view key export in the device app for much faster refreshes.");
 
 #ifdef DEBUG_HWDEVICE
         send_simple(INS_GET_KEY, 0x04);
@@ -766,6 +768,17 @@ namespace hw {
       return true;
     }
 
+    bool device_ledger::derive_subaddress_public_keys(const crypto::public_key *pubs, const crypto::key_derivation *derivations, const std::size_t *output_indices, size_t count, crypto::public_key *derived_pubs, bool *valid) {
+      if (mode == TRANSACTION_PARSE && has_view_key) {
+        //As in derive_subaddress_public_key, the derivations are in the clear: do the batch on the host.
+        MDEBUG("derive_subaddress_public_keys : PARSE mode with known viewkey");
+        crypto::derive_subaddress_public_keys(pubs, derivations, output_indices, count, derived_pubs, valid);
+        return true;
+      }
+      std::lock_guard lock{device_locker};
+      return device::derive_subaddress_public_keys(pubs, derivations, output_indices, count, derived_pubs, valid);
+    }
+
     crypto::public_key device_ledger::get_subaddress_spend_public_key(const cryptonote::account_keys& keys, const cryptonote::subaddress_index &index) {
         auto locks = tools::unique_locks(device_locker, command_locker);
         crypto::public_key D;
@@ -1077,6 +1090,21 @@ namespace hw {
       return r;
     }
 
+    bool device_ledger::generate_key_derivations(const crypto::public_key *pubs, size_t count, const crypto::secret_key &sec, crypto::key_derivation *derivations, bool *valid) {
+      if (mode == TRANSACTION_PARSE && has_view_key) {
+        //Same as generate_key_derivation: with the view key exported there is no need to go
+        //through the device at all, so derive the whole batch on the host at once.
+        MDEBUG( "generate_key_derivations : PARSE mode with known viewkey");
+        assert(is_fake_view_key(sec));
+        crypto::generate_key_derivations(pubs, count, viewkey, derivations, valid);
+        return true;
+      }
+      //The app has no multi-derivation instruction, so this is still one exchange per key; hold
+      //the device for the whole batch so it isn't interleaved with other commands.
+      std::lock_guard lock{device_locker};
+      return device::generate_key_derivations(pubs, count, sec, derivations, valid);
+    }
+
     bool device_ledger::conceal_derivation(crypto::key_derivation &derivation, const crypto::public_key &tx_pub_key, const std::vector<crypto::public_key> &additional_tx_pub_keys, const crypto::key_derivation &main_derivation, const std::vector<crypto::key_derivation> &additional_derivations) {
       const crypto::public_key *pkey = nullptr;
       if (derivation == main_derivation) {
@@ -28,6 +28,7 @@
 
 #include "dandelionpp.h"
 
+#include <algorithm>
 #include <boost/container/small_vector.hpp>
 #include <boost/uuid/nil_generator.hpp>
 #include <chrono>
@@ -44,22 +45,6 @@ namespace dandelionpp
     {
         constexpr const std::size_t expected_max_channels = CRYPTONOTE_NOISE_CHANNELS;
 
-        // could be in util somewhere
-        struct key_less
-        {
-            template<typename K, typename V>
-            bool operator()(const std::pair<K, V>& left, const K& right) const
-            {
-                return left.first < right;
-            }
-
-            template<typename K, typename V>
-            bool operator()(const K& left, const std::pair<K, V>& right) const
-            {
-                return left < right.first;
-            }
-        };
-
         std::size_t select_stem(epee::span<const std::size_t> usage, epee::span<const boost::uuids::uuid> out_map)
         {
             assert(usage.size() < std::numeric_limits<std::size_t>::max()); // prevented in constructor
@@ -102,6 +87,7 @@ namespace dandelionpp
 
     connection_map::connection_map(std::vector<boost::uuids::uuid> out_connections, const std::size_t stems)
       : out_mapping_(std::move(out_connections)),
+        out_index_(),
         in_mapping_(),
         usage_count_()
     {
@@ -121,6 +107,12 @@ namespace dandelionpp
         {
             std::shuffle(out_mapping_.begin(), out_mapping_.end(), crypto::random_device{});
         }
+
+        for (std::size_t i = 0; i < out_mapping_.size(); ++i)
+        {
+            if (!out_mapping_[i].is_nil())
+                out_index_.emplace(out_mapping_[i], i);
+        }
     }
 
     connection_map::~connection_map() noexcept
@@ -133,19 +125,29 @@ namespace dandelionpp
 
     bool connection_map::update(std::vector<boost::uuids::uuid> current)
     {
-        std::sort(current.begin(), current.end());
+        // remove connections already in use, leaving only candidates for empty stems
+        std::vector<bool> alive(out_mapping_.size(), false);
+        current.erase(
+            std::remove_if(current.begin(), current.end(), [this, &alive] (const boost::uuids::uuid& connection) {
+                const auto elem = out_index_.find(connection);
+                if (elem == out_index_.end())
+                    return false;
+                alive[elem->second] = true;
+                return true;
+            }),
+            current.end()
+        );
 
         bool replace = false;
-        for (auto& existing_out : out_mapping_)
+        for (std::size_t i = 0; i < out_mapping_.size(); ++i)
         {
-            const auto elem = std::lower_bound(current.begin(), current.end(), existing_out);
-            if (elem == current.end() || *elem != existing_out)
+            if (!alive[i])
             {
-                existing_out = boost::uuids::nil_uuid();
+                if (!out_mapping_[i].is_nil())
+                    out_index_.erase(out_mapping_[i]);
+                out_mapping_[i] = boost::uuids::nil_uuid();
                 replace = true;
             }
-            else // already using connection, remove it from candidate list
-                current.erase(elem);
         }
 
         if (!replace && out_mapping_.size() == usage_count_.size())
@@ -162,6 +164,7 @@ namespace dandelionpp
                     out_mapping_.push_back(current.back());
                 else
                     out_mapping_[i] = current.back();
+                out_index_.emplace(current.back(), i);
                 current.pop_back();
             }
         }
@@ -169,6 +172,17 @@ namespace dandelionpp
         return replace || existing_outs < out_mapping_.size();
     }
 
+    bool connection_map::remove(const boost::uuids::uuid& connection)
+    {
+        const auto elem = out_index_.find(connection);
+        if (elem == out_index_.end())
+            return false;
+
+        out_mapping_.at(elem->second) = boost::uuids::nil_uuid();
+        out_index_.erase(elem);
+        return true;
+    }
+
     std::size_t connection_map::size() const noexcept
     {
         std::size_t count = 0;
@@ -182,14 +196,14 @@ namespace dandelionpp
 
     boost::uuids::uuid connection_map::get_stem(const boost::uuids::uuid& source)
     {
-        auto elem = std::lower_bound(in_mapping_.begin(), in_mapping_.end(), source, key_less{});
-        if (elem == in_mapping_.end() || elem->first != source)
+        auto elem = in_mapping_.find(source);
+        if (elem == in_mapping_.end())
         {
             const std::size_t index = select_stem(epee::to_span(usage_count_), epee::to_span(out_mapping_));
             if (out_mapping_.size() < index)
                 return boost::uuids::nil_uuid();
 
-            elem = in_mapping_.emplace(elem, source, index);
+            elem = in_mapping_.emplace(source, index).first;
             usage_count_[index]++;
         }
         else if (out_mapping_.at(elem->second).is_nil()) // stem connection disconnected after mapping
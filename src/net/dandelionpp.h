@@ -28,9 +28,11 @@
 
 #pragma once
 
+#include <boost/functional/hash.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <cstddef>
 #include <memory>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -43,9 +45,12 @@ namespace dandelionpp
     //! Assists with mapping source -> stem and tracking connections for stem.
     class connection_map
     {
+        using index_map = std::unordered_map<boost::uuids::uuid, std::size_t, boost::hash<boost::uuids::uuid>>;
+
         // Make sure to update clone method if changing members
         std::vector<boost::uuids::uuid> out_mapping_; //<! Current outgoing uuid connection at index.
-        std::vector<std::pair<boost::uuids::uuid, std::size_t>> in_mapping_; //<! uuid source to an `out_mapping_` index.
+        index_map out_index_; //<! Non-nil `out_mapping_` entries to their index.
+        index_map in_mapping_; //<! uuid source to an `out_mapping_` index.
         std::vector<std::size_t> usage_count_;
 
         // Use clone method to prevent "hidden" copies.
@@ -96,6 +101,13 @@ namespace dandelionpp
             \return True if any updates to `get_connections()` was made. */
         bool update(std::vector<boost::uuids::uuid> current);
 
+        /*! Marks a single stem connection as dead without rescanning the
+            connection list; sources mapped to it are re-assigned on their
+            next `get_stem` call, and `update` will fill the slot.
+
+            \return True if `connection` was a stem. */
+        bool remove(const boost::uuids::uuid& connection);
+
         //! \return Number of outgoing connections in use.
         std::size_t size() const noexcept;
 
@@ -146,6 +146,7 @@ namespace nodetool
     const command_line::arg_descriptor<std::vector<std::string> > arg_anonymous_inbound = {"anonymous-inbound", "<hidden-service-address>,<[bind-ip:]port>[,max_connections] i.e. \"x.onion,127.0.0.1:18083,100\""};
     const command_line::arg_descriptor<bool> arg_p2p_hide_my_port   =    {"hide-my-port", "Do not announce yourself as peerlist candidate", false, true};
     const command_line::arg_descriptor<bool> arg_no_sync = {"no-sync", "Don't synchronize the blockchain with other peers", false};
+    const command_line::arg_descriptor<uint32_t> arg_p2p_tx_relay_delay = {"p2p-tx-relay-delay", "Milliseconds to collect transactions for before relaying them together to each public peer (0 to relay each notification immediately)", 100};
 
     const command_line::arg_descriptor<bool>        arg_no_igd  = {"no-igd", "Backwards compatibility option (this is now the default)"};
     const command_line::arg_descriptor<std::string> arg_igd = {"igd", "UPnP port mapping (disabled, enabled, delayed)", "disabled"};
@@ -158,6 +159,8 @@ namespace nodetool
     const command_line::arg_descriptor<int64_t> arg_limit_rate_up = {"limit-rate-up", "set limit-rate-up [kB/s]", P2P_DEFAULT_LIMIT_RATE_UP};
     const command_line::arg_descriptor<int64_t> arg_limit_rate_down = {"limit-rate-down", "set limit-rate-down [kB/s]", P2P_DEFAULT_LIMIT_RATE_DOWN};
     const command_line::arg_descriptor<int64_t> arg_limit_rate = {"limit-rate", "set limit-rate [kB/s]", -1};
+    const command_line::arg_descriptor<uint64_t> arg_limit_rate_peer = {"limit-rate-peer", "set limit-rate for each connection, up and down [kB/s]; 0 for none", 0};
+    const command_line::arg_descriptor<std::vector<std::string>> arg_limit_rate_zone = {"limit-rate-zone", "set limit-rate shared by a network's connections, up and down: <network-type>:<kB/s> i.e. \"tor:128\""};
 
     std::optional<std::vector<proxy>> get_proxies(boost::program_options::variables_map const& vm)
     {
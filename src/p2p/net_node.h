@@ -37,6 +37,7 @@
 #include <boost/program_options/variables_map.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <functional>
+#include <future>
 #include <utility>
 #include <vector>
 #include <shared_mutex>
@@ -56,6 +57,7 @@
 #include "common/command_line.h"
 #include "common/periodic_task.h"
 #include "common/fs.h"
+#include "common/metrics.h"
 
 PUSH_WARNINGS
 DISABLE_VS_WARNINGS(4355)
@@ -341,9 +343,20 @@ namespace nodetool
     bool do_handshake_with_peer(peerid_type& pi, p2p_connection_context& context, bool just_take_peerlist = false);
     bool do_peer_timed_sync(const epee::net_utils::connection_context_base& context, peerid_type peer_id);
 
-    bool make_new_connection_from_anchor_peerlist(const std::vector<anchor_peerlist_entry>& anchor_peerlist);
-    bool make_new_connection_from_peerlist(network_zone& zone, bool use_white_list);
+    //! A peer selected for an outgoing connection
+    struct connect_attempt
+    {
+      epee::net_utils::network_address adr;
+      uint64_t last_seen;
+      PeerType peer_type;
+      uint64_t first_seen;
+    };
+
+    bool make_new_connection_from_anchor_peerlist(const std::vector<anchor_peerlist_entry>& anchor_peerlist, size_t max_attempts = 1);
+    bool make_new_connection_from_peerlist(network_zone& zone, bool use_white_list, size_t max_attempts = 1);
     bool try_to_connect_and_handshake_with_new_peer(const epee::net_utils::network_address& na, bool just_take_peerlist = false, uint64_t last_seen_stamp = 0, PeerType peer_type = white, uint64_t first_seen_stamp = 0);
+    //! Connects and handshakes with all of `attempts` at once; returns how many succeeded.
+    size_t try_to_connect_in_parallel(std::vector<connect_attempt> attempts);
     size_t get_random_index_with_fixed_probability(size_t max_index);
     bool is_peer_used(const peerlist_entry& peer);
     bool is_peer_used(const anchor_peerlist_entry& peer);
@@ -380,6 +393,7 @@ namespace nodetool
     bool set_rate_up_limit(const boost::program_options::variables_map& vm, int64_t limit);
     bool set_rate_down_limit(const boost::program_options::variables_map& vm, int64_t limit);
     bool set_rate_limit(const boost::program_options::variables_map& vm, int64_t limit);
+    bool set_zone_rate_limits(const boost::program_options::variables_map& vm);
 
     bool has_too_many_connections(const epee::net_utils::network_address &address);
     size_t get_incoming_connections_count();
@@ -390,6 +404,7 @@ namespace nodetool
     bool check_connection_and_handshake_with_peer(const epee::net_utils::network_address& na, uint64_t last_seen_stamp);
     bool gray_peerlist_housekeeping();
     bool check_incoming_connections();
+    bool close_stale_circuits();
 
     void kill() { ///< will be called e.g. from deinit()
       MINFO("Killing the net_node");
@@ -441,11 +456,14 @@ namespace nodetool
     tools::periodic_task m_peerlist_store_interval{30min};
     tools::periodic_task m_gray_peerlist_housekeeping_interval{1min};
     tools::periodic_task m_incoming_connections_interval{1h};
+    tools::periodic_task m_stale_circuits_interval{30s};
 
     std::list<epee::net_utils::network_address>   m_priority_peers;
     std::vector<epee::net_utils::network_address> m_exclusive_peers;
     std::vector<epee::net_utils::network_address> m_seed_nodes;
     std::atomic<bool> m_seed_nodes_initialized{false};
+    // DNS lookups of m_seed_nodes_list, started by init() so they don't hold up the first connect_to_seed
+    std::future<std::vector<std::vector<std::string>>> m_seed_nodes_dns;
     std::shared_mutex m_seed_nodes_mutex;
     std::atomic_flag m_fallback_seed_nodes_added;
     std::vector<nodetool::peerlist_entry> m_command_line_peers;
@@ -480,6 +498,8 @@ namespace nodetool
 
     boost::uuids::uuid m_network_id;
     cryptonote::network_type m_nettype;
+
+    tools::metrics::registration m_memory_metric;
   };
 
     const int64_t default_limit_up = P2P_DEFAULT_LIMIT_RATE_UP;      // kB/s
@@ -500,6 +520,7 @@ namespace nodetool
     extern const command_line::arg_descriptor<std::vector<std::string> > arg_anonymous_inbound;
     extern const command_line::arg_descriptor<bool> arg_p2p_hide_my_port;
     extern const command_line::arg_descriptor<bool> arg_no_sync;
+    extern const command_line::arg_descriptor<uint32_t> arg_p2p_tx_relay_delay;
 
     extern const command_line::arg_descriptor<bool>        arg_no_igd;
     extern const command_line::arg_descriptor<std::string> arg_igd;
@@ -511,6 +532,8 @@ namespace nodetool
     extern const command_line::arg_descriptor<int64_t> arg_limit_rate_up;
     extern const command_line::arg_descriptor<int64_t> arg_limit_rate_down;
     extern const command_line::arg_descriptor<int64_t> arg_limit_rate;
+    extern const command_line::arg_descriptor<uint64_t> arg_limit_rate_peer;
+    extern const command_line::arg_descriptor<std::vector<std::string>> arg_limit_rate_zone;
 }
 
 POP_WARNINGS
@@ -36,6 +36,7 @@
 #include <boost/uuid/uuid_io.hpp>
 #include <atomic>
 #include <functional>
+#include <future>
 #include <limits>
 #include <memory>
 #include <tuple>
@@ -45,8 +46,11 @@
 #include "version.h"
 #include "epee/string_tools.h"
 #include "common/file.h"
+#include "common/memory_usage.h"
 #include "common/dns_utils.h"
 #include "common/pruning.h"
+#include "common/string_util.h"
+#include "common/thread_affinity.h"
 #include "net/error.h"
 #include "common/periodic_task.h"
 #include "epee/misc_log_ex.h"
@@ -107,6 +111,7 @@ namespace nodetool
     command_line::add_arg(desc, arg_anonymous_inbound);
     command_line::add_arg(desc, arg_p2p_hide_my_port);
     command_line::add_arg(desc, arg_no_sync);
+    command_line::add_arg(desc, arg_p2p_tx_relay_delay);
     command_line::add_arg(desc, arg_no_igd);
     command_line::add_arg(desc, arg_igd);
     command_line::add_arg(desc, arg_out_peers);
@@ -115,6 +120,8 @@ namespace nodetool
     command_line::add_arg(desc, arg_limit_rate_up);
     command_line::add_arg(desc, arg_limit_rate_down);
     command_line::add_arg(desc, arg_limit_rate);
+    command_line::add_arg(desc, arg_limit_rate_peer);
+    command_line::add_arg(desc, arg_limit_rate_zone);
   }
   //-----------------------------------------------------------------------------------
   template<class t_payload_net_handler>
@@ -388,7 +395,8 @@ namespace nodetool
     m_use_ipv6 = command_line::get_arg(vm, arg_p2p_use_ipv6);
     m_require_ipv4 = !command_line::get_arg(vm, arg_p2p_ignore_ipv4);
     public_zone.m_notifier = cryptonote::levin::notify{
-      public_zone.m_net_server.get_io_service(), public_zone.m_net_server.get_config_shared(), {}, true
+      public_zone.m_net_server.get_io_service(), public_zone.m_net_server.get_config_shared(), {}, true,
+      std::chrono::milliseconds{command_line::get_arg(vm, arg_p2p_tx_relay_delay)}
     };
 
     if (command_line::has_arg(vm, arg_p2p_add_peer))
@@ -470,6 +478,9 @@ namespace nodetool
     if ( !set_rate_limit(vm, command_line::get_arg(vm, arg_limit_rate) ) )
       return false;
 
+    if ( !set_zone_rate_limits(vm) )
+      return false;
+
 
     epee::shared_sv noise;
     auto proxies = get_proxies(vm);
@@ -653,7 +664,9 @@ namespace nodetool
     // TODO: at some point add IPv6 support, but that won't be relevant
     // for some time yet.
 
-    auto dns_results = tools::DNSResolver::instance().get_many(tools::DNS_TYPE_A, m_seed_nodes_list, ::config::DNS_TIMEOUT);
+    auto dns_results = m_seed_nodes_dns.valid()
+      ? m_seed_nodes_dns.get()
+      : tools::DNSResolver::instance().get_many(tools::DNS_TYPE_A, m_seed_nodes_list, ::config::DNS_TIMEOUT);
 
     for (size_t i = 0; i < dns_results.size(); i++)
     {
@@ -710,6 +723,10 @@ namespace nodetool
       memcpy(&m_network_id, &::config::NETWORK_ID, 16);
     }
 
+    if (!m_seed_nodes_list.empty() && m_exclusive_peers.empty() && !m_offline
+        && m_nettype != cryptonote::TESTNET && m_nettype != cryptonote::DEVNET)
+      m_seed_nodes_dns = tools::DNSResolver::instance().get_many_async(tools::DNS_TYPE_A, m_seed_nodes_list, ::config::DNS_TIMEOUT);
+
     m_config_folder = fs::u8path(command_line::get_arg(vm, cryptonote::arg_data_dir));
     network_zone& public_zone = m_network_zones.at(epee::net_utils::zone::public_);
 
@@ -760,6 +777,14 @@ namespace nodetool
     //configure self
 
     public_zone.m_net_server.set_threads_prefix("P2P"); // all zones use these threads/asio::io_service
+    public_zone.m_net_server.set_thread_init([](uint32_t index) { tools::pin_thread_to_pool("p2p", index); });
+
+    m_memory_metric = tools::memory::track("p2p", "P2P connection read buffers and send queues", [this] {
+      uint64_t connections = 0;
+      for (auto& zone : m_network_zones)
+        connections += zone.second.m_net_server.get_connections_count();
+      return connections * sizeof(std::array<char, 8192>) + epee::net_utils::connection_basic::send_que_bytes.load();
+    });
 
     // from here onwards, it's online stuff
     if (m_offline)
@@ -1309,8 +1334,9 @@ namespace nodetool
   }
   //-----------------------------------------------------------------------------------
   template<class t_payload_net_handler>
-  bool node_server<t_payload_net_handler>::make_new_connection_from_anchor_peerlist(const std::vector<anchor_peerlist_entry>& anchor_peerlist)
+  bool node_server<t_payload_net_handler>::make_new_connection_from_anchor_peerlist(const std::vector<anchor_peerlist_entry>& anchor_peerlist, size_t max_attempts)
   {
+    std::vector<connect_attempt> attempts;
     for (const auto& pe: anchor_peerlist) {
       MDEBUG("Considering connecting (out) to anchor peer: " << peerid_to_string(pe.id) << " " << pe.adr.str());
 
@@ -1331,27 +1357,36 @@ namespace nodetool
                                << "[peer_type=" << anchor
                                << "] first_seen: " << epee::misc_utils::get_time_interval_string(time(NULL) - pe.first_seen));
 
-      if(!try_to_connect_and_handshake_with_new_peer(pe.adr, false, 0, anchor, pe.first_seen)) {
-        MDEBUG("Handshake failed");
+      attempts.push_back({pe.adr, 0, anchor, pe.first_seen});
+      if (attempts.size() < max_attempts)
         continue;
-      }
 
-      return true;
+      if (try_to_connect_in_parallel(std::move(attempts)))
+        return true;
+      attempts.clear();
     }
 
-    return false;
+    return !attempts.empty() && try_to_connect_in_parallel(std::move(attempts));
   }
   //-----------------------------------------------------------------------------------
   template<class t_payload_net_handler>
-  bool node_server<t_payload_net_handler>::make_new_connection_from_peerlist(network_zone& zone, bool use_white_list)
+  bool node_server<t_payload_net_handler>::make_new_connection_from_peerlist(network_zone& zone, bool use_white_list, size_t max_attempts)
   {
     size_t max_random_index = 0;
 
     std::set<size_t> tried_peers;
 
+    // Peers to connect to at once.  An address family only gets half of a batch while the other
+    // family has candidates, so that if one is unreachable from here (typically a broken IPv6
+    // route) it can't tie up every attempt; the rest wait in `overflow`.
+    std::vector<connect_attempt> attempts, overflow;
+    const auto is_ipv6 = [](const epee::net_utils::network_address& adr) {
+      return adr.get_type_id() == epee::net_utils::ipv6_network_address::get_type_id();
+    };
+
     size_t try_count = 0;
     size_t rand_count = 0;
-    while(rand_count < (max_random_index+1)*3 &&  try_count < 10 && !zone.m_net_server.is_stop_signal_sent())
+    while(rand_count < (max_random_index+1)*3*max_attempts &&  try_count < 10 && !zone.m_net_server.is_stop_signal_sent())
     {
       ++rand_count;
       size_t random_index;
@@ -1407,7 +1442,7 @@ namespace nodetool
       if (filtered.empty())
       {
         MDEBUG("No available peer in " << (use_white_list ? "white" : "gray") << " list filtered by " << next_needed_pruning_stripe);
-        return false;
+        break;
       }
       if (use_white_list)
       {
@@ -1468,14 +1503,53 @@ namespace nodetool
                     << "[peer_list=" << (use_white_list ? white : gray)
                     << "] last_seen: " << (pe.last_seen ? epee::misc_utils::get_time_interval_string(time(NULL) - pe.last_seen) : "never"));
 
-      if(!try_to_connect_and_handshake_with_new_peer(pe.adr, false, pe.last_seen, use_white_list ? white : gray)) {
-        MDEBUG("Handshake failed");
+      connect_attempt attempt{pe.adr, static_cast<uint64_t>(pe.last_seen), use_white_list ? white : gray, 0};
+      const bool ipv6 = is_ipv6(pe.adr);
+      const size_t same_family = std::count_if(attempts.begin(), attempts.end(), [&](const connect_attempt& a) { return is_ipv6(a.adr) == ipv6; });
+      if (same_family >= (max_attempts + 1) / 2)
+      {
+        overflow.push_back(std::move(attempt));
         continue;
       }
+      attempts.push_back(std::move(attempt));
+      if (attempts.size() < max_attempts)
+        continue;
 
-      return true;
+      if (try_to_connect_in_parallel(std::move(attempts)))
+        return true;
+      attempts.clear();
     }
-    return false;
+
+    // only one family left to try
+    for (size_t i = 0; i < overflow.size() && attempts.size() < max_attempts; ++i)
+      attempts.push_back(std::move(overflow[i]));
+
+    return !attempts.empty() && try_to_connect_in_parallel(std::move(attempts));
+  }
+  //-----------------------------------------------------------------------------------
+  template<class t_payload_net_handler>
+  size_t node_server<t_payload_net_handler>::try_to_connect_in_parallel(std::vector<connect_attempt> attempts)
+  {
+    const auto attempt = [this](const connect_attempt& a) {
+      if (try_to_connect_and_handshake_with_new_peer(a.adr, false, a.last_seen, a.peer_type, a.first_seen))
+        return true;
+      MDEBUG("Handshake failed");
+      return false;
+    };
+
+    if (attempts.size() == 1)
+      return attempt(attempts.front());
+
+    MDEBUG("Connecting to " << attempts.size() << " peers at once");
+    std::vector<std::future<bool>> others;
+    others.reserve(attempts.size() - 1);
+    for (size_t i = 1; i < attempts.size(); ++i)
+      others.push_back(std::async(std::launch::async, attempt, std::cref(attempts[i])));
+
+    size_t connected = attempt(attempts.front());
+    for (auto& other : others)
+      connected += other.get();
+    return connected;
   }
   //-----------------------------------------------------------------------------------
   template<class t_payload_net_handler>
@@ -1584,9 +1658,10 @@ namespace nodetool
         const size_t expected_white_connections = m_payload_handler.get_next_needed_pruning_stripe().second ? zone.second.m_config.m_net_config.max_out_connection_count : base_expected_white_connections;
         if(conn_count < expected_white_connections)
         {
-          //start from anchor list
-          while (get_outgoing_connections_count(zone.second) < P2P_DEFAULT_ANCHOR_CONNECTIONS_COUNT
-            && make_expected_connections_count(zone.second, anchor, P2P_DEFAULT_ANCHOR_CONNECTIONS_COUNT));
+          //start from anchor list: these are the peers we had last time, so try as many as we have room for
+          const size_t expected_anchor_connections = std::max<size_t>(P2P_DEFAULT_ANCHOR_CONNECTIONS_COUNT, expected_white_connections);
+          while (get_outgoing_connections_count(zone.second) < expected_anchor_connections
+            && make_expected_connections_count(zone.second, anchor, expected_anchor_connections));
           //then do white list
           while (get_outgoing_connections_count(zone.second) < expected_white_connections
             && make_expected_connections_count(zone.second, white, expected_white_connections));
@@ -1647,15 +1722,17 @@ namespace nodetool
 
       MDEBUG("Making expected connection, type " << peer_type << ", " << conn_count << "/" << expected_connections << " connections");
 
-      if (peer_type == anchor && !make_new_connection_from_anchor_peerlist(apl)) {
+      const size_t attempts = std::min<size_t>(P2P_DEFAULT_CONNECT_ATTEMPTS_IN_FLIGHT, expected_connections - conn_count);
+
+      if (peer_type == anchor && !make_new_connection_from_anchor_peerlist(apl, attempts)) {
         return false;
       }
 
-      if (peer_type == white && !make_new_connection_from_peerlist(zone, true)) {
+      if (peer_type == white && !make_new_connection_from_peerlist(zone, true, attempts)) {
         return false;
       }
 
-      if (peer_type == gray && !make_new_connection_from_peerlist(zone, false)) {
+      if (peer_type == gray && !make_new_connection_from_peerlist(zone, false, attempts)) {
         return false;
       }
     }
@@ -1765,6 +1842,34 @@ namespace nodetool
     m_gray_peerlist_housekeeping_interval.do_call([this] { return gray_peerlist_housekeeping(); });
     m_peerlist_store_interval.do_call([this] { return store_config(); });
     m_incoming_connections_interval.do_call([this] { return check_incoming_connections(); });
+    m_stale_circuits_interval.do_call([this] { return close_stale_circuits(); });
+    return true;
+  }
+  //-----------------------------------------------------------------------------------
+  template<class t_payload_net_handler>
+  bool node_server<t_payload_net_handler>::close_stale_circuits()
+  {
+    // A tor/i2p circuit can die without the connection noticing; closing it lets connections_maker
+    // replace it before we need it for a tx.
+    const auto now = std::chrono::steady_clock::now();
+    for (auto& [type, zone] : m_network_zones)
+    {
+      if (type == epee::net_utils::zone::public_ || zone.m_connect == nullptr)
+        continue;
+
+      std::vector<boost::uuids::uuid> stale;
+      zone.m_net_server.get_config_object().foreach_connection([&](const p2p_connection_context& cntxt)
+      {
+        if (!cntxt.m_is_income && now - std::max(cntxt.m_started, cntxt.m_last_recv) > std::chrono::seconds{CRYPTONOTE_STALE_CIRCUIT_TIMEOUT})
+          stale.push_back(cntxt.m_connection_id);
+        return true;
+      });
+      for (const auto& id : stale)
+      {
+        MINFO("Closing " << epee::net_utils::zone_to_string(type) << " connection " << id << ": nothing received for " << CRYPTONOTE_STALE_CIRCUIT_TIMEOUT << "s");
+        zone.m_net_server.get_config_object().close(id);
+      }
+    }
     return true;
   }
   //-----------------------------------------------------------------------------------
@@ -1919,6 +2024,11 @@ namespace nodetool
   template<class t_payload_net_handler>
   bool node_server<t_payload_net_handler>::relay_notify_to_list(int command, const epee::span<const uint8_t> data_buff, std::vector<std::pair<epee::net_utils::zone, boost::uuids::uuid>> connections)
   {
+    if (connections.empty())
+      return true;
+    // Build the levin message once and share it between all the connections rather than having
+    // each send make its own copy of the payload.
+    epee::shared_sv message{epee::levin::make_notify(command, data_buff)};
     std::sort(connections.begin(), connections.end());
     auto zone = m_network_zones.begin();
     for(const auto& c_id: connections)
@@ -1936,7 +2046,7 @@ namespace nodetool
         ++zone;
       }
       if (zone->first == c_id.first)
-        zone->second.m_net_server.get_config_object().notify(command, data_buff, c_id.second);
+        zone->second.m_net_server.get_config_object().send(message, c_id.second);
     }
     return true;
   }
@@ -2560,6 +2670,32 @@ namespace nodetool
     return true;
   }
 
+  template<class t_payload_net_handler>
+  bool node_server<t_payload_net_handler>::set_zone_rate_limits(const boost::program_options::variables_map& vm)
+  {
+    using connection_t = epee::net_utils::connection<epee::levin::async_protocol_handler<p2p_connection_context>>;
+
+    const uint64_t peer_limit = command_line::get_arg(vm, arg_limit_rate_peer);
+    connection_t::set_peer_rate_limit(peer_limit);
+    if (peer_limit)
+      MINFO("Set per-connection limit to " << peer_limit << " kB/s");
+
+    for (std::string_view arg : command_line::get_arg(vm, arg_limit_rate_zone))
+    {
+      const auto pos = arg.find(':');
+      const auto zone = epee::net_utils::zone_from_string(arg.substr(0, pos));
+      uint64_t limit = 0;
+      if (pos == std::string_view::npos || zone == epee::net_utils::zone::invalid || !tools::parse_int(arg.substr(pos + 1), limit))
+      {
+        MERROR("Invalid value given to --" << arg_limit_rate_zone.name << ": " << arg);
+        return false;
+      }
+      connection_t::set_zone_rate_limit(zone, limit);
+      MINFO("Set " << epee::net_utils::zone_to_string(zone) << " limit to " << limit << " kB/s");
+    }
+    return true;
+  }
+
   template<class t_payload_net_handler>
   bool node_server<t_payload_net_handler>::has_too_many_connections(const epee::net_utils::network_address &address)
   {
@@ -29,18 +29,20 @@
 #include "net_peerlist.h"
 
 #include <algorithm>
+#include <cstring>
 #include <functional>
 #include <fstream>
 #include <iterator>
+#include <sstream>
 
 #include <boost/archive/binary_iarchive.hpp>
-#include <boost/archive/portable_binary_oarchive.hpp>
 #include <boost/archive/portable_binary_iarchive.hpp>
-#include <boost/range/join.hpp>
 #include <boost/serialization/version.hpp>
 
 #include "net_peerlist_boost_serialization.h"
+#include "common/file.h"
 #include "common/fs.h"
+#include "common/varint.h"
 
 
 namespace nodetool
@@ -48,6 +50,226 @@ namespace nodetool
   namespace
   {
     constexpr unsigned CURRENT_PEERLIST_STORAGE_ARCHIVE_VER = 6;
+
+    // Start of a peer store log file.  Anything else is treated as an older boost archive.
+    constexpr std::string_view STORE_MAGIC{"oxenpeers\x01", 10};
+    // Logs with fewer records than this are always appended to rather than compacted
+    constexpr size_t STORE_COMPACT_MIN_RECORDS = 1000;
+
+    // Each log record is a varint length followed by that many bytes of: a kind byte (list to
+    // which it applies, plus the erase flag), the address and, unless erasing, the entry fields.
+    // Everything up to the end of the address is the entry's key: a later record for the same key
+    // replaces (or erases) an earlier one.
+    enum class record_list : uint8_t { white = 0, gray = 1, anchor = 2 };
+    constexpr uint8_t RECORD_ERASE = 0x80;
+
+    template <typename T>
+    void write_int(std::string& out, T v)
+    {
+      tools::write_varint(std::back_inserter(out), static_cast<std::make_unsigned_t<T>>(v));
+    }
+
+    template <typename T>
+    bool read_int(std::string_view& in, T& v)
+    {
+      std::make_unsigned_t<T> u;
+      auto it = in.begin();
+      if (tools::read_varint(it, in.end(), u) <= 0)
+        return false;
+      in.remove_prefix(it - in.begin());
+      v = static_cast<T>(u);
+      return true;
+    }
+
+    bool read_bytes(std::string_view& in, void* dest, size_t size)
+    {
+      if (in.size() < size)
+        return false;
+      std::memcpy(dest, in.data(), size);
+      in.remove_prefix(size);
+      return true;
+    }
+
+    template <typename Address>
+    void write_host(std::string& out, const Address& a)
+    {
+      const size_t length = std::strlen(a.host_str());
+      if (length > 255)
+        throw std::runtime_error{"Hidden service address too long"};
+      write_int(out, a.port());
+      out += static_cast<char>(length);
+      out.append(a.host_str(), length);
+    }
+
+    template <typename Address>
+    bool read_host(std::string_view& in, epee::net_utils::network_address& na)
+    {
+      uint16_t port;
+      uint8_t length;
+      if (!read_int(in, port) || !read_bytes(in, &length, 1) || in.size() < length || length > Address::buffer_size())
+        return false;
+      const std::string_view host{in.data(), length};
+      in.remove_prefix(length);
+      if (host == Address::unknown_str())
+      {
+        na = Address::unknown();
+        return true;
+      }
+      auto address = Address::make(host, port);
+      if (!address)
+        return false;
+      na = std::move(address).value();
+      return true;
+    }
+
+    void write_address(std::string& out, const epee::net_utils::network_address& na)
+    {
+      using namespace epee::net_utils;
+      const auto type = na.get_type_id();
+      out += static_cast<char>(type);
+      switch (type)
+      {
+        case ipv4_network_address::get_type_id():
+        {
+          const auto& a = na.as<ipv4_network_address>();
+          const uint32_t ip = a.ip(); // already in network byte order
+          out.append(reinterpret_cast<const char*>(&ip), sizeof(ip));
+          write_int(out, a.port());
+          break;
+        }
+        case ipv6_network_address::get_type_id():
+        {
+          const auto& a = na.as<ipv6_network_address>();
+          const auto bytes = a.ip().to_bytes();
+          out.append(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+          write_int(out, a.port());
+          break;
+        }
+        case net::tor_address::get_type_id():
+          write_host(out, na.as<net::tor_address>());
+          break;
+        case net::i2p_address::get_type_id():
+          write_host(out, na.as<net::i2p_address>());
+          break;
+        default:
+          throw std::runtime_error{"Unsupported network address type"};
+      }
+    }
+
+    bool read_address(std::string_view& in, epee::net_utils::network_address& na)
+    {
+      using namespace epee::net_utils;
+      uint8_t type;
+      if (!read_bytes(in, &type, 1))
+        return false;
+      switch (address_type{type})
+      {
+        case ipv4_network_address::get_type_id():
+        {
+          uint32_t ip;
+          uint16_t port;
+          if (!read_bytes(in, &ip, sizeof(ip)) || !read_int(in, port))
+            return false;
+          na = ipv4_network_address{ip, port};
+          return true;
+        }
+        case ipv6_network_address::get_type_id():
+        {
+          boost::asio::ip::address_v6::bytes_type bytes;
+          uint16_t port;
+          if (!read_bytes(in, bytes.data(), bytes.size()) || !read_int(in, port))
+            return false;
+          na = ipv6_network_address{boost::asio::ip::address_v6{bytes}, port};
+          return true;
+        }
+        case net::tor_address::get_type_id():
+          return read_host<net::tor_address>(in, na);
+        case net::i2p_address::get_type_id():
+          return read_host<net::i2p_address>(in, na);
+        default:
+          return false;
+      }
+    }
+
+    // Returns the record body for `e`; the first `key_size` bytes of it are its key.
+    std::string encode_record(record_list list, const peerlist_entry& e, size_t& key_size)
+    {
+      std::string out;
+      out += static_cast<char>(list);
+      write_address(out, e.adr);
+      key_size = out.size();
+      out.append(reinterpret_cast<const char*>(&e.id), sizeof(e.id));
+      write_int(out, e.last_seen);
+      write_int(out, e.pruning_seed);
+      write_int(out, e.rpc_port);
+      return out;
+    }
+
+    std::string encode_record(record_list list, const anchor_peerlist_entry& e, size_t& key_size)
+    {
+      std::string out;
+      out += static_cast<char>(list);
+      write_address(out, e.adr);
+      key_size = out.size();
+      out.append(reinterpret_cast<const char*>(&e.id), sizeof(e.id));
+      write_int(out, e.first_seen);
+      return out;
+    }
+
+    bool decode_fields(std::string_view& in, peerlist_entry& e)
+    {
+      return read_bytes(in, &e.id, sizeof(e.id)) && read_int(in, e.last_seen) && read_int(in, e.pruning_seed) && read_int(in, e.rpc_port);
+    }
+
+    bool decode_fields(std::string_view& in, anchor_peerlist_entry& e)
+    {
+      return read_bytes(in, &e.id, sizeof(e.id)) && read_int(in, e.first_seen);
+    }
+
+    template <typename Elem>
+    bool decode_record(std::string_view body, std::vector<Elem>& out)
+    {
+      body.remove_prefix(1); // list
+      Elem e{};
+      if (!read_address(body, e.adr) || !decode_fields(body, e) || !body.empty())
+        return false;
+      out.push_back(std::move(e));
+      return true;
+    }
+
+    // Key => record body for every entry of `types`
+    template <typename... Types>
+    std::map<std::string, std::string> encode_records(const Types&... types)
+    {
+      std::map<std::string, std::string> out;
+      size_t key_size;
+      const auto add = [&](record_list list, const auto& elems) {
+        for (const auto& e : elems)
+        {
+          std::string body = encode_record(list, e, key_size);
+          std::string key = body.substr(0, key_size);
+          out.insert_or_assign(std::move(key), std::move(body));
+        }
+      };
+      (add(record_list::white, types.white), ...);
+      (add(record_list::gray, types.gray), ...);
+      (add(record_list::anchor, types.anchor), ...);
+      return out;
+    }
+
+    void append_record(std::string& out, std::string_view body)
+    {
+      write_int(out, body.size());
+      out += body;
+    }
+
+    std::string make_snapshot(const std::map<std::string, std::string>& records)
+    {
+      std::string out{STORE_MAGIC};
+      for (const auto& [key, body] : records)
+        append_record(out, body);
+      return out;
+    }
  
     struct by_zone
     {
@@ -95,15 +317,6 @@ namespace nodetool
       return elems;
     }
 
-    template<typename Archive, typename Range>
-    void save_peers(Archive& a, const Range& elems)
-    {
-      const uint64_t size = elems.size();
-      a & size;
-      for (const auto& elem : elems)
-        a & elem;
-    }
- 
     template<typename T>
     std::vector<T> do_take_zone(std::vector<T>& src, epee::net_utils::zone zone)
     {
@@ -129,12 +342,6 @@ namespace nodetool
     }
   } // anonymous
 
-  struct peerlist_join
-  {
-    const peerlist_types& ours;
-    const peerlist_types& other;
-  };
-
   template<typename Archive>
   void serialize(Archive& a, peerlist_types& elem, unsigned ver)
   {
@@ -150,15 +357,7 @@ namespace nodetool
     }
   }
  
-  template<typename Archive>
-  void serialize(Archive& a, peerlist_join elem, unsigned ver)
-  {
-    save_peers(a, boost::range::join(elem.ours.white, elem.other.white));
-    save_peers(a, boost::range::join(elem.ours.gray, elem.other.gray));
-    save_peers(a, boost::range::join(elem.ours.anchor, elem.other.anchor));
-  }
-
-  std::optional<peerlist_storage> peerlist_storage::open(std::istream& src, const bool new_format)
+  std::optional<peerlist_storage> peerlist_storage::open_legacy(std::istream& src, const bool new_format)
   {
     try
     {
@@ -188,25 +387,108 @@ namespace nodetool
     return std::nullopt;
   }
 
+  namespace
+  {
+    // Replays the log in `data` (which must start with STORE_MAGIC).  A truncated final record
+    // (from being interrupted mid-append) is dropped and makes `clean` false.
+    bool parse_log(std::string_view data, peerlist_types& types,
+        std::map<std::string, std::string>& written, size_t& records, bool& clean)
+    {
+      data.remove_prefix(STORE_MAGIC.size());
+      clean = true;
+      records = 0;
+      while (!data.empty())
+      {
+        size_t size;
+        if (!read_int(data, size) || size > data.size())
+        {
+          clean = false;
+          break;
+        }
+        const std::string_view body{data.data(), size};
+        data.remove_prefix(size);
+        records++;
+
+        epee::net_utils::network_address adr;
+        std::string_view rest = body.substr(std::min<size_t>(1, body.size()));
+        if (body.empty() || !read_address(rest, adr))
+          return false;
+        std::string key{body.substr(0, body.size() - rest.size())};
+        key[0] &= ~RECORD_ERASE;
+        if (body[0] & RECORD_ERASE)
+          written.erase(key);
+        else
+          written.insert_or_assign(std::move(key), std::string{body});
+      }
+
+      for (const auto& [key, body] : written)
+      {
+        bool ok = false;
+        switch (record_list{static_cast<uint8_t>(body[0])})
+        {
+          case record_list::white: ok = decode_record(body, types.white); break;
+          case record_list::gray: ok = decode_record(body, types.gray); break;
+          case record_list::anchor: ok = decode_record(body, types.anchor); break;
+        }
+        if (!ok)
+          return false;
+      }
+
+      std::stable_sort(types.white.begin(), types.white.end(), by_zone{});
+      std::stable_sort(types.gray.begin(), types.gray.end(), by_zone{});
+      std::stable_sort(types.anchor.begin(), types.anchor.end(), by_zone{});
+      return true;
+    }
+  }
+
+  std::optional<peerlist_storage> peerlist_storage::open(std::istream& src)
+  {
+    const std::string data{std::istreambuf_iterator<char>{src}, std::istreambuf_iterator<char>{}};
+    if (data.compare(0, STORE_MAGIC.size(), STORE_MAGIC) != 0)
+      return std::nullopt;
+
+    peerlist_storage out{};
+    bool clean;
+    if (!parse_log(data, out.m_types, out.m_written, out.m_log_records, clean))
+      return std::nullopt;
+    return {std::move(out)};
+  }
+
   std::optional<peerlist_storage> peerlist_storage::open(const fs::path& path)
   {
-    fs::ifstream src_file{path, std::ios::binary};
-    if(src_file.fail())
+    std::string data;
+    if (!tools::slurp_file(path, data))
       return std::nullopt;
 
-    std::optional<peerlist_storage> out = open(src_file, true);
+    if (data.compare(0, STORE_MAGIC.size(), STORE_MAGIC) == 0)
+    {
+      peerlist_storage out{};
+      bool clean;
+      if (!parse_log(data, out.m_types, out.m_written, out.m_log_records, clean))
+      {
+        MWARNING("Failed to load p2p peer store " << path << ", falling back to default config");
+        return peerlist_storage{}; // not valid to append to, so the next store replaces the file
+      }
+      if (!clean)
+        MWARNING("p2p peer store " << path << " ended with an incomplete record; it will be rewritten on the next save");
+      out.m_log_valid = clean;
+      return {std::move(out)};
+    }
+
+    // Not in the compact format, so an archive written by an older version; the next store
+    // replaces it with a compacted log.
+    std::istringstream src{data};
+    std::optional<peerlist_storage> out = open_legacy(src, true);
     if (!out)
     {
       // if failed, try reading in unportable mode
       auto unportable = path;
       unportable += ".unportable";
       fs::copy_file(path, unportable, fs::copy_options::overwrite_existing);
-      src_file.close();
-      src_file.open(path, std::ios_base::binary);
-      if(src_file.fail())
-        return std::nullopt;
+      src.clear();
+      src.str(std::move(data));
 
-      out = open(src_file, false);
+      out = open_legacy(src, false);
       if (!out)
       {
         // This is different from the `return std::nullopt` cases above. Those
@@ -227,24 +509,87 @@ namespace nodetool
   {
     try
     {
-      boost::archive::portable_binary_oarchive a{dest};
-      const peerlist_join pj{std::cref(m_types), std::cref(other)};
-      a << pj;
+      const std::string snapshot = make_snapshot(encode_records(m_types, other));
+      dest.write(snapshot.data(), snapshot.size());
       return dest.good();
     }
-    catch (const boost::archive::archive_exception& e)
+    catch (const std::exception& e)
     {}
 
     return false;
   }
 
-  bool peerlist_storage::store(const fs::path& path, const peerlist_types& other) const
+  bool peerlist_storage::store(const fs::path& path, const peerlist_types& other)
   {
-    fs::ofstream dest_file{path, std::ios::binary | std::ios::trunc};
-    if(dest_file.fail())
+    std::map<std::string, std::string> records;
+    try
+    {
+      records = encode_records(m_types, other);
+    }
+    catch (const std::exception& e)
+    {
       return false;
+    }
 
-    return store(dest_file, other);
+    if (!m_log_valid || (m_log_records >= STORE_COMPACT_MIN_RECORDS && m_log_records > 2 * records.size()))
+    {
+      // Write the compacted log alongside, then swap it in so that we never leave a partial file
+      auto tmp = path;
+      tmp += ".tmp";
+      if (!tools::dump_file(tmp, make_snapshot(records)))
+      {
+        m_log_valid = false;
+        return false;
+      }
+      std::error_code ec;
+      fs::rename(tmp, path, ec);
+      if (ec)
+      {
+        m_log_valid = false;
+        return false;
+      }
+      MDEBUG("Compacted p2p peer store from " << m_log_records << " to " << records.size() << " records");
+      m_log_records = records.size();
+      m_written = std::move(records);
+      m_log_valid = true;
+      return true;
+    }
+
+    std::string changes;
+    size_t count = 0;
+    for (const auto& [key, body] : records)
+    {
+      if (auto it = m_written.find(key); it == m_written.end() || it->second != body)
+      {
+        append_record(changes, body);
+        count++;
+      }
+    }
+    for (const auto& [key, body] : m_written)
+    {
+      if (!records.count(key))
+      {
+        std::string erase = key;
+        erase[0] |= RECORD_ERASE;
+        append_record(changes, erase);
+        count++;
+      }
+    }
+    if (changes.empty())
+      return true;
+
+    fs::ofstream dest_file{path, std::ios::binary | std::ios::app};
+    dest_file.write(changes.data(), changes.size());
+    dest_file.close();
+    if (dest_file.fail())
+    {
+      m_log_valid = false; // may have written part of it
+      return false;
+    }
+    MDEBUG("Appended " << count << " changes to p2p peer store");
+    m_log_records += count;
+    m_written = std::move(records);
+    return true;
   }
 
   peerlist_types peerlist_storage::take_zone(epee::net_utils::zone zone)
@@ -291,5 +636,4 @@ namespace nodetool
 }
 
 BOOST_CLASS_VERSION(nodetool::peerlist_types, nodetool::CURRENT_PEERLIST_STORAGE_ARCHIVE_VER);
-BOOST_CLASS_VERSION(nodetool::peerlist_join, nodetool::CURRENT_PEERLIST_STORAGE_ARCHIVE_VER);
 
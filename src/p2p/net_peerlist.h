@@ -33,6 +33,7 @@
 #include <iosfwd>
 #include <list>
 #include <string>
+#include <map>
 #include <vector>
 #include <optional>
 #include <mutex>
@@ -60,6 +61,9 @@ namespace nodetool
     std::vector<anchor_peerlist_entry> anchor;
   };
 
+  //! Peers saved on disk as a log of compact binary records (an upsert or erase of one entry
+  //! each), so that periodic saves only append what changed since the last one.  The log is
+  //! rewritten from scratch ("compacted") once it holds mostly superseded records.
   class peerlist_storage
   {
   public:
@@ -67,10 +71,14 @@ namespace nodetool
       : m_types{}
     {}
 
-    //! \return Peers stored in stream `src` in `new_format` (portable archive or older non-portable).
-    static std::optional<peerlist_storage> open(std::istream& src, const bool new_format);
+    //! \return Peers stored in stream `src` in the compact log format.
+    static std::optional<peerlist_storage> open(std::istream& src);
 
-    //! \return Peers stored in file at `path`
+    //! \return Peers stored in stream `src` as a boost archive by older versions, in
+    //! `new_format` (portable archive or older non-portable).
+    static std::optional<peerlist_storage> open_legacy(std::istream& src, const bool new_format);
+
+    //! \return Peers stored in file at `path`, in either format
     static std::optional<peerlist_storage> open(const fs::path& path);
 
     peerlist_storage(peerlist_storage&&) = default;
@@ -81,17 +89,26 @@ namespace nodetool
     peerlist_storage& operator=(peerlist_storage&&) = default;
     peerlist_storage& operator=(const peerlist_storage&) = delete;
 
-    //! Save peers from `this` and `other` in stream `dest`.
+    //! Save a complete (compacted) copy of the peers from `this` and `other` in stream `dest`.
     bool store(std::ostream& dest, const peerlist_types& other) const;
 
-    //! Save peers from `this` and `other` in one file at `path`.
-    bool store(const fs::path& path, const peerlist_types& other) const;
+    //! Save peers from `this` and `other` in one file at `path`, appending only the changes
+    //! since the last load or store of `path`.
+    bool store(const fs::path& path, const peerlist_types& other);
 
     //! \return Peers in `zone` and from remove from `this`.
     peerlist_types take_zone(epee::net_utils::zone zone);
 
   private:
     peerlist_types m_types;
+
+    //! Encoded key (list and address) => encoded record, for everything live in the on-disk log
+    std::map<std::string, std::string> m_written;
+    //! Number of records in the on-disk log, live or superseded
+    size_t m_log_records = 0;
+    //! False if the file isn't (or may not be) a clean log matching `m_written`: the next store
+    //! rewrites it rather than appending.
+    bool m_log_valid = false;
   };
 
   /************************************************************************/
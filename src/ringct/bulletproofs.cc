@@ -30,10 +30,12 @@
 // Paper references are to https://eprint.iacr.org/2017/1066 (revision 1 July 2018)
 
 #include <stdlib.h>
+#include <deque>
 #include "epee/misc_log_ex.h"
 #include "epee/span.h"
 #include "common/perf_timer.h"
 #include "common/varint.h"
+#include "common/threadpool.h"
 #include "cryptonote_config.h"
 extern "C"
 {
@@ -130,7 +132,7 @@ static void init_exponents()
   }
 
   straus_HiGi_cache = straus_init_cache(data, STRAUS_SIZE_LIMIT);
-  pippenger_HiGi_cache = pippenger_init_cache(data, 0, PIPPENGER_SIZE_LIMIT);
+  pippenger_HiGi_cache = pippenger_init_fixed_base_cache(data, PIPPENGER_SIZE_LIMIT);
 
   MINFO("Hi/Gi cache size: " << (sizeof(Hi)+sizeof(Gi))/1024 << " kB");
   MINFO("Hi_p3/Gi_p3 cache size: " << (sizeof(Hi_p3)+sizeof(Gi_p3))/1024 << " kB");
@@ -805,9 +807,229 @@ struct proof_data_t
   size_t logM, inv_offset;
 };
 
+// One proof's share of the weighted aggregates of bulletproof_VERIFY
+struct proof_weights_t
+{
+  rct::key z1, z3, m_y0, y1;
+  rct::keyV m_z4, m_z5;
+  std::vector<MultiexpData> multiexp_data;
+};
+
+// Checks the ranges of a proof's scalars and its size, and reconstructs its challenges
+static bool bulletproof_VERIFY_challenges(const Bulletproof &proof, proof_data_t &pd)
+{
+  const size_t logN = 6;
+
+  // check scalar range
+  CHECK_AND_ASSERT_MES(is_reduced(proof.taux), false, "Input scalar not in range");
+  CHECK_AND_ASSERT_MES(is_reduced(proof.mu), false, "Input scalar not in range");
+  CHECK_AND_ASSERT_MES(is_reduced(proof.a), false, "Input scalar not in range");
+  CHECK_AND_ASSERT_MES(is_reduced(proof.b), false, "Input scalar not in range");
+  CHECK_AND_ASSERT_MES(is_reduced(proof.t), false, "Input scalar not in range");
+
+  CHECK_AND_ASSERT_MES(proof.V.size() >= 1, false, "V does not have at least one element");
+  CHECK_AND_ASSERT_MES(proof.L.size() == proof.R.size(), false, "Mismatched L and R sizes");
+  CHECK_AND_ASSERT_MES(proof.L.size() > 0, false, "Empty proof");
+
+  // Reconstruct the challenges
+  PERF_TIMER_START_BP(VERIFY_start);
+  rct::key hash_cache = rct::hash_to_scalar(proof.V);
+  pd.y = hash_cache_mash(hash_cache, proof.A, proof.S);
+  CHECK_AND_ASSERT_MES(!(pd.y == rct::zero()), false, "y == 0");
+  pd.z = hash_cache = rct::hash_to_scalar(pd.y);
+  CHECK_AND_ASSERT_MES(!(pd.z == rct::zero()), false, "z == 0");
+  pd.x = hash_cache_mash(hash_cache, pd.z, proof.T1, proof.T2);
+  CHECK_AND_ASSERT_MES(!(pd.x == rct::zero()), false, "x == 0");
+  pd.x_ip = hash_cache_mash(hash_cache, pd.x, proof.taux, proof.mu, proof.t);
+  CHECK_AND_ASSERT_MES(!(pd.x_ip == rct::zero()), false, "x_ip == 0");
+  PERF_TIMER_STOP_BP(VERIFY_start);
+
+  size_t M;
+  for (pd.logM = 0; (M = 1<<pd.logM) <= maxM && M < proof.V.size(); ++pd.logM);
+  CHECK_AND_ASSERT_MES(proof.L.size() == 6+pd.logM, false, "Proof is not the expected size");
+
+  const size_t rounds = pd.logM+logN;
+  CHECK_AND_ASSERT_MES(rounds > 0, false, "Zero rounds");
+
+  PERF_TIMER_START_BP(VERIFY_line_21_22);
+  // The inner product challenges are computed per round
+  pd.w.resize(rounds);
+  for (size_t i = 0; i < rounds; ++i)
+  {
+    pd.w[i] = hash_cache_mash(hash_cache, proof.L[i], proof.R[i]);
+    CHECK_AND_ASSERT_MES(!(pd.w[i] == rct::zero()), false, "w[i] == 0");
+  }
+  PERF_TIMER_STOP_BP(VERIFY_line_21_22);
+  return true;
+}
+
+// Computes a proof's randomly weighted contribution to the final check
+static bool bulletproof_VERIFY_weights(const Bulletproof &proof, const proof_data_t &pd, const std::vector<rct::key> &inverses, proof_weights_t &pw)
+{
+  const size_t logN = 6;
+  const size_t N = 1 << logN;
+
+  rct::key tmp;
+
+  CHECK_AND_ASSERT_MES(proof.L.size() == 6+pd.logM, false, "Proof is not the expected size");
+  const size_t M = 1 << pd.logM;
+  const size_t MN = M*N;
+  const rct::key weight_y = rct::skGen();
+  const rct::key weight_z = rct::skGen();
+
+  pw.z1 = pw.z3 = pw.m_y0 = pw.y1 = rct::zero();
+  pw.m_z4.assign(MN, rct::zero());
+  pw.m_z5.assign(MN, rct::zero());
+  pw.multiexp_data.reserve(proof.V.size() + 2 * proof.L.size() + 4);
+
+  // pre-multiply some points by 8
+  std::vector<ge_p3> proof8_V, proof8_L, proof8_R;
+  proof8_V.resize(proof.V.size()); for (size_t i = 0; i < proof.V.size(); ++i) rct::scalarmult8(proof8_V[i], proof.V[i]);
+  proof8_L.resize(proof.L.size()); for (size_t i = 0; i < proof.L.size(); ++i) rct::scalarmult8(proof8_L[i], proof.L[i]);
+  proof8_R.resize(proof.R.size()); for (size_t i = 0; i < proof.R.size(); ++i) rct::scalarmult8(proof8_R[i], proof.R[i]);
+  ge_p3 proof8_T1;
+  ge_p3 proof8_T2;
+  ge_p3 proof8_S;
+  ge_p3 proof8_A;
+  rct::scalarmult8(proof8_T1, proof.T1);
+  rct::scalarmult8(proof8_T2, proof.T2);
+  rct::scalarmult8(proof8_S, proof.S);
+  rct::scalarmult8(proof8_A, proof.A);
+
+  PERF_TIMER_START_BP(VERIFY_line_61);
+  sc_mulsub(pw.m_y0.bytes, proof.taux.bytes, weight_y.bytes, pw.m_y0.bytes);
+
+  const rct::keyV zpow = vector_powers(pd.z, M+3);
+
+  rct::key k;
+  const rct::key ip1y = vector_power_sum(pd.y, MN);
+  sc_mulsub(k.bytes, zpow[2].bytes, ip1y.bytes, rct::zero().bytes);
+  for (size_t j = 1; j <= M; ++j)
+  {
+    CHECK_AND_ASSERT_MES(j+2 < zpow.size(), false, "invalid zpow index");
+    sc_mulsub(k.bytes, zpow[j+2].bytes, ip12.bytes, k.bytes);
+  }
+  PERF_TIMER_STOP_BP(VERIFY_line_61);
+
+  PERF_TIMER_START_BP(VERIFY_line_61rl_new);
+  sc_muladd(tmp.bytes, pd.z.bytes, ip1y.bytes, k.bytes);
+  sc_sub(tmp.bytes, proof.t.bytes, tmp.bytes);
+  sc_muladd(pw.y1.bytes, tmp.bytes, weight_y.bytes, pw.y1.bytes);
+  for (size_t j = 0; j < proof8_V.size(); j++)
+  {
+    sc_mul(tmp.bytes, zpow[j+2].bytes, weight_y.bytes);
+    pw.multiexp_data.emplace_back(tmp, proof8_V[j]);
+  }
+  sc_mul(tmp.bytes, pd.x.bytes, weight_y.bytes);
+  pw.multiexp_data.emplace_back(tmp, proof8_T1);
+  rct::key xsq;
+  sc_mul(xsq.bytes, pd.x.bytes, pd.x.bytes);
+  sc_mul(tmp.bytes, xsq.bytes, weight_y.bytes);
+  pw.multiexp_data.emplace_back(tmp, proof8_T2);
+  PERF_TIMER_STOP_BP(VERIFY_line_61rl_new);
+
+  PERF_TIMER_START_BP(VERIFY_line_62);
+  pw.multiexp_data.emplace_back(weight_z, proof8_A);
+  sc_mul(tmp.bytes, pd.x.bytes, weight_z.bytes);
+  pw.multiexp_data.emplace_back(tmp, proof8_S);
+  PERF_TIMER_STOP_BP(VERIFY_line_62);
+
+  // Compute the number of rounds for the inner product
+  const size_t rounds = pd.logM+logN;
+  CHECK_AND_ASSERT_MES(rounds > 0, false, "Zero rounds");
+
+  PERF_TIMER_START_BP(VERIFY_line_24_25);
+  // Compute the curvepoints from G[i] and H[i]
+  rct::key yinvpow = rct::identity();
+  rct::key ypow = rct::identity();
+
+  const rct::key *winv = &inverses[pd.inv_offset];
+  const rct::key yinv = inverses[pd.inv_offset + rounds];
+
+  // precalc
+  PERF_TIMER_START_BP(VERIFY_line_24_25_precalc);
+  rct::keyV w_cache(1<<rounds);
+  w_cache[0] = winv[0];
+  w_cache[1] = pd.w[0];
+  for (size_t j = 1; j < rounds; ++j)
+  {
+    const size_t slots = 1<<(j+1);
+    for (size_t s = slots; s-- > 0; --s)
+    {
+      sc_mul(w_cache[s].bytes, w_cache[s/2].bytes, pd.w[j].bytes);
+      sc_mul(w_cache[s-1].bytes, w_cache[s/2].bytes, winv[j].bytes);
+    }
+  }
+  PERF_TIMER_STOP_BP(VERIFY_line_24_25_precalc);
+
+  for (size_t i = 0; i < MN; ++i)
+  {
+    rct::key g_scalar = proof.a;
+    rct::key h_scalar;
+    if (i == 0)
+      h_scalar = proof.b;
+    else
+      sc_mul(h_scalar.bytes, proof.b.bytes, yinvpow.bytes);
+
+    // Convert the index to binary IN REVERSE and construct the scalar exponent
+    sc_mul(g_scalar.bytes, g_scalar.bytes, w_cache[i].bytes);
+    sc_mul(h_scalar.bytes, h_scalar.bytes, w_cache[(~i) & (MN-1)].bytes);
+
+    sc_add(g_scalar.bytes, g_scalar.bytes, pd.z.bytes);
+    CHECK_AND_ASSERT_MES(2+i/N < zpow.size(), false, "invalid zpow index");
+    CHECK_AND_ASSERT_MES(i%N < twoN.size(), false, "invalid twoN index");
+    sc_mul(tmp.bytes, zpow[2+i/N].bytes, twoN[i%N].bytes);
+    if (i == 0)
+    {
+      sc_add(tmp.bytes, tmp.bytes, pd.z.bytes);
+      sc_sub(h_scalar.bytes, h_scalar.bytes, tmp.bytes);
+    }
+    else
+    {
+      sc_muladd(tmp.bytes, pd.z.bytes, ypow.bytes, tmp.bytes);
+      sc_mulsub(h_scalar.bytes, tmp.bytes, yinvpow.bytes, h_scalar.bytes);
+    }
+
+    sc_mulsub(pw.m_z4[i].bytes, g_scalar.bytes, weight_z.bytes, pw.m_z4[i].bytes);
+    sc_mulsub(pw.m_z5[i].bytes, h_scalar.bytes, weight_z.bytes, pw.m_z5[i].bytes);
+
+    if (i == 0)
+    {
+      yinvpow = yinv;
+      ypow = pd.y;
+    }
+    else if (i != MN-1)
+    {
+      sc_mul(yinvpow.bytes, yinvpow.bytes, yinv.bytes);
+      sc_mul(ypow.bytes, ypow.bytes, pd.y.bytes);
+    }
+  }
+
+  PERF_TIMER_STOP_BP(VERIFY_line_24_25);
+
+  PERF_TIMER_START_BP(VERIFY_line_26_new);
+  sc_muladd(pw.z1.bytes, proof.mu.bytes, weight_z.bytes, pw.z1.bytes);
+  for (size_t i = 0; i < rounds; ++i)
+  {
+    sc_mul(tmp.bytes, pd.w[i].bytes, pd.w[i].bytes);
+    sc_mul(tmp.bytes, tmp.bytes, weight_z.bytes);
+    pw.multiexp_data.emplace_back(tmp, proof8_L[i]);
+    sc_mul(tmp.bytes, winv[i].bytes, winv[i].bytes);
+    sc_mul(tmp.bytes, tmp.bytes, weight_z.bytes);
+    pw.multiexp_data.emplace_back(tmp, proof8_R[i]);
+  }
+  sc_mulsub(tmp.bytes, proof.a.bytes, proof.b.bytes, proof.t.bytes);
+  sc_mul(tmp.bytes, tmp.bytes, pd.x_ip.bytes);
+  sc_muladd(pw.z3.bytes, tmp.bytes, weight_z.bytes, pw.z3.bytes);
+  PERF_TIMER_STOP_BP(VERIFY_line_26_new);
+  return true;
+}
+
 /* Given a range proof, determine if it is valid
  * This uses the method in PAPER LINES 95-105,
  *   weighted across multiple proofs in a batch
+ * The per proof work and the final multiexp are spread over the thread pool, so this must not be
+ *   called from a leaf task
  */
 bool bulletproof_VERIFY(const std::vector<const Bulletproof*> &proofs)
 {
@@ -815,250 +1037,90 @@ bool bulletproof_VERIFY(const std::vector<const Bulletproof*> &proofs)
 
   PERF_TIMER_START_BP(VERIFY);
 
-  const size_t logN = 6;
-  const size_t N = 1 << logN;
+  tools::threadpool& tpool = tools::threadpool::getInstance();
+  tools::threadpool::waiter waiter;
 
-  // sanity and figure out which proof is longest
+  // The proofs' challenges are independent of each other; a proof that throws (on a bad point)
+  // just fails
+  std::vector<proof_data_t> proof_data(proofs.size());
+  std::deque<bool> results(proofs.size(), false);
+  for (size_t n = 0; n < proofs.size(); ++n)
+  {
+    tpool.submit(&waiter, [&, n] {
+      try { results[n] = bulletproof_VERIFY_challenges(*proofs[n], proof_data[n]); }
+      catch (const std::exception &e) { MERROR("Failed to reconstruct the bulletproof challenges: " << e.what()); }
+    }, true);
+  }
+  waiter.wait(&tpool);
+
+  // figure out which proof is longest, and where each proof's inverses go
   size_t max_length = 0;
   size_t nV = 0;
-  std::vector<proof_data_t> proof_data;
-  proof_data.reserve(proofs.size());
   size_t inv_offset = 0;
   std::vector<rct::key> to_invert;
-  to_invert.reserve(11 * sizeof(proofs));
-  size_t max_logM = 0;
-  for (const Bulletproof *p: proofs)
+  to_invert.reserve(11 * proofs.size());
+  for (size_t n = 0; n < proofs.size(); ++n)
   {
-    const Bulletproof &proof = *p;
-
-    // check scalar range
-    CHECK_AND_ASSERT_MES(is_reduced(proof.taux), false, "Input scalar not in range");
-    CHECK_AND_ASSERT_MES(is_reduced(proof.mu), false, "Input scalar not in range");
-    CHECK_AND_ASSERT_MES(is_reduced(proof.a), false, "Input scalar not in range");
-    CHECK_AND_ASSERT_MES(is_reduced(proof.b), false, "Input scalar not in range");
-    CHECK_AND_ASSERT_MES(is_reduced(proof.t), false, "Input scalar not in range");
-
-    CHECK_AND_ASSERT_MES(proof.V.size() >= 1, false, "V does not have at least one element");
-    CHECK_AND_ASSERT_MES(proof.L.size() == proof.R.size(), false, "Mismatched L and R sizes");
-    CHECK_AND_ASSERT_MES(proof.L.size() > 0, false, "Empty proof");
-
-    max_length = std::max(max_length, proof.L.size());
-    nV += proof.V.size();
-
-    // Reconstruct the challenges
-    PERF_TIMER_START_BP(VERIFY_start);
-    proof_data.resize(proof_data.size() + 1);
-    proof_data_t &pd = proof_data.back();
-    rct::key hash_cache = rct::hash_to_scalar(proof.V);
-    pd.y = hash_cache_mash(hash_cache, proof.A, proof.S);
-    CHECK_AND_ASSERT_MES(!(pd.y == rct::zero()), false, "y == 0");
-    pd.z = hash_cache = rct::hash_to_scalar(pd.y);
-    CHECK_AND_ASSERT_MES(!(pd.z == rct::zero()), false, "z == 0");
-    pd.x = hash_cache_mash(hash_cache, pd.z, proof.T1, proof.T2);
-    CHECK_AND_ASSERT_MES(!(pd.x == rct::zero()), false, "x == 0");
-    pd.x_ip = hash_cache_mash(hash_cache, pd.x, proof.taux, proof.mu, proof.t);
-    CHECK_AND_ASSERT_MES(!(pd.x_ip == rct::zero()), false, "x_ip == 0");
-    PERF_TIMER_STOP_BP(VERIFY_start);
-
-    size_t M;
-    for (pd.logM = 0; (M = 1<<pd.logM) <= maxM && M < proof.V.size(); ++pd.logM);
-    CHECK_AND_ASSERT_MES(proof.L.size() == 6+pd.logM, false, "Proof is not the expected size");
-    max_logM = std::max(pd.logM, max_logM);
-
-    const size_t rounds = pd.logM+logN;
-    CHECK_AND_ASSERT_MES(rounds > 0, false, "Zero rounds");
-
-    PERF_TIMER_START_BP(VERIFY_line_21_22);
-    // The inner product challenges are computed per round
-    pd.w.resize(rounds);
-    for (size_t i = 0; i < rounds; ++i)
-    {
-      pd.w[i] = hash_cache_mash(hash_cache, proof.L[i], proof.R[i]);
-      CHECK_AND_ASSERT_MES(!(pd.w[i] == rct::zero()), false, "w[i] == 0");
-    }
-    PERF_TIMER_STOP_BP(VERIFY_line_21_22);
+    if (!results[n])
+      return false;
+    proof_data_t &pd = proof_data[n];
+
+    max_length = std::max(max_length, proofs[n]->L.size());
+    nV += proofs[n]->V.size();
 
     pd.inv_offset = inv_offset;
-    for (size_t i = 0; i < rounds; ++i)
+    for (size_t i = 0; i < pd.w.size(); ++i)
       to_invert.push_back(pd.w[i]);
     to_invert.push_back(pd.y);
-    inv_offset += rounds + 1;
+    inv_offset += pd.w.size() + 1;
   }
   CHECK_AND_ASSERT_MES(max_length < 32, false, "At least one proof is too large");
   size_t maxMN = 1u << max_length;
 
-  rct::key tmp;
-
-  std::vector<MultiexpData> multiexp_data;
-  multiexp_data.reserve(nV + (2 * (max_logM + logN) + 4) * proofs.size() + 2 * maxMN);
-  multiexp_data.resize(2 * maxMN);
-
   PERF_TIMER_START_BP(VERIFY_line_24_25_invert);
   const std::vector<rct::key> inverses = invert(to_invert);
   PERF_TIMER_STOP_BP(VERIFY_line_24_25_invert);
 
-  // setup weighted aggregates
+  // setup weighted aggregates, one proof per task
+  std::vector<proof_weights_t> proof_weights(proofs.size());
+  for (size_t n = 0; n < proofs.size(); ++n)
+  {
+    tpool.submit(&waiter, [&, n] {
+      try { results[n] = bulletproof_VERIFY_weights(*proofs[n], proof_data[n], inverses, proof_weights[n]); }
+      catch (const std::exception &e) { results[n] = false; MERROR("Failed to weigh bulletproof: " << e.what()); }
+    }, true);
+  }
+  waiter.wait(&tpool);
+
+  // and sum them in proof order
   rct::key z1 = rct::zero();
   rct::key z3 = rct::zero();
   rct::keyV m_z4(maxMN, rct::zero()), m_z5(maxMN, rct::zero());
   rct::key m_y0 = rct::zero(), y1 = rct::zero();
-  int proof_data_index = 0;
-  rct::keyV w_cache;
-  std::vector<ge_p3> proof8_V, proof8_L, proof8_R;
-  for (const Bulletproof *p: proofs)
+  std::vector<MultiexpData> multiexp_data;
+  multiexp_data.reserve(nV + (2 * max_length + 4) * proofs.size() + 2 * maxMN + 2);
+  multiexp_data.resize(2 * maxMN);
+  for (size_t n = 0; n < proofs.size(); ++n)
   {
-    const Bulletproof &proof = *p;
-    const proof_data_t &pd = proof_data[proof_data_index++];
-
-    CHECK_AND_ASSERT_MES(proof.L.size() == 6+pd.logM, false, "Proof is not the expected size");
-    const size_t M = 1 << pd.logM;
-    const size_t MN = M*N;
-    const rct::key weight_y = rct::skGen();
-    const rct::key weight_z = rct::skGen();
-
-    // pre-multiply some points by 8
-    proof8_V.resize(proof.V.size()); for (size_t i = 0; i < proof.V.size(); ++i) rct::scalarmult8(proof8_V[i], proof.V[i]);
-    proof8_L.resize(proof.L.size()); for (size_t i = 0; i < proof.L.size(); ++i) rct::scalarmult8(proof8_L[i], proof.L[i]);
-    proof8_R.resize(proof.R.size()); for (size_t i = 0; i < proof.R.size(); ++i) rct::scalarmult8(proof8_R[i], proof.R[i]);
-    ge_p3 proof8_T1;
-    ge_p3 proof8_T2;
-    ge_p3 proof8_S;
-    ge_p3 proof8_A;
-    rct::scalarmult8(proof8_T1, proof.T1);
-    rct::scalarmult8(proof8_T2, proof.T2);
-    rct::scalarmult8(proof8_S, proof.S);
-    rct::scalarmult8(proof8_A, proof.A);
-
-    PERF_TIMER_START_BP(VERIFY_line_61);
-    sc_mulsub(m_y0.bytes, proof.taux.bytes, weight_y.bytes, m_y0.bytes);
-
-    const rct::keyV zpow = vector_powers(pd.z, M+3);
-
-    rct::key k;
-    const rct::key ip1y = vector_power_sum(pd.y, MN);
-    sc_mulsub(k.bytes, zpow[2].bytes, ip1y.bytes, rct::zero().bytes);
-    for (size_t j = 1; j <= M; ++j)
-    {
-      CHECK_AND_ASSERT_MES(j+2 < zpow.size(), false, "invalid zpow index");
-      sc_mulsub(k.bytes, zpow[j+2].bytes, ip12.bytes, k.bytes);
-    }
-    PERF_TIMER_STOP_BP(VERIFY_line_61);
-
-    PERF_TIMER_START_BP(VERIFY_line_61rl_new);
-    sc_muladd(tmp.bytes, pd.z.bytes, ip1y.bytes, k.bytes);
-    sc_sub(tmp.bytes, proof.t.bytes, tmp.bytes);
-    sc_muladd(y1.bytes, tmp.bytes, weight_y.bytes, y1.bytes);
-    for (size_t j = 0; j < proof8_V.size(); j++)
+    if (!results[n])
+      return false;
+    proof_weights_t &pw = proof_weights[n];
+    sc_add(z1.bytes, z1.bytes, pw.z1.bytes);
+    sc_add(z3.bytes, z3.bytes, pw.z3.bytes);
+    sc_add(m_y0.bytes, m_y0.bytes, pw.m_y0.bytes);
+    sc_add(y1.bytes, y1.bytes, pw.y1.bytes);
+    for (size_t i = 0; i < pw.m_z4.size(); ++i)
     {
-      sc_mul(tmp.bytes, zpow[j+2].bytes, weight_y.bytes);
-      multiexp_data.emplace_back(tmp, proof8_V[j]);
+      sc_add(m_z4[i].bytes, m_z4[i].bytes, pw.m_z4[i].bytes);
+      sc_add(m_z5[i].bytes, m_z5[i].bytes, pw.m_z5[i].bytes);
     }
-    sc_mul(tmp.bytes, pd.x.bytes, weight_y.bytes);
-    multiexp_data.emplace_back(tmp, proof8_T1);
-    rct::key xsq;
-    sc_mul(xsq.bytes, pd.x.bytes, pd.x.bytes);
-    sc_mul(tmp.bytes, xsq.bytes, weight_y.bytes);
-    multiexp_data.emplace_back(tmp, proof8_T2);
-    PERF_TIMER_STOP_BP(VERIFY_line_61rl_new);
-
-    PERF_TIMER_START_BP(VERIFY_line_62);
-    multiexp_data.emplace_back(weight_z, proof8_A);
-    sc_mul(tmp.bytes, pd.x.bytes, weight_z.bytes);
-    multiexp_data.emplace_back(tmp, proof8_S);
-    PERF_TIMER_STOP_BP(VERIFY_line_62);
-
-    // Compute the number of rounds for the inner product
-    const size_t rounds = pd.logM+logN;
-    CHECK_AND_ASSERT_MES(rounds > 0, false, "Zero rounds");
-
-    PERF_TIMER_START_BP(VERIFY_line_24_25);
-    // Compute the curvepoints from G[i] and H[i]
-    rct::key yinvpow = rct::identity();
-    rct::key ypow = rct::identity();
-
-    const rct::key *winv = &inverses[pd.inv_offset];
-    const rct::key yinv = inverses[pd.inv_offset + rounds];
-
-    // precalc
-    PERF_TIMER_START_BP(VERIFY_line_24_25_precalc);
-    w_cache.resize(1<<rounds);
-    w_cache[0] = winv[0];
-    w_cache[1] = pd.w[0];
-    for (size_t j = 1; j < rounds; ++j)
-    {
-      const size_t slots = 1<<(j+1);
-      for (size_t s = slots; s-- > 0; --s)
-      {
-        sc_mul(w_cache[s].bytes, w_cache[s/2].bytes, pd.w[j].bytes);
-        sc_mul(w_cache[s-1].bytes, w_cache[s/2].bytes, winv[j].bytes);
-      }
-    }
-    PERF_TIMER_STOP_BP(VERIFY_line_24_25_precalc);
-
-    for (size_t i = 0; i < MN; ++i)
-    {
-      rct::key g_scalar = proof.a;
-      rct::key h_scalar;
-      if (i == 0)
-        h_scalar = proof.b;
-      else
-        sc_mul(h_scalar.bytes, proof.b.bytes, yinvpow.bytes);
-
-      // Convert the index to binary IN REVERSE and construct the scalar exponent
-      sc_mul(g_scalar.bytes, g_scalar.bytes, w_cache[i].bytes);
-      sc_mul(h_scalar.bytes, h_scalar.bytes, w_cache[(~i) & (MN-1)].bytes);
-
-      sc_add(g_scalar.bytes, g_scalar.bytes, pd.z.bytes);
-      CHECK_AND_ASSERT_MES(2+i/N < zpow.size(), false, "invalid zpow index");
-      CHECK_AND_ASSERT_MES(i%N < twoN.size(), false, "invalid twoN index");
-      sc_mul(tmp.bytes, zpow[2+i/N].bytes, twoN[i%N].bytes);
-      if (i == 0)
-      {
-        sc_add(tmp.bytes, tmp.bytes, pd.z.bytes);
-        sc_sub(h_scalar.bytes, h_scalar.bytes, tmp.bytes);
-      }
-      else
-      {
-        sc_muladd(tmp.bytes, pd.z.bytes, ypow.bytes, tmp.bytes);
-        sc_mulsub(h_scalar.bytes, tmp.bytes, yinvpow.bytes, h_scalar.bytes);
-      }
-
-      sc_mulsub(m_z4[i].bytes, g_scalar.bytes, weight_z.bytes, m_z4[i].bytes);
-      sc_mulsub(m_z5[i].bytes, h_scalar.bytes, weight_z.bytes, m_z5[i].bytes);
-
-      if (i == 0)
-      {
-        yinvpow = yinv;
-        ypow = pd.y;
-      }
-      else if (i != MN-1)
-      {
-        sc_mul(yinvpow.bytes, yinvpow.bytes, yinv.bytes);
-        sc_mul(ypow.bytes, ypow.bytes, pd.y.bytes);
-      }
-    }
-
-    PERF_TIMER_STOP_BP(VERIFY_line_24_25);
-
-    PERF_TIMER_START_BP(VERIFY_line_26_new);
-    sc_muladd(z1.bytes, proof.mu.bytes, weight_z.bytes, z1.bytes);
-    for (size_t i = 0; i < rounds; ++i)
-    {
-      sc_mul(tmp.bytes, pd.w[i].bytes, pd.w[i].bytes);
-      sc_mul(tmp.bytes, tmp.bytes, weight_z.bytes);
-      multiexp_data.emplace_back(tmp, proof8_L[i]);
-      sc_mul(tmp.bytes, winv[i].bytes, winv[i].bytes);
-      sc_mul(tmp.bytes, tmp.bytes, weight_z.bytes);
-      multiexp_data.emplace_back(tmp, proof8_R[i]);
-    }
-    sc_mulsub(tmp.bytes, proof.a.bytes, proof.b.bytes, proof.t.bytes);
-    sc_mul(tmp.bytes, tmp.bytes, pd.x_ip.bytes);
-    sc_muladd(z3.bytes, tmp.bytes, weight_z.bytes, z3.bytes);
-    PERF_TIMER_STOP_BP(VERIFY_line_26_new);
+    multiexp_data.insert(multiexp_data.end(), pw.multiexp_data.begin(), pw.multiexp_data.end());
+    pw = proof_weights_t{};
   }
 
   // now check all proofs at once
   PERF_TIMER_START_BP(VERIFY_step2_check);
+  rct::key tmp;
   sc_sub(tmp.bytes, m_y0.bytes, z1.bytes);
   multiexp_data.emplace_back(tmp, rct::G);
   sc_sub(tmp.bytes, z3.bytes, y1.bytes);
@@ -1068,7 +1130,7 @@ bool bulletproof_VERIFY(const std::vector<const Bulletproof*> &proofs)
     multiexp_data[i * 2] = {m_z4[i], Gi_p3[i]};
     multiexp_data[i * 2 + 1] = {m_z5[i], Hi_p3[i]};
   }
-  if (!(multiexp(multiexp_data, 2 * maxMN) == rct::identity()))
+  if (!(pippenger_threaded(multiexp_data, pippenger_HiGi_cache, 2 * maxMN, get_pippenger_c(multiexp_data.size())) == rct::identity()))
   {
     PERF_TIMER_STOP_BP(VERIFY_step2_check);
     MERROR("Verification failure");
@@ -28,8 +28,10 @@
 //
 // Adapted from Python code by Sarang Noether
 
+#include <atomic>
 #include "epee/misc_log_ex.h"
 #include "common/perf_timer.h"
+#include "common/threadpool.h"
 extern "C"
 {
 #include "crypto/crypto-ops.h"
@@ -147,6 +149,13 @@ static inline void add(ge_p3 &p3, const ge_cached &other)
   ge_p1p1_to_p3(&p3, &p1);
 }
 
+static inline void add(ge_p3 &p3, const ge_precomp &other)
+{
+  ge_p1p1 p1;
+  ge_madd(&p1, &p3, &other);
+  ge_p1p1_to_p3(&p3, &p1);
+}
+
 static inline void add(ge_p3 &p3, const ge_p3 &other)
 {
   ge_cached cached;
@@ -576,8 +585,9 @@ struct pippenger_cached_data
 {
   size_t size;
   ge_cached *cached;
-  pippenger_cached_data(): size(0), cached(NULL) {}
-  ~pippenger_cached_data() { aligned_free(cached); }
+  ge_precomp *precomp; // affine points instead of cached, from pippenger_init_fixed_base_cache
+  pippenger_cached_data(): size(0), cached(NULL), precomp(NULL) {}
+  ~pippenger_cached_data() { aligned_free(cached); aligned_free(precomp); }
 };
 
 std::shared_ptr<pippenger_cached_data> pippenger_init_cache(const std::vector<MultiexpData> &data, size_t start_offset, size_t N)
@@ -600,54 +610,53 @@ std::shared_ptr<pippenger_cached_data> pippenger_init_cache(const std::vector<Mu
   return cache;
 }
 
+std::shared_ptr<pippenger_cached_data> pippenger_init_fixed_base_cache(const std::vector<MultiexpData> &data, size_t N)
+{
+  if (N == 0)
+    N = data.size();
+  CHECK_AND_ASSERT_THROW_MES(N <= data.size(), "Bad cache base data");
+  std::shared_ptr<pippenger_cached_data> cache(new pippenger_cached_data());
+
+  cache->size = N;
+  cache->precomp = (ge_precomp*)aligned_realloc(cache->precomp, N * sizeof(ge_precomp), 4096);
+  CHECK_AND_ASSERT_THROW_MES(cache->precomp, "Out of memory");
+  for (size_t i = 0; i < N; ++i)
+    ge_p3_to_precomp(&cache->precomp[i], &data[i].point);
+  return cache;
+}
+
 size_t pippenger_get_cache_size(const std::shared_ptr<pippenger_cached_data> &cache)
 {
-  return cache->size * sizeof(*cache->cached);
+  return cache->size * (cache->precomp ? sizeof(*cache->precomp) : sizeof(*cache->cached));
 }
 
-rct::key pippenger(const std::vector<MultiexpData> &data, const std::shared_ptr<pippenger_cached_data> &cache, size_t cache_size, size_t c)
+static void dbl(ge_p3 &p3, size_t n)
 {
-  if (cache != NULL && cache_size == 0)
-    cache_size = cache->size;
-  CHECK_AND_ASSERT_THROW_MES(cache == NULL || cache_size <= cache->size, "Cache is too small");
-  if (c == 0)
-    c = get_pippenger_c(data.size());
-  CHECK_AND_ASSERT_THROW_MES(c <= 9, "c is too large");
+  ge_p2 p2;
+  ge_p3_to_p2(&p2, &p3);
+  for (size_t i = 0; i < n; ++i)
+  {
+    ge_p1p1 p1;
+    ge_p2_dbl(&p1, &p2);
+    if (i == n - 1)
+      ge_p1p1_to_p3(&p3, &p1);
+    else
+      ge_p1p1_to_p2(&p2, &p1);
+  }
+}
 
-  ge_p3 result = ge_p3_identity;
+// Runs the windows k_begin..k_end-1 (most significant first) into result, as if the scalars had no
+// bits below window k_begin; returns false if result is still the identity
+static bool pippenger_windows(ge_p3 &result, const std::vector<MultiexpData> &data, const pippenger_cached_data &local_cache, const pippenger_cached_data *local_cache_2, size_t cache_size, size_t c, size_t k_begin, size_t k_end)
+{
   bool result_init = false;
   std::unique_ptr<ge_p3[]> buckets{new ge_p3[1<<c]};
   bool buckets_init[1<<9];
-  std::shared_ptr<pippenger_cached_data> local_cache = cache == NULL ? pippenger_init_cache(data) : cache;
-  std::shared_ptr<pippenger_cached_data> local_cache_2 = data.size() > cache_size ? pippenger_init_cache(data, cache_size) : NULL;
-
-  rct::key maxscalar = rct::zero();
-  for (size_t i = 0; i < data.size(); ++i)
-  {
-    if (maxscalar < data[i].scalar)
-      maxscalar = data[i].scalar;
-  }
-  size_t groups = 0;
-  while (groups < 256 && !(maxscalar < pow2(groups)))
-    ++groups;
-  groups = (groups + c - 1) / c;
 
-  for (size_t k = groups; k-- > 0; )
+  for (size_t k = k_end; k-- > k_begin; )
   {
     if (result_init)
-    {
-      ge_p2 p2;
-      ge_p3_to_p2(&p2, &result);
-      for (size_t i = 0; i < c; ++i)
-      {
-        ge_p1p1 p1;
-        ge_p2_dbl(&p1, &p2);
-        if (i == c - 1)
-          ge_p1p1_to_p3(&result, &p1);
-        else
-          ge_p1p1_to_p2(&p2, &p1);
-      }
-    }
+      dbl(result, c);
     memset(buckets_init, 0, 1u<<c);
 
     // partition scalars into buckets
@@ -662,8 +671,10 @@ rct::key pippenger(const std::vector<MultiexpData> &data, const std::shared_ptr<
       CHECK_AND_ASSERT_THROW_MES(bucket < (1u<<c), "bucket overflow");
       if (buckets_init[bucket])
       {
-        if (i < cache_size)
-          add(buckets[bucket], local_cache->cached[i]);
+        if (i < cache_size && local_cache.precomp)
+          add(buckets[bucket], local_cache.precomp[i]);
+        else if (i < cache_size)
+          add(buckets[bucket], local_cache.cached[i]);
         else
           add(buckets[bucket], local_cache_2->cached[i - cache_size]);
       }
@@ -701,10 +712,86 @@ rct::key pippenger(const std::vector<MultiexpData> &data, const std::shared_ptr<
       }
     }
   }
+  return result_init;
+}
+
+static rct::key pippenger(const std::vector<MultiexpData> &data, const std::shared_ptr<pippenger_cached_data> &cache, size_t cache_size, size_t c, tools::threadpool *tpool)
+{
+  if (cache != NULL && cache_size == 0)
+    cache_size = cache->size;
+  CHECK_AND_ASSERT_THROW_MES(cache == NULL || cache_size <= cache->size, "Cache is too small");
+  if (c == 0)
+    c = get_pippenger_c(data.size());
+  CHECK_AND_ASSERT_THROW_MES(c <= 9, "c is too large");
+
+  std::shared_ptr<pippenger_cached_data> local_cache = cache == NULL ? pippenger_init_cache(data) : cache;
+  std::shared_ptr<pippenger_cached_data> local_cache_2 = data.size() > cache_size ? pippenger_init_cache(data, cache_size) : NULL;
+
+  rct::key maxscalar = rct::zero();
+  for (size_t i = 0; i < data.size(); ++i)
+  {
+    if (maxscalar < data[i].scalar)
+      maxscalar = data[i].scalar;
+  }
+  size_t groups = 0;
+  while (groups < 256 && !(maxscalar < pow2(groups)))
+    ++groups;
+  groups = (groups + c - 1) / c;
+
+  ge_p3 result = ge_p3_identity;
+  const size_t tasks = tpool ? std::min<size_t>(groups, tpool->get_max_concurrency()) : 1;
+  if (tasks <= 1)
+  {
+    pippenger_windows(result, data, *local_cache, local_cache_2.get(), cache_size, c, 0, groups);
+  }
+  else
+  {
+    // each task takes a contiguous run of windows, and the partial results are then combined in
+    // window order, so the result is the same as the single threaded one
+    std::vector<ge_p3> partial(tasks);
+    std::unique_ptr<bool[]> partial_init{new bool[tasks]};
+    std::atomic<bool> failed{false};
+    tools::threadpool::waiter waiter;
+    for (size_t t = 0; t < tasks; ++t)
+    {
+      tpool->submit(&waiter, [&, t] {
+        try { partial_init[t] = pippenger_windows(partial[t], data, *local_cache, local_cache_2.get(), cache_size, c, groups * t / tasks, groups * (t + 1) / tasks); }
+        catch (...) { partial_init[t] = false; failed = true; }
+      }, true);
+    }
+    waiter.wait(tpool);
+    CHECK_AND_ASSERT_THROW_MES(!failed, "Failed to run pippenger windows");
+
+    bool result_init = false;
+    for (size_t t = tasks; t-- > 0; )
+    {
+      if (result_init)
+        dbl(result, c * (groups * (t + 1) / tasks - groups * t / tasks));
+      if (!partial_init[t])
+        continue;
+      if (result_init)
+        add(result, partial[t]);
+      else
+      {
+        result = partial[t];
+        result_init = true;
+      }
+    }
+  }
 
   rct::key res;
   ge_p3_tobytes(res.bytes, &result);
   return res;
 }
 
+rct::key pippenger(const std::vector<MultiexpData> &data, const std::shared_ptr<pippenger_cached_data> &cache, size_t cache_size, size_t c)
+{
+  return pippenger(data, cache, cache_size, c, NULL);
+}
+
+rct::key pippenger_threaded(const std::vector<MultiexpData> &data, const std::shared_ptr<pippenger_cached_data> &cache, size_t cache_size, size_t c)
+{
+  return pippenger(data, cache, cache_size, c, &tools::threadpool::getInstance());
+}
+
 }
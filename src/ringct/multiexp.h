@@ -62,9 +62,16 @@ std::shared_ptr<straus_cached_data> straus_init_cache(const std::vector<Multiexp
 size_t straus_get_cache_size(const std::shared_ptr<straus_cached_data> &cache);
 rct::key straus(const std::vector<MultiexpData> &data, const std::shared_ptr<straus_cached_data> &cache = NULL, size_t STEP = 0);
 std::shared_ptr<pippenger_cached_data> pippenger_init_cache(const std::vector<MultiexpData> &data, size_t start_offset = 0, size_t N =0);
+// Like pippenger_init_cache, but keeps the first N points (all by default) in affine form, which
+// makes adding them cheaper; worth the inversion each only for points used again and again, like
+// the bulletproof generators
+std::shared_ptr<pippenger_cached_data> pippenger_init_fixed_base_cache(const std::vector<MultiexpData> &data, size_t N = 0);
 size_t pippenger_get_cache_size(const std::shared_ptr<pippenger_cached_data> &cache);
 size_t get_pippenger_c(size_t N);
 rct::key pippenger(const std::vector<MultiexpData> &data, const std::shared_ptr<pippenger_cached_data> &cache = NULL, size_t cache_size = 0, size_t c = 0);
+// Like pippenger, but runs the windows in parallel on the thread pool, with the same result; must
+// not be called from a leaf task
+rct::key pippenger_threaded(const std::vector<MultiexpData> &data, const std::shared_ptr<pippenger_cached_data> &cache = NULL, size_t cache_size = 0, size_t c = 0);
 
 }
 
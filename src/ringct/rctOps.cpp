@@ -555,6 +555,57 @@ namespace rct {
         return rv;
     }
 
+    // amountH_table()[15*i + j - 1] = j*16^i*H, for the 16 nibbles of an amount
+    static const std::vector<ge_cached> &amountH_table() {
+        static const std::vector<ge_cached> table = [] {
+            std::vector<ge_cached> t(16 * 15);
+            ge_p3 base = ge_p3_H, p;
+            ge_cached base_cached;
+            ge_p1p1 tmp;
+            for (int i = 0; i < 16; ++i) {
+                ge_p3_to_cached(&base_cached, &base);
+                p = base;
+                for (int j = 1; j < 16; ++j) {
+                    ge_p3_to_cached(&t[15 * i + j - 1], &p);
+                    ge_add(&tmp, &p, &base_cached);
+                    ge_p1p1_to_p3(&p, &tmp);
+                }
+                base = p;
+            }
+            return t;
+        }();
+        return table;
+    }
+
+    bool equalSums(const keyV &A, const keyV &B, xmr_amount amount) {
+        ge_p3 sum = ge_p3_identity, tmp;
+        ge_cached cached;
+        ge_p1p1 p1;
+        for (const key &a : A) {
+            CHECK_AND_ASSERT_THROW_MES_L1(ge_frombytes_vartime(&tmp, a.bytes) == 0, "ge_frombytes_vartime failed at "+boost::lexical_cast<std::string>(__LINE__));
+            ge_p3_to_cached(&cached, &tmp);
+            ge_add(&p1, &sum, &cached);
+            ge_p1p1_to_p3(&sum, &p1);
+        }
+        for (const key &b : B) {
+            CHECK_AND_ASSERT_THROW_MES_L1(ge_frombytes_vartime(&tmp, b.bytes) == 0, "ge_frombytes_vartime failed at "+boost::lexical_cast<std::string>(__LINE__));
+            ge_p3_to_cached(&cached, &tmp);
+            ge_sub(&p1, &sum, &cached);
+            ge_p1p1_to_p3(&sum, &p1);
+        }
+        // amounts are public, so this doesn't need to be constant time
+        const std::vector<ge_cached> &table = amountH_table();
+        for (int i = 0; amount; ++i, amount >>= 4) {
+            if (amount & 15) {
+                ge_sub(&p1, &sum, &table[15 * i + (amount & 15) - 1]);
+                ge_p1p1_to_p3(&sum, &p1);
+            }
+        }
+        key res;
+        ge_p3_tobytes(res.bytes, &sum);
+        return equalKeys(res, identity());
+    }
+
     //Hashing - cn_fast_hash
     //be careful these are also in crypto namespace
     //cn_fast_hash for arbitrary multiples of 32 bytes
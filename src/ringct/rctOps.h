@@ -153,6 +153,9 @@ namespace rct {
     void subKeys(key &AB, const key &A, const  key &B);
     //checks if A, B are equal as curve points
     bool equalKeys(const key & A, const key & B);
+    //checks if sum(A) = sum(B) + amount*H as curve points (A, B must be valid points); cheaper
+    //than comparing addKeys sums, as the sums are never encoded and amount*H is table based
+    bool equalSums(const keyV &A, const keyV &B, xmr_amount amount);
 
     //Hashing - cn_fast_hash
     //be careful these are also in crypto namespace
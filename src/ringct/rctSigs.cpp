@@ -28,7 +28,9 @@
 // STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <array>
 #include "epee/misc_log_ex.h"
+#include "common/lru_cache.h"
 #include "common/perf_timer.h"
 #include "common/threadpool.h"
 #include "common/util.h"
@@ -74,6 +76,49 @@ namespace
 
         return rct::Bulletproof{rct::keyV(n_outs, I), I, I, I, I, I, I, rct::keyV(nrl, I), rct::keyV(nrl, I), I, I, I};
     }
+
+    // The parts of a CLSAG ring member's verification that only depend on its output key.  Recent
+    // outputs get picked as decoys by many rings, so the most recently used ones are kept for all
+    // the verification threads to share (each entry is about 2.5kB).
+    struct clsag_member_precomp
+    {
+        rct::geDsmp P;    // the output key
+        rct::geDsmp hash; // its hash to point
+    };
+    constexpr size_t CLSAG_MEMBER_CACHE_SIZE = 4096;
+    std::mutex clsag_member_cache_mutex;
+    tools::lru_cache<rct::key, std::shared_ptr<const clsag_member_precomp>> clsag_member_cache{CLSAG_MEMBER_CACHE_SIZE};
+
+    // Throws if `dest` isn't a valid point
+    std::shared_ptr<const clsag_member_precomp> get_clsag_member_precomp(const rct::key &dest)
+    {
+        {
+            std::lock_guard lock{clsag_member_cache_mutex};
+            if (auto *cached = clsag_member_cache.get(dest))
+                return *cached;
+        }
+        auto pre = std::make_shared<clsag_member_precomp>();
+        rct::precomp(pre->P.k, dest);
+        ge_p3 hash8_p3;
+        rct::hash_to_p3(hash8_p3, dest);
+        ge_dsm_precomp(pre->hash.k, &hash8_p3);
+        std::lock_guard lock{clsag_member_cache_mutex};
+        clsag_member_cache.put(dest, pre);
+        return pre;
+    }
+
+    // Verification hashes a fresh key vector for every input of every transaction.  These are
+    // kept per thread and resized in place instead, which never gives back their capacity, so once
+    // a verification thread has seen its largest ring they cost no allocations at all.  Each
+    // caller uses its own slot and overwrites every element before hashing.
+    enum class scratch { clsag_mu_P, clsag_mu_C, clsag_round, mlsag_round, _count };
+    rct::keyV &scratch_keys(scratch slot, size_t size)
+    {
+        thread_local std::array<rct::keyV, static_cast<size_t>(scratch::_count)> keys;
+        auto &v = keys[static_cast<size_t>(slot)];
+        v.resize(size);
+        return v;
+    }
 }
 
 namespace rct {
@@ -327,7 +372,7 @@ namespace rct {
             precomp(Ip[i].k, rv.II[i]);
         }
         size_t ndsRows = 3 * dsRows; // number of dimensions not requiring linkability
-        keyV toHash(1 + 3 * dsRows + 2 * (rows - dsRows));
+        keyV &toHash = scratch_keys(scratch::mlsag_round, 1 + 3 * dsRows + 2 * (rows - dsRows));
         toHash[0] = message;
         i = 0;
         while (i < cols) {
@@ -606,8 +651,8 @@ namespace rct {
             precomp(D_precomp.k,D_8);
 
             // Aggregation hashes
-            keyV mu_P_to_hash(2*n+4); // domain, I, D, P, C, C_offset
-            keyV mu_C_to_hash(2*n+4); // domain, I, D, P, C, C_offset
+            keyV &mu_P_to_hash = scratch_keys(scratch::clsag_mu_P, 2*n+4); // domain, I, D, P, C, C_offset
+            keyV &mu_C_to_hash = scratch_keys(scratch::clsag_mu_C, 2*n+4); // domain, I, D, P, C, C_offset
             sc_0(mu_P_to_hash[0].bytes);
             memcpy(mu_P_to_hash[0].bytes, config::HASH_KEY_CLSAG_AGG_0.data(), config::HASH_KEY_CLSAG_AGG_0.size());
             sc_0(mu_C_to_hash[0].bytes);
@@ -631,7 +676,7 @@ namespace rct {
             mu_C = hash_to_scalar(mu_C_to_hash);
 
             // Set up round hash
-            keyV c_to_hash(2*n+5); // domain, P, C, C_offset, message, L, R
+            keyV &c_to_hash = scratch_keys(scratch::clsag_round, 2*n+5); // domain, P, C, C_offset, message, L, R
             sc_0(c_to_hash[0].bytes);
             memcpy(c_to_hash[0].bytes, config::HASH_KEY_CLSAG_ROUND.data(), config::HASH_KEY_CLSAG_ROUND.size());
             for (size_t i = 1; i < n+1; ++i)
@@ -646,12 +691,8 @@ namespace rct {
             key c_new;
             key L;
             key R;
-            geDsmp P_precomp;
             geDsmp C_precomp;
-            geDsmp H_precomp;
             size_t i = 0;
-            ge_p3 hash8_p3;
-            geDsmp hash_precomp;
             ge_p3 temp_p3;
             ge_p1p1 temp_p1;
 
@@ -661,7 +702,7 @@ namespace rct {
                 sc_mul(c_c.bytes,mu_C.bytes,c.bytes);
 
                 // Precompute points for L/R
-                precomp(P_precomp.k,pubs[i].dest);
+                const auto member = get_clsag_member_precomp(pubs[i].dest);
 
                 CHECK_AND_ASSERT_MES(ge_frombytes_vartime(&temp_p3, pubs[i].mask.bytes) == 0, false, "point conv failed");
                 ge_sub(&temp_p1,&temp_p3,&C_offset_cached);
@@ -669,12 +710,10 @@ namespace rct {
                 ge_dsm_precomp(C_precomp.k,&temp_p3);
 
                 // Compute L
-                addKeys_aGbBcC(L,sig.s[i],c_p,P_precomp.k,c_c,C_precomp.k);
+                addKeys_aGbBcC(L,sig.s[i],c_p,member->P.k,c_c,C_precomp.k);
 
                 // Compute R
-                hash_to_p3(hash8_p3,pubs[i].dest);
-                ge_dsm_precomp(hash_precomp.k, &hash8_p3);
-                addKeys_aAbBcC(R,sig.s[i],hash_precomp.k,c_p,I_precomp.k,c_c,D_precomp.k);
+                addKeys_aAbBcC(R,sig.s[i],member->hash.k,c_p,I_precomp.k,c_c,D_precomp.k);
 
                 c_to_hash[2*n+3] = L;
                 c_to_hash[2*n+4] = R;
@@ -690,6 +729,30 @@ namespace rct {
         catch (...) { return false; }
     }
 
+    std::vector<size_t> verRctCLSAGSimple(const std::vector<clsag_check> &checks) {
+        PERF_TIMER(verRctCLSAGSimpleBatch);
+
+        // Each CLSAG is a chain of hashes over its ring members' L and R points, so every member
+        // has to be computed in turn; there is no multiexp to share between signatures.  What
+        // batching buys is one threadpool round for all of them instead of one per transaction.
+        std::deque<bool> results(checks.size());
+        tools::threadpool& tpool = tools::threadpool::getInstance();
+        tools::threadpool::waiter waiter;
+        for (size_t i = 0; i < checks.size(); i++) {
+            tpool.submit(&waiter, [&, i] {
+                const clsag_check &check = checks[i];
+                results[i] = check.sig && check.pubs && verRctCLSAGSimple(check.message, *check.sig, *check.pubs, check.C_offset);
+            }, true);
+        }
+        waiter.wait(&tpool);
+
+        std::vector<size_t> failed;
+        for (size_t i = 0; i < results.size(); ++i)
+            if (!results[i])
+                failed.push_back(i);
+        return failed;
+    }
+
 
     //These functions get keys from blockchain
     //replace these when connecting blockchain
@@ -1012,16 +1075,9 @@ namespace rct {
           for (size_t i = 0; i < rv.outPk.size(); i++) {
             masks[i] = rv.outPk[i].mask;
           }
-          key sumOutpks = addKeys(masks);
-          DP(sumOutpks);
-          const key txnFeeKey = scalarmultH(d2h(rv.txnFee));
-          addKeys(sumOutpks, txnFeeKey, sumOutpks);
-
-          key sumPseudoOuts = addKeys(pseudoOuts);
-          DP(sumPseudoOuts);
 
           //check pseudoOuts vs Outs..
-          if (!equalKeys(sumPseudoOuts, sumOutpks)) {
+          if (!equalSums(pseudoOuts, masks, rv.txnFee)) {
             LOG_PRINT_L1("Sum check failed");
             return false;
           }
@@ -1075,60 +1131,79 @@ namespace rct {
     //ver RingCT simple
     //assumes only post-rct style inputs (at least for max anonymity)
     bool verRctNonSemanticsSimple(const rctSig & rv) {
-      try
-      {
-        PERF_TIMER(verRctNonSemanticsSimple);
+        return verRctNonSemanticsSimple(std::vector<const rctSig*>{&rv}).front();
+    }
 
-        CHECK_AND_ASSERT_MES(rct::is_rct_simple(rv.type), false, "verRctNonSemanticsSimple called on non simple rctSig");
-        const bool bulletproof = is_rct_bulletproof(rv.type);
-        // semantics check is early, and mixRing/MGs aren't resolved yet
-        if (bulletproof)
-          CHECK_AND_ASSERT_MES(rv.p.pseudoOuts.size() == rv.mixRing.size(), false, "Mismatched sizes of rv.p.pseudoOuts and mixRing");
-        else
-          CHECK_AND_ASSERT_MES(rv.pseudoOuts.size() == rv.mixRing.size(), false, "Mismatched sizes of rv.pseudoOuts and mixRing");
+    std::vector<bool> verRctNonSemanticsSimple(const std::vector<const rctSig*> & rvv) {
+        PERF_TIMER(verRctNonSemanticsSimple);
 
-        const size_t threads = std::max(rv.outPk.size(), rv.mixRing.size());
+        // std::deque rather than std::vector<bool> so that tasks can set their own element
+        std::deque<bool> valid(rvv.size(), false);
+        for (size_t t = 0; t < rvv.size(); ++t) {
+            if (!rvv[t]) {
+                LOG_PRINT_L1("rctSig pointer is NULL");
+                continue;
+            }
+            const rctSig &rv = *rvv[t];
+            if (!rct::is_rct_simple(rv.type)) {
+                LOG_PRINT_L1("verRctNonSemanticsSimple called on non simple rctSig");
+                continue;
+            }
+            // semantics check is early, and mixRing/MGs aren't resolved yet
+            const size_t pseudo_outs = (is_rct_bulletproof(rv.type) ? rv.p.pseudoOuts : rv.pseudoOuts).size();
+            const size_t sigs = rv.type == RCTType::CLSAG ? rv.p.CLSAGs.size() : rv.p.MGs.size();
+            if (pseudo_outs != rv.mixRing.size() || sigs != rv.mixRing.size()) {
+                LOG_PRINT_L1("Mismatched sizes of pseudoOuts, signatures and mixRing");
+                continue;
+            }
+            valid[t] = true;
+        }
 
-        std::deque<bool> results(threads);
         tools::threadpool& tpool = tools::threadpool::getInstance();
-        tools::threadpool::waiter waiter;
-
-        const keyV &pseudoOuts = bulletproof ? rv.p.pseudoOuts : rv.pseudoOuts;
-
-        const key message = get_pre_clsag_hash(rv, hw::get_device("default"));
-
-        results.clear();
-        results.resize(rv.mixRing.size());
-        for (size_t i = 0 ; i < rv.mixRing.size() ; i++) {
-          tpool.submit(&waiter, [&, i] {
-              if (rv.type == RCTType::CLSAG)
-                  results[i] = verRctCLSAGSimple(message, rv.p.CLSAGs[i], rv.mixRing[i], pseudoOuts[i]);
-              else
-                  results[i] = verRctMGSimple(message, rv.p.MGs[i], rv.mixRing[i], pseudoOuts[i]);
-          });
-        }
-        waiter.wait(&tpool);
+        {
+            tools::threadpool::waiter waiter;
+            std::vector<key> messages(rvv.size());
+            for (size_t t = 0; t < rvv.size(); ++t) {
+                if (!valid[t])
+                    continue;
+                tpool.submit(&waiter, [&, t] {
+                    // we can get deep throws from ge_frombytes_vartime if input isn't valid
+                    try { messages[t] = get_pre_clsag_hash(*rvv[t], hw::get_device("default")); }
+                    catch (const std::exception &e) {
+                        LOG_PRINT_L1("Error in verRctNonSemanticsSimple: " << e.what());
+                        valid[t] = false;
+                    }
+                }, true);
+            }
+            waiter.wait(&tpool);
 
-        for (size_t i = 0; i < results.size(); ++i) {
-          if (!results[i]) {
-            LOG_PRINT_L1("verRctMGSimple/verRctCLSAGSimple failed for input " << i);
-            return false;
-          }
+            // One task per input across all the rctSigs, so that large transactions don't hold up
+            // the batch while other workers sit idle
+            std::vector<std::pair<size_t, size_t>> inputs;
+            for (size_t t = 0; t < rvv.size(); ++t)
+                if (valid[t])
+                    for (size_t i = 0; i < rvv[t]->mixRing.size(); ++i)
+                        inputs.emplace_back(t, i);
+            std::deque<bool> results(inputs.size());
+            tpool.parallel_for(0, inputs.size(), 1, [&](size_t n) {
+                const auto [t, i] = inputs[n];
+                const rctSig &rv = *rvv[t];
+                const key &pseudoOut = is_rct_bulletproof(rv.type) ? rv.p.pseudoOuts[i] : rv.pseudoOuts[i];
+                if (rv.type == RCTType::CLSAG)
+                    results[n] = verRctCLSAGSimple(messages[t], rv.p.CLSAGs[i], rv.mixRing[i], pseudoOut);
+                else
+                    results[n] = verRctMGSimple(messages[t], rv.p.MGs[i], rv.mixRing[i], pseudoOut);
+            }, true);
+
+            for (size_t n = 0; n < inputs.size(); ++n) {
+                if (!results[n]) {
+                    LOG_PRINT_L1("verRctMGSimple/verRctCLSAGSimple failed for input " << inputs[n].second);
+                    valid[inputs[n].first] = false;
+                }
+            }
         }
 
-        return true;
-      }
-      // we can get deep throws from ge_frombytes_vartime if input isn't valid
-      catch (const std::exception &e)
-      {
-        LOG_PRINT_L1("Error in verRctNonSemanticsSimple: " << e.what());
-        return false;
-      }
-      catch (...)
-      {
-        LOG_PRINT_L1("Error in verRctNonSemanticsSimple, but not an actual exception");
-        return false;
-      }
+        return {valid.begin(), valid.end()};
     }
 
     //RingCT protocol
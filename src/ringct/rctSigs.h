@@ -76,6 +76,11 @@ namespace rct {
     clsag CLSAG_Gen(const key &message, const keyV & P, const key & p, const keyV & C, const key & z, const keyV & C_nonzero, const key & C_offset, const unsigned int l);
     clsag proveRctCLSAGSimple(const key &, const ctkeyV &, const ctkey &, const key &, const key &, const multisig_kLRki *, key *, key *, unsigned int, hw::device &);
     bool verRctCLSAGSimple(const key &, const clsag &, const ctkeyV &, const key &);
+    // A CLSAG to verify in a batch; `sig` and `pubs` must outlive the call
+    struct clsag_check { key message; const clsag *sig; const ctkeyV *pubs; key C_offset; };
+    // Verifies many CLSAGs in a single threadpool batch, returning the indices of those that don't
+    // verify (so an empty result means they all did).  Must not be called from a leaf task.
+    std::vector<size_t> verRctCLSAGSimple(const std::vector<clsag_check> &checks);
 
     //proveRange and verRange
     //proveRange gives C, and mask such that \sumCi = C
@@ -122,6 +127,9 @@ namespace rct {
     bool verRctSemanticsSimple(const rctSig & rv);
     bool verRctSemanticsSimple(const std::vector<const rctSig*> & rv);
     bool verRctNonSemanticsSimple(const rctSig & rv);
+    // Verifies the non-semantic part (ring signatures) of many rctSigs in a single threadpool batch,
+    // returning whether each one verified.  Must not be called from a leaf task.
+    std::vector<bool> verRctNonSemanticsSimple(const std::vector<const rctSig*> & rv);
     inline bool verRctSimple(const rctSig & rv) { return verRctSemanticsSimple(rv) && verRctNonSemanticsSimple(rv); }
     xmr_amount decodeRct(const rctSig & rv, const key & sk, unsigned int i, key & mask, hw::device &hwdev);
     xmr_amount decodeRct(const rctSig & rv, const key & sk, unsigned int i, hw::device &hwdev);
@@ -1,6 +1,9 @@
 #include "bootstrap_daemon.h"
 
+#include <algorithm>
+#include <condition_variable>
 #include <stdexcept>
+#include <thread>
 
 #include "common/string_util.h"
 #include "crypto/crypto.h"
@@ -12,6 +15,16 @@
 
 namespace cryptonote
 {
+  namespace
+  {
+    // Number of public nodes we spread requests over in auto mode
+    constexpr size_t BOOTSTRAP_UPSTREAMS = 3;
+    // Upper limit on cached responses; past this we drop the ones closest to expiry
+    constexpr size_t BOOTSTRAP_CACHE_MAX_ENTRIES = 1000;
+    // How long to wait for an upstream before hedging a request to another: a few times its usual
+    // response time, within these bounds (or the maximum if we haven't heard from it yet).
+    constexpr std::chrono::milliseconds BOOTSTRAP_MIN_HEDGE_DELAY = 200ms, BOOTSTRAP_MAX_HEDGE_DELAY = 2s;
+  }
 
   bootstrap_daemon::bootstrap_daemon(std::function<std::optional<std::string>()> get_next_public_node)
     : m_get_next_public_node(get_next_public_node)
@@ -21,15 +34,16 @@ namespace cryptonote
   bootstrap_daemon::bootstrap_daemon(const std::string &address, const std::optional<std::pair<std::string_view, std::string_view>> &credentials)
     : bootstrap_daemon(nullptr)
   {
-    if (!set_server(address, credentials))
-    {
-      throw std::runtime_error("invalid bootstrap daemon address or credentials");
-    }
+    m_upstreams.push_back(make_upstream(address, credentials));
   }
 
-  std::string bootstrap_daemon::address() const noexcept
+  std::string bootstrap_daemon::address() const
   {
-    return m_http_client.get_base_url();
+    std::lock_guard lock{m_upstreams_mutex};
+    auto best = std::min_element(m_upstreams.begin(), m_upstreams.end(), [](const auto& a, const auto& b) {
+      return a->latency_us < b->latency_us;
+    });
+    return best == m_upstreams.end() ? "" : (*best)->client.get_base_url();
   }
 
   std::optional<uint64_t> bootstrap_daemon::get_height()
@@ -49,33 +63,154 @@ namespace cryptonote
     return res.height;
   }
 
-  bool bootstrap_daemon::set_server(std::string url, const std::optional<std::pair<std::string_view, std::string_view>> &credentials /* = std::nullopt */)
+  void bootstrap_daemon::set_failed()
+  {
+    std::lock_guard lock{m_upstreams_mutex};
+    for (auto& u : m_upstreams)
+      u->failed = true;
+  }
+
+  std::shared_ptr<bootstrap_daemon::upstream> bootstrap_daemon::make_upstream(std::string url, const std::optional<std::pair<std::string_view, std::string_view>> &credentials /* = std::nullopt */)
   {
     if (!tools::starts_with(url, "http://") && !tools::starts_with(url, "https://"))
       url.insert(0, "http://");
-    m_http_client.set_base_url(std::move(url));
+    MINFO("Using bootstrap daemon " << url);
+    auto u = std::make_shared<upstream>();
+    u->client.set_base_url(std::move(url));
     if (credentials)
-      m_http_client.set_auth(credentials->first, credentials->second);
+      u->client.set_auth(credentials->first, credentials->second);
+    return u;
+  }
+
+  std::vector<std::shared_ptr<bootstrap_daemon::upstream>> bootstrap_daemon::usable_upstreams()
+  {
+    std::lock_guard lock{m_upstreams_mutex};
+    if (!m_get_next_public_node)
+    {
+      // A fixed bootstrap daemon is all we have, so keep trying it
+      for (auto& u : m_upstreams)
+        u->failed = false;
+    }
     else
-      m_http_client.set_auth();
+    {
+      m_upstreams.erase(std::remove_if(m_upstreams.begin(), m_upstreams.end(),
+            [](const auto& u) { return u->failed.load(); }), m_upstreams.end());
+      for (size_t tries = 0; m_upstreams.size() < BOOTSTRAP_UPSTREAMS && tries < 2 * BOOTSTRAP_UPSTREAMS; tries++)
+      {
+        auto address = m_get_next_public_node();
+        if (!address)
+          break;
+        auto u = make_upstream(std::move(*address));
+        auto url = u->client.get_base_url();
+        if (std::none_of(m_upstreams.begin(), m_upstreams.end(), [&url](const auto& x) { return x->client.get_base_url() == url; }))
+          m_upstreams.push_back(std::move(u));
+      }
+    }
 
-    MINFO("Changed bootstrap daemon address to " << url);
-    return true;
+    auto result = m_upstreams;
+    // Fastest first, but ones we haven't heard from yet (latency 0) ahead of those so that they get
+    // measured
+    std::stable_sort(result.begin(), result.end(), [](const auto& a, const auto& b) { return a->latency_us < b->latency_us; });
+    return result;
   }
 
+  std::optional<std::any> bootstrap_daemon::attempt(upstream& u, const std::function<std::any(rpc::http_client&)>& call)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    try {
+      std::any result = call(u.client);
+      const int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+      const int64_t prev = u.latency_us;
+      u.latency_us = std::max<int64_t>(prev ? (7 * prev + us) / 8 : us, 1);
+      return result;
+    } catch (const std::exception& e) {
+      MWARNING("bootstrap daemon request to " << u.client.get_base_url() << " failed: " << e.what());
+      u.failed = true;
+      return std::nullopt;
+    }
+  }
 
-  bool bootstrap_daemon::switch_server_if_needed()
+  std::optional<std::any> bootstrap_daemon::request(std::function<std::any(rpc::http_client&)> call, bool hedge)
   {
-    if (!m_failed || !m_get_next_public_node)
-      return true;
+    auto upstreams = usable_upstreams();
+    if (upstreams.empty())
+      return std::nullopt;
+    if (!hedge || upstreams.size() == 1)
+      return attempt(*upstreams.front(), call);
+
+    // Attempts run in their own threads and report back here; whichever succeeds first wins, and
+    // slower ones finish in the background.
+    struct shared_state
+    {
+      std::mutex mutex;
+      std::condition_variable cv;
+      std::optional<std::any> result;
+      size_t pending = 0;
+    };
+    auto state = std::make_shared<shared_state>();
+    auto shared_call = std::make_shared<std::function<std::any(rpc::http_client&)>>(std::move(call));
+    auto done = [&state] { return state->result || state->pending == 0; };
+
+    const size_t max_attempts = std::min<size_t>(upstreams.size(), 2);
+    size_t next = 0;
+    std::unique_lock lock{state->mutex};
+    for (;;)
+    {
+      auto u = upstreams[next++];
+      state->pending++;
+      std::thread{[state, shared_call, u] {
+        auto r = attempt(*u, *shared_call);
+        std::lock_guard lock{state->mutex};
+        if (r && !state->result)
+          state->result = std::move(r);
+        state->pending--;
+        state->cv.notify_all();
+      }}.detach();
+
+      if (next == max_attempts)
+        break;
+
+      const int64_t latency_us = u->latency_us;
+      const auto delay = latency_us ?
+        std::clamp<std::chrono::microseconds>(std::chrono::microseconds{3 * latency_us}, BOOTSTRAP_MIN_HEDGE_DELAY, BOOTSTRAP_MAX_HEDGE_DELAY) :
+        std::chrono::microseconds{BOOTSTRAP_MAX_HEDGE_DELAY};
+      if (state->cv.wait_for(lock, delay, done) && state->result)
+        return std::move(state->result);
+      // Either everything so far failed or is taking too long: try the next upstream as well
+      MDEBUG("Bootstrap request " << (state->pending ? "slow" : "failed") << ", also trying " << upstreams[next]->client.get_base_url());
+    }
+
+    state->cv.wait(lock, done);
+    return std::move(state->result);
+  }
 
-    const std::optional<std::string> address = m_get_next_public_node();
-    if (address) {
-      m_failed = false;
-      return set_server(*address);
+  std::optional<std::any> bootstrap_daemon::get_cached(const std::string& key)
+  {
+    std::lock_guard lock{m_cache_mutex};
+    auto it = m_cache.find(key);
+    if (it == m_cache.end())
+      return std::nullopt;
+    if (it->second.expires <= std::chrono::steady_clock::now())
+    {
+      m_cache.erase(it);
+      return std::nullopt;
     }
+    return it->second.response;
+  }
 
-    return false;
+  void bootstrap_daemon::cache(std::string key, std::any response, std::chrono::seconds lifetime)
+  {
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard lock{m_cache_mutex};
+    if (m_cache.size() >= BOOTSTRAP_CACHE_MAX_ENTRIES)
+    {
+      for (auto it = m_cache.begin(); it != m_cache.end(); )
+        it = it->second.expires <= now ? m_cache.erase(it) : std::next(it);
+      while (m_cache.size() >= BOOTSTRAP_CACHE_MAX_ENTRIES)
+        m_cache.erase(std::min_element(m_cache.begin(), m_cache.end(),
+              [](const auto& a, const auto& b) { return a.second.expires < b.second.expires; }));
+    }
+    m_cache.insert_or_assign(std::move(key), cached_response{std::move(response), now + lifetime});
   }
 
 }
@@ -1,6 +1,12 @@
 #pragma  once
 
+#include <any>
+#include <atomic>
+#include <chrono>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 #include "rpc/http_client.h"
@@ -9,50 +15,129 @@
 namespace cryptonote
 {
 
+  // How long a bootstrapped response to RPC may be served from our cache; 0 for requests that
+  // aren't cacheable.  Only requests for data of already mined blocks qualify; anything about the
+  // mempool or the chain tip changes too quickly.
+  template <typename RPC>
+  constexpr std::chrono::seconds bootstrap_cache_lifetime()
+  {
+    using namespace std::literals;
+    if constexpr (std::is_same_v<RPC, rpc::GET_BLOCK_HEADER_BY_HASH>)
+      return 10min;
+    else if constexpr (
+        std::is_same_v<RPC, rpc::GET_BLOCK_HEADERS_RANGE> ||
+        std::is_same_v<RPC, rpc::GET_BLOCK_HEADER_BY_HEIGHT> ||
+        std::is_same_v<RPC, rpc::GET_BLOCKS_BY_HEIGHT> ||
+        std::is_same_v<RPC, rpc::GET_OUTPUTS> ||
+        std::is_same_v<RPC, rpc::GET_OUTPUTS_BIN> ||
+        std::is_same_v<RPC, rpc::GET_OUTPUT_DISTRIBUTION> ||
+        std::is_same_v<RPC, rpc::GET_OUTPUT_DISTRIBUTION_BIN> ||
+        std::is_same_v<RPC, rpc::GET_TX_GLOBAL_OUTPUTS_INDEXES>)
+      // Recent blocks can still be reorged, and distributions grow with every block
+      return 30s;
+    else
+      return 0s;
+  }
+
+  // Forwards RPC requests to remote nodes while we are syncing.  With a fixed address that is the
+  // only upstream; in auto mode we keep several public nodes and send each request to whichever
+  // has been answering fastest, re-sending (hedging) it to a second one if the first is slow to
+  // respond.  Responses to cacheable requests (see bootstrap_cache_lifetime) are kept for reuse.
+  //
+  // This class is thread-safe: concurrent requests proceed in parallel.
   class bootstrap_daemon
   {
   public:
     bootstrap_daemon(std::function<std::optional<std::string>()> get_next_public_node);
     bootstrap_daemon(const std::string &address, const std::optional<std::pair<std::string_view, std::string_view>> &credentials);
 
-    std::string address() const noexcept;
+    // The address of the current preferred upstream
+    std::string address() const;
     std::optional<uint64_t> get_height();
-    // Called when a request has failed either internally or for some external reason; the next
-    // request will attempt to use a different bootstrap server (if configured).
-    void set_failed() { m_failed = true; }
+    // Called when a request has failed either internally or for some external reason; subsequent
+    // requests will attempt to use different bootstrap servers (if configured).
+    void set_failed();
 
     template <class RPC, std::enable_if_t<std::is_base_of_v<rpc::RPC_COMMAND, RPC>, int> = 0>
     bool invoke(const typename RPC::request& req, typename RPC::response& res)
     {
-      if (!switch_server_if_needed())
-        return false;
+      constexpr auto cache_lifetime = bootstrap_cache_lifetime<RPC>();
+      std::string cache_key;
+      if constexpr (cache_lifetime.count() > 0)
+      {
+        std::string req_serialized;
+        if (epee::serialization::store_t_to_binary(req, req_serialized))
+        {
+          cache_key = RPC::names().front();
+          cache_key += '\0';
+          cache_key += req_serialized;
+        }
+        if (!cache_key.empty())
+          if (auto cached = get_cached(cache_key))
+          {
+            res = std::any_cast<const typename RPC::response&>(*cached);
+            return true;
+          }
+      }
 
-      try {
+      // Copies the request: a hedged call can outlive this one
+      auto response = request([req](rpc::http_client& client) -> std::any {
         if constexpr (std::is_base_of_v<rpc::LEGACY, RPC>)
           // TODO: post-8.x hard fork we can remove this one and let everything go through the
           // non-binary json_rpc version instead (because all legacy json commands are callable via
           // json_rpc as of daemon 8.x).
-          res = m_http_client.json<RPC>(RPC::names().front(), req);
+          return client.json<RPC>(RPC::names().front(), req);
         else if constexpr (std::is_base_of_v<rpc::BINARY, RPC>)
-          res = m_http_client.binary<RPC>(RPC::names().front(), req);
+          return client.binary<RPC>(RPC::names().front(), req);
         else
-          res = m_http_client.json_rpc<RPC>(RPC::names().front(), req);
-      } catch (const std::exception& e) {
-        MWARNING("bootstrap daemon request failed: " << e.what());
-        set_failed();
+          return client.json_rpc<RPC>(RPC::names().front(), req);
+      }, !std::is_same_v<RPC, rpc::SEND_RAW_TX>);
+      if (!response)
         return false;
-      }
+
+      res = std::any_cast<typename RPC::response>(std::move(*response));
+      if constexpr (cache_lifetime.count() > 0)
+        if (!cache_key.empty() && res.status == rpc::STATUS_OK)
+          cache(std::move(cache_key), res, cache_lifetime);
       return true;
     }
 
   private:
-    bool set_server(std::string address, const std::optional<std::pair<std::string_view, std::string_view>> &credentials = std::nullopt);
-    bool switch_server_if_needed();
+    struct upstream
+    {
+      rpc::http_client client;
+      std::atomic<bool> failed = false;
+      // Exponentially weighted moving average of successful response times, in microseconds; 0
+      // until the first response
+      std::atomic<int64_t> latency_us = 0;
+    };
+
+    // Makes a request to the best upstream, and also to the next best if `hedge` is set and the
+    // first takes too long.  Returns the first successful result, or nullopt if every attempt
+    // failed.
+    std::optional<std::any> request(std::function<std::any(rpc::http_client&)> call, bool hedge);
+    // One attempt of `call` on `u`: records its latency on success, or marks it failed.
+    static std::optional<std::any> attempt(upstream& u, const std::function<std::any(rpc::http_client&)>& call);
+
+    // Replaces failed upstreams from m_get_next_public_node; returns the usable ones, best first.
+    std::vector<std::shared_ptr<upstream>> usable_upstreams();
+    std::shared_ptr<upstream> make_upstream(std::string address, const std::optional<std::pair<std::string_view, std::string_view>> &credentials = std::nullopt);
+
+    std::optional<std::any> get_cached(const std::string& key);
+    void cache(std::string key, std::any response, std::chrono::seconds lifetime);
 
-  private:
-    rpc::http_client m_http_client;
     std::function<std::optional<std::string>()> m_get_next_public_node;
-    bool m_failed = false;
+
+    mutable std::mutex m_upstreams_mutex;
+    std::vector<std::shared_ptr<upstream>> m_upstreams;
+
+    struct cached_response
+    {
+      std::any response;
+      std::chrono::steady_clock::time_point expires;
+    };
+    std::mutex m_cache_mutex;
+    std::unordered_map<std::string, cached_response> m_cache;
   };
 
 }
@@ -51,9 +51,15 @@
 #include "common/oxen.h"
 #include "common/sha256sum.h"
 #include "common/perf_timer.h"
+#include "common/trace.h"
+#include "common/lock_stats.h"
+#include "common/metrics.h"
+#include "common/profiler.h"
+#include "common/rules.h"
 #include "common/random.h"
 #include "common/hex.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_basic/transaction_view.h"
 #include "cryptonote_basic/account.h"
 #include "cryptonote_basic/cryptonote_basic_impl.h"
 #include "cryptonote_core/tx_sanity_check.h"
@@ -73,6 +79,26 @@
 namespace cryptonote { namespace rpc {
 
   namespace {
+    // Destroys a response once it has been stored into a portable_storage, so that a large response
+    // isn't held in memory as the struct, the storage and the serialized string all at once.
+    template <typename Response>
+    void release(Response&& res) {
+      [[maybe_unused]] std::remove_reference_t<Response> discard{std::move(res)};
+    }
+
+    // A response with a non-empty `serialized` member is already complete in binary form (see
+    // GET_BLOCKS_FAST) and is sent as is.
+    template <typename Response, typename = void>
+    constexpr bool has_serialized_response = false;
+    template <typename Response>
+    constexpr bool has_serialized_response<Response, std::void_t<decltype(std::declval<Response&>().serialized)>> = true;
+
+    // A response type with a `write_json` method has its JSON written directly (see json_writer.h)
+    template <typename Response, typename = void>
+    constexpr bool has_json_writer = false;
+    template <typename Response>
+    constexpr bool has_json_writer<Response, std::void_t<decltype(std::declval<const Response&>().write_json(std::declval<std::string&>()))>> = true;
+
     // Helper loaders for RPC registration; this lets us reduce the amount of compiled code by
     // avoiding the need to instantiate {JSON,binary} loading code for {binary,JSON} commands.
     // This first one is for JSON, the specialization below is for binary.
@@ -121,8 +147,16 @@ namespace cryptonote { namespace rpc {
 
       template <typename R = typename RPC::response, std::enable_if_t<!std::is_same<R, std::string>::value, int> = 0>
       std::string serialize(typename RPC::response&& res) {
+        if constexpr (has_json_writer<R>) {
+          std::string response;
+          if (res.write_json(response))
+            return response;
+        }
+        epee::serialization::portable_storage ps;
+        res.store(ps);
+        release(std::move(res));
         std::string response;
-        epee::serialization::store_t_to_json(res, response, 0 /*indent*/, false /*newlines*/);
+        ps.dump_as_json(response, 0 /*indent*/, false /*newlines*/);
         return response;
       }
     };
@@ -144,12 +178,48 @@ namespace cryptonote { namespace rpc {
       }
 
       std::string serialize(typename RPC::response&& res) {
+        if constexpr (has_serialized_response<typename RPC::response>)
+          if (!res.serialized.empty())
+            return std::move(res.serialized);
+        epee::serialization::portable_storage ps;
+        res.store(ps);
+        release(std::move(res));
         std::string response;
-        epee::serialization::store_t_to_binary(res, response);
+        ps.store_to_binary(response);
         return response;
       }
     };
 
+    template <typename RPC, typename = void>
+    constexpr bool has_cacheable_check = false;
+    template <typename RPC>
+    constexpr bool has_cacheable_check<RPC, std::void_t<decltype(RPC::cacheable(std::declval<const typename RPC::request&>()))>> = true;
+
+    // Invokes a CACHEABLE command, returning the serialized response from the server's response
+    // cache if an identical request was answered in the same cache state.
+    template <typename RPC>
+    std::string invoke_cached(reg_helper<RPC>& helper, rpc_request&& request, core_rpc_server& server)
+    {
+      auto req = helper.load(request);
+      if constexpr (has_cacheable_check<RPC>)
+        if (!RPC::cacheable(req))
+          return helper.serialize(server.invoke(std::move(req), std::move(request.context)));
+
+      // The state has to be obtained *before* invoking so that we never cache a response under a
+      // newer state than the one it was computed from.
+      auto state = server.get_response_cache_state(
+          std::is_base_of_v<CACHE_MEMPOOL, RPC>, std::is_base_of_v<CACHE_SN_PROOFS, RPC>);
+      std::string key{RPC::names().front()};
+      key += '\0';
+      key += epee::serialization::store_t_to_binary(req);
+      if (auto cached = server.get_cached_response(key, state))
+        return std::move(*cached);
+
+      auto response = helper.serialize(server.invoke(std::move(req), std::move(request.context)));
+      server.cache_response(std::move(key), state, response);
+      return response;
+    }
+
     template <typename RPC, std::enable_if_t<std::is_base_of_v<RPC_COMMAND, RPC>, int> = 0>
     void register_rpc_command(std::unordered_map<std::string, std::shared_ptr<const rpc_command>>& regs)
     {
@@ -164,8 +234,15 @@ namespace cryptonote { namespace rpc {
       cmd->is_public = std::is_base_of_v<PUBLIC, RPC>;
       cmd->is_binary = std::is_base_of_v<BINARY, RPC>;
       cmd->is_legacy = std::is_base_of_v<LEGACY, RPC>;
+      cmd->is_heavy = std::is_base_of_v<HEAVY, RPC>;
+      cmd->name = RPC::names().front();
       cmd->invoke = [](rpc_request&& request, core_rpc_server& server) {
+        tools::trace::span<tools::trace::rpc> trace_span{RPC::names().front()};
         reg_helper<RPC> helper;
+        // Admin responses can include more, and are rare enough that they aren't worth caching
+        if constexpr (std::is_base_of_v<CACHEABLE, RPC>)
+          if (!request.context.admin)
+            return invoke_cached<RPC>(helper, std::move(request), server);
         Response res = server.invoke(helper.load(request), std::move(request.context));
         return helper.serialize(std::move(res));
       };
@@ -203,6 +280,12 @@ namespace cryptonote { namespace rpc {
     , ""
     };
 
+  const command_line::arg_descriptor<bool> core_rpc_server::arg_light_wallet_index = {
+      "light-wallet-index"
+    , "Serve the light wallet RPC calls (login, get_address_txs, get_unspent_outs, ...) by scanning new blocks for the accounts that light wallets register with their view keys"
+    , false
+    };
+
   std::optional<std::string_view> rpc_request::body_view() const {
     if (auto* sv = std::get_if<std::string_view>(&body)) return *sv;
     if (auto* s = std::get_if<std::string>(&body)) return *s;
@@ -214,6 +297,7 @@ namespace cryptonote { namespace rpc {
   {
     command_line::add_arg(desc, arg_bootstrap_daemon_address);
     command_line::add_arg(desc, arg_bootstrap_daemon_login);
+    command_line::add_arg(desc, arg_light_wallet_index);
     cryptonote::rpc_args::init_options(desc, hidden);
   }
   //------------------------------------------------------------------------------------------------------------------------------
@@ -439,6 +523,12 @@ namespace cryptonote { namespace rpc {
         res.bootstrap_daemon_address = m_bootstrap_daemon->address();
       }
       res.was_bootstrap_ever_used = m_was_bootstrap_ever_used;
+      auto cache_stats = m_core.get_blockchain_storage().get_block_cache_stats();
+      res.block_cache_hits = cache_stats.hits;
+      res.block_cache_misses = cache_stats.misses;
+      auto resize_stats = m_core.get_blockchain_storage().get_db().get_resize_stats();
+      res.database_resizes = resize_stats.count;
+      res.database_resize_time = resize_stats.total_ms;
     }
 
     res.offline = m_core.offline();
@@ -468,6 +558,15 @@ namespace cryptonote { namespace rpc {
       std::lock_guard lock{epee::net_utils::network_throttle_manager::m_lock_get_global_throttle_out};
       epee::net_utils::network_throttle_manager::get_global_throttle_out().get_stats(res.total_packets_out, res.total_bytes_out);
     }
+    auto fluffy = m_p2p.get_payload_object().get_fluffy_block_stats();
+    res.fluffy_blocks_received = fluffy.received;
+    res.fluffy_blocks_reconstructed = fluffy.reconstructed;
+    res.fluffy_blocks_missing_requests = fluffy.missing_requests;
+    res.fluffy_blocks_missing_txs = fluffy.missing_txs;
+    res.fluffy_blocks_prefilled_txs = fluffy.prefilled_txs;
+    res.fluffy_blocks_prefilled_used = fluffy.prefilled_used;
+    res.send_backlog_ms = epee::net_utils::connection_basic::get_usage_up().backlog.count();
+    res.recv_backlog_ms = epee::net_utils::connection_basic::get_usage_down().backlog.count();
     res.status = STATUS_OK;
     return res;
   }
@@ -483,6 +582,163 @@ namespace cryptonote { namespace rpc {
   };
   }
   //------------------------------------------------------------------------------------------------------------------------------
+  // How far below the top of the chain GET_BLOCKS_FAST serves (and caches) serialized blocks
+  constexpr uint64_t BLOCK_CACHE_DEPTH = 100;
+
+  namespace {
+  // The storage header that starts every binary-serialized value: an empty storage, less its (one
+  // byte) empty root section.
+  const std::string& binary_storage_header()
+  {
+    static const std::string header = [] {
+      std::string s;
+      epee::serialization::portable_storage{}.store_to_binary(s);
+      s.pop_back();
+      return s;
+    }();
+    return header;
+  }
+
+  // Binary-serializes `t` as a bare section: the bytes it takes up as an element of an array of
+  // sections within a larger value.
+  template <typename T>
+  std::string store_section_to_binary(T& t)
+  {
+    auto s = epee::serialization::store_t_to_binary(t);
+    s.erase(0, binary_storage_header().size());
+    return s;
+  }
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  std::shared_ptr<const core_rpc_server::serialized_block> core_rpc_server::serialize_block(uint64_t height, const crypto::hash& hash)
+  {
+    auto& db = m_core.get_blockchain_storage().get_db();
+    block_complete_entry entry{};
+    entry.block = db.get_block_blob_view_from_height(height);
+    block b;
+    if (!parse_and_validate_block_from_blob(entry.block, b))
+    {
+      MERROR("Failed to parse block at height " << height);
+      return nullptr;
+    }
+    std::vector<std::string_view> txs;
+    if (!b.tx_hashes.empty() && !db.get_pruned_tx_blob_views_from(b.tx_hashes.front(), b.tx_hashes.size(), txs))
+    {
+      MERROR("Failed to retrieve the transactions of block " << hash);
+      return nullptr;
+    }
+    entry.txs.reserve(txs.size());
+    for (auto& tx : txs)
+      entry.txs.emplace_back(tx);
+
+    std::vector<std::vector<uint64_t>> indices;
+    const size_t n_txes = 1 + b.tx_hashes.size();
+    if (!m_core.get_tx_outputs_gindexs(get_transaction_hash(b.miner_tx), n_txes, indices) || indices.size() != n_txes)
+    {
+      MERROR("Failed to retrieve the output indices of block " << hash);
+      return nullptr;
+    }
+    GET_BLOCKS_FAST::block_output_indices output_indices;
+    output_indices.indices.reserve(n_txes);
+    for (auto& i : indices)
+      output_indices.indices.push_back({std::move(i)});
+
+    auto result = std::make_shared<serialized_block>();
+    result->hash = hash;
+    result->entry = store_section_to_binary(entry);
+    result->indices = store_section_to_binary(output_indices);
+    output_indices.indices.front().indices.clear();
+    result->indices_no_miner = store_section_to_binary(output_indices);
+    return result;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::get_blocks_fast_from_cache(const GET_BLOCKS_FAST::request& req, GET_BLOCKS_FAST::response& res)
+  {
+    auto& blockchain = m_core.get_blockchain_storage();
+    auto& db = blockchain.get_db();
+    const uint64_t height = db.height();
+    uint64_t start_height;
+    if (req.start_height > 0)
+    {
+      if (req.start_height >= height)
+        return false;
+      start_height = req.start_height;
+    }
+    else if (!blockchain.find_blockchain_supplement(req.block_ids, start_height))
+      return false;
+    if (start_height >= height || height - start_height > BLOCK_CACHE_DEPTH)
+      return false;
+
+    std::vector<crypto::hash> hashes;
+    hashes.reserve(height - start_height);
+    for (uint64_t h = start_height; h < height; h++)
+      hashes.push_back(db.get_block_hash_from_height(h));
+
+    std::vector<std::shared_ptr<const serialized_block>> blocks(hashes.size());
+    {
+      std::lock_guard lock{m_block_cache_mutex};
+      // Drop blocks that are now too deep, and any left above the top by a reorg
+      m_block_cache.erase(m_block_cache.begin(), m_block_cache.lower_bound(height > BLOCK_CACHE_DEPTH ? height - BLOCK_CACHE_DEPTH : 0));
+      m_block_cache.erase(m_block_cache.lower_bound(height), m_block_cache.end());
+      for (size_t i = 0; i < blocks.size(); i++)
+        if (auto it = m_block_cache.find(start_height + i); it != m_block_cache.end() && it->second->hash == hashes[i])
+          blocks[i] = it->second;
+    }
+    bool added = false;
+    for (size_t i = 0; i < blocks.size(); i++)
+    {
+      if (blocks[i])
+        continue;
+      if (!(blocks[i] = serialize_block(start_height + i, hashes[i])))
+      {
+        res.status = "Failed";
+        return true;
+      }
+      added = true;
+    }
+    if (added)
+    {
+      std::lock_guard lock{m_block_cache_mutex};
+      for (size_t i = 0; i < blocks.size(); i++)
+        m_block_cache.insert_or_assign(start_height + i, blocks[i]);
+    }
+
+    // Write out exactly what epee would for the response struct: the root section's fields go in
+    // name order.
+    namespace ser = epee::serialization;
+    std::ostringstream out;
+    out << binary_storage_header();
+    ser::pack_varint(out, 6);
+    auto field = [&out](std::string_view name, uint8_t tag) {
+      out.put(static_cast<char>(name.size()));
+      out.write(name.data(), name.size());
+      out.put(static_cast<char>(tag));
+    };
+    auto sections = [&](std::string_view name, std::string serialized_block::* piece) {
+      field(name, ser::SERIALIZE_FLAG_ARRAY | ser::SERIALIZE_TYPE_TAG<ser::section>);
+      ser::pack_varint(out, blocks.size());
+      for (auto& b : blocks)
+        out.write((*b.*piece).data(), (*b.*piece).size());
+    };
+    sections("blocks", &serialized_block::entry);
+    field("current_height", ser::SERIALIZE_TYPE_TAG<uint64_t>);
+    ser::pack_entry_to_buff(out, height);
+    sections("output_indices", req.no_miner_tx ? &serialized_block::indices_no_miner : &serialized_block::indices);
+    field("start_height", ser::SERIALIZE_TYPE_TAG<uint64_t>);
+    ser::pack_entry_to_buff(out, start_height);
+    field("status", ser::SERIALIZE_TYPE_TAG<std::string>);
+    ser::pack_entry_to_buff(out, STATUS_OK);
+    field("untrusted", ser::SERIALIZE_TYPE_TAG<bool>);
+    ser::pack_entry_to_buff(out, false);
+
+    res.start_height = start_height;
+    res.current_height = height;
+    res.status = STATUS_OK;
+    res.serialized = out.str();
+    MDEBUG("on_get_blocks: " << blocks.size() << " cached blocks, size " << res.serialized.size());
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   GET_BLOCKS_FAST::response core_rpc_server::invoke(GET_BLOCKS_FAST::request&& req, rpc_context context)
   {
     GET_BLOCKS_FAST::response res{};
@@ -491,6 +747,14 @@ namespace cryptonote { namespace rpc {
     if (use_bootstrap_daemon_if_necessary<GET_BLOCKS_FAST>(req, res))
       return res;
 
+    // Hold one read snapshot for the whole request so that the blocks and the output indices we
+    // return are consistent even if a block gets added while we are building the response.
+    db_rtxn_guard rtxn_guard{m_core.get_blockchain_storage().get_db()};
+
+    // Wallets keeping up with the chain ask for the same few pruned blocks over and over
+    if (req.prune && get_blocks_fast_from_cache(req, res))
+      return res;
+
     std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata> > > > bs;
 
     if(!m_core.find_blockchain_supplement(req.start_height, req.block_ids, bs, res.current_height, res.start_height, req.prune, !req.no_miner_tx, GET_BLOCKS_FAST::MAX_COUNT))
@@ -505,8 +769,8 @@ namespace cryptonote { namespace rpc {
     for(auto& bd: bs)
     {
       res.blocks.resize(res.blocks.size()+1);
-      res.blocks.back().block = bd.first.first;
       size += bd.first.first.size();
+      res.blocks.back().block = std::move(bd.first.first);
       res.output_indices.push_back(GET_BLOCKS_FAST::block_output_indices());
       ntxes += bd.second.size();
       res.output_indices.back().indices.reserve(1 + bd.second.size());
@@ -540,6 +804,121 @@ namespace cryptonote { namespace rpc {
     res.status = STATUS_OK;
     return res;
   }
+  //------------------------------------------------------------------------------------------------------------------------------
+  GET_BLOCKS_SCAN_BIN::response core_rpc_server::invoke(GET_BLOCKS_SCAN_BIN::request&& req, rpc_context context)
+  {
+    GET_BLOCKS_SCAN_BIN::response res{};
+
+    PERF_TIMER(on_get_blocks_scan);
+    if (use_bootstrap_daemon_if_necessary<GET_BLOCKS_SCAN_BIN>(req, res))
+      return res;
+
+    auto& db = m_core.get_blockchain_storage().get_db();
+    db_rtxn_guard rtxn_guard{db};
+    res.current_height = db.height();
+    res.start_height = req.start_height;
+    const uint64_t count = req.count == 0 ? GET_BLOCKS_SCAN_BIN::MAX_COUNT : std::min<uint64_t>(req.count, GET_BLOCKS_SCAN_BIN::MAX_COUNT);
+    const uint64_t end_height = std::min(res.current_height, req.start_height + count);
+
+    auto add_tx = [&res](const transaction& tx, const crypto::hash& hash, const std::vector<uint64_t>& global_indices) {
+      res.tx_hashes.push_back(hash);
+      res.tx_types.push_back(static_cast<uint16_t>(tx.type));
+      res.tx_unlock_times.push_back(tx.unlock_time);
+
+      std::vector<tx_extra_field> fields;
+      parse_tx_extra(tx.extra, fields); // A partial parse still gives us whatever fields precede any garbage
+      tx_extra_pub_key pub_key;
+      res.tx_pubkeys.push_back(find_tx_extra_field_by_type(fields, pub_key) ? pub_key.pub_key : crypto::null_pkey);
+      tx_extra_nonce nonce;
+      crypto::hash8 payment_id = crypto::null_hash8;
+      if (find_tx_extra_field_by_type(fields, nonce) && !get_encrypted_payment_id_from_tx_extra_nonce(nonce.nonce, payment_id))
+        payment_id = crypto::null_hash8;
+      res.tx_payment_ids.push_back(payment_id);
+      tx_extra_additional_pub_keys additional;
+      if (!find_tx_extra_field_by_type(fields, additional))
+        additional.data.clear();
+      res.tx_additional_pubkey_counts.push_back(additional.data.size());
+      res.additional_pubkeys.insert(res.additional_pubkeys.end(), additional.data.begin(), additional.data.end());
+
+      const bool rct = tx.version >= txversion::v2_ringct && tx.rct_signatures.type != rct::RCTType::Null;
+      res.tx_output_counts.push_back(tx.vout.size());
+      for (size_t i = 0; i < tx.vout.size(); i++)
+      {
+        auto* to_key = std::get_if<txout_to_key>(&tx.vout[i].target);
+        res.output_keys.push_back(to_key ? to_key->key : crypto::null_pkey);
+        res.output_amounts.push_back(tx.vout[i].amount);
+        crypto::hash8 encrypted_amount = crypto::null_hash8;
+        crypto::public_key commitment = crypto::null_pkey;
+        if (rct && i < tx.rct_signatures.ecdhInfo.size() && i < tx.rct_signatures.outPk.size())
+        {
+          std::memcpy(encrypted_amount.data, tx.rct_signatures.ecdhInfo[i].amount.bytes, sizeof(encrypted_amount.data));
+          commitment = rct::rct2pk(tx.rct_signatures.outPk[i].mask);
+        }
+        res.output_encrypted_amounts.push_back(encrypted_amount);
+        res.output_commitments.push_back(commitment);
+        res.output_unlock_times.push_back(tx.get_unlock_time(i));
+        res.output_global_indices.push_back(i < global_indices.size() ? global_indices[i] : 0);
+      }
+
+      uint32_t key_images = 0;
+      for (const auto& in : tx.vin)
+      {
+        if (auto* to_key = std::get_if<txin_to_key>(&in))
+        {
+          res.key_images.push_back(to_key->k_image);
+          key_images++;
+        }
+      }
+      res.tx_key_image_counts.push_back(key_images);
+    };
+
+    // Only the transaction prefixes and RingCT bases are needed, so we use the pruned blobs and
+    // parse just that part, skipping the signatures and range proofs.
+    std::vector<std::string_view> tx_blobs;
+    std::vector<std::vector<uint64_t>> indices;
+    for (uint64_t height = req.start_height; height < end_height; height++)
+    {
+      block blk;
+      if (!parse_and_validate_block_from_blob(db.get_block_blob_view_from_height(height), blk))
+      {
+        res.status = "Failed to parse block at height " + std::to_string(height);
+        return res;
+      }
+      res.block_hashes.push_back(db.get_block_hash_from_height(height));
+      res.block_timestamps.push_back(blk.timestamp);
+      res.block_tx_counts.push_back(1 + blk.tx_hashes.size());
+
+      tx_blobs.clear();
+      if (!blk.tx_hashes.empty() && !db.get_pruned_tx_blob_views_from(blk.tx_hashes.front(), blk.tx_hashes.size(), tx_blobs))
+      {
+        res.status = "Failed to retrieve transactions of block at height " + std::to_string(height);
+        return res;
+      }
+      const crypto::hash miner_tx_hash = get_transaction_hash(blk.miner_tx);
+      if (!m_core.get_tx_outputs_gindexs(miner_tx_hash, 1 + blk.tx_hashes.size(), indices))
+      {
+        res.status = "Failed to retrieve output indices of block at height " + std::to_string(height);
+        return res;
+      }
+
+      add_tx(blk.miner_tx, miner_tx_hash, indices[0]);
+      for (size_t i = 0; i < tx_blobs.size(); i++)
+      {
+        transaction tx;
+        if (!parse_and_validate_tx_base_from_blob(tx_blobs[i], tx))
+        {
+          res.status = "Failed to parse transaction " + tools::type_to_hex(blk.tx_hashes[i]);
+          return res;
+        }
+        add_tx(tx, blk.tx_hashes[i], indices[i + 1]);
+      }
+    }
+
+    MDEBUG("on_get_blocks_scan: " << res.block_hashes.size() << " blocks, " << res.tx_hashes.size() << " txes, " << res.output_keys.size() << " outputs");
+    res.status = STATUS_OK;
+    return res;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   GET_ALT_BLOCKS_HASHES::response core_rpc_server::invoke(GET_ALT_BLOCKS_HASHES::request&& req, rpc_context context)
   {
     GET_ALT_BLOCKS_HASHES::response res{};
@@ -630,6 +1009,7 @@ namespace cryptonote { namespace rpc {
     if (use_bootstrap_daemon_if_necessary<GET_OUTPUTS_BIN>(req, res))
       return res;
 
+    db_rtxn_guard rtxn_guard{m_core.get_blockchain_storage().get_db()};
     if (!context.admin && req.outputs.size() > GET_OUTPUTS_BIN::MAX_COUNT)
       res.status = "Too many outs requested";
     else if (m_core.get_outs(req, res))
@@ -854,6 +1234,7 @@ namespace cryptonote { namespace rpc {
         return res;
       }
     }
+    db_rtxn_guard rtxn_guard{m_core.get_blockchain_storage().get_db()};
     std::vector<crypto::hash> missed_txs;
     std::vector<std::tuple<crypto::hash, cryptonote::blobdata, crypto::hash, cryptonote::blobdata>> txs;
     bool r = m_core.get_split_transactions_blobs(vh, txs, missed_txs);
@@ -867,65 +1248,56 @@ namespace cryptonote { namespace rpc {
     // try the pool for any missing txes
     auto &pool = m_core.get_pool();
     size_t found_in_pool = 0;
-    std::unordered_map<crypto::hash, tx_info> per_tx_pool_tx_info;
+    std::unordered_map<crypto::hash, txpool_tx_meta_t> per_tx_pool_tx_info;
     if (!missed_txs.empty())
     {
-      std::vector<tx_info> pool_tx_info;
-      std::vector<spent_key_image_info> pool_key_image_info;
-      bool r = pool.get_transactions_and_spent_keys_info(pool_tx_info, pool_key_image_info, nullptr, context.admin);
-      if(r)
+      // sort to match original request
+      std::vector<std::tuple<crypto::hash, cryptonote::blobdata, crypto::hash, cryptonote::blobdata>> sorted_txs;
+      unsigned txs_processed = 0;
+      for (const crypto::hash &h: vh)
       {
-        // sort to match original request
-        std::vector<std::tuple<crypto::hash, cryptonote::blobdata, crypto::hash, cryptonote::blobdata>> sorted_txs;
-        unsigned txs_processed = 0;
-        for (const crypto::hash &h: vh)
+        auto missed_it = std::find(missed_txs.begin(), missed_txs.end(), h);
+        if (missed_it == missed_txs.end())
         {
-          auto missed_it = std::find(missed_txs.begin(), missed_txs.end(), h);
-          if (missed_it == missed_txs.end())
+          if (txs.size() == txs_processed)
           {
-            if (txs.size() == txs_processed)
-            {
-              res.status = "Failed: internal error - txs is empty";
-              return res;
-            }
-            // core returns the ones it finds in the right order
-            if (std::get<0>(txs[txs_processed]) != h)
-            {
-              res.status = "Failed: tx hash mismatch";
-              return res;
-            }
-            sorted_txs.push_back(std::move(txs[txs_processed]));
-            ++txs_processed;
-            continue;
+            res.status = "Failed: internal error - txs is empty";
+            return res;
           }
-          const std::string hash_string = tools::type_to_hex(h);
-          auto ptx_it = std::find_if(pool_tx_info.begin(), pool_tx_info.end(),
-              [&hash_string](const tx_info &txi) { return hash_string == txi.id_hash; });
-          if (ptx_it != pool_tx_info.end())
+          // core returns the ones it finds in the right order
+          if (std::get<0>(txs[txs_processed]) != h)
           {
-            cryptonote::transaction tx;
-            if (!cryptonote::parse_and_validate_tx_from_blob(ptx_it->tx_blob, tx))
-            {
-              res.status = "Failed to parse and validate tx from blob";
-              return res;
-            }
-            serialization::binary_string_archiver ba;
-            try {
-              tx.serialize_base(ba);
-            } catch (const std::exception& e) {
-              res.status = "Failed to serialize transaction base: "s + e.what();
-              return res;
-            }
-            std::string pruned = ba.str();
-            std::string pruned2{ptx_it->tx_blob, pruned.size()};
-            sorted_txs.emplace_back(h, std::move(pruned), get_transaction_prunable_hash(tx), std::move(pruned2));
-            missed_txs.erase(missed_it);
-            per_tx_pool_tx_info.emplace(h, *ptx_it);
-            ++found_in_pool;
+            res.status = "Failed: tx hash mismatch";
+            return res;
           }
+          sorted_txs.push_back(std::move(txs[txs_processed]));
+          ++txs_processed;
+          continue;
+        }
+        cryptonote::blobdata tx_blob;
+        txpool_tx_meta_t meta;
+        // Unrelayed txes are only visible to admin requests
+        if (pool.get_transaction(h, tx_blob, &meta) && (context.admin || meta.relayed))
+        {
+          // Only the split and the prunable hash are needed, so don't parse the signatures
+          crypto::hash prunable_hash;
+          std::string pruned, prunable;
+          try {
+            cryptonote::transaction_view tx{tx_blob};
+            prunable_hash = tx.prunable_hash();
+            pruned = tx.pruned_blob();
+            prunable = tx.prunable_blob();
+          } catch (const std::exception& e) {
+            res.status = "Failed to parse tx from blob: "s + e.what();
+            return res;
+          }
+          sorted_txs.emplace_back(h, std::move(pruned), prunable_hash, std::move(prunable));
+          missed_txs.erase(missed_it);
+          per_tx_pool_tx_info.emplace(h, meta);
+          ++found_in_pool;
         }
-        txs = sorted_txs;
       }
+      txs = sorted_txs;
       LOG_PRINT_L2("Found " << found_in_pool << "/" << vh.size() << " transactions in the pool");
     }
 
@@ -1011,7 +1383,8 @@ namespace cryptonote { namespace rpc {
         e.block_height = e.block_timestamp = std::numeric_limits<uint64_t>::max();
         e.double_spend_seen = ptx_it->second.double_spend_seen;
         e.relayed = ptx_it->second.relayed;
-        e.received_timestamp = ptx_it->second.receive_time;
+        // In restricted mode we do not include this data:
+        e.received_timestamp = context.admin ? ptx_it->second.receive_time : 0;
       }
       else
       {
@@ -1090,36 +1463,11 @@ namespace cryptonote { namespace rpc {
       res.spent_status.push_back(spent_status[n] ? IS_KEY_IMAGE_SPENT::SPENT_IN_BLOCKCHAIN : IS_KEY_IMAGE_SPENT::UNSPENT);
 
     // check the pool too
-    std::vector<tx_info> txs;
-    std::vector<spent_key_image_info> ki;
-    r = m_core.get_pool().get_transactions_and_spent_keys_info(txs, ki, nullptr, context.admin);
-    if(!r)
-    {
-      res.status = "Failed";
-      return res;
-    }
-    for (std::vector<spent_key_image_info>::const_iterator i = ki.begin(); i != ki.end(); ++i)
-    {
-      crypto::hash hash;
-      crypto::key_image spent_key_image;
-      if (tools::hex_to_type(i->id_hash, hash))
-      {
-        memcpy(&spent_key_image, &hash, sizeof(hash)); // a bit dodgy, should be other parse functions somewhere
-        for (size_t n = 0; n < res.spent_status.size(); ++n)
-        {
-          if (res.spent_status[n] == IS_KEY_IMAGE_SPENT::UNSPENT)
-          {
-            if (key_images[n] == spent_key_image)
-            {
-              res.spent_status[n] = IS_KEY_IMAGE_SPENT::SPENT_IN_POOL;
-              break;
-            }
-          }
-        }
-      }
-      else
-        MERROR("Invalid hash: " << i->id_hash);
-    }
+    std::vector<bool> pool_spent_status;
+    m_core.get_pool().check_for_key_images(key_images, pool_spent_status, context.admin);
+    for (size_t n = 0; n < res.spent_status.size(); ++n)
+      if (res.spent_status[n] == IS_KEY_IMAGE_SPENT::UNSPENT && pool_spent_status[n])
+        res.spent_status[n] = IS_KEY_IMAGE_SPENT::SPENT_IN_POOL;
 
     res.status = STATUS_OK;
     return res;
@@ -1496,9 +1844,12 @@ namespace cryptonote { namespace rpc {
       return res;
 
     std::vector<crypto::hash> tx_pool_hashes;
-    m_core.get_pool().get_transaction_hashes(tx_pool_hashes, context.admin, req.blinked_txs_only);
+    const bool include_blinked = req.include_blinked && !req.blinked_txs_only;
+    m_core.get_pool().get_transaction_hashes(tx_pool_hashes, context.admin, req.blinked_txs_only,
+        include_blinked ? &res.blinked_tx_hashes : nullptr);
 
     res.tx_hashes = std::move(tx_pool_hashes);
+    res.blinked_included = include_blinked;
     res.status    = STATUS_OK;
     return res;
   }
@@ -1570,7 +1921,7 @@ namespace cryptonote { namespace rpc {
 
     try
     {
-      m_core.get_output_blacklist(res.blacklist);
+      res.total = m_core.get_output_blacklist(res.blacklist, req.after);
     }
     catch (const std::exception &e)
     {
@@ -1848,9 +2199,32 @@ namespace cryptonote { namespace rpc {
     }
   }
 
+  void core_rpc_server::fill_block_header_response(const block_header_info& header, difficulty_type difficulty, block_header_response& response)
+  {
+    PERF_TIMER(fill_block_header_response);
+    response.major_version = header.major_version;
+    response.minor_version = header.minor_version;
+    response.timestamp = header.timestamp;
+    response.prev_hash = tools::type_to_hex(header.prev_id);
+    response.nonce = header.nonce;
+    response.orphan_status = false;
+    response.height = header.height;
+    response.depth = m_core.get_current_blockchain_height() - header.height - 1;
+    response.hash = tools::type_to_hex(header.hash);
+    response.difficulty = difficulty;
+    response.cumulative_difficulty = header.cumulative_difficulty;
+    response.reward = header.reward;
+    response.miner_reward = header.miner_reward;
+    response.block_size = response.block_weight = header.weight;
+    response.num_txes = header.num_txes;
+    response.long_term_weight = header.long_term_weight;
+    response.miner_tx_hash = tools::type_to_hex(header.miner_tx_hash);
+    response.service_node_winner = tools::type_to_hex(header.service_node_winner);
+  }
+
   /// All the common (untemplated) code for use_bootstrap_daemon_if_necessary.  Returns a held lock
   /// if we need to bootstrap, an unheld one if we don't.
-  std::unique_lock<std::shared_mutex> core_rpc_server::should_bootstrap_lock()
+  std::shared_lock<std::shared_mutex> core_rpc_server::should_bootstrap_lock()
   {
     // TODO - support bootstrapping via a remote LMQ RPC; requires some argument fiddling
 
@@ -1859,10 +2233,7 @@ namespace cryptonote { namespace rpc {
 
     std::unique_lock lock{m_bootstrap_daemon_mutex};
     if (!m_bootstrap_daemon)
-    {
-      lock.unlock();
-      return lock;
-    }
+      return {};
 
     auto current_time = std::chrono::system_clock::now();
     if (!m_p2p.get_payload_object().no_sync() &&
@@ -1874,17 +2245,15 @@ namespace cryptonote { namespace rpc {
       if (!bootstrap_daemon_height)
       {
         MERROR("Failed to fetch bootstrap daemon height");
-        lock.unlock();
-        return lock;
+        return {};
       }
 
       uint64_t target_height = m_core.get_target_blockchain_height();
       if (bootstrap_daemon_height < target_height)
       {
         MINFO("Bootstrap daemon is out of sync");
-        lock.unlock();
         m_bootstrap_daemon->set_failed();
-        return lock;
+        return {};
       }
 
       uint64_t top_height           = m_core.get_current_blockchain_height();
@@ -1895,10 +2264,15 @@ namespace cryptonote { namespace rpc {
     if (!m_should_use_bootstrap_daemon)
     {
       MINFO("The local daemon is fully synced; disabling bootstrap daemon requests");
-      lock.unlock();
+      return {};
     }
 
-    return lock;
+    // The requests themselves only need m_bootstrap_daemon to stay put, so can run in parallel
+    lock.unlock();
+    std::shared_lock shared_lock{m_bootstrap_daemon_mutex};
+    if (!m_bootstrap_daemon) // Removed while we weren't holding the lock
+      return {};
+    return shared_lock;
   }
 
   //------------------------------------------------------------------------------------------------------------------------------
@@ -1926,6 +2300,67 @@ namespace cryptonote { namespace rpc {
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
+  // Cached responses can include time-dependent values (such as GET_INFO's target height or
+  // service node reachability), so they are also only reused for this long.
+  constexpr std::chrono::seconds RPC_RESPONSE_CACHE_LIFETIME{5};
+  // Limit on the total size of cached responses; anything bigger than a quarter of this isn't cached.
+  constexpr size_t RPC_RESPONSE_CACHE_MAX_BYTES = 64 * 1024 * 1024;
+
+  core_rpc_server::response_cache_state core_rpc_server::get_response_cache_state(bool mempool, bool proofs)
+  {
+    response_cache_state state{};
+    uint64_t height;
+    m_core.get_blockchain_top(height, state.top_hash);
+    if (mempool)
+      state.pool_cookie = m_core.get_pool().cookie();
+    if (proofs)
+      state.proofs_version = m_core.get_service_node_list().proofs_version();
+    return state;
+  }
+
+  std::optional<std::string> core_rpc_server::get_cached_response(const std::string& key, const response_cache_state& state)
+  {
+    std::lock_guard lock{m_response_cache_mutex};
+    auto it = m_response_cache.find(key);
+    if (it == m_response_cache.end() || !(it->second.state == state) ||
+        std::chrono::steady_clock::now() - it->second.created >= RPC_RESPONSE_CACHE_LIFETIME)
+      return std::nullopt;
+    return it->second.response;
+  }
+
+  void core_rpc_server::cache_response(std::string key, const response_cache_state& state, const std::string& response)
+  {
+    if (response.size() > RPC_RESPONSE_CACHE_MAX_BYTES / 4)
+      return;
+
+    std::lock_guard lock{m_response_cache_mutex};
+    if (state.top_hash != m_response_cache_top_hash)
+    {
+      // Every response key includes the top block, so nothing cached for a different one is any
+      // use (and if `state` is the one that's out of date the next request will just replace it).
+      m_response_cache.clear();
+      m_response_cache_bytes = 0;
+      m_response_cache_top_hash = state.top_hash;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (auto it = m_response_cache.find(key); it != m_response_cache.end())
+    {
+      m_response_cache_bytes -= it->second.response.size();
+      m_response_cache.erase(it);
+    }
+    while (!m_response_cache.empty() && m_response_cache_bytes + response.size() > RPC_RESPONSE_CACHE_MAX_BYTES)
+    {
+      auto oldest = std::min_element(m_response_cache.begin(), m_response_cache.end(),
+          [](const auto& a, const auto& b) { return a.second.created < b.second.created; });
+      m_response_cache_bytes -= oldest->second.response.size();
+      m_response_cache.erase(oldest);
+    }
+
+    m_response_cache_bytes += response.size();
+    m_response_cache.emplace(std::move(key), cached_response{state, now, response});
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   GET_LAST_BLOCK_HEADER::response core_rpc_server::invoke(GET_LAST_BLOCK_HEADER::request&& req, rpc_context context)
   {
     GET_LAST_BLOCK_HEADER::response res{};
@@ -1992,7 +2427,22 @@ namespace cryptonote { namespace rpc {
     const uint64_t bc_height = m_core.get_current_blockchain_height();
     if (req.start_height >= bc_height || req.end_height >= bc_height || req.start_height > req.end_height)
       throw rpc_error{ERROR_TOO_BIG_HEIGHT, "Invalid start/end heights."};
-    for (uint64_t h = req.start_height; h <= req.end_height; ++h)
+    uint64_t h = req.start_height;
+    // The PoW and tx hashes need the whole block, but otherwise the stored header info will do
+    if (!(req.fill_pow_hash && context.admin) && !req.get_tx_hashes)
+    {
+      auto& db = m_core.get_blockchain_storage().get_db();
+      auto headers = db.get_block_headers(h, req.end_height - h + 1);
+      difficulty_type prev_cumulative = h > 0 && !headers.empty() ? db.get_block_cumulative_difficulty(h - 1) : 0;
+      res.headers.reserve(req.end_height - h + 1);
+      for (const auto& header : headers)
+      {
+        fill_block_header_response(header, header.cumulative_difficulty - prev_cumulative, res.headers.emplace_back());
+        prev_cumulative = header.cumulative_difficulty;
+      }
+      h += headers.size();
+    }
+    for (; h <= req.end_height; ++h)
     {
       block blk;
       bool have_block = m_core.get_block_by_height(h, blk);
@@ -2024,6 +2474,15 @@ namespace cryptonote { namespace rpc {
       if (height >= curr_height)
         throw rpc_error{ERROR_TOO_BIG_HEIGHT,
           "Requested block height: " + std::to_string(height) + " greater than current top block height: " +  std::to_string(curr_height - 1)};
+      if (!pow && !tx_hashes)
+      {
+        auto& db = m_core.get_blockchain_storage().get_db();
+        if (auto headers = db.get_block_headers(height, 1); !headers.empty())
+        {
+          fill_block_header_response(headers[0], m_core.get_blockchain_storage().block_difficulty(height), bhr);
+          return;
+        }
+      }
       block blk;
       bool have_block = m_core.get_block_by_height(height, blk);
       if (!have_block)
@@ -2238,12 +2697,7 @@ namespace cryptonote { namespace rpc {
     std::vector<crypto::hash> txids;
     if (req.txids.empty())
     {
-      std::vector<transaction> pool_txs;
-      m_core.get_pool().get_transactions(pool_txs);
-      for (const auto &tx: pool_txs)
-      {
-        txids.push_back(cryptonote::get_transaction_hash(tx));
-      }
+      m_core.get_pool().get_transaction_hashes(txids);
     }
     else
     {
@@ -2368,12 +2822,8 @@ namespace cryptonote { namespace rpc {
     GET_COINBASE_TX_SUM::response res{};
 
     PERF_TIMER(on_get_coinbase_tx_sum);
-    if (auto sums = m_core.get_coinbase_tx_sum(req.height, req.count)) {
-        std::tie(res.emission_amount, res.fee_amount, res.burn_amount) = *sums;
-        res.status = STATUS_OK;
-    } else {
-        res.status = STATUS_BUSY; // some other request is already calculating it
-    }
+    std::tie(res.emission_amount, res.fee_amount, res.burn_amount) = m_core.get_coinbase_tx_sum(req.height, req.count);
+    res.status = STATUS_OK;
     return res;
   }
   //------------------------------------------------------------------------------------------------------------------------------
@@ -2607,6 +3057,8 @@ namespace cryptonote { namespace rpc {
       return {std::move(distribution), start_height, base};
     }
 
+    // Repeated identical GET_OUTPUT_DISTRIBUTION requests are answered from the RPC response cache;
+    // this cache holds on to the last distribution so that it can also be extended for new blocks.
     static struct {
       std::mutex mutex;
       std::vector<std::uint64_t> cached_distribution;
@@ -3138,6 +3590,57 @@ namespace cryptonote { namespace rpc {
 
   }
 
+  // The reachability flags in an entry are relative to the time it was built, so even without any
+  // changes a cached list is only reused for this long.
+  constexpr std::chrono::seconds SN_RESPONSE_CACHE_LIFETIME{10};
+
+  std::shared_ptr<const std::vector<GET_SERVICE_NODES::response::entry>> core_rpc_server::get_all_sn_response_entries(uint64_t height, const crypto::hash &block_hash)
+  {
+    auto &sn_list = m_core.get_service_node_list();
+    uint64_t const proofs_version = sn_list.proofs_version();
+    auto now = std::chrono::steady_clock::now();
+    {
+      std::lock_guard lock{m_sn_response_cache_mutex};
+      auto &cache = m_sn_response_cache;
+      if (cache.entries && cache.block_hash == block_hash && cache.proofs_version == proofs_version && now - cache.created < SN_RESPONSE_CACHE_LIFETIME)
+        return cache.entries;
+    }
+
+    auto sn_infos = m_core.get_service_node_list_state();
+    auto entries = std::make_shared<std::vector<GET_SERVICE_NODES::response::entry>>(sn_infos.size());
+    for (size_t i = 0; i < sn_infos.size(); i++)
+      fill_sn_response_entry((*entries)[i], sn_infos[i], height);
+
+    std::lock_guard lock{m_sn_response_cache_mutex};
+    m_sn_response_cache = {block_hash, proofs_version, now, entries};
+    return entries;
+  }
+
+  // Moves `limit` randomly selected elements, in random order, to the front of `v` and drops the rest
+  template <typename T>
+  static void select_random_subset(std::vector<T> &v, size_t limit)
+  {
+    limit = std::min(v.size(), limit);
+
+    // We need to select N random elements, in random order, from yyyyyyyy.  We could (and used
+    // to) just shuffle the entire list and return the first N, but that is quite inefficient when
+    // the list is large and N is small.  So instead this algorithm is going to select a random
+    // element from yyyyyyyy, swap it to position 0, so we get: [x]yyyyyyyy where one of the new
+    // y's used to be at element 0.  Then we select a random element from the new y's (i.e. all
+    // the elements beginning at position 1), and swap it into element 1, to get [xx]yyyyyy, then
+    // keep repeating until our set of x's is big enough, say [xxx]yyyyy.  At that point we chop
+    // of the y's to just be left with [xxx], and only required N swaps in total.
+    for (size_t i = 0; i < limit; i++)
+    {
+      size_t j = std::uniform_int_distribution<size_t>{i, v.size()-1}(tools::rng);
+      using std::swap;
+      if (i != j)
+        swap(v[i], v[j]);
+    }
+
+    v.resize(limit);
+  }
+
   static constexpr GET_SERVICE_NODES::requested_fields_t all_fields{true};
   //------------------------------------------------------------------------------------------------------------------------------
   GET_SERVICE_NODES::response core_rpc_server::invoke(GET_SERVICE_NODES::request&& req, rpc_context context)
@@ -3147,7 +3650,8 @@ namespace cryptonote { namespace rpc {
     res.status = STATUS_OK;
     res.height = m_core.get_current_blockchain_height() - 1;
     res.target_height = m_core.get_target_blockchain_height();
-    res.block_hash = tools::type_to_hex(m_core.get_block_id_by_height(res.height));
+    crypto::hash const block_hash = m_core.get_block_id_by_height(res.height);
+    res.block_hash = tools::type_to_hex(block_hash);
     auto [hf, snode_rev] = get_network_version_revision(nettype(), res.height);
     res.hardfork = hf;
     res.snode_revision = snode_rev;
@@ -3170,6 +3674,26 @@ namespace cryptonote { namespace rpc {
             + " which is pubkey: " + req.service_node_pubkeys[i]};
     }
 
+    res.fields = req.fields.value_or(all_fields);
+
+    if (pubkeys.empty() && !req.include_json)
+    {
+      auto entries = get_all_sn_response_entries(res.height, block_hash);
+
+      std::vector<const GET_SERVICE_NODES::response::entry*> selected;
+      selected.reserve(entries->size());
+      for (auto &entry : *entries)
+        if (!req.active_only || entry.active)
+          selected.push_back(&entry);
+      if (req.limit != 0)
+        select_random_subset(selected, req.limit);
+
+      res.service_node_states.reserve(selected.size());
+      for (auto *entry : selected)
+        res.service_node_states.push_back(*entry);
+      return res;
+    }
+
     auto sn_infos = m_core.get_service_node_list_state(pubkeys);
 
     if (req.active_only) {
@@ -3181,31 +3705,10 @@ namespace cryptonote { namespace rpc {
       sn_infos.erase(end, sn_infos.end());
     }
 
-    if (req.limit != 0) {
-
-      const auto limit = std::min(sn_infos.size(), static_cast<size_t>(req.limit));
-
-      // We need to select N random elements, in random order, from yyyyyyyy.  We could (and used
-      // to) just shuffle the entire list and return the first N, but that is quite inefficient when
-      // the list is large and N is small.  So instead this algorithm is going to select a random
-      // element from yyyyyyyy, swap it to position 0, so we get: [x]yyyyyyyy where one of the new
-      // y's used to be at element 0.  Then we select a random element from the new y's (i.e. all
-      // the elements beginning at position 1), and swap it into element 1, to get [xx]yyyyyy, then
-      // keep repeating until our set of x's is big enough, say [xxx]yyyyy.  At that point we chop
-      // of the y's to just be left with [xxx], and only required N swaps in total.
-      for (size_t i = 0; i < limit; i++)
-      {
-        size_t j = std::uniform_int_distribution<size_t>{i, sn_infos.size()-1}(tools::rng);
-        using std::swap;
-        if (i != j)
-          swap(sn_infos[i], sn_infos[j]);
-      }
-
-      sn_infos.resize(limit);
-    }
+    if (req.limit != 0)
+      select_random_subset(sn_infos, req.limit);
 
     res.service_node_states.reserve(sn_infos.size());
-    res.fields = req.fields.value_or(all_fields);
 
     if (req.include_json)
     {
@@ -3391,8 +3894,9 @@ namespace cryptonote { namespace rpc {
       const uint8_t hard_fork_version = block.second.major_version;
       for (const auto& blob : blobs)
       {
-        cryptonote::transaction tx;
-        if (!cryptonote::parse_and_validate_tx_from_blob(blob, tx))
+        // Only the prefix (type and extra) is needed
+        cryptonote::transaction_prefix tx;
+        if (!cryptonote::parse_and_validate_tx_prefix_from_blob(blob, tx))
         {
           MERROR("tx could not be validated from blob, possibly corrupt blockchain");
           continue;
@@ -3464,6 +3968,256 @@ namespace cryptonote { namespace rpc {
     return res;
   }
   //------------------------------------------------------------------------------------------------------------------------------
+  GET_PULSE_STATS::response core_rpc_server::invoke(GET_PULSE_STATS::request&& req, rpc_context context)
+  {
+    GET_PULSE_STATS::response res{};
+
+    auto const &buckets = GET_PULSE_STATS::BUCKETS_MS;
+    auto add_to_histogram = [&buckets](std::vector<uint64_t> &histogram, std::chrono::milliseconds value) {
+      if (histogram.empty())
+        histogram.resize(buckets.size() + 1);
+      histogram[std::upper_bound(buckets.begin(), buckets.end(), static_cast<uint64_t>(value.count())) - buckets.begin()]++;
+    };
+
+    std::vector<pulse::round_stats> rounds = pulse::recent_rounds();
+    std::map<pulse::message_type, GET_PULSE_STATS::stage> stages;
+    std::unordered_map<crypto::public_key, GET_PULSE_STATS::validator> validators;
+    std::map<std::string, uint64_t> failures;
+    for (auto const &round : rounds)
+    {
+      // The first arrival of each message type in the round, which the others are measured against
+      std::map<pulse::message_type, std::chrono::milliseconds> first;
+      for (auto const &arrival : round.arrivals)
+        if (auto [it, inserted] = first.emplace(arrival.type, arrival.latency); !inserted)
+          it->second = std::min(it->second, arrival.latency);
+
+      for (auto const &arrival : round.arrivals)
+      {
+        add_to_histogram(stages[arrival.type].histogram, arrival.latency);
+        auto &validator = validators[arrival.sender];
+        validator.messages++;
+        add_to_histogram(validator.histogram, arrival.latency - first[arrival.type]);
+      }
+
+      if (!round.failure.empty())
+        failures[round.failure]++;
+
+      if (req.include_rounds)
+      {
+        auto &entry     = res.recent_rounds.emplace_back();
+        entry.height    = round.height;
+        entry.round     = round.round;
+        entry.node_name = round.node_name;
+        entry.failure   = round.failure;
+        for (auto const &arrival : round.arrivals)
+          entry.arrivals.push_back({std::string{pulse::message_type_string(arrival.type)}, tools::type_to_hex(arrival.sender), static_cast<uint64_t>(arrival.latency.count())});
+      }
+    }
+
+    res.buckets_ms.assign(buckets.begin(), buckets.end());
+    res.rounds = rounds.size();
+    for (auto &[type, stage] : stages)
+    {
+      stage.type = pulse::message_type_string(type);
+      res.stages.push_back(std::move(stage));
+    }
+    for (auto &[pubkey, validator] : validators)
+    {
+      validator.pubkey = tools::type_to_hex(pubkey);
+      res.validators.push_back(std::move(validator));
+    }
+    for (auto &[reason, count] : failures)
+      res.failures.push_back({reason, count});
+
+    res.status = STATUS_OK;
+    return res;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  void core_rpc_server::record_rpc_call(
+      const rpc_command& call,
+      bool success,
+      std::chrono::steady_clock::duration duration,
+      std::optional<std::chrono::steady_clock::duration> queue_wait,
+      size_t request_bytes,
+      size_t response_bytes)
+  {
+    auto const &buckets = GET_RPC_STATS::BUCKETS_MS;
+    auto const bucket = std::upper_bound(buckets.begin(), buckets.end(),
+        static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(duration).count())) - buckets.begin();
+
+    std::lock_guard lock{m_rpc_stats_mutex};
+    auto &stats = m_rpc_stats[call.name];
+    stats.calls++;
+    if (!success)
+      stats.errors++;
+    stats.histogram[bucket]++;
+    stats.total_time += duration;
+    if (queue_wait)
+    {
+      stats.queued++;
+      stats.total_queue_wait += *queue_wait;
+    }
+    stats.request_bytes += request_bytes;
+    stats.response_bytes += response_bytes;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  std::vector<std::pair<std::string_view, core_rpc_server::rpc_command_stats>> core_rpc_server::get_rpc_stats()
+  {
+    std::vector<std::pair<std::string_view, rpc_command_stats>> result;
+    {
+      std::lock_guard lock{m_rpc_stats_mutex};
+      result.assign(m_rpc_stats.begin(), m_rpc_stats.end());
+    }
+    std::sort(result.begin(), result.end(), [](const auto &a, const auto &b) { return a.second.total_time > b.second.total_time; });
+    return result;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  GET_RPC_STATS::response core_rpc_server::invoke(GET_RPC_STATS::request&& req, rpc_context context)
+  {
+    GET_RPC_STATS::response res{};
+
+    auto us = [](std::chrono::steady_clock::duration d) {
+      return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+    };
+    res.buckets_ms.assign(GET_RPC_STATS::BUCKETS_MS.begin(), GET_RPC_STATS::BUCKETS_MS.end());
+    for (auto &[name, stats] : get_rpc_stats())
+    {
+      auto &cmd          = res.commands.emplace_back();
+      cmd.name           = name;
+      cmd.calls          = stats.calls;
+      cmd.errors         = stats.errors;
+      cmd.histogram.assign(stats.histogram.begin(), stats.histogram.end());
+      cmd.total_us       = us(stats.total_time);
+      cmd.queued         = stats.queued;
+      cmd.queue_wait_us  = us(stats.total_queue_wait);
+      cmd.request_bytes  = stats.request_bytes;
+      cmd.response_bytes = stats.response_bytes;
+    }
+
+    res.status = STATUS_OK;
+    return res;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  std::string core_rpc_server::rpc_stats_prometheus()
+  {
+    auto const stats = get_rpc_stats();
+    auto seconds = [](std::chrono::steady_clock::duration d) { return std::to_string(std::chrono::duration<double>(d).count()); };
+
+    std::ostringstream o;
+    o << "# HELP oxend_rpc_requests_total RPC requests handled, by command\n"
+         "# TYPE oxend_rpc_requests_total counter\n";
+    for (auto &[name, s] : stats)
+      o << "oxend_rpc_requests_total{command=\"" << name << "\"} " << s.calls << '\n';
+
+    o << "# HELP oxend_rpc_errors_total RPC requests that failed with an error, by command\n"
+         "# TYPE oxend_rpc_errors_total counter\n";
+    for (auto &[name, s] : stats)
+      o << "oxend_rpc_errors_total{command=\"" << name << "\"} " << s.errors << '\n';
+
+    o << "# HELP oxend_rpc_duration_seconds Time taken to handle RPC requests, by command\n"
+         "# TYPE oxend_rpc_duration_seconds histogram\n";
+    for (auto &[name, s] : stats)
+    {
+      uint64_t cumulative = 0;
+      for (size_t i = 0; i < GET_RPC_STATS::BUCKETS_MS.size(); i++)
+      {
+        cumulative += s.histogram[i];
+        o << "oxend_rpc_duration_seconds_bucket{command=\"" << name << "\",le=\"" << GET_RPC_STATS::BUCKETS_MS[i] / 1000.0 << "\"} " << cumulative << '\n';
+      }
+      o << "oxend_rpc_duration_seconds_bucket{command=\"" << name << "\",le=\"+Inf\"} " << s.calls << '\n';
+      o << "oxend_rpc_duration_seconds_sum{command=\"" << name << "\"} " << seconds(s.total_time) << '\n';
+      o << "oxend_rpc_duration_seconds_count{command=\"" << name << "\"} " << s.calls << '\n';
+    }
+
+    o << "# HELP oxend_rpc_queue_wait_seconds Time RPC requests waited for a worker thread, by command\n"
+         "# TYPE oxend_rpc_queue_wait_seconds summary\n";
+    for (auto &[name, s] : stats)
+    {
+      o << "oxend_rpc_queue_wait_seconds_sum{command=\"" << name << "\"} " << seconds(s.total_queue_wait) << '\n';
+      o << "oxend_rpc_queue_wait_seconds_count{command=\"" << name << "\"} " << s.queued << '\n';
+    }
+
+    o << "# HELP oxend_rpc_request_bytes_total Size of RPC request bodies, by command\n"
+         "# TYPE oxend_rpc_request_bytes_total counter\n";
+    for (auto &[name, s] : stats)
+      o << "oxend_rpc_request_bytes_total{command=\"" << name << "\"} " << s.request_bytes << '\n';
+
+    o << "# HELP oxend_rpc_response_bytes_total Size of RPC responses, by command\n"
+         "# TYPE oxend_rpc_response_bytes_total counter\n";
+    for (auto &[name, s] : stats)
+      o << "oxend_rpc_response_bytes_total{command=\"" << name << "\"} " << s.response_bytes << '\n';
+
+    o << tools::metrics::prometheus_text();
+    return o.str();
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  GET_METRICS::response core_rpc_server::invoke(GET_METRICS::request&& req, rpc_context context)
+  {
+    GET_METRICS::response res{};
+
+    for (auto &s : tools::metrics::snapshot())
+    {
+      auto &m = res.metrics.emplace_back();
+      m.name  = std::move(s.name);
+      m.type  = s.type;
+      m.help  = std::move(s.help);
+      m.value = s.value;
+      m.count = s.count;
+      m.sum   = s.sum;
+      for (auto &[max, count] : s.buckets)
+      {
+        m.bucket_max.push_back(max);
+        m.bucket_count.push_back(count);
+      }
+    }
+
+    for (auto &l : tools::lock_stats::top_sites())
+    {
+      auto &lock = res.locks.emplace_back();
+      lock.name = std::move(l.name);
+      for (auto &s : l.sites)
+        lock.sites.push_back({std::move(s.location), s.count, s.wait, s.hold});
+    }
+
+    res.status = STATUS_OK;
+    return res;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  TRACE::response core_rpc_server::invoke(TRACE::request&& req, rpc_context context)
+  {
+    TRACE::response res{};
+
+    if (req.enable)
+      tools::trace::enable(*req.enable);
+    if (req.dump)
+      res.trace = tools::trace::chrome_trace_json();
+    if (req.clear)
+      tools::trace::clear();
+    res.enabled = tools::trace::enabled();
+    res.status = STATUS_OK;
+    return res;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  PROFILE::response core_rpc_server::invoke(PROFILE::request&& req, rpc_context context)
+  {
+    PROFILE::response res{};
+
+    if (req.enable)
+    {
+      if (!*req.enable)
+        tools::profiler::stop();
+      else if (!tools::profiler::start(req.frequency))
+        throw rpc_error{ERROR_INTERNAL, "Failed to start the profiler (unsupported platform or invalid frequency)"};
+    }
+    if (req.dump)
+      res.profile = tools::profiler::collapsed_stacks();
+    res.running = tools::profiler::running();
+    res.samples = tools::profiler::samples();
+    res.dropped = tools::profiler::dropped();
+    res.status = STATUS_OK;
+    return res;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   TEST_TRIGGER_P2P_RESYNC::response core_rpc_server::invoke(TEST_TRIGGER_P2P_RESYNC::request&& req, rpc_context context)
   {
     TEST_TRIGGER_P2P_RESYNC::response res{};
@@ -3601,10 +4355,9 @@ namespace cryptonote { namespace rpc {
   }
 
   //------------------------------------------------------------------------------------------------------------------------------
-  ONS_RESOLVE::response core_rpc_server::invoke(ONS_RESOLVE::request&& req, rpc_context context)
+  // Validates an ONS_RESOLVE request, returning its type and base64 name hash
+  static std::pair<ons::mapping_type, std::string> ons_resolve_key(ONS_RESOLVE::request const &req, uint8_t hf_version)
   {
-    ONS_RESOLVE::response res{};
-
     if (req.type >= tools::enum_count<ons::mapping_type>)
       throw rpc_error{ERROR_WRONG_PARAM, "Unable to resolve ONS address: 'type' parameter not specified"};
 
@@ -3612,21 +4365,281 @@ namespace cryptonote { namespace rpc {
     if (!name_hash)
       throw rpc_error{ERROR_WRONG_PARAM, "Unable to resolve ONS address: invalid 'name_hash' value '" + req.name_hash + "'"};
 
-
-    uint8_t hf_version = m_core.get_blockchain_storage().get_network_version();
     auto type = static_cast<ons::mapping_type>(req.type);
     if (!ons::mapping_type_allowed(hf_version, type))
       throw rpc_error{ERROR_WRONG_PARAM, "Invalid lokinet type '" + std::to_string(req.type) + "'"};
+    return {type, std::move(*name_hash)};
+  }
 
-    if (auto mapping = m_core.get_blockchain_storage().name_system_db().resolve(
-        type, *name_hash, m_core.get_current_blockchain_height()))
+  static void fill_ons_resolve_response(ONS_RESOLVE::response &res, ons::mapping_type type, std::optional<ons::mapping_value> const &mapping)
+  {
+    if (mapping)
     {
       auto [val, nonce] = mapping->value_nonce(type);
       res.encrypted_value = oxenmq::to_hex(val);
       if (val.size() < mapping->to_view().size())
         res.nonce = oxenmq::to_hex(nonce);
     }
+  }
+
+  ONS_RESOLVE::response core_rpc_server::invoke(ONS_RESOLVE::request&& req, rpc_context context)
+  {
+    ONS_RESOLVE::response res{};
+    auto [type, name_hash] = ons_resolve_key(req, m_core.get_blockchain_storage().get_network_version());
+    fill_ons_resolve_response(res, type, m_core.get_blockchain_storage().name_system_db().resolve(
+        type, name_hash, m_core.get_current_blockchain_height()));
     return res;
   }
+  //------------------------------------------------------------------------------------------------------------------------------
+  ONS_RESOLVE_BATCH::response core_rpc_server::invoke(ONS_RESOLVE_BATCH::request&& req, rpc_context context)
+  {
+    ONS_RESOLVE_BATCH::response res{};
+
+    if (!context.admin)
+      check_quantity_limit(req.entries.size(), ONS_RESOLVE_BATCH::MAX_REQUEST_ENTRIES);
 
+    uint8_t hf_version = m_core.get_blockchain_storage().get_network_version();
+    std::vector<std::pair<ons::mapping_type, std::string>> keys;
+    keys.reserve(req.entries.size());
+    for (auto const &entry : req.entries)
+      keys.push_back(ons_resolve_key(entry, hf_version));
+
+    auto mappings = m_core.get_blockchain_storage().name_system_db().resolve(keys, m_core.get_current_blockchain_height());
+    res.entries.resize(keys.size());
+    for (size_t i = 0; i < keys.size(); i++)
+      fill_ons_resolve_response(res.entries[i], keys[i].first, mappings[i]);
+
+    res.status = STATUS_OK;
+    return res;
+  }
+
+  //------------------------------------------------------------------------------------------------------------------------------
+  void core_rpc_server::start_light_wallet_index()
+  {
+    if (!m_light_wallet_index)
+      m_light_wallet_index = std::make_unique<light_wallet_index>(m_core);
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  namespace {
+    constexpr auto LIGHT_WALLET_SUCCESS = "success"sv;
+    constexpr auto LIGHT_WALLET_ERROR = "error"sv;
+
+    // Parses the address and secret view key of a light wallet request, checking that they go
+    // together (the view key is what authenticates light wallet requests).  Returns an error
+    // message on failure.
+    std::optional<std::string> parse_light_wallet_keys(network_type nettype, const std::string& address, const std::string& view_key,
+        account_public_address& addr, crypto::secret_key& key)
+    {
+      address_parse_info info;
+      if (!get_account_address_from_str(info, nettype, address))
+        return "Invalid address";
+      if (info.is_subaddress || info.has_payment_id)
+        return "Light wallet accounts must use their main address";
+      if (!tools::hex_to_type(view_key, key))
+        return "Invalid view key";
+      crypto::public_key view_pub;
+      if (!crypto::secret_key_to_public_key(key, view_pub) || view_pub != info.address.m_view_public_key)
+        return "View key does not match the address";
+      addr = info.address;
+      return std::nullopt;
+    }
+
+    std::string hash8_to_hex64(const crypto::hash8& h)
+    {
+      return tools::type_to_hex(h) + std::string(64 - 2 * sizeof(h.data), '0');
+    }
+
+    light_wallet_spent_output make_spent_output(const light_wallet_index::account_data& data, const light_wallet_index::spend& spend)
+    {
+      const auto& out = data.outputs[spend.output];
+      light_wallet_spent_output so{};
+      so.amount = out.amount;
+      so.key_image = tools::type_to_hex(spend.key_image);
+      so.tx_pub_key = tools::type_to_hex(out.tx_pub_key);
+      so.out_index = out.index;
+      so.mixin = spend.mixin;
+      return so;
+    }
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  template <typename Response>
+  std::optional<light_wallet_index::account_data> core_rpc_server::get_light_wallet_account(const std::string& address, const std::string& view_key, Response& res)
+  {
+    res.status = LIGHT_WALLET_ERROR;
+    if (!m_light_wallet_index)
+    {
+      res.reason = "The light wallet index is not enabled on this daemon";
+      return std::nullopt;
+    }
+    account_public_address addr;
+    crypto::secret_key key;
+    if (auto error = parse_light_wallet_keys(nettype(), address, view_key, addr, key))
+    {
+      res.reason = std::move(*error);
+      return std::nullopt;
+    }
+    auto data = m_light_wallet_index->get_account(addr);
+    if (!data)
+    {
+      res.reason = "Account is not registered; log in first";
+      return std::nullopt;
+    }
+    res.status = LIGHT_WALLET_SUCCESS;
+    return data;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  LIGHT_WALLET_LOGIN::response core_rpc_server::invoke(LIGHT_WALLET_LOGIN::request&& req, rpc_context context)
+  {
+    LIGHT_WALLET_LOGIN::response res{};
+
+    PERF_TIMER(on_light_wallet_login);
+    res.status = LIGHT_WALLET_ERROR;
+    if (!m_light_wallet_index)
+    {
+      res.reason = "The light wallet index is not enabled on this daemon";
+      return res;
+    }
+    account_public_address addr;
+    crypto::secret_key key;
+    if (auto error = parse_light_wallet_keys(nettype(), req.address, req.view_key, addr, key))
+    {
+      res.reason = std::move(*error);
+      return res;
+    }
+    if (!req.create_account)
+    {
+      if (!m_light_wallet_index->get_account(addr))
+      {
+        res.reason = "Account is not registered";
+        return res;
+      }
+    }
+    else
+    {
+      try
+      {
+        res.new_address = m_light_wallet_index->add_account(addr, key, req.start_height);
+      }
+      catch (const std::exception& e)
+      {
+        res.reason = e.what();
+        return res;
+      }
+    }
+    res.status = LIGHT_WALLET_SUCCESS;
+    return res;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  LIGHT_WALLET_GET_ADDRESS_INFO::response core_rpc_server::invoke(LIGHT_WALLET_GET_ADDRESS_INFO::request&& req, rpc_context context)
+  {
+    LIGHT_WALLET_GET_ADDRESS_INFO::response res{};
+
+    PERF_TIMER(on_light_wallet_get_address_info);
+    auto data = get_light_wallet_account(req.address, req.view_key, res);
+    if (!data)
+      return res;
+
+    const uint64_t height = m_core.get_current_blockchain_height();
+    for (const auto& out : data->outputs)
+    {
+      res.total_received += out.amount;
+      if (data->txs[out.tx].height + CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE > height || !rules::is_output_unlocked(out.unlock_time, height))
+        res.locked_funds += out.amount;
+    }
+    for (const auto& tx : data->txs)
+    {
+      for (const auto& spend : tx.spends)
+      {
+        res.spent_outputs.push_back(make_spent_output(*data, spend));
+        res.total_sent += res.spent_outputs.back().amount;
+      }
+    }
+    res.scanned_height = res.scanned_block_height = res.transaction_height = data->scanned_height;
+    res.start_height = data->start_height;
+    res.blockchain_height = height;
+    return res;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  LIGHT_WALLET_GET_ADDRESS_TXS::response core_rpc_server::invoke(LIGHT_WALLET_GET_ADDRESS_TXS::request&& req, rpc_context context)
+  {
+    LIGHT_WALLET_GET_ADDRESS_TXS::response res{};
+
+    PERF_TIMER(on_light_wallet_get_address_txs);
+    auto data = get_light_wallet_account(req.address, req.view_key, res);
+    if (!data)
+      return res;
+
+    res.transactions.reserve(data->txs.size());
+    for (const auto& tx : data->txs)
+    {
+      auto& entry = res.transactions.emplace_back();
+      entry.id = res.transactions.size() - 1;
+      entry.hash = tools::type_to_hex(tx.hash);
+      entry.timestamp = tx.timestamp;
+      entry.unlock_time = tx.unlock_time;
+      entry.height = tx.height;
+      entry.payment_id = hash8_to_hex64(tx.payment_id);
+      entry.coinbase = tx.coinbase;
+      entry.mempool = false;
+      for (size_t i : tx.outputs)
+        entry.total_received += data->outputs[i].amount;
+      for (const auto& spend : tx.spends)
+      {
+        entry.spent_outputs.push_back(make_spent_output(*data, spend));
+        entry.total_sent += entry.spent_outputs.back().amount;
+      }
+      entry.mixin = tx.spends.empty() ? 0 : tx.spends.front().mixin;
+      res.total_received += entry.total_received;
+    }
+    res.scanned_height = res.scanned_block_height = data->scanned_height;
+    res.start_height = data->start_height;
+    res.blockchain_height = m_core.get_current_blockchain_height();
+    return res;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  LIGHT_WALLET_GET_UNSPENT_OUTS::response core_rpc_server::invoke(LIGHT_WALLET_GET_UNSPENT_OUTS::request&& req, rpc_context context)
+  {
+    LIGHT_WALLET_GET_UNSPENT_OUTS::response res{};
+
+    PERF_TIMER(on_light_wallet_get_unspent_outs);
+    auto data = get_light_wallet_account(req.address, req.view_key, res);
+    if (!data)
+      return res;
+
+    uint64_t dust_threshold = 0;
+    if (!req.use_dust && !req.dust_threshold.empty() && !tools::parse_int(req.dust_threshold, dust_threshold))
+    {
+      res.status = LIGHT_WALLET_ERROR;
+      res.reason = "Invalid dust_threshold";
+      return res;
+    }
+
+    std::vector<std::vector<std::string>> spend_key_images(data->outputs.size());
+    for (const auto& tx : data->txs)
+      for (const auto& spend : tx.spends)
+        spend_key_images[spend.output].push_back(tools::type_to_hex(spend.key_image));
+
+    for (size_t i = 0; i < data->outputs.size(); i++)
+    {
+      const auto& out = data->outputs[i];
+      if (out.amount < dust_threshold)
+        continue;
+      const auto& tx = data->txs[out.tx];
+      auto& entry = res.outputs.emplace_back();
+      entry.amount = out.amount;
+      entry.public_key = tools::type_to_hex(out.key);
+      entry.index = out.index;
+      entry.global_index = out.global_index;
+      if (out.rct)
+        entry.rct = tools::type_to_hex(out.commitment) + tools::type_to_hex(out.encrypted_mask) + hash8_to_hex64(out.encrypted_amount);
+      entry.tx_hash = tools::type_to_hex(tx.hash);
+      entry.tx_pub_key = tools::type_to_hex(out.tx_pub_key);
+      entry.spend_key_images = std::move(spend_key_images[i]);
+      entry.timestamp = tx.timestamp;
+      entry.height = tx.height;
+      res.amount += out.amount;
+    }
+    res.per_kb_fee = m_core.get_blockchain_storage().get_dynamic_base_fee_estimate(10).first * 1024;
+    return res;
+  }
 } }  // namespace cryptonote
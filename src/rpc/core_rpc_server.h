@@ -33,12 +33,15 @@
 
 #include <variant>
 #include <memory>
+#include <map>
+#include <unordered_map>
 
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/variables_map.hpp>
 
 #include "bootstrap_daemon.h"
 #include "core_rpc_server_commands_defs.h"
+#include "light_wallet_index.h"
 #include "cryptonote_core/cryptonote_core.h"
 #include "p2p/net_node.h"
 #include "cryptonote_protocol/cryptonote_protocol_handler.h"
@@ -140,6 +143,8 @@ namespace cryptonote::rpc {
     bool is_public; // callable via restricted RPC
     bool is_binary; // only callable at /name (for HTTP RPC), and binary data, not JSON.
     bool is_legacy; // callable at /name (for HTTP RPC), even though it is JSON (for backwards compat).
+    bool is_heavy; // expensive to handle, and so given a smaller concurrency limit on public HTTP RPC.
+    std::string_view name; // the primary name of the command (i.e. not an alias)
   };
 
   /// RPC command registration; to add a new command, define it in core_rpc_server_commands_defs.h
@@ -175,6 +180,7 @@ namespace cryptonote::rpc {
   public:
     static const command_line::arg_descriptor<std::string> arg_bootstrap_daemon_address;
     static const command_line::arg_descriptor<std::string> arg_bootstrap_daemon_login;
+    static const command_line::arg_descriptor<bool> arg_light_wallet_index;
 
     core_rpc_server(
         core& cr
@@ -184,14 +190,63 @@ namespace cryptonote::rpc {
     static void init_options(boost::program_options::options_description& desc, boost::program_options::options_description& hidden);
     void init(const boost::program_options::variables_map& vm);
 
+    /// Starts the light wallet index that serves the light wallet RPC calls (LIGHT_WALLET_LOGIN,
+    /// etc.).  Must be called after the core has been initialized.
+    void start_light_wallet_index();
+
     /// Returns a reference to the owning cryptonote core object
     core& get_core() { return m_core; }
     const core& get_core() const { return m_core; }
 
     network_type nettype() const { return m_core.get_nettype(); }
 
+    /// The state that a cached response to a CACHEABLE command depends on; a cached response is
+    /// only returned while this is unchanged.  The mempool cookie and proofs version are left at 0
+    /// for commands that don't depend on them.
+    struct response_cache_state
+    {
+      crypto::hash top_hash;
+      uint64_t pool_cookie;
+      uint64_t proofs_version;
+
+      bool operator==(const response_cache_state& o) const {
+        return top_hash == o.top_hash && pool_cookie == o.pool_cookie && proofs_version == o.proofs_version;
+      }
+    };
+
+    /// Returns the current response cache state; `mempool` and `proofs` select whether the mempool
+    /// cookie and service node proofs version are included.
+    response_cache_state get_response_cache_state(bool mempool, bool proofs);
+
+    /// Returns a copy of the serialized response cached under `key` if it was cached under `state`
+    /// and hasn't expired.  `key` must identify both the command and the request.
+    std::optional<std::string> get_cached_response(const std::string& key, const response_cache_state& state);
+
+    /// Records a handled RPC request in the per-command statistics (see GET_RPC_STATS).
+    /// `queue_wait` is how long the request waited for a worker thread, if known.
+    void record_rpc_call(
+        const rpc_command& call,
+        bool success,
+        std::chrono::steady_clock::duration duration,
+        std::optional<std::chrono::steady_clock::duration> queue_wait,
+        size_t request_bytes,
+        size_t response_bytes);
+
+    /// Returns the per-command statistics in the Prometheus text exposition format.
+    std::string rpc_stats_prometheus();
+
+    /// Entries for every registered service node as of block `height`, shared by GET_SERVICE_NODES
+    /// requests for the whole list (and by OMQ service node list polling) until the block or any
+    /// proof data changes.
+    std::shared_ptr<const std::vector<GET_SERVICE_NODES::response::entry>> get_all_sn_response_entries(uint64_t height, const crypto::hash &block_hash);
+
+    /// Caches a serialized response under `key`, which must be a response computed no earlier
+    /// than `state` was obtained.
+    void cache_response(std::string key, const response_cache_state& state, const std::string& response);
+
     GET_HEIGHT::response                                invoke(GET_HEIGHT::request&& req, rpc_context context);
     GET_BLOCKS_FAST::response                           invoke(GET_BLOCKS_FAST::request&& req, rpc_context context);
+    GET_BLOCKS_SCAN_BIN::response                       invoke(GET_BLOCKS_SCAN_BIN::request&& req, rpc_context context);
     GET_ALT_BLOCKS_HASHES::response                     invoke(GET_ALT_BLOCKS_HASHES::request&& req, rpc_context context);
     GET_BLOCKS_BY_HEIGHT::response                      invoke(GET_BLOCKS_BY_HEIGHT::request&& req, rpc_context context);
     GET_HASHES_FAST::response                           invoke(GET_HASHES_FAST::request&& req, rpc_context context);
@@ -265,11 +320,21 @@ namespace cryptonote::rpc {
     GET_CHECKPOINTS::response                           invoke(GET_CHECKPOINTS::request&& req, rpc_context context);
     GET_SN_STATE_CHANGES::response                      invoke(GET_SN_STATE_CHANGES::request&& req, rpc_context context);
     REPORT_PEER_STATUS::response                        invoke(REPORT_PEER_STATUS::request&& req, rpc_context context);
+    GET_PULSE_STATS::response                           invoke(GET_PULSE_STATS::request&& req, rpc_context context);
+    GET_RPC_STATS::response                             invoke(GET_RPC_STATS::request&& req, rpc_context context);
+    GET_METRICS::response                               invoke(GET_METRICS::request&& req, rpc_context context);
+    TRACE::response                                     invoke(TRACE::request&& req, rpc_context context);
+    PROFILE::response                                   invoke(PROFILE::request&& req, rpc_context context);
     TEST_TRIGGER_P2P_RESYNC::response                   invoke(TEST_TRIGGER_P2P_RESYNC::request&& req, rpc_context context);
     TEST_TRIGGER_UPTIME_PROOF::response                 invoke(TEST_TRIGGER_UPTIME_PROOF::request&& req, rpc_context context);
     ONS_NAMES_TO_OWNERS::response                       invoke(ONS_NAMES_TO_OWNERS::request&& req, rpc_context context);
     ONS_OWNERS_TO_NAMES::response                       invoke(ONS_OWNERS_TO_NAMES::request&& req, rpc_context context);
     ONS_RESOLVE::response                               invoke(ONS_RESOLVE::request&& req, rpc_context context);
+    ONS_RESOLVE_BATCH::response                         invoke(ONS_RESOLVE_BATCH::request&& req, rpc_context context);
+    LIGHT_WALLET_LOGIN::response                        invoke(LIGHT_WALLET_LOGIN::request&& req, rpc_context context);
+    LIGHT_WALLET_GET_ADDRESS_INFO::response             invoke(LIGHT_WALLET_GET_ADDRESS_INFO::request&& req, rpc_context context);
+    LIGHT_WALLET_GET_ADDRESS_TXS::response              invoke(LIGHT_WALLET_GET_ADDRESS_TXS::request&& req, rpc_context context);
+    LIGHT_WALLET_GET_UNSPENT_OUTS::response             invoke(LIGHT_WALLET_GET_UNSPENT_OUTS::request&& req, rpc_context context);
     FLUSH_CACHE::response                               invoke(FLUSH_CACHE::request&& req, rpc_context);
 
 #if defined(OXEN_ENABLE_INTEGRATION_TEST_HOOKS)
@@ -321,10 +386,19 @@ private:
     bool set_bootstrap_daemon(const std::string &address, std::string_view username_password);
     bool set_bootstrap_daemon(const std::string &address, std::string_view username, std::string_view password);
     void fill_block_header_response(const block& blk, bool orphan_status, uint64_t height, const crypto::hash& hash, block_header_response& response, bool fill_pow_hash, bool get_tx_hashes);
-    std::unique_lock<std::shared_mutex> should_bootstrap_lock();
+    // Same, for a main chain block from its stored header info; `difficulty` is its difficulty
+    void fill_block_header_response(const block_header_info& header, difficulty_type difficulty, block_header_response& response);
+    // Returns a shared lock of m_bootstrap_daemon_mutex if requests should go to the bootstrap
+    // daemon, an unlocked one otherwise.
+    std::shared_lock<std::shared_mutex> should_bootstrap_lock();
 
     template <typename COMMAND_TYPE>
     bool use_bootstrap_daemon_if_necessary(const typename COMMAND_TYPE::request& req, typename COMMAND_TYPE::response& res);
+
+    // Returns what the light wallet index has for the account of a light wallet request, or sets
+    // the error status and reason of `res` and returns nullopt.
+    template <typename Response>
+    std::optional<light_wallet_index::account_data> get_light_wallet_account(const std::string& address, const std::string& view_key, Response& res);
     
     core& m_core;
     nodetool::node_server<cryptonote::t_cryptonote_protocol_handler<cryptonote::core> >& m_p2p;
@@ -332,7 +406,62 @@ private:
     std::atomic<bool> m_should_use_bootstrap_daemon;
     std::unique_ptr<bootstrap_daemon> m_bootstrap_daemon;
     std::chrono::system_clock::time_point m_bootstrap_height_check_time;
-    bool m_was_bootstrap_ever_used;
+    std::atomic<bool> m_was_bootstrap_ever_used;
+    std::unique_ptr<light_wallet_index> m_light_wallet_index;
+
+    struct sn_response_cache
+    {
+      crypto::hash block_hash;
+      uint64_t proofs_version;
+      std::chrono::steady_clock::time_point created;
+      std::shared_ptr<const std::vector<GET_SERVICE_NODES::response::entry>> entries;
+    };
+    std::mutex m_sn_response_cache_mutex;
+    sn_response_cache m_sn_response_cache{};
+
+    struct rpc_command_stats
+    {
+      uint64_t calls = 0;
+      uint64_t errors = 0;
+      std::array<uint64_t, GET_RPC_STATS::BUCKETS_MS.size() + 1> histogram{};
+      std::chrono::steady_clock::duration total_time{0};
+      uint64_t queued = 0;
+      std::chrono::steady_clock::duration total_queue_wait{0};
+      uint64_t request_bytes = 0;
+      uint64_t response_bytes = 0;
+    };
+    // Returns the statistics of each called command, most total time first
+    std::vector<std::pair<std::string_view, rpc_command_stats>> get_rpc_stats();
+    std::mutex m_rpc_stats_mutex;
+    std::unordered_map<std::string_view, rpc_command_stats> m_rpc_stats;
+
+    struct cached_response
+    {
+      response_cache_state state;
+      std::chrono::steady_clock::time_point created;
+      std::string response;
+    };
+    std::mutex m_response_cache_mutex;
+    std::unordered_map<std::string, cached_response> m_response_cache;
+    crypto::hash m_response_cache_top_hash = crypto::null_hash;
+    size_t m_response_cache_bytes = 0;
+
+    // A block near the chain tip serialized as it appears in a pruned GET_BLOCKS_FAST response, so
+    // that wallets polling the tip are answered by concatenating these rather than by loading and
+    // serializing the same blocks again for each of them.
+    struct serialized_block
+    {
+      crypto::hash hash;
+      std::string entry;            // The block_complete_entry, with pruned transactions
+      std::string indices;          // The block_output_indices
+      std::string indices_no_miner; // The block_output_indices for a `no_miner_tx` request
+    };
+    // Fills `res.serialized` if the request is for blocks close enough to the tip to be cached;
+    // returns false to have the request served the usual way.
+    bool get_blocks_fast_from_cache(const GET_BLOCKS_FAST::request& req, GET_BLOCKS_FAST::response& res);
+    std::shared_ptr<const serialized_block> serialize_block(uint64_t height, const crypto::hash& hash);
+    std::mutex m_block_cache_mutex;
+    std::map<uint64_t, std::shared_ptr<const serialized_block>> m_block_cache;
   };
 
 } // namespace cryptonote::rpc
@@ -1,4 +1,5 @@
 #include "core_rpc_server_commands_defs.h"
+#include "json_writer.h"
 
 namespace cryptonote::rpc {
 
@@ -49,6 +50,39 @@ KV_SERIALIZE_MAP_CODE_BEGIN(GET_BLOCKS_FAST::response)
 KV_SERIALIZE_MAP_CODE_END()
 
 
+KV_SERIALIZE_MAP_CODE_BEGIN(GET_BLOCKS_SCAN_BIN::request)
+  KV_SERIALIZE(start_height)
+  KV_SERIALIZE_OPT(count, (uint64_t)0)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(GET_BLOCKS_SCAN_BIN::response)
+  KV_SERIALIZE(start_height)
+  KV_SERIALIZE(current_height)
+  KV_SERIALIZE_CONTAINER_POD_AS_BLOB(block_hashes)
+  KV_SERIALIZE_CONTAINER_POD_AS_BLOB(block_timestamps)
+  KV_SERIALIZE_CONTAINER_POD_AS_BLOB(block_tx_counts)
+  KV_SERIALIZE_CONTAINER_POD_AS_BLOB(tx_hashes)
+  KV_SERIALIZE_CONTAINER_POD_AS_BLOB(tx_types)
+  KV_SERIALIZE_CONTAINER_POD_AS_BLOB(tx_unlock_times)
+  KV_SERIALIZE_CONTAINER_POD_AS_BLOB(tx_pubkeys)
+  KV_SERIALIZE_CONTAINER_POD_AS_BLOB(tx_payment_ids)
+  KV_SERIALIZE_CONTAINER_POD_AS_BLOB(tx_additional_pubkey_counts)
+  KV_SERIALIZE_CONTAINER_POD_AS_BLOB(additional_pubkeys)
+  KV_SERIALIZE_CONTAINER_POD_AS_BLOB(tx_output_counts)
+  KV_SERIALIZE_CONTAINER_POD_AS_BLOB(output_keys)
+  KV_SERIALIZE_CONTAINER_POD_AS_BLOB(output_amounts)
+  KV_SERIALIZE_CONTAINER_POD_AS_BLOB(output_encrypted_amounts)
+  KV_SERIALIZE_CONTAINER_POD_AS_BLOB(output_commitments)
+  KV_SERIALIZE_CONTAINER_POD_AS_BLOB(output_unlock_times)
+  KV_SERIALIZE_CONTAINER_POD_AS_BLOB(output_global_indices)
+  KV_SERIALIZE_CONTAINER_POD_AS_BLOB(tx_key_image_counts)
+  KV_SERIALIZE_CONTAINER_POD_AS_BLOB(key_images)
+  KV_SERIALIZE(status)
+  KV_SERIALIZE(untrusted)
+KV_SERIALIZE_MAP_CODE_END()
+
+
 KV_SERIALIZE_MAP_CODE_BEGIN(GET_BLOCKS_BY_HEIGHT::request)
   KV_SERIALIZE(heights)
 KV_SERIALIZE_MAP_CODE_END()
@@ -175,6 +209,64 @@ KV_SERIALIZE_MAP_CODE_BEGIN(GET_TRANSACTIONS::response)
   KV_SERIALIZE(untrusted)
 KV_SERIALIZE_MAP_CODE_END()
 
+bool GET_TRANSACTIONS::response::write_json(std::string& out) const
+{
+  size_t size = 256;
+  for (const auto& tx : txs)
+  {
+    if (tx.extra)
+      return false;
+    size += 512 + tx.output_indices.size() * 12;
+    for (auto* s : {&tx.as_hex, &tx.as_json, &tx.pruned_as_hex, &tx.prunable_as_hex})
+      if (*s)
+        size += (*s)->size();
+  }
+  out.reserve(size + missed_tx.size() * 67);
+
+  // The members, here and below, are in sorted order as epee would write them
+  json_writer w{out};
+  w.begin_object();
+  w.field("missed_tx", missed_tx);
+  w.field("status", status);
+  if (!txs.empty())
+  {
+    w.key("txs");
+    w.begin_array();
+    for (const auto& tx : txs)
+    {
+      w.begin_object();
+      w.field("as_hex", tx.as_hex);
+      w.field("as_json", tx.as_json);
+      w.field("blink", tx.blink);
+      if (!tx.in_pool)
+      {
+        w.field("block_height", tx.block_height);
+        w.field("block_timestamp", tx.block_timestamp);
+      }
+      w.field("double_spend_seen", tx.double_spend_seen);
+      w.field("in_pool", tx.in_pool);
+      if (!tx.in_pool)
+        w.field("output_indices", tx.output_indices);
+      w.field("prunable_as_hex", tx.prunable_as_hex);
+      w.field("prunable_hash", tx.prunable_hash);
+      w.field("pruned_as_hex", tx.pruned_as_hex);
+      if (tx.in_pool)
+      {
+        w.field("received_timestamp", tx.received_timestamp);
+        w.field("relayed", tx.relayed);
+      }
+      w.field("size", tx.size);
+      w.field("stake_amount", tx.stake_amount);
+      w.field("tx_hash", tx.tx_hash);
+      w.end_object();
+    }
+    w.end_array();
+  }
+  w.field("untrusted", untrusted);
+  w.end_object();
+  return true;
+}
+
 
 KV_SERIALIZE_MAP_CODE_BEGIN(IS_KEY_IMAGE_SPENT::request)
   KV_SERIALIZE(key_images)
@@ -329,6 +421,10 @@ KV_SERIALIZE_MAP_CODE_BEGIN(GET_INFO::response)
   KV_SERIALIZE(height_without_bootstrap)
   KV_SERIALIZE(was_bootstrap_ever_used)
   KV_SERIALIZE(database_size)
+  KV_SERIALIZE(block_cache_hits)
+  KV_SERIALIZE(block_cache_misses)
+  KV_SERIALIZE(database_resizes)
+  KV_SERIALIZE(database_resize_time)
   KV_SERIALIZE(version)
   KV_SERIALIZE(status_line)
 KV_SERIALIZE_MAP_CODE_END()
@@ -341,6 +437,14 @@ KV_SERIALIZE_MAP_CODE_BEGIN(GET_NET_STATS::response)
   KV_SERIALIZE(total_bytes_in)
   KV_SERIALIZE(total_packets_out)
   KV_SERIALIZE(total_bytes_out)
+  KV_SERIALIZE(fluffy_blocks_received)
+  KV_SERIALIZE(fluffy_blocks_reconstructed)
+  KV_SERIALIZE(fluffy_blocks_missing_requests)
+  KV_SERIALIZE(fluffy_blocks_missing_txs)
+  KV_SERIALIZE(fluffy_blocks_prefilled_txs)
+  KV_SERIALIZE(fluffy_blocks_prefilled_used)
+  KV_SERIALIZE(send_backlog_ms)
+  KV_SERIALIZE(recv_backlog_ms)
 KV_SERIALIZE_MAP_CODE_END()
 
 
@@ -432,6 +536,35 @@ KV_SERIALIZE_MAP_CODE_BEGIN(block_header_response)
   KV_SERIALIZE(service_node_winner)
 KV_SERIALIZE_MAP_CODE_END()
 
+static void write_json(json_writer& w, const block_header_response& h)
+{
+  w.begin_object();
+  w.field("block_size", h.block_size);
+  if (h.block_weight != 0)
+    w.field("block_weight", h.block_weight);
+  w.field("cumulative_difficulty", h.cumulative_difficulty);
+  w.field("depth", h.depth);
+  w.field("difficulty", h.difficulty);
+  w.field("hash", h.hash);
+  w.field("height", h.height);
+  if (h.long_term_weight != 0)
+    w.field("long_term_weight", h.long_term_weight);
+  w.field("major_version", h.major_version);
+  w.field("miner_reward", h.miner_reward);
+  w.field("miner_tx_hash", h.miner_tx_hash);
+  w.field("minor_version", h.minor_version);
+  w.field("nonce", h.nonce);
+  w.field("num_txes", h.num_txes);
+  w.field("orphan_status", h.orphan_status);
+  w.field("pow_hash", h.pow_hash);
+  w.field("prev_hash", h.prev_hash);
+  w.field("reward", h.reward);
+  w.field("service_node_winner", h.service_node_winner);
+  w.field("timestamp", h.timestamp);
+  w.field("tx_hashes", h.tx_hashes);
+  w.end_object();
+}
+
 
 KV_SERIALIZE_MAP_CODE_BEGIN(GET_LAST_BLOCK_HEADER::request)
   KV_SERIALIZE_OPT(fill_pow_hash, false);
@@ -494,6 +627,22 @@ KV_SERIALIZE_MAP_CODE_BEGIN(GET_BLOCK::response)
   KV_SERIALIZE(untrusted)
 KV_SERIALIZE_MAP_CODE_END()
 
+bool GET_BLOCK::response::write_json(std::string& out) const
+{
+  out.reserve(1024 + blob.size() + json.size() + (tx_hashes.size() + block_header.tx_hashes.size()) * 67);
+  json_writer w{out};
+  w.begin_object();
+  w.field("blob", blob);
+  w.key("block_header");
+  rpc::write_json(w, block_header);
+  w.field("json", json);
+  w.field("status", status);
+  w.field("tx_hashes", tx_hashes);
+  w.field("untrusted", untrusted);
+  w.end_object();
+  return true;
+}
+
 
 KV_SERIALIZE_MAP_CODE_BEGIN(GET_PEER_LIST::peer)
   KV_SERIALIZE(id)
@@ -600,12 +749,15 @@ KV_SERIALIZE_MAP_CODE_BEGIN(GET_TRANSACTION_POOL_HASHES_BIN::request)
   KV_SERIALIZE_OPT(blinked_txs_only, false)
   KV_SERIALIZE_OPT(long_poll, false)
   KV_SERIALIZE_VAL_POD_AS_BLOB_OPT(tx_pool_checksum, crypto::hash{})
+  KV_SERIALIZE_OPT(include_blinked, false)
 KV_SERIALIZE_MAP_CODE_END()
 
 
 KV_SERIALIZE_MAP_CODE_BEGIN(GET_TRANSACTION_POOL_HASHES_BIN::response)
   KV_SERIALIZE(status)
   KV_SERIALIZE_CONTAINER_POD_AS_BLOB(tx_hashes)
+  KV_SERIALIZE_CONTAINER_POD_AS_BLOB(blinked_tx_hashes)
+  KV_SERIALIZE_OPT(blinked_included, false)
   KV_SERIALIZE(untrusted)
 KV_SERIALIZE_MAP_CODE_END()
 
@@ -644,6 +796,8 @@ KV_SERIALIZE_MAP_CODE_BEGIN(txpool_stats)
   KV_SERIALIZE(histo_98pc)
   KV_SERIALIZE(histo)
   KV_SERIALIZE(num_double_spends)
+  KV_SERIALIZE(num_evicted)
+  KV_SERIALIZE(bytes_evicted)
 KV_SERIALIZE_MAP_CODE_END()
 
 
@@ -674,6 +828,28 @@ KV_SERIALIZE_MAP_CODE_BEGIN(GET_BLOCK_HEADERS_RANGE::response)
   KV_SERIALIZE(untrusted)
 KV_SERIALIZE_MAP_CODE_END()
 
+bool GET_BLOCK_HEADERS_RANGE::response::write_json(std::string& out) const
+{
+  size_t size = 128;
+  for (const auto& h : headers)
+    size += 800 + h.tx_hashes.size() * 67;
+  out.reserve(size);
+  json_writer w{out};
+  w.begin_object();
+  if (!headers.empty())
+  {
+    w.key("headers");
+    w.begin_array();
+    for (const auto& h : headers)
+      rpc::write_json(w, h);
+    w.end_array();
+  }
+  w.field("status", status);
+  w.field("untrusted", untrusted);
+  w.end_object();
+  return true;
+}
+
 KV_SERIALIZE_MAP_CODE_BEGIN(SET_BOOTSTRAP_DAEMON::request)
   KV_SERIALIZE(address)
   KV_SERIALIZE(username)
@@ -1255,8 +1431,14 @@ KV_SERIALIZE_MAP_CODE_BEGIN(GET_SERVICE_NODE_BLACKLISTED_KEY_IMAGES::response)
 KV_SERIALIZE_MAP_CODE_END()
 
 
+KV_SERIALIZE_MAP_CODE_BEGIN(GET_OUTPUT_BLACKLIST::request)
+  KV_SERIALIZE(after)
+KV_SERIALIZE_MAP_CODE_END()
+
+
 KV_SERIALIZE_MAP_CODE_BEGIN(GET_OUTPUT_BLACKLIST::response)
   KV_SERIALIZE(blacklist)
+  KV_SERIALIZE(total)
   KV_SERIALIZE(status)
   KV_SERIALIZE(untrusted)
 KV_SERIALIZE_MAP_CODE_END()
@@ -1317,6 +1499,148 @@ KV_SERIALIZE_MAP_CODE_BEGIN(REPORT_PEER_STATUS::request)
 KV_SERIALIZE_MAP_CODE_END()
 
 
+KV_SERIALIZE_MAP_CODE_BEGIN(GET_PULSE_STATS::request)
+  KV_SERIALIZE_OPT(include_rounds, false)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(GET_PULSE_STATS::stage)
+  KV_SERIALIZE(type)
+  KV_SERIALIZE(histogram)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(GET_PULSE_STATS::validator)
+  KV_SERIALIZE(pubkey)
+  KV_SERIALIZE(messages)
+  KV_SERIALIZE(histogram)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(GET_PULSE_STATS::failure)
+  KV_SERIALIZE(reason)
+  KV_SERIALIZE(count)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(GET_PULSE_STATS::arrival)
+  KV_SERIALIZE(type)
+  KV_SERIALIZE(sender)
+  KV_SERIALIZE(latency_ms)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(GET_PULSE_STATS::round)
+  KV_SERIALIZE(height)
+  KV_SERIALIZE(round)
+  KV_SERIALIZE(node_name)
+  if (!this_ref.failure.empty())
+  {
+    KV_SERIALIZE(failure)
+  }
+  KV_SERIALIZE(arrivals)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(GET_PULSE_STATS::response)
+  KV_SERIALIZE(buckets_ms)
+  KV_SERIALIZE(rounds)
+  KV_SERIALIZE(stages)
+  KV_SERIALIZE(validators)
+  KV_SERIALIZE(failures)
+  KV_SERIALIZE(recent_rounds)
+  KV_SERIALIZE(status)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(GET_RPC_STATS::command)
+  KV_SERIALIZE(name)
+  KV_SERIALIZE(calls)
+  KV_SERIALIZE(errors)
+  KV_SERIALIZE(histogram)
+  KV_SERIALIZE(total_us)
+  KV_SERIALIZE(queued)
+  KV_SERIALIZE(queue_wait_us)
+  KV_SERIALIZE(request_bytes)
+  KV_SERIALIZE(response_bytes)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(GET_RPC_STATS::response)
+  KV_SERIALIZE(buckets_ms)
+  KV_SERIALIZE(commands)
+  KV_SERIALIZE(status)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(GET_METRICS::metric)
+  KV_SERIALIZE(name)
+  KV_SERIALIZE(type)
+  KV_SERIALIZE(help)
+  if (this_ref.type == "histogram")
+  {
+    KV_SERIALIZE(count)
+    KV_SERIALIZE(sum)
+    KV_SERIALIZE(bucket_max)
+    KV_SERIALIZE(bucket_count)
+  }
+  else
+    KV_SERIALIZE(value)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(GET_METRICS::lock_site)
+  KV_SERIALIZE(location)
+  KV_SERIALIZE(count)
+  KV_SERIALIZE(wait)
+  KV_SERIALIZE(hold)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(GET_METRICS::lock)
+  KV_SERIALIZE(name)
+  KV_SERIALIZE(sites)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(GET_METRICS::response)
+  KV_SERIALIZE(metrics)
+  if (!this_ref.locks.empty())
+    KV_SERIALIZE(locks)
+  KV_SERIALIZE(status)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(TRACE::request)
+  KV_SERIALIZE(enable)
+  KV_SERIALIZE_OPT(clear, false)
+  KV_SERIALIZE_OPT(dump, false)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(TRACE::response)
+  KV_SERIALIZE(enabled)
+  KV_SERIALIZE(trace)
+  KV_SERIALIZE(status)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(PROFILE::request)
+  KV_SERIALIZE(enable)
+  KV_SERIALIZE_OPT(frequency, 99u)
+  KV_SERIALIZE_OPT(dump, false)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(PROFILE::response)
+  KV_SERIALIZE(running)
+  KV_SERIALIZE(samples)
+  KV_SERIALIZE(dropped)
+  KV_SERIALIZE(profile)
+  KV_SERIALIZE(status)
+KV_SERIALIZE_MAP_CODE_END()
+
+
 KV_SERIALIZE_MAP_CODE_BEGIN(ONS_NAMES_TO_OWNERS::request_entry)
   KV_SERIALIZE(name_hash)
   KV_SERIALIZE(types)
@@ -1384,6 +1708,129 @@ KV_SERIALIZE_MAP_CODE_BEGIN(ONS_RESOLVE::response)
 KV_SERIALIZE_MAP_CODE_END()
 
 
+KV_SERIALIZE_MAP_CODE_BEGIN(ONS_RESOLVE_BATCH::request)
+  KV_SERIALIZE(entries)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(ONS_RESOLVE_BATCH::response)
+  KV_SERIALIZE(entries)
+  KV_SERIALIZE(status)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(LIGHT_WALLET_LOGIN::request)
+  KV_SERIALIZE(address)
+  KV_SERIALIZE(view_key)
+  KV_SERIALIZE_OPT(create_account, false)
+  KV_SERIALIZE(start_height)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(LIGHT_WALLET_LOGIN::response)
+  KV_SERIALIZE(status)
+  KV_SERIALIZE(reason)
+  KV_SERIALIZE(new_address)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(light_wallet_spent_output)
+  KV_SERIALIZE(amount)
+  KV_SERIALIZE(key_image)
+  KV_SERIALIZE(tx_pub_key)
+  KV_SERIALIZE(out_index)
+  KV_SERIALIZE(mixin)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(LIGHT_WALLET_GET_ADDRESS_INFO::request)
+  KV_SERIALIZE(address)
+  KV_SERIALIZE(view_key)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(LIGHT_WALLET_GET_ADDRESS_INFO::response)
+  KV_SERIALIZE(locked_funds)
+  KV_SERIALIZE(total_received)
+  KV_SERIALIZE(total_sent)
+  KV_SERIALIZE(scanned_height)
+  KV_SERIALIZE(scanned_block_height)
+  KV_SERIALIZE(start_height)
+  KV_SERIALIZE(transaction_height)
+  KV_SERIALIZE(blockchain_height)
+  KV_SERIALIZE(spent_outputs)
+  KV_SERIALIZE(status)
+  KV_SERIALIZE(reason)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(LIGHT_WALLET_GET_ADDRESS_TXS::request)
+  KV_SERIALIZE(address)
+  KV_SERIALIZE(view_key)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(LIGHT_WALLET_GET_ADDRESS_TXS::transaction)
+  KV_SERIALIZE(id)
+  KV_SERIALIZE(hash)
+  KV_SERIALIZE(timestamp)
+  KV_SERIALIZE(total_received)
+  KV_SERIALIZE(total_sent)
+  KV_SERIALIZE(unlock_time)
+  KV_SERIALIZE(height)
+  KV_SERIALIZE(spent_outputs)
+  KV_SERIALIZE(payment_id)
+  KV_SERIALIZE(coinbase)
+  KV_SERIALIZE(mempool)
+  KV_SERIALIZE(mixin)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(LIGHT_WALLET_GET_ADDRESS_TXS::response)
+  KV_SERIALIZE(total_received)
+  KV_SERIALIZE(scanned_height)
+  KV_SERIALIZE(scanned_block_height)
+  KV_SERIALIZE(start_height)
+  KV_SERIALIZE(blockchain_height)
+  KV_SERIALIZE(transactions)
+  KV_SERIALIZE(status)
+  KV_SERIALIZE(reason)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(LIGHT_WALLET_GET_UNSPENT_OUTS::request)
+  KV_SERIALIZE(amount)
+  KV_SERIALIZE(address)
+  KV_SERIALIZE(view_key)
+  KV_SERIALIZE_OPT(mixin, (uint64_t)0)
+  KV_SERIALIZE_OPT(use_dust, true)
+  KV_SERIALIZE(dust_threshold)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(LIGHT_WALLET_GET_UNSPENT_OUTS::output)
+  KV_SERIALIZE(amount)
+  KV_SERIALIZE(public_key)
+  KV_SERIALIZE(index)
+  KV_SERIALIZE(global_index)
+  KV_SERIALIZE(rct)
+  KV_SERIALIZE(tx_hash)
+  KV_SERIALIZE(tx_pub_key)
+  KV_SERIALIZE(spend_key_images)
+  KV_SERIALIZE(timestamp)
+  KV_SERIALIZE(height)
+KV_SERIALIZE_MAP_CODE_END()
+
+
+KV_SERIALIZE_MAP_CODE_BEGIN(LIGHT_WALLET_GET_UNSPENT_OUTS::response)
+  KV_SERIALIZE(amount)
+  KV_SERIALIZE(outputs)
+  KV_SERIALIZE(per_kb_fee)
+  KV_SERIALIZE(status)
+  KV_SERIALIZE(reason)
+KV_SERIALIZE_MAP_CODE_END()
+
+
 KV_SERIALIZE_MAP_CODE_BEGIN(FLUSH_CACHE::request)
   KV_SERIALIZE_OPT(bad_txs, false)
   KV_SERIALIZE_OPT(bad_blocks, false)
@@ -66,7 +66,7 @@ namespace rpc {
 // has its own version, and that clients can just test major to see
 // whether they can talk to a given daemon without having to know in
 // advance which version they will stop working with
-  constexpr version_t VERSION = {4, 0};
+  constexpr version_t VERSION = {4, 1};
 
   /// Makes a version array from a packed 32-bit integer version
   constexpr version_t make_version(uint32_t version)
@@ -121,6 +121,25 @@ namespace rpc {
   /// if specified).
   struct LEGACY : RPC_COMMAND {};
 
+  /// Specifies that the RPC call can be expensive for the node (e.g. it returns bulk blockchain
+  /// data).  On the public HTTP RPC server these requests are only allowed a share of the
+  /// concurrent request limit, so that they can't crowd out everything else.
+  struct HEAVY : RPC_COMMAND {};
+
+  /// Specifies that the serialized response to a public (i.e. non-admin) request may be cached and
+  /// returned again for an identical request until the top block changes (or the cached response
+  /// gets a few seconds old).  This must only be used on commands whose response is determined by
+  /// the request and the chain state.  A command can additionally define a
+  /// `static bool cacheable(const request&)` to exclude some requests (e.g. randomized ones).
+  struct CACHEABLE : RPC_COMMAND {};
+
+  /// Like CACHEABLE, but the cached response is also invalidated by any change to the mempool.
+  struct CACHE_MEMPOOL : CACHEABLE {};
+
+  /// Like CACHEABLE, but the cached response is also invalidated by any new uptime proof or other
+  /// service node proof data.
+  struct CACHE_SN_PROOFS : CACHEABLE {};
+
 
   /// (Not a tag). Generic, serializable, no-argument request type, use as `struct request : EMPTY {};`
   struct EMPTY { KV_MAP_SERIALIZABLE };
@@ -155,7 +174,7 @@ namespace rpc {
 
   OXEN_RPC_DOC_INTROSPECT
   // Get all blocks info. Binary request.
-  struct GET_BLOCKS_FAST : PUBLIC, BINARY
+  struct GET_BLOCKS_FAST : PUBLIC, BINARY, HEAVY
   {
     static constexpr auto names() { return NAMES("get_blocks.bin", "getblocks.bin"); }
 
@@ -194,13 +213,71 @@ namespace rpc {
       std::vector<block_output_indices> output_indices; // Array of indices.
       bool untrusted;                                   // States if the result is obtained using the bootstrap mode, and is therefore not trusted (`true`), or when the daemon is fully synced (`false`).
 
+      // Not serialized: if non-empty, the complete binary response, which the daemon assembles
+      // from its cache of serialized blocks when the request is for blocks near the chain tip.
+      std::string serialized;
+
+      KV_MAP_SERIALIZABLE
+    };
+  };
+
+  OXEN_RPC_DOC_INTROSPECT
+  // Get the data that a wallet needs to scan a range of blocks for its outputs and spends, without
+  // the rest of the blocks and transactions.  Binary request.
+  //
+  // The response is columnar: the `block_*` fields have one value per block, in height order; the
+  // `tx_*` fields have one value per transaction, in block order, starting with each block's miner
+  // transaction; the `output_*` and `key_images` fields are concatenated over all transactions,
+  // with `tx_output_counts` and `tx_key_image_counts` giving the number belonging to each, and
+  // likewise `additional_pubkeys` per `tx_additional_pubkey_counts`.  To detect a reorg, request
+  // from the last block the wallet already has and check that its hash is unchanged.
+  struct GET_BLOCKS_SCAN_BIN : PUBLIC, BINARY, HEAVY
+  {
+    static constexpr auto names() { return NAMES("get_blocks_scan.bin"); }
+
+    static constexpr size_t MAX_COUNT = 1000;
+
+    struct request
+    {
+      uint64_t start_height; // The height of the first block to return
+      uint64_t count;        // The maximum number of blocks to return; 0 (or anything above MAX_COUNT) means MAX_COUNT.
+
+      KV_MAP_SERIALIZABLE
+    };
+
+    struct response
+    {
+      uint64_t start_height;                          // The height of the first returned block
+      uint64_t current_height;                        // The current blockchain height
+      std::vector<crypto::hash> block_hashes;         // Block hashes
+      std::vector<uint64_t> block_timestamps;         // Block timestamps
+      std::vector<uint32_t> block_tx_counts;          // The number of transactions in each block, including the miner transaction
+      std::vector<crypto::hash> tx_hashes;            // Transaction hashes
+      std::vector<uint16_t> tx_types;                 // Transaction types (standard, state change, stake, ...)
+      std::vector<uint64_t> tx_unlock_times;          // Transaction unlock times (superseded by output_unlock_times in newer transactions)
+      std::vector<crypto::public_key> tx_pubkeys;     // The main transaction public key, or null if the transaction has none
+      std::vector<crypto::hash8> tx_payment_ids;      // Encrypted payment ids, or null if the transaction has none
+      std::vector<uint32_t> tx_additional_pubkey_counts; // The number of additional public keys of each transaction
+      std::vector<crypto::public_key> additional_pubkeys; // Additional (per-output) transaction public keys
+      std::vector<uint32_t> tx_output_counts;         // The number of outputs of each transaction
+      std::vector<crypto::public_key> output_keys;    // Output one-time public keys
+      std::vector<uint64_t> output_amounts;           // Plaintext output amounts; 0 for RingCT outputs
+      std::vector<crypto::hash8> output_encrypted_amounts; // Encrypted RingCT output amounts, or null for non-RingCT outputs
+      std::vector<crypto::public_key> output_commitments;  // RingCT output commitments, or null for non-RingCT outputs
+      std::vector<uint64_t> output_unlock_times;      // Output unlock times
+      std::vector<uint64_t> output_global_indices;    // Output global indices (within the output's amount)
+      std::vector<uint32_t> tx_key_image_counts;      // The number of key images of each transaction
+      std::vector<crypto::key_image> key_images;      // Key images spent by the transactions
+      std::string status;                             // General RPC error code. "OK" means everything looks good.
+      bool untrusted;                                 // States if the result is obtained using the bootstrap mode, and is therefore not trusted (`true`), or when the daemon is fully synced (`false`).
+
       KV_MAP_SERIALIZABLE
     };
   };
 
   OXEN_RPC_DOC_INTROSPECT
   // Get blocks by height. Binary request.
-  struct GET_BLOCKS_BY_HEIGHT : PUBLIC, BINARY
+  struct GET_BLOCKS_BY_HEIGHT : PUBLIC, BINARY, HEAVY
   {
     static constexpr auto names() { return NAMES("get_blocks_by_height.bin", "getblocks_by_height.bin"); }
 
@@ -267,7 +344,7 @@ namespace rpc {
 
   OXEN_RPC_DOC_INTROSPECT
   // Look up one or more transactions by hash.
-  struct GET_TRANSACTIONS : PUBLIC, LEGACY
+  struct GET_TRANSACTIONS : PUBLIC, LEGACY, HEAVY
   {
     static constexpr auto names() { return NAMES("get_transactions", "gettransactions"); }
 
@@ -377,6 +454,11 @@ namespace rpc {
       std::string status;                   // General RPC error code. "OK" means everything looks good.
       bool untrusted;                       // States if the result is obtained using the bootstrap mode, and is therefore not trusted (`true`), or when the daemon is fully synced (`false`).
 
+      // Writes the JSON response directly (see json_writer.h), as epee would but without building
+      // a portable_storage first.  Returns false, having written nothing, if any entry has `extra`
+      // information, which is left to epee.
+      bool write_json(std::string& out) const;
+
       KV_MAP_SERIALIZABLE
     };
   };
@@ -448,7 +530,7 @@ namespace rpc {
 
   OXEN_RPC_DOC_INTROSPECT
   // Get outputs. Binary request.
-  struct GET_OUTPUTS_BIN : PUBLIC, BINARY
+  struct GET_OUTPUTS_BIN : PUBLIC, BINARY, HEAVY
   {
     static constexpr auto names() { return NAMES("get_outs.bin"); }
 
@@ -485,7 +567,7 @@ namespace rpc {
   };
 
   OXEN_RPC_DOC_INTROSPECT
-  struct GET_OUTPUTS : PUBLIC, LEGACY
+  struct GET_OUTPUTS : PUBLIC, LEGACY, HEAVY
   {
     static constexpr auto names() { return NAMES("get_outs"); }
 
@@ -607,7 +689,7 @@ namespace rpc {
   // Retrieve general information about the state of your node and the network.
   // Note that all of the std::optional<> fields here are not included if the request is a public
   // (restricted) RPC request.
-  struct GET_INFO : PUBLIC, LEGACY
+  struct GET_INFO : PUBLIC, LEGACY, CACHE_MEMPOOL
   {
     static constexpr auto names() { return NAMES("get_info", "getinfo"); }
 
@@ -652,6 +734,10 @@ namespace rpc {
       std::optional<uint64_t> height_without_bootstrap;    // Current length of the local chain of the daemon.
       std::optional<bool> was_bootstrap_ever_used;         // States if a bootstrap node has ever been used since the daemon started.
       uint64_t database_size;               // Current size of Blockchain data.  Over public RPC this is rounded up to the next-largest GB value.
+      std::optional<uint64_t> block_cache_hits;            // Number of block lookups served from the recent block cache since startup.
+      std::optional<uint64_t> block_cache_misses;          // Number of block lookups that had to be loaded from the database since startup.
+      std::optional<uint64_t> database_resizes;            // Number of times the database storage has been grown since startup.
+      std::optional<uint64_t> database_resize_time;        // Total time, in milliseconds, that database access was stalled by those resizes.
       std::string version;                  // Current version of software running.
       std::string status_line;              // A short one-line summary status of the node (requires an admin/unrestricted connection for most details)
 
@@ -674,6 +760,14 @@ namespace rpc {
       uint64_t total_bytes_in;
       uint64_t total_packets_out;
       uint64_t total_bytes_out;
+      uint64_t fluffy_blocks_received;          // New fluffy blocks received from peers
+      uint64_t fluffy_blocks_reconstructed;     // Of those, blocks we completed without having to request any transactions
+      uint64_t fluffy_blocks_missing_requests;  // Of those, blocks for which we had to request missing transactions
+      uint64_t fluffy_blocks_missing_txs;       // Total transactions requested by those requests
+      uint64_t fluffy_blocks_prefilled_txs;     // Transactions included by peers along with new blocks
+      uint64_t fluffy_blocks_prefilled_used;    // Of those, transactions we did not already have in our pool
+      uint64_t send_backlog_ms;                 // How long a p2p send started now would be held back by the upload limit
+      uint64_t recv_backlog_ms;                 // How long a p2p read started now would be held back by the download limit
 
       KV_MAP_SERIALIZABLE
     };
@@ -830,7 +924,7 @@ namespace rpc {
 
   OXEN_RPC_DOC_INTROSPECT
   // Block header information for the most recent block is easily retrieved with this method. No inputs are needed.
-  struct GET_LAST_BLOCK_HEADER : PUBLIC
+  struct GET_LAST_BLOCK_HEADER : PUBLIC, CACHEABLE
   {
     static constexpr auto names() { return NAMES("get_last_block_header", "getlastblockheader"); }
 
@@ -931,6 +1025,9 @@ namespace rpc {
       std::string json;                   // JSON formatted block details.
       bool untrusted;                     // States if the result is obtained using the bootstrap mode, and is therefore not trusted (`true`), or when the daemon is fully synced (`false`).
 
+      // Writes the JSON response directly, as for GET_TRANSACTIONS; always returns true.
+      bool write_json(std::string& out) const;
+
       KV_MAP_SERIALIZABLE
     };
   };
@@ -1124,7 +1221,7 @@ namespace rpc {
   OXEN_RPC_DOC_INTROSPECT
   // Show information about valid transactions seen by the node but not yet mined into a block,
   // as well as spent key image information for the txpool in the node's memory.
-  struct GET_TRANSACTION_POOL : PUBLIC, LEGACY
+  struct GET_TRANSACTION_POOL : PUBLIC, LEGACY, HEAVY
   {
     static constexpr auto names() { return NAMES("get_transaction_pool"); }
 
@@ -1160,6 +1257,7 @@ namespace rpc {
       bool         blinked_txs_only; // Optional: If true only transactions that were sent via blink and approved are queried.
       bool         long_poll;        // Optional: If true, this call is blocking until timeout OR tx pool has changed since the last query. TX pool change is detected by comparing the hash of all the hashes in the tx pool.  Ignored when using LMQ RPC.
       crypto::hash tx_pool_checksum; // Optional: If `long_poll` is true the caller must pass the hashes of all their known tx pool hashes, XOR'ed together.  Ignored when using LMQ RPC.
+      bool         include_blinked;  // Optional: If true (and `blinked_txs_only` is false) also return which of the returned transactions are approved blinks, saving a second request.
       KV_MAP_SERIALIZABLE
     };
 
@@ -1167,6 +1265,8 @@ namespace rpc {
     {
       std::string status;                  // General RPC error code. "OK" means everything looks good.
       std::vector<crypto::hash> tx_hashes; // List of transaction hashes,
+      std::vector<crypto::hash> blinked_tx_hashes; // The approved blink subset of `tx_hashes`, if `include_blinked` was requested.
+      bool blinked_included;               // True if `blinked_tx_hashes` was filled in; older daemons ignore `include_blinked` and leave this false.
       bool untrusted;                      // States if the result is obtained using the bootstrap mode, and is therefore not trusted (`true`), or when the daemon is fully synced (`false`).
 
       KV_MAP_SERIALIZABLE
@@ -1241,8 +1341,10 @@ namespace rpc {
     uint64_t histo_98pc;             // the time 98% of txes are "younger" than.
     std::vector<txpool_histo> histo; // List of txpool histo.
     uint32_t num_double_spends;      // Number of double spend transactions.
+    uint64_t num_evicted;            // Number of transactions evicted (since startup) to keep the pool within its maximum size.
+    uint64_t bytes_evicted;          // Total weight of the transactions counted in `num_evicted`.
 
-    txpool_stats(): bytes_total(0), bytes_min(0), bytes_max(0), bytes_med(0), fee_total(0), oldest(0), txs_total(0), num_failing(0), num_10m(0), num_not_relayed(0), histo_98pc(0), num_double_spends(0) {}
+    txpool_stats(): bytes_total(0), bytes_min(0), bytes_max(0), bytes_med(0), fee_total(0), oldest(0), txs_total(0), num_failing(0), num_10m(0), num_not_relayed(0), histo_98pc(0), num_double_spends(0), num_evicted(0), bytes_evicted(0) {}
 
     KV_MAP_SERIALIZABLE
   };
@@ -1286,7 +1388,7 @@ namespace rpc {
   // Similar to get_block_header_by_height above, but for a range of blocks.
   // This method includes a starting block height and an ending block height as
   // parameters to retrieve basic information about the range of blocks.
-  struct GET_BLOCK_HEADERS_RANGE : PUBLIC
+  struct GET_BLOCK_HEADERS_RANGE : PUBLIC, CACHEABLE
   {
     static constexpr auto names() { return NAMES("get_block_headers_range", "getblockheadersrange"); }
 
@@ -1306,6 +1408,9 @@ namespace rpc {
       std::vector<block_header_response> headers; // Array of block_header (a structure containing block header information. See get_last_block_header).
       bool untrusted;                             // States if the result is obtained using the bootstrap mode, and is therefore not trusted (`true`), or when the daemon is fully synced (`false`).
 
+      // Writes the JSON response directly, as for GET_TRANSACTIONS; always returns true.
+      bool write_json(std::string& out) const;
+
       KV_MAP_SERIALIZABLE
     };
   };
@@ -1542,7 +1647,7 @@ namespace rpc {
   OXEN_RPC_DOC_INTROSPECT
   // Get a histogram of output amounts. For all amounts (possibly filtered by parameters),
   // gives the number of outputs on the chain for that amount. RingCT outputs counts as 0 amount.
-  struct GET_OUTPUT_HISTOGRAM : PUBLIC
+  struct GET_OUTPUT_HISTOGRAM : PUBLIC, CACHEABLE, HEAVY
   {
     static constexpr auto names() { return NAMES("get_output_histogram"); }
 
@@ -1748,7 +1853,7 @@ namespace rpc {
 
 
   OXEN_RPC_DOC_INTROSPECT
-  struct GET_OUTPUT_DISTRIBUTION : PUBLIC
+  struct GET_OUTPUT_DISTRIBUTION : PUBLIC, CACHEABLE, HEAVY
   {
     static constexpr auto names() { return NAMES("get_output_distribution"); }
 
@@ -1787,7 +1892,7 @@ namespace rpc {
 
   OXEN_RPC_DOC_INTROSPECT
   // Exactly like GET_OUTPUT_DISTRIBUTION, but does a binary RPC transfer instead of JSON
-  struct GET_OUTPUT_DISTRIBUTION_BIN : PUBLIC, BINARY
+  struct GET_OUTPUT_DISTRIBUTION_BIN : PUBLIC, BINARY, CACHEABLE, HEAVY
   {
     static constexpr auto names() { return NAMES("get_output_distribution.bin"); }
 
@@ -2009,7 +2114,7 @@ namespace rpc {
 
   OXEN_RPC_DOC_INTROSPECT
   // Get information on some, all, or a random subset of Service Nodes.
-  struct GET_SERVICE_NODES : PUBLIC
+  struct GET_SERVICE_NODES : PUBLIC, CACHE_SN_PROOFS
   {
     static constexpr auto names() { return NAMES("get_service_nodes", "get_n_service_nodes", "get_all_service_nodes"); }
 
@@ -2151,6 +2256,9 @@ namespace rpc {
       KV_MAP_SERIALIZABLE
 
     };
+
+    // A random sample has to be drawn afresh for each request
+    static bool cacheable(const request& req) { return req.limit == 0; }
   };
 
   OXEN_RPC_DOC_INTROSPECT
@@ -2212,7 +2320,7 @@ namespace rpc {
   // Get the required amount of Loki to become a Service Node at the queried height.
   // For devnet and testnet values, ensure the daemon is started with the
   // `--devnet` or `--testnet` flags respectively.
-  struct GET_STAKING_REQUIREMENT : PUBLIC
+  struct GET_STAKING_REQUIREMENT : PUBLIC, CACHEABLE
   {
     static constexpr auto names() { return NAMES("get_staking_requirement"); }
 
@@ -2264,11 +2372,17 @@ namespace rpc {
   struct GET_OUTPUT_BLACKLIST : PUBLIC, BINARY
   {
     static constexpr auto names() { return NAMES("get_output_blacklist.bin"); }
-    struct request : EMPTY {};
+    struct request
+    {
+      std::optional<uint64_t> after; // If given, only return the blacklisted indexes above this one (i.e. those added since the blacklist that ended with it).
+
+      KV_MAP_SERIALIZABLE
+    };
 
     struct response
     {
-      std::vector<uint64_t> blacklist; // (Developer): Array of indexes from the global output list, corresponding to blacklisted key images.
+      std::vector<uint64_t> blacklist; // (Developer): Array of indexes from the global output list, corresponding to blacklisted key images, in ascending order.
+      uint64_t total;                  // The total number of blacklisted outputs, including those not returned because of `after`.
       std::string status;              // Generic RPC error code. "OK" is the success value.
       bool untrusted;                  // If the result is obtained using bootstrap mode, and therefore not trusted `true`, or otherwise `false`.
 
@@ -2409,6 +2523,230 @@ namespace rpc {
     struct response : STATUS {};
   };
 
+  OXEN_RPC_DOC_INTROSPECT
+  // Get timing statistics of the recent Pulse rounds this service node took part in, as
+  // histograms, for diagnosing slow or failed rounds.
+  struct GET_PULSE_STATS : RPC_COMMAND
+  {
+    static constexpr auto names() { return NAMES("get_pulse_stats"); }
+
+    // Upper bounds, in milliseconds, of the histogram buckets; each histogram has one more count at
+    // the end for the values at or above the last bound.
+    static constexpr std::array<uint64_t, 8> BUCKETS_MS = {250, 500, 1000, 2000, 4000, 8000, 16000, 32000};
+
+    struct request
+    {
+      bool include_rounds; // If set, also return the timings of each of the recent rounds.
+
+      KV_MAP_SERIALIZABLE
+    };
+
+    struct stage
+    {
+      std::string type;               // The Pulse message type, e.g. "Handshake" or "Block Template".
+      std::vector<uint64_t> histogram; // Time from the start of a round until each message of this type arrived.
+
+      KV_MAP_SERIALIZABLE
+    };
+
+    struct validator
+    {
+      std::string pubkey;              // The service node's public key
+      uint64_t messages;               // The number of messages received from it
+      std::vector<uint64_t> histogram; // How long after the first message of the same type and round each of its messages arrived.
+
+      KV_MAP_SERIALIZABLE
+    };
+
+    struct failure
+    {
+      std::string reason; // Why rounds failed
+      uint64_t count;     // How many of the recent rounds failed for this reason
+
+      KV_MAP_SERIALIZABLE
+    };
+
+    struct arrival
+    {
+      std::string type;    // The Pulse message type
+      std::string sender;  // The public key of the service node that sent the message
+      uint64_t latency_ms; // Time from the start of the round until the message arrived
+
+      KV_MAP_SERIALIZABLE
+    };
+
+    struct round
+    {
+      uint64_t height;               // The height of the block the round was for
+      uint8_t round;                 // The Pulse round
+      std::string node_name;         // Our part in the round: "V[n]" for validator n, or "W[0]" for the block producer
+      std::string failure;           // Why the round failed; omitted if we completed our part in the round
+      std::vector<arrival> arrivals; // The messages received in the round, in order of arrival
+
+      KV_MAP_SERIALIZABLE
+    };
+
+    struct response
+    {
+      std::vector<uint64_t> buckets_ms;  // The upper bounds of the histogram buckets, see BUCKETS_MS
+      uint64_t rounds;                   // The number of recent rounds the statistics cover
+      std::vector<stage> stages;         // Arrival times per message type
+      std::vector<validator> validators; // Message delays per sending service node
+      std::vector<failure> failures;     // The failed rounds, by failure reason
+      std::vector<round> recent_rounds;  // The timings of each round, oldest first, if `include_rounds` was requested
+      std::string status;                // Generic RPC error code. "OK" is the success value.
+
+      KV_MAP_SERIALIZABLE
+    };
+  };
+
+  OXEN_RPC_DOC_INTROSPECT
+  // Get per-command statistics of the RPC requests (over HTTP and OxenMQ) handled since the daemon
+  // started, for finding expensive commands and sizing RPC nodes.
+  struct GET_RPC_STATS : RPC_COMMAND
+  {
+    static constexpr auto names() { return NAMES("get_rpc_stats"); }
+
+    // Upper bounds, in milliseconds, of the latency histogram buckets; each histogram has one more
+    // count at the end for the values at or above the last bound.
+    static constexpr std::array<uint64_t, 8> BUCKETS_MS = {1, 5, 10, 50, 100, 500, 1000, 5000};
+
+    struct request : EMPTY {};
+
+    struct command
+    {
+      std::string name;                // The command name (the primary one, for commands with aliases)
+      uint64_t calls;                  // The number of requests
+      uint64_t errors;                 // The number of requests that failed with an error (rather than replying with a non-OK status)
+      std::vector<uint64_t> histogram; // The time taken to handle each request
+      uint64_t total_us;               // The total time taken to handle requests, in microseconds
+      uint64_t queued;                 // The number of requests with a known queue wait (currently just HTTP requests)
+      uint64_t queue_wait_us;          // The total time those requests waited for a worker thread, in microseconds
+      uint64_t request_bytes;          // The total size of the request bodies
+      uint64_t response_bytes;         // The total size of the successful responses
+
+      KV_MAP_SERIALIZABLE
+    };
+
+    struct response
+    {
+      std::vector<uint64_t> buckets_ms; // The upper bounds of the histogram buckets, see BUCKETS_MS
+      std::vector<command> commands;    // The commands that have been called, most total time first
+      std::string status;               // Generic RPC error code. "OK" is the success value.
+
+      KV_MAP_SERIALIZABLE
+    };
+  };
+
+  OXEN_RPC_DOC_INTROSPECT
+  // Get the daemon-wide metrics that subsystems (blockchain, tx pool, sync queue, service nodes, ONS,
+  // HTTP RPC) register: counters, gauges and histograms.  With --rpc-metrics the same metrics are
+  // also served for Prometheus at /metrics.
+  struct GET_METRICS : RPC_COMMAND
+  {
+    static constexpr auto names() { return NAMES("get_metrics"); }
+
+    struct request : EMPTY {};
+
+    struct metric
+    {
+      std::string name;                  // The metric name, e.g. "oxend_blocks_added_total"
+      std::string type;                  // One of "counter", "gauge" or "histogram"
+      std::string help;                  // What the metric measures
+      double value;                      // The value of a counter or gauge
+      uint64_t count;                    // The number of values a histogram has observed
+      double sum;                        // The sum of the values a histogram has observed
+      std::vector<double> bucket_max;    // The largest value each non-empty histogram bucket can hold
+      std::vector<uint64_t> bucket_count; // The number of values in each of those buckets
+
+      KV_MAP_SERIALIZABLE
+    };
+
+    struct lock_site
+    {
+      std::string location;              // The module+0xoffset address that took the lock
+      uint64_t count;                    // How many times it took the lock
+      double wait;                       // Total seconds it waited for the lock
+      double hold;                       // Total seconds it held the lock for
+
+      KV_MAP_SERIALIZABLE
+    };
+
+    struct lock
+    {
+      std::string name;                  // The lock name, as in its oxend_lock_<name>_* metrics
+      std::vector<lock_site> sites;      // The call sites that held the lock longest in total
+
+      KV_MAP_SERIALIZABLE
+    };
+
+    struct response
+    {
+      std::vector<metric> metrics; // Every registered metric, sorted by name
+      std::vector<lock> locks;     // The top call sites of each instrumented lock; only in builds configured with -DLOCK_STATS=ON
+      std::string status;          // Generic RPC error code. "OK" is the success value.
+
+      KV_MAP_SERIALIZABLE
+    };
+  };
+
+  OXEN_RPC_DOC_INTROSPECT
+  // Control the daemon's span tracer, which records where threads spend time in block and tx
+  // processing, RPC and p2p handling (including every PERF_TIMER), and fetch what it recorded in
+  // Chrome trace JSON format (viewable with chrome://tracing or https://ui.perfetto.dev).
+  struct TRACE : RPC_COMMAND
+  {
+    static constexpr auto names() { return NAMES("trace"); }
+
+    struct request
+    {
+      std::optional<bool> enable; // If given, starts (true) or stops (false) recording spans
+      bool clear;                 // If true, discards the recorded spans (after dumping them, if requested)
+      bool dump;                  // If true, returns the recorded spans in `trace`
+
+      KV_MAP_SERIALIZABLE
+    };
+
+    struct response
+    {
+      bool enabled;       // Whether spans are being recorded (after applying the request)
+      std::string trace;  // The Chrome trace JSON document, if `dump` was requested
+      std::string status; // Generic RPC error code. "OK" is the success value.
+
+      KV_MAP_SERIALIZABLE
+    };
+  };
+
+  OXEN_RPC_DOC_INTROSPECT
+  // Control the daemon's built-in sampling CPU profiler and fetch the stacks it sampled, in the
+  // collapsed-stack format read by flamegraph.pl and speedscope.  Frames are module+offset
+  // addresses, to be symbolised offline (e.g. with addr2line) against the same oxend build.
+  // Linux only.
+  struct PROFILE : RPC_COMMAND
+  {
+    static constexpr auto names() { return NAMES("profile"); }
+
+    struct request
+    {
+      std::optional<bool> enable; // If given, starts (true; discarding the previous profile) or stops (false) sampling
+      uint32_t frequency;         // Samples per CPU-second when starting; defaults to 99
+      bool dump;                  // If true, returns the samples taken in `profile`
+
+      KV_MAP_SERIALIZABLE
+    };
+
+    struct response
+    {
+      bool running;        // Whether the profiler is sampling (after applying the request)
+      uint64_t samples;    // The number of samples taken
+      uint64_t dropped;    // The number of samples lost because the sample buffer was full
+      std::string profile; // The collapsed stacks, if `dump` was requested
+      std::string status;  // Generic RPC error code. "OK" is the success value.
+
+      KV_MAP_SERIALIZABLE
+    };
+  };
+
   // Deliberately undocumented; this RPC call is really only useful for testing purposes to reset
   // the resync idle timer (which normally fires every 60s) for the test suite.
   struct TEST_TRIGGER_P2P_RESYNC : RPC_COMMAND
@@ -2555,6 +2893,204 @@ namespace rpc {
     };
   };
 
+  OXEN_RPC_DOC_INTROSPECT
+  // Performs many simple ONS lookups at once, each resolved as by ONS_RESOLVE (see its description
+  // for how the returned values are decrypted).
+  struct ONS_RESOLVE_BATCH : PUBLIC
+  {
+    static constexpr auto names() { return NAMES("ons_resolve_batch"); }
+
+    static constexpr size_t MAX_REQUEST_ENTRIES = 256;
+    struct request
+    {
+      std::vector<ONS_RESOLVE::request> entries; // The names to look up, each given by its `type` and `name_hash` as for ONS_RESOLVE.
+
+      KV_MAP_SERIALIZABLE
+    };
+
+    struct response
+    {
+      std::vector<ONS_RESOLVE::response> entries; // One result per request entry, in the same order; `encrypted_value` and `nonce` are omitted from the result of a name that is not registered.
+      std::string status; // Generic RPC error code. "OK" is the success value.
+
+      KV_MAP_SERIALIZABLE
+    };
+  };
+
+  OXEN_RPC_DOC_INTROSPECT
+  // Registers an account with the daemon's light wallet index, so that light wallets can get their
+  // outputs and history from get_address_info, get_address_txs and get_unspent_outs instead of
+  // downloading blocks.  This and the other light wallet calls follow the MyMonero/OpenMonero light
+  // wallet API, and are only available when the daemon runs with --light-wallet-index.  Note that
+  // they hand the daemon the account's secret view key.
+  //
+  // Once registered, the daemon scans every new block for the account's outputs, and also the
+  // blocks since `start_height` if given.  Registrations are kept in memory only, so wallets should
+  // log in again whenever they connect.
+  struct LIGHT_WALLET_LOGIN : PUBLIC, LEGACY
+  {
+    static constexpr auto names() { return NAMES("login"); }
+
+    struct request
+    {
+      std::string address;                  // The account's main address.
+      std::string view_key;                 // The account's secret view key, in hex.
+      bool create_account;                  // Register the account if it isn't registered yet.
+      std::optional<uint64_t> start_height; // The height to scan from when registering; defaults to the current height.
+
+      KV_MAP_SERIALIZABLE
+    };
+
+    struct response
+    {
+      std::string status; // "success", or "error" (with the reason in `reason`).
+      std::string reason; // Why the request failed.
+      bool new_address;   // True if this call registered the account.
+
+      KV_MAP_SERIALIZABLE
+    };
+  };
+
+  // A key image whose ring includes an output of a light wallet account.  Only the wallet can tell
+  // whether it is an actual spend of the output or the output was used as a decoy.
+  struct light_wallet_spent_output
+  {
+    uint64_t amount;        // The amount of the account's output.
+    std::string key_image;  // The key image of the spending input.
+    std::string tx_pub_key; // The (possibly additional) tx pubkey of the account's output.
+    uint64_t out_index;     // The index of the account's output in its transaction.
+    uint32_t mixin;         // The number of other ring members of the spending input.
+
+    KV_MAP_SERIALIZABLE
+  };
+
+  OXEN_RPC_DOC_INTROSPECT
+  // Get the totals of a light wallet account registered by LIGHT_WALLET_LOGIN.
+  struct LIGHT_WALLET_GET_ADDRESS_INFO : PUBLIC, LEGACY
+  {
+    static constexpr auto names() { return NAMES("get_address_info"); }
+
+    struct request
+    {
+      std::string address;  // The account's main address.
+      std::string view_key; // The account's secret view key, in hex.
+
+      KV_MAP_SERIALIZABLE
+    };
+
+    struct response
+    {
+      uint64_t locked_funds;                               // The total of received outputs that are still locked.
+      uint64_t total_received;                             // The total of all received outputs.
+      uint64_t total_sent;                                 // The total of the outputs in `spent_outputs`, which includes decoys.
+      uint64_t scanned_height;                             // All blocks below this height have been scanned.
+      uint64_t scanned_block_height;                       // Same as `scanned_height`.
+      uint64_t start_height;                               // The height the account was scanned from.
+      uint64_t transaction_height;                         // Same as `scanned_height`.
+      uint64_t blockchain_height;                          // The current blockchain height.
+      std::vector<light_wallet_spent_output> spent_outputs; // Possible spends of the account's outputs.
+      std::string status;                                  // "success", or "error" (with the reason in `reason`).
+      std::string reason;                                  // Why the request failed.
+
+      KV_MAP_SERIALIZABLE
+    };
+  };
+
+  OXEN_RPC_DOC_INTROSPECT
+  // Get the transactions of a light wallet account registered by LIGHT_WALLET_LOGIN: those that
+  // paid it, and those that may have spent its outputs.
+  struct LIGHT_WALLET_GET_ADDRESS_TXS : PUBLIC, LEGACY
+  {
+    static constexpr auto names() { return NAMES("get_address_txs"); }
+
+    struct request
+    {
+      std::string address;  // The account's main address.
+      std::string view_key; // The account's secret view key, in hex.
+
+      KV_MAP_SERIALIZABLE
+    };
+
+    struct transaction
+    {
+      uint64_t id;                                         // Sequence number of the transaction in this list.
+      std::string hash;                                    // The transaction hash.
+      uint64_t timestamp;                                  // The timestamp of the block containing the transaction.
+      uint64_t total_received;                             // The total of the outputs the account received in this transaction.
+      uint64_t total_sent;                                 // The total of the outputs in `spent_outputs`, which includes decoys.
+      uint64_t unlock_time;                                // The transaction unlock time.
+      uint64_t height;                                     // The height of the block containing the transaction.
+      std::vector<light_wallet_spent_output> spent_outputs; // Possible spends of the account's outputs.
+      std::string payment_id;                              // The decrypted short payment id, zero-padded to 64 hex digits (all zeros if none).
+      bool coinbase;                                       // True for miner transactions.
+      bool mempool;                                        // Always false: pool transactions are not indexed.
+      uint32_t mixin;                                      // The number of other ring members of the first possibly spending input.
+
+      KV_MAP_SERIALIZABLE
+    };
+
+    struct response
+    {
+      uint64_t total_received;                 // The total of all received outputs.
+      uint64_t scanned_height;                 // All blocks below this height have been scanned.
+      uint64_t scanned_block_height;           // Same as `scanned_height`.
+      uint64_t start_height;                   // The height the account was scanned from.
+      uint64_t blockchain_height;              // The current blockchain height.
+      std::vector<transaction> transactions;   // The account's transactions, in blockchain order.
+      std::string status;                      // "success", or "error" (with the reason in `reason`).
+      std::string reason;                      // Why the request failed.
+
+      KV_MAP_SERIALIZABLE
+    };
+  };
+
+  OXEN_RPC_DOC_INTROSPECT
+  // Get the outputs received by a light wallet account registered by LIGHT_WALLET_LOGIN, with the
+  // key images that may have spent each of them.
+  struct LIGHT_WALLET_GET_UNSPENT_OUTS : PUBLIC, LEGACY
+  {
+    static constexpr auto names() { return NAMES("get_unspent_outs"); }
+
+    struct request
+    {
+      std::string amount;         // Ignored (the minimum total the wallet wants to spend).
+      std::string address;        // The account's main address.
+      std::string view_key;       // The account's secret view key, in hex.
+      uint64_t mixin;             // Ignored.
+      bool use_dust;              // If false, leave out outputs below `dust_threshold`.
+      std::string dust_threshold; // The dust threshold, in atomic units.
+
+      KV_MAP_SERIALIZABLE
+    };
+
+    struct output
+    {
+      uint64_t amount;                           // The output amount.
+      std::string public_key;                    // The output key.
+      uint64_t index;                            // The index of the output in its transaction.
+      uint64_t global_index;                     // The global output index.
+      std::string rct;                           // Empty for non-RingCT outputs, otherwise the commitment, encrypted mask (zero for compact ECDH) and encrypted amount (zero-padded to 32 bytes), in hex.
+      std::string tx_hash;                       // The hash of the receiving transaction.
+      std::string tx_pub_key;                    // The (possibly additional) tx pubkey the output was derived from.
+      std::vector<std::string> spend_key_images; // The key images of the inputs that may have spent the output.
+      uint64_t timestamp;                        // The timestamp of the block containing the receiving transaction.
+      uint64_t height;                           // The height of the block containing the receiving transaction.
+
+      KV_MAP_SERIALIZABLE
+    };
+
+    struct response
+    {
+      uint64_t amount;             // The total of the returned outputs.
+      std::vector<output> outputs; // The account's outputs.
+      uint64_t per_kb_fee;         // The current fee per kB.
+      std::string status;          // "success", or "error" (with the reason in `reason`).
+      std::string reason;          // Why the request failed.
+
+      KV_MAP_SERIALIZABLE
+    };
+  };
+
   OXEN_RPC_DOC_INTROSPECT
   // Clear TXs from the daemon cache, currently only the cache storing TX hashes that were previously verified bad by the daemon.
   struct FLUSH_CACHE : RPC_COMMAND
@@ -2578,6 +3114,7 @@ namespace rpc {
   using core_rpc_types = tools::type_list<
     GET_HEIGHT,
     GET_BLOCKS_FAST,
+    GET_BLOCKS_SCAN_BIN,
     GET_BLOCKS_BY_HEIGHT,
     GET_ALT_BLOCKS_HASHES,
     GET_HASHES_FAST,
@@ -2651,11 +3188,21 @@ namespace rpc {
     GET_CHECKPOINTS,
     GET_SN_STATE_CHANGES,
     REPORT_PEER_STATUS,
+    GET_PULSE_STATS,
+    GET_RPC_STATS,
+    GET_METRICS,
+    TRACE,
+    PROFILE,
     TEST_TRIGGER_P2P_RESYNC,
     TEST_TRIGGER_UPTIME_PROOF,
     ONS_NAMES_TO_OWNERS,
     ONS_OWNERS_TO_NAMES,
     ONS_RESOLVE,
+    ONS_RESOLVE_BATCH,
+    LIGHT_WALLET_LOGIN,
+    LIGHT_WALLET_GET_ADDRESS_INFO,
+    LIGHT_WALLET_GET_ADDRESS_TXS,
+    LIGHT_WALLET_GET_UNSPENT_OUTS,
     FLUSH_CACHE
   >;
 
@@ -2,6 +2,7 @@
 #include <chrono>
 #include <regex>
 #include <cpr/cpr.h>
+#include "common/oxen.h"
 #include "common/string_util.h"
 #include "cpr/ssl_options.h"
 
@@ -32,7 +33,7 @@ void http_client::set_timeout(std::chrono::milliseconds timeout_) {
     timeout = timeout_;
   else
     timeout.reset();
-  apply_timeout = true;
+  params_version++;
 }
 
 std::chrono::milliseconds http_client::get_timeout() const {
@@ -41,9 +42,15 @@ std::chrono::milliseconds http_client::get_timeout() const {
 }
 
 void http_client::cancel() {
-  // We *don't* take a session lock here, which is a little dirty, but resetting the timeout seems
-  // small enough as to not cause issues when done from another thread.
-  session.SetTimeout(1ms);
+  // We *don't* wait for busy sessions to come back here, which is a little dirty, but resetting the
+  // timeout seems small enough as to not cause issues when done from another thread.
+  std::lock_guard lock{session_mutex};
+  for (auto& s : sessions) {
+    if (s.busy) {
+      s.session.SetTimeout(1ms);
+      s.params_version = 0;
+    }
+  }
 }
 
 http_client::WipedAuth::WipedAuth(std::string_view username, std::string_view password)
@@ -65,11 +72,11 @@ void http_client::set_auth(std::string_view username, std::string_view password)
   if (username.empty() && password.empty()) {
     if (auth) {
       auth.reset();
-      apply_auth = true;
+      params_version++;
     }
   } else {
     auth.emplace(username, password);
-    apply_auth = true;
+    params_version++;
   }
 }
 
@@ -77,7 +84,7 @@ void http_client::set_proxy(std::string proxy_) {
   std::lock_guard lock{params_mutex};
   if (proxy != proxy_) {
     proxy = std::move(proxy_);
-    apply_proxy = true;
+    params_version++;
   }
 }
 
@@ -91,11 +98,11 @@ void http_client::set_https_client_cert(std::string cert_path, std::string key_p
   if (cert_path.empty() || key_path.empty()) {
     if (client_cert) {
       client_cert.reset();
-      apply_ssl = true;
+      params_version++;
     }
   } else {
     client_cert.emplace(std::move(cert_path), std::move(key_path));
-    apply_ssl = true;
+    params_version++;
   }
 }
 
@@ -103,7 +110,7 @@ void http_client::set_insecure_https(bool insecure) {
   std::lock_guard lock{params_mutex};
   if (insecure != !verify_https) {
     verify_https = !insecure;
-    apply_ssl = true;
+    params_version++;
   }
 }
 
@@ -112,10 +119,11 @@ void http_client::set_https_cainfo(std::string cainfo_bundle_path) {
   if (cainfo_bundle_path.empty()) {
     if (ca_info) {
       ca_info.reset();
-      apply_ssl = true;
+      params_version++;
     }
   } else {
     ca_info.emplace(std::move(cainfo_bundle_path));
+    params_version++;
   }
 }
 
@@ -128,6 +136,75 @@ void http_client::copy_params_from(const http_client& other) {
   base_url = other.base_url;
   timeout = other.timeout;
   auth = other.auth;
+  params_version++;
+}
+
+void http_client::set_max_connections(size_t max) {
+  std::lock_guard lock{session_mutex};
+  max_sessions = std::max<size_t>(max, 1);
+  session_cv.notify_all();
+}
+
+namespace {
+
+// The connection cache, TLS sessions and DNS cache shared by all of our curl handles.  Never freed:
+// sessions of static http_clients can outlive any point at which we could clean it up.
+CURLSH* curl_share() {
+  static CURLSH* share = [] {
+    static std::mutex locks[CURL_LOCK_DATA_LAST];
+    CURLSH* sh = curl_share_init();
+    curl_share_setopt(sh, CURLSHOPT_LOCKFUNC, +[](CURL*, curl_lock_data data, curl_lock_access, void*) {
+      locks[data].lock();
+    });
+    curl_share_setopt(sh, CURLSHOPT_UNLOCKFUNC, +[](CURL*, curl_lock_data data, void*) {
+      locks[data].unlock();
+    });
+    curl_share_setopt(sh, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    curl_share_setopt(sh, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(sh, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    return sh;
+  }();
+  return share;
+}
+
+}
+
+http_client::pooled_session::pooled_session() {
+  session.SetUserAgent("oxen rpc client v" + std::string{OXEN_VERSION_STR});
+  auto* handle = session.GetCurlHolder()->handle;
+  // Offer every encoding curl can decode (so gzip, for oxend's large responses); curl
+  // decompresses the response before we see it.
+  curl_easy_setopt(handle, CURLOPT_ACCEPT_ENCODING, "");
+  // Negotiate HTTP/2 over https if the remote supports it; plain http stays HTTP/1.1
+  curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+  curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+  curl_easy_setopt(handle, CURLOPT_SHARE, curl_share());
+}
+
+http_client::pooled_session& http_client::acquire_session() {
+  std::unique_lock lock{session_mutex};
+  for (;;) {
+    for (auto& s : sessions) {
+      if (!s.busy) {
+        s.busy = true;
+        return s;
+      }
+    }
+    if (sessions.size() < max_sessions) {
+      auto& s = sessions.emplace_back();
+      s.busy = true;
+      return s;
+    }
+    session_cv.wait(lock);
+  }
+}
+
+void http_client::release_session(pooled_session& s) {
+  std::lock_guard lock{session_mutex};
+  s.busy = false;
+  if (sessions.size() > max_sessions)
+    sessions.remove_if([&s](const auto& x) { return &x == &s; });
+  session_cv.notify_one();
 }
 
 
@@ -137,68 +214,51 @@ cpr::Response http_client::post(const std::string& uri, cpr::Body body, cpr::Hea
 
   cpr::Response res;
   {
+    auto& ps = acquire_session();
+    OXEN_DEFER { release_session(ps); };
+    auto& session = ps.session;
+
     std::shared_lock plock{params_mutex};
     std::chrono::steady_clock::time_point start;
     if (LOG_ENABLED(Debug))
       start = std::chrono::steady_clock::now();
     auto url = base_url + uri;
 
-    // See if we need to update any of the session paramters; we do it here with only the parameter
-    // lock, then actually load the setting below once we have the session lock.
-    std::optional<cpr::Timeout> new_timeout;
-    if (apply_timeout) {
-      new_timeout = timeout ? *timeout : cpr::Timeout{0ms};
-      apply_timeout = false;
-    }
-    std::optional<cpr::Authentication> new_auth;
-    if (apply_auth) {
-      new_auth = auth ? *auth : cpr::Authentication{"", ""};
-      apply_auth = false;
-    }
-    std::optional<cpr::Proxies> new_proxy;
-    if (apply_proxy) {
+    // Bring the session up to date with any parameters changed since its last request
+    if (ps.params_version != params_version) {
+      session.SetTimeout(timeout ? *timeout : cpr::Timeout{0ms});
+      session.SetAuth(auth ? *auth : cpr::Authentication{"", ""});
       if (proxy.empty())
-        new_proxy.emplace();
+        session.SetProxies(cpr::Proxies{});
       else
-        new_proxy = cpr::Proxies{{{"http", proxy}, {"https", proxy}}};
-      apply_proxy = false;
-    }
+        session.SetProxies(cpr::Proxies{{{"http", proxy}, {"https", proxy}}});
 
-    std::optional<cpr::SslOptions> new_ssl_opts;
-    if (apply_ssl) {
-      new_ssl_opts.emplace();
+      cpr::SslOptions ssl_opts;
       if (client_cert) {
-        new_ssl_opts->SetOption(client_cert->first);
-        new_ssl_opts->SetOption(client_cert->second);
+        ssl_opts.SetOption(client_cert->first);
+        ssl_opts.SetOption(client_cert->second);
       }
       if (!verify_https) {
         MWARNING("HTTPS certificate verification disabled; this connection is not secure");
-        new_ssl_opts->SetOption(cpr::ssl::VerifyHost(false));
-        new_ssl_opts->SetOption(cpr::ssl::VerifyPeer(false));
-        new_ssl_opts->SetOption(cpr::ssl::VerifyStatus(false));
+        ssl_opts.SetOption(cpr::ssl::VerifyHost(false));
+        ssl_opts.SetOption(cpr::ssl::VerifyPeer(false));
+        ssl_opts.SetOption(cpr::ssl::VerifyStatus(false));
       }
       if (ca_info) {
-        new_ssl_opts->SetOption(*ca_info);
+        ssl_opts.SetOption(*ca_info);
       }
+      session.SetSslOptions(ssl_opts);
+      ps.params_version = params_version;
     }
 
     plock.unlock();
 
-    {
-      std::lock_guard slock{session_mutex};
+    MDEBUG("Submitting post request to " << url);
+    session.SetUrl(url);
+    session.SetHeader(header);
+    session.SetBody(std::move(body));
 
-      if (new_auth) session.SetAuth(*new_auth);
-      if (new_timeout) session.SetTimeout(*new_timeout);
-      if (new_proxy) session.SetProxies(*std::move(new_proxy));
-      if (new_ssl_opts) session.SetSslOptions(*new_ssl_opts);
-
-      MDEBUG("Submitting post request to " << url);
-      session.SetUrl(url);
-      session.SetHeader(header);
-      session.SetBody(std::move(body));
-
-      res = session.Post();
-    }
+    res = session.Post();
 
     MDEBUG(url << ": " <<
         (res.error.code != cpr::ErrorCode::OK ? res.error.message : res.status_line) <<
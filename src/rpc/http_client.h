@@ -1,5 +1,7 @@
 #pragma once
 #include <chrono>
+#include <condition_variable>
+#include <list>
 #include <stdexcept>
 #include <mutex>
 #include <shared_mutex>
@@ -16,6 +18,7 @@
 #include <cpr/cprtypes.h>
 #include <cpr/error.h>
 #include <cpr/auth.h>
+#include <cpr/curlholder.h>
 
 namespace cryptonote::rpc {
 
@@ -59,9 +62,12 @@ public:
 
 /// Class for accessing a remote node for binary, json, or json rpc requests
 ///
-/// This class is thread-safe but not multithreaded (i.e. only one thread can be making a request at
-/// a time).  Parameters (such as base_url) have their own lock and can be set even while a request
-/// is underway in another thread (the changed parameters will not take effect until the next
+/// This class is thread-safe, and concurrent requests run in parallel over a small pool of
+/// keep-alive sessions (see set_max_connections()).  The connections themselves, along with TLS
+/// sessions and DNS lookups, are shared by every http_client in the process, so a new session to a
+/// remote that another client already talks to usually skips the connect and TLS handshake.
+/// Parameters (such as base_url) have their own lock and can be set even while a request is
+/// underway in another thread (the changed parameters will not take effect until the next
 /// request).
 class http_client
 {
@@ -73,7 +79,6 @@ public:
   {
     if (!base_url_.empty())
       set_base_url(std::move(base_url_));
-    session.SetUserAgent("oxen rpc client v" + std::string{OXEN_VERSION_STR});
   }
 
   /// Sets the base_url to the given one. Will have / appended if it doesn't already end in /.  The
@@ -140,6 +145,10 @@ public:
   /// insecure.
   void set_insecure_https(bool insecure);
 
+  /// Sets the maximum number of requests this client makes at once, and so the number of
+  /// connections it keeps open; further requests wait for one of them to finish.  Default 4.
+  void set_max_connections(size_t max);
+
   /// Copies parameters (base url, timeout, authentication) from another http_client.
   void copy_params_from(const http_client& other);
 
@@ -266,7 +275,18 @@ private:
     ~WipedAuth() override;
   };
 
-  cpr::Session session;
+  struct pooled_session {
+    pooled_session();
+    cpr::Session session;
+    bool busy = false; // guarded by session_mutex
+    // The params_version last applied to `session`; 0 forces a reapply (e.g. after a cancel)
+    std::atomic<uint64_t> params_version = 0;
+  };
+
+  // Takes an idle session from the pool (or adds one), waiting while max_sessions are busy
+  pooled_session& acquire_session();
+  void release_session(pooled_session& s);
+
   cpr::Url base_url;
   std::optional<cpr::Timeout> timeout{15s};
   std::optional<WipedAuth> auth;
@@ -274,11 +294,15 @@ private:
   std::optional<std::pair<cpr::ssl::CertFile, cpr::ssl::KeyFile>> client_cert;
   bool verify_https = true;
   std::optional<cpr::ssl::CaInfo> ca_info;
-  // Whether we need to apply the above to the session when making the next request
-  bool apply_timeout = true, apply_auth = false, apply_proxy = false, apply_ssl = false;
+  // Incremented whenever one of the above changes, so that each session picks up the change on its
+  // next request
+  uint64_t params_version = 1;
 
   mutable std::shared_mutex params_mutex;
-  mutable std::mutex session_mutex;
+  std::mutex session_mutex;
+  std::condition_variable session_cv;
+  std::list<pooled_session> sessions;
+  size_t max_sessions = 4;
   std::atomic<int> json_rpc_id = 0;
 
   std::atomic<uint64_t> bytes_sent = 0;
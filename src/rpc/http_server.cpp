@@ -1,11 +1,13 @@
 
 #include "http_server.h"
+#include <algorithm>
 #include <chrono>
 #include <exception>
 #include <oxenmq/base64.h>
 #include <boost/endian/conversion.hpp>
 #include <oxenmq/variant.h>
 #include "common/command_line.h"
+#include "common/compression.h"
 #include "common/string_util.h"
 #include "cryptonote_config.h"
 #include "cryptonote_core/cryptonote_core.h"
@@ -39,6 +41,47 @@ namespace cryptonote::rpc {
     }
   };
 
+  const command_line::arg_descriptor<unsigned> http_server::arg_rpc_public_threads{
+    "rpc-public-threads",
+    "Number of threads handling public HTTP RPC connections, each running its own event loop on the --rpc-public "
+      "addresses.  More than one requires SO_REUSEPORT support (e.g. Linux).",
+    1
+  };
+
+  const command_line::arg_descriptor<unsigned> http_server::arg_rpc_public_max_requests{
+    "rpc-public-max-requests",
+    "Maximum number of public RPC requests being processed or waiting to be processed at once; further requests "
+      "get a 429 response.  Expensive requests (such as get_outs and get_blocks.bin) are limited to half of this.  "
+      "0 means unlimited.",
+    256
+  };
+
+  const command_line::arg_descriptor<double> http_server::arg_rpc_public_rate_limit{
+    "rpc-public-rate-limit",
+    "Maximum sustained rate, in requests per second, of public RPC requests accepted from one IP address; further "
+      "requests get a 429 response.  0 means unlimited.",
+    0
+  };
+
+  const command_line::arg_descriptor<unsigned> http_server::arg_rpc_public_rate_burst{
+    "rpc-public-rate-burst",
+    "Number of public RPC requests accepted at once from an IP address that has been idle, on top of "
+      "--rpc-public-rate-limit.",
+    50
+  };
+
+  const command_line::arg_descriptor<unsigned> http_server::arg_rpc_public_max_batch{
+    "rpc-public-max-batch",
+    "Maximum number of requests in one public JSON RPC batch request. 0 means unlimited.",
+    100
+  };
+
+  const command_line::arg_descriptor<bool> http_server::arg_rpc_metrics{
+    "rpc-metrics",
+    "Serve per-command RPC statistics and the daemon metrics in the Prometheus text format at /metrics on the --rpc-admin addresses.",
+    false
+  };
+
   const command_line::arg_descriptor<uint16_t> http_server::arg_rpc_bind_port = {
       "rpc-bind-port",
       "Port for RPC server; deprecated, use --rpc-public or --rpc-admin instead.",
@@ -72,6 +115,12 @@ namespace cryptonote::rpc {
   {
     command_line::add_arg(desc, arg_rpc_public);
     command_line::add_arg(desc, arg_rpc_admin);
+    command_line::add_arg(desc, arg_rpc_public_threads);
+    command_line::add_arg(desc, arg_rpc_public_max_requests);
+    command_line::add_arg(desc, arg_rpc_public_rate_limit);
+    command_line::add_arg(desc, arg_rpc_public_rate_burst);
+    command_line::add_arg(desc, arg_rpc_public_max_batch);
+    command_line::add_arg(desc, arg_rpc_metrics);
 
     command_line::add_arg(hidden, arg_rpc_bind_port);
     command_line::add_arg(hidden, arg_rpc_restricted_bind_port);
@@ -86,81 +135,102 @@ namespace cryptonote::rpc {
       core_rpc_server& server,
       rpc_args rpc_config,
       bool restricted,
-      std::vector<std::tuple<std::string, uint16_t, bool>> bind)
-    : m_server{server}, m_restricted{restricted}
+      std::vector<std::tuple<std::string, uint16_t, bool>> bind,
+      unsigned threads,
+      bool metrics)
+    : m_server{server}, m_restricted{restricted}, m_metrics{metrics && !restricted}
   {
+    m_login = rpc_config.login;
+
+    m_cors = {rpc_config.access_control_origins.begin(), rpc_config.access_control_origins.end()};
+
     // uWS is designed to work from a single thread, which is good (we pull off the requests and
     // then stick them into the LMQ job queue to be scheduled along with other jobs).  But as a
     // consequence, we need to create everything inside that thread.  We *also* need to get the
     // (thread local) event loop pointer back from the thread so that we can shut it down later
     // (injecting a callback into it is one of the few thread-safe things we can do across threads).
+    // To use more than one thread we run several such loops, each with its own uWS::App.
     //
-    // Things we need in the owning thread, fulfilled from the http thread:
+    // Things we need in the owning thread, fulfilled from each http thread:
 
     // - the uWS::Loop* for the event loop thread (which is thread_local).  We can get this during
     //   thread startup, after the thread does basic initialization.
-    std::promise<uWS::Loop*> loop_promise;
-    auto loop_future = loop_promise.get_future();
-
+    //
     // - the us_listen_socket_t* on which the server is listening.  We can't get this until we
     //   actually start listening, so wait until `start()` for it.  (We also double-purpose it to
     //   send back an exception if one fires during startup).
-    std::promise<std::vector<us_listen_socket_t*>> startup_success_promise;
-    m_startup_success = startup_success_promise.get_future();
-
-    // Things we need to send from the owning thread to the event loop thread:
-    // - a signal when the thread should bind to the port and start the event loop (when we call
-    //   start()).
-    //m_startup_promise
-
-    m_rpc_thread = std::thread{[this, rpc_config=std::move(rpc_config), bind=std::move(bind)] (
-        std::promise<uWS::Loop*> loop_promise,
-        std::future<bool> startup_future,
-        std::promise<std::vector<us_listen_socket_t*>> startup_success) {
-      uWS::App http;
-      try {
-        create_rpc_endpoints(http);
-      } catch (...) {
-        loop_promise.set_exception(std::current_exception());
-        return;
+    //
+    // Things we need to send from the owning thread to the event loop threads:
+    // - a signal when the threads should bind to the port and start the event loop (when we call
+    //   start()).  This is m_startup_promise, shared by all the threads.
+    std::shared_future<bool> startup_future = m_startup_promise.get_future();
+
+    m_loops.resize(std::max(threads, 1u));
+    try {
+      for (auto& l : m_loops) {
+        std::promise<uWS::Loop*> loop_promise;
+        auto loop_future = loop_promise.get_future();
+        std::promise<std::vector<us_listen_socket_t*>> startup_success_promise;
+        l.startup_success = startup_success_promise.get_future();
+        l.thread = std::thread{&http_server::run_loop, this, bind,
+          std::move(loop_promise), startup_future, std::move(startup_success_promise)};
+        l.loop = loop_future.get();
       }
-      loop_promise.set_value(uWS::Loop::get());
-      if (!startup_future.get())
-        // False means cancel, i.e. we got destroyed/shutdown without start() being called
-        return;
+    } catch (...) {
+      // Tell any loops we already started to give up, then let them finish
+      m_startup_promise.set_value(false);
+      for (auto& l : m_loops)
+        if (l.thread.joinable())
+          l.thread.join();
+      throw;
+    }
 
-      m_login = rpc_config.login;
+    m_loop = m_loops.front().loop;
+  }
 
-      m_cors = {rpc_config.access_control_origins.begin(), rpc_config.access_control_origins.end()};
+  void http_server::run_loop(
+      std::vector<std::tuple<std::string, uint16_t, bool>> bind,
+      std::promise<uWS::Loop*> loop_promise,
+      std::shared_future<bool> startup_future,
+      std::promise<std::vector<us_listen_socket_t*>> startup_success)
+  {
+    uWS::App http;
+    try {
+      create_rpc_endpoints(http);
+    } catch (...) {
+      loop_promise.set_exception(std::current_exception());
+      return;
+    }
+    loop_promise.set_value(uWS::Loop::get());
+    if (!startup_future.get())
+      // False means cancel, i.e. we got destroyed/shutdown without start() being called
+      return;
 
-      std::vector<us_listen_socket_t*> listening;
-      try {
-        bool required_bind_failed = false;
-        for (const auto& [addr, port, required] : bind)
-          http.listen(addr, port, [&listening, req=required, &required_bind_failed](us_listen_socket_t* sock) {
-            if (sock) listening.push_back(sock);
-            else if (req) required_bind_failed = true;
-          });
+    std::vector<us_listen_socket_t*> listening;
+    try {
+      bool required_bind_failed = false;
+      for (const auto& [addr, port, required] : bind)
+        http.listen(addr, port, [&listening, req=required, &required_bind_failed](us_listen_socket_t* sock) {
+          if (sock) listening.push_back(sock);
+          else if (req) required_bind_failed = true;
+        });
 
-        if (listening.empty() || required_bind_failed) {
-          std::ostringstream error;
-          error << "RPC HTTP server failed to bind; ";
-          if (listening.empty()) error << "no valid bind address(es) given";
-          error << "tried to bind to:";
-          for (const auto& [addr, port, required] : bind)
-            error << ' ' << addr << ':' << port;
-          throw std::runtime_error(error.str());
-        }
-      } catch (...) {
-        startup_success.set_exception(std::current_exception());
-        return;
+      if (listening.empty() || required_bind_failed) {
+        std::ostringstream error;
+        error << "RPC HTTP server failed to bind; ";
+        if (listening.empty()) error << "no valid bind address(es) given";
+        error << "tried to bind to:";
+        for (const auto& [addr, port, required] : bind)
+          error << ' ' << addr << ':' << port;
+        throw std::runtime_error(error.str());
       }
-      startup_success.set_value(std::move(listening));
-
-      http.run();
-    }, std::move(loop_promise), m_startup_promise.get_future(), std::move(startup_success_promise)};
+    } catch (...) {
+      startup_success.set_exception(std::current_exception());
+      return;
+    }
+    startup_success.set_value(std::move(listening));
 
-    m_loop = loop_future.get();
+    http.run();
   }
 
   void http_server::create_rpc_endpoints(uWS::App& http)
@@ -188,6 +258,15 @@ namespace cryptonote::rpc {
       handle_json_rpc_request(*res, *req);
     });
 
+    if (m_metrics)
+      http.get("/metrics", [this](HttpResponse* res, HttpRequest* req) {
+        if (m_login && !check_auth(*req, *res))
+          return;
+        res->writeHeader("Server", m_server_header);
+        res->writeHeader("Content-Type", "text/plain; version=0.0.4");
+        res->end(m_server.rpc_stats_prometheus());
+      });
+
     // Fallback to send a 404 for anything else:
     http.any("/*", [this](HttpResponse* res, HttpRequest* req) {
       if (m_login && !check_auth(*req, *res))
@@ -211,13 +290,19 @@ namespace cryptonote::rpc {
     bool jsonrpc{false};
     std::string jsonrpc_id; // pre-formatted json value
     std::vector<std::pair<std::string, std::string>> extra_headers; // Extra headers to send
+    uWS::Loop* loop{uWS::Loop::get()}; // The event loop of the connection; replies must be written from it
+    std::chrono::steady_clock::time_point queued; // When the request was queued for a worker thread
+    size_t request_bytes{0};
+    bool admitted{false}; // True while we hold one of the server's in-flight request slots
+    bool gzip{false}; // True if the client accepts a gzip-encoded response
 
     // If we have to drop the request because we are overloaded we want to reply with an error (so
     // that we close the connection instead of leaking it and leaving it hanging).  We don't do
     // this, of course, if the request got aborted and replied to.
     ~call_data() {
+      release_admission();
       if (replied || aborted) return;
-      http.loop_defer([&http=http, &res=res, jsonrpc=jsonrpc] {
+      loop->defer([&http=http, &res=res, jsonrpc=jsonrpc] {
         if (jsonrpc)
           http.jsonrpc_error_response(res, -32003, "Server busy, try again later");
         else
@@ -225,6 +310,26 @@ namespace cryptonote::rpc {
       });
     }
 
+    // Takes an in-flight request slot for the call; if the server is full, replies with a 429 and
+    // returns false.
+    bool admit() {
+      if (!http.acquire_in_flight(call->is_heavy)) {
+        MINFO("Rejecting HTTP RPC request for " << uri << " from " << request.context.remote << ": too many requests in progress");
+        replied = true;
+        http.too_many_requests_response(res, 1s);
+        return false;
+      }
+      admitted = true;
+      return true;
+    }
+
+    // Gives back the in-flight request slot, if we hold one
+    void release_admission() {
+      if (!admitted) return;
+      admitted = false;
+      http.release_in_flight(call->is_heavy);
+    }
+
     call_data(const call_data&) = delete;
     call_data(call_data&&) = delete;
     call_data& operator=(const call_data&) = delete;
@@ -247,28 +352,111 @@ namespace cryptonote::rpc {
     }
   };
 
+  // Large responses are written this much at a time, continuing as the socket becomes writable
+  // again, so that uWS only has to buffer the unsent part of one chunk rather than a copy of
+  // (almost) the whole response.
+  constexpr size_t RESPONSE_WRITE_CHUNK = 64 * 1024;
+
+  // A response being written: the body pieces and how far through them we have got.
+  struct pending_response {
+    std::shared_ptr<call_data> data;
+    std::vector<std::string> body;
+    size_t piece = 0;
+    size_t offset = 0;
+
+    // Writes chunks until the socket applies backpressure (returning false) or the whole body has
+    // been written and the response ended (returning true).  Pieces are freed once written.
+    bool write_more() {
+      auto& res = data->res;
+      while (piece < body.size()) {
+        auto& p = body[piece];
+        auto chunk = std::string_view{p}.substr(offset, RESPONSE_WRITE_CHUNK);
+        // An empty write would end uWS's chunked encoding, so skip empty pieces
+        bool ok = chunk.empty() || res.write(chunk);
+        offset += chunk.size();
+        if (offset >= p.size()) {
+          p.clear();
+          p.shrink_to_fit();
+          piece++;
+          offset = 0;
+        }
+        if (!ok)
+          return false;
+      }
+      res.end();
+      if (data->http.closing()) res.close();
+      return true;
+    }
+  };
+
+  // Responses smaller than this aren't worth compressing
+  constexpr size_t MIN_COMPRESS_RESPONSE = 1024;
+
+  // True if an Accept-Encoding request header value allows gzip (without refusing it with q=0)
+  bool accepts_gzip(std::string_view accept_encoding)
+  {
+    for (auto coding : tools::split(accept_encoding, ",", true))
+    {
+      auto params = tools::split(coding, ";");
+      tools::trim(params[0]);
+      if (params[0] != "gzip"sv)
+        continue;
+      for (size_t i = 1; i < params.size(); i++)
+      {
+        tools::trim(params[i]);
+        if (params[i].size() > 2 && params[i].substr(0, 2) == "q="sv && params[i].find_first_not_of("0.", 2) == std::string_view::npos)
+          return false;
+      }
+      return true;
+    }
+    return false;
+  }
+
   // Queues a response for the HTTP thread to handle; the response can be in multiple string pieces
-  // to be concatenated together.
+  // to be concatenated together.  If the client accepts it, a large response is gzipped first,
+  // here, which is on the worker thread that produced it rather than the HTTP thread.
   void queue_response(std::shared_ptr<call_data> data, std::vector<std::string> body)
   {
-    auto& http = data->http;
+    if (data->gzip)
+    {
+      size_t bytes = 0;
+      for (const auto& b : body) bytes += b.size();
+      if (bytes >= MIN_COMPRESS_RESPONSE)
+      {
+        std::string joined;
+        if (body.size() == 1)
+          joined = std::move(body.front());
+        else
+        {
+          joined.reserve(bytes);
+          for (const auto& b : body) joined += b;
+        }
+        body.clear();
+        body.push_back(tools::compress(joined, true /*gzip*/));
+        data->extra_headers.emplace_back("Content-Encoding", "gzip");
+      }
+      data->extra_headers.emplace_back("Vary", "Accept-Encoding");
+    }
+
+    auto* loop = data->loop;
     data->replied = true;
-    http.loop_defer([data=std::move(data), body=std::move(body)] {
+    loop->defer([data=std::move(data), body=std::move(body)]() mutable {
       if (data->aborted)
         return;
-      data->res.cork([data=std::move(data), body=std::move(body)] {
-        auto& res = data->res;
-        res.writeHeader("Server", data->http.server_header());
-        res.writeHeader("Content-Type", data->call->is_binary ? "application/octet-stream"sv : "application/json"sv);
-        if (data->http.closing()) res.writeHeader("Connection", "close");
-        for (const auto& [name, value] : data->extra_headers)
+      auto pending = std::make_shared<pending_response>();
+      pending->data = std::move(data);
+      pending->body = std::move(body);
+      pending->data->res.cork([pending] {
+        auto& data = *pending->data;
+        auto& res = data.res;
+        res.writeHeader("Server", data.http.server_header());
+        res.writeHeader("Content-Type", data.call && data.call->is_binary ? "application/octet-stream"sv : "application/json"sv);
+        if (data.http.closing()) res.writeHeader("Connection", "close");
+        for (const auto& [name, value] : data.extra_headers)
           res.writeHeader(name, value);
 
-        for (const auto& piece : body)
-          res.write(piece);
-
-        res.end();
-        if (data->http.closing()) res.close();
+        if (!pending->write_more())
+          res.onWritable([pending](auto /*offset*/) { return pending->data->aborted || pending->write_more(); });
       });
     });
   }
@@ -283,6 +471,40 @@ namespace cryptonote::rpc {
 
   void invoke_txpool_hashes_bin(std::shared_ptr<call_data> data);
 
+  // The outcome of invoking a command: the serialized result, or else a (non-zero) JSON RPC error
+  // code with the JSON RPC and the plain HTTP error messages.
+  struct call_result {
+    std::string body;
+    int json_error = -32603;
+    std::string json_message = "Internal error";
+    std::string http_message;
+  };
+
+  call_result invoke_command(const rpc_command& call, rpc_request&& request, core_rpc_server& core_rpc, std::string_view uri)
+  {
+    call_result result;
+    try {
+      result.body = call.invoke(std::move(request), core_rpc);
+      result.json_error = 0;
+    } catch (const parse_error& e) {
+      // This isn't really WARNable as it's the client fault; log at info level instead.
+      MINFO("HTTP RPC request '" << uri << "' called with invalid/unparseable data: " << e.what());
+      result.json_error = -32602;
+      result.http_message = "Unable to parse request: "s + e.what();
+      result.json_message = "Invalid params";
+    } catch (const rpc_error& e) {
+      MWARNING("HTTP RPC request '" << uri << "' failed with: " << e.what());
+      result.json_error = e.code;
+      result.json_message = e.message;
+      result.http_message = e.message;
+    } catch (const std::exception& e) {
+      MWARNING("HTTP RPC request '" << uri << "' raised an exception: " << e.what());
+    } catch (...) {
+      MWARNING("HTTP RPC request '" << uri << "' raised an unknown exception");
+    }
+    return result;
+  }
+
   // Invokes the actual RPC request; this is called (via oxenmq) from some random LMQ worker thread,
   // which means we can't just write our reply; instead we have to post it to the uWS loop.
   void invoke_rpc(std::shared_ptr<call_data> dataptr)
@@ -295,45 +517,13 @@ namespace cryptonote::rpc {
       return invoke_txpool_hashes_bin(std::move(dataptr));
 
     const bool time_logging = LOG_ENABLED(Debug);
-    std::chrono::steady_clock::time_point start;
-    if (time_logging)
-      start = std::chrono::steady_clock::now();
+    const auto start = std::chrono::steady_clock::now();
 
-    std::vector<std::string> result;
-    result.reserve(data.jsonrpc ? 3 : 1);
-    if (data.jsonrpc)
-    {
-      result.emplace_back(R"({"jsonrpc":"2.0","id":)");
-      result.back() += data.jsonrpc_id;
-      result.back() += R"(,"result":)";
-    }
-
-    int json_error = -32603;
-    std::string json_message = "Internal error";
-    std::string http_message;
-
-    try {
-      result.push_back(data.call->invoke(std::move(data.request), data.core_rpc));
-      json_error = 0;
-    } catch (const parse_error& e) {
-      // This isn't really WARNable as it's the client fault; log at info level instead.
-      MINFO("HTTP RPC request '" << data.uri << "' called with invalid/unparseable data: " << e.what());
-      json_error = -32602;
-      http_message = "Unable to parse request: "s + e.what();
-      json_message = "Invalid params";
-    } catch (const rpc_error& e) {
-      MWARNING("HTTP RPC request '" << data.uri << "' failed with: " << e.what());
-      json_error = e.code;
-      json_message = e.message;
-      http_message = e.message;
-    } catch (const std::exception& e) {
-      MWARNING("HTTP RPC request '" << data.uri << "' raised an exception: " << e.what());
-    } catch (...) {
-      MWARNING("HTTP RPC request '" << data.uri << "' raised an unknown exception");
-    }
+    auto [body, json_error, json_message, http_message] = invoke_command(*data.call, std::move(data.request), data.core_rpc, data.uri);
 
     if (json_error != 0) {
-      data.http.loop_defer([data=std::move(dataptr), json_error, msg=std::move(data.jsonrpc ? json_message : http_message)] {
+      data.core_rpc.record_rpc_call(*data.call, false, std::chrono::steady_clock::now() - start, start - data.queued, data.request_bytes, 0);
+      data.loop->defer([data=std::move(dataptr), json_error=json_error, msg=std::move(data.jsonrpc ? json_message : http_message)] {
         if (data->jsonrpc)
           data->jsonrpc_error_response(data->res, json_error, msg);
         else
@@ -342,24 +532,190 @@ namespace cryptonote::rpc {
       return;
     }
 
+    std::vector<std::string> result;
+    result.reserve(data.jsonrpc ? 3 : 1);
+    if (data.jsonrpc)
+    {
+      result.emplace_back(R"({"jsonrpc":"2.0","id":)");
+      result.back() += data.jsonrpc_id;
+      result.back() += R"(,"result":)";
+    }
+    result.push_back(std::move(body));
     if (data.jsonrpc)
       result.emplace_back("}\n");
 
+    const auto duration = std::chrono::steady_clock::now() - start;
+    size_t bytes = 0;
+    for (const auto& r : result) bytes += r.size();
+    data.core_rpc.record_rpc_call(*data.call, true, duration, start - data.queued, data.request_bytes, bytes);
+
     std::string call_duration;
     if (time_logging)
-      call_duration = " in " + tools::friendly_duration(std::chrono::steady_clock::now() - start);
+      call_duration = " in " + tools::friendly_duration(duration);
     if (LOG_ENABLED(Info)) {
-      size_t bytes = 0;
-      for (const auto& r : result) bytes += r.size();
       MINFO("HTTP RPC " << data.uri << " [" << data.request.context.remote << "] OK (" << bytes << " bytes)" << call_duration);
     }
 
     queue_response(std::move(dataptr), std::move(result));
   }
 
-  std::string pool_hashes_response(std::vector<crypto::hash>&& pool_hashes) {
+  // A JSON RPC 2.0 batch: an array of requests, each of which is run as its own task (so that they
+  // run concurrently on the worker threads) and answered in its own slot of `responses`.  The
+  // response array is sent once the last of them finishes.
+  struct batch_data {
+    struct call {
+      const rpc_command* command;
+      rpc_request request;
+      epee::serialization::storage_entry id;
+      size_t index; // The slot of `responses` to answer in
+    };
+    std::shared_ptr<call_data> data; // The HTTP request as a whole
+    std::vector<call> calls;         // The requests to be invoked
+    std::vector<std::string> responses;
+    std::atomic<size_t> remaining{0};
+    std::chrono::steady_clock::time_point queued;
+    size_t admitted = 0; // The calls (from the front) for which we hold an in-flight slot
+
+    ~batch_data() {
+      for (size_t i = 0; i < admitted; i++)
+        data->http.release_in_flight(calls[i].command->is_heavy);
+    }
+  };
+
+  void send_batch_response(batch_data& batch)
+  {
+    std::vector<std::string> body;
+    body.reserve(2 * batch.responses.size() + 1);
+    body.emplace_back("[");
+    for (size_t i = 0; i < batch.responses.size(); i++)
+    {
+      if (i > 0)
+        body.emplace_back(",");
+      body.push_back(std::move(batch.responses[i]));
+    }
+    body.emplace_back("]\n");
+    queue_response(batch.data, std::move(body));
+  }
+
+  void invoke_batch_call(std::shared_ptr<batch_data> batch, size_t i)
+  {
+    auto& call = batch->calls[i];
+    auto& data = *batch->data;
+    if (!data.aborted)
+    {
+      const auto start = std::chrono::steady_clock::now();
+      auto result = invoke_command(*call.command, std::move(call.request), data.core_rpc, call.command->name);
+      const auto duration = std::chrono::steady_clock::now() - start;
+      std::string& response = batch->responses[call.index];
+      if (result.json_error == 0)
+      {
+        std::ostringstream o;
+        epee::serialization::dump_as_json(o, call.id, 0 /*indent*/, false /*newlines*/);
+        response = R"({"jsonrpc":"2.0","id":)" + o.str() + R"(,"result":)";
+        response += result.body;
+        response += '}';
+      }
+      else
+        response = data.http.jsonrpc_error_body(result.json_error, std::move(result.json_message), std::move(call.id));
+      data.core_rpc.record_rpc_call(*call.command, result.json_error == 0, duration, start - batch->queued, 0, result.body.size());
+    }
+    if (--batch->remaining == 0 && !data.aborted)
+      send_batch_response(*batch);
+  }
+
+  // Parses the array of a JSON RPC batch request and queues its calls; replies directly to a batch
+  // that can't be run at all.
+  void handle_json_rpc_batch(std::shared_ptr<call_data> dataptr, std::string_view body, bool restricted, unsigned max_batch)
+  {
+    auto& data = *dataptr;
+    epee::serialization::portable_storage ps;
+    // epee can't parse a top-level array, so parse the batch as the value of an object
+    if (!ps.load_from_json("{\"batch\":"s.append(body) + "}"))
+      return data.jsonrpc_error_response(data.res, -32700, "Parse error");
+    auto* requests = ps.get_array<epee::serialization::section>("batch", nullptr);
+    if (!requests || requests->empty())
+      return data.jsonrpc_error_response(data.res, -32600, "Invalid Request");
+    if (max_batch > 0 && requests->size() > max_batch)
+    {
+      MINFO("Invalid JSON RPC batch request from " << data.request.context.remote << ": " << requests->size() << " requests is more than the maximum of " << max_batch);
+      return data.jsonrpc_error_response(data.res, -32600, "Invalid Request: batch contains more than " + std::to_string(max_batch) + " requests");
+    }
+
+    auto batch = std::make_shared<batch_data>();
+    batch->data = std::move(dataptr);
+    batch->responses.resize(requests->size());
+    batch->calls.reserve(requests->size());
+    for (size_t i = 0; i < requests->size(); i++)
+    {
+      auto& section = (*requests)[i];
+      epee::serialization::storage_entry id{std::string{}};
+      ps.get_value("id", id, &section);
+
+      std::string method;
+      if (!ps.get_value("method", method, &section))
+      {
+        batch->responses[i] = http_server_base::jsonrpc_error_body(-32600, "Invalid Request", std::move(id));
+        continue;
+      }
+      auto it = rpc_commands.find(method);
+      if (it == rpc_commands.end() || it->second->is_binary)
+      {
+        batch->responses[i] = http_server_base::jsonrpc_error_body(-32601, "Method not found", std::move(id));
+        continue;
+      }
+      if (restricted && !it->second->is_public)
+      {
+        batch->responses[i] = http_server_base::jsonrpc_error_body(403, "Forbidden; this command is not available over public RPC", std::move(id));
+        continue;
+      }
+
+      auto& call = batch->calls.emplace_back();
+      call.command = it->second.get();
+      call.request.context = data.request.context;
+      auto& params = var::get<jsonrpc_params>(call.request.body = jsonrpc_params{}).second;
+      if (!ps.get_value("params", params, &section))
+        call.request.body = ""sv;
+      call.id = std::move(id);
+      call.index = i;
+    }
+
+    for (auto& call : batch->calls)
+    {
+      if (!data.http.acquire_in_flight(call.command->is_heavy))
+      {
+        MINFO("Rejecting JSON RPC batch request from " << data.request.context.remote << ": too many requests in progress");
+        data.replied = true;
+        data.http.too_many_requests_response(data.res, 1s);
+        return;
+      }
+      batch->admitted++;
+    }
+
+    MDEBUG("Incoming JSON RPC batch of " << batch->responses.size() << " requests from " << data.request.context.remote);
+    if (batch->calls.empty())
+      return send_batch_response(*batch);
+
+    auto& omq = data.core_rpc.get_core().get_omq();
+    batch->remaining = batch->calls.size();
+    batch->queued = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < batch->calls.size(); i++)
+    {
+      auto& call = batch->calls[i];
+      std::string cat{call.command->is_public ? "rpc" : "admin"};
+      std::string cmd{"jsonrpc:"s.append(call.command->name)}; // Used for LMQ job logging
+      std::string remote{data.request.context.remote};
+      omq.inject_task(std::move(cat), std::move(cmd), std::move(remote), [batch, i] { invoke_batch_call(std::move(batch), i); });
+    }
+  }
+
+  std::string pool_hashes_response(std::vector<crypto::hash>&& pool_hashes, std::optional<std::vector<crypto::hash>>&& blinked = std::nullopt) {
     GET_TRANSACTION_POOL_HASHES_BIN::response res{};
     res.tx_hashes = std::move(pool_hashes);
+    if (blinked)
+    {
+      res.blinked_tx_hashes = std::move(*blinked);
+      res.blinked_included = true;
+    }
     res.status = STATUS_OK;
 
     std::string response;
@@ -383,7 +739,11 @@ namespace cryptonote::rpc {
       throw parse_error{"Failed to parse binary data parameters"};
 
     std::vector<crypto::hash> pool_hashes;
-    data->core_rpc.get_core().get_pool().get_transaction_hashes(pool_hashes, data->request.context.admin, req.blinked_txs_only /*include_only_blinked*/);
+    std::optional<std::vector<crypto::hash>> blinked;
+    if (req.include_blinked && !req.blinked_txs_only)
+      blinked.emplace();
+    data->core_rpc.get_core().get_pool().get_transaction_hashes(pool_hashes, data->request.context.admin, req.blinked_txs_only /*include_only_blinked*/,
+        blinked ? &*blinked : nullptr);
 
     if (req.long_poll)
     {
@@ -391,7 +751,9 @@ namespace cryptonote::rpc {
       for (const auto& h : pool_hashes) checksum ^= h;
 
       if (req.tx_pool_checksum == checksum) {
-        // Hashes match, which means we need to defer this request until later.
+        // Hashes match, which means we need to defer this request until later.  A waiting long poll
+        // isn't doing any work, so it doesn't keep its in-flight slot.
+        data->release_admission();
         std::lock_guard lock{long_poll_mutex};
         MTRACE("Deferring long poll request from " << data->request.context.remote << ": long polling requested and remote's checksum matches current pool (" << checksum << ")");
         long_pollers.emplace_back(std::move(data), std::chrono::steady_clock::now() + GET_TRANSACTION_POOL_HASHES_BIN::long_poll_timeout);
@@ -402,7 +764,7 @@ namespace cryptonote::rpc {
     }
 
     // Either not a long poll request or checksum didn't match
-    queue_response(std::move(data), pool_hashes_response(std::move(pool_hashes)));
+    queue_response(std::move(data), pool_hashes_response(std::move(pool_hashes), std::move(blinked)));
   }
 
   // This get invoked (from cryptonote_core.cpp) whenever the mempool is added to.  We queue
@@ -477,22 +839,33 @@ namespace cryptonote::rpc {
         HttpRequest& req,
         const rpc_command& call)
   {
+    std::string remote = get_remote_address(res);
+    if (auto retry = rate_limit(remote)) {
+      MINFO("Rejecting HTTP RPC request for " << req.getUrl() << " from " << remote << ": rate limit exceeded");
+      return too_many_requests_response(res, *retry);
+    }
+
     std::shared_ptr<call_data> data{new call_data{*this, m_server, res, std::string{req.getUrl()}, &call}};
     auto& request = data->request;
     request.body = ""s;
     request.context.admin = !m_restricted;
     request.context.source = rpc_source::http;
-    request.context.remote = get_remote_address(res);
+    request.context.remote = std::move(remote);
     handle_cors(req, data->extra_headers);
+    data->gzip = accepts_gzip(req.getHeader("accept-encoding"));
     MTRACE("Received " << req.getMethod() << " " << req.getUrl() << " request from " << request.context.remote);
+    if (!data->admit())
+      return;
 
     res.onAborted([data] { data->aborted = true; });
     res.onData([data=std::move(data)](std::string_view d, bool done) mutable {
       var::get<std::string>(data->request.body) += d;
       if (!done)
         return;
+      data->request_bytes = var::get<std::string>(data->request.body).size();
 
       auto& omq = data->core_rpc.get_core().get_omq();
+      data->queued = std::chrono::steady_clock::now();
       std::string cat{data->call->is_public ? "rpc" : "admin"};
       std::string cmd{"http:" + data->uri}; // Used for LMQ job logging; prefixed with http: so we can distinguish it
       std::string remote{data->request.context.remote};
@@ -502,16 +875,23 @@ namespace cryptonote::rpc {
 
   void http_server::handle_json_rpc_request(HttpResponse& res, HttpRequest& req)
   {
+    std::string remote = get_remote_address(res);
+    if (auto retry = rate_limit(remote)) {
+      MINFO("Rejecting JSON RPC request from " << remote << ": rate limit exceeded");
+      return too_many_requests_response(res, *retry);
+    }
+
     std::shared_ptr<call_data> data{new call_data{*this, m_server, res, std::string{req.getUrl()}}};
     data->jsonrpc = true;
     auto& request = data->request;
     request.context.admin = !m_restricted;
     request.context.source = rpc_source::http;
-    request.context.remote = get_remote_address(res);
+    request.context.remote = std::move(remote);
     handle_cors(req, data->extra_headers);
+    data->gzip = accepts_gzip(req.getHeader("accept-encoding"));
 
     res.onAborted([data] { data->aborted = true; });
-    res.onData([buffer=""s, data, restricted=m_restricted](std::string_view d, bool done) mutable {
+    res.onData([buffer=""s, data, restricted=m_restricted, max_batch=m_limits.max_batch](std::string_view d, bool done) mutable {
       if (!done) {
         buffer += d;
         return;
@@ -522,6 +902,10 @@ namespace cryptonote::rpc {
         body = d; // bypass copying the string_view to a string
       else
         body = (buffer += d);
+      data->request_bytes = body.size();
+
+      if (auto start = body.find_first_not_of(" \t\r\n"); start != std::string_view::npos && body[start] == '[')
+        return handle_json_rpc_batch(std::move(data), body, restricted, max_batch);
 
       auto& [ps, st_entry] = var::get<jsonrpc_params>(data->request.body = jsonrpc_params{});
       if(!ps.load_from_json(body))
@@ -553,6 +937,10 @@ namespace cryptonote::rpc {
 
       MDEBUG("Incoming JSON RPC request for " << method << " from " << data->request.context.remote);
 
+      // We can only do this now that we know what the method is
+      if (!data->admit())
+        return;
+
       {
         std::ostringstream o;
         epee::serialization::dump_as_json(o, id, 0 /*indent*/, false /*newlines*/);
@@ -566,6 +954,7 @@ namespace cryptonote::rpc {
         data->request.body = ""sv;
 
       auto& omq = data->core_rpc.get_core().get_omq();
+      data->queued = std::chrono::steady_clock::now();
       std::string cat{data->call->is_public ? "rpc" : "admin"};
       std::string cmd{"jsonrpc:" + method}; // Used for LMQ job logging; prefixed with jsonrpc: so we can distinguish it
       std::string remote{data->request.context.remote};
@@ -586,7 +975,8 @@ namespace cryptonote::rpc {
 
     m_startup_promise.set_value(true);
     m_sent_startup = true;
-    m_listen_socks = m_startup_success.get();
+    for (auto& l : m_loops)
+      l.listen_socks = l.startup_success.get();
 
     auto& omq = m_server.get_core().get_omq();
     if (timer_started.insert(&omq).second)
@@ -595,7 +985,7 @@ namespace cryptonote::rpc {
 
   void http_server::shutdown(bool join)
   {
-    if (!m_rpc_thread.joinable())
+    if (std::none_of(m_loops.begin(), m_loops.end(), [](const auto& l) { return l.thread.joinable(); }))
       return;
 
     if (!m_sent_shutdown)
@@ -606,37 +996,48 @@ namespace cryptonote::rpc {
         m_startup_promise.set_value(false);
         m_sent_startup = true;
       }
-      else if (!m_listen_socks.empty())
+      else
       {
-        loop_defer([this] {
-          MTRACE("closing " << m_listen_socks.size() << " listening sockets");
-          for (auto* s : m_listen_socks)
-            us_listen_socket_close(/*ssl=*/false, s);
-          m_listen_socks.clear();
-
-          m_closing = true;
-
-          {
-            // Destroy any pending long poll connections as well
-            MTRACE("closing pending long poll requests");
-            std::lock_guard lock{long_poll_mutex};
-            for (auto it = long_pollers.begin(); it != long_pollers.end(); )
+        for (auto& l : m_loops)
+        {
+          if (l.listen_socks.empty())
+            continue;
+          l.loop->defer([this, &l] {
+            MTRACE("closing " << l.listen_socks.size() << " listening sockets");
+            for (auto* s : l.listen_socks)
+              us_listen_socket_close(/*ssl=*/false, s);
+            l.listen_socks.clear();
+
+            m_closing = true;
+
             {
-              if (&it->first->http != this)
-                continue; // Belongs to some other http_server instance
-              it->first->aborted = true;
-              it->first->res.close();
-              it = long_pollers.erase(it);
+              // Destroy any pending long poll connections as well
+              MTRACE("closing pending long poll requests");
+              std::lock_guard lock{long_poll_mutex};
+              for (auto it = long_pollers.begin(); it != long_pollers.end(); )
+              {
+                if (&it->first->http != this || it->first->loop != l.loop)
+                {
+                  // Belongs to some other http_server instance or event loop
+                  ++it;
+                  continue;
+                }
+                it->first->aborted = true;
+                it->first->res.close();
+                it = long_pollers.erase(it);
+              }
             }
-          }
-        });
+          });
+        }
       }
       m_sent_shutdown = true;
     }
 
-    MTRACE("joining rpc thread");
+    MTRACE("joining rpc threads");
     if (join)
-      m_rpc_thread.join();
+      for (auto& l : m_loops)
+        if (l.thread.joinable())
+          l.thread.join();
     MTRACE("done shutdown");
   }
 
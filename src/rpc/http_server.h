@@ -47,6 +47,12 @@ namespace cryptonote::rpc {
   public:
     static const command_line::arg_descriptor<std::vector<std::string>> arg_rpc_public;
     static const command_line::arg_descriptor<std::vector<std::string>, false, true, 2> arg_rpc_admin;
+    static const command_line::arg_descriptor<unsigned> arg_rpc_public_threads;
+    static const command_line::arg_descriptor<unsigned> arg_rpc_public_max_requests;
+    static const command_line::arg_descriptor<double> arg_rpc_public_rate_limit;
+    static const command_line::arg_descriptor<unsigned> arg_rpc_public_rate_burst;
+    static const command_line::arg_descriptor<unsigned> arg_rpc_public_max_batch;
+    static const command_line::arg_descriptor<bool> arg_rpc_metrics;
 
     // Deprecated:
     static const command_line::arg_descriptor<uint16_t> arg_rpc_bind_port;
@@ -60,7 +66,9 @@ namespace cryptonote::rpc {
         core_rpc_server& server,
         rpc_args rpc_config,
         bool restricted,
-        std::vector<std::tuple<std::string, uint16_t, bool>> bind // {IP,port,required}
+        std::vector<std::tuple<std::string, uint16_t, bool>> bind, // {IP,port,required}
+        unsigned threads = 1,
+        bool metrics = false // serve Prometheus metrics at /metrics; ignored if restricted
         );
 
     ~http_server() override;
@@ -91,19 +99,40 @@ namespace cryptonote::rpc {
     /// Handles a POST request to /json_rpc.
     void handle_json_rpc_request(HttpResponse& res, HttpRequest& req);
 
+    /// Body of an event loop thread: sets up the endpoints, waits for the startup signal, then
+    /// binds and runs the loop.
+    void run_loop(
+        std::vector<std::tuple<std::string, uint16_t, bool>> bind,
+        std::promise<uWS::Loop*> loop_promise,
+        std::shared_future<bool> startup_future,
+        std::promise<std::vector<us_listen_socket_t*>> startup_success);
+
     // The core rpc server which handles the internal requests
     core_rpc_server& m_server;
-    // A promise we send from outside into the event loop thread to signal it to start.  We sent
-    // "true" to go ahead with binding + starting the event loop, or false to abort.
+    // A promise we send from outside into the event loop threads to signal them to start.  We send
+    // "true" to go ahead with binding + starting the event loops, or false to abort.
     std::promise<bool> m_startup_promise;
-    // A future (promise held by the thread) that delivers us the listening uSockets sockets so
-    // that, when we want to shut down, we can tell uWebSockets to close them (which will then run
-    // off the end of the event loop).  This also doubles to propagate listen exceptions back to us.
-    std::future<std::vector<us_listen_socket_t*>> m_startup_success;
+
+    struct event_loop {
+      // The loop's uWS::Loop* (which is thread_local), so that we can inject callbacks into it
+      uWS::Loop* loop = nullptr;
+      // A future (promise held by the thread) that delivers us the listening uSockets sockets so
+      // that, when we want to shut down, we can tell uWebSockets to close them (which will then
+      // run off the end of the event loop).  This also doubles to propagate listen exceptions back
+      // to us.
+      std::future<std::vector<us_listen_socket_t*>> startup_success;
+      std::vector<us_listen_socket_t*> listen_socks;
+      std::thread thread;
+    };
+    // Our event loops.  With more than one they all listen on the same addresses, and the kernel
+    // spreads incoming connections between them (via SO_REUSEPORT).  m_loop is the first of them.
+    std::vector<event_loop> m_loops;
     // Whether we have sent the startup/shutdown signals
     bool m_sent_startup{false}, m_sent_shutdown{false};
     // Whether this is restricted, i.e. public.  Unrestricted allows admin commands.
     bool m_restricted;
+    // Whether to serve the RPC statistics for Prometheus at /metrics
+    bool m_metrics;
   };
 
 } // namespace cryptonote::rpc
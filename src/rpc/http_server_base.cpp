@@ -1,8 +1,10 @@
 
 #include "http_server_base.h"
+#include <cmath>
 #include <oxenmq/base64.h>
 #include <oxenmq/hex.h>
 #include "common/string_util.h"
+#include "common/metrics.h"
 
 // epee:
 #include "epee/net/jsonrpc_structs.h"
@@ -74,7 +76,7 @@ namespace cryptonote::rpc {
   }
 
   // Similar to the above, but for JSON errors (which are 200 OK + error embedded in JSON)
-  void http_server_base::jsonrpc_error_response(HttpResponse& res, int code, std::string message, std::optional<epee::serialization::storage_entry> id) const
+  std::string http_server_base::jsonrpc_error_body(int code, std::string message, std::optional<epee::serialization::storage_entry> id)
   {
     epee::json_rpc::error_response rsp;
     rsp.jsonrpc = "2.0";
@@ -84,6 +86,12 @@ namespace cryptonote::rpc {
     rsp.error.message = std::move(message);
     std::string body;
     epee::serialization::store_t_to_json(rsp, body);
+    return body;
+  }
+
+  void http_server_base::jsonrpc_error_response(HttpResponse& res, int code, std::string message, std::optional<epee::serialization::storage_entry> id) const
+  {
+    std::string body = jsonrpc_error_body(code, std::move(message), std::move(id));
     if (body.capacity() > body.size())
       body += '\n';
     res.writeStatus("200 OK"sv);
@@ -94,6 +102,95 @@ namespace cryptonote::rpc {
     if (m_closing) res.close();
   }
 
+  void http_server_base::too_many_requests_response(HttpResponse& res, std::chrono::seconds retry_after) const
+  {
+    res.writeStatus(std::to_string(HTTP_TOO_MANY_REQUESTS.first) + " " + std::string{HTTP_TOO_MANY_REQUESTS.second});
+    res.writeHeader("Server", m_server_header);
+    res.writeHeader("Content-Type", "text/plain");
+    res.writeHeader("Retry-After", std::to_string(retry_after.count()));
+    if (m_closing) res.writeHeader("Connection", "close");
+    res.end("Too many requests, try again later\n");
+    if (m_closing) res.close();
+  }
+
+  // Once there are this many addresses with rate limit state we start (at most once a second)
+  // forgetting the ones that have been idle long enough to be back to a full bucket.
+  constexpr size_t RATE_BUCKETS_PRUNE_SIZE = 10000;
+
+  std::optional<std::chrono::seconds> http_server_base::rate_limit(const std::string& remote)
+  {
+    const double rate = m_limits.ip_rate;
+    if (rate <= 0)
+      return std::nullopt;
+    const double burst = std::max(m_limits.ip_burst, 1u);
+    auto now = std::chrono::steady_clock::now();
+    auto refilled = [&](const token_bucket& b) {
+      return std::min(burst, b.tokens + std::chrono::duration<double>(now - b.updated).count() * rate);
+    };
+
+    std::lock_guard lock{m_rate_limit_mutex};
+    if (m_rate_buckets.size() >= RATE_BUCKETS_PRUNE_SIZE && now - m_rate_buckets_pruned >= 1s)
+    {
+      for (auto it = m_rate_buckets.begin(); it != m_rate_buckets.end(); )
+      {
+        if (refilled(it->second) >= burst)
+          it = m_rate_buckets.erase(it);
+        else
+          ++it;
+      }
+      m_rate_buckets_pruned = now;
+    }
+
+    auto& bucket = m_rate_buckets.try_emplace(remote, token_bucket{burst, now}).first->second;
+    bucket.tokens = refilled(bucket);
+    bucket.updated = now;
+    if (bucket.tokens >= 1)
+    {
+      bucket.tokens -= 1;
+      return std::nullopt;
+    }
+    return std::chrono::seconds{static_cast<long>(std::ceil((1 - bucket.tokens) / rate))};
+  }
+
+  static tools::metrics::gauge& http_in_flight_metric()
+  {
+    static auto& in_flight = tools::metrics::get_gauge("oxend_http_rpc_requests_in_flight", "HTTP RPC requests currently being handled");
+    return in_flight;
+  }
+
+  bool http_server_base::acquire_in_flight(bool heavy)
+  {
+    static auto& requests = tools::metrics::get_counter("oxend_http_rpc_requests_total", "HTTP RPC requests received");
+    static auto& rejected = tools::metrics::get_counter("oxend_http_rpc_requests_rejected_total", "HTTP RPC requests refused by the concurrent request limits");
+    requests.inc();
+    if (auto n = ++m_in_flight; m_limits.max_in_flight && n > m_limits.max_in_flight)
+    {
+      --m_in_flight;
+      rejected.inc();
+      return false;
+    }
+    if (heavy)
+    {
+      if (auto n = ++m_heavy_in_flight; m_limits.max_heavy_in_flight && n > m_limits.max_heavy_in_flight)
+      {
+        --m_heavy_in_flight;
+        --m_in_flight;
+        rejected.inc();
+        return false;
+      }
+    }
+    http_in_flight_metric().add(1);
+    return true;
+  }
+
+  void http_server_base::release_in_flight(bool heavy)
+  {
+    http_in_flight_metric().add(-1);
+    --m_in_flight;
+    if (heavy)
+      --m_heavy_in_flight;
+  }
+
   std::string http_server_base::get_remote_address(HttpResponse& res) {
     std::ostringstream result;
     bool first = true;
@@ -1,7 +1,11 @@
 #pragma once
 
 #include <uWebSockets/App.h>
+#include <atomic>
+#include <chrono>
 #include <future>
+#include <mutex>
+#include <unordered_map>
 #include <unordered_set>
 #include "epee/storages/portable_storage.h"
 #include "common/password.h"
@@ -42,6 +46,13 @@ namespace cryptonote::rpc {
         std::string message,
         std::optional<epee::serialization::storage_entry> = std::nullopt) const;
 
+    // The JSON body of the above, without a trailing newline; also used for the failed requests
+    // of a JSON RPC batch.
+    static std::string jsonrpc_error_body(
+        int code,
+        std::string message,
+        std::optional<epee::serialization::storage_entry> id = std::nullopt);
+
     // Posts a callback to the uWebSockets thread loop controlling this connection; all writes must
     // be done from that thread, and so this method is provided to defer a callback from another
     // thread into that one.  The function should have signature `void ()`.
@@ -50,6 +61,31 @@ namespace cryptonote::rpc {
       m_loop->defer(std::forward<Func>(f));
     }
 
+    // Sends a 429 Too Many Requests response telling the client when to try again.
+    void too_many_requests_response(HttpResponse& res, std::chrono::seconds retry_after) const;
+
+    /// Limits on the requests the server accepts; 0 means unlimited.  Must be set before the
+    /// server is started.
+    struct request_limits {
+      unsigned max_in_flight = 0;       // Requests accepted but not yet completely answered
+      unsigned max_heavy_in_flight = 0; // Of those, requests for expensive ("heavy") commands
+      double ip_rate = 0;               // Sustained requests per second accepted from one address
+      unsigned ip_burst = 0;            // Requests accepted at once from an address that has been idle
+      unsigned max_batch = 0;           // Requests in one JSON RPC batch
+    };
+    void set_request_limits(request_limits limits) { m_limits = limits; }
+
+    /// Applies the per-address rate limit to a newly arrived request from `remote`.  Returns
+    /// std::nullopt if the request is allowed, otherwise how long the client should wait before
+    /// trying again.
+    std::optional<std::chrono::seconds> rate_limit(const std::string& remote);
+
+    /// Takes one of the in-flight request slots (and one of the heavy ones for a heavy request).
+    /// Returns false if there is none free; otherwise the slot must be given back with
+    /// release_in_flight() once the request has been answered.
+    bool acquire_in_flight(bool heavy);
+    void release_in_flight(bool heavy);
+
     const std::string& server_header() { return m_server_header; }
 
     bool closing() const { return m_closing; }
@@ -59,6 +95,7 @@ namespace cryptonote::rpc {
       HTTP_BAD_REQUEST{400, "Bad Request"sv},
       HTTP_FORBIDDEN{403, "Forbidden"sv},
       HTTP_NOT_FOUND{404, "Not Found"sv},
+      HTTP_TOO_MANY_REQUESTS{429, "Too Many Requests"sv},
       HTTP_ERROR{500, "Internal Server Error"sv},
       HTTP_SERVICE_UNAVAILABLE{503, "Service Unavailable"sv};
 
@@ -85,9 +122,20 @@ namespace cryptonote::rpc {
     // we return it in the ACAO header; otherwise (or if this is empty) we omit the header entirely.
     std::unordered_set<std::string> m_cors;
     // Will be set to true when we're trying to shut down which closes any connections as we reply
-    // to them.  Should only be read/write from inside the uWS loop.
-    bool m_closing = false;
+    // to them.  Should only be set from inside a uWS loop.
+    std::atomic<bool> m_closing = false;
     // If true then always reply with 'Access-Control-Allow-Origin: *' to allow anything.
     bool m_cors_any = false;
+    // Admission control; the counts are of acquired in-flight slots, and the buckets hold the
+    // per-address rate limit state.
+    request_limits m_limits;
+    std::atomic<unsigned> m_in_flight{0}, m_heavy_in_flight{0};
+    struct token_bucket {
+      double tokens;
+      std::chrono::steady_clock::time_point updated;
+    };
+    std::mutex m_rate_limit_mutex;
+    std::unordered_map<std::string, token_bucket> m_rate_buckets;
+    std::chrono::steady_clock::time_point m_rate_buckets_pruned;
   };
 }
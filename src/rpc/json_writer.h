@@ -0,0 +1,101 @@
+#pragma once
+
+#include <charconv>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace cryptonote::rpc {
+
+/// Writes JSON straight into a string, producing exactly what epee's (non-pretty) dump_as_json
+/// would for the same values.  This lets large responses skip building a portable_storage tree
+/// just to walk it again.
+///
+/// Object members must be written in sorted key order, as epee's sections are, and the `field`
+/// methods follow epee's KV serialization rules: empty vectors and empty optionals are omitted.
+class json_writer {
+public:
+  explicit json_writer(std::string& out) : out{out} {}
+
+  void begin_object() { separate(); out += '{'; first = true; }
+  void end_object() { out += '}'; first = false; }
+  void begin_array() { separate(); out += '['; first = true; }
+  void end_array() { out += ']'; first = false; }
+
+  void key(std::string_view k) { separate(); write_string(k); out += ':'; first = true; }
+
+  void value(std::string_view s) { separate(); write_string(s); }
+  void value(const std::string& s) { value(std::string_view{s}); }
+  void value(const char* s) { value(std::string_view{s}); }
+  void value(bool b) { separate(); out += b ? "true" : "false"; }
+  template <typename T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, int> = 0>
+  void value(T v) {
+    separate();
+    char buf[24];
+    auto end = std::to_chars(buf, buf + sizeof(buf), v).ptr;
+    out.append(buf, end - buf);
+  }
+  template <typename T>
+  void value(const std::vector<T>& v) {
+    begin_array();
+    for (const auto& e : v)
+      value(e);
+    end_array();
+  }
+
+  /// Writes "name": value, for any value type accepted by `value()`
+  template <typename T>
+  void field(std::string_view name, const T& v) { key(name); value(v); }
+  template <typename T>
+  void field(std::string_view name, const std::vector<T>& v) {
+    if (v.empty()) return;
+    key(name);
+    value(v);
+  }
+  template <typename T>
+  void field(std::string_view name, const std::optional<T>& v) {
+    if (v) field(name, *v);
+  }
+
+private:
+  void separate() {
+    if (!first) out += ',';
+    first = false;
+  }
+
+  // Same escaping as epee: `"` and `\`, \n and \t, and \u00XX for other control characters.
+  // Copies the runs between escapes in one go, as hex and hash strings never need any.
+  void write_string(std::string_view s) {
+    out += '"';
+    size_t run = 0;
+    for (size_t i = 0; i < s.size(); i++) {
+      auto c = static_cast<unsigned char>(s[i]);
+      if (c >= 0x20 && c != '"' && c != '\\')
+        continue;
+      out.append(s.data() + run, i - run);
+      run = i + 1;
+      if (c == '"' || c == '\\') {
+        out += '\\';
+        out += static_cast<char>(c);
+      } else if (c == '\n')
+        out += "\\n";
+      else if (c == '\t')
+        out += "\\t";
+      else {
+        out += "\\u00";
+        out += c >= 0x10 ? '1' : '0';
+        c &= 0xf;
+        out += static_cast<char>(c < 0xa ? '0' + c : 'a' - 10 + c);
+      }
+    }
+    out.append(s.data() + run, s.size() - run);
+    out += '"';
+  }
+
+  std::string& out;
+  bool first = true;
+};
+
+}
@@ -0,0 +1,388 @@
+#include <algorithm>
+#include <cstring>
+
+#include "light_wallet_index.h"
+#include "crypto/crypto.h"
+#include "crypto/hash.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_basic/tx_extra.h"
+#include "cryptonote_core/cryptonote_core.h"
+#include "ringct/rctOps.h"
+#include "epee/misc_log_ex.h"
+
+#undef OXEN_DEFAULT_LOG_CATEGORY
+#define OXEN_DEFAULT_LOG_CATEGORY "daemon.rpc.light_wallet"
+
+namespace cryptonote::rpc {
+
+  namespace {
+    // Blocks scanned per read transaction; newly registered accounts catch up this many blocks at
+    // a time so that new blocks don't wait behind a long rescan.
+    constexpr uint64_t SCAN_BATCH = 100;
+    // How many of the most recently scanned block hashes are kept per account to detect reorgs.
+    // Anything deeper (which checkpointing makes all but impossible) rescans the account.
+    constexpr size_t REORG_WINDOW = 60;
+
+    crypto::hash8 decrypt_payment_id(crypto::hash8 payment_id, const crypto::key_derivation& derivation)
+    {
+      char data[sizeof(derivation) + 1];
+      std::memcpy(data, &derivation, sizeof(derivation));
+      data[sizeof(derivation)] = config::HASH_KEY_ENCRYPTED_PAYMENT_ID;
+      const crypto::hash hash = crypto::cn_fast_hash(data, sizeof(data));
+      for (size_t b = 0; b < sizeof(payment_id.data); ++b)
+        payment_id.data[b] ^= hash.data[b];
+      return payment_id;
+    }
+  }
+
+  // The parts of a transaction needed to scan it, extracted once per block for all accounts
+  struct light_wallet_index::parsed_tx
+  {
+    crypto::hash hash;
+    transaction tx;
+    bool coinbase = false;
+    std::vector<uint64_t> global_indices;
+    crypto::public_key pub_key = crypto::null_pkey;
+    std::vector<crypto::public_key> additional_pub_keys;
+    std::optional<crypto::hash8> payment_id;
+    std::vector<crypto::key_image> key_images;
+    std::vector<uint64_t> ring_amounts;
+    std::vector<std::vector<uint64_t>> rings; // absolute output indices of each input's ring
+
+    void parse_extra_and_inputs()
+    {
+      std::vector<tx_extra_field> fields;
+      parse_tx_extra(tx.extra, fields); // A partial parse still gives us whatever fields precede any garbage
+      tx_extra_pub_key pk;
+      if (find_tx_extra_field_by_type(fields, pk))
+        pub_key = pk.pub_key;
+      tx_extra_additional_pub_keys additional;
+      if (find_tx_extra_field_by_type(fields, additional))
+        additional_pub_keys = std::move(additional.data);
+      tx_extra_nonce nonce;
+      crypto::hash8 pid;
+      if (find_tx_extra_field_by_type(fields, nonce) && get_encrypted_payment_id_from_tx_extra_nonce(nonce.nonce, pid))
+        payment_id = pid;
+
+      for (const auto& in : tx.vin)
+      {
+        if (auto* to_key = std::get_if<txin_to_key>(&in))
+        {
+          key_images.push_back(to_key->k_image);
+          ring_amounts.push_back(to_key->amount);
+          rings.push_back(relative_output_offsets_to_absolute(to_key->key_offsets));
+        }
+      }
+    }
+  };
+
+  light_wallet_index::light_wallet_index(core& c) : m_core{c}
+  {
+    m_core.get_blockchain_storage().hook_block_added(*this);
+    m_core.get_blockchain_storage().hook_blockchain_detached(*this);
+    m_worker = std::thread{[this] { run(); }};
+  }
+
+  light_wallet_index::~light_wallet_index()
+  {
+    {
+      std::lock_guard lock{m_worker_mutex};
+      m_stop = true;
+    }
+    m_worker_cv.notify_one();
+    if (m_worker.joinable())
+      m_worker.join();
+  }
+
+  bool light_wallet_index::add_account(const account_public_address& address, const crypto::secret_key& view_key, std::optional<uint64_t> start_height)
+  {
+    const uint64_t height = m_core.get_current_blockchain_height();
+    {
+      std::unique_lock lock{m_mutex};
+      if (m_accounts.count(address))
+        return false;
+      if (m_accounts.size() >= MAX_ACCOUNTS)
+        throw std::runtime_error{"The light wallet index is full"};
+      auto acc = std::make_shared<account>();
+      acc->address = address;
+      acc->view_key = view_key;
+      acc->data.start_height = acc->data.scanned_height = std::min(start_height.value_or(height), height);
+      MINFO("Registered light wallet account " << get_account_address_as_str(m_core.get_nettype(), false, address) << " from height " << acc->data.start_height);
+      m_accounts.emplace(address, std::move(acc));
+    }
+    wake();
+    return true;
+  }
+
+  std::optional<light_wallet_index::account_data> light_wallet_index::get_account(const account_public_address& address) const
+  {
+    std::shared_ptr<account> acc;
+    {
+      std::shared_lock lock{m_mutex};
+      auto it = m_accounts.find(address);
+      if (it == m_accounts.end())
+        return std::nullopt;
+      acc = it->second;
+    }
+    std::lock_guard lock{acc->mutex};
+    return acc->data;
+  }
+
+  bool light_wallet_index::block_added(const block& block, const std::vector<transaction>& txs, checkpoint_t const* checkpoint)
+  {
+    wake();
+    return true;
+  }
+
+  void light_wallet_index::blockchain_detached(uint64_t height, bool by_pop_blocks)
+  {
+    // The worker notices the replaced blocks by their hashes once the change is committed
+    wake();
+  }
+
+  void light_wallet_index::wake()
+  {
+    {
+      std::lock_guard lock{m_worker_mutex};
+      m_work_pending = true;
+    }
+    m_worker_cv.notify_one();
+  }
+
+  void light_wallet_index::run()
+  {
+    std::unique_lock lock{m_worker_mutex};
+    while (!m_stop)
+    {
+      m_worker_cv.wait(lock, [this] { return m_work_pending || m_stop; });
+      if (m_stop)
+        break;
+      m_work_pending = false;
+      lock.unlock();
+      try
+      {
+        while (!m_stop && scan_batch()) {}
+      }
+      catch (const std::exception& e)
+      {
+        MERROR("Light wallet index scan failed: " << e.what());
+      }
+      lock.lock();
+    }
+  }
+
+  bool light_wallet_index::scan_batch()
+  {
+    std::vector<std::shared_ptr<account>> accounts;
+    {
+      std::shared_lock lock{m_mutex};
+      accounts.reserve(m_accounts.size());
+      for (const auto& [address, acc] : m_accounts)
+        accounts.push_back(acc);
+    }
+    if (accounts.empty())
+      return false;
+
+    // The worker is the only writer of the account data, so it can read it without locking
+    auto& db = m_core.get_blockchain_storage().get_db();
+    db_rtxn_guard rtxn_guard{db};
+    const uint64_t chain_height = db.height();
+
+    // First undo anything scanned from blocks that have since been popped or replaced
+    uint64_t from = chain_height;
+    for (const auto& acc : accounts)
+    {
+      const uint64_t scanned = acc->data.scanned_height;
+      uint64_t good = scanned;
+      while (!acc->recent_hashes.empty() && (good > chain_height || db.get_block_hash_from_height(good - 1) != acc->recent_hashes.back()))
+      {
+        acc->recent_hashes.pop_back();
+        good--;
+      }
+      if (good < scanned)
+      {
+        if (acc->recent_hashes.empty())
+          good = acc->data.start_height;
+        MINFO("Rewinding light wallet account " << get_account_address_as_str(m_core.get_nettype(), false, acc->address) << " from height " << scanned << " to " << good);
+        rewind(*acc, good);
+      }
+      from = std::min(from, acc->data.scanned_height);
+    }
+    if (from >= chain_height)
+      return false;
+
+    const uint64_t to = std::min(chain_height, from + SCAN_BATCH);
+    std::vector<parsed_tx> txs;
+    std::vector<std::string_view> tx_blobs;
+    std::vector<std::vector<uint64_t>> indices;
+    for (uint64_t height = from; height < to; height++)
+    {
+      block blk;
+      if (!parse_and_validate_block_from_blob(db.get_block_blob_view_from_height(height), blk))
+        throw std::runtime_error{"Failed to parse block at height " + std::to_string(height)};
+
+      tx_blobs.clear();
+      if (!blk.tx_hashes.empty() && !db.get_pruned_tx_blob_views_from(blk.tx_hashes.front(), blk.tx_hashes.size(), tx_blobs))
+        throw std::runtime_error{"Failed to retrieve transactions of block at height " + std::to_string(height)};
+      const crypto::hash miner_tx_hash = get_transaction_hash(blk.miner_tx);
+      if (!m_core.get_tx_outputs_gindexs(miner_tx_hash, 1 + blk.tx_hashes.size(), indices))
+        throw std::runtime_error{"Failed to retrieve output indices of block at height " + std::to_string(height)};
+
+      txs.clear();
+      txs.resize(1 + tx_blobs.size());
+      txs[0].hash = miner_tx_hash;
+      txs[0].tx = std::move(blk.miner_tx);
+      txs[0].coinbase = true;
+      for (size_t i = 0; i < tx_blobs.size(); i++)
+      {
+        txs[i + 1].hash = blk.tx_hashes[i];
+        if (!parse_and_validate_tx_base_from_blob(tx_blobs[i], txs[i + 1].tx))
+          throw std::runtime_error{"Failed to parse transaction " + tools::type_to_hex(blk.tx_hashes[i])};
+      }
+      for (size_t i = 0; i < txs.size(); i++)
+      {
+        txs[i].global_indices = std::move(indices[i]);
+        txs[i].parse_extra_and_inputs();
+      }
+
+      const crypto::hash block_hash = db.get_block_hash_from_height(height);
+      for (const auto& acc : accounts)
+      {
+        if (acc->data.scanned_height != height)
+          continue;
+        std::lock_guard lock{acc->mutex};
+        for (const auto& ptx : txs)
+          scan_tx(*acc, ptx, height, blk.timestamp);
+        acc->data.scanned_height = height + 1;
+        acc->recent_hashes.push_back(block_hash);
+        if (acc->recent_hashes.size() > REORG_WINDOW)
+          acc->recent_hashes.pop_front();
+      }
+    }
+
+    return to < chain_height;
+  }
+
+  void light_wallet_index::rewind(account& acc, uint64_t height)
+  {
+    std::lock_guard lock{acc.mutex};
+    auto& data = acc.data;
+    while (!data.txs.empty() && data.txs.back().height >= height)
+      data.txs.pop_back();
+    // Outputs are appended in transaction order, so those of the removed transactions are last
+    while (!data.outputs.empty() && data.outputs.back().tx >= data.txs.size())
+      data.outputs.pop_back();
+    for (auto it = acc.outputs_by_index.begin(); it != acc.outputs_by_index.end(); )
+    {
+      if (it->second >= data.outputs.size())
+        it = acc.outputs_by_index.erase(it);
+      else
+        ++it;
+    }
+    data.scanned_height = std::max(data.start_height, std::min(data.scanned_height, height));
+    if (data.scanned_height == data.start_height)
+      acc.recent_hashes.clear();
+  }
+
+  void light_wallet_index::scan_tx(account& acc, const parsed_tx& ptx, uint64_t height, uint64_t timestamp)
+  {
+    const transaction& tx = ptx.tx;
+    auto& data = acc.data;
+
+    crypto::key_derivation derivation;
+    const bool have_derivation = ptx.pub_key != crypto::null_pkey && crypto::generate_key_derivation(ptx.pub_key, acc.view_key, derivation);
+
+    std::optional<size_t> tx_index;
+    auto record = [&]() -> tx_info& {
+      if (!tx_index)
+      {
+        tx_index = data.txs.size();
+        auto& info = data.txs.emplace_back();
+        info.hash = ptx.hash;
+        info.height = height;
+        info.timestamp = timestamp;
+        info.unlock_time = tx.unlock_time;
+        info.coinbase = ptx.coinbase;
+        info.payment_id = have_derivation && ptx.payment_id ? decrypt_payment_id(*ptx.payment_id, derivation) : crypto::null_hash8;
+      }
+      return data.txs[*tx_index];
+    };
+
+    for (size_t i = 0; i < ptx.key_images.size(); i++)
+    {
+      for (uint64_t index : ptx.rings[i])
+      {
+        if (auto it = acc.outputs_by_index.find({ptx.ring_amounts[i], index}); it != acc.outputs_by_index.end())
+          record().spends.push_back({ptx.key_images[i], it->second, static_cast<uint32_t>(ptx.rings[i].size() - 1)});
+      }
+    }
+
+    // Miner transactions since v2 store their outputs as RingCT outputs with identity masks
+    const bool rct_coinbase = ptx.coinbase && tx.version >= txversion::v2_ringct;
+    const bool rct = !ptx.coinbase && tx.rct_signatures.type != rct::RCTType::Null;
+    const bool compact_ecdh = tools::equals_any(tx.rct_signatures.type, rct::RCTType::Bulletproof2, rct::RCTType::CLSAG);
+    const bool use_additional = ptx.additional_pub_keys.size() == tx.vout.size();
+    for (size_t i = 0; i < tx.vout.size(); i++)
+    {
+      auto* to_key = std::get_if<txout_to_key>(&tx.vout[i].target);
+      if (!to_key)
+        continue;
+
+      crypto::public_key derived;
+      crypto::key_derivation out_derivation;
+      const crypto::public_key* tx_pub_key = nullptr;
+      if (have_derivation && crypto::derive_public_key(derivation, i, acc.address.m_spend_public_key, derived) && derived == to_key->key)
+      {
+        out_derivation = derivation;
+        tx_pub_key = &ptx.pub_key;
+      }
+      else if (use_additional && crypto::generate_key_derivation(ptx.additional_pub_keys[i], acc.view_key, out_derivation) &&
+          crypto::derive_public_key(out_derivation, i, acc.address.m_spend_public_key, derived) && derived == to_key->key)
+      {
+        tx_pub_key = &ptx.additional_pub_keys[i];
+      }
+      if (!tx_pub_key)
+        continue;
+
+      output out{};
+      out.tx_pub_key = *tx_pub_key;
+      out.key = to_key->key;
+      out.index = i;
+      out.global_index = i < ptx.global_indices.size() ? ptx.global_indices[i] : 0;
+      out.unlock_time = tx.get_unlock_time(i);
+      if (rct)
+      {
+        if (i >= tx.rct_signatures.ecdhInfo.size() || i >= tx.rct_signatures.outPk.size())
+          continue;
+        crypto::secret_key scalar;
+        crypto::derivation_to_scalar(out_derivation, i, scalar);
+        rct::ecdhTuple ecdh = tx.rct_signatures.ecdhInfo[i];
+        rct::ecdhDecode(ecdh, rct::sk2rct(scalar), compact_ecdh);
+        out.amount = rct::h2d(ecdh.amount);
+        out.commitment = tx.rct_signatures.outPk[i].mask;
+        if (!rct::equalKeys(rct::commit(out.amount, ecdh.mask), out.commitment))
+        {
+          MWARNING("Output " << i << " of tx " << ptx.hash << " matches a light wallet key but its amount doesn't decode");
+          continue;
+        }
+        out.rct = true;
+        out.encrypted_mask = tx.rct_signatures.ecdhInfo[i].mask;
+        std::memcpy(out.encrypted_amount.data, tx.rct_signatures.ecdhInfo[i].amount.bytes, sizeof(out.encrypted_amount.data));
+      }
+      else
+      {
+        out.amount = tx.vout[i].amount;
+        out.rct = rct_coinbase;
+        out.commitment = rct_coinbase ? rct::zeroCommit(out.amount) : rct::zero();
+        out.encrypted_mask = rct::zero();
+        out.encrypted_amount = crypto::null_hash8;
+      }
+
+      record().outputs.push_back(data.outputs.size());
+      out.tx = *tx_index;
+      acc.outputs_by_index.emplace(std::make_pair(rct || rct_coinbase ? 0 : tx.vout[i].amount, out.global_index), data.outputs.size());
+      data.outputs.push_back(out);
+    }
+  }
+
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "cryptonote_basic/cryptonote_basic_impl.h"
+#include "ringct/rctTypes.h"
+
+namespace cryptonote { class core; }
+
+namespace cryptonote::rpc {
+
+  /// Optional daemon-side index of the outputs of registered accounts, so that light wallets can
+  /// get their balance and history (via get_address_info, get_address_txs and get_unspent_outs)
+  /// without downloading any blocks.
+  ///
+  /// An account is registered with its address and secret view key.  A worker thread, woken by the
+  /// block added and blockchain detached hooks, scans the blocks since the account's start height
+  /// and then every new block against each registered key.  Only the account's main address is
+  /// scanned (light wallets don't do subaddresses).  Without the spend key the index can't tell
+  /// spends from decoys, so every key image whose ring contains one of the account's outputs is
+  /// recorded as a possible spend; the wallet checks which of them are its own.
+  ///
+  /// The index lives in memory only: accounts have to register again after a restart.
+  class light_wallet_index final : public BlockAddedHook, public BlockchainDetachedHook
+  {
+  public:
+    static constexpr size_t MAX_ACCOUNTS = 10000;
+
+    struct output
+    {
+      size_t tx;                     // index of the receiving transaction in account_data::txs
+      crypto::public_key tx_pub_key; // the tx (or additional) pubkey the output was derived from
+      crypto::public_key key;
+      uint64_t amount;
+      uint64_t index;                // index of the output within the transaction
+      uint64_t global_index;
+      uint64_t unlock_time;
+      bool rct;
+      rct::key commitment;
+      rct::key encrypted_mask;       // zero for transactions with compact (v2) ECDH info
+      crypto::hash8 encrypted_amount;
+    };
+
+    struct spend
+    {
+      crypto::key_image key_image;
+      size_t output; // index in account_data::outputs of the ring member belonging to the account
+      uint32_t mixin;
+    };
+
+    struct tx_info
+    {
+      crypto::hash hash;
+      uint64_t height;
+      uint64_t timestamp;
+      uint64_t unlock_time;
+      bool coinbase;
+      crypto::hash8 payment_id;    // decrypted short payment id, or null
+      std::vector<size_t> outputs; // indices in account_data::outputs received by this transaction
+      std::vector<spend> spends;   // possible spends of the account's outputs
+    };
+
+    /// What the index has found for an account so far, in blockchain order.
+    struct account_data
+    {
+      uint64_t start_height = 0;
+      uint64_t scanned_height = 0; // all blocks below this height have been scanned
+      std::vector<output> outputs;
+      std::vector<tx_info> txs;
+    };
+
+    explicit light_wallet_index(core& c);
+    ~light_wallet_index();
+
+    /// Registers an account to be scanned from `start_height` (or from the current height, if
+    /// omitted).  The caller must have checked that `view_key` belongs to `address`.  Returns false
+    /// if the account was already registered (in which case nothing changes), and throws
+    /// std::runtime_error if the index is full.
+    bool add_account(const account_public_address& address, const crypto::secret_key& view_key, std::optional<uint64_t> start_height);
+
+    /// Returns a copy of what has been found for a registered account, or nullopt if the account
+    /// isn't registered.
+    std::optional<account_data> get_account(const account_public_address& address) const;
+
+    bool block_added(const block& block, const std::vector<transaction>& txs, checkpoint_t const* checkpoint) override;
+    void blockchain_detached(uint64_t height, bool by_pop_blocks) override;
+
+  private:
+    struct account
+    {
+      account_public_address address;
+      crypto::secret_key view_key;
+
+      mutable std::mutex mutex;
+      account_data data; // guarded by mutex; only ever modified by the worker
+
+      // Used only by the worker: the hashes of the last scanned blocks (for reorg detection), and
+      // the account's outputs by (amount, global index), to find their spends.
+      std::deque<crypto::hash> recent_hashes;
+      std::map<std::pair<uint64_t, uint64_t>, size_t> outputs_by_index;
+    };
+
+    struct parsed_tx;
+
+    void wake();
+    void run();
+    bool scan_batch();
+    void rewind(account& acc, uint64_t height);
+    void scan_tx(account& acc, const parsed_tx& ptx, uint64_t height, uint64_t timestamp);
+
+    core& m_core;
+
+    mutable std::shared_mutex m_mutex;
+    std::unordered_map<account_public_address, std::shared_ptr<account>> m_accounts;
+
+    std::mutex m_worker_mutex;
+    std::condition_variable m_worker_cv;
+    bool m_work_pending = false;
+    std::atomic<bool> m_stop = false;
+    std::thread m_worker;
+  };
+
+}
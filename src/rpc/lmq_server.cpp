@@ -1,6 +1,9 @@
 
 #include "lmq_server.h"
 #include "oxenmq/oxenmq.h"
+#include "common/oxen.h"
+#include "common/string_util.h"
+#include "oxenmq/hex.h"
 
 #undef OXEN_DEFAULT_LOG_CATEGORY
 #define OXEN_DEFAULT_LOG_CATEGORY "daemon.rpc"
@@ -80,6 +83,68 @@ constexpr std::string_view
   LMQ_BAD_REQUEST{"400"sv},
   LMQ_ERROR{"500"sv};
 
+using sn_entry = GET_SERVICE_NODES::response::entry;
+
+std::string bt_int(uint64_t v) { return oxenmq::bt_serialize(v); }
+std::string bt_version(const std::array<uint16_t, 3>& v) {
+  return oxenmq::bt_serialize(oxenmq::bt_list{uint64_t{v[0]}, uint64_t{v[1]}, uint64_t{v[2]}});
+}
+std::string bt_hex_bytes(const std::string& hex) { return oxenmq::bt_serialize(oxenmq::from_hex(hex)); }
+
+struct sn_field {
+  std::string_view name;
+  std::string (*encode)(const sn_entry& e);
+};
+
+// The fields available through [sub.service_nodes]: the scalar fields of a GET_SERVICE_NODES entry,
+// with keys in bytes rather than hex.  Sorted by name, as bt-encoded dict keys must be.
+constexpr sn_field sn_fields[] = {
+  {"active"sv,                                 [](const sn_entry& e) { return bt_int(e.active); }},
+  {"decommission_count"sv,                     [](const sn_entry& e) { return bt_int(e.decommission_count); }},
+  {"earned_downtime_blocks"sv,                 [](const sn_entry& e) { return oxenmq::bt_serialize(e.earned_downtime_blocks); }},
+  {"funded"sv,                                 [](const sn_entry& e) { return bt_int(e.funded); }},
+  {"last_decommission_reason_consensus_all"sv, [](const sn_entry& e) { return bt_int(e.last_decommission_reason_consensus_all); }},
+  {"last_decommission_reason_consensus_any"sv, [](const sn_entry& e) { return bt_int(e.last_decommission_reason_consensus_any); }},
+  {"last_reward_block_height"sv,               [](const sn_entry& e) { return bt_int(e.last_reward_block_height); }},
+  {"last_reward_transaction_index"sv,          [](const sn_entry& e) { return bt_int(e.last_reward_transaction_index); }},
+  {"last_uptime_proof"sv,                      [](const sn_entry& e) { return bt_int(e.last_uptime_proof); }},
+  {"lokinet_first_unreachable"sv,              [](const sn_entry& e) { return bt_int(e.lokinet_first_unreachable); }},
+  {"lokinet_last_reachable"sv,                 [](const sn_entry& e) { return bt_int(e.lokinet_last_reachable); }},
+  {"lokinet_last_unreachable"sv,               [](const sn_entry& e) { return bt_int(e.lokinet_last_unreachable); }},
+  {"lokinet_reachable"sv,                      [](const sn_entry& e) { return bt_int(e.lokinet_reachable); }},
+  {"lokinet_version"sv,                        [](const sn_entry& e) { return bt_version(e.lokinet_version); }},
+  {"operator_address"sv,                       [](const sn_entry& e) { return oxenmq::bt_serialize(e.operator_address); }},
+  {"portions_for_operator"sv,                  [](const sn_entry& e) { return bt_int(e.portions_for_operator); }},
+  {"pubkey_ed25519"sv,                         [](const sn_entry& e) { return bt_hex_bytes(e.pubkey_ed25519); }},
+  {"pubkey_x25519"sv,                          [](const sn_entry& e) { return bt_hex_bytes(e.pubkey_x25519); }},
+  {"public_ip"sv,                              [](const sn_entry& e) { return oxenmq::bt_serialize(e.public_ip); }},
+  {"quorumnet_port"sv,                         [](const sn_entry& e) { return bt_int(e.quorumnet_port); }},
+  {"registration_height"sv,                    [](const sn_entry& e) { return bt_int(e.registration_height); }},
+  {"registration_hf_version"sv,                [](const sn_entry& e) { return bt_int(e.registration_hf_version); }},
+  {"requested_unlock_height"sv,                [](const sn_entry& e) { return bt_int(e.requested_unlock_height); }},
+  {"service_node_version"sv,                   [](const sn_entry& e) { return bt_version(e.service_node_version); }},
+  {"staking_requirement"sv,                    [](const sn_entry& e) { return bt_int(e.staking_requirement); }},
+  {"state_height"sv,                           [](const sn_entry& e) { return bt_int(e.state_height); }},
+  {"storage_lmq_port"sv,                       [](const sn_entry& e) { return bt_int(e.storage_lmq_port); }},
+  {"storage_port"sv,                           [](const sn_entry& e) { return bt_int(e.storage_port); }},
+  {"storage_server_first_unreachable"sv,       [](const sn_entry& e) { return bt_int(e.storage_server_first_unreachable); }},
+  {"storage_server_last_reachable"sv,          [](const sn_entry& e) { return bt_int(e.storage_server_last_reachable); }},
+  {"storage_server_last_unreachable"sv,        [](const sn_entry& e) { return bt_int(e.storage_server_last_unreachable); }},
+  {"storage_server_reachable"sv,               [](const sn_entry& e) { return bt_int(e.storage_server_reachable); }},
+  {"storage_server_version"sv,                 [](const sn_entry& e) { return bt_version(e.storage_server_version); }},
+  {"swarm_id"sv,                               [](const sn_entry& e) { return bt_int(e.swarm_id); }},
+  {"total_contributed"sv,                      [](const sn_entry& e) { return bt_int(e.total_contributed); }},
+  {"total_reserved"sv,                         [](const sn_entry& e) { return bt_int(e.total_reserved); }},
+};
+
+constexpr bool sn_fields_sorted() {
+  for (size_t i = 1; i < std::size(sn_fields); i++)
+    if (!(sn_fields[i-1].name < sn_fields[i].name))
+      return false;
+  return true;
+}
+static_assert(sn_fields_sorted(), "sn_fields must be sorted by name");
+
 } // end anonymous namespace
 
 
@@ -199,8 +264,20 @@ omq_rpc::omq_rpc(cryptonote::core& core, core_rpc_server& rpc, const boost::prog
       request.context.remote = m.remote;
       request.body = m.data.empty() ? ""sv : m.data[0];
 
+      // OxenMQ doesn't tell us how long the request was queued for, so there's no queue wait here
+      const auto start = std::chrono::steady_clock::now();
+      const size_t request_bytes = m.data.empty() ? 0 : m.data[0].size();
+      bool success = false;
+      size_t response_bytes = 0;
+      OXEN_DEFER {
+        rpc_.record_rpc_call(call, success, std::chrono::steady_clock::now() - start, std::nullopt, request_bytes, response_bytes);
+      };
+
       try {
-        m.send_reply(LMQ_OK, call.invoke(std::move(request), rpc_));
+        auto response = call.invoke(std::move(request), rpc_);
+        success = true;
+        response_bytes = response.size();
+        m.send_reply(LMQ_OK, std::move(response));
         return;
       } catch (const parse_error& e) {
         // This isn't really WARNable as it's the client fault; log at info level instead.
@@ -253,6 +330,15 @@ omq_rpc::omq_rpc(cryptonote::core& core, core_rpc_server& rpc, const boost::prog
   // such as txes that came from an existing block during a rollback).  Note that both txhash and
   // txblob are binary: in particular, txhash is *not* hex-encoded.
   //
+  // [sub.mempool, deltas] instead subscribes to a stream of mempool changes: the node sends
+  // [notify.mempool_delta, seq, type, txhash] where type is "added", "removed" (the tx was mined or
+  // otherwise dropped from the pool) or "blink" (an approved blink tx was added, or approval
+  // arrived for a tx already in the pool), and seq increases by one with each change.  Additions
+  // are the same ones as for [notify.mempool] above, so txes returned to the pool by a reorg are
+  // not reported.  A gap in seq means changes were missed; use [sub.mempool_deltas, seq] (below)
+  // to fetch them.  The "OK"/"ALREADY" reply to a deltas subscription has the current seq as a
+  // second part.
+  //
   omq.add_request_command("sub", "mempool", [this](oxenmq::Message& m) {
 
     if (m.data.size() != 1) {
@@ -265,11 +351,21 @@ omq_rpc::omq_rpc(cryptonote::core& core, core_rpc_server& rpc, const boost::prog
       sub_type = mempool_sub_type::blink;
     else if (m.data[0] == "all"sv)
       sub_type = mempool_sub_type::all;
+    else if (m.data[0] == "deltas"sv)
+      sub_type = mempool_sub_type::deltas;
     else {
       m.send_reply("Invalid mempool subscription type '" + std::string{m.data[0]} + "'");
       return;
     }
 
+    // Taken first (and held) so that a deltas subscriber's seq can't miss a delta sent in between
+    std::unique_lock deltas_lock{deltas_mutex_};
+    auto reply = [&](std::string_view status) {
+      if (sub_type == mempool_sub_type::deltas)
+        m.send_reply(status, std::to_string(mempool_delta_seq_));
+      else
+        m.send_reply(status);
+    };
     {
       std::unique_lock lock{subs_mutex_};
       auto expiry = std::chrono::steady_clock::now() + 30min;
@@ -278,33 +374,83 @@ omq_rpc::omq_rpc(cryptonote::core& core, core_rpc_server& rpc, const boost::prog
         result.first->second.expiry = expiry;
         if (result.first->second.type == sub_type) {
           MTRACE("Renewed mempool subscription request from conn id " << m.conn << " @ " << m.remote);
-          m.send_reply("ALREADY");
+          reply("ALREADY");
           return;
         }
         result.first->second.type = sub_type;
       }
-      MDEBUG("New " << (sub_type == mempool_sub_type::blink ? "blink" : "all") << " mempool subscription request from conn " << m.conn << " @ " << m.remote);
-      m.send_reply("OK");
+      MDEBUG("New " << m.data[0] << " mempool subscription request from conn " << m.conn << " @ " << m.remote);
+      reply("OK");
     }
   });
 
+  // Mempool delta catch-up: [sub.mempool_deltas, seq] returns the changes after `seq` (as sent to
+  // [sub.mempool, deltas] subscribers) as the reply ["OK", current_seq, changes], where changes is
+  // a bt-encoded list of [seq, type, txhash] lists.  If some of the requested changes are no longer
+  // retained the reply is ["RESYNC", current_seq]: the client should refetch the full mempool and
+  // then follow the deltas from current_seq.
+  omq.add_request_command("sub", "mempool_deltas", [this](oxenmq::Message& m) {
+    uint64_t since;
+    if (m.data.size() != 1 || !tools::parse_int(m.data[0], since)) {
+      m.send_reply("Invalid mempool_deltas request: expected a sequence number");
+      return;
+    }
+
+    std::unique_lock lock{deltas_mutex_};
+    auto current = std::to_string(mempool_delta_seq_);
+    if (since > mempool_delta_seq_ || (since < mempool_delta_seq_ &&
+          (mempool_deltas_.empty() || mempool_deltas_.front().seq > since + 1))) {
+      m.send_reply("RESYNC", current);
+      return;
+    }
+    oxenmq::bt_list changes;
+    for (auto it = mempool_deltas_.end() - (mempool_delta_seq_ - since); it != mempool_deltas_.end(); ++it)
+      changes.push_back(oxenmq::bt_list{it->seq, delta_type_name(it->type), std::string{it->txid.data, sizeof(it->txid.data)}});
+    m.send_reply("OK", current, oxenmq::bt_serialize(changes));
+  });
+
   // New block subscriptions: [sub.block].  This sends a notification every time a new block is
   // added to the blockchain.
   //
   // TODO: make this support [sub.block, sn] so that we can receive notification only for blocks
   // that change the SN composition.
   //
-  // The subscription request returns the current [height, blockhash] as a reply.
+  // The subscription request returns "OK" or "ALREADY", as for mempool subscriptions (including the
+  // 30 minute expiry).
   //
   // The block notification for new blocks consists of a message [notify.block, height, blockhash]
   // containing the latest height/hash.  (Note that blockhash is the hash in bytes, *not* the hex
   // encoded block hash).
+  //
+  // [sub.block, headers] instead sends [notify.block_header, header] for each new block, where
+  // header is a bt-encoded dict of:
+  // - "height", "timestamp" and "difficulty" of the block
+  // - "hash" and "prev" -- the block's hash and its parent's hash, in bytes
+  // - "txs" -- list of the hashes (in bytes) of the block's transactions, not including the miner tx
+  // - "winner" -- the pubkey (in bytes) of the service node paid by the block, or 32 null bytes
+  //
+  // Both kinds of subscribers also get [notify.block_detached, height] when blocks are removed from
+  // the top of the chain by a reorg (or pop_blocks): every block at or above `height` is gone, and
+  // the blocks that replace them are notified as usual.
   omq.add_request_command("sub", "block", [this](oxenmq::Message& m) {
-      std::unique_lock lock{subs_mutex_};
+    bool headers = false;
+    if (m.data.size() == 1 && m.data[0] == "headers"sv)
+      headers = true;
+    else if (!m.data.empty()) {
+      m.send_reply("Invalid block subscription type '" + std::string{m.data[0]} + "'");
+      return;
+    }
+    std::unique_lock lock{subs_mutex_};
     auto expiry = std::chrono::steady_clock::now() + 30min;
-    auto result = block_subs_.emplace(m.conn, block_sub{expiry});
+    auto result = block_subs_.emplace(m.conn, block_sub{expiry, headers});
     if (!result.second) {
       result.first->second.expiry = expiry;
+      if (result.first->second.headers != headers) {
+        result.first->second.headers = headers;
+        MDEBUG("Changed block subscription type for conn " << m.conn << " @ " << m.remote);
+        m.send_reply("OK");
+        return;
+      }
       MTRACE("Renewed block subscription request from conn id " << m.conn << " @ " << m.remote);
       m.send_reply("ALREADY");
     } else {
@@ -313,10 +459,143 @@ omq_rpc::omq_rpc(cryptonote::core& core, core_rpc_server& rpc, const boost::prog
     }
   });
 
+  // Block header backfill: [sub.block_headers, height] returns ["OK", headers], where headers is a
+  // bt-encoded list of the headers (as sent to [sub.block, headers] subscribers) of the blocks from
+  // `height` on, at most BLOCK_HEADERS_MAX of them.  A client that missed notifications (or just
+  // subscribed) uses this to catch up, repeating it until it has the current block.
+  omq.add_request_command("sub", "block_headers", [this](oxenmq::Message& m) {
+    uint64_t height;
+    if (m.data.size() != 1 || !tools::parse_int(m.data[0], height)) {
+      m.send_reply("Invalid block_headers request: expected a height");
+      return;
+    }
+    auto& blockchain = core_.get_blockchain_storage();
+    auto& db = blockchain.get_db();
+    db_rtxn_guard rtxn_guard{db};
+    const uint64_t end = std::min(db.height(), height + BLOCK_HEADERS_MAX);
+    std::string headers = "l";
+    for (; height < end; height++) {
+      block b;
+      if (!parse_and_validate_block_from_blob(db.get_block_blob_view_from_height(height), b)) {
+        m.send_reply("Failed to load block at height " + std::to_string(height));
+        return;
+      }
+      headers += block_header(b, height, db.get_block_hash_from_height(height));
+    }
+    headers += 'e';
+    m.send_reply("OK", headers);
+  });
+
+  // Service node list polling: [sub.service_nodes, request] where request is an optional
+  // bt-encoded dict of:
+  // - "fields" -- list of the names of the fields to return (see sn_fields); all of them if omitted
+  // - "height", "version" -- as returned by a previous request, to get only what changed since then
+  // The reply is ["OK", list] where list is a bt-encoded dict of:
+  // - "height", "version" -- identify this state of the list, for the next request
+  // - "full" -- 1 if this is the whole list: the request didn't give a height and version, or they
+  //   are too old (or from before a restart); 0 if only the changes are included
+  // - "nodes" -- dict of the (binary) pubkeys of the nodes in the list (or, if not "full", of those
+  //   added or with a change to one of the requested fields) to dicts of their requested fields
+  // - "removed" -- list of the (binary) pubkeys of nodes removed from the list (if not "full")
+  //
+  // This is meant for clients like lokinet and storage server that poll the list frequently: a
+  // poll between blocks usually only returns the few nodes that sent an uptime proof.
+  omq.add_request_command("sub", "service_nodes", [this](oxenmq::Message& m) {
+    if (m.data.size() > 1) {
+      m.send_reply("Invalid service_nodes request: expected at most one data part");
+      return;
+    }
+    std::vector<size_t> fields;
+    std::optional<uint64_t> since_height, since_version;
+    try {
+      oxenmq::bt_dict_consumer req{m.data.empty() ? "de"sv : m.data[0]};
+      if (req.skip_until("fields")) {
+        for (auto& name : req.consume_list<std::vector<std::string>>()) {
+          auto it = std::lower_bound(std::begin(sn_fields), std::end(sn_fields), name,
+              [](const sn_field& f, std::string_view n) { return f.name < n; });
+          if (it == std::end(sn_fields) || it->name != name) {
+            m.send_reply("Invalid service_nodes request: unknown field '" + name + "'");
+            return;
+          }
+          fields.push_back(it - std::begin(sn_fields));
+        }
+        std::sort(fields.begin(), fields.end());
+        fields.erase(std::unique(fields.begin(), fields.end()), fields.end());
+      }
+      if (req.skip_until("height"))
+        since_height = req.consume_integer<uint64_t>();
+      if (req.skip_until("version"))
+        since_version = req.consume_integer<uint64_t>();
+    } catch (const std::exception& e) {
+      m.send_reply("Invalid service_nodes request: "s + e.what());
+      return;
+    }
+    if (fields.empty())
+      for (size_t i = 0; i < std::size(sn_fields); i++)
+        fields.push_back(i);
+
+    auto current = current_sn_snapshot();
+    std::shared_ptr<const sn_snapshot> base;
+    if (since_height && since_version) {
+      std::lock_guard lock{sn_snapshots_mutex_};
+      for (auto& snapshot : sn_snapshots_)
+        if (snapshot->version == *since_version && snapshot->height == *since_height)
+          base = snapshot;
+    }
+
+    std::vector<std::pair<std::string_view, const sn_record*>> nodes;
+    for (auto& node : current->nodes) {
+      const sn_record& record = *node.second;
+      if (base) {
+        auto it = base->nodes.find(node.first);
+        if (it != base->nodes.end() && (it->second == node.second ||
+              std::all_of(fields.begin(), fields.end(), [&old = *it->second, &record](size_t i) { return old[i] == record[i]; })))
+          continue;
+      }
+      nodes.emplace_back(node.first, &record);
+    }
+    std::sort(nodes.begin(), nodes.end());
+
+    std::vector<std::string_view> removed;
+    if (base)
+      for (auto& node : base->nodes)
+        if (!current->nodes.count(node.first))
+          removed.push_back(node.first);
+    std::sort(removed.begin(), removed.end());
+
+    std::string result = "d";
+    result += oxenmq::bt_serialize("full"sv) + bt_int(!base);
+    result += oxenmq::bt_serialize("height"sv) + bt_int(current->height);
+    result += oxenmq::bt_serialize("nodes"sv) + 'd';
+    for (auto& [pubkey, record] : nodes) {
+      result += oxenmq::bt_serialize(pubkey) + 'd';
+      for (size_t i : fields)
+        result += oxenmq::bt_serialize(sn_fields[i].name) + (*record)[i];
+      result += 'e';
+    }
+    result += 'e';
+    if (base) {
+      result += oxenmq::bt_serialize("removed"sv) + 'l';
+      for (auto& pubkey : removed)
+        result += oxenmq::bt_serialize(pubkey);
+      result += 'e';
+    }
+    result += oxenmq::bt_serialize("version"sv) + bt_int(current->version);
+    result += 'e';
+    m.send_reply("OK", result);
+  });
+
   core_.get_blockchain_storage().hook_block_added(*this);
+  core_.get_blockchain_storage().hook_blockchain_detached(*this);
   core_.get_pool().add_notify([this](const crypto::hash& id, const transaction& tx, const std::string& blob, const tx_pool_options& opts) {
       send_mempool_notifications(id, tx, blob, opts);
   });
+  core_.get_pool().add_remove_notify([this](const crypto::hash& id) {
+      add_mempool_delta(mempool_delta_type::removed, id);
+  });
+  core_.get_pool().add_blink_notify([this](const crypto::hash& id) {
+      add_mempool_delta(mempool_delta_type::blink, id);
+  });
 }
 
 template <typename Mutex, typename Subs, typename Call>
@@ -355,24 +634,123 @@ static void send_notifies(Mutex& mutex, Subs& subs, const char* desc, Call call)
   }
 }
 
+std::string omq_rpc::block_header(const block& b, uint64_t height, const crypto::hash& hash)
+{
+  oxenmq::bt_list txs;
+  for (auto& txid : b.tx_hashes)
+    txs.push_back(std::string{txid.data, sizeof(txid.data)});
+  auto winner = get_service_node_winner_from_tx_extra(b.miner_tx.extra);
+  return oxenmq::bt_serialize(oxenmq::bt_dict{
+    {"difficulty", core_.get_blockchain_storage().block_difficulty(height)},
+    {"hash", std::string{hash.data, sizeof(hash.data)}},
+    {"height", height},
+    {"prev", std::string{b.prev_id.data, sizeof(b.prev_id.data)}},
+    {"timestamp", b.timestamp},
+    {"txs", std::move(txs)},
+    {"winner", std::string{winner.data, sizeof(winner.data)}},
+  });
+}
+
 bool omq_rpc::block_added(const block& block, const std::vector<transaction>& txs, const checkpoint_t *)
 {
   auto& omq = core_.get_omq();
-  std::string height = std::to_string(get_block_height(block));
+  const uint64_t block_height = get_block_height(block);
+  std::string height = std::to_string(block_height);
+  std::optional<std::string> header; // Built on demand, for the first headers subscriber
   send_notifies(subs_mutex_, block_subs_, "block", [&](auto& conn, auto& sub) {
-    omq.send(conn, "notify.block", height, std::string_view{block.hash.data, sizeof(block.hash.data)});
+    if (!sub.headers)
+      omq.send(conn, "notify.block", height, std::string_view{block.hash.data, sizeof(block.hash.data)});
+    else {
+      if (!header)
+        header = block_header(block, block_height, block.hash);
+      omq.send(conn, "notify.block_header", *header);
+    }
   });
 
   return true;
 }
 
+void omq_rpc::blockchain_detached(uint64_t height, bool /*by_pop_blocks*/)
+{
+  auto& omq = core_.get_omq();
+  std::string h = std::to_string(height);
+  send_notifies(subs_mutex_, block_subs_, "block", [&](auto& conn, auto&) {
+    omq.send(conn, "notify.block_detached", h);
+  });
+}
+
 void omq_rpc::send_mempool_notifications(const crypto::hash& id, const transaction& tx, const std::string& blob, const tx_pool_options& opts)
 {
   auto& omq = core_.get_omq();
   send_notifies(subs_mutex_, mempool_subs_, "mempool", [&](auto& conn, auto& sub) {
-    if (sub.type == mempool_sub_type::all || opts.approved_blink)
+    if (sub.type == mempool_sub_type::all || (sub.type == mempool_sub_type::blink && opts.approved_blink))
       omq.send(conn, "notify.mempool", std::string_view{id.data, sizeof(id.data)}, blob);
   });
+  add_mempool_delta(opts.approved_blink ? mempool_delta_type::blink : mempool_delta_type::added, id);
+}
+
+std::string_view omq_rpc::delta_type_name(mempool_delta_type type)
+{
+  switch (type) {
+    case mempool_delta_type::added: return "added"sv;
+    case mempool_delta_type::removed: return "removed"sv;
+    case mempool_delta_type::blink: return "blink"sv;
+  }
+  return "unknown"sv;
+}
+
+std::shared_ptr<const omq_rpc::sn_snapshot> omq_rpc::current_sn_snapshot()
+{
+  const uint64_t height = core_.get_current_blockchain_height() - 1;
+  auto entries = rpc_.get_all_sn_response_entries(height, core_.get_block_id_by_height(height));
+
+  std::lock_guard lock{sn_snapshots_mutex_};
+  std::shared_ptr<const sn_snapshot> prev;
+  if (!sn_snapshots_.empty()) {
+    prev = sn_snapshots_.back();
+    if (prev->entries == entries)
+      return prev;
+  }
+
+  auto snapshot = std::make_shared<sn_snapshot>();
+  snapshot->height = height;
+  snapshot->version = ++sn_snapshot_version_;
+  snapshot->entries = entries;
+  snapshot->nodes.reserve(entries->size());
+  for (auto& entry : *entries) {
+    sn_record record;
+    record.reserve(std::size(sn_fields));
+    for (auto& field : sn_fields)
+      record.push_back(field.encode(entry));
+    auto pubkey = oxenmq::from_hex(entry.service_node_pubkey);
+    std::shared_ptr<const sn_record> shared;
+    if (prev)
+      if (auto it = prev->nodes.find(pubkey); it != prev->nodes.end() && *it->second == record)
+        shared = it->second;
+    if (!shared)
+      shared = std::make_shared<const sn_record>(std::move(record));
+    snapshot->nodes.emplace(std::move(pubkey), std::move(shared));
+  }
+
+  sn_snapshots_.push_back(snapshot);
+  if (sn_snapshots_.size() > SN_SNAPSHOT_HISTORY)
+    sn_snapshots_.pop_front();
+  return snapshot;
+}
+
+void omq_rpc::add_mempool_delta(mempool_delta_type type, const crypto::hash& txid)
+{
+  std::unique_lock lock{deltas_mutex_};
+  auto& delta = mempool_deltas_.emplace_back(mempool_delta{++mempool_delta_seq_, type, txid});
+  if (mempool_deltas_.size() > MEMPOOL_DELTA_HISTORY)
+    mempool_deltas_.pop_front();
+
+  auto& omq = core_.get_omq();
+  auto seq = std::to_string(delta.seq);
+  send_notifies(subs_mutex_, mempool_subs_, "mempool", [&](auto& conn, auto& sub) {
+    if (sub.type == mempool_sub_type::deltas)
+      omq.send(conn, "notify.mempool_delta", seq, delta_type_name(type), std::string_view{txid.data, sizeof(txid.data)});
+  });
 }
 
 
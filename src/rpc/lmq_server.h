@@ -32,6 +32,7 @@
 #include "core_rpc_server.h"
 #include "cryptonote_core/blockchain.h"
 #include "oxenmq/connections.h"
+#include <deque>
 
 namespace oxenmq { class OxenMQ; }
 
@@ -44,9 +45,9 @@ void init_omq_options(boost::program_options::options_description& desc);
  * cryptonote_core--but it works with it to add RPC endpoints, make it listen on RPC ports, and
  * handles RPC requests.
  */
-class omq_rpc final : public cryptonote::BlockAddedHook {
+class omq_rpc final : public cryptonote::BlockAddedHook, public cryptonote::BlockchainDetachedHook {
 
-  enum class mempool_sub_type { all, blink };
+  enum class mempool_sub_type { all, blink, deltas };
   struct mempool_sub {
     std::chrono::steady_clock::time_point expiry;
     mempool_sub_type type;
@@ -54,19 +55,61 @@ class omq_rpc final : public cryptonote::BlockAddedHook {
 
   struct block_sub {
     std::chrono::steady_clock::time_point expiry;
+    bool headers; // [sub.block, headers]: send the compact header rather than just height and hash
   };
 
+  // The most headers returned by one [sub.block_headers, height] request
+  static constexpr uint64_t BLOCK_HEADERS_MAX = 100;
+  // The bt-encoded compact header sent to [sub.block, headers] subscribers
+  std::string block_header(const block& b, uint64_t height, const crypto::hash& hash);
+
   cryptonote::core& core_;
   core_rpc_server& rpc_;
   std::shared_timed_mutex subs_mutex_;
   std::unordered_map<oxenmq::ConnectionID, mempool_sub> mempool_subs_;
   std::unordered_map<oxenmq::ConnectionID, block_sub> block_subs_;
 
+  // Recent mempool changes, each with a sequence number, for [sub.mempool, deltas] subscribers and
+  // for catching up via [sub.mempool_deltas, seq].
+  enum class mempool_delta_type { added, removed, blink };
+  struct mempool_delta {
+    uint64_t seq;
+    mempool_delta_type type;
+    crypto::hash txid;
+  };
+  static constexpr size_t MEMPOOL_DELTA_HISTORY = 10000;
+  std::mutex deltas_mutex_;
+  std::deque<mempool_delta> mempool_deltas_;
+  uint64_t mempool_delta_seq_ = 0; // seq of the most recent delta
+
+  static std::string_view delta_type_name(mempool_delta_type type);
+  void add_mempool_delta(mempool_delta_type type, const crypto::hash& txid);
+
+  // Recent states of the service node list, for [sub.service_nodes] polling.  A node's record holds
+  // its bt-encoded field values (one per sn_fields entry) and is shared with the previous snapshot
+  // when none of them changed.
+  using sn_record = std::vector<std::string>;
+  struct sn_snapshot {
+    uint64_t height;
+    uint64_t version;
+    std::shared_ptr<const std::vector<GET_SERVICE_NODES::response::entry>> entries; // what it was built from
+    std::unordered_map<std::string, std::shared_ptr<const sn_record>> nodes; // by (binary) pubkey
+  };
+  static constexpr size_t SN_SNAPSHOT_HISTORY = 30;
+  std::mutex sn_snapshots_mutex_;
+  std::deque<std::shared_ptr<const sn_snapshot>> sn_snapshots_;
+  uint64_t sn_snapshot_version_ = 0;
+
+  // The snapshot of the current service node list, building it if the list changed
+  std::shared_ptr<const sn_snapshot> current_sn_snapshot();
+
 public:
   omq_rpc(cryptonote::core& core, core_rpc_server& rpc, const boost::program_options::variables_map& vm);
 
   bool block_added(const block& block, const std::vector<transaction>& txs, const checkpoint_t *) override;
 
+  void blockchain_detached(uint64_t height, bool by_pop_blocks) override;
+
   void send_mempool_notifications(const crypto::hash& id, const transaction& tx, const std::string& blob, const tx_pool_options& opts);
 };
 
@@ -35,12 +35,15 @@
 #pragma once
 
 #include <cassert>
+#include <cstring>
 #include <ostream>
 #include <istream>
 #include <iterator>
+#include <stdexcept>
 #include <type_traits>
 #include <string>
 #include <string_view>
+#include <vector>
 #include <boost/endian/conversion.hpp>
 
 #include "base.h"
@@ -168,24 +171,121 @@ public:
   // Returns the current position (i.e. stream.tellg()) of the input stream.
   unsigned int streampos() { return static_cast<unsigned int>(stream_.tellg()); }
 
-protected:
-  // Protected constructor used by binary_string_unarchiver to avoid the seek (because the istream
-  // hasn't been set up yet when this gets called, and because we know the eof position in advance).
-  // You must call enable_stream_exceptions() in the derived constructor.
-  binary_unarchiver(std::istream& s, std::streamoff eof_pos) : stream_{s}, eof_pos_{eof_pos} {}
-
+private:
   // Set up stream exceptions; called during construction.
   void enable_stream_exceptions() {
     exc_restore_ = stream_.exceptions();
     stream_.exceptions(std::istream::badbit | std::istream::failbit | std::istream::eofbit);
   }
 
-private:
   std::istream& stream_;
   std::ios_base::iostate exc_restore_;
   std::streamoff eof_pos_;
 };
 
+/// Deserializer for binary_archiver-serialized data that reads directly from a string_view, without
+/// going through a std::istream: each read checks the remaining length and copies straight out of
+/// the string.  The caller *must* keep the string_view data available for the lifetime of the
+/// unarchiver.  Reading past the end throws a std::runtime_error.
+class binary_string_unarchiver : public deserializer {
+public:
+  using variant_tag_type = binary_variant_tag_type;
+
+  /// Constructor; takes the string_view to deserialize from.  The caller must keep the referenced
+  /// data alive!
+  explicit binary_string_unarchiver(std::string_view s) :
+    begin_{s.data()}, pos_{s.data()}, end_{s.data() + s.size()} {}
+
+  /// Same as above, but taking a vector of uint8_ts
+  explicit binary_string_unarchiver(const std::vector<uint8_t>& s) :
+    binary_string_unarchiver(std::string_view{reinterpret_cast<const char*>(s.data()), s.size()}) {}
+
+  /// Constructing from a std::string temporary is not allowed.
+  binary_string_unarchiver(const std::string&& s) = delete;
+
+  /// Serializes a signed integer (by reinterpreting it as unsigned on the wire)
+  template <class T, std::enable_if_t<std::is_integral_v<T> && std::is_signed_v<T>, int> = 0>
+  void serialize_int(T &v)
+  {
+    serialize_int(reinterpret_cast<std::make_unsigned_t<T>&>(v));
+  }
+
+  /// Serializes an unsigned integer
+  template <class T, std::enable_if_t<std::is_integral_v<T> && std::is_unsigned_v<T>, int> = 0>
+  void serialize_int(T &v)
+  {
+    need(sizeof(T));
+    std::memcpy(&v, pos_, sizeof(T));
+    pos_ += sizeof(T);
+    if constexpr (sizeof(T) > 1)
+      boost::endian::little_to_native_inplace(v);
+  }
+
+  /// Serializes binary data of a given size by copying it directly into the given buffer
+  void serialize_blob(void* buf, size_t len, [[maybe_unused]] std::string_view delimiter=""sv)
+  {
+    need(len);
+    std::memcpy(buf, pos_, len);
+    pos_ += len;
+  }
+
+  /// Serializes an integer using varint encoding
+  template <class T>
+  void serialize_varint(T &v)
+  {
+    serialize_uvarint(*reinterpret_cast<std::make_unsigned_t<T>*>(&v));
+  }
+
+  template <class T>
+  void serialize_uvarint(T &v)
+  {
+    if (tools::read_varint(pos_, end_, v) < 0)
+      throw std::runtime_error{"deserialization of varint failed"};
+  }
+
+  // Reads array size into s and returns an RAII object to help delimit and end it.
+  [[nodiscard]] binary_archive_nested_array<binary_string_unarchiver> begin_array(size_t& s)
+  {
+    serialize_varint(s);
+    return {*this};
+  }
+
+  // Begins a sizeless array (this requires that the size is provided by some other means).
+  [[nodiscard]] binary_archive_nested_array<binary_string_unarchiver> begin_array()
+  {
+    return {*this};
+  }
+
+  // Does nothing. (This is used for tag annotations for archivers such as json)
+  void tag(std::string_view) { }
+
+  [[nodiscard]] binary_archive_nested_object begin_object() { return {}; }
+
+  void read_variant_tag(binary_variant_tag_type &t) {
+    serialize_int(t);
+  }
+
+  /// Returns the number of remaining serialization bytes.  If the given `min_required` is non-zero
+  /// then we also ensure that at least that many bytes are available (and otherwise throw).
+  size_t remaining_bytes(size_t min_required = 0) {
+    need(min_required);
+    return end_ - pos_;
+  }
+
+  // Returns the current position (i.e. the number of bytes read so far).
+  unsigned int streampos() { return static_cast<unsigned int>(pos_ - begin_); }
+
+private:
+  void need(size_t n) {
+    if (static_cast<size_t>(end_ - pos_) < n)
+      throw std::runtime_error{"deserialization failed: unexpected end of data"};
+  }
+
+  const char* begin_;
+  const char* pos_;
+  const char* end_;
+};
+
 /* \struct binary_archiver
  *
  * \brief the serializer class for a binary archive
@@ -277,6 +377,7 @@ private:
 
 // True if Archive is a binary archiver or unarchiver
 template <typename Archive>
-constexpr bool is_binary = std::is_base_of_v<binary_archiver, Archive> || std::is_base_of_v<binary_unarchiver, Archive>;
+constexpr bool is_binary = std::is_base_of_v<binary_archiver, Archive> || std::is_base_of_v<binary_unarchiver, Archive> ||
+  std::is_base_of_v<binary_string_unarchiver, Archive>;
 
 }
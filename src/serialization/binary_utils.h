@@ -85,31 +85,6 @@ public:
   std::string str() { return oss.str(); }
 };
 
-/// Subclass of binary_unarchiver that reads from a string_view.  The caller *must* keep the
-/// string_view data available for the lifetime of the unarchiver.
-class binary_string_unarchiver : public binary_unarchiver {
-  one_shot_read_buffer buf;
-  std::istream is{&buf};
-public:
-  /// Constructor; takes the string_view to deserialize from.  The caller must keep the referenced
-  /// data alive!
-  explicit binary_string_unarchiver(std::string_view s) :
-    binary_unarchiver{is, static_cast<std::streamoff>(s.size())},
-    buf{s}
-  {
-    enable_stream_exceptions();
-  }
-
-  /// Same as above, but taking a vector of uint8_ts
-  explicit binary_string_unarchiver(const std::vector<uint8_t>& s) :
-    binary_string_unarchiver(std::string_view{reinterpret_cast<const char*>(s.data()), s.size()}) {}
-
-  /// Constructing from a std::string temporary is not allowed.
-  binary_string_unarchiver(const std::string&& s) = delete;
-};
-
-
-
 /*! deserializes a binary_archiver-serialized value into v.  Throws on error.  Not consuming the
  * entire string is considered an error.
 */
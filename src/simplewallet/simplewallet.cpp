@@ -2510,6 +2510,24 @@ bool simple_wallet::set_track_uses(const std::vector<std::string> &args/* = std:
   return true;
 }
 
+bool simple_wallet::set_refresh_pipeline_depth(const std::vector<std::string> &args/* = std::vector<std::string>()*/)
+{
+  uint32_t depth;
+  if (!string_tools::get_xtype_from_string(depth, args[1]) || depth == 0)
+  {
+    fail_msg_writer() << tr("invalid depth: must be a positive integer");
+    return true;
+  }
+
+  const auto pwd_container = get_and_verify_password();
+  if (pwd_container)
+  {
+    m_wallet->refresh_pipeline_depth(depth);
+    m_wallet->rewrite(m_wallet_file, pwd_container->password());
+  }
+  return true;
+}
+
 bool simple_wallet::set_inactivity_lock_timeout(const std::vector<std::string> &args/* = std::vector<std::string>()*/)
 {
 #ifdef _WIN32
@@ -2797,6 +2815,8 @@ simple_wallet::simple_wallet()
    Ignore outputs of amount below this threshold when spending.
  track-uses <1|0>
    Whether to keep track of owned outputs uses.
+ refresh-pipeline-depth <n>
+   Set how many batches of blocks to fetch and scan ahead while refreshing.
  device-name <device_name[:device_spec]>
    Device name for hardware wallet.
  export-format <binary"|"ascii">
@@ -3234,6 +3254,7 @@ bool simple_wallet::set_variable(const std::vector<std::string> &args)
     success_msg_writer() << "ignore-outputs-above = " << cryptonote::print_money(m_wallet->ignore_outputs_above());
     success_msg_writer() << "ignore-outputs-below = " << cryptonote::print_money(m_wallet->ignore_outputs_below());
     success_msg_writer() << "track-uses = " << m_wallet->track_uses();
+    success_msg_writer() << "refresh-pipeline-depth = " << m_wallet->refresh_pipeline_depth();
     success_msg_writer() << "device_name = " << m_wallet->device_name();
     success_msg_writer() << "export-format = " << (m_wallet->export_format() == tools::wallet2::ExportFormat::Ascii ? "ascii" : "binary");
     success_msg_writer() << "inactivity-lock-timeout = " << m_wallet->inactivity_lock_timeout().count()
@@ -3292,6 +3313,7 @@ bool simple_wallet::set_variable(const std::vector<std::string> &args)
     CHECK_SIMPLE_VARIABLE("ignore-outputs-above", set_ignore_outputs_above, tr("amount"));
     CHECK_SIMPLE_VARIABLE("ignore-outputs-below", set_ignore_outputs_below, tr("amount"));
     CHECK_SIMPLE_VARIABLE("track-uses", set_track_uses, tr("0 or 1"));
+    CHECK_SIMPLE_VARIABLE("refresh-pipeline-depth", set_refresh_pipeline_depth, tr("positive integer"));
     CHECK_SIMPLE_VARIABLE("inactivity-lock-timeout", set_inactivity_lock_timeout, tr("unsigned integer (seconds, 0 to disable)"));
     CHECK_SIMPLE_VARIABLE("device-name", set_device_name, tr("<device_name[:device_spec]>"));
     CHECK_SIMPLE_VARIABLE("export-format", set_export_format, tr("\"binary\" or \"ascii\""));
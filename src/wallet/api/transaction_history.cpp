@@ -38,6 +38,7 @@
 #include "wallet/wallet2.h"
 #include "common/hex.h"
 
+#include <algorithm>
 #include <string>
 #include <list>
 
@@ -50,6 +51,8 @@ TransactionHistory::~TransactionHistory() {}
 EXPORT
 TransactionHistoryImpl::TransactionHistoryImpl(WalletImpl *wallet)
     : m_wallet(wallet)
+    , m_refreshedHeight(0)
+    , m_invalidFrom(0)
 {
 
 }
@@ -106,6 +109,13 @@ static reward_type from_pay_type(wallet::pay_type ptype) {
     }
 }
 
+EXPORT
+void TransactionHistoryImpl::invalidate(uint64_t height)
+{
+    uint64_t from = m_invalidFrom.load();
+    while (height < from && !m_invalidFrom.compare_exchange_weak(from, height)) {}
+}
+
 EXPORT
 void TransactionHistoryImpl::refresh()
 {
@@ -113,15 +123,26 @@ void TransactionHistoryImpl::refresh()
     // for "write" access, locking exclusively
     std::unique_lock lock{m_historyMutex};
 
-    // TODO: configurable values;
-    uint64_t min_height = 0;
     uint64_t max_height = (uint64_t)-1;
     uint64_t wallet_height = m_wallet->blockChainHeight();
 
-    // delete old transactions;
-    for (auto t : m_history)
-        delete t;
-    m_history.clear();
+    // Transactions found since the last refresh are all at or above the height the wallet had then,
+    // unless the history was invalidated (or the wallet went backwards) in the meantime.
+    uint64_t min_height = std::min({m_invalidFrom.exchange((uint64_t)-1), m_refreshedHeight, wallet_height});
+    m_refreshedHeight = wallet_height;
+
+    // keep the confirmed transactions below that; pending ones (and unmined blinks, which are stored
+    // at height 0) can change at any time so are always reloaded
+    auto keep_end = std::partition(m_history.begin(), m_history.end(), [&](const TransactionInfo *t) {
+        return !t->isPending() && t->blockHeight() != 0 && t->blockHeight() < min_height;
+    });
+    for (auto it = keep_end; it != m_history.end(); ++it)
+        delete *it;
+    m_history.erase(keep_end, m_history.end());
+    for (auto t : m_history) {
+        auto *ti = static_cast<TransactionInfoImpl *>(t);
+        ti->m_confirmations = (wallet_height > ti->m_blockheight) ? wallet_height - ti->m_blockheight : 0;
+    }
 
     // transactions are stored in wallet2:
     // - confirmed_transfer_details   - out transfers
@@ -132,6 +153,8 @@ void TransactionHistoryImpl::refresh()
     // one input transaction contains only one transfer. e.g. <transaction_id> - <100XMR>
 
     std::list<std::pair<crypto::hash, tools::wallet2::payment_details>> in_payments;
+    if (min_height > 0)
+        m_wallet->m_wallet->get_payments(in_payments, 0, 0);
     m_wallet->m_wallet->get_payments(in_payments, min_height, max_height);
     for (std::list<std::pair<crypto::hash, tools::wallet2::payment_details>>::const_iterator i = in_payments.begin(); i != in_payments.end(); ++i) {
         const tools::wallet2::payment_details &pd = i->second;
@@ -164,6 +187,8 @@ void TransactionHistoryImpl::refresh()
     //
 
     std::list<std::pair<crypto::hash, tools::wallet2::confirmed_transfer_details>> out_payments;
+    if (min_height > 0)
+        m_wallet->m_wallet->get_payments_out(out_payments, 0, 0);
     m_wallet->m_wallet->get_payments_out(out_payments, min_height, max_height);
 
     for (std::list<std::pair<crypto::hash, tools::wallet2::confirmed_transfer_details>>::const_iterator i = out_payments.begin();
@@ -29,6 +29,7 @@
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
 #include "wallet/api/wallet2_api.h"
+#include <atomic>
 #include <shared_mutex>
 
 namespace Wallet {
@@ -45,6 +46,9 @@ public:
     TransactionInfo* transaction(std::string_view id) const override;
     std::vector<TransactionInfo*> getAll() const override;
     void refresh() override;
+    // Makes the next refresh() rebuild the entries of transactions at or above `height` (all of them
+    // by default): they changed in some way other than new blocks arriving.
+    void invalidate(uint64_t height = 0);
 
 private:
 
@@ -52,6 +56,10 @@ private:
     std::vector<TransactionInfo*> m_history;
     WalletImpl *m_wallet;
     mutable std::shared_mutex m_historyMutex;
+    // wallet height as of the last refresh(); confirmed transactions below it don't change, so the
+    // next refresh only has to update their confirmations
+    uint64_t m_refreshedHeight;
+    std::atomic<uint64_t> m_invalidFrom;
 };
 
 }
@@ -150,6 +150,7 @@ struct Wallet2CallbackImpl : public tools::i_wallet2_callback
             // LOG_PRINT_L3(__FUNCTION__ << ": new block. height: " << height);
             if (m_listener) {
                 m_listener->newBlock(height);
+                m_listener->refreshProgress(height, m_wallet->m_refreshTargetHeight);
             }
         }
     }
@@ -215,6 +216,12 @@ struct Wallet2CallbackImpl : public tools::i_wallet2_callback
     }
 
     // Light wallet callbacks
+    EXPORT
+    void on_reorg(uint64_t height) override
+    {
+        m_wallet->m_history->invalidate(height);
+    }
+
     EXPORT
     void on_lw_new_block(uint64_t height) override
     {
@@ -453,6 +460,9 @@ WalletImpl::WalletImpl(NetworkType nettype, uint64_t kdf_rounds)
     , m_rebuildWalletCache(false)
     , m_is_connected(false)
     , m_refreshShouldRescan(false)
+    , m_refreshRequested(false)
+    , m_refreshCancelled(false)
+    , m_refreshTargetHeight(0)
 {
     m_wallet.reset(new tools::wallet2(static_cast<cryptonote::network_type>(nettype), kdf_rounds, true));
     m_history.reset(new TransactionHistoryImpl(this));
@@ -1196,6 +1206,27 @@ void WalletImpl::rescanBlockchainAsync()
     refreshAsync();
 }
 
+EXPORT
+std::future<bool> WalletImpl::refreshFuture()
+{
+    std::future<bool> result;
+    {
+        std::lock_guard lock{m_refreshPromisesMutex};
+        result = m_refreshPromises.emplace_back().get_future();
+        m_refreshRequested = true;
+    }
+    refreshAsync();
+    return result;
+}
+
+EXPORT
+void WalletImpl::cancelRefresh()
+{
+    LOG_PRINT_L2(__FUNCTION__ << ": cancelling refresh");
+    m_refreshCancelled = true;
+    m_wallet->stop();
+}
+
 EXPORT
 void WalletImpl::setAutoRefreshInterval(int millis)
 {
@@ -1297,6 +1328,8 @@ bool WalletImpl::importKeyImages(std::string_view filename_)
     uint64_t height = m_wallet->import_key_images_from_file(filename, spent, unspent);
     LOG_PRINT_L2("Signed key images imported to height " << height << ", "
         << print_money(spent) << " spent, " << print_money(unspent) << " unspent");
+    // spent key images can reveal outgoing transfers from any height
+    m_history->invalidate();
   }
   catch (const std::exception &e)
   {
@@ -1347,7 +1380,8 @@ void WalletImpl::setSubaddressLabel(uint32_t accountIndex, uint32_t addressIndex
 {
     try
     {
-        return m_wallet->set_subaddress_label({accountIndex, addressIndex}, label);
+        m_wallet->set_subaddress_label({accountIndex, addressIndex}, label);
+        m_history->invalidate();
     }
     catch (const std::exception &e)
     {
@@ -1691,6 +1725,15 @@ PendingTransaction *WalletImpl::createTransaction(const std::string &dst_addr, s
     return createTransactionMultDest(std::vector<std::string> {dst_addr},  amount ? (std::vector<uint64_t> {*amount}) : (std::optional<std::vector<uint64_t>>()), priority, subaddr_account, subaddr_indices);
 }
 
+EXPORT
+std::future<PendingTransaction*> WalletImpl::createTransactionAsync(const std::string &dst_addr, std::optional<uint64_t> amount,
+                                                  uint32_t priority, uint32_t subaddr_account, std::set<uint32_t> subaddr_indices)
+{
+    return std::async(std::launch::async, [=] {
+        return createTransaction(dst_addr, amount, priority, subaddr_account, subaddr_indices);
+    });
+}
+
 EXPORT
 PendingTransaction *WalletImpl::createSweepUnmixableTransaction()
 
@@ -2232,11 +2275,13 @@ void WalletImpl::refreshThreadFunc()
         LOG_PRINT_L3(__FUNCTION__ << ": waiting for refresh...");
         // if auto refresh enabled, we wait for the "m_refreshIntervalSeconds" interval.
         // if not - we wait forever
+        // a refreshFuture() call made while we were refreshing doesn't wait for the next wakeup
+        auto requested = [this] { return m_refreshRequested || m_refreshThreadDone; };
         if (m_refreshIntervalMillis > 0) {
             std::chrono::milliseconds wait_for_ms{m_refreshIntervalMillis.load()};
-            m_refreshCV.wait_for(lock, wait_for_ms);
+            m_refreshCV.wait_for(lock, wait_for_ms, requested);
         } else {
-            m_refreshCV.wait(lock);
+            m_refreshCV.wait(lock, requested);
         }
 
         LOG_PRINT_L3(__FUNCTION__ << ": refresh lock acquired...");
@@ -2244,7 +2289,7 @@ void WalletImpl::refreshThreadFunc()
         auto st = status();
         LOG_PRINT_L3(__FUNCTION__ << ": m_status: " << st.first << ": " << st.second);
         LOG_PRINT_L3(__FUNCTION__ << ": m_refreshShouldRescan: " << m_refreshShouldRescan);
-        if (m_refreshEnabled) {
+        if (m_refreshEnabled || m_refreshRequested) {
             LOG_PRINT_L3(__FUNCTION__ << ": refreshing...");
             doRefresh();
         }
@@ -2258,24 +2303,34 @@ void WalletImpl::doRefresh()
     bool rescan = m_refreshShouldRescan.exchange(false);
     // synchronizing async and sync refresh calls
     std::lock_guard guard{m_refreshMutex2};
+    std::vector<std::promise<bool>> promises;
+    {
+        std::lock_guard lock{m_refreshPromisesMutex};
+        promises.swap(m_refreshPromises);
+        m_refreshRequested = false;
+    }
+    m_refreshCancelled = false;
     do {
         try {
             LOG_PRINT_L3(__FUNCTION__ << ": doRefresh, rescan = "<<rescan);
             // Syncing daemon and refreshing wallet simultaneously is very resource intensive.
             // Disable refresh if wallet is disconnected or daemon isn't synced.
             if (m_wallet->light_wallet() || daemonSynced()) {
-                if(rescan)
+                m_refreshTargetHeight = m_wallet->light_wallet() ? m_wallet->get_light_wallet_blockchain_height() : daemonBlockChainHeight();
+                if(rescan) {
                     m_wallet->rescan_blockchain(false);
+                    m_history->invalidate();
+                }
                 m_wallet->refresh(trustedDaemon());
+                if (m_refreshCancelled) {
+                    setStatusError(tr("Refresh cancelled"));
+                    break;
+                }
                 if (!m_synchronized) {
                     m_synchronized = true;
                 }
-                // assuming if we have empty history, it wasn't initialized yet
-                // for further history changes client need to update history in
-                // "on_money_received" and "on_money_sent" callbacks
-                if (m_history->count() == 0) {
-                    m_history->refresh();
-                }
+                // only rebuilds the part of the history that new blocks (or a reorg) can affect
+                m_history->refresh();
                 m_wallet->find_and_save_rings(false);
             } else {
                LOG_PRINT_L3(__FUNCTION__ << ": skipping refresh - daemon is not synced");
@@ -2286,6 +2341,12 @@ void WalletImpl::doRefresh()
         }
     } while (!rescan && (rescan=m_refreshShouldRescan.exchange(false))); // repeat if not rescanned and rescan was requested
 
+    if (!promises.empty()) {
+        const bool ok = good();
+        for (auto &p : promises)
+            p.set_value(ok);
+    }
+
     if (m_wallet2Callback->getListener()) {
         m_wallet2Callback->getListener()->refreshed();
     }
@@ -37,6 +37,7 @@
 #include <mutex>
 #include <condition_variable>
 #include <thread>
+#include <future>
 
 
 namespace Wallet {
@@ -109,6 +110,8 @@ public:
     void refreshAsync() override;
     bool rescanBlockchain() override;
     void rescanBlockchainAsync() override;    
+    std::future<bool> refreshFuture() override;
+    void cancelRefresh() override;
     void setAutoRefreshInterval(int millis) override;
     int autoRefreshInterval() const override;
     void setRefreshFromBlockHeight(uint64_t refresh_from_block_height) override;
@@ -156,6 +159,11 @@ public:
                                         uint32_t priority = 0,
                                         uint32_t subaddr_account = 0,
                                         std::set<uint32_t> subaddr_indices = {}) override;
+    std::future<PendingTransaction*> createTransactionAsync(const std::string &dst_addr,
+                                        std::optional<uint64_t> amount,
+                                        uint32_t priority = 0,
+                                        uint32_t subaddr_account = 0,
+                                        std::set<uint32_t> subaddr_indices = {}) override;
     PendingTransaction* createSweepUnmixableTransaction() override;
     bool submitTransaction(std::string_view filename) override;
     UnsignedTransaction* loadUnsignedTx(std::string_view unsigned_filename) override;
@@ -250,6 +258,13 @@ private:
     std::mutex        m_refreshMutex2;
     std::condition_variable m_refreshCV;
     std::thread       m_refreshThread;
+    // promises of refreshFuture() calls, fulfilled by the next doRefresh
+    std::mutex        m_refreshPromisesMutex;
+    std::vector<std::promise<bool>> m_refreshPromises;
+    std::atomic<bool> m_refreshRequested;
+    std::atomic<bool> m_refreshCancelled;
+    // daemon height the current refresh is scanning up to, for WalletListener::refreshProgress
+    std::atomic<uint64_t> m_refreshTargetHeight;
     std::thread       m_longPollThread;
 
     // flag indicating wallet is recovering from seed
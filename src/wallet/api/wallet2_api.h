@@ -36,6 +36,7 @@
 #include <list>
 #include <set>
 #include <ctime>
+#include <future>
 #include <iostream>
 #include <stdexcept>
 #include <optional>
@@ -361,6 +362,13 @@ struct WalletListener
      */
     virtual void newBlock(uint64_t height) = 0;
 
+    /**
+     * @brief refreshProgress - called as a refresh scans blocks, at the same points as newBlock
+     * @param height          - block height just scanned
+     * @param target_height   - daemon height the refresh is scanning up to (0 if unknown)
+     */
+    virtual void refreshProgress(uint64_t height, uint64_t target_height) { (void)height; (void)target_height; }
+
     /**
      * @brief updated  - generic callback, called when any event (sent/received/block reveived/etc) happened with the wallet;
      */
@@ -701,6 +709,20 @@ struct Wallet
      */
     virtual void rescanBlockchainAsync() = 0;
 
+    /**
+     * @brief refreshFuture - like refreshAsync, but the returned future becomes ready with the
+     *                        result of refresh() once the background thread has refreshed.  The
+     *                        refresh happens even if the refresh thread is paused.
+     */
+    virtual std::future<bool> refreshFuture() = 0;
+
+    /**
+     * @brief cancelRefresh - aborts a refresh (or rescan) in progress, sync or async.  The
+     *                        aborted refresh fails with a "Refresh cancelled" status error; the
+     *                        next one carries on from where it stopped.
+     */
+    virtual void cancelRefresh() = 0;
+
     /**
      * @brief setAutoRefreshInterval - setup interval for automatic refresh.
      * @param seconds - interval in millis. if zero or less than zero - automatic refresh disabled;
@@ -835,6 +857,16 @@ struct Wallet
                                                   uint32_t subaddr_account           = 0,
                                                   std::set<uint32_t> subaddr_indices = {}) = 0;
 
+    /*!
+     * \brief createTransactionAsync runs createTransaction on a new thread
+     * \return                  future of the PendingTransaction createTransaction would return
+     */
+    virtual std::future<PendingTransaction*> createTransactionAsync(const std::string &dst_addr,
+                                                  std::optional<uint64_t> amount,
+                                                  uint32_t priority                  = 0,
+                                                  uint32_t subaddr_account           = 0,
+                                                  std::set<uint32_t> subaddr_indices = {}) = 0;
+
     /*!
      * \brief createSweepUnmixableTransaction creates transaction with unmixable outputs.
      * \return                  PendingTransaction object. caller is responsible to check PendingTransaction::status()
@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <cstring>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include "epee/int-util.h"
+#include "epee/misc_log_ex.h"
+#include "wallet_errors.h"
+#include "hashchain.h"
+
+#undef OXEN_DEFAULT_LOG_CATEGORY
+#define OXEN_DEFAULT_LOG_CATEGORY "wallet.hashchain"
+
+namespace bip = boost::interprocess;
+
+namespace
+{
+  // File layout: 8 byte magic, then the (little-endian) height of the first hash and the number of
+  // hashes, 8 reserved bytes, then the hashes.  The file is grown in steps, so it is usually longer
+  // than the hashes it holds.
+  constexpr char MAGIC[8] = {'o', 'x', 'e', 'n', 'h', 'c', 'h', '1'};
+  constexpr size_t HEADER_SIZE = 32;
+  constexpr size_t MIN_CAPACITY = 4096;
+
+  uint64_t read_u64(const char *p)
+  {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return SWAP64LE(v);
+  }
+
+  void write_u64(char *p, uint64_t v)
+  {
+    v = SWAP64LE(v);
+    std::memcpy(p, &v, sizeof(v));
+  }
+}
+
+namespace tools
+{
+  struct hashchain::mapped_file
+  {
+    fs::path path;
+    bip::file_mapping mapping;
+    bip::mapped_region region;
+    size_t capacity = 0;
+
+    explicit mapped_file(fs::path p) : path{std::move(p)} { map(); }
+
+    void map()
+    {
+      mapping = bip::file_mapping{path.string().c_str(), bip::read_write};
+      region = bip::mapped_region{mapping, bip::read_write};
+      capacity = region.get_size() < HEADER_SIZE ? 0 : (region.get_size() - HEADER_SIZE) / sizeof(crypto::hash);
+    }
+
+    // The mapping has to be dropped before the file can be resized (at least on Windows)
+    void resize(size_t new_capacity)
+    {
+      region = bip::mapped_region{};
+      mapping = bip::file_mapping{};
+      fs::resize_file(path, HEADER_SIZE + new_capacity * sizeof(crypto::hash));
+      map();
+    }
+
+    char *header() { return static_cast<char *>(region.get_address()); }
+    crypto::hash *hashes() { return reinterpret_cast<crypto::hash *>(header() + HEADER_SIZE); }
+  };
+
+  hashchain::hashchain(): m_offset(0), m_genesis(crypto::null_hash), m_base(0), m_count(0) {}
+
+  hashchain::~hashchain()
+  {
+    try { flush(); }
+    catch (const std::exception &e) { MERROR("Failed to flush hashchain file " << m_path << ": " << e.what()); }
+  }
+
+  const crypto::hash *hashchain::data() const
+  {
+    return m_map ? m_map->hashes() : m_heap.data();
+  }
+
+  crypto::hash *hashchain::data()
+  {
+    return m_map ? m_map->hashes() : m_heap.data();
+  }
+
+  void hashchain::push_back(const crypto::hash &hash)
+  {
+    if (m_offset == 0 && size() == 0)
+      m_genesis = hash;
+    if (m_map)
+    {
+      reserve(m_count + 1);
+      data()[m_count] = hash;
+    }
+    else
+      m_heap.push_back(hash);
+    ++m_count;
+  }
+
+  void hashchain::crop(size_t height)
+  {
+    m_count = height - m_base;
+    if (!m_map)
+      m_heap.resize(m_count);
+  }
+
+  void hashchain::clear()
+  {
+    m_offset = 0;
+    m_base = 0;
+    m_count = 0;
+    m_heap.clear();
+    m_expected.reset();
+  }
+
+  void hashchain::trim(size_t height)
+  {
+    // Always keeps at least one hash past the offset
+    if (height <= m_offset || size() <= m_offset + 1)
+      return;
+    const size_t new_offset = std::min(height, size() - 1);
+    if (!m_map)
+    {
+      m_heap.erase(m_heap.begin(), m_heap.begin() + (new_offset - m_base));
+      m_heap.shrink_to_fit();
+      m_base = new_offset;
+      m_count = m_heap.size();
+    }
+    // When mapped the trimmed hashes stay in the file until flush() compacts it
+    m_offset = new_offset;
+  }
+
+  void hashchain::refill(const crypto::hash &hash)
+  {
+    --m_offset;
+    m_base = m_offset;
+    m_count = 0;
+    m_heap.clear();
+    push_back(hash);
+  }
+
+  void hashchain::reserve(size_t count)
+  {
+    if (count <= m_map->capacity)
+      return;
+    m_map->resize(std::max({count, m_map->capacity * 2, MIN_CAPACITY}));
+  }
+
+  bool hashchain::open(const fs::path &path)
+  {
+    std::error_code ec;
+    const auto file_size = fs::file_size(path, ec);
+    if (ec || file_size < HEADER_SIZE)
+      return false;
+    try
+    {
+      m_map = std::make_unique<mapped_file>(path);
+    }
+    catch (const std::exception &e)
+    {
+      MERROR("Failed to map hashchain file " << path << ": " << e.what());
+      return false;
+    }
+    m_path = path;
+    return std::memcmp(m_map->header(), MAGIC, sizeof(MAGIC)) == 0;
+  }
+
+  void hashchain::create(const fs::path &path)
+  {
+    m_map.reset();
+    {
+      fs::ofstream out{path, std::ios::binary | std::ios::trunc};
+      THROW_WALLET_EXCEPTION_IF(!out, error::file_save_error, path);
+    }
+    try
+    {
+      fs::resize_file(path, HEADER_SIZE + std::max(m_count, MIN_CAPACITY) * sizeof(crypto::hash));
+      m_map = std::make_unique<mapped_file>(path);
+    }
+    catch (const std::exception &e)
+    {
+      THROW_WALLET_EXCEPTION(error::wallet_internal_error, "Failed to create hashchain file " + path.u8string() + ": " + e.what());
+    }
+    m_path = path;
+    std::memcpy(m_map->header(), MAGIC, sizeof(MAGIC));
+  }
+
+  bool hashchain::attach(const fs::path &path)
+  {
+    if (m_map && m_path == path)
+      return true;
+
+    if (m_expected)
+    {
+      const auto [count, tip] = *m_expected;
+      m_expected.reset();
+      if (open(path))
+      {
+        const uint64_t base = read_u64(m_map->header() + 8);
+        const uint64_t stored = read_u64(m_map->header() + 16);
+        // Hashes trimmed away by a flush() that wasn't followed by a cache store are fine to lose
+        const size_t offset = std::max<size_t>(m_offset, base);
+        if (count >= offset && base + m_map->capacity >= count && (count == offset ||
+              (count <= base + stored && m_map->hashes()[count - 1 - base] == tip)))
+        {
+          m_offset = offset;
+          m_base = base;
+          m_count = count - base;
+          return true;
+        }
+      }
+      MWARNING("Hashchain file " << path << " is missing or does not match the wallet cache");
+      clear();
+      create(path);
+      flush();
+      return false;
+    }
+
+    // Move the live hashes (from the heap or another file) into a new file
+    std::vector<crypto::hash> hashes;
+    if (m_map)
+    {
+      hashes.assign(data() + (m_offset - m_base), data() + m_count);
+      flush();
+    }
+    else
+    {
+      hashes = std::move(m_heap);
+      m_heap = {};
+    }
+    m_base = m_offset;
+    m_count = hashes.size();
+    create(path);
+    std::copy(hashes.begin(), hashes.end(), data());
+    flush();
+    return true;
+  }
+
+  void hashchain::detach()
+  {
+    m_expected.reset();
+    if (!m_map)
+      return;
+    flush();
+    m_heap.assign(data() + (m_offset - m_base), data() + m_count);
+    m_base = m_offset;
+    m_count = m_heap.size();
+    m_map.reset();
+    m_path.clear();
+  }
+
+  void hashchain::flush()
+  {
+    if (!m_map)
+      return;
+    const size_t trimmed = m_offset - m_base;
+    if (trimmed >= MIN_CAPACITY && trimmed > m_count - trimmed)
+    {
+      std::memmove(data(), data() + trimmed, (m_count - trimmed) * sizeof(crypto::hash));
+      m_base = m_offset;
+      m_count -= trimmed;
+    }
+    write_u64(m_map->header() + 8, m_base);
+    write_u64(m_map->header() + 16, m_count);
+    if (!m_map->region.flush())
+      MERROR("Failed to sync hashchain file " << m_path);
+  }
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <boost/serialization/deque.hpp>
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/version.hpp>
+
+#include "crypto/hash.h"
+#include "cryptonote_basic/cryptonote_boost_serialization.h"
+#include "common/fs.h"
+
+namespace tools
+{
+  /// The hashes of the blocks the wallet has scanned, indexed by height.  Hashes below `offset()`
+  /// have been trimmed (the wallet never needs to go back to them), but the genesis hash is always
+  /// kept.
+  ///
+  /// Hashes are kept on the heap and serialized with the wallet cache until `attach()` binds the
+  /// chain to a flat file of hashes (the wallet uses `<wallet>.hashchain`), memory-mapped and
+  /// appended to as blocks are scanned.  From then on the cache only records the offset, size and
+  /// tip hash, so storing and loading the wallet don't copy the hashes at all.  `flush()` makes the
+  /// file current and must be called before a cache that refers to it is written.
+  class hashchain
+  {
+  public:
+    hashchain();
+    ~hashchain();
+    hashchain(const hashchain&) = delete;
+    hashchain& operator=(const hashchain&) = delete;
+
+    size_t size() const { return m_base + m_count; }
+    size_t offset() const { return m_offset; }
+    const crypto::hash &genesis() const { return m_genesis; }
+    void push_back(const crypto::hash &hash);
+    bool is_in_bounds(size_t idx) const { return idx >= m_offset && idx < size(); }
+    const crypto::hash &operator[](size_t idx) const { return data()[idx - m_base]; }
+    void crop(size_t height);
+    void clear();
+    bool empty() const { return m_count == 0 && m_offset == 0; }
+    void trim(size_t height);
+    void refill(const crypto::hash &hash);
+
+    /// Moves the hashes into the file at `path` (creating or replacing it as needed) and keeps them
+    /// there from now on.  If the chain was loaded from a cache that refers to an existing file,
+    /// that file is opened instead; returns false if it is missing or doesn't match what the cache
+    /// recorded (e.g. after a crash mid-reorg), in which case the chain is left empty and attached
+    /// to a fresh file, and the wallet has to rescan.  Throws if the file can't be created.
+    bool attach(const fs::path &path);
+    /// Releases the file (without removing it); the hashes it held are copied back to the heap.
+    void detach();
+    bool attached() const { return m_map != nullptr; }
+    /// False if the cache this was loaded from kept the hashes in a file not yet attach()ed.
+    bool loaded() const { return !m_expected; }
+    const fs::path &path() const { return m_path; }
+    /// Writes the mapped hashes and the file header out to disk.  No-op when not attached.
+    void flush();
+
+    template <class t_archive>
+    void serialize(t_archive &a, const unsigned int ver)
+    {
+      a & m_offset;
+      a & m_genesis;
+      if (ver < 1)
+      {
+        std::deque<crypto::hash> hashes;
+        a & hashes;
+        m_heap.assign(hashes.begin(), hashes.end());
+        m_base = m_offset;
+        m_count = m_heap.size();
+        return;
+      }
+      bool external = attached();
+      a & external;
+      if (!external)
+      {
+        a & m_heap;
+        if constexpr (typename t_archive::is_loading())
+        {
+          m_base = m_offset;
+          m_count = m_heap.size();
+        }
+        return;
+      }
+      uint64_t count = 0;
+      crypto::hash tip = crypto::null_hash;
+      if constexpr (typename t_archive::is_saving())
+      {
+        count = size();
+        if (size() > m_offset)
+          tip = (*this)[size() - 1];
+      }
+      a & count;
+      a & tip;
+      if constexpr (typename t_archive::is_loading())
+      {
+        m_heap.clear();
+        m_base = m_offset;
+        m_count = 0;
+        m_expected = std::make_pair(count, tip);
+      }
+    }
+
+  private:
+    struct mapped_file;
+
+    const crypto::hash *data() const;
+    crypto::hash *data();
+    void reserve(size_t count);
+    bool open(const fs::path &path);
+    void create(const fs::path &path);
+
+    size_t m_offset;
+    crypto::hash m_genesis;
+    size_t m_base; // height of the first stored hash; <= m_offset
+    size_t m_count; // number of stored hashes
+    std::vector<crypto::hash> m_heap; // the stored hashes when not attached
+    std::unique_ptr<mapped_file> m_map;
+    fs::path m_path;
+    // Size and tip hash recorded by a cache that kept the hashes in the file, checked by attach()
+    std::optional<std::pair<uint64_t, crypto::hash>> m_expected;
+  };
+}
+BOOST_CLASS_VERSION(tools::hashchain, 1)
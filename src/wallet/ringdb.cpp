@@ -143,20 +143,47 @@ static std::string decrypt(const std::string &ciphertext, const crypto::key_imag
   return plaintext;
 }
 
-static void store_relative_ring(MDB_txn *txn, MDB_dbi &dbi, const crypto::key_image &key_image, const std::vector<uint64_t> &relative_ring, const crypto::chacha_key &chacha_key)
+static std::string encrypt_relative_ring(const crypto::key_image &key_image, const std::vector<uint64_t> &relative_ring, const crypto::chacha_key &chacha_key)
+{
+  return encrypt(compress_ring(relative_ring, V1TAG), key_image, chacha_key, 1);
+}
+
+static void put_ring(MDB_txn *txn, MDB_dbi &dbi, const std::string &key_ciphertext, const std::string &data_ciphertext)
 {
   MDB_val key, data;
-  std::string key_ciphertext = encrypt(key_image, chacha_key, 0);
   key.mv_data = (void*)key_ciphertext.data();
   key.mv_size = key_ciphertext.size();
-  std::string compressed_ring = compress_ring(relative_ring, V1TAG);
-  std::string data_ciphertext = encrypt(compressed_ring, key_image, chacha_key, 1);
   data.mv_size = data_ciphertext.size();
   data.mv_data = (void*)data_ciphertext.c_str();
   int dbr = mdb_put(txn, dbi, &key, &data, 0);
   THROW_WALLET_EXCEPTION_IF(dbr, tools::error::wallet_internal_error, "Failed to set ring for key image in LMDB table: " + std::string(mdb_strerror(dbr)));
 }
 
+static void store_relative_ring(MDB_txn *txn, MDB_dbi &dbi, const crypto::key_image &key_image, const std::vector<uint64_t> &relative_ring, const crypto::chacha_key &chacha_key)
+{
+  put_ring(txn, dbi, encrypt(key_image, chacha_key, 0), encrypt_relative_ring(key_image, relative_ring, chacha_key));
+}
+
+// Decrypts a stored ring into absolute offsets
+static std::vector<uint64_t> decode_ring(const std::string &data_ciphertext, const crypto::key_image &key_image, const crypto::chacha_key &chacha_key)
+{
+  std::vector<uint64_t> outs;
+  bool try_v0 = false;
+  std::string data_plaintext = decrypt(data_ciphertext, key_image, chacha_key, 1);
+  try { outs = decompress_ring(data_plaintext, V1TAG); if (outs.empty()) try_v0 = true; }
+  catch(...) { try_v0 = true; }
+  if (try_v0)
+  {
+    data_plaintext = decrypt(data_ciphertext, key_image, chacha_key, 0);
+    outs = decompress_ring(data_plaintext, 0);
+  }
+  MDEBUG("Found ring for key image " << key_image << ":");
+  MDEBUG("Relative: " << tools::join(" ", outs));
+  outs = cryptonote::relative_output_offsets_to_absolute(outs);
+  MDEBUG("Absolute: " << tools::join(" ", outs));
+  return outs;
+}
+
 static int resize_env(MDB_env *env, const fs::path& db_path, size_t needed)
 {
   MDB_envinfo mei;
@@ -251,6 +278,11 @@ void ringdb::close()
 {
   if (env)
   {
+    if (batch_)
+    {
+      try { commit_batch(); }
+      catch (const std::exception &e) { MERROR("Failed to commit staged ring changes: " << e.what()); }
+    }
     mdb_dbi_close(env, dbi_rings);
     mdb_dbi_close(env, dbi_blackballs);
     mdb_env_close(env);
@@ -258,12 +290,28 @@ void ringdb::close()
   }
 }
 
+void ringdb::stage_relative_ring(const crypto::key_image &key_image, const std::vector<uint64_t> &relative_ring, const crypto::chacha_key &chacha_key)
+{
+  staged_rings_[encrypt(key_image, chacha_key, 0)] = encrypt_relative_ring(key_image, relative_ring, chacha_key);
+}
+
 bool ringdb::add_rings(const crypto::chacha_key &chacha_key, const cryptonote::transaction_prefix &tx)
 {
   MDB_txn *txn;
   int dbr;
   bool tx_active = false;
 
+  if (batch_)
+  {
+    for (const auto &in: tx.vin)
+    {
+      auto *txin = std::get_if<cryptonote::txin_to_key>(&in);
+      if (txin && txin->key_offsets.size() != 1)
+        stage_relative_ring(txin->k_image, txin->key_offsets, chacha_key);
+    }
+    return true;
+  }
+
   dbr = resize_env(env, filename_, get_ring_data_size(tx.vin.size()));
   THROW_WALLET_EXCEPTION_IF(dbr, tools::error::wallet_internal_error, "Failed to set env map size");
   dbr = mdb_txn_begin(env, NULL, 0, &txn);
@@ -295,6 +343,13 @@ bool ringdb::remove_rings(const crypto::chacha_key &chacha_key, const std::vecto
   int dbr;
   bool tx_active = false;
 
+  if (batch_)
+  {
+    for (const crypto::key_image &key_image: key_images)
+      staged_rings_[encrypt(key_image, chacha_key, 0)] = std::nullopt;
+    return true;
+  }
+
   dbr = resize_env(env, filename_, 0);
   THROW_WALLET_EXCEPTION_IF(dbr, tools::error::wallet_internal_error, "Failed to set env map size");
   dbr = mdb_txn_begin(env, NULL, 0, &txn);
@@ -349,6 +404,15 @@ bool ringdb::get_ring(const crypto::chacha_key &chacha_key, const crypto::key_im
   int dbr;
   bool tx_active = false;
 
+  std::string key_ciphertext = encrypt(key_image, chacha_key, 0);
+  if (auto staged = staged_rings_.find(key_ciphertext); staged != staged_rings_.end())
+  {
+    if (!staged->second)
+      return false;
+    outs = decode_ring(*staged->second, key_image, chacha_key);
+    return true;
+  }
+
   dbr = resize_env(env, filename_, 0);
   THROW_WALLET_EXCEPTION_IF(dbr, tools::error::wallet_internal_error, "Failed to set env map size: " + std::string(mdb_strerror(dbr)));
   dbr = mdb_txn_begin(env, NULL, 0, &txn);
@@ -357,7 +421,6 @@ bool ringdb::get_ring(const crypto::chacha_key &chacha_key, const crypto::key_im
   tx_active = true;
 
   MDB_val key, data;
-  std::string key_ciphertext = encrypt(key_image, chacha_key, 0);
   key.mv_data = (void*)key_ciphertext.data();
   key.mv_size = key_ciphertext.size();
   dbr = mdb_get(txn, dbi_rings, &key, &data);
@@ -366,19 +429,7 @@ bool ringdb::get_ring(const crypto::chacha_key &chacha_key, const crypto::key_im
     return false;
   THROW_WALLET_EXCEPTION_IF(data.mv_size <= 0, tools::error::wallet_internal_error, "Invalid ring data size");
 
-  bool try_v0 = false;
-  std::string data_plaintext = decrypt(std::string((const char*)data.mv_data, data.mv_size), key_image, chacha_key, 1);
-  try { outs = decompress_ring(data_plaintext, V1TAG); if (outs.empty()) try_v0 = true; }
-  catch(...) { try_v0 = true; }
-  if (try_v0)
-  {
-    data_plaintext = decrypt(std::string((const char*)data.mv_data, data.mv_size), key_image, chacha_key, 0);
-    outs = decompress_ring(data_plaintext, 0);
-  }
-  MDEBUG("Found ring for key image " << key_image << ":");
-  MDEBUG("Relative: " << tools::join(" ", outs));
-  outs = cryptonote::relative_output_offsets_to_absolute(outs);
-  MDEBUG("Absolute: " << tools::join(" ", outs));
+  outs = decode_ring(std::string((const char*)data.mv_data, data.mv_size), key_image, chacha_key);
 
   dbr = mdb_txn_commit(txn);
   THROW_WALLET_EXCEPTION_IF(dbr, tools::error::wallet_internal_error, "Failed to commit txn getting ring from database: " + std::string(mdb_strerror(dbr)));
@@ -386,12 +437,55 @@ bool ringdb::get_ring(const crypto::chacha_key &chacha_key, const crypto::key_im
   return true;
 }
 
+bool ringdb::get_rings(const crypto::chacha_key &chacha_key, const std::vector<crypto::key_image> &key_images, std::unordered_map<crypto::key_image, std::vector<uint64_t>> &rings)
+{
+  MDB_txn *txn;
+  int dbr;
+  bool tx_active = false;
+
+  if (key_images.empty())
+    return true;
+
+  dbr = mdb_txn_begin(env, NULL, MDB_RDONLY, &txn);
+  THROW_WALLET_EXCEPTION_IF(dbr, tools::error::wallet_internal_error, "Failed to create LMDB transaction: " + std::string(mdb_strerror(dbr)));
+  OXEN_DEFER { if (tx_active) mdb_txn_abort(txn); };
+  tx_active = true;
+
+  for (const crypto::key_image &key_image: key_images)
+  {
+    std::string key_ciphertext = encrypt(key_image, chacha_key, 0);
+    if (auto staged = staged_rings_.find(key_ciphertext); staged != staged_rings_.end())
+    {
+      if (staged->second)
+        rings[key_image] = decode_ring(*staged->second, key_image, chacha_key);
+      continue;
+    }
+
+    MDB_val key, data;
+    key.mv_data = (void*)key_ciphertext.data();
+    key.mv_size = key_ciphertext.size();
+    dbr = mdb_get(txn, dbi_rings, &key, &data);
+    THROW_WALLET_EXCEPTION_IF(dbr && dbr != MDB_NOTFOUND, tools::error::wallet_internal_error, "Failed to look for key image in LMDB table: " + std::string(mdb_strerror(dbr)));
+    if (dbr == MDB_NOTFOUND)
+      continue;
+    THROW_WALLET_EXCEPTION_IF(data.mv_size <= 0, tools::error::wallet_internal_error, "Invalid ring data size");
+    rings[key_image] = decode_ring(std::string((const char*)data.mv_data, data.mv_size), key_image, chacha_key);
+  }
+  return true;
+}
+
 bool ringdb::set_ring(const crypto::chacha_key &chacha_key, const crypto::key_image &key_image, const std::vector<uint64_t> &outs, bool relative)
 {
   MDB_txn *txn;
   int dbr;
   bool tx_active = false;
 
+  if (batch_)
+  {
+    stage_relative_ring(key_image, relative ? outs : cryptonote::absolute_output_offsets_to_relative(outs), chacha_key);
+    return true;
+  }
+
   dbr = resize_env(env, filename_, outs.size() * 64);
   THROW_WALLET_EXCEPTION_IF(dbr, tools::error::wallet_internal_error, "Failed to set env map size: " + std::string(mdb_strerror(dbr)));
   dbr = mdb_txn_begin(env, NULL, 0, &txn);
@@ -407,6 +501,58 @@ bool ringdb::set_ring(const crypto::chacha_key &chacha_key, const crypto::key_im
   return true;
 }
 
+void ringdb::begin_batch()
+{
+  THROW_WALLET_EXCEPTION_IF(batch_, tools::error::wallet_internal_error, "A ringdb batch is already open");
+  batch_ = true;
+}
+
+bool ringdb::commit_batch()
+{
+  MDB_txn *txn;
+  int dbr;
+  bool tx_active = false;
+
+  THROW_WALLET_EXCEPTION_IF(!batch_, tools::error::wallet_internal_error, "No ringdb batch is open");
+  // Whatever happens, the batch is over; on failure its changes are dropped
+  OXEN_DEFER { batch_ = false; staged_rings_.clear(); };
+  if (staged_rings_.empty())
+    return true;
+
+  dbr = resize_env(env, filename_, get_ring_data_size(staged_rings_.size()));
+  THROW_WALLET_EXCEPTION_IF(dbr, tools::error::wallet_internal_error, "Failed to set env map size: " + std::string(mdb_strerror(dbr)));
+  dbr = mdb_txn_begin(env, NULL, 0, &txn);
+  THROW_WALLET_EXCEPTION_IF(dbr, tools::error::wallet_internal_error, "Failed to create LMDB transaction: " + std::string(mdb_strerror(dbr)));
+  OXEN_DEFER { if (tx_active) mdb_txn_abort(txn); };
+  tx_active = true;
+
+  for (const auto &[key_ciphertext, data_ciphertext]: staged_rings_)
+  {
+    if (data_ciphertext)
+    {
+      put_ring(txn, dbi_rings, key_ciphertext, *data_ciphertext);
+      continue;
+    }
+    MDB_val key;
+    key.mv_data = (void*)key_ciphertext.data();
+    key.mv_size = key_ciphertext.size();
+    dbr = mdb_del(txn, dbi_rings, &key, NULL);
+    THROW_WALLET_EXCEPTION_IF(dbr && dbr != MDB_NOTFOUND, tools::error::wallet_internal_error, "Failed to remove ring to database: " + std::string(mdb_strerror(dbr)));
+  }
+
+  dbr = mdb_txn_commit(txn);
+  THROW_WALLET_EXCEPTION_IF(dbr, tools::error::wallet_internal_error, "Failed to commit txn writing staged rings to database: " + std::string(mdb_strerror(dbr)));
+  tx_active = false;
+  MDEBUG("Committed " << staged_rings_.size() << " staged ring changes");
+  return true;
+}
+
+void ringdb::abort_batch()
+{
+  batch_ = false;
+  staged_rings_.clear();
+}
+
 bool ringdb::blackball_worker(const std::vector<std::pair<uint64_t, uint64_t>> &outputs, int op)
 {
   MDB_txn *txn;
@@ -28,7 +28,9 @@
 
 #pragma once
 
+#include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <lmdb.h>
 #include "epee/wipeable_string.h"
@@ -51,8 +53,19 @@ namespace tools
     bool remove_rings(const crypto::chacha_key &chacha_key, const std::vector<crypto::key_image> &key_images);
     bool remove_rings(const crypto::chacha_key &chacha_key, const cryptonote::transaction_prefix &tx);
     bool get_ring(const crypto::chacha_key &chacha_key, const crypto::key_image &key_image, std::vector<uint64_t> &outs);
+    // Looks up the rings of several key images in one txn; key images without a ring are left out
+    // of `rings`.
+    bool get_rings(const crypto::chacha_key &chacha_key, const std::vector<crypto::key_image> &key_images, std::unordered_map<crypto::key_image, std::vector<uint64_t>> &rings);
     bool set_ring(const crypto::chacha_key &chacha_key, const crypto::key_image &key_image, const std::vector<uint64_t> &outs, bool relative);
 
+    // While a batch is open, ring additions and removals are staged in memory (where lookups see
+    // them) instead of each getting their own LMDB txn; commit_batch() writes them all in one txn.
+    // A batch still open at close() is committed.  Batches don't nest.
+    void begin_batch();
+    bool commit_batch();
+    void abort_batch();
+    bool in_batch() const { return batch_; }
+
     bool blackball(const std::pair<uint64_t, uint64_t> &output);
     bool blackball(const std::vector<std::pair<uint64_t, uint64_t>> &outputs);
     bool unblackball(const std::pair<uint64_t, uint64_t> &output);
@@ -61,11 +74,16 @@ namespace tools
 
   private:
     bool blackball_worker(const std::vector<std::pair<uint64_t, uint64_t>> &outputs, int op);
+    void stage_relative_ring(const crypto::key_image &key_image, const std::vector<uint64_t> &relative_ring, const crypto::chacha_key &chacha_key);
 
   private:
     fs::path filename_;
     MDB_env *env = nullptr;
     MDB_dbi dbi_rings;
     MDB_dbi dbi_blackballs;
+
+    bool batch_ = false;
+    // Staged ring changes, by encrypted key image: the encrypted ring, or nullopt for a removal
+    std::unordered_map<std::string, std::optional<std::string>> staged_rings_;
   };
 }
@@ -34,6 +34,9 @@
 #include <tuple>
 #include <optional>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <future>
 #include <boost/format.hpp>
 #include <openssl/evp.h>
 #include <openssl/pem.h>
@@ -124,6 +127,10 @@ namespace {
 
   constexpr uint64_t FEE_ESTIMATE_GRACE_BLOCKS = 10; // estimate fee valid for that many blocks
 
+  constexpr uint64_t RCT_DISTRIBUTION_REORG_BLOCKS = 10; // re-request this many cached rct distribution blocks
+  constexpr size_t KEY_IMAGE_BATCH_SIZE = 256; // key images signed or verified per threadpool task
+  constexpr size_t KEY_IMAGE_SPENT_CHUNK_SIZE = 1000; // key images per is_key_image_spent request on import
+
   constexpr float SECOND_OUTPUT_RELATEDNESS_THRESHOLD = 0.0f;
 
   constexpr std::string_view KEY_IMAGE_EXPORT_FILE_MAGIC = "Loki key image export\002"sv;
@@ -135,6 +142,8 @@ namespace {
 
   constexpr uint64_t FIRST_REFRESH_GRANULARITY = 1024;
 
+  constexpr uint32_t DEFAULT_REFRESH_PIPELINE_DEPTH = 4;
+
   constexpr double GAMMA_SHAPE = 19.28;
   constexpr double GAMMA_SCALE = 1/1.61;
 
@@ -302,6 +311,12 @@ void do_prepare_file_names(const fs::path& file_path, fs::path& keys_file, fs::p
   (mms_file = keys_file).replace_extension(".mms");
 }
 
+fs::path hashchain_file_name(fs::path wallet_file)
+{
+  wallet_file += ".hashchain";
+  return wallet_file;
+}
+
 uint64_t calculate_fee_from_weight(byte_and_output_fees base_fees, uint64_t weight, uint64_t outputs, uint64_t fee_percent, uint64_t fee_fixed, uint64_t fee_quantization_mask)
 {
   uint64_t fee = (weight * base_fees.first + outputs * base_fees.second) * fee_percent / 100;
@@ -1021,6 +1036,74 @@ void wallet_device_callback::on_progress(const hw::device_progress& event)
     wallet->on_device_progress(event);
 }
 
+namespace {
+
+  // Number of wallet2 instances alive in this process
+  std::atomic<size_t> wallet_instances{0};
+
+  // Recently pulled and parsed block batches, shared between the wallets in this process so that
+  // wallets syncing from the same daemon download and parse each batch once rather than once per
+  // wallet.  A batch is looked up by the hash of its first block, which is the top block of the
+  // short chain history the daemon was asked with, so it is exactly what the daemon would send back
+  // to another wallet at the same point.  Only used while more than one wallet is open.
+  class shared_block_batches
+  {
+  public:
+    struct batch
+    {
+      std::string daemon;
+      bool no_miner_tx;
+      uint64_t start_height;
+      uint64_t current_height;
+      std::vector<cryptonote::block_complete_entry> blocks;
+      std::vector<wallet2::parsed_block> parsed_blocks;
+      std::chrono::steady_clock::time_point pulled;
+    };
+
+    static constexpr size_t MAX_BATCHES = 8;
+    static constexpr auto MAX_AGE = 30s;
+
+    std::shared_ptr<const batch> find(const std::string &daemon, bool no_miner_tx, const crypto::hash &first)
+    {
+      std::lock_guard lock{m_mutex};
+      expire();
+      for (const auto &b : m_batches)
+        if (b->parsed_blocks.front().hash == first && b->no_miner_tx == no_miner_tx && b->daemon == daemon)
+          return b;
+      return nullptr;
+    }
+
+    void add(std::shared_ptr<const batch> b)
+    {
+      std::lock_guard lock{m_mutex};
+      expire();
+      if (m_batches.size() >= MAX_BATCHES)
+        m_batches.pop_front();
+      m_batches.push_back(std::move(b));
+    }
+
+    void clear()
+    {
+      std::lock_guard lock{m_mutex};
+      m_batches.clear();
+    }
+
+  private:
+    void expire()
+    {
+      const auto cutoff = std::chrono::steady_clock::now() - MAX_AGE;
+      while (!m_batches.empty() && m_batches.front()->pulled < cutoff)
+        m_batches.pop_front();
+    }
+
+    std::mutex m_mutex;
+    std::deque<std::shared_ptr<const batch>> m_batches;
+  };
+
+  shared_block_batches shared_batches;
+
+}
+
 wallet2::wallet2(network_type nettype, uint64_t kdf_rounds, bool unattended):
   m_multisig_rescan_info(NULL),
   m_multisig_rescan_k(NULL),
@@ -1053,6 +1136,7 @@ wallet2::wallet2(network_type nettype, uint64_t kdf_rounds, bool unattended):
   m_ignore_outputs_above(MONEY_SUPPLY),
   m_ignore_outputs_below(0),
   m_track_uses(false),
+  m_refresh_pipeline_depth(DEFAULT_REFRESH_PIPELINE_DEPTH),
   m_inactivity_lock_timeout(m_nettype == MAINNET ? DEFAULT_INACTIVITY_LOCK_TIMEOUT : 0s),
   m_is_initialized(false),
   m_kdf_rounds(kdf_rounds),
@@ -1085,10 +1169,13 @@ wallet2::wallet2(network_type nettype, uint64_t kdf_rounds, bool unattended):
   m_rpc_version(0),
   m_export_format(ExportFormat::Binary)
 {
+  ++wallet_instances;
 }
 
 wallet2::~wallet2()
 {
+  if (--wallet_instances <= 1)
+    shared_batches.clear();
 }
 
 bool wallet2::has_testnet_option(const boost::program_options::variables_map& vm)
@@ -1250,6 +1337,10 @@ bool wallet2::set_daemon(std::string daemon_address, std::optional<tools::login>
   m_long_poll_local = localhost;
 
   m_node_rpc_proxy.invalidate();
+  m_rct_distribution.clear();
+  m_output_blacklist.clear();
+  m_output_blacklist_last.reset();
+  m_output_blacklist_count = 0;
 
   std::string url = m_http_client.get_base_url();
   MINFO("set daemon to " << (url.empty() ? "(none, offline)" : url));
@@ -1467,22 +1558,14 @@ bool wallet2::should_expand(const cryptonote::subaddress_index &index) const
 //----------------------------------------------------------------------------------------------------
 void wallet2::expand_subaddresses(const cryptonote::subaddress_index& index)
 {
-  hw::device &hwdev = m_account.get_device();
   if (m_subaddress_labels.size() <= index.major)
   {
     // add new accounts
-    cryptonote::subaddress_index index2;
+    std::vector<subaddress_range> ranges;
     const uint32_t major_end = get_subaddress_clamped_sum(index.major, m_subaddress_lookahead_major);
-    for (index2.major = m_subaddress_labels.size(); index2.major < major_end; ++index2.major)
-    {
-      const uint32_t end = get_subaddress_clamped_sum((index2.major == index.major ? index.minor : 0), m_subaddress_lookahead_minor);
-      const std::vector<crypto::public_key> pkeys = hwdev.get_subaddress_spend_public_keys(m_account.get_keys(), index2.major, 0, end);
-      for (index2.minor = 0; index2.minor < end; ++index2.minor)
-      {
-         const crypto::public_key &D = pkeys[index2.minor];
-         m_subaddresses[D] = index2;
-      }
-    }
+    for (uint32_t major = m_subaddress_labels.size(); major < major_end; ++major)
+      ranges.push_back({major, 0, get_subaddress_clamped_sum((major == index.major ? index.minor : 0), m_subaddress_lookahead_minor)});
+    add_subaddresses(ranges);
     m_subaddress_labels.resize(index.major + 1, {"Untitled account"});
     m_subaddress_labels[index.major].resize(index.minor + 1);
     get_account_tags();
@@ -1492,14 +1575,59 @@ void wallet2::expand_subaddresses(const cryptonote::subaddress_index& index)
     // add new subaddresses
     const uint32_t end = get_subaddress_clamped_sum(index.minor, m_subaddress_lookahead_minor);
     const uint32_t begin = m_subaddress_labels[index.major].size();
-    cryptonote::subaddress_index index2 = {index.major, begin};
-    const std::vector<crypto::public_key> pkeys = hwdev.get_subaddress_spend_public_keys(m_account.get_keys(), index2.major, index2.minor, end);
-    for (; index2.minor < end; ++index2.minor)
+    add_subaddresses({{index.major, begin, end}});
+    m_subaddress_labels[index.major].resize(index.minor + 1);
+  }
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::add_subaddresses(const std::vector<subaddress_range> &ranges)
+{
+  hw::device &hwdev = m_account.get_device();
+  size_t total = 0;
+  for (const auto &r: ranges)
+    total += r.end - r.begin;
+  m_subaddresses.reserve(m_subaddresses.size() + total);
+
+  // Hardware devices derive one range at a time; with the keys in memory the ranges are split into
+  // chunks and derived in parallel.
+  const bool parallel = hwdev.get_type() == hw::device::device_type::SOFTWARE;
+  static constexpr uint32_t chunk_size = 1000;
+  std::vector<subaddress_range> chunks;
+  for (const auto &r: ranges)
+  {
+    if (!parallel)
+      chunks.push_back(r);
+    else
+      for (uint32_t begin = r.begin; begin < r.end; begin += std::min(chunk_size, r.end - begin))
+        chunks.push_back({r.major, begin, begin + std::min(chunk_size, r.end - begin)});
+  }
+
+  std::vector<std::vector<crypto::public_key>> pkeys(chunks.size());
+  if (parallel && chunks.size() > 1)
+  {
+    tools::threadpool& tpool = tools::threadpool::getInstance();
+    tools::threadpool::waiter waiter;
+    const cryptonote::account_keys &keys = m_account.get_keys();
+    for (size_t i = 0; i < chunks.size(); ++i)
+      tpool.submit(&waiter, [&, i]() { pkeys[i] = hwdev.get_subaddress_spend_public_keys(keys, chunks[i].major, chunks[i].begin, chunks[i].end); }, true);
+    waiter.wait(&tpool);
+  }
+  else
+  {
+    for (size_t i = 0; i < chunks.size(); ++i)
+      pkeys[i] = hwdev.get_subaddress_spend_public_keys(m_account.get_keys(), chunks[i].major, chunks[i].begin, chunks[i].end);
+  }
+
+  for (size_t i = 0; i < chunks.size(); ++i)
+  {
+    THROW_WALLET_EXCEPTION_IF(pkeys[i].size() != chunks[i].end - chunks[i].begin, error::wallet_internal_error,
+        "Unexpected number of subaddress keys from device");
+    cryptonote::subaddress_index index2 = {chunks[i].major, chunks[i].begin};
+    for (const auto &D: pkeys[i])
     {
-       const crypto::public_key &D = pkeys[index2.minor - begin];
-       m_subaddresses[D] = index2;
+      m_subaddresses[D] = index2;
+      ++index2.minor;
     }
-    m_subaddress_labels[index.major].resize(index.minor + 1);
   }
 }
 //----------------------------------------------------------------------------------------------------
@@ -1545,6 +1673,7 @@ void wallet2::set_spent(size_t idx, uint64_t height)
   LOG_PRINT_L2("Setting SPENT at " << height << ": ki " << td.m_key_image << ", amount " << print_money(td.m_amount));
   td.m_spent = true;
   td.m_spent_height = height;
+  update_unspent_transfers_index(idx);
 }
 //----------------------------------------------------------------------------------------------------
 void wallet2::set_unspent(size_t idx)
@@ -1554,6 +1683,34 @@ void wallet2::set_unspent(size_t idx)
   LOG_PRINT_L2("Setting UNSPENT: ki " << td.m_key_image << ", amount " << print_money(td.m_amount));
   td.m_spent = false;
   td.m_spent_height = 0;
+  update_unspent_transfers_index(idx);
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::update_unspent_transfers_index(size_t idx)
+{
+  const transfer_details &td = m_transfers[idx];
+  const bool unspent = !is_spent(td, true);
+  for (auto &[index_major, indices] : m_unspent_transfers)
+    if (!unspent || index_major != td.m_subaddr_index.major)
+      indices.erase(idx);
+  if (unspent)
+    m_unspent_transfers[td.m_subaddr_index.major].insert(idx);
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::reindex_unspent_transfers(size_t from)
+{
+  for (auto &[index_major, indices] : m_unspent_transfers)
+    indices.erase(indices.lower_bound(from), indices.end());
+  for (size_t i = from; i < m_transfers.size(); ++i)
+    if (!is_spent(m_transfers[i], true))
+      m_unspent_transfers[m_transfers[i].m_subaddr_index.major].insert(i);
+}
+//----------------------------------------------------------------------------------------------------
+const std::set<size_t>& wallet2::unspent_transfers(uint32_t index_major) const
+{
+  static const std::set<size_t> none;
+  auto it = m_unspent_transfers.find(index_major);
+  return it == m_unspent_transfers.end() ? none : it->second;
 }
 //----------------------------------------------------------------------------------------------------
 bool wallet2::is_spent(const transfer_details &td, bool strict) const
@@ -2275,6 +2432,7 @@ void wallet2::process_new_transaction(const crypto::hash &txid, const cryptonote
             }
             THROW_WALLET_EXCEPTION_IF(transfer.get_public_key() != tx_scan_info[o].in_ephemeral.pub, error::wallet_internal_error, "Inconsistent public keys");
             THROW_WALLET_EXCEPTION_IF(transfer.m_spent, error::wallet_internal_error, "Inconsistent spent status");
+            update_unspent_transfers_index(kit->second);
 
             LOG_PRINT_L0("Received money: " << print_money(transfer.amount()) << ", with tx: " << txid);
             if (0 != m_callback)
@@ -2527,6 +2685,7 @@ void wallet2::process_new_transaction(const crypto::hash &txid, const cryptonote
       m_key_images[it->m_key_image]    = real_transfers_index;
       m_pub_keys[it->get_public_key()] = real_transfers_index;
     }
+    reindex_unspent_transfers(earliest_blink_got_mined_transfers_index);
   }
 
   if (notify)
@@ -2732,24 +2891,18 @@ void wallet2::pull_hashes(uint64_t start_height, uint64_t &blocks_start_height,
   hashes = std::move(res.m_block_ids);
 }
 //----------------------------------------------------------------------------------------------------
-void wallet2::process_parsed_blocks(uint64_t start_height, const std::vector<cryptonote::block_complete_entry> &blocks, const std::vector<parsed_block> &parsed_blocks, uint64_t& blocks_added, std::map<std::pair<uint64_t, uint64_t>, size_t> *output_tracker_cache)
+void wallet2::cache_parsed_blocks_tx_data(uint64_t start_height, const std::vector<parsed_block> &parsed_blocks, std::vector<tx_cache_data> &tx_cache_data) const
 {
-  size_t current_index = start_height;
-  blocks_added = 0;
-
-  THROW_WALLET_EXCEPTION_IF(blocks.size() != parsed_blocks.size(), error::wallet_internal_error, "size mismatch");
-  THROW_WALLET_EXCEPTION_IF(!m_blockchain.is_in_bounds(current_index), error::out_of_hashchain_bounds_error);
-
   tools::threadpool& tpool = tools::threadpool::getInstance();
   tools::threadpool::waiter waiter;
 
   size_t num_txes = 0;
-  std::vector<tx_cache_data> tx_cache_data;
-  for (size_t i = 0; i < blocks.size(); ++i)
+  for (size_t i = 0; i < parsed_blocks.size(); ++i)
     num_txes += 1 + parsed_blocks[i].txes.size();
+  tx_cache_data.clear();
   tx_cache_data.resize(num_txes);
   size_t txidx = 0;
-  for (size_t i = 0; i < blocks.size(); ++i)
+  for (size_t i = 0; i < parsed_blocks.size(); ++i)
   {
     THROW_WALLET_EXCEPTION_IF(parsed_blocks[i].txes.size() != parsed_blocks[i].block.tx_hashes.size(),
         error::wallet_internal_error, "Mismatched parsed_blocks[i].txes.size() and parsed_blocks[i].block.tx_hashes.size()");
@@ -2769,59 +2922,166 @@ void wallet2::process_parsed_blocks(uint64_t start_height, const std::vector<cry
   }
   THROW_WALLET_EXCEPTION_IF(txidx != num_txes, error::wallet_internal_error, "txidx does not match tx_cache_data size");
   waiter.wait(&tpool);
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::generate_tx_cache_derivations(std::vector<tx_cache_data> &tx_cache_data, hw::device &hwdev) const
+{
+  tools::threadpool& tpool = tools::threadpool::getInstance();
+  tools::threadpool::waiter waiter;
+  const cryptonote::account_keys &keys = m_account.get_keys();
+
+  // Derive in batches across txes: with the view key in memory (or exported by a hardware device)
+  // this shares the field inversion of each batch rather than doing one per tx pubkey, and a
+  // device that has to do the derivations itself gets them a batch at a time.
+  static constexpr size_t batch_size = 256;
+  std::vector<is_out_data*> iods;
+  for (auto &slot: tx_cache_data)
+  {
+    for (auto &iod: slot.primary)
+      iods.push_back(&iod);
+    for (auto &iod: slot.additional)
+      iods.push_back(&iod);
+  }
+  for (size_t begin = 0; begin < iods.size(); begin += batch_size)
+  {
+    tpool.submit(&waiter, [&iods, &keys, &hwdev, begin]() {
+      const size_t count = std::min(batch_size, iods.size() - begin);
+      std::vector<crypto::public_key> pkeys(count);
+      std::vector<crypto::key_derivation> derivations(count);
+      std::unique_ptr<bool[]> valid{new bool[count]};
+      for (size_t i = 0; i < count; ++i)
+        pkeys[i] = iods[begin + i]->pkey;
+      hwdev.generate_key_derivations(pkeys.data(), count, keys.m_view_secret_key, derivations.data(), valid.get());
+      for (size_t i = 0; i < count; ++i)
+      {
+        auto &iod = *iods[begin + i];
+        if (valid[i])
+          iod.derivation = derivations[i];
+        else
+        {
+          MWARNING("Failed to generate key derivation from tx pubkey, skipping");
+          static_assert(sizeof(iod.derivation) == sizeof(rct::key), "Mismatched sizes of key_derivation and rct::key");
+          memcpy(&iod.derivation, rct::identity().bytes, sizeof(iod.derivation));
+        }
+      }
+    }, true);
+  }
+  waiter.wait(&tpool);
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::process_parsed_blocks(uint64_t start_height, const std::vector<cryptonote::block_complete_entry> &blocks, const std::vector<parsed_block> &parsed_blocks, uint64_t& blocks_added, std::map<std::pair<uint64_t, uint64_t>, size_t> *output_tracker_cache)
+{
+  std::vector<tx_cache_data> tx_cache_data;
+  process_parsed_blocks(start_height, blocks, parsed_blocks, tx_cache_data, false, blocks_added, output_tracker_cache);
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::process_parsed_blocks(uint64_t start_height, const std::vector<cryptonote::block_complete_entry> &blocks, const std::vector<parsed_block> &parsed_blocks, std::vector<tx_cache_data> &tx_cache_data, bool derived, uint64_t& blocks_added, std::map<std::pair<uint64_t, uint64_t>, size_t> *output_tracker_cache)
+{
+  size_t current_index = start_height;
+  blocks_added = 0;
+
+  THROW_WALLET_EXCEPTION_IF(blocks.size() != parsed_blocks.size(), error::wallet_internal_error, "size mismatch");
+  THROW_WALLET_EXCEPTION_IF(!m_blockchain.is_in_bounds(current_index), error::out_of_hashchain_bounds_error);
+
+  tools::threadpool& tpool = tools::threadpool::getInstance();
+  tools::threadpool::waiter waiter;
+
+  if (tx_cache_data.empty())
+  {
+    cache_parsed_blocks_tx_data(start_height, parsed_blocks, tx_cache_data);
+    derived = false;
+  }
 
   hw::device &hwdev =  m_account.get_device();
   hw::mode_resetter rst{hwdev};
   hwdev.set_mode(hw::device::TRANSACTION_PARSE);
-  const cryptonote::account_keys &keys = m_account.get_keys();
 
-  auto gender = [&](wallet2::is_out_data &iod) {
-    if (!hwdev.generate_key_derivation(iod.pkey, keys.m_view_secret_key, iod.derivation))
+  if (!derived)
+    generate_tx_cache_derivations(tx_cache_data, hwdev);
+
+  // Same results as calling is_out_to_acc_precomp for each output and primary derivation (with the
+  // additional derivations only tried alongside the first primary one), but with the subaddress
+  // spend keys of a whole transaction derived in one batch.
+  auto geniod = [&](const cryptonote::transaction &tx, size_t n_vouts, size_t txidx) {
+    auto &primary = tx_cache_data[txidx].primary;
+    const auto &additional = tx_cache_data[txidx].additional;
+    for (const auto &iod: primary)
+      THROW_WALLET_EXCEPTION_IF(iod.received.size() != n_vouts,
+          error::wallet_internal_error, "Unexpected received array size");
+
+    std::vector<crypto::public_key> keys;
+    std::vector<crypto::key_derivation> derivations;
+    std::vector<size_t> output_indices;
+    auto derive = [&] {
+      std::vector<crypto::public_key> derived(keys.size());
+      std::unique_ptr<bool[]> valid{new bool[keys.size()]};
+      hwdev.derive_subaddress_public_keys(keys.data(), derivations.data(), output_indices.data(), keys.size(), derived.data(), valid.get());
+      std::vector<const cryptonote::subaddress_index*> found(keys.size(), nullptr);
+      for (size_t n = 0; n < keys.size(); ++n)
+      {
+        if (!valid[n])
+          continue;
+        if (auto it = m_subaddresses.find(derived[n]); it != m_subaddresses.end())
+          found[n] = &it->second;
+      }
+      keys.clear();
+      derivations.clear();
+      output_indices.clear();
+      return found;
+    };
+
+    for (size_t k = 0; k < n_vouts; ++k)
     {
-      MWARNING("Failed to generate key derivation from tx pubkey, skipping");
-      static_assert(sizeof(iod.derivation) == sizeof(rct::key), "Mismatched sizes of key_derivation and rct::key");
-      memcpy(&iod.derivation, rct::identity().bytes, sizeof(iod.derivation));
+      if (!std::holds_alternative<cryptonote::txout_to_key>(tx.vout[k].target))
+        continue;
+      for (const auto &iod: primary)
+      {
+        keys.push_back(var::get<txout_to_key>(tx.vout[k].target).key);
+        derivations.push_back(iod.derivation);
+        output_indices.push_back(k);
+      }
     }
-  };
+    if (keys.empty())
+      return;
+    // outputs[n] is the output index of the n-th key in the batch
+    std::vector<size_t> outputs = output_indices;
+    auto found = derive();
 
-  for (size_t i = 0; i < tx_cache_data.size(); ++i)
-  {
-    if (tx_cache_data[i].empty())
-      continue;
-    tpool.submit(&waiter, [&hwdev, &gender, &tx_cache_data, i]() {
-      auto &slot = tx_cache_data[i];
-      std::unique_lock hwdev_lock{hwdev};
-      for (auto &iod: slot.primary)
-        gender(iod);
-      for (auto &iod: slot.additional)
-        gender(iod);
-    }, true);
-  }
-  waiter.wait(&tpool);
+    std::vector<size_t> misses;
+    for (size_t n = 0; n < found.size(); ++n)
+    {
+      auto &iod = primary[n % primary.size()];
+      if (found[n])
+        iod.received[outputs[n]] = cryptonote::subaddress_receive_info{*found[n], iod.derivation};
+      else
+        iod.received[outputs[n]] = std::nullopt;
+      if (!found[n] && n % primary.size() == 0 && !additional.empty())
+        misses.push_back(outputs[n]);
+    }
+    if (misses.empty())
+      return;
 
-  auto geniod = [&](const cryptonote::transaction &tx, size_t n_vouts, size_t txidx) {
-    for (size_t k = 0; k < n_vouts; ++k)
+    for (size_t k: misses)
     {
-      const auto &o = tx.vout[k];
-      if (std::holds_alternative<cryptonote::txout_to_key>(o.target))
+      if (k >= additional.size())
       {
-        std::vector<crypto::key_derivation> additional_derivations;
-        additional_derivations.reserve(tx_cache_data[txidx].additional.size());
-        for (const auto &iod: tx_cache_data[txidx].additional)
-          additional_derivations.push_back(iod.derivation);
-        const auto &key = var::get<txout_to_key>(o.target).key;
-        for (size_t l = 0; l < tx_cache_data[txidx].primary.size(); ++l)
-        {
-          THROW_WALLET_EXCEPTION_IF(tx_cache_data[txidx].primary[l].received.size() != n_vouts,
-              error::wallet_internal_error, "Unexpected received array size");
-          tx_cache_data[txidx].primary[l].received[k] = is_out_to_acc_precomp(m_subaddresses, key, tx_cache_data[txidx].primary[l].derivation, additional_derivations, k, hwdev);
-          additional_derivations.clear();
-        }
+        MERROR("wrong number of additional derivations");
+        continue;
       }
+      keys.push_back(var::get<txout_to_key>(tx.vout[k].target).key);
+      derivations.push_back(additional[k].derivation);
+      output_indices.push_back(k);
+    }
+    outputs = output_indices;
+    found = derive();
+    for (size_t n = 0; n < found.size(); ++n)
+    {
+      if (found[n])
+        primary[0].received[outputs[n]] = cryptonote::subaddress_receive_info{*found[n], additional[outputs[n]].derivation};
     }
   };
 
-  txidx = 0;
+  size_t txidx = 0;
   for (size_t i = 0; i < blocks.size(); ++i)
   {
     if (should_skip_block(parsed_blocks[i].block, start_height + i))
@@ -2891,7 +3151,7 @@ void wallet2::refresh(bool trusted_daemon, uint64_t start_height, uint64_t & blo
   refresh(trusted_daemon, start_height, blocks_fetched, received_money);
 }
 //----------------------------------------------------------------------------------------------------
-void wallet2::pull_and_parse_next_blocks(uint64_t start_height, uint64_t &blocks_start_height, std::list<crypto::hash> &short_chain_history, const std::vector<cryptonote::block_complete_entry> &prev_blocks, const std::vector<parsed_block> &prev_parsed_blocks, std::vector<cryptonote::block_complete_entry> &blocks, std::vector<parsed_block> &parsed_blocks, bool &last, bool &error, std::exception_ptr &exception)
+void wallet2::pull_and_parse_next_blocks(uint64_t start_height, uint64_t &blocks_start_height, std::list<crypto::hash> &short_chain_history, const std::vector<crypto::hash> &prev_hashes, std::vector<cryptonote::block_complete_entry> &blocks, std::vector<parsed_block> &parsed_blocks, bool &last, bool &error, std::exception_ptr &exception)
 {
   error = false;
   last = false;
@@ -2901,13 +3161,27 @@ void wallet2::pull_and_parse_next_blocks(uint64_t start_height, uint64_t &blocks
   {
     drop_from_short_history(short_chain_history, 3);
 
-    THROW_WALLET_EXCEPTION_IF(prev_blocks.size() != prev_parsed_blocks.size(), error::wallet_internal_error, "size mismatch");
-
     // prepend the last 3 blocks, should be enough to guard against a block or two's reorg
-    auto s = std::next(prev_parsed_blocks.rbegin(), std::min((size_t)3, prev_parsed_blocks.size())).base();
-    for (; s != prev_parsed_blocks.end(); ++s)
+    auto s = std::next(prev_hashes.rbegin(), std::min((size_t)3, prev_hashes.size())).base();
+    for (; s != prev_hashes.end(); ++s)
     {
-      short_chain_history.push_front(s->hash);
+      short_chain_history.push_front(*s);
+    }
+
+    const bool share = wallet_instances > 1 && !short_chain_history.empty();
+    const bool no_miner_tx = m_refresh_type == RefreshNoCoinbase;
+    const std::string daemon = share ? get_daemon_address() : std::string{};
+    if (share)
+    {
+      if (auto b = shared_batches.find(daemon, no_miner_tx, short_chain_history.front()))
+      {
+        MDEBUG("Using " << b->blocks.size() << " blocks from " << b->start_height << " already pulled by another wallet");
+        blocks_start_height = b->start_height;
+        blocks = b->blocks;
+        parsed_blocks = b->parsed_blocks;
+        last = cryptonote::get_block_height(parsed_blocks.back().block) + 1 == b->current_height;
+        return;
+      }
     }
 
     // pull the new blocks
@@ -2951,6 +3225,10 @@ void wallet2::pull_and_parse_next_blocks(uint64_t start_height, uint64_t &blocks
     }
     waiter.wait(&tpool);
     last = !blocks.empty() && cryptonote::get_block_height(parsed_blocks.back().block) + 1 == current_height;
+
+    if (share && !error && !blocks.empty())
+      shared_batches.add(std::make_shared<shared_block_batches::batch>(shared_block_batches::batch{
+          daemon, no_miner_tx, blocks_start_height, current_height, blocks, parsed_blocks, std::chrono::steady_clock::now()}));
   }
   catch(...)
   {
@@ -2958,22 +3236,14 @@ void wallet2::pull_and_parse_next_blocks(uint64_t start_height, uint64_t &blocks
   }
 }
 
-void wallet2::remove_obsolete_pool_txs(const std::vector<crypto::hash> &tx_hashes)
+void wallet2::remove_obsolete_pool_txs(const std::unordered_set<crypto::hash> &tx_hashes)
 {
   // remove pool txes to us that aren't in the pool anymore
   std::unordered_multimap<crypto::hash, wallet2::pool_payment_details>::iterator uit = m_unconfirmed_payments.begin();
   while (uit != m_unconfirmed_payments.end())
   {
     const crypto::hash &txid = uit->second.m_pd.m_tx_hash;
-    bool found = false;
-    for (const auto &it2: tx_hashes)
-    {
-      if (it2 == txid)
-      {
-        found = true;
-        break;
-      }
-    }
+    bool found = tx_hashes.count(txid) > 0;
     auto pit = uit++;
     if (!found)
     {
@@ -3080,31 +3350,40 @@ std::vector<wallet2::get_pool_state_tx> wallet2::get_pool_state(bool refreshed)
 {
   std::vector<wallet2::get_pool_state_tx> process_txs;
   MTRACE("get_pool_state: take hashes from cache");
-  std::vector<crypto::hash> blink_hashes, pool_hashes;
+  std::vector<crypto::hash> blink_hashes;
+  std::unordered_set<crypto::hash> pool_hashes;
   {
-    // We make two requests here: one for all pool txes, and then (assuming there are any) a second
-    // one for blink txes.
+    // We want all pool txes and, separately, the blink txes among them.
+    //
+    // NOTE: Only blinked transactions get scanned, normal transactions will appear
+    // in the wallet when it arrives in a block. This is to prevent pulling down
+    // TX's that are awaiting blink approval being cached in the wallet as
+    // non-blink and external applications failing to respect this.
     cryptonote::rpc::GET_TRANSACTION_POOL_HASHES_BIN::request req{};
     cryptonote::rpc::GET_TRANSACTION_POOL_HASHES_BIN::response res{};
+    req.include_blinked = true;
     bool r = invoke_http<rpc::GET_TRANSACTION_POOL_HASHES_BIN>(req, res);
     THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "get_transaction_pool_hashes.bin");
     THROW_WALLET_EXCEPTION_IF(res.status == rpc::STATUS_BUSY, error::daemon_busy, "get_transaction_pool_hashes.bin");
     THROW_WALLET_EXCEPTION_IF(res.status != rpc::STATUS_OK, error::get_tx_pool_error);
     MTRACE("get_pool_state got full pool");
-    pool_hashes = std::move(res.tx_hashes);
+    pool_hashes.insert(res.tx_hashes.begin(), res.tx_hashes.end());
 
-    // NOTE: Only request blinked transactions, normal transactions will appear
-    // in the wallet when it arrives in a block. This is to prevent pulling down
-    // TX's that are awaiting blink approval being cached in the wallet as
-    // non-blink and external applications failing to respect this.
-    req.blinked_txs_only = true;
-    res = {};
-    r = invoke_http<rpc::GET_TRANSACTION_POOL_HASHES_BIN>(req, res);
-    THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "get_transaction_pool_hashes.bin");
-    THROW_WALLET_EXCEPTION_IF(res.status == rpc::STATUS_BUSY, error::daemon_busy, "get_transaction_pool_hashes.bin");
-    THROW_WALLET_EXCEPTION_IF(res.status != rpc::STATUS_OK, error::get_tx_pool_error);
+    if (res.blinked_included)
+      blink_hashes = std::move(res.blinked_tx_hashes);
+    else
+    {
+      // Older daemon: ask again for just the blinks
+      req.include_blinked = false;
+      req.blinked_txs_only = true;
+      res = {};
+      r = invoke_http<rpc::GET_TRANSACTION_POOL_HASHES_BIN>(req, res);
+      THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "get_transaction_pool_hashes.bin");
+      THROW_WALLET_EXCEPTION_IF(res.status == rpc::STATUS_BUSY, error::daemon_busy, "get_transaction_pool_hashes.bin");
+      THROW_WALLET_EXCEPTION_IF(res.status != rpc::STATUS_OK, error::get_tx_pool_error);
+      blink_hashes = std::move(res.tx_hashes);
+    }
     MTRACE("get_pool_state got blinks");
-    blink_hashes = std::move(res.tx_hashes);
   }
 
   OXEN_DEFER {
@@ -3120,7 +3399,7 @@ std::vector<wallet2::get_pool_state_tx> wallet2::get_pool_state(bool refreshed)
   while (it != m_unconfirmed_txs.end())
   {
     const crypto::hash &txid = it->first;
-    bool found = std::find(pool_hashes.begin(), pool_hashes.end(), txid) != pool_hashes.end();
+    bool found = pool_hashes.count(txid) > 0;
     auto pit = it++;
     if (!found)
     {
@@ -3175,17 +3454,12 @@ std::vector<wallet2::get_pool_state_tx> wallet2::get_pool_state(bool refreshed)
   // gather txids of new blink txes to us. We just ignore non-blinks here (we pick them up when they
   // get mined into a block).
   std::vector<std::pair<crypto::hash, bool>> txids;
+  std::unordered_set<crypto::hash> up_txids;
+  for (const auto &up: m_unconfirmed_payments)
+    up_txids.insert(up.second.m_pd.m_tx_hash);
   for (const auto &txid: blink_hashes)
   {
-    bool txid_found_in_up = false;
-    for (const auto &up: m_unconfirmed_payments)
-    {
-      if (up.second.m_pd.m_tx_hash == txid)
-      {
-        txid_found_in_up = true;
-        break;
-      }
-    }
+    bool txid_found_in_up = up_txids.count(txid) > 0;
     if (m_scanned_pool_txs[0].find(txid) != m_scanned_pool_txs[0].end() || m_scanned_pool_txs[1].find(txid) != m_scanned_pool_txs[1].end())
     {
       // if it's for us, we want to keep track of whether we saw a double spend, so don't bail out
@@ -3199,24 +3473,20 @@ std::vector<wallet2::get_pool_state_tx> wallet2::get_pool_state(bool refreshed)
     {
       LOG_PRINT_L1("Found new pool tx: " << txid);
       bool found = false;
-      for (const auto &i: m_unconfirmed_txs)
+      if (auto i = m_unconfirmed_txs.find(txid); i != m_unconfirmed_txs.end())
       {
-        if (i.first == txid)
+        found = true;
+        // if this is a payment to yourself at a different subaddress account, don't skip it
+        // so that you can see the incoming pool tx with 'show_transfers' on that receiving subaddress account
+        const unconfirmed_transfer_details& utd = i->second;
+        for (const auto& dst : utd.m_dests)
         {
-          found = true;
-          // if this is a payment to yourself at a different subaddress account, don't skip it
-          // so that you can see the incoming pool tx with 'show_transfers' on that receiving subaddress account
-          const unconfirmed_transfer_details& utd = i.second;
-          for (const auto& dst : utd.m_dests)
+          auto subaddr_index = m_subaddresses.find(dst.addr.m_spend_public_key);
+          if (subaddr_index != m_subaddresses.end() && subaddr_index->second.major != utd.m_subaddr_account)
           {
-            auto subaddr_index = m_subaddresses.find(dst.addr.m_spend_public_key);
-            if (subaddr_index != m_subaddresses.end() && subaddr_index->second.major != utd.m_subaddr_account)
-            {
-              found = false;
-              break;
-            }
+            found = false;
+            break;
           }
-          break;
         }
       }
       if (!found)
@@ -3464,11 +3734,7 @@ void wallet2::refresh(bool trusted_daemon, uint64_t start_height, uint64_t & blo
   size_t try_count = 0;
   crypto::hash last_tx_hash_id = m_transfers.size() ? m_transfers.back().m_txid : null_hash;
   std::list<crypto::hash> short_chain_history;
-  tools::threadpool& tpool = tools::threadpool::getInstance();
-  tools::threadpool::waiter waiter;
   uint64_t blocks_start_height;
-  std::vector<cryptonote::block_complete_entry> blocks;
-  std::vector<parsed_block> parsed_blocks;
   std::shared_ptr<std::map<std::pair<uint64_t, uint64_t>, size_t>> output_tracker_cache;
   hw::device &hwdev = m_account.get_device();
 
@@ -3513,35 +3779,124 @@ void wallet2::refresh(bool trusted_daemon, uint64_t start_height, uint64_t & blo
   if (check_pool)
     process_pool_txs = get_pool_state(true /*refreshed*/);
 
-  bool first = true, last = false;
+  // Blocks go through the refresh in three stages: a fetch thread pulls batches from the daemon
+  // and parses them, caches their tx extra data and (for software wallets, where it doesn't need
+  // the device) generates the key derivations, keeping up to m_refresh_pipeline_depth batches
+  // ready ahead of this thread, which matches outputs against our subaddresses and applies the
+  // batches to the wallet in order.
+  const size_t pipeline_depth = std::max<size_t>(1, m_refresh_pipeline_depth);
+  const bool derive_ahead = m_key_device_type == hw::device::device_type::SOFTWARE;
   while(m_run.load(std::memory_order_relaxed))
   {
-    uint64_t next_blocks_start_height;
-    std::vector<cryptonote::block_complete_entry> next_blocks;
-    std::vector<parsed_block> next_parsed_blocks;
-    bool error;
-    std::exception_ptr exception;
+    std::mutex fetch_mutex;
+    std::condition_variable fetch_cv;
+    std::deque<refresh_batch> fetched;
+    bool fetch_done = false, fetch_error = false, synced = false, stop_fetching = false;
+
+    std::thread fetcher{[&] {
+      std::vector<crypto::hash> prev_hashes;
+      std::optional<uint64_t> prev_start_height;
+      while (true)
+      {
+        {
+          std::unique_lock lock{fetch_mutex};
+          fetch_cv.wait(lock, [&] { return stop_fetching || fetched.size() < pipeline_depth; });
+          if (stop_fetching)
+            return;
+        }
+
+        refresh_batch batch;
+        bool last, error;
+        std::exception_ptr exception;
+        pull_and_parse_next_blocks(start_height, batch.start_height, short_chain_history, prev_hashes, batch.blocks, batch.parsed_blocks, last, error, exception);
+        if (!error)
+        {
+          try
+          {
+            cache_parsed_blocks_tx_data(batch.start_height, batch.parsed_blocks, batch.tx_cache);
+            if (derive_ahead)
+            {
+              generate_tx_cache_derivations(batch.tx_cache, hwdev);
+              batch.derived = true;
+            }
+          }
+          catch (const std::exception &e)
+          {
+            MERROR("Error caching block tx data: " << e.what());
+            error = true;
+          }
+        }
+
+        std::lock_guard lock{fetch_mutex};
+        if (error)
+          fetch_error = true;
+        else if (prev_start_height && *prev_start_height == batch.start_height)
+          synced = true;
+        else if (!batch.blocks.empty())
+        {
+          prev_start_height = batch.start_height;
+          prev_hashes.clear();
+          for (size_t i = batch.parsed_blocks.size() - std::min<size_t>(3, batch.parsed_blocks.size()); i < batch.parsed_blocks.size(); ++i)
+            prev_hashes.push_back(batch.parsed_blocks[i].hash);
+          fetched.push_back(std::move(batch));
+          fetch_cv.notify_all();
+          if (!last)
+            continue;
+        }
+        fetch_done = true;
+        fetch_cv.notify_all();
+        return;
+      }
+    }};
+    auto stop_fetcher = [&] {
+      {
+        std::lock_guard lock{fetch_mutex};
+        stop_fetching = true;
+      }
+      fetch_cv.notify_all();
+      if (fetcher.joinable())
+        fetcher.join();
+    };
+    OXEN_DEFER { stop_fetcher(); };
+
     try
     {
-      // pull the next set of blocks while we're processing the current one
-      error = false;
-      next_blocks.clear();
-      next_parsed_blocks.clear();
-      added_blocks = 0;
-      if (!first && blocks.empty())
-        break;
-      if (!last)
-        tpool.submit(&waiter, [&]{pull_and_parse_next_blocks(start_height, next_blocks_start_height, short_chain_history, blocks, parsed_blocks, next_blocks, next_parsed_blocks, last, error, exception);});
-
-      if (!first)
+      while (m_run.load(std::memory_order_relaxed))
       {
+        refresh_batch batch;
+        {
+          std::unique_lock lock{fetch_mutex};
+          fetch_cv.wait(lock, [&] { return !fetched.empty() || fetch_done || fetch_error; });
+          if (fetched.empty())
+          {
+            // handle error from async fetching thread
+            if (fetch_error)
+              throw std::runtime_error("proxy exception in refresh thread");
+            if (synced)
+              m_node_rpc_proxy.set_height(m_blockchain.size());
+            break;
+          }
+          batch = std::move(fetched.front());
+          fetched.pop_front();
+        }
+        fetch_cv.notify_all();
+
+        // if we've got at least 10 blocks to refresh, assume we're starting
+        // a long refresh, and setup a tracking output cache if we need to
+        if (m_track_uses && (!output_tracker_cache || output_tracker_cache->empty()) && batch.blocks.size() >= 10)
+          output_tracker_cache = create_output_tracker_cache();
+
         try
         {
-          process_parsed_blocks(blocks_start_height, blocks, parsed_blocks, added_blocks, output_tracker_cache.get());
+          // Rings of our outgoing txes in this batch get saved in one ringdb txn
+          const bool ringdb_batch = begin_ringdb_batch();
+          OXEN_DEFER { if (ringdb_batch) commit_ringdb_batch(); };
+          process_parsed_blocks(batch.start_height, batch.blocks, batch.parsed_blocks, batch.tx_cache, batch.derived, added_blocks, output_tracker_cache.get());
         }
         catch (const tools::error::out_of_hashchain_bounds_error&)
         {
           MINFO("Daemon claims next refresh block is out of hash chain bounds, resetting hash chain");
+          stop_fetcher();
           uint64_t stop_height = m_blockchain.offset();
           std::vector<crypto::hash> tip(m_blockchain.size() - m_blockchain.offset());
           for (size_t i = m_blockchain.offset(); i < m_blockchain.size(); ++i)
@@ -3565,52 +3920,29 @@ void wallet2::refresh(bool trusted_daemon, uint64_t start_height, uint64_t & blo
         catch (const std::exception &e)
         {
           MERROR("Error parsing blocks: " << e.what());
-          error = true;
+          throw std::runtime_error("proxy exception in refresh thread");
         }
         blocks_fetched += added_blocks;
+        if (added_blocks && m_refresh_batch_hook)
+          m_refresh_batch_hook();
+        added_blocks = 0;
       }
-      waiter.wait(&tpool);
-      if(!first && blocks_start_height == next_blocks_start_height)
-      {
-        m_node_rpc_proxy.set_height(m_blockchain.size());
-        break;
-      }
-
-      first = false;
-
-      // handle error from async fetching thread
-      if (error)
-      {
-        throw std::runtime_error("proxy exception in refresh thread");
-      }
-
-      // if we've got at least 10 blocks to refresh, assume we're starting
-      // a long refresh, and setup a tracking output cache if we need to
-      if (m_track_uses && (!output_tracker_cache || output_tracker_cache->empty()) && next_blocks.size() >= 10)
-        output_tracker_cache = create_output_tracker_cache();
-
-      // switch to the new blocks from the daemon
-      blocks_start_height = next_blocks_start_height;
-      blocks = std::move(next_blocks);
-      parsed_blocks = std::move(next_parsed_blocks);
+      break;
     }
     catch (const tools::error::password_needed&)
     {
       blocks_fetched += added_blocks;
-      waiter.wait(&tpool);
       throw;
     }
     catch (const std::exception&)
     {
       blocks_fetched += added_blocks;
-      waiter.wait(&tpool);
+      added_blocks = 0;
+      stop_fetcher();
       if(try_count < 3)
       {
         LOG_PRINT_L1("Another try pull_blocks (try_count=" << try_count << ")...");
-        first = true;
         start_height = 0;
-        blocks.clear();
-        parsed_blocks.clear();
         short_chain_history.clear();
         get_short_chain_history(short_chain_history, 1);
         ++try_count;
@@ -3672,14 +4004,27 @@ bool wallet2::get_rct_distribution(uint64_t &start_height, std::vector<uint64_t>
   }
   MDEBUG("Daemon is recent enough, requesting rct distribution");
 
+  // Once we have a distribution we only ask for the last few blocks of it onwards (to pick up any
+  // small reorg) and splice those on, as long as the daemon's output count below them still
+  // matches ours; otherwise we start over with the whole chain.
+  const bool extend = m_rct_distribution.size() > RCT_DISTRIBUTION_REORG_BLOCKS && m_rct_distribution_start_height == 0;
+  const uint64_t from_height = extend ? m_rct_distribution.size() - RCT_DISTRIBUTION_REORG_BLOCKS : 0;
+
   cryptonote::rpc::GET_OUTPUT_DISTRIBUTION_BIN::request req{};
   cryptonote::rpc::GET_OUTPUT_DISTRIBUTION_BIN::response res{};
   req.amounts.push_back(0);
-  req.from_height = 0;
-  req.cumulative = false;
+  req.from_height = from_height;
+  req.cumulative = extend;
   req.binary = true;
   req.compress = true;
   bool r = invoke_http<rpc::GET_OUTPUT_DISTRIBUTION_BIN>(req, res);
+  if (extend && (!r || (res.status != rpc::STATUS_OK && res.status != rpc::STATUS_BUSY)))
+  {
+    // e.g. the daemon's chain is now shorter than our cached distribution
+    MDEBUG("Failed to extend cached rct distribution, requesting all of it");
+    m_rct_distribution.clear();
+    return get_rct_distribution(start_height, distribution);
+  }
   if (!r)
   {
     MWARNING("Failed to request output distribution: no connection to daemon");
@@ -3705,14 +4050,32 @@ bool wallet2::get_rct_distribution(uint64_t &start_height, std::vector<uint64_t>
     MWARNING("Failed to request output distribution: results are not for amount 0");
     return false;
   }
-  for (size_t i = 1; i < res.distributions[0].data.distribution.size(); ++i)
-    res.distributions[0].data.distribution[i] += res.distributions[0].data.distribution[i-1];
-  start_height = res.distributions[0].data.start_height;
-  distribution = std::move(res.distributions[0].data.distribution);
+  auto &data = res.distributions[0].data;
+  if (extend)
+  {
+    if (data.start_height != from_height || data.base != m_rct_distribution[from_height - 1])
+    {
+      MDEBUG("Cached rct distribution no longer matches the daemon's, requesting all of it");
+      m_rct_distribution.clear();
+      return get_rct_distribution(start_height, distribution);
+    }
+    m_rct_distribution.resize(from_height);
+    m_rct_distribution.insert(m_rct_distribution.end(), data.distribution.begin(), data.distribution.end());
+    MDEBUG("Extended cached rct distribution from " << from_height << " to " << m_rct_distribution.size());
+  }
+  else
+  {
+    for (size_t i = 1; i < data.distribution.size(); ++i)
+      data.distribution[i] += data.distribution[i-1];
+    m_rct_distribution_start_height = data.start_height;
+    m_rct_distribution = std::move(data.distribution);
+  }
+  start_height = m_rct_distribution_start_height;
+  distribution = m_rct_distribution;
   return true;
 }
 //----------------------------------------------------------------------------------------------------
-bool wallet2::get_output_blacklist(std::vector<uint64_t> &blacklist)
+bool wallet2::update_output_blacklist()
 {
   rpc::version_t rpc_version;
   if (!m_node_rpc_proxy.get_rpc_version(rpc_version))
@@ -3726,16 +4089,49 @@ bool wallet2::get_output_blacklist(std::vector<uint64_t> &blacklist)
   }
   MDEBUG("Daemon is recent enough, requesting output blacklist");
 
+  // Blacklisted outputs only get added, so once we have the list we ask for the entries after the
+  // last one we have; if the daemon's total then doesn't match ours (e.g. after a reorg) we start
+  // over with the whole list.
+  const bool delta = m_output_blacklist_last && rpc_version >= rpc::version_t{4, 1};
+  cryptonote::rpc::GET_OUTPUT_BLACKLIST::request req{};
+  if (delta)
+    req.after = m_output_blacklist_last;
   cryptonote::rpc::GET_OUTPUT_BLACKLIST::response res = {};
-  bool r = invoke_http<rpc::GET_OUTPUT_BLACKLIST>({}, res);
+  bool r = invoke_http<rpc::GET_OUTPUT_BLACKLIST>(req, res);
 
   if (!r)
   {
     MWARNING("Failed to request output blacklist: no connection to daemon");
     return false;
   }
+  if (res.status != rpc::STATUS_OK)
+  {
+    MWARNING("Failed to request output blacklist: " << res.status);
+    return false;
+  }
 
-  blacklist = std::move(res.blacklist);
+  if (!delta)
+  {
+    m_output_blacklist.clear();
+    m_output_blacklist_last.reset();
+    m_output_blacklist_count = 0;
+  }
+  else if (m_output_blacklist_count + res.blacklist.size() != res.total)
+  {
+    MDEBUG("Cached output blacklist no longer matches the daemon's, requesting all of it");
+    m_output_blacklist_last.reset();
+    return update_output_blacklist();
+  }
+
+  for (uint64_t i : res.blacklist)
+  {
+    if (i >= m_output_blacklist.size())
+      m_output_blacklist.resize(i + 1);
+    m_output_blacklist[i] = true;
+    if (!m_output_blacklist_last || i > *m_output_blacklist_last)
+      m_output_blacklist_last = i;
+  }
+  m_output_blacklist_count += res.blacklist.size();
   return true;
 }
 //----------------------------------------------------------------------------------------------------
@@ -3791,6 +4187,7 @@ void wallet2::detach_blockchain(uint64_t height, std::map<std::pair<uint64_t, ui
   }
   transfers_detached = std::distance(it, m_transfers.end());
   m_transfers.erase(it, m_transfers.end());
+  reindex_unspent_transfers(i_start);
 
   size_t blocks_detached = m_blockchain.size() - height;
   m_blockchain.crop(height);
@@ -3812,6 +4209,8 @@ void wallet2::detach_blockchain(uint64_t height, std::map<std::pair<uint64_t, ui
   }
 
   LOG_PRINT_L0("Detached blockchain on height " << height << ", transfers detached " << transfers_detached << ", blocks detached " << blocks_detached);
+  if (0 != m_callback)
+    m_callback->on_reorg(height);
 }
 //----------------------------------------------------------------------------------------------------
 bool wallet2::deinit()
@@ -3828,6 +4227,7 @@ bool wallet2::clear()
   m_transfers.clear();
   m_key_images.clear();
   m_pub_keys.clear();
+  m_unspent_transfers.clear();
   m_unconfirmed_txs.clear();
   m_payments.clear();
   m_tx_keys.clear();
@@ -3851,6 +4251,7 @@ void wallet2::clear_soft(bool keep_key_images)
   if (!keep_key_images)
     m_key_images.clear();
   m_pub_keys.clear();
+  m_unspent_transfers.clear();
   m_unconfirmed_txs.clear();
   m_payments.clear();
   m_confirmed_txs.clear();
@@ -4048,6 +4449,9 @@ std::optional<wallet2::keys_file_data> wallet2::get_keys_file_data(const epee::w
   value2.SetInt(m_track_uses ? 1 : 0);
   json.AddMember("track_uses", value2, json.GetAllocator());
 
+  value2.SetUint(m_refresh_pipeline_depth);
+  json.AddMember("refresh_pipeline_depth", value2, json.GetAllocator());
+
   value2.SetInt(m_inactivity_lock_timeout.count());
   json.AddMember("inactivity_lock_timeout", value2, json.GetAllocator());
 
@@ -4215,6 +4619,7 @@ bool wallet2::load_keys_buf(const std::string& keys_buf, const epee::wipeable_st
     m_ignore_outputs_above = MONEY_SUPPLY;
     m_ignore_outputs_below = 0;
     m_track_uses = false;
+    m_refresh_pipeline_depth = DEFAULT_REFRESH_PIPELINE_DEPTH;
     m_inactivity_lock_timeout = DEFAULT_INACTIVITY_LOCK_TIMEOUT;
     m_subaddress_lookahead_major = SUBADDRESS_LOOKAHEAD_MAJOR;
     m_subaddress_lookahead_minor = SUBADDRESS_LOOKAHEAD_MINOR;
@@ -4374,6 +4779,8 @@ bool wallet2::load_keys_buf(const std::string& keys_buf, const epee::wipeable_st
     m_ignore_outputs_below = field_ignore_outputs_below;
     GET_FIELD_FROM_JSON_RETURN_ON_ERROR(json, track_uses, int, Int, false, false);
     m_track_uses = field_track_uses;
+    GET_FIELD_FROM_JSON_RETURN_ON_ERROR(json, refresh_pipeline_depth, uint32_t, Uint, false, DEFAULT_REFRESH_PIPELINE_DEPTH);
+    m_refresh_pipeline_depth = field_refresh_pipeline_depth;
     GET_FIELD_FROM_JSON_RETURN_ON_ERROR(json, inactivity_lock_timeout, uint32_t, Uint, false,
             m_nettype == MAINNET ? std::chrono::seconds{DEFAULT_INACTIVITY_LOCK_TIMEOUT}.count() : 0);
     m_inactivity_lock_timeout = std::chrono::seconds{field_inactivity_lock_timeout};
@@ -5652,8 +6059,10 @@ void wallet2::generate_chacha_key_from_password(const epee::wipeable_string &pas
 //----------------------------------------------------------------------------------------------------
 void wallet2::load(const fs::path& wallet_, const epee::wipeable_string& password, const std::string& keys_buf, const std::string& cache_buf)
 {
+  m_blockchain.detach();
   clear();
   prepare_file_names(wallet_);
+  m_stored_cache_hash = crypto::null_hash;
 
   // determine if loading from file system or string buffer
   bool use_fs = !wallet_.empty();
@@ -5716,8 +6125,8 @@ void wallet2::load(const fs::path& wallet_, const epee::wipeable_string& passwor
       crypto::chacha20(cache_file_data.cache_data.data(), cache_file_data.cache_data.size(), m_cache_key, cache_file_data.iv, &cache_data[0]);
 
       try {
-        std::stringstream iss;
-        iss << cache_data;
+        serialization::one_shot_read_buffer buf{cache_data};
+        std::istream iss{&buf};
         boost::archive::portable_binary_iarchive ar(iss);
         ar >> *this;
       }
@@ -5728,8 +6137,8 @@ void wallet2::load(const fs::path& wallet_, const epee::wipeable_string& passwor
         generate_chacha_key_from_secret_keys(key);
         crypto::chacha20(cache_file_data.cache_data.data(), cache_file_data.cache_data.size(), key, cache_file_data.iv, &cache_data[0]);
         try {
-          std::stringstream iss;
-          iss << cache_data;
+          serialization::one_shot_read_buffer buf{cache_data};
+          std::istream iss{&buf};
           boost::archive::portable_binary_iarchive ar(iss);
           ar >> *this;
         }
@@ -5738,8 +6147,8 @@ void wallet2::load(const fs::path& wallet_, const epee::wipeable_string& passwor
           crypto::chacha8(cache_file_data.cache_data.data(), cache_file_data.cache_data.size(), key, cache_file_data.iv, &cache_data[0]);
           try
           {
-            std::stringstream iss;
-            iss << cache_data;
+            serialization::one_shot_read_buffer buf{cache_data};
+            std::istream iss{&buf};
             boost::archive::portable_binary_iarchive ar(iss);
             ar >> *this;
           }
@@ -5749,8 +6158,8 @@ void wallet2::load(const fs::path& wallet_, const epee::wipeable_string& passwor
             auto unportable = m_wallet_file;
             unportable += ".unportable";
             if (use_fs) fs::copy_file(m_wallet_file, unportable, fs::copy_options::overwrite_existing);
-            std::stringstream iss;
-            iss << cache_data;
+            serialization::one_shot_read_buffer buf{cache_data};
+            std::istream iss{&buf};
             boost::archive::binary_iarchive ar(iss);
             ar >> *this;
           }
@@ -5761,8 +6170,8 @@ void wallet2::load(const fs::path& wallet_, const epee::wipeable_string& passwor
     {
       LOG_PRINT_L1("Failed to load encrypted cache, trying unencrypted");
       try {
-        std::stringstream iss;
-        iss << cache_file_buf;
+        serialization::one_shot_read_buffer buf{cache_file_buf};
+        std::istream iss{&buf};
         boost::archive::portable_binary_iarchive ar(iss);
         ar >> *this;
       }
@@ -5772,8 +6181,8 @@ void wallet2::load(const fs::path& wallet_, const epee::wipeable_string& passwor
         auto unportable = m_wallet_file;
         unportable += ".unportable";
         if (use_fs) fs::copy_file(m_wallet_file, unportable, fs::copy_options::overwrite_existing);
-        std::stringstream iss;
-        iss << cache_file_buf;
+        serialization::one_shot_read_buffer buf{cache_file_buf};
+        std::istream iss{&buf};
         boost::archive::binary_iarchive ar(iss);
         ar >> *this;
       }
@@ -5784,6 +6193,16 @@ void wallet2::load(const fs::path& wallet_, const epee::wipeable_string& passwor
       error::wallet_files_doesnt_correspond, m_keys_file, m_wallet_file);
   }
 
+  if (!m_blockchain.loaded())
+  {
+    // The cache kept the hashchain in its own file (a cache loaded from a buffer can't have one)
+    if (!use_fs || !m_blockchain.attach(hashchain_file_name(m_wallet_file)))
+    {
+      MWARNING("The wallet's hashchain file is missing or out of date, the blockchain will be rescanned");
+      clear_soft(false);
+    }
+  }
+
   cryptonote::block genesis;
   generate_genesis(genesis);
   crypto::hash genesis_hash = get_block_hash(genesis);
@@ -5799,6 +6218,7 @@ void wallet2::load(const fs::path& wallet_, const epee::wipeable_string& passwor
   }
 
   trim_hashchain();
+  reindex_unspent_transfers();
 
   if (get_num_subaddress_accounts() == 0)
     add_subaddress_account(tr("Primary account"));
@@ -5898,8 +6318,20 @@ void wallet2::store_to(const fs::path &path, const epee::wipeable_string &passwo
       fs::create_directories(parent_path);
   }
 
+  // The hashchain lives in a flat file next to the cache (and moves with it)
+  fs::path new_wallet_file = m_wallet_file;
+  if (!same_file)
+  {
+    fs::path keys_file, mms_file;
+    do_prepare_file_names(path, keys_file, new_wallet_file, mms_file);
+  }
+  const fs::path old_hashchain_file = m_blockchain.path();
+  if (!new_wallet_file.empty())
+    m_blockchain.attach(hashchain_file_name(new_wallet_file));
+
   // get wallet cache data
-  std::optional<wallet2::cache_file_data> cache_file_data = get_cache_file_data(password);
+  crypto::hash cache_hash;
+  std::optional<wallet2::cache_file_data> cache_file_data = get_cache_file_data(password, &cache_hash);
   THROW_WALLET_EXCEPTION_IF(!cache_file_data, error::wallet_internal_error, "failed to generate wallet cache data");
 
   const auto& old_file = m_wallet_file;
@@ -5912,6 +6344,7 @@ void wallet2::store_to(const fs::path &path, const epee::wipeable_string &passwo
   // if we here, main wallet file is saved and we only need to save keys and address files
   if (!same_file) {
     prepare_file_names(path);
+    m_stored_cache_hash = crypto::null_hash;
     bool r = store_keys(m_keys_file, password, false);
     THROW_WALLET_EXCEPTION_IF(!r, error::file_save_error, m_keys_file);
     if (fs::exists(old_address_file))
@@ -5934,6 +6367,12 @@ void wallet2::store_to(const fs::path &path, const epee::wipeable_string &passwo
     // remove old message store file
     if (fs::exists(old_mms_file, ec) && !fs::remove(old_mms_file, ec))
       LOG_ERROR("error removing file: " << old_mms_file << ": " << ec.message());
+    // remove old hashchain file
+    if (!old_hashchain_file.empty() && old_hashchain_file != m_blockchain.path() && !fs::remove(old_hashchain_file, ec))
+      LOG_ERROR("error removing file: " << old_hashchain_file << ": " << ec.message());
+  } else if (cache_hash == m_stored_cache_hash && fs::exists(m_wallet_file, ec)) {
+    // Nothing has changed since the last store, so the existing cache file is still current
+    MDEBUG("Wallet cache unchanged, not rewriting " << m_wallet_file);
   } else {
     // save to new file
     fs::path new_file = m_wallet_file;
@@ -5957,6 +6396,7 @@ void wallet2::store_to(const fs::path &path, const epee::wipeable_string &passwo
 #endif
     fs::rename(new_file, m_wallet_file, e);
     THROW_WALLET_EXCEPTION_IF(e, error::file_save_error, m_wallet_file, e);
+    m_stored_cache_hash = cache_hash;
   }
 
   if (m_message_store.get_active())
@@ -5967,9 +6407,10 @@ void wallet2::store_to(const fs::path &path, const epee::wipeable_string &passwo
   }
 }
 //----------------------------------------------------------------------------------------------------
-std::optional<wallet2::cache_file_data> wallet2::get_cache_file_data(const epee::wipeable_string &passwords)
+std::optional<wallet2::cache_file_data> wallet2::get_cache_file_data(const epee::wipeable_string &passwords, crypto::hash *cache_hash)
 {
   trim_hashchain();
+  m_blockchain.flush();
   try
   {
     std::stringstream oss;
@@ -5978,11 +6419,17 @@ std::optional<wallet2::cache_file_data> wallet2::get_cache_file_data(const epee:
 
     std::optional<wallet2::cache_file_data> cache_file_data = (wallet2::cache_file_data) {};
     cache_file_data->cache_data = oss.str();
-    std::string cipher;
-    cipher.resize(cache_file_data->cache_data.size());
+    if (cache_hash)
+    {
+      // Bind the contents hash to the cache key so that a password change still forces a rewrite
+      epee::mlocked<tools::scrubbed_arr<char, 2*HASH_SIZE>> hash_data;
+      crypto::cn_fast_hash(cache_file_data->cache_data.data(), cache_file_data->cache_data.size(), *reinterpret_cast<crypto::hash*>(hash_data.data()));
+      memcpy(hash_data.data() + HASH_SIZE, &m_cache_key, HASH_SIZE);
+      crypto::cn_fast_hash(hash_data.data(), hash_data.size(), *cache_hash);
+    }
+    // chacha20 can encrypt in place, which saves holding a second copy of the (possibly large) cache
     cache_file_data->iv = crypto::rand<crypto::chacha_iv>();
-    crypto::chacha20(cache_file_data->cache_data.data(), cache_file_data->cache_data.size(), m_cache_key, cache_file_data->iv, &cipher[0]);
-    cache_file_data->cache_data = cipher;
+    crypto::chacha20(cache_file_data->cache_data.data(), cache_file_data->cache_data.size(), m_cache_key, cache_file_data->iv, cache_file_data->cache_data.data());
     return cache_file_data;
   }
   catch(...)
@@ -6024,9 +6471,10 @@ uint64_t wallet2::unlocked_balance(uint32_t index_major, bool strict, uint64_t *
 std::map<uint32_t, uint64_t> wallet2::balance_per_subaddress(uint32_t index_major, bool strict) const
 {
   std::map<uint32_t, uint64_t> amount_per_subaddr;
-  for (const auto& td: m_transfers)
+  for (size_t i : unspent_transfers(index_major))
   {
-    if (td.m_subaddr_index.major == index_major && !is_spent(td, strict) && !td.m_frozen)
+    const transfer_details& td = m_transfers[i];
+    if (!is_spent(td, strict) && !td.m_frozen)
     {
       auto found = amount_per_subaddr.find(td.m_subaddr_index.minor);
       if (found == amount_per_subaddr.end())
@@ -6058,9 +6506,10 @@ std::map<uint32_t, std::pair<uint64_t, std::pair<uint64_t, uint64_t>>> wallet2::
   std::map<uint32_t, std::pair<uint64_t, std::pair<uint64_t, uint64_t>>> amount_per_subaddr;
   const uint64_t blockchain_height = get_blockchain_current_height();
   const uint64_t now = time(NULL);
-  for(const transfer_details& td: m_transfers)
+  for (size_t i : unspent_transfers(index_major))
   {
-    if(td.m_subaddr_index.major == index_major && !is_spent(td, strict) && !td.m_frozen)
+    const transfer_details& td = m_transfers[i];
+    if(!is_spent(td, strict) && !td.m_frozen)
     {
       uint64_t amount = 0, blocks_to_unlock = 0, time_to_unlock = 0;
       if (is_transfer_unlocked(td))
@@ -6265,7 +6714,7 @@ wallet::transfer_view wallet2::make_transfer_view(const crypto::hash &payment_id
   return result;
 }
 //----------------------------------------------------------------------------------------------------
-void wallet2::get_transfers(get_transfers_args_t args, std::vector<wallet::transfer_view>& transfers)
+void wallet2::get_transfers(get_transfers_args_t args, std::vector<wallet::transfer_view>& transfers, std::optional<transfer_cursor>* next)
 {
   std::optional<uint32_t> account_index = args.account_index;
   if (args.all_accounts)
@@ -6315,10 +6764,16 @@ void wallet2::get_transfers(get_transfers_args_t args, std::vector<wallet::trans
     size += pool.size();
   }
 
-  // Fill transfers
-  transfers.reserve(size);
+  // Order the matching entries by their (cheap) sort position first, so that only the ones actually
+  // returned have to be turned into transfer_views.
+  std::vector<std::pair<transfer_cursor, std::function<wallet::transfer_view()>>> entries;
+  entries.reserve(size);
   for (const auto &i : in)
-    transfers.push_back(make_transfer_view(i.second.m_tx_hash, i.first, i.second));
+  {
+    const auto &pd = i.second;
+    entries.emplace_back(transfer_cursor{true, pd.m_unmined_blink, pd.m_block_height, pd.m_timestamp, pd.m_tx_hash, 0, pd.m_subaddr_index},
+        [this, &i] { return make_transfer_view(i.second.m_tx_hash, i.first, i.second); });
+  }
   for (const auto &o : out)
   {
     bool add_entry = true;
@@ -6328,30 +6783,67 @@ void wallet2::get_transfers(get_transfers_args_t args, std::vector<wallet::trans
       add_entry = o.second.m_pay_type == wallet::pay_type::ons;
 
     if (add_entry)
-      transfers.push_back(make_transfer_view(o.first, o.second));
+      entries.emplace_back(transfer_cursor{true, false, o.second.m_block_height, o.second.m_timestamp, o.first, 1, {o.second.m_subaddr_account, 0}},
+          [this, &o] { return make_transfer_view(o.first, o.second); });
   }
   for (const auto &pof : pending_or_failed)
   {
     bool is_failed = pof.second.m_state == tools::wallet2::unconfirmed_transfer_details::failed;
     if (is_failed ? args.failed : args.pending)
-      transfers.push_back(make_transfer_view(pof.first, pof.second));
+      entries.emplace_back(transfer_cursor{false, false, 0, pof.second.m_timestamp, pof.first, 2, {pof.second.m_subaddr_account, 0}},
+          [this, &pof] { return make_transfer_view(pof.first, pof.second); });
   }
   for (const auto &p : pool)
-    transfers.push_back(make_transfer_view(p.first, p.second));
-
-  std::sort(transfers.begin(), transfers.end(), [](const auto& a, const auto& b) -> bool {
-    if (a.confirmed != b.confirmed)
-      return a.confirmed;
-    if (a.blink_mempool != b.blink_mempool)
-      return b.blink_mempool;
-    if (a.height != b.height)
-      return a.height < b.height;
-    if (a.timestamp != b.timestamp)
-      return a.timestamp < b.timestamp;
-    return a.hash < b.hash;
-  });
+  {
+    const auto &pd = p.second.m_pd;
+    entries.emplace_back(transfer_cursor{false, false, 0, pd.m_timestamp, pd.m_tx_hash, 3, pd.m_subaddr_index},
+        [this, &p] { return make_transfer_view(p.first, p.second); });
+  }
+
+  std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+  auto it = entries.begin();
+  if (args.after)
+    it = std::upper_bound(entries.begin(), entries.end(), *args.after, [](const auto& c, const auto& e) { return c < e.first; });
+  auto end = args.limit && static_cast<size_t>(entries.end() - it) > args.limit ? it + args.limit : entries.end();
+
+  transfers.clear();
+  transfers.reserve(end - it);
+  for (auto e = it; e != end; ++e)
+    transfers.push_back(e->second());
+  if (next)
+  {
+    if (end != entries.end() && end != it)
+      *next = std::prev(end)->first;
+    else
+      *next = std::nullopt;
+  }
 }
 
+//----------------------------------------------------------------------------------------------------
+std::string wallet2::transfer_cursor::to_string() const
+{
+  return std::string{confirmed ? "1" : "0"} + "-" + (blink_mempool ? "1" : "0") + "-" + std::to_string(height) + "-" +
+    std::to_string(timestamp) + "-" + tools::type_to_hex(hash) + "-" + std::to_string(source) + "-" +
+    std::to_string(subaddr_index.major) + "-" + std::to_string(subaddr_index.minor);
+}
+//----------------------------------------------------------------------------------------------------
+std::optional<wallet2::transfer_cursor> wallet2::transfer_cursor::parse(std::string_view str)
+{
+  auto parts = tools::split(str, "-");
+  transfer_cursor c;
+  int confirmed, blink;
+  if (parts.size() != 8 ||
+      !tools::parse_int(parts[0], confirmed) || !tools::parse_int(parts[1], blink) ||
+      !tools::parse_int(parts[2], c.height) || !tools::parse_int(parts[3], c.timestamp) ||
+      !tools::hex_to_type(parts[4], c.hash) || !tools::parse_int(parts[5], c.source) ||
+      !tools::parse_int(parts[6], c.subaddr_index.major) || !tools::parse_int(parts[7], c.subaddr_index.minor))
+    return std::nullopt;
+  c.confirmed = confirmed;
+  c.blink_mempool = blink;
+  return c;
+}
+//----------------------------------------------------------------------------------------------------
 std::string wallet2::transfers_to_csv(const std::vector<wallet::transfer_view>& transfers, bool formatting) const
 {
   uint64_t running_balance = 0;
@@ -7640,9 +8132,19 @@ bool wallet2::sign_multisig_tx(multisig_tx_set &exported_txs, std::vector<crypto
 
   txids.clear();
 
-  // sign the transactions
-  for (size_t n = 0; n < exported_txs.m_ptx.size(); ++n)
-  {
+  // The public halves of our multisig keys, which every signature checks for; computed once here
+  // rather than for each signature of each tx.
+  const auto &multisig_keys = get_account().get_multisig_keys();
+  std::vector<crypto::public_key> multisig_pkeys;
+  multisig_pkeys.reserve(multisig_keys.size());
+  for (const auto &msk: multisig_keys)
+    multisig_pkeys.push_back(get_multisig_signing_public_key(msk));
+
+  const bool is_last = exported_txs.m_signers.size() + 1 >= m_multisig_threshold;
+  std::vector<crypto::hash> signed_txids(exported_txs.m_ptx.size());
+
+  // Signs one tx; touches nothing but the tx itself, so txs can be signed in parallel
+  auto sign_one = [&](size_t n) {
     tools::wallet2::pending_tx &ptx = exported_txs.m_ptx[n];
     THROW_WALLET_EXCEPTION_IF(ptx.multisig_sigs.empty(), error::wallet_internal_error, "No signatures found in multisig tx");
     auto &sd = ptx.construction_data;
@@ -7684,14 +8186,12 @@ bool wallet2::sign_multisig_tx(multisig_tx_set &exported_txs, std::vector<crypto
         for (size_t idx: sd.selected_transfers)
           k.push_back(get_multisig_k(idx, sig.used_L));
 
-        for (const auto &msk: get_account().get_multisig_keys())
+        for (size_t i = 0; i < multisig_keys.size(); ++i)
         {
-          crypto::public_key pmsk = get_multisig_signing_public_key(msk);
-
-          if (sig.signing_keys.find(pmsk) == sig.signing_keys.end())
+          if (sig.signing_keys.find(multisig_pkeys[i]) == sig.signing_keys.end())
           {
-            sc_add(skey.bytes, skey.bytes, rct::sk2rct(msk).bytes);
-            sig.signing_keys.insert(pmsk);
+            sc_add(skey.bytes, skey.bytes, rct::sk2rct(multisig_keys[i]).bytes);
+            sig.signing_keys.insert(multisig_pkeys[i]);
           }
         }
         THROW_WALLET_EXCEPTION_IF(!rct::signMultisig(ptx.tx.rct_signatures, indices, k, sig.msout, skey),
@@ -7701,7 +8201,6 @@ bool wallet2::sign_multisig_tx(multisig_tx_set &exported_txs, std::vector<crypto
       }
     }
 
-    const bool is_last = exported_txs.m_signers.size() + 1 >= m_multisig_threshold;
     if (is_last)
     {
       // when the last signature on a multisig tx is made, we select the right
@@ -7718,7 +8217,41 @@ bool wallet2::sign_multisig_tx(multisig_tx_set &exported_txs, std::vector<crypto
       }
       THROW_WALLET_EXCEPTION_IF(!found, error::wallet_internal_error,
           "Final signed transaction not found: this transaction was likely made without our export data, so we cannot sign it");
-      const crypto::hash txid = get_transaction_hash(ptx.tx);
+      signed_txids[n] = get_transaction_hash(ptx.tx);
+    }
+  };
+
+  // sign the transactions; large batches are spread across the threadpool (the software device is
+  // stateless, but hardware devices have to be driven one tx at a time)
+  if (exported_txs.m_ptx.size() < 2 || m_account.get_device().get_type() != hw::device::device_type::SOFTWARE)
+  {
+    for (size_t n = 0; n < exported_txs.m_ptx.size(); ++n)
+      sign_one(n);
+  }
+  else
+  {
+    tools::threadpool& tpool = tools::threadpool::getInstance();
+    tools::threadpool::waiter waiter;
+    std::vector<std::exception_ptr> errors(exported_txs.m_ptx.size());
+    for (size_t n = 0; n < exported_txs.m_ptx.size(); ++n)
+    {
+      tpool.submit(&waiter, [&, n]() {
+        try { sign_one(n); }
+        catch (...) { errors[n] = std::current_exception(); }
+      }, true);
+    }
+    waiter.wait(&tpool);
+    for (const auto &e : errors)
+      if (e)
+        std::rethrow_exception(e);
+  }
+
+  if (is_last)
+  {
+    for (size_t n = 0; n < exported_txs.m_ptx.size(); ++n)
+    {
+      const crypto::hash &txid = signed_txids[n];
+      const auto &ptx = exported_txs.m_ptx[n];
       if (store_tx_info())
       {
         m_tx_keys.insert(std::make_pair(txid, ptx.tx_key));
@@ -7936,6 +8469,30 @@ bool wallet2::get_ring(const crypto::chacha_key &key, const crypto::key_image &k
   catch (const std::exception &e) { return false; }
 }
 
+bool wallet2::get_rings(const crypto::chacha_key &key, const std::vector<crypto::key_image> &key_images, std::unordered_map<crypto::key_image, std::vector<uint64_t>> &rings)
+{
+  if (!m_ringdb)
+    return false;
+  try { return m_ringdb->get_rings(key, key_images, rings); }
+  catch (const std::exception &e) { return false; }
+}
+
+bool wallet2::begin_ringdb_batch()
+{
+  if (!m_ringdb || m_ringdb->in_batch())
+    return false;
+  m_ringdb->begin_batch();
+  return true;
+}
+
+void wallet2::commit_ringdb_batch()
+{
+  if (!m_ringdb || !m_ringdb->in_batch())
+    return;
+  try { m_ringdb->commit_batch(); }
+  catch (const std::exception &e) { MERROR("Failed to save rings: " << e.what()); }
+}
+
 bool wallet2::get_rings(const crypto::hash &txid, std::vector<std::pair<crypto::key_image, std::vector<uint64_t>>> &outs)
 {
   for (auto i: m_confirmed_txs)
@@ -8018,13 +8575,15 @@ bool wallet2::find_and_save_rings(bool force)
 
   MDEBUG("Found " << std::to_string(txs_hashes.size()) << " transactions");
 
-  // get those transactions from the daemon
+  // get those transactions from the daemon, and save all their rings in one ringdb txn
+  const bool ringdb_batch = begin_ringdb_batch();
+  OXEN_DEFER { if (ringdb_batch) commit_ringdb_batch(); };
   auto it = txs_hashes.begin();
   constexpr size_t SLICE_SIZE = 200;
   for (size_t slice = 0; slice < txs_hashes.size(); slice += SLICE_SIZE)
   {
     size_t ntxes = slice + SLICE_SIZE > txs_hashes.size() ? txs_hashes.size() - slice : SLICE_SIZE;
-    auto res = request_transactions(hashes_to_hex(txs_hashes.begin() + slice, txs_hashes.begin() + ntxes));
+    auto res = request_transactions(hashes_to_hex(txs_hashes.begin() + slice, txs_hashes.begin() + slice + ntxes));
 
     MDEBUG("Scanning " << res.txs.size() << " transactions");
     for (size_t i = 0; i < res.txs.size(); ++i, ++it)
@@ -9211,22 +9770,19 @@ void wallet2::light_wallet_get_outs(std::vector<std::vector<tools::wallet2::get_
   }
 }
 
-std::pair<std::set<uint64_t>, size_t> outs_unique(const std::vector<std::vector<tools::wallet2::get_outs_entry>> &outs)
+std::vector<uint64_t> outs_indices(const std::vector<std::vector<tools::wallet2::get_outs_entry>> &outs)
 {
-  std::set<uint64_t> unique;
+  std::vector<uint64_t> indices;
   size_t total = 0;
+  for (const auto &it : outs)
+    total += it.size();
+  indices.reserve(total);
 
   for (const auto &it : outs)
-  {
     for (const auto &out : it)
-    {
-      const uint64_t global_index = std::get<0>(out);
-      unique.insert(global_index);
-    }
-    total += it.size();
-  }
+      indices.push_back(std::get<0>(out));
 
-  return std::make_pair(std::move(unique), total);
+  return indices;
 }
 
 void wallet2::get_outs(std::vector<std::vector<tools::wallet2::get_outs_entry>> &outs, const std::vector<size_t> &selected_transfers, size_t fake_outputs_count, bool has_rct)
@@ -9236,8 +9792,8 @@ void wallet2::get_outs(std::vector<std::vector<tools::wallet2::get_outs_entry>>
   {
     get_outs(outs, selected_transfers, fake_outputs_count, rct_offsets, has_rct);
 
-    const auto unique = outs_unique(outs);
-    if (tx_sanity_check(unique.first, unique.second, rct_offsets.empty() ? 0 : rct_offsets.back()))
+    auto indices = outs_indices(outs);
+    if (tx_sanity_check(indices, rct_offsets.empty() ? 0 : rct_offsets.back()))
     {
       return;
     }
@@ -9308,15 +9864,13 @@ void wallet2::get_outs(std::vector<std::vector<tools::wallet2::get_outs_entry>>
       }
     }
 
-    std::vector<uint64_t> output_blacklist;
-    if (!get_output_blacklist(output_blacklist))
+    if (!update_output_blacklist())
       THROW_WALLET_EXCEPTION_IF(true, error::get_output_blacklist, "Couldn't retrive list of outputs that are to be excluded from selection");
 
-    std::sort(output_blacklist.begin(), output_blacklist.end());
-    if (output_blacklist.size() * 0.05 > (double)rct_offsets.size())
+    if (m_output_blacklist_count * 0.05 > (double)rct_offsets.size())
     {
       MWARNING("More than 5% of outputs are blacklisted ("
-               << output_blacklist.size() << "/" << rct_offsets.size()
+               << m_output_blacklist_count << "/" << rct_offsets.size()
                << "), please notify the Loki developers");
     }
 
@@ -9391,6 +9945,17 @@ void wallet2::get_outs(std::vector<std::vector<tools::wallet2::get_outs_entry>>
     if (has_rct_distribution)
       gamma.reset(new gamma_picker(rct_offsets));
 
+    // Look up any rings we already used for these outputs (e.g. on another fork) in one go
+    std::unordered_map<crypto::key_image, std::vector<uint64_t>> known_rings;
+    {
+      std::vector<crypto::key_image> key_images;
+      for (size_t idx: selected_transfers)
+        if (m_transfers[idx].m_key_image_known && !m_transfers[idx].m_key_image_partial)
+          key_images.push_back(m_transfers[idx].m_key_image);
+      if (!key_images.empty())
+        get_rings(get_ringdb_key(), key_images, known_rings);
+    }
+
     size_t num_selected_transfers = 0;
     for(size_t idx: selected_transfers)
     {
@@ -9501,9 +10066,9 @@ void wallet2::get_outs(std::vector<std::vector<tools::wallet2::get_outs_entry>>
       // if we have a known ring, use it
       if (td.m_key_image_known && !td.m_key_image_partial)
       {
-        std::vector<uint64_t> ring;
-        if (get_ring(get_ringdb_key(), td.m_key_image, ring))
+        if (auto known = known_rings.find(td.m_key_image); known != known_rings.end())
         {
+          const auto &ring = known->second;
           MINFO("This output has a known ring, reusing (size " << ring.size() << ")");
           THROW_WALLET_EXCEPTION_IF(ring.size() > fake_outputs_count + 1, error::wallet_internal_error,
               "An output in this transaction was previously spent on another chain with ring size " +
@@ -9655,7 +10220,7 @@ void wallet2::get_outs(std::vector<std::vector<tools::wallet2::get_outs_entry>>
           if (!allow_blackballed_or_blacklisted)
           {
             if (is_output_blackballed(std::make_pair(amount, i)) ||
-                std::binary_search(output_blacklist.begin(), output_blacklist.end(), i))
+                is_output_blacklisted(i))
             {
               --num_usable_outs;
               continue;
@@ -9794,10 +10359,9 @@ void wallet2::get_outs(std::vector<std::vector<tools::wallet2::get_outs_entry>>
       // then pick outs from an existing ring, if any
       if (td.m_key_image_known && !td.m_key_image_partial)
       {
-        std::vector<uint64_t> ring;
-        if (get_ring(get_ringdb_key(), td.m_key_image, ring))
+        if (auto known = known_rings.find(td.m_key_image); known != known_rings.end())
         {
-          for (uint64_t out: ring)
+          for (uint64_t out: known->second)
           {
             if (out < num_outs)
             {
@@ -10212,7 +10776,7 @@ void wallet2::transfer_selected_rct(std::vector<cryptonote::tx_destination_entry
   ptx.construction_data.hf_version = tx_params.hf_version;
   ptx.construction_data.rct_config = {
     tx.rct_signatures.p.bulletproofs.empty() ? rct::RangeProofType::Borromean : rct::RangeProofType::PaddedBulletproof,
-    use_fork_rules(HF_VERSION_CLSAG, 0) ? 3 : 2
+    rct_config.bp_version
   };
   ptx.construction_data.dests = dsts;
   // record which subaddress indices are being used as inputs
@@ -10223,6 +10787,33 @@ void wallet2::transfer_selected_rct(std::vector<cryptonote::tx_destination_entry
   LOG_PRINT_L2("transfer_selected_rct done");
 }
 
+//----------------------------------------------------------------------------------------------------
+void wallet2::construct_transactions(size_t count, const std::function<void(size_t)> &construct)
+{
+  hw::device &hwdev = m_account.get_device();
+  if (count < 2 || m_multisig || hwdev.get_type() != hw::device::device_type::SOFTWARE)
+  {
+    for (size_t i = 0; i < count; ++i)
+      construct(i);
+    return;
+  }
+
+  tools::threadpool& tpool = tools::threadpool::getInstance();
+  tools::threadpool::waiter waiter;
+  std::vector<std::exception_ptr> errors(count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    tpool.submit(&waiter, [&, i]() {
+      try { construct(i); }
+      catch (...) { errors[i] = std::current_exception(); }
+    });
+  }
+  waiter.wait(&tpool);
+  for (const auto &e : errors)
+    if (e)
+      std::rethrow_exception(e);
+}
+//----------------------------------------------------------------------------------------------------
 std::vector<size_t> wallet2::pick_preferred_rct_inputs(uint64_t needed_money, uint32_t subaddr_account, const std::set<uint32_t> &subaddr_indices) const
 {
   std::vector<size_t> picks;
@@ -10230,8 +10821,10 @@ std::vector<size_t> wallet2::pick_preferred_rct_inputs(uint64_t needed_money, ui
 
   LOG_PRINT_L2("pick_preferred_rct_inputs: needed_money " << print_money(needed_money));
 
+  const auto& unspent = unspent_transfers(subaddr_account);
+
   // try to find a rct input of enough size
-  for (size_t i = 0; i < m_transfers.size(); ++i)
+  for (size_t i : unspent)
   {
     const transfer_details& td = m_transfers[i];
     if (!is_spent(td, false) && !td.m_frozen && td.is_rct() && td.amount() >= needed_money && is_transfer_unlocked(td) && td.m_subaddr_index.major == subaddr_account && subaddr_indices.count(td.m_subaddr_index.minor) == 1)
@@ -10251,8 +10844,9 @@ std::vector<size_t> wallet2::pick_preferred_rct_inputs(uint64_t needed_money, ui
   // this could be made better by picking one of the outputs to be a small one, since those
   // are less useful since often below the needed money, so if one can be used in a pair,
   // it gets rid of it for the future
-  for (size_t i = 0; i < m_transfers.size(); ++i)
+  for (auto it = unspent.begin(); it != unspent.end(); ++it)
   {
+    const size_t i = *it;
     const transfer_details& td = m_transfers[i];
     if (!is_spent(td, false) && !td.m_frozen && !td.m_key_image_partial && td.is_rct() && is_transfer_unlocked(td) && td.m_subaddr_index.major == subaddr_account && subaddr_indices.count(td.m_subaddr_index.minor) == 1)
     {
@@ -10262,8 +10856,9 @@ std::vector<size_t> wallet2::pick_preferred_rct_inputs(uint64_t needed_money, ui
         continue;
       }
       LOG_PRINT_L2("Considering input " << i << ", " << print_money(td.amount()));
-      for (size_t j = i + 1; j < m_transfers.size(); ++j)
+      for (auto jt = std::next(it); jt != unspent.end(); ++jt)
       {
+        const size_t j = *jt;
         const transfer_details& td2 = m_transfers[j];
         if (td2.amount() > m_ignore_outputs_above || td2.amount() < m_ignore_outputs_below)
         {
@@ -10425,6 +11020,8 @@ void wallet2::light_wallet_get_unspent_outs()
 
   // Clear old outputs
   m_transfers.clear();
+  m_unspent_transfers.clear();
+  OXEN_DEFER { reindex_unspent_transfers(); };
 
   for (const auto &o: ores.outputs) {
     bool spent = false;
@@ -10588,7 +11185,7 @@ void wallet2::light_wallet_get_address_txs()
   // for balance calculation
   uint64_t wallet_total_sent = 0;
   // txs in pool
-  std::vector<crypto::hash> pool_txs;
+  std::unordered_set<crypto::hash> pool_txs;
 
   for (const auto &t: ires.transactions) {
     const uint64_t total_received = t.total_received;
@@ -10654,7 +11251,7 @@ void wallet2::light_wallet_get_address_txs()
 
       if (t.mempool) {
         if (std::find(unconfirmed_payments_txs.begin(), unconfirmed_payments_txs.end(), tx_hash) == unconfirmed_payments_txs.end()) {
-          pool_txs.push_back(tx_hash);
+          pool_txs.insert(tx_hash);
           // assume false as we don't get that info from the light wallet server
           crypto::hash payment_id;
           THROW_WALLET_EXCEPTION_IF(!tools::hex_to_type(t.payment_id, payment_id),
@@ -10986,7 +11583,7 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_2(std::vector<cryp
   // gather all dust and non-dust outputs belonging to specified subaddresses
   size_t num_nondust_outputs = 0;
   size_t num_dust_outputs = 0;
-  for (size_t i = 0; i < m_transfers.size(); ++i)
+  for (size_t i : unspent_transfers(subaddr_account))
   {
     const transfer_details& td = m_transfers[i];
     if (!is_spent(td, false) && !td.m_frozen && !td.m_key_image_partial && is_transfer_unlocked(td) && td.m_subaddr_index.major == subaddr_account && subaddr_indices.count(td.m_subaddr_index.minor) == 1)
@@ -11342,6 +11939,8 @@ skip_tx:
     " total fee, " << print_money(accumulated_change) << " total change");
 
   hwdev.set_mode(hw::device::TRANSACTION_CREATE_REAL);
+  std::vector<oxen_construct_tx_params> final_tx_params;
+  final_tx_params.reserve(txes.size());
   for (auto &tx : txes)
   {
     // Convert burn percent into a fixed burn amount because this is the last place we can back out
@@ -11349,7 +11948,10 @@ skip_tx:
     // fee percent)
     if (burning)
       tx_params.burn_fixed = burn_fixed + (tx.needed_fee - burn_fixed) * burn_percent / fee_percent;
-
+    final_tx_params.push_back(tx_params);
+  }
+  construct_transactions(txes.size(), [&](size_t i) {
+    TX &tx = txes[i];
     cryptonote::transaction test_tx;
     pending_tx test_ptx;
     transfer_selected_rct(  tx.dsts,                    /* NOMOD std::vector<cryptonote::tx_destination_entry> dsts,*/
@@ -11362,12 +11964,12 @@ skip_tx:
                             test_tx,                    /* OUT   cryptonote::transaction& tx, */
                             test_ptx,                   /* OUT   cryptonote::transaction& tx, */
                             rct_config,
-                            tx_params);
+                            final_tx_params[i]);
     auto txBlob = t_serializable_object_to_blob(test_ptx.tx);
     tx.tx = test_tx;
     tx.ptx = test_ptx;
     tx.weight = get_transaction_weight(test_tx, txBlob.size());
-  }
+  });
 
   std::vector<wallet2::pending_tx> ptx_vector;
   for (std::vector<TX>::iterator i = txes.begin(); i != txes.end(); ++i)
@@ -11467,7 +12069,7 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_all(uint64_t below
 
   // gather all dust and non-dust outputs of specified subaddress (if any) and below specified threshold (if any)
   bool fund_found = false;
-  for (size_t i = 0; i < m_transfers.size(); ++i)
+  for (size_t i : unspent_transfers(subaddr_account))
   {
     const transfer_details& td = m_transfers[i];
     if (!is_spent(td, false) && !td.m_frozen && !td.m_key_image_partial && is_transfer_unlocked(td) && td.m_subaddr_index.major == subaddr_account && (subaddr_indices.empty() || subaddr_indices.count(td.m_subaddr_index.minor) == 1))
@@ -11517,8 +12119,9 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_single(const crypt
   std::vector<size_t> unused_transfers_indices;
   std::vector<size_t> unused_dust_indices;
   // find output with the given key image
-  for (size_t i = 0; i < m_transfers.size(); ++i)
+  if (auto it = m_key_images.find(ki); it != m_key_images.end() && it->second < m_transfers.size())
   {
+    const size_t i = it->second;
     const transfer_details& td = m_transfers[i];
     if (td.m_key_image_known && td.m_key_image == ki && !is_spent(td, false) && !td.m_frozen && is_transfer_unlocked(td))
     {
@@ -11526,7 +12129,6 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_single(const crypt
         unused_transfers_indices.push_back(i);
       else
         unused_dust_indices.push_back(i);
-      break;
     }
   }
   return create_transactions_from(address, is_subaddress, outputs, unused_transfers_indices, unused_dust_indices, fake_outs_count, unlock_time, priority, extra, tx_type);
@@ -11713,6 +12315,8 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_from(const crypton
     " total fee, " << print_money(accumulated_change) << " total change");
 
   hwdev.set_mode(hw::device::TRANSACTION_CREATE_REAL);
+  std::vector<oxen_construct_tx_params> final_tx_params;
+  final_tx_params.reserve(txes.size());
   for (auto &tx : txes)
   {
     // Convert burn percent into a fixed burn amount because this is the last place we can back out
@@ -11720,15 +12324,18 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_from(const crypton
     // fee percent)
     if (burning)
       oxen_tx_params.burn_fixed = burn_fixed + tx.needed_fee * burn_percent / fee_percent;
-
+    final_tx_params.push_back(oxen_tx_params);
+  }
+  construct_transactions(txes.size(), [&](size_t i) {
+    TX &tx = txes[i];
     cryptonote::transaction test_tx;
     pending_tx test_ptx;
-    transfer_selected_rct(tx.dsts, tx.selected_transfers, fake_outs_count, tx.outs, unlock_time, tx.needed_fee, extra, test_tx, test_ptx, rct_config, oxen_tx_params);
+    transfer_selected_rct(tx.dsts, tx.selected_transfers, fake_outs_count, tx.outs, unlock_time, tx.needed_fee, extra, test_tx, test_ptx, rct_config, final_tx_params[i]);
     auto txBlob = t_serializable_object_to_blob(test_ptx.tx);
     tx.tx = test_tx;
     tx.ptx = test_ptx;
     tx.weight = get_transaction_weight(test_tx, txBlob.size());
-  }
+  });
 
   std::vector<wallet2::pending_tx> ptx_vector;
   for (std::vector<TX>::iterator i = txes.begin(); i != txes.end(); ++i)
@@ -13336,9 +13943,8 @@ std::pair<size_t, std::vector<std::pair<crypto::key_image, crypto::signature>>>
       ++offset;
   }
 
-  ski.reserve(m_transfers.size() - offset);
-  for (size_t n = offset; n < m_transfers.size(); ++n)
-  {
+  ski.resize(m_transfers.size() - offset);
+  auto export_one = [&](size_t n) {
     const transfer_details &td = m_transfers[n];
 
     // get ephemeral public key
@@ -13371,10 +13977,39 @@ std::pair<size_t, std::vector<std::pair<crypto::key_image, crypto::signature>>>
         error::wallet_internal_error, "key_image generated ephemeral public key not matched with output_key");
 
     // sign the key image with the output secret key
-    auto& ki_s = ski.emplace_back();
+    auto& ki_s = ski[n - offset];
     ki_s.first = td.m_key_image;
     crypto::generate_key_image_signature(ki_s.first, pkey, in_ephemeral.sec, ki_s.second);
+  };
+
+  // The software device is stateless here, so large exports are split across the threadpool;
+  // hardware devices have to be driven one output at a time.
+  if (ski.size() < 2 * KEY_IMAGE_BATCH_SIZE || m_account.get_device().get_type() != hw::device::device_type::SOFTWARE)
+  {
+    for (size_t n = offset; n < m_transfers.size(); ++n)
+      export_one(n);
+    return std::make_pair(offset, ski);
   }
+
+  tools::threadpool& tpool = tools::threadpool::getInstance();
+  tools::threadpool::waiter waiter;
+  std::vector<std::exception_ptr> errors((ski.size() + KEY_IMAGE_BATCH_SIZE - 1) / KEY_IMAGE_BATCH_SIZE);
+  for (size_t b = 0; b < errors.size(); ++b)
+  {
+    tpool.submit(&waiter, [&, b]() {
+      try
+      {
+        const size_t end = std::min(m_transfers.size(), offset + (b + 1) * KEY_IMAGE_BATCH_SIZE);
+        for (size_t n = offset + b * KEY_IMAGE_BATCH_SIZE; n < end; ++n)
+          export_one(n);
+      }
+      catch (...) { errors[b] = std::current_exception(); }
+    }, true);
+  }
+  waiter.wait(&tpool);
+  for (const auto &e : errors)
+    if (e)
+      std::rethrow_exception(e);
   return std::make_pair(offset, ski);
 }
 
@@ -13461,40 +14096,100 @@ uint64_t wallet2::import_key_images(const std::vector<std::pair<crypto::key_imag
   req.key_images.reserve(signed_key_images.size());
 
   PERF_TIMER_START(import_key_images_A_validate_and_extract_key_images);
+  std::vector<const crypto::public_key*> pkeys(signed_key_images.size(), nullptr);
   for (size_t n = 0; n < signed_key_images.size(); ++n)
   {
     const transfer_details &td = m_transfers[n + offset];
     const crypto::key_image &key_image = signed_key_images[n].first;
-    const crypto::signature &signature = signed_key_images[n].second;
 
     // get ephemeral public key
     const cryptonote::tx_out &out = td.m_tx.vout[td.m_internal_output_index];
     THROW_WALLET_EXCEPTION_IF(!std::holds_alternative<txout_to_key>(out.target), error::wallet_internal_error,
       "Non txout_to_key output found");
-    const auto& pkey = var::get<cryptonote::txout_to_key>(out.target).key;
 
-    std::string const key_image_str = tools::type_to_hex(key_image);
+    // Only key images we don't already have need their signature checked
     if (!td.m_key_image_known || !(key_image == td.m_key_image))
-    {
-      THROW_WALLET_EXCEPTION_IF(!(rct::scalarmultKey(rct::ki2rct(key_image), rct::curveOrder()) == rct::identity()),
-          error::wallet_internal_error, "Key image out of validity domain: input " + std::to_string(n + offset) + "/"
-          + std::to_string(signed_key_images.size()) + ", key image " + key_image_str);
+      pkeys[n] = &var::get<cryptonote::txout_to_key>(out.target).key;
+    req.key_images.push_back(tools::type_to_hex(key_image));
+  }
 
-      // TODO(oxen): This can fail in a worse-case scenario. We re-sort blinks
-      // when they arrive out of order (i.e. blink is confirmed in mempool and
-      // gets inserted into m_transfers in a different order from the order they
-      // are committed to the blockchain).
+  // The spent status doesn't depend on the signatures, so ask the daemon for it (in chunks, so a
+  // large import doesn't become one huge request) while we check them.
+  std::future<void> spent_check;
+  if (check_spent)
+  {
+    spent_check = std::async(std::launch::async, [this, &req, &daemon_resp]() {
+      PERF_TIMER(import_key_images_RPC);
+      daemon_resp.status = rpc::STATUS_OK;
+      daemon_resp.spent_status.reserve(req.key_images.size());
+      for (size_t start = 0; start < req.key_images.size(); start += KEY_IMAGE_SPENT_CHUNK_SIZE)
+      {
+        rpc::IS_KEY_IMAGE_SPENT::request chunk_req{};
+        rpc::IS_KEY_IMAGE_SPENT::response chunk_resp{};
+        const size_t end = std::min(req.key_images.size(), start + KEY_IMAGE_SPENT_CHUNK_SIZE);
+        chunk_req.key_images.assign(req.key_images.begin() + start, req.key_images.begin() + end);
+        bool r = invoke_http<rpc::IS_KEY_IMAGE_SPENT>(chunk_req, chunk_resp);
+        THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "is_key_image_spent");
+        THROW_WALLET_EXCEPTION_IF(chunk_resp.status == rpc::STATUS_BUSY, error::daemon_busy, "is_key_image_spent");
+        THROW_WALLET_EXCEPTION_IF(chunk_resp.status != rpc::STATUS_OK, error::is_key_image_spent_error, chunk_resp.status);
+        THROW_WALLET_EXCEPTION_IF(chunk_resp.spent_status.size() != chunk_req.key_images.size(), error::wallet_internal_error,
+          "daemon returned wrong response for is_key_image_spent, wrong amounts count = " +
+          std::to_string(chunk_resp.spent_status.size()) + ", expected " +  std::to_string(chunk_req.key_images.size()));
+        daemon_resp.spent_status.insert(daemon_resp.spent_status.end(), chunk_resp.spent_status.begin(), chunk_resp.spent_status.end());
+      }
+    });
+  }
 
-      // If a watch only wallet sees a blink and the main wallet doesn't, then
-      // for that block, export_key_images will fail temporarily until the
-      // block is commited and the wallets sorts its transfers into a finalized
-      // canonical ordering.
-      THROW_WALLET_EXCEPTION_IF(!crypto::check_key_image_signature(key_image, pkey, signature),
-          error::signature_check_failed, std::to_string(n + offset) + "/"
-          + std::to_string(signed_key_images.size()) + ", key image " + key_image_str
-          + ", signature " + tools::type_to_hex(signature) + ", pubkey " + tools::type_to_hex(pkey));
+  // 1 = out of the validity domain, 2 = bad signature
+  std::vector<uint8_t> failed(signed_key_images.size(), 0);
+  auto verify = [&](size_t begin, size_t end) {
+    std::vector<crypto::key_image> key_images;
+    key_images.reserve(end - begin);
+    for (size_t n = begin; n < end; ++n)
+      key_images.push_back(signed_key_images[n].first);
+    std::unique_ptr<bool[]> in_domain{new bool[key_images.size()]};
+    crypto::check_key_images_domain(key_images.data(), key_images.size(), in_domain.get());
+    for (size_t n = begin; n < end; ++n)
+    {
+      if (!pkeys[n])
+        continue;
+      const crypto::key_image &key_image = signed_key_images[n].first;
+      if (!in_domain[n - begin])
+        failed[n] = 1;
+      else if (!crypto::check_key_image_signature(key_image, *pkeys[n], signed_key_images[n].second))
+        failed[n] = 2;
     }
-    req.key_images.push_back(key_image_str);
+  };
+  if (signed_key_images.size() < 2 * KEY_IMAGE_BATCH_SIZE)
+    verify(0, signed_key_images.size());
+  else
+  {
+    tools::threadpool& tpool = tools::threadpool::getInstance();
+    tools::threadpool::waiter waiter;
+    for (size_t start = 0; start < signed_key_images.size(); start += KEY_IMAGE_BATCH_SIZE)
+      tpool.submit(&waiter, [&, start]() { verify(start, std::min(signed_key_images.size(), start + KEY_IMAGE_BATCH_SIZE)); }, true);
+    waiter.wait(&tpool);
+  }
+
+  for (size_t n = 0; n < signed_key_images.size(); ++n)
+  {
+    THROW_WALLET_EXCEPTION_IF(failed[n] == 1,
+        error::wallet_internal_error, "Key image out of validity domain: input " + std::to_string(n + offset) + "/"
+        + std::to_string(signed_key_images.size()) + ", key image " + req.key_images[n]);
+
+    // TODO(oxen): This can fail in a worse-case scenario. We re-sort blinks
+    // when they arrive out of order (i.e. blink is confirmed in mempool and
+    // gets inserted into m_transfers in a different order from the order they
+    // are committed to the blockchain).
+
+    // If a watch only wallet sees a blink and the main wallet doesn't, then
+    // for that block, export_key_images will fail temporarily until the
+    // block is commited and the wallets sorts its transfers into a finalized
+    // canonical ordering.
+    THROW_WALLET_EXCEPTION_IF(failed[n] == 2,
+        error::signature_check_failed, std::to_string(n + offset) + "/"
+        + std::to_string(signed_key_images.size()) + ", key image " + req.key_images[n]
+        + ", signature " + tools::type_to_hex(signed_key_images[n].second) + ", pubkey " + tools::type_to_hex(*pkeys[n]));
   }
   PERF_TIMER_STOP(import_key_images_A_validate_and_extract_key_images);
 
@@ -13511,18 +14206,12 @@ uint64_t wallet2::import_key_images(const std::vector<std::pair<crypto::key_imag
 
   if(check_spent)
   {
-    PERF_TIMER(import_key_images_RPC);
-    bool r = invoke_http<rpc::IS_KEY_IMAGE_SPENT>(req, daemon_resp);
-    THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "is_key_image_spent");
-    THROW_WALLET_EXCEPTION_IF(daemon_resp.status == rpc::STATUS_BUSY, error::daemon_busy, "is_key_image_spent");
-    THROW_WALLET_EXCEPTION_IF(daemon_resp.status != rpc::STATUS_OK, error::is_key_image_spent_error, daemon_resp.status);
-    THROW_WALLET_EXCEPTION_IF(daemon_resp.spent_status.size() != signed_key_images.size(), error::wallet_internal_error,
-      "daemon returned wrong response for is_key_image_spent, wrong amounts count = " +
-      std::to_string(daemon_resp.spent_status.size()) + ", expected " +  std::to_string(signed_key_images.size()));
+    spent_check.get();
     for (size_t n = 0; n < daemon_resp.spent_status.size(); ++n)
     {
       transfer_details &td = m_transfers[n + offset];
       td.m_spent = daemon_resp.spent_status[n] != rpc::IS_KEY_IMAGE_SPENT::UNSPENT;
+      update_unspent_transfers_index(n + offset);
     }
   }
   std::unordered_set<crypto::hash> spent_txids;   // For each spent key image, search for a tx in m_transfers that uses it as input.
@@ -13856,6 +14545,7 @@ size_t wallet2::import_outputs(const std::pair<size_t, std::vector<tools::wallet
 
   const size_t offset = outputs.first;
   const size_t original_size = m_transfers.size();
+  OXEN_DEFER { reindex_unspent_transfers(offset); };
   m_transfers.resize(offset + outputs.second.size());
   for (size_t i = 0; i < offset; ++i)
     m_transfers[i].m_key_image_request = false;
@@ -14145,7 +14835,7 @@ cryptonote::blobdata wallet2::export_multisig()
   return ciphertext;
 }
 //----------------------------------------------------------------------------------------------------
-void wallet2::update_multisig_rescan_info(const std::vector<std::vector<rct::key>> &multisig_k, const std::vector<std::vector<wallet::multisig_info>> &info, size_t n)
+void wallet2::update_multisig_rescan_info(const std::vector<std::vector<rct::key>> &multisig_k, const std::vector<std::vector<wallet::multisig_info>> &info, size_t n, const crypto::key_image *key_image)
 {
   CHECK_AND_ASSERT_THROW_MES(n < m_transfers.size(), "Bad index in update_multisig_info");
   CHECK_AND_ASSERT_THROW_MES(multisig_k.size() >= m_transfers.size(), "Mismatched sizes of multisig_k and info");
@@ -14159,7 +14849,7 @@ void wallet2::update_multisig_rescan_info(const std::vector<std::vector<rct::key
     td.m_multisig_info.push_back(pi[n]);
   }
   m_key_images.erase(td.m_key_image);
-  td.m_key_image = get_multisig_composite_key_image(n);
+  td.m_key_image = key_image ? *key_image : get_multisig_composite_key_image(n);
   td.m_key_image_known = true;
   td.m_key_image_request = false;
   td.m_key_image_partial = false;
@@ -14262,9 +14952,49 @@ size_t wallet2::import_multisig(std::vector<cryptonote::blobdata> blobs)
     break;
   }
 
-  for (size_t n = 0; n < n_outputs && n < m_transfers.size(); ++n)
+  // The composite key images are the expensive part of the update, and each depends only on its
+  // own output's multisig info, so set that first and compute them up front (in parallel, for
+  // the software device).
+  n_outputs = std::min(n_outputs, m_transfers.size());
+  for (size_t n = 0; n < n_outputs; ++n)
+  {
+    auto &td_info = m_transfers[n].m_multisig_info;
+    td_info.clear();
+    for (const auto &pi: info)
+      td_info.push_back(pi[n]);
+  }
+  std::vector<crypto::key_image> key_images(n_outputs);
+  if (n_outputs < 2 * KEY_IMAGE_BATCH_SIZE || m_account.get_device().get_type() != hw::device::device_type::SOFTWARE)
+  {
+    for (size_t n = 0; n < n_outputs; ++n)
+      key_images[n] = get_multisig_composite_key_image(n);
+  }
+  else
+  {
+    tools::threadpool& tpool = tools::threadpool::getInstance();
+    tools::threadpool::waiter waiter;
+    std::vector<std::exception_ptr> errors((n_outputs + KEY_IMAGE_BATCH_SIZE - 1) / KEY_IMAGE_BATCH_SIZE);
+    for (size_t b = 0; b < errors.size(); ++b)
+    {
+      tpool.submit(&waiter, [&, b]() {
+        try
+        {
+          const size_t end = std::min(n_outputs, (b + 1) * KEY_IMAGE_BATCH_SIZE);
+          for (size_t n = b * KEY_IMAGE_BATCH_SIZE; n < end; ++n)
+            key_images[n] = get_multisig_composite_key_image(n);
+        }
+        catch (...) { errors[b] = std::current_exception(); }
+      }, true);
+    }
+    waiter.wait(&tpool);
+    for (const auto &e : errors)
+      if (e)
+        std::rethrow_exception(e);
+  }
+
+  for (size_t n = 0; n < n_outputs; ++n)
   {
-    update_multisig_rescan_info(k, info, n);
+    update_multisig_rescan_info(k, info, n, &key_images[n]);
   }
 
   m_multisig_rescan_k = &k;
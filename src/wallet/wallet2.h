@@ -40,6 +40,7 @@
 #include <boost/serialization/deque.hpp>
 #include <atomic>
 #include <random>
+#include <tuple>
 
 #include "cryptonote_basic/account.h"
 #include "cryptonote_basic/account_boost_serialization.h"
@@ -68,6 +69,7 @@
 #include "transfer_destination.h"
 #include "transfer_details.h"
 #include "transfer_view.h"
+#include "hashchain.h"
 #include "multisig_info.h"
 #include "pending_tx.h"
 #include "multisig_sig.h"
@@ -146,6 +148,8 @@ private:
     virtual void on_unconfirmed_money_received(uint64_t height, const crypto::hash &txid, const cryptonote::transaction& tx, uint64_t amount, const cryptonote::subaddress_index& subaddr_index) {}
     virtual void on_money_spent(uint64_t height, const crypto::hash &txid, const cryptonote::transaction& in_tx, uint64_t amount, const cryptonote::transaction& spend_tx, const cryptonote::subaddress_index& subaddr_index) {}
     virtual void on_skip_transaction(uint64_t height, const crypto::hash &txid, const cryptonote::transaction& tx) {}
+    // Blocks from `height` on were detached; anything recorded at those heights is gone
+    virtual void on_reorg(uint64_t height) {}
     virtual std::optional<epee::wipeable_string> on_get_password(const char *reason) { return std::nullopt; }
     // Light wallet callbacks
     virtual void on_lw_new_block(uint64_t height) {}
@@ -184,38 +188,6 @@ private:
     uint64_t unlock_time;
   };
 
-  class hashchain
-  {
-  public:
-    hashchain(): m_genesis(crypto::null_hash), m_offset(0) {}
-
-    size_t size() const { return m_blockchain.size() + m_offset; }
-    size_t offset() const { return m_offset; }
-    const crypto::hash &genesis() const { return m_genesis; }
-    void push_back(const crypto::hash &hash) { if (m_offset == 0 && m_blockchain.empty()) m_genesis = hash; m_blockchain.push_back(hash); }
-    bool is_in_bounds(size_t idx) const { return idx >= m_offset && idx < size(); }
-    const crypto::hash &operator[](size_t idx) const { return m_blockchain[idx - m_offset]; }
-    crypto::hash &operator[](size_t idx) { return m_blockchain[idx - m_offset]; }
-    void crop(size_t height) { m_blockchain.resize(height - m_offset); }
-    void clear() { m_offset = 0; m_blockchain.clear(); }
-    bool empty() const { return m_blockchain.empty() && m_offset == 0; }
-    void trim(size_t height) { while (height > m_offset && m_blockchain.size() > 1) { m_blockchain.pop_front(); ++m_offset; } m_blockchain.shrink_to_fit(); }
-    void refill(const crypto::hash &hash) { m_blockchain.push_back(hash); --m_offset; }
-
-    template <class t_archive>
-    void serialize(t_archive &a, const unsigned int ver)
-    {
-      a & m_offset;
-      a & m_genesis;
-      a & m_blockchain;
-    }
-
-  private:
-    size_t m_offset;
-    crypto::hash m_genesis;
-    std::deque<crypto::hash> m_blockchain;
-  };
-
   //enum class stake_check_result { allowed, not_allowed, try_later };
 
   enum tx_priority
@@ -611,10 +583,13 @@ private:
     std::optional<wallet2::keys_file_data> get_keys_file_data(const epee::wipeable_string& password, bool watch_only);
     /*!
      * \brief get_cache_file_data   Get wallet cache data which can be stored to a wallet file.
+     *                              Once the hashchain is attached to its file the block hashes are
+     *                              kept there rather than in this data.
      * \param password              Password to protect the wallet cache data (TODO: probably better save the password in the wallet object?)
+     * \param cache_hash            If not null, set to a hash of the unencrypted cache contents and cache key
      * \return                      Encrypted wallet cache data which can be stored to a wallet file
      */
-    std::optional<wallet2::cache_file_data> get_cache_file_data(const epee::wipeable_string& password);
+    std::optional<wallet2::cache_file_data> get_cache_file_data(const epee::wipeable_string& password, crypto::hash *cache_hash = nullptr);
 
     const fs::path& path() const;
 
@@ -654,6 +629,10 @@ private:
     i_wallet2_callback* callback() const { return m_callback; }
     void callback(i_wallet2_callback* callback) { m_callback = callback; }
 
+    /// Sets a function that refresh() calls, on the refreshing thread, each time it has applied a
+    /// batch of blocks (so the wallet is in a consistent state between batches).
+    void refresh_batch_hook(std::function<void()> hook) { m_refresh_batch_hook = std::move(hook); }
+
     bool is_trusted_daemon() const { return m_trusted_daemon; }
     void set_trusted_daemon(bool trusted) { m_trusted_daemon = trusted; }
 
@@ -782,6 +761,28 @@ private:
     wallet::transfer_view make_transfer_view(const crypto::hash &payment_id, const tools::wallet2::pool_payment_details &pd) const;
     void get_transfers(wallet2::transfer_container& incoming_transfers) const;
 
+    /// Position of an entry in the get_transfers() ordering, used to resume a paged listing after
+    /// the last entry of the previous page.
+    struct transfer_cursor
+    {
+      bool confirmed = true;
+      bool blink_mempool = false;
+      uint64_t height = 0;
+      uint64_t timestamp = 0;
+      crypto::hash hash = crypto::null_hash;
+      uint8_t source = 0; // which list the entry came from, to order entries for the same tx
+      cryptonote::subaddress_index subaddr_index = {0, 0};
+
+      bool operator<(const transfer_cursor &o) const
+      {
+        return std::make_tuple(!confirmed, blink_mempool, height, timestamp, hash, source, subaddr_index.major, subaddr_index.minor)
+            < std::make_tuple(!o.confirmed, o.blink_mempool, o.height, o.timestamp, o.hash, o.source, o.subaddr_index.major, o.subaddr_index.minor);
+      }
+
+      std::string to_string() const;
+      static std::optional<transfer_cursor> parse(std::string_view str);
+    };
+
     struct get_transfers_args_t
     {
       bool in = false;
@@ -798,8 +799,12 @@ private:
       std::set<uint32_t> subaddr_indices;
       uint32_t account_index;
       bool all_accounts;
+      size_t limit = 0; // if non-zero, return at most this many transfers
+      std::optional<transfer_cursor> after; // only return transfers after this position
     };
-    void get_transfers(get_transfers_args_t args, std::vector<wallet::transfer_view>& transfers);
+    /// Gets the wallet's transfers matching `args`, ordered by height (unconfirmed last).  If
+    /// `args.limit` cut the listing short, `next` (if given) is set to the position to continue from.
+    void get_transfers(get_transfers_args_t args, std::vector<wallet::transfer_view>& transfers, std::optional<transfer_cursor>* next = nullptr);
     std::string transfers_to_csv(const std::vector<wallet::transfer_view>& transfers, bool formatting = false) const;
     void get_payments(const crypto::hash& payment_id, std::list<wallet2::payment_details>& payments, uint64_t min_height = 0, const std::optional<uint32_t>& subaddr_account = std::nullopt, const std::set<uint32_t>& subaddr_indices = {}) const;
     void get_payments(std::list<std::pair<crypto::hash,wallet2::payment_details>>& payments, uint64_t min_height, uint64_t max_height = (uint64_t)-1, const std::optional<uint32_t>& subaddr_account = std::nullopt, const std::set<uint32_t>& subaddr_indices = {}) const;
@@ -1013,6 +1018,8 @@ private:
     void ignore_outputs_below(uint64_t value) { m_ignore_outputs_below = value; }
     bool track_uses() const { return m_track_uses; }
     void track_uses(bool value) { m_track_uses = value; }
+    uint32_t refresh_pipeline_depth() const { return m_refresh_pipeline_depth; }
+    void refresh_pipeline_depth(uint32_t depth) { m_refresh_pipeline_depth = depth; }
     std::chrono::seconds inactivity_lock_timeout() const { return m_inactivity_lock_timeout; }
     void inactivity_lock_timeout(std::chrono::seconds seconds) { m_inactivity_lock_timeout = seconds; }
     const std::string & device_name() const { return m_device_name; }
@@ -1203,7 +1210,7 @@ private:
     std::vector<get_pool_state_tx> get_pool_state(bool refreshed = false);
     void process_pool_state(const std::vector<get_pool_state_tx> &txs);
 
-    void remove_obsolete_pool_txs(const std::vector<crypto::hash> &tx_hashes);
+    void remove_obsolete_pool_txs(const std::unordered_set<crypto::hash> &tx_hashes);
 
     std::string encrypt(std::string_view plaintext, const crypto::secret_key &skey, bool authenticated = true) const;
     std::string encrypt(const epee::span<char> &span, const crypto::secret_key &skey, bool authenticated = true) const;
@@ -1493,8 +1500,20 @@ private:
     void pull_blocks(uint64_t start_height, uint64_t& blocks_start_height, const std::list<crypto::hash> &short_chain_history, std::vector<cryptonote::block_complete_entry> &blocks, std::vector<cryptonote::rpc::GET_BLOCKS_FAST::block_output_indices> &o_indices, uint64_t &current_height);
     void pull_hashes(uint64_t start_height, uint64_t& blocks_start_height, const std::list<crypto::hash> &short_chain_history, std::vector<crypto::hash> &hashes);
     void fast_refresh(uint64_t stop_height, uint64_t &blocks_start_height, std::list<crypto::hash> &short_chain_history, bool force = false);
-    void pull_and_parse_next_blocks(uint64_t start_height, uint64_t &blocks_start_height, std::list<crypto::hash> &short_chain_history, const std::vector<cryptonote::block_complete_entry> &prev_blocks, const std::vector<parsed_block> &prev_parsed_blocks, std::vector<cryptonote::block_complete_entry> &blocks, std::vector<parsed_block> &parsed_blocks, bool &last, bool &error, std::exception_ptr &exception);
+    // A batch of blocks fetched and parsed ahead of being applied to the wallet during refresh
+    struct refresh_batch
+    {
+      uint64_t start_height = 0;
+      std::vector<cryptonote::block_complete_entry> blocks;
+      std::vector<parsed_block> parsed_blocks;
+      std::vector<tx_cache_data> tx_cache;
+      bool derived = false; // whether tx_cache already has its key derivations
+    };
+    void pull_and_parse_next_blocks(uint64_t start_height, uint64_t &blocks_start_height, std::list<crypto::hash> &short_chain_history, const std::vector<crypto::hash> &prev_hashes, std::vector<cryptonote::block_complete_entry> &blocks, std::vector<parsed_block> &parsed_blocks, bool &last, bool &error, std::exception_ptr &exception);
+    void cache_parsed_blocks_tx_data(uint64_t start_height, const std::vector<parsed_block> &parsed_blocks, std::vector<tx_cache_data> &tx_cache_data) const;
+    void generate_tx_cache_derivations(std::vector<tx_cache_data> &tx_cache_data, hw::device &hwdev) const;
     void process_parsed_blocks(uint64_t start_height, const std::vector<cryptonote::block_complete_entry> &blocks, const std::vector<parsed_block> &parsed_blocks, uint64_t& blocks_added, std::map<std::pair<uint64_t, uint64_t>, size_t> *output_tracker_cache = NULL);
+    void process_parsed_blocks(uint64_t start_height, const std::vector<cryptonote::block_complete_entry> &blocks, const std::vector<parsed_block> &parsed_blocks, std::vector<tx_cache_data> &tx_cache_data, bool derived, uint64_t& blocks_added, std::map<std::pair<uint64_t, uint64_t>, size_t> *output_tracker_cache = NULL);
     uint64_t select_transfers(uint64_t needed_money, std::vector<size_t> unused_transfers_indices, std::vector<size_t>& selected_transfers) const;
     bool prepare_file_names(const fs::path& file_path);
     void process_unconfirmed(const crypto::hash &txid, const cryptonote::transaction& tx, uint64_t height);
@@ -1514,8 +1533,15 @@ private:
     cryptonote::byte_and_output_fees get_dynamic_base_fee_estimate() const;
     float get_output_relatedness(const transfer_details &td0, const transfer_details &td1) const;
     std::vector<size_t> pick_preferred_rct_inputs(uint64_t needed_money, uint32_t subaddr_account, const std::set<uint32_t> &subaddr_indices) const;
+    /// Calls `construct(i)` for each i in [0, count), in parallel on the threadpool when the
+    /// transactions can be built independently (software device, not multisig).  Rethrows the
+    /// first exception thrown by any of them.
+    void construct_transactions(size_t count, const std::function<void(size_t)> &construct);
     void set_spent(size_t idx, uint64_t height);
     void set_unspent(size_t idx);
+    void update_unspent_transfers_index(size_t idx);
+    void reindex_unspent_transfers(size_t from = 0);
+    const std::set<size_t>& unspent_transfers(uint32_t index_major) const;
     bool is_spent(const transfer_details &td, bool strict = true) const;
     bool is_spent(size_t idx, bool strict = true) const;
     void get_outs(std::vector<std::vector<get_outs_entry>> &outs, const std::vector<size_t> &selected_transfers, size_t fake_outputs_count, bool has_rct);
@@ -1529,11 +1555,17 @@ private:
     rct::multisig_kLRki get_multisig_composite_kLRki(size_t n,  const std::unordered_set<crypto::public_key> &ignore_set, std::unordered_set<rct::key> &used_L, std::unordered_set<rct::key> &new_used_L) const;
     rct::multisig_kLRki get_multisig_kLRki(size_t n, const rct::key &k) const;
     rct::key get_multisig_k(size_t idx, const std::unordered_set<rct::key> &used_L) const;
-    void update_multisig_rescan_info(const std::vector<std::vector<rct::key>> &multisig_k, const std::vector<std::vector<wallet::multisig_info>> &info, size_t n);
+    // `key_image`, if given, is the output's composite key image already computed from `info`
+    void update_multisig_rescan_info(const std::vector<std::vector<rct::key>> &multisig_k, const std::vector<std::vector<wallet::multisig_info>> &info, size_t n, const crypto::key_image *key_image = nullptr);
     bool add_rings(const crypto::chacha_key &key, const cryptonote::transaction_prefix &tx);
     bool add_rings(const cryptonote::transaction_prefix &tx);
     bool remove_rings(const cryptonote::transaction_prefix &tx);
     bool get_ring(const crypto::chacha_key &key, const crypto::key_image &key_image, std::vector<uint64_t> &outs);
+    bool get_rings(const crypto::chacha_key &key, const std::vector<crypto::key_image> &key_images, std::unordered_map<crypto::key_image, std::vector<uint64_t>> &rings);
+    // Starts staging ring changes in memory, unless that's already happening; returns true if it
+    // started a batch, which the caller then ends with commit_ringdb_batch().
+    bool begin_ringdb_batch();
+    void commit_ringdb_batch();
     crypto::chacha_key get_ringdb_key();
     void setup_keys(const epee::wipeable_string &password);
     size_t get_transfer_details(const crypto::key_image &ki) const;
@@ -1542,7 +1574,8 @@ private:
     hw::device& lookup_device(const std::string & device_descriptor);
 
     bool get_rct_distribution(uint64_t &start_height, std::vector<uint64_t> &distribution);
-    bool get_output_blacklist(std::vector<uint64_t> &blacklist);
+    bool update_output_blacklist();
+    bool is_output_blacklisted(uint64_t global_index) const { return global_index < m_output_blacklist.size() && m_output_blacklist[global_index]; }
 
     uint64_t get_segregation_fork_height() const;
     void unpack_multisig_info(const std::vector<std::string>& info,
@@ -1570,10 +1603,17 @@ private:
 
     bool should_expand(const cryptonote::subaddress_index &index) const;
 
+    struct subaddress_range { uint32_t major; uint32_t begin; uint32_t end; };
+    /// Derives the subaddress spend public keys for each [begin, end) range of minor indices and
+    /// adds them to m_subaddresses.
+    void add_subaddresses(const std::vector<subaddress_range> &ranges);
+
     cryptonote::account_base m_account;
     fs::path m_wallet_file;
     fs::path m_keys_file;
     fs::path m_mms_file;
+    // Contents hash (see get_cache_file_data) of the cache last written to m_wallet_file
+    crypto::hash m_stored_cache_hash = crypto::null_hash;
     hashchain m_blockchain;
     std::unordered_map<crypto::hash, unconfirmed_transfer_details> m_unconfirmed_txs;
     std::unordered_map<crypto::hash, confirmed_transfer_details> m_confirmed_txs;
@@ -1590,6 +1630,8 @@ private:
     payment_container m_payments;
     std::unordered_map<crypto::key_image, size_t> m_key_images;
     std::unordered_map<crypto::public_key, size_t> m_pub_keys;
+    // Indices of the m_transfers that aren't strictly spent, by subaddress account (not serialized)
+    std::unordered_map<uint32_t, std::set<size_t>> m_unspent_transfers;
     cryptonote::account_public_address m_account_public_address;
     std::unordered_map<crypto::public_key, cryptonote::subaddress_index> m_subaddresses;
     std::vector<std::vector<std::string>> m_subaddress_labels;
@@ -1606,6 +1648,7 @@ private:
 
     bool m_trusted_daemon;
     i_wallet2_callback* m_callback;
+    std::function<void()> m_refresh_batch_hook;
     hw::device::device_type m_key_device_type;
     cryptonote::network_type m_nettype;
     uint64_t m_kdf_rounds;
@@ -1640,9 +1683,18 @@ private:
     bool m_segregate_pre_fork_outputs;
     bool m_key_reuse_mitigation2;
     uint64_t m_segregation_height;
+    // Cumulative rct output distribution last received from the daemon (not serialized)
+    uint64_t m_rct_distribution_start_height = 0;
+    std::vector<uint64_t> m_rct_distribution;
+    // The daemon's rct output blacklist as a bitmap of global output indices, topped up with just the
+    // outputs blacklisted since the last one we have (not serialized)
+    std::vector<bool> m_output_blacklist;
+    std::optional<uint64_t> m_output_blacklist_last;
+    uint64_t m_output_blacklist_count = 0;
     uint64_t m_ignore_outputs_above;
     uint64_t m_ignore_outputs_below;
     bool m_track_uses;
+    uint32_t m_refresh_pipeline_depth; // max. number of fetched block batches waiting to be applied during refresh
     std::chrono::seconds m_inactivity_lock_timeout;
     bool m_is_initialized;
     NodeRPCProxy m_node_rpc_proxy;
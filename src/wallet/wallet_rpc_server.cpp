@@ -47,6 +47,7 @@
 #include "cryptonote_basic/account.h"
 #include "multisig/multisig.h"
 #include "epee/misc_language.h"
+#include "common/oxen.h"
 #include "epee/string_coding.h"
 #include "epee/string_tools.h"
 #include "crypto/hash.h"
@@ -66,6 +67,12 @@ using namespace tools::wallet_rpc;
 namespace
 {
   constexpr auto DEFAULT_AUTO_REFRESH_PERIOD = 20s;
+  // A wallet that hasn't served a request for this long is idle: it auto-refreshes less often and
+  // picks up new blocks after a random delay, so that many idle wallets sharing a daemon spread
+  // their refreshes out instead of all hitting it right after each block.
+  constexpr auto ACTIVE_WALLET_WINDOW = 5min;
+  constexpr int IDLE_REFRESH_BACKOFF = 3;
+  constexpr auto IDLE_REFRESH_MAX_DELAY = 15s;
 
   const command_line::arg_descriptor<uint16_t, true> arg_rpc_bind_port = {"rpc-bind-port", "Sets bind port for server"};
   const command_line::arg_descriptor<bool> arg_disable_rpc_login = {"disable-rpc-login", "Disable HTTP authentication for RPC connections served by this process"};
@@ -85,8 +92,9 @@ namespace
     return pwd_container;
   }
 
-  using rpc_func_data = std::pair<
+  using rpc_func_data = std::tuple<
     bool, // restricted
+    bool, // snapshot read
     std::string(*)( // function to invoke
       epee::serialization::portable_storage& ps,
       epee::serialization::storage_entry id,
@@ -105,6 +113,7 @@ namespace
         "Unable to register RPC command: wallet_rpc_server::invoke(Request) is not defined or does not return a Response");
     rpc_func_data invoke = {
       std::is_base_of_v<RESTRICTED, RPC>,
+      std::is_base_of_v<SNAPSHOT_READ, RPC>,
       []( epee::serialization::portable_storage& ps,
           epee::serialization::storage_entry id,
           std::optional<epee::serialization::storage_entry> params,
@@ -241,7 +250,7 @@ namespace tools
       }
       MDEBUG("Incoming JSON RPC request for " << method << " from " << get_remote_address(res));
 
-      const auto& [restricted, invoke_ptr] = it->second;
+      const auto& [restricted, snapshot_read, invoke_ptr] = it->second;
 
       // If it's a restricted command and we're in restricted mode then deny it
       if (restricted && m_restricted) {
@@ -257,6 +266,31 @@ namespace tools
 
       std::string result;
       wallet_rpc_error json_error{-32603, "Internal error"};
+      m_last_request_time = std::chrono::steady_clock::now();
+
+      // A read that the snapshot can answer doesn't wait for a refresh that is holding the wallet;
+      // anything else does.  Anything but such a read may change the wallet, so a snapshot taken
+      // before it is stale afterwards.
+      if (!m_wallet_lock.try_lock())
+      {
+        std::lock_guard lock{m_snapshot_mutex};
+        if (snapshot_read && m_snapshot)
+          m_request_snapshot = m_snapshot;
+      }
+      if (!m_request_snapshot && !m_wallet_lock.owns_lock())
+        m_wallet_lock.lock();
+      OXEN_DEFER {
+        if (m_wallet_lock.owns_lock())
+        {
+          if (!snapshot_read)
+          {
+            std::lock_guard lock{m_snapshot_mutex};
+            m_snapshot.reset();
+          }
+          m_wallet_lock.unlock();
+        }
+        m_request_snapshot.reset();
+      };
 
       try {
         result = invoke_ptr(ps, std::move(id), std::move(params), *this);
@@ -376,34 +410,54 @@ namespace tools
     if (m_wallet)
       start_long_poll_thread();
 
-    // Used to prevent queuing up multiple refreshes at once
-    std::atomic<bool> refreshing = false;
-
     // Now we just hang around and twiddle our thumbs until we're told to quit.  (And once in a
-    // while we inject a wallet refresh into the uWS loop).
+    // while we refresh the wallet: here, rather than in the uWS loop, so that SNAPSHOT_READ requests
+    // can still be answered meanwhile).
+    //
+    // A recently used wallet refreshes on its period and as soon as the long poll sees a change; an
+    // idle one backs off and waits out a random delay first.  Whatever triggers a refresh (timer,
+    // long poll, or a REFRESH request) also satisfies the others that are pending.
+    auto idle_delay = std::chrono::milliseconds{crypto::rand_idx<uint64_t>(std::chrono::milliseconds{IDLE_REFRESH_MAX_DELAY}.count())};
+    std::optional<std::chrono::steady_clock::time_point> change_seen;
     while (!m_stop.load(std::memory_order_relaxed))
     {
-      bool refresh_now = !refreshing && m_wallet && (
-          (m_auto_refresh_period > 0s && std::chrono::steady_clock::now() > m_last_auto_refresh_time + m_auto_refresh_period)
-          || m_long_poll_new_changes);
+      const auto now = std::chrono::steady_clock::now();
+      const bool active = now - m_last_request_time.load() < ACTIVE_WALLET_WINDOW;
+      auto period = m_auto_refresh_period;
+      if (!active)
+        period = period * IDLE_REFRESH_BACKOFF + idle_delay;
+      if (m_long_poll_new_changes && !change_seen)
+        change_seen = now;
+      bool refresh_now =
+          (m_auto_refresh_period > 0s && now > m_last_auto_refresh_time.load() + period)
+          || (change_seen && (active || now >= *change_seen + idle_delay));
 
       if (refresh_now)
       {
-        refreshing = true;
-
-        // Queue the refresh to run in the uWS thread loop
-        loop_defer([this, &refreshing] {
+        std::lock_guard lock{m_wallet_mutex};
+        change_seen.reset();
+        idle_delay = std::chrono::milliseconds{crypto::rand_idx<uint64_t>(std::chrono::milliseconds{IDLE_REFRESH_MAX_DELAY}.count())};
+        if (m_wallet)
+        {
           m_long_poll_new_changes = false; // Always consume the change, if we miss one due to thread race, not the end of the world.
 
           try {
-            if (m_wallet) m_wallet->refresh(m_wallet->is_trusted_daemon());
+            bool have_snapshot;
+            {
+              std::lock_guard slock{m_snapshot_mutex};
+              have_snapshot = (bool) m_snapshot;
+            }
+            if (!have_snapshot)
+              publish_snapshot();
+            m_wallet->refresh_batch_hook([this] { publish_snapshot(); });
+            m_wallet->refresh(m_wallet->is_trusted_daemon());
+            publish_snapshot();
           } catch (const std::exception& ex) {
             LOG_ERROR("Exception while refreshing: " << ex.what());
           }
 
           m_last_auto_refresh_time = std::chrono::steady_clock::now();
-          refreshing = false;
-        });
+        }
       }
 
       std::this_thread::sleep_for(250ms);
@@ -575,15 +629,75 @@ namespace tools
 
     m_auto_refresh_period = DEFAULT_AUTO_REFRESH_PERIOD;
     m_last_auto_refresh_time = std::chrono::steady_clock::time_point::min();
+    m_last_request_time = std::chrono::steady_clock::now();
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
   void wallet_rpc_server::require_open()
   {
-    if (!m_wallet)
+    if (!m_wallet && !m_request_snapshot)
       throw wallet_rpc_error{error_code::NOT_OPEN, "No wallet file"};
   }
   //------------------------------------------------------------------------------------------------------------------------------
+  void wallet_rpc_server::publish_snapshot()
+  {
+    if (!m_wallet)
+      return;
+    auto snap = std::make_shared<wallet_snapshot>();
+
+    std::vector<wallet::transfer_details> transfers;
+    m_wallet->get_transfers(transfers);
+
+    snap->accounts.resize(m_wallet->get_num_subaddress_accounts());
+    for (uint32_t a = 0; a < snap->accounts.size(); ++a)
+    {
+      auto& account = snap->accounts[a];
+      for (bool strict : {false, true})
+      {
+        account.balance[strict] = m_wallet->balance(a, strict);
+        account.unlocked_balance[strict] = m_wallet->unlocked_balance(a, strict, &account.blocks_to_unlock[strict], &account.time_to_unlock[strict]);
+        account.balance_per_subaddress[strict] = m_wallet->balance_per_subaddress(a, strict);
+        account.unlocked_balance_per_subaddress[strict] = m_wallet->unlocked_balance_per_subaddress(a, strict);
+      }
+      account.subaddresses.resize(m_wallet->get_num_subaddresses(a));
+      for (uint32_t i = 0; i < account.subaddresses.size(); ++i)
+      {
+        account.subaddresses[i].address = m_wallet->get_subaddress_as_str({a, i});
+        account.subaddresses[i].label = m_wallet->get_subaddress_label({a, i});
+      }
+    }
+    for (const auto& td : transfers)
+    {
+      if (td.m_subaddr_index.major >= snap->accounts.size())
+        continue;
+      auto& subaddresses = snap->accounts[td.m_subaddr_index.major].subaddresses;
+      if (td.m_subaddr_index.minor >= subaddresses.size())
+        continue;
+      auto& sub = subaddresses[td.m_subaddr_index.minor];
+      sub.used = true;
+      if (!td.m_spent)
+        sub.num_unspent_outputs++;
+    }
+    snap->multisig_import_needed = m_wallet->multisig() && m_wallet->has_multisig_partial_key_images();
+    snap->height = m_wallet->get_blockchain_current_height();
+    snap->immutable_height = m_wallet->get_immutable_height();
+
+    std::lock_guard lock{m_snapshot_mutex};
+    m_snapshot = std::move(snap);
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  std::shared_ptr<const wallet_rpc_server::wallet_snapshot> wallet_rpc_server::current_snapshot()
+  {
+    return m_request_snapshot;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  void wallet_rpc_server::wait_for_wallet()
+  {
+    m_request_snapshot.reset();
+    m_wallet_lock.lock();
+    require_open();
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   void wallet_rpc_server::close_wallet(bool save_current)
   {
     if (m_wallet)
@@ -606,6 +720,62 @@ namespace tools
   {
     require_open();
     GET_BALANCE::response res{};
+    if (auto snap = current_snapshot())
+    {
+      if (!req.all_accounts && req.account_index >= snap->accounts.size())
+        wait_for_wallet(); // Let the wallet produce the error
+      else
+      {
+        const bool strict = req.strict;
+        res.multisig_import_needed = snap->multisig_import_needed;
+        uint32_t first = req.all_accounts ? 0 : req.account_index;
+        uint32_t last = req.all_accounts ? snap->accounts.size() : req.account_index + 1;
+        for (uint32_t account_index = first; account_index < last; ++account_index)
+        {
+          const auto& account = snap->accounts[account_index];
+          res.balance += account.balance[strict];
+          res.unlocked_balance += account.unlocked_balance[strict];
+          res.blocks_to_unlock = std::max(res.blocks_to_unlock, account.blocks_to_unlock[strict]);
+          res.time_to_unlock = std::max(res.time_to_unlock, account.time_to_unlock[strict]);
+
+          std::set<uint32_t> address_indices;
+          if (!req.all_accounts && !req.address_indices.empty())
+            address_indices = req.address_indices;
+          else
+            for (const auto& i : account.balance_per_subaddress[strict])
+              address_indices.insert(i.first);
+          for (uint32_t i : address_indices)
+          {
+            if (i >= account.subaddresses.size())
+            {
+              MDEBUG("Subaddress " << account_index << "/" << i << " isn't in the snapshot; waiting for the wallet");
+              res = {};
+              wait_for_wallet();
+              break;
+            }
+            wallet_rpc::GET_BALANCE::per_subaddress_info info{};
+            info.account_index = account_index;
+            info.address_index = i;
+            info.address = account.subaddresses[i].address;
+            info.label = account.subaddresses[i].label;
+            info.num_unspent_outputs = account.subaddresses[i].num_unspent_outputs;
+            if (auto b = account.balance_per_subaddress[strict].find(i); b != account.balance_per_subaddress[strict].end())
+              info.balance = b->second;
+            if (auto u = account.unlocked_balance_per_subaddress[strict].find(i); u != account.unlocked_balance_per_subaddress[strict].end())
+            {
+              info.unlocked_balance = u->second.first;
+              info.blocks_to_unlock = u->second.second.first;
+              info.time_to_unlock = u->second.second.second;
+            }
+            res.per_subaddress.push_back(std::move(info));
+          }
+          if (!current_snapshot())
+            break;
+        }
+        if (current_snapshot())
+          return res;
+      }
+    }
     {
       res.balance = req.all_accounts ? m_wallet->balance_all(req.strict) : m_wallet->balance(req.account_index, req.strict);
       res.unlocked_balance = req.all_accounts ? m_wallet->unlocked_balance_all(req.strict, &res.blocks_to_unlock, &res.time_to_unlock) : m_wallet->unlocked_balance(req.account_index, req.strict, &res.blocks_to_unlock, &res.time_to_unlock);
@@ -666,6 +836,31 @@ namespace tools
   {
     require_open();
     GET_ADDRESS::response res{};
+    if (auto snap = current_snapshot())
+    {
+      // Anything out of bounds is left to the wallet, for the error
+      const auto* account = req.account_index < snap->accounts.size() ? &snap->accounts[req.account_index] : nullptr;
+      if (account && std::all_of(req.address_index.begin(), req.address_index.end(),
+            [&](uint32_t i) { return i < account->subaddresses.size(); }))
+      {
+        auto add = [&](uint32_t i) {
+          auto& info = res.addresses.emplace_back();
+          info.address = account->subaddresses[i].address;
+          info.label = account->subaddresses[i].label;
+          info.address_index = i;
+          info.used = account->subaddresses[i].used;
+        };
+        if (req.address_index.empty())
+          for (uint32_t i = 0; i < account->subaddresses.size(); ++i)
+            add(i);
+        else
+          for (uint32_t i : req.address_index)
+            add(i);
+        res.address = account->subaddresses.empty() ? "" : account->subaddresses[0].address;
+        return res;
+      }
+      wait_for_wallet();
+    }
     {
       THROW_WALLET_EXCEPTION_IF(req.account_index >= m_wallet->get_num_subaddress_accounts(), error::account_index_outofbound);
       res.addresses.clear();
@@ -859,6 +1054,12 @@ namespace tools
   {
     require_open();
     GET_HEIGHT::response res{};
+    if (auto snap = current_snapshot())
+    {
+      res.height           = snap->height;
+      res.immutable_height = snap->immutable_height;
+    }
+    else
     {
       res.height           = m_wallet->get_blockchain_current_height();
       res.immutable_height = m_wallet->get_immutable_height();
@@ -2002,9 +2203,19 @@ namespace tools
     args.subaddr_indices  = req.subaddr_indices;
     args.account_index    = req.account_index;
     args.all_accounts     = req.all_accounts;
+    args.limit            = req.limit;
+    if (!req.cursor.empty())
+    {
+      args.after = wallet2::transfer_cursor::parse(req.cursor);
+      if (!args.after)
+        throw wallet_rpc_error{error_code::UNKNOWN_ERROR, "Invalid cursor"};
+    }
 
     std::vector<wallet::transfer_view> transfers;
-    m_wallet->get_transfers(args, transfers);
+    std::optional<wallet2::transfer_cursor> next;
+    m_wallet->get_transfers(args, transfers, &next);
+    if (next)
+      res.next_cursor = next->to_string();
 
     for (wallet::transfer_view& entry : transfers)
     {
@@ -2348,7 +2559,9 @@ namespace tools
   {
     require_open();
     REFRESH::response res{};
+    m_long_poll_new_changes = false;
     m_wallet->refresh(m_wallet->is_trusted_daemon(), req.start_height, res.blocks_fetched, res.received_money);
+    m_last_auto_refresh_time = std::chrono::steady_clock::now();
     return res;
   }
   //------------------------------------------------------------------------------------------------------------------------------
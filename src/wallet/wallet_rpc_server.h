@@ -33,6 +33,8 @@
 
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/variables_map.hpp>
+#include <memory>
+#include <mutex>
 #include <string>
 
 #include <uWebSockets/App.h>
@@ -177,6 +179,44 @@ namespace tools
       // Checks that a wallet is open; if not, throws an error.
       void require_open();
 
+      // Read-only wallet state published after each refreshed block batch, so that SNAPSHOT_READ
+      // commands can be answered while a refresh holds the wallet.
+      struct wallet_snapshot
+      {
+        struct subaddress
+        {
+          std::string address;
+          std::string label;
+          uint64_t num_unspent_outputs = 0;
+          bool used = false;
+        };
+        struct account
+        {
+          // Indexed by `strict`
+          uint64_t balance[2];
+          uint64_t unlocked_balance[2];
+          uint64_t blocks_to_unlock[2];
+          uint64_t time_to_unlock[2];
+          std::map<uint32_t, uint64_t> balance_per_subaddress[2];
+          std::map<uint32_t, std::pair<uint64_t, std::pair<uint64_t, uint64_t>>> unlocked_balance_per_subaddress[2];
+          std::vector<subaddress> subaddresses;
+        };
+        std::vector<account> accounts;
+        bool multisig_import_needed;
+        uint64_t height;
+        uint64_t immutable_height;
+      };
+
+      // Builds and publishes a snapshot of m_wallet; must be called with m_wallet_mutex held.
+      void publish_snapshot();
+
+      // If the current request is a SNAPSHOT_READ being answered from the snapshot, returns it.
+      std::shared_ptr<const wallet_snapshot> current_snapshot();
+
+      // Switches a SNAPSHOT_READ request that the snapshot can't answer over to waiting for (and
+      // then using) the wallet.
+      void wait_for_wallet();
+
       // Safely and cleanly closes the currently open wallet (if one is open)
       void close_wallet(bool save_current);
 
@@ -210,6 +250,12 @@ namespace tools
       void stop_long_poll_thread();
 
       std::unique_ptr<wallet2> m_wallet;
+      // Held by the RPC thread while handling a request, and by run_loop() while refreshing.
+      std::mutex m_wallet_mutex;
+      std::unique_lock<std::mutex> m_wallet_lock{m_wallet_mutex, std::defer_lock}; // the RPC thread's
+      std::shared_ptr<const wallet_snapshot> m_snapshot; // null when stale; guarded by m_snapshot_mutex
+      std::mutex m_snapshot_mutex;
+      std::shared_ptr<const wallet_snapshot> m_request_snapshot; // set while answering from a snapshot
       fs::path m_wallet_dir;
       std::vector<std::tuple<std::string /*ip*/, uint16_t /*port*/, bool /*required*/>> m_bind;
       tools::private_file rpc_login_file;
@@ -217,7 +263,8 @@ namespace tools
       bool m_restricted;
       boost::program_options::variables_map m_vm;
       std::chrono::milliseconds m_auto_refresh_period;
-      std::chrono::steady_clock::time_point m_last_auto_refresh_time;
+      std::atomic<std::chrono::steady_clock::time_point> m_last_auto_refresh_time;
+      std::atomic<std::chrono::steady_clock::time_point> m_last_request_time;
       std::atomic<bool> m_long_poll_new_changes;
       std::atomic<bool> m_long_poll_disabled;
       std::thread m_long_poll_thread;
@@ -649,6 +649,8 @@ KV_SERIALIZE_MAP_CODE_BEGIN(GET_TRANSFERS::request)
   KV_SERIALIZE(account_index);
   KV_SERIALIZE(subaddr_indices);
   KV_SERIALIZE_OPT(all_accounts, false);
+  KV_SERIALIZE_OPT(limit, (uint32_t)0);
+  KV_SERIALIZE(cursor);
 KV_SERIALIZE_MAP_CODE_END()
 
 
@@ -658,6 +660,7 @@ KV_SERIALIZE_MAP_CODE_BEGIN(GET_TRANSFERS::response)
   KV_SERIALIZE(pending);
   KV_SERIALIZE(failed);
   KV_SERIALIZE(pool);
+  KV_SERIALIZE(next_cursor);
 KV_SERIALIZE_MAP_CODE_END()
 
 
@@ -69,6 +69,10 @@ namespace tools::wallet_rpc {
   /// restricted mode).
   struct RESTRICTED : RPC_COMMAND {};
 
+  /// Base class for read-only commands that, while a refresh is running, are answered from the
+  /// wallet state published after the last refreshed block batch instead of waiting for it.
+  struct SNAPSHOT_READ : RPC_COMMAND {};
+
   /// Generic, serializable, no-argument request or response type, use as
   /// `struct request : EMPTY {};` or `using response = EMPTY;`
   struct EMPTY { KV_MAP_SERIALIZABLE };
@@ -88,7 +92,7 @@ namespace tools::wallet_rpc {
 
   OXEN_RPC_DOC_INTROSPECT
   // Return the wallet's balance.
-  struct GET_BALANCE : RPC_COMMAND
+  struct GET_BALANCE : SNAPSHOT_READ
   {
     static constexpr auto names() { return NAMES("get_balance", "getbalance"); }
 
@@ -132,7 +136,7 @@ namespace tools::wallet_rpc {
 
   OXEN_RPC_DOC_INTROSPECT
   // Return the wallet's addresses for an account. Optionally filter for specific set of subaddresses.
-  struct GET_ADDRESS : RPC_COMMAND
+  struct GET_ADDRESS : SNAPSHOT_READ
   {
     static constexpr auto names() { return NAMES("get_address", "getaddress"); }
 
@@ -379,7 +383,7 @@ namespace tools::wallet_rpc {
 
   OXEN_RPC_DOC_INTROSPECT
   // Returns the wallet's current block height and blockchain immutable height
-  struct GET_HEIGHT : RPC_COMMAND
+  struct GET_HEIGHT : SNAPSHOT_READ
   {
     static constexpr auto names() { return NAMES("get_height", "getheight"); }
 
@@ -1215,6 +1219,8 @@ namespace tools::wallet_rpc {
       uint32_t account_index;             // (Optional) Index of the account to query for transfers. (defaults to 0)
       std::set<uint32_t> subaddr_indices; // (Optional) List of subaddress indices to query for transfers. (defaults to 0)
       bool all_accounts;                  // If true, return transfers for all accounts, subaddr_indices and account_index are ignored
+      uint32_t limit;                     // (Optional) Return at most this many transfers (in total across all types); 0 for no limit.
+      std::string cursor;                 // (Optional) Continue a limited listing from the `next_cursor` of the previous response.
 
       KV_MAP_SERIALIZABLE
     };
@@ -1226,6 +1232,7 @@ namespace tools::wallet_rpc {
       std::list<wallet::transfer_view> pending; //
       std::list<wallet::transfer_view> failed;  //
       std::list<wallet::transfer_view> pool;    //
+      std::string next_cursor;                  // If `limit` cut the listing short, pass this as `cursor` to get the next transfers; empty otherwise.
 
       KV_MAP_SERIALIZABLE
     };
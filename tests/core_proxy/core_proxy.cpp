@@ -203,6 +203,15 @@ std::vector<core::tx_verification_batch_info> tests::proxy_core::handle_incoming
     return parsed;
 }
 
+std::vector<std::vector<core::tx_verification_batch_info>> tests::proxy_core::preparse_incoming_block_txs(const std::vector<block_complete_entry>& blocks, uint64_t start_height)
+{
+    std::vector<std::vector<core::tx_verification_batch_info>> parsed;
+    parsed.reserve(blocks.size());
+    for (const auto &b : blocks)
+        parsed.push_back(parse_incoming_txs(b.txs, tx_pool_options::from_block()));
+    return parsed;
+}
+
 bool tests::proxy_core::handle_incoming_tx(const blobdata& tx_blob, tx_verification_context& tvc, const tx_pool_options &opts)
 {
     const std::vector<cryptonote::blobdata> tx_blobs{{tx_blob}};
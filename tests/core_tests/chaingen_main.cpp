@@ -34,6 +34,7 @@
 #include "common/command_line.h"
 #include "cryptonote_core/uptime_proof.h"
 #include "transaction_tests.h"
+#include "wallet_benchmark.h"
 
 namespace po = boost::program_options;
 
@@ -42,6 +43,11 @@ namespace
   const command_line::arg_descriptor<std::string> arg_filter                      = { "filter", "Regular expression filter for which tests to run" };
   const command_line::arg_descriptor<bool>        arg_list_tests                  = {"list_tests", ""};
   const command_line::arg_descriptor<std::string> arg_log_level                   = {"log-level", ""};
+  const command_line::arg_descriptor<bool>        arg_txpool_benchmark            = {"txpool_benchmark", "Run the tx pool benchmark instead of the tests"};
+  const command_line::arg_descriptor<size_t>      arg_txpool_benchmark_txs        = {"txpool_benchmark_txs", "Number of txs for --txpool_benchmark to submit", oxen_txpool_benchmark::num_txs};
+  const command_line::arg_descriptor<bool>        arg_wallet_benchmark            = {"wallet_benchmark", "Run the large-wallet benchmark instead of the tests"};
+  const command_line::arg_descriptor<std::vector<size_t>> arg_wallet_benchmark_transfers = {"wallet_benchmark_transfers", "Wallet sizes, in transfers, to measure --wallet_benchmark at (default: 10000, 100000 and 1000000)"};
+  const command_line::arg_descriptor<size_t>      arg_wallet_benchmark_subaddresses = {"wallet_benchmark_subaddresses", "Number of subaddresses that --wallet_benchmark pays", 1000};
 }
 
 int main(int argc, char* argv[])
@@ -61,6 +67,11 @@ int main(int argc, char* argv[])
   command_line::add_arg(desc_options, arg_filter);
   command_line::add_arg(desc_options, arg_list_tests);
   command_line::add_arg(desc_options, arg_log_level);
+  command_line::add_arg(desc_options, arg_txpool_benchmark);
+  command_line::add_arg(desc_options, arg_txpool_benchmark_txs);
+  command_line::add_arg(desc_options, arg_wallet_benchmark);
+  command_line::add_arg(desc_options, arg_wallet_benchmark_transfers);
+  command_line::add_arg(desc_options, arg_wallet_benchmark_subaddresses);
 
   po::variables_map vm;
   bool r = command_line::handle_error_helper(desc_options, [&]()
@@ -83,6 +94,14 @@ int main(int argc, char* argv[])
   else
     mlog_set_log_level(0);
 
+  if (command_line::get_arg(vm, arg_wallet_benchmark))
+  {
+    auto sizes = command_line::get_arg(vm, arg_wallet_benchmark_transfers);
+    if (sizes.empty())
+      sizes = {10'000, 100'000, 1'000'000};
+    return run_wallet_benchmark(sizes, command_line::get_arg(vm, arg_wallet_benchmark_subaddresses)) ? 0 : 1;
+  }
+
   const std::string filter = command_line::get_arg(vm, arg_filter);
 
   size_t tests_count = 0;
@@ -91,6 +110,13 @@ int main(int argc, char* argv[])
   {
     list_tests = command_line::get_arg(vm, arg_list_tests);
 
+    if (command_line::get_arg(vm, arg_txpool_benchmark))
+    {
+      oxen_txpool_benchmark::num_txs = command_line::get_arg(vm, arg_txpool_benchmark_txs);
+      GENERATE_AND_PLAY(oxen_txpool_benchmark);
+      return failed_tests.empty() ? 0 : 1;
+    }
+
     // NOTE: Loki Tests
     GENERATE_AND_PLAY(oxen_checkpointing_alt_chain_handle_alt_blocks_at_tip);
     GENERATE_AND_PLAY(oxen_checkpointing_alt_chain_more_service_node_checkpoints_less_pow_overtakes);
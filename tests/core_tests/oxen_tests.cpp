@@ -1404,6 +1404,22 @@ bool oxen_name_system_get_mappings::generate(std::vector<test_event_entry> &even
     std::vector<ons::mapping_record> records = ons_db.get_mappings({ons::mapping_type::session}, session_name_hash);
     CHECK_EQ(records.size(), 1);
     CHECK_TEST_CONDITION(verify_ons_mapping_record(perr_context, records[0], ons::mapping_type::session, session_name1, bob_key.session_value, session_height, std::nullopt, session_tx_hash, bob_key.owner, {} /*backup_owner*/));
+
+    // Batched resolve (done first, so that it reads the db rather than the resolve cache): one
+    // result per key, in order, matching the single lookup
+    std::string other_name_hash = ons::name_to_base64_hash("othername");
+    uint64_t height = c.get_current_blockchain_height();
+    auto values = ons_db.resolve({{ons::mapping_type::lokinet, session_name_hash},
+                                  {ons::mapping_type::session, session_name_hash},
+                                  {ons::mapping_type::session, other_name_hash},
+                                  {ons::mapping_type::session, session_name_hash}}, height);
+    auto single = ons_db.resolve(ons::mapping_type::session, session_name_hash, height);
+    CHECK_EQ(values.size(), 4);
+    CHECK_TEST_CONDITION(single);
+    CHECK_TEST_CONDITION(!values[0]);
+    CHECK_TEST_CONDITION(values[1] && *values[1] == *single);
+    CHECK_TEST_CONDITION(!values[2]);
+    CHECK_TEST_CONDITION(values[3] && *values[3] == *single);
     return true;
   });
 
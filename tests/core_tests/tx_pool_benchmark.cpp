@@ -0,0 +1,215 @@
+#include "tx_pool_benchmark.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_config.h"
+#include "cryptonote_core/cryptonote_core.h"
+#include "cryptonote_core/tx_pool.h"
+#include "cryptonote_core/uptime_proof.h"
+
+#undef LOKI_DEFAULT_LOG_CATEGORY
+#define LOKI_DEFAULT_LOG_CATEGORY "txpool_benchmark"
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+double micros(clock_type::duration d)
+{
+  return std::chrono::duration<double, std::micro>(d).count();
+}
+
+// Takes and releases a lock every 100us on its own thread, recording how long each acquisition
+// waited: the worst waits bound how long the code under test held the lock for.
+class lock_probe
+{
+public:
+  explicit lock_probe(std::function<void()> lock_unlock)
+    : thread{[this, f = std::move(lock_unlock)] {
+        while (!done.load(std::memory_order_relaxed))
+        {
+          auto start = clock_type::now();
+          f();
+          waits.push_back(micros(clock_type::now() - start));
+          std::this_thread::sleep_for(std::chrono::microseconds{100});
+        }
+      }}
+  {}
+
+  // Stops probing and returns the 99th percentile and maximum waits, in microseconds
+  std::pair<double, double> finish()
+  {
+    done = true;
+    thread.join();
+    if (waits.empty())
+      return {0, 0};
+    std::sort(waits.begin(), waits.end());
+    return {waits[std::min(waits.size() - 1, waits.size() * 99 / 100)], waits.back()};
+  }
+
+private:
+  std::vector<double> waits;
+  std::atomic<bool> done{false};
+  std::thread thread;
+};
+
+void clear_pool(cryptonote::core& c)
+{
+  auto& pool = c.get_pool();
+  std::vector<crypto::hash> hashes;
+  pool.get_transaction_hashes(hashes);
+  cryptonote::transaction tx;
+  cryptonote::blobdata blob;
+  size_t weight;
+  uint64_t fee;
+  bool relayed, do_not_relay, double_spend_seen;
+  for (auto& h : hashes)
+    pool.take_tx(h, tx, blob, weight, fee, relayed, do_not_relay, double_spend_seen);
+}
+
+// Submits blobs[begin, end) in batches of `batch` from `threads` threads; returns the number added
+// to the pool.
+size_t submit(cryptonote::core& c, const std::vector<cryptonote::blobdata>& blobs, size_t begin, size_t end, size_t batch, size_t threads)
+{
+  std::atomic<size_t> next{begin}, added{0};
+  auto worker = [&] {
+    for (size_t i; (i = next.fetch_add(batch)) < end;)
+    {
+      std::vector<cryptonote::blobdata> chunk(blobs.begin() + i, blobs.begin() + std::min(i + batch, end));
+      for (auto& r : c.handle_incoming_txs(chunk, cryptonote::tx_pool_options::from_peer()))
+        if (r.tvc.m_added_to_pool)
+          added++;
+    }
+  };
+  std::vector<std::thread> workers;
+  for (size_t t = 1; t < threads; t++)
+    workers.emplace_back(worker);
+  worker();
+  for (auto& w : workers)
+    w.join();
+  return added;
+}
+
+double time_fill_block_template(cryptonote::core& c)
+{
+  auto& bc = c.get_blockchain_storage();
+  const uint64_t height = bc.get_current_blockchain_height();
+  const size_t median_weight = bc.get_current_cumulative_block_weight_limit() / 2;
+  const uint64_t coins = bc.get_db().get_block_already_generated_coins(height - 1);
+  const uint8_t version = bc.get_network_version();
+
+  // Best of three, as the first call also warms the pool's caches
+  double best = 0;
+  for (int i = 0; i < 3; i++)
+  {
+    cryptonote::block b{};
+    size_t weight;
+    uint64_t fee, reward;
+    auto start = clock_type::now();
+    c.get_pool().fill_block_template(b, median_weight, coins, weight, fee, reward, version, height);
+    double us = micros(clock_type::now() - start);
+    if (i == 0 || us < best)
+      best = us;
+  }
+  return best;
+}
+
+bool run_benchmark(cryptonote::core& c, const std::vector<cryptonote::blobdata>& blobs)
+{
+  DEFINE_TESTS_ERROR_CONTEXT("txpool_benchmark");
+  auto& pool = c.get_pool();
+  const size_t n = blobs.size();
+
+  std::cout << std::fixed << std::setprecision(1)
+            << "\nAdmission of " << n << " txs through handle_incoming_txs\n"
+            << std::setw(6) << "batch" << std::setw(9) << "threads" << std::setw(12) << "txs/s"
+            << std::setw(16) << "pool lock p99" << std::setw(12) << "max"
+            << std::setw(20) << "incoming lock p99" << std::setw(12) << "max" << "  (us)\n";
+  for (size_t batch : {1, 16, 128})
+  {
+    for (size_t threads : {1, 2, 4})
+    {
+      clear_pool(c);
+      lock_probe pool_probe{[&pool] { pool.lock(); pool.unlock(); }};
+      lock_probe incoming_probe{[&c] { c.incoming_tx_lock(); }};
+      auto start = clock_type::now();
+      size_t added = submit(c, blobs, 0, n, batch, threads);
+      double secs = micros(clock_type::now() - start) / 1e6;
+      auto [pool_p99, pool_max] = pool_probe.finish();
+      auto [in_p99, in_max] = incoming_probe.finish();
+      CHECK_EQ(added, n);
+      std::cout << std::setw(6) << batch << std::setw(9) << threads << std::setw(12) << added / secs
+                << std::setw(16) << pool_p99 << std::setw(12) << pool_max
+                << std::setw(20) << in_p99 << std::setw(12) << in_max << "\n";
+    }
+  }
+
+  std::cout << "\nfill_block_template latency by pool size\n"
+            << std::setw(8) << "txs" << std::setw(14) << "bytes" << std::setw(12) << "us\n";
+  clear_pool(c);
+  for (size_t quarter = 1; quarter <= 4; quarter++)
+  {
+    CHECK_EQ(submit(c, blobs, (quarter - 1) * n / 4, quarter * n / 4, 128, 1), quarter * n / 4 - (quarter - 1) * n / 4);
+    std::cout << std::setw(8) << pool.get_transactions_count() << std::setw(14) << pool.get_txpool_weight()
+              << std::setw(12) << time_fill_block_template(c) << "\n";
+  }
+
+  const size_t weight = pool.get_txpool_weight(), count = pool.get_transactions_count();
+  auto start = clock_type::now();
+  pool.set_txpool_max_weight(weight / 2);
+  double prune_us = micros(clock_type::now() - start);
+  const size_t evicted = count - pool.get_transactions_count();
+  std::cout << "\nPruning " << count << " txs to half their weight evicted " << evicted << " in " << prune_us << "us";
+  if (evicted)
+    std::cout << " (" << prune_us / evicted << "us per tx)";
+  std::cout << "\n" << std::endl;
+
+  pool.set_txpool_max_weight(DEFAULT_TXPOOL_MAX_WEIGHT);
+  clear_pool(c);
+  return true;
+}
+
+}
+
+bool oxen_txpool_benchmark::generate(std::vector<test_event_entry>& events)
+{
+  auto hard_forks = oxen_generate_hard_fork_table();
+  oxen_chain_generator gen(events, hard_forks);
+  gen.add_blocks_until_version(hard_forks.back().version);
+  gen.add_mined_money_unlock_blocks();
+
+  // The generator only counts outputs as spent once they are mined, so each sender is funded by a
+  // separate block and then signs exactly one unmined tx.
+  std::vector<cryptonote::account_base> senders;
+  senders.reserve(num_txs);
+  for (size_t i = 0; i < num_txs; i++)
+  {
+    auto& sender = senders.emplace_back(gen.add_account());
+    auto funding = gen.create_and_add_tx(gen.first_miner_, sender.get_keys().m_account_address, MK_COINS(10));
+    gen.create_and_add_next_block({funding});
+  }
+  gen.add_transfer_unlock_blocks();
+
+  // Fees vary so that fill_block_template has an ordering to work out
+  auto blobs = std::make_shared<std::vector<cryptonote::blobdata>>();
+  blobs->reserve(num_txs);
+  for (size_t i = 0; i < senders.size(); i++)
+  {
+    auto tx = gen.create_tx(senders[i], gen.first_miner_.get_keys().m_account_address, MK_COINS(1), TESTS_DEFAULT_FEE * (1 + i % 4));
+    blobs->push_back(cryptonote::tx_to_blob(tx));
+  }
+
+  oxen_register_callback(events, "run_txpool_benchmark", [blobs](cryptonote::core &c, size_t ev_index)
+  {
+    return run_benchmark(c, *blobs);
+  });
+  return true;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "chaingen.h"
+
+/// Tx pool throughput benchmark.  Builds a chain holding `num_txs` funded accounts, signs one
+/// transfer from each, then replays those transfers into the core's pool and reports:
+///
+/// - the admission rate through core::handle_incoming_txs for a range of batch sizes and
+///   submitting threads, with how long a probe thread had to wait for the pool and incoming tx
+///   locks meanwhile;
+/// - fill_block_template latency as the pool grows;
+/// - the cost of pruning the full pool to half its weight.
+///
+/// Not part of the regular test run; enable it with `core_tests --txpool_benchmark`.
+struct oxen_txpool_benchmark : public test_chain_unit_base
+{
+  static inline size_t num_txs = 256;
+  bool generate(std::vector<test_event_entry>& events);
+};
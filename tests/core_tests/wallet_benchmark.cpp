@@ -0,0 +1,219 @@
+#include "wallet_benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <unistd.h>
+
+#include "common/fs.h"
+#include "common/threadpool.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_core/uptime_proof.h"
+#include "ringct/rctOps.h"
+#include "wallet_tools.h"
+
+#undef LOKI_DEFAULT_LOG_CATEGORY
+#define LOKI_DEFAULT_LOG_CATEGORY "wallet_benchmark"
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+constexpr size_t outputs_per_tx = 10, txs_per_block = 10, blocks_per_batch = 1000;
+constexpr uint64_t transfer_amount = COIN;
+
+double seconds(clock_type::duration d)
+{
+  return std::chrono::duration<double>(d).count();
+}
+
+// A transfer of `outputs` outputs to consecutive entries of `dests` (all subaddresses, so each
+// output gets its own additional tx key).  The input and proofs are junk: the wallet doesn't
+// verify them, only the output keys and the amount commitments.
+cryptonote::transaction make_tx(const std::vector<cryptonote::account_public_address>& dests, size_t first, size_t outputs)
+{
+  auto& hwdev = hw::get_device("default");
+  cryptonote::transaction tx;
+  tx.version = cryptonote::txversion::v4_tx_types;
+  tx.type = cryptonote::txtype::standard;
+
+  cryptonote::txin_to_key in{};
+  in.key_offsets = {1};
+  in.k_image = crypto::rand<crypto::key_image>();
+  tx.vin.push_back(in);
+
+  tx.rct_signatures.type = rct::RCTType::CLSAG;
+  tx.rct_signatures.txnFee = TESTS_DEFAULT_FEE;
+  cryptonote::add_tx_extra<cryptonote::tx_extra_pub_key>(tx, cryptonote::keypair{hwdev}.pub);
+
+  std::vector<crypto::public_key> additional;
+  for (size_t k = 0; k < outputs; k++)
+  {
+    const auto& to = dests[(first + k) % dests.size()];
+    cryptonote::keypair r{hwdev};
+    crypto::key_derivation derivation;
+    crypto::generate_key_derivation(to.m_view_public_key, r.sec, derivation);
+    crypto::public_key out_key;
+    crypto::derive_public_key(derivation, k, to.m_spend_public_key, out_key);
+    additional.push_back(rct::rct2pk(rct::scalarmultKey(rct::pk2rct(to.m_spend_public_key), rct::sk2rct(r.sec))));
+
+    crypto::secret_key scalar;
+    crypto::derivation_to_scalar(derivation, k, scalar);
+    rct::ecdhTuple ecdh{};
+    ecdh.amount = rct::d2h(transfer_amount);
+    rct::ecdhEncode(ecdh, rct::sk2rct(scalar), true);
+
+    tx.vout.push_back({0, cryptonote::txout_to_key{out_key}});
+    tx.output_unlock_times.push_back(0);
+    tx.rct_signatures.ecdhInfo.push_back(ecdh);
+    tx.rct_signatures.outPk.push_back({rct::pk2rct(out_key), rct::commit(transfer_amount, rct::genCommitmentMask(rct::sk2rct(scalar)))});
+  }
+  cryptonote::add_additional_tx_pub_keys_to_extra(tx.extra, additional);
+  return tx;
+}
+
+// A block at `height` whose transfers pay `transfers` outputs to the wallet, plus a miner tx
+// paying someone else.  Outputs are numbered globally from `global_index`.
+void make_block(uint64_t height, size_t transfers, uint64_t global_index, const std::vector<cryptonote::account_public_address>& dests,
+    cryptonote::block_complete_entry& entry, tools::wallet2::parsed_block& parsed)
+{
+  auto& hwdev = hw::get_device("default");
+  auto& b = parsed.block;
+  b.major_version = cryptonote::network_version_count - 1;
+  b.timestamp = time(nullptr);
+  b.miner_tx.version = cryptonote::txversion::v4_tx_types;
+  b.miner_tx.vin.push_back(cryptonote::txin_gen{height});
+  cryptonote::add_tx_extra<cryptonote::tx_extra_pub_key>(b.miner_tx, cryptonote::keypair{hwdev}.pub);
+  b.miner_tx.vout.push_back({transfer_amount, cryptonote::txout_to_key{cryptonote::keypair{hwdev}.pub}});
+  b.miner_tx.output_unlock_times.push_back(height + CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW);
+
+  auto& indices = parsed.o_indices.indices;
+  indices.emplace_back().indices.push_back(global_index++);
+  for (size_t done = 0; done < transfers; done += outputs_per_tx)
+  {
+    const size_t n = std::min(outputs_per_tx, transfers - done);
+    parsed.txes.push_back(make_tx(dests, global_index, n));
+    b.tx_hashes.push_back(crypto::rand<crypto::hash>());
+    auto& tx_indices = indices.emplace_back().indices;
+    for (size_t k = 0; k < n; k++)
+      tx_indices.push_back(global_index++);
+  }
+  // Nothing reads the blobs of already-parsed blocks, only their count
+  entry.txs.resize(parsed.txes.size());
+  parsed.hash = crypto::rand<crypto::hash>();
+  parsed.error = false;
+}
+
+}
+
+bool run_wallet_benchmark(std::vector<size_t> transfer_counts, size_t subaddresses)
+{
+  std::sort(transfer_counts.begin(), transfer_counts.end());
+  subaddresses = std::max<size_t>(subaddresses, 1);
+  const auto dir = fs::temp_directory_path() / ("oxen-wallet-benchmark-" + std::to_string(getpid()));
+  bool ok = true;
+  try
+  {
+    fs::create_directories(dir);
+    const auto path = dir / "wallet";
+    tools::wallet2 wallet{cryptonote::FAKECHAIN};
+    wallet.init("");
+    wallet.generate(path, "", crypto::secret_key{}, false, false, false);
+
+    std::vector<cryptonote::account_public_address> dests;
+    for (uint32_t i = 1; i <= subaddresses; i++)
+    {
+      wallet.add_subaddress(0, "");
+      dests.push_back(wallet.get_subaddress({0, i}));
+    }
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "\nWallet with " << subaddresses << " subaddresses, " << outputs_per_tx * txs_per_block << " outputs per block\n"
+              << std::setw(10) << "transfers" << std::setw(10) << "blocks/s" << std::setw(12) << "outputs/s"
+              << std::setw(11) << "store ms" << std::setw(10) << "load ms" << std::setw(13) << "balance us"
+              << std::setw(18) << "get_transfers ms" << "\n";
+
+    auto& tpool = tools::threadpool::getInstance();
+    uint64_t global_index = 0;
+    size_t transfers = 0;
+    for (size_t target : transfer_counts)
+    {
+      uint64_t blocks = 0, outputs = 0;
+      clock_type::duration scanning{};
+      while (transfers < target)
+      {
+        const uint64_t start_height = wallet.get_blockchain_current_height();
+        const size_t per_block = outputs_per_tx * txs_per_block;
+        const size_t n = std::min(target - transfers, blocks_per_batch * per_block);
+        const size_t num_blocks = (n + per_block - 1) / per_block;
+
+        std::vector<cryptonote::block_complete_entry> entries(num_blocks);
+        std::vector<tools::wallet2::parsed_block> parsed(num_blocks);
+        tools::threadpool::waiter waiter;
+        for (size_t i = 0; i < num_blocks; i++)
+        {
+          const size_t block_transfers = std::min(per_block, n - i * per_block);
+          // The miner tx's output comes first in each block
+          const uint64_t first_index = global_index + i * (per_block + 1);
+          tpool.submit(&waiter, [&, i, block_transfers, first_index] {
+            make_block(start_height + i, block_transfers, first_index, dests, entries[i], parsed[i]);
+          }, true);
+        }
+        waiter.wait(&tpool);
+        global_index += n + num_blocks;
+
+        uint64_t added;
+        auto start = clock_type::now();
+        wallet_accessor_test::process_parsed_blocks(&wallet, start_height, entries, parsed, added);
+        scanning += clock_type::now() - start;
+        blocks += added;
+        outputs += n + num_blocks;
+        transfers += n;
+      }
+      CHECK_AND_ASSERT_THROW_MES(wallet.get_num_transfer_details() == transfers,
+          "Wallet found " << wallet.get_num_transfer_details() << " of " << transfers << " synthetic transfers");
+
+      auto start = clock_type::now();
+      wallet.store();
+      const double store_s = seconds(clock_type::now() - start);
+
+      start = clock_type::now();
+      {
+        tools::wallet2 loaded{cryptonote::FAKECHAIN};
+        loaded.load(path, "");
+      }
+      const double load_s = seconds(clock_type::now() - start);
+
+      start = clock_type::now();
+      const uint64_t balance = wallet.balance_all(false);
+      const double balance_s = seconds(clock_type::now() - start);
+      CHECK_AND_ASSERT_THROW_MES(balance == transfers * transfer_amount, "Unexpected wallet balance " << balance);
+
+      tools::wallet2::get_transfers_args_t args{};
+      args.in = true;
+      args.all_accounts = true;
+      std::vector<wallet::transfer_view> views;
+      start = clock_type::now();
+      wallet.get_transfers(args, views);
+      const double get_transfers_s = seconds(clock_type::now() - start);
+
+      const double scan_s = seconds(scanning);
+      std::cout << std::setw(10) << transfers
+                << std::setw(10) << (scan_s > 0 ? blocks / scan_s : 0.0)
+                << std::setw(12) << (scan_s > 0 ? outputs / scan_s : 0.0)
+                << std::setw(11) << store_s * 1e3 << std::setw(10) << load_s * 1e3
+                << std::setw(13) << balance_s * 1e6 << std::setw(18) << get_transfers_s * 1e3 << "\n";
+    }
+    std::cout << std::endl;
+  }
+  catch (const std::exception& e)
+  {
+    MERROR("Wallet benchmark failed: " << e.what());
+    ok = false;
+  }
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+  return ok;
+}
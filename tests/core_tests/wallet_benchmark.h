@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/// Large-wallet benchmark.  Feeds a fresh wallet synthetic blocks full of RingCT outputs spread
+/// across `subaddresses` subaddresses, and each time it holds one of `transfer_counts` transfers
+/// reports the scanning rate since the previous size and the latency of store(), load(),
+/// balance_all() and get_transfers().
+///
+/// The blocks are handed straight to the wallet's block processing (what refresh does once blocks
+/// are downloaded and parsed), so no daemon is needed; for the same reason transaction creation,
+/// which needs a daemon for decoys and fees, isn't covered.
+///
+/// Not part of the regular test run; enable it with `core_tests --wallet_benchmark`.
+bool run_wallet_benchmark(std::vector<size_t> transfer_counts, size_t subaddresses);
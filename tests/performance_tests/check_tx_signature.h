@@ -177,3 +177,51 @@ private:
   cryptonote::account_base m_alice;
   std::vector<cryptonote::transaction> m_txes;
 };
+
+// Verifies a CLSAG/bulletproof transaction with several inputs, as the daemon does for each
+// incoming transaction.  The inputs all spend the same output: nothing here checks key images, and
+// the verification cost doesn't depend on which ring member is real.
+template<size_t a_ring_size, size_t a_inputs, size_t a_outputs>
+class test_verify_tx : private multi_tx_test_base<a_ring_size>
+{
+  static_assert(0 < a_inputs, "inputs must be greater than 0");
+  static_assert(0 < a_outputs, "outputs must be greater than 0");
+
+public:
+  static const size_t loop_count = a_ring_size * a_inputs <= 20 ? 50 : 10;
+
+  typedef multi_tx_test_base<a_ring_size> base_class;
+
+  bool init()
+  {
+    using namespace cryptonote;
+
+    if (!base_class::init())
+      return false;
+
+    m_alice.generate();
+
+    std::vector<tx_source_entry> sources(a_inputs, this->m_sources.front());
+    std::vector<tx_destination_entry> destinations;
+    destinations.push_back(tx_destination_entry(a_inputs * this->m_source_amount - a_outputs + 1, m_alice.get_keys().m_account_address, false));
+    for (size_t n = 1; n < a_outputs; ++n)
+      destinations.push_back(tx_destination_entry(1, m_alice.get_keys().m_account_address, false));
+
+    crypto::secret_key tx_key;
+    std::vector<crypto::secret_key> additional_tx_keys;
+    std::unordered_map<crypto::public_key, cryptonote::subaddress_index> subaddresses;
+    subaddresses[this->m_miners[this->real_source_idx].get_keys().m_account_address.m_spend_public_key] = {0,0};
+    oxen_construct_tx_params tx_params;
+    tx_params.hf_version = cryptonote::network_version_count - 1;
+    return construct_tx_and_get_tx_key(this->m_miners[this->real_source_idx].get_keys(), subaddresses, sources, destinations, cryptonote::tx_destination_entry{}, std::vector<uint8_t>(), m_tx, 0, tx_key, additional_tx_keys, {rct::RangeProofType::PaddedBulletproof, 2}, nullptr, tx_params);
+  }
+
+  bool test()
+  {
+    return rct::verRctSimple(m_tx.rct_signatures);
+  }
+
+private:
+  cryptonote::account_base m_alice;
+  cryptonote::transaction m_tx;
+};
@@ -46,6 +46,8 @@ enum test_op
   op_addKeys,
   op_scalarmultBase,
   op_scalarmultKey,
+  op_ge_scalarmult,
+  op_ge_scalarmult_x4,
   op_scalarmultH,
   op_scalarmult8,
   op_scalarmult8_p3,
@@ -113,6 +115,14 @@ public:
       case op_addKeys: rct::addKeys(key, point0, point1); break;
       case op_scalarmultBase: rct::scalarmultBase(scalar0); break;
       case op_scalarmultKey: rct::scalarmultKey(point0, scalar0); break;
+      case op_ge_scalarmult: ge_scalarmult(&tmp_p2, scalar0.bytes, &p3_0); break;
+      case op_ge_scalarmult_x4: { // four multiplications per call
+        const unsigned char *scalars[4] = {scalar0.bytes, scalar1.bytes, scalar2.bytes, scalar0.bytes};
+        const ge_p3 points[4] = {p3_0, p3_1, p3_2, p3_0};
+        ge_p2 results[4];
+        ge_scalarmult_x4(results, scalars, points);
+        break;
+      }
       case op_scalarmultH: rct::scalarmultH(scalar0); break;
       case op_scalarmult8: rct::scalarmult8(point0); break;
       case op_scalarmult8_p3: rct::scalarmult8(p3_0,point0); break;
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "crypto/crypto.h"
+#include "cryptonote_basic/cryptonote_basic.h"
+
+#include "single_tx_test_base.h"
+
+// Derives `count` tx pubkeys per iteration, either with one generate_key_derivation call per key
+// (as the wallet did when scanning) or with one batched generate_key_derivations call.
+template<size_t count, bool batched>
+class test_generate_key_derivations : public single_tx_test_base
+{
+public:
+  static const size_t loop_count = 10000 / count;
+
+  bool init()
+  {
+    if (!single_tx_test_base::init())
+      return false;
+    m_keys.resize(count);
+    for (auto &key: m_keys)
+    {
+      crypto::secret_key sec;
+      crypto::generate_keys(key, sec);
+    }
+    m_derivations.resize(count);
+    m_valid.reset(new bool[count]);
+    return true;
+  }
+
+  bool test()
+  {
+    const crypto::secret_key &view_key = m_bob.get_keys().m_view_secret_key;
+    if (batched)
+    {
+      crypto::generate_key_derivations(m_keys.data(), count, view_key, m_derivations.data(), m_valid.get());
+      return true;
+    }
+    for (size_t i = 0; i < count; ++i)
+      if (!crypto::generate_key_derivation(m_keys[i], view_key, m_derivations[i]))
+        return false;
+    return true;
+  }
+
+private:
+  std::vector<crypto::public_key> m_keys;
+  std::vector<crypto::key_derivation> m_derivations;
+  std::unique_ptr<bool[]> m_valid;
+};
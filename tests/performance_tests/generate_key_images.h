@@ -0,0 +1,87 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "crypto/crypto.h"
+#include "ringct/rctOps.h"
+
+// Generates `count` key images per iteration, either with one generate_key_image call per key or
+// with one batched generate_key_images call.
+template<size_t count, bool batched>
+class test_generate_key_images
+{
+public:
+  static const size_t loop_count = 10000 / count;
+
+  bool init()
+  {
+    m_pubs.resize(count);
+    m_secs.resize(count);
+    for (size_t i = 0; i < count; ++i)
+      crypto::generate_keys(m_pubs[i], m_secs[i]);
+    m_images.resize(count);
+    return true;
+  }
+
+  bool test()
+  {
+    if (batched)
+    {
+      crypto::generate_key_images(m_pubs.data(), m_secs.data(), count, m_images.data());
+      return true;
+    }
+    for (size_t i = 0; i < count; ++i)
+      crypto::generate_key_image(m_pubs[i], m_secs[i], m_images[i]);
+    return true;
+  }
+
+private:
+  std::vector<crypto::public_key> m_pubs;
+  std::vector<crypto::secret_key> m_secs;
+  std::vector<crypto::key_image> m_images;
+};
+
+// Checks that `count` key images are in the prime order subgroup per iteration, either with the
+// scalarmultKey by the curve order the daemon and wallet used to do per image, or with one batched
+// check_key_images_domain call.
+template<size_t count, bool batched>
+class test_check_key_images_domain
+{
+public:
+  static const size_t loop_count = 10000 / count;
+
+  bool init()
+  {
+    m_images.resize(count);
+    for (auto &image: m_images)
+    {
+      crypto::public_key pub;
+      crypto::secret_key sec;
+      crypto::generate_keys(pub, sec);
+      crypto::generate_key_image(pub, sec, image);
+    }
+    m_in_domain.reset(new bool[count]);
+    return true;
+  }
+
+  bool test()
+  {
+    if (batched)
+    {
+      crypto::check_key_images_domain(m_images.data(), count, m_in_domain.get());
+      for (size_t i = 0; i < count; ++i)
+        if (!m_in_domain[i])
+          return false;
+      return true;
+    }
+    for (const auto &image: m_images)
+      if (!(rct::scalarmultKey(rct::ki2rct(image), rct::curveOrder()) == rct::identity()))
+        return false;
+    return true;
+  }
+
+private:
+  std::vector<crypto::key_image> m_images;
+  std::unique_ptr<bool[]> m_in_domain;
+};
@@ -44,11 +44,14 @@
 #include "ge_frombytes_vartime.h"
 #include "ge_tobytes.h"
 #include "generate_key_derivation.h"
+#include "generate_key_derivations.h"
 #include "generate_key_image.h"
+#include "generate_key_images.h"
 #include "generate_key_image_helper.h"
 #include "generate_keypair.h"
 #include "signature.h"
 #include "is_out_to_acc.h"
+#include "scan_block.h"
 #include "subaddress_expand.h"
 #include "sc_reduce32.h"
 #include "sc_check.h"
@@ -58,6 +61,7 @@
 #include "crypto_ops.h"
 #include "multiexp.h"
 #include "sig_clsag.h"
+#include "service_node_quorum.h"
 
 namespace po = boost::program_options;
 
@@ -76,11 +80,17 @@ int main(int argc, char** argv)
   const command_line::arg_descriptor<bool> arg_stats = { "stats", "Including statistics (min/median)", false };
   const command_line::arg_descriptor<unsigned> arg_loop_multiplier = { "loop-multiplier", "Run for that many times more loops", 1 };
   const command_line::arg_descriptor<std::string> arg_timings_database = { "timings-database", "Keep timings history in a file" };
+  const command_line::arg_descriptor<std::string> arg_json_output = { "json-output", "Write the results (in seconds) to a JSON file" };
+  const command_line::arg_descriptor<std::string> arg_baseline = { "baseline", "Compare median timings against the latest runs in this timings database, and fail on regressions" };
+  const command_line::arg_descriptor<double> arg_regression_threshold = { "regression-threshold", "Percentage by which a median may exceed the baseline's before it counts as a regression", 10.0 };
   command_line::add_arg(desc_options, arg_filter);
   command_line::add_arg(desc_options, arg_verbose);
   command_line::add_arg(desc_options, arg_stats);
   command_line::add_arg(desc_options, arg_loop_multiplier);
   command_line::add_arg(desc_options, arg_timings_database);
+  command_line::add_arg(desc_options, arg_json_output);
+  command_line::add_arg(desc_options, arg_baseline);
+  command_line::add_arg(desc_options, arg_regression_threshold);
 
   po::variables_map vm;
   bool r = command_line::handle_error_helper(desc_options, [&]()
@@ -94,11 +104,17 @@ int main(int argc, char** argv)
 
   const std::string filter = command_line::get_arg(vm, arg_filter);
   const std::string timings_database = command_line::get_arg(vm, arg_timings_database);
+  const std::string json_output = command_line::get_arg(vm, arg_json_output);
+  const std::string baseline = command_line::get_arg(vm, arg_baseline);
   Params p;
   if (!timings_database.empty())
     p.td = TimingsDatabase(timings_database);
+  if (!baseline.empty())
+    p.baseline = TimingsDatabase(baseline, true);
+  p.regression_threshold = command_line::get_arg(vm, arg_regression_threshold);
   p.verbose = command_line::get_arg(vm, arg_verbose);
-  p.stats = command_line::get_arg(vm, arg_stats);
+  // Percentiles and baseline comparisons need the per call timings
+  p.stats = command_line::get_arg(vm, arg_stats) || !json_output.empty() || !baseline.empty();
   p.loop_multiplier = command_line::get_arg(vm, arg_loop_multiplier);
 
   auto started = std::chrono::steady_clock::now();
@@ -168,6 +184,11 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE5(filter, p, test_check_tx_signature, 2, 10, true, rct::RangeProofType::PaddedBulletproof, 2);
   TEST_PERFORMANCE5(filter, p, test_check_tx_signature, 2, 10, true, rct::RangeProofType::MultiOutputBulletproof, 2);
 
+  // End to end scenarios, with a ring size of 10
+  TEST_PERFORMANCE3(filter, p, test_verify_tx, 10, 2, 2); // verify a 2-in/2-out CLSAG tx
+  TEST_PERFORMANCE5(filter, p, test_construct_tx, 10, 16, true, rct::RangeProofType::PaddedBulletproof, 2); // construct a 16-output tx
+  TEST_PERFORMANCE2(filter, p, test_scan_block, 20, 2); // scan a block of 20 2-output txs for one wallet
+
   TEST_PERFORMANCE3(filter, p, test_check_tx_signature_aggregated_bulletproofs, 2, 2, 64);
   TEST_PERFORMANCE3(filter, p, test_check_tx_signature_aggregated_bulletproofs, 10, 2, 64);
   TEST_PERFORMANCE3(filter, p, test_check_tx_signature_aggregated_bulletproofs, 100, 2, 64);
@@ -182,7 +203,15 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE0(filter, p, test_is_out_to_acc_precomp);
   TEST_PERFORMANCE0(filter, p, test_generate_key_image_helper);
   TEST_PERFORMANCE0(filter, p, test_generate_key_derivation);
+  TEST_PERFORMANCE2(filter, p, test_generate_key_derivations, 16, false);
+  TEST_PERFORMANCE2(filter, p, test_generate_key_derivations, 16, true);
+  TEST_PERFORMANCE2(filter, p, test_generate_key_derivations, 256, false);
+  TEST_PERFORMANCE2(filter, p, test_generate_key_derivations, 256, true);
   TEST_PERFORMANCE0(filter, p, test_generate_key_image);
+  TEST_PERFORMANCE2(filter, p, test_generate_key_images, 16, false);
+  TEST_PERFORMANCE2(filter, p, test_generate_key_images, 16, true);
+  TEST_PERFORMANCE2(filter, p, test_check_key_images_domain, 16, false);
+  TEST_PERFORMANCE2(filter, p, test_check_key_images_domain, 16, true);
   TEST_PERFORMANCE0(filter, p, test_derive_public_key);
   TEST_PERFORMANCE0(filter, p, test_derive_secret_key);
   TEST_PERFORMANCE0(filter, p, test_ge_frombytes_vartime);
@@ -199,6 +228,10 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE1(filter, p, test_cn_fast_hash, 32);
   TEST_PERFORMANCE1(filter, p, test_cn_fast_hash, 16384);
 
+  TEST_PERFORMANCE1(filter, p, test_generate_pulse_quorum, 100);
+  TEST_PERFORMANCE1(filter, p, test_generate_pulse_quorum, 2000);
+  TEST_PERFORMANCE1(filter, p, test_generate_pulse_quorum, 10000);
+
   TEST_PERFORMANCE3(filter, p, test_sig_clsag, 4, 2, 2); // CLSAG verification
   TEST_PERFORMANCE3(filter, p, test_sig_clsag, 8, 2, 2);
   TEST_PERFORMANCE3(filter, p, test_sig_clsag, 16, 2, 2);
@@ -206,6 +239,8 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE3(filter, p, test_sig_clsag, 64, 2, 2);
   TEST_PERFORMANCE3(filter, p, test_sig_clsag, 128, 2, 2);
   TEST_PERFORMANCE3(filter, p, test_sig_clsag, 256, 2, 2);
+  TEST_PERFORMANCE3(filter, p, test_sig_clsag_batch, 16, 2, 16); // CLSAG batch verification (signers must be < N)
+  TEST_PERFORMANCE3(filter, p, test_sig_clsag_batch, 64, 2, 64);
 
   TEST_PERFORMANCE2(filter, p, test_equality, memcmp32, true);
   TEST_PERFORMANCE2(filter, p, test_equality, memcmp32, false);
@@ -240,6 +275,8 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_addKeys);
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_scalarmultBase);
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_scalarmultKey);
+  TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_ge_scalarmult);
+  TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_ge_scalarmult_x4);
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_scalarmultH);
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_scalarmult8);
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_scalarmult8_p3);
@@ -322,6 +359,11 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE3(filter, p, test_multiexp, multiexp_pippenger_cached, 1024, 7);
   TEST_PERFORMANCE3(filter, p, test_multiexp, multiexp_pippenger_cached, 2048, 8);
   TEST_PERFORMANCE3(filter, p, test_multiexp, multiexp_pippenger_cached, 4096, 9);
+  TEST_PERFORMANCE3(filter, p, test_multiexp, multiexp_pippenger_fixed_base, 128, 5);
+  TEST_PERFORMANCE3(filter, p, test_multiexp, multiexp_pippenger_fixed_base, 256, 6);
+  TEST_PERFORMANCE3(filter, p, test_multiexp, multiexp_pippenger_fixed_base, 512, 7);
+  TEST_PERFORMANCE3(filter, p, test_multiexp, multiexp_pippenger_fixed_base, 1024, 7);
+  TEST_PERFORMANCE3(filter, p, test_multiexp, multiexp_pippenger_fixed_base, 2048, 8);
 #else
   TEST_PERFORMANCE3(filter, p, test_multiexp, multiexp_pippenger_cached, 2, 1);
   TEST_PERFORMANCE3(filter, p, test_multiexp, multiexp_pippenger_cached, 2, 2);
@@ -544,6 +586,14 @@ int main(int argc, char** argv)
 
   std::cout << "Tests finished. Elapsed time: " << elapsed_str(std::chrono::steady_clock::now() - started) << std::endl;
 
+  if (!json_output.empty() && !write_json_results(json_output, p.results))
+    return 1;
+  if (p.failures || p.regressions)
+  {
+    std::cout << p.failures << " test(s) failed, " << p.regressions << " regression(s) beyond " << p.regression_threshold << "% of the baseline" << std::endl;
+    return 1;
+  }
+
   return 0;
   CATCH_ENTRY_L0("main", 1);
 }
@@ -41,6 +41,7 @@ enum test_multiexp_algorithm
   multiexp_straus_cached,
   multiexp_pippenger,
   multiexp_pippenger_cached,
+  multiexp_pippenger_fixed_base,
 };
 
 template<test_multiexp_algorithm algorithm, size_t npoints, size_t c=0>
@@ -64,6 +65,8 @@ public:
     }
     straus_cache = rct::straus_init_cache(data);
     pippenger_cache = rct::pippenger_init_cache(data);
+    // like the bulletproof generators: all but the last few points are fixed
+    pippenger_fixed_base_cache = rct::pippenger_init_fixed_base_cache(data, npoints - npoints / 16);
     return true;
   }
 
@@ -81,6 +84,8 @@ public:
         return res == pippenger(data, NULL, 0, c);
       case multiexp_pippenger_cached:
         return res == pippenger(data, pippenger_cache, 0, c);
+      case multiexp_pippenger_fixed_base:
+        return res == pippenger(data, pippenger_fixed_base_cache, 0, c);
       default:
         return false;
     }
@@ -90,5 +95,6 @@ private:
   std::vector<rct::MultiexpData> data;
   std::shared_ptr<rct::straus_cached_data> straus_cache;
   std::shared_ptr<rct::pippenger_cached_data> pippenger_cache;
+  std::shared_ptr<rct::pippenger_cached_data> pippenger_fixed_base_cache;
   rct::key res;
 };
@@ -35,18 +35,36 @@
 #include <cstdint>
 #include <regex>
 #include <chrono>
+#include <fstream>
+#include <optional>
 
 #include "epee/misc_language.h"
+#include "epee/misc_log_ex.h"
 #include "epee/stats.h"
 #include "common/perf_timer.h"
 #include "timings.h"
 
+struct Result
+{
+  std::string name;
+  size_t calls;
+  double time_per_call;
+  double min, max, mean, median, stddev;
+  double p90, p99;
+  std::optional<double> baseline_median; // set when the baseline has a run of this test
+};
+
 struct Params
 {
   TimingsDatabase td;
+  TimingsDatabase baseline;
+  double regression_threshold; // percent by which the median may exceed the baseline's
   bool verbose;
   bool stats;
   unsigned loop_multiplier;
+  std::vector<Result> results;
+  size_t failures = 0;
+  size_t regressions = 0;
 };
 
 using namespace std::literals;
@@ -181,6 +199,7 @@ void run_test(const std::string &filter, Params &params, const char* test_name)
       std::cout << test_name << " (" << T::loop_count * params.loop_multiplier << " calls) - OK:";
     }
     const auto quantiles = runner.get_quantiles(10);
+    const auto percentiles = runner.get_quantiles(100);
     double min = runner.get_min();
     double max = runner.get_max();
     double med = runner.get_median();
@@ -205,15 +224,58 @@ void run_test(const std::string &filter, Params &params, const char* test_name)
         }
         cmp += "  -- " + std::to_string(prev_instance.mean);
       }
-      std::cout << " (min " << elapsed_str(min) << ", 90th " << elapsed_str(quantiles[9]) <<
-        ", median " << elapsed_str(med) << ", std dev " << elapsed_str(stddev) << ")" << cmp;
+      std::cout << " (min " << elapsed_str(min) << ", median " << elapsed_str(med) <<
+        ", 90th " << elapsed_str(percentiles[90]) << ", 99th " << elapsed_str(percentiles[99]) <<
+        ", std dev " << elapsed_str(stddev) << ")" << cmp;
+    }
+
+    Result result{test_name, runner.get_size(), runner.time_per_call().count(), min, max, mean, med, stddev, percentiles[90], percentiles[99]};
+    if (std::vector<TimingsDatabase::instance> base = params.baseline.get(test_name); !base.empty())
+    {
+      result.baseline_median = base.back().median;
+      double pc = 100. * (med - *result.baseline_median) / *result.baseline_median;
+      if (pc > params.regression_threshold)
+      {
+        std::ostringstream msg;
+        msg << " -- REGRESSION: median " << std::fixed << std::setprecision(1) << pc << "% slower than baseline " << elapsed_str(*result.baseline_median);
+        std::cout << msg.str();
+        ++params.regressions;
+      }
     }
+    params.results.push_back(std::move(result));
     std::cout << std::endl;
   }
   else
   {
     std::cout << test_name << " - FAILED" << std::endl;
+    ++params.failures;
+  }
+}
+
+/// Writes the results of the tests that ran as a JSON array, with all times in seconds.
+bool write_json_results(const std::string &filename, const std::vector<Result> &results)
+{
+  std::ofstream out{filename};
+  if (!out)
+  {
+    MERROR("Failed to write to file " << filename);
+    return false;
+  }
+  out << std::setprecision(9) << "[";
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    const Result &r = results[i];
+    // Test names are C++ type names, so there is nothing in them that needs escaping
+    out << (i ? ",\n" : "\n") << "  {\"name\": \"" << r.name << "\", \"calls\": " << r.calls <<
+      ", \"time_per_call\": " << r.time_per_call << ", \"min\": " << r.min << ", \"median\": " << r.median <<
+      ", \"p90\": " << r.p90 << ", \"p99\": " << r.p99 << ", \"max\": " << r.max <<
+      ", \"mean\": " << r.mean << ", \"stddev\": " << r.stddev;
+    if (r.baseline_median)
+      out << ", \"baseline_median\": " << *r.baseline_median;
+    out << "}";
   }
+  out << "\n]\n";
+  return bool(out);
 }
 
 #define QUOTEME(x) #x
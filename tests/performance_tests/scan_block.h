@@ -0,0 +1,115 @@
+// Copyright (c) 2014-2018, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <vector>
+
+#include "cryptonote_basic/account.h"
+#include "cryptonote_basic/cryptonote_basic.h"
+#include "cryptonote_core/cryptonote_tx_utils.h"
+#include "device/device.hpp"
+
+#include "multi_tx_test_base.h"
+
+// Scans a block's worth of transactions for one wallet, the way the wallet's refresh does: one key
+// derivation per transaction, then a subaddress lookup per output.  Only the first transaction pays
+// the wallet.
+template<size_t a_tx_count, size_t a_outputs>
+class test_scan_block : private multi_tx_test_base<10>
+{
+  static_assert(0 < a_tx_count, "tx_count must be greater than 0");
+  static_assert(0 < a_outputs, "outputs must be greater than 0");
+
+public:
+  static const size_t loop_count = 50;
+
+  typedef multi_tx_test_base<10> base_class;
+
+  bool init()
+  {
+    using namespace cryptonote;
+
+    if (!base_class::init())
+      return false;
+
+    m_wallet.generate();
+    m_subaddresses[m_wallet.get_keys().m_account_address.m_spend_public_key] = {0,0};
+
+    cryptonote::account_base other;
+    other.generate();
+
+    std::unordered_map<crypto::public_key, cryptonote::subaddress_index> sender_subaddresses;
+    sender_subaddresses[this->m_miners[this->real_source_idx].get_keys().m_account_address.m_spend_public_key] = {0,0};
+    oxen_construct_tx_params tx_params;
+    tx_params.hf_version = cryptonote::network_version_count - 1;
+
+    m_txes.resize(a_tx_count);
+    for (size_t t = 0; t < a_tx_count; ++t)
+    {
+      const account_public_address &to = (t == 0 ? m_wallet : other).get_keys().m_account_address;
+      std::vector<tx_destination_entry> destinations;
+      destinations.push_back(tx_destination_entry(this->m_source_amount - a_outputs + 1, to, false));
+      for (size_t n = 1; n < a_outputs; ++n)
+        destinations.push_back(tx_destination_entry(1, to, false));
+
+      crypto::secret_key tx_key;
+      std::vector<crypto::secret_key> additional_tx_keys;
+      if (!construct_tx_and_get_tx_key(this->m_miners[this->real_source_idx].get_keys(), sender_subaddresses, this->m_sources, destinations, cryptonote::tx_destination_entry{}, std::vector<uint8_t>(), m_txes[t], 0, tx_key, additional_tx_keys, {rct::RangeProofType::PaddedBulletproof, 2}, nullptr, tx_params))
+        return false;
+    }
+
+    return true;
+  }
+
+  bool test()
+  {
+    hw::device &hwdev = hw::get_device("default");
+    const crypto::secret_key &view_key = m_wallet.get_keys().m_view_secret_key;
+    const std::vector<crypto::key_derivation> additional_derivations;
+    size_t found = 0;
+    for (const cryptonote::transaction &tx : m_txes)
+    {
+      crypto::key_derivation derivation;
+      if (!crypto::generate_key_derivation(cryptonote::get_tx_pub_key_from_extra(tx), view_key, derivation))
+        return false;
+      for (size_t i = 0; i < tx.vout.size(); ++i)
+      {
+        const auto &out = var::get<cryptonote::txout_to_key>(tx.vout[i].target);
+        if (cryptonote::is_out_to_acc_precomp(m_subaddresses, out.key, derivation, additional_derivations, i, hwdev))
+          ++found;
+      }
+    }
+    return found == a_outputs;
+  }
+
+private:
+  cryptonote::account_base m_wallet;
+  std::unordered_map<crypto::public_key, cryptonote::subaddress_index> m_subaddresses;
+  std::vector<cryptonote::transaction> m_txes;
+};
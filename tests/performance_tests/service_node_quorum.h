@@ -0,0 +1,47 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "crypto/crypto.h"
+#include "cryptonote_core/service_node_list.h"
+
+// Pulse quorum selection from a network of `num_nodes` active service nodes, as done for every
+// block by service_node_list::state_t::update_from_block.
+template <size_t num_nodes>
+class test_generate_pulse_quorum
+{
+public:
+  static const size_t loop_count = num_nodes < 1000 ? 1000 : 100;
+
+  bool init()
+  {
+    m_nodes.reserve(num_nodes);
+    for (size_t i = 0; i < num_nodes; i++)
+    {
+      auto info = std::make_shared<service_nodes::service_node_info>();
+      info->pulse_sorter.last_height_validating_in_quorum = crypto::rand<uint16_t>();
+      m_nodes.emplace_back(crypto::rand<crypto::public_key>(), std::move(info));
+    }
+    std::sort(m_nodes.begin(), m_nodes.end(), [](const auto &a, const auto &b) {
+      return std::memcmp(a.first.data, b.first.data, sizeof(a.first.data)) < 0;
+    });
+
+    m_entropy.resize(service_nodes::PULSE_QUORUM_SIZE);
+    for (auto &hash : m_entropy)
+      hash = crypto::rand<crypto::hash>();
+    return true;
+  }
+
+  bool test()
+  {
+    auto quorum = service_nodes::generate_pulse_quorum(
+        cryptonote::MAINNET, m_nodes[0].first, cryptonote::network_version_16_pulse, m_nodes, m_entropy, 1 /*pulse_round*/);
+    return quorum.validators.size() == service_nodes::PULSE_QUORUM_NUM_VALIDATORS;
+  }
+
+private:
+  std::vector<service_nodes::pubkey_and_sninfo> m_nodes;
+  std::vector<crypto::hash> m_entropy;
+};
@@ -157,7 +157,7 @@ class test_sig_clsag
             return true;
         }
 
-    private:
+    protected:
         ctkeyV pubs;
         keyV Q;
         keyV r;
@@ -170,3 +170,20 @@ class test_sig_clsag
         keyV messages;
         std::vector<clsag> sigs;
 };
+
+// Verifies the same signatures with the batch verifier, all in one threadpool round
+template<size_t a_N, size_t a_T, size_t a_w>
+class test_sig_clsag_batch : public test_sig_clsag<a_N, a_T, a_w>
+{
+    public:
+        static const size_t loop_count = 100;
+
+        bool test()
+        {
+            std::vector<clsag_check> checks;
+            checks.reserve(a_w);
+            for (size_t u = 0; u < a_w; u++)
+                checks.push_back({this->messages[u], &this->sigs[u], &this->pubs, this->C_offsets[u]});
+            return verRctCLSAGSimple(checks).empty();
+        }
+};
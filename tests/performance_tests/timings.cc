@@ -12,8 +12,8 @@ TimingsDatabase::TimingsDatabase()
 {
 }
 
-TimingsDatabase::TimingsDatabase(const std::string &filename):
-  filename(filename)
+TimingsDatabase::TimingsDatabase(const std::string &filename, bool read_only):
+  filename(filename), read_only(read_only)
 {
   load();
 }
@@ -75,7 +75,7 @@ bool TimingsDatabase::load()
     i.deciles.reserve(11);
     for (int n = 0; n < 11; ++n)
     {
-      i.deciles.push_back(atoi(fields[idx++].c_str()));
+      i.deciles.push_back(atof(fields[idx++].c_str()));
     }
     instances.insert(std::make_pair(name, i));
   }
@@ -85,7 +85,7 @@ bool TimingsDatabase::load()
 
 bool TimingsDatabase::save()
 {
-  if (filename.empty())
+  if (filename.empty() || read_only)
     return true;
 
   FILE *f = fopen(filename.c_str(), "w");
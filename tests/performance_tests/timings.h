@@ -18,7 +18,7 @@ public:
 
 public:
   TimingsDatabase();
-  TimingsDatabase(const std::string &filename);
+  TimingsDatabase(const std::string &filename, bool read_only = false);
   ~TimingsDatabase();
 
   std::vector<instance> get(const char *name) const;
@@ -30,5 +30,6 @@ private:
 
 private:
   std::string filename;
+  bool read_only = false;
   std::multimap<std::string, instance> instances;
 };
@@ -0,0 +1,467 @@
+// RPC load generator: sends a weighted mix of daemon (and optionally wallet) RPC calls at a target
+// rate over many connections, over HTTP or OxenMQ, and reports throughput and latency percentiles
+// per command.
+//
+// With --qps the load is open-loop: requests are due at fixed intervals whether or not earlier
+// ones have been answered, and latency is measured from when a request was due rather than when
+// it was sent, so a server that falls behind shows up as latency instead of silently lowering the
+// request rate.  Without --qps every connection sends its next request as soon as the previous
+// one is answered.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/program_options.hpp>
+#include <oxenmq/oxenmq.h>
+#include <oxenmq/hex.h>
+
+#include "common/command_line.h"
+#include "common/hex.h"
+#include "common/string_util.h"
+#include "epee/misc_log_ex.h"
+#include "epee/storages/portable_storage_template_helper.h"
+#include "rpc/core_rpc_server_commands_defs.h"
+#include "rpc/http_client.h"
+
+namespace po = boost::program_options;
+using namespace std::literals;
+using namespace cryptonote::rpc;
+using clock_type = std::chrono::steady_clock;
+
+namespace {
+
+const command_line::arg_descriptor<std::string> arg_daemon_url{"daemon-url", "Daemon HTTP RPC URL; also used to look up the chain for the synthetic mix", "http://127.0.0.1:22023"};
+const command_line::arg_descriptor<std::string> arg_daemon_login{"daemon-login", "Daemon RPC credentials, as <user>:<password>", ""};
+const command_line::arg_descriptor<std::string> arg_omq{"omq", "Send daemon calls over OxenMQ to this address (e.g. tcp://127.0.0.1:22029) instead of HTTP", ""};
+const command_line::arg_descriptor<std::string> arg_wallet_url{"wallet-url", "Wallet RPC URL; adds wallet calls to the synthetic mix", ""};
+const command_line::arg_descriptor<std::string> arg_wallet_login{"wallet-login", "Wallet RPC credentials, as <user>:<password>", ""};
+const command_line::arg_descriptor<std::string> arg_mix{"mix", "Replay the calls in this file instead of the synthetic mix; each line is "
+  "`<weight> <method> [<json params>]` where <method> is a daemon JSON-RPC method, /<endpoint> for a plain JSON endpoint, "
+  "or wallet:<method> for a wallet JSON-RPC method", ""};
+const command_line::arg_descriptor<double> arg_qps{"qps", "Target requests per second over all connections (0 = as fast as responses come back)", 0};
+const command_line::arg_descriptor<unsigned> arg_connections{"connections", "Number of concurrent connections", 8};
+const command_line::arg_descriptor<unsigned> arg_duration{"duration", "Seconds to run for", 30};
+const command_line::arg_descriptor<uint64_t> arg_seed{"seed", "Seed for choosing calls and their parameters", 1};
+
+// One kind of call in the request mix
+struct call_type
+{
+  std::string name;     // name in the report
+  double weight;
+  std::string method;   // JSON-RPC method, or endpoint name
+  bool json_rpc = true; // a JSON-RPC method (POST /json_rpc) rather than an endpoint of its own
+  bool binary = false;  // an endpoint taking an epee binary body instead of JSON
+  bool wallet = false;  // sent to the wallet RPC rather than the daemon
+  std::function<std::string(std::mt19937_64&)> body; // the JSON params, or the binary body
+};
+
+struct call_stats
+{
+  std::vector<uint32_t> latency_us;
+  uint64_t errors = 0;
+
+  void merge(call_stats&& o)
+  {
+    latency_us.insert(latency_us.end(), o.latency_us.begin(), o.latency_us.end());
+    errors += o.errors;
+  }
+};
+
+struct options
+{
+  std::string daemon_url, daemon_login, omq, wallet_url, wallet_login;
+  double qps;
+  unsigned connections;
+  clock_type::duration duration;
+  uint64_t seed;
+};
+
+void set_login(http_client& c, std::string_view login)
+{
+  if (login.empty())
+    return;
+  auto colon = login.find(':');
+  c.set_auth(login.substr(0, colon), colon == std::string_view::npos ? ""sv : login.substr(colon + 1));
+}
+
+std::string random_hex(std::mt19937_64& rng, size_t bytes)
+{
+  std::string raw(bytes, '\0');
+  for (auto& c : raw)
+    c = static_cast<char>(rng());
+  return oxenmq::to_hex(raw);
+}
+
+std::vector<call_type> synthetic_mix(http_client& daemon, bool with_wallet)
+{
+  const uint64_t height = daemon.json_rpc<GET_INFO>("get_info", {}).height;
+  GET_BLOCK_HEADER_BY_HEIGHT::request hreq{};
+  hreq.height = 0;
+  auto genesis_header = daemon.json_rpc<GET_BLOCK_HEADER_BY_HEIGHT>("get_block_header_by_height", hreq).block_header;
+  crypto::hash genesis;
+  if (!genesis_header || !tools::hex_to_type(genesis_header->hash, genesis))
+    throw std::runtime_error{"Unable to get the genesis block hash from the daemon"};
+  std::cout << "Daemon is at height " << height << "\n";
+
+  auto random_height = [height](std::mt19937_64& rng, uint64_t within = 0) {
+    const uint64_t lowest = within && height > within ? height - within : 0;
+    return std::uniform_int_distribution<uint64_t>{lowest, height ? height - 1 : 0}(rng);
+  };
+
+  std::vector<call_type> mix;
+  mix.push_back({"get_info", 20, "get_info", true, false, false, [](auto&) { return "{}"s; }});
+  mix.push_back({"get_blocks_fast", 10, "get_blocks.bin", false, true, false, [=](auto& rng) {
+    GET_BLOCKS_FAST::request req{};
+    req.block_ids.push_back(genesis);
+    req.start_height = random_height(rng);
+    req.prune = true;
+    return epee::serialization::store_t_to_binary(req);
+  }});
+  mix.push_back({"get_outs", 10, "get_outs", false, false, false, [=](auto& rng) {
+    // Like a wallet picking decoys: a handful of random RingCT outputs
+    std::string outputs;
+    for (int i = 0; i < 10; i++)
+      outputs += (i ? ","s : ""s) + R"({"amount":0,"index":)" + std::to_string(random_height(rng)) + "}";
+    return R"({"outputs":[)" + outputs + "]}";
+  }});
+  mix.push_back({"get_output_distribution", 5, "get_output_distribution", true, false, false, [=](auto& rng) {
+    return R"({"amounts":[0],"cumulative":true,"from_height":)" + std::to_string(random_height(rng, 1000)) + "}";
+  }});
+  mix.push_back({"get_service_nodes", 5, "get_service_nodes", true, false, false, [](auto&) { return "{}"s; }});
+  mix.push_back({"ons_resolve", 10, "ons_resolve", true, false, false, [](auto& rng) {
+    return R"({"type":0,"name_hash":")" + random_hex(rng, 32) + "\"}";
+  }});
+  if (with_wallet)
+  {
+    mix.push_back({"wallet:get_balance", 5, "get_balance", true, false, true, [](auto&) { return R"({"account_index":0})"s; }});
+    mix.push_back({"wallet:get_height", 5, "get_height", true, false, true, [](auto&) { return "{}"s; }});
+    mix.push_back({"wallet:get_transfers", 2, "get_transfers", true, false, true, [](auto&) { return R"({"in":true,"out":true})"s; }});
+  }
+  return mix;
+}
+
+std::vector<call_type> load_mix(const std::string& path)
+{
+  std::ifstream in{path};
+  if (!in)
+    throw std::runtime_error{"Unable to open mix file " + path};
+  std::vector<call_type> mix;
+  std::string line;
+  for (int lineno = 1; std::getline(in, line); lineno++)
+  {
+    std::string_view l{line};
+    tools::trim(l);
+    if (l.empty() || l[0] == '#')
+      continue;
+    auto sp = l.find(' ');
+    const std::string weight_str{l.substr(0, sp)};
+    char* weight_end;
+    const double weight = std::strtod(weight_str.c_str(), &weight_end);
+    if (sp == std::string_view::npos || *weight_end || !(weight > 0))
+      throw std::runtime_error{path + ":" + std::to_string(lineno) + ": expected `<weight> <method> [<params>]`"};
+    l.remove_prefix(sp + 1);
+    tools::trim(l);
+    sp = l.find(' ');
+    std::string name{l.substr(0, sp)};
+    std::string_view params = sp == std::string_view::npos ? "{}"sv : l.substr(sp + 1);
+    tools::trim(params);
+
+    call_type c{name, weight, name, true, false, false, [params = std::string{params}](auto&) { return params; }};
+    if (tools::starts_with(name, "wallet:"))
+    {
+      c.wallet = true;
+      c.method = name.substr(7);
+    }
+    else if (tools::starts_with(name, "/"))
+    {
+      c.json_rpc = false;
+      c.method = name.substr(1);
+    }
+    mix.push_back(std::move(c));
+  }
+  if (mix.empty())
+    throw std::runtime_error{"Mix file " + path + " has no calls"};
+  return mix;
+}
+
+std::discrete_distribution<size_t> call_chooser(const std::vector<call_type>& mix)
+{
+  std::vector<double> weights;
+  for (auto& c : mix)
+    weights.push_back(c.weight);
+  return {weights.begin(), weights.end()};
+}
+
+// Requests are due every `interval` from `start`; the n-th due time is handed out to whichever
+// connection asks next.
+struct schedule
+{
+  clock_type::time_point start, end;
+  clock_type::duration interval;
+  std::atomic<uint64_t> next{0};
+
+  // The time the next request is due, or nullopt once the run is over
+  std::optional<clock_type::time_point> next_due()
+  {
+    auto due = interval.count() ? start + static_cast<int64_t>(next++) * interval : clock_type::now();
+    if (due >= end)
+      return std::nullopt;
+    return due;
+  }
+};
+
+uint32_t micros_since(clock_type::time_point t)
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(clock_type::now() - t).count();
+}
+
+void run_http(const std::vector<call_type>& mix, const options& opt, schedule& sched, std::vector<call_stats>& stats)
+{
+  std::mutex stats_mutex;
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < opt.connections; t++)
+  {
+    threads.emplace_back([&, t] {
+      http_client daemon{opt.daemon_url}, wallet;
+      set_login(daemon, opt.daemon_login);
+      if (!opt.wallet_url.empty())
+      {
+        wallet.set_base_url(opt.wallet_url);
+        set_login(wallet, opt.wallet_login);
+      }
+      std::mt19937_64 rng{opt.seed + t};
+      auto choose = call_chooser(mix);
+      std::vector<call_stats> local(mix.size());
+
+      while (auto due = sched.next_due())
+      {
+        std::this_thread::sleep_until(*due);
+        const size_t i = choose(rng);
+        auto& call = mix[i];
+        std::string body = call.body(rng);
+        if (call.json_rpc)
+          body = R"({"jsonrpc":"2.0","id":"0","method":")" + call.method + R"(","params":)" + body + "}";
+        bool ok = false;
+        try
+        {
+          auto res = (call.wallet ? wallet : daemon).post(call.json_rpc ? "json_rpc"s : call.method, cpr::Body{std::move(body)},
+              {{"Content-Type", call.binary ? "application/octet-stream" : "application/json"}});
+          ok = res.status_code == 200 && !(call.json_rpc && res.text.find(R"("error":)") != std::string::npos);
+        }
+        catch (const std::exception& e)
+        {
+          MDEBUG(call.name << " failed: " << e.what());
+        }
+        if (ok)
+          local[i].latency_us.push_back(micros_since(*due));
+        else
+          local[i].errors++;
+      }
+
+      std::lock_guard lock{stats_mutex};
+      for (size_t i = 0; i < mix.size(); i++)
+        stats[i].merge(std::move(local[i]));
+    });
+  }
+  for (auto& t : threads)
+    t.join();
+}
+
+void run_omq(const std::vector<call_type>& mix, const options& opt, schedule& sched, std::vector<call_stats>& stats)
+{
+  std::mutex mutex; // protects rng, choose and stats, which reply callbacks also use
+  std::mt19937_64 rng{opt.seed};
+  auto choose = call_chooser(mix);
+  std::atomic<uint64_t> in_flight{0};
+  std::vector<oxenmq::ConnectionID> conns;
+
+  // Declared last so that it is destroyed (joining its threads, and so any late reply callbacks)
+  // before the state above
+  oxenmq::OxenMQ omq;
+  omq.start();
+
+  for (unsigned i = 0; i < opt.connections; i++)
+  {
+    std::promise<std::string> connected;
+    auto c = omq.connect_remote(oxenmq::address{opt.omq},
+        [&](oxenmq::ConnectionID) { connected.set_value(""); },
+        [&](oxenmq::ConnectionID, std::string_view err) { connected.set_value(err.empty() ? "connection failed"s : std::string{err}); });
+    if (auto err = connected.get_future().get(); !err.empty())
+      throw std::runtime_error{"Unable to connect to " + opt.omq + ": " + err};
+    conns.push_back(std::move(c));
+  }
+
+  // Sends one request on connection `conn`; in closed-loop mode its reply sends the next one
+  std::function<void(size_t, clock_type::time_point)> send = [&](size_t conn, clock_type::time_point due) {
+    size_t i;
+    std::string body;
+    {
+      std::lock_guard lock{mutex};
+      i = choose(rng);
+      body = mix[i].body(rng);
+    }
+    in_flight++;
+    omq.request(conns[conn], "rpc." + mix[i].method,
+        [&, conn, i, due](bool success, std::vector<std::string> data) {
+          {
+            std::lock_guard lock{mutex};
+            // A successful reply is ["200", response]
+            if (success && !data.empty() && data[0] == "200")
+              stats[i].latency_us.push_back(micros_since(due));
+            else
+              stats[i].errors++;
+          }
+          if (!sched.interval.count())
+            if (auto next = sched.next_due())
+              send(conn, *next);
+          in_flight--;
+        },
+        std::string_view{body}, oxenmq::send_option::request_timeout{15s});
+  };
+
+  if (sched.interval.count())
+  {
+    for (uint64_t n = 0; auto due = sched.next_due(); n++)
+    {
+      std::this_thread::sleep_until(*due);
+      send(n % conns.size(), *due);
+    }
+  }
+  else
+  {
+    for (size_t c = 0; c < conns.size(); c++)
+      if (auto due = sched.next_due())
+        send(c, *due);
+    std::this_thread::sleep_until(sched.end);
+  }
+
+  // Wait for the stragglers (up to the request timeout)
+  for (auto until = clock_type::now() + 16s; in_flight && clock_type::now() < until; )
+    std::this_thread::sleep_for(10ms);
+}
+
+void print_report(const std::vector<call_type>& mix, std::vector<call_stats>& stats, double seconds)
+{
+  auto ms = [](uint32_t us) { return us / 1000.0; };
+  auto row = [&](const std::string& name, std::vector<uint32_t>& lat, uint64_t errors) {
+    std::sort(lat.begin(), lat.end());
+    auto pct = [&](double p) { return lat.empty() ? 0 : ms(lat[std::min(lat.size() - 1, static_cast<size_t>(p * lat.size()))]); };
+    std::cout << std::left << std::setw(26) << name << std::right
+      << std::setw(10) << lat.size() << std::setw(8) << errors
+      << std::setw(10) << lat.size() / seconds
+      << std::setw(10) << pct(0.5) << std::setw(10) << pct(0.99) << std::setw(10) << pct(0.999)
+      << std::setw(10) << (lat.empty() ? 0 : ms(lat.back())) << '\n';
+  };
+
+  std::cout << std::fixed << std::setprecision(1) << "\n"
+    << std::left << std::setw(26) << "command" << std::right << std::setw(10) << "ok" << std::setw(8) << "errors"
+    << std::setw(10) << "req/s" << std::setw(10) << "p50 ms" << std::setw(10) << "p99 ms" << std::setw(10) << "p99.9 ms"
+    << std::setw(10) << "max ms" << '\n';
+  std::vector<uint32_t> all;
+  uint64_t all_errors = 0;
+  for (size_t i = 0; i < mix.size(); i++)
+  {
+    if (stats[i].latency_us.empty() && !stats[i].errors)
+      continue;
+    all.insert(all.end(), stats[i].latency_us.begin(), stats[i].latency_us.end());
+    all_errors += stats[i].errors;
+    row(mix[i].name, stats[i].latency_us, stats[i].errors);
+  }
+  row("total", all, all_errors);
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  TRY_ENTRY();
+
+  po::options_description desc("Options");
+  command_line::add_arg(desc, command_line::arg_help);
+  for (auto* arg : {&arg_daemon_url, &arg_daemon_login, &arg_omq, &arg_wallet_url, &arg_wallet_login, &arg_mix})
+    command_line::add_arg(desc, *arg);
+  command_line::add_arg(desc, arg_qps);
+  command_line::add_arg(desc, arg_connections);
+  command_line::add_arg(desc, arg_duration);
+  command_line::add_arg(desc, arg_seed);
+
+  po::variables_map vm;
+  if (!command_line::handle_error_helper(desc, [&] {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+        return true;
+      }))
+    return 1;
+  if (command_line::get_arg(vm, command_line::arg_help))
+  {
+    std::cout << desc << std::endl;
+    return 0;
+  }
+
+  mlog_configure(mlog_get_default_log_path("rpc_load_tests.log"), true);
+  mlog_set_log_level(0);
+
+  options opt{
+    command_line::get_arg(vm, arg_daemon_url), command_line::get_arg(vm, arg_daemon_login), command_line::get_arg(vm, arg_omq),
+    command_line::get_arg(vm, arg_wallet_url), command_line::get_arg(vm, arg_wallet_login),
+    command_line::get_arg(vm, arg_qps), std::max(command_line::get_arg(vm, arg_connections), 1u),
+    std::chrono::seconds{command_line::get_arg(vm, arg_duration)}, command_line::get_arg(vm, arg_seed)};
+
+  std::vector<call_type> mix;
+  if (auto path = command_line::get_arg(vm, arg_mix); !path.empty())
+    mix = load_mix(path);
+  else
+  {
+    http_client daemon{opt.daemon_url};
+    set_login(daemon, opt.daemon_login);
+    mix = synthetic_mix(daemon, !opt.wallet_url.empty());
+  }
+  if (!opt.omq.empty())
+  {
+    // The wallet RPC server only speaks HTTP
+    if (std::any_of(mix.begin(), mix.end(), [](auto& c) { return c.wallet; }))
+      std::cout << "Note: wallet calls are skipped when sending over OxenMQ\n";
+    mix.erase(std::remove_if(mix.begin(), mix.end(), [](auto& c) { return c.wallet; }), mix.end());
+  }
+  else if (opt.wallet_url.empty() && std::any_of(mix.begin(), mix.end(), [](auto& c) { return c.wallet; }))
+  {
+    std::cerr << "The mix has wallet calls but no --" << arg_wallet_url.name << " was given\n";
+    return 1;
+  }
+  if (mix.empty())
+  {
+    std::cerr << "Nothing to send\n";
+    return 1;
+  }
+
+  schedule sched;
+  sched.interval = opt.qps > 0 ? std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>{1 / opt.qps}) : clock_type::duration{0};
+  sched.start = clock_type::now();
+  sched.end = sched.start + opt.duration;
+
+  std::cout << "Sending to " << (opt.omq.empty() ? opt.daemon_url : opt.omq) << " over " << opt.connections << " connections for "
+    << command_line::get_arg(vm, arg_duration) << "s at " << (opt.qps > 0 ? std::to_string(opt.qps) + " req/s" : "full speed"s) << "..." << std::endl;
+
+  std::vector<call_stats> stats(mix.size());
+  if (opt.omq.empty())
+    run_http(mix, opt, sched, stats);
+  else
+    run_omq(mix, opt, sched, stats);
+
+  print_report(mix, stats, std::chrono::duration<double>{clock_type::now() - sched.start}.count());
+  return 0;
+
+  CATCH_ENTRY("RPC load test error", 1);
+}
@@ -32,6 +32,8 @@
 #include "cryptonote_protocol/cryptonote_protocol_defs.h"
 #include "cryptonote_protocol/block_queue.h"
 
+using namespace std::literals;
+
 static const boost::uuids::uuid &uuid1()
 {
   static const boost::uuids::uuid uuid = crypto::rand<boost::uuids::uuid>();
@@ -85,3 +87,50 @@ TEST(block_queue, flush_uuid)
   bq.add_blocks(0, 200, uuid1(), std::chrono::steady_clock::now());
   ASSERT_EQ(bq.get_max_block_height(), 399);
 }
+
+TEST(block_queue, get_filled_span_at)
+{
+  cryptonote::block_queue bq;
+  std::vector<cryptonote::block_complete_entry> bcel;
+  boost::uuids::uuid connection_id;
+
+  bq.add_blocks(0, 10, uuid1(), std::chrono::steady_clock::now());
+  ASSERT_FALSE(bq.get_filled_span_at(0, bcel, connection_id)); // scheduled, not yet filled
+
+  bq.add_blocks(10, std::vector<cryptonote::block_complete_entry>(5), uuid2(), 1.0f, 100);
+  ASSERT_FALSE(bq.get_filled_span_at(11, bcel, connection_id));
+  ASSERT_TRUE(bq.get_filled_span_at(10, bcel, connection_id));
+  ASSERT_EQ(bcel.size(), 5);
+  ASSERT_EQ(connection_id, uuid2());
+}
+
+TEST(block_queue, span_size)
+{
+  cryptonote::block_queue bq;
+  ASSERT_EQ(bq.get_span_size(uuid1(), 100), 100); // nothing measured yet
+
+  bq.add_blocks(0, std::vector<cryptonote::block_complete_entry>(10), uuid1(), 5000.0f, 10000);
+  bq.add_blocks(10, std::vector<cryptonote::block_complete_entry>(10), uuid2(), 10000.0f, 10000);
+  ASSERT_EQ(bq.get_span_size(uuid2(), 100), 100);
+  ASSERT_EQ(bq.get_span_size(uuid1(), 100), 50);
+
+  bq.flush_spans(uuid1(), true);
+  bq.add_blocks(0, std::vector<cryptonote::block_complete_entry>(10), uuid1(), 10.0f, 10000);
+  ASSERT_EQ(bq.get_span_size(uuid1(), 100), 12); // clamped to the minimum span size
+  ASSERT_EQ(bq.get_span_size(uuid1(), 4), 1);
+}
+
+TEST(block_queue, next_span_late)
+{
+  cryptonote::block_queue bq;
+  const auto now = std::chrono::steady_clock::now();
+
+  // uuid1 holds the next span, and sends 10 blocks of 1000 bytes in 10s; uuid2 is 10 times faster
+  bq.add_blocks(0, 10, uuid1(), now - 20s);
+  bq.add_blocks(10, std::vector<cryptonote::block_complete_entry>(10), uuid1(), 1000.0f, 10000);
+  ASSERT_FALSE(bq.is_next_span_late(0, uuid2(), now)); // uuid2 has no measured rate yet
+  bq.add_blocks(20, std::vector<cryptonote::block_complete_entry>(10), uuid2(), 10000.0f, 10000);
+  ASSERT_FALSE(bq.is_next_span_late(0, uuid2(), now));
+  ASSERT_TRUE(bq.is_next_span_late(0, uuid2(), now + 15s));
+  ASSERT_FALSE(bq.is_next_span_late(0, uuid1(), now + 15s));
+}
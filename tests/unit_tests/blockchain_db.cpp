@@ -335,4 +335,90 @@ TYPED_TEST(BlockchainDBTest, RetrieveBlockData)
   ASSERT_HASH_EQ(get_block_hash(this->m_blocks[1].first), hashes[1]);
 }
 
+TYPED_TEST(BlockchainDBTest, BlockHeaders)
+{
+  fs::path tempPath = random_tmp_file();
+  std::string dirPath = tempPath.string();
+
+  this->set_prefix(dirPath);
+
+  ASSERT_NO_THROW(this->m_db->open(dirPath, cryptonote::FAKECHAIN));
+  this->get_filenames();
+
+  db_wtxn_guard guard(this->m_db);
+
+  ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[0], t_sizes[0], t_sizes[0], t_diffs[0], t_coins[0], this->m_txs[0]));
+  ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[1], t_sizes[1], t_sizes[1], t_diffs[1], t_coins[1], this->m_txs[1]));
+
+  auto headers = this->m_db->get_block_headers(0, 5);
+  ASSERT_EQ(2, headers.size());
+  for (size_t i = 0; i < headers.size(); i++)
+  {
+    const block& b = this->m_blocks[i].first;
+    const auto& h = headers[i];
+    ASSERT_EQ(i, h.height);
+    ASSERT_HASH_EQ(get_block_hash(b), h.hash);
+    ASSERT_HASH_EQ(b.prev_id, h.prev_id);
+    ASSERT_HASH_EQ(get_transaction_hash(b.miner_tx), h.miner_tx_hash);
+    ASSERT_EQ(b.major_version, h.major_version);
+    ASSERT_EQ(b.nonce, h.nonce);
+    ASSERT_EQ(b.timestamp, h.timestamp);
+    ASSERT_EQ(b.tx_hashes.size(), h.num_txes);
+    ASSERT_EQ(b.miner_tx.vout[0].amount, h.miner_reward);
+    ASSERT_EQ(t_sizes[i], h.weight);
+    ASSERT_EQ(t_diffs[i], h.cumulative_difficulty);
+  }
+
+  ASSERT_EQ(1, this->m_db->get_block_headers(1, 1).size());
+  ASSERT_TRUE(this->m_db->get_block_headers(2, 1).empty());
+
+  block popped;
+  std::vector<transaction> popped_txs;
+  ASSERT_NO_THROW(this->m_db->pop_block(popped, popped_txs));
+  ASSERT_EQ(1, this->m_db->get_block_headers(0, 5).size());
+}
+
+TYPED_TEST(BlockchainDBTest, CoinbaseSums)
+{
+  fs::path tempPath = random_tmp_file();
+  std::string dirPath = tempPath.string();
+
+  this->set_prefix(dirPath);
+
+  ASSERT_NO_THROW(this->m_db->open(dirPath, cryptonote::FAKECHAIN));
+  this->get_filenames();
+
+  db_wtxn_guard guard(this->m_db);
+
+  ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[0], t_sizes[0], t_sizes[0], t_diffs[0], t_coins[0], this->m_txs[0]));
+  ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[1], t_sizes[1], t_sizes[1], t_diffs[1], t_coins[1], this->m_txs[1]));
+
+  uint64_t emission = 0, fees = 0;
+  for (size_t i = 0; i < 2; i++)
+  {
+    const block& b = this->m_blocks[i].first;
+    emission += get_outs_money_amount(b.miner_tx);
+    for (const auto& tx : this->m_txs[i])
+    {
+      const uint64_t fee = get_tx_miner_fee(tx.first, b.major_version >= HF_VERSION_FEE_BURNING);
+      emission -= fee;
+      fees += fee;
+    }
+
+    block_coinbase_sums sums;
+    ASSERT_TRUE(this->m_db->get_coinbase_sums(i, sums));
+    ASSERT_EQ(emission, sums.emission);
+    ASSERT_EQ(fees, sums.fees);
+  }
+
+  block_coinbase_sums sums;
+  ASSERT_FALSE(this->m_db->get_coinbase_sums(2, sums));
+
+  block popped;
+  std::vector<transaction> popped_txs;
+  ASSERT_NO_THROW(this->m_db->pop_block(popped, popped_txs));
+  ASSERT_FALSE(this->m_db->get_coinbase_sums(1, sums));
+  ASSERT_TRUE(this->m_db->get_coinbase_sums(0, sums));
+}
+
 }  // anonymous namespace
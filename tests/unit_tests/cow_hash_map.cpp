@@ -0,0 +1,80 @@
+#include "gtest/gtest.h"
+
+#include <string>
+
+#include "common/cow_hash_map.h"
+
+TEST(cow_hash_map, insert_find_erase)
+{
+  tools::cow_hash_map<int, std::string> map;
+  EXPECT_TRUE(map.empty());
+  EXPECT_TRUE(map.emplace(1, "one").second);
+  EXPECT_FALSE(map.emplace(1, "uno").second);
+  map[2] = "two";
+  EXPECT_EQ(map.size(), 2);
+  EXPECT_EQ(map.at(1), "one");
+  EXPECT_THROW(map.at(3), std::out_of_range);
+  EXPECT_TRUE(map.find(3) == map.end());
+
+  auto it = map.find(2);
+  ASSERT_TRUE(it != map.end());
+  it->second = "deux";
+  EXPECT_EQ(map.at(2), "deux");
+
+  map.erase(it);
+  EXPECT_EQ(map.erase(2), 0);
+  EXPECT_EQ(map.erase(1), 1);
+  EXPECT_TRUE(map.empty());
+  EXPECT_TRUE(map.begin() == map.end());
+}
+
+TEST(cow_hash_map, iterates_every_element)
+{
+  tools::cow_hash_map<int, int, std::hash<int>, 8> map;
+  for (int i = 0; i < 1000; i++)
+    map.emplace(i, i * 2);
+  size_t n = 0;
+  long sum = 0;
+  for (const auto& [k, v] : map)
+  {
+    EXPECT_EQ(v, k * 2);
+    sum += k;
+    n++;
+  }
+  EXPECT_EQ(n, 1000);
+  EXPECT_EQ(sum, 999 * 1000 / 2);
+}
+
+TEST(cow_hash_map, copies_are_independent)
+{
+  tools::cow_hash_map<int, int> a;
+  for (int i = 0; i < 100; i++)
+    a[i] = i;
+
+  auto b = a;
+  b[5] = 500;
+  b.erase(6);
+  b.emplace(100, 100);
+  auto it = b.find(7);
+  it->second = 700;
+
+  EXPECT_EQ(a.size(), 100);
+  EXPECT_EQ(a.at(5), 5);
+  EXPECT_EQ(a.at(6), 6);
+  EXPECT_EQ(a.at(7), 7);
+  EXPECT_EQ(a.count(100), 0);
+
+  EXPECT_EQ(b.size(), 100);
+  EXPECT_EQ(b.at(5), 500);
+  EXPECT_EQ(b.count(6), 0);
+  EXPECT_EQ(b.at(7), 700);
+  EXPECT_EQ(b.at(100), 100);
+
+  // An iterator obtained before a copy must not modify the copy when erased through
+  auto it8 = a.find(8);
+  auto c = a;
+  a.erase(it8);
+  EXPECT_EQ(a.count(8), 0);
+  EXPECT_EQ(c.at(8), 8);
+  EXPECT_EQ(c.size(), 100);
+}
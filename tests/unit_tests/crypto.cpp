@@ -31,9 +31,14 @@
 #include <memory>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "cryptonote_basic/cryptonote_basic_impl.h"
 
+extern "C" {
+#include "crypto/crypto-ops.h"
+}
+
 namespace
 {
   alignas(size_t) static constexpr const std::uint8_t source[] = {
@@ -99,3 +104,138 @@ TEST(Crypto, verify_32)
     }
   }
 }
+
+TEST(Crypto, generate_key_derivations)
+{
+  crypto::public_key view_pub;
+  crypto::secret_key view_sec;
+  crypto::generate_keys(view_pub, view_sec);
+
+  std::vector<crypto::public_key> keys(20);
+  for (auto &key: keys)
+  {
+    crypto::secret_key sec;
+    crypto::generate_keys(key, sec);
+  }
+  // a couple of invalid keys in the middle of the batch must not affect the others
+  for (size_t i : {5, 13})
+    do keys[i] = crypto::rand<crypto::public_key>(); while (crypto::check_key(keys[i]));
+
+  std::vector<crypto::key_derivation> derivations(keys.size());
+  std::unique_ptr<bool[]> valid{new bool[keys.size()]};
+  crypto::generate_key_derivations(keys.data(), keys.size(), view_sec, derivations.data(), valid.get());
+  for (size_t i = 0; i < keys.size(); ++i)
+  {
+    crypto::key_derivation expected;
+    ASSERT_EQ(valid[i], crypto::generate_key_derivation(keys[i], view_sec, expected));
+    if (valid[i])
+      ASSERT_EQ(memcmp(&derivations[i], &expected, sizeof(expected)), 0);
+  }
+  ASSERT_FALSE(valid[5]);
+  ASSERT_FALSE(valid[13]);
+
+  crypto::generate_key_derivations(keys.data(), 0, view_sec, derivations.data(), valid.get());
+}
+
+TEST(Crypto, derive_subaddress_public_keys)
+{
+  std::vector<crypto::public_key> keys(20);
+  std::vector<crypto::key_derivation> derivations(keys.size());
+  std::vector<size_t> output_indices(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i)
+  {
+    crypto::secret_key sec;
+    crypto::generate_keys(keys[i], sec);
+    derivations[i] = crypto::rand<crypto::key_derivation>();
+    output_indices[i] = i * 37;
+  }
+  for (size_t i : {0, 11})
+    do keys[i] = crypto::rand<crypto::public_key>(); while (crypto::check_key(keys[i]));
+
+  std::vector<crypto::public_key> derived(keys.size());
+  std::unique_ptr<bool[]> valid{new bool[keys.size()]};
+  crypto::derive_subaddress_public_keys(keys.data(), derivations.data(), output_indices.data(), keys.size(), derived.data(), valid.get());
+  for (size_t i = 0; i < keys.size(); ++i)
+  {
+    crypto::public_key expected;
+    ASSERT_EQ(valid[i], crypto::derive_subaddress_public_key(keys[i], derivations[i], output_indices[i], expected));
+    if (valid[i])
+      ASSERT_EQ(derived[i], expected);
+  }
+  ASSERT_FALSE(valid[0]);
+  ASSERT_FALSE(valid[11]);
+}
+
+TEST(Crypto, generate_key_images)
+{
+  // an odd count, so that some go through the four at a time path and some don't
+  std::vector<crypto::public_key> pubs(11);
+  std::vector<crypto::secret_key> secs(pubs.size());
+  for (size_t i = 0; i < pubs.size(); ++i)
+    crypto::generate_keys(pubs[i], secs[i]);
+
+  std::vector<crypto::key_image> images(pubs.size());
+  crypto::generate_key_images(pubs.data(), secs.data(), pubs.size(), images.data());
+  std::unique_ptr<bool[]> in_domain{new bool[images.size() + 2]};
+  for (size_t i = 0; i < pubs.size(); ++i)
+  {
+    crypto::key_image expected;
+    crypto::generate_key_image(pubs[i], secs[i], expected);
+    ASSERT_EQ(images[i], expected);
+  }
+
+  // the point of order 2, and something that isn't a point at all
+  crypto::key_image torsion;
+  memset(&torsion, 0xff, sizeof(torsion));
+  reinterpret_cast<unsigned char*>(&torsion)[0] = 0xec;
+  reinterpret_cast<unsigned char*>(&torsion)[31] = 0x7f;
+  images.push_back(torsion);
+  crypto::key_image invalid;
+  do invalid = crypto::rand<crypto::key_image>(); while (crypto::check_key(reinterpret_cast<const crypto::public_key&>(invalid)));
+  images.push_back(invalid);
+  crypto::check_key_images_domain(images.data(), images.size(), in_domain.get());
+  for (size_t i = 0; i < pubs.size(); ++i)
+    ASSERT_TRUE(in_domain[i]);
+  ASSERT_FALSE(in_domain[pubs.size()]);
+  ASSERT_FALSE(in_domain[pubs.size() + 1]);
+}
+
+TEST(Crypto, ge_scalarmult_x4)
+{
+  for (int round = 0; round < 50; ++round)
+  {
+    ge_p3 points[4];
+    crypto::secret_key scalars[4];
+    const unsigned char *scalar_ptrs[4];
+    for (int i = 0; i < 4; ++i)
+    {
+      crypto::public_key pub;
+      crypto::generate_keys(pub, scalars[i]);
+      ASSERT_EQ(ge_frombytes_vartime(&points[i], reinterpret_cast<const unsigned char*>(&pub)), 0);
+      scalar_ptrs[i] = reinterpret_cast<const unsigned char*>(&scalars[i]);
+    }
+    ge_p2 results[4];
+    ge_scalarmult_x4(results, scalar_ptrs, points);
+    for (int i = 0; i < 4; ++i)
+    {
+      ge_p2 expected;
+      ge_scalarmult(&expected, scalar_ptrs[i], &points[i]);
+      // identical limbs, not just the same point
+      ASSERT_EQ(memcmp(&results[i], &expected, sizeof(expected)), 0);
+    }
+  }
+}
+
+TEST(Crypto, cn_fast_hash_batch)
+{
+  // lengths on both sides of the 136 byte keccak block, mixed within each group of four
+  std::string data(1000, 0);
+  crypto::rand(data.size(), reinterpret_cast<uint8_t*>(data.data()));
+  std::vector<std::string_view> blobs;
+  for (size_t len : {0, 1, 64, 135, 136, 137, 271, 272, 500, 32, 96, 999, 64})
+    blobs.push_back(std::string_view{data}.substr(blobs.size(), len));
+  const std::vector<crypto::hash> hashes = crypto::cn_fast_hash_batch(blobs);
+  ASSERT_EQ(hashes.size(), blobs.size());
+  for (size_t i = 0; i < blobs.size(); ++i)
+    ASSERT_EQ(hashes[i], crypto::cn_fast_hash(blobs[i].data(), blobs[i].size()));
+}
@@ -29,6 +29,7 @@
 #include "gtest/gtest.h"
 #include "epee/int-util.h"
 #include "cryptonote_basic/difficulty.h"
+#include "testdb.h"
 
 static cryptonote::difficulty_type MKDIFF(uint64_t high, uint64_t low)
 {
@@ -72,3 +73,46 @@ TEST(difficulty, check_hash)
   ASSERT_TRUE(cryptonote::check_hash(MKHASH(0xffffffffffffffff, 1), MKDIFF(0xffffffffffffffff, 1)));
   ASSERT_FALSE(cryptonote::check_hash(MKHASH(0xffffffffffffffff, 1), MKDIFF(0xffffffffffffffff, 2)));
 }
+
+namespace
+{
+  class DifficultyTestDB: public BaseTestDB
+  {
+  public:
+    uint64_t get_block_timestamp(const uint64_t& height) const override { m_reads++; return 1000 + height * 120 + height % 7; }
+    cryptonote::difficulty_type get_block_cumulative_difficulty(const uint64_t& height) const override { m_reads++; return height * (height + 1000); }
+    mutable uint64_t m_reads = 0;
+  };
+}
+
+TEST(difficulty, incremental_timestamps_and_difficulties)
+{
+  DifficultyTestDB db;
+  std::vector<uint64_t> timestamps, difficulties;
+  uint64_t cached_height = 0;
+
+  // Walk the chain up, down (as blocks are popped) and back up, checking the incrementally
+  // maintained window against a fresh load at every height.
+  std::vector<uint64_t> heights;
+  for (uint64_t h = 2; h < 200; h++) heights.push_back(h);
+  for (uint64_t h = 198; h > 120; h--) heights.push_back(h);
+  heights.push_back(150);
+  heights.push_back(20);
+  for (uint64_t h = 21; h < 100; h++) heights.push_back(h);
+
+  for (uint64_t h : heights)
+  {
+    db.m_reads = 0;
+    db.fill_timestamps_and_difficulties_for_pow(cryptonote::FAKECHAIN, timestamps, difficulties, h, cached_height);
+    uint64_t const incremental_reads = db.m_reads;
+    bool const adjacent = cached_height && (h + 1 == cached_height || h == cached_height + 1);
+    cached_height = h;
+
+    std::vector<uint64_t> expected_timestamps, expected_difficulties;
+    db.fill_timestamps_and_difficulties_for_pow(cryptonote::FAKECHAIN, expected_timestamps, expected_difficulties, h, 0);
+    ASSERT_EQ(timestamps, expected_timestamps) << "at height " << h;
+    ASSERT_EQ(difficulties, expected_difficulties) << "at height " << h;
+    if (adjacent)
+      ASSERT_LE(incremental_reads, 2) << "at height " << h;
+  }
+}
@@ -323,6 +323,28 @@ TEST_F(positive_test_connection_to_levin_protocol_handler_calls, concurent_handl
   ASSERT_EQ(connection_count * thread_count, m_commands_handler.close_connection_counter());
 }
 
+TEST_F(positive_test_connection_to_levin_protocol_handler_calls, foreach_connection_does_not_block_connection_setup)
+{
+  std::vector<test_connection_ptr> connections;
+  for (size_t i = 0; i < 3; ++i)
+    connections.push_back(create_connection());
+
+  // Connections get set up and torn down on other threads while the callbacks are running
+  size_t visited = 0;
+  ASSERT_TRUE(m_handler_config.foreach_connection([&](test_levin_connection_context&) {
+    boost::thread th{[&] { create_connection().reset(); }};
+    th.join();
+    ++visited;
+    return true;
+  }));
+  ASSERT_EQ(3, visited);
+  ASSERT_EQ(3, m_handler_config.get_connections_count());
+
+  visited = 0;
+  ASSERT_FALSE(m_handler_config.foreach_connection([&](test_levin_connection_context&) { return ++visited < 2; }));
+  ASSERT_EQ(2, visited);
+}
+
 TEST_F(positive_test_connection_to_levin_protocol_handler_calls, handler_processes_handle_read_as_invoke)
 {
   // Setup
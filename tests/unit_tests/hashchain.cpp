@@ -28,6 +28,9 @@
 
 // FIXME: move this into a full wallet2 unit test suite, if possible
 
+#include <sstream>
+#include <boost/archive/portable_binary_iarchive.hpp>
+#include <boost/archive/portable_binary_oarchive.hpp>
 #include "gtest/gtest.h"
 
 #include "wallet/wallet2.h"
@@ -127,3 +130,92 @@ TEST(hashchain, trim)
   ASSERT_FALSE(hashchain.empty());
   ASSERT_EQ(hashchain.genesis(), make_hash(1));
 }
+
+TEST(hashchain, attach)
+{
+  const fs::path dir = fs::temp_directory_path() / ("oxen-hashchain-" + std::to_string(crypto::rand<uint64_t>()));
+  fs::create_directories(dir);
+  const fs::path file = dir / "wallet.hashchain";
+  auto store = [](const tools::hashchain &hashchain) {
+    std::ostringstream oss;
+    boost::archive::portable_binary_oarchive ar(oss);
+    ar << hashchain;
+    return oss.str();
+  };
+  auto load = [](const std::string &cache, tools::hashchain &hashchain) {
+    std::istringstream iss(cache);
+    boost::archive::portable_binary_iarchive ar(iss);
+    ar >> hashchain;
+  };
+
+  std::string cache;
+  {
+    tools::hashchain hashchain;
+    for (uint64_t n = 1; n <= 10; ++n)
+      hashchain.push_back(make_hash(n));
+    hashchain.trim(4);
+    ASSERT_TRUE(hashchain.attach(file));
+    ASSERT_TRUE(hashchain.attached());
+    ASSERT_EQ(hashchain.size(), 10);
+    ASSERT_EQ(hashchain.offset(), 4);
+    ASSERT_EQ(hashchain[4], make_hash(5));
+    ASSERT_EQ(hashchain[9], make_hash(10));
+    for (uint64_t n = 11; n <= 10000; ++n) // grows the file
+      hashchain.push_back(make_hash(n));
+    hashchain.crop(9999);
+    hashchain.flush();
+    cache = store(hashchain);
+  }
+  ASSERT_LT(cache.size(), 1000); // the hashes stay in the file
+
+  {
+    tools::hashchain hashchain;
+    load(cache, hashchain);
+    ASSERT_FALSE(hashchain.loaded());
+    ASSERT_TRUE(hashchain.attach(file));
+    ASSERT_TRUE(hashchain.loaded());
+    ASSERT_EQ(hashchain.size(), 9999);
+    ASSERT_EQ(hashchain.offset(), 4);
+    ASSERT_EQ(hashchain.genesis(), make_hash(1));
+    ASSERT_EQ(hashchain[4], make_hash(5));
+    ASSERT_EQ(hashchain[9998], make_hash(9999));
+
+    // Trimming most of the chain compacts the file on the next flush
+    hashchain.trim(9000);
+    hashchain.flush();
+    ASSERT_EQ(hashchain.offset(), 9000);
+    ASSERT_EQ(hashchain[9000], make_hash(9001));
+    ASSERT_EQ(hashchain[9998], make_hash(9999));
+    cache = store(hashchain);
+
+    hashchain.detach();
+    ASSERT_FALSE(hashchain.attached());
+    ASSERT_EQ(hashchain.size(), 9999);
+    ASSERT_EQ(hashchain[9998], make_hash(9999));
+  }
+
+  {
+    tools::hashchain hashchain;
+    load(cache, hashchain);
+    ASSERT_TRUE(hashchain.attach(file));
+    ASSERT_EQ(hashchain.size(), 9999);
+    ASSERT_EQ(hashchain.offset(), 9000);
+    ASSERT_EQ(hashchain[9998], make_hash(9999));
+  }
+
+  // A file that no longer matches the cache is refused
+  {
+    tools::hashchain other;
+    other.push_back(make_hash(100));
+    ASSERT_TRUE(other.attach(file));
+  }
+  {
+    tools::hashchain hashchain;
+    load(cache, hashchain);
+    ASSERT_FALSE(hashchain.attach(file));
+    ASSERT_TRUE(hashchain.empty());
+    ASSERT_TRUE(hashchain.attached());
+  }
+
+  fs::remove_all(dir);
+}
@@ -0,0 +1,52 @@
+#include "gtest/gtest.h"
+
+#include "cryptonote_basic/known_inventory.h"
+
+namespace
+{
+  crypto::hash make_hash(uint64_t i)
+  {
+    crypto::hash h;
+    crypto::cn_fast_hash(&i, sizeof(i), h);
+    return h;
+  }
+}
+
+TEST(known_inventory, insert_contains)
+{
+  cryptonote::known_inventory known;
+  EXPECT_FALSE(known.contains(make_hash(1)));
+  known.insert(make_hash(1));
+  EXPECT_TRUE(known.contains(make_hash(1)));
+  EXPECT_FALSE(known.contains(make_hash(2)));
+
+  cryptonote::known_inventory copy{known};
+  EXPECT_TRUE(copy.contains(make_hash(1)));
+
+  known.clear();
+  EXPECT_FALSE(known.contains(make_hash(1)));
+  EXPECT_TRUE(copy.contains(make_hash(1)));
+}
+
+TEST(known_inventory, rolls_over)
+{
+  constexpr uint64_t gen = cryptonote::known_inventory::GENERATION_SIZE;
+  cryptonote::known_inventory known;
+  for (uint64_t i = 0; i < 2 * gen; i++)
+    known.insert(make_hash(i));
+
+  // The last full generation is always remembered
+  for (uint64_t i = gen; i < 2 * gen; i++)
+    ASSERT_TRUE(known.contains(make_hash(i)));
+
+  // One more rollover drops the oldest generation (aside from the odd false positive)
+  for (uint64_t i = 2 * gen; i < 3 * gen; i++)
+    known.insert(make_hash(i));
+  size_t remembered = 0, false_positives = 0;
+  for (uint64_t i = 0; i < gen; i++)
+    remembered += known.contains(make_hash(i));
+  for (uint64_t i = 3 * gen; i < 13 * gen; i++)
+    false_positives += known.contains(make_hash(i));
+  EXPECT_LT(remembered, gen / 50);
+  EXPECT_LT(false_positives, 10 * gen / 250); // < 0.4%
+}
@@ -30,10 +30,12 @@
 #include <boost/uuid/nil_generator.hpp>
 #include <boost/uuid/random_generator.hpp>
 #include <boost/uuid/uuid.hpp>
+#include <chrono>
 #include <cstring>
 #include <gtest/gtest.h>
 #include <limits>
 #include <set>
+#include <thread>
 
 #include "epee/shared_sv.h"
 #include "crypto/crypto.h"
@@ -271,12 +273,12 @@ namespace
             EXPECT_EQ(connection_ids_.size(), connections_->get_connections_count());
         }
 
-        cryptonote::levin::notify make_notifier(const std::size_t noise_size, bool is_public)
+        cryptonote::levin::notify make_notifier(const std::size_t noise_size, bool is_public, std::chrono::milliseconds relay_delay = {})
         {
             epee::shared_sv noise;
             if (noise_size)
                 noise = epee::shared_sv{epee::levin::make_noise_notify(noise_size)};
-            return cryptonote::levin::notify{io_service_, connections_, std::move(noise), is_public};
+            return cryptonote::levin::notify{io_service_, connections_, std::move(noise), is_public, relay_delay};
         }
 
         boost::uuids::random_generator random_generator_;
@@ -482,6 +484,7 @@ TEST_F(levin_notify, flood)
         }
     }
 
+    txs[0].resize(150); // peers now know the first txs, so send something new
     ASSERT_EQ(10u, contexts_.size());
     {
         auto context = contexts_.begin();
@@ -504,6 +507,93 @@ TEST_F(levin_notify, flood)
     }
 }
 
+TEST_F(levin_notify, batched_flood)
+{
+    cryptonote::levin::notify notifier = make_notifier(0, true, std::chrono::milliseconds{10});
+
+    for (unsigned count = 0; count < 10; ++count)
+        add_connection(count % 2 == 0);
+
+    std::vector<cryptonote::blobdata> txs(3);
+    txs[0].resize(100, 'f');
+    txs[1].resize(200, 'e');
+    txs[2].resize(300, 'd');
+
+    // the first two connections each send us one tx, and both send us the third
+    auto first = contexts_.begin(), second = std::next(first);
+    EXPECT_TRUE(notifier.send_txs({txs[0], txs[2]}, first->get_id(), false));
+    EXPECT_TRUE(notifier.send_txs({txs[1], txs[2]}, second->get_id(), false));
+
+    io_service_.reset();
+    io_service_.poll();
+    for (auto& context : contexts_)
+        EXPECT_EQ(0u, context.process_send_queue()); // nothing goes out before the delay
+    ASSERT_EQ(0u, receiver_.notified_size());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds{50});
+    io_service_.reset();
+    ASSERT_LT(0u, io_service_.poll());
+
+    EXPECT_EQ(1u, first->process_send_queue());
+    {
+        auto notification = receiver_.get_notification<cryptonote::NOTIFY_NEW_TRANSACTIONS>().second;
+        EXPECT_EQ(std::vector<cryptonote::blobdata>{txs[1]}, notification.txs);
+    }
+    EXPECT_EQ(1u, second->process_send_queue());
+    {
+        auto notification = receiver_.get_notification<cryptonote::NOTIFY_NEW_TRANSACTIONS>().second;
+        EXPECT_EQ(std::vector<cryptonote::blobdata>{txs[0]}, notification.txs);
+    }
+
+    std::sort(txs.begin(), txs.end());
+    for (auto context = std::next(second); context != contexts_.end(); ++context)
+    {
+        EXPECT_EQ(1u, context->process_send_queue());
+        auto notification = receiver_.get_notification<cryptonote::NOTIFY_NEW_TRANSACTIONS>().second;
+        EXPECT_EQ(txs, notification.txs);
+    }
+}
+
+TEST_F(levin_notify, known_inventory_not_resent)
+{
+    cryptonote::levin::notify notifier = make_notifier(0, true);
+
+    for (unsigned count = 0; count < 10; ++count)
+        add_connection(count % 2 == 0);
+
+    std::vector<cryptonote::blobdata> txs(2);
+    txs[0].resize(100, 'f');
+    txs[1].resize(200, 'e');
+
+    auto first = contexts_.begin(), second = std::next(first);
+    EXPECT_TRUE(notifier.send_txs(txs, first->get_id(), false));
+    io_service_.reset();
+    ASSERT_LT(0u, io_service_.poll());
+    for (auto& context : contexts_)
+        context.process_send_queue();
+    ASSERT_EQ(9u, receiver_.notified_size());
+    for (unsigned count = 0; count < 9; ++count)
+        receiver_.get_notification<cryptonote::NOTIFY_NEW_TRANSACTIONS>();
+
+    // Everyone but the original source got them from us already
+    EXPECT_TRUE(notifier.send_txs(txs, second->get_id(), false));
+    io_service_.reset();
+    ASSERT_LT(0u, io_service_.poll());
+    EXPECT_EQ(1u, first->process_send_queue());
+    for (auto context = second; context != contexts_.end(); ++context)
+        EXPECT_EQ(0u, context->process_send_queue());
+    ASSERT_EQ(1u, receiver_.notified_size());
+
+    // A single unknown tx means the peer gets the message
+    txs.emplace_back(300, 'd');
+    EXPECT_TRUE(notifier.send_txs(txs, first->get_id(), false));
+    io_service_.reset();
+    ASSERT_LT(0u, io_service_.poll());
+    EXPECT_EQ(0u, first->process_send_queue());
+    for (auto context = second; context != contexts_.end(); ++context)
+        EXPECT_EQ(1u, context->process_send_queue());
+}
+
 TEST_F(levin_notify, private_flood)
 {
     cryptonote::levin::notify notifier = make_notifier(0, false);
@@ -551,6 +641,7 @@ TEST_F(levin_notify, private_flood)
         }
     }
 
+    txs[0].resize(150); // peers now know the first txs, so send something new
     ASSERT_EQ(10u, contexts_.size());
     {
         auto context = contexts_.begin();
@@ -575,6 +666,38 @@ TEST_F(levin_notify, private_flood)
     }
 }
 
+TEST_F(levin_notify, private_held_until_connection)
+{
+    cryptonote::levin::notify notifier = make_notifier(0, false);
+    add_connection(true);
+
+    std::vector<cryptonote::blobdata> txs(1);
+    txs[0].resize(100, 'g');
+
+    // only an incoming connection, which never gets our own txs over an anonymity network
+    EXPECT_TRUE(notifier.send_txs(txs, boost::uuids::nil_uuid(), false));
+    io_service_.poll();
+    EXPECT_EQ(0u, contexts_.front().process_send_queue());
+
+    add_connection(false);
+    notifier.new_out_connection();
+    io_service_.reset();
+    ASSERT_LT(0u, io_service_.poll());
+    EXPECT_EQ(0u, contexts_.front().process_send_queue());
+    EXPECT_EQ(1u, contexts_.back().process_send_queue());
+
+    ASSERT_EQ(1u, receiver_.notified_size());
+    auto notification = receiver_.get_notification<cryptonote::NOTIFY_NEW_TRANSACTIONS>().second;
+    EXPECT_EQ(txs, notification.txs);
+
+    // nothing left to send on the next connection
+    add_connection(false);
+    notifier.new_out_connection();
+    io_service_.reset();
+    io_service_.poll();
+    EXPECT_EQ(0u, contexts_.back().process_send_queue());
+}
+
 TEST_F(levin_notify, noise)
 {
     for (unsigned count = 0; count < 10; ++count)
@@ -0,0 +1,36 @@
+#include "gtest/gtest.h"
+
+// The instrumented mutex is a header template, so it can be tested without a -DLOCK_STATS build
+#ifndef OXEN_LOCK_STATS
+#define OXEN_LOCK_STATS
+#endif
+#include "common/lock_stats.h"
+#include "common/metrics.h"
+
+#include <mutex>
+
+TEST(lock_stats, recursive_hold_counted_once)
+{
+  tools::instrumented_mutex<std::recursive_mutex> m{"test_recursive"};
+  auto& hold = tools::metrics::get_histogram("oxend_lock_test_recursive_hold_seconds", "", 1e-9);
+  for (int i = 0; i < 3; i++)
+  {
+    std::unique_lock outer{m};
+    std::unique_lock inner{m};
+  }
+  EXPECT_EQ(hold.count(), 3u);
+  EXPECT_EQ(tools::metrics::get_histogram("oxend_lock_test_recursive_wait_seconds", "", 1e-9).count(), 3u);
+
+  bool found = false;
+  for (auto& l : tools::lock_stats::top_sites())
+  {
+    if (l.name != "test_recursive")
+      continue;
+    found = true;
+    uint64_t count = 0;
+    for (auto& s : l.sites)
+      count += s.count;
+    EXPECT_EQ(count, 3u);
+  }
+  EXPECT_TRUE(found);
+}
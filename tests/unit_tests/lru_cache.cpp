@@ -0,0 +1,55 @@
+#include "gtest/gtest.h"
+
+#include <string>
+
+#include "common/lru_cache.h"
+
+TEST(lru_cache, get_put)
+{
+  tools::lru_cache<int, std::string> cache{3};
+  EXPECT_EQ(cache.get(1), nullptr);
+  cache.put(1, "one");
+  cache.put(2, "two");
+  ASSERT_NE(cache.get(1), nullptr);
+  EXPECT_EQ(*cache.get(1), "one");
+  cache.put(1, "uno");
+  EXPECT_EQ(*cache.get(1), "uno");
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_EQ(cache.hits(), 3);
+  EXPECT_EQ(cache.misses(), 1);
+}
+
+TEST(lru_cache, evicts_least_recently_used)
+{
+  tools::lru_cache<int, int> cache{3};
+  cache.put(1, 10);
+  cache.put(2, 20);
+  cache.put(3, 30);
+  cache.get(1); // 2 is now the least recently used
+  cache.put(4, 40);
+  EXPECT_EQ(cache.size(), 3);
+  EXPECT_FALSE(cache.contains(2));
+  EXPECT_TRUE(cache.contains(1));
+  EXPECT_TRUE(cache.contains(3));
+  EXPECT_TRUE(cache.contains(4));
+
+  cache.max_size(1);
+  EXPECT_EQ(cache.size(), 1);
+  EXPECT_TRUE(cache.contains(4));
+}
+
+TEST(lru_cache, erase)
+{
+  tools::lru_cache<int, int> cache{10};
+  for (int i = 0; i < 10; i++)
+    cache.put(i, i * i);
+  EXPECT_TRUE(cache.erase(3));
+  EXPECT_FALSE(cache.erase(3));
+  cache.erase_if([](int k, int) { return k >= 5; });
+  EXPECT_EQ(cache.size(), 4);
+  for (int i : {0, 1, 2, 4})
+    EXPECT_TRUE(cache.contains(i));
+  cache.clear();
+  EXPECT_TRUE(cache.empty());
+  EXPECT_EQ(cache.get(0), nullptr);
+}
@@ -0,0 +1,88 @@
+#include "gtest/gtest.h"
+
+#include "common/memory_usage.h"
+#include "common/metrics.h"
+
+TEST(metrics, histogram_buckets)
+{
+  using tools::metrics::histogram;
+  for (uint64_t v : {0ull, 1ull, 3ull, 4ull, 5ull, 7ull, 8ull, 9ull, 1000ull, 123456789ull, ~0ull})
+  {
+    auto b = histogram::bucket(v);
+    ASSERT_LT(b, histogram::BUCKETS);
+    EXPECT_LE(v, histogram::bucket_max(b));
+    if (b > 0) {
+      EXPECT_GT(v, histogram::bucket_max(b - 1));
+    }
+  }
+  EXPECT_EQ(histogram::bucket_max(histogram::BUCKETS - 1), ~0ull);
+  // Four buckets per power of two
+  EXPECT_EQ(histogram::bucket_max(histogram::bucket(1000)), 1023u);
+  EXPECT_EQ(histogram::bucket_max(histogram::bucket(1100)), 1279u);
+}
+
+TEST(metrics, registry)
+{
+  auto& c = tools::metrics::get_counter("test_metrics_counter_total", "A counter");
+  c.inc();
+  c.inc(2);
+  EXPECT_EQ(&c, &tools::metrics::get_counter("test_metrics_counter_total", "A counter"));
+  EXPECT_THROW(tools::metrics::get_gauge("test_metrics_counter_total", "Not a gauge"), std::logic_error);
+
+  auto& h = tools::metrics::get_histogram("test_metrics_seconds", "A histogram", 1e-3);
+  h.observe(5);
+  h.observe(1500);
+
+  int value = 7;
+  {
+    auto reg = tools::metrics::register_gauge("test_metrics_callback", "A callback gauge", [&] { return value; });
+    bool found = false;
+    for (auto& s : tools::metrics::snapshot())
+    {
+      if (s.name == "test_metrics_counter_total")
+        EXPECT_EQ(s.value, 3);
+      else if (s.name == "test_metrics_callback")
+      {
+        found = true;
+        EXPECT_EQ(s.value, 7);
+      }
+      else if (s.name == "test_metrics_seconds")
+      {
+        EXPECT_EQ(s.count, 2u);
+        EXPECT_DOUBLE_EQ(s.sum, 1.505);
+        EXPECT_EQ(s.buckets.size(), 2u);
+      }
+    }
+    EXPECT_TRUE(found);
+
+    auto text = tools::metrics::prometheus_text();
+    EXPECT_NE(text.find("# TYPE test_metrics_counter_total counter\ntest_metrics_counter_total 3\n"), std::string::npos);
+    EXPECT_NE(text.find("test_metrics_seconds_bucket{le=\"0.007\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("test_metrics_seconds_bucket{le=\"+Inf\"} 2\n"), std::string::npos);
+  }
+  for (auto& s : tools::metrics::snapshot())
+    EXPECT_NE(s.name, "test_metrics_callback");
+}
+
+TEST(metrics, memory_tracking)
+{
+  std::vector<uint64_t> v(100);
+  EXPECT_EQ(tools::memory::heap_bytes(v), 800u);
+  EXPECT_EQ(tools::memory::heap_bytes(std::string{"short"}), 0u);
+  EXPECT_GE(tools::memory::heap_bytes(std::string(100, 'x')), 101u);
+  std::unordered_map<int, uint64_t> m{{1, 1}, {2, 2}};
+  EXPECT_GE(tools::memory::heap_bytes(m), 2 * sizeof(std::pair<const int, uint64_t>));
+
+  auto reg = tools::memory::track("test_subsystem", "A tracked subsystem", [] { return 1234; });
+  bool found = false;
+  for (auto& s : tools::metrics::snapshot())
+    if (s.name == "oxend_memory_test_subsystem_bytes")
+    {
+      found = true;
+      EXPECT_EQ(s.value, 1234);
+    }
+  EXPECT_TRUE(found);
+#ifdef __linux__
+  EXPECT_GT(tools::memory::resident_bytes(), 0u);
+#endif
+}
@@ -266,6 +266,44 @@ TEST(multiexp, pippenger_cached)
   }
 }
 
+TEST(multiexp, pippenger_fixed_base)
+{
+  static constexpr size_t N = 256;
+  std::vector<rct::MultiexpData> P(N);
+  for (size_t n = 0; n < N; ++n)
+  {
+    P[n].scalar = rct::zero();
+    ASSERT_TRUE(ge_frombytes_vartime(&P[n].point, rct::scalarmultBase(rct::skGen()).bytes) == 0);
+  }
+  std::shared_ptr<rct::pippenger_cached_data> cache = rct::pippenger_init_fixed_base_cache(P);
+  for (size_t n = 0; n < N/16; ++n)
+  {
+    // the fixed points, followed by a few that aren't in the cache
+    std::vector<rct::MultiexpData> data;
+    for (size_t s = 0; s < N; ++s)
+      data.push_back({rct::skGen(), P[s].point});
+    size_t extra = crypto::rand<size_t>() % 32;
+    for (size_t s = 0; s < extra; ++s)
+      data.push_back({rct::skGen(), get_p3(rct::scalarmultBase(rct::skGen()))});
+    ASSERT_TRUE(basic(data) == pippenger(data, cache, N));
+  }
+}
+
+TEST(multiexp, pippenger_threaded)
+{
+  for (size_t n = 1; n < 512; n = n * 3 + 1)
+  {
+    std::vector<rct::MultiexpData> data;
+    for (size_t s = 0; s < n; ++s)
+      data.push_back({rct::skGen(), get_p3(rct::scalarmultBase(rct::skGen()))});
+    // small scalars leave the high windows empty
+    data[0].scalar = rct::zero();
+    data[n / 2].scalar = rct::identity();
+    ASSERT_TRUE(basic(data) == rct::pippenger_threaded(data));
+    ASSERT_TRUE(pippenger(data, NULL, 0, 2) == rct::pippenger_threaded(data, NULL, 0, 2));
+  }
+}
+
 TEST(multiexp, scalarmult_triple)
 {
   std::vector<rct::MultiexpData> data;
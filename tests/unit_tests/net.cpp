@@ -1327,3 +1327,52 @@ TEST(dandelionpp_map, dropped_all_connections)
             EXPECT_EQ(3u, entry.second);
     }
 }
+
+TEST(dandelionpp_map, removed_connection)
+{
+    boost::uuids::random_generator random_uuid{};
+
+    std::vector<boost::uuids::uuid> connections{4};
+    for (auto &e: connections)
+      e = random_uuid();
+
+    // select 3 of 4 outgoing connections
+    net::dandelionpp::connection_map mapper{connections, 3};
+    EXPECT_EQ(3u, mapper.size());
+
+    std::vector<boost::uuids::uuid> in_connections{6};
+    for (auto &e: in_connections)
+      e = random_uuid();
+    for (const boost::uuids::uuid& connection : in_connections)
+        EXPECT_FALSE(mapper.get_stem(connection).is_nil());
+
+    const boost::uuids::uuid lost_connection = *mapper.begin();
+    EXPECT_FALSE(mapper.remove(random_uuid()));
+    EXPECT_TRUE(mapper.remove(lost_connection));
+    EXPECT_FALSE(mapper.remove(lost_connection));
+    EXPECT_EQ(2u, mapper.size());
+    EXPECT_TRUE(mapper.begin()->is_nil());
+
+    // sources on the removed stem are moved to the remaining two
+    {
+        std::map<boost::uuids::uuid, std::size_t> used;
+        for (const boost::uuids::uuid& connection : in_connections)
+        {
+            const boost::uuids::uuid out = mapper.get_stem(connection);
+            EXPECT_FALSE(out.is_nil());
+            EXPECT_NE(lost_connection, out);
+            used[out]++;
+        }
+        EXPECT_EQ(2u, used.size());
+    }
+
+    // the hole is filled from the unused connection
+    connections.erase(std::find(connections.begin(), connections.end(), lost_connection));
+    EXPECT_TRUE(mapper.update(connections));
+    EXPECT_EQ(3u, mapper.size());
+    for (const boost::uuids::uuid& connection : mapper)
+    {
+        EXPECT_NE(lost_connection, connection);
+        EXPECT_NE(connections.end(), std::find(connections.begin(), connections.end(), connection));
+    }
+}
@@ -0,0 +1,59 @@
+#include "gtest/gtest.h"
+
+#include <chrono>
+
+#include "common/profiler.h"
+
+#ifdef __linux__
+static volatile uint64_t sink;
+
+static void burn_cpu(std::chrono::milliseconds how_long)
+{
+  auto until = std::chrono::steady_clock::now() + how_long;
+  uint64_t x = 1;
+  while (std::chrono::steady_clock::now() < until)
+    for (int i = 0; i < 10000; i++)
+      x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+  sink = x;
+}
+
+TEST(profiler, samples_busy_thread)
+{
+  ASSERT_TRUE(tools::profiler::start(1000));
+  EXPECT_TRUE(tools::profiler::running());
+  burn_cpu(std::chrono::milliseconds{300});
+  tools::profiler::stop();
+  EXPECT_FALSE(tools::profiler::running());
+
+  EXPECT_GT(tools::profiler::samples(), 0u);
+  auto stacks = tools::profiler::collapsed_stacks();
+  ASSERT_FALSE(stacks.empty());
+  // Every line is "frame;frame;... count"
+  for (size_t pos = 0; pos < stacks.size(); )
+  {
+    auto eol = stacks.find('\n', pos);
+    ASSERT_NE(eol, std::string::npos);
+    auto line = stacks.substr(pos, eol - pos);
+    auto sp = line.rfind(' ');
+    ASSERT_NE(sp, std::string::npos);
+    EXPECT_NE(line.find(';'), std::string::npos);
+    EXPECT_GT(std::stoul(line.substr(sp + 1)), 0u);
+    pos = eol + 1;
+  }
+
+  // Samples are kept after stopping, and a restart discards them
+  const auto taken = tools::profiler::samples();
+  burn_cpu(std::chrono::milliseconds{50});
+  EXPECT_EQ(tools::profiler::samples(), taken);
+  ASSERT_TRUE(tools::profiler::start(1000));
+  tools::profiler::stop();
+  EXPECT_LT(tools::profiler::samples(), taken);
+}
+
+TEST(profiler, rejects_bad_frequency)
+{
+  EXPECT_FALSE(tools::profiler::start(0));
+  EXPECT_FALSE(tools::profiler::start(100000));
+  EXPECT_FALSE(tools::profiler::running());
+}
+#endif
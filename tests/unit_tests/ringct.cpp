@@ -837,6 +837,32 @@ TEST(ringct, mul8)
   ASSERT_EQ(rct::scalarmultKey(rct::scalarmultKey(rct::H, rct::INV_EIGHT), rct::EIGHT), rct::H);
 }
 
+TEST(ringct, equalSums)
+{
+  // two inputs and three outputs, with the masks balanced so that inputs = outputs + fee*H
+  const rct::key m0 = rct::skGen(), m1 = rct::skGen(), m2 = rct::skGen(), m3 = rct::skGen();
+  rct::key m4;
+  sc_add(m4.bytes, m0.bytes, m1.bytes);
+  sc_sub(m4.bytes, m4.bytes, m2.bytes);
+  sc_sub(m4.bytes, m4.bytes, m3.bytes);
+  const uint64_t fee = 0xfedcba9876543210;
+  rct::keyV inputs{rct::commit(0xffffffffffffffff, m0), rct::commit(0xfedcba9876543210, m1)};
+  const rct::keyV outputs{rct::commit(0xffffffff00000000, m2), rct::commit(0xffffffff, m3), rct::commit(0, m4)};
+  ASSERT_TRUE(rct::equalSums(inputs, outputs, fee));
+  ASSERT_FALSE(rct::equalSums(inputs, outputs, fee + 1));
+  ASSERT_FALSE(rct::equalSums(outputs, inputs, fee));
+  ASSERT_TRUE(rct::equalSums({}, {}, 0));
+  ASSERT_TRUE(rct::equalSums({rct::scalarmultH(rct::d2h(fee))}, {}, fee));
+
+  // a difference in the small subgroup must not go unnoticed
+  rct::key torsion = rct::identity(); // the point of order 2
+  torsion.bytes[0] = 0xec;
+  memset(torsion.bytes + 1, 0xff, 30);
+  torsion.bytes[31] = 0x7f;
+  inputs[0] = rct::addKeys(inputs[0], torsion);
+  ASSERT_FALSE(rct::equalSums(inputs, outputs, fee));
+}
+
 TEST(ringct, aggregated)
 {
   static const size_t N_PROOFS = 16;
@@ -131,6 +131,45 @@ TEST(ringdb, different_genesis)
   ASSERT_FALSE(ringdb.get_ring(get_context().KEY_2, get_context().KEY_IMAGE_1, outs2));
 }
 
+TEST(ringdb, batch)
+{
+  RingDB ringdb;
+  std::vector<uint64_t> outs, outs2;
+  outs.push_back(43); outs.push_back(7320); outs.push_back(8429);
+  ringdb.begin_batch();
+  ASSERT_TRUE(ringdb.set_ring(get_context().KEY_1, get_context().KEY_IMAGE_1, outs, false));
+  ASSERT_TRUE(ringdb.get_ring(get_context().KEY_1, get_context().KEY_IMAGE_1, outs2));
+  ASSERT_EQ(outs, outs2);
+  ASSERT_TRUE(ringdb.commit_batch());
+  ASSERT_FALSE(ringdb.in_batch());
+  outs2.clear();
+  ASSERT_TRUE(ringdb.get_ring(get_context().KEY_1, get_context().KEY_IMAGE_1, outs2));
+  ASSERT_EQ(outs, outs2);
+
+  ringdb.begin_batch();
+  ASSERT_TRUE(ringdb.remove_rings(get_context().KEY_1, std::vector<crypto::key_image>{get_context().KEY_IMAGE_1}));
+  ASSERT_FALSE(ringdb.get_ring(get_context().KEY_1, get_context().KEY_IMAGE_1, outs2));
+  ringdb.abort_batch();
+  ASSERT_TRUE(ringdb.get_ring(get_context().KEY_1, get_context().KEY_IMAGE_1, outs2));
+}
+
+TEST(ringdb, get_rings)
+{
+  RingDB ringdb;
+  const crypto::key_image key_image_2 = generate_key_image(), key_image_3 = generate_key_image();
+  std::vector<uint64_t> outs{43, 7320, 8429}, outs2{5, 6, 7};
+  ASSERT_TRUE(ringdb.set_ring(get_context().KEY_1, get_context().KEY_IMAGE_1, outs, false));
+  ringdb.begin_batch();
+  ASSERT_TRUE(ringdb.set_ring(get_context().KEY_1, key_image_2, outs2, false));
+
+  std::unordered_map<crypto::key_image, std::vector<uint64_t>> rings;
+  ASSERT_TRUE(ringdb.get_rings(get_context().KEY_1, {get_context().KEY_IMAGE_1, key_image_2, key_image_3}, rings));
+  ASSERT_EQ(rings.size(), 2);
+  ASSERT_EQ(rings[get_context().KEY_IMAGE_1], outs);
+  ASSERT_EQ(rings[key_image_2], outs2);
+  ASSERT_TRUE(ringdb.commit_batch());
+}
+
 TEST(spent_outputs, not_found)
 {
   RingDB ringdb;
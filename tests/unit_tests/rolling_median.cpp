@@ -200,3 +200,34 @@ TEST(rolling_median, size)
     ASSERT_EQ(m.size(), std::min<int>(10, i + 2));
   }
 }
+
+TEST(rolling_median, rollback)
+{
+  epee::misc_utils::rolling_median_t<uint64_t> m(100);
+  std::vector<uint64_t> v;
+  for (int i = 0; i < 10000; ++i)
+  {
+    if (v.size() > 100 && crypto::rand<uint64_t>() % 3 == 0)
+    {
+      // undo the newest insert, putting back the value it pushed out of the window
+      const uint64_t oldest = v[v.size() - 101];
+      v.pop_back();
+      ASSERT_TRUE(m.rollback(oldest));
+    }
+    else
+    {
+      uint64_t r = crypto::rand<uint64_t>() % 1000;
+      v.push_back(r);
+      m.insert(r);
+    }
+    std::vector<uint64_t> vcopy(v.end() - std::min<size_t>(v.size(), 100), v.end());
+    ASSERT_EQ(m.size(), vcopy.size());
+    ASSERT_EQ(m.median(), epee::misc_utils::median(vcopy));
+  }
+
+  // can't roll back a window that isn't full
+  m.clear();
+  m.insert(1);
+  ASSERT_FALSE(m.rollback(2));
+  ASSERT_EQ(m.median(), 1);
+}
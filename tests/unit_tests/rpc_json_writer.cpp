@@ -0,0 +1,132 @@
+#include "gtest/gtest.h"
+
+#include <string>
+
+#include "epee/storages/portable_storage.h"
+#include "rpc/core_rpc_server_commands_defs.h"
+#include "rpc/json_writer.h"
+
+using namespace cryptonote::rpc;
+
+namespace
+{
+  template <typename T>
+  std::string epee_json(const T& t)
+  {
+    epee::serialization::portable_storage ps;
+    t.store(ps);
+    std::string json;
+    ps.dump_as_json(json, 0 /*indent*/, false /*newlines*/);
+    return json;
+  }
+
+  template <typename T>
+  std::string direct_json(const T& t)
+  {
+    std::string json;
+    EXPECT_TRUE(t.write_json(json));
+    return json;
+  }
+
+  block_header_response make_header(uint64_t height)
+  {
+    block_header_response h{};
+    h.major_version = 18;
+    h.minor_version = 18;
+    h.timestamp = 1600000000 + height;
+    h.prev_hash = std::string(64, 'a');
+    h.nonce = 12345;
+    h.height = height;
+    h.depth = 3;
+    h.hash = std::string(64, 'b');
+    h.difficulty = 1000;
+    h.cumulative_difficulty = 123456789012345;
+    h.reward = 16'500'000'000;
+    h.miner_reward = 1'000'000;
+    h.block_size = h.block_weight = 2000;
+    h.num_txes = height % 2;
+    h.miner_tx_hash = std::string(64, 'c');
+    if (height % 2)
+    {
+      h.pow_hash = std::string(64, 'd');
+      h.tx_hashes = {std::string(64, 'e')};
+    }
+    h.service_node_winner = std::string(64, 'f');
+    return h;
+  }
+}
+
+TEST(rpc_json_writer, escapes_like_epee)
+{
+  epee::serialization::portable_storage ps;
+  const std::string s = "plain \"quoted\" back\\slash\nnew\ttab\x01\x1f end";
+  ps.set_value("s", s, nullptr);
+  std::string expected;
+  ps.dump_as_json(expected, 0, false);
+
+  std::string json;
+  json_writer w{json};
+  w.begin_object();
+  w.field("s", s);
+  w.end_object();
+  EXPECT_EQ(json, expected);
+}
+
+TEST(rpc_json_writer, get_transactions)
+{
+  GET_TRANSACTIONS::response res{};
+  res.status = STATUS_OK;
+  res.missed_tx = {std::string(64, '0')};
+  auto& mined = res.txs.emplace_back();
+  mined.tx_hash = std::string(64, '1');
+  mined.as_hex = "0102030405";
+  mined.as_json = "{\n  \"version\": 4\n}";
+  mined.size = 5;
+  mined.block_height = 1234;
+  mined.block_timestamp = 1600000000;
+  mined.output_indices = {1, 2, 3000000000};
+  mined.blink = true;
+  auto& pool = res.txs.emplace_back();
+  pool.tx_hash = std::string(64, '2');
+  pool.pruned_as_hex = "aa";
+  pool.prunable_hash = std::string(64, '3');
+  pool.size = 1;
+  pool.in_pool = true;
+  pool.relayed = true;
+  pool.received_timestamp = 1600000123;
+  pool.stake_amount = 15000;
+  EXPECT_EQ(direct_json(res), epee_json(res));
+
+  res.txs.clear();
+  res.missed_tx.clear();
+  EXPECT_EQ(direct_json(res), epee_json(res));
+
+  res.txs.emplace_back().extra.emplace();
+  std::string json;
+  EXPECT_FALSE(res.write_json(json));
+  EXPECT_TRUE(json.empty());
+}
+
+TEST(rpc_json_writer, get_block)
+{
+  GET_BLOCK::response res{};
+  res.status = STATUS_OK;
+  res.block_header = make_header(101);
+  res.tx_hashes = res.block_header.tx_hashes;
+  res.blob = "0a0b0c";
+  res.json = "{\"major_version\": 18}";
+  EXPECT_EQ(direct_json(res), epee_json(res));
+}
+
+TEST(rpc_json_writer, get_block_headers_range)
+{
+  GET_BLOCK_HEADERS_RANGE::response res{};
+  res.status = STATUS_OK;
+  res.untrusted = true;
+  EXPECT_EQ(direct_json(res), epee_json(res));
+  for (uint64_t h = 100; h < 104; h++)
+    res.headers.push_back(make_header(h));
+  res.headers[2].block_weight = 0;
+  res.headers[2].long_term_weight = 0;
+  EXPECT_EQ(direct_json(res), epee_json(res));
+}
@@ -36,6 +36,7 @@
 #include <boost/archive/portable_binary_iarchive.hpp>
 #include "cryptonote_basic/cryptonote_basic.h"
 #include "cryptonote_basic/cryptonote_basic_impl.h"
+#include "cryptonote_basic/transaction_view.h"
 #include "ringct/rctSigs.h"
 #include "serialization/binary_archive.h"
 #include "serialization/json_archive.h"
@@ -601,6 +602,68 @@ TEST(serialization, serializes_ringct)
 //             - 2019-02-25 Doyle
 
 #if 0
+TEST(serialization, transaction_view)
+{
+  cryptonote::transaction tx;
+  tx.version = cryptonote::txversion::v4_tx_types;
+  tx.type = cryptonote::txtype::standard;
+  for (int i = 0; i < 2; ++i)
+  {
+    cryptonote::txin_to_key in;
+    in.amount = 0;
+    in.key_offsets = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    in.k_image = rct::rct2ki(rct::pkGen());
+    tx.vin.push_back(in);
+    tx.vout.push_back({0, cryptonote::txout_to_key{rct::rct2pk(rct::pkGen())}});
+    tx.output_unlock_times.push_back(0);
+  }
+  tx.extra = {1, 2, 3};
+
+  rct::rctSig &rv = tx.rct_signatures;
+  rv.type = rct::RCTType::CLSAG;
+  rv.txnFee = 1234;
+  rv.ecdhInfo.resize(2);
+  rv.outPk.resize(2);
+  for (auto &pk : rv.outPk)
+    pk.mask = rct::pkGen();
+  rv.p.bulletproofs.resize(1);
+  rct::Bulletproof &bp = rv.p.bulletproofs[0];
+  bp.A = bp.S = bp.T1 = bp.T2 = bp.taux = bp.mu = bp.a = bp.b = bp.t = rct::skGen();
+  bp.L = bp.R = rct::keyV(7, rct::pkGen());
+  rv.p.CLSAGs.resize(2);
+  for (auto &sig : rv.p.CLSAGs)
+  {
+    sig.s = rct::keyV(10, rct::skGen());
+    sig.c1 = rct::skGen();
+    sig.D = rct::pkGen();
+  }
+  rv.p.pseudoOuts = rct::keyV(2, rct::pkGen());
+
+  const std::string blob = serialization::dump_binary(tx);
+  cryptonote::transaction parsed;
+  ASSERT_TRUE(cryptonote::parse_and_validate_tx_from_blob(blob, parsed));
+
+  cryptonote::transaction_view view{blob};
+  EXPECT_EQ(view.prefix().vin.size(), 2);
+  EXPECT_EQ(view.prefix_size(), parsed.prefix_size);
+  EXPECT_EQ(view.unprunable_size(), parsed.unprunable_size);
+  EXPECT_EQ(view.rct_base().txnFee, 1234);
+  ASSERT_EQ(view.rct_base().outPk.size(), 2);
+  EXPECT_EQ(view.rct_base().outPk[1].dest, parsed.rct_signatures.outPk[1].dest);
+  EXPECT_EQ(view.prefix_hash(), cryptonote::get_transaction_prefix_hash(parsed));
+  EXPECT_EQ(view.prunable_hash(), cryptonote::get_transaction_prunable_hash(parsed));
+  EXPECT_EQ(view.hash(), cryptonote::get_transaction_hash(parsed));
+  EXPECT_EQ(cryptonote::get_transaction_hash(view.tx()), view.hash());
+
+  serialization::binary_string_archiver ba;
+  parsed.serialize_base(ba);
+  EXPECT_EQ(view.pruned_blob(), ba.str());
+
+  EXPECT_THROW(cryptonote::transaction_view{std::string_view{blob}.substr(0, view.prefix_size() - 1)}, std::runtime_error);
+  cryptonote::transaction_view truncated{std::string_view{blob}.substr(0, view.prefix_size() + 1)};
+  EXPECT_THROW(truncated.rct_base(), std::runtime_error);
+}
+
 TEST(serialization, portability_wallet)
 {
   const cryptonote::network_type nettype = cryptonote::TESTNET;
@@ -552,3 +552,27 @@ TEST(service_nodes, service_node_get_locked_key_image_unlock_height)
     ASSERT_EQ(unlock_height, expected);
   }
 }
+
+TEST(service_nodes, participation_history_failure_count)
+{
+  service_nodes::participation_history<service_nodes::timesync_entry, 4> history{};
+  service_nodes::timesync_entry fail{false}, pass{true};
+
+  // Not judged until the window is full
+  for (int i = 0; i < 3; i++) history.add(fail);
+  ASSERT_TRUE(history.check_participation(1));
+  history.add(pass);
+  ASSERT_FALSE(history.check_participation(2));
+  ASSERT_TRUE(history.check_participation(3));
+
+  // Failures drop out of the count as they are overwritten
+  history.add(pass);
+  history.add(pass);
+  ASSERT_EQ(history.failures, 1u);
+  ASSERT_TRUE(history.check_participation(1));
+
+  history.reset();
+  ASSERT_EQ(history.failures, 0u);
+  for (int i = 0; i < 4; i++) history.add(pass);
+  ASSERT_TRUE(history.check_participation(0));
+}
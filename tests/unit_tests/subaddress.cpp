@@ -99,3 +99,21 @@ TEST_F(WalletSubaddress, OutOfBoundsIndexes)
     EXPECT_STREQ("index.minor is out of bound", e.what());  
   }   
 }
+
+TEST_F(WalletSubaddress, LookaheadMatchesSubaddresses)
+{
+  // Large enough that the lookahead is generated in several chunks
+  w1.set_subaddress_lookahead(2, 2500);
+  w1.add_subaddress_account("lookahead");
+  for (uint32_t major = 2; major < 4; ++major)
+  {
+    for (uint32_t minor : {0u, 1u, 999u, 1000u, 1001u, 2499u})
+    {
+      auto index = w1.get_subaddress_index(w1.get_subaddress({major, minor}));
+      ASSERT_TRUE(index);
+      EXPECT_EQ(major, index->major);
+      EXPECT_EQ(minor, index->minor);
+    }
+  }
+  EXPECT_FALSE(w1.get_subaddress_index(w1.get_subaddress({2, 2500})));
+}
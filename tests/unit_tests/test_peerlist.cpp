@@ -30,9 +30,13 @@
 
 #include "gtest/gtest.h"
 
+#include <algorithm>
+
+#include "common/expect.h"
 #include "common/util.h"
 #include "p2p/net_peerlist.h"
 #include "epee/net/net_utils_base.h"
+#include "net/tor_address.h"
 
 TEST(peer_list, peer_list_general)
 {
@@ -84,6 +88,8 @@ TEST(peer_list, merge_peer_lists)
 
 namespace
 {
+  constexpr const char v3_onion[] = "vww6ybal4bd7szmgncyruucpgfkqahzddi37ktceo3ah7ngmcopnpyyd.onion";
+
   bool check_empty(nodetool::peerlist_storage& peers, std::initializer_list<epee::net_utils::zone> zones)
   {
     bool pass = false;
@@ -108,6 +114,9 @@ TEST(peerlist_storage, store)
   nodetool::peerlist_storage peers{};
   EXPECT_TRUE(check_empty(peers, {zone::invalid, zone::public_, zone::tor, zone::i2p}));
 
+  // entries are unique by address within each list, as in peerlist_manager
+  const net::tor_address second_tor = MONERO_UNWRAP(net::tor_address::make(v3_onion));
+
   std::string buffer{};
   {
     nodetool::peerlist_types types{};
@@ -117,7 +126,7 @@ TEST(peerlist_storage, store)
     types.gray.push_back({epee::net_utils::ipv4_network_address{2000, 20}, 84, 45});
     types.anchor.push_back({epee::net_utils::ipv4_network_address{999, 654}, 444, 555});
     types.anchor.push_back({net::tor_address::unknown(), 14, 33});
-    types.anchor.push_back({net::tor_address::unknown(), 24, 22});
+    types.anchor.push_back({second_tor, 24, 22});
 
     std::ostringstream stream{};
     EXPECT_TRUE(peers.store(stream, types));
@@ -127,7 +136,7 @@ TEST(peerlist_storage, store)
   {
     std::istringstream stream{buffer};
     std::optional<nodetool::peerlist_storage> read_peers =
-      nodetool::peerlist_storage::open(stream, true);
+      nodetool::peerlist_storage::open(stream);
     ASSERT_TRUE(bool(read_peers));
     peers = std::move(*read_peers);
   }
@@ -187,7 +196,7 @@ TEST(peerlist_storage, store)
   EXPECT_EQ(14u, types.anchor[0].id);
   EXPECT_EQ(33u, types.anchor[0].first_seen);
   ASSERT_EQ(address_type::tor, types.anchor[1].adr.get_type_id());
-  EXPECT_STREQ(net::tor_address::unknown_str(), types.anchor[1].adr.template as<net::tor_address>().host_str());
+  EXPECT_STREQ(v3_onion, types.anchor[1].adr.template as<net::tor_address>().host_str());
   EXPECT_EQ(0u, types.anchor[1].adr.template as<net::tor_address>().port());
   EXPECT_EQ(24u, types.anchor[1].id);
   EXPECT_EQ(22u, types.anchor[1].first_seen);
@@ -195,7 +204,7 @@ TEST(peerlist_storage, store)
   {
     std::istringstream stream{buffer};
     std::optional<nodetool::peerlist_storage> read_peers =
-      nodetool::peerlist_storage::open(stream, true);
+      nodetool::peerlist_storage::open(stream);
     ASSERT_TRUE(bool(read_peers));
     peers = std::move(*read_peers);
   }
@@ -249,8 +258,69 @@ TEST(peerlist_storage, store)
   EXPECT_EQ(14u, types.anchor[0].id);
   EXPECT_EQ(33u, types.anchor[0].first_seen);
   ASSERT_EQ(address_type::tor, types.anchor[1].adr.get_type_id());
-  EXPECT_STREQ(net::tor_address::unknown_str(), types.anchor[1].adr.template as<net::tor_address>().host_str());
+  EXPECT_STREQ(v3_onion, types.anchor[1].adr.template as<net::tor_address>().host_str());
   EXPECT_EQ(0u, types.anchor[1].adr.template as<net::tor_address>().port());
   EXPECT_EQ(24u, types.anchor[1].id);
   EXPECT_EQ(22u, types.anchor[1].first_seen);
 }
+
+TEST(peerlist_storage, incremental_store)
+{
+  using zone = epee::net_utils::zone;
+
+  const fs::path dir = fs::temp_directory_path() / ("oxen-peerlist-" + std::to_string(crypto::rand<uint64_t>()));
+  fs::create_directories(dir);
+  const fs::path path = dir / "p2pstate.bin";
+
+  nodetool::peerlist_types types{};
+  for (uint32_t i = 0; i < 100; i++)
+    types.gray.push_back({epee::net_utils::ipv4_network_address{1000 + i, 10}, i, 55});
+  types.white.push_back({epee::net_utils::ipv6_network_address{boost::asio::ip::address_v6::loopback(), 30}, 44, 66, 0x81, 22});
+
+  nodetool::peerlist_storage peers{};
+  ASSERT_TRUE(peers.store(path, types));
+  const auto full_size = fs::file_size(path);
+
+  // An unchanged save writes nothing; changes only append their own records
+  ASSERT_TRUE(peers.store(path, types));
+  EXPECT_EQ(full_size, fs::file_size(path));
+  types.gray[5].last_seen = 77;
+  types.gray.pop_back();
+  ASSERT_TRUE(peers.store(path, types));
+  EXPECT_LT(full_size, fs::file_size(path));
+  EXPECT_GT(full_size + 30, fs::file_size(path));
+
+  {
+    auto read = nodetool::peerlist_storage::open(path);
+    ASSERT_TRUE(read);
+    const auto got = read->take_zone(zone::public_);
+    ASSERT_EQ(99u, got.gray.size());
+    ASSERT_EQ(1u, got.white.size());
+    EXPECT_EQ(types.white[0].adr, got.white[0].adr);
+    EXPECT_EQ(0x81u, got.white[0].pruning_seed);
+    EXPECT_EQ(22u, got.white[0].rpc_port);
+    const auto changed = std::find_if(got.gray.begin(), got.gray.end(), [](const auto& e) { return e.id == 5; });
+    ASSERT_NE(got.gray.end(), changed);
+    EXPECT_EQ(77, changed->last_seen);
+    EXPECT_TRUE(std::none_of(got.gray.begin(), got.gray.end(), [](const auto& e) { return e.id == 99; }));
+  }
+
+  // A partially written final record is dropped, and the next save rewrites the file
+  {
+    fs::ofstream out{path, std::ios::binary | std::ios::app};
+    out.write("\x10\x01", 2);
+  }
+  {
+    auto read = nodetool::peerlist_storage::open(path);
+    ASSERT_TRUE(read);
+    peers = std::move(*read);
+  }
+  ASSERT_TRUE(peers.store(path, nodetool::peerlist_types{}));
+  {
+    auto read = nodetool::peerlist_storage::open(path);
+    ASSERT_TRUE(read);
+    EXPECT_EQ(99u, read->take_zone(zone::public_).gray.size());
+  }
+
+  fs::remove_all(dir);
+}
@@ -53,3 +53,41 @@ TEST(protocol_pack, protocol_pack_command)
     ASSERT_TRUE(r.total_height == 3);
   }
 }
+
+TEST(protocol_pack, block_blobs_round_trip)
+{
+  cryptonote::NOTIFY_RESPONSE_GET_BLOCKS::request r{};
+  r.current_blockchain_height = 123;
+  for (int i = 0; i < 5; i++)
+  {
+    auto& bce = r.blocks.emplace_back();
+    bce.block = std::string(1000 + i, 'a' + i);
+    for (int t = 0; t < i; t++)
+      bce.txs.push_back(std::string(200 + t, 'A' + t));
+  }
+  r.missed_ids.push_back(crypto::hash{});
+  std::string buff;
+  ASSERT_TRUE(epee::serialization::store_t_to_binary(r, buff));
+
+  // blob strings get moved out of the storage while loading; make sure every one arrives intact
+  cryptonote::NOTIFY_RESPONSE_GET_BLOCKS::request r2{};
+  ASSERT_TRUE(epee::serialization::load_t_from_binary(r2, buff));
+  ASSERT_EQ(r2.current_blockchain_height, 123);
+  ASSERT_EQ(r2.missed_ids.size(), 1);
+  ASSERT_EQ(r2.blocks.size(), r.blocks.size());
+  for (size_t i = 0; i < r.blocks.size(); i++)
+  {
+    ASSERT_EQ(r2.blocks[i].block, r.blocks[i].block);
+    ASSERT_EQ(r2.blocks[i].txs, r.blocks[i].txs);
+  }
+
+  // and a storage that doesn't consume keeps its values for a second read
+  epee::serialization::portable_storage ps;
+  ASSERT_TRUE(ps.load_from_binary(buff));
+  cryptonote::NOTIFY_RESPONSE_GET_BLOCKS::request r3{}, r4{};
+  ASSERT_TRUE(r3.load(ps));
+  ASSERT_TRUE(r4.load(ps));
+  ASSERT_EQ(r4.blocks.size(), r.blocks.size());
+  ASSERT_EQ(r4.blocks.back().block, r.blocks.back().block);
+  ASSERT_EQ(r4.blocks.back().txs, r.blocks.back().txs);
+}
@@ -79,6 +79,7 @@ public:
   virtual bool get_top_checkpoint     (cryptonote::checkpoint_t &checkpoint) const override { return false; }
   virtual void remove_block_checkpoint(uint64_t height) override { }
   std::vector<checkpoint_t> get_checkpoints_range(uint64_t start, uint64_t end, size_t num_desired_checkpoints = GET_ALL_CHECKPOINTS) const override { return {}; }
+  virtual std::string_view get_block_blob_view_from_height(uint64_t height) const override { return {}; }
   virtual cryptonote::blobdata get_block_blob(const crypto::hash& h) const override { return cryptonote::blobdata(); }
   virtual uint64_t get_block_height(const crypto::hash& h) const override { return 0; }
   virtual cryptonote::block_header get_block_header(const crypto::hash& h) const override { return cryptonote::block_header(); }
@@ -105,6 +106,7 @@ public:
   virtual bool get_pruned_tx(const crypto::hash& h, cryptonote::transaction &tx) const override { return false; }
   virtual bool get_tx_blob(const crypto::hash& h, cryptonote::blobdata &tx) const override { return false; }
   virtual bool get_pruned_tx_blob(const crypto::hash& h, cryptonote::blobdata &tx) const override { return false; }
+  virtual bool get_pruned_tx_blob_views_from(const crypto::hash& h, size_t count, std::vector<std::string_view> &bd) const override { return false; }
   virtual bool get_prunable_tx_blob(const crypto::hash& h, cryptonote::blobdata &tx) const override { return false; }
   virtual bool get_prunable_tx_hash(const crypto::hash& tx_hash, crypto::hash &prunable_hash) const override { return false; }
   virtual uint64_t get_tx_count() const override { return 0; }
@@ -131,6 +133,7 @@ public:
   virtual void prune_outputs(uint64_t amount) override {}
   virtual uint32_t get_blockchain_pruning_seed() const override { return 0; }
   virtual bool prune_blockchain(uint32_t pruning_seed = 0) override { return true; }
+  virtual bool prune_blockchain_step(uint32_t pruning_seed, size_t max_records) override { return true; }
   virtual bool update_pruning() override { return true; }
   virtual bool check_pruning() override { return true; }
   virtual bool for_all_txpool_txes(std::function<bool(const crypto::hash&, const cryptonote::txpool_tx_meta_t&, const cryptonote::blobdata*)>, bool include_blob, bool include_unrelayed_txes) const override { return false; }
@@ -148,10 +151,10 @@ public:
   virtual bool is_read_only() const override { return false; }
   virtual uint64_t get_database_size() const override { return 0; }
 
-  virtual void get_output_blacklist   (std::vector<uint64_t> &blacklist)       const override { }
+  virtual void get_output_blacklist   (std::vector<uint64_t> &blacklist, uint64_t from = 0) const override { }
   virtual void add_output_blacklist   (std::vector<uint64_t> const &blacklist)       override { }
   virtual void set_service_node_data  (const std::string& data, bool long_term)      override { }
-  virtual bool get_service_node_data  (std::string& data, bool long_term)            override { return false; }
+  virtual bool get_service_node_data  (std::string_view& data, bool long_term)       override { return false; }
   virtual void clear_service_node_data()                                             override { }
 
   virtual cryptonote::transaction get_pruned_tx(const crypto::hash& h) const override { return {}; };
@@ -0,0 +1,31 @@
+#include "gtest/gtest.h"
+
+#include "common/thread_affinity.h"
+
+using namespace std::literals;
+
+TEST(thread_affinity, parse_cpu_set)
+{
+  EXPECT_EQ(tools::parse_cpu_set("3"), (std::vector<unsigned>{3}));
+  EXPECT_EQ(tools::parse_cpu_set("0-3,8,10-11"), (std::vector<unsigned>{0, 1, 2, 3, 8, 10, 11}));
+  EXPECT_EQ(tools::parse_cpu_set("5,1-2,2"), (std::vector<unsigned>{1, 2, 5}));
+  EXPECT_FALSE(tools::parse_cpu_set(""));
+  EXPECT_FALSE(tools::parse_cpu_set("3-1"));
+  EXPECT_FALSE(tools::parse_cpu_set("1-"));
+  EXPECT_FALSE(tools::parse_cpu_set("a"));
+
+  const auto& nodes = tools::numa_nodes();
+  ASSERT_FALSE(nodes.empty());
+  EXPECT_FALSE(tools::parse_cpu_set("node" + std::to_string(nodes.size())));
+  for (size_t n = 0; n < nodes.size(); n++)
+    if (!nodes[n].empty())
+      EXPECT_EQ(tools::parse_cpu_set("node" + std::to_string(n)), nodes[n]);
+}
+
+TEST(thread_affinity, set_thread_affinity)
+{
+  EXPECT_FALSE(tools::set_thread_affinity("threadpool"));
+  EXPECT_FALSE(tools::set_thread_affinity("nosuchpool=0"));
+  EXPECT_FALSE(tools::set_thread_affinity("miner=x"));
+  EXPECT_TRUE(tools::set_thread_affinity("miner=numa"));
+}
@@ -26,7 +26,9 @@
 // STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <array>
 #include <atomic>
+#include <memory>
 #include "gtest/gtest.h"
 #include "epee/misc_language.h"
 #include "common/threadpool.h"
@@ -144,3 +146,43 @@ TEST(threadpool, leaf_reentrancy)
   waiter.wait(tpool.get());
   ASSERT_EQ(counter, 500000);
 }
+
+TEST(threadpool, large_and_move_only_tasks)
+{
+  std::shared_ptr<tools::threadpool> tpool(tools::threadpool::getNewForUnitTests(4));
+  tools::threadpool::waiter waiter;
+
+  std::atomic<uint64_t> sum(0);
+  for (uint64_t n = 0; n < 100; ++n)
+  {
+    std::array<uint64_t, 16> big; // too big to be stored in place
+    big.fill(n);
+    auto p = std::make_unique<uint64_t>(n);
+    tpool->submit(&waiter, [&sum, big, p = std::move(p)](){ sum += big[15] + *p; });
+  }
+  waiter.wait(tpool.get());
+  ASSERT_EQ(sum, 2 * 4950);
+}
+
+TEST(threadpool, parallel_for)
+{
+  std::shared_ptr<tools::threadpool> tpool(tools::threadpool::getNewForUnitTests(4));
+
+  for (size_t grain : {1, 7, 1000, 5000})
+  {
+    std::vector<std::atomic<int>> hits(1000);
+    tpool->parallel_for(0, hits.size(), grain, [&](size_t i) { ++hits[i]; });
+    for (const auto& h : hits)
+      ASSERT_EQ(h, 1);
+  }
+
+  std::atomic<int> counter(0);
+  tpool->parallel_for(5, 5, 1, [&](size_t) { ++counter; });
+  ASSERT_EQ(counter, 0);
+
+  // from inside a task, where nested submits run inline
+  tools::threadpool::waiter waiter;
+  tpool->submit(&waiter, [&](){ tpool->parallel_for(0, 100, 3, [&](size_t) { ++counter; }); });
+  waiter.wait(tpool.get());
+  ASSERT_EQ(counter, 100);
+}
@@ -0,0 +1,59 @@
+#include "gtest/gtest.h"
+
+#include "epee/net/token_bucket.h"
+
+using epee::net_utils::token_bucket;
+using namespace std::literals;
+
+namespace
+{
+  double ms(token_bucket::clock::duration d)
+  {
+    return std::chrono::duration<double, std::milli>(d).count();
+  }
+}
+
+TEST(token_bucket, unlimited)
+{
+  token_bucket bucket;
+  const auto now = token_bucket::clock::now();
+  EXPECT_EQ(token_bucket::clock::duration::zero(), bucket.reserve(1'000'000, now));
+  EXPECT_EQ(token_bucket::clock::duration::zero(), bucket.get_backlog(now));
+  EXPECT_EQ(1'000'000u, bucket.get_total());
+}
+
+TEST(token_bucket, paces_after_burst)
+{
+  token_bucket bucket{1000};
+  const auto now = token_bucket::clock::now();
+
+  // a full second's worth goes straight through, beyond that it has to wait
+  EXPECT_EQ(token_bucket::clock::duration::zero(), bucket.reserve(1000, now));
+  EXPECT_NEAR(500, ms(bucket.reserve(500, now)), 1);
+  EXPECT_NEAR(1500, ms(bucket.reserve(1000, now)), 1);
+  EXPECT_NEAR(1500, ms(bucket.get_backlog(now)), 1);
+
+  // the debt is paid off over time
+  EXPECT_NEAR(500, ms(bucket.get_backlog(now + 1s)), 1);
+  EXPECT_EQ(token_bucket::clock::duration::zero(), bucket.get_backlog(now + 2s));
+  EXPECT_EQ(token_bucket::clock::duration::zero(), bucket.reserve(100, now + 2s));
+  EXPECT_EQ(2600u, bucket.get_total());
+
+  // idle time doesn't build up more than a second of burst
+  EXPECT_EQ(token_bucket::clock::duration::zero(), bucket.reserve(1000, now + 10s));
+  EXPECT_NEAR(100, ms(bucket.reserve(100, now + 10s)), 1);
+}
+
+TEST(token_bucket, set_rate)
+{
+  token_bucket bucket{1000};
+  const auto now = token_bucket::clock::now();
+  EXPECT_NEAR(1000, ms(bucket.reserve(2000, now)), 1);
+
+  bucket.set_rate(2000, now);
+  EXPECT_EQ(2000u, bucket.get_rate());
+  EXPECT_NEAR(500, ms(bucket.get_backlog(now)), 1);
+
+  bucket.set_rate(0, now);
+  EXPECT_EQ(token_bucket::clock::duration::zero(), bucket.reserve(10'000, now));
+}
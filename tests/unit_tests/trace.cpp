@@ -0,0 +1,56 @@
+#include "gtest/gtest.h"
+
+#include <thread>
+
+#include "common/trace.h"
+
+TEST(trace, records_spans_when_enabled)
+{
+  tools::trace::clear();
+  {
+    TRACE_SPAN(blockchain, before_enable);
+  }
+  tools::trace::enable(true);
+  {
+    TRACE_SPAN(blockchain, outer);
+    TRACE_SPAN(rpc, inner);
+  }
+  std::thread{[] { TRACE_SPAN(p2p, other_thread); }}.join();
+  tools::trace::enable(false);
+  {
+    TRACE_SPAN(blockchain, after_disable);
+  }
+
+  auto json = tools::trace::chrome_trace_json();
+  EXPECT_EQ(json.find("before_enable"), std::string::npos);
+  EXPECT_EQ(json.find("after_disable"), std::string::npos);
+  EXPECT_NE(json.find(R"("cat":"blockchain","name":"outer")"), std::string::npos);
+  EXPECT_NE(json.find(R"("cat":"rpc","name":"inner")"), std::string::npos);
+  EXPECT_NE(json.find(R"("cat":"p2p","name":"other_thread")"), std::string::npos);
+
+  tools::trace::clear();
+  EXPECT_EQ(tools::trace::chrome_trace_json().find("outer"), std::string::npos);
+}
+
+TEST(trace, ring_keeps_newest)
+{
+  tools::trace::clear();
+  tools::trace::enable(true);
+  for (size_t i = 0; i < tools::trace::capacity; i++)
+  {
+    TRACE_SPAN(txpool, old_span);
+  }
+  for (size_t i = 0; i < tools::trace::capacity / 2; i++)
+  {
+    TRACE_SPAN(txpool, new_span);
+  }
+  tools::trace::enable(false);
+
+  auto json = tools::trace::chrome_trace_json();
+  size_t olds = 0, news = 0;
+  for (size_t pos = 0; (pos = json.find("old_span", pos)) != std::string::npos; pos++) olds++;
+  for (size_t pos = 0; (pos = json.find("new_span", pos)) != std::string::npos; pos++) news++;
+  EXPECT_EQ(olds, tools::trace::capacity / 2);
+  EXPECT_EQ(news, tools::trace::capacity / 2);
+  tools::trace::clear();
+}